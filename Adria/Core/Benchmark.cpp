@@ -0,0 +1,363 @@
+#include <filesystem>
+#include "Benchmark.h"
+#include "Paths.h"
+#include "ConsoleManager.h"
+#include "Logging/Logger.h"
+#include "Graphics/GfxDevice.h"
+#include "RenderGraph/RenderGraphProfiler.h"
+#include "Rendering/Camera.h"
+#include "Utilities/JsonUtil.h"
+#include "Utilities/FilesUtil.h"
+
+namespace adria
+{
+	namespace
+	{
+		struct Statistics
+		{
+			Float mean;
+			Float variance;
+			Float p50;
+			Float p95;
+			Float p99;
+		};
+
+		Statistics ComputeStatistics(std::vector<Float> samples)
+		{
+			if (samples.empty()) return {};
+			std::sort(samples.begin(), samples.end());
+			auto Percentile = [&samples](Float p)
+				{
+					Uint64 rank = (Uint64)std::ceil(p * samples.size());
+					return samples[std::clamp<Uint64>(rank, 1, samples.size()) - 1];
+				};
+
+			Float64 sum = 0.0;
+			for (Float sample : samples) sum += sample;
+			Float64 const mean = sum / samples.size();
+			Float64 squared_deviation_sum = 0.0;
+			for (Float sample : samples) squared_deviation_sum += (sample - mean) * (sample - mean);
+			Float64 const variance = samples.size() > 1 ? squared_deviation_sum / (samples.size() - 1) : 0.0;
+			return Statistics{ (Float)mean, (Float)variance, Percentile(0.50f), Percentile(0.95f), Percentile(0.99f) };
+		}
+
+		json StatisticsToJson(Statistics const& statistics)
+		{
+			return json{ {"mean", statistics.mean}, {"median", statistics.p50}, {"variance", statistics.variance},
+						 {"p50", statistics.p50}, {"p95", statistics.p95}, {"p99", statistics.p99} };
+		}
+
+		std::string CVarValueToString(json const& value)
+		{
+			if (value.is_string()) return value.get<std::string>();
+			if (value.is_boolean()) return value.get<Bool>() ? "1" : "0";
+			return value.dump();
+		}
+	}
+
+	Benchmark::Benchmark(std::string const& benchmark_file)
+	{
+		json camera_path_json, resolutions_json, permutations_json, passes_json;
+		try
+		{
+			JsonParams benchmark_params = json::parse(std::ifstream(benchmark_file));
+			scene_file = benchmark_params.FindOr<std::string>("scene", "sponza.json");
+			output_name = benchmark_params.FindOr<std::string>("output", GetFilenameWithoutExtension(benchmark_file));
+			warmup_frames = benchmark_params.FindOr<Uint32>("warmup_frames", warmup_frames);
+			measured_frames = benchmark_params.FindOr<Uint32>("frames", measured_frames);
+			fixed_delta_time = benchmark_params.FindOr<Float>("fixed_dt", fixed_delta_time);
+			baseline_file = benchmark_params.FindOr<std::string>("baseline", "");
+			regression_threshold = benchmark_params.FindOr<Float>("regression_threshold", regression_threshold);
+			regression_min_delta_ms = benchmark_params.FindOr<Float>("regression_min_delta_ms", regression_min_delta_ms);
+			camera_path_json = benchmark_params.FindJsonArray("camera_path");
+			resolutions_json = benchmark_params.FindJsonArray("resolutions");
+			permutations_json = benchmark_params.FindJsonArray("permutations");
+			passes_json = benchmark_params.FindJsonArray("passes");
+		}
+		catch (json::parse_error const& e)
+		{
+			ADRIA_LOG(ERROR, "Benchmark json parsing error: %s! ", e.what());
+			return;
+		}
+
+		for (auto&& keyframe_json : camera_path_json)
+		{
+			JsonParams keyframe_params(keyframe_json);
+			Float position[3] = { 0.0f, 0.0f, 0.0f };
+			Float look_at[3] = { 0.0f, 0.0f, 1.0f };
+			if (!keyframe_params.FindArray("position", position) || !keyframe_params.FindArray("look_at", look_at))
+			{
+				ADRIA_LOG(WARNING, "Benchmark camera keyframe doesn't have position or look_at field! Skipping this keyframe...");
+				continue;
+			}
+			camera_path.emplace_back(Vector3(position), Vector3(look_at));
+		}
+
+		for (auto&& pass_json : passes_json)
+		{
+			if (pass_json.is_string()) pass_filter.push_back(pass_json.get<std::string>());
+		}
+
+		//every resolution is measured with every permutation, a benchmark without either is a single run of the current settings
+		std::vector<std::pair<Uint32, Uint32>> resolutions;
+		for (auto&& resolution_json : resolutions_json)
+		{
+			if (!resolution_json.is_array() || resolution_json.size() != 2)
+			{
+				ADRIA_LOG(WARNING, "Benchmark resolution has to be a [width, height] array! Skipping this resolution...");
+				continue;
+			}
+			resolutions.emplace_back(resolution_json[0].get<Uint32>(), resolution_json[1].get<Uint32>());
+		}
+		if (resolutions.empty()) resolutions.emplace_back(0, 0);
+
+		std::vector<BenchmarkRun> permutations;
+		for (auto&& permutation_json : permutations_json)
+		{
+			JsonParams permutation_params(permutation_json);
+			BenchmarkRun& permutation = permutations.emplace_back();
+			permutation.name = permutation_params.FindOr<std::string>("name", "permutation" + std::to_string(permutations.size() - 1));
+			for (auto&& [cvar_name, cvar_value] : permutation_params.FindJson("cvars").items())
+			{
+				permutation.cvars.emplace_back(cvar_name, CVarValueToString(cvar_value));
+			}
+		}
+		if (permutations.empty()) permutations.emplace_back().name = "default";
+
+		for (auto const& [width, height] : resolutions)
+		{
+			for (BenchmarkRun const& permutation : permutations)
+			{
+				BenchmarkRun& run = runs.emplace_back(permutation);
+				run.width = width;
+				run.height = height;
+				if (width > 0) run.name += "_" + std::to_string(width) + "x" + std::to_string(height);
+			}
+		}
+
+		if (measured_frames == 0)
+		{
+			ADRIA_LOG(ERROR, "Benchmark has to measure at least one frame!");
+			return;
+		}
+		run_samples.resize(runs.size());
+		for (BenchmarkRunSamples& samples : run_samples)
+		{
+			samples.cpu_frame_times.reserve(measured_frames);
+			samples.vram_usage.reserve(measured_frames);
+		}
+		valid = true;
+		ADRIA_LOG(INFO, "Running benchmark %s: %llu runs of %u warm-up frames and %u measured frames, %llu camera keyframes",
+			benchmark_file.c_str(), (Uint64)runs.size(), warmup_frames, measured_frames, (Uint64)camera_path.size());
+	}
+
+	Bool Benchmark::ConsumeResolutionRequest(Uint32& width, Uint32& height)
+	{
+		if (!resolution_requested || IsFinished()) return false;
+		resolution_requested = false;
+		width = runs[current_run].width;
+		height = runs[current_run].height;
+		return true;
+	}
+
+	void Benchmark::BeginFrame(Float dt)
+	{
+		if (!run_started) StartRun();
+		if (IsMeasuring() && current_frame > warmup_frames) run_samples[current_run].cpu_frame_times.push_back(dt * 1000.0f);
+	}
+
+	void Benchmark::UpdateCamera(Camera& camera) const
+	{
+		if (camera_path.empty()) return;
+
+		Float t = 0.0f;
+		if (current_frame > warmup_frames && measured_frames > 1)
+		{
+			t = std::min(Float(current_frame - warmup_frames) / (measured_frames - 1), 1.0f);
+		}
+		BenchmarkKeyframe keyframe = SampleCameraPath(t);
+		camera.SetPosition(keyframe.position);
+		camera.SetLookAt(keyframe.look_at);
+	}
+
+	void Benchmark::EndFrame(GfxDevice* gfx)
+	{
+		if (IsMeasuring())
+		{
+			BenchmarkRunSamples& samples = run_samples[current_run];
+			for (RGPassTiming const& pass_timing : g_RenderGraphProfiler.GetPassTimings())
+			{
+				if (!pass_filter.empty() && std::find(pass_filter.begin(), pass_filter.end(), pass_timing.name) == pass_filter.end()) continue;
+
+				BenchmarkPassSamples& pass_samples = samples.pass_samples[pass_timing.name];
+				pass_samples.group = pass_timing.group;
+				if (pass_timing.culled)
+				{
+					++pass_samples.culled_frames;
+					continue;
+				}
+				pass_samples.cpu_times.push_back(pass_timing.cpu_time_ms);
+				pass_samples.gpu_times.push_back(pass_timing.gpu_time_ms);
+			}
+			GPUMemoryUsage memory_usage = gfx->GetMemoryUsage();
+			samples.vram_usage.push_back(Float(memory_usage.usage) / (1024.0f * 1024.0f));
+
+			MemoryTagStats const heap_stats = MemoryTracker::GetTotalStats();
+			samples.frame_allocations.push_back(Float(heap_stats.frame_allocations));
+			samples.frame_allocated_kb.push_back(Float(heap_stats.frame_bytes) / 1024.0f);
+			for (Uint64 i = 0; i < samples.tag_allocations.size(); ++i) samples.tag_allocations[i] += MemoryTracker::GetStats((MemoryTag)i).frame_allocations;
+		}
+		if (++current_frame >= warmup_frames + measured_frames)
+		{
+			current_frame = 0;
+			run_started = false;
+			++current_run;
+		}
+	}
+
+	void Benchmark::WriteReport()
+	{
+		std::filesystem::create_directories(paths::BenchmarksDir);
+		std::string const csv_path = paths::BenchmarksDir + output_name + ".csv";
+		std::string const json_path = paths::BenchmarksDir + output_name + ".json";
+
+		std::ofstream csv(csv_path);
+		if (csv) csv << "run,metric,mean,median,variance,p95,p99\n";
+		else ADRIA_LOG(WARNING, "Failed to write benchmark report %s!", csv_path.c_str());
+		auto WriteCsvRow = [&csv](std::string const& run_name, std::string const& metric, Statistics const& statistics)
+			{
+				if (csv) csv << run_name << ",\"" << metric << "\"," << statistics.mean << "," << statistics.p50 << "," << statistics.variance << "," << statistics.p95 << "," << statistics.p99 << "\n";
+			};
+
+		json report;
+		report["scene"] = scene_file;
+		report["warmup_frames"] = warmup_frames;
+		report["measured_frames"] = measured_frames;
+		json runs_json = json::object();
+		for (Uint64 run_index = 0; run_index < runs.size(); ++run_index)
+		{
+			BenchmarkRun const& run = runs[run_index];
+			BenchmarkRunSamples const& samples = run_samples[run_index];
+			Statistics const cpu_statistics = ComputeStatistics(samples.cpu_frame_times);
+			Statistics const vram_statistics = ComputeStatistics(samples.vram_usage);
+			Statistics const allocation_statistics = ComputeStatistics(samples.frame_allocations);
+			Statistics const allocated_statistics = ComputeStatistics(samples.frame_allocated_kb);
+			WriteCsvRow(run.name, "CPU Frame Time (ms)", cpu_statistics);
+			WriteCsvRow(run.name, "VRAM Usage (MB)", vram_statistics);
+			WriteCsvRow(run.name, "Heap Allocations per Frame", allocation_statistics);
+			WriteCsvRow(run.name, "Heap Allocated per Frame (KB)", allocated_statistics);
+
+			json& run_json = runs_json[run.name];
+			if (run.width > 0) run_json["resolution"] = { run.width, run.height };
+			json cvars_json = json::object();
+			for (auto const& [cvar_name, cvar_value] : run.cvars) cvars_json[cvar_name] = cvar_value;
+			run_json["cvars"] = std::move(cvars_json);
+			run_json["cpu_frame_time_ms"] = StatisticsToJson(cpu_statistics);
+			run_json["vram_usage_mb"] = StatisticsToJson(vram_statistics);
+			run_json["heap_allocations_per_frame"] = StatisticsToJson(allocation_statistics);
+			run_json["heap_allocated_kb_per_frame"] = StatisticsToJson(allocated_statistics);
+			json tag_allocations_json = json::object();
+			Uint64 const frame_count = std::max<Uint64>(samples.frame_allocations.size(), 1);
+			for (Uint64 i = 0; i < samples.tag_allocations.size(); ++i)
+			{
+				tag_allocations_json[MemoryTagToString((MemoryTag)i)] = Float(samples.tag_allocations[i]) / frame_count;
+			}
+			run_json["heap_allocations_per_frame_by_tag"] = std::move(tag_allocations_json);
+
+			json passes = json::object();
+			for (auto const& [name, pass_samples] : samples.pass_samples)
+			{
+				Statistics const gpu_statistics = ComputeStatistics(pass_samples.gpu_times);
+				Statistics const pass_cpu_statistics = ComputeStatistics(pass_samples.cpu_times);
+				WriteCsvRow(run.name, "GPU " + name + " (ms)", gpu_statistics);
+				WriteCsvRow(run.name, "CPU " + name + " (ms)", pass_cpu_statistics);
+
+				json& pass = passes[name];
+				pass["group"] = pass_samples.group;
+				pass["gpu_ms"] = StatisticsToJson(gpu_statistics);
+				pass["cpu_ms"] = StatisticsToJson(pass_cpu_statistics);
+				pass["culled_frames"] = pass_samples.culled_frames;
+			}
+			run_json["passes"] = std::move(passes);
+			ADRIA_LOG(INFO, "Benchmark run %s: CPU frame time mean %.3f ms, median %.3f ms, p99 %.3f ms", run.name.c_str(), cpu_statistics.mean, cpu_statistics.p50, cpu_statistics.p99);
+		}
+		report["runs"] = std::move(runs_json);
+
+		//a regression is a pass whose mean gpu time grew by more than the relative threshold and the absolute noise floor
+		if (!baseline_file.empty())
+		{
+			json regressions = json::array();
+			std::ifstream baseline_stream(baseline_file);
+			json baseline = baseline_stream ? json::parse(baseline_stream, nullptr, false) : json();
+			if (baseline.is_discarded() || !baseline.contains("runs"))
+			{
+				ADRIA_LOG(WARNING, "Benchmark baseline %s couldn't be read, skipping the comparison!", baseline_file.c_str());
+			}
+			else
+			{
+				for (auto&& [run_name, run_json] : report["runs"].items())
+				{
+					if (!baseline["runs"].contains(run_name)) continue;
+					json const& baseline_passes = baseline["runs"][run_name].value("passes", json::object());
+					for (auto&& [pass_name, pass_json] : run_json["passes"].items())
+					{
+						if (!baseline_passes.contains(pass_name)) continue;
+						Float const baseline_ms = baseline_passes[pass_name]["gpu_ms"].value("mean", 0.0f);
+						Float const current_ms = pass_json["gpu_ms"].value("mean", 0.0f);
+						if (current_ms - baseline_ms > regression_min_delta_ms && current_ms > baseline_ms * (1.0f + regression_threshold))
+						{
+							ADRIA_LOG(WARNING, "Benchmark regression in %s, %s: %.3f ms -> %.3f ms", run_name.c_str(), pass_name.c_str(), baseline_ms, current_ms);
+							regressions.push_back(json{ {"run", run_name}, {"pass", pass_name}, {"baseline_ms", baseline_ms}, {"current_ms", current_ms} });
+						}
+					}
+				}
+				regression_count = (Uint32)regressions.size();
+				ADRIA_LOG(INFO, "Benchmark compared against %s: %u regressions", baseline_file.c_str(), regression_count);
+			}
+			report["baseline"] = baseline_file;
+			report["regressions"] = std::move(regressions);
+		}
+
+		std::ofstream json_file(json_path);
+		if (json_file) json_file << report.dump(4);
+		else ADRIA_LOG(WARNING, "Failed to write benchmark report %s!", json_path.c_str());
+	}
+
+	void Benchmark::StartRun()
+	{
+		run_started = true;
+		if (IsFinished()) return;
+
+		BenchmarkRun const& run = runs[current_run];
+		for (auto const& [cvar_name, cvar_value] : run.cvars)
+		{
+			IConsoleVariable* cvar = g_ConsoleManager.FindConsoleVariable(cvar_name);
+			if (!cvar || !cvar->Set(cvar_value.c_str()))
+			{
+				ADRIA_LOG(WARNING, "Benchmark run %s couldn't set %s to %s!", run.name.c_str(), cvar_name.c_str(), cvar_value.c_str());
+			}
+		}
+		resolution_requested = run.width > 0 && run.height > 0;
+		ADRIA_LOG(INFO, "Benchmark run %llu/%llu: %s", current_run + 1, (Uint64)runs.size(), run.name.c_str());
+	}
+
+	BenchmarkKeyframe Benchmark::SampleCameraPath(Float t) const
+	{
+		Uint64 const keyframe_count = camera_path.size();
+		if (keyframe_count == 1) return camera_path[0];
+
+		Float const segment_t = t * (keyframe_count - 1);
+		Uint64 const segment = std::min<Uint64>((Uint64)segment_t, keyframe_count - 2);
+		Float const local_t = segment_t - segment;
+
+		BenchmarkKeyframe const& k0 = camera_path[segment == 0 ? 0 : segment - 1];
+		BenchmarkKeyframe const& k1 = camera_path[segment];
+		BenchmarkKeyframe const& k2 = camera_path[segment + 1];
+		BenchmarkKeyframe const& k3 = camera_path[std::min(segment + 2, keyframe_count - 1)];
+
+		BenchmarkKeyframe keyframe{};
+		keyframe.position = Vector3::CatmullRom(k0.position, k1.position, k2.position, k3.position, local_t);
+		keyframe.look_at = Vector3::CatmullRom(k0.look_at, k1.look_at, k2.look_at, k3.look_at, local_t);
+		return keyframe;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "MemoryTracker.h"
+
+namespace adria
+{
+	class Camera;
+	class GfxDevice;
+
+	struct BenchmarkKeyframe
+	{
+		Vector3 position;
+		Vector3 look_at;
+	};
+
+	//one measured configuration: every run applies its cvars and resolution, then warms up and measures the same camera path
+	struct BenchmarkRun
+	{
+		std::string name;
+		Uint32 width = 0;
+		Uint32 height = 0;
+		std::vector<std::pair<std::string, std::string>> cvars;
+	};
+
+	struct BenchmarkPassSamples
+	{
+		std::string group;
+		std::vector<Float> cpu_times;
+		std::vector<Float> gpu_times;
+		Uint32 culled_frames = 0;
+	};
+
+	struct BenchmarkRunSamples
+	{
+		std::vector<Float> cpu_frame_times;
+		std::vector<Float> vram_usage;
+		std::vector<Float> frame_allocations;
+		std::vector<Float> frame_allocated_kb;
+		std::array<Uint64, (Uint64)MemoryTag::Count> tag_allocations{};
+		std::map<std::string, BenchmarkPassSamples> pass_samples;
+	};
+
+	class Benchmark
+	{
+	public:
+		explicit Benchmark(std::string const& benchmark_file);
+
+		Bool IsValid() const { return valid; }
+		std::string const& GetSceneFile() const { return scene_file; }
+		Float GetFixedDeltaTime() const { return fixed_delta_time; }
+		Bool IsFinished() const { return current_run >= runs.size(); }
+		Bool HasRegressions() const { return regression_count > 0; }
+
+		Bool ConsumeResolutionRequest(Uint32& width, Uint32& height);
+		void BeginFrame(Float dt);
+		void UpdateCamera(Camera& camera) const;
+		void EndFrame(GfxDevice* gfx);
+		void WriteReport();
+
+	private:
+		Bool valid = false;
+		std::string scene_file;
+		std::string output_name;
+		Uint32 warmup_frames = 60;
+		Uint32 measured_frames = 600;
+		Float fixed_delta_time = 1.0f / 60.0f;
+		std::vector<BenchmarkKeyframe> camera_path;
+		std::vector<BenchmarkRun> runs;
+		std::vector<std::string> pass_filter;
+		std::string baseline_file;
+		Float regression_threshold = 0.05f;
+		Float regression_min_delta_ms = 0.02f;
+
+		Uint64 current_run = 0;
+		Uint32 current_frame = 0;
+		Bool run_started = false;
+		Bool resolution_requested = false;
+		std::vector<BenchmarkRunSamples> run_samples;
+		Uint32 regression_count = 0;
+
+	private:
+		Bool IsMeasuring() const { return current_frame >= warmup_frames && !IsFinished(); }
+		void StartRun();
+		BenchmarkKeyframe SampleCameraPath(Float t) const;
+	};
+}
@@ -147,7 +147,7 @@ namespace adria
 	class ConsoleVariable : public ConsoleVariableBase
 	{
 	public:
-		ConsoleVariable(T default_value, Char const* name, Char const* help) : ConsoleVariableBase(name, help), value(default_value)
+		ConsoleVariable(T default_value, Char const* name, Char const* help) : ConsoleVariableBase(name, help), value(default_value), snapshot(default_value), notified_value(default_value)
 		{
 		}
 
@@ -157,7 +157,7 @@ namespace adria
 			if (FromCString(str_value, out))
 			{
 				value = out;
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			return false;
@@ -167,25 +167,25 @@ namespace adria
 			if constexpr (std::is_same_v<T, Bool>)
 			{
 				value = bool_value;
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, Int>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Bool>::GetInt(bool_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, Float>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Bool>::GetFloat(bool_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, std::string>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Bool>::GetString(bool_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			return false;
@@ -195,25 +195,25 @@ namespace adria
 			if constexpr (std::is_same_v<T, Int>)
 			{
 				value = int_value;
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, Bool>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Int>::GetInt(int_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, Float>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Int>::GetFloat(int_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, std::string>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Int>::GetString(int_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			return false;
@@ -223,25 +223,25 @@ namespace adria
 			if constexpr (std::is_same_v<T, Float>)
 			{
 				value = float_value;
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, Int>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Float>::GetInt(float_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, Bool>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Float>::GetBool(float_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			else if constexpr (std::is_same_v<T, std::string>)
 			{
 				value = detail::ConsoleVariableConversionHelper<Float>::GetString(float_value);
-				OnChangedDelegate().Broadcast(this);
+				NotifyChanged();
 				return true;
 			}
 			return false;
@@ -262,8 +262,25 @@ namespace adria
 		virtual Float* GetFloatPtr() override { return nullptr; }
 		virtual std::string* GetStringPtr() override { return nullptr; }
 
+		//writes through the value pointer (editor widgets) bypass Set, they are broadcast here once per frame
+		virtual void CaptureSnapshot() override
+		{
+			if (value != notified_value) NotifyChanged();
+			snapshot = value;
+		}
+		virtual void const* GetSnapshotPtr() const override { return &snapshot; }
+
 	private:
 		T value;
+		T snapshot;
+		T notified_value;
+
+	private:
+		void NotifyChanged()
+		{
+			notified_value = value;
+			OnChangedDelegate().Broadcast(this);
+		}
 	};
 
 	template<> Bool ConsoleVariable<Bool>::IsBool() const
@@ -571,6 +588,14 @@ namespace adria
 		for (auto& [name, obj] : console_objects) delegate(obj);
 	}
 
+	void ConsoleManager::CaptureSnapshot()
+	{
+		for (auto& [name, obj] : console_objects)
+		{
+			if (IConsoleVariable* cvar = obj->AsVariable()) cvar->CaptureSnapshot();
+		}
+	}
+
 	Bool ConsoleManager::ProcessInput(std::string const& cmd)
 	{
 		auto args = SplitString(cmd, ' ');
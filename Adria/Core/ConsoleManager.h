@@ -34,6 +34,7 @@ namespace adria
 		virtual IConsoleObject* FindConsoleObject(std::string const& name) const override;
 		virtual void ForAllObjects(ConsoleObjectDelegate const&) const override;
 
+		virtual void CaptureSnapshot() override;
 		virtual Bool ProcessInput(std::string const& cmd) override;
 
 	private:
@@ -136,26 +137,45 @@ namespace adria
 	class TAutoConsoleVariable final : public AutoConsoleVariable
 	{
 	public:
-		TAutoConsoleVariable(Char const* name, std::type_identity_t<T> default_value, Char const* help) : AutoConsoleVariable(name, default_value, help) {}
+		TAutoConsoleVariable(Char const* name, std::type_identity_t<T> default_value, Char const* help) : AutoConsoleVariable(name, default_value, help)
+		{
+			CacheValuePointers();
+		}
 		TAutoConsoleVariable(Char const* name, std::type_identity_t<T> default_value, Char const* help, ConsoleVariableDelegate const& callback)
-			: AutoConsoleVariable(name, default_value, help, callback) {}
+			: AutoConsoleVariable(name, default_value, help, callback)
+		{
+			CacheValuePointers();
+		}
 
-		T Get() const
+		ADRIA_FORCEINLINE T Get() const
 		{
-			if constexpr (std::is_same_v<T, Bool>) return AsVariable()->GetBool();
-			if constexpr (std::is_same_v<T, Int>) return  AsVariable()->GetInt();
-			if constexpr (std::is_same_v<T, Float>) return AsVariable()->GetFloat();
-			if constexpr (std::is_same_v<T, std::string>) return AsVariable()->GetString();
+			return *value_ptr;
 		}
-		T* GetPtr()
+		ADRIA_FORCEINLINE T* GetPtr()
 		{
-			if constexpr (std::is_same_v<T, Bool>) return AsVariable()->GetBoolPtr();
-			if constexpr (std::is_same_v<T, Int>) return  AsVariable()->GetIntPtr();
-			if constexpr (std::is_same_v<T, Float>) return AsVariable()->GetFloatPtr();
-			if constexpr (std::is_same_v<T, std::string>) return AsVariable()->GetStringPtr();
+			return value_ptr;
+		}
+		//value captured by ConsoleManager::CaptureSnapshot at the start of the frame, safe to read from parallel command list recording
+		ADRIA_FORCEINLINE T GetSnapshot() const
+		{
+			return *snapshot_ptr;
 		}
 
 	private:
+		T* value_ptr = nullptr;
+		T const* snapshot_ptr = nullptr;
+
+	private:
+		//the variable is owned by the console manager for the lifetime of the program, Get can skip the virtual lookup
+		void CacheValuePointers()
+		{
+			if constexpr (std::is_same_v<T, Bool>) value_ptr = AsVariable()->GetBoolPtr();
+			if constexpr (std::is_same_v<T, Int>) value_ptr = AsVariable()->GetIntPtr();
+			if constexpr (std::is_same_v<T, Float>) value_ptr = AsVariable()->GetFloatPtr();
+			if constexpr (std::is_same_v<T, std::string>) value_ptr = AsVariable()->GetStringPtr();
+			snapshot_ptr = static_cast<T const*>(AsVariable()->GetSnapshotPtr());
+			ADRIA_ASSERT(value_ptr && snapshot_ptr);
+		}
 	};
 
 	template <Uint32 N>
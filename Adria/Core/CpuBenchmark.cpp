@@ -0,0 +1,262 @@
+#include <filesystem>
+#include "CpuBenchmark.h"
+#include "Paths.h"
+#include "Logging/Logger.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxDescriptorAllocator.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
+#include "RenderGraph/RenderGraph.h"
+#include "RenderGraph/RenderGraphCache.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/ConcurrentQueue.h"
+#include "Utilities/RingBuffer.h"
+#include "Utilities/JsonUtil.h"
+
+namespace adria
+{
+	namespace
+	{
+		//keeps the compiler from dropping the work whose result is otherwise unused
+		template<typename T>
+		void DoNotOptimize(T const& value)
+		{
+			static volatile Uint64 sink = 0;
+			sink = sink + static_cast<Uint64>(value);
+		}
+
+		Float64 ElapsedSeconds(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<Float64>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		//chain of passes where every pass reads the buffer of the previous one and declares its own, the last one keeps the chain alive
+		void BuildSyntheticGraph(RGResourcePool& pool, RGCache* cache, Uint32 pass_count)
+		{
+			struct BenchmarkPassData
+			{
+				RGBufferReadOnlyId input;
+				RGBufferReadWriteId output;
+			};
+
+			RenderGraph rg(pool, cache);
+			for (Uint32 i = 0; i < pass_count; ++i)
+			{
+				rg.AddPass<BenchmarkPassData>("CPU Benchmark Pass",
+					[=](BenchmarkPassData& data, RenderGraphBuilder& builder)
+					{
+						RGBufferDesc buffer_desc{};
+						buffer_desc.size = 256 * sizeof(Uint32);
+						buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+						buffer_desc.stride = sizeof(Uint32);
+						builder.DeclareBuffer(RG_NAME_IDX(CpuBenchmarkBuffer, i), buffer_desc);
+						if (i > 0) data.input = builder.ReadBuffer(RG_NAME_IDX(CpuBenchmarkBuffer, i - 1));
+						data.output = builder.WriteBuffer(RG_NAME_IDX(CpuBenchmarkBuffer, i));
+					},
+					[=](BenchmarkPassData const&, RenderGraphContext&, GfxCommandList*) {},
+					RGPassType::Compute, i == pass_count - 1 ? RGPassFlags::ForceNoCull : RGPassFlags::None);
+			}
+			rg.Build();
+		}
+
+		Float64 Median(std::vector<Float64> samples)
+		{
+			if (samples.empty()) return 0.0;
+			std::sort(samples.begin(), samples.end());
+			Uint64 const middle = samples.size() / 2;
+			return samples.size() % 2 ? samples[middle] : 0.5 * (samples[middle - 1] + samples[middle]);
+		}
+	}
+
+	CpuBenchmark::CpuBenchmark(GfxDevice* gfx) : gfx(gfx)
+	{
+		RegisterEngineBenchmarks();
+	}
+
+	CpuBenchmark::~CpuBenchmark() = default;
+
+	void CpuBenchmark::Register(std::string const& name, CpuBenchmarkFunction&& function)
+	{
+		cases.push_back(CpuBenchmarkCase{ name, std::move(function) });
+	}
+
+	void CpuBenchmark::Run(std::string const& filter)
+	{
+		results.clear();
+		for (CpuBenchmarkCase const& benchmark_case : cases)
+		{
+			if (!filter.empty() && benchmark_case.name.find(filter) == std::string::npos) continue;
+			Result result = RunCase(benchmark_case);
+			ADRIA_LOG(INFO, "%s: %llu iterations, %.1f ns per iteration", result.name.c_str(), result.iterations, Median(result.ns_per_iteration));
+			results.push_back(std::move(result));
+		}
+	}
+
+	void CpuBenchmark::WriteReport(std::string const& output_name) const
+	{
+		json report;
+		report["min_time_seconds"] = min_time_seconds;
+		report["repetitions"] = repetitions;
+		json cases_json = json::object();
+		for (Result const& result : results)
+		{
+			Float64 sum = 0.0;
+			for (Float64 sample : result.ns_per_iteration) sum += sample;
+			Float64 const mean = result.ns_per_iteration.empty() ? 0.0 : sum / result.ns_per_iteration.size();
+			Float64 squared_deviation_sum = 0.0;
+			for (Float64 sample : result.ns_per_iteration) squared_deviation_sum += (sample - mean) * (sample - mean);
+
+			json& case_json = cases_json[result.name];
+			case_json["iterations"] = result.iterations;
+			case_json["ns_per_iteration"] = result.ns_per_iteration;
+			case_json["mean"] = mean;
+			case_json["median"] = Median(result.ns_per_iteration);
+			case_json["variance"] = result.ns_per_iteration.size() > 1 ? squared_deviation_sum / (result.ns_per_iteration.size() - 1) : 0.0;
+		}
+		report["cases"] = std::move(cases_json);
+
+		std::filesystem::create_directories(paths::BenchmarksDir);
+		std::string const json_path = paths::BenchmarksDir + output_name + ".json";
+		std::ofstream json_file(json_path);
+		if (!json_file)
+		{
+			ADRIA_LOG(WARNING, "Failed to write cpu benchmark report %s!", json_path.c_str());
+			return;
+		}
+		json_file << report.dump(4);
+		ADRIA_LOG(INFO, "CPU benchmark report written to %s", json_path.c_str());
+	}
+
+	void CpuBenchmark::RegisterEngineBenchmarks()
+	{
+		for (Uint32 pass_count : { 50u, 200u, 500u })
+		{
+			Register("RenderGraph/Build/" + std::to_string(pass_count), [this, pass_count](Uint64 iterations)
+				{
+					RGResourcePool pool(gfx);
+					for (Uint64 i = 0; i < iterations; ++i) BuildSyntheticGraph(pool, nullptr, pass_count);
+				});
+			Register("RenderGraph/BuildCached/" + std::to_string(pass_count), [this, pass_count](Uint64 iterations)
+				{
+					RGResourcePool pool(gfx);
+					RGCache cache{};
+					for (Uint64 i = 0; i < iterations; ++i) BuildSyntheticGraph(pool, &cache, pass_count);
+				});
+		}
+
+		Register("RenderGraphResourcePool/AllocateRelease", [this](Uint64 iterations)
+			{
+				static constexpr Uint32 BufferCount = 32;
+				RGResourcePool pool(gfx);
+				GfxBufferDesc buffer_desc{};
+				buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess | GfxBindFlag::ShaderResource;
+				buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				buffer_desc.stride = sizeof(Uint32);
+				GfxBuffer* buffers[BufferCount] = {};
+				for (Uint64 i = 0; i < iterations; ++i)
+				{
+					for (Uint32 j = 0; j < BufferCount; ++j)
+					{
+						buffer_desc.size = (1ull + j % 4) * 64 * 1024;
+						buffers[j] = pool.AllocateBuffer(buffer_desc);
+					}
+					for (GfxBuffer* buffer : buffers) pool.ReleaseBuffer(buffer);
+					pool.Tick();
+				}
+			});
+
+		Register("GfxDescriptorAllocator/AllocateFree", [this](Uint64 iterations)
+			{
+				static constexpr Uint32 Counts[] = { 1, 1, 4, 1, 16, 2, 1, 64 };
+				GfxDescriptorAllocator allocator(gfx, GfxDescriptorAllocatorDesc{ GfxDescriptorHeapType::CBV_SRV_UAV, 4096, false });
+				GfxDescriptor descriptors[std::size(Counts)];
+				for (Uint64 i = 0; i < iterations; ++i)
+				{
+					for (Uint32 j = 0; j < std::size(Counts); ++j) descriptors[j] = allocator.AllocateDescriptors(Counts[j]);
+					for (Uint32 j = 0; j < std::size(Counts); ++j) allocator.FreeDescriptors(descriptors[j], Counts[j]);
+				}
+			});
+
+		for (Uint32 thread_count : { 1u, 4u, 8u })
+		{
+			Register("GfxLinearDynamicAllocator/Allocate/Threads" + std::to_string(thread_count), [this, thread_count](Uint64 iterations)
+				{
+					static constexpr Uint32 AllocationsPerThread = 1024;
+					GfxLinearDynamicAllocator allocator(gfx, 8 * 1024 * 1024);
+					std::vector<std::future<void>> futures(thread_count);
+					for (Uint64 i = 0; i < iterations; ++i)
+					{
+						for (Uint32 t = 0; t < thread_count; ++t)
+						{
+							futures[t] = g_ThreadPool.Submit([&allocator]()
+								{
+									for (Uint32 j = 0; j < AllocationsPerThread; ++j) DoNotOptimize(allocator.Allocate(256, 256).offset);
+								});
+						}
+						for (std::future<void>& future : futures) future.wait();
+						allocator.Clear();
+					}
+				});
+		}
+
+		Register("ThreadPool/Submit", [](Uint64 iterations)
+			{
+				std::vector<std::future<void>> futures;
+				futures.reserve(iterations);
+				for (Uint64 i = 0; i < iterations; ++i) futures.push_back(g_ThreadPool.Submit([]() {}));
+				for (std::future<void>& future : futures) future.wait();
+			});
+
+		Register("ConcurrentQueue/PushPop", [](Uint64 iterations)
+			{
+				ConcurrentQueue<Uint64> queue;
+				Uint64 value = 0;
+				for (Uint64 i = 0; i < iterations; ++i)
+				{
+					queue.Push(i);
+					queue.TryPop(value);
+				}
+				DoNotOptimize(value);
+			});
+
+		Register("RingBuffer/PushBackPopFront", [](Uint64 iterations)
+			{
+				RingBuffer<Uint64> ring_buffer(64);
+				Uint64 sum = 0;
+				for (Uint64 i = 0; i < iterations; ++i)
+				{
+					ring_buffer.PushBack(i);
+					if (ring_buffer.Full())
+					{
+						sum += ring_buffer.Front();
+						ring_buffer.PopFront();
+					}
+				}
+				DoNotOptimize(sum);
+			});
+	}
+
+	CpuBenchmark::Result CpuBenchmark::RunCase(CpuBenchmarkCase const& benchmark_case) const
+	{
+		Uint64 iterations = 1;
+		while (true)
+		{
+			auto const start = std::chrono::steady_clock::now();
+			benchmark_case.function(iterations);
+			Float64 const elapsed = ElapsedSeconds(start);
+			if (elapsed >= min_time_seconds) break;
+			Float64 const scale = elapsed > 0.0 ? 1.4 * min_time_seconds / elapsed : 10.0;
+			iterations = std::max<Uint64>(iterations + 1, (Uint64)(iterations * std::min(scale, 10.0)));
+		}
+
+		Result result{};
+		result.name = benchmark_case.name;
+		result.iterations = iterations;
+		for (Uint32 i = 0; i < repetitions; ++i)
+		{
+			auto const start = std::chrono::steady_clock::now();
+			benchmark_case.function(iterations);
+			result.ns_per_iteration.push_back(ElapsedSeconds(start) * 1e9 / iterations);
+		}
+		return result;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+
+namespace adria
+{
+	class GfxDevice;
+
+	//runs the body with the given iteration count, the harness picks the count so one repetition takes at least the minimum time
+	using CpuBenchmarkFunction = std::function<void(Uint64 iterations)>;
+
+	struct CpuBenchmarkCase
+	{
+		std::string name;
+		CpuBenchmarkFunction function;
+	};
+
+	//cpu micro benchmarks of engine data structures and hot paths, started with -cpubenchmark instead of the frame loop
+	class CpuBenchmark
+	{
+	public:
+		explicit CpuBenchmark(GfxDevice* gfx);
+		~CpuBenchmark();
+
+		void Register(std::string const& name, CpuBenchmarkFunction&& function);
+		void Run(std::string const& filter);
+		void WriteReport(std::string const& output_name) const;
+
+	private:
+		struct Result
+		{
+			std::string name;
+			Uint64 iterations = 0;
+			std::vector<Float64> ns_per_iteration;
+		};
+
+		GfxDevice* gfx;
+		std::vector<CpuBenchmarkCase> cases;
+		std::vector<Result> results;
+		Float64 min_time_seconds = 0.1;
+		Uint32 repetitions = 5;
+
+	private:
+		void RegisterEngineBenchmarks();
+		Result RunCase(CpuBenchmarkCase const& benchmark_case) const;
+	};
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include "CpuProfiler.h"
+
+namespace adria
+{
+	namespace
+	{
+		thread_local void* thread_event_buffer = nullptr;
+
+		Float TicksToMilliseconds(Uint64 ticks)
+		{
+			using Ticks = std::chrono::steady_clock::duration;
+			return std::chrono::duration<Float, std::milli>(Ticks(ticks)).count();
+		}
+	}
+
+	void CpuProfiler::NewFrame()
+	{
+		struct PhaseFrameData
+		{
+			Float time_ms = 0.0f;
+			Uint32 call_count = 0;
+			Uint64 frame_offset_ticks = UINT64_MAX;
+			Uint32 depth = 0;
+		};
+		Uint64 const frame_end_ticks = GetTicks();
+		std::unordered_map<std::string_view, PhaseFrameData> frame_data;
+		{
+			std::lock_guard lock(registration_mutex);
+			for (std::unique_ptr<ThreadEventBuffer>& thread_buffer : thread_buffers)
+			{
+				Uint64 const read_index = thread_buffer->read_index.load(std::memory_order_relaxed);
+				Uint64 const write_index = thread_buffer->write_index.load(std::memory_order_acquire);
+				for (Uint64 i = read_index; i < write_index; ++i)
+				{
+					CpuProfileEvent const& event = thread_buffer->events[i % ThreadEventBuffer::CAPACITY];
+					PhaseFrameData& phase_frame_data = frame_data[event.name];
+					phase_frame_data.time_ms += TicksToMilliseconds(event.end_ticks - event.begin_ticks);
+					++phase_frame_data.call_count;
+
+					Uint64 const frame_offset_ticks = event.begin_ticks > frame_begin_ticks ? event.begin_ticks - frame_begin_ticks : 0;
+					if (frame_offset_ticks < phase_frame_data.frame_offset_ticks)
+					{
+						phase_frame_data.frame_offset_ticks = frame_offset_ticks;
+						phase_frame_data.depth = event.depth;
+					}
+				}
+				thread_buffer->read_index.store(write_index, std::memory_order_release);
+			}
+		}
+
+		frame_begin_ticks = frame_end_ticks;
+
+		for (auto const& [name, phase_frame_data] : frame_data)
+		{
+			PhaseHistory& history = phase_histories[name];
+			history.frame_offset_ticks = phase_frame_data.frame_offset_ticks;
+			history.depth = phase_frame_data.depth;
+		}
+
+		phase_stats.clear();
+		for (auto& [name, history] : phase_histories)
+		{
+			auto it = frame_data.find(name);
+			history.frame_times.PushBack(it != frame_data.end() ? it->second.time_ms : 0.0f);
+
+			CpuPhaseStats& stats = phase_stats.emplace_back();
+			stats.name = name.data();
+			stats.depth = history.depth;
+			stats.call_count = it != frame_data.end() ? it->second.call_count : 0;
+			stats.time_ms = it != frame_data.end() ? it->second.time_ms : 0.0f;
+			for (Float frame_time : history.frame_times)
+			{
+				stats.average_ms += frame_time;
+				stats.max_ms = std::max(stats.max_ms, frame_time);
+			}
+			stats.average_ms /= std::max<Uint64>(history.frame_times.Size(), 1);
+		}
+		std::sort(phase_stats.begin(), phase_stats.end(), [this](CpuPhaseStats const& a, CpuPhaseStats const& b)
+			{
+				return phase_histories[a.name].frame_offset_ticks < phase_histories[b.name].frame_offset_ticks;
+			});
+	}
+
+	Uint32 CpuProfiler::BeginEvent()
+	{
+		return GetThreadBuffer().depth++;
+	}
+
+	void CpuProfiler::EndEvent(Char const* name, Uint64 begin_ticks, Uint32 depth)
+	{
+		Uint64 const end_ticks = GetTicks();
+		ThreadEventBuffer& thread_buffer = GetThreadBuffer();
+		thread_buffer.depth = depth;
+
+		Uint64 const write_index = thread_buffer.write_index.load(std::memory_order_relaxed);
+		if (write_index - thread_buffer.read_index.load(std::memory_order_acquire) >= ThreadEventBuffer::CAPACITY)
+		{
+			dropped_events.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		CpuProfileEvent& event = thread_buffer.events[write_index % ThreadEventBuffer::CAPACITY];
+		event.name = name;
+		event.begin_ticks = begin_ticks;
+		event.end_ticks = end_ticks;
+		event.depth = depth;
+		thread_buffer.write_index.store(write_index + 1, std::memory_order_release);
+	}
+
+	Uint64 CpuProfiler::GetTicks()
+	{
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+
+	CpuProfiler::ThreadEventBuffer& CpuProfiler::GetThreadBuffer()
+	{
+		if (!thread_event_buffer) [[unlikely]]
+		{
+			std::lock_guard lock(registration_mutex);
+			thread_event_buffer = thread_buffers.emplace_back(std::make_unique<ThreadEventBuffer>()).get();
+		}
+		return *static_cast<ThreadEventBuffer*>(thread_event_buffer);
+	}
+}
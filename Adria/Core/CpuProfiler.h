@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include "Utilities/RingBuffer.h"
+#include "Utilities/Singleton.h"
+
+namespace adria
+{
+	struct CpuProfileEvent
+	{
+		Char const* name = nullptr;
+		Uint64 begin_ticks = 0;
+		Uint64 end_ticks = 0;
+		Uint32 depth = 0;
+	};
+
+	struct CpuPhaseStats
+	{
+		Char const* name = nullptr;
+		Uint32 depth = 0;
+		Uint32 call_count = 0;
+		Float time_ms = 0.0f;
+		Float average_ms = 0.0f;
+		Float max_ms = 0.0f;
+	};
+
+	class CpuProfiler : public Singleton<CpuProfiler>
+	{
+		friend class Singleton<CpuProfiler>;
+
+		struct ThreadEventBuffer
+		{
+			static constexpr Uint32 CAPACITY = 1024;
+
+			CpuProfileEvent events[CAPACITY];
+			std::atomic<Uint64> write_index = 0;
+			std::atomic<Uint64> read_index = 0;
+			Uint32 depth = 0;
+		};
+
+		struct PhaseHistory
+		{
+			PhaseHistory() : frame_times(HISTORY_SIZE) {}
+
+			RingBuffer<Float> frame_times;
+			Uint32 depth = 0;
+			Uint64 frame_offset_ticks = 0;
+		};
+
+	public:
+		static constexpr Uint32 HISTORY_SIZE = 64;
+
+		void NewFrame();
+
+		Uint32 BeginEvent();
+		void EndEvent(Char const* name, Uint64 begin_ticks, Uint32 depth);
+
+		std::vector<CpuPhaseStats> const& GetPhaseStats() const { return phase_stats; }
+		Uint64 GetDroppedEventCount() const { return dropped_events.load(std::memory_order_relaxed); }
+
+		static Uint64 GetTicks();
+
+	private:
+		std::mutex registration_mutex;
+		std::vector<std::unique_ptr<ThreadEventBuffer>> thread_buffers;
+		std::atomic<Uint64> dropped_events = 0;
+
+		std::unordered_map<std::string_view, PhaseHistory> phase_histories;
+		std::vector<CpuPhaseStats> phase_stats;
+		Uint64 frame_begin_ticks = 0;
+
+	private:
+		CpuProfiler() = default;
+		~CpuProfiler() = default;
+
+		ThreadEventBuffer& GetThreadBuffer();
+	};
+	#define g_CpuProfiler CpuProfiler::Get()
+
+	class CpuProfileScope
+	{
+	public:
+		explicit CpuProfileScope(Char const* name) : name(name), depth(g_CpuProfiler.BeginEvent()), begin_ticks(CpuProfiler::GetTicks()) {}
+		~CpuProfileScope()
+		{
+			g_CpuProfiler.EndEvent(name, begin_ticks, depth);
+		}
+		ADRIA_NONCOPYABLE_NONMOVABLE(CpuProfileScope)
+
+	private:
+		Char const* name;
+		Uint32 depth;
+		Uint64 begin_ticks;
+	};
+	#define AdriaCpuProfileScope(name) CpuProfileScope ADRIA_CONCAT(_cpu_profile_scope_, __LINE__)(name)
+}
@@ -1,16 +1,26 @@
+#include <filesystem>
 #include "tracy/Tracy.hpp"
 #include "Engine.h"
 #include "Window.h"
 #include "Input.h"
 #include "Paths.h"
 #include "ConsoleManager.h"
+#include "Benchmark.h"
+#include "CpuBenchmark.h"
+#include "CpuProfiler.h"
+#include "MemoryTracker.h"
+#include "RemoteControl.h"
 #include "Logging/Logger.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
+#include "RenderGraph/RenderGraphProfiler.h"
 #include "Rendering/Renderer.h"
 #include "Rendering/SceneConfig.h"
+#include "Rendering/SceneStreamer.h"
+#include "Rendering/SceneSnapshot.h"
 #include "Rendering/ShaderManager.h"
 #include "Utilities/ThreadPool.h"
+#include "Utilities/JobSystem.h"
 #include "Utilities/Random.h"
 #include "Utilities/Timer.h"
 #include "Utilities/StringUtil.h"
@@ -22,41 +32,142 @@ namespace adria
 	Engine::Engine(EngineInit const& init) : window{ init.window }, viewport_data{}
 	{
 		g_ThreadPool.Initialize();
+		g_JobSystem.Initialize();
 		GfxShaderCompiler::Initialize();
 		gfx = std::make_unique<GfxDevice>(window, init.gfx_options);
-		ShaderManager::Initialize(init.gfx_options.shader_debug);
+		ShaderManager::Initialize(gfx.get(), init.gfx_options.shader_debug);
+		ShaderManager::WarmUp();
 		g_TextureManager.Initialize(gfx.get());
-		renderer = std::make_unique<Renderer>(reg, gfx.get(), window->Width(), window->Height());
+		renderer = std::make_unique<Renderer>(reg, gfx.get(), gfx->GetWidth(), gfx->GetHeight());
 		scene_loader = std::make_unique<SceneLoader>(reg, gfx.get());
+		scene_streamer = std::make_unique<SceneStreamer>(reg, gfx.get(), scene_loader.get());
 
 		InputEvents& input_events = g_Input.GetInputEvents();
-		input_events.window_resized_event.AddMember(&GfxDevice::OnResize, *gfx);
-		input_events.window_resized_event.AddMember(&Renderer::OnResize, *renderer);
+		input_events.window_resized_event.AddMember(&Engine::OnWindowResized, *this);
 		input_events.right_mouse_clicked.AddMember(&Renderer::OnRightMouseClicked, *renderer);
 		input_events.f6_pressed_event.AddMember(&Renderer::OnTakeScreenshot, *renderer);
 		std::ignore = input_events.f5_pressed_event.AddStatic(ShaderManager::CheckIfShadersHaveChanged);
 
-		SceneConfig scene_config{};
-		if (ParseSceneConfig(init.scene_file, scene_config))
+		g_ConsoleManager.RegisterConsoleCommand("scene.snapshot.save", "Saves the scene to a snapshot in the snapshots directory, the argument is the snapshot name",
+			ConsoleCommandWithArgsDelegate::CreateLambda([this](std::span<Char const*> args) { SaveSnapshot(args.empty() ? "scene" : args[0]); }));
+		g_ConsoleManager.RegisterConsoleCommand("scene.snapshot.load", "Replaces the scene with a snapshot from the snapshots directory, the argument is the snapshot name",
+			ConsoleCommandWithArgsDelegate::CreateLambda([this](std::span<Char const*> args)
+				{
+					std::string const name = args.empty() ? "scene" : args[0];
+					snapshot_request = IsSceneSnapshotFile(name) ? name : name + ".snapshot";
+				}));
+		g_ConsoleManager.RegisterConsoleCommand("scene.load", "Replaces the scene with a scene file from the scenes directory, the argument is the scene file name",
+			ConsoleCommandWithArgsDelegate::CreateLambda([this](std::span<Char const*> args)
+				{
+					if (args.empty()) return;
+					if (SceneConfig scene_config{}; ParseSceneConfig(args[0], scene_config)) NewSceneRequest(scene_config);
+				}));
+
+		std::string scene_file = init.scene_file;
+		if (!init.benchmark_file.empty())
+		{
+			benchmark = std::make_unique<Benchmark>(init.benchmark_file);
+			if (!benchmark->IsValid())
+			{
+				Quit(1);
+				return;
+			}
+			scene_file = benchmark->GetSceneFile();
+		}
+
+		Bool scene_loaded = false;
+		if (IsSceneSnapshotFile(scene_file))
 		{
-			ProcessCVarIniFile(scene_config.ini_file);
-			InitializeScene(scene_config);
+			SceneSnapshot snapshot{};
+			scene_loaded = LoadSceneSnapshot(paths::SnapshotsDir + scene_file, snapshot);
+			if (scene_loaded)
+			{
+				ProcessCVarSnapshot(snapshot);
+				InitializeScene(snapshot);
+			}
 		}
-		else 
+		else
 		{
-			window->Quit(1);
+			SceneConfig scene_config{};
+			scene_loaded = ParseSceneConfig(scene_file, scene_config);
+			if (scene_loaded)
+			{
+				ProcessCVarIniFile(scene_config.ini_file);
+				InitializeScene(scene_config);
+			}
+		}
+		if (!scene_loaded)
+		{
+			Quit(1);
 			return;
 		}
+		if (gfx->IsHeadless())
+		{
+			headless_frames_remaining = std::max(init.headless_frames, 1u);
+			headless_capture = init.headless_capture;
+		}
 
-		input_events.window_resized_event.AddMember(&Camera::OnResize, *camera);
 		input_events.scroll_mouse_event.AddMember(&Camera::Zoom, *camera);
+
+		if (init.remote_port != 0)
+		{
+			remote_control = std::make_unique<RemoteControl>(init.remote_address, init.remote_port);
+			if (!remote_control->IsListening()) remote_control.reset();
+		}
 	}
 
 	Engine::~Engine()
 	{
+		//the streaming thread can be waiting on thread pool tasks while it cooks a model
+		scene_streamer.reset();
+		remote_control.reset();
+		g_ConsoleManager.UnregisterConsoleObject("scene.snapshot.save");
+		g_ConsoleManager.UnregisterConsoleObject("scene.snapshot.load");
+		g_ConsoleManager.UnregisterConsoleObject("scene.load");
 		g_TextureManager.Destroy();
 		ShaderManager::Destroy();
 		GfxShaderCompiler::Destroy();
+		g_JobSystem.Destroy();
+		g_ThreadPool.Destroy();
+	}
+
+	void Engine::Precompile(EngineInit const& init)
+	{
+		Timer timer;
+		g_ThreadPool.Initialize();
+		GfxShaderCompiler::Initialize();
+		{
+			std::unique_ptr<GfxDevice> gfx = std::make_unique<GfxDevice>(init.window, init.gfx_options);
+			ShaderManager::Initialize(gfx.get(), init.gfx_options.shader_debug);
+			ShaderManager::WarmUp();
+			g_TextureManager.Initialize(gfx.get());
+			{
+				entt::registry reg;
+				std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(reg, gfx.get(), gfx->GetWidth(), gfx->GetHeight());
+			}
+			gfx->WaitForGPU();
+			g_TextureManager.Destroy();
+			ShaderManager::Destroy();
+		}
+		GfxShaderCompiler::Destroy();
+		g_ThreadPool.Destroy();
+		ADRIA_LOG(INFO, "Precompiled shaders and pipeline states in %f s", timer.ElapsedInSeconds());
+	}
+
+	void Engine::RunCpuBenchmarks(EngineInit const& init, std::string const& filter)
+	{
+		g_ThreadPool.Initialize();
+		GfxShaderCompiler::Initialize();
+		{
+			std::unique_ptr<GfxDevice> gfx = std::make_unique<GfxDevice>(init.window, init.gfx_options);
+			{
+				CpuBenchmark cpu_benchmark(gfx.get());
+				cpu_benchmark.Run(filter);
+				cpu_benchmark.WriteReport("cpu_benchmark");
+			}
+			gfx->WaitForGPU();
+		}
+		GfxShaderCompiler::Destroy();
 		g_ThreadPool.Destroy();
 	}
 
@@ -68,38 +179,169 @@ namespace adria
 	void Engine::Run()
 	{
 		FrameMarkNamed("EngineFrame");
-		static Timer timer;
-		Float const dt = timer.MarkInSeconds();
-		g_Input.Tick();
-		Update(dt);
-		Render();
+		g_CpuProfiler.NewFrame();
+		MemoryTracker::NewFrame();
+		gfx->WaitForFrameLatency();
+		Float const dt = frame_timer.MarkInSeconds();
+		if (window) g_Input.Tick();
+		HandleRemoteCommands();
+		if (benchmark)
+		{
+			SetViewportData(nullptr);
+			camera->Enable(false);
+			benchmark->BeginFrame(dt);
+			if (Uint32 width = 0, height = 0; benchmark->ConsumeResolutionRequest(width, height)) OnWindowResized(width, height);
+			HandlePendingResize();
+			Update(benchmark->GetFixedDeltaTime());
+			Render();
+			if (benchmark->IsFinished())
+			{
+				benchmark->WriteReport();
+				Int const benchmark_exit_code = benchmark->HasRegressions() ? 1 : 0;
+				benchmark.reset();
+				Quit(benchmark_exit_code);
+			}
+		}
+		else if (gfx->IsHeadless())
+		{
+			if (headless_frames_remaining == 1 && !headless_capture.empty()) renderer->OnTakeScreenshot(headless_capture.c_str());
+			Update(dt);
+			Render();
+			if (--headless_frames_remaining == 0)
+			{
+				gfx->WaitForGPU();
+				renderer->FlushScreenshots();
+				Quit(0);
+			}
+		}
+		else
+		{
+			HandlePendingResize();
+			Update(dt);
+			Render();
+		}
+		PublishRemoteFrameStats(dt);
+	}
+
+	Bool Engine::NeedsContinuousRendering() const
+	{
+		if (benchmark || scene_request || snapshot_request || pending_window_size) return true;
+		if (remote_control && remote_control->HasSubscribers()) return true;
+		return renderer->NeedsContinuousRendering() || scene_streamer->IsStreaming();
+	}
+
+	void Engine::Quit(Int code)
+	{
+		if (window) window->Quit(code);
+		finished = true;
+		exit_code = code;
 	}
 
 	void Engine::HandleSceneRequest()
 	{
 		if (scene_request)
 		{
-			gfx->WaitForGPU();
-			g_TextureManager.Clear();
-			reg.clear();
+			ClearScene();
 			ProcessCVarIniFile(scene_request->ini_file);
 			gfx->SetRenderingNotStarted();
 			InitializeScene(*scene_request);
 			scene_request = std::nullopt;
 		}
+		else if (snapshot_request)
+		{
+			SceneSnapshot snapshot{};
+			Bool const snapshot_loaded = LoadSceneSnapshot(paths::SnapshotsDir + *snapshot_request, snapshot);
+			snapshot_request = std::nullopt;
+			if (!snapshot_loaded) return;
+
+			ClearScene();
+			ProcessCVarSnapshot(snapshot);
+			gfx->SetRenderingNotStarted();
+			InitializeScene(snapshot);
+		}
+	}
+
+	void Engine::ClearScene()
+	{
+		gfx->WaitForGPU();
+		scene_streamer->Clear();
+		g_TextureManager.Clear();
+		reg.clear();
+	}
+
+	void Engine::SaveSnapshot(std::string const& name)
+	{
+		if (!camera) return;
+		SceneSnapshot snapshot{};
+		CaptureSceneSnapshot(reg, *camera, scene_hash, scene_streamer->GetParameters(), scene_streamer->GetStreamedEntities(), snapshot);
+		std::filesystem::create_directories(paths::SnapshotsDir);
+		SaveSceneSnapshot(paths::SnapshotsDir + (IsSceneSnapshotFile(name) ? name : name + ".snapshot"), snapshot);
+	}
+
+	//window messages can report several sizes between two frames, the swapchain and the renderer are resized once with the last one
+	void Engine::HandlePendingResize()
+	{
+		if (!pending_window_size) return;
+		Uint32 const width = pending_window_size->x, height = pending_window_size->y;
+		pending_window_size.reset();
+
+		gfx->OnResize(width, height);
+		renderer->OnResize(width, height);
+		if (camera) camera->OnResize(width, height);
+	}
+
+	//console objects are not thread safe, remote commands are queued by the network thread and executed here
+	void Engine::HandleRemoteCommands()
+	{
+		if (!remote_control) return;
+		remote_control->ConsumeCommands(remote_commands);
+		for (RemoteCommand const& remote_command : remote_commands)
+		{
+			Bool const processed = g_ConsoleManager.ProcessInput(remote_command.command);
+			remote_control->SendReply(remote_command.client_id, processed ? R"({"ok":true})" : R"({"ok":false})");
+		}
+		remote_commands.clear();
+	}
+
+	void Engine::PublishRemoteFrameStats(Float dt)
+	{
+		if (!remote_control || !remote_control->HasClients()) return;
+		RemoteFrameStats& stats = remote_control->BeginFrameStats();
+		stats.cpu_frame_time_ms = dt * 1000.0f;
+		stats.pass_timings = g_RenderGraphProfiler.GetPassTimings();
+		stats.gpu_frame_time_ms = 0.0f;
+		for (RGPassTiming const& pass_timing : stats.pass_timings) stats.gpu_frame_time_ms += pass_timing.gpu_time_ms;
+		GPUMemoryUsage const memory_usage = gfx->GetMemoryUsage();
+		stats.vram_usage = memory_usage.usage;
+		stats.vram_budget = memory_usage.budget;
+		remote_control->PublishFrameStats();
 	}
 
 	void Engine::Update(Float dt)
 	{
-		HandleSceneRequest();
+		AdriaCpuProfileScope("Update");
+		gfx->SetLatencyMarker(GfxLatencyMarker::SimulationStart);
+		ShaderManager::Update();
 		camera->Update(dt);
+		if (benchmark) benchmark->UpdateCamera(*camera);
+		//the previous frame may still be presenting, nothing above touches the device or the scene
+		gfx->WaitForPresent();
+		g_ConsoleManager.CaptureSnapshot();
+		HandleSceneRequest();
+		scene_streamer->Update(camera->Position());
+		gfx->UpdateColorSpace();
 		renderer->NewFrame(camera.get());
 		renderer->Update(dt);
+		gfx->SetLatencyMarker(GfxLatencyMarker::SimulationEnd);
 	}
 	void Engine::Render()
 	{
+		AdriaCpuProfileScope("Render");
 		gfx->BeginFrame();
+		gfx->SetLatencyMarker(GfxLatencyMarker::RenderSubmitStart);
 		renderer->Render();
+		if (benchmark) benchmark->EndFrame(gfx.get());
+		gfx->SetLatencyMarker(GfxLatencyMarker::RenderSubmitEnd);
 		gfx->EndFrame();
 	}
 
@@ -115,10 +357,10 @@ namespace adria
 			viewport_data.mouse_position_x = g_Input.GetMousePositionX();
 			viewport_data.mouse_position_y = g_Input.GetMousePositionY();
 
-			viewport_data.scene_viewport_pos_x = static_cast<Float>(window->PositionX());
-			viewport_data.scene_viewport_pos_y = static_cast<Float>(window->PositionY());
-			viewport_data.scene_viewport_size_x = static_cast<Float>(window->Width());
-			viewport_data.scene_viewport_size_y = static_cast<Float>(window->Height());
+			viewport_data.scene_viewport_pos_x = window ? static_cast<Float>(window->PositionX()) : 0.0f;
+			viewport_data.scene_viewport_pos_y = window ? static_cast<Float>(window->PositionY()) : 0.0f;
+			viewport_data.scene_viewport_size_x = static_cast<Float>(gfx->GetWidth());
+			viewport_data.scene_viewport_size_y = static_cast<Float>(gfx->GetHeight());
 		}
 		renderer->SetViewportData(viewport_data);
 	}
@@ -135,26 +377,46 @@ namespace adria
 		cmd_list->Begin();
 
 		camera = std::make_unique<Camera>(config.camera_params);
-		camera->SetAspectRatio((Float)window->Width() / window->Height());
+		camera->SetAspectRatio((Float)gfx->GetWidth() / gfx->GetHeight());
 		scene_loader->LoadSkybox(config.skybox_params);
 
 		for (auto const& model : config.scene_models) scene_loader->LoadModel_GLTF(model);
 		for (auto const& light : config.scene_lights) scene_loader->LoadLight(light);
+		scene_streamer->Initialize(config.streaming);
 
-		auto ray_tracing_view = reg.view<Mesh, RayTracing>();
-		for (auto entity : reg.view<Mesh, RayTracing>())
-		{
-			auto const& mesh = ray_tracing_view.get<Mesh>(entity);
-			GfxBuffer* buffer = g_GeometryBufferCache.GetGeometryBuffer(mesh.geometry_buffer_handle);
-			cmd_list->BufferBarrier(*buffer, GfxResourceState::CopyDst, GfxResourceState::AllSRV);
-		}
+		scene_hash = HashSceneConfig(config);
+		renderer->OnSceneInitialized(scene_hash);
+		cmd_list->End();
+		cmd_list->Submit();
+		gfx->WaitForGPU();
+	}
 
-		renderer->OnSceneInitialized();
+	//the snapshot keeps the hash of the scene it was taken from, so data persisted per scene such as the ddgi probe cache is reused
+	void Engine::InitializeScene(SceneSnapshot const& snapshot)
+	{
+		auto cmd_list = gfx->GetLatestCommandList(GfxCommandListType::Graphics);
+		cmd_list->Begin();
+
+		camera = std::make_unique<Camera>(snapshot.camera_params);
+		camera->SetAspectRatio((Float)gfx->GetWidth() / gfx->GetHeight());
+		RestoreSceneSnapshot(snapshot, reg, *scene_loader);
+		scene_streamer->Initialize(snapshot.streaming);
+
+		scene_hash = snapshot.scene_hash;
+		renderer->OnSceneInitialized(scene_hash);
 		cmd_list->End();
 		cmd_list->Submit();
 		gfx->WaitForGPU();
 	}
 
+	void Engine::ProcessCVarSnapshot(SceneSnapshot const& snapshot)
+	{
+		for (auto const& [name, value] : snapshot.cvars)
+		{
+			if (IConsoleVariable* cvar = g_ConsoleManager.FindConsoleVariable(name)) cvar->Set(value.c_str());
+		}
+	}
+
 	void Engine::ProcessCVarIniFile(std::string const& ini_file)
 	{
 		std::string cvar_ini_path = paths::IniDir + ini_file;
@@ -2,6 +2,7 @@
 #include "Graphics/GfxOptions.h"
 #include "Rendering/ViewportData.h"
 #include "Rendering/SceneConfig.h"
+#include "Utilities/Timer.h"
 #include "entt/entity/registry.hpp"
 
 namespace adria
@@ -9,18 +10,30 @@ namespace adria
 	struct WindowEventData;
 	class Window;
 	struct SceneConfig;
+	struct SceneSnapshot;
 	class GfxDevice;
 	class Renderer;
 	class SceneLoader;
+	class SceneStreamer;
 	struct EditorEvents;
 	class ImGuiManager;
 	class Camera;
+	class Benchmark;
+	class RemoteControl;
+	struct RemoteCommand;
 
 	struct EngineInit
 	{
 		std::string scene_file;
+		std::string benchmark_file;
 		Window* window = nullptr;
 		GfxOptions gfx_options;
+		//headless runs render this many frames and save the last one as a screenshot when a capture name is given
+		Uint32 headless_frames = 1;
+		std::string headless_capture;
+		//listens for automation clients on this port when non-zero, loopback only unless another address is given
+		Uint16 remote_port = 0;
+		std::string remote_address = "127.0.0.1";
 	};
 
 	class Engine
@@ -32,8 +45,15 @@ namespace adria
 		ADRIA_NONCOPYABLE_NONMOVABLE(Engine)
 		~Engine();
 
+		static void Precompile(EngineInit const&);
+		static void RunCpuBenchmarks(EngineInit const&, std::string const& filter);
+
 		void OnWindowEvent(WindowEventData const& msg_data);
 		void Run();
+		Bool IsFinished() const { return finished; }
+		//whether frames change without any input, e.g. while the path tracer accumulates or the scene is still loading
+		Bool NeedsContinuousRendering() const;
+		Int GetExitCode() const { return exit_code; }
 
 	private:
 		Window* window = nullptr;
@@ -42,12 +62,29 @@ namespace adria
 		std::unique_ptr<GfxDevice> gfx;
 		std::unique_ptr<Renderer> renderer;
 		std::unique_ptr<SceneLoader> scene_loader;
+		std::unique_ptr<SceneStreamer> scene_streamer;
 		ViewportData viewport_data;
 		std::optional<SceneConfig> scene_request;
+		std::optional<std::string> snapshot_request;
+		Uint64 scene_hash = 0;
+		std::optional<Vector2u> pending_window_size;
+		Timer<> frame_timer;
+		std::unique_ptr<Benchmark> benchmark;
+		std::unique_ptr<RemoteControl> remote_control;
+		std::vector<RemoteCommand> remote_commands;
+		Uint32 headless_frames_remaining = 0;
+		std::string headless_capture;
+		Bool finished = false;
+		Int exit_code = 0;
 
 	private:
+		void Quit(Int code);
 		void InitializeScene(SceneConfig const&);
+		void InitializeScene(SceneSnapshot const&);
+		void ClearScene();
 		void ProcessCVarIniFile(std::string const&);
+		void ProcessCVarSnapshot(SceneSnapshot const&);
+		void SaveSnapshot(std::string const& name);
 
 		void NewSceneRequest(SceneConfig const& scene_cfg)
 		{
@@ -55,6 +92,15 @@ namespace adria
 		}
 		void HandleSceneRequest();
 
+		void OnWindowResized(Uint32 width, Uint32 height)
+		{
+			pending_window_size = Vector2u(width, height);
+		}
+		void HandlePendingResize();
+
+		void HandleRemoteCommands();
+		void PublishRemoteFrameStats(Float dt);
+
 		void Update(Float dt);
 		void Render();
 
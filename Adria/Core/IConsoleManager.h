@@ -59,6 +59,9 @@ namespace adria
 
 		virtual void AddOnChanged(ConsoleVariableDelegate const&) = 0;
 		virtual ConsoleVariableMulticastDelegate& OnChangedDelegate() = 0;
+
+		virtual void CaptureSnapshot() {}
+		virtual void const* GetSnapshotPtr() const { return nullptr; }
 	};
 
 	DECLARE_DELEGATE(ConsoleCommandDelegate)
@@ -95,6 +98,7 @@ namespace adria
 		virtual IConsoleObject* FindConsoleObject(std::string const& name) const = 0;
 		virtual void ForAllObjects(ConsoleObjectDelegate const&) const = 0;
 
+		virtual void CaptureSnapshot() = 0;
 		virtual Bool ProcessInput(std::string const& cmd) = 0;
 
 
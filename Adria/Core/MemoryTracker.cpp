@@ -0,0 +1,203 @@
+#include <new>
+#include <atomic>
+#include <malloc.h>
+#include "MemoryTracker.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Uint64 TagCount = (Uint64)MemoryTag::Count;
+
+		struct alignas(16) AllocationHeader
+		{
+			Uint64 size;
+			MemoryTag tag;
+		};
+		static_assert(sizeof(AllocationHeader) == 16);
+
+		//one cache line per tag, threads allocating under different tags don't contend
+		struct alignas(64) TagCounters
+		{
+			std::atomic<Uint64> live_allocations;
+			std::atomic<Uint64> live_bytes;
+			std::atomic<Uint64> total_allocations;
+			std::atomic<Uint64> total_bytes;
+		};
+
+		//constant initialized, allocations of static initializers are tracked as well
+		constinit TagCounters tag_counters[TagCount]{};
+		constinit Uint64 last_total_allocations[TagCount]{};
+		constinit Uint64 last_total_bytes[TagCount]{};
+		MemoryTagStats frame_stats[TagCount]{};
+		thread_local MemoryTag current_tag = MemoryTag::Other;
+
+		void* RecordAllocation(void* ptr, Uint64 size)
+		{
+			AllocationHeader* header = static_cast<AllocationHeader*>(ptr) - 1;
+			header->size = size;
+			header->tag = current_tag;
+
+			TagCounters& counters = tag_counters[(Uint64)header->tag];
+			counters.live_allocations.fetch_add(1, std::memory_order_relaxed);
+			counters.live_bytes.fetch_add(size, std::memory_order_relaxed);
+			counters.total_allocations.fetch_add(1, std::memory_order_relaxed);
+			counters.total_bytes.fetch_add(size, std::memory_order_relaxed);
+			return ptr;
+		}
+
+		void RecordFree(void* ptr)
+		{
+			AllocationHeader const* header = static_cast<AllocationHeader const*>(ptr) - 1;
+			TagCounters& counters = tag_counters[(Uint64)header->tag];
+			counters.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+			counters.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+		}
+
+		void* TrackedAlloc(Uint64 size)
+		{
+			Uint8* block = static_cast<Uint8*>(malloc(size + sizeof(AllocationHeader)));
+			if (!block) return nullptr;
+			return RecordAllocation(block + sizeof(AllocationHeader), size);
+		}
+
+		void TrackedFree(void* ptr)
+		{
+			if (!ptr) return;
+			RecordFree(ptr);
+			free(static_cast<Uint8*>(ptr) - sizeof(AllocationHeader));
+		}
+
+		//over-aligned blocks keep the header at the end of an alignment sized prefix
+		Uint64 GetAlignedOffset(std::align_val_t alignment)
+		{
+			return std::max<Uint64>((Uint64)alignment, sizeof(AllocationHeader));
+		}
+
+		void* TrackedAlignedAlloc(Uint64 size, std::align_val_t alignment)
+		{
+			Uint64 const offset = GetAlignedOffset(alignment);
+			Uint8* block = static_cast<Uint8*>(_aligned_malloc(size + offset, (Uint64)alignment));
+			if (!block) return nullptr;
+			return RecordAllocation(block + offset, size);
+		}
+
+		void TrackedAlignedFree(void* ptr, std::align_val_t alignment)
+		{
+			if (!ptr) return;
+			RecordFree(ptr);
+			_aligned_free(static_cast<Uint8*>(ptr) - GetAlignedOffset(alignment));
+		}
+	}
+
+	Char const* MemoryTagToString(MemoryTag tag)
+	{
+		switch (tag)
+		{
+		case MemoryTag::Other:			return "Other";
+		case MemoryTag::RenderGraph:	return "Render Graph";
+		case MemoryTag::SceneLoader:	return "Scene Loader";
+		case MemoryTag::TextureManager:	return "Texture Manager";
+		case MemoryTag::ECS:			return "ECS";
+		case MemoryTag::ImGui:			return "ImGui";
+		case MemoryTag::Logging:		return "Logging";
+		}
+		return "Unknown";
+	}
+
+	MemoryTagScope::MemoryTagScope(MemoryTag tag) : previous_tag(current_tag)
+	{
+		current_tag = tag;
+	}
+
+	MemoryTagScope::~MemoryTagScope()
+	{
+		current_tag = previous_tag;
+	}
+
+	MemoryTag MemoryTagScope::Current()
+	{
+		return current_tag;
+	}
+
+	void MemoryTracker::NewFrame()
+	{
+		for (Uint64 i = 0; i < TagCount; ++i)
+		{
+			TagCounters const& counters = tag_counters[i];
+			Uint64 const total_allocations = counters.total_allocations.load(std::memory_order_relaxed);
+			Uint64 const total_bytes = counters.total_bytes.load(std::memory_order_relaxed);
+
+			MemoryTagStats& stats = frame_stats[i];
+			stats.live_allocations = counters.live_allocations.load(std::memory_order_relaxed);
+			stats.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+			stats.frame_allocations = total_allocations - last_total_allocations[i];
+			stats.frame_bytes = total_bytes - last_total_bytes[i];
+			last_total_allocations[i] = total_allocations;
+			last_total_bytes[i] = total_bytes;
+		}
+	}
+
+	MemoryTagStats const& MemoryTracker::GetStats(MemoryTag tag)
+	{
+		return frame_stats[(Uint64)tag];
+	}
+
+	MemoryTagStats MemoryTracker::GetTotalStats()
+	{
+		MemoryTagStats total{};
+		for (MemoryTagStats const& stats : frame_stats)
+		{
+			total.live_allocations += stats.live_allocations;
+			total.live_bytes += stats.live_bytes;
+			total.frame_allocations += stats.frame_allocations;
+			total.frame_bytes += stats.frame_bytes;
+		}
+		return total;
+	}
+}
+
+#if ADRIA_MEMORY_TRACKING
+using adria::TrackedAlloc;
+using adria::TrackedFree;
+using adria::TrackedAlignedAlloc;
+using adria::TrackedAlignedFree;
+
+void* operator new(std::size_t size)
+{
+	if (void* ptr = TrackedAlloc(size)) return ptr;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+	if (void* ptr = TrackedAlloc(size)) return ptr;
+	throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept { return TrackedAlloc(size); }
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept { return TrackedAlloc(size); }
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if (void* ptr = TrackedAlignedAlloc(size, alignment)) return ptr;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	if (void* ptr = TrackedAlignedAlloc(size, alignment)) return ptr;
+	throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept { return TrackedAlignedAlloc(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept { return TrackedAlignedAlloc(size, alignment); }
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::nothrow_t const&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { TrackedAlignedFree(ptr, alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { TrackedAlignedFree(ptr, alignment); }
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept { TrackedAlignedFree(ptr, alignment); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept { TrackedAlignedFree(ptr, alignment); }
+void operator delete(void* ptr, std::align_val_t alignment, std::nothrow_t const&) noexcept { TrackedAlignedFree(ptr, alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment, std::nothrow_t const&) noexcept { TrackedAlignedFree(ptr, alignment); }
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+//replaces the global operator new and delete, every allocation carries a small header with its size and tag
+#define ADRIA_MEMORY_TRACKING 1
+
+namespace adria
+{
+	enum class MemoryTag : Uint8
+	{
+		Other,
+		RenderGraph,
+		SceneLoader,
+		TextureManager,
+		ECS,
+		ImGui,
+		Logging,
+		Count
+	};
+	Char const* MemoryTagToString(MemoryTag tag);
+
+	//tags the heap allocations of the current thread until the scope ends
+	class MemoryTagScope
+	{
+	public:
+		explicit MemoryTagScope(MemoryTag tag);
+		ADRIA_NONCOPYABLE_NONMOVABLE(MemoryTagScope)
+		~MemoryTagScope();
+
+		static MemoryTag Current();
+
+	private:
+		MemoryTag previous_tag;
+	};
+
+	struct MemoryTagStats
+	{
+		Uint64 live_allocations = 0;
+		Uint64 live_bytes = 0;
+		Uint64 frame_allocations = 0;
+		Uint64 frame_bytes = 0;
+	};
+
+	class MemoryTracker
+	{
+	public:
+		//latches the allocations made since the previous call as the frame statistics
+		static void NewFrame();
+		static MemoryTagStats const& GetStats(MemoryTag tag);
+		static MemoryTagStats GetTotalStats();
+	};
+}
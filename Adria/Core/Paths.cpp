@@ -23,18 +23,24 @@ namespace adria
 
 	std::string const paths::ScreenshotsDir = SavedDir + "Screenshots/";
 
+	std::string const paths::BenchmarksDir = SavedDir + "Benchmarks/";
+
 	std::string const paths::LogDir = SavedDir + "Log/";
 	
 	std::string const paths::RenderGraphDir = SavedDir + "RenderGraph/";
 
 	std::string const paths::ShaderCacheDir = SavedDir + "ShaderCache/";
 
+	std::string const paths::ProceduralCacheDir = SavedDir + "ProceduralCache/";
+
 	std::string const paths::ShaderPDBDir = SavedDir + "ShaderPDB/";
 
 	std::string const paths::IniDir = SavedDir + "Ini/";
 
 	std::string const paths::ScenesDir = SavedDir + "Scenes/";
 
+	std::string const paths::SnapshotsDir = SavedDir + "Snapshots/";
+
 	std::string const paths::AftermathDir = SavedDir + "Aftermath/";
 
 	std::string const paths::PixCapturesDir = SavedDir + "PixCaptures/";
@@ -16,11 +16,14 @@ namespace adria::paths
 
 	extern std::string const LogDir;
 	extern std::string const ScreenshotsDir;
+	extern std::string const BenchmarksDir;
 	extern std::string const PixCapturesDir;
 	extern std::string const RenderGraphDir;
 	extern std::string const ShaderCacheDir;
+	extern std::string const ProceduralCacheDir;
 	extern std::string const ShaderPDBDir;
 	extern std::string const IniDir;
 	extern std::string const ScenesDir;
+	extern std::string const SnapshotsDir;
 	extern std::string const AftermathDir;
 }
\ No newline at end of file
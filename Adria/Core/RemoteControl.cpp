@@ -0,0 +1,213 @@
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#include "RemoteControl.h"
+#include "Logging/Logger.h"
+#include "Utilities/JsonUtil.h"
+#pragma comment(lib, "ws2_32.lib")
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Uint64 MAX_LINE_LENGTH = 4096;
+		constexpr Int32 SELECT_TIMEOUT_US = 5000;
+	}
+
+	RemoteControl::RemoteControl(std::string const& address, Uint16 port)
+	{
+		WSADATA wsa_data{};
+		if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+		{
+			ADRIA_LOG(WARNING, "Remote control: WSAStartup failed!");
+			return;
+		}
+
+		sockaddr_in socket_address{};
+		socket_address.sin_family = AF_INET;
+		socket_address.sin_port = htons(port);
+		if (inet_pton(AF_INET, address.c_str(), &socket_address.sin_addr) != 1)
+		{
+			ADRIA_LOG(WARNING, "Remote control: invalid address %s!", address.c_str());
+			return;
+		}
+
+		SOCKET const s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (s == INVALID_SOCKET) return;
+		if (bind(s, reinterpret_cast<sockaddr const*>(&socket_address), sizeof(socket_address)) == SOCKET_ERROR || listen(s, SOMAXCONN) == SOCKET_ERROR)
+		{
+			ADRIA_LOG(WARNING, "Remote control: failed to listen on %s:%u!", address.c_str(), port);
+			closesocket(s);
+			return;
+		}
+		listen_socket = (Uint64)s;
+		network_thread = std::thread(&RemoteControl::NetworkThread, this);
+		ADRIA_LOG(INFO, "Remote control listening on %s:%u", address.c_str(), port);
+	}
+
+	RemoteControl::~RemoteControl()
+	{
+		exit_requested.store(true, std::memory_order_release);
+		if (network_thread.joinable()) network_thread.join();
+		for (Client const& client : clients) closesocket((SOCKET)client.socket);
+		if (IsListening()) closesocket((SOCKET)listen_socket);
+		WSACleanup();
+	}
+
+	void RemoteControl::ConsumeCommands(std::vector<RemoteCommand>& _commands)
+	{
+		std::lock_guard lock(command_mutex);
+		_commands.swap(commands);
+		commands.clear();
+	}
+
+	void RemoteControl::SendReply(Uint64 client_id, std::string&& message)
+	{
+		std::lock_guard lock(command_mutex);
+		replies.push_back(Reply{ client_id, std::move(message) });
+	}
+
+	void RemoteControl::PublishFrameStats()
+	{
+		frame_stats[write_index].frame = ++published_frames;
+		write_index = middle_index.exchange(write_index | STATS_DIRTY, std::memory_order_acq_rel) & ~STATS_DIRTY;
+	}
+
+	RemoteFrameStats const* RemoteControl::AcquireFrameStats()
+	{
+		if (middle_index.load(std::memory_order_acquire) & STATS_DIRTY)
+		{
+			read_index = middle_index.exchange(read_index, std::memory_order_acq_rel) & ~STATS_DIRTY;
+		}
+		return frame_stats[read_index].frame > 0 ? &frame_stats[read_index] : nullptr;
+	}
+
+	void RemoteControl::NetworkThread()
+	{
+		std::vector<Reply> pending_replies;
+		while (!exit_requested.load(std::memory_order_acquire))
+		{
+			fd_set read_set;
+			FD_ZERO(&read_set);
+			FD_SET((SOCKET)listen_socket, &read_set);
+			for (Client const& client : clients) FD_SET((SOCKET)client.socket, &read_set);
+
+			timeval timeout{ 0, SELECT_TIMEOUT_US };
+			if (select(0, &read_set, nullptr, nullptr, &timeout) > 0)
+			{
+				if (FD_ISSET((SOCKET)listen_socket, &read_set)) AcceptClient();
+				std::erase_if(clients, [&](Client& client)
+					{
+						if (!FD_ISSET((SOCKET)client.socket, &read_set) || ReceiveFromClient(client)) return false;
+						if (client.subscribed) subscriber_count.fetch_sub(1, std::memory_order_relaxed);
+						closesocket((SOCKET)client.socket);
+						return true;
+					});
+				client_count.store((Uint32)clients.size(), std::memory_order_relaxed);
+			}
+
+			{
+				std::lock_guard lock(command_mutex);
+				pending_replies.swap(replies);
+			}
+			for (Reply const& reply : pending_replies)
+			{
+				auto it = std::find_if(clients.begin(), clients.end(), [&](Client const& client) { return client.id == reply.client_id; });
+				if (it != clients.end()) SendLine(it->socket, reply.message);
+			}
+			pending_replies.clear();
+
+			if (!HasSubscribers()) continue;
+			RemoteFrameStats const* stats = AcquireFrameStats();
+			if (!stats || stats->frame == last_streamed_frame) continue;
+			last_streamed_frame = stats->frame;
+			std::string const stats_json = FrameStatsToJson(*stats);
+			for (Client const& client : clients)
+			{
+				if (client.subscribed) SendLine(client.socket, stats_json);
+			}
+		}
+	}
+
+	void RemoteControl::AcceptClient()
+	{
+		SOCKET const s = accept((SOCKET)listen_socket, nullptr, nullptr);
+		if (s == INVALID_SOCKET) return;
+		BOOL const no_delay = TRUE;
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<Char const*>(&no_delay), sizeof(no_delay));
+		clients.push_back(Client{ .socket = (Uint64)s, .id = next_client_id++ });
+	}
+
+	Bool RemoteControl::ReceiveFromClient(Client& client)
+	{
+		Char buffer[1024];
+		Int const received = recv((SOCKET)client.socket, buffer, sizeof(buffer), 0);
+		if (received <= 0) return false;
+
+		client.pending_input.append(buffer, received);
+		Uint64 line_end;
+		while ((line_end = client.pending_input.find('\n')) != std::string::npos)
+		{
+			std::string line = client.pending_input.substr(0, line_end);
+			client.pending_input.erase(0, line_end + 1);
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (!line.empty()) HandleLine(client, line);
+		}
+		return client.pending_input.size() <= MAX_LINE_LENGTH;
+	}
+
+	void RemoteControl::HandleLine(Client& client, std::string const& line)
+	{
+		if (line == "stats")
+		{
+			RemoteFrameStats const* stats = AcquireFrameStats();
+			SendLine(client.socket, stats ? FrameStatsToJson(*stats) : R"({"error":"no frame yet"})");
+		}
+		else if (line == "subscribe" || line == "unsubscribe")
+		{
+			Bool const subscribe = line == "subscribe";
+			if (client.subscribed != subscribe)
+			{
+				client.subscribed = subscribe;
+				if (subscribe) subscriber_count.fetch_add(1, std::memory_order_relaxed);
+				else subscriber_count.fetch_sub(1, std::memory_order_relaxed);
+			}
+			SendLine(client.socket, R"({"ok":true})");
+		}
+		else
+		{
+			std::lock_guard lock(command_mutex);
+			commands.push_back(RemoteCommand{ client.id, line });
+		}
+	}
+
+	std::string RemoteControl::FrameStatsToJson(RemoteFrameStats const& stats)
+	{
+		json stats_json;
+		stats_json["frame"] = stats.frame;
+		stats_json["cpu_ms"] = stats.cpu_frame_time_ms;
+		stats_json["gpu_ms"] = stats.gpu_frame_time_ms;
+		stats_json["vram_usage"] = stats.vram_usage;
+		stats_json["vram_budget"] = stats.vram_budget;
+		json passes = json::array();
+		for (RGPassTiming const& pass_timing : stats.pass_timings)
+		{
+			if (pass_timing.culled) continue;
+			passes.push_back(json{ {"name", pass_timing.name}, {"cpu_ms", pass_timing.cpu_time_ms}, {"gpu_ms", pass_timing.gpu_time_ms} });
+		}
+		stats_json["passes"] = std::move(passes);
+		return stats_json.dump();
+	}
+
+	Bool RemoteControl::SendLine(Uint64 socket, std::string const& line)
+	{
+		std::string const message = line + "\n";
+		Uint64 sent = 0;
+		while (sent < message.size())
+		{
+			Int const result = send((SOCKET)socket, message.data() + sent, (Int)(message.size() - sent), 0);
+			if (result == SOCKET_ERROR) return false;
+			sent += result;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "RenderGraph/RenderGraphProfiler.h"
+
+namespace adria
+{
+	struct RemoteFrameStats
+	{
+		Uint64 frame = 0;
+		Float cpu_frame_time_ms = 0.0f;
+		Float gpu_frame_time_ms = 0.0f;
+		Uint64 vram_usage = 0;
+		Uint64 vram_budget = 0;
+		std::vector<RGPassTiming> pass_timings;
+	};
+
+	struct RemoteCommand
+	{
+		Uint64 client_id;
+		std::string command;
+	};
+
+	//line based tcp endpoint for automation, every received line is a command and every reply a single json line.
+	//"stats" replies with the statistics of the last frame, "subscribe" and "unsubscribe" toggle streaming them every frame,
+	//any other line is console input and is executed on the main thread
+	class RemoteControl
+	{
+		struct Client
+		{
+			Uint64 socket;
+			Uint64 id;
+			std::string pending_input;
+			Bool subscribed = false;
+		};
+		struct Reply
+		{
+			Uint64 client_id;
+			std::string message;
+		};
+
+	public:
+		RemoteControl(std::string const& address, Uint16 port);
+		ADRIA_NONCOPYABLE_NONMOVABLE(RemoteControl)
+		~RemoteControl();
+
+		Bool IsListening() const { return listen_socket != INVALID_SOCKET_HANDLE; }
+		Bool HasSubscribers() const { return subscriber_count.load(std::memory_order_relaxed) > 0; }
+		Bool HasClients() const { return client_count.load(std::memory_order_relaxed) > 0; }
+
+		//main thread
+		void ConsumeCommands(std::vector<RemoteCommand>& commands);
+		void SendReply(Uint64 client_id, std::string&& message);
+		RemoteFrameStats& BeginFrameStats() { return frame_stats[write_index]; }
+		void PublishFrameStats();
+
+	private:
+		static constexpr Uint64 INVALID_SOCKET_HANDLE = ~0ull;
+		static constexpr Uint32 STATS_DIRTY = 4;
+
+		Uint64 listen_socket = INVALID_SOCKET_HANDLE;
+		std::thread network_thread;
+		std::atomic<Bool> exit_requested = false;
+		std::atomic<Uint32> client_count = 0;
+		std::atomic<Uint32> subscriber_count = 0;
+
+		//triple buffered, the main thread never waits for the network thread
+		RemoteFrameStats frame_stats[3];
+		std::atomic<Uint32> middle_index = 1;
+		Uint32 write_index = 0;
+		Uint32 read_index = 2;
+		Uint64 published_frames = 0;
+
+		std::mutex command_mutex;
+		std::vector<RemoteCommand> commands;
+		std::vector<Reply> replies;
+
+		//network thread
+		std::vector<Client> clients;
+		Uint64 next_client_id = 1;
+		Uint64 last_streamed_frame = 0;
+
+	private:
+		void NetworkThread();
+		void AcceptClient();
+		Bool ReceiveFromClient(Client& client);
+		void HandleLine(Client& client, std::string const& line);
+		RemoteFrameStats const* AcquireFrameStats();
+		static std::string FrameStatsToJson(RemoteFrameStats const& stats);
+		static Bool SendLine(Uint64 socket, std::string const& line);
+	};
+}
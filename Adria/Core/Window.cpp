@@ -73,7 +73,8 @@ namespace adria
 		SetWindowLong(hwnd, GWL_STYLE, GetWindowLong(hwnd, GWL_STYLE) & ~WS_MINIMIZEBOX);
         SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
 
-        if(init.maximize) ShowWindow(hwnd, SW_SHOWMAXIMIZED);
+        if (init.hidden) {}
+        else if(init.maximize) ShowWindow(hwnd, SW_SHOWMAXIMIZED);
         else ShowWindow(hwnd, SW_SHOWNORMAL);
 
 		UpdateWindow(hwnd);
@@ -126,6 +127,11 @@ namespace adria
         return true;
     }
 
+	void Window::WaitForMessages(Uint32 timeout_ms) const
+	{
+		MsgWaitForMultipleObjectsEx(0, nullptr, timeout_ms, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	}
+
 	void Window::Quit(Int32 exit_code)
 	{
         PostQuitMessage(exit_code);
@@ -19,6 +19,7 @@ namespace adria
         Char const* title;
         Uint32 width, height;
         Bool maximize;
+        Bool hidden = false;
     };
 
 	DECLARE_EVENT(WindowEvent, Window, WindowEventData const&)
@@ -36,6 +37,8 @@ namespace adria
 		Uint32 PositionY() const;
 
 		Bool Loop();
+		//blocks until a message arrives or the timeout expires, the message is left for the next Loop
+		void WaitForMessages(Uint32 timeout_ms) const;
 		void Quit(Int32 exit_code);
 
 		void* Handle() const;
@@ -5,8 +5,12 @@
 #include "EditorLogger.h"
 #include "EditorConsole.h"
 #include "Core/Engine.h"
+#include "Core/Window.h"
 #include "Core/Input.h"
 #include "Core/Paths.h"
+#include "Core/CpuProfiler.h"
+#include "Core/ConsoleManager.h"
+#include "Core/MemoryTracker.h"
 #include "IconsFontAwesome6.h"
 #include "Rendering/Renderer.h"
 #include "Rendering/Camera.h"
@@ -17,9 +21,13 @@
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
 #include "Graphics/GfxTexture.h"
+#include "Graphics/GfxPipelineState.h"
 #include "Graphics/GfxRingDescriptorAllocator.h"
 #include "Graphics/GfxProfiler.h"
+#include "Graphics/GfxResidencyManager.h"
+#include "Graphics/GfxCommandAllocatorPool.h"
 #include "RenderGraph/RenderGraph.h"
+#include "RenderGraph/RenderGraphProfiler.h"
 #include "Utilities/FilesUtil.h"
 #include "Utilities/StringUtil.h"
 #include "Utilities/Random.h"
@@ -32,6 +40,11 @@ namespace adria
 {
 	extern Bool dump_render_graph;
 
+	static TAutoConsoleVariable<Bool> IdleThrottling("editor.IdleThrottling", true, "Stop rendering while nothing changes, the last image stays on screen until the next input");
+	static TAutoConsoleVariable<Int> IdleFrames("editor.IdleFrames", 16, "Number of unchanged frames rendered before the editor goes idle, lets temporal effects converge");
+	static TAutoConsoleVariable<Int> IdleRefreshInterval("editor.IdleRefreshInterval", 250, "Milliseconds between the frames rendered while idle, they pick up changes that come without input");
+	static TAutoConsoleVariable<Int> UIUpdateInterval("editor.UIUpdateInterval", 1, "Number of frames between editor UI updates, in between the last UI frame is drawn again. Input always triggers an update");
+
 	struct ProfilerState
 	{
 		Bool  show_average = false;
@@ -52,6 +65,42 @@ namespace adria
 		Uint32 accumulating_frame_count = 0;
 	};
 
+	static void RenderGraphProfileNode(RGProfileNode const& node)
+	{
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		if (node.is_group)
+		{
+			Bool const open = ImGui::TreeNodeEx(node.name.c_str(), ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen);
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%.3f ms", node.cpu_time_ms);
+			ImGui::TableSetColumnIndex(2);
+			ImGui::Text("%.3f ms", node.gpu_time_ms);
+			if (open)
+			{
+				for (RGProfileNode const& child : node.children) RenderGraphProfileNode(child);
+				ImGui::TreePop();
+			}
+			return;
+		}
+
+		if (node.culled) ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(128, 128, 128, 255));
+		ImGui::TreeNodeEx(node.name.c_str(), ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanFullWidth);
+		if (node.gpu_history && !node.gpu_history->empty() && ImGui::IsItemHovered())
+		{
+			ImGui::BeginTooltip();
+			ImGui::PlotLines("##GPUHistory", node.gpu_history->data(), (Int32)node.gpu_history->size(), 0, "GPU time (ms)", 0.0f, FLT_MAX, ImVec2(300, 80));
+			ImGui::EndTooltip();
+		}
+		ImGui::TableSetColumnIndex(1);
+		if (node.culled) ImGui::TextUnformatted("culled");
+		else ImGui::Text("%.3f ms", node.cpu_time_ms);
+		ImGui::TableSetColumnIndex(2);
+		if (node.culled) ImGui::TextUnformatted("culled");
+		else ImGui::Text(node.async_compute ? "%.3f ms (async)" : "%.3f ms", node.gpu_time_ms);
+		if (node.culled) ImGui::PopStyleColor();
+	}
+
 	Editor::Editor() = default;
 	Editor::~Editor() = default;
 	void Editor::Init(EditorInit&& init)
@@ -61,6 +110,7 @@ namespace adria
 		engine = std::make_unique<Engine>(init.engine_init);
 		gfx = engine->gfx.get();
 		gui = std::make_unique<ImGuiManager>(gfx);
+		CreateUICompositePSOs();
 		engine->RegisterEditorEventCallbacks(editor_events);
 
 		console = std::make_unique<EditorConsole>();
@@ -77,27 +127,40 @@ namespace adria
 	}
 	void Editor::OnWindowEvent(WindowEventData const& msg_data)
 	{
+		idle_frames = 0;
 		engine->OnWindowEvent(msg_data);
 		gui->OnWindowEvent(msg_data);
 	}
 	void Editor::Run()
 	{
+		Bool const idle = IdleThrottling.Get() && engine->window && idle_frames >= std::max(IdleFrames.Get(), 1) && !engine->NeedsContinuousRendering();
+		if (idle && !idle_refresh)
+		{
+			//messages end the wait right away, a timeout renders a single refresh frame
+			engine->window->WaitForMessages((Uint32)std::max(IdleRefreshInterval.Get(), 1));
+			engine->frame_timer.Mark();
+			idle_refresh = true;
+			return;
+		}
+		idle_refresh = false;
+
 		HandleInput();
 		if (gui->IsVisible()) engine->SetViewportData(&viewport_data);
 		else engine->SetViewportData(nullptr);
 
 		engine->Run();
+		if (engine->camera && engine->camera->IsChanged()) idle_frames = 0;
+		else ++idle_frames;
 
 		if (reload_shaders)
 		{
-			gfx->WaitForGPU();
 			ShaderManager::CheckIfShadersHaveChanged();
 			reload_shaders = false;
 		}
 	}
 	Bool Editor::IsActive() const
 	{
-		return gui->IsVisible();
+		return gui && gui->IsVisible();
 	}
 
 	void Editor::AddCommand(GUICommand&& command)
@@ -110,6 +173,10 @@ namespace adria
 	}
 	void Editor::AddRenderPass(RenderGraph& rg)
 	{
+		UpdateViewportDescriptor();
+
+		//ImGui only renders to R8G8B8A8_UNORM, on HDR outputs the UI goes to an intermediate target that is encoded for the display afterwards
+		Bool const hdr_output = gfx->GetColorSpace() != GfxColorSpace::SDR;
 		struct EditorPassData
 		{
 			RGTextureReadOnlyId src;
@@ -119,19 +186,44 @@ namespace adria
 		rg.AddPass<EditorPassData>("Editor Pass",
 			[=](EditorPassData& data, RenderGraphBuilder& builder)
 			{
-				data.src = builder.ReadTexture(RG_NAME(FinalTexture));
-				data.rt = builder.WriteRenderTarget(RG_NAME(Backbuffer), RGLoadStoreAccessOp::Preserve_Preserve);
+				data.src = builder.ReadTexture(RG_NAME(FinalTexture)); //transitions the final texture, the viewport samples it through viewport_descriptor
 				Vector2u display_resolution = engine->renderer->GetDisplayResolution();
+				if (hdr_output)
+				{
+					RGTextureDesc ui_desc{};
+					ui_desc.width = display_resolution.x;
+					ui_desc.height = display_resolution.y;
+					ui_desc.format = GfxFormat::R8G8B8A8_UNORM;
+					ui_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+					builder.DeclareTexture(RG_NAME(EditorUI), ui_desc);
+					data.rt = builder.WriteRenderTarget(RG_NAME(EditorUI), RGLoadStoreAccessOp::Clear_Preserve);
+				}
+				else
+				{
+					data.rt = builder.WriteRenderTarget(RG_NAME(Backbuffer), RGLoadStoreAccessOp::Preserve_Preserve);
+				}
 				builder.SetViewport(display_resolution.x, display_resolution.y);
 			},
 			[=](EditorPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
-				GfxDescriptor src_descriptor = ctx.GetReadOnlyTexture(data.src);
+				AdriaCpuProfileScope("ImGui");
+				//the viewport image is sampled through a persistent descriptor so the cached UI still shows the current frame
+				Bool const update_ui = ui_update_requested || gui->HasPendingInput() || ++ui_frames_since_update >= std::max(UIUpdateInterval.Get(), 1);
+				if (!update_ui)
+				{
+					gui->Redraw(cmd_list);
+					commands.clear();
+					debug_textures.clear();
+					return;
+				}
+				ui_frames_since_update = 0;
+				ui_update_requested = false;
+
 				gui->Begin();
 				{
 					ImGui::DockSpaceOverViewport(0, ImGui::GetMainViewport());
 					MenuBar();
-					Scene(src_descriptor);
+					Scene();
 					ListEntities();
 					AddEntities();
 					Settings();
@@ -148,6 +240,77 @@ namespace adria
 				debug_textures.clear();
 			}, RGPassType::Graphics, RGPassFlags::ForceNoCull | RGPassFlags::LegacyRenderPass);
 
+		if (hdr_output) AddUICompositePass(rg);
+	}
+
+	//the viewport samples the final texture through a descriptor that lives in the ImGui heap until the texture is recreated
+	void Editor::UpdateViewportDescriptor()
+	{
+		Uint64 const generation = engine->renderer->GetFinalTextureGeneration();
+		if (viewport_descriptor.IsValid() && generation == viewport_texture_generation) return;
+
+		gui->FreePersistentDescriptorGPU(viewport_descriptor);
+		viewport_descriptor = gui->AllocatePersistentDescriptorGPU();
+		GfxDescriptor final_texture_srv = gfx->CreateTextureSRV(engine->renderer->GetFinalTexture());
+		gfx->CopyDescriptors(1, viewport_descriptor, final_texture_srv);
+		gfx->FreeDescriptorCPU(final_texture_srv, GfxDescriptorHeapType::CBV_SRV_UAV);
+		viewport_texture_generation = generation;
+		ui_update_requested = true;
+	}
+
+	void Editor::AddUICompositePass(RenderGraph& rg)
+	{
+		struct UICompositePassData
+		{
+			RGTextureReadOnlyId ui;
+		};
+
+		GfxColorSpace const color_space = gfx->GetColorSpace();
+		rg.AddPass<UICompositePassData>("UI Composite Pass",
+			[=](UICompositePassData& data, RenderGraphBuilder& builder)
+			{
+				data.ui = builder.ReadTexture(RG_NAME(EditorUI), ReadAccess_PixelShader);
+				builder.WriteRenderTarget(RG_NAME(Backbuffer), RGLoadStoreAccessOp::Discard_Preserve);
+				Vector2u display_resolution = engine->renderer->GetDisplayResolution();
+				builder.SetViewport(display_resolution.x, display_resolution.y);
+			},
+			[=](UICompositePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDescriptor ui_descriptor = gfx->AllocateDescriptorsGPU();
+				gfx->CopyDescriptors(1, ui_descriptor, ctx.GetReadOnlyTexture(data.ui));
+
+				//the UI is decoded to linear and scaled to paper white before the HDR10 or scRGB encoding
+				struct UICompositeConstants
+				{
+					Uint32 ui_idx;
+					Float  paper_white_nits;
+				} constants =
+				{
+					.ui_idx = ui_descriptor.GetIndex(),
+					.paper_white_nits = gfx->GetHDRPaperWhite()
+				};
+				cmd_list->SetPipelineState(color_space == GfxColorSpace::HDR10 ? ui_composite_hdr10_pso.get() : ui_composite_scrgb_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
+				cmd_list->Draw(3);
+			}, RGPassType::Graphics, RGPassFlags::ForceNoCull);
+	}
+	void Editor::CreateUICompositePSOs()
+	{
+		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
+		gfx_pso_desc.root_signature = GfxRootSignatureID::Common;
+		gfx_pso_desc.VS = VS_FullscreenTriangle;
+		gfx_pso_desc.PS = PS_UIComposite;
+		gfx_pso_desc.PS.AddDefine("HDR10_OUTPUT", "1");
+		gfx_pso_desc.num_render_targets = 1;
+		gfx_pso_desc.rasterizer_state.cull_mode = GfxCullMode::None;
+		gfx_pso_desc.rtv_formats[0] = GfxFormat::R10G10B10A2_UNORM;
+		ui_composite_hdr10_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
+
+		gfx_pso_desc.PS = GfxShaderKey(PS_UIComposite);
+		gfx_pso_desc.PS.AddDefine("SCRGB_OUTPUT", "1");
+		gfx_pso_desc.rtv_formats[0] = GfxFormat::R16G16B16A16_FLOAT;
+		ui_composite_scrgb_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
 	}
 	void Editor::HandleInput()
 	{
@@ -303,6 +466,42 @@ namespace adria
 				ImGui::TreePop();
 				ImGui::Separator();
 			}
+			if (ImGui::TreeNodeEx("Terrain", 0))
+			{
+				static HeightmapDesc heightmap_desc{ .width = 1025, .depth = 1025, .max_height = 200, .fractal_type = FractalType::FBM, .octaves = 6, .noise_scale = 4.0f };
+				static Float texel_size = 1.0f;
+
+				ImGui::SliderInt("Width", (Int32*)&heightmap_desc.width, 257, 4097);
+				ImGui::SliderInt("Depth", (Int32*)&heightmap_desc.depth, 257, 4097);
+				ImGui::SliderInt("Max Height", (Int32*)&heightmap_desc.max_height, 1, 1000);
+				ImGui::SliderInt("Seed", &heightmap_desc.seed, 0, 10000);
+				ImGui::SliderInt("Octaves", &heightmap_desc.octaves, 1, 10);
+				ImGui::SliderFloat("Persistence", &heightmap_desc.persistence, 0.1f, 1.0f);
+				ImGui::SliderFloat("Lacunarity", &heightmap_desc.lacunarity, 1.0f, 4.0f);
+				ImGui::SliderFloat("Noise Scale", &heightmap_desc.noise_scale, 0.1f, 50.0f);
+				ImGui::SliderFloat("Texel Size", &texel_size, 0.1f, 10.0f);
+
+				if (ImGui::Button("Load Terrain"))
+				{
+					TerrainParameters params{};
+					params.heightmap = std::make_unique<Heightmap>(heightmap_desc);
+					params.texel_size = texel_size;
+					params.origin = Vector3(-0.5f * heightmap_desc.width * texel_size, 0.0f, -0.5f * heightmap_desc.depth * texel_size);
+					params.layers.push_back(TerrainLayerParameters{ .albedo_color = Vector3(0.76f, 0.70f, 0.50f), .height_range = Vector2(0.0f, 0.15f) });
+					params.layers.push_back(TerrainLayerParameters{ .albedo_color = Vector3(0.20f, 0.40f, 0.12f), .height_range = Vector2(0.15f, 0.7f), .slope_range = Vector2(0.0f, 0.6f) });
+					params.layers.push_back(TerrainLayerParameters{ .albedo_color = Vector3(0.40f, 0.36f, 0.33f), .slope_range = Vector2(0.6f, 1.0f) });
+					params.layers.push_back(TerrainLayerParameters{ .albedo_color = Vector3(0.95f, 0.95f, 0.97f), .height_range = Vector2(0.7f, 1.0f), .slope_range = Vector2(0.0f, 0.6f) });
+					gfx->WaitForGPU();
+					engine->scene_loader->LoadTerrain(std::move(params));
+				}
+
+				if (ImGui::Button(ICON_FA_ERASER" Clear"))
+				{
+					for (auto e : engine->reg.view<Terrain>()) engine->reg.destroy(e);
+				}
+				ImGui::TreePop();
+				ImGui::Separator();
+			}
 			if (ImGui::TreeNodeEx("Decals", 0))
 			{
 				static DecalParameters params{};
@@ -373,28 +572,34 @@ namespace adria
 		auto all_entities = engine->reg.view<Tag>();
 		if (ImGui::Begin(ICON_FA_LIST" Entities ", &visibility_flags[Flag_Entities]))
 		{
-			std::vector<entt::entity> deleted_entities{};
-			std::function<void(entt::entity, Bool)> ShowEntity;
-			ShowEntity = [&](entt::entity e, Bool first_iteration)
+			//only the rows inside the scroll region are submitted, large scenes would otherwise emit a tree node per entity every frame
+			listed_entities.assign(all_entities.begin(), all_entities.end());
+			ImGuiListClipper clipper;
+			clipper.Begin((Int)listed_entities.size());
+			while (clipper.Step())
 			{
-				auto& tag = all_entities.get<Tag>(e);
+				for (Int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+				{
+					entt::entity e = listed_entities[i];
+					auto& tag = all_entities.get<Tag>(e);
 
-				ImGuiTreeNodeFlags flags = ((selected_entity == e) ? ImGuiTreeNodeFlags_Selected : 0) | ImGuiTreeNodeFlags_OpenOnArrow;
-				flags |= ImGuiTreeNodeFlags_SpanAvailWidth;
-				Bool opened = ImGui::TreeNodeEx(tag.name.c_str(), flags);
+					ImGuiTreeNodeFlags flags = ((selected_entity == e) ? ImGuiTreeNodeFlags_Selected : 0) | ImGuiTreeNodeFlags_OpenOnArrow;
+					flags |= ImGuiTreeNodeFlags_SpanAvailWidth;
+					Bool opened = ImGui::TreeNodeEx((void*)(Uint64)entt::to_integral(e), flags, "%s", tag.name.c_str());
 
-				if (ImGui::IsItemClicked())
-				{
-					if (e == selected_entity) selected_entity = entt::null;
-					else selected_entity = e;
-				}
+					if (ImGui::IsItemClicked())
+					{
+						if (e == selected_entity) selected_entity = entt::null;
+						else selected_entity = e;
+					}
 
-				if (opened)
-				{
-					ImGui::TreePop();
+					if (opened)
+					{
+						ImGui::TreePop();
+					}
 				}
-			};
-			for (auto e : all_entities) ShowEntity(e, true);
+			}
+			clipper.End();
 		}
 		ImGui::End();
 	}
@@ -628,6 +833,26 @@ namespace adria
 					transform->current_transform = translation_matrix * rotation_matrix * scale_matrix;
 				}
 
+				auto local_transform = engine->reg.try_get<LocalTransform>(selected_entity);
+				if (local_transform && ImGui::CollapsingHeader("Local Transform"))
+				{
+					Vector3 translation, scale;
+					Quaternion rotation;
+					Matrix(local_transform->transform).Decompose(scale, rotation, translation);
+					Vector3 euler = rotation.ToEuler();
+					Vector3 euler_degrees(XMConvertToDegrees(euler.x), XMConvertToDegrees(euler.y), XMConvertToDegrees(euler.z));
+
+					Bool changed = ImGui::InputFloat3("Translation", &translation.x);
+					changed |= ImGui::InputFloat3("Rotation", &euler_degrees.x);
+					changed |= ImGui::InputFloat3("Scale", &scale.x);
+					if (changed)
+					{
+						Quaternion const new_rotation = Quaternion::CreateFromYawPitchRoll(XMConvertToRadians(euler_degrees.y), XMConvertToRadians(euler_degrees.x), XMConvertToRadians(euler_degrees.z));
+						Matrix const new_transform = Matrix::CreateScale(scale) * Matrix::CreateFromQuaternion(new_rotation) * Matrix::CreateTranslation(translation);
+						engine->reg.patch<LocalTransform>(selected_entity, [&](LocalTransform& local) { local.transform = new_transform; });
+					}
+				}
+
 				auto decal = engine->reg.try_get<Decal>(selected_entity);
 				if (decal && ImGui::CollapsingHeader("Decal"))
 				{
@@ -719,7 +944,7 @@ namespace adria
 		}
 		ImGui::End();
 	}
-	void Editor::Scene(GfxDescriptor& src)
+	void Editor::Scene()
 	{
 		ImGui::Begin(ICON_FA_GLOBE" Scene", nullptr, ImGuiWindowFlags_MenuBar);
 		{
@@ -737,6 +962,7 @@ namespace adria
 					AddLightingPathMenuItem(TiledDeferred);
 					AddLightingPathMenuItem(ClusteredDeferred);
 					AddLightingPathMenuItem(PathTracing);
+					AddLightingPathMenuItem(ReSTIR_DI);
 					#undef AddLightingPathMenuItem
 					ImGui::EndMenu();
 				}
@@ -773,9 +999,7 @@ namespace adria
 			v_max.y += ImGui::GetWindowPos().y;
 			ImVec2 size(v_max.x - v_min.x, v_max.y - v_min.y);
 
-			GfxDescriptor dst_descriptor = gui->AllocateDescriptorsGPU();
-			gfx->CopyDescriptors(1, dst_descriptor, src);
-			ImGui::Image((ImTextureID)static_cast<D3D12_GPU_DESCRIPTOR_HANDLE>(dst_descriptor).ptr, size);
+			ImGui::Image((ImTextureID)static_cast<D3D12_GPU_DESCRIPTOR_HANDLE>(viewport_descriptor).ptr, size);
 
 			scene_focused = ImGui::IsWindowFocused();
 
@@ -877,7 +1101,7 @@ namespace adria
 				static Float FrameTimeGraphMaxValues[ARRAYSIZE(FRAME_TIME_GRAPH_MAX_FPS)] = { 0 };
 				for (Uint64 i = 0; i < ARRAYSIZE(FrameTimeGraphMaxValues); ++i) { FrameTimeGraphMaxValues[i] = 1000.f / FRAME_TIME_GRAPH_MAX_FPS[i]; }
 
-				std::vector<GfxTimestamp> time_stamps = g_GfxProfiler.GetResults();
+				std::vector<GfxTimestamp> const& time_stamps = g_RenderGraphProfiler.GetGpuTimestamps();
 				FrameTimeArray[NUM_FRAMES - 1] = 1000.0f / io.Framerate;
 				for (Uint32 i = 0; i < NUM_FRAMES - 1; i++) FrameTimeArray[i] = FrameTimeArray[i + 1];
 				RecentHighestFrameTime = std::max(RecentHighestFrameTime, FrameTimeArray[NUM_FRAMES - 1]);
@@ -885,6 +1109,10 @@ namespace adria
 				Float frame_time_ms = FrameTimeArray[NUM_FRAMES - 1];
 				Int32 const fps = static_cast<Int32>(1000.0f / frame_time_ms);
 				ImGui::Text("FPS        : %d (%.2f ms)", fps, frame_time_ms);
+				GfxLatencyStats const latency_stats = gfx->GetLatencyStats();
+				if (latency_stats.input_to_display_ms) ImGui::Text("Latency    : %.2f ms input-to-display, %.2f ms input-to-GPU", *latency_stats.input_to_display_ms, latency_stats.input_to_gpu_complete_ms);
+				else ImGui::Text("Latency    : %.2f ms input-to-GPU", latency_stats.input_to_gpu_complete_ms);
+				ImGui::Text("CPU        : simulation %.2f ms, render submit %.2f ms, present %.2f ms", latency_stats.simulation_ms, latency_stats.render_submit_ms, latency_stats.present_ms);
 				if (ImGui::CollapsingHeader("Timings", ImGuiTreeNodeFlags_DefaultOpen))
 				{
 					ImGui::Checkbox("Show Avg/Min/Max", &state.show_average);
@@ -975,6 +1203,146 @@ namespace adria
 					ImGui::Text("Total: %7.2f %s", total_time_ms, "ms");
 					state.accumulating_frame_count++;
 				}
+				if (ImGui::CollapsingHeader("Queue Timeline"))
+				{
+					Float timeline_end_ms = 0.0f;
+					for (GfxTimestamp const& time_stamp : time_stamps) timeline_end_ms = std::max(timeline_end_ms, time_stamp.start_in_ms + time_stamp.time_in_ms);
+
+					static constexpr Float lane_height = 20.0f;
+					static constexpr Char const* lane_names[] = { "Graphics", "Async Compute" };
+					Float const timeline_width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+					ImVec2 const timeline_origin = ImGui::GetCursorScreenPos();
+					ImDrawList* draw_list = ImGui::GetWindowDrawList();
+					for (Uint32 lane = 0; lane < ARRAYSIZE(lane_names); ++lane)
+					{
+						ImVec2 const lane_min(timeline_origin.x, timeline_origin.y + lane * lane_height);
+						draw_list->AddRectFilled(lane_min, ImVec2(lane_min.x + timeline_width, lane_min.y + lane_height - 2.0f), IM_COL32(40, 40, 40, 255));
+						draw_list->AddText(lane_min, IM_COL32(160, 160, 160, 255), lane_names[lane]);
+					}
+					for (GfxTimestamp const& time_stamp : time_stamps)
+					{
+						if (timeline_end_ms <= 0.0f) break;
+						Float const lane_y = timeline_origin.y + (time_stamp.async_compute ? lane_height : 0.0f);
+						Float const x_min = timeline_origin.x + timeline_width * time_stamp.start_in_ms / timeline_end_ms;
+						Float const x_max = std::max(x_min + 1.0f, timeline_origin.x + timeline_width * (time_stamp.start_in_ms + time_stamp.time_in_ms) / timeline_end_ms);
+						ImU32 const color = time_stamp.async_compute ? IM_COL32(230, 140, 40, 200) : IM_COL32(60, 140, 230, 200);
+						draw_list->AddRectFilled(ImVec2(x_min, lane_y), ImVec2(x_max, lane_y + lane_height - 2.0f), color);
+						if (ImGui::IsMouseHoveringRect(ImVec2(x_min, lane_y), ImVec2(x_max, lane_y + lane_height - 2.0f)))
+						{
+							ImGui::SetTooltip("%s\n%.2f ms (starts at %.2f ms)", time_stamp.name.c_str(), time_stamp.time_in_ms, time_stamp.start_in_ms);
+						}
+					}
+					ImGui::Dummy(ImVec2(timeline_width, lane_height * ARRAYSIZE(lane_names)));
+				}
+				if (ImGui::CollapsingHeader("Pipeline Statistics"))
+				{
+					Bool has_statistics = false;
+					for (GfxTimestamp const& time_stamp : time_stamps) has_statistics |= time_stamp.pipeline_statistics.has_value();
+					if (!has_statistics)
+					{
+						ImGui::TextWrapped("Enable rhi.PipelineStatistics to collect pipeline statistics for passes on the graphics queue.");
+					}
+					else
+					{
+						static constexpr ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX;
+						static constexpr Char const* columns[] = { "Pass", "IA Prims", "VS", "MS", "MS Prims", "Rasterizer In", "Rasterized", "Culled", "PS", "CS" };
+						if (ImGui::BeginTable("PipelineStatistics", ARRAYSIZE(columns), flags))
+						{
+							for (Char const* column : columns) ImGui::TableSetupColumn(column);
+							ImGui::TableHeadersRow();
+							for (GfxTimestamp const& time_stamp : time_stamps)
+							{
+								if (!time_stamp.pipeline_statistics) continue;
+								GfxPipelineStatistics const& statistics = *time_stamp.pipeline_statistics;
+								Uint64 const culled_primitives = statistics.rasterizer_invocations > statistics.rasterized_primitives ? statistics.rasterizer_invocations - statistics.rasterized_primitives : 0;
+								Uint64 const values[] = { statistics.ia_primitives, statistics.vs_invocations, statistics.ms_invocations, statistics.ms_primitives,
+														  statistics.rasterizer_invocations, statistics.rasterized_primitives, culled_primitives, statistics.ps_invocations, statistics.cs_invocations };
+								ImGui::TableNextRow();
+								ImGui::TableSetColumnIndex(0);
+								ImGui::TextUnformatted(time_stamp.name.c_str());
+								for (Uint32 i = 0; i < ARRAYSIZE(values); ++i)
+								{
+									ImGui::TableSetColumnIndex(i + 1);
+									ImGui::Text("%llu", values[i]);
+								}
+							}
+							ImGui::EndTable();
+						}
+					}
+				}
+				if (ImGui::CollapsingHeader("Command Allocators"))
+				{
+					static constexpr ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg;
+					static constexpr Char const* columns[] = { "Queue", "Live", "In Flight", "Available", "Created", "Destroyed", "Resets", "Reuses" };
+					if (ImGui::BeginTable("CommandAllocators", ARRAYSIZE(columns), flags))
+					{
+						for (Char const* column : columns) ImGui::TableSetupColumn(column);
+						ImGui::TableHeadersRow();
+						static constexpr std::pair<Char const*, GfxCommandListType> queues[] =
+						{
+							{ "Graphics", GfxCommandListType::Graphics }, { "Compute", GfxCommandListType::Compute }, { "Copy", GfxCommandListType::Copy }
+						};
+						for (auto const& [queue_name, queue_type] : queues)
+						{
+							GfxCommandAllocatorStats const stats = gfx->GetCommandQueue(queue_type).GetAllocatorPool().GetStats();
+							Uint64 const values[] = { stats.created - stats.destroyed, stats.in_flight, stats.available, stats.created, stats.destroyed, stats.resets, stats.reuses };
+							ImGui::TableNextRow();
+							ImGui::TableSetColumnIndex(0);
+							ImGui::TextUnformatted(queue_name);
+							for (Uint32 i = 0; i < ARRAYSIZE(values); ++i)
+							{
+								ImGui::TableSetColumnIndex(i + 1);
+								ImGui::Text("%llu", values[i]);
+							}
+						}
+						ImGui::EndTable();
+					}
+				}
+				if (ImGui::CollapsingHeader("CPU Frame Phases"))
+				{
+					static constexpr ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+					if (ImGui::BeginTable("CpuProfiler", 5, flags))
+					{
+						ImGui::TableSetupColumn("Phase", ImGuiTableColumnFlags_NoHide);
+						ImGui::TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+						ImGui::TableSetupColumn("Avg", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+						ImGui::TableSetupColumn("Max", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+						ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+						ImGui::TableHeadersRow();
+						for (CpuPhaseStats const& phase : g_CpuProfiler.GetPhaseStats())
+						{
+							ImGui::TableNextRow();
+							ImGui::TableSetColumnIndex(0);
+							Float const indent = phase.depth * ImGui::GetStyle().IndentSpacing;
+							if (indent > 0.0f) ImGui::Indent(indent);
+							ImGui::TextUnformatted(phase.name);
+							if (indent > 0.0f) ImGui::Unindent(indent);
+							ImGui::TableSetColumnIndex(1);
+							ImGui::Text("%.2f ms", phase.time_ms);
+							ImGui::TableSetColumnIndex(2);
+							ImGui::Text("%.2f ms", phase.average_ms);
+							ImGui::TableSetColumnIndex(3);
+							ImGui::Text("%.2f ms", phase.max_ms);
+							ImGui::TableSetColumnIndex(4);
+							ImGui::Text("%u", phase.call_count);
+						}
+						ImGui::EndTable();
+					}
+					if (Uint64 dropped_events = g_CpuProfiler.GetDroppedEventCount()) ImGui::Text("Dropped events: %llu", dropped_events);
+				}
+				if (ImGui::CollapsingHeader("Render Graph Passes"))
+				{
+					static constexpr ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+					if (ImGui::BeginTable("RenderGraphProfiler", 3, flags))
+					{
+						ImGui::TableSetupColumn("Pass", ImGuiTableColumnFlags_NoHide);
+						ImGui::TableSetupColumn("CPU (avg)", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+						ImGui::TableSetupColumn("GPU (avg)", ImGuiTableColumnFlags_WidthFixed, 130.0f);
+						ImGui::TableHeadersRow();
+						for (RGProfileNode const& node : g_RenderGraphProfiler.GetRoot().children) RenderGraphProfileNode(node);
+						ImGui::EndTable();
+					}
+				}
 			}
 			static Bool display_vram_usage = false;
 			ImGui::Checkbox("Display VRAM Usage", &display_vram_usage);
@@ -988,6 +1356,61 @@ namespace adria
 				else ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 255, 255, 255));
 				ImGui::TextWrapped(vram_display_string.c_str());
 				ImGui::PopStyleColor();
+				ImGui::Text("Peak VRAM usage: %llu MB", gfx->GetPeakMemoryUsage() / 1024 / 1024);
+				GfxResidencyManager const* residency_manager = gfx->GetResidencyManager();
+				ImGui::Text("Residency: %llu tracked, %llu evicted%s", residency_manager->GetTrackedCount(), residency_manager->GetEvictedCount(), residency_manager->IsUnderPressure() ? " (under pressure)" : "");
+
+				GfxMemoryTracker const& memory_tracker = gfx->GetMemoryTracker();
+				if (ImGui::BeginTable("VRAMCategories", 3, ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg))
+				{
+					ImGui::TableSetupColumn("Category");
+					ImGui::TableSetupColumn("Current");
+					ImGui::TableSetupColumn("Peak");
+					ImGui::TableHeadersRow();
+					for (Uint32 i = 0; i < (Uint32)GfxMemoryCategory::Count; ++i)
+					{
+						GfxMemoryCategory const category = (GfxMemoryCategory)i;
+						ImGui::TableNextRow();
+						ImGui::TableSetColumnIndex(0);
+						ImGui::TextUnformatted(GfxMemoryCategoryToString(category));
+						ImGui::TableSetColumnIndex(1);
+						ImGui::Text("%.1f MB", memory_tracker.GetUsage(category) / (1024.0f * 1024.0f));
+						ImGui::TableSetColumnIndex(2);
+						ImGui::Text("%.1f MB", memory_tracker.GetPeakUsage(category) / (1024.0f * 1024.0f));
+					}
+					ImGui::EndTable();
+				}
+			}
+			static Bool display_cpu_memory_usage = false;
+			ImGui::Checkbox("Display CPU Memory Usage", &display_cpu_memory_usage);
+			if (display_cpu_memory_usage)
+			{
+				MemoryTagStats const total_stats = MemoryTracker::GetTotalStats();
+				ImGui::Text("Heap: %.1f MB in %llu allocations, %llu allocations (%.1f KB) last frame", total_stats.live_bytes / (1024.0f * 1024.0f),
+					total_stats.live_allocations, total_stats.frame_allocations, total_stats.frame_bytes / 1024.0f);
+				if (ImGui::BeginTable("CPUMemoryTags", 4, ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg))
+				{
+					ImGui::TableSetupColumn("Tag");
+					ImGui::TableSetupColumn("Live");
+					ImGui::TableSetupColumn("Allocs/Frame");
+					ImGui::TableSetupColumn("KB/Frame");
+					ImGui::TableHeadersRow();
+					for (Uint32 i = 0; i < (Uint32)MemoryTag::Count; ++i)
+					{
+						MemoryTag const tag = (MemoryTag)i;
+						MemoryTagStats const& stats = MemoryTracker::GetStats(tag);
+						ImGui::TableNextRow();
+						ImGui::TableSetColumnIndex(0);
+						ImGui::TextUnformatted(MemoryTagToString(tag));
+						ImGui::TableSetColumnIndex(1);
+						ImGui::Text("%.1f MB (%llu)", stats.live_bytes / (1024.0f * 1024.0f), stats.live_allocations);
+						ImGui::TableSetColumnIndex(2);
+						ImGui::Text("%llu", stats.frame_allocations);
+						ImGui::TableSetColumnIndex(3);
+						ImGui::Text("%.1f", stats.frame_bytes / 1024.0f);
+					}
+					ImGui::EndTable();
+				}
 			}
 		}
 		ImGui::End();
@@ -4,13 +4,14 @@
 #include "GUICommand.h"
 #include "EditorEvents.h"
 #include "Rendering/ViewportData.h"
+#include "Graphics/GfxDescriptor.h"
 #include "Utilities/Singleton.h"
 #include "entt/entity/fwd.hpp"
 
 namespace adria
 {
 	class GfxDevice;
-	class GfxDescriptor;
+	class GfxGraphicsPipelineState;
 	class Engine;
 	class ImGuiManager;
 	class RenderGraph;
@@ -59,6 +60,15 @@ namespace adria
 		std::unique_ptr<ImGuiManager> gui;
 		GfxDevice* gfx;
 		Bool ray_tracing_supported = false;
+		std::unique_ptr<GfxGraphicsPipelineState> ui_composite_hdr10_pso;
+		std::unique_ptr<GfxGraphicsPipelineState> ui_composite_scrgb_pso;
+		GfxDescriptor viewport_descriptor;
+		Uint64 viewport_texture_generation = 0;
+		Int ui_frames_since_update = 0;
+		Bool ui_update_requested = true;
+		Int idle_frames = 0;
+		Bool idle_refresh = false;
+		std::vector<entt::entity> listed_entities;
 
 		std::unique_ptr<EditorConsole> console;
 		EditorLogger* logger;
@@ -80,13 +90,16 @@ namespace adria
 		~Editor();
 
 		void SetStyle();
+		void CreateUICompositePSOs();
+		void AddUICompositePass(RenderGraph& rg);
+		void UpdateViewportDescriptor();
 		void HandleInput();
 		void MenuBar();
 		void AddEntities();
 		void ListEntities();
 		void Properties();
 		void Camera();
-		void Scene(GfxDescriptor& tex);
+		void Scene();
 		void Log();
 		void Console();
 		void Settings();
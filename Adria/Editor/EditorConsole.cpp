@@ -84,11 +84,24 @@ namespace adria
 
 		ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(4, 1)); // Tighten spacing
 		if (copy_to_clipboard) ImGui::LogToClipboard();
-		for (int i = 0; i < Items.Size; i++)
+		if (Filter.IsActive() || copy_to_clipboard)
 		{
-			const Char* item = Items[i];
-			if (!Filter.PassFilter(item)) continue;
-			ImGui::TextUnformatted(item);
+			for (int i = 0; i < Items.Size; i++)
+			{
+				const Char* item = Items[i];
+				if (!Filter.PassFilter(item)) continue;
+				ImGui::TextUnformatted(item);
+			}
+		}
+		else
+		{
+			ImGuiListClipper clipper;
+			clipper.Begin(Items.Size);
+			while (clipper.Step())
+			{
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) ImGui::TextUnformatted(Items[i]);
+			}
+			clipper.End();
 		}
 		if (copy_to_clipboard) ImGui::LogFinish();
 
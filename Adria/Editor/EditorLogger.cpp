@@ -7,6 +7,8 @@ namespace adria
 		ImGuiTextBuffer     Buf;
 		ImGuiTextFilter     Filter;
 		ImVector<int>       LineOffsets;
+		ImVector<int>       FilteredLines;
+		int                 FilteredLineCount;
 		Bool                AutoScroll;
 
 		ImGuiLogger()
@@ -20,6 +22,24 @@ namespace adria
 			Buf.clear();
 			LineOffsets.clear();
 			LineOffsets.push_back(0);
+			ClearFilteredLines();
+		}
+		void ClearFilteredLines()
+		{
+			FilteredLines.clear();
+			FilteredLineCount = 0;
+		}
+		//complete lines are tested against the filter once, only lines added since the last frame are visited
+		void UpdateFilteredLines()
+		{
+			const Char* buf = Buf.begin();
+			for (; FilteredLineCount < LineOffsets.Size - 1; FilteredLineCount++)
+			{
+				const Char* line_start = buf + LineOffsets[FilteredLineCount];
+				const Char* line_end = buf + LineOffsets[FilteredLineCount + 1] - 1;
+				if (Filter.PassFilter(line_start, line_end))
+					FilteredLines.push_back(FilteredLineCount);
+			}
 		}
 		void AddLog(const Char* fmt, ...) IM_FMTARGS(2)
 		{
@@ -55,7 +75,8 @@ namespace adria
 			ImGui::SameLine();
 			Bool copy = ImGui::Button("Copy");
 			ImGui::SameLine();
-			Filter.Draw("Filter", -100.0f);
+			if (Filter.Draw("Filter", -100.0f))
+				ClearFilteredLines();
 
 			ImGui::Separator();
 			ImGui::BeginChild("scrolling", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
@@ -70,13 +91,27 @@ namespace adria
 			const Char* buf_end = Buf.end();
 			if (Filter.IsActive())
 			{
-				for (int line_no = 0; line_no < LineOffsets.Size; line_no++)
+				UpdateFilteredLines();
+				//the last line can still be appended to so it is tested every frame
+				const Char* last_line_start = buf + LineOffsets.back();
+				Bool const show_last_line = Filter.PassFilter(last_line_start, buf_end);
+
+				ImGuiListClipper clipper;
+				clipper.Begin(FilteredLines.Size + (show_last_line ? 1 : 0));
+				while (clipper.Step())
 				{
-					const Char* line_start = buf + LineOffsets[line_no];
-					const Char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-					if (Filter.PassFilter(line_start, line_end))
-						ImGui::TextUnformatted(line_start, line_end);
+					for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+					{
+						if (i == FilteredLines.Size)
+						{
+							ImGui::TextUnformatted(last_line_start, buf_end);
+							continue;
+						}
+						int line_no = FilteredLines[i];
+						ImGui::TextUnformatted(buf + LineOffsets[line_no], buf + LineOffsets[line_no + 1] - 1);
+					}
 				}
+				clipper.End();
 			}
 			else
 			{
@@ -2,6 +2,7 @@
 #include "IconsFontAwesome6.h"
 #include "Core/Window.h"
 #include "Core/Paths.h"
+#include "Core/MemoryTracker.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
 #include "Graphics/GfxRingDescriptorAllocator.h"
@@ -13,6 +14,13 @@ namespace adria
 	ImGuiManager::ImGuiManager(GfxDevice* gfx) : gfx(gfx)
 	{
 		IMGUI_CHECKVERSION();
+		ImGui::SetAllocatorFunctions(
+			[](size_t size, void*) -> void*
+			{
+				MemoryTagScope memory_scope(MemoryTag::ImGui);
+				return ::operator new(size, std::nothrow);
+			},
+			[](void* ptr, void*) { ::operator delete(ptr); });
 		ImGui::CreateContext();
 		ImGui::StyleColorsDark();
 
@@ -36,7 +44,7 @@ namespace adria
 		io.Fonts->Build();
 		ImGui_ImplWin32_Init(gfx->GetHwnd());
 
-		imgui_allocator = std::make_unique<GUIDescriptorAllocator>(gfx, 30, 1); 
+		imgui_allocator = std::make_unique<GUIDescriptorAllocator>(gfx, 32, 1, 2);
 		GfxDescriptor handle = imgui_allocator->GetHandle(0);
 		ImGui_ImplDX12_Init(gfx->GetDevice(), gfx->GetBackbufferCount(), DXGI_FORMAT_R8G8B8A8_UNORM, imgui_allocator->GetHeap(), handle, handle);
 	}
@@ -53,18 +61,14 @@ namespace adria
 		ImGui_ImplDX12_NewFrame();
 		ImGui_ImplWin32_NewFrame();
 		ImGui::NewFrame();
+		pending_input = false;
 
 		imgui_allocator->ReleaseCompletedFrames(frame_count);
 	}
 	void ImGuiManager::End(GfxCommandList* cmd_list) const
 	{
 		ImGui::Render();
-		if (visible)
-		{
-			ID3D12DescriptorHeap* pp_heaps[] = { imgui_allocator->GetHeap() };
-			cmd_list->GetNative()->SetDescriptorHeaps(ARRAYSIZE(pp_heaps), pp_heaps);
-			ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), cmd_list->GetNative());
-		}
+		RenderDrawData(cmd_list);
 
 		if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
 		{
@@ -74,10 +78,25 @@ namespace adria
 		imgui_allocator->FinishCurrentFrame(frame_count);
 		++frame_count;
 	}
+	//draws the draw data of the last ImGui frame again without building a new one,
+	//descriptors allocated for that frame stay alive since the ring allocator only advances in Begin/End
+	void ImGuiManager::Redraw(GfxCommandList* cmd_list) const
+	{
+		ImDrawData* draw_data = ImGui::GetDrawData();
+		if (!draw_data || !draw_data->Valid) return;
+		RenderDrawData(cmd_list);
+	}
 	void ImGuiManager::OnWindowEvent(WindowEventData const& msg_data) const
 	{
 		ImGui_ImplWin32_WndProcHandler(static_cast<HWND>(msg_data.handle),
 			msg_data.msg, msg_data.wparam, msg_data.lparam);
+
+		Uint32 const msg = msg_data.msg;
+		if ((msg >= WM_MOUSEFIRST && msg <= WM_MOUSELAST) || (msg >= WM_KEYFIRST && msg <= WM_KEYLAST) ||
+			msg == WM_SIZE || msg == WM_SETFOCUS || msg == WM_KILLFOCUS || msg == WM_MOUSELEAVE)
+		{
+			pending_input = true;
+		}
 	}
 
 	void ImGuiManager::ToggleVisibility()
@@ -94,4 +113,23 @@ namespace adria
 		return imgui_allocator->Allocate(count);
 	}
 
+	void ImGuiManager::RenderDrawData(GfxCommandList* cmd_list) const
+	{
+		if (!visible) return;
+		ID3D12DescriptorHeap* pp_heaps[] = { imgui_allocator->GetHeap() };
+		cmd_list->GetNative()->SetDescriptorHeaps(ARRAYSIZE(pp_heaps), pp_heaps);
+		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), cmd_list->GetNative());
+		cmd_list->InvalidateStateCache();
+	}
+
+	GfxDescriptor ImGuiManager::AllocatePersistentDescriptorGPU() const
+	{
+		return imgui_allocator->AllocatePersistent();
+	}
+
+	void ImGuiManager::FreePersistentDescriptorGPU(GfxDescriptor descriptor) const
+	{
+		imgui_allocator->FreePersistent(descriptor);
+	}
+
 }
\ No newline at end of file
@@ -27,6 +27,8 @@ namespace adria
 
 		void Begin() const;
 		void End(GfxCommandList* cmd_list) const;
+		void Redraw(GfxCommandList* cmd_list) const;
+		Bool HasPendingInput() const { return pending_input; }
 
 		void OnWindowEvent(WindowEventData const&) const;
 
@@ -34,6 +36,8 @@ namespace adria
 		Bool IsVisible() const;
 
 		GfxDescriptor AllocateDescriptorsGPU(Uint32 count = 1) const;
+		GfxDescriptor AllocatePersistentDescriptorGPU() const;
+		void FreePersistentDescriptorGPU(GfxDescriptor descriptor) const;
 
 	private:
 		GfxDevice* gfx;
@@ -41,6 +45,10 @@ namespace adria
 		std::unique_ptr<GUIDescriptorAllocator> imgui_allocator;
 		Bool visible = true;
 		mutable Uint64 frame_count = 0;
+		mutable Bool pending_input = true;
+
+	private:
+		void RenderDrawData(GfxCommandList* cmd_list) const;
 	};
 
 }
\ No newline at end of file
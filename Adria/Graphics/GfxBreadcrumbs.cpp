@@ -0,0 +1,71 @@
+#include "GfxBreadcrumbs.h"
+#include "GfxDevice.h"
+#include "GfxBuffer.h"
+#include "GfxCommandList.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Char const* queue_names[] = { "Graphics", "Async Compute" };
+
+		Uint32 GetQueueIndex(GfxCommandList const* cmd_list)
+		{
+			return cmd_list->GetType() == GfxCommandListType::Compute ? 1 : 0;
+		}
+	}
+
+	GfxBreadcrumbs::GfxBreadcrumbs(GfxDevice* gfx) : gfx(gfx)
+	{
+		breadcrumb_buffer = gfx->CreateBuffer(ReadBackBufferDesc(GFX_BACKBUFFER_COUNT * FRAME_SLOT_SIZE));
+		breadcrumb_buffer->SetName("Breadcrumb Buffer");
+		breadcrumb_data = breadcrumb_buffer->GetMappedData<Uint32>();
+		memset(breadcrumb_data, 0, GFX_BACKBUFFER_COUNT * FRAME_SLOT_SIZE);
+	}
+
+	GfxBreadcrumbs::~GfxBreadcrumbs() = default;
+
+	void GfxBreadcrumbs::BeginFrame(Uint32 frame_slot, std::vector<std::string>&& marker_names)
+	{
+		current_frame_slot = frame_slot;
+		frame_marker_names[frame_slot] = std::move(marker_names);
+		memset(reinterpret_cast<Uint8*>(breadcrumb_data) + frame_slot * FRAME_SLOT_SIZE, 0, FRAME_SLOT_SIZE);
+	}
+
+	void GfxBreadcrumbs::BeginMarker(GfxCommandList* cmd_list, Uint32 marker)
+	{
+		cmd_list->WriteBufferImmediate(*breadcrumb_buffer, GetOffset(current_frame_slot, GetQueueIndex(cmd_list), false), marker + 1, GfxWriteBufferImmediateMode::MarkerIn);
+	}
+
+	void GfxBreadcrumbs::EndMarker(GfxCommandList* cmd_list, Uint32 marker)
+	{
+		cmd_list->WriteBufferImmediate(*breadcrumb_buffer, GetOffset(current_frame_slot, GetQueueIndex(cmd_list), true), marker + 1, GfxWriteBufferImmediateMode::MarkerOut);
+	}
+
+	void GfxBreadcrumbs::LogState(Uint32 frame_slot) const
+	{
+		for (Uint32 queue_index = 0; queue_index < QUEUE_COUNT; ++queue_index)
+		{
+			Uint32 const begun = breadcrumb_data[GetOffset(frame_slot, queue_index, false) / sizeof(Uint32)];
+			Uint32 const completed = breadcrumb_data[GetOffset(frame_slot, queue_index, true) / sizeof(Uint32)];
+			if (begun == 0) continue;
+			if (begun != completed)
+			{
+				ADRIA_LOG(WARNING, "[Breadcrumbs] %s queue: executing '%s', last completed '%s'", queue_names[queue_index], GetMarkerName(frame_slot, begun), GetMarkerName(frame_slot, completed));
+			}
+			else
+			{
+				ADRIA_LOG(WARNING, "[Breadcrumbs] %s queue: idle, last completed '%s'", queue_names[queue_index], GetMarkerName(frame_slot, completed));
+			}
+		}
+	}
+
+	Char const* GfxBreadcrumbs::GetMarkerName(Uint32 frame_slot, Uint32 marker_value) const
+	{
+		std::vector<std::string> const& marker_names = frame_marker_names[frame_slot];
+		if (marker_value == 0) return "<none>";
+		if (marker_value > marker_names.size()) return "<unknown>";
+		return marker_names[marker_value - 1].c_str();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "GfxMacros.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxCommandList;
+
+	class GfxBreadcrumbs
+	{
+		static constexpr Uint32 QUEUE_COUNT = 2;
+		static constexpr Uint32 FRAME_SLOT_SIZE = QUEUE_COUNT * 2 * sizeof(Uint32);
+
+	public:
+		explicit GfxBreadcrumbs(GfxDevice* gfx);
+		~GfxBreadcrumbs();
+
+		void BeginFrame(Uint32 frame_slot, std::vector<std::string>&& marker_names);
+		void BeginMarker(GfxCommandList* cmd_list, Uint32 marker);
+		void EndMarker(GfxCommandList* cmd_list, Uint32 marker);
+
+		void LogState(Uint32 frame_slot) const;
+
+	private:
+		GfxDevice* gfx;
+		std::unique_ptr<GfxBuffer> breadcrumb_buffer;
+		Uint32* breadcrumb_data = nullptr;
+		std::vector<std::string> frame_marker_names[GFX_BACKBUFFER_COUNT];
+		Uint32 current_frame_slot = 0;
+
+	private:
+		Uint32 GetOffset(Uint32 frame_slot, Uint32 queue_index, Bool completed) const
+		{
+			return frame_slot * FRAME_SLOT_SIZE + (queue_index * 2 + (completed ? 1 : 0)) * sizeof(Uint32);
+		}
+		Char const* GetMarkerName(Uint32 frame_slot, Uint32 marker_value) const;
+	};
+}
@@ -37,41 +37,65 @@ namespace adria
 		if (HasAllFlags(desc.misc_flags, GfxBufferMiscFlag::AccelStruct))
 			resource_state = D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE;
 
+		GfxResourceUsage resource_usage = desc.resource_usage;
+		if (resource_usage == GfxResourceUsage::GpuUpload && !gfx->GetCapabilities().SupportsGPUUploadHeap()) resource_usage = GfxResourceUsage::Upload;
+		this->desc.resource_usage = resource_usage;
+
 		D3D12MA::ALLOCATION_DESC allocation_desc{};
 		allocation_desc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
-		if (desc.resource_usage == GfxResourceUsage::Readback)
+		if (resource_usage == GfxResourceUsage::Readback)
 		{
 			allocation_desc.HeapType = D3D12_HEAP_TYPE_READBACK;
 			resource_state = D3D12_RESOURCE_STATE_COPY_DEST;
 			resource_desc.Flags |= D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
 		}
-		else if (desc.resource_usage == GfxResourceUsage::Upload)
+		else if (resource_usage == GfxResourceUsage::Upload)
 		{
 			allocation_desc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
 			resource_state = D3D12_RESOURCE_STATE_GENERIC_READ;
 		}
+		else if (resource_usage == GfxResourceUsage::GpuUpload)
+		{
+			resource_state = HasAllFlags(desc.bind_flags, GfxBindFlag::UnorderedAccess) ? D3D12_RESOURCE_STATE_COMMON : D3D12_RESOURCE_STATE_GENERIC_READ;
+		}
 
 		auto device = gfx->GetDevice();
 		auto allocator = gfx->GetAllocator();
 
-		D3D12MA::Allocation* alloc = nullptr;
-		HRESULT hr = allocator->CreateResource(
-			&allocation_desc,
-			&resource_desc,
-			resource_state,
-			nullptr,
-			&alloc,
-			IID_PPV_ARGS(resource.GetAddressOf())
-		);
-		GFX_CHECK_HR(hr);
-		allocation.reset(alloc);
+		HRESULT hr = S_OK;
+		if (resource_usage == GfxResourceUsage::GpuUpload)
+		{
+			//the bundled D3D12MA has no pools for the gpu upload heap, such buffers are committed resources
+			D3D12_HEAP_PROPERTIES heap_properties{};
+			heap_properties.Type = D3D12_HEAP_TYPE_GPU_UPLOAD;
+			hr = device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, resource_state, nullptr, IID_PPV_ARGS(resource.GetAddressOf()));
+			GFX_CHECK_HR(hr);
+			allocation_size = device->GetResourceAllocationInfo(0, 1, &resource_desc).SizeInBytes;
+		}
+		else
+		{
+			D3D12MA::Allocation* alloc = nullptr;
+			hr = allocator->CreateResource(
+				&allocation_desc,
+				&resource_desc,
+				resource_state,
+				nullptr,
+				&alloc,
+				IID_PPV_ARGS(resource.GetAddressOf())
+			);
+			GFX_CHECK_HR(hr);
+			allocation.reset(alloc);
+			allocation_size = allocation->GetSize();
+		}
+		memory_category = GfxMemoryCategoryScope::Current();
+		gfx->GetMemoryTracker().Allocate(memory_category, allocation_size);
 
-		if (desc.resource_usage == GfxResourceUsage::Readback)
+		if (resource_usage == GfxResourceUsage::Readback)
 		{
 			hr = resource->Map(0, nullptr, &mapped_data);
 			GFX_CHECK_HR(hr);
 		}
-		else if (desc.resource_usage == GfxResourceUsage::Upload)
+		else if (resource_usage == GfxResourceUsage::Upload || resource_usage == GfxResourceUsage::GpuUpload)
 		{
 			D3D12_RANGE read_range{};
 			hr = resource->Map(0, &read_range, &mapped_data);
@@ -83,7 +107,7 @@ namespace adria
 			}
 		}
 
-		if (initial_data != nullptr && desc.resource_usage != GfxResourceUsage::Upload)
+		if (initial_data != nullptr && resource_usage == GfxResourceUsage::Default)
 		{
 			auto cmd_list = gfx->GetCommandList();
 			auto upload_buffer = gfx->GetDynamicAllocator();
@@ -106,6 +130,7 @@ namespace adria
 
 	GfxBuffer::~GfxBuffer()
 	{
+		if (allocation_size) gfx->GetMemoryTracker().Free(memory_category, allocation_size);
 		if (mapped_data != nullptr)
 		{
 			ADRIA_ASSERT(resource != nullptr);
@@ -124,6 +149,12 @@ namespace adria
 		return resource.Get();
 	}
 
+	ID3D12Pageable* GfxBuffer::GetPageable() const
+	{
+		if (allocation && allocation->GetHeap() != nullptr) return nullptr;
+		return resource.Get();
+	}
+
 	GfxBufferDesc const& GfxBuffer::GetDesc() const
 	{
 		return desc;
@@ -170,7 +201,7 @@ namespace adria
 			hr = resource->Map(0, nullptr, &mapped_data);
 			GFX_CHECK_HR(hr);
 		}
-		else if (desc.resource_usage == GfxResourceUsage::Upload)
+		else if (desc.resource_usage == GfxResourceUsage::Upload || desc.resource_usage == GfxResourceUsage::GpuUpload)
 		{
 			D3D12_RANGE read_range{};
 			hr = resource->Map(0, &read_range, &mapped_data);
@@ -187,7 +218,7 @@ namespace adria
 
 	void GfxBuffer::Update(void const* src_data, Uint64 data_size, Uint64 offset /*= 0*/)
 	{
-		ADRIA_ASSERT(desc.resource_usage == GfxResourceUsage::Upload);
+		ADRIA_ASSERT(desc.resource_usage == GfxResourceUsage::Upload || desc.resource_usage == GfxResourceUsage::GpuUpload);
 		if (mapped_data)
 		{
 			memcpy((Uint8*)mapped_data + offset, src_data, data_size);
@@ -1,5 +1,6 @@
 #pragma once
 #include "GfxResourceCommon.h"
+#include "GfxMemoryTracker.h"
 
 namespace adria
 {
@@ -38,6 +39,7 @@ namespace adria
 		~GfxBuffer();
 
 		ID3D12Resource* GetNative() const;
+		ID3D12Pageable* GetPageable() const;
 
 		GfxBufferDesc const& GetDesc() const;
 		Uint64 GetGpuAddress() const;
@@ -63,6 +65,8 @@ namespace adria
 		Ref<ID3D12Resource> resource;
 		GfxBufferDesc desc;
 		ReleasablePtr<D3D12MA::Allocation> allocation = nullptr;
+		Uint64 allocation_size = 0;
+		GfxMemoryCategory memory_category = GfxMemoryCategory::Other;
 		void* mapped_data = nullptr;
 	};
 
@@ -17,6 +17,10 @@ namespace adria
 				return RayTracingSupport::Tier1_0;
 			case D3D12_RAYTRACING_TIER_1_1:
 				return RayTracingSupport::Tier1_1;
+#if GFX_OPACITY_MICROMAPS
+			case D3D12_RAYTRACING_TIER_1_2:
+				return RayTracingSupport::Tier1_2;
+#endif
 			}
 			return RayTracingSupport::TierNotSupported;
 		}
@@ -68,6 +72,9 @@ namespace adria
 			case D3D_SHADER_MODEL_6_6: return SM_6_6;
 			case D3D_SHADER_MODEL_6_7: return SM_6_7;
 			case D3D_SHADER_MODEL_6_8: return SM_6_8;
+#if defined(D3D12_SDK_VERSION) && (D3D12_SDK_VERSION >= 612)
+			case D3D_SHADER_MODEL_6_9: return SM_6_9;
+#endif
 			default:
 				return SM_Unknown;
 			}
@@ -85,6 +92,14 @@ namespace adria
 		work_graph_support = ConvertWorkGraphTier(feature_support.WorkGraphsTier());
 		shader_model		= ConvertShaderModel(feature_support.HighestShaderModel());
 		enhanced_barriers_supported = feature_support.EnhancedBarriersSupported();
+		resource_heap_tier2_supported = feature_support.ResourceHeapTier() >= D3D12_RESOURCE_HEAP_TIER_2;
+		mesh_shader_pipeline_statistics_supported = feature_support.MeshShaderPipelineStatsSupported();
+		copy_queue_timestamps_supported = feature_support.CopyQueueTimestampQueriesSupported();
+		cache_coherent_uma = feature_support.CacheCoherentUMA();
+		gpu_upload_heap_supported = feature_support.GPUUploadHeapSupported();
+		native_16bit_shader_ops_supported = feature_support.Native16BitShaderOpsSupported();
+		wave_lane_count_min = feature_support.WaveLaneCountMin();
+		wave_lane_count_max = feature_support.WaveLaneCountMax();
 
 		shading_rate_image_tile_size = feature_support.ShadingRateImageTileSize();
 		additional_shading_rates_supported = feature_support.AdditionalShadingRatesSupported();
@@ -94,7 +109,6 @@ namespace adria
 			ADRIA_LOG(ERROR, "Device doesn't support Shader Model 6.6 which is required!");
 			return false;
 		}
-
 		return true;
 	}
 }
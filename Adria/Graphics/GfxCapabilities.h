@@ -1,5 +1,6 @@
 #pragma once
 #include "GfxShaderEnums.h"
+#include "GfxMacros.h"
 
 namespace adria
 {
@@ -9,7 +10,8 @@ namespace adria
 	{
 		TierNotSupported,
 		Tier1_0,
-		Tier1_1
+		Tier1_1,
+		Tier1_2
 	};
 	enum class VSRSupport : Uint8
 	{
@@ -72,13 +74,33 @@ namespace adria
 		{
 			return shader_model >= sm;
 		}
+		Bool SupportsOpacityMicromaps() const
+		{
+			return GFX_OPACITY_MICROMAPS && CheckRayTracingSupport(RayTracingSupport::Tier1_2);
+		}
+		//MaybeReorderThread is part of SM 6.9 for every ray tracing device, drivers without hardware reordering treat it as a no-op
+		Bool SupportsShaderExecutionReordering() const
+		{
+			return SupportsRayTracing() && SupportsShaderModel(SM_6_9);
+		}
 		Bool SupportsEnhancedBarriers() const 
 		{
 			return enhanced_barriers_supported;
 		}
+		Bool SupportsResourceHeapTier2() const
+		{
+			return resource_heap_tier2_supported;
+		}
 
+		Bool SupportsMeshShaderPipelineStatistics() const { return mesh_shader_pipeline_statistics_supported; }
+		Bool SupportsCopyQueueTimestamps() const { return copy_queue_timestamps_supported; }
 		Bool SupportsAdditionalShadingRates() const { return additional_shading_rates_supported; }
 		Uint32 GetShadingRateImageTileSize() const { return shading_rate_image_tile_size; }
+		Bool IsCacheCoherentUMA() const { return cache_coherent_uma; }
+		Bool SupportsGPUUploadHeap() const { return gpu_upload_heap_supported; }
+		Bool SupportsNative16BitShaderOps() const { return native_16bit_shader_ops_supported; }
+		Uint32 GetWaveLaneCountMin() const { return wave_lane_count_min; }
+		Uint32 GetWaveLaneCountMax() const { return wave_lane_count_max; }
 
 	private:
 		
@@ -88,6 +110,14 @@ namespace adria
 		WorkGraphSupport work_graph_support = WorkGraphSupport::TierNotSupported;
 		GfxShaderModel shader_model = SM_Unknown;
 		Bool enhanced_barriers_supported = false;
+		Bool resource_heap_tier2_supported = false;
+		Bool mesh_shader_pipeline_statistics_supported = false;
+		Bool copy_queue_timestamps_supported = false;
+		Bool cache_coherent_uma = false;
+		Bool gpu_upload_heap_supported = false;
+		Bool native_16bit_shader_ops_supported = false;
+		Uint32 wave_lane_count_min = 32;
+		Uint32 wave_lane_count_max = 32;
 
 		Bool additional_shading_rates_supported = false;
 		Uint32 shading_rate_image_tile_size = 0;
@@ -0,0 +1,76 @@
+#include "GfxCommandAllocatorPool.h"
+#include "GfxDevice.h"
+
+namespace adria
+{
+	GfxCommandAllocatorPool::GfxCommandAllocatorPool(GfxDevice* gfx, D3D12_COMMAND_LIST_TYPE type, GfxFence& fence) : gfx(gfx), type(type), fence(fence)
+	{
+	}
+
+	GfxCommandAllocatorPool::~GfxCommandAllocatorPool() = default;
+
+	Ref<ID3D12CommandAllocator> GfxCommandAllocatorPool::Acquire(Uint32 command_count_hint)
+	{
+		std::lock_guard lock(pool_mutex);
+		RecycleCompleted();
+
+		//an allocator that already grew large enough is preferred over making a smaller one grow
+		for (Uint32 size_class = GetSizeClass(command_count_hint); size_class < SIZE_CLASS_COUNT; ++size_class)
+		{
+			if (available_allocators[size_class].empty()) continue;
+			Ref<ID3D12CommandAllocator> allocator = std::move(available_allocators[size_class].back());
+			available_allocators[size_class].pop_back();
+			--stats.available;
+			++stats.reuses;
+			return allocator;
+		}
+
+		Ref<ID3D12CommandAllocator> allocator;
+		GFX_CHECK_HR(gfx->GetDevice()->CreateCommandAllocator(type, IID_PPV_ARGS(allocator.GetAddressOf())));
+		++stats.created;
+		return allocator;
+	}
+
+	void GfxCommandAllocatorPool::Release(Ref<ID3D12CommandAllocator>&& allocator, Uint64 fence_value, Uint32 command_count)
+	{
+		if (!allocator) return;
+
+		std::lock_guard lock(pool_mutex);
+		pending_allocators.emplace_back(std::move(allocator), fence_value, GetSizeClass(command_count));
+		++stats.in_flight;
+	}
+
+	GfxCommandAllocatorStats GfxCommandAllocatorPool::GetStats() const
+	{
+		std::lock_guard lock(pool_mutex);
+		return stats;
+	}
+
+	Uint32 GfxCommandAllocatorPool::GetSizeClass(Uint32 command_count)
+	{
+		return std::min((Uint32)std::bit_width(command_count >> 6), SIZE_CLASS_COUNT - 1);
+	}
+
+	void GfxCommandAllocatorPool::RecycleCompleted()
+	{
+		if (pending_allocators.empty()) return;
+
+		Uint64 const completed_value = fence.GetCompletedValue();
+		std::erase_if(pending_allocators, [&](PendingAllocator& pending)
+			{
+				if (pending.fence_value > completed_value) return false;
+
+				--stats.in_flight;
+				if (available_allocators[pending.size_class].size() >= MAX_AVAILABLE_PER_SIZE_CLASS)
+				{
+					++stats.destroyed;
+					return true;
+				}
+				GFX_CHECK_HR(pending.allocator->Reset());
+				++stats.resets;
+				++stats.available;
+				available_allocators[pending.size_class].push_back(std::move(pending.allocator));
+				return true;
+			});
+	}
+}
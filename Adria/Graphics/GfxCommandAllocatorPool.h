@@ -0,0 +1,56 @@
+#pragma once
+#include <mutex>
+#include "GfxFence.h"
+
+namespace adria
+{
+	class GfxDevice;
+
+	struct GfxCommandAllocatorStats
+	{
+		Uint64 created = 0;
+		Uint64 destroyed = 0;
+		Uint64 resets = 0;
+		Uint64 reuses = 0;
+		Uint32 in_flight = 0;
+		Uint32 available = 0;
+	};
+
+	//command allocators of one queue, handed back with the fence value of the submission that used them and reset once it completes.
+	//allocators keep the memory of their largest recording, so they are bucketed by the command count of the list that last used them
+	class GfxCommandAllocatorPool
+	{
+		static constexpr Uint32 SIZE_CLASS_COUNT = 8;
+		static constexpr Uint32 MAX_AVAILABLE_PER_SIZE_CLASS = 8;
+
+		struct PendingAllocator
+		{
+			Ref<ID3D12CommandAllocator> allocator;
+			Uint64 fence_value;
+			Uint32 size_class;
+		};
+
+	public:
+		GfxCommandAllocatorPool(GfxDevice* gfx, D3D12_COMMAND_LIST_TYPE type, GfxFence& fence);
+		ADRIA_NONCOPYABLE_NONMOVABLE(GfxCommandAllocatorPool)
+		~GfxCommandAllocatorPool();
+
+		Ref<ID3D12CommandAllocator> Acquire(Uint32 command_count_hint);
+		void Release(Ref<ID3D12CommandAllocator>&& allocator, Uint64 fence_value, Uint32 command_count);
+
+		GfxCommandAllocatorStats GetStats() const;
+
+	private:
+		GfxDevice* gfx;
+		D3D12_COMMAND_LIST_TYPE const type;
+		GfxFence& fence;
+		mutable std::mutex pool_mutex;
+		std::vector<PendingAllocator> pending_allocators;
+		std::vector<Ref<ID3D12CommandAllocator>> available_allocators[SIZE_CLASS_COUNT];
+		GfxCommandAllocatorStats stats;
+
+	private:
+		static Uint32 GetSizeClass(Uint32 command_count);
+		void RecycleCompleted();
+	};
+}
@@ -1,5 +1,6 @@
 #include "GfxCommandList.h"
 #include "GfxCommandQueue.h"
+#include "GfxCommandAllocatorPool.h"
 #include "GfxDevice.h"
 #include "GfxBuffer.h"
 #include "GfxTexture.h"
@@ -8,6 +9,7 @@
 #include "GfxRenderPass.h"
 #include "GfxRingDescriptorAllocator.h"
 #include "GfxLinearDynamicAllocator.h"
+#include "GfxTracyProfiler.h"
 #include "GfxRayTracingShaderTable.h"
 #include "GfxStateObject.h"
 #include "Utilities/StringUtil.h"
@@ -101,6 +103,8 @@ namespace adria
 				return D3D12_QUERY_TYPE_BINARY_OCCLUSION;
 			case GfxQueryType::PipelineStatistics:
 				return D3D12_QUERY_TYPE_PIPELINE_STATISTICS;
+			case GfxQueryType::PipelineStatistics1:
+				return D3D12_QUERY_TYPE_PIPELINE_STATISTICS1;
 			}
 			return D3D12_QUERY_TYPE_TIMESTAMP;
 		}
@@ -117,32 +121,60 @@ namespace adria
 				d3d12_clear_value.DepthStencil.Stencil = value.depth_stencil.stencil;
 			}
 		}
+		constexpr D3D12_RESOURCE_BARRIER_FLAGS ToD3D12BarrierFlags(GfxBarrierSplit split)
+		{
+			switch (split)
+			{
+			case GfxBarrierSplit::Begin:
+				return D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+			case GfxBarrierSplit::End:
+				return D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			}
+			return D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		}
+		template<typename BarrierType>
+		void ApplyBarrierSplit(BarrierType& barrier, GfxBarrierSplit split)
+		{
+			if (split == GfxBarrierSplit::Begin) barrier.SyncAfter = D3D12_BARRIER_SYNC_SPLIT;
+			else if (split == GfxBarrierSplit::End) barrier.SyncBefore = D3D12_BARRIER_SYNC_SPLIT;
+		}
 	}
 
 	GfxCommandList::GfxCommandList(GfxDevice* gfx, GfxCommandListType type, Char const* name)
-		: gfx(gfx), type(type), cmd_queue(gfx->GetCommandQueue(type)), use_legacy_barriers(!gfx->GetCapabilities().SupportsEnhancedBarriers()), current_rt_table(nullptr)
+		: gfx(gfx), type(type), cmd_queue(gfx->GetCommandQueue(type)), use_legacy_barriers(!gfx->GetCapabilities().SupportsEnhancedBarriers()),
+		state_cache(std::make_unique<StateCache>())
 	{
 		D3D12_COMMAND_LIST_TYPE cmd_list_type = ToD3D12CommandListType(type);
 		ID3D12Device* device = gfx->GetDevice();
-		HRESULT hr = device->CreateCommandAllocator(cmd_list_type, IID_PPV_ARGS(cmd_allocator.GetAddressOf()));
-		GFX_CHECK_HR(hr);
-
-		hr = device->CreateCommandList(0, cmd_list_type, cmd_allocator, nullptr, IID_PPV_ARGS(cmd_list.GetAddressOf()));
+		cmd_allocator = cmd_queue.GetAllocatorPool().Acquire(0);
+		HRESULT hr = device->CreateCommandList(0, cmd_list_type, cmd_allocator, nullptr, IID_PPV_ARGS(cmd_list.GetAddressOf()));
 		GFX_CHECK_HR(hr);
 
 		cmd_list->SetName(ToWideString(name).c_str());
 		cmd_list->Close();
 	}
 
-	GfxCommandList::~GfxCommandList(){}
+	GfxCommandList::~GfxCommandList()
+	{
+		if (cmd_allocator) cmd_queue.GetAllocatorPool().Release(std::move(cmd_allocator), cmd_queue.GetLastSubmissionValue(), command_count);
+	}
 
+	//an allocator still held by the list was never submitted, one that was submitted is replaced by a completed one from the pool
 	void GfxCommandList::ResetAllocator()
 	{
-		cmd_allocator->Reset();
+		if (cmd_allocator) GFX_CHECK_HR(cmd_allocator->Reset());
+		else cmd_allocator = cmd_queue.GetAllocatorPool().Acquire(last_command_count);
+	}
+
+	void GfxCommandList::ReleaseAllocator(Uint64 fence_value)
+	{
+		last_command_count = command_count;
+		cmd_queue.GetAllocatorPool().Release(std::move(cmd_allocator), fence_value, command_count);
 	}
 
 	void GfxCommandList::Begin()
 	{
+		if (!cmd_allocator) cmd_allocator = cmd_queue.GetAllocatorPool().Acquire(last_command_count);
 		cmd_list->Reset(cmd_allocator.Get(), nullptr);
 		ResetState();
 	}
@@ -198,8 +230,9 @@ namespace adria
 		current_pso = nullptr;
 		current_render_pass = nullptr;
 		current_state_object = nullptr;
-		current_rt_table.reset();
+		current_rt_table = nullptr;
 		current_context = Context::Invalid;
+		InvalidateStateCache();
 
 		if (type == GfxCommandListType::Graphics || type == GfxCommandListType::Compute)
 		{
@@ -216,10 +249,16 @@ namespace adria
 		}
 	}
 
+	void GfxCommandList::InvalidateStateCache()
+	{
+		*state_cache = StateCache{};
+	}
+
 	void GfxCommandList::BeginQuery(GfxQueryHeap& query_heap, Uint32 index)
 	{
 		D3D12_QUERY_TYPE d3d12_query_type = ToD3D12QueryType(query_heap.GetDesc().type);
-		cmd_list->EndQuery(query_heap, d3d12_query_type, index);
+		if (d3d12_query_type == D3D12_QUERY_TYPE_TIMESTAMP) cmd_list->EndQuery(query_heap, d3d12_query_type, index);
+		else cmd_list->BeginQuery(query_heap, d3d12_query_type, index);
 	}
 
 	void GfxCommandList::EndQuery(GfxQueryHeap& query_heap, Uint32 index)
@@ -275,6 +314,15 @@ namespace adria
 		++command_count;
 	}
 
+	void GfxCommandList::MultiDrawIndexedIndirect(GfxBuffer const& buffer, Uint32 offset, Uint32 draw_count)
+	{
+		ADRIA_ASSERT(current_context == Context::Graphics);
+		cmd_list->ExecuteIndirect(gfx->GetDrawIndexedRootConstantIndirectSignature(), draw_count, buffer.GetNative(), offset, nullptr, 0);
+		++command_count;
+		//the signature writes the first dword of root constant slot 1, the cached value no longer matches
+		GetRootArgumentCache().constants_valid_mask[1] &= ~1ull;
+	}
+
 	void GfxCommandList::DispatchIndirect(GfxBuffer const& buffer, Uint32 offset)
 	{
 		ADRIA_ASSERT(current_context == Context::Compute);
@@ -295,16 +343,59 @@ namespace adria
 		dispatch_desc.Width = dispatch_width;
 		dispatch_desc.Height = dispatch_height;
 		dispatch_desc.Depth = dispatch_depth;
-		current_rt_table->Commit(*gfx->GetDynamicAllocator(), dispatch_desc);
+		current_rt_table->Commit(this, dispatch_desc);
 		cmd_list->DispatchRays(&dispatch_desc);
 	}
 
-	void GfxCommandList::TextureBarrier(GfxTexture const& texture, GfxResourceState flags_before, GfxResourceState flags_after, Uint32 subresource)
+	void GfxCommandList::DispatchRaysIndirect(GfxBuffer const& buffer, Uint32 offset)
+	{
+		//the gpu only writes the dispatch dimensions, shader table addresses live in per frame memory and are patched in here
+		D3D12_DISPATCH_RAYS_DESC dispatch_desc{};
+		current_rt_table->Commit(this, dispatch_desc);
+
+		static constexpr Uint32 TableDwordCount = offsetof(D3D12_DISPATCH_RAYS_DESC, Width) / sizeof(Uint32);
+		Uint32 table_dwords[TableDwordCount];
+		memcpy(table_dwords, &dispatch_desc, sizeof(table_dwords));
+		D3D12_WRITEBUFFERIMMEDIATE_PARAMETER params[TableDwordCount];
+		for (Uint32 i = 0; i < TableDwordCount; ++i)
+		{
+			params[i].Dest = buffer.GetGpuAddress() + offset + i * sizeof(Uint32);
+			params[i].Value = table_dwords[i];
+		}
+
+		BufferBarrier(buffer, GfxResourceState::IndirectArgs, GfxResourceState::CopyDst);
+		FlushBarriers();
+		cmd_list->WriteBufferImmediate(TableDwordCount, params, nullptr);
+		BufferBarrier(buffer, GfxResourceState::CopyDst, GfxResourceState::IndirectArgs);
+		FlushBarriers();
+		cmd_list->ExecuteIndirect(gfx->GetDispatchRaysIndirectSignature(), 1, buffer.GetNative(), offset, nullptr, 0);
+		++command_count;
+	}
+
+	void GfxCommandList::DispatchGraph(void const* records, Uint32 record_count, Uint32 record_stride)
+	{
+		ADRIA_ASSERT(current_context == Context::Compute);
+		D3D12_DISPATCH_GRAPH_DESC dispatch_desc{};
+		dispatch_desc.Mode = D3D12_DISPATCH_MODE_NODE_CPU_INPUT;
+		dispatch_desc.NodeCPUInput.EntrypointIndex = 0;
+		dispatch_desc.NodeCPUInput.NumRecords = record_count;
+		dispatch_desc.NodeCPUInput.pRecords = records;
+		dispatch_desc.NodeCPUInput.RecordStrideInBytes = record_stride;
+
+		Ref<ID3D12GraphicsCommandList10> cmd_list10;
+		GFX_CHECK_HR(cmd_list.As(&cmd_list10));
+		cmd_list10->DispatchGraph(&dispatch_desc);
+		++command_count;
+	}
+
+	void GfxCommandList::TextureBarrier(GfxTexture const& texture, GfxResourceState flags_before, GfxResourceState flags_after, Uint32 subresource, GfxBarrierSplit split)
 	{
 		if (use_legacy_barriers)
 		{
-			if (flags_before == GfxResourceState::ComputeUAV && flags_after == GfxResourceState::ComputeUAV)
+			if ((flags_before == GfxResourceState::ComputeUAV && flags_after == GfxResourceState::ComputeUAV) ||
+				(flags_before == GfxResourceState::ASWrite && HasAnyFlag(flags_after, GfxResourceState::AllAS)))
 			{
+				if (split == GfxBarrierSplit::Begin) return;
 				D3D12_RESOURCE_BARRIER barrier{};
 				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
 				barrier.UAV.pResource = texture.GetNative();
@@ -318,6 +409,7 @@ namespace adria
 				barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
 				barrier.Transition.StateBefore = ToD3D12LegacyResourceState(flags_before);
 				barrier.Transition.StateAfter = ToD3D12LegacyResourceState(flags_after);
+				barrier.Flags = ToD3D12BarrierFlags(split);
 				legacy_barriers.push_back(barrier);
 			}
 		}
@@ -332,18 +424,21 @@ namespace adria
 			barrier.LayoutAfter = ToD3D12BarrierLayout(flags_after);
 			barrier.pResource = texture.GetNative();
 			barrier.Subresources = CD3DX12_BARRIER_SUBRESOURCE_RANGE(subresource);
+			ApplyBarrierSplit(barrier, split);
 
 			if (HasAnyFlag(flags_before, GfxResourceState::Discard)) barrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_DISCARD;
 			texture_barriers.push_back(barrier);
 		}
 	}
 
-	void GfxCommandList::BufferBarrier(GfxBuffer const& buffer, GfxResourceState flags_before, GfxResourceState flags_after)
+	void GfxCommandList::BufferBarrier(GfxBuffer const& buffer, GfxResourceState flags_before, GfxResourceState flags_after, GfxBarrierSplit split)
 	{
 		if (use_legacy_barriers)
 		{
-			if (flags_before == GfxResourceState::ComputeUAV && flags_after == GfxResourceState::ComputeUAV)
+			if ((flags_before == GfxResourceState::ComputeUAV && flags_after == GfxResourceState::ComputeUAV) ||
+				(flags_before == GfxResourceState::ASWrite && HasAnyFlag(flags_after, GfxResourceState::AllAS)))
 			{
+				if (split == GfxBarrierSplit::Begin) return;
 				D3D12_RESOURCE_BARRIER barrier{};
 				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
 				barrier.UAV.pResource = buffer.GetNative();
@@ -357,6 +452,7 @@ namespace adria
 				barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
 				barrier.Transition.StateBefore = ToD3D12LegacyResourceState(flags_before);
 				barrier.Transition.StateAfter = ToD3D12LegacyResourceState(flags_after);
+				barrier.Flags = ToD3D12BarrierFlags(split);
 				legacy_barriers.push_back(barrier);
 			}
 		}
@@ -370,6 +466,7 @@ namespace adria
 			barrier.pResource = buffer.GetNative();
 			barrier.Offset = 0;
 			barrier.Size = UINT64_MAX;
+			ApplyBarrierSplit(barrier, split);
 
 			buffer_barriers.push_back(barrier);
 		}
@@ -379,7 +476,8 @@ namespace adria
 	{
 		if (use_legacy_barriers)
 		{
-			if (flags_before == GfxResourceState::ComputeUAV && flags_after == GfxResourceState::ComputeUAV)
+			if ((flags_before == GfxResourceState::ComputeUAV && flags_after == GfxResourceState::ComputeUAV) ||
+				(flags_before == GfxResourceState::ASWrite && HasAnyFlag(flags_after, GfxResourceState::AllAS)))
 			{
 				D3D12_RESOURCE_BARRIER barrier{};
 				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
@@ -402,12 +500,49 @@ namespace adria
 		}
 	}
 
+	void GfxCommandList::AliasingBarrier(GfxTexture const* texture_before, GfxTexture const& texture_after, GfxResourceState flags_after)
+	{
+		GfxResourceState const initial_state = texture_after.GetDesc().initial_state;
+		if (use_legacy_barriers)
+		{
+			D3D12_RESOURCE_BARRIER barrier{};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			barrier.Aliasing.pResourceBefore = texture_before ? texture_before->GetNative() : nullptr;
+			barrier.Aliasing.pResourceAfter = texture_after.GetNative();
+			legacy_barriers.push_back(barrier);
+			if (initial_state != flags_after) TextureBarrier(texture_after, initial_state, flags_after);
+
+			GfxBindFlag const bind_flags = texture_after.GetDesc().bind_flags;
+			if (HasAnyFlag(bind_flags, GfxBindFlag::RenderTarget | GfxBindFlag::DepthStencil) && HasAnyFlag(flags_after, GfxResourceState::RTV | GfxResourceState::DSV))
+			{
+				FlushBarriers();
+				cmd_list->DiscardResource(texture_after.GetNative(), nullptr);
+				++command_count;
+			}
+		}
+		else
+		{
+			D3D12_TEXTURE_BARRIER barrier{};
+			barrier.SyncBefore = D3D12_BARRIER_SYNC_ALL;
+			barrier.SyncAfter = ToD3D12BarrierSync(flags_after);
+			barrier.AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS;
+			barrier.AccessAfter = ToD3D12BarrierAccess(flags_after);
+			barrier.LayoutBefore = D3D12_BARRIER_LAYOUT_UNDEFINED;
+			barrier.LayoutAfter = ToD3D12BarrierLayout(flags_after);
+			barrier.pResource = texture_after.GetNative();
+			barrier.Subresources = CD3DX12_BARRIER_SUBRESOURCE_RANGE(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+			barrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_DISCARD;
+			texture_barriers.push_back(barrier);
+		}
+	}
+
 	void GfxCommandList::FlushBarriers()
 	{
 		if (use_legacy_barriers)
 		{
 			if (!legacy_barriers.empty())
 			{
+				TracyGfxBarrierBatch(type, cmd_list.Get(), (Uint32)legacy_barriers.size());
 				cmd_list->ResourceBarrier((Uint32)legacy_barriers.size(), legacy_barriers.data());
 				legacy_barriers.clear();
 				++command_count;
@@ -435,6 +570,7 @@ namespace adria
 
 			if (!barrier_groups.empty())
 			{
+				TracyGfxBarrierBatch(type, cmd_list.Get(), (Uint32)(texture_barriers.size() + buffer_barriers.size() + global_barriers.size()));
 				cmd_list->Barrier((Uint32)barrier_groups.size(), barrier_groups.data());
 				++command_count;
 			}
@@ -529,12 +665,25 @@ namespace adria
 		++command_count;
 	}
 
-	void GfxCommandList::WriteBufferImmediate(GfxBuffer& buffer, Uint32 offset, Uint32 data)
+	void GfxCommandList::SetPredication(GfxBuffer const* buffer, Uint64 offset, GfxPredicationOp op)
+	{
+		ADRIA_ASSERT(offset % sizeof(Uint64) == 0);
+		D3D12_PREDICATION_OP const predication_op = op == GfxPredicationOp::EqualZero ? D3D12_PREDICATION_OP_EQUAL_ZERO : D3D12_PREDICATION_OP_NOT_EQUAL_ZERO;
+		cmd_list->SetPredication(buffer ? buffer->GetNative() : nullptr, buffer ? offset : 0, predication_op);
+	}
+
+	void GfxCommandList::WriteBufferImmediate(GfxBuffer& buffer, Uint32 offset, Uint32 data, GfxWriteBufferImmediateMode mode)
 	{
 		D3D12_WRITEBUFFERIMMEDIATE_PARAMETER parameter{};
 		parameter.Dest = buffer.GetGpuAddress() + offset;
 		parameter.Value = data;
-		cmd_list->WriteBufferImmediate(1, &parameter, nullptr);
+		D3D12_WRITEBUFFERIMMEDIATE_MODE write_mode = D3D12_WRITEBUFFERIMMEDIATE_MODE_DEFAULT;
+		switch (mode)
+		{
+		case GfxWriteBufferImmediateMode::MarkerIn:  write_mode = D3D12_WRITEBUFFERIMMEDIATE_MODE_MARKER_IN; break;
+		case GfxWriteBufferImmediateMode::MarkerOut: write_mode = D3D12_WRITEBUFFERIMMEDIATE_MODE_MARKER_OUT; break;
+		}
+		cmd_list->WriteBufferImmediate(1, &parameter, &write_mode);
 		++command_count;
 	}
 
@@ -641,11 +790,30 @@ namespace adria
 			current_state_object = state_object->d3d12_so;
 			cmd_list->SetPipelineState1(state_object->d3d12_so.Get());
 			current_context = state_object->d3d12_so ? Context::Compute : Context::Invalid;
-			current_rt_table = std::make_unique<GfxRayTracingShaderTable>(state_object);
+			current_rt_table = &state_object->GetShaderTable();
 		}
 		return *current_rt_table;
 	}
 
+	void GfxCommandList::SetWorkGraph(GfxStateObject* state_object, Wchar const* program_name, GfxBuffer const& backing_memory, Bool initialize_backing_memory)
+	{
+		D3D12_SET_PROGRAM_DESC program_desc{};
+		program_desc.Type = D3D12_PROGRAM_TYPE_WORK_GRAPH;
+		program_desc.WorkGraph.ProgramIdentifier = state_object->GetProgramIdentifier(program_name);
+		program_desc.WorkGraph.Flags = initialize_backing_memory ? D3D12_SET_WORK_GRAPH_FLAG_INITIALIZE : D3D12_SET_WORK_GRAPH_FLAG_NONE;
+		program_desc.WorkGraph.BackingMemory.StartAddress = backing_memory.GetGpuAddress();
+		program_desc.WorkGraph.BackingMemory.SizeInBytes = backing_memory.GetSize();
+
+		Ref<ID3D12GraphicsCommandList10> cmd_list10;
+		GFX_CHECK_HR(cmd_list.As(&cmd_list10));
+		cmd_list10->SetProgram(&program_desc);
+
+		//SetProgram replaces the bound pipeline, force the next SetPipelineState/SetStateObject to rebind
+		current_pso = nullptr;
+		current_state_object = nullptr;
+		current_context = Context::Compute;
+	}
+
 	void GfxCommandList::SetStencilReference(Uint8 stencil)
 	{
 		cmd_list->OMSetStencilRef(stencil);
@@ -658,6 +826,8 @@ namespace adria
 
 	void GfxCommandList::SetTopology(GfxPrimitiveTopology topology)
 	{
+		if (topology == state_cache->topology) return;
+		state_cache->topology = topology;
 		cmd_list->IASetPrimitiveTopology(ToD3D12PrimitiveTopology(topology));
 	}
 
@@ -671,10 +841,18 @@ namespace adria
 			ibv.BufferLocation = index_buffer_view->buffer_location;
 			ibv.SizeInBytes = index_buffer_view->size_in_bytes;
 			ibv.Format = ConvertGfxFormat(index_buffer_view->format);
+
+			D3D12_INDEX_BUFFER_VIEW const& cached_ibv = state_cache->index_buffer_view;
+			if (state_cache->index_buffer_valid && cached_ibv.BufferLocation == ibv.BufferLocation &&
+				cached_ibv.SizeInBytes == ibv.SizeInBytes && cached_ibv.Format == ibv.Format) return;
+
+			state_cache->index_buffer_view = ibv;
+			state_cache->index_buffer_valid = true;
 			cmd_list->IASetIndexBuffer(&ibv);
 		}
 		else
 		{
+			state_cache->index_buffer_valid = false;
 			cmd_list->IASetIndexBuffer(nullptr);
 		}
 	}
@@ -707,7 +885,12 @@ namespace adria
 		ADRIA_ASSERT(current_context == Context::Graphics);
 
 		D3D12_VIEWPORT vp = { (Float)x, (Float)y, (Float)width, (Float)height, 0.0f, 1.0f };
-		cmd_list->RSSetViewports(1, &vp);
+		if (!state_cache->viewport_valid || memcmp(&state_cache->viewport, &vp, sizeof(vp)) != 0)
+		{
+			state_cache->viewport = vp;
+			state_cache->viewport_valid = true;
+			cmd_list->RSSetViewports(1, &vp);
+		}
 		SetScissorRect(x, y, width, height);
 	}
 
@@ -716,6 +899,9 @@ namespace adria
 		ADRIA_ASSERT(current_context == Context::Graphics);
 
 		D3D12_RECT rect = { (LONG)x, (LONG)y, LONG(x + width), LONG(y + height) };
+		if (state_cache->scissor_rect_valid && memcmp(&state_cache->scissor_rect, &rect, sizeof(rect)) == 0) return;
+		state_cache->scissor_rect = rect;
+		state_cache->scissor_rect_valid = true;
 		cmd_list->RSSetScissorRects(1, &rect);
 	}
 
@@ -785,6 +971,15 @@ namespace adria
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
 
+		if (slot < MAX_CACHED_ROOT_PARAMETERS && offset < MAX_CACHED_ROOT_CONSTANTS)
+		{
+			RootArgumentCache& cache = GetRootArgumentCache();
+			Uint64 const bit = 1ull << offset;
+			if ((cache.constants_valid_mask[slot] & bit) && cache.constants[slot][offset] == data) return;
+			cache.constants[slot][offset] = data;
+			cache.constants_valid_mask[slot] |= bit;
+		}
+
 		if (current_context == Context::Graphics)
 		{
 			cmd_list->SetGraphicsRoot32BitConstant(slot, data, offset);
@@ -799,6 +994,17 @@ namespace adria
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
 
+		Uint32 const count = data_size / sizeof(Uint32);
+		if (slot < MAX_CACHED_ROOT_PARAMETERS && count > 0 && offset + count <= MAX_CACHED_ROOT_CONSTANTS)
+		{
+			RootArgumentCache& cache = GetRootArgumentCache();
+			Uint64 const range_mask = (count == 64 ? ~0ull : ((1ull << count) - 1)) << offset;
+			Uint32* cached_constants = cache.constants[slot].data() + offset;
+			if ((cache.constants_valid_mask[slot] & range_mask) == range_mask && memcmp(cached_constants, data, count * sizeof(Uint32)) == 0) return;
+			memcpy(cached_constants, data, count * sizeof(Uint32));
+			cache.constants_valid_mask[slot] |= range_mask;
+		}
+
 		if (current_context == Context::Graphics)
 		{
 			cmd_list->SetGraphicsRoot32BitConstants(slot, data_size / sizeof(Uint32), data, offset);
@@ -813,22 +1019,31 @@ namespace adria
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
 
+		//identical data for the slot keeps pointing at the previous allocation, which stays alive until the end of the frame
+		Bool const cacheable = slot < MAX_CACHED_ROOT_PARAMETERS && data_size <= MAX_CACHED_ROOT_CBV_SIZE;
+		if (cacheable)
+		{
+			RootArgumentCache& cache = GetRootArgumentCache();
+			if (cache.cbv_data_size[slot] == data_size && memcmp(cache.cbv_data[slot].data(), data, data_size) == 0) return;
+		}
+
 		auto dynamic_allocator = gfx->GetDynamicAllocator();
 		GfxDynamicAllocation alloc = dynamic_allocator->Allocate(data_size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
 		alloc.Update(data, data_size);
 
-		if (current_context == Context::Graphics)
-		{
-			cmd_list->SetGraphicsRootConstantBufferView(slot, alloc.gpu_address);
-		}
-		else
+		SetRootCBV(slot, alloc.gpu_address);
+		if (cacheable)
 		{
-			cmd_list->SetComputeRootConstantBufferView(slot, alloc.gpu_address);
+			RootArgumentCache& cache = GetRootArgumentCache();
+			memcpy(cache.cbv_data[slot].data(), data, data_size);
+			cache.cbv_data_size[slot] = (Uint32)data_size;
 		}
 	}
 
 	void GfxCommandList::SetRootCBV(Uint32 slot, Uint64 gpu_address)
 	{
+		if (!SetCachedRootDescriptor(slot, gpu_address)) return;
+
 		if (current_context == Context::Graphics)
 		{
 			cmd_list->SetGraphicsRootConstantBufferView(slot, gpu_address);
@@ -842,6 +1057,7 @@ namespace adria
 	void GfxCommandList::SetRootSRV(Uint32 slot, Uint64 gpu_address)
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
+		if (!SetCachedRootDescriptor(slot, gpu_address)) return;
 
 		if (current_context == Context::Graphics)
 		{
@@ -856,6 +1072,7 @@ namespace adria
 	void GfxCommandList::SetRootUAV(Uint32 slot, Uint64 gpu_address)
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
+		if (!SetCachedRootDescriptor(slot, gpu_address)) return;
 
 		if (current_context == Context::Graphics)
 		{
@@ -869,6 +1086,9 @@ namespace adria
 
 	void GfxCommandList::SetRootDescriptorTable(Uint32 slot, GfxDescriptor base_descriptor)
 	{
+		D3D12_GPU_DESCRIPTOR_HANDLE const handle = base_descriptor;
+		if (!SetCachedRootDescriptor(slot, handle.ptr)) return;
+
 		if (current_context == Context::Graphics)
 		{
 			cmd_list->SetGraphicsRootDescriptorTable(slot, base_descriptor);
@@ -896,6 +1116,12 @@ namespace adria
 		cmd_list->ClearDepthStencilView(dsv, d3d12_clear_flags, depth, stencil, 0, nullptr);
 	}
 
+	void GfxCommandList::ClearDepth(GfxDescriptor dsv, Uint32 x, Uint32 y, Uint32 width, Uint32 height, Float depth /*= 1.0f*/)
+	{
+		D3D12_RECT rect = { (LONG)x, (LONG)y, LONG(x + width), LONG(y + height) };
+		cmd_list->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 1, &rect);
+	}
+
 	void GfxCommandList::SetRenderTargets(std::span<GfxDescriptor const> rtvs, GfxDescriptor const* dsv /*= nullptr*/, Bool single_rt /*= false*/)
 	{
 		D3D12_CPU_DESCRIPTOR_HANDLE* d3d12_dsv = nullptr;
@@ -914,5 +1140,21 @@ namespace adria
 		current_context = ctx;
 	}
 
+	GfxCommandList::RootArgumentCache& GfxCommandList::GetRootArgumentCache()
+	{
+		return current_context == Context::Graphics ? state_cache->graphics_root_arguments : state_cache->compute_root_arguments;
+	}
+
+	Bool GfxCommandList::SetCachedRootDescriptor(Uint32 slot, Uint64 gpu_address)
+	{
+		if (slot >= MAX_CACHED_ROOT_PARAMETERS) return true;
+
+		RootArgumentCache& cache = GetRootArgumentCache();
+		cache.cbv_data_size[slot] = 0;
+		if (gpu_address != 0 && cache.descriptors[slot] == gpu_address) return false;
+		cache.descriptors[slot] = gpu_address;
+		return true;
+	}
+
 }
 
@@ -29,8 +29,32 @@ namespace adria
 		Copy
 	};
 
+	enum class GfxWriteBufferImmediateMode : Uint8
+	{
+		Default,
+		MarkerIn,
+		MarkerOut
+	};
+
+	enum class GfxBarrierSplit : Uint8
+	{
+		None,
+		Begin,
+		End
+	};
+
+	enum class GfxPredicationOp : Uint8
+	{
+		EqualZero,
+		NotEqualZero
+	};
+
 	class GfxCommandList
 	{
+		static constexpr Uint32 MAX_CACHED_ROOT_PARAMETERS = 8;
+		static constexpr Uint32 MAX_CACHED_ROOT_CONSTANTS = 64;
+		static constexpr Uint32 MAX_CACHED_ROOT_CBV_SIZE = 256;
+
 	public:
 		enum class Context
 		{
@@ -46,8 +70,10 @@ namespace adria
 		GfxDevice* GetDevice() const { return gfx; }
 		ID3D12GraphicsCommandList6* GetNative() const { return cmd_list.Get(); }
 		GfxCommandQueue& GetQueue() const { return cmd_queue; }
+		GfxCommandListType GetType() const { return type; }
 
 		void ResetAllocator();
+		void ReleaseAllocator(Uint64 fence_value);
 		void Begin();
 		void End();
 		void Wait(GfxFence& fence, Uint64 value);
@@ -56,6 +82,9 @@ namespace adria
 		void Submit();
 		void SignalAll();
 		void ResetState();
+		void InvalidateStateCache();
+		Bool HasPendingWaits() const { return !pending_waits.empty(); }
+		Bool HasPendingSignals() const { return !pending_signals.empty(); }
 
 		void BeginQuery(GfxQueryHeap& query_heap, Uint32 index);
 		void EndQuery(GfxQueryHeap& query_heap, Uint32 index);
@@ -67,15 +96,22 @@ namespace adria
 		void DispatchMesh(Uint32 group_count_x, Uint32 group_count_y, Uint32 group_count_z = 1);
 		void DrawIndirect(GfxBuffer const& buffer, Uint32 offset);
 		void DrawIndexedIndirect(GfxBuffer const& buffer, Uint32 offset);
+		void MultiDrawIndexedIndirect(GfxBuffer const& buffer, Uint32 offset, Uint32 draw_count);
 		void DispatchIndirect(GfxBuffer const& buffer, Uint32 offset);
 		void DispatchMeshIndirect(GfxBuffer const& buffer, Uint32 offset);
 		void DispatchRays(Uint32 dispatch_width, Uint32 dispatch_height, Uint32 dispatch_depth = 1);
+		void DispatchRaysIndirect(GfxBuffer const& buffer, Uint32 offset);
+		void DispatchGraph(void const* records, Uint32 record_count, Uint32 record_stride);
 
-		void TextureBarrier(GfxTexture const& texture, GfxResourceState flags_before, GfxResourceState flags_after, Uint32 subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
-		void BufferBarrier(GfxBuffer const& buffer, GfxResourceState flags_before, GfxResourceState flags_after);
+		void TextureBarrier(GfxTexture const& texture, GfxResourceState flags_before, GfxResourceState flags_after, Uint32 subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, GfxBarrierSplit split = GfxBarrierSplit::None);
+		void BufferBarrier(GfxBuffer const& buffer, GfxResourceState flags_before, GfxResourceState flags_after, GfxBarrierSplit split = GfxBarrierSplit::None);
 		void GlobalBarrier(GfxResourceState flags_before, GfxResourceState flags_after);
+		void AliasingBarrier(GfxTexture const* texture_before, GfxTexture const& texture_after, GfxResourceState flags_after);
 		void FlushBarriers();
 
+		//draws, dispatches, copies and clears are skipped while the Uint64 at offset satisfies op, a null buffer disables predication
+		void SetPredication(GfxBuffer const* buffer, Uint64 offset = 0, GfxPredicationOp op = GfxPredicationOp::EqualZero);
+
 		void CopyBuffer(GfxBuffer& dst, GfxBuffer const& src);
 		void CopyBuffer(GfxBuffer& dst, Uint64 dst_offset, GfxBuffer const& src, Uint64 src_offset, Uint64 size);
 		void CopyTexture(GfxTexture& dst, GfxTexture const& src);
@@ -86,13 +122,14 @@ namespace adria
 		void ClearUAV(GfxTexture const& resource, GfxDescriptor uav, GfxDescriptor uav_cpu, const Float* clear_value);
 		void ClearUAV(GfxBuffer const& resource, GfxDescriptor uav, GfxDescriptor uav_cpu, const Uint32* clear_value);
 		void ClearUAV(GfxTexture const& resource, GfxDescriptor uav, GfxDescriptor uav_cpu, const Uint32* clear_value);
-		void WriteBufferImmediate(GfxBuffer& buffer, Uint32 offset, Uint32 data);
+		void WriteBufferImmediate(GfxBuffer& buffer, Uint32 offset, Uint32 data, GfxWriteBufferImmediateMode mode = GfxWriteBufferImmediateMode::Default);
 
 		void BeginRenderPass(GfxRenderPassDesc const& render_pass_desc);
 		void EndRenderPass();
 
 		void SetPipelineState(GfxPipelineState* state);
 		GfxRayTracingShaderTable& SetStateObject(GfxStateObject* state_object);
+		void SetWorkGraph(GfxStateObject* state_object, Wchar const* program_name, GfxBuffer const& backing_memory, Bool initialize_backing_memory);
 
 		void SetStencilReference(Uint8 stencil);
 		void SetBlendFactor(Float const* blend_factor);
@@ -131,6 +168,7 @@ namespace adria
 
 		void ClearRenderTarget(GfxDescriptor rtv, Float const* clear_color);
 		void ClearDepth(GfxDescriptor dsv, Float depth = 1.0f, Uint8 stencil = 0, Bool clear_stencil = false);
+		void ClearDepth(GfxDescriptor dsv, Uint32 x, Uint32 y, Uint32 width, Uint32 height, Float depth = 1.0f);
 		void SetRenderTargets(std::span<GfxDescriptor const> rtvs, GfxDescriptor const* dsv = nullptr, Bool single_rt = false);
 
 		void SetContext(Context ctx);
@@ -143,14 +181,38 @@ namespace adria
 		Ref<ID3D12CommandAllocator> cmd_allocator = nullptr;
 
 		Uint32 command_count = 0;
+		Uint32 last_command_count = 0;
 		GfxPipelineState* current_pso = nullptr;
 		GfxRenderPassDesc const* current_render_pass = nullptr;
 
 		ID3D12StateObject* current_state_object = nullptr;
-		std::unique_ptr<GfxRayTracingShaderTable> current_rt_table;
+		GfxRayTracingShaderTable* current_rt_table = nullptr;
 
 		Context current_context = Context::Invalid;
 
+		//last values sent to the native command list, used to skip redundant binds
+		struct RootArgumentCache
+		{
+			std::array<Uint64, MAX_CACHED_ROOT_PARAMETERS> descriptors{};
+			std::array<std::array<Uint32, MAX_CACHED_ROOT_CONSTANTS>, MAX_CACHED_ROOT_PARAMETERS> constants{};
+			std::array<Uint64, MAX_CACHED_ROOT_PARAMETERS> constants_valid_mask{};
+			std::array<std::array<Uint8, MAX_CACHED_ROOT_CBV_SIZE>, MAX_CACHED_ROOT_PARAMETERS> cbv_data{};
+			std::array<Uint32, MAX_CACHED_ROOT_PARAMETERS> cbv_data_size{};
+		};
+		struct StateCache
+		{
+			GfxPrimitiveTopology topology = GfxPrimitiveTopology::Undefined;
+			D3D12_INDEX_BUFFER_VIEW index_buffer_view{};
+			Bool index_buffer_valid = false;
+			D3D12_VIEWPORT viewport{};
+			Bool viewport_valid = false;
+			D3D12_RECT scissor_rect{};
+			Bool scissor_rect_valid = false;
+			RootArgumentCache graphics_root_arguments;
+			RootArgumentCache compute_root_arguments;
+		};
+		std::unique_ptr<StateCache> state_cache;
+
 		std::vector<std::pair<GfxFence&, Uint64>> pending_waits;
 		std::vector<std::pair<GfxFence&, Uint64>> pending_signals;
 
@@ -159,5 +221,9 @@ namespace adria
 		std::vector<D3D12_BUFFER_BARRIER>		  buffer_barriers;
 		std::vector<D3D12_GLOBAL_BARRIER>		  global_barriers;
 		std::vector<D3D12_RESOURCE_BARRIER>		  legacy_barriers;
+
+	private:
+		RootArgumentCache& GetRootArgumentCache();
+		Bool SetCachedRootDescriptor(Uint32 slot, Uint64 gpu_address);
 	};
 }
\ No newline at end of file
@@ -20,7 +20,15 @@ namespace adria
 
 	GfxCommandList* GfxCommandListPool::AllocateCmdList()
 	{
-		cmd_lists.push_back(std::make_unique<GfxCommandList>(gfx, type));
+		if (!free_cmd_lists.empty())
+		{
+			cmd_lists.push_back(std::move(free_cmd_lists.back()));
+			free_cmd_lists.pop_back();
+		}
+		else
+		{
+			cmd_lists.push_back(std::make_unique<GfxCommandList>(gfx, type));
+		}
 		cmd_lists.back()->ResetAllocator();
 		cmd_lists.back()->Begin();
 		return cmd_lists.back().get();
@@ -40,16 +48,26 @@ namespace adria
 
 	void GfxCommandListPool::BeginCmdLists()
 	{
-		for (auto& cmd_list : cmd_lists)
+		while (cmd_lists.size() > 1)
 		{
-			cmd_list->ResetAllocator();
-			cmd_list->Begin();
+			free_cmd_lists.push_back(std::move(cmd_lists.back()));
+			cmd_lists.pop_back();
 		}
+		GfxCommandList* main_cmd_list = GetMainCmdList();
+		main_cmd_list->ResetAllocator();
+		main_cmd_list->Begin();
 	}
 	void GfxCommandListPool::EndCmdLists()
 	{
 		for (auto& cmd_list : cmd_lists) cmd_list->End();
 	}
+	//submitted lists gave their allocators back to the queue's pool, so they are free for reuse right away
+	void GfxCommandListPool::RetireCmdLists()
+	{
+		for (auto& cmd_list : cmd_lists) free_cmd_lists.push_back(std::move(cmd_list));
+		cmd_lists.clear();
+		AllocateCmdList();
+	}
 
 	GfxGraphicsCommandListPool::GfxGraphicsCommandListPool(GfxDevice* gfx) : GfxCommandListPool(gfx, GfxCommandListType::Graphics)
 	{
@@ -25,6 +25,7 @@ namespace adria
 
 		void BeginCmdLists();
 		void EndCmdLists();
+		void RetireCmdLists();
 
 	protected:
 		GfxCommandListPool(GfxDevice* gfx, GfxCommandListType type);
@@ -33,6 +34,7 @@ namespace adria
 		GfxDevice* gfx;
 		GfxCommandListType const type;
 		std::vector<std::unique_ptr<GfxCommandList>> cmd_lists;
+		std::vector<std::unique_ptr<GfxCommandList>> free_cmd_lists;
 	};
 
 	class GfxGraphicsCommandListPool : public GfxCommandListPool
@@ -2,10 +2,14 @@
 #include "GfxDevice.h"
 #include "GfxCommandList.h"
 #include "GfxCommandListPool.h"
+#include "GfxCommandAllocatorPool.h"
 #include "Utilities/StringUtil.h"
 
 namespace adria
 {
+	GfxCommandQueue::GfxCommandQueue() = default;
+	GfxCommandQueue::~GfxCommandQueue() = default;
+
 	Bool GfxCommandQueue::Create(GfxDevice* gfx, GfxCommandListType type, Char const* name)
 	{
 		ID3D12Device* device = gfx->GetDevice();
@@ -31,6 +35,9 @@ namespace adria
 		if (FAILED(hr)) return false;
 		command_queue->SetName(ToWideString(name).c_str());
 		if(type != GfxCommandListType::Copy) command_queue->GetTimestampFrequency(&timestamp_frequency);
+
+		if (!submission_fence.Create(gfx, (std::string(name) + " Submission Fence").c_str())) return false;
+		allocator_pool = std::make_unique<GfxCommandAllocatorPool>(gfx, queue_desc.Type, submission_fence);
 		return true;
 	}
 
@@ -38,13 +45,34 @@ namespace adria
 	{
 		if (cmd_lists.empty()) return;
 
-		for (GfxCommandList* cmd_list : cmd_lists) cmd_list->WaitAll();
+		std::vector<ID3D12CommandList*> d3d12_cmd_lists;
+		d3d12_cmd_lists.reserve(cmd_lists.size());
+		auto ExecutePendingCommandLists = [&]()
+			{
+				if (d3d12_cmd_lists.empty()) return;
+				command_queue->ExecuteCommandLists((Uint32)d3d12_cmd_lists.size(), d3d12_cmd_lists.data());
+				d3d12_cmd_lists.clear();
+			};
 
-		std::vector<ID3D12CommandList*> d3d12_cmd_lists(cmd_lists.size());
-		for (Uint64 i = 0; i < d3d12_cmd_lists.size(); ++i) d3d12_cmd_lists[i] = cmd_lists[i]->GetNative();
-		command_queue->ExecuteCommandLists((Uint32)d3d12_cmd_lists.size(), d3d12_cmd_lists.data());
+		for (GfxCommandList* cmd_list : cmd_lists)
+		{
+			if (cmd_list->HasPendingWaits())
+			{
+				ExecutePendingCommandLists();
+				cmd_list->WaitAll();
+			}
+			d3d12_cmd_lists.push_back(cmd_list->GetNative());
+			if (cmd_list->HasPendingSignals())
+			{
+				ExecutePendingCommandLists();
+				cmd_list->SignalAll();
+			}
+		}
+		ExecutePendingCommandLists();
 
-		for (GfxCommandList* cmd_list : cmd_lists) cmd_list->SignalAll();
+		//allocators go back to the pool tagged with this submission, the lists themselves can be reset right away
+		command_queue->Signal(submission_fence, ++submission_fence_value);
+		for (GfxCommandList* cmd_list : cmd_lists) cmd_list->ReleaseAllocator(submission_fence_value);
 	}
 
 	void GfxCommandQueue::ExecuteCommandListPool(GfxCommandListPool& cmd_list_pool)
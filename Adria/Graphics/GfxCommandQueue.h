@@ -7,14 +7,15 @@ namespace adria
 	class GfxDevice;
 	class GfxCommandList;
 	class GfxCommandListPool;
+	class GfxCommandAllocatorPool;
 
 	enum class GfxCommandListType : Uint8;
 
 	class GfxCommandQueue
 	{
 	public:
-		GfxCommandQueue() = default;
-		~GfxCommandQueue() = default;
+		GfxCommandQueue();
+		~GfxCommandQueue();
 
 		Bool Create(GfxDevice* gfx, GfxCommandListType type, Char const* name = "");
 		
@@ -26,11 +27,16 @@ namespace adria
 
 		Uint64 GetTimestampFrequency() const { return timestamp_frequency; }
 		GfxCommandListType GetType() const { return type; }
+		GfxCommandAllocatorPool& GetAllocatorPool() const { return *allocator_pool; }
+		Uint64 GetLastSubmissionValue() const { return submission_fence_value; }
 
 		operator ID3D12CommandQueue* () const { return command_queue.Get(); }
 	private:
 		Ref<ID3D12CommandQueue> command_queue;
 		Uint64 timestamp_frequency;
 		GfxCommandListType type;
+		GfxFence submission_fence;
+		Uint64 submission_fence_value = 0;
+		std::unique_ptr<GfxCommandAllocatorPool> allocator_pool;
 	};
 }
\ No newline at end of file
@@ -11,7 +11,8 @@ namespace adria
 		Draw,
 		DrawIndexed,
 		Dispatch,
-		DispatchMesh
+		DispatchMesh,
+		DispatchRays
 	};
 	template<IndirectCommandType>
 	struct IndirectCommandTraits;
@@ -42,6 +43,13 @@ namespace adria
 		static constexpr UINT Stride = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS);
 	};
 
+	template<>
+	struct IndirectCommandTraits<IndirectCommandType::DispatchRays>
+	{
+		static constexpr D3D12_INDIRECT_ARGUMENT_TYPE ArgumentType = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_RAYS;
+		static constexpr UINT Stride = sizeof(D3D12_DISPATCH_RAYS_DESC);
+	};
+
 	template<IndirectCommandType type>
 	class IndirectCommandSignature
 	{
@@ -64,8 +72,44 @@ namespace adria
 		Ref<ID3D12CommandSignature> cmd_signature;
 	};
 
+	//root constant followed by an indexed draw, lets a single ExecuteIndirect issue many draws with different instance ids
+	class DrawIndexedRootConstantIndirectSignature
+	{
+	public:
+		struct Arguments
+		{
+			Uint32 root_constant;
+			D3D12_DRAW_INDEXED_ARGUMENTS draw;
+		};
+
+	public:
+		DrawIndexedRootConstantIndirectSignature(ID3D12Device* device, ID3D12RootSignature* root_signature, Uint32 root_parameter_index)
+		{
+			D3D12_INDIRECT_ARGUMENT_DESC argument_descs[2]{};
+			argument_descs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+			argument_descs[0].Constant.RootParameterIndex = root_parameter_index;
+			argument_descs[0].Constant.DestOffsetIn32BitValues = 0;
+			argument_descs[0].Constant.Num32BitValuesToSet = 1;
+			argument_descs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+			D3D12_COMMAND_SIGNATURE_DESC desc{};
+			desc.NumArgumentDescs = ARRAYSIZE(argument_descs);
+			desc.pArgumentDescs = argument_descs;
+			desc.ByteStride = sizeof(Arguments);
+			GFX_CHECK_HR(device->CreateCommandSignature(&desc, root_signature, IID_PPV_ARGS(cmd_signature.GetAddressOf())));
+		}
+		operator ID3D12CommandSignature* () const
+		{
+			return cmd_signature.Get();
+		}
+	private:
+		Ref<ID3D12CommandSignature> cmd_signature;
+	};
+	static_assert(sizeof(DrawIndexedRootConstantIndirectSignature::Arguments) == 24);
+
 	using DrawIndirectSignature			= IndirectCommandSignature<IndirectCommandType::Draw>;
 	using DrawIndexedIndirectSignature	= IndirectCommandSignature<IndirectCommandType::DrawIndexed>;
 	using DispatchIndirectSignature		= IndirectCommandSignature<IndirectCommandType::Dispatch>;
 	using DispatchMeshIndirectSignature = IndirectCommandSignature<IndirectCommandType::DispatchMesh>;
+	using DispatchRaysIndirectSignature = IndirectCommandSignature<IndirectCommandType::DispatchRays>;
 }
\ No newline at end of file
@@ -16,7 +16,7 @@ namespace adria
 		GfxConstantBuffer(GfxDevice* gfx, Uint32 cbuffer_count) : cbuffer_size(GetCBufferSize()), cbuffer_count(cbuffer_count)
 		{
 			GfxBufferDesc desc{};
-			desc.resource_usage = GfxResourceUsage::Upload;
+			desc.resource_usage = GfxResourceUsage::GpuUpload;
 			desc.bind_flags = GfxBindFlag::None;
 			desc.format = GfxFormat::UNKNOWN;
 			desc.misc_flags = GfxBufferMiscFlag::ConstantBuffer;
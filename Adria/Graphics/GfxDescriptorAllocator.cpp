@@ -1,58 +1,126 @@
+#include <bit>
 #include "GfxDescriptorAllocator.h"
+#include "Logging/Logger.h"
 
 namespace adria
 {
+	namespace
+	{
+		Uint32 GetSizeClass(Uint32 count)
+		{
+			return count <= 1 ? 0 : (Uint32)std::bit_width(count - 1);
+		}
+	}
+
 	GfxDescriptorAllocator::GfxDescriptorAllocator(GfxDevice* gfx, GfxDescriptorAllocatorDesc const& desc)
-		: GfxDescriptorAllocatorBase(gfx, desc.type, desc.descriptor_count, desc.shader_visible),
-		tail_descriptor(head_descriptor)
+		: GfxDescriptorAllocatorBase(gfx, desc.type, desc.descriptor_count, desc.shader_visible)
 	{
-		tail_descriptor.Increment(descriptor_handle_size ,desc.descriptor_count - 1);
-		free_descriptor_ranges.emplace_back(head_descriptor, tail_descriptor);
+		free_heads.fill(INVALID_INDEX);
+		next_free.resize(descriptor_count, INVALID_INDEX);
+		prev_free.resize(descriptor_count, INVALID_INDEX);
+		free_classes.resize(descriptor_count, 0);
+		FreeRange(0, descriptor_count);
 	}
 
 	GfxDescriptorAllocator::~GfxDescriptorAllocator() = default;
 
 	GfxDescriptor GfxDescriptorAllocator::AllocateDescriptor()
 	{
-		GfxDescriptorRange& range = free_descriptor_ranges.front();
-		GfxDescriptor handle = range.begin;
-		range.begin.Increment(descriptor_handle_size);
-		if (range.begin == range.end) free_descriptor_ranges.pop_front();
-		return handle;
+		return AllocateDescriptors(1);
 	}
 
 	void GfxDescriptorAllocator::FreeDescriptor(GfxDescriptor handle)
 	{
-		GfxDescriptor incremented_handle = handle;
-		incremented_handle.Increment(descriptor_handle_size);
+		if (!handle.IsValid()) return;
+		std::lock_guard lock(alloc_mutex);
+		FreeBlock(handle.GetIndex(), 0);
+	}
+
+	GfxDescriptor GfxDescriptorAllocator::AllocateDescriptors(Uint32 count)
+	{
+		ADRIA_ASSERT(count > 0);
+		std::lock_guard lock(alloc_mutex);
+		Uint32 const index = AllocateRange(count);
+		if (index == INVALID_INDEX)
+		{
+			ADRIA_LOG(WARNING, "Descriptor heap is full, %u descriptors could not be allocated!", count);
+			return GfxDescriptor{};
+		}
+		return GetHandle(index);
+	}
+
+	void GfxDescriptorAllocator::FreeDescriptors(GfxDescriptor handle, Uint32 count)
+	{
+		ADRIA_ASSERT(count > 0);
+		if (!handle.IsValid()) return;
+		std::lock_guard lock(alloc_mutex);
+		FreeRange(handle.GetIndex(), count);
+	}
 
-		GfxDescriptorRange rng{
-			.begin = handle,
-			.end = incremented_handle
-		};
+	Uint32 GfxDescriptorAllocator::AllocateRange(Uint32 count)
+	{
+		Uint32 const size_class = GetSizeClass(count);
+		Uint32 block_class = size_class;
+		while (block_class < SIZE_CLASS_COUNT && free_heads[block_class] == INVALID_INDEX) ++block_class;
+		if (block_class == SIZE_CLASS_COUNT) return INVALID_INDEX;
 
-		Bool found = false;
-		for (auto range = std::begin(free_descriptor_ranges);
-			range != std::end(free_descriptor_ranges) && found == false; ++range)
+		Uint32 const index = free_heads[block_class];
+		RemoveFreeBlock(index, block_class);
+		while (block_class > size_class)
 		{
-			if (range->begin == incremented_handle)
-			{
-				range->begin = handle;
-				found = true;
-			}
-			else if (range->end == handle)
-			{
-				range->end.Increment(descriptor_handle_size);
-				found = true;
-			}
-			else if (range->begin.GetIndex() > handle.GetIndex())
-			{
-				free_descriptor_ranges.insert(range, rng);
-				found = true;
-			}
+			--block_class;
+			PushFreeBlock(index + (1u << block_class), block_class);
 		}
-		if (!found) free_descriptor_ranges.push_back(rng);
+		//the tail past the requested count goes back right away, ranges don't keep the power of two rounding
+		Uint32 const block_size = 1u << size_class;
+		if (count < block_size) FreeRange(index + count, block_size - count);
+		return index;
 	}
 
-}
+	//splits the range into aligned power of two blocks, the same split for every range keeps allocation and free symmetric
+	void GfxDescriptorAllocator::FreeRange(Uint32 index, Uint32 count)
+	{
+		Uint32 const end = index + count;
+		while (index < end)
+		{
+			Uint32 size_class = (Uint32)std::bit_width(end - index) - 1;
+			if (index != 0) size_class = std::min(size_class, (Uint32)std::countr_zero(index));
+			FreeBlock(index, size_class);
+			index += 1u << size_class;
+		}
+	}
 
+	void GfxDescriptorAllocator::FreeBlock(Uint32 index, Uint32 size_class)
+	{
+		ADRIA_ASSERT(index < descriptor_count && free_classes[index] == 0);
+		while (size_class + 1 < SIZE_CLASS_COUNT)
+		{
+			Uint32 const buddy = index ^ (1u << size_class);
+			if (buddy >= descriptor_count || free_classes[buddy] != size_class + 1) break;
+			RemoveFreeBlock(buddy, size_class);
+			index = std::min(index, buddy);
+			++size_class;
+		}
+		PushFreeBlock(index, size_class);
+	}
+
+	void GfxDescriptorAllocator::PushFreeBlock(Uint32 index, Uint32 size_class)
+	{
+		Uint32 const head = free_heads[size_class];
+		next_free[index] = head;
+		prev_free[index] = INVALID_INDEX;
+		if (head != INVALID_INDEX) prev_free[head] = index;
+		free_heads[size_class] = index;
+		free_classes[index] = (Uint8)(size_class + 1);
+	}
+
+	void GfxDescriptorAllocator::RemoveFreeBlock(Uint32 index, Uint32 size_class)
+	{
+		Uint32 const next = next_free[index];
+		Uint32 const prev = prev_free[index];
+		if (prev != INVALID_INDEX) next_free[prev] = next;
+		else free_heads[size_class] = next;
+		if (next != INVALID_INDEX) prev_free[next] = prev;
+		free_classes[index] = 0;
+	}
+}
@@ -1,5 +1,5 @@
 #pragma once
-#include <list>
+#include <mutex>
 #include "GfxDescriptorAllocatorBase.h"
 
 namespace adria
@@ -11,13 +11,12 @@ namespace adria
 		Bool shader_visible = false;
 	};
 
+	//buddy allocator over the heap, freed blocks merge with their buddy at index ^ block size.
+	//allocations fail with an invalid descriptor once no free block is large enough
 	class GfxDescriptorAllocator : public GfxDescriptorAllocatorBase
 	{
-		struct GfxDescriptorRange
-		{
-			GfxDescriptor begin;
-			GfxDescriptor end;
-		};
+		static constexpr Uint32 SIZE_CLASS_COUNT = 32;
+		static constexpr Uint32 INVALID_INDEX = ~0u;
 
 	public:
 		GfxDescriptorAllocator(GfxDevice* gfx_device, GfxDescriptorAllocatorDesc const& desc);
@@ -26,8 +25,23 @@ namespace adria
 		ADRIA_NODISCARD GfxDescriptor AllocateDescriptor();
 		void FreeDescriptor(GfxDescriptor handle);
 
+		ADRIA_NODISCARD GfxDescriptor AllocateDescriptors(Uint32 count);
+		void FreeDescriptors(GfxDescriptor handle, Uint32 count);
+
+	private:
+		std::mutex alloc_mutex;
+		//free blocks of each size class form an intrusive list indexed by their first descriptor
+		std::array<Uint32, SIZE_CLASS_COUNT> free_heads;
+		std::vector<Uint32> next_free;
+		std::vector<Uint32> prev_free;
+		//size class + 1 for the first descriptor of a free block, 0 otherwise
+		std::vector<Uint8> free_classes;
+
 	private:
-		GfxDescriptor tail_descriptor;
-		std::list<GfxDescriptorRange> free_descriptor_ranges;
+		Uint32 AllocateRange(Uint32 count);
+		void FreeRange(Uint32 index, Uint32 count);
+		void FreeBlock(Uint32 index, Uint32 size_class);
+		void PushFreeBlock(Uint32 index, Uint32 size_class);
+		void RemoveFreeBlock(Uint32 index, Uint32 size_class);
 	};
-}
\ No newline at end of file
+}
@@ -24,6 +24,11 @@ namespace adria
 		head_descriptor.index = 0;
 	}
 
+	GfxDescriptorAllocatorBase::~GfxDescriptorAllocatorBase()
+	{
+		gfx->GetMemoryTracker().Free(GfxMemoryCategory::DescriptorHeaps, Uint64(descriptor_count) * descriptor_handle_size);
+	}
+
 	void GfxDescriptorAllocatorBase::CreateHeap()
 	{
 		ADRIA_ASSERT(descriptor_count <= UINT32_MAX && "Too many descriptors");
@@ -33,6 +38,7 @@ namespace adria
 		heap_desc.Type = ToD3D12HeapType(type);
 		GFX_CHECK_HR(gfx->GetDevice()->CreateDescriptorHeap(&heap_desc, IID_PPV_ARGS(heap.ReleaseAndGetAddressOf())));
 		descriptor_handle_size = gfx->GetDevice()->GetDescriptorHandleIncrementSize(heap_desc.Type);
+		gfx->GetMemoryTracker().Allocate(GfxMemoryCategory::DescriptorHeaps, Uint64(descriptor_count) * descriptor_handle_size);
 	}
 
 }
\ No newline at end of file
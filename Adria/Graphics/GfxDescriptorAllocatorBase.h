@@ -49,6 +49,7 @@ namespace adria
 
 	protected:
 		GfxDescriptorAllocatorBase(GfxDevice* gfx, GfxDescriptorHeapType type, Uint32 descriptor_count, Bool shader_visible);
+		~GfxDescriptorAllocatorBase();
 		void CreateHeap();
 	};
 }
\ No newline at end of file
@@ -11,12 +11,18 @@
 #include "GfxLinearDynamicAllocator.h"
 #include "GfxQueryHeap.h"
 #include "GfxPipelineState.h"
+#include "GfxPipelineLibrary.h"
+#include "GfxBreadcrumbs.h"
+#include "GfxReadbackQueue.h"
+#include "GfxUploadManager.h"
+#include "GfxResidencyManager.h"
 #include "GfxNsightAftermathGpuCrashTracker.h"
 #include "d3dx12.h"
 #include "pix3.h"
 #include "Logging/Logger.h"
 #include "Core/Window.h"
 #include "Core/ConsoleManager.h"
+#include "Core/CpuProfiler.h"
 
 
 extern "C" { __declspec(dllexport) extern const UINT D3D12SDKVersion = D3D12_SDK_VERSION; }
@@ -239,6 +245,17 @@ namespace adria
 	}
 
 	static TAutoConsoleVariable<Bool> VSync("rhi.VSync", false, "0: VSync is disabled. 1: VSync is enabled.");
+	static TAutoConsoleVariable<Bool> LowLatency("rhi.LowLatency", false, "Wait on the swapchain frame latency waitable object before sampling input");
+	static TAutoConsoleVariable<Int> MaxFrameLatency("rhi.MaxFrameLatency", 1, "Maximum number of frames queued for presentation in low latency mode");
+	static TAutoConsoleVariable<Int>  LowLatencyMode("rhi.LowLatencyMode", 0, "0: Off, 1: NVIDIA Reflex, 2: AMD Anti-Lag 2");
+	static TAutoConsoleVariable<Bool> LowLatencyBoost("rhi.LowLatencyBoost", false, "Enable NVIDIA Reflex boost mode");
+	static TAutoConsoleVariable<Bool> Breadcrumbs("rhi.Breadcrumbs", true, "Write a GPU breadcrumb before and after every render graph pass");
+	static TAutoConsoleVariable<Int>  GpuWatchdogThreshold("rhi.GpuWatchdogThreshold", 200, "Log the breadcrumb state when waiting for a GPU frame takes longer than this many milliseconds");
+	static TAutoConsoleVariable<Bool> AllowTearing("rhi.AllowTearing", true, "Present with tearing allowed when VSync is disabled (required for variable refresh rate displays)");
+	static TAutoConsoleVariable<Int>  HDROutput("rhi.HDR", 0, "0: SDR, 1: HDR10 (ST.2084), 2: scRGB. Falls back to SDR when the display is not in HDR mode");
+	static TAutoConsoleVariable<Float> HDRPaperWhite("rhi.HDR.PaperWhite", 200.0f, "Luminance in nits that SDR white and the UI are mapped to on HDR outputs");
+	static TAutoConsoleVariable<Bool> PresentThread("rhi.PresentThread", true, "Present and wait for the frame fence on a separate thread so the start of the next frame overlaps with it");
+	static TAutoConsoleVariable<Float> MemoryBudgetWarning("rhi.MemoryBudgetWarning", 0.9f, "Log a warning when VRAM usage exceeds this fraction of the DXGI budget");
 
 	GfxDevice::DRED::DRED(GfxDevice* gfx)
 	{
@@ -259,9 +276,10 @@ namespace adria
 		: frame_index(0), shading_rate_info{}
 	{
 		VSync->Set(options.vsync);
-		hwnd = window->Handle();
-		width = window->Width();
-		height = window->Height();
+		ADRIA_ASSERT(window != nullptr || options.headless);
+		hwnd = options.headless ? nullptr : window->Handle();
+		width = options.headless ? options.headless_width : window->Width();
+		height = options.headless ? options.headless_height : window->Height();
 
 		HRESULT hr = E_FAIL;
 		Uint32 dxgi_factory_flags = 0;
@@ -324,6 +342,8 @@ namespace adria
 		{
 			nsight_aftermath->Initialize();
 		}
+		pipeline_library = std::make_unique<GfxPipelineLibrary>(this, adapter.Get());
+		low_latency = std::make_unique<GfxLowLatency>(this);
 
 		D3D12MA::ALLOCATOR_DESC allocator_desc{};
 		allocator_desc.pDevice = device.Get();
@@ -359,23 +379,35 @@ namespace adria
 		swapchain_desc.height = height;
 		swapchain_desc.fullscreen_windowed = true;
 		swapchain_desc.backbuffer_format = GfxFormat::R8G8B8A8_UNORM;
+		swapchain_desc.headless = options.headless;
+		swapchain_desc.headless_buffer_count = options.headless_frames_in_flight;
 		swapchain = std::make_unique<GfxSwapchain>(this, swapchain_desc);
 
 		frame_fence.Create(this, "Frame Fence");
 		upload_fence.Create(this, "Upload Fence");
 		async_compute_fence.Create(this, "Async Compute Fence");
+		async_graphics_fence.Create(this, "Async Graphics Fence");
 		wait_fence.Create(this, "Wait Fence");
 		release_fence.Create(this, "Release Fence");
 
 		draw_indirect_signature = std::make_unique<DrawIndirectSignature>(device.Get());
 		draw_indexed_indirect_signature = std::make_unique<DrawIndexedIndirectSignature>(device.Get());
 		dispatch_indirect_signature = std::make_unique<DispatchIndirectSignature>(device.Get());
+		breadcrumbs = std::make_unique<GfxBreadcrumbs>(this);
+		readback_queue = std::make_unique<GfxReadbackQueue>(this);
+		upload_manager = std::make_unique<GfxUploadManager>(this, 8 * 1024 * 1024);
+		residency_manager = std::make_unique<GfxResidencyManager>(this);
 		if (device_capabilities.SupportsMeshShaders())
 		{
 			dispatch_mesh_indirect_signature = std::make_unique<DispatchMeshIndirectSignature>(device.Get());
 		}
+		if (device_capabilities.CheckRayTracingSupport(RayTracingSupport::Tier1_1))
+		{
+			dispatch_rays_indirect_signature = std::make_unique<DispatchRaysIndirectSignature>(device.Get());
+		}
 		SetInfoQueue();
 		CreateCommonRootSignature();
+		draw_indexed_root_constant_indirect_signature = std::make_unique<DrawIndexedRootConstantIndirectSignature>(device.Get(), global_root_signature.Get(), 1);
 
 		std::atexit(ReportLiveObjects);
 		if (options.dred)
@@ -385,20 +417,60 @@ namespace adria
 	}
 	GfxDevice::~GfxDevice()
 	{
+		WaitForPresent();
+		if (present_thread.joinable())
+		{
+			{
+				std::lock_guard lock(present_mutex);
+				present_thread_exit = true;
+			}
+			present_cond_var.notify_one();
+			present_thread.join();
+		}
 		WaitForGPU();
+		breadcrumbs.reset();
+		readback_queue.reset();
+		upload_manager.reset();
 		ProcessReleaseQueue();
 		frame_fence.Wait(frame_fence_values[swapchain->GetBackbufferIndex()]);
 	}
 
 	void GfxDevice::WaitForGPU()
 	{
+		WaitForPresent();
 		graphics_queue.Signal(wait_fence, wait_fence_value);
-		copy_queue.Signal(wait_fence, wait_fence_value);
 		wait_fence.Wait(wait_fence_value);
+		wait_fence_value++;
+
+		compute_queue.Signal(wait_fence, wait_fence_value);
+		wait_fence.Wait(wait_fence_value);
+		wait_fence_value++;
+
+		copy_queue.Signal(wait_fence, wait_fence_value);
 		wait_fence.Wait(wait_fence_value);
 		wait_fence_value++;
 	}
 
+	//the cpu only stalls on the gpu right before the slot's allocators and command lists get reused
+	void GfxDevice::WaitForFrameSlot(Uint32 backbuffer_index)
+	{
+		AdriaCpuProfileScope("Wait For Frame Slot");
+		if (!frame_fence.WaitHelping(frame_fence_values[backbuffer_index], std::max(GpuWatchdogThreshold.Get(), 1)))
+		{
+			ADRIA_LOG(WARNING, "GPU frame %u exceeded the watchdog threshold of %d ms!", frame_index, GpuWatchdogThreshold.Get());
+			breadcrumbs->LogState(backbuffer_index);
+			frame_fence.Wait(frame_fence_values[backbuffer_index]);
+		}
+		if (input_sample_ticks != 0)
+		{
+			static LARGE_INTEGER qpc_frequency{};
+			if (qpc_frequency.QuadPart == 0) QueryPerformanceFrequency(&qpc_frequency);
+			LARGE_INTEGER now{};
+			QueryPerformanceCounter(&now);
+			input_to_gpu_complete_ms = (Float)(1000.0 * (now.QuadPart - input_sample_ticks) / qpc_frequency.QuadPart);
+		}
+	}
+
 	void GfxDevice::OnResize(Uint32 w, Uint32 h)
 	{
 		if ((width != w || height != h) && width > 0 && height > 0)
@@ -410,14 +482,63 @@ namespace adria
 			swapchain->OnResize(w, h);
 		}
 	}
+	void GfxDevice::UpdateColorSpace()
+	{
+		GfxColorSpace const requested_color_space = (GfxColorSpace)std::clamp(HDROutput.Get(), 0, (Int)GfxColorSpace::scRGB);
+		if (requested_color_space == requested_color_space_applied) return;
+
+		WaitForGPU();
+		for (Uint32 i = 0; i < GFX_BACKBUFFER_COUNT; ++i) frame_fence_values[i] = frame_fence_values[swapchain->GetBackbufferIndex()];
+		if (swapchain->SetColorSpace(requested_color_space))
+		{
+			ADRIA_LOG(INFO, "Swapchain color space changed to %s", swapchain->GetColorSpace() == GfxColorSpace::HDR10 ? "HDR10" : swapchain->GetColorSpace() == GfxColorSpace::scRGB ? "scRGB" : "SDR");
+		}
+		requested_color_space_applied = requested_color_space;
+	}
 	Uint32 GfxDevice::GetBackbufferIndex() const
 	{
 		return swapchain->GetBackbufferIndex();
 	}
 	Uint32 GfxDevice::GetFrameIndex() const { return frame_index; }
 
+	void GfxDevice::WaitForFrameLatency()
+	{
+		if (LowLatency.Get())
+		{
+			swapchain->SetMaximumFrameLatency(MaxFrameLatency.Get());
+			swapchain->WaitForFrameLatency();
+		}
+		else
+		{
+			swapchain->SetMaximumFrameLatency(GFX_BACKBUFFER_COUNT);
+		}
+		GfxLowLatencyMode const low_latency_mode = (GfxLowLatencyMode)std::clamp(LowLatencyMode.Get(), 0, (Int)GfxLowLatencyMode::AntiLag2);
+		if (low_latency_mode != low_latency->GetMode())
+		{
+			low_latency->SetMode(low_latency_mode, LowLatencyBoost.Get());
+			LowLatencyMode->Set((Int)low_latency->GetMode());
+		}
+		low_latency->Sleep();
+
+		LARGE_INTEGER now{};
+		QueryPerformanceCounter(&now);
+		input_sample_ticks = now.QuadPart;
+		SetLatencyMarker(GfxLatencyMarker::InputSample);
+	}
+
+	void GfxDevice::SetLatencyMarker(GfxLatencyMarker marker)
+	{
+		low_latency->SetMarker(marker, frame_index + 1);
+	}
+
+	void GfxDevice::SetLowLatencyMode(GfxLowLatencyMode mode)
+	{
+		LowLatencyMode->Set((Int)mode);
+	}
+
 	void GfxDevice::BeginFrame()
 	{
+		WaitForPresent();
 		if (rendering_not_started) [[unlikely]]
 		{
 			dynamic_allocator_on_init.reset();
@@ -425,26 +546,108 @@ namespace adria
 			rendering_not_started = false;
 		}
 
+		GPUMemoryUsage const memory_usage = GetMemoryUsage();
+		peak_memory_usage = std::max(peak_memory_usage, memory_usage.usage);
+		Bool const over_budget = memory_usage.usage > MemoryBudgetWarning.Get() * memory_usage.budget;
+		if (over_budget && !memory_budget_warning_issued)
+		{
+			ADRIA_LOG(WARNING, "VRAM usage %llu MB exceeds %.0f%% of the %llu MB budget!", memory_usage.usage / (1024 * 1024), MemoryBudgetWarning.Get() * 100.0f, memory_usage.budget / (1024 * 1024));
+		}
+		memory_budget_warning_issued = over_budget;
+
 		Uint32 backbuffer_index = swapchain->GetBackbufferIndex();
+		WaitForFrameSlot(backbuffer_index);
 		gpu_descriptor_allocator->ReleaseCompletedFrames(frame_index);
 		dynamic_allocators[backbuffer_index]->Clear();
+		readback_queue->ProcessCompleted();
+		upload_manager->ProcessCompleted();
+		residency_manager->Update(frame_index);
 
 		graphics_cmd_list_pool[backbuffer_index]->BeginCmdLists();
+		compute_cmd_list_pool[backbuffer_index]->BeginCmdLists();
 		copy_cmd_list_pool[backbuffer_index]->BeginCmdLists();
+		upload_manager->Flush(graphics_cmd_list_pool[backbuffer_index]->GetMainCmdList());
+	}
+	void GfxDevice::SubmitCommandLists()
+	{
+		Uint32 backbuffer_index = swapchain->GetBackbufferIndex();
+		compute_cmd_list_pool[backbuffer_index]->EndCmdLists();
+		graphics_cmd_list_pool[backbuffer_index]->EndCmdLists();
+		compute_queue.ExecuteCommandListPool(*compute_cmd_list_pool[backbuffer_index]);
+		graphics_queue.ExecuteCommandListPool(*graphics_cmd_list_pool[backbuffer_index]);
+		compute_cmd_list_pool[backbuffer_index]->RetireCmdLists();
+		graphics_cmd_list_pool[backbuffer_index]->RetireCmdLists();
 	}
 	void GfxDevice::EndFrame()
 	{
 		if (first_frame) [[unlikely]] first_frame = false;
 		Uint32 backbuffer_index = swapchain->GetBackbufferIndex();
+		Uint32 const frame_slot = backbuffer_index;
 
 		graphics_cmd_list_pool[backbuffer_index]->EndCmdLists();
+		compute_cmd_list_pool[backbuffer_index]->EndCmdLists();
 		copy_cmd_list_pool[backbuffer_index]->EndCmdLists();
 
+		compute_queue.ExecuteCommandListPool(*compute_cmd_list_pool[backbuffer_index]);
 		graphics_queue.ExecuteCommandListPool(*graphics_cmd_list_pool[backbuffer_index]);
+		readback_queue->Submit(graphics_queue);
+		upload_manager->Submit(graphics_queue);
 		copy_queue.ExecuteCommandListPool(*copy_cmd_list_pool[backbuffer_index]);
 		ProcessReleaseQueue();
 
-		Bool present_successful = swapchain->Present(VSync.Get());
+		if (!PresentThread.Get())
+		{
+			PresentFrame(frame_slot);
+			return;
+		}
+		if (!present_thread.joinable()) present_thread = std::thread(&GfxDevice::PresentThreadLoop, this);
+		{
+			std::lock_guard lock(present_mutex);
+			present_frame_slot = frame_slot;
+			present_pending = true;
+		}
+		present_cond_var.notify_one();
+	}
+
+	void GfxDevice::WaitForPresent()
+	{
+		std::unique_lock lock(present_mutex);
+		present_cond_var.wait(lock, [this] { return !present_pending; });
+	}
+
+	void GfxDevice::PresentThreadLoop()
+	{
+		while (true)
+		{
+			Uint32 frame_slot = 0;
+			{
+				std::unique_lock lock(present_mutex);
+				present_cond_var.wait(lock, [this] { return present_pending || present_thread_exit; });
+				if (present_thread_exit) return;
+				frame_slot = present_frame_slot;
+			}
+			PresentFrame(frame_slot);
+			{
+				std::lock_guard lock(present_mutex);
+				present_pending = false;
+			}
+			present_cond_var.notify_all();
+		}
+	}
+
+	//everything here runs on the present thread when rhi.PresentThread is enabled,
+	//the main thread only touches the swapchain and frame_index again after WaitForPresent
+	void GfxDevice::PresentFrame(Uint32 frame_slot)
+	{
+		Uint32 backbuffer_index = frame_slot;
+		Bool present_successful = false;
+		{
+			AdriaCpuProfileScope("Present");
+			SetLatencyMarker(GfxLatencyMarker::PresentStart);
+			present_successful = swapchain->Present(VSync.Get(), AllowTearing.Get(), input_sample_ticks);
+			SetLatencyMarker(GfxLatencyMarker::PresentEnd);
+		}
+		if (!present_successful) breadcrumbs->LogState(frame_slot);
 		if (!present_successful && nsight_aftermath && nsight_aftermath->IsInitialized())
 		{
 			nsight_aftermath->HandleGpuCrash();
@@ -457,9 +660,6 @@ namespace adria
 		graphics_queue.Signal(frame_fence, frame_fence_value);
 		++frame_fence_value;
 
-		backbuffer_index = swapchain->GetBackbufferIndex();
-		frame_fence.Wait(frame_fence_values[backbuffer_index]);
-
 		++frame_index;
 		gpu_descriptor_allocator->FinishCurrentFrame(frame_index);
 	}
@@ -501,6 +701,22 @@ namespace adria
 	{
 		return swapchain->GetBackbuffer();
 	}
+	GfxFormat GfxDevice::GetBackbufferFormat() const
+	{
+		return swapchain->GetBackbufferFormat();
+	}
+	GfxColorSpace GfxDevice::GetColorSpace() const
+	{
+		return swapchain->GetColorSpace();
+	}
+	GfxDisplayInfo const& GfxDevice::GetDisplayInfo() const
+	{
+		return swapchain->GetDisplayInfo();
+	}
+	Float GfxDevice::GetHDRPaperWhite() const
+	{
+		return HDRPaperWhite.Get();
+	}
 	GfxCommandQueue& GfxDevice::GetCommandQueue(GfxCommandListType type)
 	{
 		switch (type)
@@ -642,6 +858,14 @@ namespace adria
 	{
 		return GetDescriptorAllocator()->Allocate(count);
 	}
+	GfxDescriptor GfxDevice::AllocatePersistentDescriptorGPU()
+	{
+		return GetDescriptorAllocator()->AllocatePersistent();
+	}
+	void GfxDevice::FreePersistentDescriptorGPU(GfxDescriptor descriptor)
+	{
+		GetDescriptorAllocator()->FreePersistent(descriptor);
+	}
 	GfxDescriptor GfxDevice::GetDescriptorGPU(Uint32 i) const
 	{
 		return GetDescriptorAllocator()->GetHandle(i);
@@ -659,7 +883,8 @@ namespace adria
 
 	void GfxDevice::InitShaderVisibleAllocator(Uint32 reserve)
 	{
-		gpu_descriptor_allocator = std::make_unique<GfxOnlineDescriptorAllocator>(this, 32767, reserve);
+		if (gpu_descriptor_allocator) return;
+		gpu_descriptor_allocator = std::make_unique<GfxOnlineDescriptorAllocator>(this, 32767, reserve, GFX_PERSISTENT_DESCRIPTOR_COUNT);
 	}
 
 	std::unique_ptr<GfxTexture> GfxDevice::CreateBackbufferTexture(GfxTextureDesc const& desc, void* backbuffer)
@@ -705,9 +930,9 @@ namespace adria
 		return std::make_unique<GfxQueryHeap>(this, desc);
 	}
 
-	std::unique_ptr<GfxRayTracingTLAS> GfxDevice::CreateRayTracingTLAS(std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags)
+	std::unique_ptr<GfxRayTracingTLAS> GfxDevice::CreateRayTracingTLAS(std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags, GfxCommandList* cmd_list)
 	{
-		return std::make_unique<GfxRayTracingTLAS>(this, instances, flags);
+		return std::make_unique<GfxRayTracingTLAS>(this, instances, flags, cmd_list);
 	}
 	std::unique_ptr<GfxRayTracingBLAS> GfxDevice::CreateRayTracingBLAS(std::span<GfxRayTracingGeometry> geometries, GfxRayTracingASFlags flags)
 	{
@@ -773,6 +998,22 @@ namespace adria
 		return gpu_memory_usage;
 	}
 
+	GfxBreadcrumbs* GfxDevice::GetBreadcrumbs() const
+	{
+		return Breadcrumbs.Get() ? breadcrumbs.get() : nullptr;
+	}
+
+	GfxLatencyStats GfxDevice::GetLatencyStats() const
+	{
+		GfxLatencyStats latency_stats{};
+		latency_stats.input_to_gpu_complete_ms = input_to_gpu_complete_ms;
+		latency_stats.input_to_display_ms = swapchain->GetDisplayLatency();
+		latency_stats.simulation_ms = low_latency->GetMarkerDelta(GfxLatencyMarker::SimulationStart, GfxLatencyMarker::SimulationEnd);
+		latency_stats.render_submit_ms = low_latency->GetMarkerDelta(GfxLatencyMarker::RenderSubmitStart, GfxLatencyMarker::RenderSubmitEnd);
+		latency_stats.present_ms = low_latency->GetMarkerDelta(GfxLatencyMarker::PresentStart, GfxLatencyMarker::PresentEnd);
+		return latency_stats;
+	}
+
 	void GfxDevice::SetRenderingNotStarted()
 	{
 		rendering_not_started = true;
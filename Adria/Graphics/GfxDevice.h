@@ -5,9 +5,12 @@
 
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <vector>
 #include <array>
 #include <queue>
+#include <optional>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
@@ -24,6 +27,9 @@
 #include "GfxCommandSignature.h"
 #include "GfxRayTracingAS.h"
 #include "GfxShadingRate.h"
+#include "GfxMemoryTracker.h"
+#include "GfxLowLatency.h"
+#include "GfxDisplay.h"
 #include "Utilities/Releasable.h"
 
 namespace adria
@@ -66,6 +72,11 @@ namespace adria
 	class GfxRingDescriptorAllocator;
 
 	class GfxNsightAftermathGpuCrashTracker;
+	class GfxPipelineLibrary;
+	class GfxBreadcrumbs;
+	class GfxReadbackQueue;
+	class GfxUploadManager;
+	class GfxResidencyManager;
 #if GFX_MULTITHREADED
 	using GfxOnlineDescriptorAllocator = GfxRingDescriptorAllocator<true>;
 #else
@@ -78,6 +89,15 @@ namespace adria
 		Uint64 budget;
 	};
 
+	struct GfxLatencyStats
+	{
+		Float input_to_gpu_complete_ms = 0.0f;
+		std::optional<Float> input_to_display_ms;
+		Float simulation_ms = 0.0f;
+		Float render_submit_ms = 0.0f;
+		Float present_ms = 0.0f;
+	};
+
 	enum class GfxVendor : Uint8
 	{
 		AMD,
@@ -97,19 +117,34 @@ namespace adria
 		~GfxDevice();
 
 		void WaitForGPU();
+		void WaitForPresent();
 		
 		void OnResize(Uint32 w, Uint32 h);
+		void UpdateColorSpace();
 		Uint32 GetBackbufferIndex() const;
 		Uint32 GetFrameIndex() const;
 
+		void WaitForFrameLatency();
+		void SetLatencyMarker(GfxLatencyMarker marker);
+		void SetLowLatencyMode(GfxLowLatencyMode mode);
+		GfxLowLatency const& GetLowLatency() const { return *low_latency; }
+		GfxBreadcrumbs* GetBreadcrumbs() const;
+		GfxReadbackQueue* GetReadbackQueue() const { return readback_queue.get(); }
+		GfxUploadManager* GetUploadManager() const { return upload_manager.get(); }
+		GfxResidencyManager* GetResidencyManager() const { return residency_manager.get(); }
 		void BeginFrame();
+		void SubmitCommandLists();
 		void EndFrame();
 		void TakePixCapture(Char const* capture_name, Uint32 num_frames);
 
 		void* GetHwnd() const { return hwnd; }
+		Uint32 GetWidth() const { return width; }
+		Uint32 GetHeight() const { return height; }
+		Bool IsHeadless() const { return hwnd == nullptr; }
 		IDXGIFactory4* GetFactory() const;
 		ID3D12Device5* GetDevice() const;
 		ID3D12RootSignature* GetCommonRootSignature() const;
+		GfxPipelineLibrary* GetPipelineLibrary() const { return pipeline_library.get(); }
 		D3D12MA::Allocator* GetAllocator() const;
 
 		GfxCapabilities const& GetCapabilities() const { return device_capabilities; }
@@ -122,7 +157,18 @@ namespace adria
 		GfxCommandList* AllocateCommandList(GfxCommandListType type) const;
 		void			FreeCommandList(GfxCommandList*, GfxCommandListType type);
 
+		GfxFence& GetAsyncComputeFence() { return async_compute_fence; }
+		GfxFence& GetAsyncGraphicsFence() { return async_graphics_fence; }
+		Uint64 IncrementAsyncComputeFenceValue() { return ++async_compute_fence_value; }
+		Uint64 IncrementAsyncGraphicsFenceValue() { return ++async_graphics_fence_value; }
+		GfxFence& GetUploadFence() { return upload_fence; }
+		Uint64 IncrementUploadFenceValue() { return ++upload_fence_value; }
+
 		GfxTexture* GetBackbuffer() const;
+		GfxFormat GetBackbufferFormat() const;
+		GfxColorSpace GetColorSpace() const;
+		GfxDisplayInfo const& GetDisplayInfo() const;
+		Float GetHDRPaperWhite() const;
 
 		template<Releasable T>
 		void AddToReleaseQueue(T* alloc)
@@ -134,6 +180,8 @@ namespace adria
 		void FreeDescriptorCPU(GfxDescriptor, GfxDescriptorHeapType);
 
 		GfxDescriptor AllocateDescriptorsGPU(Uint32 count = 1);
+		GfxDescriptor AllocatePersistentDescriptorGPU();
+		void FreePersistentDescriptorGPU(GfxDescriptor);
 		GfxDescriptor GetDescriptorGPU(Uint32 i) const;
 		void InitShaderVisibleAllocator(Uint32 reserve);
 
@@ -151,7 +199,7 @@ namespace adria
 
 		std::unique_ptr<GfxQueryHeap>	   CreateQueryHeap(GfxQueryHeapDesc const& desc);
 
-		std::unique_ptr<GfxRayTracingTLAS> CreateRayTracingTLAS(std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags);
+		std::unique_ptr<GfxRayTracingTLAS> CreateRayTracingTLAS(std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags, GfxCommandList* cmd_list = nullptr);
 		std::unique_ptr<GfxRayTracingBLAS> CreateRayTracingBLAS(std::span<GfxRayTracingGeometry> geometries, GfxRayTracingASFlags flags);
 
 		GfxDescriptor CreateBufferSRV(GfxBuffer const*, GfxBufferDescriptorDesc const* = nullptr);
@@ -173,6 +221,10 @@ namespace adria
 
 		void GetTimestampFrequency(Uint64& frequency) const;
 		GPUMemoryUsage GetMemoryUsage() const;
+		Uint64 GetPeakMemoryUsage() const { return peak_memory_usage; }
+		GfxLatencyStats GetLatencyStats() const;
+		GfxMemoryTracker& GetMemoryTracker() { return memory_tracker; }
+		GfxMemoryTracker const& GetMemoryTracker() const { return memory_tracker; }
 
 		void SetVRSInfo(GfxShadingRateInfo const& info)
 		{
@@ -187,6 +239,8 @@ namespace adria
 		DrawIndexedIndirectSignature& GetDrawIndexedIndirectSignature() const { return *draw_indexed_indirect_signature;}
 		DispatchIndirectSignature& GetDispatchIndirectSignature() const { return *dispatch_indirect_signature;}
 		DispatchMeshIndirectSignature& GetDispatchMeshIndirectSignature() const { return *dispatch_mesh_indirect_signature;}
+		DispatchRaysIndirectSignature& GetDispatchRaysIndirectSignature() const { return *dispatch_rays_indirect_signature;}
+		DrawIndexedRootConstantIndirectSignature& GetDrawIndexedRootConstantIndirectSignature() const { return *draw_indexed_root_constant_indirect_signature; }
 
 		void SetRenderingNotStarted();
 		Bool IsFirstFrame() const { return first_frame; }
@@ -205,11 +259,17 @@ namespace adria
 		Ref<ID3D12Device5> device = nullptr;
 		GfxCapabilities device_capabilities{};
 		GfxVendor vendor = GfxVendor::Unknown;
+		GfxMemoryTracker memory_tracker;
+		Uint64 peak_memory_usage = 0;
+		Bool memory_budget_warning_issued = false;
+		Int64 input_sample_ticks = 0;
+		Float input_to_gpu_complete_ms = 0.0f;
 
 		std::unique_ptr<GfxOnlineDescriptorAllocator> gpu_descriptor_allocator;
 		std::array<std::unique_ptr<GfxDescriptorAllocator>, (Uint64)GfxDescriptorHeapType::Count> cpu_descriptor_allocators;
 
 		std::unique_ptr<GfxSwapchain> swapchain;
+		GfxColorSpace requested_color_space_applied = GfxColorSpace::SDR;
 		ReleasablePtr<D3D12MA::Allocator> allocator = nullptr;
 
 		GfxCommandQueue graphics_queue;
@@ -224,6 +284,8 @@ namespace adria
 		std::unique_ptr<GfxComputeCommandListPool> compute_cmd_list_pool[GFX_BACKBUFFER_COUNT];
 		GfxFence async_compute_fence;
 		Uint64 async_compute_fence_value = 0;
+		GfxFence async_graphics_fence;
+		Uint64 async_graphics_fence_value = 0;
 
 		std::unique_ptr<GfxCopyCommandListPool> copy_cmd_list_pool[GFX_BACKBUFFER_COUNT];
 		GfxFence upload_fence;
@@ -252,6 +314,8 @@ namespace adria
 		std::unique_ptr<DrawIndexedIndirectSignature> draw_indexed_indirect_signature;
 		std::unique_ptr<DispatchIndirectSignature> dispatch_indirect_signature;
 		std::unique_ptr<DispatchMeshIndirectSignature> dispatch_mesh_indirect_signature;
+		std::unique_ptr<DispatchRaysIndirectSignature> dispatch_rays_indirect_signature;
+		std::unique_ptr<DrawIndexedRootConstantIndirectSignature> draw_indexed_root_constant_indirect_signature;
 
 		GfxShadingRateInfo shading_rate_info;
 
@@ -269,6 +333,19 @@ namespace adria
 		Bool pix_dll_loaded = false;
 
 		std::unique_ptr<GfxNsightAftermathGpuCrashTracker> nsight_aftermath;
+		std::unique_ptr<GfxPipelineLibrary> pipeline_library;
+		std::unique_ptr<GfxLowLatency> low_latency;
+		std::unique_ptr<GfxBreadcrumbs> breadcrumbs;
+		std::unique_ptr<GfxReadbackQueue> readback_queue;
+		std::unique_ptr<GfxUploadManager> upload_manager;
+		std::unique_ptr<GfxResidencyManager> residency_manager;
+
+		std::thread present_thread;
+		std::mutex present_mutex;
+		std::condition_variable present_cond_var;
+		Bool present_pending = false;
+		Bool present_thread_exit = false;
+		Uint32 present_frame_slot = 0;
 
 	private:
 		void SetupOptions(GfxOptions const& options, Uint32& dxgi_factory_flags);
@@ -276,6 +353,9 @@ namespace adria
 		void CreateCommonRootSignature();
 
 		void ProcessReleaseQueue();
+		void PresentFrame(Uint32 frame_slot);
+		void WaitForFrameSlot(Uint32 backbuffer_index);
+		void PresentThreadLoop();
 		GfxOnlineDescriptorAllocator* GetDescriptorAllocator() const;
 
 		GfxDescriptor CreateBufferView(GfxBuffer const* buffer, GfxSubresourceType view_type, GfxBufferDescriptorDesc const& view_desc, GfxBuffer const* uav_counter = nullptr);
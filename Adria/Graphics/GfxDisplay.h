@@ -0,0 +1,20 @@
+#pragma once
+
+namespace adria
+{
+	enum class GfxColorSpace : Uint8
+	{
+		SDR,
+		HDR10,
+		scRGB
+	};
+
+	//luminance values in nits as reported by the output the swapchain is presented on
+	struct GfxDisplayInfo
+	{
+		Bool  hdr_supported = false;
+		Float min_luminance = 0.0f;
+		Float max_luminance = 80.0f;
+		Float max_full_frame_luminance = 80.0f;
+	};
+}
@@ -2,6 +2,7 @@
 #include "GfxDevice.h"
 #include "GfxCommandQueue.h"
 #include "Utilities/StringUtil.h"
+#include "Utilities/JobSystem.h"
 
 namespace adria
 {
@@ -34,6 +35,33 @@ namespace adria
 		}
 	}
 
+	Bool GfxFence::Wait(Uint64 value, Uint32 timeout_ms)
+	{
+		if (IsCompleted(value)) return true;
+		fence->SetEventOnCompletion(value, event);
+		return WaitForSingleObjectEx(event, timeout_ms, FALSE) == WAIT_OBJECT_0;
+	}
+
+	//jobs can't be interrupted, helping stops halfway to the deadline so a long job doesn't hide a gpu hang from the caller
+	Bool GfxFence::WaitHelping(Uint64 value, Uint32 timeout_ms)
+	{
+		if (IsCompleted(value)) return true;
+		fence->SetEventOnCompletion(value, event);
+
+		Uint64 const start = GetTickCount64();
+		Uint64 const help_deadline = start + timeout_ms / 2;
+		while (WaitForSingleObjectEx(event, 0, FALSE) != WAIT_OBJECT_0)
+		{
+			if (GetTickCount64() >= help_deadline || !g_JobSystem.TryExecuteJob())
+			{
+				Uint64 const elapsed = GetTickCount64() - start;
+				if (elapsed >= timeout_ms) return false;
+				return WaitForSingleObjectEx(event, DWORD(timeout_ms - elapsed), FALSE) == WAIT_OBJECT_0;
+			}
+		}
+		return true;
+	}
+
 	void GfxFence::Signal(Uint64 value)
 	{
 		fence->Signal(value);
@@ -15,6 +15,9 @@ namespace adria
 		Bool Create(GfxDevice* gfx, Char const* name);
 
 		void Wait(Uint64 value);
+		Bool Wait(Uint64 value, Uint32 timeout_ms);
+		//runs pending jobs on the calling thread during the first half of the timeout, only meant for the main thread's frame slot wait
+		Bool WaitHelping(Uint64 value, Uint32 timeout_ms);
 		void Signal(Uint64 value);
 
 		Bool IsCompleted(Uint64 value);
@@ -4,73 +4,132 @@
 
 namespace adria
 {
+	namespace
+	{
+		std::atomic<Uint32> thread_count = 0;
+		thread_local Uint32 const thread_index = thread_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	GfxLinearDynamicAllocator::GfxLinearDynamicAllocator(GfxDevice* gfx, Uint64 page_size, Uint64 page_count)
 		: gfx(gfx), page_size(page_size)
 	{
 		alloc_pages.reserve(page_count);
-		while (alloc_pages.size() < page_count) alloc_pages.emplace_back(gfx, page_size);
+		while (alloc_pages.size() < std::max<Uint64>(page_count, 1)) alloc_pages.push_back(std::make_unique<GfxAllocationPage>(gfx, page_size));
+		current_page.store(alloc_pages[0].get(), std::memory_order_release);
 	}
 	GfxLinearDynamicAllocator::~GfxLinearDynamicAllocator() = default;
 
 	GfxDynamicAllocation GfxLinearDynamicAllocator::Allocate(Uint64 size_in_bytes, Uint64 alignment)
 	{
-		Uint64 offset = INVALID_ALLOC_OFFSET;
-		GfxAllocationPage& last_page = alloc_pages[current_page];
+		Uint64 const chunk_threshold = THREAD_CHUNK_SIZE / 4;
+		if (thread_index < MAX_THREAD_COUNT && size_in_bytes <= chunk_threshold)
 		{
-			std::lock_guard<std::mutex> guard(alloc_mutex);
-			offset = last_page.linear_allocator.Allocate(size_in_bytes, alignment);
+			ThreadChunk& chunk = thread_chunks[thread_index];
+			if (chunk.generation == generation && chunk.page)
+			{
+				Uint64 const offset = Align(chunk.offset, alignment);
+				if (offset + size_in_bytes <= chunk.end)
+				{
+					chunk.offset = offset + size_in_bytes;
+					return MakeAllocation(chunk.page, offset, size_in_bytes);
+				}
+			}
+
+			while (true)
+			{
+				GfxAllocationPage* page = current_page.load(std::memory_order_acquire);
+				Uint64 chunk_offset;
+				if (AllocateFromPage(page, THREAD_CHUNK_SIZE, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, chunk_offset))
+				{
+					chunk.page = page;
+					chunk.end = chunk_offset + THREAD_CHUNK_SIZE;
+					chunk.generation = generation;
+					Uint64 const offset = Align(chunk_offset, alignment);
+					chunk.offset = offset + size_in_bytes;
+					return MakeAllocation(page, offset, size_in_bytes);
+				}
+				NextPage(page, THREAD_CHUNK_SIZE);
+			}
 		}
 
-		if (offset != INVALID_ALLOC_OFFSET)
+		while (true)
 		{
-			GfxDynamicAllocation allocation{};
-			allocation.buffer = last_page.buffer.get();
-			allocation.cpu_address = reinterpret_cast<Uint8*>(last_page.cpu_address) + offset;
-			allocation.gpu_address = last_page.buffer->GetGpuAddress() + offset;
-			allocation.offset = offset;
-			allocation.size = size_in_bytes;
-
-			return allocation;
+			GfxAllocationPage* page = current_page.load(std::memory_order_acquire);
+			Uint64 offset;
+			if (AllocateFromPage(page, size_in_bytes, alignment, offset)) return MakeAllocation(page, offset, size_in_bytes);
+			NextPage(page, size_in_bytes + alignment);
 		}
-		else
+	}
+
+	void GfxLinearDynamicAllocator::Clear()
+	{
+		std::lock_guard<std::mutex> guard(page_mutex);
+		Uint32 i = gfx->GetFrameIndex() % PAGE_COUNT_HISTORY_SIZE;
+		used_page_count_history[i] = current_page_index + 1;
+		Uint64 max_used_page_count = 1;
+		for (Uint32 j = 0; j < PAGE_COUNT_HISTORY_SIZE; ++j) max_used_page_count = std::max(max_used_page_count, used_page_count_history[j]);
+		while (alloc_pages.size() > max_used_page_count) alloc_pages.pop_back();
+
+		for (auto& page : alloc_pages) page->top.store(0, std::memory_order_relaxed);
+		current_page_index = 0;
+		current_page.store(alloc_pages[0].get(), std::memory_order_release);
+		++generation;
+	}
+
+	Bool GfxLinearDynamicAllocator::AllocateFromPage(GfxAllocationPage* page, Uint64 size, Uint64 alignment, Uint64& offset)
+	{
+		Uint64 top = page->top.load(std::memory_order_relaxed);
+		while (true)
 		{
-			++current_page;
-			GfxAllocationPage& last_page = current_page < alloc_pages.size() ? alloc_pages[current_page] : alloc_pages.emplace_back(gfx, std::max(size_in_bytes, page_size));
-			return Allocate(size_in_bytes, alignment);
+			offset = Align(top, alignment);
+			if (offset + size > page->size) return false;
+			if (page->top.compare_exchange_weak(top, offset + size, std::memory_order_relaxed)) return true;
 		}
 	}
-	void GfxLinearDynamicAllocator::Clear()
+
+	GfxLinearDynamicAllocator::GfxAllocationPage* GfxLinearDynamicAllocator::NextPage(GfxAllocationPage* exhausted_page, Uint64 min_size)
 	{
+		std::lock_guard<std::mutex> guard(page_mutex);
+		GfxAllocationPage* page = current_page.load(std::memory_order_acquire);
+		if (page != exhausted_page) return page;
+
+		++current_page_index;
+		if (current_page_index < alloc_pages.size() && alloc_pages[current_page_index]->size < min_size)
 		{
-			std::lock_guard<std::mutex> guard(alloc_mutex);
-			for (auto& page : alloc_pages) page.linear_allocator.Clear();
+			alloc_pages.insert(alloc_pages.begin() + current_page_index, std::make_unique<GfxAllocationPage>(gfx, min_size));
 		}
-		
-		Uint32 i = gfx->GetFrameIndex() % PAGE_COUNT_HISTORY_SIZE;
-		used_page_count_history[i] = current_page;
-		Uint64 max_used_page_count = 0;
-		for (Uint32 j = 0; j < PAGE_COUNT_HISTORY_SIZE; ++j) max_used_page_count = std::max(max_used_page_count, used_page_count_history[j]);
-		if (max_used_page_count < alloc_pages.size())
+		else if (current_page_index >= alloc_pages.size())
 		{
-			while (alloc_pages.size() == max_used_page_count) 
-				alloc_pages.pop_back();
+			alloc_pages.push_back(std::make_unique<GfxAllocationPage>(gfx, std::max(min_size, page_size)));
 		}
-		current_page = 0;
+		page = alloc_pages[current_page_index].get();
+		current_page.store(page, std::memory_order_release);
+		return page;
+	}
+
+	GfxDynamicAllocation GfxLinearDynamicAllocator::MakeAllocation(GfxAllocationPage* page, Uint64 offset, Uint64 size)
+	{
+		GfxDynamicAllocation allocation{};
+		allocation.buffer = page->buffer.get();
+		allocation.cpu_address = reinterpret_cast<Uint8*>(page->cpu_address) + offset;
+		allocation.gpu_address = page->buffer->GetGpuAddress() + offset;
+		allocation.offset = offset;
+		allocation.size = size;
+		return allocation;
 	}
 
-	GfxLinearDynamicAllocator::GfxAllocationPage::GfxAllocationPage(GfxDevice* gfx, Uint64 page_size) : linear_allocator(page_size)
+	GfxLinearDynamicAllocator::GfxAllocationPage::GfxAllocationPage(GfxDevice* gfx, Uint64 page_size) : size(page_size)
 	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::DynamicUpload);
 		GfxBufferDesc desc{};
 		desc.size = page_size;
-		desc.resource_usage = GfxResourceUsage::Upload;
+		desc.resource_usage = GfxResourceUsage::GpuUpload;
 		desc.bind_flags = GfxBindFlag::ShaderResource;
 
 		buffer = gfx->CreateBuffer(desc);
 		ADRIA_ASSERT(buffer->IsMapped());
 		cpu_address = buffer->GetMappedData();
 	}
-	GfxLinearDynamicAllocator::GfxAllocationPage::GfxAllocationPage(GfxAllocationPage&&) = default;
 
 	GfxLinearDynamicAllocator::GfxAllocationPage::~GfxAllocationPage() = default;
-
-}
\ No newline at end of file
+}
@@ -1,28 +1,38 @@
 #pragma once
 #include <mutex>
+#include <atomic>
 #include "GfxDynamicAllocation.h"
-#include "Utilities/LinearAllocator.h"
 
 namespace adria
 {
 	class GfxBuffer;
 	class GfxDevice;
 
-	class GfxAllocationPage;
-	
 	class GfxLinearDynamicAllocator
 	{
 		static constexpr Uint32 PAGE_COUNT_HISTORY_SIZE = 8;
+		static constexpr Uint32 MAX_THREAD_COUNT = 64;
+		static constexpr Uint64 THREAD_CHUNK_SIZE = 64 * 1024;
+
 		struct GfxAllocationPage
 		{
 			std::unique_ptr<GfxBuffer> buffer;
-			LinearAllocator linear_allocator;
+			std::atomic<Uint64> top = 0;
+			Uint64 size;
 			void* cpu_address;
 
 			GfxAllocationPage(GfxDevice* gfx, Uint64 page_size);
-			GfxAllocationPage(GfxAllocationPage&&);
 			~GfxAllocationPage();
 		};
+
+		struct alignas(64) ThreadChunk
+		{
+			GfxAllocationPage* page = nullptr;
+			Uint64 offset = 0;
+			Uint64 end = 0;
+			Uint64 generation = 0;
+		};
+
 	public:
 		GfxLinearDynamicAllocator(GfxDevice* gfx, Uint64 page_size, Uint64 page_count = 1);
 		~GfxLinearDynamicAllocator();
@@ -37,10 +47,18 @@ namespace adria
 
 	private:
 		GfxDevice* gfx;
-		std::mutex alloc_mutex;
-		std::vector<GfxAllocationPage> alloc_pages;
+		std::mutex page_mutex;
+		std::vector<std::unique_ptr<GfxAllocationPage>> alloc_pages;
+		std::atomic<GfxAllocationPage*> current_page = nullptr;
+		Uint64 current_page_index = 0;
 		Uint64 const page_size;
-		Uint64 current_page = 0;
-		Uint64 used_page_count_history[PAGE_COUNT_HISTORY_SIZE];
+		Uint64 used_page_count_history[PAGE_COUNT_HISTORY_SIZE] = {};
+		Uint64 generation = 1;
+		ThreadChunk thread_chunks[MAX_THREAD_COUNT];
+
+	private:
+		Bool AllocateFromPage(GfxAllocationPage* page, Uint64 size, Uint64 alignment, Uint64& offset);
+		GfxAllocationPage* NextPage(GfxAllocationPage* exhausted_page, Uint64 min_size);
+		static GfxDynamicAllocation MakeAllocation(GfxAllocationPage* page, Uint64 offset, Uint64 size);
 	};
-}
\ No newline at end of file
+}
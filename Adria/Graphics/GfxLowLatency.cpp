@@ -0,0 +1,144 @@
+#include "GfxLowLatency.h"
+#include "GfxDevice.h"
+#include "Logging/Logger.h"
+#if GFX_NVIDIA_REFLEX
+#include "nvapi.h"
+#pragma comment(lib, "nvapi64.lib")
+#endif
+#if GFX_AMD_ANTILAG2
+#include "ffx_antilag2_dx12.h"
+#endif
+
+namespace adria
+{
+#if GFX_NVIDIA_REFLEX
+	namespace
+	{
+		NV_LATENCY_MARKER_TYPE ToNvLatencyMarker(GfxLatencyMarker marker)
+		{
+			switch (marker)
+			{
+			case GfxLatencyMarker::SimulationStart:	  return SIMULATION_START;
+			case GfxLatencyMarker::SimulationEnd:	  return SIMULATION_END;
+			case GfxLatencyMarker::RenderSubmitStart: return RENDERSUBMIT_START;
+			case GfxLatencyMarker::RenderSubmitEnd:	  return RENDERSUBMIT_END;
+			case GfxLatencyMarker::PresentStart:	  return PRESENT_START;
+			case GfxLatencyMarker::PresentEnd:		  return PRESENT_END;
+			case GfxLatencyMarker::InputSample:		  return INPUT_SAMPLE;
+			}
+			return SIMULATION_START;
+		}
+	}
+#endif
+
+	GfxLowLatency::GfxLowLatency(GfxDevice* gfx) : gfx(gfx)
+	{
+#if GFX_NVIDIA_REFLEX
+		if (gfx->GetVendor() == GfxVendor::Nvidia && NvAPI_Initialize() == NVAPI_OK)
+		{
+			NV_GET_SLEEP_STATUS_PARAMS sleep_status{};
+			sleep_status.version = NV_GET_SLEEP_STATUS_PARAMS_VER;
+			reflex_supported = NvAPI_D3D_GetSleepStatus(gfx->GetDevice(), &sleep_status) == NVAPI_OK;
+		}
+#endif
+#if GFX_AMD_ANTILAG2
+		if (gfx->GetVendor() == GfxVendor::AMD)
+		{
+			AMD::AntiLag2DX12::Context* context = new AMD::AntiLag2DX12::Context{};
+			if (AMD::AntiLag2DX12::Initialize(context, gfx->GetDevice()) == S_OK)
+			{
+				antilag2_context = context;
+				antilag2_supported = true;
+			}
+			else delete context;
+		}
+#endif
+	}
+
+	GfxLowLatency::~GfxLowLatency()
+	{
+		SetMode(GfxLowLatencyMode::Off);
+#if GFX_AMD_ANTILAG2
+		if (antilag2_context)
+		{
+			AMD::AntiLag2DX12::Context* context = static_cast<AMD::AntiLag2DX12::Context*>(antilag2_context);
+			AMD::AntiLag2DX12::DeInitialize(context);
+			delete context;
+		}
+#endif
+	}
+
+	Bool GfxLowLatency::IsSupported(GfxLowLatencyMode _mode) const
+	{
+		switch (_mode)
+		{
+		case GfxLowLatencyMode::Off:	  return true;
+		case GfxLowLatencyMode::Reflex:	  return reflex_supported;
+		case GfxLowLatencyMode::AntiLag2: return antilag2_supported;
+		}
+		return false;
+	}
+
+	void GfxLowLatency::SetMode(GfxLowLatencyMode _mode, Bool boost)
+	{
+		if (!IsSupported(_mode))
+		{
+			ADRIA_LOG(WARNING, "%s is not supported on this device!", GfxLowLatencyModeToString(_mode));
+			_mode = GfxLowLatencyMode::Off;
+		}
+#if GFX_NVIDIA_REFLEX
+		if (reflex_supported)
+		{
+			NV_SET_SLEEP_MODE_PARAMS sleep_params{};
+			sleep_params.version = NV_SET_SLEEP_MODE_PARAMS_VER;
+			sleep_params.bLowLatencyMode = _mode == GfxLowLatencyMode::Reflex;
+			sleep_params.bLowLatencyBoost = _mode == GfxLowLatencyMode::Reflex && boost;
+			sleep_params.minimumIntervalUs = 0;
+			NvAPI_D3D_SetSleepMode(gfx->GetDevice(), &sleep_params);
+		}
+#endif
+		mode = _mode;
+	}
+
+	void GfxLowLatency::Sleep()
+	{
+		switch (mode)
+		{
+		case GfxLowLatencyMode::Reflex:
+#if GFX_NVIDIA_REFLEX
+			NvAPI_D3D_Sleep(gfx->GetDevice());
+#endif
+			break;
+		case GfxLowLatencyMode::AntiLag2:
+#if GFX_AMD_ANTILAG2
+			AMD::AntiLag2DX12::Update(static_cast<AMD::AntiLag2DX12::Context*>(antilag2_context), true, 0);
+#endif
+			break;
+		}
+	}
+
+	void GfxLowLatency::SetMarker(GfxLatencyMarker marker, Uint64 frame_id)
+	{
+		LARGE_INTEGER now{};
+		QueryPerformanceCounter(&now);
+		marker_ticks[(Uint32)marker] = now.QuadPart;
+#if GFX_NVIDIA_REFLEX
+		if (mode == GfxLowLatencyMode::Reflex)
+		{
+			NV_LATENCY_MARKER_PARAMS marker_params{};
+			marker_params.version = NV_LATENCY_MARKER_PARAMS_VER;
+			marker_params.frameID = frame_id;
+			marker_params.markerType = ToNvLatencyMarker(marker);
+			NvAPI_D3D_SetLatencyMarker(gfx->GetDevice(), &marker_params);
+		}
+#endif
+	}
+
+	Float GfxLowLatency::GetMarkerDelta(GfxLatencyMarker begin, GfxLatencyMarker end) const
+	{
+		static LARGE_INTEGER qpc_frequency{};
+		if (qpc_frequency.QuadPart == 0) QueryPerformanceFrequency(&qpc_frequency);
+		Int64 const delta_ticks = marker_ticks[(Uint32)end] - marker_ticks[(Uint32)begin];
+		return delta_ticks > 0 ? (Float)(1000.0 * delta_ticks / qpc_frequency.QuadPart) : 0.0f;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "GfxMacros.h"
+
+namespace adria
+{
+	class GfxDevice;
+
+	enum class GfxLowLatencyMode : Uint8
+	{
+		Off,
+		Reflex,
+		AntiLag2
+	};
+
+	inline Char const* GfxLowLatencyModeToString(GfxLowLatencyMode mode)
+	{
+		switch (mode)
+		{
+		case GfxLowLatencyMode::Reflex:   return "NVIDIA Reflex";
+		case GfxLowLatencyMode::AntiLag2: return "AMD Anti-Lag 2";
+		}
+		return "Off";
+	}
+
+	enum class GfxLatencyMarker : Uint8
+	{
+		SimulationStart,
+		SimulationEnd,
+		RenderSubmitStart,
+		RenderSubmitEnd,
+		PresentStart,
+		PresentEnd,
+		InputSample,
+		Count
+	};
+
+	class GfxLowLatency
+	{
+	public:
+		explicit GfxLowLatency(GfxDevice* gfx);
+		~GfxLowLatency();
+
+		Bool IsSupported(GfxLowLatencyMode mode) const;
+		void SetMode(GfxLowLatencyMode mode, Bool boost = false);
+		GfxLowLatencyMode GetMode() const { return mode; }
+
+		void Sleep();
+		void SetMarker(GfxLatencyMarker marker, Uint64 frame_id);
+		Float GetMarkerDelta(GfxLatencyMarker begin, GfxLatencyMarker end) const;
+
+	private:
+		GfxDevice* gfx;
+		GfxLowLatencyMode mode = GfxLowLatencyMode::Off;
+		Bool reflex_supported = false;
+		Bool antilag2_supported = false;
+		Int64 marker_ticks[(Uint32)GfxLatencyMarker::Count] = {};
+#if GFX_AMD_ANTILAG2
+		void* antilag2_context = nullptr;
+#endif
+	};
+}
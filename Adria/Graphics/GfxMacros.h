@@ -3,9 +3,14 @@
 #define GFX_CHECK_HR(hr) if(FAILED(hr)) ADRIA_DEBUGBREAK();
 
 #define GFX_BACKBUFFER_COUNT 3
+#define GFX_PERSISTENT_DESCRIPTOR_COUNT 4096
 #define GFX_MULTITHREADED 0
 #define GFX_SHADER_PRINTF 1
 #define GFX_PROFILING 1
+#define GFX_NVIDIA_REFLEX 0
+#define GFX_AMD_ANTILAG2 0
+//opacity micromaps are part of DXR 1.2 and need the 1.717 agility sdk headers or newer
+#define GFX_OPACITY_MICROMAPS 0
 
 #if GFX_PROFILING
 #define GFX_PROFILING_USE_TRACY 0
@@ -0,0 +1,39 @@
+#include "GfxMemoryTracker.h"
+
+namespace adria
+{
+	namespace
+	{
+		thread_local GfxMemoryCategory current_category = GfxMemoryCategory::Other;
+	}
+
+	Char const* GfxMemoryCategoryToString(GfxMemoryCategory category)
+	{
+		switch (category)
+		{
+		case GfxMemoryCategory::Other:					return "Other";
+		case GfxMemoryCategory::Textures:				return "Textures";
+		case GfxMemoryCategory::Geometry:				return "Geometry";
+		case GfxMemoryCategory::RenderGraphTransients:	return "Render Graph Transients";
+		case GfxMemoryCategory::AccelerationStructures:	return "Acceleration Structures";
+		case GfxMemoryCategory::DynamicUpload:			return "Dynamic Upload";
+		case GfxMemoryCategory::DescriptorHeaps:		return "Descriptor Heaps";
+		}
+		return "Unknown";
+	}
+
+	GfxMemoryCategoryScope::GfxMemoryCategoryScope(GfxMemoryCategory category) : previous_category(current_category)
+	{
+		current_category = category;
+	}
+
+	GfxMemoryCategoryScope::~GfxMemoryCategoryScope()
+	{
+		current_category = previous_category;
+	}
+
+	GfxMemoryCategory GfxMemoryCategoryScope::Current()
+	{
+		return current_category;
+	}
+}
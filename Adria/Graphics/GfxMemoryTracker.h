@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+
+namespace adria
+{
+	enum class GfxMemoryCategory : Uint8
+	{
+		Other,
+		Textures,
+		Geometry,
+		RenderGraphTransients,
+		AccelerationStructures,
+		DynamicUpload,
+		DescriptorHeaps,
+		Count
+	};
+	Char const* GfxMemoryCategoryToString(GfxMemoryCategory category);
+
+	class GfxMemoryCategoryScope
+	{
+	public:
+		explicit GfxMemoryCategoryScope(GfxMemoryCategory category);
+		ADRIA_NONCOPYABLE_NONMOVABLE(GfxMemoryCategoryScope)
+		~GfxMemoryCategoryScope();
+
+		static GfxMemoryCategory Current();
+
+	private:
+		GfxMemoryCategory previous_category;
+	};
+
+	class GfxMemoryTracker
+	{
+		static constexpr Uint64 CategoryCount = (Uint64)GfxMemoryCategory::Count;
+
+	public:
+		void Allocate(GfxMemoryCategory category, Uint64 size)
+		{
+			Uint64 const usage = usages[(Uint64)category].fetch_add(size) + size;
+			Uint64 peak = peaks[(Uint64)category].load();
+			while (usage > peak && !peaks[(Uint64)category].compare_exchange_weak(peak, usage));
+		}
+		void Free(GfxMemoryCategory category, Uint64 size)
+		{
+			usages[(Uint64)category].fetch_sub(size);
+		}
+
+		Uint64 GetUsage(GfxMemoryCategory category) const { return usages[(Uint64)category].load(); }
+		Uint64 GetPeakUsage(GfxMemoryCategory category) const { return peaks[(Uint64)category].load(); }
+
+	private:
+		std::array<std::atomic<Uint64>, CategoryCount> usages{};
+		std::array<std::atomic<Uint64>, CategoryCount> peaks{};
+	};
+}
@@ -12,5 +12,10 @@ namespace adria
 		Bool aftermath = false;
 		Bool vsync = false;
 		Bool shader_debug = false;
+		//renders into offscreen backbuffers without a window or a DXGI swapchain
+		Bool headless = false;
+		Uint32 headless_width = 1920;
+		Uint32 headless_height = 1080;
+		Uint32 headless_frames_in_flight = 3;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include <fstream>
+#include "GfxPipelineLibrary.h"
+#include "GfxDevice.h"
+#include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> PipelineLibrary("r.PipelineLibrary", true, "Cache compiled pipeline states between runs using ID3D12PipelineLibrary");
+
+	static constexpr Uint32 PIPELINE_LIBRARY_MAGIC = 0x4C505341;
+	static constexpr Uint32 PIPELINE_LIBRARY_VERSION = 1;
+
+	namespace
+	{
+		std::string GetPipelineLibraryPath()
+		{
+			return paths::ShaderCacheDir + "PipelineLibrary.bin";
+		}
+	}
+
+	GfxPipelineLibrary::GfxPipelineLibrary(GfxDevice* gfx, IDXGIAdapter4* adapter) : gfx(gfx)
+	{
+		DXGI_ADAPTER_DESC3 adapter_desc{};
+		adapter->GetDesc3(&adapter_desc);
+		LARGE_INTEGER driver_version{};
+		adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver_version);
+
+		adapter_header.magic = PIPELINE_LIBRARY_MAGIC;
+		adapter_header.version = PIPELINE_LIBRARY_VERSION;
+		adapter_header.vendor_id = adapter_desc.VendorId;
+		adapter_header.device_id = adapter_desc.DeviceId;
+		adapter_header.subsystem_id = adapter_desc.SubSysId;
+		adapter_header.revision = adapter_desc.Revision;
+		adapter_header.driver_version = driver_version.QuadPart;
+
+		if (!PipelineLibrary.Get()) return;
+		Load();
+	}
+
+	GfxPipelineLibrary::~GfxPipelineLibrary()
+	{
+		Save();
+	}
+
+	Ref<ID3D12PipelineState> GfxPipelineLibrary::CreateGraphicsPipelineState(Uint64 key, D3D12_GRAPHICS_PIPELINE_STATE_DESC const& desc)
+	{
+		Ref<ID3D12PipelineState> pso;
+		std::wstring name = std::to_wstring(key);
+		if (library)
+		{
+			std::lock_guard lock(library_mutex);
+			if (SUCCEEDED(library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf())))) return pso;
+		}
+		GFX_CHECK_HR(gfx->GetDevice()->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+		StorePipeline(name, pso.Get());
+		return pso;
+	}
+
+	Ref<ID3D12PipelineState> GfxPipelineLibrary::CreateComputePipelineState(Uint64 key, D3D12_COMPUTE_PIPELINE_STATE_DESC const& desc)
+	{
+		Ref<ID3D12PipelineState> pso;
+		std::wstring name = std::to_wstring(key);
+		if (library)
+		{
+			std::lock_guard lock(library_mutex);
+			if (SUCCEEDED(library->LoadComputePipeline(name.c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf())))) return pso;
+		}
+		GFX_CHECK_HR(gfx->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+		StorePipeline(name, pso.Get());
+		return pso;
+	}
+
+	Ref<ID3D12PipelineState> GfxPipelineLibrary::CreatePipelineState(Uint64 key, D3D12_PIPELINE_STATE_STREAM_DESC const& desc)
+	{
+		Ref<ID3D12PipelineState> pso;
+		std::wstring name = std::to_wstring(key);
+		if (library)
+		{
+			std::lock_guard lock(library_mutex);
+			if (SUCCEEDED(library->LoadPipeline(name.c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf())))) return pso;
+		}
+		GFX_CHECK_HR(gfx->GetDevice()->CreatePipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+		StorePipeline(name, pso.Get());
+		return pso;
+	}
+
+	void GfxPipelineLibrary::Save()
+	{
+		std::lock_guard lock(library_mutex);
+		if (!library || !dirty) return;
+
+		Uint64 const serialized_size = library->GetSerializedSize();
+		std::vector<Uint8> serialized_data(serialized_size);
+		if (FAILED(library->Serialize(serialized_data.data(), serialized_size)))
+		{
+			ADRIA_LOG(WARNING, "Failed to serialize pipeline library!");
+			return;
+		}
+
+		GfxPipelineLibraryHeader header = adapter_header;
+		header.data_size = serialized_size;
+		std::ofstream os(GetPipelineLibraryPath(), std::ios::binary);
+		os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+		os.write(reinterpret_cast<Char const*>(serialized_data.data()), serialized_size);
+		dirty = false;
+	}
+
+	void GfxPipelineLibrary::Load()
+	{
+		std::ifstream is(GetPipelineLibraryPath(), std::ios::binary);
+		GfxPipelineLibraryHeader header{};
+		if (!is || !is.read(reinterpret_cast<Char*>(&header), sizeof(header)))
+		{
+			CreateEmptyLibrary();
+			return;
+		}
+
+		Bool const matches_adapter = header.magic == adapter_header.magic && header.version == adapter_header.version &&
+									 header.vendor_id == adapter_header.vendor_id && header.device_id == adapter_header.device_id &&
+									 header.subsystem_id == adapter_header.subsystem_id && header.revision == adapter_header.revision &&
+									 header.driver_version == adapter_header.driver_version;
+		if (!matches_adapter)
+		{
+			ADRIA_LOG(INFO, "Pipeline library was created for a different adapter or driver, discarding it");
+			CreateEmptyLibrary();
+			return;
+		}
+
+		library_data.resize(header.data_size);
+		if (!is.read(reinterpret_cast<Char*>(library_data.data()), header.data_size))
+		{
+			CreateEmptyLibrary();
+			return;
+		}
+
+		HRESULT hr = gfx->GetDevice()->CreatePipelineLibrary(library_data.data(), library_data.size(), IID_PPV_ARGS(library.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ADRIA_LOG(INFO, "Pipeline library could not be loaded (0x%08X), discarding it", (Uint32)hr);
+			CreateEmptyLibrary();
+			return;
+		}
+		ADRIA_LOG(INFO, "Loaded pipeline library (%llu bytes)", header.data_size);
+	}
+
+	void GfxPipelineLibrary::CreateEmptyLibrary()
+	{
+		library.Reset();
+		library_data.clear();
+		HRESULT hr = gfx->GetDevice()->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(library.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ADRIA_LOG(WARNING, "Pipeline libraries are not supported (0x%08X)", (Uint32)hr);
+			library.Reset();
+			return;
+		}
+		dirty = true;
+	}
+
+	void GfxPipelineLibrary::StorePipeline(std::wstring const& name, ID3D12PipelineState* pso)
+	{
+		if (!library) return;
+		std::lock_guard lock(library_mutex);
+		if (SUCCEEDED(library->StorePipeline(name.c_str(), pso))) dirty = true;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <mutex>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+namespace adria
+{
+	class GfxDevice;
+
+	class GfxPipelineLibrary
+	{
+	public:
+		GfxPipelineLibrary(GfxDevice* gfx, IDXGIAdapter4* adapter);
+		~GfxPipelineLibrary();
+
+		Ref<ID3D12PipelineState> CreateGraphicsPipelineState(Uint64 key, D3D12_GRAPHICS_PIPELINE_STATE_DESC const& desc);
+		Ref<ID3D12PipelineState> CreateComputePipelineState(Uint64 key, D3D12_COMPUTE_PIPELINE_STATE_DESC const& desc);
+		Ref<ID3D12PipelineState> CreatePipelineState(Uint64 key, D3D12_PIPELINE_STATE_STREAM_DESC const& desc);
+		void Save();
+
+	private:
+		struct GfxPipelineLibraryHeader
+		{
+			Uint32 magic;
+			Uint32 version;
+			Uint32 vendor_id;
+			Uint32 device_id;
+			Uint32 subsystem_id;
+			Uint32 revision;
+			Uint64 driver_version;
+			Uint64 data_size;
+		};
+
+		GfxDevice* gfx;
+		std::vector<Uint8> library_data;
+		Ref<ID3D12PipelineLibrary1> library;
+		GfxPipelineLibraryHeader adapter_header{};
+		std::mutex library_mutex;
+		Bool dirty = false;
+
+	private:
+		void Load();
+		void CreateEmptyLibrary();
+		void StorePipeline(std::wstring const& name, ID3D12PipelineState* pso);
+	};
+}
@@ -1,16 +1,21 @@
 #include "d3dx12_pipeline_state_stream.h"
 #include "GfxPipelineState.h"
+#include "GfxPipelineLibrary.h"
 #include "GfxDevice.h"
 #include "GfxStates.h"
 #include "GfxShader.h"
 #include "GfxResourceCommon.h"
 #include "Rendering/ShaderManager.h"
 #include "Utilities/HashUtil.h"
+#include "Utilities/ThreadPool.h"
 
 namespace adria
 {
 	namespace
 	{
+		std::mutex pending_pipeline_states_mutex;
+		std::vector<GfxPipelineState*> pending_pipeline_states;
+
 		constexpr D3D12_FILL_MODE ConvertFillMode(GfxFillMode value)
 		{
 			switch (value)
@@ -297,6 +302,42 @@ namespace adria
 			}
 			return D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED;
 		}
+		void CombineBytecodeHash(HashState& state, D3D12_SHADER_BYTECODE const& bytecode)
+		{
+			if (bytecode.BytecodeLength == 0) return;
+			state.Combine(crc64(static_cast<Char const*>(bytecode.pShaderBytecode), bytecode.BytecodeLength));
+		}
+		template<typename T>
+		void CombineStateHash(HashState& state, T const& value)
+		{
+			state.Combine(crc64(reinterpret_cast<Char const*>(&value), sizeof(T)));
+		}
+		template<typename D3D12PipelineStateDesc>
+		void CombineOutputStateHash(HashState& state, D3D12PipelineStateDesc const& desc)
+		{
+			CombineStateHash(state, desc.BlendState);
+			CombineStateHash(state, desc.RasterizerState);
+			CombineStateHash(state, desc.DepthStencilState);
+			state.Combine(desc.SampleMask);
+			state.Combine(desc.PrimitiveTopologyType);
+			state.Combine(desc.NumRenderTargets);
+			for (DXGI_FORMAT rtv_format : desc.RTVFormats) state.Combine(rtv_format);
+			state.Combine(desc.DSVFormat);
+		}
+		void CombineInputLayoutHash(HashState& state, D3D12_INPUT_LAYOUT_DESC const& input_layout)
+		{
+			for (Uint32 i = 0; i < input_layout.NumElements; ++i)
+			{
+				D3D12_INPUT_ELEMENT_DESC const& element = input_layout.pInputElementDescs[i];
+				state.Combine(crc64(element.SemanticName, strlen(element.SemanticName)));
+				state.Combine(element.SemanticIndex);
+				state.Combine(element.Format);
+				state.Combine(element.InputSlot);
+				state.Combine(element.AlignedByteOffset);
+				state.Combine(element.InputSlotClass);
+				state.Combine(element.InstanceDataStepRate);
+			}
+		}
 		inline void ConvertInputLayout(GfxInputLayout const& input_layout, std::vector<D3D12_INPUT_ELEMENT_DESC>& element_descs)
 		{
 			element_descs.resize(input_layout.elements.size());
@@ -325,18 +366,56 @@ namespace adria
 		}
 	}
 
+	GfxPipelineState::~GfxPipelineState()
+	{
+		if (!recreate_task.valid()) return;
+		recreate_task.wait();
+		std::lock_guard lock(pending_pipeline_states_mutex);
+		std::erase(pending_pipeline_states, this);
+	}
+
 	GfxPipelineState::operator ID3D12PipelineState* () const
 	{
 		return pso.Get();
 	}
 
+	void GfxPipelineState::UpdatePendingPipelineStates()
+	{
+		std::lock_guard lock(pending_pipeline_states_mutex);
+		std::erase_if(pending_pipeline_states, [](GfxPipelineState* pipeline_state)
+			{
+				if (pipeline_state->recreate_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+				Ref<ID3D12PipelineState> new_pso = pipeline_state->recreate_task.get();
+				if (new_pso)
+				{
+					pipeline_state->gfx->AddToReleaseQueue(pipeline_state->pso.Detach());
+					pipeline_state->pso = std::move(new_pso);
+				}
+				return true;
+			});
+	}
+
+	void GfxPipelineState::RecreateAsync(std::function<Ref<ID3D12PipelineState>()>&& create)
+	{
+		if (recreate_task.valid()) recreate_task.wait();
+		recreate_task = g_ThreadPool.Submit(std::move(create));
+
+		std::lock_guard lock(pending_pipeline_states_mutex);
+		if (std::find(pending_pipeline_states.begin(), pending_pipeline_states.end(), this) == pending_pipeline_states.end())
+		{
+			pending_pipeline_states.push_back(this);
+		}
+	}
+
 	GfxGraphicsPipelineState::GfxGraphicsPipelineState(GfxDevice* gfx, GfxGraphicsPipelineStateDesc const& desc) : GfxPipelineState(gfx, GfxPipelineStateType::Graphics), desc(desc)
 	{
-		Create(desc);
+		pso = Create(gfx, desc);
+		std::lock_guard lock(ShaderManager::GetEventMutex());
 		event_handle = ShaderManager::GetShaderRecompiledEvent().AddMember(&GfxGraphicsPipelineState::OnShaderRecompiled, *this);
 	}
 	GfxGraphicsPipelineState::~GfxGraphicsPipelineState()
 	{
+		std::lock_guard lock(ShaderManager::GetEventMutex());
 		ShaderManager::GetShaderRecompiledEvent().Remove(event_handle);
 	}
 	void GfxGraphicsPipelineState::OnShaderRecompiled(GfxShaderKey const& s)
@@ -346,12 +425,12 @@ namespace adria
 		{
 			if (s == shaders[i])
 			{
-				Create(desc);
+				RecreateAsync([gfx = gfx, desc = desc]() { return Create(gfx, desc); });
 				return;
 			}
 		}
 	}
-	void GfxGraphicsPipelineState::Create(GfxGraphicsPipelineStateDesc const& desc)
+	Ref<ID3D12PipelineState> GfxGraphicsPipelineState::Create(GfxDevice* gfx, GfxGraphicsPipelineStateDesc const& desc)
 	{
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12_desc{};
 		d3d12_desc.pRootSignature = gfx->GetCommonRootSignature();
@@ -376,45 +455,60 @@ namespace adria
 		d3d12_desc.PrimitiveTopologyType = ConvertPrimitiveTopologyType(desc.topology_type);
 		d3d12_desc.SampleMask = desc.sample_mask;
 		if (d3d12_desc.DSVFormat == DXGI_FORMAT_UNKNOWN) d3d12_desc.DepthStencilState.DepthEnable = false;
-		HRESULT hr = gfx->GetDevice()->CreateGraphicsPipelineState(&d3d12_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf()));
-		GFX_CHECK_HR(hr);
+
+		HashState pso_key;
+		CombineOutputStateHash(pso_key, d3d12_desc);
+		CombineInputLayoutHash(pso_key, d3d12_desc.InputLayout);
+		CombineBytecodeHash(pso_key, d3d12_desc.VS);
+		CombineBytecodeHash(pso_key, d3d12_desc.PS);
+		CombineBytecodeHash(pso_key, d3d12_desc.GS);
+		CombineBytecodeHash(pso_key, d3d12_desc.HS);
+		CombineBytecodeHash(pso_key, d3d12_desc.DS);
+		return gfx->GetPipelineLibrary()->CreateGraphicsPipelineState(pso_key, d3d12_desc);
 	}
 
 	GfxComputePipelineState::GfxComputePipelineState(GfxDevice* gfx, GfxComputePipelineStateDesc const& desc) : GfxPipelineState(gfx, GfxPipelineStateType::Compute), desc(desc)
 	{
-		Create(desc);
+		pso = Create(gfx, desc);
+		std::lock_guard lock(ShaderManager::GetEventMutex());
 		event_handle = ShaderManager::GetShaderRecompiledEvent().AddMember(&GfxComputePipelineState::OnShaderRecompiled, *this);
 	}
 	GfxComputePipelineState::~GfxComputePipelineState()
 	{
+		std::lock_guard lock(ShaderManager::GetEventMutex());
 		ShaderManager::GetShaderRecompiledEvent().Remove(event_handle);
 	}
 	void GfxComputePipelineState::OnShaderRecompiled(GfxShaderKey const& s)
 	{
-		if (s == desc.CS) Create(desc);
+		if (s == desc.CS) RecreateAsync([gfx = gfx, desc = desc]() { return Create(gfx, desc); });
 	}
-	void GfxComputePipelineState::Create(GfxComputePipelineStateDesc const& desc)
+	Ref<ID3D12PipelineState> GfxComputePipelineState::Create(GfxDevice* gfx, GfxComputePipelineStateDesc const& desc)
 	{
 		D3D12_COMPUTE_PIPELINE_STATE_DESC d3d12_desc{};
 		d3d12_desc.pRootSignature = gfx->GetCommonRootSignature();
 		d3d12_desc.CS = GetGfxShader(desc.CS);
-		GFX_CHECK_HR(gfx->GetDevice()->CreateComputePipelineState(&d3d12_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf())));
+
+		HashState pso_key;
+		CombineBytecodeHash(pso_key, d3d12_desc.CS);
+		return gfx->GetPipelineLibrary()->CreateComputePipelineState(pso_key, d3d12_desc);
 	}
 
 	GfxMeshShaderPipelineState::GfxMeshShaderPipelineState(GfxDevice* gfx, GfxMeshShaderPipelineStateDesc const& desc) : GfxPipelineState(gfx, GfxPipelineStateType::MeshShader), desc(desc)
 	{
-		Create(desc);
+		pso = Create(gfx, desc);
+		std::lock_guard lock(ShaderManager::GetEventMutex());
 		event_handle = ShaderManager::GetShaderRecompiledEvent().AddMember(&GfxMeshShaderPipelineState::OnShaderRecompiled, *this);
 	}
 	GfxMeshShaderPipelineState::~GfxMeshShaderPipelineState()
 	{
+		std::lock_guard lock(ShaderManager::GetEventMutex());
 		ShaderManager::GetShaderRecompiledEvent().Remove(event_handle);
 	}
 	void GfxMeshShaderPipelineState::OnShaderRecompiled(GfxShaderKey const& s)
 	{
-		if (s == desc.AS || s == desc.MS || s == desc.PS) Create(desc);
+		if (s == desc.AS || s == desc.MS || s == desc.PS) RecreateAsync([gfx = gfx, desc = desc]() { return Create(gfx, desc); });
 	}
-	void GfxMeshShaderPipelineState::Create(GfxMeshShaderPipelineStateDesc const& desc)
+	Ref<ID3D12PipelineState> GfxMeshShaderPipelineState::Create(GfxDevice* gfx, GfxMeshShaderPipelineStateDesc const& desc)
 	{
 		D3DX12_MESH_SHADER_PIPELINE_STATE_DESC d3d12_desc{};
 
@@ -441,7 +535,12 @@ namespace adria
 		stream_desc.pPipelineStateSubobjectStream = &pso_stream;
 		stream_desc.SizeInBytes = sizeof(pso_stream);
 
-		GFX_CHECK_HR(gfx->GetDevice()->CreatePipelineState(&stream_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf())));
+		HashState pso_key;
+		CombineOutputStateHash(pso_key, d3d12_desc);
+		CombineBytecodeHash(pso_key, d3d12_desc.AS);
+		CombineBytecodeHash(pso_key, d3d12_desc.MS);
+		CombineBytecodeHash(pso_key, d3d12_desc.PS);
+		return gfx->GetPipelineLibrary()->CreatePipelineState(pso_key, stream_desc);
 	}
 
 }
\ No newline at end of file
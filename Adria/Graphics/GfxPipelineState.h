@@ -1,4 +1,6 @@
 #pragma once
+#include <future>
+#include <functional>
 #include "GfxStates.h"
 #include "GfxShaderKey.h"
 #include "GfxInputLayout.h"
@@ -27,14 +29,20 @@ namespace adria
 		operator ID3D12PipelineState*() const;
 		GfxPipelineStateType GetType() const { return type; }
 
+		static void UpdatePendingPipelineStates();
+
 	protected:
 		GfxPipelineState(GfxDevice* gfx, GfxPipelineStateType type) : gfx(gfx), type(type) {}
+		~GfxPipelineState();
+
+		void RecreateAsync(std::function<Ref<ID3D12PipelineState>()>&& create);
 
 	protected:
 		GfxDevice* gfx;
 		Ref<ID3D12PipelineState> pso;
 		GfxPipelineStateType type;
 		DelegateHandle event_handle;
+		std::future<Ref<ID3D12PipelineState>> recreate_task;
 	};
 
 	struct GfxGraphicsPipelineStateDesc
@@ -65,7 +73,7 @@ namespace adria
 		GfxGraphicsPipelineStateDesc desc;
 	private:
 		void OnShaderRecompiled(GfxShaderKey const&);
-		void Create(GfxGraphicsPipelineStateDesc const& desc);
+		static Ref<ID3D12PipelineState> Create(GfxDevice* gfx, GfxGraphicsPipelineStateDesc const& desc);
 	};
 
 	struct GfxComputePipelineStateDesc
@@ -84,7 +92,7 @@ namespace adria
 		
 	private:
 		void OnShaderRecompiled(GfxShaderKey const&);
-		void Create(GfxComputePipelineStateDesc const& desc);
+		static Ref<ID3D12PipelineState> Create(GfxDevice* gfx, GfxComputePipelineStateDesc const& desc);
 	};
 
 	struct GfxMeshShaderPipelineStateDesc
@@ -113,6 +121,6 @@ namespace adria
 
 	private:
 		void OnShaderRecompiled(GfxShaderKey const&);
-		void Create(GfxMeshShaderPipelineStateDesc const& desc);
+		static Ref<ID3D12PipelineState> Create(GfxDevice* gfx, GfxMeshShaderPipelineStateDesc const& desc);
 	};
 }
\ No newline at end of file
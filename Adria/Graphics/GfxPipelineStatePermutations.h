@@ -1,7 +1,9 @@
 #pragma once
+#include <future>
 #include "GfxPipelineState.h"
 #include "GfxShaderEnums.h"
 #include "Utilities/HashUtil.h"
+#include "Utilities/ThreadPool.h"
 
 namespace adria
 {
@@ -12,13 +14,15 @@ namespace adria
 	{
 		ADRIA_NODISCARD Uint64 operator()(GfxGraphicsPipelineStateDesc const& desc) const
 		{
+			//shader keys carry their own cached hash, only the fixed function state in front of them is hashed bytewise
 			HashState state;
-			state.Combine(crc64(reinterpret_cast<Char const*>(&desc), sizeof(GfxGraphicsPipelineStateDesc)));
+			state.Combine(crc64(reinterpret_cast<Char const*>(&desc), offsetof(GfxGraphicsPipelineStateDesc, VS)));
 			state.Combine(desc.VS.GetHash());
 			state.Combine(desc.PS.GetHash());
 			state.Combine(desc.DS.GetHash());
 			state.Combine(desc.HS.GetHash());
 			state.Combine(desc.GS.GetHash());
+			state.Combine((Uint64)desc.sample_mask);
 			return state;
 		}
 	};
@@ -27,7 +31,7 @@ namespace adria
 		ADRIA_NODISCARD Uint64 operator()(GfxComputePipelineStateDesc const& desc) const
 		{
 			HashState state;
-			state.Combine(crc64(reinterpret_cast<Char const*>(&desc), sizeof(GfxComputePipelineStateDesc)));
+			state.Combine((Uint64)desc.root_signature);
 			state.Combine(desc.CS.GetHash());
 			return state;
 		}
@@ -37,10 +41,11 @@ namespace adria
 		ADRIA_NODISCARD Uint64 operator()(GfxMeshShaderPipelineStateDesc const& desc) const
 		{
 			HashState state;
-			state.Combine(crc64(reinterpret_cast<Char const*>(&desc), sizeof(GfxMeshShaderPipelineStateDesc)));
+			state.Combine(crc64(reinterpret_cast<Char const*>(&desc), offsetof(GfxMeshShaderPipelineStateDesc, AS)));
 			state.Combine(desc.AS.GetHash());
 			state.Combine(desc.MS.GetHash());
 			state.Combine(desc.PS.GetHash());
+			state.Combine((Uint64)desc.sample_mask);
 			return state;
 		}
 	};
@@ -105,7 +110,10 @@ namespace adria
 			: gfx(gfx), base_pso_desc(desc), current_pso_desc(desc)
 		{
 		}
-		~GfxPipelineStatePermutations() = default;
+		~GfxPipelineStatePermutations()
+		{
+			FinishPrecompile();
+		}
 		ADRIA_NONCOPYABLE(GfxPipelineStatePermutations)
 
 		void AddDefine(Char const* name, Char const* value)
@@ -180,23 +188,152 @@ namespace adria
 			f(current_pso_desc);
 		}
 
+		void SetAsyncCompilation(Bool _async_compilation)
+		{
+			async_compilation = _async_compilation;
+		}
+		void SetFallbackPermutation()
+		{
+			fallback_pso_hash = PSODescHasher{}(current_pso_desc);
+			if (!pso_permutations.contains(fallback_pso_hash))
+			{
+				FinishPrecompileTask(fallback_pso_hash);
+				if (!pso_permutations.contains(fallback_pso_hash)) pso_permutations[fallback_pso_hash] = std::make_unique<PSO>(gfx, current_pso_desc);
+			}
+			current_pso_desc = base_pso_desc;
+		}
+
+		void DeclarePermutation()
+		{
+			declared_pso_descs.push_back(current_pso_desc);
+			current_pso_desc = base_pso_desc;
+		}
+
+		void Precompile()
+		{
+			for (PSODesc const& pso_desc : declared_pso_descs)
+			{
+				Uint64 pso_hash = PSODescHasher{}(pso_desc);
+				if (pso_permutations.contains(pso_hash) || precompile_tasks.contains(pso_hash)) continue;
+				precompile_tasks[pso_hash] = g_ThreadPool.Submit([gfx = gfx, pso_desc]() { return std::make_unique<PSO>(gfx, pso_desc); });
+			}
+			declared_pso_descs.clear();
+		}
+
 		PSO* Get() const
 		{
 			Uint64 pso_hash = PSODescHasher{}(current_pso_desc);
-			if (!pso_permutations.contains(pso_hash))
+			PSO* pso = nullptr;
+			if (async_compilation)
 			{
-				pso_permutations[pso_hash] = std::make_unique<PSO>(gfx, current_pso_desc);
+				CollectReadyPrecompileTasks();
+				if (!pso_permutations.contains(pso_hash))
+				{
+					if (!precompile_tasks.contains(pso_hash))
+					{
+						precompile_tasks[pso_hash] = g_ThreadPool.Submit([gfx = gfx, pso_desc = current_pso_desc]() { return std::make_unique<PSO>(gfx, pso_desc); });
+					}
+					pso = GetFallback();
+				}
+			}
+			else
+			{
+				FinishPrecompile();
+			}
+
+			if (!pso)
+			{
+				if (!pso_permutations.contains(pso_hash))
+				{
+					pso_permutations[pso_hash] = std::make_unique<PSO>(gfx, current_pso_desc);
+				}
+				pso = pso_permutations[pso_hash].get();
 			}
-			PSO* pso = pso_permutations[pso_hash].get();
 			current_pso_desc = base_pso_desc;
 			return pso;
 		}
+		//permutation keys are small compile time bitmasks built by the caller, apply adds the matching defines
+		//the first time a key is seen and once its pso is compiled later lookups skip building and hashing the desc
+		template<typename F> requires std::is_invocable_v<F, GfxPipelineStatePermutations&>
+		PSO* Get(Uint32 permutation_key, F&& apply)
+		{
+			if (permutation_key < keyed_psos.size() && keyed_psos[permutation_key]) return keyed_psos[permutation_key];
+
+			apply(*this);
+			Uint64 const pso_hash = PSODescHasher{}(current_pso_desc);
+			PSO* pso = Get();
+			auto it = pso_permutations.find(pso_hash);
+			if (it != pso_permutations.end() && it->second.get() == pso)
+			{
+				if (permutation_key >= keyed_psos.size()) keyed_psos.resize(permutation_key + 1, nullptr);
+				keyed_psos[permutation_key] = pso;
+			}
+			return pso;
+		}
+		Bool IsReady() const
+		{
+			Uint64 pso_hash = PSODescHasher{}(current_pso_desc);
+			CollectReadyPrecompileTasks();
+			return pso_permutations.contains(pso_hash);
+		}
 
 	private:
 		GfxDevice* gfx;
 		PSODesc const base_pso_desc;
 		mutable PSOPermutationMap pso_permutations;
 		mutable PSODesc current_pso_desc;
+		std::vector<PSODesc> declared_pso_descs;
+		std::vector<PSO*> keyed_psos;
+		mutable std::unordered_map<Uint64, std::future<std::unique_ptr<PSO>>> precompile_tasks;
+		mutable Uint64 fallback_pso_hash = 0;
+		Bool async_compilation = false;
+
+	private:
+		void FinishPrecompile() const
+		{
+			if (precompile_tasks.empty()) return;
+			for (auto& [pso_hash, precompile_task] : precompile_tasks)
+			{
+				pso_permutations[pso_hash] = precompile_task.get();
+			}
+			precompile_tasks.clear();
+		}
+		void FinishPrecompileTask(Uint64 pso_hash) const
+		{
+			auto it = precompile_tasks.find(pso_hash);
+			if (it == precompile_tasks.end()) return;
+			pso_permutations[pso_hash] = it->second.get();
+			precompile_tasks.erase(it);
+		}
+		void CollectReadyPrecompileTasks() const
+		{
+			for (auto it = precompile_tasks.begin(); it != precompile_tasks.end();)
+			{
+				if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+				{
+					pso_permutations[it->first] = it->second.get();
+					it = precompile_tasks.erase(it);
+				}
+				else ++it;
+			}
+		}
+		PSO* GetFallback() const
+		{
+			if (fallback_pso_hash == 0)
+			{
+				fallback_pso_hash = PSODescHasher{}(base_pso_desc);
+			}
+			if (!pso_permutations.contains(fallback_pso_hash))
+			{
+				FinishPrecompileTask(fallback_pso_hash);
+				if (!pso_permutations.contains(fallback_pso_hash))
+				{
+					ADRIA_ASSERT(fallback_pso_hash == PSODescHasher{}(base_pso_desc));
+					pso_permutations[fallback_pso_hash] = std::make_unique<PSO>(gfx, base_pso_desc);
+				}
+			}
+			return pso_permutations[fallback_pso_hash].get();
+		}
 	};
 
 	using GfxGraphicsPipelineStatePermutations	 = GfxPipelineStatePermutations<GfxGraphicsPipelineState>;
@@ -11,27 +11,35 @@
 #include "GfxCommandList.h"
 #include "GfxQueryHeap.h"
 #include "GfxBuffer.h"
+#include "Core/ConsoleManager.h"
 
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> PipelineStatistics("rhi.PipelineStatistics", false, "0: Disabled, 1: Profile scopes on the graphics queue also collect pipeline statistics");
+
 	struct GfxProfiler::Impl
 	{
 		static constexpr Uint64 FRAME_COUNT = GFX_BACKBUFFER_COUNT;
-		static constexpr Uint64 MAX_PROFILES = 256;
+		static constexpr Uint64 MAX_PROFILES = 1024;
 
 		struct QueryData
 		{
 			Bool query_started = false;
 			Bool query_finished = false;
+			Bool pipeline_statistics = false;
 			GfxCommandList* cmd_list = nullptr;
 		};
 
 		GfxDevice* gfx = nullptr;
 		std::unique_ptr<GfxQueryHeap> query_heap;
 		std::unique_ptr<GfxBuffer> query_readback_buffer;
+		std::unique_ptr<GfxQueryHeap> statistics_query_heap;
+		std::unique_ptr<GfxBuffer> statistics_readback_buffer;
+		Uint64 statistics_size = 0;
 
 		std::array<QueryData, MAX_PROFILES> query_data;
+		Float frame_gpu_time_ms = 0.0f;
 		std::unordered_map<std::string, Uint32> name_to_index_map;
 
 #if GFX_MULTITHREADED
@@ -50,11 +58,22 @@ namespace adria
 			query_heap_desc.count = MAX_PROFILES * 2;
 			query_heap_desc.type = GfxQueryType::Timestamp;
 			query_heap = gfx->CreateQueryHeap(query_heap_desc);
+
+			Bool const statistics1 = gfx->GetCapabilities().SupportsMeshShaderPipelineStatistics();
+			statistics_size = statistics1 ? sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS1) : sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS);
+			statistics_readback_buffer = gfx->CreateBuffer(ReadBackBufferDesc(MAX_PROFILES * FRAME_COUNT * statistics_size));
+
+			GfxQueryHeapDesc statistics_query_heap_desc{};
+			statistics_query_heap_desc.count = MAX_PROFILES;
+			statistics_query_heap_desc.type = statistics1 ? GfxQueryType::PipelineStatistics1 : GfxQueryType::PipelineStatistics;
+			statistics_query_heap = gfx->CreateQueryHeap(statistics_query_heap_desc);
 		}
 		void Destroy()
 		{
 			query_heap.reset();
 			query_readback_buffer.reset();
+			statistics_query_heap.reset();
+			statistics_readback_buffer.reset();
 			gfx = nullptr;
 		}
 		void NewFrame()
@@ -62,6 +81,7 @@ namespace adria
 			for (auto& profile_data : query_data)
 			{
 				profile_data.query_started = profile_data.query_finished = false;
+				profile_data.pipeline_statistics = false;
 				profile_data.cmd_list = nullptr;
 			}
 			name_to_index_map.clear();
@@ -70,9 +90,10 @@ namespace adria
 		void BeginProfileScope(GfxCommandList* cmd_list, Char const* name)
 		{
 			Uint32 profile_index = scope_counter++;
+			if (profile_index >= MAX_PROFILES) return;
 #if GFX_MULTITHREADED
 			{
-				std::scoped_lock(map_mutex);
+				std::scoped_lock lock(map_mutex);
 				name_to_index_map[name] = profile_index;
 			}
 #else
@@ -83,6 +104,11 @@ namespace adria
 			ADRIA_ASSERT(profile_data.query_finished == false);
 			Uint32 begin_query_index = Uint32(profile_index * 2);
 			cmd_list->BeginQuery(*query_heap, begin_query_index);
+			if (PipelineStatistics.Get() && cmd_list->GetType() == GfxCommandListType::Graphics)
+			{
+				cmd_list->BeginQuery(*statistics_query_heap, profile_index);
+				profile_data.pipeline_statistics = true;
+			}
 			profile_data.query_started = true;
 			profile_data.cmd_list = cmd_list;
 		}
@@ -91,21 +117,45 @@ namespace adria
 			Uint32 profile_index = -1;
 #if GFX_MULTITHREADED
 			{
-				std::scoped_lock(map_mutex);
-				profile_index = name_to_index_map[name];
+				std::scoped_lock lock(map_mutex);
+				if (auto it = name_to_index_map.find(name); it != name_to_index_map.end()) profile_index = it->second;
 			}
 #else
-			profile_index = name_to_index_map[name];
+			if (auto it = name_to_index_map.find(name); it != name_to_index_map.end()) profile_index = it->second;
 #endif
-			ADRIA_ASSERT(profile_index != Uint32(-1));
+			if (profile_index == Uint32(-1)) return;
 			QueryData& profile_data = query_data[profile_index];
 			ADRIA_ASSERT(profile_data.query_started == true);
 			ADRIA_ASSERT(profile_data.query_finished == false);
 			Uint32 begin_query_index = Uint32(profile_index * 2);
 			Uint32 end_query_index = Uint32(profile_index * 2 + 1);
 			profile_data.cmd_list->EndQuery(*query_heap, end_query_index);
+			if (profile_data.pipeline_statistics) profile_data.cmd_list->EndQuery(*statistics_query_heap, profile_index);
 			profile_data.query_finished = true;
 		}
+		GfxPipelineStatistics ReadPipelineStatistics(Uint8 const* data) const
+		{
+			D3D12_QUERY_DATA_PIPELINE_STATISTICS1 d3d12_statistics{};
+			memcpy(&d3d12_statistics, data, statistics_size);
+
+			GfxPipelineStatistics statistics{};
+			statistics.ia_vertices = d3d12_statistics.IAVertices;
+			statistics.ia_primitives = d3d12_statistics.IAPrimitives;
+			statistics.vs_invocations = d3d12_statistics.VSInvocations;
+			statistics.gs_invocations = d3d12_statistics.GSInvocations;
+			statistics.gs_primitives = d3d12_statistics.GSPrimitives;
+			statistics.rasterizer_invocations = d3d12_statistics.CInvocations;
+			statistics.rasterized_primitives = d3d12_statistics.CPrimitives;
+			statistics.ps_invocations = d3d12_statistics.PSInvocations;
+			statistics.hs_invocations = d3d12_statistics.HSInvocations;
+			statistics.ds_invocations = d3d12_statistics.DSInvocations;
+			statistics.cs_invocations = d3d12_statistics.CSInvocations;
+			statistics.as_invocations = d3d12_statistics.ASInvocations;
+			statistics.ms_invocations = d3d12_statistics.MSInvocations;
+			statistics.ms_primitives = d3d12_statistics.MSPrimitives;
+			return statistics;
+		}
+
 		std::vector<GfxTimestamp> GetResults()
 		{
 			Uint64 gpu_frequency = 0;
@@ -122,10 +172,23 @@ namespace adria
 					Uint64 readback_offset = ((current_backbuffer_index * MAX_PROFILES * 2) + begin_query_index) * sizeof(Uint64);
 					ADRIA_ASSERT(profile_data.cmd_list);
 					profile_data.cmd_list->ResolveQueryData(*query_heap, begin_query_index, 2, *query_readback_buffer, readback_offset);
+					if (profile_data.pipeline_statistics)
+					{
+						Uint64 statistics_readback_offset = (current_backbuffer_index * MAX_PROFILES + index) * statistics_size;
+						profile_data.cmd_list->ResolveQueryData(*statistics_query_heap, index, 1, *statistics_readback_buffer, statistics_readback_offset);
+					}
 				}
 			}
 			Uint64 const* query_timestamps = query_readback_buffer->GetMappedData<Uint64>();
 			Uint64 const* frame_query_timestamps = query_timestamps + (current_backbuffer_index * MAX_PROFILES * 2);
+			Uint8 const* frame_statistics = statistics_readback_buffer->GetMappedData<Uint8>() + current_backbuffer_index * MAX_PROFILES * statistics_size;
+
+			Uint64 frame_start_time = UINT64_MAX;
+			for (auto const& [_, index] : name_to_index_map)
+			{
+				QueryData& profile_data = query_data[index];
+				if (profile_data.query_started && profile_data.query_finished) frame_start_time = std::min(frame_start_time, frame_query_timestamps[index * 2 + 0]);
+			}
 
 			std::vector<GfxTimestamp> results{};
 			results.reserve(name_to_index_map.size());
@@ -141,9 +204,15 @@ namespace adria
 					Uint64 delta = end_time - start_time;
 					Float frequency = Float(gpu_frequency);
 					Float time_ms = (delta / frequency) * 1000.0f;
-					results.emplace_back(time_ms, name);
+					Float start_ms = ((start_time - frame_start_time) / frequency) * 1000.0f;
+					Bool const async_compute = profile_data.cmd_list->GetType() == GfxCommandListType::Compute;
+					GfxTimestamp& result = results.emplace_back(time_ms, name, start_ms, async_compute);
+					if (profile_data.pipeline_statistics) result.pipeline_statistics = ReadPipelineStatistics(frame_statistics + index * statistics_size);
 				}
 			}
+
+			frame_gpu_time_ms = 0.0f;
+			for (GfxTimestamp const& result : results) frame_gpu_time_ms = std::max(frame_gpu_time_ms, result.start_in_ms + result.time_in_ms);
 			return results;
 		}
 	};
@@ -180,6 +249,11 @@ namespace adria
 		return pimpl->GetResults();
 	}
 
+	Float GfxProfiler::GetFrameGPUTime() const
+	{
+		return pimpl ? pimpl->frame_gpu_time_ms : 0.0f;
+	}
+
 	GfxProfiler::GfxProfiler() {}
 	GfxProfiler::~GfxProfiler() {}
 }
@@ -1,15 +1,37 @@
 #pragma once
 #include <memory>
+#include <optional>
 #include "GfxMacros.h"
 #include "Utilities/Singleton.h"
 
 
 namespace adria
 {
+	struct GfxPipelineStatistics
+	{
+		Uint64 ia_vertices = 0;
+		Uint64 ia_primitives = 0;
+		Uint64 vs_invocations = 0;
+		Uint64 gs_invocations = 0;
+		Uint64 gs_primitives = 0;
+		Uint64 rasterizer_invocations = 0;
+		Uint64 rasterized_primitives = 0;
+		Uint64 ps_invocations = 0;
+		Uint64 hs_invocations = 0;
+		Uint64 ds_invocations = 0;
+		Uint64 cs_invocations = 0;
+		Uint64 as_invocations = 0;
+		Uint64 ms_invocations = 0;
+		Uint64 ms_primitives = 0;
+	};
+
 	struct GfxTimestamp
 	{
 		Float time_in_ms;
 		std::string name;
+		Float start_in_ms = 0.0f;
+		Bool async_compute = false;
+		std::optional<GfxPipelineStatistics> pipeline_statistics = std::nullopt;
 	};
 
 	class GfxDevice;
@@ -30,6 +52,7 @@ namespace adria
 		void BeginProfileScope(GfxCommandList* cmd_list, Char const* name);
 		void EndProfileScope(Char const* name);
 		std::vector<GfxTimestamp> GetResults();
+		Float GetFrameGPUTime() const;
 
 	private:
 		std::unique_ptr<Impl> pimpl;
@@ -14,6 +14,8 @@ namespace adria
 			return D3D12_QUERY_HEAP_TYPE_OCCLUSION;
 		case GfxQueryType::PipelineStatistics:
 			return D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+		case GfxQueryType::PipelineStatistics1:
+			return D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS1;
 		}
 		return D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
 	}
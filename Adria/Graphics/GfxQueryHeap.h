@@ -10,7 +10,8 @@ namespace adria
 		Occlusion,
 		BinaryOcclusion,
 		Timestamp,
-		PipelineStatistics
+		PipelineStatistics,
+		PipelineStatistics1
 	};
 	struct GfxQueryHeapDesc
 	{
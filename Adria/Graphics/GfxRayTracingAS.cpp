@@ -2,6 +2,7 @@
 #include "GfxDevice.h"
 #include "GfxCommandList.h"
 #include "GfxBuffer.h"
+#include "Utilities/AllocatorUtil.h"
 
 namespace adria
 {
@@ -53,10 +54,50 @@ namespace adria
 			d3d12_desc.Triangles.IndexBuffer = geometry.index_buffer->GetGpuAddress() + geometry.index_buffer_offset;
 			return d3d12_desc;
 		}
+
+#if GFX_OPACITY_MICROMAPS
+		struct OpacityMicromapArrayInputs
+		{
+			D3D12_RAYTRACING_OPACITY_MICROMAP_HISTOGRAM_ENTRY histogram{};
+			D3D12_RAYTRACING_OPACITY_MICROMAP_ARRAY_DESC array_desc{};
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
+
+			OpacityMicromapArrayInputs(Uint64 input_address, Uint64 descs_address, Uint32 micromap_count, Uint32 subdivision_level)
+			{
+				histogram.Count = micromap_count;
+				histogram.SubdivisionLevel = subdivision_level;
+				histogram.Format = D3D12_RAYTRACING_OPACITY_MICROMAP_FORMAT_OC1_4_STATE;
+				array_desc.NumOmmHistogramEntries = 1;
+				array_desc.pOmmHistogram = &histogram;
+				array_desc.InputBuffer = input_address;
+				array_desc.PerOmmDescs.StartAddress = descs_address;
+				array_desc.PerOmmDescs.StrideInBytes = sizeof(D3D12_RAYTRACING_OPACITY_MICROMAP_DESC);
+				inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_OPACITY_MICROMAP_ARRAY;
+				inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+				inputs.NumDescs = 1;
+				inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+				inputs.pOpacityMicromapArrayDesc = &array_desc;
+			}
+			OpacityMicromapArrayInputs(OpacityMicromapArrayInputs const&) = delete;
+		};
+#endif
+
+		inline D3D12_RAYTRACING_INSTANCE_DESC ConvertRayTracingInstance(GfxRayTracingInstance const& instance)
+		{
+			D3D12_RAYTRACING_INSTANCE_DESC d3d12_desc{};
+			d3d12_desc.InstanceID = instance.instance_id;
+			d3d12_desc.InstanceContributionToHitGroupIndex = 0;
+			d3d12_desc.Flags = ConvertInstanceFlags(instance.flags);
+			memcpy(d3d12_desc.Transform, &instance.transform, sizeof(d3d12_desc.Transform));
+			d3d12_desc.AccelerationStructure = instance.blas->GetGpuAddress();
+			d3d12_desc.InstanceMask = instance.instance_mask;
+			return d3d12_desc;
+		}
 	}
 
 	GfxRayTracingBLAS::GfxRayTracingBLAS(GfxDevice* gfx, std::span<GfxRayTracingGeometry> geometries, GfxRayTracingASFlags flags)
 	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
 		std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geo_descs; geo_descs.reserve(geometries.size());
 		for (auto&& geometry : geometries)	geo_descs.push_back(ConvertRayTracingGeometry(geometry));
 
@@ -95,15 +136,297 @@ namespace adria
 		cmd_list->GetNative()->BuildRaytracingAccelerationStructure(&blas_desc, 0, nullptr);
 	}
 
+	GfxRayTracingBLAS::GfxRayTracingBLAS(std::unique_ptr<GfxBuffer>&& _result_buffer) : result_buffer(std::move(_result_buffer))
+	{
+	}
+
 	GfxRayTracingBLAS::~GfxRayTracingBLAS() = default;
 
+	void GfxRayTracingBLAS::Update(GfxCommandList* cmd_list, std::span<GfxRayTracingGeometry const> geometries, GfxRayTracingASFlags flags)
+	{
+		GfxDevice* gfx = cmd_list->GetDevice();
+		std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geo_descs; geo_descs.reserve(geometries.size());
+		for (auto&& geometry : geometries) geo_descs.push_back(ConvertRayTracingGeometry(geometry));
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
+		inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		inputs.Flags = ConvertASFlags(flags | GfxRayTracingASFlag_PerformUpdate);
+		inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+		inputs.NumDescs = (Uint32)geo_descs.size();
+		inputs.pGeometryDescs = geo_descs.data();
+
+		if (!update_scratch_buffer)
+		{
+			GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO bl_prebuild_info{};
+			gfx->GetDevice()->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &bl_prebuild_info);
+
+			GfxBufferDesc scratch_buffer_desc{};
+			scratch_buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+			scratch_buffer_desc.size = std::max<Uint64>(bl_prebuild_info.UpdateScratchDataSizeInBytes, 256);
+			update_scratch_buffer = gfx->CreateBuffer(scratch_buffer_desc);
+			update_scratch_buffer->SetName("BLAS update scratch buffer");
+		}
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC blas_desc{};
+		blas_desc.Inputs = inputs;
+		blas_desc.SourceAccelerationStructureData = result_buffer->GetGpuAddress();
+		blas_desc.DestAccelerationStructureData = result_buffer->GetGpuAddress();
+		blas_desc.ScratchAccelerationStructureData = update_scratch_buffer->GetGpuAddress();
+		cmd_list->GetNative()->BuildRaytracingAccelerationStructure(&blas_desc, 0, nullptr);
+	}
+
 	Uint64 GfxRayTracingBLAS::GetGpuAddress() const
 	{
 		return result_buffer->GetGpuAddress();
 	}
 
-	GfxRayTracingTLAS::GfxRayTracingTLAS(GfxDevice* gfx, std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags)
+	GfxRayTracingOpacityMicromapArray::GfxRayTracingOpacityMicromapArray(GfxDevice* gfx, GfxOpacityMicromapArrayDesc const& desc)
+		: micromap_count(desc.micromap_count), subdivision_level(desc.subdivision_level)
+	{
+#if GFX_OPACITY_MICROMAPS
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
+		ADRIA_ASSERT(micromap_count > 0 && !desc.triangle_indices.empty());
+		Uint32 const micromap_size = std::max(1u << (2 * subdivision_level), 4u) / 4;
+		ADRIA_ASSERT(desc.micromaps.size() >= (Uint64)micromap_count * micromap_size);
+
+		std::vector<D3D12_RAYTRACING_OPACITY_MICROMAP_DESC> micromap_descs(micromap_count);
+		for (Uint32 i = 0; i < micromap_count; ++i)
+		{
+			micromap_descs[i].ByteOffset = i * micromap_size;
+			micromap_descs[i].SubdivisionLevel = static_cast<decltype(micromap_descs[i].SubdivisionLevel)>(subdivision_level);
+			micromap_descs[i].Format = static_cast<decltype(micromap_descs[i].Format)>(D3D12_RAYTRACING_OPACITY_MICROMAP_FORMAT_OC1_4_STATE);
+		}
+
+		GfxBufferDesc upload_desc{};
+		upload_desc.bind_flags = GfxBindFlag::None;
+		upload_desc.resource_usage = GfxResourceUsage::Upload;
+		upload_desc.size = desc.micromaps.size();
+		input_buffer = gfx->CreateBuffer(upload_desc, desc.micromaps.data());
+		upload_desc.size = micromap_descs.size() * sizeof(D3D12_RAYTRACING_OPACITY_MICROMAP_DESC);
+		descs_buffer = gfx->CreateBuffer(upload_desc, micromap_descs.data());
+		upload_desc.size = desc.triangle_indices.size() * sizeof(Int32);
+		index_buffer = gfx->CreateBuffer(upload_desc, desc.triangle_indices.data());
+
+		OpacityMicromapArrayInputs const array_inputs(input_buffer->GetGpuAddress(), descs_buffer->GetGpuAddress(), micromap_count, subdivision_level);
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuild_info{};
+		gfx->GetDevice()->GetRaytracingAccelerationStructurePrebuildInfo(&array_inputs.inputs, &prebuild_info);
+		ADRIA_ASSERT(prebuild_info.ResultDataMaxSizeInBytes > 0);
+
+		GfxBufferDesc scratch_buffer_desc{};
+		scratch_buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+		scratch_buffer_desc.size = std::max<Uint64>(prebuild_info.ScratchDataSizeInBytes, 256);
+		scratch_buffer = gfx->CreateBuffer(scratch_buffer_desc);
+		scratch_buffer->SetName("OMM array scratch buffer");
+
+		GfxBufferDesc result_buffer_desc{};
+		result_buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess | GfxBindFlag::ShaderResource;
+		result_buffer_desc.size = prebuild_info.ResultDataMaxSizeInBytes;
+		result_buffer_desc.misc_flags = GfxBufferMiscFlag::AccelStruct;
+		result_buffer_desc.stride = 4;
+		result_buffer = gfx->CreateBuffer(result_buffer_desc);
+		result_buffer->SetName("OMM array buffer");
+#endif
+	}
+
+	GfxRayTracingOpacityMicromapArray::~GfxRayTracingOpacityMicromapArray() = default;
+
+	void GfxRayTracingOpacityMicromapArray::Build(GfxCommandList* cmd_list)
+	{
+#if GFX_OPACITY_MICROMAPS
+		ADRIA_ASSERT(input_buffer && scratch_buffer);
+		OpacityMicromapArrayInputs const array_inputs(input_buffer->GetGpuAddress(), descs_buffer->GetGpuAddress(), micromap_count, subdivision_level);
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC build_desc{};
+		build_desc.Inputs = array_inputs.inputs;
+		build_desc.DestAccelerationStructureData = result_buffer->GetGpuAddress();
+		build_desc.ScratchAccelerationStructureData = scratch_buffer->GetGpuAddress();
+		cmd_list->GetNative()->BuildRaytracingAccelerationStructure(&build_desc, 0, nullptr);
+#endif
+	}
+
+	void GfxRayTracingOpacityMicromapArray::ReleaseBuildResources()
+	{
+		scratch_buffer.reset();
+		input_buffer.reset();
+		descs_buffer.reset();
+		index_buffer.reset();
+	}
+
+	Uint64 GfxRayTracingOpacityMicromapArray::GetGpuAddress() const
+	{
+		return result_buffer ? result_buffer->GetGpuAddress() : 0;
+	}
+
+	Uint64 GfxRayTracingOpacityMicromapArray::GetIndexBufferGpuAddress() const
+	{
+		return index_buffer ? index_buffer->GetGpuAddress() : 0;
+	}
+
+	Uint64 GfxRayTracingOpacityMicromapArray::GetSize() const
+	{
+		return result_buffer ? result_buffer->GetSize() : 0;
+	}
+
+	GfxRayTracingBLASBuilder::GfxRayTracingBLASBuilder(GfxDevice* gfx, Uint64 scratch_budget) : gfx(gfx), scratch_budget(scratch_budget)
+	{
+	}
+
+	GfxRayTracingBLASBuilder::~GfxRayTracingBLASBuilder() = default;
+
+	Uint32 GfxRayTracingBLASBuilder::AddBLAS(std::span<GfxRayTracingGeometry> geometries, GfxRayTracingASFlags flags)
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
+		BLASBuild& build = builds.emplace_back();
+		build.geometry_descs.reserve(geometries.size());
+		for (auto&& geometry : geometries) build.geometry_descs.push_back(ConvertRayTracingGeometry(geometry));
+#if GFX_OPACITY_MICROMAPS
+		//the reserved storage keeps the pointers of the geometry descs valid
+		build.triangle_descs.reserve(geometries.size());
+		build.opacity_micromap_links.reserve(geometries.size());
+		for (Uint64 i = 0; i < geometries.size(); ++i)
+		{
+			GfxRayTracingOpacityMicromapArray const* opacity_micromap_array = geometries[i].opacity_micromap_array;
+			if (!opacity_micromap_array) continue;
+
+			D3D12_RAYTRACING_GEOMETRY_OMM_LINKAGE_DESC& link = build.opacity_micromap_links.emplace_back();
+			link.OpacityMicromapIndexBuffer.StartAddress = opacity_micromap_array->GetIndexBufferGpuAddress();
+			link.OpacityMicromapIndexBuffer.StrideInBytes = sizeof(Int32);
+			link.OpacityMicromapIndexFormat = DXGI_FORMAT_R32_UINT;
+			link.OpacityMicromapBaseLocation = 0;
+			link.OpacityMicromapArray = opacity_micromap_array->GetGpuAddress();
+
+			D3D12_RAYTRACING_GEOMETRY_DESC& geometry_desc = build.geometry_descs[i];
+			build.triangle_descs.push_back(geometry_desc.Triangles);
+			geometry_desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_OMM_TRIANGLES;
+			geometry_desc.OmmTriangles.pTriangles = &build.triangle_descs.back();
+			geometry_desc.OmmTriangles.pOmmLinkage = &link;
+		}
+#endif
+
+		build.inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		build.inputs.Flags = ConvertASFlags(flags);
+		build.inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+		build.inputs.NumDescs = (Uint32)build.geometry_descs.size();
+		build.inputs.pGeometryDescs = build.geometry_descs.data();
+
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO bl_prebuild_info{};
+		gfx->GetDevice()->GetRaytracingAccelerationStructurePrebuildInfo(&build.inputs, &bl_prebuild_info);
+		ADRIA_ASSERT(bl_prebuild_info.ResultDataMaxSizeInBytes > 0);
+		build.scratch_size = Align(bl_prebuild_info.ScratchDataSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+
+		GfxBufferDesc result_buffer_desc{};
+		result_buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess | GfxBindFlag::ShaderResource;
+		result_buffer_desc.size = bl_prebuild_info.ResultDataMaxSizeInBytes;
+		result_buffer_desc.misc_flags = GfxBufferMiscFlag::AccelStruct;
+		result_buffer_desc.stride = 4;
+		build.result_buffer = gfx->CreateBuffer(result_buffer_desc);
+		build.result_buffer->SetName("BLAS result buffer");
+		built_size += result_buffer_desc.size;
+
+		if (flags & GfxRayTracingASFlag_AllowCompaction) build.postbuild_index = (Int32)compaction_count++;
+		return (Uint32)builds.size() - 1;
+	}
+
+	void GfxRayTracingBLASBuilder::Build(GfxCommandList* cmd_list)
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
+		if (builds.empty()) return;
+		compacted_size = built_size;
+
+		Uint64 max_scratch_size = 0;
+		for (BLASBuild const& build : builds) max_scratch_size = std::max(max_scratch_size, build.scratch_size);
+
+		GfxBufferDesc scratch_buffer_desc{};
+		scratch_buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+		scratch_buffer_desc.size = std::max(scratch_budget, max_scratch_size);
+		scratch_buffer = gfx->CreateBuffer(scratch_buffer_desc);
+		scratch_buffer->SetName("BLAS scratch buffer");
+
+		if (compaction_count > 0)
+		{
+			GfxBufferDesc postbuild_info_desc{};
+			postbuild_info_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+			postbuild_info_desc.size = compaction_count * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+			postbuild_info_buffer = gfx->CreateBuffer(postbuild_info_desc);
+			postbuild_info_readback_buffer = gfx->CreateBuffer(ReadBackBufferDesc(postbuild_info_desc.size));
+			cmd_list->BufferBarrier(*postbuild_info_buffer, GfxResourceState::Common, GfxResourceState::ComputeUAV);
+			cmd_list->FlushBarriers();
+		}
+
+		Uint64 scratch_offset = 0;
+		for (BLASBuild& build : builds)
+		{
+			if (scratch_offset + build.scratch_size > scratch_buffer_desc.size)
+			{
+				cmd_list->GlobalBarrier(GfxResourceState::ASWrite, GfxResourceState::ASWrite);
+				cmd_list->FlushBarriers();
+				scratch_offset = 0;
+			}
+
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC blas_desc{};
+			blas_desc.Inputs = build.inputs;
+			blas_desc.DestAccelerationStructureData = build.result_buffer->GetGpuAddress();
+			blas_desc.ScratchAccelerationStructureData = scratch_buffer->GetGpuAddress() + scratch_offset;
+
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuild_info_desc{};
+			if (build.postbuild_index >= 0)
+			{
+				postbuild_info_desc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+				postbuild_info_desc.DestBuffer = postbuild_info_buffer->GetGpuAddress() + build.postbuild_index * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+			}
+			cmd_list->GetNative()->BuildRaytracingAccelerationStructure(&blas_desc, build.postbuild_index >= 0 ? 1 : 0, build.postbuild_index >= 0 ? &postbuild_info_desc : nullptr);
+			scratch_offset += build.scratch_size;
+		}
+
+		if (compaction_count > 0)
+		{
+			cmd_list->BufferBarrier(*postbuild_info_buffer, GfxResourceState::ComputeUAV, GfxResourceState::CopySrc);
+			cmd_list->FlushBarriers();
+			cmd_list->CopyBuffer(*postbuild_info_readback_buffer, *postbuild_info_buffer);
+		}
+	}
+
+	void GfxRayTracingBLASBuilder::Compact(GfxCommandList* cmd_list)
 	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
+		if (compaction_count == 0) return;
+
+		scratch_buffer.reset();
+		compacted_size = built_size;
+		auto const* compacted_sizes = postbuild_info_readback_buffer->GetMappedData<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC>();
+		for (BLASBuild& build : builds)
+		{
+			if (build.postbuild_index < 0) continue;
+
+			Uint64 const compacted_buffer_size = compacted_sizes[build.postbuild_index].CompactedSizeInBytes;
+			if (compacted_buffer_size == 0 || compacted_buffer_size >= build.result_buffer->GetSize()) continue;
+
+			GfxBufferDesc compacted_buffer_desc = build.result_buffer->GetDesc();
+			compacted_buffer_desc.size = compacted_buffer_size;
+			build.compacted_buffer = gfx->CreateBuffer(compacted_buffer_desc);
+			build.compacted_buffer->SetName("BLAS compacted buffer");
+			cmd_list->GetNative()->CopyRaytracingAccelerationStructure(build.compacted_buffer->GetGpuAddress(), build.result_buffer->GetGpuAddress(),
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+			compacted_size -= build.result_buffer->GetSize() - compacted_buffer_size;
+		}
+	}
+
+	std::vector<std::unique_ptr<GfxRayTracingBLAS>> GfxRayTracingBLASBuilder::GetBLASes()
+	{
+		std::vector<std::unique_ptr<GfxRayTracingBLAS>> blases;
+		blases.reserve(builds.size());
+		for (BLASBuild& build : builds)
+		{
+			if (build.compacted_buffer) blases.push_back(std::make_unique<GfxRayTracingBLAS>(std::move(build.compacted_buffer)));
+			else blases.push_back(std::make_unique<GfxRayTracingBLAS>(std::move(build.result_buffer)));
+		}
+		return blases;
+	}
+
+	GfxRayTracingTLAS::GfxRayTracingTLAS(GfxDevice* gfx, std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags, GfxCommandList* cmd_list)
+		: flags(flags), instance_count((Uint32)instances.size())
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::AccelerationStructures);
 		// First, get the size of the TLAS buffers and create them
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
 		inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
@@ -117,7 +440,7 @@ namespace adria
 
 		GfxBufferDesc scratch_buffer_desc{};
 		scratch_buffer_desc.bind_flags = GfxBindFlag::UnorderedAccess;
-		scratch_buffer_desc.size = tl_prebuild_info.ScratchDataSizeInBytes;
+		scratch_buffer_desc.size = std::max(tl_prebuild_info.ScratchDataSizeInBytes, tl_prebuild_info.UpdateScratchDataSizeInBytes);
 		scratch_buffer = gfx->CreateBuffer(scratch_buffer_desc);
 
 		GfxBufferDesc result_buffer_desc{};
@@ -135,12 +458,7 @@ namespace adria
 		D3D12_RAYTRACING_INSTANCE_DESC* p_instance_desc = instance_buffer->GetMappedData<D3D12_RAYTRACING_INSTANCE_DESC>();
 		for (Uint64 i = 0; i < instances.size(); ++i)
 		{
-			p_instance_desc[i].InstanceID = instances[i].instance_id;
-			p_instance_desc[i].InstanceContributionToHitGroupIndex = 0;
-			p_instance_desc[i].Flags = ConvertInstanceFlags(instances[i].flags);
-			memcpy(p_instance_desc[i].Transform, &instances[i].transform, sizeof(p_instance_desc->Transform));
-			p_instance_desc[i].AccelerationStructure = instances[i].blas->GetGpuAddress();
-			p_instance_desc[i].InstanceMask = instances[i].instance_mask;
+			p_instance_desc[i] = ConvertRayTracingInstance(instances[i]);
 		}
 		instance_buffer->Unmap();
 
@@ -150,12 +468,63 @@ namespace adria
 		tlas_desc.DestAccelerationStructureData = result_buffer->GetGpuAddress();
 		tlas_desc.ScratchAccelerationStructureData = scratch_buffer->GetGpuAddress();
 
-		GfxCommandList* cmd_list = gfx->GetCommandList();
+		if (!cmd_list) cmd_list = gfx->GetCommandList();
 		cmd_list->GetNative()->BuildRaytracingAccelerationStructure(&tlas_desc, 0, nullptr);
+
+		if (flags & GfxRayTracingASFlag_AllowUpdate)
+		{
+			GfxBufferDesc update_instance_buffer_desc{};
+			update_instance_buffer_desc.bind_flags = GfxBindFlag::None;
+			update_instance_buffer_desc.size = instance_buffer_desc.size;
+			update_instance_buffer = gfx->CreateBuffer(update_instance_buffer_desc);
+			update_instance_buffer->SetName("TLAS update instance buffer");
+
+			cmd_list->BufferBarrier(*update_instance_buffer, GfxResourceState::Common, GfxResourceState::CopyDst);
+			cmd_list->FlushBarriers();
+			cmd_list->CopyBuffer(*update_instance_buffer, *instance_buffer);
+		}
 	}
 
 	GfxRayTracingTLAS::~GfxRayTracingTLAS() = default;
 
+	void GfxRayTracingTLAS::UpdateInstances(GfxCommandList* cmd_list, std::span<GfxRayTracingInstance const> instances, Uint32 first_instance)
+	{
+		ADRIA_ASSERT(update_instance_buffer != nullptr);
+		ADRIA_ASSERT(first_instance + instances.size() <= instance_count);
+		if (instances.empty()) return;
+
+		Uint32 const upload_size = (Uint32)(instances.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+		GfxDynamicAllocation upload = cmd_list->AllocateTransient(upload_size, D3D12_RAYTRACING_INSTANCE_DESCS_BYTE_ALIGNMENT);
+		D3D12_RAYTRACING_INSTANCE_DESC* p_instance_desc = static_cast<D3D12_RAYTRACING_INSTANCE_DESC*>(upload.cpu_address);
+		for (Uint64 i = 0; i < instances.size(); ++i)
+		{
+			p_instance_desc[i] = ConvertRayTracingInstance(instances[i]);
+		}
+		cmd_list->CopyBuffer(*update_instance_buffer, first_instance * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), *upload.buffer, upload.offset, upload_size);
+	}
+
+	void GfxRayTracingTLAS::Update(GfxCommandList* cmd_list, Bool rebuild)
+	{
+		ADRIA_ASSERT(update_instance_buffer != nullptr);
+		cmd_list->BufferBarrier(*update_instance_buffer, GfxResourceState::CopyDst, GfxResourceState::ComputeSRV);
+		cmd_list->FlushBarriers();
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC tlas_desc{};
+		tlas_desc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		tlas_desc.Inputs.Flags = ConvertASFlags(rebuild ? flags : flags | GfxRayTracingASFlag_PerformUpdate);
+		tlas_desc.Inputs.NumDescs = instance_count;
+		tlas_desc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+		tlas_desc.Inputs.InstanceDescs = update_instance_buffer->GetGpuAddress();
+		tlas_desc.SourceAccelerationStructureData = rebuild ? 0 : result_buffer->GetGpuAddress();
+		tlas_desc.DestAccelerationStructureData = result_buffer->GetGpuAddress();
+		tlas_desc.ScratchAccelerationStructureData = scratch_buffer->GetGpuAddress();
+		cmd_list->GetNative()->BuildRaytracingAccelerationStructure(&tlas_desc, 0, nullptr);
+
+		cmd_list->GlobalBarrier(GfxResourceState::ASWrite, GfxResourceState::ASRead);
+		cmd_list->BufferBarrier(*update_instance_buffer, GfxResourceState::ComputeSRV, GfxResourceState::CopyDst);
+		cmd_list->FlushBarriers();
+	}
+
 	Uint64 GfxRayTracingTLAS::GetGpuAddress() const
 	{
 		return result_buffer->GetGpuAddress();
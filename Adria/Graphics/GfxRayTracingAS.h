@@ -1,13 +1,18 @@
 #pragma once
 #include <span>
 #include <memory>
+#include <vector>
+#include <d3d12.h>
 #include "GfxFormat.h"
+#include "GfxMacros.h"
 
 namespace adria
 {
 	class GfxBuffer;
 	class GfxDevice;
+	class GfxCommandList;
 	class GfxRayTracingBLAS;
+	class GfxRayTracingOpacityMicromapArray;
 
 	enum GfxRayTracingASFlagBit : Uint32
 	{
@@ -46,14 +51,55 @@ namespace adria
 		GfxFormat index_format;
 
 		Bool opaque;
+
+		//optional, micromaps resolving the alpha test of the triangles in hardware
+		GfxRayTracingOpacityMicromapArray const* opacity_micromap_array = nullptr;
+	};
+
+	//4 state micromaps of one geometry, all of the same subdivision level and stored back to back.
+	//triangle_indices has one entry per triangle, either a micromap index or a negative special index
+	struct GfxOpacityMicromapArrayDesc
+	{
+		std::span<Uint8 const> micromaps;
+		std::span<Int32 const> triangle_indices;
+		Uint32 micromap_count;
+		Uint32 subdivision_level;
+	};
+
+	//inputs stay in upload memory until the BLASes using the array are built, the array itself has to outlive those BLASes
+	class GfxRayTracingOpacityMicromapArray
+	{
+	public:
+		GfxRayTracingOpacityMicromapArray(GfxDevice* gfx, GfxOpacityMicromapArrayDesc const& desc);
+		~GfxRayTracingOpacityMicromapArray();
+
+		void Build(GfxCommandList* cmd_list);
+		void ReleaseBuildResources();
+
+		Uint64 GetGpuAddress() const;
+		Uint64 GetIndexBufferGpuAddress() const;
+		Uint64 GetSize() const;
+
+	private:
+		std::unique_ptr<GfxBuffer> result_buffer;
+		std::unique_ptr<GfxBuffer> scratch_buffer;
+		std::unique_ptr<GfxBuffer> input_buffer;
+		std::unique_ptr<GfxBuffer> descs_buffer;
+		std::unique_ptr<GfxBuffer> index_buffer;
+		Uint32 micromap_count;
+		Uint32 subdivision_level;
 	};
 
 	class GfxRayTracingBLAS
 	{
 	public:
 		GfxRayTracingBLAS(GfxDevice* gfx, std::span<GfxRayTracingGeometry> geometries, GfxRayTracingASFlags flags);
+		explicit GfxRayTracingBLAS(std::unique_ptr<GfxBuffer>&& result_buffer);
 		~GfxRayTracingBLAS();
 
+		//refits in place, the BLAS must have been built with GfxRayTracingASFlag_AllowUpdate from geometries with the same topology
+		void Update(GfxCommandList* cmd_list, std::span<GfxRayTracingGeometry const> geometries, GfxRayTracingASFlags flags);
+
 		Uint64 GetGpuAddress() const;
 		GfxBuffer const& GetBuffer() const { return *result_buffer; }
 		GfxBuffer const& operator*() const { return *result_buffer; }
@@ -61,8 +107,52 @@ namespace adria
 	private:
 		std::unique_ptr<GfxBuffer> result_buffer;
 		std::unique_ptr<GfxBuffer> scratch_buffer;
+		std::unique_ptr<GfxBuffer> update_scratch_buffer;
 	};
 
+	//Records many BLAS builds that share one scratch buffer of at most scratch_budget bytes,
+	//builds that do not fit are split into batches separated by a UAV barrier.
+	//Compact must be called after the GPU finished the builds, the builder has to outlive the compaction copies.
+	class GfxRayTracingBLASBuilder
+	{
+	public:
+		GfxRayTracingBLASBuilder(GfxDevice* gfx, Uint64 scratch_budget);
+		~GfxRayTracingBLASBuilder();
+
+		Uint32 AddBLAS(std::span<GfxRayTracingGeometry> geometries, GfxRayTracingASFlags flags);
+		void Build(GfxCommandList* cmd_list);
+		Bool NeedsCompaction() const { return compaction_count > 0; }
+		void Compact(GfxCommandList* cmd_list);
+
+		std::vector<std::unique_ptr<GfxRayTracingBLAS>> GetBLASes();
+		Uint64 GetBuiltSize() const { return built_size; }
+		Uint64 GetCompactedSize() const { return compacted_size; }
+
+	private:
+		struct BLASBuild
+		{
+			std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometry_descs;
+#if GFX_OPACITY_MICROMAPS
+			std::vector<D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC> triangle_descs;
+			std::vector<D3D12_RAYTRACING_GEOMETRY_OMM_LINKAGE_DESC> opacity_micromap_links;
+#endif
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
+			Uint64 scratch_size = 0;
+			Int32 postbuild_index = -1;
+			std::unique_ptr<GfxBuffer> result_buffer;
+			std::unique_ptr<GfxBuffer> compacted_buffer;
+		};
+
+		GfxDevice* gfx;
+		Uint64 scratch_budget;
+		std::vector<BLASBuild> builds;
+		Uint32 compaction_count = 0;
+		std::unique_ptr<GfxBuffer> scratch_buffer;
+		std::unique_ptr<GfxBuffer> postbuild_info_buffer;
+		std::unique_ptr<GfxBuffer> postbuild_info_readback_buffer;
+		Uint64 built_size = 0;
+		Uint64 compacted_size = 0;
+	};
 
 	struct GfxRayTracingInstance
 	{
@@ -76,10 +166,16 @@ namespace adria
 	class GfxRayTracingTLAS
 	{
 	public:
-		GfxRayTracingTLAS(GfxDevice* gfx, std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags);
+		GfxRayTracingTLAS(GfxDevice* gfx, std::span<GfxRayTracingInstance> instances, GfxRayTracingASFlags flags, GfxCommandList* cmd_list = nullptr);
 		~GfxRayTracingTLAS();
 
+		//requires GfxRayTracingASFlag_AllowUpdate, the instance count cannot change
+		void UpdateInstances(GfxCommandList* cmd_list, std::span<GfxRayTracingInstance const> instances, Uint32 first_instance);
+		void Update(GfxCommandList* cmd_list, Bool rebuild);
+
 		Uint64 GetGpuAddress() const;
+		Uint32 GetInstanceCount() const { return instance_count; }
+		Bool AllowsUpdate() const { return update_instance_buffer != nullptr; }
 		GfxBuffer const& GetBuffer() const { return *result_buffer; }
 		GfxBuffer const& operator*() const { return *result_buffer; }
 
@@ -87,6 +183,9 @@ namespace adria
 		std::unique_ptr<GfxBuffer> result_buffer;
 		std::unique_ptr<GfxBuffer> scratch_buffer;
 		std::unique_ptr<GfxBuffer> instance_buffer;
+		std::unique_ptr<GfxBuffer> update_instance_buffer;
 		void* instance_buffer_cpu_address = nullptr;
+		GfxRayTracingASFlags flags;
+		Uint32 instance_count;
 	};
 }
\ No newline at end of file
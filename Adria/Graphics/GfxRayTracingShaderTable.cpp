@@ -1,7 +1,9 @@
 #include "GfxRayTracingShaderTable.h"
 #include "GfxStateObject.h"
+#include "GfxCommandList.h"
+#include "GfxDevice.h"
+#include "GfxBuffer.h"
 #include "GfxLinearDynamicAllocator.h"
-#include "GfxRingDynamicAllocator.h"
 #include "Utilities/StringUtil.h"
 
 namespace adria
@@ -12,10 +14,12 @@ namespace adria
 		GFX_CHECK_HR(state_object->d3d12_so->QueryInterface(IID_PPV_ARGS(pso_info.GetAddressOf())));
 	}
 
+	GfxRayTracingShaderTable::~GfxRayTracingShaderTable() = default;
+
 	void GfxRayTracingShaderTable::SetRayGenShader(Char const* name, void* local_data /*= nullptr*/, Uint32 data_size /*= 0*/)
 	{
 		void const* ray_gen_id = pso_info->GetShaderIdentifier(ToWideString(name).c_str());
-		ray_gen_record.Init(ray_gen_id, local_data, data_size);
+		dirty |= ray_gen_record.Init(ray_gen_id, local_data, data_size);
 		ray_gen_record_size = (Uint32)Align(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + data_size, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
 	}
 
@@ -26,7 +30,7 @@ namespace adria
 			miss_shader_records.resize(i + 1);
 		}
 		void const* miss_id = pso_info->GetShaderIdentifier(ToWideString(name).c_str());
-		miss_shader_records[i].Init(miss_id, local_data, data_size);
+		dirty |= miss_shader_records[i].Init(miss_id, local_data, data_size);
 		miss_shader_record_size = std::max(miss_shader_record_size, (Uint32)Align(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + data_size, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT));
 	}
 
@@ -37,19 +41,76 @@ namespace adria
 			hit_group_records.resize(i + 1);
 		}
 		void const* miss_id = pso_info->GetShaderIdentifier(ToWideString(name).c_str());
-		hit_group_records[i].Init(miss_id, local_data, data_size);
+		dirty |= hit_group_records[i].Init(miss_id, local_data, data_size);
 		hit_group_record_size = std::max(hit_group_record_size, (Uint32)Align(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + data_size, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT));
 	}
 
-	void GfxRayTracingShaderTable::Commit(GfxLinearDynamicAllocator& allocator, D3D12_DISPATCH_RAYS_DESC& desc)
+	void GfxRayTracingShaderTable::Commit(GfxCommandList* cmd_list, D3D12_DISPATCH_RAYS_DESC& desc)
 	{
-		CommitImpl(allocator, desc);
+		Uint32 rg_section = ray_gen_record_size;
+		Uint32 rg_section_aligned = (Uint32)Align(rg_section, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+		Uint32 miss_section = miss_shader_record_size * (Uint32)miss_shader_records.size();
+		Uint32 miss_section_aligned = (Uint32)Align(miss_section, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+		Uint32 hit_section = hit_group_record_size * (Uint32)hit_group_records.size();
+		Uint32 hit_section_aligned = (Uint32)Align(hit_section, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+		Uint32 total_size = (Uint32)Align(rg_section_aligned + miss_section_aligned + hit_section_aligned, 256);
+
+		if (dirty || !table_buffer) Upload(cmd_list, rg_section_aligned, miss_section_aligned, total_size);
+
+		Uint64 const gpu_address = table_buffer->GetGpuAddress();
+		desc.RayGenerationShaderRecord.StartAddress = gpu_address;
+		desc.RayGenerationShaderRecord.SizeInBytes = rg_section;
+		desc.MissShaderTable.StartAddress = gpu_address + rg_section_aligned;
+		desc.MissShaderTable.SizeInBytes = miss_section;
+		desc.MissShaderTable.StrideInBytes = miss_shader_record_size;
+		desc.HitGroupTable.StartAddress = gpu_address + rg_section_aligned + miss_section_aligned;
+		desc.HitGroupTable.SizeInBytes = hit_section;
+		desc.HitGroupTable.StrideInBytes = hit_group_record_size;
 	}
 
-	void GfxRayTracingShaderTable::Commit(GfxRingDynamicAllocator& allocator, D3D12_DISPATCH_RAYS_DESC& desc)
+	void GfxRayTracingShaderTable::Upload(GfxCommandList* cmd_list, Uint32 rg_section_aligned, Uint32 miss_section_aligned, Uint32 total_size)
 	{
-		CommitImpl(allocator, desc);
+		GfxDevice* gfx = cmd_list->GetDevice();
+		if (!table_buffer || table_buffer->GetSize() < total_size)
+		{
+			GfxBufferDesc table_desc{};
+			table_desc.size = total_size;
+			table_desc.resource_usage = GfxResourceUsage::Default;
+			table_buffer = gfx->CreateBuffer(table_desc);
+			table_buffer_state = GfxResourceState::Common;
+		}
+
+		GfxDynamicAllocation allocation = gfx->GetDynamicAllocator()->Allocate(total_size, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+		Uint8* p_start = (Uint8*)allocation.cpu_address;
+		memset(p_start, 0, total_size);
+		Uint8* p_data = p_start;
+
+		memcpy(p_data, ray_gen_record.shader_id, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+		memcpy(p_data + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, ray_gen_record.local_root_args.get(), ray_gen_record.local_root_args_size);
+		p_data = p_start + rg_section_aligned;
+
+		for (auto const& r : miss_shader_records)
+		{
+			memcpy(p_data, r.shader_id, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+			memcpy(p_data + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, r.local_root_args.get(), r.local_root_args_size);
+			p_data += miss_shader_record_size;
+		}
+		p_data = p_start + rg_section_aligned + miss_section_aligned;
+
+		for (auto const& r : hit_group_records)
+		{
+			memcpy(p_data, r.shader_id, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+			memcpy(p_data + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, r.local_root_args.get(), r.local_root_args_size);
+			p_data += hit_group_record_size;
+		}
+
+		if (table_buffer_state != GfxResourceState::CopyDst) cmd_list->BufferBarrier(*table_buffer, table_buffer_state, GfxResourceState::CopyDst);
+		cmd_list->FlushBarriers();
+		cmd_list->CopyBuffer(*table_buffer, 0, *allocation.buffer, allocation.offset, total_size);
+		cmd_list->BufferBarrier(*table_buffer, GfxResourceState::CopyDst, GfxResourceState::ComputeSRV);
+		cmd_list->FlushBarriers();
+		table_buffer_state = GfxResourceState::ComputeSRV;
+		dirty = false;
 	}
 
 }
-
@@ -0,0 +1,122 @@
+#include "GfxReadbackQueue.h"
+#include "GfxDevice.h"
+#include "GfxBuffer.h"
+#include "GfxTexture.h"
+#include "GfxCommandList.h"
+#include "GfxCommandQueue.h"
+
+namespace adria
+{
+
+	GfxReadbackQueue::GfxReadbackQueue(GfxDevice* gfx) : gfx(gfx)
+	{
+		fence.Create(gfx, "Readback Fence");
+	}
+
+	GfxReadbackQueue::~GfxReadbackQueue() = default;
+
+	void GfxReadbackQueue::Enqueue(GfxCommandList* cmd_list, GfxBuffer const& src, Uint64 src_offset, Uint64 size, GfxReadbackCallback&& callback)
+	{
+		//the fence is signaled on the graphics queue, async compute and copy queue lists are not covered by it
+		ADRIA_ASSERT(cmd_list->GetType() == GfxCommandListType::Graphics);
+		std::unique_ptr<GfxBuffer> buffer = AcquireBuffer(size);
+		cmd_list->CopyBuffer(*buffer, 0, src, src_offset, size);
+		pending_readbacks.emplace_back(std::move(buffer), size, fence_value, std::move(callback));
+		has_unsubmitted = true;
+	}
+
+	void GfxReadbackQueue::Enqueue(GfxCommandList* cmd_list, GfxTexture const& src, GfxReadbackCallback&& callback)
+	{
+		ADRIA_ASSERT(cmd_list->GetType() == GfxCommandListType::Graphics);
+		Uint64 const size = gfx->GetLinearBufferSize(&src);
+		std::unique_ptr<GfxBuffer> buffer = AcquireBuffer(size);
+		cmd_list->CopyTextureToBuffer(*buffer, 0, src, 0, 0);
+		pending_readbacks.emplace_back(std::move(buffer), size, fence_value, std::move(callback));
+		has_unsubmitted = true;
+	}
+
+	void GfxReadbackQueue::EnqueueSubresources(GfxCommandList* cmd_list, GfxTexture const& src, GfxReadbackCallback&& callback)
+	{
+		ADRIA_ASSERT(cmd_list->GetType() == GfxCommandListType::Graphics);
+		D3D12_RESOURCE_DESC const resource_desc = src.GetNative()->GetDesc();
+		Uint32 const array_size = resource_desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : resource_desc.DepthOrArraySize;
+		Uint32 const subresource_count = resource_desc.MipLevels * array_size;
+
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresource_count);
+		Uint64 size = 0;
+		gfx->GetDevice()->GetCopyableFootprints(&resource_desc, 0, subresource_count, 0, footprints.data(), nullptr, nullptr, &size);
+		std::unique_ptr<GfxBuffer> buffer = AcquireBuffer(size);
+
+		cmd_list->FlushBarriers();
+		for (Uint32 i = 0; i < subresource_count; ++i)
+		{
+			D3D12_TEXTURE_COPY_LOCATION dst_location{};
+			dst_location.pResource = buffer->GetNative();
+			dst_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			dst_location.PlacedFootprint = footprints[i];
+
+			D3D12_TEXTURE_COPY_LOCATION src_location{};
+			src_location.pResource = src.GetNative();
+			src_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			src_location.SubresourceIndex = i;
+			cmd_list->GetNative()->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
+		}
+		pending_readbacks.emplace_back(std::move(buffer), size, fence_value, std::move(callback));
+		has_unsubmitted = true;
+	}
+
+	void GfxReadbackQueue::Submit(GfxCommandQueue& queue)
+	{
+		if (!has_unsubmitted) return;
+		queue.Signal(fence, fence_value);
+		++fence_value;
+		has_unsubmitted = false;
+	}
+
+	void GfxReadbackQueue::ProcessCompleted()
+	{
+		if (pending_readbacks.empty()) return;
+
+		Uint64 const completed_value = fence.GetCompletedValue();
+		Uint64 completed_count = 0;
+		while (completed_count < pending_readbacks.size() && pending_readbacks[completed_count].fence_value <= completed_value) ++completed_count;
+		if (completed_count == 0) return;
+
+		//callbacks are allowed to enqueue new readbacks, so the completed ones are moved out first
+		std::vector<PendingReadback> completed_readbacks(std::make_move_iterator(pending_readbacks.begin()), std::make_move_iterator(pending_readbacks.begin() + completed_count));
+		pending_readbacks.erase(pending_readbacks.begin(), pending_readbacks.begin() + completed_count);
+		for (PendingReadback& readback : completed_readbacks)
+		{
+			readback.callback(readback.buffer->GetMappedData(), readback.size);
+			free_buffers.push_back(std::move(readback.buffer));
+		}
+	}
+
+	void GfxReadbackQueue::Flush()
+	{
+		if (fence_value > 1) fence.Wait(fence_value - 1);
+		ProcessCompleted();
+	}
+
+	std::unique_ptr<GfxBuffer> GfxReadbackQueue::AcquireBuffer(Uint64 size)
+	{
+		Uint64 best_index = free_buffers.size();
+		for (Uint64 i = 0; i < free_buffers.size(); ++i)
+		{
+			Uint64 const buffer_size = free_buffers[i]->GetSize();
+			if (buffer_size >= size && (best_index == free_buffers.size() || buffer_size < free_buffers[best_index]->GetSize()))
+			{
+				best_index = i;
+			}
+		}
+		if (best_index == free_buffers.size())
+		{
+			std::unique_ptr<GfxBuffer> buffer = gfx->CreateBuffer(ReadBackBufferDesc(size));
+			buffer->SetName("Readback Queue Buffer");
+			return buffer;
+		}
+		std::unique_ptr<GfxBuffer> buffer = std::move(free_buffers[best_index]);
+		free_buffers.erase(free_buffers.begin() + best_index);
+		return buffer;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include "GfxFence.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxTexture;
+	class GfxCommandList;
+	class GfxCommandQueue;
+
+	using GfxReadbackCallback = std::function<void(void const*, Uint64)>;
+
+	//copies GPU data into pooled readback buffers and invokes the callbacks on the main thread once the GPU is done with them
+	class GfxReadbackQueue
+	{
+		struct PendingReadback
+		{
+			std::unique_ptr<GfxBuffer> buffer;
+			Uint64 size;
+			Uint64 fence_value;
+			GfxReadbackCallback callback;
+		};
+
+	public:
+		explicit GfxReadbackQueue(GfxDevice* gfx);
+		ADRIA_NONCOPYABLE_NONMOVABLE(GfxReadbackQueue)
+		~GfxReadbackQueue();
+
+		void Enqueue(GfxCommandList* cmd_list, GfxBuffer const& src, Uint64 src_offset, Uint64 size, GfxReadbackCallback&& callback);
+		void Enqueue(GfxCommandList* cmd_list, GfxTexture const& src, GfxReadbackCallback&& callback);
+		//every mip and array slice of src, each subresource laid out at its copyable footprint
+		void EnqueueSubresources(GfxCommandList* cmd_list, GfxTexture const& src, GfxReadbackCallback&& callback);
+
+		void Submit(GfxCommandQueue& queue);
+		void ProcessCompleted();
+		void Flush();
+
+	private:
+		GfxDevice* gfx;
+		GfxFence fence;
+		Uint64 fence_value = 1;
+		Bool has_unsubmitted = false;
+		std::vector<PendingReadback> pending_readbacks;
+		std::vector<std::unique_ptr<GfxBuffer>> free_buffers;
+
+	private:
+		std::unique_ptr<GfxBuffer> AcquireBuffer(Uint64 size);
+	};
+}
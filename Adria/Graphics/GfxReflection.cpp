@@ -41,23 +41,32 @@ namespace adria
 		SIZE_T bytecodeSize = 0;
 	};
 
-	void GfxReflection::FillInputLayoutDesc(GfxShader const& vertex_shader, GfxInputLayout& input_layout)
+	namespace
 	{
-		Ref<IDxcContainerReflection> reflection;
-		HRESULT hr = DxcCreateInstance(CLSID_DxcContainerReflection, IID_PPV_ARGS(reflection.GetAddressOf()));
-		GfxReflectionBlob my_blob{ vertex_shader.GetData(), vertex_shader.GetSize() };
-		GFX_CHECK_HR(hr);
-		hr = reflection->Load(&my_blob);
-		GFX_CHECK_HR(hr);
-		uint32_t part_index;
+		Ref<ID3D12ShaderReflection> GetShaderReflection(GfxShader const& shader)
+		{
+			Ref<IDxcContainerReflection> reflection;
+			HRESULT hr = DxcCreateInstance(CLSID_DxcContainerReflection, IID_PPV_ARGS(reflection.GetAddressOf()));
+			GfxReflectionBlob my_blob{ shader.GetData(), shader.GetSize() };
+			GFX_CHECK_HR(hr);
+			hr = reflection->Load(&my_blob);
+			GFX_CHECK_HR(hr);
+			uint32_t part_index;
 #ifndef MAKEFOURCC
 #define MAKEFOURCC(a, b, c, d) (Uint)((Uchar)(a) | (Uchar)(b) << 8 | (Uchar)(c) << 16 | (Uchar)(d) << 24)
 #endif
-		GFX_CHECK_HR(reflection->FindFirstPartKind(MAKEFOURCC('D', 'X', 'I', 'L'), &part_index));
+			GFX_CHECK_HR(reflection->FindFirstPartKind(MAKEFOURCC('D', 'X', 'I', 'L'), &part_index));
 #undef MAKEFOURCC
 
-		Ref<ID3D12ShaderReflection> vertex_shader_reflection;
-		GFX_CHECK_HR(reflection->GetPartReflection(part_index, IID_PPV_ARGS(vertex_shader_reflection.GetAddressOf())));
+			Ref<ID3D12ShaderReflection> shader_reflection;
+			GFX_CHECK_HR(reflection->GetPartReflection(part_index, IID_PPV_ARGS(shader_reflection.GetAddressOf())));
+			return shader_reflection;
+		}
+	}
+
+	void GfxReflection::FillInputLayoutDesc(GfxShader const& vertex_shader, GfxInputLayout& input_layout)
+	{
+		Ref<ID3D12ShaderReflection> vertex_shader_reflection = GetShaderReflection(vertex_shader);
 
 		D3D12_SHADER_DESC shader_desc;
 		GFX_CHECK_HR(vertex_shader_reflection->GetDesc(&shader_desc));
@@ -107,5 +116,39 @@ namespace adria
 		}
 	}
 
+	void GfxReflection::FillConstantBuffers(GfxShader& shader)
+	{
+		Ref<ID3D12ShaderReflection> shader_reflection = GetShaderReflection(shader);
+
+		D3D12_SHADER_DESC shader_desc;
+		GFX_CHECK_HR(shader_reflection->GetDesc(&shader_desc));
+
+		std::vector<GfxShaderConstantBuffer> constant_buffers;
+		for (Uint32 i = 0; i < shader_desc.BoundResources; ++i)
+		{
+			D3D12_SHADER_INPUT_BIND_DESC bind_desc{};
+			GFX_CHECK_HR(shader_reflection->GetResourceBindingDesc(i, &bind_desc));
+			if (bind_desc.Type != D3D_SIT_CBUFFER) continue;
+
+			ID3D12ShaderReflectionConstantBuffer* cbuffer_reflection = shader_reflection->GetConstantBufferByName(bind_desc.Name);
+			D3D12_SHADER_BUFFER_DESC cbuffer_desc{};
+			GFX_CHECK_HR(cbuffer_reflection->GetDesc(&cbuffer_desc));
+
+			GfxShaderConstantBuffer& constant_buffer = constant_buffers.emplace_back();
+			constant_buffer.name = bind_desc.Name;
+			constant_buffer.slot = bind_desc.BindPoint;
+			constant_buffer.space = bind_desc.Space;
+			constant_buffer.size = cbuffer_desc.Size;
+			constant_buffer.variables.reserve(cbuffer_desc.Variables);
+			for (Uint32 j = 0; j < cbuffer_desc.Variables; ++j)
+			{
+				D3D12_SHADER_VARIABLE_DESC variable_desc{};
+				GFX_CHECK_HR(cbuffer_reflection->GetVariableByIndex(j)->GetDesc(&variable_desc));
+				constant_buffer.variables.push_back({ .name = variable_desc.Name, .offset = variable_desc.StartOffset, .size = variable_desc.Size });
+			}
+		}
+		shader.SetConstantBuffers(std::move(constant_buffers));
+	}
+
 }
 
@@ -8,5 +8,6 @@ namespace adria
 	namespace GfxReflection
 	{
 		void FillInputLayoutDesc(GfxShader const& vertex_shader, GfxInputLayout& input_layout);
+		void FillConstantBuffers(GfxShader& shader);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "GfxResidencyManager.h"
+#include "GfxDevice.h"
+#include "GfxCommandQueue.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Float> ResidencyBudget("rhi.ResidencyBudget", 0.9f, "Fraction of the VRAM budget above which cold resources get a lower residency priority");
+	static TAutoConsoleVariable<Int>   ResidencyIdleFrames("rhi.ResidencyIdleFrames", 120, "Number of frames without use after which a tracked resource is considered cold");
+
+	GfxResidencyManager::GfxResidencyManager(GfxDevice* gfx) : gfx(gfx)
+	{
+		residency_fence.Create(gfx, "Residency Fence");
+	}
+
+	GfxResidencyManager::~GfxResidencyManager() = default;
+
+	void GfxResidencyManager::MarkUsed(ID3D12Pageable* pageable, Float priority)
+	{
+		if (!pageable) return;
+
+		std::lock_guard lock(residency_mutex);
+		TrackedResource& resource = resources[pageable];
+		resource.last_used_frame = current_frame;
+		resource.priority = std::clamp(priority, 0.0f, 1.0f);
+		ADRIA_ASSERT(!resource.evicted);
+	}
+
+	void GfxResidencyManager::Unregister(ID3D12Pageable* pageable)
+	{
+		if (!pageable) return;
+
+		std::lock_guard lock(residency_mutex);
+		if (auto it = resources.find(pageable); it != resources.end())
+		{
+			if (it->second.evicted) --evicted_count;
+			resources.erase(it);
+		}
+	}
+
+	void GfxResidencyManager::Evict(ID3D12Pageable* pageable)
+	{
+		if (!pageable) return;
+
+		std::lock_guard lock(residency_mutex);
+		TrackedResource& resource = resources[pageable];
+		if (resource.evicted) return;
+		GFX_CHECK_HR(gfx->GetDevice()->Evict(1, &pageable));
+		resource.evicted = true;
+		++evicted_count;
+	}
+
+	void GfxResidencyManager::MakeResident(ID3D12Pageable* pageable)
+	{
+		if (!pageable) return;
+
+		std::lock_guard lock(residency_mutex);
+		auto it = resources.find(pageable);
+		if (it == resources.end() || !it->second.evicted) return;
+
+		//paging in happens asynchronously, queues wait on the fence so the cpu never stalls on it
+		++residency_fence_value;
+		GFX_CHECK_HR(gfx->GetDevice()->EnqueueMakeResident(D3D12_RESIDENCY_FLAG_NONE, 1, &pageable, residency_fence, residency_fence_value));
+		gfx->GetCommandQueue(GfxCommandListType::Graphics).Wait(residency_fence, residency_fence_value);
+		gfx->GetCommandQueue(GfxCommandListType::Compute).Wait(residency_fence, residency_fence_value);
+		it->second.evicted = false;
+		it->second.last_used_frame = current_frame;
+		--evicted_count;
+	}
+
+	void GfxResidencyManager::Update(Uint64 frame_index)
+	{
+		std::lock_guard lock(residency_mutex);
+		current_frame = frame_index;
+
+		GPUMemoryUsage const memory_usage = gfx->GetMemoryUsage();
+		Bool const pressure = memory_usage.usage > ResidencyBudget.Get() * memory_usage.budget;
+		if (!pressure && !under_pressure) return;
+		under_pressure = pressure;
+
+		std::vector<ID3D12Pageable*> pageables;
+		std::vector<D3D12_RESIDENCY_PRIORITY> priorities;
+		for (auto& [pageable, resource] : resources)
+		{
+			if (resource.evicted) continue;
+			D3D12_RESIDENCY_PRIORITY const residency_priority = pressure ? GetResidencyPriority(resource) : D3D12_RESIDENCY_PRIORITY_NORMAL;
+			if (residency_priority == resource.residency_priority) continue;
+			resource.residency_priority = residency_priority;
+			pageables.push_back(pageable);
+			priorities.push_back(residency_priority);
+		}
+		if (!pageables.empty())
+		{
+			GFX_CHECK_HR(gfx->GetDevice()->SetResidencyPriority((UINT)pageables.size(), pageables.data(), priorities.data()));
+		}
+	}
+
+	D3D12_RESIDENCY_PRIORITY GfxResidencyManager::GetResidencyPriority(TrackedResource const& resource) const
+	{
+		Uint64 const idle_frames = current_frame - resource.last_used_frame;
+		if (idle_frames > (Uint64)std::max(ResidencyIdleFrames.Get(), 1)) return D3D12_RESIDENCY_PRIORITY_MINIMUM;
+		if (resource.priority < 0.25f) return D3D12_RESIDENCY_PRIORITY_LOW;
+		return D3D12_RESIDENCY_PRIORITY_NORMAL;
+	}
+}
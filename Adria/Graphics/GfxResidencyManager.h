@@ -0,0 +1,53 @@
+#pragma once
+#include <mutex>
+#include <unordered_map>
+#include "GfxFence.h"
+
+namespace adria
+{
+	class GfxDevice;
+
+	//tracks when pageable resources were last used and, when usage nears the budget, lowers the residency priority of the cold ones so the OS demotes them first.
+	//owners that know a resource won't be touched for a while can evict it explicitly, it has to be made resident again before it is used
+	class GfxResidencyManager
+	{
+		struct TrackedResource
+		{
+			Uint64 last_used_frame = 0;
+			Float priority = 1.0f;
+			D3D12_RESIDENCY_PRIORITY residency_priority = D3D12_RESIDENCY_PRIORITY_NORMAL;
+			Bool evicted = false;
+		};
+
+	public:
+		explicit GfxResidencyManager(GfxDevice* gfx);
+		ADRIA_NONCOPYABLE_NONMOVABLE(GfxResidencyManager)
+		~GfxResidencyManager();
+
+		//priority is the owner's relative importance in [0, 1], for example the on-screen size from streaming feedback
+		void MarkUsed(ID3D12Pageable* pageable, Float priority = 1.0f);
+		void Unregister(ID3D12Pageable* pageable);
+
+		void Evict(ID3D12Pageable* pageable);
+		void MakeResident(ID3D12Pageable* pageable);
+
+		void Update(Uint64 frame_index);
+
+		Uint64 GetTrackedCount() const { return resources.size(); }
+		Uint64 GetEvictedCount() const { return evicted_count; }
+		Bool IsUnderPressure() const { return under_pressure; }
+
+	private:
+		GfxDevice* gfx;
+		GfxFence residency_fence;
+		Uint64 residency_fence_value = 0;
+		std::mutex residency_mutex;
+		std::unordered_map<ID3D12Pageable*, TrackedResource> resources;
+		Uint64 current_frame = 0;
+		Uint64 evicted_count = 0;
+		Bool under_pressure = false;
+
+	private:
+		D3D12_RESIDENCY_PRIORITY GetResidencyPriority(TrackedResource const& resource) const;
+	};
+}
@@ -130,7 +130,8 @@ namespace adria
 	{
 		Default,
 		Upload,
-		Readback
+		Readback,
+		GpuUpload	//cpu visible video memory (resizable bar), buffers only, falls back to Upload when not supported
 	};
 
 	enum class GfxTextureMiscFlag : Uint32
@@ -177,6 +178,7 @@ namespace adria
 		ASRead = 1 << 17,
 		ASWrite = 1 << 18,
 		Discard = 1 << 19,
+		Predication = 1 << 20,
 
 		AllVertex = VertexSRV | VertexUAV,
 		AllPixel = PixelSRV | PixelUAV,
@@ -211,6 +213,7 @@ namespace adria
 		if (HasFlag(flags, ShadingRate))	sync |= D3D12_BARRIER_SYNC_PIXEL_SHADING;
 		if (HasFlag(flags, IndexBuffer))	sync |= D3D12_BARRIER_SYNC_INDEX_INPUT;
 		if (HasFlag(flags, IndirectArgs))	sync |= D3D12_BARRIER_SYNC_EXECUTE_INDIRECT;
+		if (HasFlag(flags, Predication))	sync |= D3D12_BARRIER_SYNC_PREDICATION;
 		if (HasAnyFlag(flags, AllAS))		sync |= D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE;
 		return sync;
 	}
@@ -232,6 +235,7 @@ namespace adria
 		if (HasFlag(flags, CopyDst))		return D3D12_BARRIER_LAYOUT_COPY_DEST;
 		if (HasFlag(flags, CopySrc))		return D3D12_BARRIER_LAYOUT_COPY_SOURCE;
 		if (HasFlag(flags, ShadingRate))	return D3D12_BARRIER_LAYOUT_SHADING_RATE_SOURCE;
+		if (HasFlag(flags, Common))			return D3D12_BARRIER_LAYOUT_COMMON;
 		ADRIA_UNREACHABLE();
 		return D3D12_BARRIER_LAYOUT_UNDEFINED;
 	}
@@ -252,6 +256,7 @@ namespace adria
 		if (HasFlag(flags, ShadingRate))     access |= D3D12_BARRIER_ACCESS_SHADING_RATE_SOURCE;
 		if (HasFlag(flags, IndexBuffer))     access |= D3D12_BARRIER_ACCESS_INDEX_BUFFER;
 		if (HasFlag(flags, IndirectArgs))    access |= D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT;
+		if (HasFlag(flags, Predication))     access |= D3D12_BARRIER_ACCESS_PREDICATION;
 		if (HasFlag(flags, ASRead))          access |= D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ;
 		if (HasFlag(flags, ASWrite))         access |= D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE;
 		return access;
@@ -269,6 +274,7 @@ namespace adria
 		if (HasAnyFlag(state, ComputeSRV | VertexSRV)) api_state |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
 		if (HasFlag(state, PixelSRV))			api_state |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
 		if (HasFlag(state, IndirectArgs))		api_state |= D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+		if (HasFlag(state, Predication))		api_state |= D3D12_RESOURCE_STATE_PREDICATION;
 		if (HasFlag(state, CopyDst))			api_state |= D3D12_RESOURCE_STATE_COPY_DEST;
 		if (HasFlag(state, CopySrc))			api_state |= D3D12_RESOURCE_STATE_COPY_SOURCE;
 		if (HasFlag(state, Present))			api_state |= D3D12_RESOURCE_STATE_PRESENT;
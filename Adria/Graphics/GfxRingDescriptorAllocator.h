@@ -1,6 +1,9 @@
 #pragma once
 #include <mutex>
+#include <vector>
+#include <queue>
 #include "GfxDescriptorAllocatorBase.h"
+#include "GfxMacros.h"
 #include "Utilities/RingAllocator.h"
 
 namespace adria
@@ -10,9 +13,10 @@ namespace adria
 	{
 		using Mutex = std::conditional_t<UseMutex, std::mutex, DummyMutex>;
 	public:
-		GfxRingDescriptorAllocator(GfxDevice* gfx, Uint32 count, Uint32 reserve = 0)
+		//descriptors [0, reserve) are managed by the user, [reserve, reserve + persistent_count) are handed out by AllocatePersistent
+		GfxRingDescriptorAllocator(GfxDevice* gfx, Uint32 count, Uint32 reserve = 0, Uint32 persistent_count = 0)
 			: GfxDescriptorAllocatorBase(gfx, GfxDescriptorHeapType::CBV_SRV_UAV, count, true),
-			ring_allocator(count, reserve)
+			ring_allocator(count, reserve + persistent_count), persistent_begin(reserve), persistent_end(reserve + persistent_count), persistent_next(reserve)
 		{}
 
 		~GfxRingDescriptorAllocator() = default;
@@ -28,19 +32,59 @@ namespace adria
 			return GetHandle((Uint32)start);
 		}
 
+		ADRIA_NODISCARD GfxDescriptor AllocatePersistent()
+		{
+			Uint32 index = persistent_end;
+			{
+				std::lock_guard guard(alloc_mutex);
+				if (!persistent_free.empty())
+				{
+					index = persistent_free.back();
+					persistent_free.pop_back();
+				}
+				else if (persistent_next < persistent_end)
+				{
+					index = persistent_next++;
+				}
+			}
+			ADRIA_ASSERT(index != persistent_end && "Don't have enough space for persistent descriptors");
+			return GetHandle(index);
+		}
+
+		void FreePersistent(GfxDescriptor descriptor)
+		{
+			if (!descriptor.IsValid()) return;
+			ADRIA_ASSERT(descriptor.GetIndex() >= persistent_begin && descriptor.GetIndex() < persistent_end);
+			std::lock_guard guard(alloc_mutex);
+			persistent_pending_frees.emplace(descriptor.GetIndex(), current_frame);
+		}
+
 		void FinishCurrentFrame(Uint64 frame)
 		{
 			std::lock_guard guard(alloc_mutex);
 			ring_allocator.FinishCurrentFrame(frame);
+			current_frame = frame;
 		}
 		void ReleaseCompletedFrames(Uint64 completed_frame)
 		{
 			std::lock_guard guard(alloc_mutex);
 			ring_allocator.ReleaseCompletedFrames(completed_frame);
+			while (!persistent_pending_frees.empty() && persistent_pending_frees.front().second + GFX_BACKBUFFER_COUNT <= completed_frame)
+			{
+				persistent_free.push_back(persistent_pending_frees.front().first);
+				persistent_pending_frees.pop();
+			}
 		}
 
 	private:
 		mutable Mutex alloc_mutex;
 		RingAllocator ring_allocator;
+
+		Uint32 const persistent_begin;
+		Uint32 const persistent_end;
+		Uint32 persistent_next;
+		std::vector<Uint32> persistent_free;
+		std::queue<std::pair<Uint32, Uint64>> persistent_pending_frees;
+		Uint64 current_frame = 0;
 	};
 }
\ No newline at end of file
@@ -7,9 +7,10 @@ namespace adria
 	GfxRingDynamicAllocator::GfxRingDynamicAllocator(GfxDevice* gfx, Uint64 max_size_in_bytes)
 		: ring_allocator(max_size_in_bytes)
 	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::DynamicUpload);
 		GfxBufferDesc desc{};
 		desc.size = max_size_in_bytes;
-		desc.resource_usage = GfxResourceUsage::Upload;
+		desc.resource_usage = GfxResourceUsage::GpuUpload;
 		desc.bind_flags = GfxBindFlag::ShaderResource;
 
 		buffer = gfx->CreateBuffer(desc);
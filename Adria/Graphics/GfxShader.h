@@ -16,7 +16,8 @@ namespace adria
 	{
 		GfxShaderCompilerFlag_None = 0,
 		GfxShaderCompilerFlag_Debug = 1 << 0,
-		GfxShaderCompilerFlag_DisableOptimization = 1 << 1
+		GfxShaderCompilerFlag_DisableOptimization = 1 << 1,
+		GfxShaderCompilerFlag_Enable16BitTypes = 1 << 2
 	};
 	using GfxShaderCompilerFlags = Uint32;
 	struct GfxShaderDesc
@@ -29,6 +30,30 @@ namespace adria
 		GfxShaderCompilerFlags flags = GfxShaderCompilerFlag_None;
 	};
 
+	struct GfxShaderConstantBufferVariable
+	{
+		std::string name;
+		Uint32 offset;
+		Uint32 size;
+	};
+	struct GfxShaderConstantBuffer
+	{
+		std::string name;
+		Uint32 slot;
+		Uint32 space;
+		Uint32 size;
+		std::vector<GfxShaderConstantBufferVariable> variables;
+
+		GfxShaderConstantBufferVariable const* FindVariable(std::string_view variable_name) const
+		{
+			for (GfxShaderConstantBufferVariable const& variable : variables)
+			{
+				if (variable.name == variable_name) return &variable;
+			}
+			return nullptr;
+		}
+	};
+
 	using GfxShaderBlob = std::vector<Uint8>;
 	using GfxDebugBlob = std::vector<Uint8>;
 	class GfxShader
@@ -47,6 +72,19 @@ namespace adria
 
 		GfxShaderDesc const& GetDesc() const { return desc; }
 
+		void SetConstantBuffers(std::vector<GfxShaderConstantBuffer>&& _constant_buffers)
+		{
+			constant_buffers = std::move(_constant_buffers);
+		}
+		GfxShaderConstantBuffer const* GetConstantBuffer(Uint32 slot, Uint32 space = 0) const
+		{
+			for (GfxShaderConstantBuffer const& constant_buffer : constant_buffers)
+			{
+				if (constant_buffer.slot == slot && constant_buffer.space == space) return &constant_buffer;
+			}
+			return nullptr;
+		}
+
 		void* GetData() const
 		{
 			return !shader_blob.empty() ? (void*)shader_blob.data() : nullptr;
@@ -68,5 +106,6 @@ namespace adria
 	private:
 		GfxShaderBlob shader_blob;
 		GfxShaderDesc desc;
+		std::vector<GfxShaderConstantBuffer> constant_buffers;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include <fstream>
+#include <mutex>
+#include <filesystem>
+#include "GfxShaderCache.h"
+#include "Core/Paths.h"
+#include "Utilities/HashUtil.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Uint32 SHADER_CACHE_MAGIC = 0x43534441;
+		constexpr Uint32 SHADER_CACHE_VERSION = 2;
+
+		struct ShaderCacheHeader
+		{
+			Uint32 magic;
+			Uint32 version;
+			Uint64 entry_count;
+			Uint64 index_offset;
+			Uint64 strings_offset;
+			Uint64 strings_size;
+		};
+
+		struct ShaderCacheIndexEntry
+		{
+			Uint64 key;
+			Uint64 dependency_hash;
+			Uint64 shader_hash[2];
+			Uint64 blob_offset;
+			Uint64 blob_size;
+			Uint64 includes_offset;
+			Uint64 includes_size;
+		};
+
+		struct ShaderCacheEntry
+		{
+			Uint64 dependency_hash;
+			Uint64 shader_hash[2];
+			std::vector<std::string> includes;
+			Uint8 const* mapped_blob = nullptr;
+			Uint64 mapped_blob_size = 0;
+			GfxShaderBlob blob;
+
+			Uint8 const* GetData() const { return mapped_blob ? mapped_blob : blob.data(); }
+			Uint64 GetSize() const { return mapped_blob ? mapped_blob_size : blob.size(); }
+		};
+
+		std::mutex cache_mutex;
+		std::unordered_map<Uint64, ShaderCacheEntry> cache_entries;
+		std::unordered_map<std::string, Uint64> file_hashes;
+		Bool dirty = false;
+
+		HANDLE cache_file = INVALID_HANDLE_VALUE;
+		HANDLE cache_mapping = nullptr;
+		Uint8 const* cache_view = nullptr;
+		Uint64 cache_view_size = 0;
+
+		std::string GetShaderCachePath()
+		{
+			return paths::ShaderCacheDir + "ShaderCache.bin";
+		}
+
+		Uint64 GetShaderCacheKey(GfxShaderCompileInput const& input)
+		{
+			std::string define_key;
+			for (GfxShaderDefine const& define : input.defines)
+			{
+				define_key += define.name;
+				define_key += define.value;
+			}
+
+			HashState key;
+			key.Combine(crc64(input.file.c_str(), input.file.size()));
+			key.Combine(crc64(define_key.c_str(), define_key.size()));
+			key.Combine(crc64(input.entry_point.c_str(), input.entry_point.size()));
+			key.Combine((Uint64)input.stage);
+			key.Combine((Uint64)input.model);
+			key.Combine((Uint64)input.flags);
+			return key;
+		}
+
+		Uint64 GetFileHash(std::string const& file)
+		{
+			if (auto it = file_hashes.find(file); it != file_hashes.end()) return it->second;
+			Uint64 file_hash = 0;
+			std::ifstream is(file, std::ios::binary);
+			if (is)
+			{
+				std::string const content((std::istreambuf_iterator<Char>(is)), std::istreambuf_iterator<Char>());
+				file_hash = crc64(content.c_str(), content.size());
+			}
+			file_hashes[file] = file_hash;
+			return file_hash;
+		}
+
+		Uint64 GetDependencyHash(std::vector<std::string> const& includes)
+		{
+			HashState dependency_hash;
+			for (std::string const& include : includes)
+			{
+				dependency_hash.Combine(crc64(include.c_str(), include.size()));
+				dependency_hash.Combine(GetFileHash(include));
+			}
+			return dependency_hash;
+		}
+
+		void UnmapCache()
+		{
+			if (cache_view) UnmapViewOfFile(cache_view);
+			if (cache_mapping) CloseHandle(cache_mapping);
+			if (cache_file != INVALID_HANDLE_VALUE) CloseHandle(cache_file);
+			cache_view = nullptr;
+			cache_mapping = nullptr;
+			cache_file = INVALID_HANDLE_VALUE;
+			cache_view_size = 0;
+		}
+
+		Bool MapCache()
+		{
+			std::string const cache_path = GetShaderCachePath();
+			cache_file = CreateFileA(cache_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (cache_file == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER file_size{};
+			if (!GetFileSizeEx(cache_file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(ShaderCacheHeader))
+			{
+				UnmapCache();
+				return false;
+			}
+
+			cache_mapping = CreateFileMappingA(cache_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!cache_mapping)
+			{
+				UnmapCache();
+				return false;
+			}
+			cache_view = static_cast<Uint8 const*>(MapViewOfFile(cache_mapping, FILE_MAP_READ, 0, 0, 0));
+			if (!cache_view)
+			{
+				UnmapCache();
+				return false;
+			}
+			cache_view_size = file_size.QuadPart;
+			return true;
+		}
+
+		Bool ParseCache()
+		{
+			ShaderCacheHeader const* header = reinterpret_cast<ShaderCacheHeader const*>(cache_view);
+			if (header->magic != SHADER_CACHE_MAGIC || header->version != SHADER_CACHE_VERSION) return false;
+			if (header->index_offset + header->entry_count * sizeof(ShaderCacheIndexEntry) > cache_view_size) return false;
+			if (header->strings_offset + header->strings_size > cache_view_size) return false;
+
+			ShaderCacheIndexEntry const* index = reinterpret_cast<ShaderCacheIndexEntry const*>(cache_view + header->index_offset);
+			Char const* strings = reinterpret_cast<Char const*>(cache_view + header->strings_offset);
+			cache_entries.reserve(header->entry_count);
+			for (Uint64 i = 0; i < header->entry_count; ++i)
+			{
+				ShaderCacheIndexEntry const& index_entry = index[i];
+				if (index_entry.blob_offset + index_entry.blob_size > cache_view_size) return false;
+				if (index_entry.includes_offset + index_entry.includes_size > header->strings_size) return false;
+
+				ShaderCacheEntry& entry = cache_entries[index_entry.key];
+				entry.dependency_hash = index_entry.dependency_hash;
+				entry.shader_hash[0] = index_entry.shader_hash[0];
+				entry.shader_hash[1] = index_entry.shader_hash[1];
+				entry.mapped_blob = cache_view + index_entry.blob_offset;
+				entry.mapped_blob_size = index_entry.blob_size;
+
+				Char const* include = strings + index_entry.includes_offset;
+				Char const* includes_end = include + index_entry.includes_size;
+				while (include < includes_end)
+				{
+					std::string& include_file = entry.includes.emplace_back(include);
+					include += include_file.size() + 1;
+				}
+			}
+			return true;
+		}
+
+		void SaveCache()
+		{
+			std::string const cache_path = GetShaderCachePath();
+			std::string const temp_cache_path = cache_path + ".tmp";
+			{
+				std::ofstream os(temp_cache_path, std::ios::binary);
+				if (!os)
+				{
+					ADRIA_LOG(WARNING, "Failed to write shader cache archive!");
+					return;
+				}
+
+				ShaderCacheHeader header{};
+				header.magic = SHADER_CACHE_MAGIC;
+				header.version = SHADER_CACHE_VERSION;
+				header.entry_count = cache_entries.size();
+				os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+
+				std::vector<ShaderCacheIndexEntry> index;
+				index.reserve(cache_entries.size());
+				std::string strings;
+				Uint64 offset = sizeof(header);
+				for (auto const& [key, entry] : cache_entries)
+				{
+					ShaderCacheIndexEntry& index_entry = index.emplace_back();
+					index_entry.key = key;
+					index_entry.dependency_hash = entry.dependency_hash;
+					index_entry.shader_hash[0] = entry.shader_hash[0];
+					index_entry.shader_hash[1] = entry.shader_hash[1];
+					index_entry.blob_offset = offset;
+					index_entry.blob_size = entry.GetSize();
+					index_entry.includes_offset = strings.size();
+					for (std::string const& include : entry.includes)
+					{
+						strings += include;
+						strings += '\0';
+					}
+					index_entry.includes_size = strings.size() - index_entry.includes_offset;
+
+					os.write(reinterpret_cast<Char const*>(entry.GetData()), entry.GetSize());
+					offset += entry.GetSize();
+				}
+
+				header.index_offset = offset;
+				header.strings_offset = offset + index.size() * sizeof(ShaderCacheIndexEntry);
+				header.strings_size = strings.size();
+				os.write(reinterpret_cast<Char const*>(index.data()), index.size() * sizeof(ShaderCacheIndexEntry));
+				os.write(strings.data(), strings.size());
+				os.seekp(0);
+				os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+			}
+
+			cache_entries.clear();
+			UnmapCache();
+			std::error_code ec;
+			std::filesystem::rename(temp_cache_path, cache_path, ec);
+			if (ec) ADRIA_LOG(WARNING, "Failed to replace shader cache archive: %s", ec.message().c_str());
+		}
+	}
+
+	namespace GfxShaderCache
+	{
+		void Initialize()
+		{
+			std::filesystem::create_directories(paths::ShaderCacheDir);
+			if (!MapCache()) return;
+			if (!ParseCache())
+			{
+				ADRIA_LOG(INFO, "Shader cache archive is invalid or outdated, discarding it");
+				cache_entries.clear();
+				UnmapCache();
+				return;
+			}
+			ADRIA_LOG(INFO, "Loaded shader cache archive with %llu entries", (Uint64)cache_entries.size());
+		}
+
+		void Destroy()
+		{
+			std::lock_guard lock(cache_mutex);
+			if (dirty) SaveCache();
+			cache_entries.clear();
+			file_hashes.clear();
+			UnmapCache();
+			dirty = false;
+		}
+
+		Bool Get(GfxShaderCompileInput const& input, GfxShaderCompileOutput& output)
+		{
+			std::lock_guard lock(cache_mutex);
+			auto it = cache_entries.find(GetShaderCacheKey(input));
+			if (it == cache_entries.end()) return false;
+
+			ShaderCacheEntry const& entry = it->second;
+			if (entry.dependency_hash != GetDependencyHash(entry.includes)) return false;
+
+			output.shader_hash[0] = entry.shader_hash[0];
+			output.shader_hash[1] = entry.shader_hash[1];
+			output.includes = entry.includes;
+			output.shader.SetShaderData(entry.GetData(), entry.GetSize());
+			output.shader.SetDesc(input);
+			return true;
+		}
+
+		void Add(GfxShaderCompileInput const& input, GfxShaderCompileOutput const& output)
+		{
+			std::lock_guard lock(cache_mutex);
+			ShaderCacheEntry& entry = cache_entries[GetShaderCacheKey(input)];
+			entry.dependency_hash = GetDependencyHash(output.includes);
+			entry.shader_hash[0] = output.shader_hash[0];
+			entry.shader_hash[1] = output.shader_hash[1];
+			entry.includes = output.includes;
+			entry.mapped_blob = nullptr;
+			entry.mapped_blob_size = 0;
+			entry.blob.resize(output.shader.GetSize());
+			memcpy(entry.blob.data(), output.shader.GetData(), output.shader.GetSize());
+			dirty = true;
+		}
+
+		void OnSourceFilesChanged()
+		{
+			std::lock_guard lock(cache_mutex);
+			file_hashes.clear();
+		}
+	}
+}
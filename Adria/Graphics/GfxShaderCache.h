@@ -0,0 +1,14 @@
+#pragma once
+#include "GfxShaderCompiler.h"
+
+namespace adria
+{
+	namespace GfxShaderCache
+	{
+		void Initialize();
+		void Destroy();
+		Bool Get(GfxShaderCompileInput const& input, GfxShaderCompileOutput& output);
+		void Add(GfxShaderCompileInput const& input, GfxShaderCompileOutput const& output);
+		void OnSourceFilesChanged();
+	}
+}
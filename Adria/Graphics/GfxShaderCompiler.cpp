@@ -2,10 +2,8 @@
 #include <d3dcompiler.h>
 #include <filesystem>
 #include "dxcapi.h"
-#include "cereal/archives/binary.hpp"
-#include "cereal/types/string.hpp"
-#include "cereal/types/vector.hpp"
 #include "GfxShaderCompiler.h"
+#include "GfxShaderCache.h"
 #include "GfxMacros.h"
 #include "Core/Paths.h"
 #include "Utilities/StringUtil.h"
@@ -23,6 +21,25 @@ namespace adria
 		Ref<IDxcCompiler3> compiler = nullptr;
 		Ref<IDxcUtils> utils = nullptr;
 		Ref<IDxcIncludeHandler> include_handler = nullptr;
+
+		struct DxcThreadContext
+		{
+			Ref<IDxcLibrary> library = nullptr;
+			Ref<IDxcCompiler3> compiler = nullptr;
+			Ref<IDxcUtils> utils = nullptr;
+		};
+		thread_local DxcThreadContext thread_context;
+
+		DxcThreadContext& GetThreadContext()
+		{
+			if (!thread_context.compiler)
+			{
+				GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(thread_context.library.GetAddressOf())));
+				GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(thread_context.compiler.GetAddressOf())));
+				GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(thread_context.utils.GetAddressOf())));
+			}
+			return thread_context;
+		}
 	}
 	class GfxIncludeHandler : public IDxcIncludeHandler
 	{
@@ -52,13 +69,13 @@ namespace adria
 			if (already_included)
 			{
 				static const Char nullStr[] = " ";
-				utils->CreateBlob(nullStr, ARRAYSIZE(nullStr), CP_UTF8, encoding.GetAddressOf());
+				GetThreadContext().utils->CreateBlob(nullStr, ARRAYSIZE(nullStr), CP_UTF8, encoding.GetAddressOf());
 				*ppIncludeSource = encoding.Detach();
 				return S_OK;
 			}
 
 			std::wstring winclude_file = ToWideString(include_file);
-			HRESULT hr = utils->LoadFile(winclude_file.c_str(), nullptr, encoding.GetAddressOf());
+			HRESULT hr = GetThreadContext().utils->LoadFile(winclude_file.c_str(), nullptr, encoding.GetAddressOf());
 			if (SUCCEEDED(hr))
 			{
 				include_files.push_back(include_file);
@@ -143,6 +160,9 @@ namespace adria
 		case SM_6_8:
 			target += L"6_8";
 			break;
+		case SM_6_9:
+			target += L"6_9";
+			break;
 		default:
 			break;
 		}
@@ -151,55 +171,6 @@ namespace adria
 
 	namespace GfxShaderCompiler
 	{
-		static Bool CheckCache(Char const* cache_path, GfxShaderCompileInput const& input, GfxShaderCompileOutput& output)
-		{
-			std::string cache_binary(cache_path); cache_binary += ".bin";
-			std::string cache_metadata(cache_path); cache_metadata += ".meta";
-
-			if (!FileExists(cache_binary) || !FileExists(cache_metadata)) return false;
-			if (GetFileLastWriteTime(cache_binary) < GetFileLastWriteTime(input.file)) return false;
-
-			std::ifstream is(cache_metadata, std::ios::binary);
-			cereal::BinaryInputArchive metadata_archive(is);
-
-			metadata_archive(output.shader_hash);
-			metadata_archive(output.includes);
-			Uint64 binary_size = 0;
-			metadata_archive(binary_size);
-
-			//check if the one of the includes was modified after the cache binary was generated
-			for (std::string const& include : output.includes)
-			{
-				if (GetFileLastWriteTime(cache_binary) < GetFileLastWriteTime(include)) 
-					return false;
-			}
-
-			std::ifstream is2(cache_binary, std::ios::binary);
-			cereal::BinaryInputArchive binary_archive(is2);
-
-			std::unique_ptr<Char[]> binary_data(new Char[binary_size]);
-			binary_archive.loadBinary(binary_data.get(), binary_size);
-			output.shader.SetShaderData(binary_data.get(), binary_size);
-			output.shader.SetDesc(input);
-			return true;
-		}
-		static Bool SaveToCache(Char const* cache_path, GfxShaderCompileOutput const& output)
-		{
-			std::string cache_metadata(cache_path); cache_metadata += ".meta";
-			std::ofstream os(cache_metadata, std::ios::binary);
-			cereal::BinaryOutputArchive metadata_archive(os);
-			metadata_archive(output.shader_hash);
-			metadata_archive(output.includes);
-			metadata_archive(output.shader.GetSize());
-
-			std::string cache_binary(cache_path); cache_binary += ".bin";
-			std::ofstream os2(cache_binary, std::ios::binary);
-			cereal::BinaryOutputArchive binary_archive(os2);
-			binary_archive.saveBinary(output.shader.GetData(), output.shader.GetSize());
-
-			return true;
-		}
-
 		void Initialize()
 		{
 			GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(library.GetAddressOf())));
@@ -208,9 +179,11 @@ namespace adria
 			GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(utils.GetAddressOf())));
 
 			std::filesystem::create_directory(paths::ShaderPDBDir);
+			GfxShaderCache::Initialize();
 		}
 		void Destroy()
 		{
+			GfxShaderCache::Destroy();
 			include_handler.Reset();
 			compiler.Reset();
 			library.Reset();
@@ -218,27 +191,16 @@ namespace adria
 		}
 		Bool CompileShader(GfxShaderCompileInput const& input, GfxShaderCompileOutput& output)
 		{
-			std::string define_key;
-			for (GfxShaderDefine const& define : input.defines)
-			{
-				define_key += define.name;
-				define_key += define.value;
-			}
-			Uint64 define_hash = crc64(define_key.c_str(), define_key.size());
-			std::string build_string = input.flags & GfxShaderCompilerFlag_Debug ? "debug" : "release";
-			Char cache_path[256];
-			sprintf_s(cache_path, "%s%s_%s_%llx_%s", paths::ShaderCacheDir.c_str(), GetFilenameWithoutExtension(input.file).c_str(),
-												     input.entry_point.c_str(), define_hash, build_string.c_str());
-
-			if (CheckCache(cache_path, input, output)) return true;
+			if (GfxShaderCache::Get(input, output)) return true;
 			ADRIA_LOG(INFO, "Shader '%s.%s' not found in cache. Compiling...", input.file.c_str(), input.entry_point.c_str());
 
+			DxcThreadContext& context = GetThreadContext();
 			compile:
 			Uint32 code_page = CP_UTF8;
 			Ref<IDxcBlobEncoding> source_blob;
 
 			std::wstring shader_source = ToWideString(input.file);
-			HRESULT hr = library->CreateBlobFromFile(shader_source.data(), &code_page, source_blob.GetAddressOf());
+			HRESULT hr = context.library->CreateBlobFromFile(shader_source.data(), &code_page, source_blob.GetAddressOf());
 			GFX_CHECK_HR(hr);
 
 			std::wstring name = ToWideString(GetFilenameWithoutExtension(input.file));
@@ -265,6 +227,10 @@ namespace adria
 				compile_args.push_back(DXC_ARG_OPTIMIZATION_LEVEL3);
 			}
 			compile_args.push_back(L"-HV 2021");
+			if (input.flags & GfxShaderCompilerFlag_Enable16BitTypes)
+			{
+				compile_args.push_back(L"-enable-16bit-types");
+			}
 
 			compile_args.push_back(L"-E");
 			compile_args.push_back(entry_point.c_str());
@@ -295,7 +261,7 @@ namespace adria
 			GfxIncludeHandler custom_include_handler{};
 
 			Ref<IDxcResult> result;
-			hr = compiler->Compile(
+			hr = context.compiler->Compile(
 				&source_buffer,
 				compile_args.data(), (Uint32)compile_args.size(),
 				&custom_include_handler,
@@ -326,7 +292,7 @@ namespace adria
 				if (SUCCEEDED(result->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(pdb_blob.GetAddressOf()), pdb_path_utf16.GetAddressOf())))
 				{
 					Ref<IDxcBlobUtf8> pdb_path_utf8;
-					if (SUCCEEDED(utils->GetBlobAsUtf8(pdb_path_utf16.Get(), pdb_path_utf8.GetAddressOf())))
+					if (SUCCEEDED(context.utils->GetBlobAsUtf8(pdb_path_utf16.Get(), pdb_path_utf8.GetAddressOf())))
 					{
 						Char pdb_path[256];
 						sprintf_s(pdb_path, "%s%s", paths::ShaderPDBDir.c_str(), pdb_path_utf8->GetStringPointer());
@@ -351,7 +317,7 @@ namespace adria
 			output.shader.SetShaderData(blob->GetBufferPointer(), blob->GetBufferSize());
 			output.includes = std::move(custom_include_handler.include_files);
 			output.includes.push_back(input.file);
-			SaveToCache(cache_path, output);
+			GfxShaderCache::Add(input, output);
 			return true;
 		}
 		void ReadBlobFromFile(std::string const& filename, GfxShaderBlob& blob)
@@ -359,7 +325,7 @@ namespace adria
 			std::wstring wide_filename = ToWideString(filename);
 			Uint32 code_page = CP_UTF8;
 			Ref<IDxcBlobEncoding> source_blob;
-			HRESULT hr = library->CreateBlobFromFile(wide_filename.data(), &code_page, source_blob.GetAddressOf());
+			HRESULT hr = GetThreadContext().library->CreateBlobFromFile(wide_filename.data(), &code_page, source_blob.GetAddressOf());
 			GFX_CHECK_HR(hr);
 			blob.resize(source_blob->GetBufferSize());
 			memcpy(blob.data(), source_blob->GetBufferPointer(), source_blob->GetBufferSize());
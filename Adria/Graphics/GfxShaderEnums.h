@@ -26,6 +26,7 @@ namespace adria
 		SM_6_5,
 		SM_6_6,
 		SM_6_7,
-		SM_6_8
+		SM_6_8,
+		SM_6_9
 	};
 }
\ No newline at end of file
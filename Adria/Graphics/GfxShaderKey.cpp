@@ -5,41 +5,16 @@
 
 namespace adria
 {
-	struct GfxShaderKey::Impl
-	{
-		ShaderID id = ShaderID_Invalid;
-		std::vector<GfxShaderDefine> defines;
-	};
-
-	GfxShaderKey::GfxShaderKey()
-	{
-		impl = std::make_unique<Impl>();
-	}
-
-	GfxShaderKey::GfxShaderKey(ShaderID shader_id) : GfxShaderKey()
-	{
-		impl->id = shader_id;
-	}
+	static_assert(std::is_trivially_copyable_v<GfxShaderKey>);
+	static_assert(sizeof(GfxShaderKey) == 256, "GfxShaderKey should have no padding since pipeline state descs containing it are hashed bytewise");
 
-	GfxShaderKey::GfxShaderKey(GfxShaderKey const& k) 
+	GfxShaderKey::GfxShaderKey(ShaderID shader_id) : id(shader_id)
 	{
-		impl = std::make_unique<Impl>();
-		impl->id = k.impl->id;
-		impl->defines = k.impl->defines;
 	}
 
-	GfxShaderKey::~GfxShaderKey() = default;
-
 	void GfxShaderKey::Init(ShaderID shader_id)
 	{
-		impl->id = shader_id;
-	}
-
-	GfxShaderKey& GfxShaderKey::operator=(GfxShaderKey const& k)
-	{
-		impl->id = k.impl->id;
-		impl->defines = k.impl->defines;
-		return *this;
+		id = shader_id;
 	}
 
 	void GfxShaderKey::operator=(ShaderID shader_id)
@@ -49,48 +24,75 @@ namespace adria
 
 	void GfxShaderKey::AddDefine(Char const* name, Char const* value)
 	{
-		impl->defines.emplace_back(name, value);
+		Uint64 const name_size = strlen(name) + 1;
+		Uint64 const value_size = strlen(value) + 1;
+		ADRIA_ASSERT(define_data_size + name_size + value_size <= MAX_DEFINE_DATA_SIZE);
+		if (define_data_size + name_size + value_size > MAX_DEFINE_DATA_SIZE)
+		{
+			ADRIA_LOG(ERROR, "Shader key define storage exceeded while adding %s!", name);
+			return;
+		}
+
+		Char* define = define_data + define_data_size;
+		memcpy(define, name, name_size);
+		memcpy(define + name_size, value, value_size);
+		define_data_size += (Uint16)(name_size + value_size);
+		++define_count;
+
+		HashState state;
+		state.Combine(define_hash);
+		state.Combine(crc64(define, name_size + value_size));
+		define_hash = state;
 	}
 
 	Bool GfxShaderKey::IsValid() const
 	{
-		return impl->id != ShaderID_Invalid;
+		return id != ShaderID_Invalid;
 	}
 
 	GfxShaderKey::operator ShaderID() const
 	{
-		return impl->id;
+		return id;
 	}
 
-	std::vector<GfxShaderDefine> const& GfxShaderKey::GetDefines() const
+	std::vector<GfxShaderDefine> GfxShaderKey::GetDefines() const
 	{
-		return impl->defines;
+		std::vector<GfxShaderDefine> defines;
+		defines.reserve(define_count);
+		for (Char const* define = define_data; define < define_data + define_data_size;)
+		{
+			Char const* name = define;
+			Char const* value = name + strlen(name) + 1;
+			defines.emplace_back(name, value);
+			define = value + strlen(value) + 1;
+		}
+		return defines;
 	}
 
 	ShaderID GfxShaderKey::GetShaderID() const
 	{
-		return impl->id;
+		return id;
 	}
 
 	Uint64 GfxShaderKey::GetHash() const
 	{
-		if (!impl) return 0;
-
-		std::string define_key;
-		for (GfxShaderDefine const& define : impl->defines)
-		{
-			define_key += define.name;
-			define_key += define.value;
-		}
-		define_key += std::to_string(impl->id);
-		Uint64 define_hash = crc64(define_key.c_str(), define_key.size());
-		return define_hash;
+		HashState state;
+		state.Combine(define_hash);
+		state.Combine((Uint64)id);
+		return state;
 	}
 
 	Bool GfxShaderKey::operator==(GfxShaderKey const& key) const
 	{
-		if (impl->id != key.impl->id) return false;
-		return GetHash() == key.GetHash();
+		if (id != key.id || define_hash != key.define_hash || define_data_size != key.define_data_size) return false;
+		return memcmp(define_data, key.define_data, define_data_size) == 0;
 	}
 
+	Bool GfxShaderKey::operator<(GfxShaderKey const& key) const
+	{
+		if (id != key.id) return id < key.id;
+		if (define_hash != key.define_hash) return define_hash < key.define_hash;
+		if (define_data_size != key.define_data_size) return define_data_size < key.define_data_size;
+		return memcmp(define_data, key.define_data, define_data_size) < 0;
+	}
 }
@@ -5,16 +5,18 @@ namespace adria
 	enum ShaderID : Uint8;
 	struct GfxShaderDefine;
 
+	//defines are stored inline as consecutive null terminated name/value pairs so copying a key never allocates,
+	//the define hash is updated on every AddDefine instead of being rebuilt on every GetHash
 	class GfxShaderKey
 	{
-		struct Impl;
 	public:
-		GfxShaderKey();
-		GfxShaderKey(ShaderID shader_id);
-		~GfxShaderKey();
+		static constexpr Uint32 MAX_DEFINE_DATA_SIZE = 244;
 
-		GfxShaderKey(GfxShaderKey const&);
-		GfxShaderKey& operator=(GfxShaderKey const&);
+	public:
+		GfxShaderKey() = default;
+		GfxShaderKey(ShaderID shader_id);
+		ADRIA_DEFAULT_COPYABLE_MOVABLE(GfxShaderKey)
+		~GfxShaderKey() = default;
 
 		void Init(ShaderID shader_id);
 		void operator=(ShaderID shader_id);
@@ -22,15 +24,21 @@ namespace adria
 		void AddDefine(Char const* name, Char const* value = "");
 		Bool IsValid() const;
 
-		std::vector<GfxShaderDefine> const& GetDefines() const;
+		Uint32 GetDefineCount() const { return define_count; }
+		std::vector<GfxShaderDefine> GetDefines() const;
 		ShaderID GetShaderID() const;
 		Uint64 GetHash() const;
 
 		operator ShaderID() const;
 		Bool operator==(GfxShaderKey const& key) const;
+		Bool operator<(GfxShaderKey const& key) const;
 
 	private:
-		std::unique_ptr<Impl> impl;
+		Uint64 define_hash = 0;
+		Char define_data[MAX_DEFINE_DATA_SIZE] = {};
+		Uint16 define_data_size = 0;
+		Uint8 define_count = 0;
+		ShaderID id{};
 	};
 
 	struct GfxShaderKeyHash
@@ -41,4 +49,3 @@ namespace adria
 		}
 	};
 }
-
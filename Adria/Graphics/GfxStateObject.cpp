@@ -1,8 +1,51 @@
 #include "GfxStateObject.h"
 #include "GfxDevice.h"
+#include "GfxRayTracingShaderTable.h"
 
 namespace adria
 {
+	GfxStateObject::~GfxStateObject() = default;
+
+	GfxRayTracingShaderTable& GfxStateObject::GetShaderTable()
+	{
+		if (!shader_table) shader_table = std::make_unique<GfxRayTracingShaderTable>(this);
+		return *shader_table;
+	}
+
+	D3D12_PROGRAM_IDENTIFIER GfxStateObject::GetProgramIdentifier(Wchar const* program_name) const
+	{
+		Ref<ID3D12StateObjectProperties1> so_properties;
+		GFX_CHECK_HR(d3d12_so->QueryInterface(IID_PPV_ARGS(so_properties.GetAddressOf())));
+		return so_properties->GetProgramIdentifier(program_name);
+	}
+
+	Uint64 GfxStateObject::GetWorkGraphBackingMemorySize(Wchar const* program_name) const
+	{
+		Ref<ID3D12WorkGraphProperties> work_graph_properties;
+		GFX_CHECK_HR(d3d12_so->QueryInterface(IID_PPV_ARGS(work_graph_properties.GetAddressOf())));
+		Uint32 const work_graph_index = work_graph_properties->GetWorkGraphIndex(program_name);
+		D3D12_WORK_GRAPH_MEMORY_REQUIREMENTS memory_requirements{};
+		work_graph_properties->GetWorkGraphMemoryRequirements(work_graph_index, &memory_requirements);
+		return memory_requirements.MaxSizeInBytes;
+	}
+
+	void GfxStateObjectBuilder::AddRayTracingPipelineConfig(GfxDevice* gfx, Uint32 max_trace_recursion_depth)
+	{
+#if GFX_OPACITY_MICROMAPS
+		if (gfx->GetCapabilities().SupportsOpacityMicromaps())
+		{
+			D3D12_RAYTRACING_PIPELINE_CONFIG1 pipeline_config{};
+			pipeline_config.MaxTraceRecursionDepth = max_trace_recursion_depth;
+			pipeline_config.Flags = D3D12_RAYTRACING_PIPELINE_FLAG_ALLOW_OPACITY_MICROMAPS;
+			AddSubObject(pipeline_config);
+			return;
+		}
+#endif
+		D3D12_RAYTRACING_PIPELINE_CONFIG pipeline_config{};
+		pipeline_config.MaxTraceRecursionDepth = max_trace_recursion_depth;
+		AddSubObject(pipeline_config);
+	}
+
 	GfxStateObject* GfxStateObjectBuilder::CreateStateObject(GfxDevice* gfx, GfxStateObjectType type)
 	{
 		D3D12_STATE_OBJECT_TYPE d3d12_type;
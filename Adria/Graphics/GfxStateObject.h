@@ -5,6 +5,7 @@
 namespace adria
 {
 	class GfxDevice;
+	class GfxRayTracingShaderTable;
 
 	enum class GfxStateObjectType
 	{
@@ -20,21 +21,28 @@ namespace adria
 		friend class GfxRayTracingShaderTable;
 
 	public:
+		~GfxStateObject();
 		Bool IsValid() const { return d3d12_so != nullptr; }
 
+		D3D12_PROGRAM_IDENTIFIER GetProgramIdentifier(Wchar const* program_name) const;
+		Uint64 GetWorkGraphBackingMemorySize(Wchar const* program_name) const;
+
 	private:
 		Ref<ID3D12StateObject> d3d12_so;
+		std::unique_ptr<GfxRayTracingShaderTable> shader_table;
 
 	private:
 		explicit GfxStateObject(ID3D12StateObject* so)
 		{
 			d3d12_so.Attach(so);
 		}
+
+		GfxRayTracingShaderTable& GetShaderTable();
 	};
 
 	class GfxStateObjectBuilder
 	{
-		static constexpr Uint64 MAX_SUBOBJECT_DESC_SIZE = sizeof(D3D12_HIT_GROUP_DESC);
+		static constexpr Uint64 MAX_SUBOBJECT_DESC_SIZE = std::max(sizeof(D3D12_HIT_GROUP_DESC), sizeof(D3D12_WORK_GRAPH_DESC));
 	public:
 		explicit GfxStateObjectBuilder(Uint64 max_subobjects) : max_subobjects(max_subobjects), num_subobjects(0u), subobjects(max_subobjects), subobject_data(max_subobjects* MAX_SUBOBJECT_DESC_SIZE) {}
 
@@ -61,6 +69,8 @@ namespace adria
 				return AddSubObject(&desc, sizeof(desc), D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_SHADER_CONFIG);
 			else if constexpr (std::is_same_v<SubObjectDesc, D3D12_RAYTRACING_PIPELINE_CONFIG>)
 				return AddSubObject(&desc, sizeof(desc), D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_PIPELINE_CONFIG);
+			else if constexpr (std::is_same_v<SubObjectDesc, D3D12_RAYTRACING_PIPELINE_CONFIG1>)
+				return AddSubObject(&desc, sizeof(desc), D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_PIPELINE_CONFIG1);
 			else if constexpr (std::is_same_v<SubObjectDesc, D3D12_HIT_GROUP_DESC>)
 				return AddSubObject(&desc, sizeof(desc), D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP);
 			else if constexpr(std::is_same_v<SubObjectDesc, D3D12_WORK_GRAPH_DESC>)
@@ -69,6 +79,8 @@ namespace adria
 				return nullptr;
 		}
 
+		//opts the pipeline into opacity micromaps when the device supports them, they are ignored by pipelines without the flag
+		void AddRayTracingPipelineConfig(GfxDevice* gfx, Uint32 max_trace_recursion_depth);
 		GfxStateObject* CreateStateObject(GfxDevice* gfx, GfxStateObjectType type = GfxStateObjectType::RayTracingPipeline);
 
 	private:
@@ -7,10 +7,37 @@
 
 namespace adria
 {
+	static GfxFormat GetColorSpaceFormat(GfxColorSpace color_space, GfxFormat sdr_format)
+	{
+		switch (color_space)
+		{
+		case GfxColorSpace::HDR10: return GfxFormat::R10G10B10A2_UNORM;
+		case GfxColorSpace::scRGB: return GfxFormat::R16G16B16A16_FLOAT;
+		}
+		return sdr_format;
+	}
+	static DXGI_COLOR_SPACE_TYPE GetDXGIColorSpace(GfxColorSpace color_space)
+	{
+		switch (color_space)
+		{
+		case GfxColorSpace::HDR10: return DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020;
+		case GfxColorSpace::scRGB: return DXGI_COLOR_SPACE_RGB_FULL_G10_NONE_P709;
+		}
+		return DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
+	}
 
 	GfxSwapchain::GfxSwapchain(GfxDevice* gfx, GfxSwapchainDesc const& desc)
-		: gfx(gfx), width(desc.width), height(desc.height)
+		: gfx(gfx), width(desc.width), height(desc.height), backbuffer_count(GFX_BACKBUFFER_COUNT), backbuffer_format(desc.backbuffer_format), sdr_backbuffer_format(desc.backbuffer_format)
 	{
+		//headless swapchains cycle through offscreen render targets, fewer of them means fewer frames in flight
+		if (desc.headless)
+		{
+			backbuffer_count = std::clamp<Uint32>(desc.headless_buffer_count, 1, GFX_BACKBUFFER_COUNT);
+			backbuffer_index = 0;
+			CreateBackbuffers();
+			return;
+		}
+
 		DXGI_SWAP_CHAIN_DESC1 swapchain_desc{};
 		swapchain_desc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
 		swapchain_desc.BufferCount = GFX_BACKBUFFER_COUNT;
@@ -24,6 +51,15 @@ namespace adria
 		swapchain_desc.SampleDesc.Count = 1;
 		swapchain_desc.SampleDesc.Quality = 0;
 
+		Ref<IDXGIFactory5> factory5 = nullptr;
+		if (SUCCEEDED(gfx->GetFactory()->QueryInterface(IID_PPV_ARGS(factory5.GetAddressOf()))))
+		{
+			BOOL allow_tearing = FALSE;
+			tearing_supported = SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allow_tearing, sizeof(allow_tearing))) && allow_tearing;
+		}
+		if (tearing_supported) swapchain_desc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+		if (desc.frame_latency_waitable) swapchain_desc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
 		DXGI_SWAP_CHAIN_FULLSCREEN_DESC fullscreen_desc{};
 		fullscreen_desc.RefreshRate.Denominator = 60;
 		fullscreen_desc.RefreshRate.Numerator = 1;
@@ -44,12 +80,22 @@ namespace adria
 
 		swapchain.Reset();
 		swapchain1.As(&swapchain);
+
+		if (desc.frame_latency_waitable)
+		{
+			SetMaximumFrameLatency(desc.max_frame_latency);
+			frame_latency_waitable = swapchain->GetFrameLatencyWaitableObject();
+		}
 		
 		backbuffer_index = swapchain->GetCurrentBackBufferIndex();
 		CreateBackbuffers();
+		UpdateDisplayInfo();
 	}
 
-	GfxSwapchain::~GfxSwapchain() {}
+	GfxSwapchain::~GfxSwapchain()
+	{
+		if (frame_latency_waitable) CloseHandle(frame_latency_waitable);
+	}
 
 	void GfxSwapchain::SetAsRenderTarget(GfxCommandList* cmd_list)
 	{
@@ -64,13 +110,41 @@ namespace adria
 		cmd_list->ClearRenderTarget(rtv, clear_color);
 	}
 
-	Bool GfxSwapchain::Present(Bool vsync)
+	Bool GfxSwapchain::Present(Bool vsync, Bool allow_tearing, Int64 input_ticks)
 	{
-		HRESULT hr = swapchain->Present(vsync, 0);
+		if (IsHeadless())
+		{
+			backbuffer_index = (backbuffer_index + 1) % backbuffer_count;
+			return true;
+		}
+
+		Uint32 const present_flags = !vsync && allow_tearing && tearing_supported ? DXGI_PRESENT_ALLOW_TEARING : 0;
+		HRESULT hr = swapchain->Present(vsync, present_flags);
 		backbuffer_index = swapchain->GetCurrentBackBufferIndex();
+		if (SUCCEEDED(hr))
+		{
+			UINT present_count = 0;
+			if (SUCCEEDED(swapchain->GetLastPresentCount(&present_count)))
+			{
+				present_records[present_count % ARRAYSIZE(present_records)] = PresentRecord{ present_count, input_ticks };
+			}
+			UpdateDisplayLatency();
+		}
 		return SUCCEEDED(hr);
 	}
 
+	void GfxSwapchain::WaitForFrameLatency(Uint32 timeout_ms)
+	{
+		if (frame_latency_waitable) WaitForSingleObjectEx(frame_latency_waitable, timeout_ms, TRUE);
+	}
+
+	void GfxSwapchain::SetMaximumFrameLatency(Uint32 frame_latency)
+	{
+		frame_latency = std::clamp<Uint32>(frame_latency, 1, DXGI_MAX_SWAP_CHAIN_BUFFERS);
+		if (frame_latency == max_frame_latency || IsHeadless()) return;
+		if (SUCCEEDED(swapchain->SetMaximumFrameLatency(frame_latency))) max_frame_latency = frame_latency;
+	}
+
 	void GfxSwapchain::OnResize(Uint32 w, Uint32 h)
 	{
 		width = w;
@@ -80,6 +154,12 @@ namespace adria
 		{
 			back_buffers[i].reset(nullptr);
 		}
+		if (IsHeadless())
+		{
+			backbuffer_index = 0;
+			CreateBackbuffers();
+			return;
+		}
 
 		DXGI_SWAP_CHAIN_DESC desc{};
 		swapchain->GetDesc(&desc);
@@ -90,8 +170,59 @@ namespace adria
 		CreateBackbuffers();
 	}
 
+	//the caller has to make sure the backbuffers are no longer in use by the GPU
+	Bool GfxSwapchain::SetColorSpace(GfxColorSpace requested_color_space)
+	{
+		if (IsHeadless()) return false;
+		UpdateDisplayInfo();
+		if (requested_color_space != GfxColorSpace::SDR && !display_info.hdr_supported) requested_color_space = GfxColorSpace::SDR;
+
+		UINT color_space_support = 0;
+		DXGI_COLOR_SPACE_TYPE const dxgi_color_space = GetDXGIColorSpace(requested_color_space);
+		if (FAILED(swapchain->CheckColorSpaceSupport(dxgi_color_space, &color_space_support)) ||
+			!(color_space_support & DXGI_SWAP_CHAIN_COLOR_SPACE_SUPPORT_FLAG_PRESENT))
+		{
+			requested_color_space = GfxColorSpace::SDR;
+		}
+		if (requested_color_space == color_space) return false;
+
+		for (Uint32 i = 0; i < GFX_BACKBUFFER_COUNT; ++i)
+		{
+			back_buffers[i].reset(nullptr);
+		}
+
+		backbuffer_format = GetColorSpaceFormat(requested_color_space, sdr_backbuffer_format);
+		DXGI_SWAP_CHAIN_DESC desc{};
+		swapchain->GetDesc(&desc);
+		GFX_CHECK_HR(swapchain->ResizeBuffers(desc.BufferCount, width, height, ConvertGfxFormat(backbuffer_format), desc.Flags));
+		GFX_CHECK_HR(swapchain->SetColorSpace1(GetDXGIColorSpace(requested_color_space)));
+		color_space = requested_color_space;
+
+		backbuffer_index = swapchain->GetCurrentBackBufferIndex();
+		CreateBackbuffers();
+		return true;
+	}
+
 	void GfxSwapchain::CreateBackbuffers()
 	{
+		if (IsHeadless())
+		{
+			for (Uint32 i = 0; i < backbuffer_count; ++i)
+			{
+				GfxTextureDesc gfx_desc{};
+				gfx_desc.width = width;
+				gfx_desc.height = height;
+				gfx_desc.format = backbuffer_format;
+				gfx_desc.initial_state = GfxResourceState::Present;
+				gfx_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+				gfx_desc.bind_flags = GfxBindFlag::RenderTarget | GfxBindFlag::ShaderResource;
+				back_buffers[i] = gfx->CreateTexture(gfx_desc);
+				back_buffers[i]->SetName("Offscreen Backbuffer");
+				backbuffer_rtvs[i] = gfx->CreateTextureRTV(back_buffers[i].get());
+			}
+			return;
+		}
+
 		for (Uint32 i = 0; i < GFX_BACKBUFFER_COUNT; ++i)
 		{
 			Ref<ID3D12Resource> backbuffer = nullptr;
@@ -116,4 +247,38 @@ namespace adria
 		return backbuffer_rtvs[backbuffer_index];
 	}
 
+	void GfxSwapchain::UpdateDisplayInfo()
+	{
+		display_info = GfxDisplayInfo{};
+		Ref<IDXGIOutput> output = nullptr;
+		if (IsHeadless() || FAILED(swapchain->GetContainingOutput(output.GetAddressOf()))) return;
+		Ref<IDXGIOutput6> output6 = nullptr;
+		if (FAILED(output.As(&output6))) return;
+		DXGI_OUTPUT_DESC1 output_desc{};
+		if (FAILED(output6->GetDesc1(&output_desc))) return;
+
+		display_info.hdr_supported = output_desc.ColorSpace == DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020;
+		display_info.min_luminance = output_desc.MinLuminance;
+		display_info.max_luminance = output_desc.MaxLuminance;
+		display_info.max_full_frame_luminance = output_desc.MaxFullFrameLuminance;
+	}
+
+	void GfxSwapchain::UpdateDisplayLatency()
+	{
+		DXGI_FRAME_STATISTICS frame_statistics{};
+		if (FAILED(swapchain->GetFrameStatistics(&frame_statistics)))
+		{
+			display_latency_ms = std::nullopt;
+			return;
+		}
+
+		PresentRecord const& present_record = present_records[frame_statistics.PresentCount % ARRAYSIZE(present_records)];
+		if (present_record.present_count != frame_statistics.PresentCount || present_record.input_ticks == 0) return;
+
+		static LARGE_INTEGER qpc_frequency{};
+		if (qpc_frequency.QuadPart == 0) QueryPerformanceFrequency(&qpc_frequency);
+		Int64 const latency_ticks = frame_statistics.SyncQPCTime.QuadPart - present_record.input_ticks;
+		if (latency_ticks > 0) display_latency_ms = (Float)(1000.0 * latency_ticks / qpc_frequency.QuadPart);
+	}
+
 }
@@ -1,8 +1,10 @@
 #pragma once
 #include <memory>
+#include <optional>
 #include "GfxFormat.h"
 #include "GfxMacros.h"
 #include "GfxDescriptor.h"
+#include "GfxDisplay.h"
 
 namespace adria
 {
@@ -16,6 +18,10 @@ namespace adria
 		Uint32 height = 0;
 		GfxFormat backbuffer_format = GfxFormat::R8G8B8A8_UNORM_SRGB;
 		Bool fullscreen_windowed = false;
+		Bool frame_latency_waitable = true;
+		Uint32 max_frame_latency = 1;
+		Bool headless = false;
+		Uint32 headless_buffer_count = GFX_BACKBUFFER_COUNT;
 	};
 
 	class GfxSwapchain
@@ -26,9 +32,21 @@ namespace adria
 
 		void SetAsRenderTarget(GfxCommandList* cmd_list);
 		void ClearBackbuffer(GfxCommandList* cmd_list);
-		Bool Present(Bool vsync);
+		Bool Present(Bool vsync, Bool allow_tearing = false, Int64 input_ticks = 0);
 		void OnResize(Uint32 w, Uint32 h);
 
+		void WaitForFrameLatency(Uint32 timeout_ms = 1000);
+		void SetMaximumFrameLatency(Uint32 frame_latency);
+		Uint32 GetMaximumFrameLatency() const { return max_frame_latency; }
+		Bool IsTearingSupported() const { return tearing_supported; }
+		std::optional<Float> GetDisplayLatency() const { return display_latency_ms; }
+
+		Bool SetColorSpace(GfxColorSpace requested_color_space);
+		GfxColorSpace GetColorSpace() const { return color_space; }
+		GfxFormat GetBackbufferFormat() const { return backbuffer_format; }
+		GfxDisplayInfo const& GetDisplayInfo() const { return display_info; }
+
+		Bool IsHeadless() const { return swapchain == nullptr; }
 		Uint32 GetBackbufferIndex() const { return backbuffer_index; }
 		GfxTexture* GetBackbuffer() const { return back_buffers[backbuffer_index].get(); }
 		
@@ -40,9 +58,28 @@ namespace adria
 		Uint32		 width;
 		Uint32		 height;
 		Uint32		 backbuffer_index;
+		Uint32		 backbuffer_count;
+		GfxFormat	 backbuffer_format;
+		GfxFormat	 sdr_backbuffer_format;
+		GfxColorSpace  color_space = GfxColorSpace::SDR;
+		GfxDisplayInfo display_info;
+
+		HANDLE		 frame_latency_waitable = nullptr;
+		Uint32		 max_frame_latency = 0;
+		Bool		 tearing_supported = false;
+
+		struct PresentRecord
+		{
+			Uint32 present_count;
+			Int64 input_ticks;
+		};
+		PresentRecord present_records[8] = {};
+		std::optional<Float> display_latency_ms;
 
 	private:
 		void CreateBackbuffers();
 		GfxDescriptor GetBackbufferDescriptor() const;
+		void UpdateDisplayLatency();
+		void UpdateDisplayInfo();
 	};
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "GfxResourceCommon.h"
+#include "GfxMemoryTracker.h"
 
 namespace adria
 {
@@ -106,16 +107,25 @@ namespace adria
 		Uint32 sub_count = Uint32(-1);
 	};
 
+	struct GfxTextureAllocationInfo
+	{
+		Uint64 size = 0;
+		Uint64 alignment = 0;
+	};
+
 	class GfxTexture
 	{
 	public:
 		GfxTexture(GfxDevice* gfx, GfxTextureDesc const& desc, GfxTextureData const& data);
 		GfxTexture(GfxDevice* gfx, GfxTextureDesc const& desc);
 		GfxTexture(GfxDevice* gfx, GfxTextureDesc const& desc, void* backbuffer); //constructor used by swapchain for creating backbuffer texture
+		GfxTexture(GfxDevice* gfx, GfxTextureDesc const& desc, D3D12MA::Allocation* heap_allocation, Uint64 heap_offset); //constructor used for placing aliased textures in existing heap memory
 		ADRIA_NONCOPYABLE_NONMOVABLE(GfxTexture)
 		~GfxTexture();
 
 		ID3D12Resource* GetNative() const;
+		//null for textures placed in shared heaps, those can't be paged on their own
+		ID3D12Pageable* GetPageable() const;
 
 		GfxDevice* GetParent() const { return gfx; }
 		GfxTextureDesc const& GetDesc() const { return desc; }
@@ -135,11 +145,14 @@ namespace adria
 
 		void SetName(Char const* name);
 
+		static GfxTextureAllocationInfo GetAllocationInfo(GfxDevice* gfx, GfxTextureDesc const& desc);
+
 	private:
 		GfxDevice* gfx;
 		Ref<ID3D12Resource> resource;
 		GfxTextureDesc desc;
 		ReleasablePtr<D3D12MA::Allocation> allocation = nullptr;
+		GfxMemoryCategory memory_category = GfxMemoryCategory::Other;
 		void* mapped_data = nullptr;
 		Bool is_backbuffer = false;
 	};
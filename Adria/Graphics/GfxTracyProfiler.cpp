@@ -1,3 +1,4 @@
+#include <atomic>
 #include "GfxTracyProfiler.h"
 #include "GfxDevice.h"
 #include "GfxCommandList.h"
@@ -7,18 +8,32 @@ namespace adria
 	namespace
 	{
 		TracyD3D12Ctx _tracy_ctx = nullptr;
+		TracyD3D12Ctx _tracy_compute_ctx = nullptr;
+		TracyD3D12Ctx _tracy_copy_ctx = nullptr;
+		std::atomic<Uint32> _frame_barrier_count = 0;
+		std::atomic<Uint32> _frame_barrier_batch_count = 0;
 	}
 
 	void GfxTracyProfiler::Initialize(GfxDevice* gfx)
 	{
 #if GFX_PROFILING_USE_TRACY
 		_tracy_ctx = TracyD3D12Context(gfx->GetDevice(), gfx->GetCommandQueue(GfxCommandListType::Graphics));
+		_tracy_compute_ctx = TracyD3D12Context(gfx->GetDevice(), gfx->GetCommandQueue(GfxCommandListType::Compute));
+		TracyD3D12ContextName(_tracy_ctx, "Graphics Queue", 14);
+		TracyD3D12ContextName(_tracy_compute_ctx, "Async Compute Queue", 19);
+		if (gfx->GetCapabilities().SupportsCopyQueueTimestamps())
+		{
+			_tracy_copy_ctx = TracyD3D12Context(gfx->GetDevice(), gfx->GetCommandQueue(GfxCommandListType::Copy));
+			TracyD3D12ContextName(_tracy_copy_ctx, "Copy Queue", 10);
+		}
 #endif
 	}
 
 	void GfxTracyProfiler::Destroy()
 	{
 #if GFX_PROFILING_USE_TRACY
+		if (_tracy_copy_ctx) TracyD3D12Destroy(_tracy_copy_ctx);
+		TracyD3D12Destroy(_tracy_compute_ctx);
 		TracyD3D12Destroy(_tracy_ctx);
 #endif
 	}
@@ -28,14 +43,37 @@ namespace adria
 #if GFX_PROFILING_USE_TRACY
 		TracyD3D12Collect(_tracy_ctx);
 		TracyD3D12NewFrame(_tracy_ctx);
+		TracyD3D12Collect(_tracy_compute_ctx);
+		TracyD3D12NewFrame(_tracy_compute_ctx);
+		if (_tracy_copy_ctx)
+		{
+			TracyD3D12Collect(_tracy_copy_ctx);
+			TracyD3D12NewFrame(_tracy_copy_ctx);
+		}
+		TracyPlot("Barriers Per Frame", (int64_t)_frame_barrier_count.exchange(0));
+		TracyPlot("Barrier Batches Per Frame", (int64_t)_frame_barrier_batch_count.exchange(0));
 #endif
 	}
 
-	TracyD3D12Ctx GfxTracyProfiler::GetCtx()
+	TracyD3D12Ctx GfxTracyProfiler::GetCtx(GfxCommandListType type)
 	{
+		switch (type)
+		{
+		case GfxCommandListType::Compute: return _tracy_compute_ctx;
+		case GfxCommandListType::Copy: return _tracy_copy_ctx ? _tracy_copy_ctx : _tracy_ctx;
+		}
 		return _tracy_ctx;
 	}
 
+	void GfxTracyProfiler::OnBarrierBatch(Uint32 barrier_count)
+	{
+#if GFX_PROFILING_USE_TRACY
+		_frame_barrier_count += barrier_count;
+		++_frame_barrier_batch_count;
+		TracyPlot("Barrier Batch Size", (int64_t)barrier_count);
+#endif
+	}
+
 }
 
 
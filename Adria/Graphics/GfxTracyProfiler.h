@@ -1,25 +1,32 @@
 #pragma once
 #include "GfxMacros.h"
+#include "tracy/Tracy.hpp"
 #include "tracy/TracyD3D12.hpp"
 
 namespace adria
 {
 	class GfxDevice;
+	enum class GfxCommandListType : Uint8;
 	namespace GfxTracyProfiler
 	{
 		void Initialize(GfxDevice* gfx);
 		void Destroy();
 		void NewFrame();
-		TracyD3D12Ctx GetCtx();
+		TracyD3D12Ctx GetCtx(GfxCommandListType type);
+		void OnBarrierBatch(Uint32 barrier_count);
 	};
-	#define g_TracyGfxCtx GfxTracyProfiler::GetCtx()
+	#define g_TracyGfxCtx GfxTracyProfiler::GetCtx(GfxCommandListType::Graphics)
 
 	
 #if GFX_PROFILING_USE_TRACY
 	#define TracyGfxProfileScope(cmd_list, name)				TracyD3D12ZoneTransient(g_TracyGfxCtx, ___tracy_gpu_zone, cmd_list, name, true)
 	#define TracyGfxProfileCondScope(cmd_list, name, active)	TracyD3D12ZoneTransient(g_TracyGfxCtx, ___tracy_gpu_zone, cmd_list, name, active)
+	#define TracyGfxQueueProfileScope(type, cmd_list, name)		TracyD3D12ZoneTransient(GfxTracyProfiler::GetCtx(type), ___tracy_gpu_zone, cmd_list, name, true)
+	#define TracyGfxBarrierBatch(type, cmd_list, count)			TracyD3D12ZoneTransient(GfxTracyProfiler::GetCtx(type), ___tracy_gpu_zone, cmd_list, "Barriers", true); GfxTracyProfiler::OnBarrierBatch(count)
 #else
 	#define TracyGfxProfileScope(cmd_list, name) 
 	#define TracyGfxProfileCondScope(cmd_list, name, active) 
+	#define TracyGfxQueueProfileScope(type, cmd_list, name) 
+	#define TracyGfxBarrierBatch(type, cmd_list, count) 
 #endif
 }
\ No newline at end of file
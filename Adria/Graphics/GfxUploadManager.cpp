@@ -0,0 +1,91 @@
+#include <bit>
+#include "GfxUploadManager.h"
+#include "GfxDevice.h"
+#include "GfxBuffer.h"
+#include "GfxCommandList.h"
+#include "GfxCommandQueue.h"
+
+namespace adria
+{
+
+	GfxUploadManager::GfxUploadManager(GfxDevice* gfx, Uint64 initial_staging_size) : gfx(gfx), ring_allocator(0)
+	{
+		fence.Create(gfx, "Upload Manager Fence");
+		CreateStagingBuffer(initial_staging_size);
+	}
+
+	GfxUploadManager::~GfxUploadManager() = default;
+
+	void GfxUploadManager::UploadBuffer(GfxBuffer& dst, void const* data, Uint64 size, Uint64 dst_offset, GfxResourceState dst_state)
+	{
+		ADRIA_ASSERT(dst_offset + size <= dst.GetSize());
+		if (size == 0) return;
+		//frames in flight may still read a mapped buffer, those have to be versioned per frame slot by the caller
+		ADRIA_ASSERT(!dst.IsMapped());
+
+		std::lock_guard lock(upload_mutex);
+		Uint64 const aligned_size = Align(size, STAGING_ALIGNMENT);
+		Uint64 offset = ring_allocator.Allocate(aligned_size);
+		if (offset == INVALID_ALLOC_OFFSET)
+		{
+			//copies already queued keep pointing at the old ring, it is released together with the frame
+			retired_staging_buffers.emplace_back(std::move(staging_buffer), fence_value);
+			CreateStagingBuffer(std::bit_ceil(std::max(staging_size * 2, aligned_size)));
+			offset = ring_allocator.Allocate(aligned_size);
+			ADRIA_ASSERT(offset != INVALID_ALLOC_OFFSET);
+		}
+
+		memcpy(staging_cpu_address + offset, data, size);
+		pending_copies.emplace_back(&dst, dst_offset, staging_buffer.get(), offset, size, dst_state);
+	}
+
+	void GfxUploadManager::Flush(GfxCommandList* cmd_list)
+	{
+		std::lock_guard lock(upload_mutex);
+		if (pending_copies.empty()) return;
+
+		//default heap buffers outside of the render graph decay to common after every submission and are promoted by the copy
+		for (PendingBufferCopy const& copy : pending_copies)
+		{
+			cmd_list->CopyBuffer(*copy.dst, copy.dst_offset, *copy.staging, copy.staging_offset, copy.size);
+		}
+		std::sort(pending_copies.begin(), pending_copies.end(), [](PendingBufferCopy const& a, PendingBufferCopy const& b) { return a.dst < b.dst; });
+		for (Uint64 i = 0; i < pending_copies.size(); ++i)
+		{
+			if (i > 0 && pending_copies[i].dst == pending_copies[i - 1].dst) continue;
+			cmd_list->BufferBarrier(*pending_copies[i].dst, GfxResourceState::CopyDst, pending_copies[i].dst_state);
+		}
+		cmd_list->FlushBarriers();
+		pending_copies.clear();
+	}
+
+	void GfxUploadManager::Submit(GfxCommandQueue& queue)
+	{
+		std::lock_guard lock(upload_mutex);
+		ring_allocator.FinishCurrentFrame(fence_value);
+		queue.Signal(fence, fence_value);
+		++fence_value;
+	}
+
+	void GfxUploadManager::ProcessCompleted()
+	{
+		std::lock_guard lock(upload_mutex);
+		Uint64 const completed_value = fence.GetCompletedValue();
+		ring_allocator.ReleaseCompletedFrames(completed_value);
+		std::erase_if(retired_staging_buffers, [completed_value](RetiredStagingBuffer const& retired) { return retired.fence_value <= completed_value; });
+	}
+
+	void GfxUploadManager::CreateStagingBuffer(Uint64 size)
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::DynamicUpload);
+		GfxBufferDesc desc{};
+		desc.size = size;
+		desc.resource_usage = GfxResourceUsage::Upload;
+		staging_buffer = gfx->CreateBuffer(desc);
+		staging_buffer->SetName("Upload Manager Staging Buffer");
+		ADRIA_ASSERT(staging_buffer->IsMapped());
+		staging_cpu_address = static_cast<Uint8*>(staging_buffer->GetMappedData());
+		staging_size = size;
+		ring_allocator = RingAllocator(size);
+	}
+}
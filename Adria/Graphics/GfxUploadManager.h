@@ -0,0 +1,65 @@
+#pragma once
+#include <mutex>
+#include "GfxFence.h"
+#include "GfxResourceCommon.h"
+#include "Utilities/RingAllocator.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxCommandList;
+	class GfxCommandQueue;
+
+	//stages CPU data in a ring of upload memory and records all queued copies into default heap buffers at the start of the frame,
+	//the ring grows when a frame does not fit and its memory is recycled once the fence passes the frame that used it
+	class GfxUploadManager
+	{
+		static constexpr Uint64 STAGING_ALIGNMENT = 16;
+
+		struct PendingBufferCopy
+		{
+			GfxBuffer* dst;
+			Uint64 dst_offset;
+			GfxBuffer* staging;
+			Uint64 staging_offset;
+			Uint64 size;
+			GfxResourceState dst_state;
+		};
+		struct RetiredStagingBuffer
+		{
+			std::unique_ptr<GfxBuffer> buffer;
+			Uint64 fence_value;
+		};
+
+	public:
+		GfxUploadManager(GfxDevice* gfx, Uint64 initial_staging_size);
+		ADRIA_NONCOPYABLE_NONMOVABLE(GfxUploadManager)
+		~GfxUploadManager();
+
+		//destinations are default heap buffers, the copy is ordered on the frame's command list
+		void UploadBuffer(GfxBuffer& dst, void const* data, Uint64 size, Uint64 dst_offset = 0, GfxResourceState dst_state = GfxResourceState::AllSRV);
+
+		void Flush(GfxCommandList* cmd_list);
+		void Submit(GfxCommandQueue& queue);
+		void ProcessCompleted();
+
+		Uint64 GetStagingSize() const { return staging_size; }
+
+	private:
+		GfxDevice* gfx;
+		GfxFence fence;
+		Uint64 fence_value = 1;
+		std::mutex upload_mutex;
+
+		std::unique_ptr<GfxBuffer> staging_buffer;
+		Uint8* staging_cpu_address = nullptr;
+		Uint64 staging_size = 0;
+		RingAllocator ring_allocator;
+		std::vector<RetiredStagingBuffer> retired_staging_buffers;
+		std::vector<PendingBufferCopy> pending_copies;
+
+	private:
+		void CreateStagingBuffer(Uint64 size);
+	};
+}
@@ -0,0 +1,517 @@
+#include "GfxVideoEncoder.h"
+#include "GfxDevice.h"
+#include "GfxBuffer.h"
+#include "GfxTexture.h"
+#include "GfxCommandList.h"
+#include "GfxReadbackQueue.h"
+#include "Utilities/AllocatorUtil.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	namespace
+	{
+		class BitstreamWriter
+		{
+		public:
+			void WriteBits(Uint32 value, Uint32 count)
+			{
+				for (Int32 i = (Int32)count - 1; i >= 0; --i) WriteBit((value >> i) & 1);
+			}
+			void WriteUE(Uint32 value)
+			{
+				Uint32 const code = value + 1;
+				Uint32 const length = (Uint32)std::bit_width(code);
+				WriteBits(0, length - 1);
+				WriteBits(code, length);
+			}
+			void WriteSE(Int32 value)
+			{
+				WriteUE(value <= 0 ? Uint32(-2 * value) : Uint32(2 * value - 1));
+			}
+			void WriteTrailingBits()
+			{
+				WriteBit(1);
+				while (bit_count != 0) WriteBit(0);
+			}
+
+			std::vector<Uint8> const& GetBytes() const { return bytes; }
+
+		private:
+			std::vector<Uint8> bytes;
+			Uint8 current = 0;
+			Uint32 bit_count = 0;
+
+		private:
+			void WriteBit(Uint32 bit)
+			{
+				current = Uint8((current << 1) | bit);
+				if (++bit_count == 8)
+				{
+					bytes.push_back(current);
+					current = 0;
+					bit_count = 0;
+				}
+			}
+		};
+
+		void AppendNalUnit(std::vector<Uint8>& output, Uint8 nal_header, std::vector<Uint8> const& rbsp)
+		{
+			output.insert(output.end(), { 0, 0, 0, 1, nal_header });
+			Uint32 zero_count = 0;
+			for (Uint8 byte : rbsp)
+			{
+				if (zero_count >= 2 && byte <= 3)
+				{
+					output.push_back(3);
+					zero_count = 0;
+				}
+				output.push_back(byte);
+				zero_count = byte == 0 ? zero_count + 1 : 0;
+			}
+		}
+
+		Uint32 GetLevelIdc(D3D12_VIDEO_ENCODER_LEVELS_H264 level)
+		{
+			switch (level)
+			{
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_1:  return 10;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_1b: return 11;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_11: return 11;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_12: return 12;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_13: return 13;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_2:  return 20;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_21: return 21;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_22: return 22;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_3:  return 30;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_31: return 31;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_32: return 32;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_4:  return 40;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_41: return 41;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_42: return 42;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_5:  return 50;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_51: return 51;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_52: return 52;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_6:  return 60;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_61: return 61;
+			case D3D12_VIDEO_ENCODER_LEVELS_H264_62: return 62;
+			}
+			return 51;
+		}
+
+		//nv12 planes of an array texture are separate subresources, so every barrier on a slice covers both of them
+		void AddSliceBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers, ID3D12Resource* resource, Uint32 slice, Uint32 slice_count, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+		{
+			for (Uint32 plane = 0; plane < 2; ++plane)
+			{
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after, D3D12CalcSubresource(0, slice, plane, 1, slice_count)));
+			}
+		}
+
+		constexpr Uint32 RECONSTRUCTED_PICTURE_COUNT = 2;
+	}
+
+	GfxVideoEncoder::GfxVideoEncoder(GfxDevice* gfx, GfxVideoEncoderDesc const& _desc, GfxVideoBitstreamCallback&& callback) : gfx(gfx), desc(_desc), callback(std::move(callback))
+	{
+		desc.width = (Uint32)Align(desc.width, 2);
+		desc.height = (Uint32)Align(desc.height, 2);
+
+		if (FAILED(gfx->GetDevice()->QueryInterface(IID_PPV_ARGS(video_device.GetAddressOf()))))
+		{
+			ADRIA_LOG(WARNING, "Video encoding is not supported by the device!");
+			return;
+		}
+
+		codec_config.ConfigurationFlags = D3D12_VIDEO_ENCODER_CODEC_CONFIGURATION_H264_FLAG_NONE;
+		codec_config.DirectModeConfig = D3D12_VIDEO_ENCODER_CODEC_CONFIGURATION_H264_DIRECT_MODES_DISABLED;
+		codec_config.DisableDeblockingFilterConfig = D3D12_VIDEO_ENCODER_CODEC_CONFIGURATION_H264_SLICES_DEBLOCKING_MODE_0_ALL_LUMA_CHROMA_SLICE_BLOCK_EDGES_ALWAYS_FILTERED;
+
+		//only I and P frames, frame_num wraps inside the gop and poc type 2 derives the picture order from it
+		gop.GOPLength = desc.gop_length;
+		gop.PPicturePeriod = 1;
+		gop.pic_order_cnt_type = 2;
+		gop.log2_max_frame_num_minus4 = (UCHAR)std::clamp((Int32)std::bit_width(desc.gop_length) - 4, 0, 12);
+		gop.log2_max_pic_order_cnt_lsb_minus4 = 0;
+
+		cqp.ConstantQP_FullIntracodedFrame = desc.qp;
+		cqp.ConstantQP_InterPredictedFrame_PrevRefOnly = desc.qp + 2;
+		cqp.ConstantQP_InterPredictedFrame_BiDirectionalRef = desc.qp + 2;
+
+		level = desc.width * desc.height > 2560 * 1440 ? D3D12_VIDEO_ENCODER_LEVELS_H264_51 : D3D12_VIDEO_ENCODER_LEVELS_H264_42;
+		if (!CheckSupport()) return;
+
+		D3D12_VIDEO_ENCODER_DESC encoder_desc{};
+		encoder_desc.NodeMask = 0;
+		encoder_desc.Flags = D3D12_VIDEO_ENCODER_FLAG_NONE;
+		encoder_desc.EncodeCodec = D3D12_VIDEO_ENCODER_CODEC_H264;
+		encoder_desc.EncodeProfile = GetProfileDesc();
+		encoder_desc.InputFormat = DXGI_FORMAT_NV12;
+		encoder_desc.CodecConfiguration = GetCodecConfiguration();
+		encoder_desc.MaxMotionEstimationPrecision = D3D12_VIDEO_ENCODER_MOTION_ESTIMATION_PRECISION_MODE_MAXIMUM;
+		GFX_CHECK_HR(video_device->CreateVideoEncoder(&encoder_desc, IID_PPV_ARGS(encoder.GetAddressOf())));
+
+		D3D12_VIDEO_ENCODER_PICTURE_RESOLUTION_DESC resolution{ desc.width, desc.height };
+		D3D12_VIDEO_ENCODER_HEAP_DESC heap_desc{};
+		heap_desc.NodeMask = 0;
+		heap_desc.Flags = D3D12_VIDEO_ENCODER_HEAP_FLAG_NONE;
+		heap_desc.EncodeCodec = D3D12_VIDEO_ENCODER_CODEC_H264;
+		heap_desc.EncodeProfile = GetProfileDesc();
+		heap_desc.EncodeLevel = { sizeof(level), { &level } };
+		heap_desc.ResolutionsListCount = 1;
+		heap_desc.pResolutionList = &resolution;
+		GFX_CHECK_HR(video_device->CreateVideoEncoderHeap(&heap_desc, IID_PPV_ARGS(encoder_heap.GetAddressOf())));
+
+		CreateResources();
+		CreateParameterSets();
+		ADRIA_LOG(INFO, "Created H.264 video encoder %ux%u, level %u", desc.width, desc.height, GetLevelIdc(level));
+	}
+
+	GfxVideoEncoder::~GfxVideoEncoder()
+	{
+		if (video_fence_value > 0) video_fence.Wait(video_fence_value);
+	}
+
+	void GfxVideoEncoder::EncodeFrame(GfxCommandList* cmd_list, GfxTexture const& luma, GfxTexture const& chroma)
+	{
+		ADRIA_ASSERT(IsValid());
+		ADRIA_ASSERT(luma.GetWidth() == desc.width && luma.GetHeight() == desc.height);
+
+		//frames are read back once the next slots are in flight, the graphics queue only waits on encodes that have long finished
+		for (FrameSlot& slot : frame_slots)
+		{
+			if (slot.pending_readback && slot.frame + FRAME_SLOTS - 1 <= frame_count) EnqueueReadback(cmd_list, slot);
+		}
+
+		FrameSlot& slot = frame_slots[frame_count % FRAME_SLOTS];
+		ADRIA_ASSERT(!slot.pending_readback);
+		video_fence.Wait(slot.fence_value);
+
+		cmd_list->FlushBarriers();
+		ID3D12GraphicsCommandList* native_cmd_list = cmd_list->GetNative();
+		ID3D12Resource* input_frame = slot.input_frame.Get();
+		{
+			D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(input_frame, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+			native_cmd_list->ResourceBarrier(1, &barrier);
+
+			GfxTexture const* planes[] = { &luma, &chroma };
+			for (Uint32 plane = 0; plane < ARRAYSIZE(planes); ++plane)
+			{
+				CD3DX12_TEXTURE_COPY_LOCATION dst(input_frame, plane);
+				CD3DX12_TEXTURE_COPY_LOCATION src(planes[plane]->GetNative(), 0);
+				native_cmd_list->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			barrier = CD3DX12_RESOURCE_BARRIER::Transition(input_frame, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
+			native_cmd_list->ResourceBarrier(1, &barrier);
+		}
+		cmd_list->Signal(copy_fence, ++copy_fence_value);
+
+		Bool const idr = frame_num == 0;
+		Uint32 const current_picture = frame_num % RECONSTRUCTED_PICTURE_COUNT;
+		Uint32 const reference_picture = (frame_num + 1) % RECONSTRUCTED_PICTURE_COUNT;
+		ID3D12Resource* reconstructed = reconstructed_pictures.Get();
+
+		GFX_CHECK_HR(slot.cmd_allocator->Reset());
+		GFX_CHECK_HR(video_cmd_list->Reset(slot.cmd_allocator.Get()));
+
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(input_frame, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_VIDEO_ENCODE_READ));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.bitstream->GetNative(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.metadata->GetNative(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE));
+		AddSliceBarriers(barriers, reconstructed, current_picture, RECONSTRUCTED_PICTURE_COUNT, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE);
+		if (!idr) AddSliceBarriers(barriers, reconstructed, reference_picture, RECONSTRUCTED_PICTURE_COUNT, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_VIDEO_ENCODE_READ);
+		video_cmd_list->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+		UINT reference_subresource = reference_picture;
+		UINT list0_references[] = { 0 };
+		D3D12_VIDEO_ENCODER_REFERENCE_PICTURE_DESCRIPTOR_H264 reference_descriptor{};
+		reference_descriptor.ReconstructedPictureResourceIndex = 0;
+		reference_descriptor.IsLongTermReference = FALSE;
+		reference_descriptor.PictureOrderCountNumber = 2 * (frame_num - 1);
+		reference_descriptor.FrameDecodingOrderNumber = frame_num - 1;
+
+		D3D12_VIDEO_ENCODER_PICTURE_CONTROL_CODEC_DATA_H264 picture_data{};
+		picture_data.Flags = D3D12_VIDEO_ENCODER_PICTURE_CONTROL_CODEC_DATA_H264_FLAG_NONE;
+		picture_data.FrameType = idr ? D3D12_VIDEO_ENCODER_FRAME_TYPE_H264_IDR_FRAME : D3D12_VIDEO_ENCODER_FRAME_TYPE_H264_P_FRAME;
+		picture_data.pic_parameter_set_id = 0;
+		picture_data.idr_pic_id = idr_pic_id;
+		picture_data.PictureOrderCountNumber = 2 * frame_num;
+		picture_data.FrameDecodingOrderNumber = frame_num;
+		picture_data.TemporalLayerIndex = 0;
+		if (!idr)
+		{
+			picture_data.List0ReferenceFramesCount = 1;
+			picture_data.pList0ReferenceFrames = list0_references;
+			picture_data.ReferenceFramesReconPictureDescriptorsCount = 1;
+			picture_data.pReferenceFramesReconPictureDescriptors = &reference_descriptor;
+		}
+
+		D3D12_VIDEO_ENCODER_PICTURE_RESOLUTION_DESC resolution{ desc.width, desc.height };
+		D3D12_VIDEO_ENCODER_SEQUENCE_CONTROL_DESC sequence_control{};
+		sequence_control.Flags = D3D12_VIDEO_ENCODER_SEQUENCE_CONTROL_FLAG_NONE;
+		sequence_control.IntraRefreshConfig = { D3D12_VIDEO_ENCODER_INTRA_REFRESH_MODE_NONE, 0 };
+		sequence_control.RateControl = GetRateControl();
+		sequence_control.PictureTargetResolution = resolution;
+		sequence_control.SelectedLayoutMode = D3D12_VIDEO_ENCODER_FRAME_SUBREGION_LAYOUT_MODE_FULL_FRAME;
+		sequence_control.FrameSubregionsLayoutData = {};
+		sequence_control.CodecGopSequence = GetGopStructure();
+
+		D3D12_VIDEO_ENCODER_PICTURE_CONTROL_DESC picture_control{};
+		picture_control.IntraRefreshFrameIndex = 0;
+		picture_control.Flags = D3D12_VIDEO_ENCODER_PICTURE_CONTROL_FLAG_USED_AS_REFERENCE_PICTURE;
+		picture_control.PictureControlCodecData = { sizeof(picture_data), { &picture_data } };
+		if (!idr) picture_control.ReferenceFrames = { 1, &reconstructed, &reference_subresource };
+
+		D3D12_VIDEO_ENCODER_ENCODEFRAME_INPUT_ARGUMENTS input_arguments{};
+		input_arguments.SequenceControlDesc = sequence_control;
+		input_arguments.PictureControlDesc = picture_control;
+		input_arguments.pInputFrame = input_frame;
+		input_arguments.InputFrameSubresource = 0;
+		input_arguments.CurrentFrameBitstreamMetadataSize = 0;
+
+		D3D12_VIDEO_ENCODER_ENCODEFRAME_OUTPUT_ARGUMENTS output_arguments{};
+		output_arguments.Bitstream = { slot.bitstream->GetNative(), 0 };
+		output_arguments.ReconstructedPicture = { reconstructed, current_picture };
+		output_arguments.EncoderOutputMetadata = { slot.metadata->GetNative(), 0 };
+		video_cmd_list->EncodeFrame(encoder.Get(), encoder_heap.Get(), &input_arguments, &output_arguments);
+
+		barriers.clear();
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.metadata->GetNative(), D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE, D3D12_RESOURCE_STATE_VIDEO_ENCODE_READ));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.resolved_metadata->GetNative(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE));
+		video_cmd_list->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+		D3D12_VIDEO_ENCODER_RESOLVE_METADATA_INPUT_ARGUMENTS resolve_input{};
+		resolve_input.EncoderCodec = D3D12_VIDEO_ENCODER_CODEC_H264;
+		resolve_input.EncoderProfile = GetProfileDesc();
+		resolve_input.EncoderInputFormat = DXGI_FORMAT_NV12;
+		resolve_input.EncodedPictureEffectiveResolution = resolution;
+		resolve_input.HWLayoutMetadata = { slot.metadata->GetNative(), 0 };
+		D3D12_VIDEO_ENCODER_RESOLVE_METADATA_OUTPUT_ARGUMENTS resolve_output{};
+		resolve_output.ResolvedLayoutMetadata = { slot.resolved_metadata->GetNative(), 0 };
+		video_cmd_list->ResolveEncoderOutputMetadata(&resolve_input, &resolve_output);
+
+		barriers.clear();
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(input_frame, D3D12_RESOURCE_STATE_VIDEO_ENCODE_READ, D3D12_RESOURCE_STATE_COMMON));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.bitstream->GetNative(), D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE, D3D12_RESOURCE_STATE_COMMON));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.metadata->GetNative(), D3D12_RESOURCE_STATE_VIDEO_ENCODE_READ, D3D12_RESOURCE_STATE_COMMON));
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(slot.resolved_metadata->GetNative(), D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE, D3D12_RESOURCE_STATE_COMMON));
+		AddSliceBarriers(barriers, reconstructed, current_picture, RECONSTRUCTED_PICTURE_COUNT, D3D12_RESOURCE_STATE_VIDEO_ENCODE_WRITE, D3D12_RESOURCE_STATE_COMMON);
+		if (!idr) AddSliceBarriers(barriers, reconstructed, reference_picture, RECONSTRUCTED_PICTURE_COUNT, D3D12_RESOURCE_STATE_VIDEO_ENCODE_READ, D3D12_RESOURCE_STATE_COMMON);
+		video_cmd_list->ResourceBarrier((UINT)barriers.size(), barriers.data());
+		GFX_CHECK_HR(video_cmd_list->Close());
+
+		//the wait is on a value the graphics queue signals only once this frame's lists are executed
+		ID3D12CommandList* cmd_lists[] = { video_cmd_list.Get() };
+		GFX_CHECK_HR(video_queue->Wait(copy_fence, copy_fence_value));
+		video_queue->ExecuteCommandLists(1, cmd_lists);
+		GFX_CHECK_HR(video_queue->Signal(video_fence, ++video_fence_value));
+
+		slot.fence_value = video_fence_value;
+		slot.frame = frame_count;
+		slot.idr = idr;
+		slot.pending_readback = true;
+
+		++frame_count;
+		if (idr) ++idr_pic_id;
+		frame_num = (frame_num + 1) % desc.gop_length;
+	}
+
+	void GfxVideoEncoder::ReadbackAll(GfxCommandList* cmd_list)
+	{
+		std::vector<FrameSlot*> pending_slots;
+		for (FrameSlot& slot : frame_slots)
+		{
+			if (slot.pending_readback) pending_slots.push_back(&slot);
+		}
+		std::sort(pending_slots.begin(), pending_slots.end(), [](FrameSlot const* a, FrameSlot const* b) { return a->frame < b->frame; });
+		for (FrameSlot* slot : pending_slots) EnqueueReadback(cmd_list, *slot);
+	}
+
+	Bool GfxVideoEncoder::CheckSupport()
+	{
+		D3D12_FEATURE_DATA_VIDEO_ENCODER_CODEC codec_support{};
+		codec_support.NodeIndex = 0;
+		codec_support.Codec = D3D12_VIDEO_ENCODER_CODEC_H264;
+		if (FAILED(video_device->CheckFeatureSupport(D3D12_FEATURE_VIDEO_ENCODER_CODEC, &codec_support, sizeof(codec_support))) || !codec_support.IsSupported)
+		{
+			ADRIA_LOG(WARNING, "H.264 video encoding is not supported by the device!");
+			return false;
+		}
+
+		D3D12_VIDEO_ENCODER_PICTURE_RESOLUTION_DESC resolution{ desc.width, desc.height };
+		D3D12_FEATURE_DATA_VIDEO_ENCODER_RESOLUTION_SUPPORT_LIMITS resolution_limits{};
+		D3D12_VIDEO_ENCODER_PROFILE_H264 suggested_profile{};
+		D3D12_VIDEO_ENCODER_LEVELS_H264 suggested_level{};
+
+		D3D12_FEATURE_DATA_VIDEO_ENCODER_SUPPORT support{};
+		support.NodeIndex = 0;
+		support.Codec = D3D12_VIDEO_ENCODER_CODEC_H264;
+		support.InputFormat = DXGI_FORMAT_NV12;
+		support.CodecConfiguration = GetCodecConfiguration();
+		support.CodecGopSequence = GetGopStructure();
+		support.RateControl = GetRateControl();
+		support.IntraRefresh = D3D12_VIDEO_ENCODER_INTRA_REFRESH_MODE_NONE;
+		support.SubregionFrameEncoding = D3D12_VIDEO_ENCODER_FRAME_SUBREGION_LAYOUT_MODE_FULL_FRAME;
+		support.ResolutionsListCount = 1;
+		support.pResolutionList = &resolution;
+		support.MaxReferenceFramesInDPB = 1;
+		support.SuggestedProfile = { sizeof(suggested_profile), { &suggested_profile } };
+		support.SuggestedLevel = { sizeof(suggested_level), { &suggested_level } };
+		support.pResolutionDependentSupport = &resolution_limits;
+		if (FAILED(video_device->CheckFeatureSupport(D3D12_FEATURE_VIDEO_ENCODER_SUPPORT, &support, sizeof(support))) ||
+			!(support.SupportFlags & D3D12_VIDEO_ENCODER_SUPPORT_FLAG_GENERAL_SUPPORT_OK))
+		{
+			ADRIA_LOG(WARNING, "H.264 encoding of %ux%u with constant QP is not supported, validation flags: %u", desc.width, desc.height, (Uint32)support.ValidationFlags);
+			return false;
+		}
+		if (suggested_level > level) level = suggested_level;
+
+		D3D12_FEATURE_DATA_VIDEO_ENCODER_RESOURCE_REQUIREMENTS requirements{};
+		requirements.NodeIndex = 0;
+		requirements.Codec = D3D12_VIDEO_ENCODER_CODEC_H264;
+		requirements.Profile = GetProfileDesc();
+		requirements.InputFormat = DXGI_FORMAT_NV12;
+		requirements.PictureTargetResolution = resolution;
+		if (FAILED(video_device->CheckFeatureSupport(D3D12_FEATURE_VIDEO_ENCODER_RESOURCE_REQUIREMENTS, &requirements, sizeof(requirements))) || !requirements.IsSupported)
+		{
+			ADRIA_LOG(WARNING, "H.264 encoder resource requirements could not be queried!");
+			return false;
+		}
+		return true;
+	}
+
+	void GfxVideoEncoder::CreateResources()
+	{
+		ID3D12Device5* device = gfx->GetDevice();
+
+		D3D12_COMMAND_QUEUE_DESC queue_desc{};
+		queue_desc.Type = D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE;
+		queue_desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+		GFX_CHECK_HR(device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(video_queue.GetAddressOf())));
+		video_queue->SetName(L"Video Encode Queue");
+		GFX_CHECK_HR(device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(video_cmd_list.GetAddressOf())));
+
+		copy_fence.Create(gfx, "Video Encode Copy Fence");
+		video_fence.Create(gfx, "Video Encode Fence");
+
+		CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_DEFAULT);
+		D3D12_RESOURCE_DESC frame_desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_NV12, desc.width, desc.height, 1, 1);
+
+		//reconstructed pictures are only ever touched by the encoder, placing both in one array works whether the driver requires it or not
+		D3D12_RESOURCE_DESC reconstructed_desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_NV12, desc.width, desc.height, RECONSTRUCTED_PICTURE_COUNT, 1);
+		reconstructed_desc.Flags = D3D12_RESOURCE_FLAG_VIDEO_ENCODE_REFERENCE_ONLY | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+		GFX_CHECK_HR(device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &reconstructed_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(reconstructed_pictures.GetAddressOf())));
+		reconstructed_pictures->SetName(L"Video Encode Reconstructed Pictures");
+
+		//nv12 at constant qp stays far below the uncompressed frame size
+		bitstream_size = Align(Uint64(desc.width) * desc.height * 3 / 2, 65536);
+		GfxBufferDesc bitstream_desc{ .size = bitstream_size };
+		GfxBufferDesc metadata_desc{ .size = 4096 };
+		GfxBufferDesc resolved_metadata_desc{ .size = sizeof(D3D12_VIDEO_ENCODER_OUTPUT_METADATA) + sizeof(D3D12_VIDEO_ENCODER_FRAME_SUBREGION_METADATA) };
+		for (FrameSlot& slot : frame_slots)
+		{
+			GFX_CHECK_HR(device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &frame_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(slot.input_frame.GetAddressOf())));
+			slot.input_frame->SetName(L"Video Encode Input Frame");
+			GFX_CHECK_HR(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE, IID_PPV_ARGS(slot.cmd_allocator.GetAddressOf())));
+			slot.bitstream = gfx->CreateBuffer(bitstream_desc);
+			slot.bitstream->SetName("Video Encode Bitstream");
+			slot.metadata = gfx->CreateBuffer(metadata_desc);
+			slot.metadata->SetName("Video Encode Metadata");
+			slot.resolved_metadata = gfx->CreateBuffer(resolved_metadata_desc);
+			slot.resolved_metadata->SetName("Video Encode Resolved Metadata");
+		}
+	}
+
+	//the encoder only produces slice data, sps and pps matching the gop and codec configuration are prepended to every idr frame
+	void GfxVideoEncoder::CreateParameterSets()
+	{
+		Uint32 const width_in_mbs = DivideAndRoundUp(desc.width, 16u);
+		Uint32 const height_in_mbs = DivideAndRoundUp(desc.height, 16u);
+		Uint32 const crop_right = (width_in_mbs * 16 - desc.width) / 2;
+		Uint32 const crop_bottom = (height_in_mbs * 16 - desc.height) / 2;
+
+		BitstreamWriter sps;
+		sps.WriteBits(77, 8);
+		sps.WriteBits(0x40, 8);
+		sps.WriteBits(GetLevelIdc(level), 8);
+		sps.WriteUE(0);
+		sps.WriteUE(gop.log2_max_frame_num_minus4);
+		sps.WriteUE(gop.pic_order_cnt_type);
+		sps.WriteUE(1);
+		sps.WriteBits(0, 1);
+		sps.WriteUE(width_in_mbs - 1);
+		sps.WriteUE(height_in_mbs - 1);
+		sps.WriteBits(1, 1);
+		sps.WriteBits(1, 1);
+		Bool const cropping = crop_right != 0 || crop_bottom != 0;
+		sps.WriteBits(cropping, 1);
+		if (cropping)
+		{
+			sps.WriteUE(0);
+			sps.WriteUE(crop_right);
+			sps.WriteUE(0);
+			sps.WriteUE(crop_bottom);
+		}
+		sps.WriteBits(0, 1);
+		sps.WriteTrailingBits();
+
+		BitstreamWriter pps;
+		pps.WriteUE(0);
+		pps.WriteUE(0);
+		pps.WriteBits(0, 1);
+		pps.WriteBits(0, 1);
+		pps.WriteUE(0);
+		pps.WriteUE(0);
+		pps.WriteUE(0);
+		pps.WriteBits(0, 1);
+		pps.WriteBits(0, 2);
+		pps.WriteSE(0);
+		pps.WriteSE(0);
+		pps.WriteSE(0);
+		pps.WriteBits(1, 1);
+		pps.WriteBits(0, 1);
+		pps.WriteBits(0, 1);
+		pps.WriteTrailingBits();
+
+		parameter_sets.clear();
+		AppendNalUnit(parameter_sets, 0x67, sps.GetBytes());
+		AppendNalUnit(parameter_sets, 0x68, pps.GetBytes());
+	}
+
+	void GfxVideoEncoder::EnqueueReadback(GfxCommandList* cmd_list, FrameSlot& slot)
+	{
+		ADRIA_ASSERT(slot.pending_readback);
+		cmd_list->Wait(video_fence, slot.fence_value);
+
+		//the callbacks run in order on the main thread, the metadata one hands the written size to the bitstream one
+		std::shared_ptr<Uint64> written_bytes = std::make_shared<Uint64>(0);
+		gfx->GetReadbackQueue()->Enqueue(cmd_list, *slot.resolved_metadata, 0, sizeof(D3D12_VIDEO_ENCODER_OUTPUT_METADATA), [written_bytes](void const* data, Uint64)
+			{
+				D3D12_VIDEO_ENCODER_OUTPUT_METADATA const& metadata = *static_cast<D3D12_VIDEO_ENCODER_OUTPUT_METADATA const*>(data);
+				if (metadata.EncodeErrorFlags != D3D12_VIDEO_ENCODER_ENCODE_ERROR_FLAG_NO_ERROR)
+				{
+					ADRIA_LOG(WARNING, "Video encoding of a frame failed with error flags %llu", metadata.EncodeErrorFlags);
+					return;
+				}
+				*written_bytes = metadata.EncodedBitstreamWrittenBytesCount;
+			});
+		gfx->GetReadbackQueue()->Enqueue(cmd_list, *slot.bitstream, 0, bitstream_size, [this, written_bytes, idr = slot.idr](void const* data, Uint64 size)
+			{
+				Uint64 const bytes = std::min(*written_bytes, size);
+				if (bytes == 0) return;
+				if (idr) callback(parameter_sets.data(), parameter_sets.size());
+				callback(static_cast<Uint8 const*>(data), bytes);
+			});
+		slot.pending_readback = false;
+	}
+
+	D3D12_VIDEO_ENCODER_RATE_CONTROL GfxVideoEncoder::GetRateControl()
+	{
+		D3D12_VIDEO_ENCODER_RATE_CONTROL rate_control{};
+		rate_control.Mode = D3D12_VIDEO_ENCODER_RATE_CONTROL_MODE_CQP;
+		rate_control.Flags = D3D12_VIDEO_ENCODER_RATE_CONTROL_FLAG_NONE;
+		rate_control.ConfigParams = { sizeof(cqp), { &cqp } };
+		rate_control.TargetFrameRate = { desc.frame_rate, 1 };
+		return rate_control;
+	}
+}
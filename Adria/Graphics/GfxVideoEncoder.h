@@ -0,0 +1,97 @@
+#pragma once
+#include <functional>
+#include <d3d12video.h>
+#include "GfxFence.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxTexture;
+	class GfxCommandList;
+
+	using GfxVideoBitstreamCallback = std::function<void(Uint8 const*, Uint64)>;
+
+	struct GfxVideoEncoderDesc
+	{
+		Uint32 width = 0;
+		Uint32 height = 0;
+		Uint32 frame_rate = 60;
+		Uint32 gop_length = 60;
+		Uint32 qp = 23;
+	};
+
+	//h264 main profile encoder running on the d3d12 video encode queue with a single reference frame.
+	//luma and chroma planes are copied into an nv12 frame on the graphics queue, the video queue waits for the copy
+	//and the annex b bitstream is read back a few frames later, so neither queue stalls on the other
+	class GfxVideoEncoder
+	{
+		static constexpr Uint32 FRAME_SLOTS = GFX_BACKBUFFER_COUNT;
+
+		struct FrameSlot
+		{
+			Ref<ID3D12Resource> input_frame;
+			Ref<ID3D12CommandAllocator> cmd_allocator;
+			std::unique_ptr<GfxBuffer> bitstream;
+			std::unique_ptr<GfxBuffer> metadata;
+			std::unique_ptr<GfxBuffer> resolved_metadata;
+			Uint64 fence_value = 0;
+			Uint64 frame = 0;
+			Bool idr = false;
+			Bool pending_readback = false;
+		};
+
+	public:
+		GfxVideoEncoder(GfxDevice* gfx, GfxVideoEncoderDesc const& desc, GfxVideoBitstreamCallback&& callback);
+		ADRIA_NONCOPYABLE_NONMOVABLE(GfxVideoEncoder)
+		~GfxVideoEncoder();
+
+		Bool IsValid() const { return encoder != nullptr; }
+		GfxVideoEncoderDesc const& GetDesc() const { return desc; }
+
+		//luma is an R8 texture of the encoder size, chroma an R8G8 texture of half that size, both in copy source state
+		void EncodeFrame(GfxCommandList* cmd_list, GfxTexture const& luma, GfxTexture const& chroma);
+		void ReadbackAll(GfxCommandList* cmd_list);
+
+	private:
+		GfxDevice* gfx;
+		GfxVideoEncoderDesc desc;
+		GfxVideoBitstreamCallback callback;
+
+		Ref<ID3D12VideoDevice3> video_device;
+		Ref<ID3D12CommandQueue> video_queue;
+		Ref<ID3D12VideoEncodeCommandList2> video_cmd_list;
+		Ref<ID3D12VideoEncoder> encoder;
+		Ref<ID3D12VideoEncoderHeap> encoder_heap;
+		Ref<ID3D12Resource> reconstructed_pictures;
+
+		GfxFence copy_fence;
+		Uint64 copy_fence_value = 0;
+		GfxFence video_fence;
+		Uint64 video_fence_value = 0;
+
+		FrameSlot frame_slots[FRAME_SLOTS];
+		Uint64 frame_count = 0;
+		Uint32 frame_num = 0;
+		Uint32 idr_pic_id = 0;
+		Uint64 bitstream_size = 0;
+
+		D3D12_VIDEO_ENCODER_PROFILE_H264 profile = D3D12_VIDEO_ENCODER_PROFILE_H264_MAIN;
+		D3D12_VIDEO_ENCODER_LEVELS_H264 level = D3D12_VIDEO_ENCODER_LEVELS_H264_42;
+		D3D12_VIDEO_ENCODER_CODEC_CONFIGURATION_H264 codec_config{};
+		D3D12_VIDEO_ENCODER_SEQUENCE_GOP_STRUCTURE_H264 gop{};
+		D3D12_VIDEO_ENCODER_RATE_CONTROL_CQP cqp{};
+		std::vector<Uint8> parameter_sets;
+
+	private:
+		Bool CheckSupport();
+		void CreateResources();
+		void CreateParameterSets();
+		void EnqueueReadback(GfxCommandList* cmd_list, FrameSlot& slot);
+
+		D3D12_VIDEO_ENCODER_PROFILE_DESC GetProfileDesc() { return { sizeof(profile), { &profile } }; }
+		D3D12_VIDEO_ENCODER_CODEC_CONFIGURATION GetCodecConfiguration() { return { sizeof(codec_config), { &codec_config } }; }
+		D3D12_VIDEO_ENCODER_SEQUENCE_GOP_STRUCTURE GetGopStructure() { return { sizeof(gop), { &gop } }; }
+		D3D12_VIDEO_ENCODER_RATE_CONTROL GetRateControl();
+	};
+}
@@ -1,28 +1,42 @@
 #include "Logger.h"
+#include "Core/MemoryTracker.h"
 #include <chrono>
 #include <ctime>   
 #include <vector>
 #include <thread>
-#include "Utilities/ConcurrentQueue.h"
+#include <atomic>
+#include <cstdarg>
 
 namespace adria
 {
-	struct QueueEntry
-	{
-		LogLevel level;
-		std::string str;
-		std::string filename;
-		Uint32 line;
-	};
-
 	class LogManagerImpl
 	{
+		static constexpr Uint64 LOG_QUEUE_SIZE = 1024;
+		static constexpr Uint64 LOG_MESSAGE_SIZE = 512;
+		static_assert((LOG_QUEUE_SIZE & (LOG_QUEUE_SIZE - 1)) == 0);
+
+		struct LogRecord
+		{
+			std::atomic<Uint64> sequence;
+			LogLevel level;
+			Uint32 line;
+			Char const* file;
+			Char* long_message;
+			Char message[LOG_MESSAGE_SIZE];
+		};
+
 	public:
 
-		LogManagerImpl() : log_thread(&LogManagerImpl::ProcessLogs, this) {}
+		LogManagerImpl() : records(new LogRecord[LOG_QUEUE_SIZE])
+		{
+			for (Uint64 i = 0; i < LOG_QUEUE_SIZE; ++i) records[i].sequence.store(i, std::memory_order_relaxed);
+			log_thread = std::thread(&LogManagerImpl::ProcessLogs, this);
+		}
 		~LogManagerImpl()
 		{
-			exit.store(true);
+			exit.store(true, std::memory_order_release);
+			pending.fetch_add(1, std::memory_order_release);
+			pending.notify_one();
 			log_thread.join();
 		}
 
@@ -30,28 +44,129 @@ namespace adria
 		{
 			loggers.emplace_back(logger);
 		}
-		void Log(LogLevel level, Char const* str, Char const* filename, Uint32 line)
+		void Log(LogLevel level, Char const* str, Char const* file, Uint32 line)
+		{
+			Uint64 pos;
+			LogRecord* record = AcquireRecord(pos);
+			if (!record) return;
+
+			Uint64 const length = strlen(str);
+			record->long_message = nullptr;
+			if (length < LOG_MESSAGE_SIZE)
+			{
+				memcpy(record->message, str, length + 1);
+			}
+			else
+			{
+				MemoryTagScope memory_scope(MemoryTag::Logging);
+				record->long_message = new Char[length + 1];
+				memcpy(record->long_message, str, length + 1);
+			}
+			CommitRecord(record, pos, level, file, line);
+		}
+		void LogFormat(LogLevel level, Char const* file, Uint32 line, Char const* fmt, va_list args)
 		{
-			log_queue.Push(QueueEntry{ level, str, filename, line });
+			Uint64 pos;
+			LogRecord* record = AcquireRecord(pos);
+			if (!record) return;
+
+			va_list args_copy;
+			va_copy(args_copy, args);
+			Int const length = vsnprintf(record->message, LOG_MESSAGE_SIZE, fmt, args);
+			record->long_message = nullptr;
+			if (length >= (Int)LOG_MESSAGE_SIZE)
+			{
+				MemoryTagScope memory_scope(MemoryTag::Logging);
+				record->long_message = new Char[length + 1];
+				vsnprintf(record->long_message, length + 1, fmt, args_copy);
+			}
+			else if (length < 0)
+			{
+				record->message[0] = '\0';
+			}
+			va_end(args_copy);
+			CommitRecord(record, pos, level, file, line);
 		}
 
+	private:
 		std::vector<std::unique_ptr<ILogger>> loggers;
-		ConcurrentQueue<QueueEntry> log_queue;
-		std::thread log_thread;
+		std::unique_ptr<LogRecord[]> records;
+		alignas(64) std::atomic<Uint64> enqueue_pos = 0;
+		alignas(64) Uint64 dequeue_pos = 0;
+		std::atomic<Uint64> pending = 0;
+		std::atomic<Uint64> dropped_count = 0;
 		std::atomic_bool exit = false;
+		std::thread log_thread;
 
 	private:
+		LogRecord* AcquireRecord(Uint64& pos)
+		{
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				LogRecord& record = records[pos & (LOG_QUEUE_SIZE - 1)];
+				Uint64 const sequence = record.sequence.load(std::memory_order_acquire);
+				Int64 const diff = (Int64)sequence - (Int64)pos;
+				if (diff == 0)
+				{
+					if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &record;
+				}
+				else if (diff < 0)
+				{
+					dropped_count.fetch_add(1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				else
+				{
+					pos = enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void CommitRecord(LogRecord* record, Uint64 pos, LogLevel level, Char const* file, Uint32 line)
+		{
+			record->level = level;
+			record->file = file;
+			record->line = line;
+			record->sequence.store(pos + 1, std::memory_order_release);
+			pending.fetch_add(1, std::memory_order_release);
+			pending.notify_one();
+		}
+
+		Bool ProcessRecord()
+		{
+			LogRecord& record = records[dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+			if (record.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) return false;
+
+			Char const* message = record.long_message ? record.long_message : record.message;
+			for (auto&& logger : loggers) if (logger) logger->Log(record.level, message, record.file, record.line);
+			delete[] record.long_message;
+			record.long_message = nullptr;
+
+			record.sequence.store(dequeue_pos + LOG_QUEUE_SIZE, std::memory_order_release);
+			++dequeue_pos;
+			return true;
+		}
+
 		void ProcessLogs()
 		{
-			QueueEntry entry{};
+			MemoryTagScope memory_scope(MemoryTag::Logging);
 			while (true)
 			{
-				Bool success = log_queue.TryPop(entry);
-				if (success)
+				Uint64 const signal = pending.load(std::memory_order_acquire);
+				while (ProcessRecord()) {}
+
+				if (Uint64 const dropped = dropped_count.exchange(0, std::memory_order_relaxed); dropped > 0)
+				{
+					std::string const warning = std::to_string(dropped) + " log messages were dropped because the log queue was full";
+					for (auto&& logger : loggers) if (logger) logger->Log(LogLevel::LOG_WARNING, warning.c_str(), __FILE__, __LINE__);
+				}
+				if (exit.load(std::memory_order_acquire))
 				{
-					for (auto&& logger : loggers) if (logger) logger->Log(entry.level, entry.str.c_str(), entry.filename.c_str(), entry.line);
+					while (ProcessRecord()) {}
+					break;
 				}
-				if (exit.load() && log_queue.Empty()) break;
+				pending.wait(signal, std::memory_order_acquire);
 			}
 		}
 	};
@@ -100,4 +215,11 @@ namespace adria
 	{
 		Log(level, str, location.file_name(), location.line());
 	}
+	void LogManager::LogFormat(LogLevel level, Char const* file, Uint32 line, Char const* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		pimpl->LogFormat(level, file, line, fmt, args);
+		va_end(args);
+	}
 }
\ No newline at end of file
@@ -35,19 +35,14 @@ namespace adria
 		void Register(ILogger* logger);
 		void Log(LogLevel level, Char const* str, Char const* file, Uint32 line);
 		void Log(LogLevel level, Char const* str, std::source_location location = std::source_location::current());
+		void LogFormat(LogLevel level, Char const* file, Uint32 line, Char const* fmt, ...);
 
 	private:
 		std::unique_ptr<class LogManagerImpl> pimpl;
 	};
 	inline LogManager g_Log{};
 
-	#define ADRIA_LOG(level, ... ) [&]()  \
-	{ \
-		Uint64 const size = snprintf(nullptr, 0, __VA_ARGS__) + 1; \
-		std::unique_ptr<Char[]> buf = std::make_unique<Char[]>(size); \
-		snprintf(buf.get(), size, __VA_ARGS__); \
-		g_Log.Log(LogLevel::LOG_##level, buf.get(), __FILE__, __LINE__);  \
-	}()
+	#define ADRIA_LOG(level, ... ) g_Log.LogFormat(LogLevel::LOG_##level, __FILE__, __LINE__, __VA_ARGS__)
 	#define ADRIA_DEBUG(...)	ADRIA_LOG(DEBUG, __VA_ARGS__)
 	#define ADRIA_INFO(...)		ADRIA_LOG(INFO, __VA_ARGS__)
 	#define ADRIA_WARNING(...)  ADRIA_LOG(WARNING, __VA_ARGS__)
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <functional>
+#include "BoundingVolumeHierarchy.h"
+
+namespace adria
+{
+	static constexpr Uint32 INVALID_NODE = UINT32_MAX;
+
+	struct BVHBounds
+	{
+		Vector3 min = Vector3(FLT_MAX);
+		Vector3 max = Vector3(-FLT_MAX);
+
+		void Grow(Vector3 const& point)
+		{
+			min = Vector3::Min(min, point);
+			max = Vector3::Max(max, point);
+		}
+		void Grow(BoundingBox const& box)
+		{
+			Grow(Vector3(box.Center) - Vector3(box.Extents));
+			Grow(Vector3(box.Center) + Vector3(box.Extents));
+		}
+		void Grow(BVHBounds const& bounds)
+		{
+			min = Vector3::Min(min, bounds.min);
+			max = Vector3::Max(max, bounds.max);
+		}
+		Float Area() const
+		{
+			Vector3 const d = max - min;
+			if (d.x < 0.0f) return 0.0f;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+		BoundingBox ToBox() const
+		{
+			BoundingBox box;
+			BoundingBox::CreateFromPoints(box, min, max);
+			return box;
+		}
+	};
+
+	static Float GetArea(BoundingBox const& box)
+	{
+		Vector3 const d = 2.0f * Vector3(box.Extents);
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	void BoundingVolumeHierarchy::Build(std::span<BoundingBox const> boxes)
+	{
+		Clear();
+		if (boxes.empty()) return;
+
+		Uint32 const item_count = (Uint32)boxes.size();
+		item_boxes.assign(boxes.begin(), boxes.end());
+		items.resize(item_count);
+		item_leaves.resize(item_count);
+		std::vector<Vector3> centroids(item_count);
+		for (Uint32 i = 0; i < item_count; ++i)
+		{
+			items[i] = i;
+			centroids[i] = boxes[i].Center;
+		}
+
+		//children are always appended after their parent so the node count never exceeds 2n - 1 and references stay valid
+		nodes.reserve(2 * item_count);
+		node_parents.reserve(2 * item_count);
+		nodes.push_back(Node{ BoundingBox{}, 0, item_count });
+		node_parents.push_back(INVALID_NODE);
+		BuildNode(0, centroids, 0);
+
+		node_dirty.assign(nodes.size(), 0);
+		total_area = 0.0f;
+		for (Node const& node : nodes) total_area += GetArea(node.box);
+		built_total_area = total_area;
+	}
+
+	void BoundingVolumeHierarchy::Clear()
+	{
+		nodes.clear();
+		items.clear();
+		item_boxes.clear();
+		item_leaves.clear();
+		node_parents.clear();
+		node_dirty.clear();
+		dirty_items.clear();
+		total_area = 0.0f;
+		built_total_area = 0.0f;
+	}
+
+	void BoundingVolumeHierarchy::SetItemBounds(Uint32 item, BoundingBox const& box)
+	{
+		ADRIA_ASSERT(item < item_boxes.size());
+		item_boxes[item] = box;
+		dirty_items.push_back(item);
+	}
+
+	void BoundingVolumeHierarchy::Update()
+	{
+		if (dirty_items.empty()) return;
+
+		refit_nodes.clear();
+		for (Uint32 item : dirty_items)
+		{
+			for (Uint32 node = item_leaves[item]; node != INVALID_NODE && !node_dirty[node]; node = node_parents[node])
+			{
+				node_dirty[node] = 1;
+				refit_nodes.push_back(node);
+			}
+		}
+		dirty_items.clear();
+
+		//children have larger indices than their parents, refitting in descending order visits them first
+		std::sort(refit_nodes.begin(), refit_nodes.end(), std::greater<>{});
+		for (Uint32 node_index : refit_nodes)
+		{
+			Node& node = nodes[node_index];
+			total_area -= GetArea(node.box);
+			if (node.count > 0)
+			{
+				BVHBounds bounds;
+				for (Uint32 i = node.first; i < node.first + node.count; ++i) bounds.Grow(item_boxes[items[i]]);
+				node.box = bounds.ToBox();
+			}
+			else
+			{
+				BoundingBox::CreateMerged(node.box, nodes[node.first].box, nodes[node.first + 1].box);
+			}
+			total_area += GetArea(node.box);
+			node_dirty[node_index] = 0;
+		}
+
+		if (total_area > built_total_area * REBUILD_AREA_RATIO)
+		{
+			std::vector<BoundingBox> boxes = std::move(item_boxes);
+			Build(boxes);
+		}
+	}
+
+	void BoundingVolumeHierarchy::BuildNode(Uint32 node_index, std::vector<Vector3> const& centroids, Uint32 depth)
+	{
+		Uint32 const first = nodes[node_index].first;
+		Uint32 const count = nodes[node_index].count;
+
+		BVHBounds bounds, centroid_bounds;
+		for (Uint32 i = first; i < first + count; ++i)
+		{
+			bounds.Grow(item_boxes[items[i]]);
+			centroid_bounds.Grow(centroids[items[i]]);
+		}
+		nodes[node_index].box = bounds.ToBox();
+
+		if (count <= MAX_LEAF_SIZE)
+		{
+			for (Uint32 i = first; i < first + count; ++i) item_leaves[items[i]] = node_index;
+			return;
+		}
+
+		Vector3 const extent = centroid_bounds.max - centroid_bounds.min;
+		Uint32 const axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		Float const axis_min = (&centroid_bounds.min.x)[axis];
+		Float const axis_extent = (&extent.x)[axis];
+
+		auto const begin = items.begin() + first;
+		auto const end = begin + count;
+		Uint32 split = INVALID_NODE;
+		if (axis_extent > 0.0f && depth < MAX_SAH_DEPTH)
+		{
+			Float const bin_scale = SAH_BIN_COUNT / axis_extent;
+			auto GetBin = [&](Uint32 item) { return std::min((Uint32)(((&centroids[item].x)[axis] - axis_min) * bin_scale), SAH_BIN_COUNT - 1); };
+
+			BVHBounds bin_bounds[SAH_BIN_COUNT];
+			Uint32 bin_counts[SAH_BIN_COUNT] = {};
+			for (Uint32 i = first; i < first + count; ++i)
+			{
+				Uint32 const bin = GetBin(items[i]);
+				++bin_counts[bin];
+				bin_bounds[bin].Grow(item_boxes[items[i]]);
+			}
+
+			Float left_costs[SAH_BIN_COUNT - 1];
+			Uint32 left_counts[SAH_BIN_COUNT - 1];
+			BVHBounds left_bounds;
+			Uint32 left_count = 0;
+			for (Uint32 bin = 0; bin < SAH_BIN_COUNT - 1; ++bin)
+			{
+				left_bounds.Grow(bin_bounds[bin]);
+				left_count += bin_counts[bin];
+				left_costs[bin] = left_bounds.Area() * left_count;
+				left_counts[bin] = left_count;
+			}
+
+			BVHBounds right_bounds;
+			Uint32 right_count = 0;
+			Float best_cost = FLT_MAX;
+			Uint32 best_bin = 0;
+			for (Uint32 bin = SAH_BIN_COUNT - 1; bin > 0; --bin)
+			{
+				right_bounds.Grow(bin_bounds[bin]);
+				right_count += bin_counts[bin];
+				if (left_counts[bin - 1] == 0 || right_count == 0) continue;
+
+				Float const cost = left_costs[bin - 1] + right_bounds.Area() * right_count;
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_bin = bin;
+				}
+			}
+
+			if (best_bin > 0)
+			{
+				auto const middle = std::partition(begin, end, [&](Uint32 item) { return GetBin(item) < best_bin; });
+				split = first + (Uint32)(middle - begin);
+			}
+		}
+		if (split == INVALID_NODE)
+		{
+			split = first + count / 2;
+			std::nth_element(begin, items.begin() + split, end, [&](Uint32 lhs, Uint32 rhs) { return (&centroids[lhs].x)[axis] < (&centroids[rhs].x)[axis]; });
+		}
+
+		Uint32 const left_index = (Uint32)nodes.size();
+		nodes.push_back(Node{ BoundingBox{}, first, split - first });
+		nodes.push_back(Node{ BoundingBox{}, split, first + count - split });
+		node_parents.push_back(node_index);
+		node_parents.push_back(node_index);
+		nodes[node_index].first = left_index;
+		nodes[node_index].count = 0;
+
+		BuildNode(left_index, centroids, depth + 1);
+		BuildNode(left_index + 1, centroids, depth + 1);
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <DirectXCollision.h>
+
+namespace adria
+{
+	//binary BVH over item bounding boxes, built with a binned SAH and refitted in place when items move
+	class BoundingVolumeHierarchy
+	{
+		static constexpr Uint32 MAX_LEAF_SIZE = 4;
+		static constexpr Uint32 SAH_BIN_COUNT = 16;
+		static constexpr Float REBUILD_AREA_RATIO = 2.0f;
+		//past this depth nodes are split at the median so the depth stays bounded for the traversal stacks
+		static constexpr Uint32 MAX_SAH_DEPTH = 64;
+		static constexpr Uint32 STACK_SIZE = 128;
+
+		struct Node
+		{
+			BoundingBox box;
+			Uint32 first; //first child if count is 0, otherwise first item
+			Uint32 count;
+		};
+
+	public:
+		void Build(std::span<BoundingBox const> boxes);
+		void Clear();
+
+		void SetItemBounds(Uint32 item, BoundingBox const& box);
+		//refits the dirty items, rebuilds when refitting inflated the hierarchy too much
+		void Update();
+
+		Bool Empty() const { return nodes.empty(); }
+		Uint64 GetItemCount() const { return item_boxes.size(); }
+
+		//volume is any DirectX bounding volume with Contains(BoundingBox), f is called for every item intersecting it
+		template<typename Volume, typename F>
+		void Query(Volume const& volume, F&& f) const
+		{
+			if (nodes.empty()) return;
+			Uint32 stack[STACK_SIZE];
+			Uint32 stack_size = 0;
+			stack[stack_size++] = 0;
+			while (stack_size > 0)
+			{
+				Node const& node = nodes[stack[--stack_size]];
+				ContainmentType const containment = volume.Contains(node.box);
+				if (containment == DISJOINT) continue;
+				if (containment == CONTAINS)
+				{
+					VisitSubtree(node, f);
+					continue;
+				}
+				if (node.count > 0)
+				{
+					for (Uint32 i = node.first; i < node.first + node.count; ++i)
+					{
+						if (volume.Contains(item_boxes[items[i]]) != DISJOINT) f(items[i]);
+					}
+					continue;
+				}
+				stack[stack_size++] = node.first;
+				stack[stack_size++] = node.first + 1;
+			}
+		}
+
+		//direction has to be normalized, f is called with every item the ray hits and the hit distance, items are not sorted by distance
+		template<typename F>
+		void Raycast(Vector3 const& origin, Vector3 const& direction, Float max_distance, F&& f) const
+		{
+			if (nodes.empty()) return;
+			Uint32 stack[STACK_SIZE];
+			Uint32 stack_size = 0;
+			stack[stack_size++] = 0;
+			while (stack_size > 0)
+			{
+				Node const& node = nodes[stack[--stack_size]];
+				Float distance = 0.0f;
+				if (!node.box.Intersects(origin, direction, distance) || distance > max_distance) continue;
+				if (node.count > 0)
+				{
+					for (Uint32 i = node.first; i < node.first + node.count; ++i)
+					{
+						if (item_boxes[items[i]].Intersects(origin, direction, distance) && distance <= max_distance) f(items[i], distance);
+					}
+					continue;
+				}
+				stack[stack_size++] = node.first;
+				stack[stack_size++] = node.first + 1;
+			}
+		}
+
+	private:
+		std::vector<Node> nodes;
+		std::vector<Uint32> items;
+		std::vector<BoundingBox> item_boxes;
+		std::vector<Uint32> item_leaves;
+		std::vector<Uint32> node_parents;
+		std::vector<Uint8> node_dirty;
+		std::vector<Uint32> dirty_items;
+		std::vector<Uint32> refit_nodes;
+		Float total_area = 0.0f;
+		Float built_total_area = 0.0f;
+
+	private:
+		void BuildNode(Uint32 node_index, std::vector<Vector3> const& centroids, Uint32 depth);
+
+		template<typename F>
+		void VisitSubtree(Node const& root, F& f) const
+		{
+			Uint32 stack[STACK_SIZE];
+			Uint32 stack_size = 0;
+			Node const* node = &root;
+			while (true)
+			{
+				if (node->count > 0)
+				{
+					for (Uint32 i = node->first; i < node->first + node->count; ++i) f(items[i]);
+				}
+				else
+				{
+					stack[stack_size++] = node->first + 1;
+					stack[stack_size++] = node->first;
+				}
+				if (stack_size == 0) break;
+				node = &nodes[stack[--stack_size]];
+			}
+		}
+	};
+}
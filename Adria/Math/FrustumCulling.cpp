@@ -0,0 +1,100 @@
+#include <xmmintrin.h>
+#include "FrustumCulling.h"
+
+namespace adria
+{
+	void AABBArray::Clear()
+	{
+		center_x.clear(); center_y.clear(); center_z.clear();
+		extents_x.clear(); extents_y.clear(); extents_z.clear();
+	}
+
+	void AABBArray::Reserve(Uint64 count)
+	{
+		center_x.reserve(count); center_y.reserve(count); center_z.reserve(count);
+		extents_x.reserve(count); extents_y.reserve(count); extents_z.reserve(count);
+	}
+
+	void AABBArray::Add(BoundingBox const& aabb)
+	{
+		center_x.push_back(aabb.Center.x);
+		center_y.push_back(aabb.Center.y);
+		center_z.push_back(aabb.Center.z);
+		extents_x.push_back(aabb.Extents.x);
+		extents_y.push_back(aabb.Extents.y);
+		extents_z.push_back(aabb.Extents.z);
+	}
+
+	void AABBArray::Set(Uint64 index, BoundingBox const& aabb)
+	{
+		center_x[index] = aabb.Center.x;
+		center_y[index] = aabb.Center.y;
+		center_z[index] = aabb.Center.z;
+		extents_x[index] = aabb.Extents.x;
+		extents_y[index] = aabb.Extents.y;
+		extents_z[index] = aabb.Extents.z;
+	}
+
+	void FrustumCull(BoundingFrustum const& frustum, AABBArray const& aabbs, Uint64 begin, Uint64 end, Uint64* visibility_mask)
+	{
+		ADRIA_ASSERT(begin % 64 == 0);
+		ADRIA_ASSERT(end <= aabbs.Size());
+
+		//planes point out of the frustum, a box is outside if its center is farther than its projected radius in front of any plane
+		DirectX::XMVECTOR planes[6];
+		frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+		DirectX::XMFLOAT4 plane_values[6];
+		for (Uint32 i = 0; i < 6; ++i) DirectX::XMStoreFloat4(&plane_values[i], planes[i]);
+
+		__m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+		__m128 plane_abs_x[6], plane_abs_y[6], plane_abs_z[6];
+		for (Uint32 i = 0; i < 6; ++i)
+		{
+			plane_x[i] = _mm_set1_ps(plane_values[i].x);
+			plane_y[i] = _mm_set1_ps(plane_values[i].y);
+			plane_z[i] = _mm_set1_ps(plane_values[i].z);
+			plane_w[i] = _mm_set1_ps(plane_values[i].w);
+			plane_abs_x[i] = _mm_set1_ps(std::abs(plane_values[i].x));
+			plane_abs_y[i] = _mm_set1_ps(std::abs(plane_values[i].y));
+			plane_abs_z[i] = _mm_set1_ps(std::abs(plane_values[i].z));
+		}
+
+		Uint64 i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 const center_x = _mm_loadu_ps(&aabbs.center_x[i]);
+			__m128 const center_y = _mm_loadu_ps(&aabbs.center_y[i]);
+			__m128 const center_z = _mm_loadu_ps(&aabbs.center_z[i]);
+			__m128 const extents_x = _mm_loadu_ps(&aabbs.extents_x[i]);
+			__m128 const extents_y = _mm_loadu_ps(&aabbs.extents_y[i]);
+			__m128 const extents_z = _mm_loadu_ps(&aabbs.extents_z[i]);
+
+			__m128 outside = _mm_setzero_ps();
+			for (Uint32 p = 0; p < 6; ++p)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(center_x, plane_x[p]), plane_w[p]);
+				distance = _mm_add_ps(distance, _mm_mul_ps(center_y, plane_y[p]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(center_z, plane_z[p]));
+				__m128 radius = _mm_mul_ps(extents_x, plane_abs_x[p]);
+				radius = _mm_add_ps(radius, _mm_mul_ps(extents_y, plane_abs_y[p]));
+				radius = _mm_add_ps(radius, _mm_mul_ps(extents_z, plane_abs_z[p]));
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, radius));
+			}
+			Uint64 const visible = ~(Uint64)_mm_movemask_ps(outside) & 0xFull;
+			visibility_mask[i / 64] |= visible << (i % 64);
+		}
+
+		for (; i < end; ++i)
+		{
+			Bool outside = false;
+			for (Uint32 p = 0; p < 6 && !outside; ++p)
+			{
+				DirectX::XMFLOAT4 const& plane = plane_values[p];
+				Float const distance = aabbs.center_x[i] * plane.x + aabbs.center_y[i] * plane.y + aabbs.center_z[i] * plane.z + plane.w;
+				Float const radius = aabbs.extents_x[i] * std::abs(plane.x) + aabbs.extents_y[i] * std::abs(plane.y) + aabbs.extents_z[i] * std::abs(plane.z);
+				outside = distance > radius;
+			}
+			if (!outside) visibility_mask[i / 64] |= 1ull << (i % 64);
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace adria
+{
+	struct AABBArray
+	{
+		std::vector<Float> center_x, center_y, center_z;
+		std::vector<Float> extents_x, extents_y, extents_z;
+
+		void Clear();
+		void Reserve(Uint64 count);
+		void Add(BoundingBox const& aabb);
+		void Set(Uint64 index, BoundingBox const& aabb);
+		Uint64 Size() const { return center_x.size(); }
+	};
+
+	//tests boxes [begin, end) against the frustum planes and sets bit i % 64 of visibility_mask[i / 64] for each visible box i,
+	//begin has to be a multiple of 64 so that concurrent calls over disjoint ranges never write the same mask word
+	void FrustumCull(BoundingFrustum const& frustum, AABBArray const& aabbs, Uint64 begin, Uint64 end, Uint64* visibility_mask);
+
+	inline Bool IsVisible(Uint64 const* visibility_mask, Uint64 index)
+	{
+		return (visibility_mask[index / 64] >> (index % 64)) & 1ull;
+	}
+}
@@ -40,4 +40,51 @@ namespace adria
 		Uint32 packed_value = (static_cast<Uint32>(value1) << 16) | static_cast<Uint32>(value2);
 		return packed_value;
 	}
+
+	Int16 PackSnorm16(Float value)
+	{
+		return (Int16)std::round(Clamp(value, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	Uint16 PackUnorm16(Float value)
+	{
+		return (Uint16)std::round(Clamp(value) * 65535.0f);
+	}
+
+	Uint16 PackHalfRoundUp(Float value)
+	{
+		DirectX::PackedVector::HALF half = DirectX::PackedVector::XMConvertFloatToHalf(value);
+		if (DirectX::PackedVector::XMConvertHalfToFloat(half) < value) ++half;
+		return half;
+	}
+
+	Vector2 OctahedralEncode(Vector3 const& n)
+	{
+		Float const l1_norm = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (l1_norm <= 0.0f) return Vector2(0.0f, 0.0f);
+
+		Vector2 oct(n.x / l1_norm, n.y / l1_norm);
+		if (n.z < 0.0f)
+		{
+			Float const x = (1.0f - std::abs(oct.y)) * (oct.x >= 0.0f ? 1.0f : -1.0f);
+			Float const y = (1.0f - std::abs(oct.x)) * (oct.y >= 0.0f ? 1.0f : -1.0f);
+			oct = Vector2(x, y);
+		}
+		return oct;
+	}
+
+	Uint32 PackOctahedralNormal(Vector3 const& n)
+	{
+		Vector2 const oct = OctahedralEncode(n);
+		return PackTwoUint16ToUint32((Uint16)PackSnorm16(oct.y), (Uint16)PackSnorm16(oct.x));
+	}
+
+	Uint32 PackOctahedralTangent(Vector4 const& t)
+	{
+		Vector2 const oct = OctahedralEncode(Vector3(t.x, t.y, t.z));
+		Uint32 const x = (Uint32)std::round(Clamp(oct.x * 0.5f + 0.5f) * 32767.0f);
+		Uint32 const y = (Uint32)std::round(Clamp(oct.y * 0.5f + 0.5f) * 32767.0f);
+		Uint32 const sign = t.w < 0.0f ? 1u : 0u;
+		return x | (y << 15) | (sign << 31);
+	}
 }
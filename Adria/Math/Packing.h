@@ -15,4 +15,12 @@ namespace adria
 	Uint64 PackFourFloatsToUint64(Float x, Float y, Float z, Float w);
 
 	Uint32 PackTwoUint16ToUint32(Uint16 value1, Uint16 value2);
+
+	Int16 PackSnorm16(Float value);
+	Uint16 PackUnorm16(Float value);
+	Uint16 PackHalfRoundUp(Float value);
+	Vector2 OctahedralEncode(Vector3 const& n);
+	Uint32 PackOctahedralNormal(Vector3 const& n);
+	//15 bits per octahedral component, handedness in the top bit
+	Uint32 PackOctahedralTangent(Vector4 const& t);
 }
\ No newline at end of file
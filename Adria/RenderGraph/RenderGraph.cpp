@@ -1,14 +1,24 @@
 #include <stack>
+#include <unordered_set>
+#include <algorithm>
 #include <format>
 #include <fstream>
 #include "RenderGraph.h"
+#include "RenderGraphProfiler.h"
 #include "Graphics/GfxCommandList.h"
 #include "Graphics/GfxRenderPass.h"
 #include "Graphics/GfxProfiler.h"
 #include "Graphics/GfxTracyProfiler.h"
+#include "Graphics/GfxBreadcrumbs.h"
 #include "Utilities/StringUtil.h"
 #include "Utilities/FilesUtil.h"
+#include "Utilities/JobSystem.h"
+#include "Utilities/AllocatorUtil.h"
+#include "Utilities/HashUtil.h"
+#include "Utilities/Timer.h"
+#include "Utilities/JsonUtil.h"
 #include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
 #include "Logging/Logger.h"
 #include "pix3.h"
 
@@ -21,6 +31,75 @@
 namespace adria
 {
 	extern Bool dump_render_graph = false;
+	static TAutoConsoleVariable<Bool> AsyncCompute("rg.AsyncCompute", true, "0 - Disabled, 1 - ComputeAsync passes are scheduled on the compute queue");
+	static TAutoConsoleVariable<Bool> GraphCaching("rg.GraphCaching", true, "0 - Disabled, 1 - Reuse the compiled schedule from the previous frame when the graph topology doesn't change");
+	static TAutoConsoleVariable<Bool> SplitBarriers("rg.SplitBarriers", true, "0 - Disabled, 1 - Transitions begin after a resource's last use and end before its next use");
+	static TAutoConsoleVariable<Bool> IncrementalSubmission("rg.IncrementalSubmission", true, "0 - Disabled, 1 - Command lists are submitted at checkpoints during execution instead of once at the end of the frame");
+	static TAutoConsoleVariable<Int>  SubmitPassInterval("rg.SubmitPassInterval", 0, "Number of executed passes after which the recorded command lists are submitted, 0 - only after passes with RGPassFlags::SubmitAfter");
+	static TAutoConsoleVariable<Bool> TextureAliasing("rg.TextureAliasing", true, "0 - Disabled, 1 - Transient textures with non-overlapping lifetimes share heap memory");
+	static TAutoConsoleVariable<Bool> RenderPassMerging("rg.RenderPassMerging", true, "0 - Disabled, 1 - Adjacent raster passes with the same attachments and no barriers in between share one render pass");
+	static TAutoConsoleVariable<Bool> Lint("rg.Lint", false, "0 - Disabled, 1 - Report redundant transitions, unread writes, frame long transients, missed async compute and oversized inputs when the graph is built");
+	static TAutoConsoleVariable<Bool> InferDiscardAccess("rg.InferDiscardAccess", true, "0 - Disabled, 1 - Attachments of transient textures are not loaded when created and not stored after their last use");
+
+	namespace
+	{
+		template<typename ResourceId>
+		void SortResourceIds(std::vector<ResourceId>& ids)
+		{
+			std::sort(ids.begin(), ids.end(), [](ResourceId const& a, ResourceId const& b) { return a.id < b.id; });
+		}
+
+		template<typename ResourceId>
+		Bool ContainsResourceId(std::vector<ResourceId> const& ids, ResourceId id)
+		{
+			return std::binary_search(ids.begin(), ids.end(), id, [](ResourceId const& a, ResourceId const& b) { return a.id < b.id; });
+		}
+
+		template<typename ResourceId>
+		void MergeResourceStates(std::vector<std::pair<ResourceId, GfxResourceState>>& states)
+		{
+			std::sort(states.begin(), states.end(), [](auto const& a, auto const& b) { return a.first.id < b.first.id; });
+			Uint64 merged_count = 0;
+			for (Uint64 i = 0; i < states.size(); ++i)
+			{
+				if (merged_count > 0 && states[merged_count - 1].first.id == states[i].first.id) states[merged_count - 1].second |= states[i].second;
+				else states[merged_count++] = states[i];
+			}
+			states.resize(merged_count);
+		}
+
+		template<typename ResourceId>
+		GfxResourceState FindResourceState(std::vector<std::pair<ResourceId, GfxResourceState>> const& states, ResourceId id)
+		{
+			auto it = std::lower_bound(states.begin(), states.end(), id, [](auto const& state, ResourceId const& resource_id) { return state.first.id < resource_id.id; });
+			return (it != states.end() && it->first.id == id.id) ? it->second : GfxResourceState::None;
+		}
+
+		void AdjustAccessOpsForRange(RGParallelRange const* range, RGLoadAccessOp& load_op, RGStoreAccessOp& store_op)
+		{
+			if (!range) return;
+			if (range->index > 0 && load_op != RGLoadAccessOp::NoAccess) load_op = RGLoadAccessOp::Preserve;
+			if (range->index + 1 < range->count && store_op != RGStoreAccessOp::NoAccess) store_op = RGStoreAccessOp::Preserve;
+		}
+
+		RGStoreAccessOp GetStoreAccessOp(RGLoadStoreAccessOp load_store_op)
+		{
+			RGLoadAccessOp load_op = RGLoadAccessOp::NoAccess;
+			RGStoreAccessOp store_op = RGStoreAccessOp::NoAccess;
+			SplitAccessOp(load_store_op, load_op, store_op);
+			return store_op;
+		}
+
+		Bool CanContinueRenderPass(RGLoadStoreAccessOp previous_access, RGLoadStoreAccessOp next_access)
+		{
+			if (previous_access == RGLoadStoreAccessOp::NoAccess_NoAccess && next_access == RGLoadStoreAccessOp::NoAccess_NoAccess) return true;
+			RGLoadAccessOp previous_load = RGLoadAccessOp::NoAccess, next_load = RGLoadAccessOp::NoAccess;
+			RGStoreAccessOp previous_store = RGStoreAccessOp::NoAccess, next_store = RGStoreAccessOp::NoAccess;
+			SplitAccessOp(previous_access, previous_load, previous_store);
+			SplitAccessOp(next_access, next_load, next_store);
+			return previous_store == RGStoreAccessOp::Preserve && next_load == RGLoadAccessOp::Preserve;
+		}
+	}
 
 	RGTextureId RenderGraph::DeclareTexture(RGResourceName name, RGTextureDesc const& desc)
 	{
@@ -40,6 +119,17 @@ namespace adria
 		return RGBufferId(buffers.size() - 1);
 	}
 
+	Bool RenderGraph::DeclareTemporalTexture(RGResourceName name, RGResourceName history_name, RGTextureDesc const& desc)
+	{
+		//both versions live outside of the pool buckets, so they are handled like imported textures once they are acquired
+		RGTextureId current = DeclareTexture(name, desc);
+		RGTextureId history = DeclareTexture(history_name, desc);
+		GetRGTexture(current)->imported = true;
+		GetRGTexture(history)->imported = true;
+		temporal_textures.push_back(TemporalTexture{ name.hashed_name, current, history });
+		return pool.HasTemporalHistory(name.hashed_name, GetRGTexture(current)->desc);
+	}
+
 	Bool RenderGraph::IsTextureDeclared(RGResourceName name)
 	{
 		return texture_name_id_map.contains(name);
@@ -90,163 +180,481 @@ namespace adria
 
 	RenderGraph::~RenderGraph()
 	{
-		for (auto& [tex_id, view_vector] : texture_view_map)
-		{
-			for (auto [view, type] : view_vector)
-			{
-				switch (type)
-				{
-				case RGDescriptorType::RenderTarget:
-					gfx->FreeDescriptorCPU(view, GfxDescriptorHeapType::RTV);
-					continue;
-				case RGDescriptorType::DepthStencil:
-					gfx->FreeDescriptorCPU(view, GfxDescriptorHeapType::DSV);
-					continue;
-				case RGDescriptorType::ReadWrite:
-				case RGDescriptorType::ReadOnly:
-				default:
-					gfx->FreeDescriptorCPU(view, GfxDescriptorHeapType::CBV_SRV_UAV);
-				}
-			}
-		}
+		for (auto const& [view, heap_type] : owned_views) gfx->FreeDescriptorCPU(view, heap_type);
 
-		for (auto& [buf_id, view_vector] : buffer_view_map)
+		if (!passes.empty())
 		{
-			for (auto [view, type] : view_vector) gfx->FreeDescriptorCPU(view, GfxDescriptorHeapType::CBV_SRV_UAV);
+			passes.clear();
+			allocator.Reset();
 		}
 	}
 
 	void RenderGraph::Build()
 	{
-		BuildAdjacencyLists();
-		TopologicalSort();
-		BuildDependencyLevels();
-		CullPasses();
-		CalculateResourcesLifetime();
+		async_compute_enabled = AsyncCompute.Get();
+		Uint64 const graph_hash = (cache && GraphCaching.Get()) ? ComputeGraphHash() : 0;
+		if (graph_hash != 0 && cache->hash == graph_hash)
+		{
+			LoadCompiledGraph();
+		}
+		else
+		{
+			BuildAdjacencyLists();
+			TopologicalSort();
+			BuildDependencyLevels();
+			CullPasses();
+			CalculateResourcesLifetime();
+			if (cache) StoreCompiledGraph(graph_hash);
+		}
+		AcquireTemporalTextures();
+		CreateImportedResourceViews();
 		for (auto& dependency_level : dependency_levels) dependency_level.Setup();
-		if (dump_render_graph) Dump("rendergraph.gv");
+		CalculateAsyncComputeSyncLevels();
+		CalculateSplitBarriers();
+		InitializeResourceStates();
+		InferRenderPassAccessOps();
+		MergeRenderPasses();
+		if (Lint.Get()) LintGraph();
 	}
 
 	void RenderGraph::Execute()
 	{
+		pool.Tick();
+		CalculateTextureAliasing();
+		breadcrumbs = gfx->GetBreadcrumbs();
+		if (breadcrumbs)
+		{
+			std::vector<std::string> pass_names;
+			pass_names.reserve(passes.size());
+			for (auto const& pass : passes) pass_names.push_back(pass->name);
+			breadcrumbs->BeginFrame(gfx->GetBackbufferIndex(), std::move(pass_names));
+		}
 #if RG_MULTITHREADED
 		Execute_Multithreaded();
 #else
 		Execute_Singlethreaded();
 #endif
+
+		std::vector<RGPassTiming> pass_timings;
+		pass_timings.reserve(passes.size());
+		for (auto const& pass : passes)
+		{
+			RGPassTiming& pass_timing = pass_timings.emplace_back();
+			pass_timing.name = pass->name;
+			pass_timing.group = pass->group;
+			pass_timing.cpu_time_ms = pass->cpu_time_ms;
+			pass_timing.culled = pass->IsCulled();
+			pass_timing.async_compute = async_compute_enabled && pass->type == RGPassType::ComputeAsync;
+		}
+		g_RenderGraphProfiler.EndFrame(std::move(pass_timings));
+
+		if (dump_render_graph)
+		{
+			DumpTimeline("rendergraph.json");
+			Dump("rendergraph.gv");
+		}
 	}
 
-	void RenderGraph::Execute_Singlethreaded()
+	void RenderGraph::SetupPass(RenderGraphPassBase* pass)
 	{
-		pool.Tick();
+		passes.emplace_back(pass);
+		pass->id = passes.size() - 1;
+		if (!pass_groups.empty()) pass->group = allocator.CopyString(pass_groups.back().c_str());
+		RenderGraphBuilder builder(*this, *pass);
+		pass->Setup(builder);
+	}
+
+	void RenderGraph::PushPassGroup(Char const* group_name)
+	{
+		if (pass_groups.empty()) pass_groups.emplace_back(group_name);
+		else pass_groups.push_back(pass_groups.back() + "/" + group_name);
+	}
+
+	void RenderGraph::PopPassGroup()
+	{
+		ADRIA_ASSERT(!pass_groups.empty());
+		pass_groups.pop_back();
+	}
 
+	void RenderGraph::Execute_Singlethreaded()
+	{
 		GfxCommandList* cmd_list = gfx->GetCommandList();
+		Uint64 passes_since_submit = 0;
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			cmd_list = SyncAsyncCompute(i, cmd_list);
+			PrepareDependencyLevel(i, cmd_list);
+			cmd_list->FlushBarriers();
+			cmd_list = SubmitAsyncCompute(i, cmd_list);
+			dependency_levels[i].Execute(gfx, cmd_list);
+			FinishDependencyLevel(i, cmd_list);
+			cmd_list->FlushBarriers();
+			cmd_list = SubmitCheckpoint(i, cmd_list, passes_since_submit);
+		}
+		SyncAsyncCompute(dependency_levels.size(), cmd_list);
+	}
+
+	void RenderGraph::Execute_Multithreaded()
+	{
+		Uint64 const max_cmd_lists = std::max<Uint64>(1, std::thread::hardware_concurrency() - 1);
+		std::vector<GfxCommandList*> pass_cmd_lists;
+		pass_cmd_lists.reserve(max_cmd_lists);
+
+		GfxCommandList* cmd_list = gfx->GetLatestCommandList(GfxCommandListType::Graphics);
+		Uint64 passes_since_submit = 0;
 		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
 		{
 			auto& dependency_level = dependency_levels[i];
-			for (auto tex_id : dependency_level.texture_creates)
+			cmd_list = SyncAsyncCompute(i, cmd_list);
+			PrepareDependencyLevel(i, cmd_list);
+			cmd_list->FlushBarriers();
+			cmd_list = SubmitAsyncCompute(i, cmd_list);
+
+			Uint64 const recording_unit_count = dependency_level.PrepareRecordingUnits(max_cmd_lists);
+			if (recording_unit_count <= 1)
+			{
+				dependency_level.Execute(gfx, cmd_list);
+			}
+			else
+			{
+				FlushSplitBarriers(cmd_list);
+				pass_cmd_lists.clear();
+				for (Uint64 j = 0; j < recording_unit_count; ++j)
+				{
+					pass_cmd_lists.push_back(gfx->AllocateCommandList(GfxCommandListType::Graphics));
+				}
+				dependency_level.Execute(gfx, pass_cmd_lists);
+				cmd_list = gfx->AllocateCommandList(GfxCommandListType::Graphics);
+			}
+
+			FinishDependencyLevel(i, cmd_list);
+			cmd_list->FlushBarriers();
+			cmd_list = SubmitCheckpoint(i, cmd_list, passes_since_submit);
+		}
+		SyncAsyncCompute(dependency_levels.size(), cmd_list);
+	}
+
+	GfxCommandList* RenderGraph::SubmitAsyncCompute(Uint64 level_index, GfxCommandList* cmd_list)
+	{
+		auto& dependency_level = dependency_levels[level_index];
+		if (!dependency_level.HasAsyncComputePasses()) return cmd_list;
+
+		FlushSplitBarriers(cmd_list);
+
+		GfxFence& graphics_fence = gfx->GetAsyncGraphicsFence();
+		Uint64 const graphics_fence_value = gfx->IncrementAsyncGraphicsFenceValue();
+		cmd_list->Signal(graphics_fence, graphics_fence_value);
+
+		GfxCommandList* compute_cmd_list = gfx->AllocateCommandList(GfxCommandListType::Compute);
+		compute_cmd_list->Wait(graphics_fence, graphics_fence_value);
+		dependency_level.ExecuteAsyncCompute(gfx, compute_cmd_list);
+
+		GfxFence& compute_fence = gfx->GetAsyncComputeFence();
+		Uint64 const compute_fence_value = gfx->IncrementAsyncComputeFenceValue();
+		compute_cmd_list->Signal(compute_fence, compute_fence_value);
+		pending_async_compute_syncs.push_back(AsyncComputeSync{ level_index, dependency_level.async_compute_sync_level, compute_fence_value });
+
+		return gfx->AllocateCommandList(GfxCommandListType::Graphics);
+	}
+
+	//the async compute lists are submitted together with the graphics ones, so waits recorded so far never stall on unsubmitted work
+	GfxCommandList* RenderGraph::SubmitCheckpoint(Uint64 level_index, GfxCommandList* cmd_list, Uint64& passes_since_submit)
+	{
+		if (!IncrementalSubmission.Get() || level_index + 1 == dependency_levels.size()) return cmd_list;
+
+		Bool submit = false;
+		Bool render_pass_open = false;
+		for (RenderGraphPassBase* pass : dependency_levels[level_index].passes)
+		{
+			if (pass->IsCulled()) continue;
+			++passes_since_submit;
+			submit |= pass->ShouldSubmitAfter();
+			render_pass_open |= pass->IsMergedWithNext();
+		}
+		//a merged render pass continues in the next level, the submission is postponed until it ends
+		if (render_pass_open) return cmd_list;
+		Int const pass_interval = SubmitPassInterval.Get();
+		if (pass_interval > 0 && passes_since_submit >= (Uint64)pass_interval) submit = true;
+		if (!submit) return cmd_list;
+
+		FlushSplitBarriers(cmd_list);
+		cmd_list->FlushBarriers();
+		gfx->SubmitCommandLists();
+		passes_since_submit = 0;
+		return gfx->GetCommandList();
+	}
+
+	GfxCommandList* RenderGraph::SyncAsyncCompute(Uint64 level_index, GfxCommandList* cmd_list)
+	{
+		Uint64 wait_fence_value = 0;
+		for (AsyncComputeSync const& async_compute_sync : pending_async_compute_syncs)
+		{
+			if (async_compute_sync.sync_level == level_index) wait_fence_value = std::max(wait_fence_value, async_compute_sync.fence_value);
+		}
+		if (wait_fence_value == 0) return cmd_list;
+
+		FlushSplitBarriers(cmd_list);
+		cmd_list = gfx->AllocateCommandList(GfxCommandListType::Graphics);
+		cmd_list->Wait(gfx->GetAsyncComputeFence(), wait_fence_value);
+		for (AsyncComputeSync const& async_compute_sync : pending_async_compute_syncs)
+		{
+			if (async_compute_sync.fence_value > wait_fence_value) continue;
+
+			auto& dependency_level = dependency_levels[async_compute_sync.level_index];
+			for (RGTextureId tex_id : dependency_level.async_texture_destroys)
 			{
 				RGTexture* rg_texture = GetRGTexture(tex_id);
-				rg_texture->resource = pool.AllocateTexture(rg_texture->desc);
-				CreateTextureViews(tex_id);
-				rg_texture->SetName();
+				GfxTexture* texture = rg_texture->resource;
+				GfxResourceState initial_state = texture->GetDesc().initial_state;
+				GfxResourceState state = dependency_level.GetTextureState(tex_id);
+				if (initial_state != state) cmd_list->TextureBarrier(*texture, state, initial_state);
+				if (!rg_texture->imported) pool.ReleaseTexture(rg_texture->resource);
 			}
-			for (auto buf_id : dependency_level.buffer_creates)
+			for (RGBufferId buf_id : dependency_level.async_buffer_destroys)
 			{
 				RGBuffer* rg_buffer = GetRGBuffer(buf_id);
-				rg_buffer->resource = pool.AllocateBuffer(rg_buffer->desc);
-				CreateBufferViews(buf_id);
-				rg_buffer->SetName();
+				GfxBuffer* buffer = rg_buffer->resource;
+				GfxResourceState state = dependency_level.GetBufferState(buf_id);
+				if (state != GfxResourceState::Common) cmd_list->BufferBarrier(*buffer, state, GfxResourceState::Common);
+				if (!rg_buffer->imported) pool.ReleaseBuffer(rg_buffer->resource);
 			}
-			for (auto const& [tex_id, state] : dependency_level.texture_state_map)
+		}
+		std::erase_if(pending_async_compute_syncs, [wait_fence_value](AsyncComputeSync const& async_compute_sync) { return async_compute_sync.fence_value <= wait_fence_value; });
+		cmd_list->FlushBarriers();
+		return cmd_list;
+	}
+
+	void RenderGraph::FlushSplitBarriers(GfxCommandList* cmd_list)
+	{
+		for (RGTextureId tex_id : pending_texture_splits)
+		{
+			GfxResourceState& split_state = texture_split_states[tex_id.id];
+			if (split_state == GfxResourceState::None) continue;
+			cmd_list->TextureBarrier(*GetRGTexture(tex_id)->resource, texture_last_states[tex_id.id], split_state, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, GfxBarrierSplit::End);
+			texture_last_states[tex_id.id] = split_state;
+			split_state = GfxResourceState::None;
+		}
+		for (RGBufferId buf_id : pending_buffer_splits)
+		{
+			GfxResourceState& split_state = buffer_split_states[buf_id.id];
+			if (split_state == GfxResourceState::None) continue;
+			cmd_list->BufferBarrier(*GetRGBuffer(buf_id)->resource, buffer_last_states[buf_id.id], split_state, GfxBarrierSplit::End);
+			buffer_last_states[buf_id.id] = split_state;
+			split_state = GfxResourceState::None;
+		}
+		pending_texture_splits.clear();
+		pending_buffer_splits.clear();
+		cmd_list->FlushBarriers();
+	}
+
+	void RenderGraph::CalculateTextureAliasing()
+	{
+		texture_heap_offsets.clear();
+		if (!TextureAliasing.Get() || !pool.SupportsTextureAliasing()) return;
+
+		struct TransientTexture
+		{
+			RGTextureId id;
+			Uint64 first_level;
+			Uint64 last_level;
+			Uint64 size;
+			Uint64 alignment;
+			Uint64 heap_offset;
+		};
+		std::vector<TransientTexture> transient_textures;
+		std::unordered_map<RGTextureId, Uint64> transient_texture_indices;
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			for (RGTextureId tex_id : dependency_levels[i].texture_creates)
 			{
 				RGTexture* rg_texture = GetRGTexture(tex_id);
-				GfxTexture* texture = rg_texture->resource;
-				if (dependency_level.texture_creates.contains(tex_id))
-				{
-					if (!HasAllFlags(texture->GetDesc().initial_state, state))
-					{
-						cmd_list->TextureBarrier(*texture, texture->GetDesc().initial_state, state);
-					}
-					continue;
-				}
-				Bool found = false;
-				for (Int32 j = (Int32)i - 1; j >= 0; --j)
-				{
-					auto& prev_dependency_level = dependency_levels[j];
-					if (prev_dependency_level.texture_state_map.contains(tex_id))
-					{
-						GfxResourceState prev_state = prev_dependency_level.texture_state_map[tex_id];
-						if (prev_state != state) cmd_list->TextureBarrier(*texture, prev_state, state);
-						found = true;
-						break;
-					}
-				}
-				if (!found && rg_texture->imported)
+				if (rg_texture->imported || rg_texture->desc.heap_type != GfxResourceUsage::Default) continue;
+
+				GfxTextureAllocationInfo allocation_info = GfxTexture::GetAllocationInfo(gfx, rg_texture->desc);
+				transient_texture_indices[tex_id] = transient_textures.size();
+				transient_textures.push_back(TransientTexture{ tex_id, i, dependency_levels.size() - 1, allocation_info.size, allocation_info.alignment, 0 });
+			}
+			for (RGTextureId tex_id : dependency_levels[i].texture_destroys)
+			{
+				if (auto it = transient_texture_indices.find(tex_id); it != transient_texture_indices.end())
 				{
-					GfxResourceState prev_state = rg_texture->desc.initial_state;
-					if (prev_state != state) cmd_list->TextureBarrier(*texture, prev_state, state);
+					transient_textures[it->second].last_level = i;
 				}
 			}
-			for (auto const& [buf_id, state] : dependency_level.buffer_state_map)
+			for (RGTextureId tex_id : dependency_levels[i].async_texture_destroys)
 			{
-				RGBuffer* rg_buffer = GetRGBuffer(buf_id);
-				GfxBuffer* buffer = rg_buffer->resource;
-				if (dependency_level.buffer_creates.contains(buf_id))
+				if (auto it = transient_texture_indices.find(tex_id); it != transient_texture_indices.end())
 				{
-					if (state != GfxResourceState::Common)
-					{
-						cmd_list->BufferBarrier(*buffer, GfxResourceState::Common, state);
-					}
-					continue;
+					transient_textures[it->second].last_level = std::min(dependency_levels[i].async_compute_sync_level, dependency_levels.size()) - 1;
 				}
-				Bool found = false;
-				for (Int32 j = (Int32)i - 1; j >= 0; --j)
+			}
+		}
+		if (transient_textures.empty()) return;
+
+		std::sort(transient_textures.begin(), transient_textures.end(), [](TransientTexture const& a, TransientTexture const& b) { return a.size > b.size; });
+
+		Uint64 heap_size = 0;
+		std::vector<std::pair<Uint64, Uint64>> occupied_ranges;
+		for (Uint64 i = 0; i < transient_textures.size(); ++i)
+		{
+			TransientTexture& transient_texture = transient_textures[i];
+			occupied_ranges.clear();
+			for (Uint64 j = 0; j < i; ++j)
+			{
+				TransientTexture const& placed_texture = transient_textures[j];
+				Bool const lifetimes_overlap = placed_texture.first_level <= transient_texture.last_level && transient_texture.first_level <= placed_texture.last_level;
+				if (lifetimes_overlap) occupied_ranges.emplace_back(placed_texture.heap_offset, placed_texture.heap_offset + placed_texture.size);
+			}
+			std::sort(occupied_ranges.begin(), occupied_ranges.end());
+
+			Uint64 heap_offset = 0;
+			for (auto const& [range_begin, range_end] : occupied_ranges)
+			{
+				if (heap_offset + transient_texture.size <= range_begin) break;
+				heap_offset = std::max(heap_offset, Align(range_end, transient_texture.alignment));
+			}
+			transient_texture.heap_offset = heap_offset;
+			heap_size = std::max(heap_size, heap_offset + transient_texture.size);
+		}
+
+		pool.ReserveTransientHeap(heap_size);
+		for (TransientTexture const& transient_texture : transient_textures)
+		{
+			texture_heap_offsets[transient_texture.id] = transient_texture.heap_offset;
+		}
+	}
+
+	void RenderGraph::PrepareDependencyLevel(Uint64 level_index, GfxCommandList* cmd_list)
+	{
+		auto& dependency_level = dependency_levels[level_index];
+		for (auto tex_id : dependency_level.texture_creates)
+		{
+			RGTexture* rg_texture = GetRGTexture(tex_id);
+			if (auto it = texture_heap_offsets.find(tex_id); it != texture_heap_offsets.end())
+			{
+				rg_texture->resource = pool.AllocateAliasedTexture(rg_texture->desc, it->second, &rg_texture->pooled);
+				rg_texture->aliased = true;
+			}
+			else
+			{
+				rg_texture->resource = pool.AllocateTexture(rg_texture->desc, &rg_texture->pooled);
+			}
+			CreateTextureViews(tex_id);
+			rg_texture->SetName();
+		}
+		for (auto buf_id : dependency_level.buffer_creates)
+		{
+			RGBuffer* rg_buffer = GetRGBuffer(buf_id);
+			rg_buffer->resource = pool.AllocateBuffer(rg_buffer->desc, &rg_buffer->pooled);
+			CreateBufferViews(buf_id);
+			rg_buffer->SetName();
+		}
+		for (auto const& [tex_id, state] : dependency_level.texture_states)
+		{
+			RGTexture* rg_texture = GetRGTexture(tex_id);
+			GfxTexture* texture = rg_texture->resource;
+			GfxResourceState& last_state = texture_last_states[tex_id.id];
+			if (dependency_level.CreatesTexture(tex_id))
+			{
+				if (texture_heap_offsets.contains(tex_id))
 				{
-					auto& prev_dependency_level = dependency_levels[j];
-					if (prev_dependency_level.buffer_state_map.contains(buf_id))
-					{
-						GfxResourceState prev_state = prev_dependency_level.buffer_state_map[buf_id];
-						if (prev_state != state) cmd_list->BufferBarrier(*buffer, prev_state, state);
-						found = true;
-						break;
-					}
+					cmd_list->AliasingBarrier(nullptr, *texture, state);
 				}
-				if (!found && rg_buffer->imported)
+				else if (!HasAllFlags(texture->GetDesc().initial_state, state))
 				{
-					if (GfxResourceState::Common != state) cmd_list->BufferBarrier(*buffer, GfxResourceState::Common, state);
+					cmd_list->TextureBarrier(*texture, texture->GetDesc().initial_state, state);
 				}
 			}
-
-			cmd_list->FlushBarriers();
-			dependency_level.Execute(gfx, cmd_list);
-
-			for (RGTextureId tex_id : dependency_level.texture_destroys)
+			else if (last_state != GfxResourceState::None && last_state != state)
 			{
-				RGTexture* rg_texture = GetRGTexture(tex_id);
-				GfxTexture* texture = rg_texture->resource;
-				GfxResourceState initial_state = texture->GetDesc().initial_state;
-				ADRIA_ASSERT(dependency_level.texture_state_map.contains(tex_id));
-				GfxResourceState state = dependency_level.texture_state_map[tex_id];
-				if (initial_state != state) cmd_list->TextureBarrier(*texture, state, initial_state);
-				if (!rg_texture->imported) pool.ReleaseTexture(rg_texture->resource);
+				GfxResourceState& split_state = texture_split_states[tex_id.id];
+				ADRIA_ASSERT(split_state == GfxResourceState::None || split_state == state);
+				cmd_list->TextureBarrier(*texture, last_state, state, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, split_state != GfxResourceState::None ? GfxBarrierSplit::End : GfxBarrierSplit::None);
+				split_state = GfxResourceState::None;
 			}
-			for (RGBufferId buf_id : dependency_level.buffer_destroys)
+			last_state = state;
+		}
+		for (auto const& [buf_id, state] : dependency_level.buffer_states)
+		{
+			RGBuffer* rg_buffer = GetRGBuffer(buf_id);
+			GfxBuffer* buffer = rg_buffer->resource;
+			GfxResourceState& last_state = buffer_last_states[buf_id.id];
+			if (dependency_level.CreatesBuffer(buf_id))
 			{
-				RGBuffer* rg_buffer = GetRGBuffer(buf_id);
-				GfxBuffer* buffer = rg_buffer->resource;
-				ADRIA_ASSERT(dependency_level.buffer_state_map.contains(buf_id));
-				GfxResourceState state = dependency_level.buffer_state_map[buf_id];
-				if(state != GfxResourceState::Common) cmd_list->BufferBarrier(*buffer, state, GfxResourceState::Common);
-				if (!rg_buffer->imported) pool.ReleaseBuffer(rg_buffer->resource);
+				if (state != GfxResourceState::Common)
+				{
+					cmd_list->BufferBarrier(*buffer, GfxResourceState::Common, state);
+				}
 			}
-			cmd_list->FlushBarriers();
+			else if (last_state != GfxResourceState::None && last_state != state)
+			{
+				GfxResourceState& split_state = buffer_split_states[buf_id.id];
+				ADRIA_ASSERT(split_state == GfxResourceState::None || split_state == state);
+				cmd_list->BufferBarrier(*buffer, last_state, state, split_state != GfxResourceState::None ? GfxBarrierSplit::End : GfxBarrierSplit::None);
+				split_state = GfxResourceState::None;
+			}
+			last_state = state;
 		}
 	}
 
-	void RenderGraph::Execute_Multithreaded()
+	void RenderGraph::FinishDependencyLevel(Uint64 level_index, GfxCommandList* cmd_list)
+	{
+		auto& dependency_level = dependency_levels[level_index];
+		for (RGTextureId tex_id : dependency_level.texture_destroys)
+		{
+			RGTexture* rg_texture = GetRGTexture(tex_id);
+			GfxTexture* texture = rg_texture->resource;
+			GfxResourceState initial_state = texture->GetDesc().initial_state;
+			GfxResourceState state = dependency_level.GetTextureState(tex_id);
+			ADRIA_ASSERT(state != GfxResourceState::None);
+			if (initial_state != state) cmd_list->TextureBarrier(*texture, state, initial_state);
+			if (!rg_texture->imported) pool.ReleaseTexture(rg_texture->resource);
+		}
+		for (RGBufferId buf_id : dependency_level.buffer_destroys)
+		{
+			RGBuffer* rg_buffer = GetRGBuffer(buf_id);
+			GfxBuffer* buffer = rg_buffer->resource;
+			GfxResourceState state = dependency_level.GetBufferState(buf_id);
+			ADRIA_ASSERT(state != GfxResourceState::None);
+			if(state != GfxResourceState::Common) cmd_list->BufferBarrier(*buffer, state, GfxResourceState::Common);
+			if (!rg_buffer->imported) pool.ReleaseBuffer(rg_buffer->resource);
+		}
+		for (auto const& [tex_id, next_state] : dependency_level.texture_split_barriers)
+		{
+			cmd_list->TextureBarrier(*GetRGTexture(tex_id)->resource, texture_last_states[tex_id.id], next_state, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, GfxBarrierSplit::Begin);
+			texture_split_states[tex_id.id] = next_state;
+			pending_texture_splits.push_back(tex_id);
+		}
+		for (auto const& [buf_id, next_state] : dependency_level.buffer_split_barriers)
+		{
+			cmd_list->BufferBarrier(*GetRGBuffer(buf_id)->resource, buffer_last_states[buf_id.id], next_state, GfxBarrierSplit::Begin);
+			buffer_split_states[buf_id.id] = next_state;
+			pending_buffer_splits.push_back(buf_id);
+		}
+	}
+
+	void RenderGraph::AddCounterPredicatePass(RGResourceName counter, RGResourceName predicate, Uint32 counter_offset)
 	{
-		ADRIA_ASSERT_MSG(false, "Not implemented!");
+		struct CounterPredicatePassData
+		{
+			RGBufferCopySrcId counter;
+			RGBufferCopyDstId predicate;
+		};
+		AddPass<CounterPredicatePassData>("Counter Predicate Pass",
+			[=](CounterPredicatePassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc predicate_desc{};
+				predicate_desc.size = sizeof(Uint64);
+				builder.DeclareBuffer(predicate, predicate_desc);
+				data.counter = builder.ReadCopySrcBuffer(counter);
+				data.predicate = builder.WriteCopyDstBuffer(predicate);
+			},
+			[=](CounterPredicatePassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxBuffer& predicate_buffer = context.GetCopyDstBuffer(data.predicate);
+				cmd_list->WriteBufferImmediate(predicate_buffer, sizeof(Uint32), 0);
+				cmd_list->CopyBuffer(predicate_buffer, 0, context.GetCopySrcBuffer(data.counter), counter_offset, sizeof(Uint32));
+			}, RGPassType::Copy, RGPassFlags::None);
 	}
 
 	void RenderGraph::AddExportBufferCopyPass(RGResourceName export_buffer, GfxBuffer* buffer)
@@ -345,6 +753,16 @@ namespace adria
 			}
 		}
 
+		for (Uint64 u = topologically_sorted_passes.size(); u-- > 0;)
+		{
+			Uint64 i = topologically_sorted_passes[u];
+			if (!passes[i]->ShouldScheduleLate() || adjacency_lists[i].empty()) continue;
+
+			Uint64 latest_level = distances[adjacency_lists[i][0]];
+			for (auto v : adjacency_lists[i]) latest_level = std::min(latest_level, distances[v]);
+			distances[i] = std::max(distances[i], latest_level - 1);
+		}
+
 		dependency_levels.resize(*std::max_element(std::begin(distances), std::end(distances)) + 1, DependencyLevel(*this));
 		for (Uint64 i = 0; i < passes.size(); ++i)
 		{
@@ -446,15 +864,349 @@ namespace adria
 		for (Uint64 i = 0; i < textures.size(); ++i)
 		{
 			if (textures[i]->last_used_by != nullptr) textures[i]->last_used_by->texture_destroys.insert(RGTextureId(i));
-			if (textures[i]->imported) CreateTextureViews(RGTextureId(i));
 		}
 		for (Uint64 i = 0; i < buffers.size(); ++i)
 		{
 			if (buffers[i]->last_used_by != nullptr) buffers[i]->last_used_by->buffer_destroys.insert(RGBufferId(i));
+		}
+	}
+
+	void RenderGraph::AcquireTemporalTextures()
+	{
+		for (TemporalTexture const& temporal : temporal_textures)
+		{
+			RGTexture* current = GetRGTexture(temporal.current);
+			RGTexture* history = GetRGTexture(temporal.history);
+
+			//the textures swap roles every frame, so both get the union of the usages and start in the state this frame's version is first used in
+			GfxTextureDesc desc = current->desc;
+			desc.bind_flags |= history->desc.bind_flags;
+			if (desc.initial_state == GfxResourceState::Common) desc.initial_state = history->desc.initial_state;
+
+			auto [current_texture, history_texture] = pool.AcquireTemporalTexture(temporal.key, desc);
+			current->resource = current_texture;
+			current->desc = desc;
+			current->SetName();
+			history->resource = history_texture;
+			history->desc = desc;
+			history->SetName();
+		}
+	}
+
+	void RenderGraph::CreateImportedResourceViews()
+	{
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			if (textures[i]->imported) CreateTextureViews(RGTextureId(i));
+		}
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
 			if (buffers[i]->imported) CreateBufferViews(RGBufferId(i));
 		}
 	}
 
+	Uint64 RenderGraph::ComputeGraphHash() const
+	{
+		auto HashIdSet = []<typename T>(std::pmr::unordered_set<T> const& ids)
+			{
+				Uint64 set_hash = ids.size();
+				for (T const& id : ids) set_hash += std::hash<T>{}(id) * 0x9e3779b97f4a7c15ull;
+				return set_hash;
+			};
+		auto HashStateMap = []<typename T>(std::pmr::unordered_map<T, GfxResourceState> const& state_map)
+			{
+				Uint64 map_hash = state_map.size();
+				for (auto const& [id, state] : state_map)
+				{
+					HashState entry_hash{};
+					entry_hash.Combine(std::hash<T>{}(id));
+					entry_hash.Combine((Uint64)state);
+					map_hash += entry_hash;
+				}
+				return map_hash;
+			};
+
+		HashState hash{};
+		hash.Combine(passes.size());
+		hash.Combine(textures.size());
+		hash.Combine(buffers.size());
+		for (auto const& texture : textures) hash.Combine(texture->imported);
+		for (auto const& buffer : buffers) hash.Combine(buffer->imported);
+		for (auto const& pass : passes)
+		{
+			hash.Combine(std::string_view(pass->name));
+			hash.Combine((Uint64)pass->type);
+			hash.Combine((Uint64)pass->flags);
+			hash.Combine(HashIdSet(pass->texture_creates));
+			hash.Combine(HashIdSet(pass->texture_reads));
+			hash.Combine(HashIdSet(pass->texture_writes));
+			hash.Combine(HashStateMap(pass->texture_state_map));
+			hash.Combine(HashIdSet(pass->buffer_creates));
+			hash.Combine(HashIdSet(pass->buffer_reads));
+			hash.Combine(HashIdSet(pass->buffer_writes));
+			hash.Combine(HashStateMap(pass->buffer_state_map));
+		}
+		Uint64 const graph_hash = hash;
+		return graph_hash == 0 ? 1 : graph_hash;
+	}
+
+	void RenderGraph::StoreCompiledGraph(Uint64 graph_hash)
+	{
+		cache->hash = graph_hash;
+		cache->adjacency_lists = adjacency_lists;
+		cache->topologically_sorted_passes = topologically_sorted_passes;
+
+		cache->dependency_level_passes.resize(dependency_levels.size());
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			auto& level_passes = cache->dependency_level_passes[i];
+			level_passes.clear();
+			for (RenderGraphPassBase* pass : dependency_levels[i].passes) level_passes.push_back(pass->id);
+		}
+
+		cache->pass_ref_counts.resize(passes.size());
+		for (Uint64 i = 0; i < passes.size(); ++i) cache->pass_ref_counts[i] = passes[i]->ref_count;
+
+		cache->texture_last_used_by.resize(textures.size());
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			cache->texture_last_used_by[i] = textures[i]->last_used_by ? textures[i]->last_used_by->id : RGCache::INVALID_PASS;
+		}
+		cache->buffer_last_used_by.resize(buffers.size());
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
+			cache->buffer_last_used_by[i] = buffers[i]->last_used_by ? buffers[i]->last_used_by->id : RGCache::INVALID_PASS;
+		}
+	}
+
+	void RenderGraph::LoadCompiledGraph()
+	{
+		adjacency_lists = cache->adjacency_lists;
+		topologically_sorted_passes = cache->topologically_sorted_passes;
+
+		dependency_levels.resize(cache->dependency_level_passes.size(), DependencyLevel(*this));
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			for (Uint64 pass_id : cache->dependency_level_passes[i]) dependency_levels[i].AddPass(passes[pass_id].get());
+		}
+
+		for (Uint64 i = 0; i < passes.size(); ++i) passes[i]->ref_count = cache->pass_ref_counts[i];
+
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			Uint64 const pass_id = cache->texture_last_used_by[i];
+			if (pass_id == RGCache::INVALID_PASS) continue;
+			textures[i]->last_used_by = passes[pass_id].get();
+			passes[pass_id]->texture_destroys.insert(RGTextureId(i));
+		}
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
+			Uint64 const pass_id = cache->buffer_last_used_by[i];
+			if (pass_id == RGCache::INVALID_PASS) continue;
+			buffers[i]->last_used_by = passes[pass_id].get();
+			passes[pass_id]->buffer_destroys.insert(RGBufferId(i));
+		}
+	}
+
+	void RenderGraph::CalculateAsyncComputeSyncLevels()
+	{
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			auto& dependency_level = dependency_levels[i];
+			dependency_level.async_compute_sync_level = dependency_levels.size();
+			if (!dependency_level.HasAsyncComputePasses()) continue;
+
+			std::unordered_set<RGTextureId> async_textures;
+			std::unordered_set<RGBufferId> async_buffers;
+			for (RenderGraphPassBase* pass : dependency_level.async_compute_passes)
+			{
+				for (auto const& [tex_id, state] : pass->texture_state_map) async_textures.insert(tex_id);
+				for (auto const& [buf_id, state] : pass->buffer_state_map) async_buffers.insert(buf_id);
+			}
+
+			for (Uint64 j = i + 1; j < dependency_levels.size(); ++j)
+			{
+				auto& next_dependency_level = dependency_levels[j];
+				Bool const textures_shared = std::any_of(async_textures.begin(), async_textures.end(), [&](RGTextureId tex_id) { return next_dependency_level.GetTextureState(tex_id) != GfxResourceState::None; });
+				Bool const buffers_shared = std::any_of(async_buffers.begin(), async_buffers.end(), [&](RGBufferId buf_id) { return next_dependency_level.GetBufferState(buf_id) != GfxResourceState::None; });
+				if (textures_shared || buffers_shared)
+				{
+					dependency_level.async_compute_sync_level = j;
+					break;
+				}
+			}
+		}
+	}
+
+	void RenderGraph::InitializeResourceStates()
+	{
+		texture_last_states.assign(textures.size(), GfxResourceState::None);
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			if (textures[i]->imported) texture_last_states[i] = textures[i]->desc.initial_state;
+		}
+		buffer_last_states.assign(buffers.size(), GfxResourceState::None);
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
+			if (buffers[i]->imported) buffer_last_states[i] = GfxResourceState::Common;
+		}
+		texture_split_states.assign(textures.size(), GfxResourceState::None);
+		buffer_split_states.assign(buffers.size(), GfxResourceState::None);
+	}
+
+	void RenderGraph::CalculateSplitBarriers()
+	{
+		if (!SplitBarriers.Get()) return;
+
+		static constexpr Uint64 INVALID_LEVEL = static_cast<Uint64>(-1);
+		std::vector<Uint64> texture_next_use(textures.size(), INVALID_LEVEL);
+		std::vector<Uint64> buffer_next_use(buffers.size(), INVALID_LEVEL);
+		for (Uint64 i = dependency_levels.size(); i-- > 0;)
+		{
+			auto& dependency_level = dependency_levels[i];
+			for (auto const& [tex_id, state] : dependency_level.texture_states)
+			{
+				Uint64 const next_level = texture_next_use[tex_id.id];
+				texture_next_use[tex_id.id] = i;
+				if (next_level == INVALID_LEVEL || next_level == i + 1 || dependency_level.IsUsedByAsyncCompute(tex_id)) continue;
+
+				GfxResourceState const next_state = dependency_levels[next_level].GetTextureState(tex_id);
+				if (next_state != state) dependency_level.texture_split_barriers.emplace_back(tex_id, next_state);
+			}
+			for (auto const& [buf_id, state] : dependency_level.buffer_states)
+			{
+				Uint64 const next_level = buffer_next_use[buf_id.id];
+				buffer_next_use[buf_id.id] = i;
+				if (next_level == INVALID_LEVEL || next_level == i + 1 || dependency_level.IsUsedByAsyncCompute(buf_id)) continue;
+
+				GfxResourceState const next_state = dependency_levels[next_level].GetBufferState(buf_id);
+				if (next_state != state) dependency_level.buffer_split_barriers.emplace_back(buf_id, next_state);
+			}
+		}
+	}
+
+	void RenderGraph::InferRenderPassAccessOps()
+	{
+		if (!InferDiscardAccess.Get()) return;
+
+		auto InferAccessOp = [this](RenderGraphPassBase const* pass, RGTextureId tex_id, RGLoadStoreAccessOp& load_store_op)
+			{
+				RGTexture const* rg_texture = GetRGTexture(tex_id);
+				if (rg_texture->imported || load_store_op == RGLoadStoreAccessOp::NoAccess_NoAccess) return;
+
+				RGLoadAccessOp load_op = RGLoadAccessOp::NoAccess;
+				RGStoreAccessOp store_op = RGStoreAccessOp::NoAccess;
+				SplitAccessOp(load_store_op, load_op, store_op);
+				//transient textures have undefined contents when created and nobody reads them after their last use
+				if (load_op == RGLoadAccessOp::Preserve && pass->texture_creates.contains(tex_id)) load_op = RGLoadAccessOp::Discard;
+				if (store_op == RGStoreAccessOp::Preserve && rg_texture->last_used_by == pass) store_op = RGStoreAccessOp::Discard;
+				load_store_op = static_cast<RGLoadStoreAccessOp>(CombineAccessOps(load_op, store_op));
+			};
+
+		for (auto& dependency_level : dependency_levels)
+		{
+			for (RenderGraphPassBase* pass : dependency_level.passes)
+			{
+				if (pass->IsCulled() || pass->type != RGPassType::Graphics) continue;
+				for (auto& render_target_info : pass->render_targets_info)
+				{
+					InferAccessOp(pass, render_target_info.render_target_handle.GetResourceId(), render_target_info.render_target_access);
+				}
+				if (pass->depth_stencil.has_value() && !pass->depth_stencil->depth_read_only)
+				{
+					auto& depth_stencil_info = pass->depth_stencil.value();
+					RGTextureId const ds_texture = depth_stencil_info.depth_stencil_handle.GetResourceId();
+					InferAccessOp(pass, ds_texture, depth_stencil_info.depth_access);
+					InferAccessOp(pass, ds_texture, depth_stencil_info.stencil_access);
+				}
+			}
+		}
+	}
+
+	//merges raster passes of consecutive levels when they draw to the same attachments and nothing is recorded between them,
+	//only levels with a single pass on the graphics queue take part so the render pass never spans several command lists
+	void RenderGraph::MergeRenderPasses()
+	{
+		if (!RenderPassMerging.Get()) return;
+
+		auto GetRenderPass = [](DependencyLevel const& dependency_level) -> RenderGraphPassBase*
+			{
+				if (dependency_level.GetActivePassCount() != 1 || dependency_level.HasAsyncComputePasses()) return nullptr;
+				for (RenderGraphPassBase* pass : dependency_level.passes)
+				{
+					if (!dependency_level.IsExecutedOnGraphicsQueue(pass)) continue;
+					Bool const mergeable = pass->type == RGPassType::Graphics && !pass->UseLegacyRenderPasses() && !pass->IsParallel() && !pass->IsPredicated();
+					return mergeable ? pass : nullptr;
+				}
+				return nullptr;
+			};
+		auto CanMerge = [](RenderGraphPassBase const* previous_pass, RenderGraphPassBase const* pass)
+			{
+				if (previous_pass->viewport_width != pass->viewport_width || previous_pass->viewport_height != pass->viewport_height) return false;
+				if (previous_pass->render_targets_info.size() != pass->render_targets_info.size()) return false;
+				for (Uint64 i = 0; i < pass->render_targets_info.size(); ++i)
+				{
+					auto const& previous_info = previous_pass->render_targets_info[i];
+					auto const& info = pass->render_targets_info[i];
+					if (previous_info.render_target_handle != info.render_target_handle) return false;
+					if (!CanContinueRenderPass(previous_info.render_target_access, info.render_target_access)) return false;
+				}
+				if (previous_pass->depth_stencil.has_value() != pass->depth_stencil.has_value()) return false;
+				if (!pass->depth_stencil.has_value()) return true;
+
+				auto const& previous_info = previous_pass->depth_stencil.value();
+				auto const& info = pass->depth_stencil.value();
+				return previous_info.depth_stencil_handle == info.depth_stencil_handle && previous_info.depth_read_only == info.depth_read_only &&
+					   CanContinueRenderPass(previous_info.depth_access, info.depth_access) && CanContinueRenderPass(previous_info.stencil_access, info.stencil_access);
+			};
+
+		std::vector<Bool> async_compute_sync_levels(dependency_levels.size() + 1, false);
+		for (auto const& dependency_level : dependency_levels)
+		{
+			if (dependency_level.HasAsyncComputePasses()) async_compute_sync_levels[dependency_level.async_compute_sync_level] = true;
+		}
+
+		//replays the transitions Prepare/FinishDependencyLevel will record, starting from the states set by InitializeResourceStates
+		std::vector<GfxResourceState> texture_states = texture_last_states;
+		std::vector<GfxResourceState> buffer_states = buffer_last_states;
+		RenderGraphPassBase* previous_pass = nullptr;
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			DependencyLevel& dependency_level = dependency_levels[i];
+			Bool barriers = !dependency_level.texture_creates.empty() || !dependency_level.buffer_creates.empty() || async_compute_sync_levels[i];
+			for (auto const& [tex_id, state] : dependency_level.texture_states)
+			{
+				GfxResourceState& last_state = texture_states[tex_id.id];
+				if (!dependency_level.CreatesTexture(tex_id) && last_state != GfxResourceState::None && last_state != state) barriers = true;
+				last_state = state;
+			}
+			for (auto const& [buf_id, state] : dependency_level.buffer_states)
+			{
+				GfxResourceState& last_state = buffer_states[buf_id.id];
+				if (!dependency_level.CreatesBuffer(buf_id) && last_state != GfxResourceState::None && last_state != state) barriers = true;
+				last_state = state;
+			}
+
+			RenderGraphPassBase* pass = GetRenderPass(dependency_level);
+			if (previous_pass && pass && !barriers && CanMerge(previous_pass, pass))
+			{
+				previous_pass->merged_next = pass;
+				pass->merged_with_previous = true;
+			}
+
+			Bool end_barriers = !dependency_level.texture_split_barriers.empty() || !dependency_level.buffer_split_barriers.empty();
+			for (RGTextureId tex_id : dependency_level.texture_destroys)
+			{
+				if (GetRGTexture(tex_id)->desc.initial_state != dependency_level.GetTextureState(tex_id)) end_barriers = true;
+			}
+			for (RGBufferId buf_id : dependency_level.buffer_destroys)
+			{
+				if (dependency_level.GetBufferState(buf_id) != GfxResourceState::Common) end_barriers = true;
+			}
+			previous_pass = (pass && !end_barriers && !pass->ShouldSubmitAfter()) ? pass : nullptr;
+		}
+	}
+
 	void RenderGraph::DepthFirstSearch(Uint64 i, std::vector<Bool>& visited, std::vector<Uint64>& topologically_sorted_passes)
 	{
 		visited[i] = true;
@@ -488,9 +1240,16 @@ namespace adria
 	void RenderGraph::CreateTextureViews(RGTextureId res_id)
 	{
 		auto const& view_descs = texture_view_desc_map[res_id];
+		Bool const imported = GetRGTexture(res_id)->imported;
 		for (auto const& [view_desc, type] : view_descs)
 		{
 			GfxTexture* texture = GetTexture(res_id);
+			if (!imported)
+			{
+				texture_view_map[res_id].emplace_back(pool.GetTextureView(texture, view_desc, type), type);
+				continue;
+			}
+
 			GfxDescriptor view;
 			switch (type)
 			{
@@ -510,16 +1269,25 @@ namespace adria
 				ADRIA_ASSERT_MSG(false, "invalid resource view type for texture");
 			}
 			texture_view_map[res_id].emplace_back(view, type);
+			owned_views.emplace_back(view, GetDescriptorHeapType(type));
 		}
 	}
 
 	void RenderGraph::CreateBufferViews(RGBufferId res_id)
 	{
 		auto const& view_descs = buffer_view_desc_map[res_id];
+		Bool const imported = GetRGBuffer(res_id)->imported;
 		for (Uint64 i = 0; i < view_descs.size(); ++i)
 		{
 			auto const& [view_desc, type] = view_descs[i];
 			GfxBuffer* buffer = GetBuffer(res_id);
+			RGBufferReadWriteId rw_id(i, res_id);
+			if (!imported && !(type == RGDescriptorType::ReadWrite && buffer_uav_counter_map.contains(rw_id)))
+			{
+				buffer_view_map[res_id].emplace_back(pool.GetBufferView(buffer, view_desc, type), type);
+				continue;
+			}
+
 			GfxDescriptor view;
 			switch (type)
 			{
@@ -530,7 +1298,6 @@ namespace adria
 			}
 			case RGDescriptorType::ReadWrite:
 			{
-				RGBufferReadWriteId rw_id(i, res_id);
 				if (buffer_uav_counter_map.contains(rw_id))
 				{
 					GfxBuffer* counter_buffer = GetBuffer(buffer_uav_counter_map[rw_id]);
@@ -545,6 +1312,7 @@ namespace adria
 				ADRIA_ASSERT_MSG(false, "invalid resource view type for buffer");
 			}
 			buffer_view_map[res_id].emplace_back(view, type);
+			owned_views.emplace_back(view, GfxDescriptorHeapType::CBV_SRV_UAV);
 		}
 	}
 
@@ -896,207 +1664,345 @@ namespace adria
 	void RenderGraph::DependencyLevel::AddPass(RenderGraphPassBase* pass)
 	{
 		passes.push_back(pass);
-		texture_reads.insert(pass->texture_reads.begin(), pass->texture_reads.end());
-		texture_writes.insert(pass->texture_writes.begin(), pass->texture_writes.end());
-		buffer_reads.insert(pass->buffer_reads.begin(), pass->buffer_reads.end());
-		buffer_writes.insert(pass->buffer_writes.begin(), pass->buffer_writes.end());
+	}
+
+	Uint64 RenderGraph::DependencyLevel::GetActivePassCount() const
+	{
+		return std::count_if(passes.begin(), passes.end(), [this](RenderGraphPassBase const* pass) { return IsExecutedOnGraphicsQueue(pass); });
+	}
+
+	Bool RenderGraph::DependencyLevel::IsExecutedOnGraphicsQueue(RenderGraphPassBase const* pass) const
+	{
+		if (pass->IsCulled()) return false;
+		return !(rg.async_compute_enabled && pass->type == RGPassType::ComputeAsync);
 	}
 
 	void RenderGraph::DependencyLevel::Setup()
 	{
+		Uint64 texture_state_count = 0, buffer_state_count = 0;
+		for (auto& pass : passes)
+		{
+			texture_state_count += pass->texture_state_map.size();
+			buffer_state_count += pass->buffer_state_map.size();
+		}
+		texture_states.reserve(texture_state_count);
+		buffer_states.reserve(buffer_state_count);
+
 		for (auto& pass : passes)
 		{
 			if (pass->IsCulled()) continue;
 
-			texture_creates.insert(pass->texture_creates.begin(), pass->texture_creates.end());
-			texture_destroys.insert(pass->texture_destroys.begin(), pass->texture_destroys.end());
-			for (auto [resource, state] : pass->texture_state_map)
-			{
-				texture_state_map[resource] |= state;
-			}
+			Bool const async_compute = !IsExecutedOnGraphicsQueue(pass);
+			if (async_compute) async_compute_passes.push_back(pass);
 
-			buffer_creates.insert(pass->buffer_creates.begin(), pass->buffer_creates.end());
-			buffer_destroys.insert(pass->buffer_destroys.begin(), pass->buffer_destroys.end());
-			for (auto [resource, state] : pass->buffer_state_map)
-			{
-				buffer_state_map[resource] |= state;
-			}
+			texture_creates.insert(texture_creates.end(), pass->texture_creates.begin(), pass->texture_creates.end());
+			auto& pass_texture_destroys = async_compute ? async_texture_destroys : texture_destroys;
+			pass_texture_destroys.insert(pass_texture_destroys.end(), pass->texture_destroys.begin(), pass->texture_destroys.end());
+			texture_states.insert(texture_states.end(), pass->texture_state_map.begin(), pass->texture_state_map.end());
+
+			buffer_creates.insert(buffer_creates.end(), pass->buffer_creates.begin(), pass->buffer_creates.end());
+			auto& pass_buffer_destroys = async_compute ? async_buffer_destroys : buffer_destroys;
+			pass_buffer_destroys.insert(pass_buffer_destroys.end(), pass->buffer_destroys.begin(), pass->buffer_destroys.end());
+			buffer_states.insert(buffer_states.end(), pass->buffer_state_map.begin(), pass->buffer_state_map.end());
 		}
+		SortResourceIds(texture_creates);
+		SortResourceIds(buffer_creates);
+		MergeResourceStates(texture_states);
+		MergeResourceStates(buffer_states);
+	}
+
+	Bool RenderGraph::DependencyLevel::CreatesTexture(RGTextureId tex_id) const
+	{
+		return ContainsResourceId(texture_creates, tex_id);
+	}
+
+	Bool RenderGraph::DependencyLevel::CreatesBuffer(RGBufferId buf_id) const
+	{
+		return ContainsResourceId(buffer_creates, buf_id);
+	}
+
+	GfxResourceState RenderGraph::DependencyLevel::GetTextureState(RGTextureId tex_id) const
+	{
+		return FindResourceState(texture_states, tex_id);
+	}
+
+	GfxResourceState RenderGraph::DependencyLevel::GetBufferState(RGBufferId buf_id) const
+	{
+		return FindResourceState(buffer_states, buf_id);
+	}
+
+	Bool RenderGraph::DependencyLevel::IsUsedByAsyncCompute(RGTextureId tex_id) const
+	{
+		return std::any_of(async_compute_passes.begin(), async_compute_passes.end(), [tex_id](RenderGraphPassBase const* pass) { return pass->texture_state_map.contains(tex_id); });
+	}
+
+	Bool RenderGraph::DependencyLevel::IsUsedByAsyncCompute(RGBufferId buf_id) const
+	{
+		return std::any_of(async_compute_passes.begin(), async_compute_passes.end(), [buf_id](RenderGraphPassBase const* pass) { return pass->buffer_state_map.contains(buf_id); });
 	}
 
 	void RenderGraph::DependencyLevel::Execute(GfxDevice* gfx, GfxCommandList* cmd_list)
 	{
 		for (auto& pass : passes)
 		{
-			if (pass->IsCulled()) continue;
-			RenderGraphContext rg_resources(rg, *pass);
-			if (pass->type == RGPassType::Graphics)
+			if (!IsExecutedOnGraphicsQueue(pass)) continue;
+			ExecutePass(pass, cmd_list);
+		}
+	}
+
+	void RenderGraph::DependencyLevel::ExecuteAsyncCompute(GfxDevice* gfx, GfxCommandList* cmd_list)
+	{
+		for (auto& pass : async_compute_passes) ExecutePass(pass, cmd_list);
+	}
+
+	Uint64 RenderGraph::DependencyLevel::PrepareRecordingUnits(Uint64 max_cmd_lists)
+	{
+		active_passes.clear();
+		recording_units.clear();
+		Uint64 serial_pass_count = 0;
+		for (auto& pass : passes)
+		{
+			if (!IsExecutedOnGraphicsQueue(pass)) continue;
+			active_passes.push_back(pass);
+			if (!pass->IsParallel()) ++serial_pass_count;
+		}
+		if (active_passes.empty()) return 0;
+
+		Uint64 const passes_per_cmd_list = serial_pass_count > 0 ? DivideAndRoundUp(serial_pass_count, std::min(serial_pass_count, max_cmd_lists)) : 1;
+		for (Uint64 i = 0; i < active_passes.size();)
+		{
+			RenderGraphPassBase* pass = active_passes[i];
+			if (pass->IsParallel())
 			{
-				GfxRenderPassDesc render_pass_desc{};
-				render_pass_desc.flags = GfxRenderPassFlagBit_None;
-				render_pass_desc.rtv_attachments.reserve(pass->render_targets_info.size());
-				for (auto const& render_target_info : pass->render_targets_info)
+				Uint32 const work_count = pass->parallel_work_count;
+				Uint32 const range_count = (Uint32)std::min<Uint64>(DivideAndRoundUp(work_count, pass->parallel_min_batch), max_cmd_lists);
+				Uint32 const work_per_range = DivideAndRoundUp(work_count, range_count);
+				for (Uint32 j = 0; j < range_count; ++j)
 				{
-					GfxColorAttachmentDesc rtv_desc{};
+					Uint32 const begin = j * work_per_range;
+					Uint32 const end = std::min(begin + work_per_range, work_count);
+					recording_units.push_back(RecordingUnit{ i, i + 1, RGParallelRange{ begin, end, j, range_count } });
+				}
+				++i;
+				continue;
+			}
 
-					RGLoadAccessOp load_access = RGLoadAccessOp::NoAccess;
-					RGStoreAccessOp store_access = RGStoreAccessOp::NoAccess;
-					SplitAccessOp(render_target_info.render_target_access, load_access, store_access);
+			Uint64 const begin = i;
+			while (i < active_passes.size() && i - begin < passes_per_cmd_list && !active_passes[i]->IsParallel()) ++i;
+			recording_units.push_back(RecordingUnit{ begin, i, std::nullopt });
+		}
+		return recording_units.size();
+	}
 
-					switch (load_access)
-					{
-					case RGLoadAccessOp::Clear:
-						rtv_desc.beginning_access = GfxLoadAccessOp::Clear;
-						break;
-					case RGLoadAccessOp::Discard:
-						rtv_desc.beginning_access = GfxLoadAccessOp::Discard;
-						break;
-					case RGLoadAccessOp::Preserve:
-						rtv_desc.beginning_access = GfxLoadAccessOp::Preserve;
-						break;
-					case RGLoadAccessOp::NoAccess:
-						rtv_desc.beginning_access = GfxLoadAccessOp::NoAccess;
-						break;
-					default:
-						ADRIA_ASSERT_MSG(false, "Invalid Load Access!");
-					}
+	void RenderGraph::DependencyLevel::Execute(GfxDevice* gfx, std::span<GfxCommandList*> const& cmd_lists)
+	{
+		ADRIA_ASSERT(cmd_lists.size() == recording_units.size());
 
-					switch (store_access)
+		JobCounter recording_counter;
+		for (Uint64 i = 0; i < recording_units.size(); ++i)
+		{
+			GfxCommandList* cmd_list = cmd_lists[i];
+			RecordingUnit const* unit = &recording_units[i];
+			g_JobSystem.Execute([this, cmd_list, unit]()
+				{
+					if (unit->range.has_value())
 					{
-					case RGStoreAccessOp::Resolve:
-						rtv_desc.ending_access = GfxStoreAccessOp::Resolve;
-						break;
-					case RGStoreAccessOp::Discard:
-						rtv_desc.ending_access = GfxStoreAccessOp::Discard;
-						break;
-					case RGStoreAccessOp::Preserve:
-						rtv_desc.ending_access = GfxStoreAccessOp::Preserve;
-						break;
-					case RGStoreAccessOp::NoAccess:
-						rtv_desc.ending_access = GfxStoreAccessOp::NoAccess;
-						break;
-					default:
-						ADRIA_ASSERT_MSG(false, "Invalid Store Access!");
+						ExecutePass(active_passes[unit->pass_begin], cmd_list, &unit->range.value());
+						return;
 					}
+					for (Uint64 j = unit->pass_begin; j < unit->pass_end; ++j) ExecutePass(active_passes[j], cmd_list);
+				}, recording_counter);
+		}
+		g_JobSystem.Wait(recording_counter);
+	}
 
-					RGTextureId rt_texture = render_target_info.render_target_handle.GetResourceId();
-					GfxTexture* texture = rg.GetTexture(rt_texture);
+	void RenderGraph::DependencyLevel::ExecutePass(RenderGraphPassBase* pass, GfxCommandList* cmd_list, RGParallelRange const* range)
+	{
+		Timer cpu_timer;
+		RenderGraphContext rg_resources(rg, *pass);
+		Bool const first_range = !range || range->index == 0;
+		Bool const last_range = !range || range->index + 1 == range->count;
+		if (rg.breadcrumbs && first_range) rg.breadcrumbs->BeginMarker(cmd_list, (Uint32)pass->id);
+		if (pass->type == RGPassType::Graphics)
+		{
+			//a merged render pass is begun by its first pass with the store ops of its last pass and ended by the last one
+			RenderGraphPassBase const* last_merged_pass = pass;
+			while (last_merged_pass->merged_next) last_merged_pass = last_merged_pass->merged_next;
+
+			GfxRenderPassDesc local_render_pass_desc{};
+			GfxRenderPassDesc& render_pass_desc = (pass->IsMergedWithNext() && !pass->IsMergedWithPrevious()) ? rg.merged_render_pass_desc : local_render_pass_desc;
+			render_pass_desc = GfxRenderPassDesc{};
+			render_pass_desc.flags = GfxRenderPassFlagBit_None;
+			render_pass_desc.rtv_attachments.reserve(pass->render_targets_info.size());
+			for (Uint64 i = 0; i < pass->render_targets_info.size() && !pass->IsMergedWithPrevious(); ++i)
+			{
+				auto const& render_target_info = pass->render_targets_info[i];
+				GfxColorAttachmentDesc rtv_desc{};
 
-					GfxTextureDesc const& desc = texture->GetDesc();
-					GfxClearValue const& clear_value = desc.clear_value;
-					if (clear_value.active_member != GfxClearValue::GfxActiveMember::None)
-					{
-						ADRIA_ASSERT_MSG(clear_value.active_member == GfxClearValue::GfxActiveMember::Color, "Invalid Clear Value for Render Target");
-						rtv_desc.clear_value = desc.clear_value;
-						rtv_desc.clear_value.format = desc.format;
-					}
-					else if(rtv_desc.beginning_access == GfxLoadAccessOp::Clear)
-					{
-						rtv_desc.clear_value.format = desc.format;
-						rtv_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
-					}
+				RGLoadAccessOp load_access = RGLoadAccessOp::NoAccess;
+				RGStoreAccessOp store_access = RGStoreAccessOp::NoAccess;
+				SplitAccessOp(render_target_info.render_target_access, load_access, store_access);
+				store_access = GetStoreAccessOp(last_merged_pass->render_targets_info[i].render_target_access);
+				AdjustAccessOpsForRange(range, load_access, store_access);
 
-					rtv_desc.cpu_handle = rg.GetRenderTarget(render_target_info.render_target_handle);
-					render_pass_desc.rtv_attachments.push_back(rtv_desc);
+				switch (load_access)
+				{
+				case RGLoadAccessOp::Clear:
+					rtv_desc.beginning_access = GfxLoadAccessOp::Clear;
+					break;
+				case RGLoadAccessOp::Discard:
+					rtv_desc.beginning_access = GfxLoadAccessOp::Discard;
+					break;
+				case RGLoadAccessOp::Preserve:
+					rtv_desc.beginning_access = GfxLoadAccessOp::Preserve;
+					break;
+				case RGLoadAccessOp::NoAccess:
+					rtv_desc.beginning_access = GfxLoadAccessOp::NoAccess;
+					break;
+				default:
+					ADRIA_ASSERT_MSG(false, "Invalid Load Access!");
 				}
 
-				if (pass->depth_stencil.has_value())
+				switch (store_access)
 				{
-					auto const& depth_stencil_info = pass->depth_stencil.value();
-					if (depth_stencil_info.depth_read_only)
-					{
-						render_pass_desc.flags |= GfxRenderPassFlagBit_ReadOnlyDepth;
-					}
-					
-					GfxDepthAttachmentDesc dsv_desc{};
-					RGLoadAccessOp load_access = RGLoadAccessOp::NoAccess;
-					RGStoreAccessOp store_access = RGStoreAccessOp::NoAccess;
-					SplitAccessOp(depth_stencil_info.depth_access, load_access, store_access);
+				case RGStoreAccessOp::Resolve:
+					rtv_desc.ending_access = GfxStoreAccessOp::Resolve;
+					break;
+				case RGStoreAccessOp::Discard:
+					rtv_desc.ending_access = GfxStoreAccessOp::Discard;
+					break;
+				case RGStoreAccessOp::Preserve:
+					rtv_desc.ending_access = GfxStoreAccessOp::Preserve;
+					break;
+				case RGStoreAccessOp::NoAccess:
+					rtv_desc.ending_access = GfxStoreAccessOp::NoAccess;
+					break;
+				default:
+					ADRIA_ASSERT_MSG(false, "Invalid Store Access!");
+				}
 
-					switch (load_access)
-					{
-					case RGLoadAccessOp::Clear:
-						dsv_desc.depth_beginning_access = GfxLoadAccessOp::Clear;
-						break;
-					case RGLoadAccessOp::Discard:
-						dsv_desc.depth_beginning_access = GfxLoadAccessOp::Discard;
-						break;
-					case RGLoadAccessOp::Preserve:
-						dsv_desc.depth_beginning_access = GfxLoadAccessOp::Preserve;
-						break;
-					case RGLoadAccessOp::NoAccess:
-						dsv_desc.depth_beginning_access = GfxLoadAccessOp::NoAccess;
-						break;
-					default:
-						ADRIA_ASSERT_MSG(false, "Invalid Load Access!");
-					}
+				RGTextureId rt_texture = render_target_info.render_target_handle.GetResourceId();
+				GfxTexture* texture = rg.GetTexture(rt_texture);
 
-					switch (store_access)
-					{
-					case RGStoreAccessOp::Resolve:
-						dsv_desc.depth_ending_access = GfxStoreAccessOp::Resolve;
-						break;
-					case RGStoreAccessOp::Discard:
-						dsv_desc.depth_ending_access = GfxStoreAccessOp::Discard;
-						break;
-					case RGStoreAccessOp::Preserve:
-						dsv_desc.depth_ending_access = GfxStoreAccessOp::Preserve;
-						break;
-					case RGStoreAccessOp::NoAccess:
-						dsv_desc.depth_ending_access = GfxStoreAccessOp::NoAccess;
-						break;
-					default:
-						ADRIA_ASSERT_MSG(false, "Invalid Store Access!");
-					}
+				GfxTextureDesc const& desc = texture->GetDesc();
+				GfxClearValue const& clear_value = desc.clear_value;
+				if (clear_value.active_member != GfxClearValue::GfxActiveMember::None)
+				{
+					ADRIA_ASSERT_MSG(clear_value.active_member == GfxClearValue::GfxActiveMember::Color, "Invalid Clear Value for Render Target");
+					rtv_desc.clear_value = desc.clear_value;
+					rtv_desc.clear_value.format = desc.format;
+				}
+				else if(rtv_desc.beginning_access == GfxLoadAccessOp::Clear)
+				{
+					rtv_desc.clear_value.format = desc.format;
+					rtv_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+				}
 
-					RGTextureId ds_texture = depth_stencil_info.depth_stencil_handle.GetResourceId();
-					GfxTexture* texture = rg.GetTexture(ds_texture);
+				rtv_desc.cpu_handle = rg.GetRenderTarget(render_target_info.render_target_handle);
+				render_pass_desc.rtv_attachments.push_back(rtv_desc);
+			}
 
-					GfxTextureDesc const& desc = texture->GetDesc();
-					if (desc.clear_value.active_member != GfxClearValue::GfxActiveMember::None)
-					{
-						ADRIA_ASSERT_MSG(desc.clear_value.active_member == GfxClearValue::GfxActiveMember::DepthStencil, "Invalid Clear Value for Depth Stencil");
-						dsv_desc.clear_value = desc.clear_value;
-						dsv_desc.clear_value.format = desc.format;
-					}
-					else if (dsv_desc.depth_beginning_access == GfxLoadAccessOp::Clear)
-					{
-						dsv_desc.clear_value.format = desc.format;
-						dsv_desc.clear_value = GfxClearValue(0.0f, 0);
-					}
+			if (pass->depth_stencil.has_value() && !pass->IsMergedWithPrevious())
+			{
+				auto const& depth_stencil_info = pass->depth_stencil.value();
+				if (depth_stencil_info.depth_read_only)
+				{
+					render_pass_desc.flags |= GfxRenderPassFlagBit_ReadOnlyDepth;
+				}
+				
+				GfxDepthAttachmentDesc dsv_desc{};
+				RGLoadAccessOp load_access = RGLoadAccessOp::NoAccess;
+				RGStoreAccessOp store_access = RGStoreAccessOp::NoAccess;
+				SplitAccessOp(depth_stencil_info.depth_access, load_access, store_access);
+				store_access = GetStoreAccessOp(last_merged_pass->depth_stencil->depth_access);
+				AdjustAccessOpsForRange(range, load_access, store_access);
+
+				switch (load_access)
+				{
+				case RGLoadAccessOp::Clear:
+					dsv_desc.depth_beginning_access = GfxLoadAccessOp::Clear;
+					break;
+				case RGLoadAccessOp::Discard:
+					dsv_desc.depth_beginning_access = GfxLoadAccessOp::Discard;
+					break;
+				case RGLoadAccessOp::Preserve:
+					dsv_desc.depth_beginning_access = GfxLoadAccessOp::Preserve;
+					break;
+				case RGLoadAccessOp::NoAccess:
+					dsv_desc.depth_beginning_access = GfxLoadAccessOp::NoAccess;
+					break;
+				default:
+					ADRIA_ASSERT_MSG(false, "Invalid Load Access!");
+				}
+
+				switch (store_access)
+				{
+				case RGStoreAccessOp::Resolve:
+					dsv_desc.depth_ending_access = GfxStoreAccessOp::Resolve;
+					break;
+				case RGStoreAccessOp::Discard:
+					dsv_desc.depth_ending_access = GfxStoreAccessOp::Discard;
+					break;
+				case RGStoreAccessOp::Preserve:
+					dsv_desc.depth_ending_access = GfxStoreAccessOp::Preserve;
+					break;
+				case RGStoreAccessOp::NoAccess:
+					dsv_desc.depth_ending_access = GfxStoreAccessOp::NoAccess;
+					break;
+				default:
+					ADRIA_ASSERT_MSG(false, "Invalid Store Access!");
+				}
 
-					dsv_desc.cpu_handle = rg.GetDepthStencil(depth_stencil_info.depth_stencil_handle);
+				RGTextureId ds_texture = depth_stencil_info.depth_stencil_handle.GetResourceId();
+				GfxTexture* texture = rg.GetTexture(ds_texture);
 
-					//todo add stencil
-					render_pass_desc.dsv_attachment = dsv_desc;
+				GfxTextureDesc const& desc = texture->GetDesc();
+				if (desc.clear_value.active_member != GfxClearValue::GfxActiveMember::None)
+				{
+					ADRIA_ASSERT_MSG(desc.clear_value.active_member == GfxClearValue::GfxActiveMember::DepthStencil, "Invalid Clear Value for Depth Stencil");
+					dsv_desc.clear_value = desc.clear_value;
+					dsv_desc.clear_value.format = desc.format;
 				}
-				ADRIA_ASSERT_MSG((pass->viewport_width != 0 && pass->viewport_height != 0), "Viewport Width/Height is 0! The call to builder.SetViewport is probably missing...");
-				render_pass_desc.width = pass->viewport_width;
-				render_pass_desc.height = pass->viewport_height;
-				render_pass_desc.legacy = pass->UseLegacyRenderPasses();
-
-				PIXScopedEvent(cmd_list->GetNative(), PIX_COLOR_DEFAULT, pass->name.c_str());
-				AdriaGfxProfileScope(cmd_list, pass->name.c_str());
-				TracyGfxProfileScope(cmd_list->GetNative(), pass->name.c_str());
-				cmd_list->SetContext(GfxCommandList::Context::Graphics);
-				cmd_list->BeginRenderPass(render_pass_desc);
-				pass->Execute(rg_resources,cmd_list);
-				cmd_list->EndRenderPass();
-			}
-			else
-			{
-				PIXScopedEvent(cmd_list->GetNative(), PIX_COLOR_DEFAULT, pass->name.c_str());
-				AdriaGfxProfileScope(cmd_list, pass->name.c_str());
-				TracyGfxProfileScope(cmd_list->GetNative(), pass->name.c_str());
-				cmd_list->SetContext(GfxCommandList::Context::Compute);
-				pass->Execute(rg_resources, cmd_list);
+				else if (dsv_desc.depth_beginning_access == GfxLoadAccessOp::Clear)
+				{
+					dsv_desc.clear_value.format = desc.format;
+					dsv_desc.clear_value = GfxClearValue(0.0f, 0);
+				}
+
+				dsv_desc.cpu_handle = rg.GetDepthStencil(depth_stencil_info.depth_stencil_handle);
+
+				//todo add stencil
+				render_pass_desc.dsv_attachment = dsv_desc;
 			}
+			ADRIA_ASSERT_MSG((pass->viewport_width != 0 && pass->viewport_height != 0), "Viewport Width/Height is 0! The call to builder.SetViewport is probably missing...");
+			render_pass_desc.width = pass->viewport_width;
+			render_pass_desc.height = pass->viewport_height;
+			render_pass_desc.legacy = pass->UseLegacyRenderPasses();
+
+			PIXScopedEvent(cmd_list->GetNative(), PIX_COLOR_DEFAULT, pass->name);
+			AdriaGfxProfileCondScope(cmd_list, pass->name, first_range);
+			TracyGfxQueueProfileScope(cmd_list->GetType(), cmd_list->GetNative(), pass->name);
+			cmd_list->SetContext(GfxCommandList::Context::Graphics);
+			if (pass->IsPredicated()) cmd_list->SetPredication(rg.GetRGBuffer(pass->predication_buffer)->resource, pass->predication_offset);
+			if (!pass->IsMergedWithPrevious()) cmd_list->BeginRenderPass(render_pass_desc);
+			if (range) pass->ExecuteRange(rg_resources, cmd_list, *range);
+			else pass->Execute(rg_resources, cmd_list);
+			if (!pass->IsMergedWithNext()) cmd_list->EndRenderPass();
+			if (pass->IsPredicated()) cmd_list->SetPredication(nullptr);
 		}
-	}
-
-	void RenderGraph::DependencyLevel::Execute(GfxDevice* gfx, std::span<GfxCommandList*> const& cmd_lists)
-	{
-		ADRIA_ASSERT_MSG(false, "Not yet implemented");
+		else
+		{
+			PIXScopedEvent(cmd_list->GetNative(), PIX_COLOR_DEFAULT, pass->name);
+			AdriaGfxProfileCondScope(cmd_list, pass->name, first_range);
+			TracyGfxQueueProfileScope(cmd_list->GetType(), cmd_list->GetNative(), pass->name);
+			cmd_list->SetContext(GfxCommandList::Context::Compute);
+			if (pass->IsPredicated()) cmd_list->SetPredication(rg.GetRGBuffer(pass->predication_buffer)->resource, pass->predication_offset);
+			if (range) pass->ExecuteRange(rg_resources, cmd_list, *range);
+			else pass->Execute(rg_resources, cmd_list);
+			if (pass->IsPredicated()) cmd_list->SetPredication(nullptr);
+		}
+		if (rg.breadcrumbs && last_range) rg.breadcrumbs->EndMarker(cmd_list, (Uint32)pass->id);
+		if (first_range) pass->cpu_time_ms = cpu_timer.Elapsed() / 1000.0f;
 	}
 
 	void RenderGraph::Dump(Char const* graph_file_name)
@@ -1115,6 +2021,7 @@ namespace adria
 				{
 					Char const* executed{ "orange" };
 					Char const* culled{ "lightgray" };
+					Char const* critical{ "red" };
 				} pass;
 				struct
 				{
@@ -1139,26 +2046,42 @@ namespace adria
 		graphviz.defaults += std::format("graph [style=invis, rankdir=\"{}\", ordering=out, splines=spline]\n", style.rank_dir);
 		graphviz.defaults += std::format("node [shape=record, fontname=\"{}\", fontsize={}, margin=\"0.2,0.03\"]\n", style.font.name, style.font.size);
 
+		DumpStatistics const stats = CollectDumpStatistics();
+		auto HeatColor = [](Float heat)
+		{
+			return std::format("\"{:.3f} 0.6 1.0\"", 0.33f * (1.0f - std::clamp(heat, 0.0f, 1.0f)));
+		};
+		auto LifetimeToString = [](std::pair<Uint64, Uint64> const& lifetime)
+		{
+			return lifetime.first > lifetime.second ? std::string("unused") : std::format("levels {} - {}", lifetime.first, lifetime.second);
+		};
+		auto AllocationToString = [](RGResource const* resource)
+		{
+			if (resource->imported) return "Imported";
+			if (resource->aliased) return resource->pooled ? "Transient (aliased, pooled)" : "Transient (aliased)";
+			return resource->pooled ? "Transient (pooled)" : "Transient";
+		};
+
 		auto PairHash = [](std::pair<Uint64, Uint64> const& p)
 		{
 			return std::hash<Uint64>{}(p.first) + std::hash<Uint64>{}(p.second);
 		};
 		std::unordered_set<std::pair<Uint64, Uint64>, decltype(PairHash)> declared_buffers;
 		std::unordered_set<std::pair<Uint64, Uint64>, decltype(PairHash)> declared_textures;
-		auto DeclareBuffer  = [&declared_buffers,&graphviz, this](RGBuffer* buffer)
+		auto DeclareBuffer  = [&](RGBuffer* buffer)
 		{
 			auto decl_pair = std::make_pair(buffer->id, buffer->version);
 			if (!declared_buffers.contains(decl_pair))
 			{
-				buffer->desc.size;
 				graphviz.declarations += std::format("B{}_{} ", buffer->id, buffer->version);
-				std::string label = std::format("<{}<br/>dimension: Buffer<br/>size: {} bytes <br/>format: {} <br/>version: {} <br/>refs: {}<br/>{}>", 
-					buffer->name, buffer->desc.size, GfxFormatToString(buffer->desc.format), buffer->version, buffer->ref_count, buffer->imported ? "Imported" : "Transient");
-				graphviz.declarations += std::format("[shape=\"box\", style=\"filled\",fillcolor={}, label={}] \n", buffer->imported ? style.color.resource.imported : style.color.resource.transient, label);
+				std::string label = std::format("<{}<br/>dimension: Buffer<br/>size: {} bytes <br/>format: {} <br/>version: {} <br/>refs: {}<br/>lifetime: {}<br/>{}>", 
+					buffer->name, buffer->desc.size, GfxFormatToString(buffer->desc.format), buffer->version, buffer->ref_count, LifetimeToString(stats.buffer_lifetimes[buffer->id]), AllocationToString(buffer));
+				std::string const fill_color = buffer->imported ? style.color.resource.imported : HeatColor((Float)buffer->desc.size / std::max<Uint64>(stats.max_resource_size, 1));
+				graphviz.declarations += std::format("[shape=\"box\", style=\"filled\",fillcolor={}, label={}] \n", fill_color, label);
 				declared_buffers.insert(decl_pair);
 			}
 		};
-		auto DeclareTexture = [&declared_textures, &graphviz, this](RGTexture* texture)
+		auto DeclareTexture = [&](RGTexture* texture)
 		{
 			auto decl_pair = std::make_pair(texture->id, texture->version);
 			if (!declared_textures.contains(decl_pair))
@@ -1174,9 +2097,12 @@ namespace adria
 				if (texture->desc.array_size > 1)  dimensions += std::format(", array size = {}", texture->desc.array_size);
 				
 				graphviz.declarations += std::format("T{}_{} ", texture->id, texture->version);
-				std::string label = std::format("<{} <br/>dimension: {}<br/>{}<br/>format: {} <br/>version: {} <br/>refs: {}<br/>{}>", 
-					texture->name, GfxTextureTypeToString(texture->desc.type), dimensions, GfxFormatToString(texture->desc.format), texture->version, texture->ref_count, texture->imported ? "Imported" : "Transient");
-				graphviz.declarations += std::format("[shape=\"box\", style=\"filled\",fillcolor={}, label={}] \n", texture->imported ? style.color.resource.imported : style.color.resource.transient, label);
+				Uint64 const texture_size = stats.texture_sizes[texture->id];
+				std::string label = std::format("<{} <br/>dimension: {}<br/>{}<br/>format: {} <br/>size: {:.2f} MB<br/>version: {} <br/>refs: {}<br/>lifetime: {}<br/>{}>", 
+					texture->name, GfxTextureTypeToString(texture->desc.type), dimensions, GfxFormatToString(texture->desc.format), texture_size / (1024.0 * 1024.0), texture->version, texture->ref_count,
+					LifetimeToString(stats.texture_lifetimes[texture->id]), AllocationToString(texture));
+				std::string const fill_color = texture->imported ? style.color.resource.imported : HeatColor((Float)texture_size / std::max<Uint64>(stats.max_resource_size, 1));
+				graphviz.declarations += std::format("[shape=\"box\", style=\"filled\",fillcolor={}, label={}] \n", fill_color, label);
 				declared_textures.insert(decl_pair);
 			}
 		};
@@ -1186,9 +2112,12 @@ namespace adria
 			for (auto const& pass : dependency_level.passes)
 			{
 				graphviz.declarations += std::format("P{} ", pass->id);
-				std::string label = std::format("<{}<br/> type: {}<br/> refs: {}<br/> culled: {}>", pass->name, RGPassTypeToString(pass->type), pass->ref_count, pass->IsCulled() ? "Yes" : "No");
-				graphviz.declarations += std::format("[shape=\"ellipse\", style=\"rounded,filled\",fillcolor={}, label={}] \n",
-					                                  pass->IsCulled() ?  style.color.pass.culled : style.color.pass.executed, label);
+				std::string label = std::format("<{}<br/> type: {}<br/> refs: {}<br/> culled: {}<br/> level: {}<br/> cpu: {:.3f} ms<br/> gpu: {:.3f} ms>", 
+					pass->name, RGPassTypeToString(pass->type), pass->ref_count, pass->IsCulled() ? "Yes" : "No", stats.pass_levels[pass->id], pass->cpu_time_ms, stats.pass_gpu_times[pass->id]);
+				std::string fill_color = pass->IsCulled() ? style.color.pass.culled : style.color.pass.executed;
+				if (!pass->IsCulled() && stats.max_pass_gpu_time > 0.0f) fill_color = HeatColor(stats.pass_gpu_times[pass->id] / stats.max_pass_gpu_time);
+				std::string const outline = stats.pass_critical[pass->id] ? std::format("color={}, penwidth=3, ", style.color.pass.critical) : "";
+				graphviz.declarations += std::format("[shape=\"ellipse\", style=\"rounded,filled\", {}fillcolor={}, label={}] \n", outline, fill_color, label);
 
 				std::string read_dependencies = "{"; 
 				std::string write_dependencies = "{";
@@ -1247,6 +2176,292 @@ namespace adria
 		system(cmd.c_str());
 	}
 
+	void RenderGraph::DumpTimeline(Char const* timeline_file_name)
+	{
+		DumpStatistics const stats = CollectDumpStatistics();
+		std::vector<RGPassTiming> const& pass_timings = g_RenderGraphProfiler.GetPassTimings();
+
+		json timeline;
+		timeline["critical_path_gpu_ms"] = stats.critical_path_gpu_time;
+		timeline["transient_heap_size"] = pool.GetTransientHeapSize();
+
+		Uint64 peak_level = 0;
+		json levels = json::array();
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			json level;
+			level["index"] = i;
+			level["transient_memory"] = stats.level_transient_memory[i];
+			level["passes"] = json::array();
+			for (RenderGraphPassBase const* pass : dependency_levels[i].passes) level["passes"].push_back(pass->name);
+			levels.push_back(std::move(level));
+			if (stats.level_transient_memory[i] > stats.level_transient_memory[peak_level]) peak_level = i;
+		}
+		timeline["levels"] = std::move(levels);
+		timeline["peak_transient_memory"] = stats.level_transient_memory.empty() ? 0 : stats.level_transient_memory[peak_level];
+		timeline["peak_transient_memory_level"] = peak_level;
+
+		json passes_json = json::array();
+		for (Uint64 i = 0; i < passes.size(); ++i)
+		{
+			RenderGraphPassBase const* pass = passes[i].get();
+			json pass_json;
+			pass_json["name"] = pass->name;
+			pass_json["group"] = pass->group;
+			pass_json["type"] = RGPassTypeToString(pass->type);
+			pass_json["level"] = stats.pass_levels[i];
+			pass_json["cpu_ms"] = pass->cpu_time_ms;
+			pass_json["gpu_ms"] = stats.pass_gpu_times[i];
+			pass_json["culled"] = pass->IsCulled();
+			pass_json["async_compute"] = i < pass_timings.size() && pass_timings[i].async_compute;
+			pass_json["critical_path"] = (Bool)stats.pass_critical[i];
+			passes_json.push_back(std::move(pass_json));
+		}
+		timeline["passes"] = std::move(passes_json);
+
+		auto ResourceToJson = [](RGResource const* resource, Uint64 size, std::pair<Uint64, Uint64> const& lifetime)
+		{
+			json resource_json;
+			resource_json["name"] = resource->name;
+			resource_json["imported"] = resource->imported;
+			resource_json["size"] = size;
+			resource_json["aliased"] = resource->aliased;
+			resource_json["pooled"] = resource->pooled;
+			if (lifetime.first <= lifetime.second)
+			{
+				resource_json["first_level"] = lifetime.first;
+				resource_json["last_level"] = lifetime.second;
+			}
+			return resource_json;
+		};
+		json textures_json = json::array();
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			textures_json.push_back(ResourceToJson(textures[i].get(), stats.texture_sizes[i], stats.texture_lifetimes[i]));
+		}
+		timeline["textures"] = std::move(textures_json);
+		json buffers_json = json::array();
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
+			buffers_json.push_back(ResourceToJson(buffers[i].get(), buffers[i]->desc.size, stats.buffer_lifetimes[i]));
+		}
+		timeline["buffers"] = std::move(buffers_json);
+		if (!lint_warnings.empty()) timeline["lint"] = lint_warnings;
+
+		std::ofstream timeline_file(paths::RenderGraphDir + timeline_file_name);
+		timeline_file << timeline.dump(4);
+	}
+
+	RenderGraph::DumpStatistics RenderGraph::CollectDumpStatistics() const
+	{
+		DumpStatistics stats{};
+		stats.pass_levels.resize(passes.size(), 0);
+		stats.pass_gpu_times.resize(passes.size(), 0.0f);
+		stats.pass_critical.resize(passes.size(), false);
+		stats.texture_lifetimes.resize(textures.size(), { UINT64_MAX, 0 });
+		stats.buffer_lifetimes.resize(buffers.size(), { UINT64_MAX, 0 });
+		stats.texture_sizes.resize(textures.size(), 0);
+		stats.level_transient_memory.resize(dependency_levels.size(), 0);
+
+		std::vector<RGPassTiming> const& pass_timings = g_RenderGraphProfiler.GetPassTimings();
+		for (Uint64 i = 0; i < passes.size() && i < pass_timings.size(); ++i)
+		{
+			stats.pass_gpu_times[i] = pass_timings[i].gpu_time_ms;
+			stats.max_pass_gpu_time = std::max(stats.max_pass_gpu_time, pass_timings[i].gpu_time_ms);
+		}
+
+		auto ExtendLifetime = [](std::pair<Uint64, Uint64>& lifetime, Uint64 level)
+		{
+			lifetime.first = std::min(lifetime.first, level);
+			lifetime.second = std::max(lifetime.second, level);
+		};
+		for (Uint64 i = 0; i < dependency_levels.size(); ++i)
+		{
+			for (RenderGraphPassBase const* pass : dependency_levels[i].passes)
+			{
+				stats.pass_levels[pass->id] = i;
+				if (pass->IsCulled()) continue;
+				for (RGTextureId tex_id : pass->texture_reads)  ExtendLifetime(stats.texture_lifetimes[tex_id.id], i);
+				for (RGTextureId tex_id : pass->texture_writes) ExtendLifetime(stats.texture_lifetimes[tex_id.id], i);
+				for (RGBufferId buf_id : pass->buffer_reads)    ExtendLifetime(stats.buffer_lifetimes[buf_id.id], i);
+				for (RGBufferId buf_id : pass->buffer_writes)   ExtendLifetime(stats.buffer_lifetimes[buf_id.id], i);
+			}
+		}
+
+		auto AccumulateTransientMemory = [&stats](std::pair<Uint64, Uint64> const& lifetime, Uint64 size)
+		{
+			if (lifetime.first > lifetime.second) return;
+			for (Uint64 level = lifetime.first; level <= lifetime.second; ++level) stats.level_transient_memory[level] += size;
+		};
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			stats.texture_sizes[i] = GfxTexture::GetAllocationInfo(gfx, textures[i]->desc).size;
+			stats.max_resource_size = std::max(stats.max_resource_size, stats.texture_sizes[i]);
+			if (!textures[i]->imported) AccumulateTransientMemory(stats.texture_lifetimes[i], stats.texture_sizes[i]);
+		}
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
+			stats.max_resource_size = std::max(stats.max_resource_size, buffers[i]->desc.size);
+			if (!buffers[i]->imported) AccumulateTransientMemory(stats.buffer_lifetimes[i], buffers[i]->desc.size);
+		}
+
+		std::vector<Float> path_times(passes.size(), 0.0f);
+		std::vector<Uint64> next_passes(passes.size(), UINT64_MAX);
+		for (auto it = topologically_sorted_passes.rbegin(); it != topologically_sorted_passes.rend(); ++it)
+		{
+			Uint64 const pass_index = *it;
+			if (passes[pass_index]->IsCulled()) continue;
+			Float longest_successor_path = 0.0f;
+			for (Uint64 successor : adjacency_lists[pass_index])
+			{
+				if (path_times[successor] > longest_successor_path)
+				{
+					longest_successor_path = path_times[successor];
+					next_passes[pass_index] = successor;
+				}
+			}
+			path_times[pass_index] = stats.pass_gpu_times[pass_index] + longest_successor_path;
+		}
+
+		auto critical_path_start = std::max_element(path_times.begin(), path_times.end());
+		if (critical_path_start != path_times.end() && *critical_path_start > 0.0f)
+		{
+			stats.critical_path_gpu_time = *critical_path_start;
+			for (Uint64 pass_index = std::distance(path_times.begin(), critical_path_start); pass_index != UINT64_MAX; pass_index = next_passes[pass_index])
+			{
+				stats.pass_critical[pass_index] = true;
+			}
+		}
+		return stats;
+	}
+
+	void RenderGraph::LintGraph()
+	{
+		static GfxResourceState const WriteStates = GfxResourceState::RTV | GfxResourceState::DSV | GfxResourceState::AllUAV | GfxResourceState::ClearUAV | GfxResourceState::CopyDst | GfxResourceState::ASWrite;
+		static GfxResourceState const ComputeQueueStates = GfxResourceState::Common | GfxResourceState::AllCompute | GfxResourceState::ClearUAV | GfxResourceState::AllCopy | GfxResourceState::IndirectArgs | GfxResourceState::AllAS | GfxResourceState::Predication;
+		//the same warnings come up every frame, each one is logged once
+		static std::unordered_set<Uint64> reported_warnings;
+
+		lint_warnings.clear();
+		auto Warn = [this](std::string&& warning)
+		{
+			if (reported_warnings.insert(crc64(warning.c_str(), warning.size())).second) ADRIA_LOG(WARNING, "[RenderGraph] %s", warning.c_str());
+			lint_warnings.push_back(std::move(warning));
+		};
+		DumpStatistics const stats = CollectDumpStatistics();
+		Uint64 const level_count = dependency_levels.size();
+
+		//A->B->A between read only states in consecutive levels, one combined read state would avoid both barriers
+		auto LintTransitions = [&](Char const* resource_name, auto GetLevelState)
+		{
+			GfxResourceState states[3] = { GfxResourceState::None, GfxResourceState::None, GfxResourceState::None };
+			for (Uint64 i = 0; i < level_count; ++i)
+			{
+				states[0] = states[1];
+				states[1] = states[2];
+				states[2] = GetLevelState(dependency_levels[i]);
+				if (states[0] == GfxResourceState::None || states[1] == GfxResourceState::None || states[2] == GfxResourceState::None) continue;
+				if (states[0] != states[2] || states[0] == states[1]) continue;
+				if (HasAnyFlag(states[0], WriteStates) || HasAnyFlag(states[1], WriteStates)) continue;
+				Warn(std::format("Redundant transitions of {} in levels {} - {}: {} -> {} -> {}", resource_name, i - 2, i,
+					ConvertBarrierFlagsToString(states[0]), ConvertBarrierFlagsToString(states[1]), ConvertBarrierFlagsToString(states[2])));
+			}
+		};
+		for (auto const& texture : textures)
+		{
+			LintTransitions(texture->name, [&](DependencyLevel const& level) { return level.GetTextureState(RGTextureId(texture->id)); });
+		}
+		for (auto const& buffer : buffers)
+		{
+			LintTransitions(buffer->name, [&](DependencyLevel const& level) { return level.GetBufferState(RGBufferId(buffer->id)); });
+		}
+
+		std::vector<Bool> texture_read(textures.size(), false), texture_written(textures.size(), false);
+		std::vector<Bool> buffer_read(buffers.size(), false), buffer_written(buffers.size(), false);
+		for (auto const& pass : passes)
+		{
+			if (pass->IsCulled()) continue;
+			for (RGTextureId tex_id : pass->texture_reads)  texture_read[tex_id.id] = true;
+			for (RGTextureId tex_id : pass->texture_writes) texture_written[tex_id.id] = true;
+			for (RGBufferId buf_id : pass->buffer_reads)    buffer_read[buf_id.id] = true;
+			for (RGBufferId buf_id : pass->buffer_writes)   buffer_written[buf_id.id] = true;
+		}
+
+		//imported resources are read by later frames or outside of the graph, only transients are checked
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			RGTexture const* texture = textures[i].get();
+			if (texture->imported) continue;
+			if (texture_written[i] && !texture_read[i]) Warn(std::format("Texture {} is written but never read", texture->name));
+			std::pair<Uint64, Uint64> const& lifetime = stats.texture_lifetimes[i];
+			if (level_count > 2 && lifetime.first == 0 && lifetime.second == level_count - 1)
+			{
+				Warn(std::format("Transient texture {} ({:.2f} MB) is alive for the whole frame", texture->name, stats.texture_sizes[i] / (1024.0 * 1024.0)));
+			}
+		}
+		for (Uint64 i = 0; i < buffers.size(); ++i)
+		{
+			RGBuffer const* buffer = buffers[i].get();
+			if (buffer->imported) continue;
+			if (buffer_written[i] && !buffer_read[i]) Warn(std::format("Buffer {} is written but never read", buffer->name));
+			std::pair<Uint64, Uint64> const& lifetime = stats.buffer_lifetimes[i];
+			if (level_count > 2 && lifetime.first == 0 && lifetime.second == level_count - 1)
+			{
+				Warn(std::format("Transient buffer {} ({} bytes) is alive for the whole frame", buffer->name, buffer->desc.size));
+			}
+		}
+
+		//a compute pass that shares its level with graphics work and only uses states the compute queue supports could overlap with it
+		for (DependencyLevel const& level : dependency_levels)
+		{
+			Bool const has_graphics_work = std::any_of(level.passes.begin(), level.passes.end(), [](RenderGraphPassBase const* pass) { return !pass->IsCulled() && pass->type == RGPassType::Graphics; });
+			if (!has_graphics_work) continue;
+			for (RenderGraphPassBase const* pass : level.passes)
+			{
+				if (pass->IsCulled() || pass->type != RGPassType::Compute) continue;
+				Bool const compute_queue_states = std::all_of(pass->texture_state_map.begin(), pass->texture_state_map.end(), [](auto const& state) { return !HasAnyFlag(state.second, ~ComputeQueueStates); }) &&
+												  std::all_of(pass->buffer_state_map.begin(), pass->buffer_state_map.end(), [](auto const& state) { return !HasAnyFlag(state.second, ~ComputeQueueStates); });
+				if (compute_queue_states) Warn(std::format("Compute pass {} runs next to graphics work and could be ComputeAsync", pass->name));
+			}
+		}
+
+		//the extent a pass works at is its viewport, or its largest written texture for passes without one
+		auto GetPassExtent = [this](RenderGraphPassBase const* pass)
+		{
+			if (pass->viewport_width > 0) return std::make_pair(pass->viewport_width, pass->viewport_height);
+			std::pair<Uint32, Uint32> extent(0, 0);
+			for (RGTextureId tex_id : pass->texture_writes)
+			{
+				RGTextureDesc const& desc = GetRGTexture(tex_id)->desc;
+				extent.first = std::max(extent.first, desc.width);
+				extent.second = std::max(extent.second, desc.height);
+			}
+			return extent;
+		};
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			RGTexture const* texture = textures[i].get();
+			if (texture->imported || !texture_read[i] || texture->desc.type != GfxTextureType_2D || texture->desc.mip_levels > 1) continue;
+			if (texture->desc.width < 4 || texture->desc.height < 4) continue;
+
+			Bool only_half_resolution = true;
+			for (auto const& pass : passes)
+			{
+				if (pass->IsCulled() || !pass->texture_reads.contains(RGTextureId(i))) continue;
+				auto const [width, height] = GetPassExtent(pass.get());
+				if (width == 0 || width * 2 > texture->desc.width || height * 2 > texture->desc.height)
+				{
+					only_half_resolution = false;
+					break;
+				}
+			}
+			if (only_half_resolution)
+			{
+				Warn(std::format("Texture {} ({}x{}) is only read by passes working at half resolution or lower", texture->name, texture->desc.width, texture->desc.height));
+			}
+		}
+	}
+
 	void RenderGraph::DumpDebugData()
 	{
 		std::string render_graph_data = "";
@@ -1291,12 +2506,12 @@ namespace adria
 			render_graph_data += std::format("Dependency level {}: \n", i);
 			for(auto pass : level.passes) render_graph_data += std::format("{}\n", pass->name);
 			render_graph_data += "\nTexture usage:\n";
-			for (auto [tex_id, state] : level.texture_state_map)
+			for (auto [tex_id, state] : level.texture_states)
 			{
 				render_graph_data += std::format("Texture ID: {}, State: {}\n", tex_id.id, ConvertBarrierFlagsToString(state));
 			}
 			render_graph_data += "\nBuffer usage:\n";
-			for (auto [buf_id, state] : level.buffer_state_map)
+			for (auto [buf_id, state] : level.buffer_states)
 			{
 				render_graph_data += std::format("Buffer ID: {}, State: {}\n", buf_id.id, ConvertBarrierFlagsToString(state));
 			}
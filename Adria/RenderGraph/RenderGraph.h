@@ -3,7 +3,9 @@
 #include "RenderGraphBlackboard.h"
 #include "RenderGraphBuilder.h"
 #include "RenderGraphResourcePool.h"
+#include "RenderGraphCache.h"
 #include "Graphics/GfxDevice.h"
+#include "Graphics/GfxRenderPass.h"
 
 namespace adria
 {
@@ -22,26 +24,80 @@ namespace adria
 			void Setup();
 			void Execute(GfxDevice* gfx, GfxCommandList* cmd_list);
 			void Execute(GfxDevice* gfx, std::span<GfxCommandList*> const& cmd_lists);
+			void ExecuteAsyncCompute(GfxDevice* gfx, GfxCommandList* cmd_list);
+			Uint64 GetActivePassCount() const;
+			Uint64 PrepareRecordingUnits(Uint64 max_cmd_lists);
+			Bool HasAsyncComputePasses() const { return !async_compute_passes.empty(); }
+
+		private:
+			struct RecordingUnit
+			{
+				Uint64 pass_begin;
+				Uint64 pass_end;
+				std::optional<RGParallelRange> range;
+			};
+
+			void ExecutePass(RenderGraphPassBase* pass, GfxCommandList* cmd_list, RGParallelRange const* range = nullptr);
+			Bool IsExecutedOnGraphicsQueue(RenderGraphPassBase const* pass) const;
+
+			Bool CreatesTexture(RGTextureId tex_id) const;
+			Bool CreatesBuffer(RGBufferId buf_id) const;
+			GfxResourceState GetTextureState(RGTextureId tex_id) const;
+			GfxResourceState GetBufferState(RGBufferId buf_id) const;
+			Bool IsUsedByAsyncCompute(RGTextureId tex_id) const;
+			Bool IsUsedByAsyncCompute(RGBufferId buf_id) const;
 
 		private:
 			RenderGraph& rg;
 			std::vector<RenderGraphPassBase*> passes;
-			std::unordered_set<RGTextureId> texture_creates;
-			std::unordered_set<RGTextureId> texture_reads;
-			std::unordered_set<RGTextureId> texture_writes;
-			std::unordered_set<RGTextureId> texture_destroys;
-			std::unordered_map<RGTextureId, GfxResourceState> texture_state_map;
-
-			std::unordered_set<RGBufferId> buffer_creates;
-			std::unordered_set<RGBufferId> buffer_reads;
-			std::unordered_set<RGBufferId> buffer_writes;
-			std::unordered_set<RGBufferId> buffer_destroys;
-			std::unordered_map<RGBufferId, GfxResourceState> buffer_state_map;
+			std::vector<RenderGraphPassBase*> active_passes;
+			std::vector<RecordingUnit> recording_units;
+			std::vector<RenderGraphPassBase*> async_compute_passes;
+			Uint64 async_compute_sync_level = 0;
+			std::vector<RGTextureId> texture_creates;
+			std::vector<RGTextureId> texture_destroys;
+			std::vector<RGTextureId> async_texture_destroys;
+			std::vector<std::pair<RGTextureId, GfxResourceState>> texture_states;
+			std::vector<std::pair<RGTextureId, GfxResourceState>> texture_split_barriers;
+
+			std::vector<RGBufferId> buffer_creates;
+			std::vector<RGBufferId> buffer_destroys;
+			std::vector<RGBufferId> async_buffer_destroys;
+			std::vector<std::pair<RGBufferId, GfxResourceState>> buffer_states;
+			std::vector<std::pair<RGBufferId, GfxResourceState>> buffer_split_barriers;
+		};
+
+		struct DumpStatistics
+		{
+			std::vector<Uint64> pass_levels;
+			std::vector<Float> pass_gpu_times;
+			std::vector<Bool> pass_critical;
+			std::vector<std::pair<Uint64, Uint64>> texture_lifetimes;
+			std::vector<std::pair<Uint64, Uint64>> buffer_lifetimes;
+			std::vector<Uint64> texture_sizes;
+			std::vector<Uint64> level_transient_memory;
+			Float max_pass_gpu_time = 0.0f;
+			Float critical_path_gpu_time = 0.0f;
+			Uint64 max_resource_size = 0;
+		};
+
+		struct TemporalTexture
+		{
+			Uint64 key;
+			RGTextureId current;
+			RGTextureId history;
+		};
+
+		struct AsyncComputeSync
+		{
+			Uint64 level_index;
+			Uint64 sync_level;
+			Uint64 fence_value;
 		};
 
 	public:
 
-		RenderGraph(RGResourcePool& pool) : pool(pool), gfx(pool.GetDevice()) {}
+		RenderGraph(RGResourcePool& pool, RGCache* cache = nullptr) : pool(pool), cache(cache), gfx(pool.GetDevice()), allocator(pool.GetAllocator()), passes(&allocator) {}
 		ADRIA_NONCOPYABLE(RenderGraph)
 		ADRIA_DEFAULT_MOVABLE(RenderGraph)
 		~RenderGraph();
@@ -49,16 +105,40 @@ namespace adria
 		void Build();
 		void Execute();
 
-		template<typename PassData, typename... Args> requires std::is_constructible_v<RenderGraphPass<PassData>, Args...>
-		ADRIA_MAYBE_UNUSED decltype(auto) AddPass(Args&&... args)
+		template<typename PassData, typename SetupFunc, typename ExecuteFunc, typename... Args>
+		ADRIA_MAYBE_UNUSED decltype(auto) AddPass(Char const* name, SetupFunc&& setup, ExecuteFunc&& execute, Args&&... args)
+		{
+			using PassType = RenderGraphPass<PassData, std::decay_t<SetupFunc>, std::decay_t<ExecuteFunc>>;
+			PassType* pass = allocator.New<PassType>(allocator, name, std::forward<SetupFunc>(setup), std::forward<ExecuteFunc>(execute), std::forward<Args>(args)...);
+			SetupPass(pass);
+			return *pass;
+		}
+
+		//setup is not called when the condition is false, so a disabled feature doesn't declare or import any of its resources
+		template<typename PassData, typename SetupFunc, typename ExecuteFunc, typename... Args>
+		ADRIA_MAYBE_UNUSED Bool AddPassIf(Bool condition, Char const* name, SetupFunc&& setup, ExecuteFunc&& execute, Args&&... args)
+		{
+			if (!condition) return false;
+			AddPass<PassData>(name, std::forward<SetupFunc>(setup), std::forward<ExecuteFunc>(execute), std::forward<Args>(args)...);
+			return true;
+		}
+
+		//execute is called as execute(data, context, cmd_list, range) once per recorded range of the work declared with builder.SetParallelWorkload
+		template<typename PassData, typename SetupFunc, typename ExecuteFunc, typename... Args>
+		ADRIA_MAYBE_UNUSED decltype(auto) AddParallelPass(Char const* name, SetupFunc&& setup, ExecuteFunc&& execute, Args&&... args)
 		{
-			passes.emplace_back(std::make_unique<RenderGraphPass<PassData>>(std::forward<Args>(args)...));
-			std::unique_ptr<RGPassBase>& pass = passes.back(); pass->id = passes.size() - 1;
-			RenderGraphBuilder builder(*this, *pass);
-			pass->Setup(builder);
-			return *dynamic_cast<RenderGraphPass<PassData>*>(pass.get());
+			using PassType = RenderGraphParallelPass<PassData, std::decay_t<SetupFunc>, std::decay_t<ExecuteFunc>>;
+			PassType* pass = allocator.New<PassType>(allocator, name, std::forward<SetupFunc>(setup), std::forward<ExecuteFunc>(execute), std::forward<Args>(args)...);
+			SetupPass(pass);
+			return *pass;
 		}
 
+		//widens the Uint32 at counter_offset in counter to a Uint64 predicate for builder.SetPredication
+		void AddCounterPredicatePass(RGResourceName counter, RGResourceName predicate, Uint32 counter_offset = 0);
+
+		void PushPassGroup(Char const* group_name);
+		void PopPassGroup();
+
 		void ImportTexture(RGResourceName name, GfxTexture* texture);
 		void ImportBuffer(RGResourceName name, GfxBuffer* buffer);
 
@@ -69,30 +149,48 @@ namespace adria
 		RGBlackboard& GetBlackboard() { return blackboard; }
 
 		void Dump(Char const* graph_file_name);
+		void DumpTimeline(Char const* timeline_file_name);
 		void DumpDebugData();
 
 	private:
 		RGResourcePool& pool;
+		RGCache* cache;
 		GfxDevice* gfx;
 		RGBlackboard blackboard;
+		RGAllocator& allocator;
 
-		std::vector<std::unique_ptr<RGPassBase>> passes;
+		std::pmr::vector<RGAllocatorPtr<RGPassBase>> passes;
 		std::vector<std::unique_ptr<RGTexture>> textures;
 		std::vector<std::unique_ptr<RGBuffer>> buffers;
 
 		std::vector<std::vector<Uint64>> adjacency_lists;
 		std::vector<Uint64> topologically_sorted_passes;
 		std::vector<DependencyLevel> dependency_levels;
+		std::vector<std::string> pass_groups;
 
 		std::unordered_map<RGResourceName, RGTextureId> texture_name_id_map;
 		std::unordered_map<RGResourceName, RGBufferId>  buffer_name_id_map;
 		std::unordered_map<RGBufferReadWriteId, RGBufferId> buffer_uav_counter_map;
+		std::unordered_map<RGTextureId, Uint64> texture_heap_offsets;
+		std::vector<TemporalTexture> temporal_textures;
+		std::vector<AsyncComputeSync> pending_async_compute_syncs;
+		std::vector<GfxResourceState> texture_last_states;
+		std::vector<GfxResourceState> buffer_last_states;
+		std::vector<GfxResourceState> texture_split_states;
+		std::vector<GfxResourceState> buffer_split_states;
+		std::vector<RGTextureId> pending_texture_splits;
+		std::vector<RGBufferId> pending_buffer_splits;
+		Bool async_compute_enabled = false;
+		GfxBreadcrumbs* breadcrumbs = nullptr;
+		GfxRenderPassDesc merged_render_pass_desc;
+		std::vector<std::string> lint_warnings;
 
 		mutable std::unordered_map<RGTextureId, std::vector<std::pair<GfxTextureDescriptorDesc, RGDescriptorType>>> texture_view_desc_map;
 		mutable std::unordered_map<RGTextureId, std::vector<std::pair<GfxDescriptor, RGDescriptorType>>> texture_view_map;
 
 		mutable std::unordered_map<RGBufferId, std::vector<std::pair<GfxBufferDescriptorDesc, RGDescriptorType>>> buffer_view_desc_map;
 		mutable std::unordered_map<RGBufferId, std::vector<std::pair<GfxDescriptor, RGDescriptorType>>> buffer_view_map;
+		std::vector<std::pair<GfxDescriptor, GfxDescriptorHeapType>> owned_views;
 
 	private:
 
@@ -101,10 +199,23 @@ namespace adria
 		void BuildDependencyLevels();
 		void CullPasses();
 		void CalculateResourcesLifetime();
+		void AcquireTemporalTextures();
+		void CreateImportedResourceViews();
+		Uint64 ComputeGraphHash() const;
+		void StoreCompiledGraph(Uint64 graph_hash);
+		void LoadCompiledGraph();
+		void CalculateAsyncComputeSyncLevels();
+		void InitializeResourceStates();
+		void CalculateSplitBarriers();
+		void InferRenderPassAccessOps();
+		void MergeRenderPasses();
 		void DepthFirstSearch(Uint64 i, std::vector<Bool>& visited, std::vector<Uint64>& sort);
+		DumpStatistics CollectDumpStatistics() const;
+		void LintGraph();
 		
 		RGTextureId DeclareTexture(RGResourceName name, RGTextureDesc const& desc);
 		RGBufferId DeclareBuffer(RGResourceName name, RGBufferDesc const& desc);
+		Bool DeclareTemporalTexture(RGResourceName name, RGResourceName history_name, RGTextureDesc const& desc);
 
 		Bool IsTextureDeclared(RGResourceName);
 		Bool IsBufferDeclared(RGResourceName);
@@ -160,12 +271,34 @@ namespace adria
 		GfxTexture* GetTexture(RGTextureId) const;
 		GfxBuffer* GetBuffer(RGBufferId) const;
 
+		void SetupPass(RenderGraphPassBase* pass);
 		void CreateTextureViews(RGTextureId);
 		void CreateBufferViews(RGBufferId);
 		void Execute_Singlethreaded();
 		void Execute_Multithreaded();
+		void CalculateTextureAliasing();
+		void PrepareDependencyLevel(Uint64 level_index, GfxCommandList* cmd_list);
+		void FinishDependencyLevel(Uint64 level_index, GfxCommandList* cmd_list);
+		GfxCommandList* SubmitAsyncCompute(Uint64 level_index, GfxCommandList* cmd_list);
+		GfxCommandList* SyncAsyncCompute(Uint64 level_index, GfxCommandList* cmd_list);
+		GfxCommandList* SubmitCheckpoint(Uint64 level_index, GfxCommandList* cmd_list, Uint64& passes_since_submit);
+		void FlushSplitBarriers(GfxCommandList* cmd_list);
 
 		void AddExportBufferCopyPass(RGResourceName export_buffer, GfxBuffer* buffer);
 		void AddExportTextureCopyPass(RGResourceName export_texture, GfxTexture* texture);
 	};
+
+	struct RGPassGroupScope
+	{
+		RGPassGroupScope(RenderGraph& rg, Char const* group_name) : rg(rg)
+		{
+			rg.PushPassGroup(group_name);
+		}
+		~RGPassGroupScope()
+		{
+			rg.PopPassGroup();
+		}
+		RenderGraph& rg;
+	};
+	#define RG_PASS_GROUP(rg, name) RGPassGroupScope ADRIA_CONCAT(rg_pass_group, __COUNTER__)(rg, name)
 }
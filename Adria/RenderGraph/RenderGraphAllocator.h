@@ -0,0 +1,113 @@
+#pragma once
+#include <memory_resource>
+#include "Utilities/LinearAllocator.h"
+
+namespace adria
+{
+	class RenderGraphAllocator final : public std::pmr::memory_resource
+	{
+		static constexpr Uint64 DEFAULT_BLOCK_SIZE = 1 << 20;
+
+		struct MemoryBlock
+		{
+			std::unique_ptr<Uint8[]> memory;
+			LinearAllocator allocator;
+		};
+
+	public:
+		explicit RenderGraphAllocator(Uint64 block_size = DEFAULT_BLOCK_SIZE) : block_size(block_size)
+		{
+			AddBlock(block_size);
+		}
+		ADRIA_NONCOPYABLE_NONMOVABLE(RenderGraphAllocator)
+		~RenderGraphAllocator() = default;
+
+		void* Allocate(Uint64 size, Uint64 align = alignof(std::max_align_t))
+		{
+			if (void* memory = AllocateFromBlock(blocks[current_block], size, align)) return memory;
+			while (++current_block < blocks.size())
+			{
+				if (void* memory = AllocateFromBlock(blocks[current_block], size, align)) return memory;
+			}
+			AddBlock(std::max(block_size, size + align));
+			return AllocateFromBlock(blocks[current_block], size, align);
+		}
+
+		template<typename T, typename... Args>
+		T* New(Args&&... args)
+		{
+			return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		Char const* CopyString(Char const* str)
+		{
+			Uint64 const length = strlen(str);
+			Char* copy = static_cast<Char*>(Allocate(length + 1, alignof(Char)));
+			memcpy(copy, str, length + 1);
+			return copy;
+		}
+
+		void Reset()
+		{
+			if (blocks.size() > 1)
+			{
+				Uint64 total_size = 0;
+				for (MemoryBlock const& block : blocks) total_size += block.allocator.MaxSize();
+				blocks.clear();
+				AddBlock(total_size);
+			}
+			for (MemoryBlock& block : blocks) block.allocator.Clear();
+			current_block = 0;
+		}
+
+		Uint64 GetUsedSize() const
+		{
+			Uint64 used_size = 0;
+			for (MemoryBlock const& block : blocks) used_size += block.allocator.UsedSize();
+			return used_size;
+		}
+
+	private:
+		std::vector<MemoryBlock> blocks;
+		Uint64 current_block = 0;
+		Uint64 block_size;
+
+	private:
+		void AddBlock(Uint64 size)
+		{
+			blocks.push_back(MemoryBlock{ std::make_unique<Uint8[]>(size), LinearAllocator(size) });
+			current_block = blocks.size() - 1;
+		}
+
+		static void* AllocateFromBlock(MemoryBlock& block, Uint64 size, Uint64 align)
+		{
+			Uint64 const base = reinterpret_cast<Uint64>(block.memory.get());
+			Uint64 const padding = Align(base + block.allocator.UsedSize(), align) - (base + block.allocator.UsedSize());
+			Uint64 const offset = block.allocator.Allocate(size + padding);
+			if (offset == INVALID_ALLOC_OFFSET) return nullptr;
+			return block.memory.get() + offset + padding;
+		}
+
+		void* do_allocate(Uint64 size, Uint64 align) override
+		{
+			return Allocate(size, align);
+		}
+		void do_deallocate(void*, Uint64, Uint64) override {}
+		Bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+	using RGAllocator = RenderGraphAllocator;
+
+	struct RGAllocatorDeleter
+	{
+		template<typename T>
+		void operator()(T* object) const
+		{
+			object->~T();
+		}
+	};
+	template<typename T>
+	using RGAllocatorPtr = std::unique_ptr<T, RGAllocatorDeleter>;
+}
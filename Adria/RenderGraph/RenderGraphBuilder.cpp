@@ -32,6 +32,11 @@ namespace adria
 		rg_pass.texture_creates.insert(rg.DeclareTexture(name, desc));
 	}
 
+	Bool RenderGraphBuilder::DeclareTemporalTexture(RGResourceName name, RGResourceName history_name, RGTextureDesc const& desc)
+	{
+		return rg.DeclareTemporalTexture(name, history_name, desc);
+	}
+
 	void RenderGraphBuilder::DeclareBuffer(RGResourceName name, RGBufferDesc const& desc)
 	{
 		rg_pass.buffer_creates.insert(rg.DeclareBuffer(name, desc));
@@ -295,6 +300,21 @@ namespace adria
 		rg_pass.viewport_height = height;
 	}
 
+	void RenderGraphBuilder::SetParallelWorkload(Uint32 work_count, Uint32 min_batch_size)
+	{
+		rg_pass.parallel_work_count = work_count;
+		rg_pass.parallel_min_batch = std::max(min_batch_size, 1u);
+	}
+
+	void RenderGraphBuilder::SetPredication(RGResourceName name, Uint64 offset)
+	{
+		RGBufferId res_id(rg.ReadIndirectArgsBuffer(name));
+		rg_pass.buffer_state_map[res_id] |= GfxResourceState::Predication;
+		rg_pass.buffer_reads.insert(res_id);
+		rg_pass.predication_buffer = res_id;
+		rg_pass.predication_offset = offset;
+	}
+
 	RGTextureDesc RenderGraphBuilder::GetTextureDesc(RGResourceName name)
 	{
 		return rg.GetTextureDesc(name);
@@ -90,6 +90,8 @@ namespace adria
 		void ExportBuffer(RGResourceName name, GfxBuffer* buffer);
 		void DeclareTexture(RGResourceName name, RGTextureDesc const& desc);
 		void DeclareBuffer(RGResourceName name, RGBufferDesc const& desc);
+		//name is this frame's version and history_name the previous frame's one, returns false when the history doesn't hold last frame's contents
+		Bool DeclareTemporalTexture(RGResourceName name, RGResourceName history_name, RGTextureDesc const& desc);
 
 		void DummyWriteTexture(RGResourceName name);
 		void DummyReadTexture(RGResourceName name);
@@ -150,6 +152,9 @@ namespace adria
 		}
 
 		void SetViewport(Uint32 width, Uint32 height);
+		void SetParallelWorkload(Uint32 work_count, Uint32 min_batch_size = 64);
+		//the commands of the pass are skipped on the gpu when the Uint64 at offset in the buffer is zero
+		void SetPredication(RGResourceName name, Uint64 offset = 0);
 		RGTextureDesc GetTextureDesc(RGResourceName);
 		RGBufferDesc  GetBufferDesc(RGResourceName);
 		void AddBufferBindFlags(RGResourceName name, GfxBindFlag flags);
@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+
+namespace adria
+{
+	struct RenderGraphCache
+	{
+		static constexpr Uint64 INVALID_PASS = static_cast<Uint64>(-1);
+
+		Uint64 hash = 0;
+		std::vector<std::vector<Uint64>> adjacency_lists;
+		std::vector<Uint64> topologically_sorted_passes;
+		std::vector<std::vector<Uint64>> dependency_level_passes;
+		std::vector<Uint64> pass_ref_counts;
+		std::vector<Uint64> texture_last_used_by;
+		std::vector<Uint64> buffer_last_used_by;
+
+		void Invalidate() { hash = 0; }
+	};
+	using RGCache = RenderGraphCache;
+}
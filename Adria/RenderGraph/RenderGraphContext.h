@@ -42,6 +42,8 @@ namespace adria
 		Bool imported;
 		Uint64 version;
 		Uint64 ref_count;
+		Bool aliased = false;
+		Bool pooled = false;
 
 		RenderGraphPassBase* writer = nullptr;
 		RenderGraphPassBase* last_used_by = nullptr;
@@ -1,7 +1,7 @@
 #pragma once
-#include <functional>
 #include <optional>
 #include "RenderGraphContext.h"
+#include "RenderGraphAllocator.h"
 #include "Utilities/EnumUtil.h"
 
 
@@ -20,6 +20,8 @@ namespace adria
 		None = 0x00,
 		ForceNoCull = 0x01,						//RGPass will not be culled by Render Graph, useful for debug passes
 		LegacyRenderPass = 0x02,				//RGPass will not use DX12 Render Passes but rather OMSetRenderTargets
+		ScheduleLate = 0x04,					//RGPass is placed in the latest dependency level its consumers allow, useful to overlap it with async compute
+		SubmitAfter = 0x08,						//Command lists recorded up to the end of RGPass's dependency level are submitted so the GPU can start on them
 	};
 	ENABLE_ENUM_BIT_OPERATORS(RGPassFlags);
 
@@ -70,6 +72,14 @@ namespace adria
 		load_op = static_cast<RGLoadAccessOp>(((Uint8)load_store_op >> 2) & 0b11);
 	}
 
+	struct RGParallelRange
+	{
+		Uint32 begin;
+		Uint32 end;
+		Uint32 index;
+		Uint32 count;
+	};
+
 	class RenderGraph;
 	class RenderGraphBuilder;
 	class GfxDevice;
@@ -95,54 +105,70 @@ namespace adria
 		inline static Uint32 unique_pass_id = 0;
 
 	public:
-		explicit RenderGraphPassBase(Char const* name, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
-			: name(name), type(type), flags(flags) {}
+		RenderGraphPassBase(RGAllocator& allocator, Char const* name, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
+			: name(allocator.CopyString(name)), type(type), flags(flags),
+			  texture_creates(&allocator), texture_reads(&allocator), texture_writes(&allocator), texture_destroys(&allocator), texture_state_map(&allocator),
+			  buffer_creates(&allocator), buffer_reads(&allocator), buffer_writes(&allocator), buffer_destroys(&allocator), buffer_state_map(&allocator),
+			  render_targets_info(&allocator) {}
 		virtual ~RenderGraphPassBase() = default;
 
 	protected:
 
 		virtual void Setup(RenderGraphBuilder&) = 0;
 		virtual void Execute(RenderGraphContext&, GfxCommandList*) const = 0;
+		virtual void ExecuteRange(RenderGraphContext& context, GfxCommandList* cmd_list, RGParallelRange const&) const { Execute(context, cmd_list); }
 
 		Bool IsCulled() const { return CanBeCulled() && ref_count == 0; }
 		Bool CanBeCulled() const { return !HasAnyFlag(flags, RGPassFlags::ForceNoCull); }
 		Bool UseLegacyRenderPasses() const { return HasAnyFlag(flags, RGPassFlags::LegacyRenderPass); }
+		Bool ShouldScheduleLate() const { return HasAnyFlag(flags, RGPassFlags::ScheduleLate); }
+		Bool ShouldSubmitAfter() const { return HasAnyFlag(flags, RGPassFlags::SubmitAfter); }
+		Bool IsParallel() const { return parallel_work_count > 0; }
+		Bool IsPredicated() const { return predication_buffer.IsValid(); }
+		Bool IsMergedWithPrevious() const { return merged_with_previous; }
+		Bool IsMergedWithNext() const { return merged_next != nullptr; }
+		Uint32 GetParallelWorkCount() const { return parallel_work_count; }
 
 	private:
-		std::string const name;
+		Char const* name;
+		Char const* group = "";
+		Float cpu_time_ms = 0.0f;
 		Uint64 ref_count = 0ull;
 		RGPassType type;
 		RGPassFlags flags = RGPassFlags::None;
 		Uint64 id;
 
-		std::unordered_set<RGTextureId> texture_creates;
-		std::unordered_set<RGTextureId> texture_reads;
-		std::unordered_set<RGTextureId> texture_writes;
-		std::unordered_set<RGTextureId> texture_destroys;
-		std::unordered_map<RGTextureId, GfxResourceState> texture_state_map;
+		std::pmr::unordered_set<RGTextureId> texture_creates;
+		std::pmr::unordered_set<RGTextureId> texture_reads;
+		std::pmr::unordered_set<RGTextureId> texture_writes;
+		std::pmr::unordered_set<RGTextureId> texture_destroys;
+		std::pmr::unordered_map<RGTextureId, GfxResourceState> texture_state_map;
 		
-		std::unordered_set<RGBufferId> buffer_creates;
-		std::unordered_set<RGBufferId> buffer_reads;
-		std::unordered_set<RGBufferId> buffer_writes;
-		std::unordered_set<RGBufferId> buffer_destroys;
-		std::unordered_map<RGBufferId, GfxResourceState> buffer_state_map;
+		std::pmr::unordered_set<RGBufferId> buffer_creates;
+		std::pmr::unordered_set<RGBufferId> buffer_reads;
+		std::pmr::unordered_set<RGBufferId> buffer_writes;
+		std::pmr::unordered_set<RGBufferId> buffer_destroys;
+		std::pmr::unordered_map<RGBufferId, GfxResourceState> buffer_state_map;
 
-		std::vector<RenderTargetInfo> render_targets_info;
+		std::pmr::vector<RenderTargetInfo> render_targets_info;
 		std::optional<DepthStencilInfo> depth_stencil = std::nullopt;
 		Uint32 viewport_width = 0, viewport_height = 0;
+		Uint32 parallel_work_count = 0;
+		Uint32 parallel_min_batch = 1;
+		RenderGraphPassBase* merged_next = nullptr;
+		Bool merged_with_previous = false;
+		RGBufferId predication_buffer;
+		Uint64 predication_offset = 0;
 	};
 	using RGPassBase = RenderGraphPassBase;
 
-	template<typename PassData>
+	template<typename PassData, typename SetupFunc, typename ExecuteFunc>
 	class RenderGraphPass final : public RenderGraphPassBase
 	{
 	public:
-		using SetupFunc = std::function<void(PassData&, RenderGraphBuilder&)>;
-		using ExecuteFunc = std::function<void(PassData const&, RenderGraphContext&, GfxCommandList*)>;
-
-	public:
-		RenderGraphPass(Char const* name, SetupFunc&& setup, ExecuteFunc&& execute, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
-			: RenderGraphPassBase(name, type, flags), setup(std::move(setup)), execute(std::move(execute))
+		template<typename S, typename E>
+		RenderGraphPass(RGAllocator& allocator, Char const* name, S&& setup, E&& execute, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
+			: RenderGraphPassBase(allocator, name, type, flags), setup(std::forward<S>(setup)), execute(std::forward<E>(execute))
 		{}
 
 		PassData const& GetPassData() const
@@ -153,33 +179,28 @@ namespace adria
 	private:
 		PassData data;
 		SetupFunc setup;
-		ExecuteFunc execute;
+		mutable ExecuteFunc execute;
 
 	private:
 
 		void Setup(RenderGraphBuilder& builder) override
 		{
-			ADRIA_ASSERT(setup != nullptr && "setup function is null!");
 			setup(data, builder);
 		}
 
 		void Execute(RenderGraphContext& context, GfxCommandList* ctx) const override
 		{
-			ADRIA_ASSERT(setup != nullptr && "execute function is null!");
 			execute(data, context, ctx);
 		}
 	};
 
-	template<>
-	class RenderGraphPass<void> final : public RenderGraphPassBase
+	template<typename SetupFunc, typename ExecuteFunc>
+	class RenderGraphPass<void, SetupFunc, ExecuteFunc> final : public RenderGraphPassBase
 	{
 	public:
-		using SetupFunc = std::function<void(RenderGraphBuilder&)>;
-		using ExecuteFunc = std::function<void(RenderGraphContext&, GfxCommandList*)>;
-
-	public:
-		RenderGraphPass(Char const* name, SetupFunc&& setup, ExecuteFunc&& execute, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
-			: RenderGraphPassBase(name, type, flags), setup(std::move(setup)), execute(std::move(execute))
+		template<typename S, typename E>
+		RenderGraphPass(RGAllocator& allocator, Char const* name, S&& setup, E&& execute, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
+			: RenderGraphPassBase(allocator, name, type, flags), setup(std::forward<S>(setup)), execute(std::forward<E>(execute))
 		{}
 
 		void GetPassData() const
@@ -189,25 +210,62 @@ namespace adria
 
 	private:
 		SetupFunc setup;
-		ExecuteFunc execute;
+		mutable ExecuteFunc execute;
 
 	private:
 
 		void Setup(RenderGraphBuilder& builder) override
 		{
-			ADRIA_ASSERT(setup != nullptr && "setup function is null!");
 			setup(builder);
 		}
 
 		void Execute(RenderGraphContext& context, GfxCommandList* ctx) const override
 		{
-			ADRIA_ASSERT(setup != nullptr && "execute function is null!");
 			execute(context, ctx);
 		}
 	};
 
-	template<typename PassData>
-	using RGPass = RenderGraphPass<PassData>;
+	template<typename PassData, typename SetupFunc, typename ExecuteFunc>
+	class RenderGraphParallelPass final : public RenderGraphPassBase
+	{
+	public:
+		template<typename S, typename E>
+		RenderGraphParallelPass(RGAllocator& allocator, Char const* name, S&& setup, E&& execute, RGPassType type = RGPassType::Graphics, RGPassFlags flags = RGPassFlags::None)
+			: RenderGraphPassBase(allocator, name, type, flags), setup(std::forward<S>(setup)), execute(std::forward<E>(execute))
+		{}
+
+		PassData const& GetPassData() const
+		{
+			return data;
+		}
+
+	private:
+		PassData data;
+		SetupFunc setup;
+		mutable ExecuteFunc execute;
+
+	private:
+
+		void Setup(RenderGraphBuilder& builder) override
+		{
+			setup(data, builder);
+		}
+
+		void Execute(RenderGraphContext& context, GfxCommandList* ctx) const override
+		{
+			execute(data, context, ctx, RGParallelRange{ 0, GetParallelWorkCount(), 0, 1 });
+		}
+
+		void ExecuteRange(RenderGraphContext& context, GfxCommandList* ctx, RGParallelRange const& range) const override
+		{
+			execute(data, context, ctx, range);
+		}
+	};
+
+	template<typename PassData, typename SetupFunc, typename ExecuteFunc>
+	using RGPass = RenderGraphPass<PassData, SetupFunc, ExecuteFunc>;
+	template<typename PassData, typename SetupFunc, typename ExecuteFunc>
+	using RGParallelPass = RenderGraphParallelPass<PassData, SetupFunc, ExecuteFunc>;
 
 	inline std::string RGPassTypeToString(RGPassType type)
 	{
@@ -0,0 +1,100 @@
+#include "RenderGraphProfiler.h"
+
+namespace adria
+{
+	namespace
+	{
+		Float Average(std::vector<Float> const& samples)
+		{
+			if (samples.empty()) return 0.0f;
+			Float sum = 0.0f;
+			for (Float sample : samples) sum += sample;
+			return sum / samples.size();
+		}
+
+		void PushSample(std::vector<Float>& samples, Float sample)
+		{
+			if (samples.size() == RenderGraphProfiler::HISTORY_SIZE) samples.erase(samples.begin());
+			samples.push_back(sample);
+		}
+
+		RGProfileNode& FindOrAddChild(RGProfileNode& node, std::string_view name)
+		{
+			for (RGProfileNode& child : node.children)
+			{
+				if (child.is_group && child.name == name) return child;
+			}
+			RGProfileNode& child = node.children.emplace_back();
+			child.name = name;
+			child.is_group = true;
+			return child;
+		}
+
+		void AccumulateGroupTimes(RGProfileNode& node)
+		{
+			if (!node.is_group) return;
+			node.cpu_time_ms = node.gpu_time_ms = 0.0f;
+			node.culled = true;
+			for (RGProfileNode& child : node.children)
+			{
+				AccumulateGroupTimes(child);
+				node.cpu_time_ms += child.cpu_time_ms;
+				node.gpu_time_ms += child.gpu_time_ms;
+				node.culled &= child.culled;
+			}
+		}
+	}
+
+	void RenderGraphProfiler::EndFrame(std::vector<RGPassTiming>&& _pass_timings)
+	{
+		++frame;
+		pass_timings = std::move(_pass_timings);
+		gpu_timestamps = g_GfxProfiler.GetResults();
+
+		std::unordered_map<std::string_view, Float> gpu_times;
+		for (GfxTimestamp const& timestamp : gpu_timestamps) gpu_times[timestamp.name] = timestamp.time_in_ms;
+
+		for (RGPassTiming& pass_timing : pass_timings)
+		{
+			if (pass_timing.culled) continue;
+			if (auto it = gpu_times.find(pass_timing.name); it != gpu_times.end()) pass_timing.gpu_time_ms = it->second;
+
+			PassHistory& history = pass_histories[pass_timing.name];
+			PushSample(history.cpu_times, pass_timing.cpu_time_ms);
+			PushSample(history.gpu_times, pass_timing.gpu_time_ms);
+			history.last_frame = frame;
+		}
+		std::erase_if(pass_histories, [this](auto const& history) { return frame - history.second.last_frame > HISTORY_SIZE; });
+		BuildHierarchy();
+	}
+
+	void RenderGraphProfiler::BuildHierarchy()
+	{
+		root = RGProfileNode{};
+		root.name = "Frame";
+		root.is_group = true;
+		for (RGPassTiming const& pass_timing : pass_timings)
+		{
+			RGProfileNode* parent = &root;
+			std::string_view group = pass_timing.group;
+			while (!group.empty())
+			{
+				Uint64 const separator = group.find('/');
+				parent = &FindOrAddChild(*parent, group.substr(0, separator));
+				group = separator == std::string_view::npos ? std::string_view{} : group.substr(separator + 1);
+			}
+
+			RGProfileNode& pass_node = parent->children.emplace_back();
+			pass_node.name = pass_timing.name;
+			pass_node.culled = pass_timing.culled;
+			pass_node.async_compute = pass_timing.async_compute;
+			if (auto it = pass_histories.find(pass_timing.name); it != pass_histories.end())
+			{
+				pass_node.cpu_time_ms = pass_timing.culled ? 0.0f : Average(it->second.cpu_times);
+				pass_node.gpu_time_ms = pass_timing.culled ? 0.0f : Average(it->second.gpu_times);
+				pass_node.gpu_history = &it->second.gpu_times;
+			}
+		}
+		AccumulateGroupTimes(root);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Graphics/GfxProfiler.h"
+#include "Utilities/Singleton.h"
+
+namespace adria
+{
+	struct RGPassTiming
+	{
+		std::string name;
+		std::string group;
+		Float cpu_time_ms = 0.0f;
+		Float gpu_time_ms = 0.0f;
+		Bool culled = false;
+		Bool async_compute = false;
+	};
+
+	struct RGProfileNode
+	{
+		std::string name;
+		Float cpu_time_ms = 0.0f;
+		Float gpu_time_ms = 0.0f;
+		Bool culled = false;
+		Bool async_compute = false;
+		Bool is_group = false;
+		std::vector<Float> const* gpu_history = nullptr;
+		std::vector<RGProfileNode> children;
+	};
+
+	class RenderGraphProfiler : public Singleton<RenderGraphProfiler>
+	{
+		friend class Singleton<RenderGraphProfiler>;
+
+		struct PassHistory
+		{
+			std::vector<Float> cpu_times;
+			std::vector<Float> gpu_times;
+			Uint32 last_frame = 0;
+		};
+
+	public:
+		static constexpr Uint32 HISTORY_SIZE = 128;
+
+		void EndFrame(std::vector<RGPassTiming>&& pass_timings);
+
+		std::vector<RGPassTiming> const& GetPassTimings() const { return pass_timings; }
+		std::vector<GfxTimestamp> const& GetGpuTimestamps() const { return gpu_timestamps; }
+		RGProfileNode const& GetRoot() const { return root; }
+
+	private:
+		std::vector<RGPassTiming> pass_timings;
+		std::vector<GfxTimestamp> gpu_timestamps;
+		std::unordered_map<std::string, PassHistory> pass_histories;
+		RGProfileNode root;
+		Uint32 frame = 0;
+
+	private:
+		RenderGraphProfiler() = default;
+		~RenderGraphProfiler() = default;
+
+		void BuildHierarchy();
+	};
+	#define g_RenderGraphProfiler RenderGraphProfiler::Get()
+}
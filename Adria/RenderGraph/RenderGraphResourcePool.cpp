@@ -0,0 +1,371 @@
+#include "RenderGraphResourcePool.h"
+#include "Graphics/GfxResidencyManager.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/HashUtil.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Int> PoolEvictionMode("rg.PoolEvictionMode", 0, "0 - evict idle pooled resources after rg.PoolEvictionFrames frames, 1 - keep them until VRAM usage exceeds rg.PoolEvictionBudget, committed ones are then paged out instead of released");
+	static TAutoConsoleVariable<Int> PoolEvictionFrames("rg.PoolEvictionFrames", 4, "Number of idle frames after which a pooled render graph resource is released");
+	static TAutoConsoleVariable<Float> PoolEvictionBudget("rg.PoolEvictionBudget", 0.9f, "Fraction of the VRAM budget above which idle pooled render graph resources are released");
+
+	namespace
+	{
+		Uint64 GetTextureBucketKey(GfxTextureDesc const& desc, Bool aliased, Uint64 heap_offset)
+		{
+			HashState hash{};
+			hash.Combine((Uint64)desc.type);
+			hash.Combine(desc.width);
+			hash.Combine(desc.height);
+			hash.Combine(desc.array_size);
+			hash.Combine((Uint64)desc.format);
+			hash.Combine(desc.sample_count);
+			hash.Combine((Uint64)desc.heap_type);
+			hash.Combine(aliased);
+			hash.Combine(heap_offset);
+			return hash;
+		}
+
+		Uint64 GetBufferBucketKey(GfxBufferDesc const& desc)
+		{
+			HashState hash{};
+			hash.Combine(desc.size);
+			hash.Combine((Uint64)desc.resource_usage);
+			hash.Combine((Uint64)desc.bind_flags);
+			hash.Combine((Uint64)desc.misc_flags);
+			hash.Combine(desc.stride);
+			hash.Combine((Uint64)desc.format);
+			return hash;
+		}
+	}
+
+	RenderGraphResourcePool::~RenderGraphResourcePool()
+	{
+		for (auto& [texture, pooled_texture] : texture_pool)
+		{
+			if (pooled_texture.evicted) device->GetResidencyManager()->Unregister(texture->GetPageable());
+			FreeViews(pooled_texture.views);
+		}
+		for (auto& [buffer, pooled_buffer] : buffer_pool)
+		{
+			if (pooled_buffer.evicted) device->GetResidencyManager()->Unregister(buffer->GetPageable());
+			FreeViews(pooled_buffer.views);
+		}
+		texture_pool.clear();
+		buffer_pool.clear();
+		if (transient_heap)
+		{
+			device->GetMemoryTracker().Free(GfxMemoryCategory::RenderGraphTransients, transient_heap_size);
+			device->AddToReleaseQueue(transient_heap.release());
+		}
+	}
+
+	void RenderGraphResourcePool::Tick()
+	{
+		Bool memory_pressure = false;
+		if ((RGPoolEvictionMode)PoolEvictionMode.Get() == RGPoolEvictionMode::MemoryPressure)
+		{
+			GPUMemoryUsage const memory_usage = device->GetMemoryUsage();
+			memory_pressure = memory_usage.usage > PoolEvictionBudget.Get() * memory_usage.budget;
+		}
+
+		std::vector<GfxTexture const*> evicted_textures;
+		for (auto& [key, textures] : free_textures)
+		{
+			std::erase_if(textures, [&](GfxTexture* texture)
+				{
+					PooledTexture& pooled_texture = texture_pool[texture];
+					if (!ShouldEvict(pooled_texture.last_used_frame, memory_pressure)) return false;
+					if (memory_pressure && !pooled_texture.aliased && texture->GetPageable())
+					{
+						TryEvictResidency(texture->GetPageable(), pooled_texture.last_used_frame, pooled_texture.evicted);
+						return false;
+					}
+					evicted_textures.push_back(texture);
+					return true;
+				});
+		}
+		for (GfxTexture const* texture : evicted_textures) EvictTexture(texture);
+
+		std::vector<GfxBuffer const*> evicted_buffers;
+		for (auto& [key, buffers] : free_buffers)
+		{
+			std::erase_if(buffers, [&](GfxBuffer* buffer)
+				{
+					PooledBuffer& pooled_buffer = buffer_pool[buffer];
+					if (!ShouldEvict(pooled_buffer.last_used_frame, memory_pressure)) return false;
+					if (memory_pressure && buffer->GetPageable())
+					{
+						TryEvictResidency(buffer->GetPageable(), pooled_buffer.last_used_frame, pooled_buffer.evicted);
+						return false;
+					}
+					evicted_buffers.push_back(buffer);
+					return true;
+				});
+		}
+		for (GfxBuffer const* buffer : evicted_buffers) EvictBuffer(buffer);
+
+		std::erase_if(free_textures, [](auto const& bucket) { return bucket.second.empty(); });
+		std::erase_if(free_buffers, [](auto const& bucket) { return bucket.second.empty(); });
+		std::erase_if(temporal_textures, [this](auto const& temporal) { return temporal.second.last_used_frame < frame_index; });
+		++frame_index;
+	}
+
+	void RenderGraphResourcePool::EvictIdleTextures()
+	{
+		std::vector<GfxTexture const*> evicted_textures;
+		for (auto& [key, textures] : free_textures)
+		{
+			//placed textures don't own memory, the transient heap is kept for the new resolution
+			std::erase_if(textures, [&](GfxTexture* texture)
+				{
+					if (texture_pool[texture].aliased) return false;
+					evicted_textures.push_back(texture);
+					return true;
+				});
+		}
+		for (GfxTexture const* texture : evicted_textures) EvictTexture(texture);
+		std::erase_if(free_textures, [](auto const& bucket) { return bucket.second.empty(); });
+	}
+
+	void RenderGraphResourcePool::ReserveTransientHeap(Uint64 size)
+	{
+		if (size <= transient_heap_size) return;
+
+		for (auto& [key, textures] : free_textures)
+		{
+			std::erase_if(textures, [this](GfxTexture* texture) { return texture_pool[texture].aliased; });
+		}
+		std::vector<GfxTexture const*> aliased_textures;
+		for (auto const& [texture, pooled_texture] : texture_pool)
+		{
+			if (pooled_texture.aliased) aliased_textures.push_back(texture);
+		}
+		for (GfxTexture const* texture : aliased_textures) EvictTexture(texture);
+
+		if (transient_heap)
+		{
+			device->GetMemoryTracker().Free(GfxMemoryCategory::RenderGraphTransients, transient_heap_size);
+			device->AddToReleaseQueue(transient_heap.release());
+		}
+
+		transient_heap_size = ((size + HEAP_SIZE_GRANULARITY - 1) / HEAP_SIZE_GRANULARITY) * HEAP_SIZE_GRANULARITY;
+
+		D3D12MA::ALLOCATION_DESC allocation_desc{};
+		allocation_desc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+		allocation_desc.ExtraHeapFlags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+
+		D3D12_RESOURCE_ALLOCATION_INFO allocation_info{};
+		allocation_info.SizeInBytes = transient_heap_size;
+		allocation_info.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+
+		D3D12MA::Allocation* heap_allocation = nullptr;
+		HRESULT hr = device->GetAllocator()->AllocateMemory(&allocation_desc, &allocation_info, &heap_allocation);
+		GFX_CHECK_HR(hr);
+		transient_heap.reset(heap_allocation);
+		device->GetMemoryTracker().Allocate(GfxMemoryCategory::RenderGraphTransients, transient_heap_size);
+	}
+
+	GfxTexture* RenderGraphResourcePool::AllocateAliasedTexture(GfxTextureDesc const& desc, Uint64 heap_offset, Bool* pooled)
+	{
+		ADRIA_ASSERT(transient_heap != nullptr);
+		Uint64 const bucket_key = GetTextureBucketKey(desc, true, heap_offset);
+		GfxTexture* texture = FindFreeTexture(bucket_key, desc, true, heap_offset);
+		if (pooled) *pooled = texture != nullptr;
+		if (texture) return texture;
+
+		std::unique_ptr<GfxTexture> new_texture = std::make_unique<GfxTexture>(device, desc, transient_heap.get(), heap_offset);
+		texture = new_texture.get();
+		texture_pool[texture] = PooledTexture{ std::move(new_texture), desc, frame_index, bucket_key, heap_offset, true, true };
+		return texture;
+	}
+
+	GfxTexture* RenderGraphResourcePool::AllocateTexture(GfxTextureDesc const& desc, Bool* pooled)
+	{
+		Uint64 const bucket_key = GetTextureBucketKey(desc, false, 0);
+		GfxTexture* texture = FindFreeTexture(bucket_key, desc, false, 0);
+		if (pooled) *pooled = texture != nullptr;
+		if (texture) return texture;
+
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::RenderGraphTransients);
+		std::unique_ptr<GfxTexture> new_texture = std::make_unique<GfxTexture>(device, desc);
+		texture = new_texture.get();
+		texture_pool[texture] = PooledTexture{ std::move(new_texture), desc, frame_index, bucket_key, 0, false, true };
+		return texture;
+	}
+
+	void RenderGraphResourcePool::ReleaseTexture(GfxTexture* texture)
+	{
+		auto it = texture_pool.find(texture);
+		if (it == texture_pool.end() || !it->second.active) return;
+		it->second.active = false;
+		free_textures[it->second.bucket_key].push_back(texture);
+	}
+
+	GfxBuffer* RenderGraphResourcePool::AllocateBuffer(GfxBufferDesc const& desc, Bool* pooled)
+	{
+		Uint64 const bucket_key = GetBufferBucketKey(desc);
+		if (auto it = free_buffers.find(bucket_key); it != free_buffers.end())
+		{
+			std::vector<GfxBuffer*>& buffers = it->second;
+			for (Uint64 i = 0; i < buffers.size(); ++i)
+			{
+				GfxBuffer* buffer = buffers[i];
+				if (buffer->GetDesc() != desc) continue;
+
+				std::swap(buffers[i], buffers.back());
+				buffers.pop_back();
+				PooledBuffer& pooled_buffer = buffer_pool[buffer];
+				pooled_buffer.last_used_frame = frame_index;
+				pooled_buffer.active = true;
+				MakeResident(buffer->GetPageable(), pooled_buffer.evicted);
+				if (pooled) *pooled = true;
+				return buffer;
+			}
+		}
+
+		if (pooled) *pooled = false;
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::RenderGraphTransients);
+		std::unique_ptr<GfxBuffer> new_buffer = std::make_unique<GfxBuffer>(device, desc);
+		GfxBuffer* buffer = new_buffer.get();
+		buffer_pool[buffer] = PooledBuffer{ std::move(new_buffer), frame_index, bucket_key, true };
+		return buffer;
+	}
+
+	void RenderGraphResourcePool::ReleaseBuffer(GfxBuffer* buffer)
+	{
+		auto it = buffer_pool.find(buffer);
+		if (it == buffer_pool.end() || !it->second.active) return;
+		it->second.active = false;
+		free_buffers[it->second.bucket_key].push_back(buffer);
+	}
+
+	Bool RenderGraphResourcePool::HasTemporalHistory(Uint64 key, GfxTextureDesc const& desc) const
+	{
+		auto it = temporal_textures.find(key);
+		if (it == temporal_textures.end() || it->second.last_used_frame + 1 != frame_index) return false;
+		GfxTextureDesc const& history_desc = it->second.textures[0]->GetDesc();
+		return history_desc.type == desc.type && history_desc.width == desc.width && history_desc.height == desc.height
+			&& history_desc.depth == desc.depth && history_desc.array_size == desc.array_size && history_desc.format == desc.format;
+	}
+
+	std::pair<GfxTexture*, GfxTexture*> RenderGraphResourcePool::AcquireTemporalTexture(Uint64 key, GfxTextureDesc const& desc)
+	{
+		TemporalTexture& temporal = temporal_textures[key];
+		if (!temporal.textures[0] || temporal.textures[0]->GetDesc() != desc)
+		{
+			GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::RenderGraphTransients);
+			for (std::unique_ptr<GfxTexture>& texture : temporal.textures) texture = std::make_unique<GfxTexture>(device, desc);
+			temporal.current = 0;
+		}
+		else if (temporal.last_used_frame != frame_index)
+		{
+			temporal.current ^= 1;
+		}
+		temporal.last_used_frame = frame_index;
+		return { temporal.textures[temporal.current].get(), temporal.textures[temporal.current ^ 1].get() };
+	}
+
+	GfxDescriptor RenderGraphResourcePool::GetTextureView(GfxTexture* texture, GfxTextureDescriptorDesc const& desc, RGDescriptorType type)
+	{
+		auto it = texture_pool.find(texture);
+		ADRIA_ASSERT(it != texture_pool.end());
+		PooledTextureViews& views = it->second.views;
+		for (auto const& pooled_view : views)
+		{
+			if (pooled_view.type == type && pooled_view.desc == desc) return pooled_view.view;
+		}
+
+		GfxDescriptor view;
+		switch (type)
+		{
+		case RGDescriptorType::RenderTarget: view = device->CreateTextureRTV(texture, &desc); break;
+		case RGDescriptorType::DepthStencil: view = device->CreateTextureDSV(texture, &desc); break;
+		case RGDescriptorType::ReadOnly:	 view = device->CreateTextureSRV(texture, &desc); break;
+		case RGDescriptorType::ReadWrite:	 view = device->CreateTextureUAV(texture, &desc); break;
+		}
+		views.push_back({ desc, type, view });
+		return view;
+	}
+
+	GfxDescriptor RenderGraphResourcePool::GetBufferView(GfxBuffer* buffer, GfxBufferDescriptorDesc const& desc, RGDescriptorType type)
+	{
+		auto it = buffer_pool.find(buffer);
+		ADRIA_ASSERT(it != buffer_pool.end());
+		PooledBufferViews& views = it->second.views;
+		for (auto const& pooled_view : views)
+		{
+			if (pooled_view.type == type && pooled_view.desc == desc) return pooled_view.view;
+		}
+
+		ADRIA_ASSERT(type == RGDescriptorType::ReadOnly || type == RGDescriptorType::ReadWrite);
+		GfxDescriptor view = type == RGDescriptorType::ReadOnly ? device->CreateBufferSRV(buffer, &desc) : device->CreateBufferUAV(buffer, &desc);
+		views.push_back({ desc, type, view });
+		return view;
+	}
+
+	GfxTexture* RenderGraphResourcePool::FindFreeTexture(Uint64 bucket_key, GfxTextureDesc const& desc, Bool aliased, Uint64 heap_offset)
+	{
+		auto it = free_textures.find(bucket_key);
+		if (it == free_textures.end()) return nullptr;
+
+		std::vector<GfxTexture*>& textures = it->second;
+		for (Uint64 i = 0; i < textures.size(); ++i)
+		{
+			GfxTexture* texture = textures[i];
+			PooledTexture& pooled_texture = texture_pool[texture];
+			Bool const compatible = aliased ? (pooled_texture.heap_offset == heap_offset && pooled_texture.desc == desc) : texture->GetDesc().IsCompatible(desc);
+			if (!compatible) continue;
+
+			std::swap(textures[i], textures.back());
+			textures.pop_back();
+			pooled_texture.last_used_frame = frame_index;
+			pooled_texture.active = true;
+			MakeResident(texture->GetPageable(), pooled_texture.evicted);
+			return texture;
+		}
+		return nullptr;
+	}
+
+	void RenderGraphResourcePool::EvictTexture(GfxTexture const* texture)
+	{
+		auto it = texture_pool.find(texture);
+		if (it == texture_pool.end()) return;
+		if (it->second.evicted) device->GetResidencyManager()->Unregister(texture->GetPageable());
+		FreeViews(it->second.views);
+		texture_pool.erase(it);
+	}
+
+	void RenderGraphResourcePool::EvictBuffer(GfxBuffer const* buffer)
+	{
+		auto it = buffer_pool.find(buffer);
+		if (it == buffer_pool.end()) return;
+		if (it->second.evicted) device->GetResidencyManager()->Unregister(buffer->GetPageable());
+		FreeViews(it->second.views);
+		buffer_pool.erase(it);
+	}
+
+	Bool RenderGraphResourcePool::ShouldEvict(Uint64 last_used_frame, Bool memory_pressure) const
+	{
+		if ((RGPoolEvictionMode)PoolEvictionMode.Get() == RGPoolEvictionMode::MemoryPressure)
+		{
+			return memory_pressure && last_used_frame < frame_index;
+		}
+		return last_used_frame + (Uint64)std::max(PoolEvictionFrames.Get(), 0) < frame_index;
+	}
+
+	void RenderGraphResourcePool::TryEvictResidency(ID3D12Pageable* pageable, Uint64 last_used_frame, Bool& evicted)
+	{
+		//paging out is only legal once no frame in flight can reference the resource
+		if (evicted || last_used_frame + GFX_BACKBUFFER_COUNT >= frame_index) return;
+		device->GetResidencyManager()->Evict(pageable);
+		evicted = true;
+	}
+
+	void RenderGraphResourcePool::MakeResident(ID3D12Pageable* pageable, Bool& evicted)
+	{
+		if (!evicted) return;
+		device->GetResidencyManager()->MakeResident(pageable);
+		evicted = false;
+	}
+}
@@ -1,102 +1,136 @@
 #pragma once
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxTexture.h"
+#include "Graphics/GfxDevice.h"
+#include "RenderGraphAllocator.h"
+#include "RenderGraphResourceId.h"
 
 namespace adria
 {
+	inline constexpr GfxDescriptorHeapType GetDescriptorHeapType(RGDescriptorType type)
+	{
+		switch (type)
+		{
+		case RGDescriptorType::RenderTarget: return GfxDescriptorHeapType::RTV;
+		case RGDescriptorType::DepthStencil: return GfxDescriptorHeapType::DSV;
+		case RGDescriptorType::ReadOnly:
+		case RGDescriptorType::ReadWrite:
+		default:
+			return GfxDescriptorHeapType::CBV_SRV_UAV;
+		}
+	}
+
+	enum class RGPoolEvictionMode : Uint8
+	{
+		FrameAge,
+		MemoryPressure
+	};
+
 	class RenderGraphResourcePool
 	{
+		template<typename DescriptorDesc>
+		struct PooledView
+		{
+			DescriptorDesc desc;
+			RGDescriptorType type;
+			GfxDescriptor view;
+		};
+		using PooledTextureViews = std::vector<PooledView<GfxTextureDescriptorDesc>>;
+		using PooledBufferViews = std::vector<PooledView<GfxBufferDescriptorDesc>>;
+
 		struct PooledTexture
 		{
 			std::unique_ptr<GfxTexture> texture;
+			GfxTextureDesc desc;
 			Uint64 last_used_frame;
+			Uint64 bucket_key;
+			Uint64 heap_offset;
+			Bool aliased;
+			Bool active;
+			PooledTextureViews views;
+			Bool evicted = false;
 		};
 
 		struct PooledBuffer
 		{
 			std::unique_ptr<GfxBuffer> buffer;
 			Uint64 last_used_frame;
+			Uint64 bucket_key;
+			Bool active;
+			PooledBufferViews views;
+			Bool evicted = false;
+		};
+
+		struct TemporalTexture
+		{
+			std::unique_ptr<GfxTexture> textures[2];
+			Uint64 last_used_frame;
+			Uint32 current;
 		};
 
+		static constexpr Uint64 HEAP_SIZE_GRANULARITY = 64 * 1024 * 1024;
+
 	public:
 		explicit RenderGraphResourcePool(GfxDevice* device) : device(device) {}
+		ADRIA_NONCOPYABLE_NONMOVABLE(RenderGraphResourcePool)
+		~RenderGraphResourcePool();
 
-		void Tick()
-		{
-			for (Uint64 i = 0; i < texture_pool.size();)
-			{
-				PooledTexture& resource = texture_pool[i].first;
-				Bool active = texture_pool[i].second;
-				if (!active && resource.last_used_frame + 4 < frame_index)
-				{
-					std::swap(texture_pool[i], texture_pool.back());
-					texture_pool.pop_back();
-				}
-				else ++i;
-			}
-			++frame_index;
-		}
+		void Tick();
+		//after a resolution change most idle textures have the wrong size, releasing them right away avoids holding both sets for rg.PoolEvictionFrames
+		void EvictIdleTextures();
 
-		GfxTexture* AllocateTexture(GfxTextureDesc const& desc)
+		Bool SupportsTextureAliasing() const
 		{
-			for (auto& [pool_texture, active] : texture_pool)
-			{
-				if (!active && pool_texture.texture->GetDesc().IsCompatible(desc))
-				{
-					pool_texture.last_used_frame = frame_index;
-					active = true;
-					return pool_texture.texture.get();
-				}
-			}
-			auto& texture = texture_pool.emplace_back(std::pair{ PooledTexture{ std::make_unique<GfxTexture>(device, desc), frame_index}, true }).first.texture;
-			return texture.get();
-		}
-		void ReleaseTexture(GfxTexture* texture)
-		{
-			for (auto& [pooled_texture, active] : texture_pool)
-			{
-				auto& texture_ptr = pooled_texture.texture;
-				if (active && texture_ptr.get() == texture)
-				{
-					active = false;
-				}
-			}
+			return device->GetCapabilities().SupportsResourceHeapTier2();
 		}
+		void ReserveTransientHeap(Uint64 size);
+		Uint64 GetTransientHeapSize() const { return transient_heap_size; }
 
-		GfxBuffer* AllocateBuffer(GfxBufferDesc const& desc)
-		{
-			for (auto& [pool_buffer, active] : buffer_pool)
-			{
-				if (!active && pool_buffer.buffer->GetDesc() == desc)
-				{
-					pool_buffer.last_used_frame = frame_index;
-					active = true;
-					return pool_buffer.buffer.get();
-				}
-			}
-			auto& buffer = buffer_pool.emplace_back(std::pair{ PooledBuffer{ std::make_unique<GfxBuffer>(device, desc), frame_index}, true }).first.buffer;
-			return buffer.get();
-		}
-		void ReleaseBuffer(GfxBuffer* buffer)
-		{
-			for (auto& [pooled_buffer, active] : buffer_pool)
-			{
-				auto& buffer_ptr = pooled_buffer.buffer;
-				if (active && buffer_ptr.get() == buffer)
-				{
-					active = false;
-				}
-			}
-		}
+		GfxTexture* AllocateAliasedTexture(GfxTextureDesc const& desc, Uint64 heap_offset, Bool* pooled = nullptr);
+		GfxTexture* AllocateTexture(GfxTextureDesc const& desc, Bool* pooled = nullptr);
+		void ReleaseTexture(GfxTexture* texture);
+
+		GfxBuffer* AllocateBuffer(GfxBufferDesc const& desc, Bool* pooled = nullptr);
+		void ReleaseBuffer(GfxBuffer* buffer);
+
+		//temporal textures are ping-ponged once per frame and released as soon as a frame doesn't acquire them
+		Bool HasTemporalHistory(Uint64 key, GfxTextureDesc const& desc) const;
+		std::pair<GfxTexture*, GfxTexture*> AcquireTemporalTexture(Uint64 key, GfxTextureDesc const& desc);
+
+		GfxDescriptor GetTextureView(GfxTexture* texture, GfxTextureDescriptorDesc const& desc, RGDescriptorType type);
+		GfxDescriptor GetBufferView(GfxBuffer* buffer, GfxBufferDescriptorDesc const& desc, RGDescriptorType type);
 
 		GfxDevice* GetDevice() const { return device; }
+		RGAllocator& GetAllocator() { return allocator; }
 
 	private:
 		GfxDevice* device = nullptr;
+		RGAllocator allocator;
 		Uint64 frame_index = 0;
-		std::vector<std::pair<PooledTexture, Bool>> texture_pool;
-		std::vector<std::pair<PooledBuffer, Bool>>  buffer_pool;
+
+		std::unordered_map<GfxTexture const*, PooledTexture> texture_pool;
+		std::unordered_map<Uint64, std::vector<GfxTexture*>> free_textures;
+		std::unordered_map<GfxBuffer const*, PooledBuffer> buffer_pool;
+		std::unordered_map<Uint64, std::vector<GfxBuffer*>> free_buffers;
+		std::unordered_map<Uint64, TemporalTexture> temporal_textures;
+
+		ReleasablePtr<D3D12MA::Allocation> transient_heap = nullptr;
+		Uint64 transient_heap_size = 0;
+
+	private:
+		GfxTexture* FindFreeTexture(Uint64 bucket_key, GfxTextureDesc const& desc, Bool aliased, Uint64 heap_offset);
+		void EvictTexture(GfxTexture const* texture);
+		void EvictBuffer(GfxBuffer const* buffer);
+		Bool ShouldEvict(Uint64 last_used_frame, Bool memory_pressure) const;
+		void TryEvictResidency(ID3D12Pageable* pageable, Uint64 last_used_frame, Bool& evicted);
+		void MakeResident(ID3D12Pageable* pageable, Bool& evicted);
+
+		template<typename DescriptorDesc>
+		void FreeViews(std::vector<PooledView<DescriptorDesc>>& views)
+		{
+			for (auto const& pooled_view : views) device->FreeDescriptorCPU(pooled_view.view, GetDescriptorHeapType(pooled_view.type));
+			views.clear();
+		}
 	};
 	using RGResourcePool = RenderGraphResourcePool;
-
-}
\ No newline at end of file
+}
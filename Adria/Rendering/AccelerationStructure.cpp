@@ -1,108 +1,245 @@
 #include "AccelerationStructure.h"
 #include "Components.h"
+#include "OpacityMicromapBaker.h"
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Core/ConsoleManager.h"
+#include "Logging/Logger.h"
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> BLASCompaction("r.RayTracing.BLASCompaction", true, "Compact bottom level acceleration structures after they are built");
+	static TAutoConsoleVariable<Int> BLASScratchBudget("r.RayTracing.BLASScratchBudget", 64, "Size in MB of the scratch buffer shared by batched BLAS builds");
+	static TAutoConsoleVariable<Int> TLASMaxRefits("r.RayTracing.TLASMaxRefits", 32, "Number of TLAS refits after which the TLAS is fully rebuilt");
+
+	static Matrix GetObjectToWorld(SubMeshGPU const& submesh, Matrix const& world_transform)
+	{
+		if (submesh.vertex_layout != VertexLayout::Compact) return world_transform;
+		//compact BLAS is built from the quantized positions, dequantize through the instance transform
+		Matrix const dequantize = Matrix::CreateScale(Vector3(submesh.bounding_box.Extents)) * Matrix::CreateTranslation(Vector3(submesh.bounding_box.Center));
+		return dequantize * world_transform;
+	}
 
 	AccelerationStructure::AccelerationStructure(GfxDevice* gfx) : gfx(gfx)
 	{
 		build_fence.Create(gfx, "Build Fence");
-		++build_fence_value;
 	}
 
+	AccelerationStructure::~AccelerationStructure() = default;
+
 	void AccelerationStructure::AddInstance(Mesh const& mesh)
 	{
-		auto dynamic_allocator = gfx->GetDynamicAllocator();
-		blases.resize(mesh.instances.size());
 		Uint32 instance_id = 0;
 
 		GfxBuffer* geometry_buffer = g_GeometryBufferCache.GetGeometryBuffer(mesh.geometry_buffer_handle);
 		for (SubMeshInstance const& instance : mesh.instances)
 		{
-			SubMeshGPU const& submesh = mesh.submeshes[instance.submesh_index];
-			Material const& material = mesh.materials[submesh.material_index];
-
-			GfxRayTracingGeometry& rt_geometry = rt_geometries.emplace_back();
-			rt_geometry.vertex_buffer = geometry_buffer;
-			rt_geometry.vertex_buffer_offset = submesh.positions_offset;
-			rt_geometry.vertex_format = GfxFormat::R32G32B32_FLOAT;
-			rt_geometry.vertex_stride = GetGfxFormatStride(rt_geometry.vertex_format);
-			rt_geometry.vertex_count = submesh.vertices_count;
-
-			rt_geometry.index_buffer = geometry_buffer;
-			rt_geometry.index_buffer_offset = submesh.indices_offset;
-			rt_geometry.index_count = submesh.indices_count;
-			rt_geometry.index_format = GfxFormat::R32_UINT;
-			rt_geometry.opaque = material.alpha_mode == MaterialAlphaMode::Opaque;
+			SubMeshGPU const& instance_submesh = mesh.submeshes[instance.submesh_index];
+			Bool const deformable = (instance_submesh.skinned && instance.skin_index != UINT32_MAX) || (instance_submesh.morph_target_count > 0 && instance.node_index != UINT32_MAX);
+
+			//deformable instances are refit to their own pose and cannot share a BLAS
+			BLASKey const blas_key{ geometry_buffer, instance_submesh.positions_offset, deformable ? (Uint32)rt_instances.size() : UINT32_MAX };
+			auto [blas_it, inserted] = blas_map.try_emplace(blas_key, (Uint32)rt_geometries.size());
+			if (inserted)
+			{
+				SubMeshGPU const& submesh = mesh.submeshes[instance.submesh_index];
+				Material const& material = mesh.materials[submesh.material_index];
+
+				GfxRayTracingGeometry& rt_geometry = rt_geometries.emplace_back();
+				rt_geometry.vertex_buffer = geometry_buffer;
+				rt_geometry.vertex_buffer_offset = submesh.positions_offset;
+				rt_geometry.vertex_format = submesh.vertex_layout == VertexLayout::Compact ? GfxFormat::R16G16B16A16_SNORM : GfxFormat::R32G32B32_FLOAT;
+				rt_geometry.vertex_stride = GetGfxFormatStride(rt_geometry.vertex_format);
+				rt_geometry.vertex_count = submesh.vertices_count;
+
+				rt_geometry.index_buffer = geometry_buffer;
+				rt_geometry.index_buffer_offset = submesh.indices_offset;
+				rt_geometry.index_count = submesh.indices_count;
+				rt_geometry.index_format = GfxFormat::R32_UINT;
+				rt_geometry.opaque = material.alpha_mode == MaterialAlphaMode::Opaque;
+
+				//deformed triangles would no longer match the baked micro triangles
+				OpacityMicromapData const* micromap_data = instance.submesh_index < mesh.opacity_micromaps.size() ? mesh.opacity_micromaps[instance.submesh_index].get() : nullptr;
+				if (micromap_data && !deformable && !rt_geometry.opaque)
+				{
+					GfxOpacityMicromapArrayDesc micromap_array_desc{};
+					micromap_array_desc.micromaps = micromap_data->micromaps;
+					micromap_array_desc.triangle_indices = micromap_data->triangle_indices;
+					micromap_array_desc.micromap_count = micromap_data->micromap_count;
+					micromap_array_desc.subdivision_level = micromap_data->subdivision_level;
+					rt_geometry.opacity_micromap_array = opacity_micromap_arrays.emplace_back(std::make_unique<GfxRayTracingOpacityMicromapArray>(gfx, micromap_array_desc)).get();
+				}
+				rt_geometry_deformable.push_back(deformable);
+			}
+			rt_instance_blas_indices.push_back(blas_it->second);
 
 			GfxRayTracingInstance& rt_instance = rt_instances.emplace_back();
 			rt_instance.flags = GfxRayTracingInstanceFlag_None;
 			rt_instance.instance_id = instance_id++; //#todo temporary
 			rt_instance.instance_mask = 0xff;
-			const auto T = XMMatrixTranspose(instance.world_transform);
+			const auto T = XMMatrixTranspose(GetObjectToWorld(mesh.submeshes[instance.submesh_index], instance.world_transform));
 			memcpy(rt_instance.transform, &T, sizeof(T));
 		}
 	}
 
 	void AccelerationStructure::Build()
 	{
-		if (blases.empty()) return;
-		BuildBottomLevels();
-		for(auto& rt_instance : rt_instances) rt_instance.blas = blases[rt_instance.instance_id].get();
-		BuildTopLevel();
-		tlas_srv = gfx->CreateBufferSRV(&tlas->GetBuffer());
+		if (rt_geometries.empty()) return;
+
+		GfxRayTracingASFlags blas_flags = GfxRayTracingASFlag_PreferFastTrace;
+		if (BLASCompaction.Get()) blas_flags |= GfxRayTracingASFlag_AllowCompaction;
+
+		blas_builder = std::make_unique<GfxRayTracingBLASBuilder>(gfx, (Uint64)BLASScratchBudget.Get() * 1024 * 1024);
+		std::span<GfxRayTracingGeometry> geometry_span(rt_geometries);
+		for (Uint64 i = 0; i < geometry_span.size(); ++i)
+		{
+			blas_builder->AddBLAS(geometry_span.subspan(i, 1), rt_geometry_deformable[i] ? GfxRayTracingASFlag_PreferFastBuild | GfxRayTracingASFlag_AllowUpdate : blas_flags);
+		}
+		build_state = ASBuildState::Pending;
+	}
+
+	void AccelerationStructure::Update()
+	{
+		if (build_state == ASBuildState::Idle || build_state == ASBuildState::Ready) return;
+		if (build_state != ASBuildState::Pending && !build_fence.IsCompleted(build_fence_value)) return;
+
+		GfxCommandList* cmd_list = gfx->GetCommandList(GfxCommandListType::Compute);
+		switch (build_state)
+		{
+		case ASBuildState::Pending:
+			if (!opacity_micromap_arrays.empty())
+			{
+				for (auto& opacity_micromap_array : opacity_micromap_arrays) opacity_micromap_array->Build(cmd_list);
+				cmd_list->GlobalBarrier(GfxResourceState::ASWrite, GfxResourceState::ASWrite);
+				cmd_list->FlushBarriers();
+			}
+			blas_builder->Build(cmd_list);
+			build_state = blas_builder->NeedsCompaction() ? ASBuildState::BuildingBottomLevels : ASBuildState::CompactingBottomLevels;
+			break;
+		case ASBuildState::BuildingBottomLevels:
+			blas_builder->Compact(cmd_list);
+			ADRIA_LOG(INFO, "BLAS compaction: %llu KB -> %llu KB", blas_builder->GetBuiltSize() / 1024, blas_builder->GetCompactedSize() / 1024);
+			build_state = ASBuildState::CompactingBottomLevels;
+			break;
+		case ASBuildState::CompactingBottomLevels:
+			BuildTopLevel(cmd_list);
+			build_state = ASBuildState::BuildingTopLevel;
+			break;
+		case ASBuildState::BuildingTopLevel:
+			blas_builder.reset();
+			//the bottom levels keep referencing the micromap arrays, only their build inputs can go
+			for (auto& opacity_micromap_array : opacity_micromap_arrays) opacity_micromap_array->ReleaseBuildResources();
+			tlas_srv = gfx->CreateBufferSRV(&tlas->GetBuffer());
+			tlas_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+			gfx->CopyDescriptors(1, tlas_srv_gpu, tlas_srv);
+			build_state = ASBuildState::Ready;
+			return;
+		}
+		cmd_list->Signal(build_fence, ++build_fence_value);
 	}
 
 	void AccelerationStructure::Clear()
 	{
+		if (build_state != ASBuildState::Idle && build_state != ASBuildState::Pending) build_fence.Wait(build_fence_value);
+		build_state = ASBuildState::Idle;
+		blas_builder.reset();
+		gfx->FreePersistentDescriptorGPU(tlas_srv_gpu);
+		tlas_srv_gpu = GfxDescriptor{};
 		blases.clear();
+		opacity_micromap_arrays.clear();
+		blas_map.clear();
 		rt_geometries.clear();
+		rt_geometry_deformable.clear();
 		rt_instances.clear();
+		rt_instance_blas_indices.clear();
+		dirty_instances.clear();
+		pending_refits.clear();
+		refit_count = 0;
 		tlas = nullptr;
 	}
 
-	Int32 AccelerationStructure::GetTLASIndex() const
+	void AccelerationStructure::SetInstanceTransform(Uint32 instance_index, SubMeshGPU const& submesh, Matrix const& world_transform)
 	{
-		GfxDescriptor tlas_srv_gpu = gfx->AllocateDescriptorsGPU();
-		gfx->CopyDescriptors(1, tlas_srv_gpu, tlas_srv);
-		return (Int32)tlas_srv_gpu.GetIndex();
+		ADRIA_ASSERT(instance_index < rt_instances.size());
+		GfxRayTracingInstance& rt_instance = rt_instances[instance_index];
+		const auto T = XMMatrixTranspose(GetObjectToWorld(submesh, world_transform));
+		if (memcmp(rt_instance.transform, &T, sizeof(T)) == 0) return;
+
+		memcpy(rt_instance.transform, &T, sizeof(T));
+		dirty_instances.push_back(instance_index);
 	}
 
-	void AccelerationStructure::BuildBottomLevels()
+	void AccelerationStructure::RefitInstance(Uint32 instance_index, GfxBuffer* vertex_buffer, Uint32 positions_offset)
 	{
-		GfxCommandList* cmd_list = gfx->GetCommandList();
+		ADRIA_ASSERT(instance_index < rt_instances.size());
+		ADRIA_ASSERT(rt_geometry_deformable[rt_instance_blas_indices[instance_index]]);
+		pending_refits.push_back(BLASRefit{ .instance_index = instance_index, .vertex_buffer = vertex_buffer, .positions_offset = positions_offset });
+		dirty_instances.push_back(instance_index);
+	}
 
-		std::span<GfxRayTracingGeometry> geometry_span(rt_geometries);
-		for (Uint64 i = 0; i < blases.size(); ++i)
+	void AccelerationStructure::AddTLASUpdatePass(RenderGraph& rg)
+	{
+		if (!IsReady() || !tlas->AllowsUpdate() || dirty_instances.empty())
 		{
-			blases[i] = gfx->CreateRayTracingBLAS(geometry_span.subspan(i, 1), GfxRayTracingASFlag_PreferFastTrace);
+			pending_refits.clear();
+			return;
 		}
-		cmd_list->Signal(build_fence, build_fence_value);
-		cmd_list->End();
-		cmd_list->Submit();
+
+		std::sort(dirty_instances.begin(), dirty_instances.end());
+		dirty_instances.erase(std::unique(dirty_instances.begin(), dirty_instances.end()), dirty_instances.end());
+
+		Bool const rebuild = refit_count >= (Uint32)TLASMaxRefits.Get();
+		refit_count = rebuild ? 0 : refit_count + 1;
+
+		rg.AddPass<void>("TLAS Update Pass",
+			[=](RenderGraphBuilder& builder)
+			{
+			},
+			[=, this, dirty_instances = std::move(dirty_instances), pending_refits = std::move(pending_refits)](RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				if (!pending_refits.empty())
+				{
+					for (BLASRefit const& refit : pending_refits)
+					{
+						Uint32 const blas_index = rt_instance_blas_indices[refit.instance_index];
+						GfxRayTracingGeometry geometry = rt_geometries[blas_index];
+						geometry.vertex_buffer = refit.vertex_buffer;
+						geometry.vertex_buffer_offset = refit.positions_offset;
+						geometry.vertex_format = GfxFormat::R32G32B32_FLOAT;
+						geometry.vertex_stride = GetGfxFormatStride(geometry.vertex_format);
+						blases[blas_index]->Update(cmd_list, std::span<GfxRayTracingGeometry const>(&geometry, 1), GfxRayTracingASFlag_PreferFastBuild | GfxRayTracingASFlag_AllowUpdate);
+					}
+					cmd_list->GlobalBarrier(GfxResourceState::ASWrite, GfxResourceState::ASRead);
+					cmd_list->FlushBarriers();
+				}
+
+				std::span<GfxRayTracingInstance const> instances(rt_instances);
+				for (Uint64 i = 0; i < dirty_instances.size();)
+				{
+					Uint64 range_end = i + 1;
+					while (range_end < dirty_instances.size() && dirty_instances[range_end] == dirty_instances[range_end - 1] + 1) ++range_end;
+
+					Uint32 const first_instance = dirty_instances[i];
+					tlas->UpdateInstances(cmd_list, instances.subspan(first_instance, range_end - i), first_instance);
+					i = range_end;
+				}
+				tlas->Update(cmd_list, rebuild);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+		dirty_instances.clear();
+		pending_refits.clear();
 	}
 
-	void AccelerationStructure::BuildTopLevel()
+	Int32 AccelerationStructure::GetTLASIndex() const
 	{
-		GfxCommandList* cmd_list = gfx->GetCommandList();
-		cmd_list->Begin();
-
-		build_fence.Wait(build_fence_value);
-		++build_fence_value;
-
-		tlas = gfx->CreateRayTracingTLAS(rt_instances, GfxRayTracingASFlag_PreferFastTrace);
-
-		cmd_list->Signal(build_fence, build_fence_value);
-		cmd_list->End();
-		cmd_list->Submit();
-
-		build_fence.Wait(build_fence_value);
-		++build_fence_value;
+		return (Int32)tlas_srv_gpu.GetIndex();
+	}
 
-		cmd_list->Begin();
+	void AccelerationStructure::BuildTopLevel(GfxCommandList* cmd_list)
+	{
+		blases = blas_builder->GetBLASes();
+		for (Uint64 i = 0; i < rt_instances.size(); ++i) rt_instances[i].blas = blases[rt_instance_blas_indices[i]].get();
+		tlas = gfx->CreateRayTracingTLAS(rt_instances, GfxRayTracingASFlag_PreferFastTrace | GfxRayTracingASFlag_AllowUpdate, cmd_list);
 	}
 }
-
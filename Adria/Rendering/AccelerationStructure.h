@@ -1,43 +1,106 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include "Graphics/GfxFence.h"
 #include "Graphics/GfxDescriptor.h"
 #include "Graphics/GfxRayTracingAS.h"
+#include "Utilities/HashUtil.h"
 
 namespace adria
 {
 	class GfxDevice;
 	class GfxBuffer;
+	class GfxCommandList;
+	class GfxRayTracingBLASBuilder;
+	class RenderGraph;
 	struct Mesh;
+	struct SubMeshGPU;
 
 	class AccelerationStructure
 	{
 
 	public:
 		explicit AccelerationStructure(GfxDevice* gfx);
+		~AccelerationStructure();
 
 		void AddInstance(Mesh const& mesh);
 		void Build();
+		void Update();
 		void Clear();
+		Bool IsReady() const { return build_state == ASBuildState::Ready; }
+
+		void SetInstanceTransform(Uint32 instance_index, SubMeshGPU const& submesh, Matrix const& world_transform);
+		//refits the BLAS of a deformable instance from float3 positions written by the skinning pass
+		void RefitInstance(Uint32 instance_index, GfxBuffer* vertex_buffer, Uint32 positions_offset);
+		void AddTLASUpdatePass(RenderGraph& rg);
 
 		Int32 GetTLASIndex() const;
+		Uint32 GetInstanceCount() const { return (Uint32)rt_instances.size(); }
+
+	private:
+		enum class ASBuildState : Uint8
+		{
+			Idle,
+			Pending,
+			BuildingBottomLevels,
+			CompactingBottomLevels,
+			BuildingTopLevel,
+			Ready
+		};
+
+	private:
+		struct BLASRefit
+		{
+			Uint32 instance_index;
+			GfxBuffer* vertex_buffer;
+			Uint32 positions_offset;
+		};
+		//deformable instances get their instance index as owner, all other instances of a submesh share the key
+		struct BLASKey
+		{
+			GfxBuffer const* geometry_buffer;
+			Uint32 positions_offset;
+			Uint32 owner_instance;
+			Bool operator==(BLASKey const&) const = default;
+		};
+		struct BLASKeyHash
+		{
+			Uint64 operator()(BLASKey const& key) const
+			{
+				HashState hash{};
+				hash.Combine(key.geometry_buffer);
+				hash.Combine(key.positions_offset);
+				hash.Combine(key.owner_instance);
+				return hash;
+			}
+		};
 
 	private:
 		GfxDevice* gfx;
+		std::unique_ptr<GfxRayTracingBLASBuilder> blas_builder;
 		std::vector<GfxRayTracingGeometry> rt_geometries;
+		std::vector<Bool> rt_geometry_deformable;
 		std::vector<std::unique_ptr<GfxRayTracingBLAS>> blases;
+		std::vector<std::unique_ptr<GfxRayTracingOpacityMicromapArray>> opacity_micromap_arrays;
+		std::unordered_map<BLASKey, Uint32, BLASKeyHash> blas_map;
 
 		std::vector<GfxRayTracingInstance> rt_instances;
+		std::vector<Uint32> rt_instance_blas_indices;
 		std::unique_ptr<GfxRayTracingTLAS> tlas;
 		GfxDescriptor tlas_srv;
+		GfxDescriptor tlas_srv_gpu;
+		std::vector<Uint32> dirty_instances;
+		std::vector<BLASRefit> pending_refits;
+		Uint32 refit_count = 0;
 
 		GfxFence build_fence;
 		Uint64 build_fence_value = 0;
+		ASBuildState build_state = ASBuildState::Idle;
+
 	private:
-		void BuildBottomLevels();
-		void BuildTopLevel();
+		void BuildTopLevel(GfxCommandList* cmd_list);
 	};
 }
\ No newline at end of file
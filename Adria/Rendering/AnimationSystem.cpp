@@ -0,0 +1,106 @@
+#include "AnimationSystem.h"
+#include "Components.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	namespace
+	{
+		struct KeyFrame
+		{
+			Uint32 key0;
+			Uint32 key1;
+			Float  factor;
+		};
+
+		KeyFrame FindKeyFrame(Skeleton const& skeleton, AnimationChannel const& channel, Float time)
+		{
+			Float const* key_times = skeleton.key_times.data() + channel.first_key;
+			Float const* next_key = std::upper_bound(key_times, key_times + channel.key_count, time);
+			if (next_key == key_times) return KeyFrame{ 0, 0, 0.0f };
+			if (next_key == key_times + channel.key_count) return KeyFrame{ channel.key_count - 1, channel.key_count - 1, 0.0f };
+
+			Uint32 const key1 = (Uint32)(next_key - key_times);
+			Uint32 const key0 = key1 - 1;
+			if (channel.interpolation == AnimationInterpolation::Step) return KeyFrame{ key0, key0, 0.0f };
+			Float const key_duration = key_times[key1] - key_times[key0];
+			return KeyFrame{ key0, key1, key_duration > 0.0f ? (time - key_times[key0]) / key_duration : 0.0f };
+		}
+	}
+
+	AnimationSystem::AnimationSystem(entt::registry& reg) : reg(reg) {}
+
+	AnimationSystem::~AnimationSystem() = default;
+
+	void AnimationSystem::Update(Float dt)
+	{
+		posed_entities.clear();
+		for (auto entity : reg.view<Skeleton>())
+		{
+			Skeleton& skeleton = reg.get<Skeleton>(entity);
+			Bool const has_clip = skeleton.active_clip >= 0 && skeleton.active_clip < (Int32)skeleton.clips.size();
+			Bool const playing = skeleton.playing && has_clip;
+			if (!playing && !skeleton.node_transforms.empty()) continue;
+
+			if (playing)
+			{
+				Float const duration = skeleton.clips[skeleton.active_clip].duration;
+				skeleton.time = duration > 0.0f ? std::fmod(skeleton.time + dt * skeleton.speed, duration) : 0.0f;
+				if (skeleton.time < 0.0f) skeleton.time += duration;
+			}
+			EvaluatePose(skeleton);
+			posed_entities.push_back(entity);
+		}
+	}
+
+	void AnimationSystem::EvaluatePose(Skeleton& skeleton)
+	{
+		Uint64 const node_count = skeleton.nodes.size();
+		std::vector<SkeletonNode> pose = skeleton.nodes;
+		skeleton.pose_morph_weights = skeleton.morph_weights;
+
+		if (skeleton.active_clip >= 0 && skeleton.active_clip < (Int32)skeleton.clips.size())
+		{
+			AnimationClip const& clip = skeleton.clips[skeleton.active_clip];
+			for (Uint32 i = clip.first_channel; i < clip.first_channel + clip.channel_count; ++i)
+			{
+				AnimationChannel const& channel = skeleton.channels[i];
+				SkeletonNode& node = pose[channel.node];
+				KeyFrame const key_frame = FindKeyFrame(skeleton, channel, skeleton.time);
+				Float const* value0 = skeleton.key_values.data() + channel.first_value + key_frame.key0 * channel.value_stride;
+				Float const* value1 = skeleton.key_values.data() + channel.first_value + key_frame.key1 * channel.value_stride;
+				switch (channel.path)
+				{
+				case AnimationPath::Translation:
+					node.translation = Vector3::Lerp(Vector3(value0), Vector3(value1), key_frame.factor);
+					break;
+				case AnimationPath::Rotation:
+					node.rotation = Quaternion::Slerp(Quaternion(value0), Quaternion(value1), key_frame.factor);
+					node.rotation.Normalize();
+					break;
+				case AnimationPath::Scale:
+					node.scale = Vector3::Lerp(Vector3(value0), Vector3(value1), key_frame.factor);
+					break;
+				case AnimationPath::MorphWeights:
+				{
+					Uint32 const weight_count = std::min(channel.value_stride, node.morph_weight_count);
+					for (Uint32 w = 0; w < weight_count; ++w)
+					{
+						skeleton.pose_morph_weights[node.first_morph_weight + w] = value0[w] + (value1[w] - value0[w]) * key_frame.factor;
+					}
+				}
+				break;
+				}
+			}
+		}
+
+		//parents precede their children, so their model space transform is always resolved first
+		skeleton.node_transforms.resize(node_count);
+		for (Uint64 i = 0; i < node_count; ++i)
+		{
+			SkeletonNode const& node = pose[i];
+			Matrix const local_transform = Matrix::CreateScale(node.scale) * Matrix::CreateFromQuaternion(node.rotation) * Matrix::CreateTranslation(node.translation);
+			skeleton.node_transforms[i] = node.parent >= 0 ? local_transform * skeleton.node_transforms[node.parent] : local_transform;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <span>
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	struct Skeleton;
+
+	//samples the active clip of every Skeleton and resolves the model space node transforms of the pose,
+	//skeletons that are paused keep their pose and are only evaluated once
+	class AnimationSystem
+	{
+	public:
+		explicit AnimationSystem(entt::registry& reg);
+		~AnimationSystem();
+
+		void Update(Float dt);
+
+		std::span<entt::entity const> GetPosedEntities() const { return posed_entities; }
+
+	private:
+		entt::registry& reg;
+		std::vector<entt::entity> posed_entities;
+
+	private:
+		static void EvaluatePose(Skeleton& skeleton);
+	};
+}
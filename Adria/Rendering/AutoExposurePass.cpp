@@ -5,6 +5,7 @@
 #include "RenderGraph/RenderGraph.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxReadbackQueue.h"
 #include "Graphics/GfxPipelineState.h"
 #include "Editor/GUICommand.h"
 #include "Core/ConsoleManager.h"
@@ -15,14 +16,28 @@ namespace adria
 	static TAutoConsoleVariable<Float> MinLogLuminance("r.AutoExposure.MinLogLuminance", -5.0f, "Min Log Luminance for Auto Exposure");
 	static TAutoConsoleVariable<Float> MaxLogLuminance("r.AutoExposure.MaxLogLuminance", 20.0f, "Max Log Luminance for Auto Exposure");
 	static TAutoConsoleVariable<Float> AdaptionSpeed("r.AutoExposure.AdaptionSpeed", 2.5f, "Adaption Speed for Auto Exposure");
+	static TAutoConsoleVariable<Int>   HistogramMip("r.AutoExposure.HistogramMip", 2, "Mip of the scene color the luminance histogram is built from, 0 - full resolution");
 
-	AutoExposurePass::AutoExposurePass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	AutoExposurePass::AutoExposurePass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), spd_pass(gfx)
 	{
 		CreatePSOs();
 	}
 
 	void AutoExposurePass::AddPass(RenderGraph& rg, PostProcessor* postprocessor)
 	{
+		//the histogram only needs the luminance distribution, an averaged mip of the scene keeps it close while touching a fraction of the pixels
+		RGResourceName histogram_source = postprocessor->GetFinalResource();
+		Uint32 const histogram_mip = (Uint32)std::clamp(HistogramMip.Get(), 0, 4);
+		Uint32 const histogram_width = std::max(1u, width >> histogram_mip);
+		Uint32 const histogram_height = std::max(1u, height >> histogram_mip);
+		if (histogram_mip > 0)
+		{
+			std::vector<RGResourceName> luminance_mips(histogram_mip);
+			for (Uint32 i = 0; i < histogram_mip; ++i) luminance_mips[i] = RG_NAME_IDX(AutoExposureSceneMip, i + 1);
+			spd_pass.AddPass(rg, histogram_source, luminance_mips, GfxFormat::R16G16B16A16_FLOAT, SPDReductionOp::Average, "Auto Exposure");
+			histogram_source = luminance_mips.back();
+		}
+
 		struct BuildHistogramData
 		{
 			RGTextureReadOnlyId scene_texture;
@@ -32,7 +47,7 @@ namespace adria
 		rg.AddPass<BuildHistogramData>("Build Histogram Pass",
 			[=](BuildHistogramData& data, RenderGraphBuilder& builder)
 			{
-				data.scene_texture = builder.ReadTexture(postprocessor->GetFinalResource());
+				data.scene_texture = builder.ReadTexture(histogram_source);
 
 				RGBufferDesc desc{};
 				desc.stride = sizeof(Uint32);
@@ -70,15 +85,16 @@ namespace adria
 					Float   log_luminance_range_rcp;
 					Uint32  scene_idx;
 					Uint32  histogram_idx;
-				} constants = { .width = width, .height = height,
-								.rcp_width = 1.0f / width, .rcp_height = 1.0f / height,
+				} constants = { .width = histogram_width, .height = histogram_height,
+								.rcp_width = 1.0f / histogram_width, .rcp_height = 1.0f / histogram_height,
 								.min_log_luminance = MinLogLuminance.Get(), .log_luminance_range_rcp = 1.0f/ (MaxLogLuminance.Get() - MinLogLuminance.Get()),
 								.scene_idx = descriptor_index, .histogram_idx = descriptor_index + 1 };
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
-			}, RGPassType::Compute, RGPassFlags::None);
+				cmd_list->Dispatch(DivideAndRoundUp(histogram_width, 16), DivideAndRoundUp(histogram_height, 16), 1);
+			}, RGPassType::ComputeAsync, RGPassFlags::None);
 
 		rg.ImportTexture(RG_NAME(AverageLuminance), luminance_texture.get());
+		rg.ImportTexture(RG_NAME(Exposure), exposure_texture.get());
 
 		struct HistogramReductionData
 		{
@@ -93,15 +109,10 @@ namespace adria
 			{
 				data.histogram_buffer = builder.ReadBuffer(RG_NAME(HistogramBuffer));
 				data.avg_luminance = builder.WriteTexture(RG_NAME(AverageLuminance));
-
-				RGTextureDesc desc{};
-				desc.width = desc.height = 1;
-				desc.format = GfxFormat::R16_FLOAT;
-				builder.DeclareTexture(RG_NAME(Exposure), desc);
 				data.exposure = builder.WriteTexture(RG_NAME(Exposure));
 
-				RGTextureDesc const& scene_desc = builder.GetTextureDesc(postprocessor->GetFinalResource());
-				data.pixel_count = scene_desc.width * scene_desc.height;
+				RGTextureDesc const& histogram_desc = builder.GetTextureDesc(histogram_source);
+				data.pixel_count = histogram_desc.width * histogram_desc.height;
 			},
 			[=](HistogramReductionData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
 			{
@@ -143,7 +154,26 @@ namespace adria
 				cmd_list->Dispatch(1, 1, 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		if (show_histogram) rg.ExportBuffer(RG_NAME(HistogramBuffer), histogram_copy.get());
+		if (!show_histogram) return;
+
+		struct HistogramReadbackData
+		{
+			RGBufferCopySrcId histogram_buffer;
+		};
+		rg.AddPass<HistogramReadbackData>("Histogram Readback Pass",
+			[=](HistogramReadbackData& data, RenderGraphBuilder& builder)
+			{
+				data.histogram_buffer = builder.ReadCopySrcBuffer(RG_NAME(HistogramBuffer));
+			},
+			[=](HistogramReadbackData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxBuffer const& histogram_buffer = context.GetCopySrcBuffer(data.histogram_buffer);
+				gfx->GetReadbackQueue()->Enqueue(cmd_list, histogram_buffer, 0, histogram_buffer.GetSize(), [this](void const* readback_data, Uint64 size)
+					{
+						Int32 const* histogram = static_cast<Int32 const*>(readback_data);
+						histogram_data.assign(histogram, histogram + size / sizeof(Int32));
+					});
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
 	}
 
 	void AutoExposurePass::OnSceneInitialized()
@@ -159,12 +189,9 @@ namespace adria
 
 		luminance_texture = gfx->CreateTexture(desc);
 
-		GfxBufferDesc hist_desc{};
-		hist_desc.stride = sizeof(Uint32);
-		hist_desc.size = hist_desc.stride * 256;
-		hist_desc.misc_flags = GfxBufferMiscFlag::BufferRaw;
-		hist_desc.resource_usage = GfxResourceUsage::Readback;
-		histogram_copy = gfx->CreateBuffer(hist_desc);
+		//exposure stays on the GPU across frames, passes recorded before the reduction read the previous frame's value
+		desc.bind_flags = GfxBindFlag::UnorderedAccess | GfxBindFlag::ShaderResource;
+		exposure_texture = gfx->CreateTexture(desc);
 	}
 
 	void AutoExposurePass::GUI()
@@ -179,8 +206,9 @@ namespace adria
 					{
 						ImGui::DragFloatRange2("Log Luminance", MinLogLuminance.GetPtr(), MaxLogLuminance.GetPtr(), 1.0f, -100, 50);
 						ImGui::SliderFloat("Adaption Speed", AdaptionSpeed.GetPtr(), 0.01f, 5.0f);
+						ImGui::SliderInt("Histogram Mip", HistogramMip.GetPtr(), 0, 4);
 						ImGui::Checkbox("Histogram", &show_histogram);
-						if (show_histogram)
+						if (show_histogram && !histogram_data.empty())
 						{
 							auto MaxElement = [](Int32* array, Uint64 count)
 								{
@@ -192,9 +220,8 @@ namespace adria
 									return max_element;
 								};
 
-							ADRIA_ASSERT(histogram_copy->IsMapped());
-							Uint64 histogram_size = histogram_copy->GetSize() / sizeof(Int32);
-							Int32* hist_data = histogram_copy->GetMappedData<Int32>();
+							Uint64 histogram_size = histogram_data.size();
+							Int32* hist_data = histogram_data.data();
 							Int32 max_value = MaxElement(hist_data, histogram_size);
 							auto converter = [](void* data, Int32 idx)-> Float
 								{
@@ -1,5 +1,6 @@
 #pragma once
 #include "PostEffect.h"
+#include "SPDPass.h"
 #include "Graphics/GfxDescriptor.h"
 
 namespace adria
@@ -25,13 +26,15 @@ namespace adria
 		GfxDevice* gfx;
 		Uint32 width, height;
 		std::unique_ptr<GfxTexture> luminance_texture;
-		std::unique_ptr<GfxBuffer> histogram_copy;
+		std::unique_ptr<GfxTexture> exposure_texture;
+		std::vector<Int32> histogram_data;
 		Bool invalid_history = true;
 
 		std::unique_ptr<GfxComputePipelineState> build_histogram_pso;
 		std::unique_ptr<GfxComputePipelineState> histogram_reduction_pso;
 		std::unique_ptr<GfxComputePipelineState> exposure_pso;
 		Bool show_histogram		= false;
+		SPDPass spd_pass;
 
 	private:
 		void CreatePSOs();
@@ -18,6 +18,28 @@ namespace adria
 		Uint64						frame_cbuffer_address;
 	};
 
+	struct HZBBlackboardData
+	{
+		DirectX::XMMATRIX			hzb_view_projection;
+		Uint32						hzb_width;
+		Uint32						hzb_height;
+		Uint32						hzb_mip_count;
+	};
+
+	//lights occupy OcclusionQueryResults[light_query_offset + light_index]
+	struct OcclusionQueryBlackboardData
+	{
+		Uint32 light_query_offset;
+	};
+
+	//added once the clustered light lists are built, forward passes then read LightGrid and LightList
+	struct LightClusterBlackboardData
+	{
+		Uint32 cluster_size_x;
+		Uint32 cluster_size_y;
+		Uint32 cluster_size_z;
+	};
+
 	struct DoFBlackboardData
 	{
 		Float dof_focus_distance;
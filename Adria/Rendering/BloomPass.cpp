@@ -17,8 +17,10 @@ namespace adria
 	static TAutoConsoleVariable<Float> BloomRadius("r.Bloom.Radius", 0.25f, "Controls the radius of the bloom effect");
 	static TAutoConsoleVariable<Float> BloomIntensity("r.Bloom.Intensity", 1.33f, "Controls the intensity of the bloom effect");
 	static TAutoConsoleVariable<Float> BloomBlendFactor("r.Bloom.BlendFactor", 0.25f, "Controls the blend factor of the bloom effect");
+	static TAutoConsoleVariable<Bool>  BloomSinglePassDownsample("r.Bloom.SinglePassDownsample", true, "Build the bloom downsample chain with one SPD dispatch instead of one dispatch per mip");
+	static TAutoConsoleVariable<Bool>  BloomFusedUpsample("r.Bloom.FusedUpsample", true, "Upsample the low bloom mips in one dispatch instead of one dispatch per mip");
 
-	BloomPass::BloomPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	BloomPass::BloomPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), spd_pass(gfx)
 	{
 		CreatePSOs();
 	}
@@ -28,16 +30,40 @@ namespace adria
 	{
 		Uint32 pass_count = (Uint32)std::floor(log2f((Float)std::max(width, height))) - 3;
 		std::vector<RGResourceName> downsample_mips(pass_count);
-		downsample_mips[0] = DownsamplePass(rg, postprocessor->GetFinalResource(), 1);
-		for (Uint32 i = 1; i < pass_count; ++i)
+		if (BloomSinglePassDownsample.Get())
 		{
-			downsample_mips[i] = DownsamplePass(rg, downsample_mips[i - 1], i + 1);
+			for (Uint32 i = 0; i < pass_count; ++i) downsample_mips[i] = RG_NAME_IDX(BloomDownsample, i + 1);
+			spd_pass.AddPass(rg, postprocessor->GetFinalResource(), downsample_mips, GfxFormat::R16G16B16A16_FLOAT, SPDReductionOp::KarisAverage, "Bloom Downsample");
+		}
+		else
+		{
+			downsample_mips[0] = DownsamplePass(rg, postprocessor->GetFinalResource(), 1);
+			for (Uint32 i = 1; i < pass_count; ++i)
+			{
+				downsample_mips[i] = DownsamplePass(rg, downsample_mips[i - 1], i + 1);
+			}
 		}
 
 		std::vector<RGResourceName> upsample_mips(pass_count);
 		upsample_mips[pass_count - 1] = downsample_mips[pass_count - 1];
 
-		for (Int32 i = pass_count - 2; i >= 0; --i)
+		Int32 first_unfused_mip = pass_count - 2;
+		if (BloomFusedUpsample.Get())
+		{
+			Uint32 first_fused_mip = pass_count - 1;
+			while (first_fused_mip > 0 && pass_count - first_fused_mip <= MAX_FUSED_UPSAMPLE_LEVELS &&
+				   (std::max(width, height) >> first_fused_mip) <= FUSED_UPSAMPLE_MAX_DIMENSION)
+			{
+				--first_fused_mip;
+			}
+			if (pass_count - 1 - first_fused_mip > 1)
+			{
+				FusedUpsamplePass(rg, downsample_mips, upsample_mips, first_fused_mip);
+				first_unfused_mip = (Int32)first_fused_mip - 1;
+			}
+		}
+
+		for (Int32 i = first_unfused_mip; i >= 0; --i)
 		{
 			upsample_mips[i] = UpsamplePass(rg, downsample_mips[i], upsample_mips[i + 1], i + 1);
 		}
@@ -68,6 +94,8 @@ namespace adria
 						ImGui::SliderFloat("Bloom Radius", BloomRadius.GetPtr(), 0.0f, 1.0f);
 						ImGui::SliderFloat("Bloom Intensity", BloomIntensity.GetPtr(), 0.0f, 8.0f);
 						ImGui::SliderFloat("Bloom Blend Factor", BloomBlendFactor.GetPtr(), 0.0f, 1.0f);
+						ImGui::Checkbox("Single Pass Downsample", BloomSinglePassDownsample.GetPtr());
+						ImGui::Checkbox("Fused Upsample", BloomFusedUpsample.GetPtr());
 					}
 					ImGui::TreePop();
 					ImGui::Separator();
@@ -85,6 +113,9 @@ namespace adria
 
 		compute_pso_desc.CS = CS_BloomUpsample;
 		upsample_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_BloomUpsampleFused;
+		fused_upsample_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 	}
 
 	RGResourceName BloomPass::DownsamplePass(RenderGraph& rg, RGResourceName input, Uint32 pass_idx)
@@ -225,5 +256,99 @@ namespace adria
 		return output;
 	}
 
+	void BloomPass::FusedUpsamplePass(RenderGraph& rg, std::vector<RGResourceName> const& downsample_mips, std::vector<RGResourceName>& upsample_mips, Uint32 first_mip)
+	{
+		Uint32 const mip_count = (Uint32)upsample_mips.size();
+		Uint32 const level_count = mip_count - 1 - first_mip;
+		ADRIA_ASSERT(level_count <= MAX_FUSED_UPSAMPLE_LEVELS);
+
+		//levels go from low to high resolution, level l writes upsample mip mip_count - 2 - l
+		RGResourceName lowest_input = upsample_mips[mip_count - 1];
+		RGResourceName high_inputs[MAX_FUSED_UPSAMPLE_LEVELS];
+		RGResourceName outputs[MAX_FUSED_UPSAMPLE_LEVELS];
+		Uint32 level_dims[MAX_FUSED_UPSAMPLE_LEVELS][2];
+		for (Uint32 level = 0; level < level_count; ++level)
+		{
+			Uint32 const mip = mip_count - 2 - level;
+			high_inputs[level] = downsample_mips[mip];
+			outputs[level] = mip != 0 ? RG_NAME_IDX(BloomUpsample, mip + 1) : RG_NAME(Bloom);
+			level_dims[level][0] = std::max(1u, width >> (mip + 1));
+			level_dims[level][1] = std::max(1u, height >> (mip + 1));
+			upsample_mips[mip] = outputs[level];
+		}
+
+		struct BloomFusedUpsamplePassData
+		{
+			RGTextureReadOnlyId  input_lowest;
+			RGTextureReadOnlyId  inputs_high[MAX_FUSED_UPSAMPLE_LEVELS];
+			RGTextureReadWriteId outputs[MAX_FUSED_UPSAMPLE_LEVELS];
+		};
+
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		rg.AddPass<BloomFusedUpsamplePassData>("Bloom Fused Upsample Pass",
+			[=](BloomFusedUpsamplePassData& data, RenderGraphBuilder& builder)
+			{
+				data.input_lowest = builder.ReadTexture(lowest_input, ReadAccess_NonPixelShader);
+				for (Uint32 level = 0; level < level_count; ++level)
+				{
+					data.inputs_high[level] = builder.ReadTexture(high_inputs[level], ReadAccess_NonPixelShader);
+
+					RGTextureDesc desc{};
+					desc.width = level_dims[level][0];
+					desc.height = level_dims[level][1];
+					desc.format = GfxFormat::R16G16B16A16_FLOAT;
+					builder.DeclareTexture(outputs[level], desc);
+					data.outputs[level] = builder.WriteTexture(outputs[level]);
+				}
+			},
+			[=](BloomFusedUpsamplePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(1 + 2 * level_count);
+				Uint32 const i = dst_descriptor.GetIndex();
+				gfx->CopyDescriptors(1, dst_descriptor, ctx.GetReadOnlyTexture(data.input_lowest));
+				for (Uint32 level = 0; level < level_count; ++level)
+				{
+					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1 + 2 * level), ctx.GetReadOnlyTexture(data.inputs_high[level]));
+					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 2 + 2 * level), ctx.GetReadWriteTexture(data.outputs[level]));
+				}
+
+				struct BloomFusedUpsampleLevel
+				{
+					Uint32 width;
+					Uint32 height;
+					Uint32 high_input_idx;
+					Uint32 output_idx;
+				};
+				struct BloomFusedUpsampleConstants
+				{
+					Uint32 level_count;
+					Uint32 lowest_input_idx;
+					Float  radius;
+					Uint32 _pad;
+					BloomFusedUpsampleLevel levels[MAX_FUSED_UPSAMPLE_LEVELS];
+				} constants{};
+				constants.level_count = level_count;
+				constants.lowest_input_idx = i;
+				constants.radius = BloomRadius.Get();
+				for (Uint32 level = 0; level < level_count; ++level)
+				{
+					constants.levels[level] =
+					{
+						.width = level_dims[level][0],
+						.height = level_dims[level][1],
+						.high_input_idx = i + 1 + 2 * level,
+						.output_idx = i + 2 + 2 * level
+					};
+				}
+
+				cmd_list->SetPipelineState(fused_upsample_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
 }
 
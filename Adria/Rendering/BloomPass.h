@@ -1,5 +1,6 @@
 #pragma once
 #include "PostEffect.h"
+#include "SPDPass.h"
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 namespace adria
@@ -9,6 +10,10 @@ namespace adria
 
 	class BloomPass : public PostEffect
 	{
+		//the low mips are upsampled by a single thread group that walks them with a barrier between levels
+		static constexpr Uint32 MAX_FUSED_UPSAMPLE_LEVELS = 6;
+		static constexpr Uint32 FUSED_UPSAMPLE_MAX_DIMENSION = 128;
+
 	public:
 		BloomPass(GfxDevice* gfx, Uint32 w, Uint32 h);
 		~BloomPass();
@@ -23,12 +28,15 @@ namespace adria
 		Uint32 width, height;
 		std::unique_ptr<GfxComputePipelineStatePermutations> downsample_psos;
 		std::unique_ptr<GfxComputePipelineState> upsample_pso;
+		std::unique_ptr<GfxComputePipelineState> fused_upsample_pso;
+		SPDPass spd_pass;
 
 	private:
 		void CreatePSOs();
 
 		RGResourceName DownsamplePass(RenderGraph& rendergraph, RGResourceName input, Uint32 pass_idx);
 		RGResourceName UpsamplePass(RenderGraph& rendergraph, RGResourceName input, RGResourceName, Uint32 pass_idx);
+		void FusedUpsamplePass(RenderGraph& rendergraph, std::vector<RGResourceName> const& downsample_mips, std::vector<RGResourceName>& upsample_mips, Uint32 first_mip);
 	};
 
 	
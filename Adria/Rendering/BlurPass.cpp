@@ -5,11 +5,57 @@
 #include "ShaderManager.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
 
+using namespace DirectX;
 
 namespace adria
 {
+	namespace
+	{
+		//x - weight, y - offset in texels from the center, w of the first element holds the tap count
+		DECLSPEC_ALIGN(16)
+		struct BlurKernelConstants
+		{
+			XMFLOAT4 taps[BlurPass::MAX_RADIUS + 1];
+		};
+
+		Uint32 BuildKernel(BlurKernel const& kernel, Bool fold_taps, BlurKernelConstants& constants)
+		{
+			Uint32 const radius = std::clamp(kernel.radius, 1u, BlurPass::MAX_RADIUS);
+			Float const sigma = std::max(kernel.sigma, 0.01f);
+
+			Float weights[BlurPass::MAX_RADIUS + 1];
+			Float weight_sum = 0.0f;
+			for (Uint32 i = 0; i <= radius; ++i)
+			{
+				weights[i] = expf(-Float(i * i) / (2.0f * sigma * sigma));
+				weight_sum += i == 0 ? weights[i] : 2.0f * weights[i];
+			}
+			for (Uint32 i = 0; i <= radius; ++i) weights[i] /= weight_sum;
+
+			Uint32 tap_count = 0;
+			constants.taps[tap_count++] = XMFLOAT4(weights[0], 0.0f, 0.0f, 0.0f);
+			if (!fold_taps)
+			{
+				for (Uint32 i = 1; i <= radius; ++i) constants.taps[tap_count++] = XMFLOAT4(weights[i], Float(i), 0.0f, 0.0f);
+			}
+			else
+			{
+				//two neighbouring taps are fetched with one bilinear sample placed between them by their weights
+				for (Uint32 i = 1; i <= radius; i += 2)
+				{
+					Float const w0 = weights[i];
+					Float const w1 = i + 1 <= radius ? weights[i + 1] : 0.0f;
+					Float const w = w0 + w1;
+					constants.taps[tap_count++] = XMFLOAT4(w, (i * w0 + (i + 1) * w1) / w, 0.0f, 0.0f);
+				}
+			}
+			constants.taps[0].w = Float(tap_count);
+			return radius;
+		}
+	}
 
 	BlurPass::BlurPass(GfxDevice* gfx) : gfx(gfx)
 	{
@@ -19,9 +65,20 @@ namespace adria
 	BlurPass::~BlurPass() = default;
 
 	void BlurPass::AddPass(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture,
-		Char const* pass_name)
+		Char const* pass_name, RGPassType pass_type, BlurKernel const& kernel)
+	{
+		AddBlurPasses(rendergraph, src_texture, blurred_texture, nullptr, pass_name, pass_type, kernel);
+	}
+
+	void BlurPass::AddBilateralPass(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture, BlurBilateralInputs const& bilateral,
+		Char const* pass_name, RGPassType pass_type, BlurKernel const& kernel)
 	{
+		AddBlurPasses(rendergraph, src_texture, blurred_texture, &bilateral, pass_name, pass_type, kernel);
+	}
 
+	void BlurPass::AddBlurPasses(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture, BlurBilateralInputs const* bilateral_inputs,
+		Char const* pass_name, RGPassType pass_type, BlurKernel const& kernel)
+	{
 		static Uint64 counter = 0;
 		counter++;
 
@@ -29,98 +86,90 @@ namespace adria
 		std::string vertical_name = "Vertical Blur Pass " + std::string(pass_name);
 		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
 
+		Bool const bilateral = bilateral_inputs != nullptr;
+		BlurBilateralInputs const bilateral_data = bilateral ? *bilateral_inputs : BlurBilateralInputs{};
+		BlurKernelConstants kernel_constants{};
+		Uint32 const radius = BuildKernel(kernel, !bilateral, kernel_constants);
+
 		struct BlurPassData
 		{
 			RGTextureReadOnlyId src_texture;
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
 			RGTextureReadWriteId dst_texture;
 		};
 
-		rendergraph.AddPass<BlurPassData>(horizontal_name.c_str(),
-			[=](BlurPassData& data, RenderGraphBuilder& builder)
-			{
-				RGTextureDesc blur_desc = builder.GetTextureDesc(src_texture);
-
-				builder.DeclareTexture(RG_NAME_IDX(Intermediate, counter), blur_desc);
-				data.dst_texture = builder.WriteTexture(RG_NAME_IDX(Intermediate, counter));
-				data.src_texture = builder.ReadTexture(src_texture, ReadAccess_NonPixelShader);
-			},
-			[=](BlurPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-				GfxTextureDesc const& src_desc = context.GetTexture(*data.src_texture).GetDesc();
-
-				GfxDescriptor src_descriptors[] =
-				{
-					context.GetReadOnlyTexture(data.src_texture),
-					context.GetReadWriteTexture(data.dst_texture)
-				};
-				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
-				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
-				Uint32 const i = dst_descriptor.GetIndex();
-
-				struct BlurConstants
-				{
-					Uint32 input_idx;
-					Uint32 output_idx;
-				} constants =
-				{
-					.input_idx = i, .output_idx = i + 1
-				};
-
-				cmd_list->SetPipelineState(blur_horizontal_pso.get());
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(src_desc.width, 1024), src_desc.height, 1);
-			}, RGPassType::Compute, RGPassFlags::None);
-
-		rendergraph.AddPass<BlurPassData>(vertical_name.c_str(),
-			[=](BlurPassData& data, RenderGraphBuilder& builder)
-			{
-				RGTextureDesc blur_desc = builder.GetTextureDesc(src_texture);
-				builder.DeclareTexture(blurred_texture, blur_desc);
-				data.dst_texture = builder.WriteTexture(blurred_texture);
-				data.src_texture = builder.ReadTexture(RG_NAME_IDX(Intermediate, counter), ReadAccess_NonPixelShader);
-			},
-			[=](BlurPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-				GfxTextureDesc const& src_desc = context.GetTexture(*data.src_texture).GetDesc();
-
-				GfxDescriptor src_descriptors[] =
-				{
-					context.GetReadOnlyTexture(data.src_texture),
-					context.GetReadWriteTexture(data.dst_texture)
-				};
-				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
-				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
-				Uint32 const i = dst_descriptor.GetIndex();
-
-				struct BlurConstants
+		auto AddDirectionPass = [&](Char const* name, RGResourceName input, RGResourceName output, Bool horizontal)
+		{
+			rendergraph.AddPass<BlurPassData>(name,
+				[=](BlurPassData& data, RenderGraphBuilder& builder)
 				{
-					Uint32 input_idx;
-					Uint32 output_idx;
-				} constants =
+					RGTextureDesc blur_desc = builder.GetTextureDesc(src_texture);
+					builder.DeclareTexture(output, blur_desc);
+					data.dst_texture = builder.WriteTexture(output);
+					data.src_texture = builder.ReadTexture(input, ReadAccess_NonPixelShader);
+					if (bilateral)
+					{
+						data.depth = builder.ReadTexture(bilateral_data.depth, ReadAccess_NonPixelShader);
+						data.normal = builder.ReadTexture(bilateral_data.normal, ReadAccess_NonPixelShader);
+					}
+				},
+				[=](BlurPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
 				{
-					.input_idx = i, .output_idx = i + 1
-				};
-
-				cmd_list->SetPipelineState(blur_vertical_pso.get());
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(src_desc.width, DivideAndRoundUp(src_desc.height, 1024), 1);
-
-			}, RGPassType::Compute, RGPassFlags::None);
+					GfxDevice* gfx = cmd_list->GetDevice();
+					GfxTextureDesc const& src_desc = context.GetTexture(*data.src_texture).GetDesc();
+
+					GfxDescriptor src_descriptors[] =
+					{
+						context.GetReadOnlyTexture(data.src_texture),
+						context.GetReadWriteTexture(data.dst_texture),
+						bilateral ? context.GetReadOnlyTexture(data.depth) : context.GetReadOnlyTexture(data.src_texture),
+						bilateral ? context.GetReadOnlyTexture(data.normal) : context.GetReadOnlyTexture(data.src_texture)
+					};
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+					Uint32 const i = dst_descriptor.GetIndex();
+
+					struct BlurConstants
+					{
+						Uint32 input_idx;
+						Uint32 output_idx;
+						Uint32 depth_idx;
+						Uint32 normal_idx;
+						Uint32 radius;
+						Float  depth_sigma;
+						Float  normal_power;
+					} constants =
+					{
+						.input_idx = i, .output_idx = i + 1, .depth_idx = i + 2, .normal_idx = i + 3,
+						.radius = radius, .depth_sigma = bilateral_data.depth_sigma, .normal_power = bilateral_data.normal_power
+					};
+
+					GfxComputePipelineStatePermutations* psos = horizontal ? blur_horizontal_psos.get() : blur_vertical_psos.get();
+					if (bilateral) psos->AddDefine("BLUR_BILATERAL", "1");
+					cmd_list->SetPipelineState(psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->SetRootCBV(2, kernel_constants);
+					if (horizontal) cmd_list->Dispatch(DivideAndRoundUp(src_desc.width, TILE_SIZE), src_desc.height, 1);
+					else cmd_list->Dispatch(src_desc.width, DivideAndRoundUp(src_desc.height, TILE_SIZE), 1);
+				}, pass_type, RGPassFlags::None);
+		};
 
+		AddDirectionPass(horizontal_name.c_str(), src_texture, RG_NAME_IDX(Intermediate, counter), true);
+		AddDirectionPass(vertical_name.c_str(), RG_NAME_IDX(Intermediate, counter), blurred_texture, false);
 	}
 
 	void BlurPass::CreatePSOs()
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_Blur_Horizontal;
-		blur_horizontal_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS.AddDefine("BLUR_TILE_SIZE", std::to_string(TILE_SIZE).c_str());
+		blur_horizontal_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 
 		compute_pso_desc.CS = CS_Blur_Vertical;
-		blur_vertical_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS.AddDefine("BLUR_TILE_SIZE", std::to_string(TILE_SIZE).c_str());
+		blur_vertical_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 	}
 
-}
\ No newline at end of file
+}
@@ -1,25 +1,53 @@
 #pragma once
 #include "RenderGraph/RenderGraphResourceName.h"
+#include "RenderGraph/RenderGraphPass.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 namespace adria
 {
 	class GfxDevice;
-	class GfxComputePipelineState;
 	class RenderGraph;
 
+	struct BlurKernel
+	{
+		Uint32 radius = 6;
+		Float  sigma = 3.0f;
+	};
+
+	//edge stopping inputs of the bilateral blur, they have to match the resolution of the blurred texture
+	struct BlurBilateralInputs
+	{
+		RGResourceName depth;
+		RGResourceName normal;
+		Float depth_sigma = 1.0f;
+		Float normal_power = 32.0f;
+	};
+
+	//separable gaussian blur over groupshared tiles. The plain variant folds pairs of taps into a single bilinear fetch,
+	//the bilateral variant keeps discrete taps and weights them by depth and normal similarity
 	class BlurPass
 	{
+	public:
+		static constexpr Uint32 MAX_RADIUS = 16;
+		static constexpr Uint32 TILE_SIZE = 256;
+
 	public:
 		explicit BlurPass(GfxDevice* gfx);
 		~BlurPass();
 
-		void AddPass(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture, Char const* pass_name = "");
+		void AddPass(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture, Char const* pass_name = "", RGPassType pass_type = RGPassType::Compute, 
+					 BlurKernel const& kernel = {});
+		void AddBilateralPass(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture, BlurBilateralInputs const& bilateral,
+							  Char const* pass_name = "", RGPassType pass_type = RGPassType::Compute, BlurKernel const& kernel = {});
 
 	private:
 		GfxDevice* gfx;
-		std::unique_ptr<GfxComputePipelineState> blur_horizontal_pso;
-		std::unique_ptr<GfxComputePipelineState> blur_vertical_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> blur_horizontal_psos;
+		std::unique_ptr<GfxComputePipelineStatePermutations> blur_vertical_psos;
+
 	private:
 		void CreatePSOs();
+		void AddBlurPasses(RenderGraph& rendergraph, RGResourceName src_texture, RGResourceName blurred_texture, BlurBilateralInputs const* bilateral,
+						   Char const* pass_name, RGPassType pass_type, BlurKernel const& kernel);
 	};
-}
\ No newline at end of file
+}
@@ -11,14 +11,7 @@ namespace adria
 	Camera::Camera(CameraParameters const& desc) 
 		: position(desc.position), aspect_ratio(1.0f), fov(desc.fov), near_plane(desc.far_plane), far_plane(desc.near_plane), enabled(true), changed(false)
 	{
-		Vector3 look_vector = desc.look_at - position;
-		look_vector.Normalize();
-
-		Float yaw = std::atan2(look_vector.x, look_vector.z);
-		Float pitch = std::asin(std::clamp(-look_vector.y, -1.0f, 1.0f));
-		Quaternion pitch_quat = Quaternion::CreateFromYawPitchRoll(0, pitch, 0);
-		Quaternion yaw_quat = Quaternion::CreateFromYawPitchRoll(yaw, 0, 0);
-		orientation = pitch_quat * orientation * yaw_quat;
+		SetLookAt(desc.look_at);
 	}
 
 	Vector3 Camera::Forward() const
@@ -125,6 +118,21 @@ namespace adria
 	{
 		position = pos;
 	}
+	void Camera::SetLookAt(Vector3 const& look_at)
+	{
+		Vector3 look_vector = look_at - position;
+		look_vector.Normalize();
+
+		Float yaw = std::atan2(look_vector.x, look_vector.z);
+		Float pitch = std::asin(std::clamp(-look_vector.y, -1.0f, 1.0f));
+		Quaternion pitch_quat = Quaternion::CreateFromYawPitchRoll(0, pitch, 0);
+		Quaternion yaw_quat = Quaternion::CreateFromYawPitchRoll(yaw, 0, 0);
+		orientation = pitch_quat * yaw_quat;
+
+		Matrix view_inverse = Matrix::CreateFromQuaternion(orientation) * Matrix::CreateTranslation(position);
+		view_inverse.Invert(view_matrix);
+		changed = true;
+	}
 
 	Matrix Camera::View() const
 	{
@@ -2,12 +2,14 @@
 #include "ShaderStructs.h"
 #include "Components.h"
 #include "BlackboardData.h"
+#include "FFXVRSPass.h"
 #include "ShaderManager.h" 
 #include "Graphics/GfxCommon.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Math/Packing.h"
+#include "Utilities/HashUtil.h"
 #include "Logging/Logger.h"
 #include "entt/entity/registry.hpp"
 
@@ -31,92 +33,20 @@ namespace adria
 		: reg(reg), gfx(gfx), width(w), height(h),
 		clusters(gfx, StructuredBufferDesc<ClusterAABB>(CLUSTER_COUNT)),
 		light_counter(gfx, StructuredBufferDesc<Uint32>(1)),
-		light_list(gfx, StructuredBufferDesc<Uint32>(CLUSTER_COUNT * CLUSTER_MAX_LIGHTS)),
 		light_grid(gfx, StructuredBufferDesc<LightGrid>(CLUSTER_COUNT))
 	{
+		light_list = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(INITIAL_LIGHT_LIST_SIZE));
+		for (Uint32 i = 0; i < gfx->GetBackbufferCount(); ++i)
+		{
+			light_counter_readback_buffers.emplace_back(gfx->CreateBuffer(ReadBackBufferDesc(sizeof(Uint32))));
+		}
 		CreatePSOs();
 	}
 
-	void ClusteredDeferredLightingPass::AddPass(RenderGraph& rendergraph, Bool recreate_clusters)
+	void ClusteredDeferredLightingPass::AddPass(RenderGraph& rendergraph)
 	{
 		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
-
-		rendergraph.ImportBuffer(RG_NAME(ClustersBuffer), &clusters);
-		rendergraph.ImportBuffer(RG_NAME(LightCounter), &light_counter);
-		rendergraph.ImportBuffer(RG_NAME(LightGrid), &light_grid);
-		rendergraph.ImportBuffer(RG_NAME(LightList), &light_list);
-
-		struct ClusterBuildingPassData
-		{
-			RGBufferReadWriteId clusters;
-		};
-
-		if (recreate_clusters)
-		{
-			rendergraph.AddPass<ClusterBuildingPassData>("Cluster Building Pass",
-				[=](ClusterBuildingPassData& data, RenderGraphBuilder& builder)
-				{
-					data.clusters = builder.WriteBuffer(RG_NAME(ClustersBuffer));
-				},
-				[=](ClusterBuildingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
-				{
-					GfxDevice* gfx = cmd_list->GetDevice();
-					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU();
-					gfx->CopyDescriptors(1, dst_descriptor, context.GetReadWriteBuffer(data.clusters));
-
-					cmd_list->SetPipelineState(clustered_building_pso.get());
-					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-					cmd_list->SetRootConstant(1, dst_descriptor.GetIndex(), 0);
-					cmd_list->Dispatch(CLUSTER_SIZE_X, CLUSTER_SIZE_Y, CLUSTER_SIZE_Z);
-				}, RGPassType::Compute, RGPassFlags::None);
-		}
-
-		struct ClusterCullingPassData
-		{
-			RGBufferReadOnlyId  clusters;
-			RGBufferReadWriteId light_counter;
-			RGBufferReadWriteId light_grid;
-			RGBufferReadWriteId light_list;
-		};
-		rendergraph.AddPass<ClusterCullingPassData>("Cluster Culling Pass",
-			[=](ClusterCullingPassData& data, RenderGraphBuilder& builder)
-			{
-				data.clusters = builder.ReadBuffer(RG_NAME(ClustersBuffer), ReadAccess_NonPixelShader);
-				data.light_counter = builder.WriteBuffer(RG_NAME(LightCounter));
-				data.light_grid = builder.WriteBuffer(RG_NAME(LightGrid));
-				data.light_list = builder.WriteBuffer(RG_NAME(LightList));
-			},
-			[=](ClusterCullingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-
-				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.clusters),
-												context.GetReadWriteBuffer(data.light_counter),
-												context.GetReadWriteBuffer(data.light_list),
-												context.GetReadWriteBuffer(data.light_grid) };
-	
-				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
-				gfx->CopyDescriptors(dst_handle, src_handles);
-
-				Uint32 i = dst_handle.GetIndex();
-				struct ClusterCullingConstants
-				{
-					Uint32 clusters_idx;
-					Uint32 light_index_counter_idx;
-					Uint32 light_index_list_idx;
-					Uint32 light_grid_idx;
-				} constants =
-				{
-					.clusters_idx = i, .light_index_counter_idx = i + 1,
-					.light_index_list_idx = i + 2, .light_grid_idx = i + 3
-				};
-
-				cmd_list->SetPipelineState(clustered_culling_pso.get());
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(CLUSTER_SIZE_X / 16, CLUSTER_SIZE_Y / 16, CLUSTER_SIZE_Z / 1);
-
-			}, RGPassType::Compute, RGPassFlags::None);
+		AddLightCullingPasses(rendergraph);
 
 		struct ClusteredDeferredLightingPassData
 		{
@@ -151,6 +81,11 @@ namespace adria
 				if (builder.IsTextureDeclared(RG_NAME(AmbientOcclusion)))
 					data.ambient_occlusion = builder.ReadTexture(RG_NAME(AmbientOcclusion), ReadAccess_NonPixelShader);
 				else data.ambient_occlusion.Invalidate();
+				if (builder.IsTextureDeclared(RG_NAME(ReSTIR_GI_Irradiance))) std::ignore = builder.ReadTexture(RG_NAME(ReSTIR_GI_Irradiance), ReadAccess_NonPixelShader);
+
+				if (builder.IsTextureDeclared(RG_NAME(VRSTileMask)))
+					data.vrs_tile_mask = builder.ReadTexture(RG_NAME(VRSTileMask), ReadAccess_NonPixelShader);
+				else data.vrs_tile_mask.Invalidate();
 
 				data.output = builder.WriteTexture(RG_NAME(HDR_RenderTarget));
 			},
@@ -194,25 +129,390 @@ namespace adria
 				};
 				ADRIA_ASSERT(i + 8 < UINT32_MAX);
 
-				cmd_list->SetPipelineState(clustered_lighting_pso.get());
+				cmd_list->SetPipelineState(data.vrs_tile_mask.IsValid() ? clustered_lighting_vrs_pso.get() : clustered_lighting_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
+				if (data.vrs_tile_mask.IsValid())
+				{
+					GfxDescriptor vrs_dst_handle = gfx->AllocateDescriptorsGPU();
+					gfx->CopyDescriptors(1, vrs_dst_handle, context.GetReadOnlyTexture(data.vrs_tile_mask));
+
+					struct SoftwareVRSConstants
+					{
+						Uint32 vrs_tile_mask_idx;
+						Uint32 vrs_tile_size;
+					} vrs_constants =
+					{
+						.vrs_tile_mask_idx = vrs_dst_handle.GetIndex(), .vrs_tile_size = FFXVRSPass::SOFTWARE_VRS_TILE_SIZE
+					};
+					cmd_list->SetRootCBV(3, vrs_constants);
+				}
 				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
+	void ClusteredDeferredLightingPass::AddLightCullingPasses(RenderGraph& rendergraph)
+	{
+		if (rendergraph.GetBlackboard().TryGet<LightClusterBlackboardData>()) return;
+
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+		OcclusionQueryBlackboardData const* occlusion_data = rendergraph.GetBlackboard().TryGet<OcclusionQueryBlackboardData>();
+		Uint32 const light_query_offset = occlusion_data ? occlusion_data->light_query_offset : 0;
+
+		//cluster AABBs are in view space so they only depend on the projection and the viewport
+		HashState projection_hash;
+		projection_hash.Combine(frame_data.camera_fov);
+		projection_hash.Combine(frame_data.camera_aspect_ratio);
+		projection_hash.Combine(frame_data.camera_near);
+		projection_hash.Combine(frame_data.camera_far);
+		projection_hash.Combine(width);
+		projection_hash.Combine(height);
+		Bool const recreate_clusters = clusters_projection_hash != projection_hash;
+		clusters_projection_hash = projection_hash;
+
+		GrowLightList();
+
+		rendergraph.ImportBuffer(RG_NAME(ClustersBuffer), &clusters);
+		rendergraph.ImportBuffer(RG_NAME(LightCounter), &light_counter);
+		rendergraph.ImportBuffer(RG_NAME(LightGrid), &light_grid);
+		rendergraph.ImportBuffer(RG_NAME(LightList), light_list.get());
+
+		struct ClusterBuildingPassData
+		{
+			RGBufferReadWriteId clusters;
+		};
+
+		if (recreate_clusters)
+		{
+			rendergraph.AddPass<ClusterBuildingPassData>("Cluster Building Pass",
+				[=](ClusterBuildingPassData& data, RenderGraphBuilder& builder)
+				{
+					data.clusters = builder.WriteBuffer(RG_NAME(ClustersBuffer));
+				},
+				[=](ClusterBuildingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU();
+					gfx->CopyDescriptors(1, dst_descriptor, context.GetReadWriteBuffer(data.clusters));
+
+					cmd_list->SetPipelineState(clustered_building_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstant(1, dst_descriptor.GetIndex(), 0);
+					cmd_list->Dispatch(CLUSTER_SIZE_X, CLUSTER_SIZE_Y, CLUSTER_SIZE_Z);
+				}, RGPassType::Compute, RGPassFlags::None);
+		}
+
+		struct ClusterMarkActivePassData
+		{
+			RGTextureReadOnlyId depth;
+			RGBufferReadWriteId cluster_flags;
+			RGBufferReadWriteId light_counter;
+		};
+		rendergraph.AddPass<ClusterMarkActivePassData>("Cluster Mark Active Pass",
+			[=](ClusterMarkActivePassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc cluster_flags_desc{};
+				cluster_flags_desc.resource_usage = GfxResourceUsage::Default;
+				cluster_flags_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				cluster_flags_desc.stride = sizeof(Uint32);
+				cluster_flags_desc.size = CLUSTER_COUNT * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(ClusterActiveFlags), cluster_flags_desc);
+
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.cluster_flags = builder.WriteBuffer(RG_NAME(ClusterActiveFlags));
+				data.light_counter = builder.WriteBuffer(RG_NAME(LightCounter));
+			},
+			[=, assign_all_clusters = assign_all_clusters](ClusterMarkActivePassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.depth),
+												context.GetReadWriteBuffer(data.cluster_flags),
+												context.GetReadWriteBuffer(data.light_counter) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				Uint32 clear[] = { 0, 0, 0, 0 };
+				Uint32 mark_all[] = { 1, 1, 1, 1 };
+				cmd_list->ClearUAV(context.GetBuffer(*data.cluster_flags), gfx->GetDescriptorGPU(i + 1), context.GetReadWriteBuffer(data.cluster_flags), assign_all_clusters ? mark_all : clear);
+				cmd_list->ClearUAV(context.GetBuffer(*data.light_counter), gfx->GetDescriptorGPU(i + 2), context.GetReadWriteBuffer(data.light_counter), clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+				if (assign_all_clusters) return;
+
+				struct ClusterMarkActiveConstants
+				{
+					Uint32 depth_idx;
+					Uint32 cluster_flags_idx;
+				} constants =
+				{
+					.depth_idx = i, .cluster_flags_idx = i + 1
+				};
+
+				cmd_list->SetPipelineState(cluster_mark_active_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct ClusterCompactPassData
+		{
+			RGBufferReadOnlyId  cluster_flags;
+			RGBufferReadWriteId active_clusters;
+			RGBufferReadWriteId cluster_cull_args;
+		};
+		rendergraph.AddPass<ClusterCompactPassData>("Cluster Compact Pass",
+			[=](ClusterCompactPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc active_clusters_desc{};
+				active_clusters_desc.resource_usage = GfxResourceUsage::Default;
+				active_clusters_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				active_clusters_desc.stride = sizeof(Uint32);
+				active_clusters_desc.size = CLUSTER_COUNT * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(ActiveClusters), active_clusters_desc);
+
+				RGBufferDesc cluster_cull_args_desc{};
+				cluster_cull_args_desc.resource_usage = GfxResourceUsage::Default;
+				cluster_cull_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				cluster_cull_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+				cluster_cull_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
+				builder.DeclareBuffer(RG_NAME(ClusterCullArgs), cluster_cull_args_desc);
+
+				data.cluster_flags = builder.ReadBuffer(RG_NAME(ClusterActiveFlags), ReadAccess_NonPixelShader);
+				data.active_clusters = builder.WriteBuffer(RG_NAME(ActiveClusters));
+				data.cluster_cull_args = builder.WriteBuffer(RG_NAME(ClusterCullArgs));
+			},
+			[=](ClusterCompactPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.cluster_flags),
+												context.GetReadWriteBuffer(data.active_clusters),
+												context.GetReadWriteBuffer(data.cluster_cull_args) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct ClusterCompactConstants
+				{
+					Uint32 cluster_flags_idx;
+					Uint32 active_clusters_idx;
+					Uint32 cluster_cull_args_idx;
+					Uint32 cluster_count;
+				} constants =
+				{
+					.cluster_flags_idx = i, .active_clusters_idx = i + 1,
+					.cluster_cull_args_idx = i + 2, .cluster_count = CLUSTER_COUNT
+				};
+
+				cmd_list->SetPipelineState(cluster_compact_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct ClusterLightCountPassData
+		{
+			RGBufferReadOnlyId     clusters;
+			RGBufferReadOnlyId     active_clusters;
+			RGBufferIndirectArgsId cluster_cull_args;
+			RGBufferReadWriteId    light_grid;
+			RGBufferReadOnlyId     light_visibility;
+		};
+		rendergraph.AddPass<ClusterLightCountPassData>("Cluster Light Count Pass",
+			[=](ClusterLightCountPassData& data, RenderGraphBuilder& builder)
+			{
+				data.clusters = builder.ReadBuffer(RG_NAME(ClustersBuffer), ReadAccess_NonPixelShader);
+				data.active_clusters = builder.ReadBuffer(RG_NAME(ActiveClusters), ReadAccess_NonPixelShader);
+				data.cluster_cull_args = builder.ReadIndirectArgsBuffer(RG_NAME(ClusterCullArgs));
+				data.light_grid = builder.WriteBuffer(RG_NAME(LightGrid));
+				if (occlusion_data) data.light_visibility = builder.ReadBuffer(RG_NAME(OcclusionQueryResults), ReadAccess_NonPixelShader);
+				else data.light_visibility.Invalidate();
+			},
+			[=](ClusterLightCountPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.clusters),
+												context.GetReadOnlyBuffer(data.active_clusters),
+												context.GetReadWriteBuffer(data.light_grid) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles) + 1);
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+				if (data.light_visibility.IsValid()) gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + ARRAYSIZE(src_handles)), context.GetReadOnlyBuffer(data.light_visibility));
+
+				struct ClusterLightCountConstants
+				{
+					Uint32 clusters_idx;
+					Uint32 active_clusters_idx;
+					Uint32 light_grid_idx;
+					Int32  light_visibility_idx;
+					Uint32 light_query_offset;
+				} constants =
+				{
+					.clusters_idx = i, .active_clusters_idx = i + 1, .light_grid_idx = i + 2,
+					.light_visibility_idx = data.light_visibility.IsValid() ? Int32(i + 3) : -1, .light_query_offset = light_query_offset
+				};
+
+				cmd_list->SetPipelineState(cluster_light_count_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				GfxBuffer const& cluster_cull_args = context.GetIndirectArgsBuffer(data.cluster_cull_args);
+				cmd_list->DispatchIndirect(cluster_cull_args, 0);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct ClusterPrefixSumPassData
+		{
+			RGBufferReadOnlyId  cluster_flags;
+			RGBufferReadWriteId light_grid;
+			RGBufferReadWriteId light_counter;
+		};
+		rendergraph.AddPass<ClusterPrefixSumPassData>("Cluster Prefix Sum Pass",
+			[=](ClusterPrefixSumPassData& data, RenderGraphBuilder& builder)
+			{
+				data.cluster_flags = builder.ReadBuffer(RG_NAME(ClusterActiveFlags), ReadAccess_NonPixelShader);
+				data.light_grid = builder.WriteBuffer(RG_NAME(LightGrid));
+				data.light_counter = builder.WriteBuffer(RG_NAME(LightCounter));
+			},
+			[=, light_list_capacity = light_list->GetCount()](ClusterPrefixSumPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.cluster_flags),
+												context.GetReadWriteBuffer(data.light_grid),
+												context.GetReadWriteBuffer(data.light_counter) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct ClusterPrefixSumConstants
+				{
+					Uint32 cluster_flags_idx;
+					Uint32 light_grid_idx;
+					Uint32 light_counter_idx;
+					Uint32 light_list_capacity;
+				} constants =
+				{
+					.cluster_flags_idx = i, .light_grid_idx = i + 1,
+					.light_counter_idx = i + 2, .light_list_capacity = light_list_capacity
+				};
+
+				cmd_list->SetPipelineState(cluster_prefix_sum_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct ClusterLightAssignPassData
+		{
+			RGBufferReadOnlyId     clusters;
+			RGBufferReadOnlyId     active_clusters;
+			RGBufferIndirectArgsId cluster_cull_args;
+			RGBufferReadWriteId    light_grid;
+			RGBufferReadWriteId    light_list;
+			RGBufferReadOnlyId     light_visibility;
+		};
+		rendergraph.AddPass<ClusterLightAssignPassData>("Cluster Light Assign Pass",
+			[=](ClusterLightAssignPassData& data, RenderGraphBuilder& builder)
+			{
+				data.clusters = builder.ReadBuffer(RG_NAME(ClustersBuffer), ReadAccess_NonPixelShader);
+				data.active_clusters = builder.ReadBuffer(RG_NAME(ActiveClusters), ReadAccess_NonPixelShader);
+				data.cluster_cull_args = builder.ReadIndirectArgsBuffer(RG_NAME(ClusterCullArgs));
+				data.light_grid = builder.WriteBuffer(RG_NAME(LightGrid));
+				data.light_list = builder.WriteBuffer(RG_NAME(LightList));
+				if (occlusion_data) data.light_visibility = builder.ReadBuffer(RG_NAME(OcclusionQueryResults), ReadAccess_NonPixelShader);
+				else data.light_visibility.Invalidate();
+			},
+			[=](ClusterLightAssignPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.clusters),
+												context.GetReadOnlyBuffer(data.active_clusters),
+												context.GetReadWriteBuffer(data.light_grid),
+												context.GetReadWriteBuffer(data.light_list) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles) + 1);
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+				if (data.light_visibility.IsValid()) gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + ARRAYSIZE(src_handles)), context.GetReadOnlyBuffer(data.light_visibility));
+
+				struct ClusterLightAssignConstants
+				{
+					Uint32 clusters_idx;
+					Uint32 active_clusters_idx;
+					Uint32 light_grid_idx;
+					Uint32 light_list_idx;
+					Int32  light_visibility_idx;
+					Uint32 light_query_offset;
+				} constants =
+				{
+					.clusters_idx = i, .active_clusters_idx = i + 1,
+					.light_grid_idx = i + 2, .light_list_idx = i + 3,
+					.light_visibility_idx = data.light_visibility.IsValid() ? Int32(i + 4) : -1, .light_query_offset = light_query_offset
+				};
+
+				cmd_list->SetPipelineState(cluster_light_assign_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				GfxBuffer const& cluster_cull_args = context.GetIndirectArgsBuffer(data.cluster_cull_args);
+				cmd_list->DispatchIndirect(cluster_cull_args, 0);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct LightCounterCopyPassData
+		{
+			RGBufferCopySrcId light_counter;
+		};
+		rendergraph.AddPass<LightCounterCopyPassData>("Light Counter Copy Pass",
+			[=](LightCounterCopyPassData& data, RenderGraphBuilder& builder)
+			{
+				data.light_counter = builder.ReadCopySrcBuffer(RG_NAME(LightCounter));
+			},
+			[=, backbuffer_index = gfx->GetBackbufferIndex()](LightCounterCopyPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxBuffer const& buffer = context.GetCopySrcBuffer(data.light_counter);
+				cmd_list->CopyBuffer(*light_counter_readback_buffers[backbuffer_index], buffer);
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
+
+		rendergraph.GetBlackboard().Add<LightClusterBlackboardData>(LightClusterBlackboardData{ .cluster_size_x = CLUSTER_SIZE_X, .cluster_size_y = CLUSTER_SIZE_Y, .cluster_size_z = CLUSTER_SIZE_Z });
+	}
+
 	void ClusteredDeferredLightingPass::CreatePSOs()
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_ClusteredDeferredLighting;
 		clustered_lighting_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 
+		compute_pso_desc.CS.AddDefine("SOFTWARE_VRS", "1");
+		clustered_lighting_vrs_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
 		compute_pso_desc.CS = CS_ClusterBuilding;
 		clustered_building_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 
-		compute_pso_desc.CS = CS_ClusterCulling;
-		clustered_culling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ClusterMarkActive;
+		cluster_mark_active_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ClusterCompact;
+		cluster_compact_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ClusterLightCount;
+		cluster_light_count_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ClusterPrefixSum;
+		cluster_prefix_sum_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ClusterLightAssign;
+		cluster_light_assign_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void ClusteredDeferredLightingPass::GrowLightList()
+	{
+		//the total is read back a few frames late, until then the prefix sum clamps the lists to the current capacity
+		Uint32 const required_light_count = *light_counter_readback_buffers[gfx->GetBackbufferIndex()]->GetMappedData<Uint32>();
+		Uint32 const light_list_capacity = light_list->GetCount();
+		if (required_light_count <= light_list_capacity) return;
 
+		Uint32 new_light_list_capacity = light_list_capacity;
+		while (new_light_list_capacity < required_light_count) new_light_list_capacity *= 2;
+		ADRIA_LOG(INFO, "Growing clustered light list from %u to %u entries", light_list_capacity, new_light_list_capacity);
+		light_list = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(new_light_list_capacity));
 	}
 
 }
@@ -15,12 +15,19 @@ namespace adria
 		static constexpr Uint32 CLUSTER_SIZE_Y = 16;
 		static constexpr Uint32 CLUSTER_SIZE_Z = 16;
 		static constexpr Uint32 CLUSTER_COUNT = CLUSTER_SIZE_X * CLUSTER_SIZE_Y * CLUSTER_SIZE_Z;
-		static constexpr Uint32 CLUSTER_MAX_LIGHTS = 128;
+		static constexpr Uint32 INITIAL_LIGHT_LIST_SIZE = CLUSTER_COUNT * 16;
 
 	public:
 		ClusteredDeferredLightingPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
 
-		void AddPass(RenderGraph& rendergraph, Bool recreate_clusters);
+		void AddPass(RenderGraph& rendergraph);
+		//builds LightGrid and LightList without the deferred lighting, for forward passes with other lighting paths
+		void AddLightCullingPasses(RenderGraph& rendergraph);
+		//clusters are only assigned lights where the depth buffer has samples, forward shaded surfaces need every cluster
+		void SetAssignAllClusters(Bool assign_all)
+		{
+			assign_all_clusters = assign_all;
+		}
 
 		void OnResize(Uint32 w, Uint32 h)
 		{
@@ -33,15 +40,24 @@ namespace adria
 		Uint32 width, height;
 		GfxBuffer clusters;
 		GfxBuffer light_counter;
-		GfxBuffer light_list;
 		GfxBuffer light_grid;
+		std::unique_ptr<GfxBuffer> light_list;
+		std::vector<std::unique_ptr<GfxBuffer>> light_counter_readback_buffers;
+		Uint64 clusters_projection_hash = 0;
+		Bool assign_all_clusters = false;
 
 		std::unique_ptr<GfxComputePipelineState> clustered_lighting_pso;
+		std::unique_ptr<GfxComputePipelineState> clustered_lighting_vrs_pso;
 		std::unique_ptr<GfxComputePipelineState> clustered_building_pso;
-		std::unique_ptr<GfxComputePipelineState> clustered_culling_pso;
+		std::unique_ptr<GfxComputePipelineState> cluster_mark_active_pso;
+		std::unique_ptr<GfxComputePipelineState> cluster_compact_pso;
+		std::unique_ptr<GfxComputePipelineState> cluster_light_count_pso;
+		std::unique_ptr<GfxComputePipelineState> cluster_prefix_sum_pso;
+		std::unique_ptr<GfxComputePipelineState> cluster_light_assign_pso;
 
 	private:
 		void CreatePSOs();
+		void GrowLightList();
 	};
 
-}
\ No newline at end of file
+}
@@ -17,5 +17,35 @@ namespace adria
 		}
 		else cmd_list->Draw(submesh.vertex_count, submesh.instance_count, submesh.start_vertex_location, submesh.start_instance_location);
 	}
+
+	Uint32 SelectSubMeshLOD(SubMeshGPU const& submesh, Float lod_error_scale)
+	{
+		Uint32 lod = 0;
+		while (lod + 1 < submesh.lod_count && submesh.lods[lod + 1].error * lod_error_scale <= 1.0f) ++lod;
+		return lod;
+	}
+
+	void DrawSubMeshLOD(GfxCommandList* cmd_list, SubMeshGPU const& submesh, Uint32 lod, Uint32 instance_count)
+	{
+		//bind the whole geometry buffer so submeshes sharing it reuse the same index buffer view
+		SubMeshLOD const& submesh_lod = submesh.lods[lod];
+		GfxIndexBufferView ibv(submesh.buffer_address, (Uint32)(submesh.buffer_size / sizeof(Uint32)));
+		cmd_list->SetTopology(submesh.topology);
+		cmd_list->SetIndexBuffer(&ibv);
+		cmd_list->DrawIndexed(submesh_lod.index_count, instance_count, (Uint32)(submesh.indices_offset / sizeof(Uint32)) + submesh_lod.first_index);
+	}
+
+	Bool BatchDrawOrder(Batch const& lhs, Batch const& rhs)
+	{
+		if (lhs.submesh->buffer_address != rhs.submesh->buffer_address) return lhs.submesh->buffer_address < rhs.submesh->buffer_address;
+		if (lhs.submesh->topology != rhs.submesh->topology) return lhs.submesh->topology < rhs.submesh->topology;
+		if (lhs.submesh != rhs.submesh) return lhs.submesh < rhs.submesh;
+		return lhs.instance_id < rhs.instance_id;
+	}
+
+	Bool IsNextBatchInstance(Batch const& first, Uint32 instance_count, Batch const& batch)
+	{
+		return batch.submesh == first.submesh && batch.lod == first.lod && batch.instance_id == first.instance_id + instance_count;
+	}
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <array>
 #include <DirectXCollision.h>
 #include "GeometryBufferCache.h"
 #include "Graphics/GfxVertexFormat.h"
@@ -13,6 +14,8 @@
 namespace adria
 {
 	class GfxCommandList;
+	class Heightmap;
+	struct OpacityMicromapData;
 
 	enum class LightType : Int32
 	{
@@ -46,6 +49,19 @@ namespace adria
 	{
 		Matrix current_transform = Matrix::Identity;
 	};
+	struct COMPONENT Relationship
+	{
+		entt::entity parent = entt::null;
+	};
+	//modify through registry patch or replace so the TransformSystem picks up the change
+	struct COMPONENT LocalTransform
+	{
+		Matrix transform = Matrix::Identity;
+	};
+	struct COMPONENT WorldTransform
+	{
+		Matrix transform = Matrix::Identity;
+	};
 	struct COMPONENT SubMesh
 	{
 		BoundingBox bounding_box;
@@ -123,6 +139,7 @@ namespace adria
 		Int32 shadow_texture_index = -1;
 		Int32 shadow_matrix_index = -1;
 		Int32 shadow_mask_index = -1;
+		Int32 shadow_page_table_index = -1;
 		Uint32 light_index = 0;
 
 		Float volumetric_strength = 0.004f;
@@ -147,6 +164,49 @@ namespace adria
 		DecalType decal_type = DecalType::Project_XY;
 		Bool modify_gbuffer_normals = false;
 	};
+	struct TerrainLayer
+	{
+		TextureHandle albedo_texture = INVALID_TEXTURE_HANDLE;
+		Vector3 albedo_color = Vector3(1.0f);
+		Float tiling = 0.25f;
+		//normalized height and slope ranges the layer covers, blended over the given width
+		Vector2 height_range = Vector2(0.0f, 1.0f);
+		Vector2 slope_range = Vector2(0.0f, 1.0f);
+		Float blend_width = 0.05f;
+	};
+	struct COMPONENT Terrain
+	{
+		static constexpr Uint32 MAX_LAYERS = 4;
+
+		std::shared_ptr<Heightmap> heightmap;
+		Vector3 origin = Vector3::Zero;
+		Float texel_size = 1.0f;
+		Float height_scale = 1.0f;
+		std::array<TerrainLayer, MAX_LAYERS> layers{};
+		Uint32 layer_count = 0;
+	};
+	struct COMPONENT ParticleEmitter
+	{
+		Vector3 position = Vector3::Zero;
+		Vector3 position_variance = Vector3(0.5f);
+		Vector3 velocity = Vector3(0.0f, 5.0f, 0.0f);
+		Vector3 velocity_variance = Vector3(1.0f);
+		Vector4 start_color = Vector4(1.0f);
+		Vector4 end_color = Vector4(1.0f, 1.0f, 1.0f, 0.0f);
+		Float particles_per_second = 100.0f;
+		Float lifetime = 2.0f;
+		Float lifetime_variance = 0.5f;
+		Float start_size = 0.1f;
+		Float end_size = 0.1f;
+		Float gravity_scale = 1.0f;
+		Float restitution = 0.5f; //particles with no restitution die on collision
+		TextureHandle texture = INVALID_TEXTURE_HANDLE;
+		Bool collisions = true;
+		Bool camera_relative = false; //position is an offset from the camera
+		Bool velocity_aligned = false; //billboards are stretched along the velocity
+		Bool active = true;
+		Float emit_accumulator = 0.0f;
+	};
 	struct COMPONENT Tag
 	{
 		std::string name = "name tag";
@@ -156,9 +216,29 @@ namespace adria
 	struct COMPONENT Ocean {};
 	struct COMPONENT Deferred {};
 
+	enum class VertexLayout : Uint32
+	{
+		Full,
+		//snorm16x4 positions relative to the submesh bounding box, octahedral normals and tangents, half uvs
+		Compact
+	};
+
+	inline constexpr Uint32 SUBMESH_MAX_LODS = 4;
+
+	//index and meshlet ranges are relative to the submesh index and meshlet streams, lod 0 matches indices_count and meshlet_count
+	struct SubMeshLOD
+	{
+		Uint32 first_index;
+		Uint32 index_count;
+		Uint32 first_meshlet;
+		Uint32 meshlet_count;
+		Float  error; //object space simplification error
+	};
+
 	struct SubMeshGPU
 	{
 		Uint64 buffer_address;
+		Uint64 buffer_size;
 
 		Uint32 indices_offset;
 		Uint32 indices_count;
@@ -174,15 +254,43 @@ namespace adria
 		Uint32 meshlet_triangles_offset;
 		Uint32 meshlet_count;
 
+		//meshlets [0, cluster_count) form the cluster lod hierarchy, 0 if it was not built
+		Uint32 cluster_lods_offset;
+		Uint32 cluster_count;
+
 		Uint32 material_index;
 		DirectX::BoundingBox bounding_box;
 		GfxPrimitiveTopology topology;
+		VertexLayout vertex_layout;
+
+		Uint32 lod_count;
+		SubMeshLOD lods[SUBMESH_MAX_LODS];
+
+		//skinned submeshes keep the full vertex layout, joints are uint16x4 and weights float4 per vertex
+		Bool skinned;
+		Uint32 joints_offset;
+		Uint32 weights_offset;
+		//morph target deltas are stored target after target, see MorphTargetVertex
+		Uint32 morph_targets_offset;
+		Uint32 morph_target_count;
+	};
+	struct MorphTargetVertex
+	{
+		Vector3 position;
+		Vector3 normal;
 	};
+	Uint32 SelectSubMeshLOD(SubMeshGPU const& submesh, Float lod_error_scale);
+	//instanced draws expect instance_count consecutive instance ids, the shaders add SV_InstanceID to the instance id they are given
+	void DrawSubMeshLOD(GfxCommandList* cmd_list, SubMeshGPU const& submesh, Uint32 lod, Uint32 instance_count = 1);
 	struct SubMeshInstance
 	{
 		entt::entity parent;
 		Uint32 submesh_index;
+		Matrix local_transform;
 		Matrix world_transform;
+		//skeleton node the instance was created from and its skin, skinned instances ignore the node transform
+		Uint32 node_index = UINT32_MAX;
+		Uint32 skin_index = UINT32_MAX;
 	};
 	struct COMPONENT Mesh
 	{
@@ -190,18 +298,109 @@ namespace adria
 		std::vector<Material> materials;
 		std::vector<SubMeshGPU> submeshes;
 		std::vector<SubMeshInstance> instances;
+		//per submesh, empty or null where alpha testing was not baked
+		std::vector<std::shared_ptr<OpacityMicromapData const>> opacity_micromaps;
+	};
+
+	//file a model entity was created from, scene snapshots recreate the mesh from its cooked model instead of storing gpu data
+	struct COMPONENT ModelSource
+	{
+		std::string model_path;
+		std::string textures_path;
+		Bool triangle_ccw = true;
+		Bool force_mask_alpha_usage = false;
+		Bool compact_vertices = false;
+		Bool cluster_lod = false;
 	};
 
 	struct COMPONENT Batch
 	{
 		Uint32   instance_id;
 		SubMeshGPU*  submesh;
+		Material const* material;
 		ShadingExtension shading_extension;
 		MaterialAlphaMode alpha_mode;
 		Matrix world_transform;
+		Matrix prev_world_transform;
 		BoundingBox bounding_box;
 		Bool camera_visibility = true;
+		Bool dynamic = false;
+		Uint32 lod = 0;
+	};
+	//batches of meshes that have been moved at runtime, the rest is static and can be cached
+	struct COMPONENT DynamicBatch {};
+
+	enum class AnimationPath : Uint8
+	{
+		Translation,
+		Rotation,
+		Scale,
+		MorphWeights
+	};
+	enum class AnimationInterpolation : Uint8
+	{
+		Step,
+		Linear
+	};
+	struct SkeletonNode
+	{
+		Vector3 translation;
+		Quaternion rotation;
+		Vector3 scale;
+		Int32 parent;
+		//default weights of the morph targets of the node mesh
+		Uint32 first_morph_weight;
+		Uint32 morph_weight_count;
+	};
+	struct SkeletonSkin
+	{
+		Uint32 first_joint;
+		Uint32 joint_count;
+	};
+	//keys are ranges into Skeleton::key_times, every key has value_stride floats in Skeleton::key_values
+	struct AnimationChannel
+	{
+		Uint32 node;
+		AnimationPath path;
+		AnimationInterpolation interpolation;
+		Uint32 first_key;
+		Uint32 key_count;
+		Uint32 first_value;
+		Uint32 value_stride;
+	};
+	struct AnimationClip
+	{
+		Uint32 first_channel;
+		Uint32 channel_count;
+		Float duration;
+	};
+	//node hierarchy, skins and animation clips of a model, nodes are ordered so that parents come before their children
+	struct COMPONENT Skeleton
+	{
+		std::vector<SkeletonNode> nodes;
+		std::vector<SkeletonSkin> skins;
+		std::vector<Uint32> skin_joints;
+		std::vector<Matrix> inverse_bind_matrices;
+		std::vector<Float> morph_weights;
+		std::vector<AnimationClip> clips;
+		std::vector<AnimationChannel> channels;
+		std::vector<Float> key_times;
+		std::vector<Float> key_values;
+
+		Int32 active_clip = 0;
+		Float time = 0.0f;
+		Float speed = 1.0f;
+		Bool playing = true;
+
+		//model space node transforms and morph weights of the current pose, written by the AnimationSystem
+		std::vector<Matrix> node_transforms;
+		std::vector<Float> pose_morph_weights;
 	};
+	//orders batches so consecutive draws share topology and geometry buffer, leaving nothing to rebind,
+	//instances of one submesh end up adjacent and in instance id order so they can be drawn instanced
+	Bool BatchDrawOrder(Batch const& lhs, Batch const& rhs);
+	//whether batch continues an instanced draw of instance_count instances starting with first
+	Bool IsNextBatchInstance(Batch const& first, Uint32 instance_count, Batch const& batch);
 
 	void Draw(SubMesh const& submesh, GfxCommandList* cmd_list, Bool override_topology = false, GfxPrimitiveTopology new_topology = GfxPrimitiveTopology::Undefined);
 }
\ No newline at end of file
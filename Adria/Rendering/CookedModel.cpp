@@ -0,0 +1,312 @@
+#include <fstream>
+#include <filesystem>
+#include "CookedModel.h"
+#include "Logging/Logger.h"
+#include "Utilities/AllocatorUtil.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Uint32 COOKED_MODEL_MAGIC = 0x4C444F4D;
+		constexpr Uint32 COOKED_MODEL_VERSION = 8;
+		constexpr Uint64 INVALID_STRING_OFFSET = Uint64(-1);
+		constexpr Char SECTION_PADDING[COOKED_MODEL_GEOMETRY_ALIGNMENT] = {};
+
+		struct CookedModelSection
+		{
+			Uint64 offset;
+			Uint64 size;
+		};
+
+		struct CookedModelHeader
+		{
+			Uint32 magic;
+			Uint32 version;
+			Int64 source_write_time;
+			Uint32 options;
+			Uint32 material_count;
+			CookedModelSection geometry;
+			CookedModelSection submeshes;
+			CookedModelSection materials;
+			CookedModelSection instances;
+			CookedModelSection lights;
+			CookedModelSection strings;
+			CookedModelSection nodes;
+			CookedModelSection skins;
+			CookedModelSection skin_joints;
+			CookedModelSection inverse_bind_matrices;
+			CookedModelSection morph_weights;
+			CookedModelSection clips;
+			CookedModelSection channels;
+			CookedModelSection key_times;
+			CookedModelSection key_values;
+		};
+
+		struct CookedMaterialRecord
+		{
+			Material material;
+			Uint64 texture_offsets[MaterialTextureSlot_Count];
+		};
+
+		template<typename T>
+		Bool ReadSection(Uint8 const* view, Uint64 view_size, CookedModelSection const& section, std::vector<T>& output)
+		{
+			if (section.offset + section.size > view_size || section.size % sizeof(T) != 0) return false;
+			output.resize(section.size / sizeof(T));
+			if (section.size > 0) memcpy(output.data(), view + section.offset, section.size);
+			return true;
+		}
+
+		template<typename T>
+		CookedModelSection WriteSection(std::ofstream& os, Uint64& offset, T const* data, Uint64 size, Uint64 alignment = 16)
+		{
+			Uint64 const aligned_offset = Align(offset, alignment);
+			os.write(SECTION_PADDING, aligned_offset - offset);
+			os.write(reinterpret_cast<Char const*>(data), size);
+			offset = aligned_offset + size;
+			return CookedModelSection{ aligned_offset, size };
+		}
+	}
+
+	Bool IsMaterialTextureSlotSRGB(MaterialTextureSlot slot)
+	{
+		switch (slot)
+		{
+		case MaterialTextureSlot_Albedo:
+		case MaterialTextureSlot_Emissive:
+		case MaterialTextureSlot_Anisotropy:
+		case MaterialTextureSlot_SheenColor:
+			return true;
+		}
+		return false;
+	}
+
+	TextureCookMode GetMaterialTextureCookMode(MaterialTextureSlot slot)
+	{
+		switch (slot)
+		{
+		case MaterialTextureSlot_Normal:
+		case MaterialTextureSlot_ClearCoatNormal:
+			return TextureCookMode::NormalMap;
+		case MaterialTextureSlot_Anisotropy:
+			return TextureCookMode::None;
+		}
+		return TextureCookMode::BlockCompressed;
+	}
+
+	TextureHandle& GetMaterialTexture(Material& material, MaterialTextureSlot slot)
+	{
+		switch (slot)
+		{
+		case MaterialTextureSlot_Albedo:			 return material.albedo_texture;
+		case MaterialTextureSlot_MetallicRoughness:  return material.metallic_roughness_texture;
+		case MaterialTextureSlot_Normal:			 return material.normal_texture;
+		case MaterialTextureSlot_Emissive:			 return material.emissive_texture;
+		case MaterialTextureSlot_Anisotropy:		 return material.anisotropy_texture;
+		case MaterialTextureSlot_ClearCoat:			 return material.clear_coat_texture;
+		case MaterialTextureSlot_ClearCoatRoughness: return material.clear_coat_roughness_texture;
+		case MaterialTextureSlot_ClearCoatNormal:	 return material.clear_coat_normal_texture;
+		case MaterialTextureSlot_SheenColor:		 return material.sheen_color_texture;
+		case MaterialTextureSlot_SheenRoughness:	 return material.sheen_roughness_texture;
+		}
+		ADRIA_UNREACHABLE();
+	}
+
+	CookedModel::~CookedModel()
+	{
+		Unmap();
+	}
+
+	Bool CookedModel::Load(std::string const& path, Int64 source_write_time, CookedModelOptions options)
+	{
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER file_size{};
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(CookedModelHeader))
+		{
+			Unmap();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		view = mapping ? static_cast<Uint8 const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (!view)
+		{
+			Unmap();
+			return false;
+		}
+
+		Uint64 const view_size = file_size.QuadPart;
+		CookedModelHeader const* header = reinterpret_cast<CookedModelHeader const*>(view);
+		Bool valid = header->magic == COOKED_MODEL_MAGIC && header->version == COOKED_MODEL_VERSION &&
+					 header->source_write_time == source_write_time && header->options == options;
+
+		std::vector<CookedMaterialRecord> material_records;
+		valid = valid && header->geometry.offset + header->geometry.size <= view_size;
+		valid = valid && header->strings.offset + header->strings.size <= view_size;
+		valid = valid && ReadSection(view, view_size, header->submeshes, submeshes);
+		valid = valid && ReadSection(view, view_size, header->materials, material_records);
+		valid = valid && ReadSection(view, view_size, header->instances, instances);
+		valid = valid && ReadSection(view, view_size, header->lights, lights);
+		valid = valid && ReadSection(view, view_size, header->nodes, nodes);
+		valid = valid && ReadSection(view, view_size, header->skins, skins);
+		valid = valid && ReadSection(view, view_size, header->skin_joints, skin_joints);
+		valid = valid && ReadSection(view, view_size, header->inverse_bind_matrices, inverse_bind_matrices);
+		valid = valid && ReadSection(view, view_size, header->morph_weights, morph_weights);
+		valid = valid && ReadSection(view, view_size, header->clips, clips);
+		valid = valid && ReadSection(view, view_size, header->channels, channels);
+		valid = valid && ReadSection(view, view_size, header->key_times, key_times);
+		valid = valid && ReadSection(view, view_size, header->key_values, key_values);
+		if (!valid)
+		{
+			ADRIA_LOG(INFO, "Cooked model '%s' is invalid or outdated, recooking it", path.c_str());
+			submeshes.clear();
+			instances.clear();
+			lights.clear();
+			nodes.clear();
+			skins.clear();
+			skin_joints.clear();
+			inverse_bind_matrices.clear();
+			morph_weights.clear();
+			clips.clear();
+			channels.clear();
+			key_times.clear();
+			key_values.clear();
+			Unmap();
+			return false;
+		}
+
+		Char const* strings = reinterpret_cast<Char const*>(view + header->strings.offset);
+		materials.reserve(material_records.size());
+		material_textures.resize(material_records.size());
+		for (Uint64 i = 0; i < material_records.size(); ++i)
+		{
+			materials.push_back(material_records[i].material);
+			for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+			{
+				Uint64 const string_offset = material_records[i].texture_offsets[slot];
+				if (string_offset != INVALID_STRING_OFFSET && string_offset < header->strings.size) material_textures[i][slot] = strings + string_offset;
+			}
+		}
+
+		cooked_path = path;
+		geometry_file_offset = header->geometry.offset;
+		mapped_geometry = view + header->geometry.offset;
+		mapped_geometry_size = header->geometry.size;
+		return true;
+	}
+
+	Bool CookedModel::ReadGeometry(void* dst) const
+	{
+		ADRIA_ASSERT(CanReadGeometry());
+		ADRIA_ASSERT(reinterpret_cast<Uint64>(dst) % COOKED_MODEL_GEOMETRY_ALIGNMENT == 0);
+
+		HANDLE geometry_file = CreateFileA(cooked_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (geometry_file == INVALID_HANDLE_VALUE) return false;
+
+		static constexpr Uint64 MAX_READ_SIZE = 64 * 1024 * 1024;
+		Uint64 const read_size = Align(mapped_geometry_size, COOKED_MODEL_GEOMETRY_ALIGNMENT);
+		Uint64 offset = 0;
+		Bool success = true;
+		while (success && offset < read_size)
+		{
+			OVERLAPPED overlapped{};
+			Uint64 const file_offset = geometry_file_offset + offset;
+			overlapped.Offset = (DWORD)(file_offset & 0xFFFFFFFF);
+			overlapped.OffsetHigh = (DWORD)(file_offset >> 32);
+
+			DWORD const chunk_size = (DWORD)std::min(read_size - offset, MAX_READ_SIZE);
+			DWORD bytes_read = 0;
+			success = ReadFile(geometry_file, static_cast<Uint8*>(dst) + offset, chunk_size, &bytes_read, &overlapped) && bytes_read > 0;
+			offset += bytes_read;
+			if (bytes_read < chunk_size) break;
+		}
+		CloseHandle(geometry_file);
+		return success && offset >= mapped_geometry_size;
+	}
+
+	Bool CookedModel::Save(std::string const& path, Int64 source_write_time, CookedModelOptions options) const
+	{
+		std::string const temp_path = path + ".tmp";
+		{
+			std::ofstream os(temp_path, std::ios::binary);
+			if (!os)
+			{
+				ADRIA_LOG(WARNING, "Failed to write cooked model '%s'!", path.c_str());
+				return false;
+			}
+
+			std::string strings;
+			std::vector<CookedMaterialRecord> material_records(materials.size());
+			for (Uint64 i = 0; i < materials.size(); ++i)
+			{
+				material_records[i].material = materials[i];
+				for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+				{
+					std::string const& texture = material_textures[i][slot];
+					material_records[i].texture_offsets[slot] = texture.empty() ? INVALID_STRING_OFFSET : strings.size();
+					if (!texture.empty())
+					{
+						strings += texture;
+						strings += '\0';
+					}
+				}
+			}
+
+			CookedModelHeader header{};
+			header.magic = COOKED_MODEL_MAGIC;
+			header.version = COOKED_MODEL_VERSION;
+			header.source_write_time = source_write_time;
+			header.options = options;
+			header.material_count = (Uint32)materials.size();
+			os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+
+			Uint64 offset = sizeof(header);
+			header.geometry = WriteSection(os, offset, GetGeometryData(), GetGeometrySize(), COOKED_MODEL_GEOMETRY_ALIGNMENT);
+			header.submeshes = WriteSection(os, offset, submeshes.data(), submeshes.size() * sizeof(SubMeshGPU));
+			header.materials = WriteSection(os, offset, material_records.data(), material_records.size() * sizeof(CookedMaterialRecord));
+			header.instances = WriteSection(os, offset, instances.data(), instances.size() * sizeof(CookedModelInstance));
+			header.lights = WriteSection(os, offset, lights.data(), lights.size() * sizeof(CookedModelLight));
+			header.strings = WriteSection(os, offset, strings.data(), strings.size());
+			header.nodes = WriteSection(os, offset, nodes.data(), nodes.size() * sizeof(SkeletonNode));
+			header.skins = WriteSection(os, offset, skins.data(), skins.size() * sizeof(SkeletonSkin));
+			header.skin_joints = WriteSection(os, offset, skin_joints.data(), skin_joints.size() * sizeof(Uint32));
+			header.inverse_bind_matrices = WriteSection(os, offset, inverse_bind_matrices.data(), inverse_bind_matrices.size() * sizeof(Matrix));
+			header.morph_weights = WriteSection(os, offset, morph_weights.data(), morph_weights.size() * sizeof(Float));
+			header.clips = WriteSection(os, offset, clips.data(), clips.size() * sizeof(AnimationClip));
+			header.channels = WriteSection(os, offset, channels.data(), channels.size() * sizeof(AnimationChannel));
+			header.key_times = WriteSection(os, offset, key_times.data(), key_times.size() * sizeof(Float));
+			header.key_values = WriteSection(os, offset, key_values.data(), key_values.size() * sizeof(Float));
+			os.write(SECTION_PADDING, Align(offset, COOKED_MODEL_GEOMETRY_ALIGNMENT) - offset);
+			os.seekp(0);
+			os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+			if (!os)
+			{
+				ADRIA_LOG(WARNING, "Failed to write cooked model '%s'!", path.c_str());
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(temp_path, path, ec);
+		if (ec)
+		{
+			ADRIA_LOG(WARNING, "Failed to replace cooked model '%s': %s", path.c_str(), ec.message().c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void CookedModel::Unmap()
+	{
+		if (view) UnmapViewOfFile(view);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		view = nullptr;
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+		mapped_geometry = nullptr;
+		mapped_geometry_size = 0;
+	}
+}
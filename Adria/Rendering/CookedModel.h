@@ -0,0 +1,115 @@
+#pragma once
+#include "Components.h"
+#include "Utilities/TextureCooker.h"
+
+namespace adria
+{
+	inline constexpr Uint64 COOKED_MODEL_GEOMETRY_ALIGNMENT = 4096;
+
+	enum MaterialTextureSlot : Uint32
+	{
+		MaterialTextureSlot_Albedo,
+		MaterialTextureSlot_MetallicRoughness,
+		MaterialTextureSlot_Normal,
+		MaterialTextureSlot_Emissive,
+		MaterialTextureSlot_Anisotropy,
+		MaterialTextureSlot_ClearCoat,
+		MaterialTextureSlot_ClearCoatRoughness,
+		MaterialTextureSlot_ClearCoatNormal,
+		MaterialTextureSlot_SheenColor,
+		MaterialTextureSlot_SheenRoughness,
+		MaterialTextureSlot_Count
+	};
+	Bool IsMaterialTextureSlotSRGB(MaterialTextureSlot slot);
+	TextureCookMode GetMaterialTextureCookMode(MaterialTextureSlot slot);
+	TextureHandle& GetMaterialTexture(Material& material, MaterialTextureSlot slot);
+
+	//cook parameters that change the cooked data, a cooked model is only reused if they match
+	enum CookedModelOption : Uint32
+	{
+		CookedModelOption_None = 0x0,
+		CookedModelOption_TriangleCCW = 0x1,
+		CookedModelOption_CompactVertices = 0x2,
+		CookedModelOption_ClusterLOD = 0x4,
+	};
+	using CookedModelOptions = Uint32;
+
+	struct CookedModelInstance
+	{
+		Matrix local_to_world;
+		Uint32 submesh_index;
+		Uint32 node_index;
+		Uint32 skin_index;
+	};
+
+	struct CookedModelLight
+	{
+		Matrix local_to_world;
+		Float color[3];
+		Float intensity;
+		Float inner_cone_angle;
+		Float outer_cone_angle;
+		Float range;
+		LightType type;
+	};
+
+	//final geometry buffer layout, submeshes, materials, instances and lights of a model,
+	//written next to the source file so that later loads only map the file and upload the geometry
+	class CookedModel
+	{
+	public:
+		CookedModel() = default;
+		ADRIA_NONCOPYABLE_NONMOVABLE(CookedModel)
+		~CookedModel();
+
+		Bool Load(std::string const& path, Int64 source_write_time, CookedModelOptions options);
+		Bool Save(std::string const& path, Int64 source_write_time, CookedModelOptions options) const;
+
+		Uint8 const* GetGeometryData() const { return mapped_geometry ? mapped_geometry : geometry.data(); }
+		Uint64 GetGeometrySize() const { return mapped_geometry ? mapped_geometry_size : geometry.size(); }
+
+		//reads the geometry of a loaded cooked model straight from disk with unbuffered I/O, dst has to be
+		//COOKED_MODEL_GEOMETRY_ALIGNMENT aligned and large enough for GetGeometrySize() rounded up to it
+		Bool ReadGeometry(void* dst) const;
+		Bool CanReadGeometry() const { return mapped_geometry != nullptr; }
+
+	public:
+		std::vector<Material> materials;
+		std::vector<std::array<std::string, MaterialTextureSlot_Count>> material_textures;
+		std::vector<SubMeshGPU> submeshes;
+		std::vector<CookedModelInstance> instances;
+		std::vector<CookedModelLight> lights;
+		std::vector<Uint8> geometry;
+
+		//empty unless the model has skins, morph targets or animations
+		std::vector<SkeletonNode> nodes;
+		std::vector<SkeletonSkin> skins;
+		std::vector<Uint32> skin_joints;
+		std::vector<Matrix> inverse_bind_matrices;
+		std::vector<Float> morph_weights;
+		std::vector<AnimationClip> clips;
+		std::vector<AnimationChannel> channels;
+		std::vector<Float> key_times;
+		std::vector<Float> key_values;
+
+		//baked after loading for ray tracing and not part of the cooked file
+		std::vector<std::shared_ptr<OpacityMicromapData const>> opacity_micromaps;
+
+	private:
+		std::string cooked_path;
+		Uint64 geometry_file_offset = 0;
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		Uint8 const* view = nullptr;
+		Uint8 const* mapped_geometry = nullptr;
+		Uint64 mapped_geometry_size = 0;
+
+	private:
+		void Unmap();
+	};
+
+	inline std::string GetCookedModelPath(std::string const& model_path)
+	{
+		return model_path + ".cooked";
+	}
+}
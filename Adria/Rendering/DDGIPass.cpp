@@ -1,8 +1,9 @@
+#include <format>
 #include "DDGIPass.h"
 #include "BlackboardData.h"
-#include "Components.h"
 #include "ShaderStructs.h"
 #include "ShaderManager.h"
+#include "ProceduralTextureCache.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxShader.h"
 #include "Graphics/GfxShaderKey.h"
@@ -10,16 +11,32 @@
 #include "Graphics/GfxPipelineState.h"
 #include "Graphics/GfxReflection.h"
 #include "Graphics/GfxRayTracingShaderTable.h"
+#include "Graphics/GfxReadbackQueue.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Math/Constants.h"
 #include "Editor/GUICommand.h"
 #include "Utilities/Random.h"
+#include "Utilities/HashUtil.h"
 #include "Core/ConsoleManager.h"
+#include "Logging/Logger.h"
 #include "entt/entity/registry.hpp"
 
 namespace adria
 {
 	static TAutoConsoleVariable<Bool> DDGI("r.DDGI", true, "Enable DDGI if supported");
+	static TAutoConsoleVariable<Int>  DDGICascadeCount("r.DDGI.CascadeCount", 3, "Number of camera-centred DDGI cascades, applied on scene load");
+	static TAutoConsoleVariable<Float> DDGIProbeSpacing("r.DDGI.ProbeSpacing", 2.0f, "Probe spacing of the first DDGI cascade, doubled for each following cascade");
+	static TAutoConsoleVariable<Bool> DDGIProbeRelocation("r.DDGI.ProbeRelocation", true, "Move probes out of geometry and away from nearby surfaces");
+	static TAutoConsoleVariable<Bool> DDGIProbeClassification("r.DDGI.ProbeClassification", true, "Disable probes inside geometry or far from any surface");
+	static TAutoConsoleVariable<Bool> DDGIAdaptiveRays("r.DDGI.AdaptiveRays", true, "Scale the per-probe ray count by the temporal variance of its irradiance");
+	static TAutoConsoleVariable<Int>  DDGIMinRays("r.DDGI.MinRays", 32, "Ray count used for inactive and converged probes");
+	static TAutoConsoleVariable<Int>  DDGIProbeUpdatePeriod("r.DDGI.ProbeUpdatePeriod", 2, "Number of frames over which every probe gets updated once");
+	static TAutoConsoleVariable<Float> DDGIBackfaceThreshold("r.DDGI.BackfaceThreshold", 0.25f, "Fraction of backface hits above which a probe is considered inside geometry");
+	static TAutoConsoleVariable<Float> DDGIMinFrontfaceDistance("r.DDGI.MinFrontfaceDistance", 0.2f, "Minimal distance to frontfaces relative to the probe spacing");
+	static TAutoConsoleVariable<Float> DDGITargetVariance("r.DDGI.TargetVariance", 0.05f, "Luminance variance at which a probe uses the full ray budget");
+	static TAutoConsoleVariable<Bool> DDGIInline("r.DDGI.Inline", true, "Trace probe rays with inline ray tracing (RayQuery) and shade hits from the previous probes and the shadow maps when DXR 1.1 is supported");
+	static TAutoConsoleVariable<Int>  DDGIInlineRayMultiplier("r.DDGI.InlineRayMultiplier", 2, "Ray count multiplier of the inline path, its hits are cheaper to shade");
+	static TAutoConsoleVariable<Bool> DDGIPersist("r.DDGI.Persist", true, "Restore the probe atlases saved for the scene on load and save them again once they converged");
 
 	Vector2u DDGIPass::ProbeTextureDimensions(Vector3u const& num_probes, Uint32 texels_per_probe)
 	{
@@ -28,9 +45,16 @@ namespace adria
 		return Vector2u(width, height);
 	}
 
+	static Int32 PositiveModulo(Int32 value, Int32 divisor)
+	{
+		Int32 const result = value % divisor;
+		return result < 0 ? result + divisor : result;
+	}
+
 	DDGIPass::DDGIPass(GfxDevice* gfx, entt::registry& reg, Uint32 w, Uint32 h) : gfx(gfx), reg(reg), width(w), height(h)
 	{
 		is_supported = gfx->GetCapabilities().SupportsRayTracing();
+		is_inline_supported = gfx->GetCapabilities().CheckRayTracingSupport(RayTracingSupport::Tier1_1);
 		DDGI->Set(is_supported);
 		if (is_supported)
 		{
@@ -42,26 +66,206 @@ namespace adria
 
 	DDGIPass::~DDGIPass() = default;
 
-	void DDGIPass::OnSceneInitialized()
+	void DDGIPass::OnSceneInitialized(Uint64 _scene_hash)
+	{
+		scene_hash = _scene_hash;
+		Uint32 const cascade_count = (Uint32)std::clamp(DDGICascadeCount.Get(), 1, (Int)MAX_CASCADES);
+		ddgi_volumes.clear();
+		ddgi_volumes.resize(cascade_count);
+		for (Uint32 i = 0; i < cascade_count; ++i)
+		{
+			CreateVolume(ddgi_volumes[i], DDGIProbeSpacing.Get() * (Float)(1u << i), i);
+		}
+		visualize_cascade = 0;
+		frames_until_persist = PERSIST_FRAMES;
+		persist_requested = false;
+	}
+
+	void DDGIPass::OnResize(Uint32 w, Uint32 h)
+	{
+		if (!IsSupported()) return;
+		width = w, height = h;
+	}
+
+	void DDGIPass::UpdateVolumes(Vector3 const& camera_position)
+	{
+		for (DDGIVolume& ddgi_volume : ddgi_volumes)
+		{
+			Vector3i grid_origin(
+				(Int32)std::floor(camera_position.x / ddgi_volume.probe_spacing.x) - (Int32)ddgi_volume.num_probes.x / 2,
+				(Int32)std::floor(camera_position.y / ddgi_volume.probe_spacing.y) - (Int32)ddgi_volume.num_probes.y / 2,
+				(Int32)std::floor(camera_position.z / ddgi_volume.probe_spacing.z) - (Int32)ddgi_volume.num_probes.z / 2);
+
+			ddgi_volume.pending_scroll.x += grid_origin.x - ddgi_volume.grid_origin.x;
+			ddgi_volume.pending_scroll.y += grid_origin.y - ddgi_volume.grid_origin.y;
+			ddgi_volume.pending_scroll.z += grid_origin.z - ddgi_volume.grid_origin.z;
+			ddgi_volume.grid_origin = grid_origin;
+		}
+	}
+
+	void DDGIPass::AddPasses(RenderGraph& rg)
 	{
-		BoundingBox scene_bounding_box;
-		for (auto mesh_entity : reg.view<Mesh>())
+		ADRIA_ASSERT(IsSupported());
+		if (frames_until_persist > 0 && --frames_until_persist == 0) persist_requested = true;
+		Bool const persist = persist_requested && DDGIPersist.Get();
+		persist_requested = false;
+		for (Uint32 i = 0; i < ddgi_volumes.size(); ++i)
 		{
-			Mesh& mesh = reg.get<Mesh>(mesh_entity);
+			AddVolumePasses(rg, i);
+			if (persist) AddPersistPass(rg, i);
+		}
+		shadow_textures.clear();
+	}
+
+	void DDGIPass::AddVisualizePass(RenderGraph& rg)
+	{
+		if (!IsSupported() || !visualize || ddgi_volumes.empty()) return;
+
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const volume_index = (Uint32)std::clamp(visualize_cascade, 0, (Int32)ddgi_volumes.size() - 1);
+		Vector3u const num_probes = ddgi_volumes[volume_index].num_probes;
 
-			for (auto const& instance : mesh.instances)
+		rg.AddPass<void>("DDGI Visualize Pass",
+			[=](RenderGraphBuilder& builder)
 			{
-				SubMeshGPU& submesh = mesh.submeshes[instance.submesh_index];
-				BoundingBox instance_bounding_box;
-				submesh.bounding_box.Transform(instance_bounding_box, instance.world_transform);
-				BoundingBox::CreateMerged(scene_bounding_box, scene_bounding_box, instance_bounding_box);
-			}
+				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=](RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				struct DDGIVisualizeParameters
+				{
+					Uint32 visualize_mode;
+					Uint32 volume_idx;
+				} parameters
+				{
+					.visualize_mode = (Uint32)ddgi_visualize_mode,
+					.volume_idx = volume_index
+				};
+				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
+				cmd_list->SetPipelineState(visualize_probes_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, parameters);
+				cmd_list->Draw(2880, num_probes.x * num_probes.y * num_probes.z);
+			}, RGPassType::Graphics);
+	}
+
+	void DDGIPass::GUI()
+	{
+		if (!is_supported) return;
+
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNode("DDGI"))
+				{
+					ImGui::Checkbox("Enable", DDGI.GetPtr());
+					if (DDGI.Get())
+					{
+						ImGui::Checkbox("Probe Relocation", DDGIProbeRelocation.GetPtr());
+						ImGui::Checkbox("Probe Classification", DDGIProbeClassification.GetPtr());
+						ImGui::Checkbox("Adaptive Ray Count", DDGIAdaptiveRays.GetPtr());
+						if (DDGIAdaptiveRays.Get())
+						{
+							ImGui::SliderInt("Min Rays", DDGIMinRays.GetPtr(), 8, 128);
+							ImGui::SliderFloat("Target Variance", DDGITargetVariance.GetPtr(), 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+						}
+						ImGui::SliderInt("Probe Update Period", DDGIProbeUpdatePeriod.GetPtr(), 1, 8);
+						if (is_inline_supported)
+						{
+							ImGui::Checkbox("Inline Ray Tracing", DDGIInline.GetPtr());
+							if (DDGIInline.Get()) ImGui::SliderInt("Inline Ray Multiplier", DDGIInlineRayMultiplier.GetPtr(), 1, 4);
+						}
+						if (ImGui::Button("Save Probes")) persist_requested = true;
+						ImGui::Checkbox("Visualize DDGI", &visualize);
+						if (visualize)
+						{
+							static const Char* visualize_mode[] = { "Irradiance", "Distance" };
+							static Int current_visualize_mode = 0;
+							const Char* visualize_mode_label = visualize_mode[current_visualize_mode];
+							if (ImGui::BeginCombo("DDGI Visualize Mode", visualize_mode_label, 0))
+							{
+								for (Int n = 0; n < IM_ARRAYSIZE(visualize_mode); n++)
+								{
+									const Bool is_selected = (current_visualize_mode == n);
+									if (ImGui::Selectable(visualize_mode[n], is_selected)) current_visualize_mode = n;
+									if (is_selected) ImGui::SetItemDefaultFocus();
+								}
+								ImGui::EndCombo();
+							}
+							ddgi_visualize_mode = (DDGIVisualizeMode)current_visualize_mode;
+							if (ddgi_volumes.size() > 1) ImGui::SliderInt("Visualize Cascade", &visualize_cascade, 0, (Int32)ddgi_volumes.size() - 1);
+						}
+					}
+					ImGui::TreePop();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	Bool DDGIPass::IsEnabled() const
+	{
+		return DDGI.Get();
+	}
+
+	Int32 DDGIPass::GetDDGIVolumeIndex()
+	{
+		if (!IsSupported() || ddgi_volumes.empty())  return -1;
+
+		std::vector<DDGIVolumeGPU> ddgi_data;
+		ddgi_data.reserve(ddgi_volumes.size());
+		for (DDGIVolume const& ddgi_volume : ddgi_volumes)
+		{
+			DDGIVolumeGPU& ddgi_gpu = ddgi_data.emplace_back();
+			ddgi_gpu.start_position = Vector3((Float)ddgi_volume.grid_origin.x, (Float)ddgi_volume.grid_origin.y, (Float)ddgi_volume.grid_origin.z) * ddgi_volume.probe_spacing;
+			ddgi_gpu.probe_size = ddgi_volume.probe_spacing;
+			ddgi_gpu.rays_per_probe = GetRayCount(ddgi_volume);
+			ddgi_gpu.max_rays_per_probe = GetMaxRayCount(ddgi_volume);
+			ddgi_gpu.probe_count = Vector3i(ddgi_volume.num_probes.x, ddgi_volume.num_probes.y, ddgi_volume.num_probes.z);
+			ddgi_gpu.probe_scroll_offset = Vector3i(
+				PositiveModulo(ddgi_volume.grid_origin.x, (Int32)ddgi_volume.num_probes.x),
+				PositiveModulo(ddgi_volume.grid_origin.y, (Int32)ddgi_volume.num_probes.y),
+				PositiveModulo(ddgi_volume.grid_origin.z, (Int32)ddgi_volume.num_probes.z));
+			ddgi_gpu.normal_bias = 0.25f;
+			ddgi_gpu.energy_preservation = 0.85f;
+			ddgi_gpu.history_blend_weight = 0.98f;
+
+			GfxDescriptor irradiance_gpu = gfx->AllocateDescriptorsGPU();
+			GfxDescriptor distance_gpu = gfx->AllocateDescriptorsGPU();
+			GfxDescriptor probe_data_gpu = gfx->AllocateDescriptorsGPU();
+			gfx->CopyDescriptors(1, irradiance_gpu, ddgi_volume.irradiance_history_srv);
+			gfx->CopyDescriptors(1, distance_gpu, ddgi_volume.distance_history_srv);
+			gfx->CopyDescriptors(1, probe_data_gpu, ddgi_volume.probe_data_srv);
+
+			ddgi_gpu.irradiance_history_idx = (Int32)irradiance_gpu.GetIndex();
+			ddgi_gpu.distance_history_idx = (Int32)distance_gpu.GetIndex();
+			ddgi_gpu.probe_data_idx = (Int32)probe_data_gpu.GetIndex();
+			ddgi_gpu.probe_update_offset = (Int32)ddgi_volume.probe_update_offset;
+			ddgi_gpu.probe_update_count = (Int32)GetProbeUpdateCount(ddgi_volume);
+			ddgi_gpu.min_rays_per_probe = std::min(DDGIMinRays.Get(), (Int)ddgi_volume.num_rays);
+		}
+
+		if (!ddgi_volume_buffer || ddgi_volume_buffer->GetCount() < ddgi_data.size())
+		{
+			ddgi_volume_buffer = gfx->CreateBuffer(StructuredBufferDesc<DDGIVolumeGPU>(ddgi_data.size(), false, true));
+			ddgi_volume_buffer_srv = gfx->CreateBufferSRV(ddgi_volume_buffer.get());
 		}
-		ddgi_volume.origin = scene_bounding_box.Center;
-		ddgi_volume.extents = 1.1f * Vector3(scene_bounding_box.Extents);
+
+		ddgi_volume_buffer->Update(ddgi_data.data(), ddgi_data.size() * sizeof(DDGIVolumeGPU));
+		GfxDescriptor ddgi_volume_buffer_srv_gpu = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, ddgi_volume_buffer_srv_gpu, ddgi_volume_buffer_srv);
+		return (Int32)ddgi_volume_buffer_srv_gpu.GetIndex();
+	}
+
+	void DDGIPass::CreateVolume(DDGIVolume& ddgi_volume, Float probe_spacing, Uint32 volume_index)
+	{
+		ddgi_volume.probe_spacing = Vector3(probe_spacing);
 		ddgi_volume.num_probes = Vector3u(16, 12, 14);
+		ddgi_volume.grid_origin = Vector3i(0, 0, 0);
+		ddgi_volume.pending_scroll = Vector3i(ddgi_volume.num_probes.x, ddgi_volume.num_probes.y, ddgi_volume.num_probes.z);
 		ddgi_volume.num_rays = 128;
-		ddgi_volume.max_num_rays = 512;
+		ddgi_volume.max_num_rays = MAX_RAYS_PER_PROBE;
+		ddgi_volume.probe_update_offset = 0;
 
 		Vector2u irradiance_dimensions = ProbeTextureDimensions(ddgi_volume.num_probes, PROBE_IRRADIANCE_TEXELS);
 		GfxTextureDesc irradiance_desc{};
@@ -70,9 +274,6 @@ namespace adria
 		irradiance_desc.format = GfxFormat::R16G16B16A16_FLOAT;
 		irradiance_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
 		irradiance_desc.initial_state = GfxResourceState::CopyDst;
-		ddgi_volume.irradiance_history = gfx->CreateTexture(irradiance_desc);
-		ddgi_volume.irradiance_history->SetName("DDGI Irradiance History");
-		ddgi_volume.irradiance_history_srv = gfx->CreateTextureSRV(ddgi_volume.irradiance_history.get());
 
 		Vector2u distance_dimensions = ProbeTextureDimensions(ddgi_volume.num_probes, PROBE_DISTANCE_TEXELS);
 		GfxTextureDesc distance_desc{};
@@ -81,106 +282,183 @@ namespace adria
 		distance_desc.format = GfxFormat::R16G16_FLOAT;
 		distance_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
 		distance_desc.initial_state = GfxResourceState::CopyDst;
-		ddgi_volume.distance_history = gfx->CreateTexture(distance_desc);
+
+		//a persisted volume is restored at the grid origin it was saved at, scrolling to the camera then only resets the probes that moved
+		Uint32 const num_probes_flat = ddgi_volume.num_probes.x * ddgi_volume.num_probes.y * ddgi_volume.num_probes.z;
+		std::string const cache_name = GetVolumeCacheName(volume_index);
+		Uint64 const volume_hash = GetVolumeCacheHash(ddgi_volume, volume_index);
+		std::vector<Uint8> probe_blob;
+		if (DDGIPersist.Get() && LoadProceduralData(cache_name + "_Probes", volume_hash, probe_blob) && probe_blob.size() == sizeof(Vector3i) + num_probes_flat * sizeof(DDGIProbeGPU))
+		{
+			Vector3i grid_origin;
+			memcpy(&grid_origin, probe_blob.data(), sizeof(Vector3i));
+			HashState atlas_hash{};
+			atlas_hash.Combine(volume_hash);
+			atlas_hash.Combine(grid_origin.x);
+			atlas_hash.Combine(grid_origin.y);
+			atlas_hash.Combine(grid_origin.z);
+
+			ddgi_volume.irradiance_history = LoadProceduralTexture(gfx, cache_name + "_Irradiance", atlas_hash, irradiance_desc);
+			ddgi_volume.distance_history = LoadProceduralTexture(gfx, cache_name + "_Distance", atlas_hash, distance_desc);
+			if (ddgi_volume.irradiance_history && ddgi_volume.distance_history)
+			{
+				ddgi_volume.grid_origin = grid_origin;
+				ddgi_volume.pending_scroll = Vector3i(0, 0, 0);
+				ddgi_volume.probe_data = gfx->CreateBuffer(StructuredBufferDesc<DDGIProbeGPU>(num_probes_flat), probe_blob.data() + sizeof(Vector3i));
+				ADRIA_LOG(INFO, "Restored DDGI cascade %u from %s", volume_index, cache_name.c_str());
+			}
+		}
+
+		if (!ddgi_volume.irradiance_history) ddgi_volume.irradiance_history = gfx->CreateTexture(irradiance_desc);
+		ddgi_volume.irradiance_history->SetName("DDGI Irradiance History");
+		ddgi_volume.irradiance_history_srv = gfx->CreateTextureSRV(ddgi_volume.irradiance_history.get());
+
+		if (!ddgi_volume.distance_history) ddgi_volume.distance_history = gfx->CreateTexture(distance_desc);
 		ddgi_volume.distance_history->SetName("DDGI Distance History");
 		ddgi_volume.distance_history_srv = gfx->CreateTextureSRV(ddgi_volume.distance_history.get());
-	}
 
-	void DDGIPass::OnResize(Uint32 w, Uint32 h)
-	{
-		if (!IsSupported()) return;
-		width = w, height = h;
+		if (!ddgi_volume.probe_data) ddgi_volume.probe_data = gfx->CreateBuffer(StructuredBufferDesc<DDGIProbeGPU>(num_probes_flat));
+		ddgi_volume.probe_data->SetName("DDGI Probe Data");
+		ddgi_volume.probe_data_srv = gfx->CreateBufferSRV(ddgi_volume.probe_data.get());
 	}
 
-	void DDGIPass::AddPasses(RenderGraph& rg)
+	void DDGIPass::AddVolumePasses(RenderGraph& rg, Uint32 volume_index)
 	{
-		ADRIA_ASSERT(IsSupported());
-
+		DDGIVolume& ddgi_volume = ddgi_volumes[volume_index];
 		Uint32 const num_probes_flat = ddgi_volume.num_probes.x * ddgi_volume.num_probes.y * ddgi_volume.num_probes.z;
+		Uint32 const probe_update_count = GetProbeUpdateCount(ddgi_volume);
+		Uint32 const num_rays = DDGIAdaptiveRays.Get() ? GetMaxRayCount(ddgi_volume) : GetRayCount(ddgi_volume);
+		Uint32 const max_num_rays = GetMaxRayCount(ddgi_volume);
+		Bool const use_inline = UseInlineTracing();
 		RealRandomGenerator rng(0.0f, 1.0f);
 		Vector3 random_vector(2.0f * rng() - 1.0f, 2.0f * rng() - 1.0f, 2.0f * rng() - 1.0f); 
 		random_vector.Normalize();
 		Float random_angle = rng() * pi<Float> * 2.0f;
 
+		RGResourceName const irradiance_history_name = RG_NAME_IDX(DDGIIrradianceHistory, volume_index);
+		RGResourceName const distance_history_name = RG_NAME_IDX(DDGIDistanceHistory, volume_index);
+		RGResourceName const probe_data_name = RG_NAME_IDX(DDGIProbeData, volume_index);
+		RGResourceName const ray_buffer_name = RG_NAME_IDX(DDGIRayBuffer, volume_index);
+
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
-		rg.ImportTexture(RG_NAME(DDGIIrradianceHistory), ddgi_volume.irradiance_history.get());
-		rg.ImportTexture(RG_NAME(DDGIDistanceHistory), ddgi_volume.distance_history.get());
+		rg.ImportTexture(irradiance_history_name, ddgi_volume.irradiance_history.get());
+		rg.ImportTexture(distance_history_name, ddgi_volume.distance_history.get());
+		rg.ImportBuffer(probe_data_name, ddgi_volume.probe_data.get());
 
-		struct DDGIBlackboardData
-		{
-			Uint32 heap_index;
-		};
+		Vector3i const scroll_delta(
+			std::clamp(ddgi_volume.pending_scroll.x, -(Int32)ddgi_volume.num_probes.x, (Int32)ddgi_volume.num_probes.x),
+			std::clamp(ddgi_volume.pending_scroll.y, -(Int32)ddgi_volume.num_probes.y, (Int32)ddgi_volume.num_probes.y),
+			std::clamp(ddgi_volume.pending_scroll.z, -(Int32)ddgi_volume.num_probes.z, (Int32)ddgi_volume.num_probes.z));
+		ddgi_volume.pending_scroll = Vector3i(0, 0, 0);
 
-		if (gfx->IsFirstFrame())
+		if (scroll_delta.x != 0 || scroll_delta.y != 0 || scroll_delta.z != 0)
 		{
-			struct DDGIClearHistoryPassData
+			struct DDGIResetProbesPassData
 			{
 				RGTextureReadWriteId irradiance_history;
 				RGTextureReadWriteId distance_history;
+				RGBufferReadWriteId  probe_data;
 			};
 
-			rg.AddPass<DDGIClearHistoryPassData>("DDGI Clear History Pass",
-				[=](DDGIClearHistoryPassData& data, RenderGraphBuilder& builder)
+			rg.AddPass<DDGIResetProbesPassData>(std::format("DDGI Reset Probes Pass {}", volume_index).c_str(),
+				[=](DDGIResetProbesPassData& data, RenderGraphBuilder& builder)
 				{
-					data.irradiance_history = builder.WriteTexture(RG_NAME(DDGIIrradianceHistory));
-					data.distance_history = builder.WriteTexture(RG_NAME(DDGIDistanceHistory));
+					data.irradiance_history = builder.WriteTexture(irradiance_history_name);
+					data.distance_history = builder.WriteTexture(distance_history_name);
+					data.probe_data = builder.WriteBuffer(probe_data_name);
 				},
-				[=](DDGIClearHistoryPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+				[=](DDGIResetProbesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
 				{
-					static constexpr Float black[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					GfxDevice* gfx = cmd_list->GetDevice();
 
-					Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
+					Uint32 i = gfx->AllocateDescriptorsGPU(3).GetIndex();
 					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadWriteTexture(data.irradiance_history));
 					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.distance_history));
+					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 2), ctx.GetReadWriteBuffer(data.probe_data));
 
-					cmd_list->ClearUAV(ctx.GetTexture(*data.irradiance_history), gfx->GetDescriptorGPU(i),
-									   ctx.GetReadWriteTexture(data.irradiance_history), black);
-					cmd_list->ClearUAV(ctx.GetTexture(*data.distance_history), gfx->GetDescriptorGPU(i + 1),
-									   ctx.GetReadWriteTexture(data.distance_history), black);
+					struct DDGIResetParameters
+					{
+						Vector3i scroll_delta;
+						Uint32   volume_idx;
+						Uint32   irradiance_idx;
+						Uint32   distance_idx;
+						Uint32   probe_data_idx;
+					} parameters
+					{
+						.scroll_delta = scroll_delta,
+						.volume_idx = volume_index,
+						.irradiance_idx = i,
+						.distance_idx = i + 1,
+						.probe_data_idx = i + 2
+					};
+
+					cmd_list->SetPipelineState(reset_probes_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, parameters);
+					cmd_list->Dispatch(DivideAndRoundUp(num_probes_flat, 32u), 1, 1);
 				}, RGPassType::Compute);
 		}
 
 		struct DDGIRayTracePassData
 		{
 			RGBufferReadWriteId ray_buffer;
+			RGBufferReadOnlyId  probe_data;
 			RGTextureReadOnlyId irradiance_history;
 			RGTextureReadOnlyId distance_history;
 		};
 
-		rg.AddPass<DDGIRayTracePassData>("DDGI Ray Trace Pass",
+		rg.AddPass<DDGIRayTracePassData>(std::format("DDGI Ray Trace Pass {}", volume_index).c_str(),
 			[=](DDGIRayTracePassData& data, RenderGraphBuilder& builder)
 			{
 				RGBufferDesc ray_buffer_desc{};
 				ray_buffer_desc.format = GfxFormat::R16G16B16A16_FLOAT;
 				ray_buffer_desc.stride = GetGfxFormatStride(ray_buffer_desc.format);
-				ray_buffer_desc.size = ray_buffer_desc.stride * num_probes_flat * ddgi_volume.max_num_rays;
-				builder.DeclareBuffer(RG_NAME(DDGIRayBuffer), ray_buffer_desc);
-
-				data.ray_buffer = builder.WriteBuffer(RG_NAME(DDGIRayBuffer));
-				data.irradiance_history = builder.ReadTexture(RG_NAME(DDGIIrradianceHistory));
-				data.distance_history = builder.ReadTexture(RG_NAME(DDGIDistanceHistory));
+				ray_buffer_desc.size = ray_buffer_desc.stride * num_probes_flat * max_num_rays;
+				builder.DeclareBuffer(ray_buffer_name, ray_buffer_desc);
+
+				data.ray_buffer = builder.WriteBuffer(ray_buffer_name);
+				data.probe_data = builder.ReadBuffer(probe_data_name, ReadAccess_NonPixelShader);
+				data.irradiance_history = builder.ReadTexture(irradiance_history_name);
+				data.distance_history = builder.ReadTexture(distance_history_name);
+				//the inline path takes the direct light of hits from the shadow maps instead of tracing shadow rays
+				if (use_inline)
+				{
+					for (RGResourceName shadow_texture : shadow_textures) std::ignore = builder.ReadTexture(shadow_texture, ReadAccess_NonPixelShader);
+				}
 			},
 			[=](DDGIRayTracePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
-				Uint32 i = gfx->AllocateDescriptorsGPU(1).GetIndex();
+				Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
 				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadWriteBuffer(data.ray_buffer));
-				ctx.GetBlackboard().Create<DDGIBlackboardData>(i);
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadOnlyBuffer(data.probe_data));
 
 				struct DDGIParameters
 				{
 					Vector3  random_vector;
 					Float    random_angle;
-					Float    history_blend_weight;
+					Uint32   volume_idx;
 					Uint32   ray_buffer_index;
+					Uint32   probe_data_idx;
 				} parameters
 				{
 					.random_vector = random_vector,
 					.random_angle = random_angle,
-					.history_blend_weight = 0.98f,
-					.ray_buffer_index = i
+					.volume_idx = volume_index,
+					.ray_buffer_index = i,
+					.probe_data_idx = i + 1
 				};
 
+				if (use_inline)
+				{
+					cmd_list->SetPipelineState(ddgi_trace_inline_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, parameters);
+					cmd_list->Dispatch(DivideAndRoundUp(num_rays, 32), probe_update_count, 1);
+					cmd_list->BufferBarrier(ctx.GetBuffer(*data.ray_buffer), GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+					return;
+				}
+
 				GfxRayTracingShaderTable& table = cmd_list->SetStateObject(ddgi_trace_so.get());
 				table.SetRayGenShader("DDGI_RayGen");
 				table.AddMissShader("DDGI_Miss", 0);
@@ -189,221 +467,215 @@ namespace adria
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, parameters);
 				
-				cmd_list->DispatchRays(ddgi_volume.num_rays, num_probes_flat);
+				cmd_list->DispatchRays(num_rays, probe_update_count);
 				cmd_list->BufferBarrier(ctx.GetBuffer(*data.ray_buffer), GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
 			}, RGPassType::Compute);
 
 		struct DDGIUpdateIrradiancePassData
 		{
 			RGBufferReadOnlyId		ray_buffer;
-			RGTextureReadOnlyId		irradiance_history;
+			RGBufferReadWriteId		probe_data;
 			RGTextureReadWriteId	irradiance;
 		};
 
-		rg.AddPass<DDGIUpdateIrradiancePassData>("DDGI Update Irradiance Pass",
+		rg.AddPass<DDGIUpdateIrradiancePassData>(std::format("DDGI Update Irradiance Pass {}", volume_index).c_str(),
 			[=](DDGIUpdateIrradiancePassData& data, RenderGraphBuilder& builder)
 			{
-				Vector2u irradiance_dimensions = ProbeTextureDimensions(ddgi_volume.num_probes, PROBE_IRRADIANCE_TEXELS);
-				RGTextureDesc irradiance_desc{};
-				irradiance_desc.width  = irradiance_dimensions.x;
-				irradiance_desc.height = irradiance_dimensions.y;
-				irradiance_desc.format = GfxFormat::R16G16B16A16_FLOAT;
-				builder.DeclareTexture(RG_NAME(DDGIIrradiance), irradiance_desc);
-
-				data.irradiance		= builder.WriteTexture(RG_NAME(DDGIIrradiance));
-				data.ray_buffer		= builder.ReadBuffer(RG_NAME(DDGIRayBuffer));
-				data.irradiance_history = builder.ReadTexture(RG_NAME(DDGIIrradianceHistory));
+				data.irradiance		= builder.WriteTexture(irradiance_history_name);
+				data.probe_data		= builder.WriteBuffer(probe_data_name);
+				data.ray_buffer		= builder.ReadBuffer(ray_buffer_name);
 			},
 			[=](DDGIUpdateIrradiancePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
-				DDGIBlackboardData const& ddgi_blackboard = ctx.GetBlackboard().Get<DDGIBlackboardData>();
 
-				Uint32 i = gfx->AllocateDescriptorsGPU(1).GetIndex();
-				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadWriteTexture(data.irradiance));
+				Uint32 i = gfx->AllocateDescriptorsGPU(3).GetIndex();
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyBuffer(data.ray_buffer));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.irradiance));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 2), ctx.GetReadWriteBuffer(data.probe_data));
 
 				struct DDGIParameters
 				{
 					Vector3  random_vector;
 					Float    random_angle;
-					Float    history_blend_weight;
+					Uint32   volume_idx;
 					Uint32   ray_buffer_index;
 					Uint32   irradiance_idx;
+					Uint32   probe_data_idx;
 				} parameters
 				{
 					.random_vector = random_vector,
 					.random_angle = random_angle,
-					.history_blend_weight = 0.98f,
-					.ray_buffer_index = ddgi_blackboard.heap_index,
-					.irradiance_idx = i
+					.volume_idx = volume_index,
+					.ray_buffer_index = i,
+					.irradiance_idx = i + 1,
+					.probe_data_idx = i + 2
 				};
 
 				cmd_list->SetPipelineState(update_irradiance_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, parameters);
-				cmd_list->Dispatch(num_probes_flat, 1, 1);
+				cmd_list->Dispatch(probe_update_count, 1, 1);
 				cmd_list->TextureBarrier(ctx.GetTexture(*data.irradiance), GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
-			}, RGPassType::Compute);
+			}, RGPassType::ComputeAsync);
 
 		struct DDGIUpdateDistancePassData
 		{
 			RGBufferReadOnlyId		ray_buffer;
-			RGTextureReadOnlyId		distance_history;
+			RGBufferReadOnlyId		probe_data;
 			RGTextureReadWriteId	distance;
 		};
 
-		rg.AddPass<DDGIUpdateDistancePassData>("DDGI Update Distance Pass",
+		rg.AddPass<DDGIUpdateDistancePassData>(std::format("DDGI Update Distance Pass {}", volume_index).c_str(),
 			[=](DDGIUpdateDistancePassData& data, RenderGraphBuilder& builder)
 			{
-				Vector2u distance_dimensions = ProbeTextureDimensions(ddgi_volume.num_probes, PROBE_DISTANCE_TEXELS);
-				RGTextureDesc distance_desc{};
-				distance_desc.width = distance_dimensions.x;
-				distance_desc.height = distance_dimensions.y;
-				distance_desc.format = GfxFormat::R16G16_FLOAT;
-				builder.DeclareTexture(RG_NAME(DDGIDistance), distance_desc);
-
-				data.distance = builder.WriteTexture(RG_NAME(DDGIDistance));
-				data.ray_buffer = builder.ReadBuffer(RG_NAME(DDGIRayBuffer));
-				data.distance_history = builder.ReadTexture(RG_NAME(DDGIDistanceHistory));
+				data.distance = builder.WriteTexture(distance_history_name);
+				data.probe_data = builder.ReadBuffer(probe_data_name, ReadAccess_NonPixelShader);
+				data.ray_buffer = builder.ReadBuffer(ray_buffer_name);
 			},
 			[=](DDGIUpdateDistancePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				DDGIBlackboardData const& ddgi_blackboard = ctx.GetBlackboard().Get<DDGIBlackboardData>();
-
-				Uint32 i = gfx->AllocateDescriptorsGPU(1).GetIndex();
-				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadWriteTexture(data.distance));
+				Uint32 i = gfx->AllocateDescriptorsGPU(3).GetIndex();
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyBuffer(data.ray_buffer));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.distance));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 2), ctx.GetReadOnlyBuffer(data.probe_data));
 
 				struct DDGIParameters
 				{
 					Vector3  random_vector;
 					Float    random_angle;
-					Float    history_blend_weight;
+					Uint32   volume_idx;
 					Uint32   ray_buffer_index;
 					Uint32   distance_idx;
+					Uint32   probe_data_idx;
 				} parameters
 				{
 					.random_vector = random_vector,
 					.random_angle = random_angle,
-					.history_blend_weight = 0.98f,
-					.ray_buffer_index = ddgi_blackboard.heap_index,
-					.distance_idx = i
+					.volume_idx = volume_index,
+					.ray_buffer_index = i,
+					.distance_idx = i + 1,
+					.probe_data_idx = i + 2
 				};
 
 				cmd_list->SetPipelineState(update_distance_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, parameters);
-				cmd_list->Dispatch(num_probes_flat, 1, 1);
+				cmd_list->Dispatch(probe_update_count, 1, 1);
 				cmd_list->TextureBarrier(ctx.GetTexture(*data.distance), GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
-			}, RGPassType::Compute);
+			}, RGPassType::ComputeAsync);
 
-		rg.ExportTexture(RG_NAME(DDGIIrradiance), ddgi_volume.irradiance_history.get());
-		rg.ExportTexture(RG_NAME(DDGIDistance), ddgi_volume.distance_history.get());
-	}
+		struct DDGIProbeUpdatePassData
+		{
+			RGBufferReadOnlyId		ray_buffer;
+			RGBufferReadWriteId		probe_data;
+		};
 
-	void DDGIPass::AddVisualizePass(RenderGraph& rg)
-	{
-		if (!IsSupported() || !visualize) return;
+		rg.AddPass<DDGIProbeUpdatePassData>(std::format("DDGI Relocate Probes Pass {}", volume_index).c_str(),
+			[=](DDGIProbeUpdatePassData& data, RenderGraphBuilder& builder)
+			{
+				data.probe_data = builder.WriteBuffer(probe_data_name);
+				data.ray_buffer = builder.ReadBuffer(ray_buffer_name);
+			},
+			[=](DDGIProbeUpdatePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
 
-		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+				Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyBuffer(data.ray_buffer));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteBuffer(data.probe_data));
 
-		rg.AddPass<void>("DDGI Visualize Pass",
-			[=](RenderGraphBuilder& builder)
+				struct DDGIRelocationParameters
+				{
+					Uint32  volume_idx;
+					Uint32  ray_buffer_index;
+					Uint32  probe_data_idx;
+					Bool32  relocation_enabled;
+					Float   backface_threshold;
+					Float   min_frontface_distance;
+				} parameters
+				{
+					.volume_idx = volume_index,
+					.ray_buffer_index = i,
+					.probe_data_idx = i + 1,
+					.relocation_enabled = DDGIProbeRelocation.Get(),
+					.backface_threshold = DDGIBackfaceThreshold.Get(),
+					.min_frontface_distance = DDGIMinFrontfaceDistance.Get()
+				};
+
+				cmd_list->SetPipelineState(relocate_probes_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, parameters);
+				cmd_list->Dispatch(DivideAndRoundUp(probe_update_count, 32u), 1, 1);
+			}, RGPassType::ComputeAsync);
+
+		rg.AddPass<DDGIProbeUpdatePassData>(std::format("DDGI Classify Probes Pass {}", volume_index).c_str(),
+			[=](DDGIProbeUpdatePassData& data, RenderGraphBuilder& builder)
 			{
-				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.SetViewport(width, height);
+				data.probe_data = builder.WriteBuffer(probe_data_name);
+				data.ray_buffer = builder.ReadBuffer(ray_buffer_name);
 			},
-			[=](RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+			[=](DDGIProbeUpdatePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
-				struct DDGIVisualizeParameters
+
+				Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyBuffer(data.ray_buffer));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteBuffer(data.probe_data));
+
+				struct DDGIClassificationParameters
 				{
-					Uint32 visualize_mode;
+					Uint32  volume_idx;
+					Uint32  ray_buffer_index;
+					Uint32  probe_data_idx;
+					Bool32  classification_enabled;
+					Bool32  adaptive_rays_enabled;
+					Float   backface_threshold;
+					Float   target_variance;
 				} parameters
 				{
-					.visualize_mode = (Uint32)ddgi_visualize_mode
+					.volume_idx = volume_index,
+					.ray_buffer_index = i,
+					.probe_data_idx = i + 1,
+					.classification_enabled = DDGIProbeClassification.Get(),
+					.adaptive_rays_enabled = DDGIAdaptiveRays.Get(),
+					.backface_threshold = DDGIBackfaceThreshold.Get(),
+					.target_variance = DDGITargetVariance.Get()
 				};
-				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
-				cmd_list->SetPipelineState(visualize_probes_pso.get());
+
+				cmd_list->SetPipelineState(classify_probes_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, parameters);
-				cmd_list->Draw(2880, ddgi_volume.num_probes.x * ddgi_volume.num_probes.y * ddgi_volume.num_probes.z);
-			}, RGPassType::Graphics);
+				cmd_list->Dispatch(DivideAndRoundUp(probe_update_count, 32u), 1, 1);
+			}, RGPassType::ComputeAsync);
+
+		ddgi_volume.probe_update_offset = (ddgi_volume.probe_update_offset + probe_update_count) % num_probes_flat;
 	}
 
-	void DDGIPass::GUI()
+	Uint32 DDGIPass::GetProbeUpdateCount(DDGIVolume const& ddgi_volume) const
 	{
-		if (!is_supported) return;
-
-		QueueGUI([&]()
-			{
-				if (ImGui::TreeNode("DDGI"))
-				{
-					ImGui::Checkbox("Enable", DDGI.GetPtr());
-					if (DDGI.Get())
-					{
-						ImGui::Checkbox("Visualize DDGI", &visualize);
-						if (visualize)
-						{
-							static const Char* visualize_mode[] = { "Irradiance", "Distance" };
-							static Int current_visualize_mode = 0;
-							const Char* visualize_mode_label = visualize_mode[current_visualize_mode];
-							if (ImGui::BeginCombo("DDGI Visualize Mode", visualize_mode_label, 0))
-							{
-								for (Int n = 0; n < IM_ARRAYSIZE(visualize_mode); n++)
-								{
-									const Bool is_selected = (current_visualize_mode == n);
-									if (ImGui::Selectable(visualize_mode[n], is_selected)) current_visualize_mode = n;
-									if (is_selected) ImGui::SetItemDefaultFocus();
-								}
-								ImGui::EndCombo();
-							}
-							ddgi_visualize_mode = (DDGIVisualizeMode)current_visualize_mode;
-						}
-					}
-					ImGui::TreePop();
-				}
-			}, GUICommandGroup_Renderer);
+		Uint32 const num_probes_flat = ddgi_volume.num_probes.x * ddgi_volume.num_probes.y * ddgi_volume.num_probes.z;
+		Uint32 const update_period = (Uint32)std::max(DDGIProbeUpdatePeriod.Get(), 1);
+		return DivideAndRoundUp(num_probes_flat, update_period);
 	}
 
-	Bool DDGIPass::IsEnabled() const
+	Bool DDGIPass::UseInlineTracing() const
 	{
-		return DDGI.Get();
+		return is_inline_supported && DDGIInline.Get();
 	}
 
-	Int32 DDGIPass::GetDDGIVolumeIndex()
+	Uint32 DDGIPass::GetRayCount(DDGIVolume const& ddgi_volume) const
 	{
-		if (!IsSupported())  return -1;
-
-		std::vector<DDGIVolumeGPU> ddgi_data;
-		DDGIVolumeGPU& ddgi_gpu = ddgi_data.emplace_back();
-		ddgi_gpu.start_position = ddgi_volume.origin - ddgi_volume.extents;
-		ddgi_gpu.probe_size = 2 * ddgi_volume.extents / (Vector3((Float)ddgi_volume.num_probes.x, (Float)ddgi_volume.num_probes.y, (Float)ddgi_volume.num_probes.z) - Vector3::One);
-		ddgi_gpu.rays_per_probe = ddgi_volume.num_rays;
-		ddgi_gpu.max_rays_per_probe = ddgi_volume.max_num_rays;
-		ddgi_gpu.probe_count = Vector3i(ddgi_volume.num_probes.x, ddgi_volume.num_probes.y, ddgi_volume.num_probes.z);
-		ddgi_gpu.normal_bias = 0.25f;
-		ddgi_gpu.energy_preservation = 0.85f;
-
-		GfxDescriptor irradiance_gpu = gfx->AllocateDescriptorsGPU();
-		GfxDescriptor distance_gpu = gfx->AllocateDescriptorsGPU();
-		gfx->CopyDescriptors(1, irradiance_gpu, ddgi_volume.irradiance_history_srv);
-		gfx->CopyDescriptors(1, distance_gpu, ddgi_volume.distance_history_srv);
-
-		ddgi_gpu.irradiance_history_idx = (Int32)irradiance_gpu.GetIndex();
-		ddgi_gpu.distance_history_idx = (Int32)distance_gpu.GetIndex();
-		if (!ddgi_volume_buffer || ddgi_volume_buffer->GetCount() < ddgi_data.size())
-		{
-			ddgi_volume_buffer = gfx->CreateBuffer(StructuredBufferDesc<DDGIVolumeGPU>(ddgi_data.size(), false, true));
-			ddgi_volume_buffer_srv = gfx->CreateBufferSRV(ddgi_volume_buffer.get());
-		}
+		Uint32 const ray_count = UseInlineTracing() ? ddgi_volume.num_rays * (Uint32)std::clamp(DDGIInlineRayMultiplier.Get(), 1, 4) : ddgi_volume.num_rays;
+		return std::min(ray_count, MAX_RAYS_PER_PROBE);
+	}
 
-		ddgi_volume_buffer->Update(ddgi_data.data(), ddgi_data.size() * sizeof(DDGIVolumeGPU));
-		GfxDescriptor ddgi_volume_buffer_srv_gpu = gfx->AllocateDescriptorsGPU();
-		gfx->CopyDescriptors(1, ddgi_volume_buffer_srv_gpu, ddgi_volume_buffer_srv);
-		return (Int32)ddgi_volume_buffer_srv_gpu.GetIndex();
+	Uint32 DDGIPass::GetMaxRayCount(DDGIVolume const& ddgi_volume) const
+	{
+		Uint32 const ray_count = UseInlineTracing() ? ddgi_volume.max_num_rays * (Uint32)std::clamp(DDGIInlineRayMultiplier.Get(), 1, 4) : ddgi_volume.max_num_rays;
+		return std::min(ray_count, MAX_RAYS_PER_PROBE);
 	}
 
 	void DDGIPass::CreatePSOs()
@@ -428,6 +700,21 @@ namespace adria
 
 		compute_pso_desc.CS = CS_DDGIUpdateDistance;
 		update_distance_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DDGIRelocateProbes;
+		relocate_probes_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DDGIClassifyProbes;
+		classify_probes_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DDGIResetProbes;
+		reset_probes_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		if (is_inline_supported)
+		{
+			compute_pso_desc.CS = CS_DDGIRayTraceInline;
+			ddgi_trace_inline_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		}
 	}
 
 	void DDGIPass::CreateStateObject()
@@ -452,9 +739,7 @@ namespace adria
 			global_root_sig.pGlobalRootSignature = gfx->GetCommonRootSignature();
 			ddgi_state_object_builder.AddSubObject(global_root_sig);
 
-			D3D12_RAYTRACING_PIPELINE_CONFIG pipeline_config{};
-			pipeline_config.MaxTraceRecursionDepth = 1;
-			ddgi_state_object_builder.AddSubObject(pipeline_config);
+			ddgi_state_object_builder.AddRayTracingPipelineConfig(gfx, 1);
 
 			D3D12_HIT_GROUP_DESC hit_group{};
 			hit_group.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
@@ -465,6 +750,68 @@ namespace adria
 		ddgi_trace_so.reset(ddgi_state_object_builder.CreateStateObject(gfx));
 	}
 
+	void DDGIPass::AddPersistPass(RenderGraph& rg, Uint32 volume_index)
+	{
+		DDGIVolume const& ddgi_volume = ddgi_volumes[volume_index];
+		std::string const cache_name = GetVolumeCacheName(volume_index);
+		Uint64 const volume_hash = GetVolumeCacheHash(ddgi_volume, volume_index);
+		Vector3i const grid_origin = ddgi_volume.grid_origin;
+		HashState atlas_hash{};
+		atlas_hash.Combine(volume_hash);
+		atlas_hash.Combine(grid_origin.x);
+		atlas_hash.Combine(grid_origin.y);
+		atlas_hash.Combine(grid_origin.z);
+
+		struct DDGIPersistPassData
+		{
+			RGTextureCopySrcId irradiance_history;
+			RGTextureCopySrcId distance_history;
+			RGBufferCopySrcId  probe_data;
+		};
+		rg.AddPass<DDGIPersistPassData>(std::format("DDGI Persist Pass {}", volume_index).c_str(),
+			[=](DDGIPersistPassData& data, RenderGraphBuilder& builder)
+			{
+				data.irradiance_history = builder.ReadCopySrcTexture(RG_NAME_IDX(DDGIIrradianceHistory, volume_index));
+				data.distance_history = builder.ReadCopySrcTexture(RG_NAME_IDX(DDGIDistanceHistory, volume_index));
+				data.probe_data = builder.ReadCopySrcBuffer(RG_NAME_IDX(DDGIProbeData, volume_index));
+			},
+			[=, atlas_hash = (Uint64)atlas_hash](DDGIPersistPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				SaveProceduralTexture(gfx, cmd_list, ctx.GetCopySrcTexture(data.irradiance_history), cache_name + "_Irradiance", atlas_hash);
+				SaveProceduralTexture(gfx, cmd_list, ctx.GetCopySrcTexture(data.distance_history), cache_name + "_Distance", atlas_hash);
+				GfxBuffer const& probe_data = ctx.GetCopySrcBuffer(data.probe_data);
+				gfx->GetReadbackQueue()->Enqueue(cmd_list, probe_data, 0, probe_data.GetSize(), [=](void const* readback_data, Uint64 size)
+					{
+						std::vector<Uint8> probe_blob(sizeof(Vector3i) + size);
+						memcpy(probe_blob.data(), &grid_origin, sizeof(Vector3i));
+						memcpy(probe_blob.data() + sizeof(Vector3i), readback_data, size);
+						SaveProceduralData(cache_name + "_Probes", volume_hash, std::move(probe_blob));
+					});
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
+	}
+
+	std::string DDGIPass::GetVolumeCacheName(Uint32 volume_index) const
+	{
+		return std::format("DDGI_{:016x}_{}", scene_hash, volume_index);
+	}
+
+	Uint64 DDGIPass::GetVolumeCacheHash(DDGIVolume const& ddgi_volume, Uint32 volume_index) const
+	{
+		HashState hash{};
+		hash.Combine(scene_hash);
+		hash.Combine(volume_index);
+		hash.Combine(ddgi_volume.probe_spacing.x);
+		hash.Combine(ddgi_volume.num_probes.x);
+		hash.Combine(ddgi_volume.num_probes.y);
+		hash.Combine(ddgi_volume.num_probes.z);
+		hash.Combine(PROBE_IRRADIANCE_TEXELS);
+		hash.Combine(PROBE_DISTANCE_TEXELS);
+		//probe states and adaptive ray counts converge for the ray counts that were traced
+		hash.Combine(GetRayCount(ddgi_volume));
+		hash.Combine(GetMaxRayCount(ddgi_volume));
+		return hash;
+	}
+
 	void DDGIPass::OnLibraryRecompiled(GfxShaderKey const& key)
 	{
 		if (key.GetShaderID() == LIB_DDGIRayTracing) CreateStateObject();
@@ -1,5 +1,6 @@
 #pragma once
 #include "Graphics/GfxDescriptor.h"
+#include "RenderGraph/RenderGraphResourceName.h"
 #include "entt/entity/fwd.hpp"
 
 namespace adria
@@ -17,19 +18,41 @@ namespace adria
 	{
 		static constexpr Uint32 PROBE_IRRADIANCE_TEXELS = 6;
 		static constexpr Uint32 PROBE_DISTANCE_TEXELS = 14;
+		static constexpr Uint32 MAX_CASCADES = 4;
+		static constexpr Uint32 PERSIST_FRAMES = 300;
+		//upper bound of rays per probe the probe update, relocation and classification kernels handle
+		static constexpr Uint32 MAX_RAYS_PER_PROBE = 512;
 		static Vector2u ProbeTextureDimensions(Vector3u const& num_probes, Uint32 texels_per_probe);
 
 		struct DDGIVolume
 		{
-			Vector3				 origin;
-			Vector3				 extents;
+			Vector3				 probe_spacing;
 			Vector3u			 num_probes;
+			Vector3i			 grid_origin;
+			Vector3i			 pending_scroll;
 			Uint32				 max_num_rays;
 			Uint32				 num_rays;
 			std::unique_ptr<GfxTexture> irradiance_history;
 			std::unique_ptr<GfxTexture> distance_history;
+			std::unique_ptr<GfxBuffer>  probe_data;
 			GfxDescriptor irradiance_history_srv;
 			GfxDescriptor distance_history_srv;
+			GfxDescriptor probe_data_srv;
+			Uint32				 probe_update_offset;
+		};
+		enum DDGIProbeState : Uint32
+		{
+			DDGIProbeState_Active = 0,
+			DDGIProbeState_Inactive
+		};
+		struct DDGIProbeGPU
+		{
+			Vector3 offset;
+			Uint32 state;
+			Float luminance_mean;
+			Float luminance_variance;
+			Uint32 num_rays;
+			Uint32 padding;
 		};
 		struct DDGIVolumeGPU
 		{
@@ -39,9 +62,15 @@ namespace adria
 			Int32 max_rays_per_probe;
 			Vector3i probe_count;
 			Float normal_bias;
+			Vector3i probe_scroll_offset;
 			Float energy_preservation;
 			Int32 irradiance_history_idx;
 			Int32 distance_history_idx;
+			Int32 probe_data_idx;
+			Int32 probe_update_offset;
+			Int32 probe_update_count;
+			Int32 min_rays_per_probe;
+			Float history_blend_weight;
 		};
 
 		enum DDGIVisualizeMode : Uint32
@@ -54,34 +83,60 @@ namespace adria
 		DDGIPass(GfxDevice* gfx, entt::registry& reg, Uint32 w, Uint32 h);
 		~DDGIPass();
 
-		void OnSceneInitialized();
+		void OnSceneInitialized(Uint64 scene_hash);
 		void OnResize(Uint32 w, Uint32 h);
+		void UpdateVolumes(Vector3 const& camera_position);
 
 		void AddPasses(RenderGraph& rg);
 		void AddVisualizePass(RenderGraph& rg);
 		void GUI();
 
+		void OnShadowTextureRendered(RGResourceName name)
+		{
+			if (IsEnabled() && std::find(shadow_textures.begin(), shadow_textures.end(), name) == shadow_textures.end()) shadow_textures.push_back(name);
+		}
+
 		Bool Visualize() const   { return visualize; }
 		Bool IsEnabled() const;
 		Bool IsSupported() const { return is_supported; }
 		Int32 GetDDGIVolumeIndex();
+		Uint32 GetDDGIVolumeCount() const { return (Uint32)ddgi_volumes.size(); }
 
 	private:
 		GfxDevice* gfx;
 		entt::registry& reg;
 		Uint32 width, height;
 		Bool is_supported;
+		Bool is_inline_supported;
 		std::unique_ptr<GfxStateObject> ddgi_trace_so;
-		DDGIVolume ddgi_volume;
+		std::unique_ptr<GfxComputePipelineState> ddgi_trace_inline_pso;
+		std::vector<RGResourceName> shadow_textures;
+		std::vector<DDGIVolume> ddgi_volumes;
 		std::unique_ptr<GfxBuffer>  ddgi_volume_buffer;
 		GfxDescriptor ddgi_volume_buffer_srv;
 		Bool visualize = false;
 		DDGIVisualizeMode ddgi_visualize_mode = DDGIVisualizeMode_Irradiance;
+		Int32 visualize_cascade = 0;
+		Uint64 scene_hash = 0;
+		Uint32 frames_until_persist = 0;
+		Bool persist_requested = false;
 		std::unique_ptr<GfxComputePipelineState>  update_irradiance_pso;
 		std::unique_ptr<GfxComputePipelineState>  update_distance_pso;
+		std::unique_ptr<GfxComputePipelineState>  relocate_probes_pso;
+		std::unique_ptr<GfxComputePipelineState>  classify_probes_pso;
+		std::unique_ptr<GfxComputePipelineState>  reset_probes_pso;
 		std::unique_ptr<GfxGraphicsPipelineState> visualize_probes_pso;
 
 	private:
+		void CreateVolume(DDGIVolume& ddgi_volume, Float probe_spacing, Uint32 volume_index);
+		void AddVolumePasses(RenderGraph& rg, Uint32 volume_index);
+		void AddPersistPass(RenderGraph& rg, Uint32 volume_index);
+		std::string GetVolumeCacheName(Uint32 volume_index) const;
+		Uint64 GetVolumeCacheHash(DDGIVolume const& ddgi_volume, Uint32 volume_index) const;
+		Uint32 GetProbeUpdateCount(DDGIVolume const& ddgi_volume) const;
+		Bool UseInlineTracing() const;
+		Uint32 GetRayCount(DDGIVolume const& ddgi_volume) const;
+		Uint32 GetMaxRayCount(DDGIVolume const& ddgi_volume) const;
 		void CreatePSOs();
 		void CreateStateObject();
 		void OnLibraryRecompiled(GfxShaderKey const&);
@@ -87,8 +87,8 @@ namespace adria
 
 				dlss_eval_params.pInDepth = depth_texture.GetNative();
 				dlss_eval_params.pInMotionVectors = velocity_texture.GetNative();
-                dlss_eval_params.InMVScaleX = (Float)render_width;
-                dlss_eval_params.InMVScaleY = (Float)render_height;
+                dlss_eval_params.InMVScaleX = (Float)GetDynamicRenderWidth();
+                dlss_eval_params.InMVScaleY = (Float)GetDynamicRenderHeight();
 
 				dlss_eval_params.pInExposureTexture = nullptr;
                 dlss_eval_params.InExposureScale = 1.0f;
@@ -96,7 +96,7 @@ namespace adria
 				dlss_eval_params.InJitterOffsetX = frame_data.camera_jitter_x;
 				dlss_eval_params.InJitterOffsetY = frame_data.camera_jitter_y;
 				dlss_eval_params.InReset = false;
-				dlss_eval_params.InRenderSubrectDimensions = { render_width, render_height };
+				dlss_eval_params.InRenderSubrectDimensions = { GetDynamicRenderWidth(), GetDynamicRenderHeight() };
 
 				NVSDK_NGX_Result result = NGX_D3D12_EVALUATE_DLSS_EXT(cmd_list->GetNative(), dlss_feature, ngx_parameters, &dlss_eval_params);
 				ADRIA_ASSERT(NVSDK_NGX_SUCCEED(result));
@@ -154,8 +154,8 @@ namespace adria
 
 				dlss_eval_params.pInDepth = depth_texture.GetNative();
 				dlss_eval_params.pInMotionVectors = velocity_texture.GetNative();
-				dlss_eval_params.InMVScaleX = (Float)render_width;
-				dlss_eval_params.InMVScaleY = (Float)render_height;
+				dlss_eval_params.InMVScaleX = (Float)GetDynamicRenderWidth();
+				dlss_eval_params.InMVScaleY = (Float)GetDynamicRenderHeight();
 
 				dlss_eval_params.pInExposureTexture = nullptr;
 				dlss_eval_params.InExposureScale = 1.0f;
@@ -163,7 +163,7 @@ namespace adria
 				dlss_eval_params.InJitterOffsetX = frame_data.camera_jitter_x;
 				dlss_eval_params.InJitterOffsetY = frame_data.camera_jitter_y;
 				dlss_eval_params.InReset = false;
-				dlss_eval_params.InRenderSubrectDimensions = { render_width, render_height };
+				dlss_eval_params.InRenderSubrectDimensions = { GetDynamicRenderWidth(), GetDynamicRenderHeight() };
 
 				NVSDK_NGX_Result result = NGX_D3D12_EVALUATE_DLSS_EXT(cmd_list->GetNative(), dlss_feature, ngx_parameters, &dlss_eval_params);
 				ADRIA_ASSERT(NVSDK_NGX_SUCCEED(result));
@@ -1,15 +1,20 @@
 #include "DebugRenderer.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h"
+#include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxDynamicAllocation.h"
 #include "Graphics/GfxReflection.h"
+#include "Graphics/GfxPipelineState.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Math/Packing.h"
 #include "Math/Constants.h"
+#include "Core/ConsoleManager.h"
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> GPUDebugPrimitives("r.DebugRenderer.GPUPrimitives", false, "Enable the buffer shaders append debug lines to, drawn with a single indirect draw");
+
 	struct SpherePointHelper
 	{
 		Vector3 center;
@@ -42,6 +47,11 @@ namespace adria
 	{
 		transient_lines.clear();
 		transient_triangles.clear();
+		gpu_primitive_args.reset();
+		gpu_primitive_vertices.reset();
+		clear_gpu_primitives_pso.reset();
+		gpu_primitives_pso.reset();
+		debug_psos.reset();
 		width = 0, height = 0;
 		gfx = nullptr;
 	}
@@ -53,6 +63,7 @@ namespace adria
 
 	void DebugRenderer::Render(RenderGraph& rg)
 	{
+		if (GPUDebugPrimitives.Get()) AddGPUPrimitivesPass(rg);
 		if (transient_lines.empty() && transient_triangles.empty() && persistent_lines.empty() && persistent_triangles.empty()) 
 			return;
 
@@ -120,6 +131,100 @@ namespace adria
 			}, RGPassType::Graphics, RGPassFlags::None);
 	}
 
+	void DebugRenderer::AddClearGPUPrimitivesPass(RenderGraph& rg)
+	{
+		if (!GPUDebugPrimitives.Get()) return;
+		if (!gpu_primitive_args) CreateGPUPrimitiveBuffers();
+
+		rg.ImportBuffer(RG_NAME(DebugPrimitiveArgs), gpu_primitive_args.get());
+		rg.ImportBuffer(RG_NAME(DebugPrimitiveVertices), gpu_primitive_vertices.get());
+
+		struct ClearGPUPrimitivesPassData
+		{
+			RGBufferReadWriteId args;
+			RGBufferReadWriteId vertices;
+		};
+		rg.AddPass<ClearGPUPrimitivesPassData>("Clear Debug Primitives Pass",
+			[=](ClearGPUPrimitivesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.args = builder.WriteBuffer(RG_NAME(DebugPrimitiveArgs));
+				data.vertices = builder.WriteBuffer(RG_NAME(DebugPrimitiveVertices));
+			},
+			[=](ClearGPUPrimitivesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor args_uav = gfx->AllocateDescriptorsGPU();
+				gfx->CopyDescriptors(1, args_uav, ctx.GetReadWriteBuffer(data.args));
+
+				struct ClearGPUPrimitivesConstants
+				{
+					Uint32 args_idx;
+				} constants =
+				{
+					.args_idx = args_uav.GetIndex()
+				};
+				cmd_list->SetPipelineState(clear_gpu_primitives_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+	}
+
+	Int32 DebugRenderer::GetGPUPrimitiveArgsIndex()
+	{
+		if (!GPUDebugPrimitives.Get() || !gpu_primitive_args) return -1;
+		GfxDescriptor gpu_descriptor = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, gpu_descriptor, gpu_primitive_args_uav);
+		return (Int32)gpu_descriptor.GetIndex();
+	}
+
+	Int32 DebugRenderer::GetGPUPrimitiveVerticesIndex()
+	{
+		if (!GPUDebugPrimitives.Get() || !gpu_primitive_vertices) return -1;
+		GfxDescriptor gpu_descriptor = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, gpu_descriptor, gpu_primitive_vertices_uav);
+		return (Int32)gpu_descriptor.GetIndex();
+	}
+
+	void DebugRenderer::AddGPUPrimitivesPass(RenderGraph& rg)
+	{
+		if (!rg.IsBufferDeclared(RG_NAME(DebugPrimitiveArgs))) return;
+
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		struct GPUPrimitivesPassData
+		{
+			RGBufferIndirectArgsId args;
+			RGBufferReadOnlyId vertices;
+		};
+		rg.AddPass<GPUPrimitivesPassData>("Debug Primitives Pass",
+			[=](GPUPrimitivesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.args = builder.ReadIndirectArgsBuffer(RG_NAME(DebugPrimitiveArgs));
+				data.vertices = builder.ReadBuffer(RG_NAME(DebugPrimitiveVertices), ReadAccess_NonPixelShader);
+				builder.WriteRenderTarget(RG_NAME(FinalTexture), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.ReadDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=](GPUPrimitivesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor vertices_srv = gfx->AllocateDescriptorsGPU();
+				gfx->CopyDescriptors(1, vertices_srv, ctx.GetReadOnlyBuffer(data.vertices));
+
+				struct GPUPrimitivesConstants
+				{
+					Uint32 vertices_idx;
+				} constants =
+				{
+					.vertices_idx = vertices_srv.GetIndex()
+				};
+				cmd_list->SetPipelineState(gpu_primitives_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetTopology(GfxPrimitiveTopology::LineList);
+				cmd_list->DrawIndirect(ctx.GetIndirectArgsBuffer(data.args), 0);
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+
 	void DebugRenderer::AddLine(Vector3 const& start, Vector3 const& end, Color color)
 	{
 		std::vector<DebugLine>& lines = (mode == DebugRendererMode::Transient ? transient_lines : persistent_lines);
@@ -333,6 +438,42 @@ namespace adria
 		gfx_pso_desc.rasterizer_state.fill_mode = GfxFillMode::Wireframe;
 		gfx_pso_desc.topology_type = GfxPrimitiveTopologyType::Line;
 		debug_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gfx_pso_desc);
+
+		gfx_pso_desc.input_layout = {};
+		gfx_pso_desc.VS = VS_DebugGPUPrimitives;
+		gpu_primitives_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
+
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_ClearDebugGPUPrimitives;
+		clear_gpu_primitives_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void DebugRenderer::CreateGPUPrimitiveBuffers()
+	{
+		GfxBufferDesc args_desc{};
+		args_desc.resource_usage = GfxResourceUsage::Default;
+		args_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+		args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+		args_desc.stride = sizeof(D3D12_DRAW_ARGUMENTS);
+		args_desc.size = sizeof(D3D12_DRAW_ARGUMENTS);
+		gpu_primitive_args = gfx->CreateBuffer(args_desc);
+		gpu_primitive_args->SetName("Debug Primitive Args");
+
+		GfxBufferDesc vertices_desc{};
+		vertices_desc.resource_usage = GfxResourceUsage::Default;
+		vertices_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		vertices_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+		vertices_desc.stride = sizeof(DebugVertex);
+		vertices_desc.size = sizeof(DebugLine) * MAX_GPU_DEBUG_LINES;
+		gpu_primitive_vertices = gfx->CreateBuffer(vertices_desc);
+		gpu_primitive_vertices->SetName("Debug Primitive Vertices");
+
+		gpu_primitive_args_uav = gfx->CreateBufferUAV(gpu_primitive_args.get());
+		gpu_primitive_vertices_uav = gfx->CreateBufferUAV(gpu_primitive_vertices.get());
+
+		GfxCommandList* cmd_list = gfx->GetCommandList();
+		cmd_list->BufferBarrier(*gpu_primitive_args, GfxResourceState::Common, GfxResourceState::ComputeUAV);
+		cmd_list->BufferBarrier(*gpu_primitive_vertices, GfxResourceState::Common, GfxResourceState::ComputeUAV);
 	}
 
 	DebugRenderer::DebugRenderer() = default;
@@ -1,5 +1,6 @@
 #pragma once
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
+#include "Graphics/GfxDescriptor.h"
 #include "Utilities/Singleton.h"
 
 using namespace DirectX;
@@ -7,6 +8,7 @@ using namespace DirectX;
 namespace adria
 {
 	class GfxDevice;
+	class GfxBuffer;
 	class RenderGraph;
 
 	enum class DebugRendererMode : Bool
@@ -19,6 +21,8 @@ namespace adria
 	{
 		friend class Singleton<DebugRenderer>;
 
+		static constexpr Uint32 MAX_GPU_DEBUG_LINES = 1 << 18;
+
 		static Uint32 ColorToUint(Color const& col);
 
 		struct DebugVertex
@@ -59,6 +63,9 @@ namespace adria
 		void OnResize(Uint32 w, Uint32 h);
 
 		void Render(RenderGraph& rg);
+		void AddClearGPUPrimitivesPass(RenderGraph& rg);
+		Int32 GetGPUPrimitiveArgsIndex();
+		Int32 GetGPUPrimitiveVerticesIndex();
 
 		void AddLine(Vector3 const& start, Vector3 const& end, Color color);
 		void AddRay(Vector3 const& origin, Vector3 const& direction, Color color);
@@ -84,11 +91,20 @@ namespace adria
 		Uint32 width = 0, height = 0;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> debug_psos;
 
+		std::unique_ptr<GfxBuffer> gpu_primitive_args;
+		std::unique_ptr<GfxBuffer> gpu_primitive_vertices;
+		GfxDescriptor gpu_primitive_args_uav;
+		GfxDescriptor gpu_primitive_vertices_uav;
+		std::unique_ptr<GfxComputePipelineState> clear_gpu_primitives_pso;
+		std::unique_ptr<GfxGraphicsPipelineState> gpu_primitives_pso;
+
 	private:
 		DebugRenderer();
 		~DebugRenderer();
 
 		void CreatePSOs();
+		void CreateGPUPrimitiveBuffers();
+		void AddGPUPrimitivesPass(RenderGraph& rg);
 	};
 	#define g_DebugRenderer DebugRenderer::Get()
 }
\ No newline at end of file
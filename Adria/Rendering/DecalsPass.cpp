@@ -4,15 +4,20 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h"
 #include "TextureManager.h"
+#include "OcclusionQueryPass.h"
+#include "Graphics/GfxDevice.h"
 #include "Graphics/GfxReflection.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
+#include "Core/ConsoleManager.h"
 #include "entt/entity/registry.hpp"
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> TiledDecals("r.Decals.Tiled", true, "Cull decals into screen tiles and apply all of them in one compute pass instead of drawing a cube per decal");
 
 	DecalsPass::DecalsPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
 	 : reg{ reg }, gfx{ gfx }, width{ w }, height{ h }
@@ -21,9 +26,16 @@ namespace adria
 	}
 	DecalsPass::~DecalsPass() = default;
 
-	void DecalsPass::AddPass(RenderGraph& rendergraph)
+	void DecalsPass::AddPass(RenderGraph& rendergraph, OcclusionQueryPass* occlusion_queries)
 	{
 		if (reg.view<Decal>().size() == 0) return;
+		std::vector<entt::entity> visible_decals = GetVisibleDecals(occlusion_queries);
+		if (visible_decals.empty()) return;
+		if (TiledDecals.Get())
+		{
+			AddTiledPasses(rendergraph, visible_decals);
+			return;
+		}
 		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
 
 		struct DecalsPassData
@@ -60,11 +72,9 @@ namespace adria
 				};
 
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				auto decal_view = reg.view<Decal>();
 
 				auto decal_pass_lambda = [&](Bool modify_normals)
 				{
-					if (decal_view.empty()) return;
 
 					if (modify_normals)
 					{
@@ -78,16 +88,16 @@ namespace adria
 					}
 					GfxPipelineState* pso = decal_psos->Get();
 					cmd_list->SetPipelineState(pso);
-					for (auto e : decal_view)
+					for (auto e : visible_decals)
 					{
-						Decal& decal = decal_view.get<Decal>(e);
+						Decal const& decal = reg.get<Decal>(e);
 						if (decal.modify_gbuffer_normals != modify_normals) continue;
 
 						constants.model_matrix = decal.decal_model_matrix;
 						constants.transposed_inverse_model = decal.decal_model_matrix.Invert().Transpose(); 
 						constants.decal_type = static_cast<Uint32>(decal.decal_type);
-						constants.decal_albedo_idx = (Uint32)decal.albedo_decal_texture;
-						constants.decal_normal_idx = (Uint32)decal.normal_decal_texture;
+						constants.decal_albedo_idx = GetTextureIndex(decal.albedo_decal_texture);
+						constants.decal_normal_idx = GetTextureIndex(decal.normal_decal_texture);
 						
 						cmd_list->SetRootCBV(2, constants);
 						cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
@@ -127,6 +137,176 @@ namespace adria
 		decals_pso_desc.num_render_targets = 1;
 		decals_pso_desc.rtv_formats[0] = GfxFormat::R8G8B8A8_UNORM;
 		decal_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, decals_pso_desc);
+
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_DecalsTileCulling;
+		decals_tile_culling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DecalsApply;
+		decals_apply_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	std::vector<entt::entity> DecalsPass::GetVisibleDecals(OcclusionQueryPass* occlusion_queries) const
+	{
+		std::vector<entt::entity> visible_decals;
+		for (auto e : reg.view<Decal>())
+		{
+			if (occlusion_queries)
+			{
+				Decal const& decal = reg.get<Decal>(e);
+				BoundingBox decal_bounds(Vector3::Zero, Vector3(0.5f));
+				decal_bounds.Transform(decal_bounds, decal.decal_model_matrix);
+
+				Uint32 const decal_id = entt::to_integral(e);
+				Bool const visible = occlusion_queries->IsVisible(OcclusionQueryGroup::Decal, decal_id);
+				occlusion_queries->AddQuery(OcclusionQueryGroup::Decal, decal_id, decal_bounds);
+				if (!visible) continue;
+			}
+			visible_decals.push_back(e);
+		}
+		return visible_decals;
+	}
+
+	void DecalsPass::AddTiledPasses(RenderGraph& rendergraph, std::vector<entt::entity> const& visible_decals)
+	{
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+
+		std::vector<DecalGPU> decals;
+		for (auto e : visible_decals)
+		{
+			Decal const& decal = reg.get<Decal>(e);
+			DecalGPU& decal_gpu = decals.emplace_back();
+			decal_gpu.model_matrix = decal.decal_model_matrix;
+			decal_gpu.transposed_inverse_model = decal.decal_model_matrix.Invert().Transpose();
+			decal_gpu.decal_type = static_cast<Uint32>(decal.decal_type);
+			decal_gpu.decal_albedo_idx = GetTextureIndex(decal.albedo_decal_texture);
+			decal_gpu.decal_normal_idx = GetTextureIndex(decal.normal_decal_texture);
+			decal_gpu.modify_normals = decal.modify_gbuffer_normals;
+		}
+		Uint32 const decal_count = (Uint32)decals.size();
+		Uint32 const tiles_x = DivideAndRoundUp(width, TILE_SIZE);
+		Uint32 const tiles_y = DivideAndRoundUp(height, TILE_SIZE);
+
+		struct DecalsUploadPassData
+		{
+			RGBufferCopyDstId decals;
+		};
+		rendergraph.AddPass<DecalsUploadPassData>("Decals Upload Pass",
+			[=](DecalsUploadPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc decals_desc{};
+				decals_desc.resource_usage = GfxResourceUsage::Default;
+				decals_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				decals_desc.stride = sizeof(DecalGPU);
+				decals_desc.size = sizeof(DecalGPU) * decal_count;
+				builder.DeclareBuffer(RG_NAME(DecalsBuffer), decals_desc);
+				data.decals = builder.WriteCopyDstBuffer(RG_NAME(DecalsBuffer));
+			},
+			[=](DecalsUploadPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				Uint64 const decals_size = sizeof(DecalGPU) * decals.size();
+				GfxDynamicAllocation staging = cmd_list->GetDevice()->GetDynamicAllocator()->Allocate(decals_size, 16);
+				staging.Update(decals.data(), decals_size);
+				cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.decals), 0, *staging.buffer, staging.offset, decals_size);
+			}, RGPassType::Copy, RGPassFlags::None);
+
+		struct DecalsTileCullingPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGBufferReadOnlyId  decals;
+			RGBufferReadWriteId tile_lists;
+		};
+		rendergraph.AddPass<DecalsTileCullingPassData>("Decals Tile Culling Pass",
+			[=](DecalsTileCullingPassData& data, RenderGraphBuilder& builder)
+			{
+				//each tile stores its decal count followed by up to MAX_DECALS_PER_TILE indices
+				RGBufferDesc tile_lists_desc{};
+				tile_lists_desc.resource_usage = GfxResourceUsage::Default;
+				tile_lists_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				tile_lists_desc.stride = sizeof(Uint32);
+				tile_lists_desc.size = sizeof(Uint32) * tiles_x * tiles_y * (MAX_DECALS_PER_TILE + 1);
+				builder.DeclareBuffer(RG_NAME(DecalTileLists), tile_lists_desc);
+
+				data.tile_lists = builder.WriteBuffer(RG_NAME(DecalTileLists));
+				data.decals = builder.ReadBuffer(RG_NAME(DecalsBuffer));
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+			},
+			[=](DecalsTileCullingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.depth),
+												context.GetReadOnlyBuffer(data.decals),
+												context.GetReadWriteBuffer(data.tile_lists) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct DecalsTileCullingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 decals_idx;
+					Uint32 tile_lists_idx;
+					Uint32 decal_count;
+				} constants =
+				{
+					.depth_idx = i, .decals_idx = i + 1, .tile_lists_idx = i + 2, .decal_count = decal_count
+				};
+
+				cmd_list->SetPipelineState(decals_tile_culling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(tiles_x, tiles_y, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct DecalsApplyPassData
+		{
+			RGTextureReadOnlyId  depth;
+			RGBufferReadOnlyId   decals;
+			RGBufferReadOnlyId   tile_lists;
+			RGTextureReadWriteId gbuffer_albedo;
+			RGTextureReadWriteId gbuffer_normal;
+		};
+		rendergraph.AddPass<DecalsApplyPassData>("Decals Apply Pass",
+			[=](DecalsApplyPassData& data, RenderGraphBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.decals = builder.ReadBuffer(RG_NAME(DecalsBuffer));
+				data.tile_lists = builder.ReadBuffer(RG_NAME(DecalTileLists));
+				data.gbuffer_albedo = builder.WriteTexture(RG_NAME(GBufferAlbedo));
+				data.gbuffer_normal = builder.WriteTexture(RG_NAME(GBufferNormal));
+			},
+			[=](DecalsApplyPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.depth),
+												context.GetReadOnlyBuffer(data.decals),
+												context.GetReadOnlyBuffer(data.tile_lists),
+												context.GetReadWriteTexture(data.gbuffer_albedo),
+												context.GetReadWriteTexture(data.gbuffer_normal) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				//decals of a tile are blended in list order, so overlapping decals resolve in register without blend state
+				struct DecalsApplyConstants
+				{
+					Uint32 depth_idx;
+					Uint32 decals_idx;
+					Uint32 tile_lists_idx;
+					Uint32 gbuffer_albedo_idx;
+					Uint32 gbuffer_normal_idx;
+				} constants =
+				{
+					.depth_idx = i, .decals_idx = i + 1, .tile_lists_idx = i + 2, .gbuffer_albedo_idx = i + 3, .gbuffer_normal_idx = i + 4
+				};
+
+				cmd_list->SetPipelineState(decals_apply_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(tiles_x, tiles_y, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
 	void DecalsPass::CreateCubeBuffers()
@@ -8,14 +8,18 @@ namespace adria
 	class RenderGraph;
 	class GfxDevice;
 	class GfxBuffer;
+	class OcclusionQueryPass;
 
 	class DecalsPass
 	{
+		static constexpr Uint32 TILE_SIZE = 16;
+		static constexpr Uint32 MAX_DECALS_PER_TILE = 63;
+
 	public:
 		DecalsPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
 		~DecalsPass();
 
-		void AddPass(RenderGraph& rendergraph);
+		void AddPass(RenderGraph& rendergraph, OcclusionQueryPass* occlusion_queries = nullptr);
 		void OnResize(Uint32 w, Uint32 h);
 		void OnSceneInitialized();
 
@@ -26,9 +30,13 @@ namespace adria
 		std::unique_ptr<GfxBuffer>	cube_vb = nullptr;
 		std::unique_ptr<GfxBuffer>	cube_ib = nullptr;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> decal_psos;
+		std::unique_ptr<GfxComputePipelineState> decals_tile_culling_pso;
+		std::unique_ptr<GfxComputePipelineState> decals_apply_pso;
 
 	private:
 		void CreatePSOs();
 		void CreateCubeBuffers();
+		std::vector<entt::entity> GetVisibleDecals(OcclusionQueryPass* occlusion_queries) const;
+		void AddTiledPasses(RenderGraph& rendergraph, std::vector<entt::entity> const& visible_decals);
 	};
 }
\ No newline at end of file
@@ -4,16 +4,39 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h" 
 #include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "Graphics/GfxCommon.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
 #include "Math/Packing.h"
+#include "Core/ConsoleManager.h"
 #include "Logging/Logger.h"
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> TileClassification("r.DeferredLighting.TileClassification", true, "Bin screen tiles by shading extension and light each bin with a specialized shader permutation");
+
+	namespace
+	{
+		//one bin per shading extension plus one for tiles that mix extensions and need the full shader
+		constexpr Uint32 TILE_BIN_COUNT = (Uint32)ShadingExtension::Count + 1;
+		constexpr Uint32 TILE_BIN_MIXED = (Uint32)ShadingExtension::Count;
+
+		void AddTileBinDefines(GfxComputePipelineStatePermutations& psos, Uint32 bin)
+		{
+			psos.AddDefine("TILE_CLASSIFICATION", "1");
+			switch (bin)
+			{
+			case (Uint32)ShadingExtension::None: break;
+			case (Uint32)ShadingExtension::Anisotropy: psos.AddDefine("SHADING_EXTENSION_ANISOTROPY", "1"); break;
+			case (Uint32)ShadingExtension::ClearCoat: psos.AddDefine("SHADING_EXTENSION_CLEARCOAT", "1"); break;
+			case (Uint32)ShadingExtension::Sheen: psos.AddDefine("SHADING_EXTENSION_SHEEN", "1"); break;
+			case TILE_BIN_MIXED: psos.AddDefine("SHADING_EXTENSION_ALL", "1"); break;
+			}
+		}
+	}
 
 	DeferredLightingPass::DeferredLightingPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
 	{
@@ -22,6 +45,9 @@ namespace adria
 
 	void DeferredLightingPass::AddPass(RenderGraph& rg)
 	{
+		Bool const tile_classification = TileClassification.Get();
+		if (tile_classification) AddClassifyTilesPass(rg);
+
 		struct LightingPassData
 		{
 			RGTextureReadOnlyId  gbuffer_normal;
@@ -31,6 +57,8 @@ namespace adria
 			RGTextureReadOnlyId  depth;
 			RGTextureReadOnlyId  ambient_occlusion;
 			RGTextureReadWriteId output;
+			RGBufferReadOnlyId   tile_lists;
+			RGBufferIndirectArgsId tile_args;
 		};
 
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
@@ -53,8 +81,15 @@ namespace adria
 
 				if (builder.IsTextureDeclared(RG_NAME(AmbientOcclusion))) data.ambient_occlusion = builder.ReadTexture(RG_NAME(AmbientOcclusion), ReadAccess_NonPixelShader);
 				else data.ambient_occlusion.Invalidate();
+				if (builder.IsTextureDeclared(RG_NAME(ReSTIR_GI_Irradiance))) std::ignore = builder.ReadTexture(RG_NAME(ReSTIR_GI_Irradiance), ReadAccess_NonPixelShader);
 
 				for (auto& shadow_texture : shadow_textures) std::ignore = builder.ReadTexture(shadow_texture);
+
+				if (tile_classification)
+				{
+					data.tile_lists = builder.ReadBuffer(RG_NAME(DeferredLightingTileLists));
+					data.tile_args = builder.ReadIndirectArgsBuffer(RG_NAME(DeferredLightingTileArgs));
+				}
 			},
 			[=](LightingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
 			{
@@ -66,7 +101,8 @@ namespace adria
 												context.GetReadOnlyTexture(data.gbuffer_custom),
 												context.GetReadOnlyTexture(data.depth),
 												data.ambient_occlusion.IsValid() ? context.GetReadOnlyTexture(data.ambient_occlusion) : gfxcommon::GetCommonView(GfxCommonViewType::WhiteTexture2D_SRV),
-												context.GetReadWriteTexture(data.output) };
+												context.GetReadWriteTexture(data.output),
+												tile_classification ? context.GetReadOnlyBuffer(data.tile_lists) : gfxcommon::GetCommonView(GfxCommonViewType::NullTexture2D_SRV) };
 
 				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
 				Uint32 i = dst_handle.GetIndex();
@@ -85,15 +121,30 @@ namespace adria
 					Uint32 depth_idx;
 					Uint32 ao_idx;
 					Uint32 output_idx;
+					Uint32 tile_lists_idx;
 				} constants =
 				{
-					.normal_metallic_idx = i, .diffuse_idx = i + 1, .emissive_idx = i + 2, .custom_idx = i + 3, .depth_idx = i + 4, .ao_idx = i + 5, .output_idx = i + 6
+					.normal_metallic_idx = i, .diffuse_idx = i + 1, .emissive_idx = i + 2, .custom_idx = i + 3, .depth_idx = i + 4, .ao_idx = i + 5, .output_idx = i + 6, .tile_lists_idx = i + 7
 				};
 
-				cmd_list->SetPipelineState(deferred_lighting_pso.get());
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+				if (!tile_classification)
+				{
+					cmd_list->SetPipelineState(deferred_lighting_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width, TILE_SIZE), DivideAndRoundUp(height, TILE_SIZE), 1);
+					return;
+				}
+
+				GfxBuffer const& tile_args = context.GetIndirectArgsBuffer(data.tile_args);
+				for (Uint32 bin = 0; bin < TILE_BIN_COUNT; ++bin)
+				{
+					AddTileBinDefines(*deferred_lighting_psos, bin);
+					cmd_list->SetPipelineState(deferred_lighting_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->DispatchIndirect(tile_args, bin * sizeof(D3D12_DISPATCH_ARGUMENTS));
+				}
 			}, RGPassType::Compute);
 
 		shadow_textures.clear();
@@ -104,6 +155,87 @@ namespace adria
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_DeferredLighting;
 		deferred_lighting_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		deferred_lighting_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DeferredLightingClearTileArgs;
+		clear_tile_args_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DeferredLightingClassifyTiles;
+		classify_tiles_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void DeferredLightingPass::AddClassifyTilesPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const tiles_x = DivideAndRoundUp(width, TILE_SIZE);
+		Uint32 const tiles_y = DivideAndRoundUp(height, TILE_SIZE);
+		Uint32 const tile_count = tiles_x * tiles_y;
+
+		struct ClassifyTilesPassData
+		{
+			RGTextureReadOnlyId  gbuffer_custom;
+			RGTextureReadOnlyId  depth;
+			RGBufferReadWriteId  tile_lists;
+			RGBufferReadWriteId  tile_args;
+		};
+
+		rg.AddPass<ClassifyTilesPassData>("Deferred Lighting Classify Tiles Pass",
+			[=](ClassifyTilesPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc tile_lists_desc{};
+				tile_lists_desc.resource_usage = GfxResourceUsage::Default;
+				tile_lists_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				tile_lists_desc.stride = sizeof(Uint32);
+				tile_lists_desc.size = sizeof(Uint32) * tile_count * TILE_BIN_COUNT;
+				builder.DeclareBuffer(RG_NAME(DeferredLightingTileLists), tile_lists_desc);
+
+				RGBufferDesc tile_args_desc{};
+				tile_args_desc.resource_usage = GfxResourceUsage::Default;
+				tile_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				tile_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+				tile_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS) * TILE_BIN_COUNT;
+				builder.DeclareBuffer(RG_NAME(DeferredLightingTileArgs), tile_args_desc);
+
+				data.tile_lists = builder.WriteBuffer(RG_NAME(DeferredLightingTileLists));
+				data.tile_args = builder.WriteBuffer(RG_NAME(DeferredLightingTileArgs));
+				data.gbuffer_custom = builder.ReadTexture(RG_NAME(GBufferCustom), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+			},
+			[=](ClassifyTilesPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.gbuffer_custom),
+												context.GetReadOnlyTexture(data.depth),
+												context.GetReadWriteBuffer(data.tile_lists),
+												context.GetReadWriteBuffer(data.tile_args) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				//bin b owns tile_lists[b * tile_count, (b + 1) * tile_count), its dispatch args are tile_args[b]
+				struct ClassifyTilesConstants
+				{
+					Uint32 custom_idx;
+					Uint32 depth_idx;
+					Uint32 tile_lists_idx;
+					Uint32 tile_args_idx;
+					Uint32 tile_count;
+				} constants =
+				{
+					.custom_idx = i, .depth_idx = i + 1, .tile_lists_idx = i + 2, .tile_args_idx = i + 3, .tile_count = tile_count
+				};
+
+				cmd_list->SetPipelineState(clear_tile_args_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				cmd_list->SetPipelineState(classify_tiles_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(tiles_x, tiles_y, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
 }
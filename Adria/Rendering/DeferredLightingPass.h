@@ -1,16 +1,18 @@
 #pragma once
 #include "RenderGraph/RenderGraphResourceId.h"
 #include "RenderGraph/RenderGraphResourceName.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 #include "entt/entity/entity.hpp"
 
 namespace adria
 {
 	class GfxDevice;
-	class GfxComputePipelineState;
 	class RenderGraph;
 
 	class DeferredLightingPass
 	{
+		static constexpr Uint32 TILE_SIZE = 16;
+
 	public:
 		DeferredLightingPass(GfxDevice* gfx, Uint32 w, Uint32 h);
 		void AddPass(RenderGraph& rendergraph);
@@ -29,9 +31,13 @@ namespace adria
 		Uint32 width, height;
 		std::vector<RGResourceName> shadow_textures;
 		std::unique_ptr<GfxComputePipelineState> deferred_lighting_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> deferred_lighting_psos;
+		std::unique_ptr<GfxComputePipelineState> clear_tile_args_pso;
+		std::unique_ptr<GfxComputePipelineState> classify_tiles_pso;
 
 	private:
 		void CreatePSOs();
+		void AddClassifyTilesPass(RenderGraph& rendergraph);
 	};
 
 }
\ No newline at end of file
@@ -22,10 +22,55 @@ namespace adria
 	static TAutoConsoleVariable<Float> FocalLength("r.DepthOfField.FocalLength", 200.0f, "Focal Length used in Depth of Field pass");
 	static TAutoConsoleVariable<Float> FocusDistance("r.DepthOfField.FocusDistance", 50.0f, "Focus Distance used in Depth of Field pass");
 	static TAutoConsoleVariable<Float> FStop("r.DepthOfField.FStop", 1.0f, "F-Stop used in Depth of Field pass");
+	static TAutoConsoleVariable<Bool>  TileClassification("r.DepthOfField.TileClassification", true, "Classify screen tiles by their CoC range so in focus tiles skip the gathers and near or far tiles only run the field they need");
+	static TAutoConsoleVariable<Float> TileFocusThreshold("r.DepthOfField.TileFocusThreshold", 0.05f, "Fraction of the max CoC below which a tile is treated as in focus");
 
 	static constexpr Uint32 SMALL_BOKEH_KERNEL_RING_COUNT   = 3;
 	static constexpr Uint32 SMALL_BOKEH_KERNEL_RING_DENSITY = 5;
 
+	//tiles with CoC only in front of or only behind the focus plane run the gathers for that field alone
+	static constexpr Uint32 TILE_BIN_NEAR = 0;
+	static constexpr Uint32 TILE_BIN_FAR = 1;
+	static constexpr Uint32 TILE_BIN_NEAR_FAR = 2;
+	static constexpr Uint32 TILE_BIN_FOCUS = 3;
+	static constexpr Uint32 TILE_BIN_COUNT = 4;
+	static constexpr Uint32 TILE_GATHER_BIN_COUNT = TILE_BIN_FOCUS;
+
+	static void AddTileBinDefines(GfxComputePipelineStatePermutations& psos, Uint32 bin)
+	{
+		psos.AddDefine("TILE_CLASSIFICATION", "1");
+		switch (bin)
+		{
+		case TILE_BIN_NEAR: psos.AddDefine("NEAR_FIELD", "1"); break;
+		case TILE_BIN_FAR: psos.AddDefine("FAR_FIELD", "1"); break;
+		case TILE_BIN_NEAR_FAR: psos.AddDefine("NEAR_FIELD", "1"); psos.AddDefine("FAR_FIELD", "1"); break;
+		case TILE_BIN_FOCUS: psos.AddDefine("IN_FOCUS", "1"); break;
+		}
+	}
+	//dispatches the tiles of every bin with its permutation, the tile lists are bound through the root CBV
+	template<typename F>
+	static void DispatchTileBins(RenderGraphContext& ctx, GfxCommandList* cmd_list, GfxComputePipelineStatePermutations& psos, RGBufferReadOnlyId tile_lists, RGBufferIndirectArgsId tile_args, Uint32 bin_count, Bool karis_inverse, F&& set_root_parameters)
+	{
+		GfxDevice* gfx = cmd_list->GetDevice();
+		GfxDescriptor tile_lists_descriptor = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, tile_lists_descriptor, ctx.GetReadOnlyBuffer(tile_lists));
+		struct TileConstants
+		{
+			Uint32 tile_lists_idx;
+		} tile_constants = { .tile_lists_idx = tile_lists_descriptor.GetIndex() };
+
+		GfxBuffer const& args = ctx.GetIndirectArgsBuffer(tile_args);
+		for (Uint32 bin = 0; bin < bin_count; ++bin)
+		{
+			AddTileBinDefines(psos, bin);
+			if (karis_inverse) psos.AddDefine("KARIS_INVERSE", "1");
+			cmd_list->SetPipelineState(psos.Get());
+			set_root_parameters();
+			cmd_list->SetRootCBV(2, tile_constants);
+			cmd_list->DispatchIndirect(args, bin * sizeof(D3D12_DISPATCH_ARGUMENTS));
+		}
+	}
+
 	static Uint32 GetSampleCount(Uint32 ring_count, Uint32 ring_density)
 	{
 		return 1 + ring_density * (ring_count - 1) * ring_count / 2;
@@ -54,7 +99,7 @@ namespace adria
 		return kernel_data;
 	}
 
-	DepthOfFieldPass::DepthOfFieldPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), blur_pass(gfx)
+	DepthOfFieldPass::DepthOfFieldPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), blur_pass(gfx), spd_pass(gfx)
 	{
 		CreatePSOs();
 	}
@@ -62,14 +107,16 @@ namespace adria
 
 	void DepthOfFieldPass::AddPass(RenderGraph& rg, PostProcessor* postprocessor)
 	{
+		Bool const tile_classification = TileClassification.Get();
 		AddComputeCircleOfConfusionPass(rg);
 		AddSeparatedCircleOfConfusionPass(rg);
 		AddDownsampleCircleOfConfusionPass(rg);
-		AddComputePrefilteredTexturePass(rg, postprocessor->GetFinalResource());
-		AddBokehFirstPass(rg, postprocessor->GetFinalResource());
-		AddBokehSecondPass(rg);
-		AddComputePostfilteredTexturePass(rg);
-		AddCombinePass(rg, postprocessor->GetFinalResource());
+		if (tile_classification) AddClassifyTilesPass(rg);
+		AddComputePrefilteredTexturePass(rg, postprocessor->GetFinalResource(), tile_classification);
+		AddBokehFirstPass(rg, postprocessor->GetFinalResource(), tile_classification);
+		AddBokehSecondPass(rg, tile_classification);
+		AddComputePostfilteredTexturePass(rg, tile_classification);
+		AddCombinePass(rg, postprocessor->GetFinalResource(), tile_classification);
 		postprocessor->SetFinalResource(RG_NAME(DepthOfFieldOutput));
 	}
 
@@ -101,6 +148,8 @@ namespace adria
 					ImGui::SliderFloat("FStop", FStop.GetPtr(), 1.0f, 8.0f);
 					ImGui::SliderFloat("Alpha Interpolation", AlphaInterpolation.GetPtr(), 0.00f, 1.0f);
 					ImGui::Checkbox("Karis Inverse", BokehKarisInverse.GetPtr());
+					ImGui::Checkbox("Tile Classification", TileClassification.GetPtr());
+					if (TileClassification.Get()) ImGui::SliderFloat("Tile Focus Threshold", TileFocusThreshold.GetPtr(), 0.0f, 0.5f);
 					ImGui::TreePop();
 					ImGui::Separator();
 				}
@@ -116,11 +165,8 @@ namespace adria
 		compute_pso_desc.CS = CS_DepthOfField_ComputeSeparatedCoC;
 		compute_separated_coc_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 
-		compute_pso_desc.CS = CS_DepthOfField_DownsampleCoC;
-		downsample_coc_pso = gfx->CreateComputePipelineState(compute_pso_desc);
-
 		compute_pso_desc.CS = CS_DepthOfField_ComputePrefilteredTexture;
-		compute_prefiltered_texture_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_prefiltered_texture_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 
 		compute_pso_desc.CS = CS_DepthOfField_BokehFirstPass;
 		bokeh_first_pass_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
@@ -129,10 +175,16 @@ namespace adria
 		bokeh_second_pass_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 
 		compute_pso_desc.CS = CS_DepthOfField_ComputePostfilteredTexture;
-		compute_posfiltered_texture_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_posfiltered_texture_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 
 		compute_pso_desc.CS = CS_DepthOfField_Combine;
-		combine_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		combine_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DepthOfField_ClearTileArgs;
+		clear_tile_args_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_DepthOfField_ClassifyTiles;
+		classify_tiles_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 	}
 
 	void DepthOfFieldPass::CreateSmallBokehKernel()
@@ -302,66 +354,93 @@ namespace adria
 	{
 		static constexpr Uint32 pass_count = 4;
 
-		std::vector<RGResourceName> coc_mips(pass_count);
-		coc_mips[0] = RG_NAME_IDX(CoCDilationMip, 0);
-		for (Uint32 i = 1; i < pass_count; ++i)
-		{
-			coc_mips[i] = RG_NAME_IDX(CoCDilationMip, i);
+		std::vector<RGResourceName> coc_mips(pass_count - 1);
+		for (Uint32 i = 1; i < pass_count; ++i) coc_mips[i - 1] = RG_NAME_IDX(CoCDilationMip, i);
+		spd_pass.AddPass(rg, RG_NAME_IDX(CoCDilationMip, 0), coc_mips, GfxFormat::R16_UNORM, SPDReductionOp::Max, "CoC Downsample");
+		blur_pass.AddPass(rg, coc_mips.back(), RG_NAME(CoCDilation), "CoC Blur");
+	}
+
+	void DepthOfFieldPass::AddClassifyTilesPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const tiles_x = DivideAndRoundUp(width, TILE_SIZE);
+		Uint32 const tiles_y = DivideAndRoundUp(height, TILE_SIZE);
+		Uint32 const tile_count = tiles_x * tiles_y;
 
-			Uint32 mip_width = width >> i;
-			Uint32 mip_height = height >> i;
+		struct ClassifyTilesPassData
+		{
+			RGTextureReadOnlyId coc;
+			RGTextureReadOnlyId coc_dilation;
+			RGBufferReadWriteId tile_lists;
+			RGBufferReadWriteId tile_args;
+		};
 
-			struct DownsampleCircleOfConfusionPassData
+		rg.AddPass<ClassifyTilesPassData>("Depth Of Field Classify Tiles Pass",
+			[=](ClassifyTilesPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc tile_lists_desc{};
+				tile_lists_desc.resource_usage = GfxResourceUsage::Default;
+				tile_lists_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				tile_lists_desc.stride = sizeof(Uint32);
+				tile_lists_desc.size = sizeof(Uint32) * tile_count * TILE_BIN_COUNT;
+				builder.DeclareBuffer(RG_NAME(DoFTileLists), tile_lists_desc);
+
+				RGBufferDesc tile_args_desc{};
+				tile_args_desc.resource_usage = GfxResourceUsage::Default;
+				tile_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				tile_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+				tile_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS) * TILE_BIN_COUNT;
+				builder.DeclareBuffer(RG_NAME(DoFTileArgs), tile_args_desc);
+
+				data.tile_lists = builder.WriteBuffer(RG_NAME(DoFTileLists));
+				data.tile_args = builder.WriteBuffer(RG_NAME(DoFTileArgs));
+				data.coc = builder.ReadTexture(RG_NAME(CoCTexture), ReadAccess_NonPixelShader);
+				data.coc_dilation = builder.ReadTexture(RG_NAME(CoCDilation), ReadAccess_NonPixelShader);
+			},
+			[=](ClassifyTilesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
-				RGTextureReadOnlyId input;
-				RGTextureReadWriteId output;
-			};
+				GfxDevice* gfx = cmd_list->GetDevice();
 
-			rg.AddPass<DownsampleCircleOfConfusionPassData>("Downsample Circle Of Confusion Pass",
-				[=](DownsampleCircleOfConfusionPassData& data, RenderGraphBuilder& builder)
+				GfxDescriptor src_descriptors[] =
 				{
-					RGTextureDesc compute_separated_coc_desc{};
-					compute_separated_coc_desc.width = mip_width;
-					compute_separated_coc_desc.height = mip_height;
-					compute_separated_coc_desc.format = GfxFormat::R16_UNORM;
+					ctx.GetReadOnlyTexture(data.coc),
+					ctx.GetReadOnlyTexture(data.coc_dilation),
+					ctx.GetReadWriteBuffer(data.tile_lists),
+					ctx.GetReadWriteBuffer(data.tile_args)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
 
-					builder.DeclareTexture(coc_mips[i], compute_separated_coc_desc);
-					data.output = builder.WriteTexture(coc_mips[i]);
-					data.input = builder.ReadTexture(coc_mips[i - 1], ReadAccess_NonPixelShader);
-				},
-				[=](DownsampleCircleOfConfusionPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				//the min/max CoC of a tile picks its bin, the dilated CoC also marks tiles that near field bokeh bleeds into
+				//bin b owns tile_lists[b * tile_count, (b + 1) * tile_count), its dispatch args are tile_args[b]
+				struct ClassifyTilesConstants
 				{
-					GfxDevice* gfx = cmd_list->GetDevice();
-
-					cmd_list->SetPipelineState(downsample_coc_pso.get());
-
-					GfxDescriptor src_descriptors[] =
-					{
-						ctx.GetReadOnlyTexture(data.input),
-						ctx.GetReadWriteTexture(data.output)
-					};
-					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
-					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
-					Uint32 const i = dst_descriptor.GetIndex();
-
-					struct DownsampleCircleOfConfusionPassConstants
-					{
-						Uint32 input_idx;
-						Uint32 output_idx;
-					} constants =
-					{
-						.input_idx = i, .output_idx = i + 1,
-					};
+					Uint32 coc_idx;
+					Uint32 coc_dilation_idx;
+					Uint32 tile_lists_idx;
+					Uint32 tile_args_idx;
+					Uint32 tile_count;
+					Float  focus_threshold;
+				} constants =
+				{
+					.coc_idx = i, .coc_dilation_idx = i + 1, .tile_lists_idx = i + 2, .tile_args_idx = i + 3,
+					.tile_count = tile_count, .focus_threshold = TileFocusThreshold.Get() * MaxCircleOfConfusion.Get()
+				};
 
-					cmd_list->SetRootConstants(1, constants);
-					cmd_list->Dispatch(DivideAndRoundUp(mip_width, 16), DivideAndRoundUp(mip_height, 16), 1);
+				cmd_list->SetPipelineState(clear_tile_args_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
 
-				}, RGPassType::Compute, RGPassFlags::None);
-		}
-		blur_pass.AddPass(rg, coc_mips.back(), RG_NAME(CoCDilation), "CoC Blur");
+				cmd_list->SetPipelineState(classify_tiles_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(tiles_x, tiles_y, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
-	void DepthOfFieldPass::AddComputePrefilteredTexturePass(RenderGraph& rg, RGResourceName color_texture)
+	void DepthOfFieldPass::AddComputePrefilteredTexturePass(RenderGraph& rg, RGResourceName color_texture, Bool tile_classification)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 
@@ -372,6 +451,8 @@ namespace adria
 			RGTextureReadOnlyId coc_dilation;
 			RGTextureReadWriteId near_coc;
 			RGTextureReadWriteId far_coc;
+			RGBufferReadOnlyId   tile_lists;
+			RGBufferIndirectArgsId tile_args;
 		};
 
 		rg.AddPass<ComputePrefilteredTexturePassData>("Compute Prefiltered Texture Pass",
@@ -390,13 +471,16 @@ namespace adria
 				data.color = builder.ReadTexture(color_texture, ReadAccess_NonPixelShader);
 				data.coc = builder.ReadTexture(RG_NAME(CoCTexture), ReadAccess_NonPixelShader);
 				data.coc_dilation = builder.ReadTexture(RG_NAME(CoCDilation), ReadAccess_NonPixelShader);
+				if (tile_classification)
+				{
+					data.tile_lists = builder.ReadBuffer(RG_NAME(DoFTileLists), ReadAccess_NonPixelShader);
+					data.tile_args = builder.ReadIndirectArgsBuffer(RG_NAME(DoFTileArgs));
+				}
 			},
 			[=](ComputePrefilteredTexturePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				cmd_list->SetPipelineState(compute_prefiltered_texture_pso.get());
-
 				GfxDescriptor src_descriptors[] =
 				{
 					ctx.GetReadOnlyTexture(data.color),
@@ -425,14 +509,29 @@ namespace adria
 					.background_output_idx = i + 4,
 				};
 
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+				if (!tile_classification)
+				{
+					cmd_list->SetPipelineState(compute_prefiltered_texture_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+					return;
+				}
+
+				//skipped tiles have to read as empty to the gathers of neighbouring tiles
+				static constexpr Float clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				cmd_list->ClearUAV(ctx.GetTexture(*data.near_coc), gfx->GetDescriptorGPU(i + 3), ctx.GetReadWriteTexture(data.near_coc), clear);
+				cmd_list->ClearUAV(ctx.GetTexture(*data.far_coc), gfx->GetDescriptorGPU(i + 4), ctx.GetReadWriteTexture(data.far_coc), clear);
+				DispatchTileBins(ctx, cmd_list, *compute_prefiltered_texture_psos, data.tile_lists, data.tile_args, TILE_GATHER_BIN_COUNT, false, [&]()
+					{
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+					});
 			}, RGPassType::Compute, RGPassFlags::None);
 
 	}
 
-	void DepthOfFieldPass::AddBokehFirstPass(RenderGraph& rg, RGResourceName color_texture)
+	void DepthOfFieldPass::AddBokehFirstPass(RenderGraph& rg, RGResourceName color_texture, Bool tile_classification)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 		rg.ImportTexture(RG_NAME(BokehLargeKernel), bokeh_large_kernel.get());
@@ -445,6 +544,8 @@ namespace adria
 			RGTextureReadOnlyId coc_far;
 			RGTextureReadWriteId output0;
 			RGTextureReadWriteId output1;
+			RGBufferReadOnlyId   tile_lists;
+			RGBufferIndirectArgsId tile_args;
 		};
 
 		rg.AddPass<BokehFirstPassData>("Bokeh First Pass",
@@ -463,16 +564,16 @@ namespace adria
 				data.color = builder.ReadTexture(color_texture);
 				data.coc_near = builder.ReadTexture(RG_NAME(NearCoC));
 				data.coc_far = builder.ReadTexture(RG_NAME(FarCoC));
+				if (tile_classification)
+				{
+					data.tile_lists = builder.ReadBuffer(RG_NAME(DoFTileLists), ReadAccess_NonPixelShader);
+					data.tile_args = builder.ReadIndirectArgsBuffer(RG_NAME(DoFTileArgs));
+				}
 			},
 			[=](BokehFirstPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				if (BokehKarisInverse.Get())
-				{
-					bokeh_first_pass_psos->AddDefine("KARIS_INVERSE", "1");
-				}
-				cmd_list->SetPipelineState(bokeh_first_pass_psos->Get());
 				GfxDescriptor src_descriptors[] =
 				{
 					ctx.GetReadOnlyTexture(data.color),
@@ -507,13 +608,32 @@ namespace adria
 					.sample_count = GetSampleCount(BokehKernelRingCount.Get(), BokehKernelRingDensity.Get()),
 					.max_coc = MaxCircleOfConfusion.Get()
 				};
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+				if (!tile_classification)
+				{
+					if (BokehKarisInverse.Get())
+					{
+						bokeh_first_pass_psos->AddDefine("KARIS_INVERSE", "1");
+					}
+					cmd_list->SetPipelineState(bokeh_first_pass_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+					return;
+				}
+
+				//skipped tiles have to read as empty to the gathers of neighbouring tiles
+				static constexpr Float clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				cmd_list->ClearUAV(ctx.GetTexture(*data.output0), gfx->GetDescriptorGPU(i + 4), ctx.GetReadWriteTexture(data.output0), clear);
+				cmd_list->ClearUAV(ctx.GetTexture(*data.output1), gfx->GetDescriptorGPU(i + 5), ctx.GetReadWriteTexture(data.output1), clear);
+				DispatchTileBins(ctx, cmd_list, *bokeh_first_pass_psos, data.tile_lists, data.tile_args, TILE_GATHER_BIN_COUNT, BokehKarisInverse.Get(), [&]()
+					{
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+					});
 			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
-	void DepthOfFieldPass::AddBokehSecondPass(RenderGraph& rg)
+	void DepthOfFieldPass::AddBokehSecondPass(RenderGraph& rg, Bool tile_classification)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 		rg.ImportTexture(RG_NAME(BokehSmallKernel), bokeh_small_kernel.get());
@@ -525,6 +645,8 @@ namespace adria
 			RGTextureReadOnlyId coc_far;
 			RGTextureReadWriteId output0;
 			RGTextureReadWriteId output1;
+			RGBufferReadOnlyId   tile_lists;
+			RGBufferIndirectArgsId tile_args;
 		};
 
 		rg.AddPass<BokehSecondPassData>("Bokeh Second Pass",
@@ -542,17 +664,16 @@ namespace adria
 				data.kernel = builder.ReadTexture(RG_NAME(BokehSmallKernel));
 				data.coc_near = builder.ReadTexture(RG_NAME(BokehTexture0));
 				data.coc_far = builder.ReadTexture(RG_NAME(BokehTexture1));
+				if (tile_classification)
+				{
+					data.tile_lists = builder.ReadBuffer(RG_NAME(DoFTileLists), ReadAccess_NonPixelShader);
+					data.tile_args = builder.ReadIndirectArgsBuffer(RG_NAME(DoFTileArgs));
+				}
 			},
 			[=](BokehSecondPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				if (BokehKarisInverse.Get())
-				{
-					bokeh_second_pass_psos->AddDefine("KARIS_INVERSE", "1");
-				}
-				cmd_list->SetPipelineState(bokeh_second_pass_psos->Get());
-
 				GfxDescriptor src_descriptors[] =
 				{
 					ctx.GetReadOnlyTexture(data.kernel),
@@ -584,13 +705,32 @@ namespace adria
 					.sample_count = GetSampleCount(SMALL_BOKEH_KERNEL_RING_COUNT, SMALL_BOKEH_KERNEL_RING_DENSITY),
 					.max_coc = MaxCircleOfConfusion.Get()
 				};
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+				if (!tile_classification)
+				{
+					if (BokehKarisInverse.Get())
+					{
+						bokeh_second_pass_psos->AddDefine("KARIS_INVERSE", "1");
+					}
+					cmd_list->SetPipelineState(bokeh_second_pass_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+					return;
+				}
+
+				//skipped tiles have to read as empty to the gathers of neighbouring tiles
+				static constexpr Float clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				cmd_list->ClearUAV(ctx.GetTexture(*data.output0), gfx->GetDescriptorGPU(i + 3), ctx.GetReadWriteTexture(data.output0), clear);
+				cmd_list->ClearUAV(ctx.GetTexture(*data.output1), gfx->GetDescriptorGPU(i + 4), ctx.GetReadWriteTexture(data.output1), clear);
+				DispatchTileBins(ctx, cmd_list, *bokeh_second_pass_psos, data.tile_lists, data.tile_args, TILE_GATHER_BIN_COUNT, BokehKarisInverse.Get(), [&]()
+					{
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+					});
 			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
-	void DepthOfFieldPass::AddComputePostfilteredTexturePass(RenderGraph& rg)
+	void DepthOfFieldPass::AddComputePostfilteredTexturePass(RenderGraph& rg, Bool tile_classification)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 
@@ -600,6 +740,8 @@ namespace adria
 			RGTextureReadOnlyId  far_coc;
 			RGTextureReadWriteId output0;
 			RGTextureReadWriteId output1;
+			RGBufferReadOnlyId   tile_lists;
+			RGBufferIndirectArgsId tile_args;
 		};
 
 		rg.AddPass<ComputePostfilteredTexturePassData>("Compute Postfiltered Texture Pass",
@@ -618,13 +760,16 @@ namespace adria
 
 				data.near_coc = builder.ReadTexture(RG_NAME(BokehTexture3), ReadAccess_NonPixelShader);
 				data.far_coc = builder.ReadTexture(RG_NAME(BokehTexture4), ReadAccess_NonPixelShader);
+				if (tile_classification)
+				{
+					data.tile_lists = builder.ReadBuffer(RG_NAME(DoFTileLists), ReadAccess_NonPixelShader);
+					data.tile_args = builder.ReadIndirectArgsBuffer(RG_NAME(DoFTileArgs));
+				}
 			},
 			[=](ComputePostfilteredTexturePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				cmd_list->SetPipelineState(compute_posfiltered_texture_pso.get());
-
 				GfxDescriptor src_descriptors[] =
 				{
 					ctx.GetReadOnlyTexture(data.near_coc),
@@ -650,16 +795,31 @@ namespace adria
 					.background_output_idx = i + 3,
 				};
 
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
-
 				GUI_DebugTexture("CoC Near Final", &ctx.GetTexture(*data.output0));
 				GUI_DebugTexture("CoC Far Final", &ctx.GetTexture(*data.output1));
+
+				if (!tile_classification)
+				{
+					cmd_list->SetPipelineState(compute_posfiltered_texture_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width / 2, 16), DivideAndRoundUp(height / 2, 16), 1);
+					return;
+				}
+
+				//skipped tiles have to read as empty to the gathers of neighbouring tiles
+				static constexpr Float clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				cmd_list->ClearUAV(ctx.GetTexture(*data.output0), gfx->GetDescriptorGPU(i + 2), ctx.GetReadWriteTexture(data.output0), clear);
+				cmd_list->ClearUAV(ctx.GetTexture(*data.output1), gfx->GetDescriptorGPU(i + 3), ctx.GetReadWriteTexture(data.output1), clear);
+				DispatchTileBins(ctx, cmd_list, *compute_posfiltered_texture_psos, data.tile_lists, data.tile_args, TILE_GATHER_BIN_COUNT, false, [&]()
+					{
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+					});
 			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
-	void DepthOfFieldPass::AddCombinePass(RenderGraph& rg, RGResourceName color_texture)
+	void DepthOfFieldPass::AddCombinePass(RenderGraph& rg, RGResourceName color_texture, Bool tile_classification)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 
@@ -669,6 +829,8 @@ namespace adria
 			RGTextureReadOnlyId  near_coc;
 			RGTextureReadOnlyId  far_coc;
 			RGTextureReadWriteId output;
+			RGBufferReadOnlyId   tile_lists;
+			RGBufferIndirectArgsId tile_args;
 		};
 
 		rg.AddPass<CombinePassData>("Combine Pass",
@@ -685,13 +847,16 @@ namespace adria
 				data.near_coc = builder.ReadTexture(RG_NAME(FinalNearCoC), ReadAccess_NonPixelShader);
 				data.far_coc = builder.ReadTexture(RG_NAME(FinalFarCoC), ReadAccess_NonPixelShader);
 				data.color = builder.ReadTexture(color_texture, ReadAccess_NonPixelShader);
+				if (tile_classification)
+				{
+					data.tile_lists = builder.ReadBuffer(RG_NAME(DoFTileLists), ReadAccess_NonPixelShader);
+					data.tile_args = builder.ReadIndirectArgsBuffer(RG_NAME(DoFTileArgs));
+				}
 			},
 			[=](CombinePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				cmd_list->SetPipelineState(combine_pso.get());
-
 				GfxDescriptor src_descriptors[] =
 				{
 					ctx.GetReadOnlyTexture(data.color),
@@ -719,9 +884,21 @@ namespace adria
 					.alpha_interpolation = AlphaInterpolation.Get()
 				};
 
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+				if (!tile_classification)
+				{
+					cmd_list->SetPipelineState(combine_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+					return;
+				}
+
+				//every tile is written, in focus tiles just copy the color
+				DispatchTileBins(ctx, cmd_list, *combine_psos, data.tile_lists, data.tile_args, TILE_BIN_COUNT, false, [&]()
+					{
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+					});
 
 			}, RGPassType::Compute, RGPassFlags::None);
 	}
@@ -1,6 +1,7 @@
 #pragma once
 #include "PostEffect.h"
 #include "BlurPass.h"
+#include "SPDPass.h"
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 namespace adria
@@ -12,6 +13,9 @@ namespace adria
 
 	class DepthOfFieldPass : public PostEffect
 	{
+		//one thread group per tile in every tiled kernel, 8x8 threads for the half resolution gathers and 16x16 for the combine
+		static constexpr Uint32 TILE_SIZE = 16;
+
 	public:
 		DepthOfFieldPass(GfxDevice* gfx, Uint32 w, Uint32 h);
 		~DepthOfFieldPass();
@@ -26,15 +30,17 @@ namespace adria
 		GfxDevice* gfx;
 		Uint32 width, height;
 		BlurPass blur_pass;
+		SPDPass spd_pass;
 
 		std::unique_ptr<GfxComputePipelineState> compute_coc_pso;
 		std::unique_ptr<GfxComputePipelineState> compute_separated_coc_pso;
-		std::unique_ptr<GfxComputePipelineState> downsample_coc_pso;
-		std::unique_ptr<GfxComputePipelineState> compute_prefiltered_texture_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> compute_prefiltered_texture_psos;
 		std::unique_ptr<GfxComputePipelineStatePermutations> bokeh_first_pass_psos;
 		std::unique_ptr<GfxComputePipelineStatePermutations> bokeh_second_pass_psos;
-		std::unique_ptr<GfxComputePipelineState> compute_posfiltered_texture_pso;
-		std::unique_ptr<GfxComputePipelineState> combine_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> compute_posfiltered_texture_psos;
+		std::unique_ptr<GfxComputePipelineStatePermutations> combine_psos;
+		std::unique_ptr<GfxComputePipelineState> clear_tile_args_pso;
+		std::unique_ptr<GfxComputePipelineState> classify_tiles_pso;
 
 		std::unique_ptr<GfxTexture> bokeh_large_kernel;
 		std::unique_ptr<GfxTexture> bokeh_small_kernel;
@@ -47,11 +53,12 @@ namespace adria
 		void AddComputeCircleOfConfusionPass(RenderGraph&);
 		void AddSeparatedCircleOfConfusionPass(RenderGraph&);
 		void AddDownsampleCircleOfConfusionPass(RenderGraph&);
-		void AddComputePrefilteredTexturePass(RenderGraph&, RGResourceName);
-		void AddBokehFirstPass(RenderGraph&, RGResourceName);
-		void AddBokehSecondPass(RenderGraph&);
-		void AddComputePostfilteredTexturePass(RenderGraph&);
-		void AddCombinePass(RenderGraph&, RGResourceName);
+		void AddClassifyTilesPass(RenderGraph&);
+		void AddComputePrefilteredTexturePass(RenderGraph&, RGResourceName, Bool tile_classification);
+		void AddBokehFirstPass(RenderGraph&, RGResourceName, Bool tile_classification);
+		void AddBokehSecondPass(RenderGraph&, Bool tile_classification);
+		void AddComputePostfilteredTexturePass(RenderGraph&, Bool tile_classification);
+		void AddCombinePass(RenderGraph&, RGResourceName, Bool tile_classification);
 	};
 
 }
\ No newline at end of file
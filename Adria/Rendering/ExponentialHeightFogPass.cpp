@@ -101,6 +101,11 @@ namespace adria
 	}
 
 	Bool ExponentialHeightFogPass::IsEnabled(PostProcessor const*) const
+	{
+		return Fog.Get() && !injected_into_froxels;
+	}
+
+	Bool ExponentialHeightFogPass::IsFogEnabled() const
 	{
 		return Fog.Get();
 	}
@@ -8,19 +8,19 @@ namespace adria
 	class GfxComputePipelineState;
 	class RenderGraph;
 
-	class ExponentialHeightFogPass : public PostEffect
+	struct ExponentialHeightFogParameters
 	{
-		struct FogParameters
-		{
-			Float  fog_falloff		= 0.125f;
-			Float  fog_density		= 3.0f;
-			Float  fog_height		= 100.0f;
-			Float  fog_min_opacity  = 0.7f;
-			Float  fog_start		= 0.0f;
-			Float  fog_cutoff_distance = 0.0f;
-			Float  fog_color[3]		= { 0.5f, 0.6f, 1.0f };
-		};
+		Float  fog_falloff		= 0.125f;
+		Float  fog_density		= 3.0f;
+		Float  fog_height		= 100.0f;
+		Float  fog_min_opacity  = 0.7f;
+		Float  fog_start		= 0.0f;
+		Float  fog_cutoff_distance = 0.0f;
+		Float  fog_color[3]		= { 0.5f, 0.6f, 1.0f };
+	};
 
+	class ExponentialHeightFogPass : public PostEffect
+	{
 	public:
 		ExponentialHeightFogPass(GfxDevice* gfx, Uint32 w, Uint32 h);
 
@@ -29,11 +29,16 @@ namespace adria
 		virtual Bool IsEnabled(PostProcessor const*) const override;
 		virtual void GUI() override;
 
+		Bool IsFogEnabled() const;
+		ExponentialHeightFogParameters const& GetParameters() const { return params; }
+		void SetInjectedIntoFroxels(Bool _injected_into_froxels) { injected_into_froxels = _injected_into_froxels; }
+
 	private:
 		GfxDevice* gfx;
 		Uint32 width, height;
 		std::unique_ptr<GfxComputePipelineState> fog_pso;
-		FogParameters params;
+		ExponentialHeightFogParameters params;
+		Bool injected_into_froxels = false;
 
 	private:
 		void CreatePSO();
@@ -341,7 +341,7 @@ namespace adria
 				ADRIA_ASSERT(error_code == FFX_OK);
 
 				cmd_list->ResetState();
-			}, RGPassType::Compute);
+			}, RGPassType::ComputeAsync);
 
 		cacao_settings = FfxCacaoPresets[preset_id].cacao_settings;
 		use_downsampled_ssao = FfxCacaoPresets[preset_id].use_downsampled_ssao;
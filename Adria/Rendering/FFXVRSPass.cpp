@@ -5,6 +5,7 @@
 #include "Postprocessor.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxCommon.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
 #include "Core/ConsoleManager.h"
@@ -18,6 +19,9 @@ namespace adria
 	static TAutoConsoleVariable<int>   VariableRateShadingCombiner("r.VariableRateShading.Combiner", 0, "");
 	static TAutoConsoleVariable<Float> VariableRateShadingThreshold("r.VariableRateShading.Threshold", 0.015f, "");
 	static TAutoConsoleVariable<Float> VariableRateShadingMotionFactor("r.VariableRateShading.MotionFactor", 0.01f, "");
+	static TAutoConsoleVariable<Bool>  VariableRateShadingContentAdaptive("r.VariableRateShading.ContentAdaptive", false, "Coarsen the shading rate image in fast moving and out of focus regions and write a software VRS tile mask for the lighting compute passes");
+	static TAutoConsoleVariable<Float> VariableRateShadingVelocityThreshold("r.VariableRateShading.VelocityThreshold", 4.0f, "Screen space motion in pixels per frame above which a tile is shaded at a coarser rate");
+	static TAutoConsoleVariable<Float> VariableRateShadingCoCThreshold("r.VariableRateShading.CoCThreshold", 0.5f, "Circle of confusion above which a tile is shaded at a coarser rate");
 
 	static GfxShadingRate shading_rates[] =
 	{
@@ -131,6 +135,8 @@ namespace adria
 
 			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
 
+		if (VariableRateShadingContentAdaptive.Get()) AddContentAdaptivePass(rg);
+
 		if (VariableRateShadingOverlay.Get())
 		{
 			rg.AddPass<void>("VRS Overlay Pass",
@@ -175,6 +181,12 @@ namespace adria
 						{
 							ImGui::SliderFloat("Threshold", VariableRateShadingThreshold.GetPtr(), 0.0f, 0.1f);
 							ImGui::SliderFloat("Motion Factor", VariableRateShadingMotionFactor.GetPtr(), 0.0f, 0.1f);
+							ImGui::Checkbox("Content Adaptive", VariableRateShadingContentAdaptive.GetPtr());
+							if (VariableRateShadingContentAdaptive.Get())
+							{
+								ImGui::SliderFloat("Velocity Threshold", VariableRateShadingVelocityThreshold.GetPtr(), 0.0f, 32.0f);
+								ImGui::SliderFloat("CoC Threshold", VariableRateShadingCoCThreshold.GetPtr(), 0.0f, 1.0f);
+							}
 							ImGui::Checkbox("Draw Overlay", VariableRateShadingOverlay.GetPtr());
 						}
 					}
@@ -187,6 +199,73 @@ namespace adria
 	{
 		width = w, height = h;
 		CreateVRSImage();
+		if (vrs_tile_mask) CreateTileMask();
+	}
+
+	void FFXVRSPass::ImportResources(RenderGraph& rg)
+	{
+		if (!IsSupported() || !VariableRateShading.Get() || !VariableRateShadingImage.Get() || !VariableRateShadingContentAdaptive.Get()) return;
+
+		if (!vrs_tile_mask) CreateTileMask();
+		rg.ImportTexture(RG_NAME(VRSTileMask), vrs_tile_mask.get());
+	}
+
+	void FFXVRSPass::AddContentAdaptivePass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct VRSContentAdaptivePassData
+		{
+			RGTextureReadOnlyId  motion_vectors;
+			RGTextureReadOnlyId  coc;
+			RGTextureReadWriteId tile_mask;
+		};
+
+		rg.AddPass<VRSContentAdaptivePassData>("VRS Content Adaptive Pass",
+			[=](VRSContentAdaptivePassData& data, RenderGraphBuilder& builder)
+			{
+				data.motion_vectors = builder.ReadTexture(RG_NAME(VelocityBuffer), ReadAccess_NonPixelShader);
+				if (builder.IsTextureDeclared(RG_NAME(CoCTexture))) data.coc = builder.ReadTexture(RG_NAME(CoCTexture), ReadAccess_NonPixelShader);
+				else data.coc.Invalidate();
+				data.tile_mask = builder.WriteTexture(RG_NAME(VRSTileMask));
+			},
+			[=](VRSContentAdaptivePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.motion_vectors),
+					data.coc.IsValid() ? ctx.GetReadOnlyTexture(data.coc) : gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV),
+					vrs_image_uav,
+					ctx.GetReadWriteTexture(data.tile_mask)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct VRSContentAdaptiveConstants
+				{
+					Uint32 velocity_idx;
+					Uint32 coc_idx;
+					Uint32 vrs_image_idx;
+					Uint32 tile_mask_idx;
+					Uint32 shading_rate_image_tile_size;
+					Uint32 software_tile_size;
+					Float  velocity_threshold;
+					Float  coc_threshold;
+				} constants =
+				{
+					.velocity_idx = i, .coc_idx = i + 1, .vrs_image_idx = i + 2, .tile_mask_idx = i + 3,
+					.shading_rate_image_tile_size = shading_rate_image_tile_size, .software_tile_size = SOFTWARE_VRS_TILE_SIZE,
+					.velocity_threshold = VariableRateShadingVelocityThreshold.Get(), .coc_threshold = VariableRateShadingCoCThreshold.Get()
+				};
+
+				cmd_list->TextureBarrier(*vrs_image, GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+				cmd_list->SetPipelineState(content_adaptive_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, SOFTWARE_VRS_TILE_SIZE), DivideAndRoundUp(height, SOFTWARE_VRS_TILE_SIZE), 1);
+				cmd_list->TextureBarrier(*vrs_image, GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
 	}
 
 	Bool FFXVRSPass::IsEnabled(PostProcessor const*) const
@@ -206,6 +285,23 @@ namespace adria
 		vrs_image_desc.initial_state = GfxResourceState::ComputeUAV;
 		vrs_image = gfx->CreateTexture(vrs_image_desc);
 		vrs_image_srv = gfx->CreateTextureSRV(vrs_image.get());
+		vrs_image_uav = gfx->CreateTextureUAV(vrs_image.get());
+	}
+
+	void FFXVRSPass::CreateTileMask()
+	{
+		GfxTextureDesc tile_mask_desc{};
+		tile_mask_desc.format = GfxFormat::R8_UINT;
+		tile_mask_desc.width = DivideAndRoundUp(width, SOFTWARE_VRS_TILE_SIZE);
+		tile_mask_desc.height = DivideAndRoundUp(height, SOFTWARE_VRS_TILE_SIZE);
+		tile_mask_desc.bind_flags = GfxBindFlag::UnorderedAccess | GfxBindFlag::ShaderResource;
+		tile_mask_desc.initial_state = GfxResourceState::ComputeUAV;
+
+		//a zeroed mask shades every tile at full rate until the first content adaptive pass runs
+		std::vector<Uint8> full_rate(tile_mask_desc.width * tile_mask_desc.height, 0);
+		GfxTextureSubData sub_data{ .data = full_rate.data(), .row_pitch = tile_mask_desc.width, .slice_pitch = full_rate.size() };
+		GfxTextureData init_data{ .sub_data = &sub_data, .sub_count = 1 };
+		vrs_tile_mask = gfx->CreateTexture(tile_mask_desc, init_data);
 	}
 
 	void FFXVRSPass::CreateOverlayPSO()
@@ -226,6 +322,10 @@ namespace adria
 		gfx_pso_desc.blend_state.render_target[0].src_blend_alpha = GfxBlend::One;
 		gfx_pso_desc.blend_state.render_target[0].dest_blend_alpha = GfxBlend::InvSrcAlpha;
 		vrs_overlay_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
+
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_VRSContentAdaptive;
+		content_adaptive_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 	}
 
 	void FFXVRSPass::DestroyContext()
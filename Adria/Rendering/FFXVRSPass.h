@@ -13,10 +13,14 @@ namespace adria
 	class RenderGraph;
 	class GfxTexture;
 	class GfxGraphicsPipelineState;
+	class GfxComputePipelineState;
 	class PostProcessor;
 
 	class FFXVRSPass : public PostEffect
 	{
+	public:
+		static constexpr Uint32 SOFTWARE_VRS_TILE_SIZE = 16;
+
 	public:
 		FFXVRSPass(GfxDevice* gfx, Uint32 w, Uint32 h);
 		~FFXVRSPass();
@@ -27,6 +31,8 @@ namespace adria
 		virtual Bool IsEnabled(PostProcessor const*) const override;
 		virtual Bool IsSupported() const override { return is_supported; }
 
+		void ImportResources(RenderGraph& rg);
+
 	private:
 		Char name_version[16] = {};
 		GfxDevice* gfx;
@@ -39,15 +45,21 @@ namespace adria
 
 		std::unique_ptr<GfxTexture> vrs_image;
 		GfxDescriptor vrs_image_srv;
+		GfxDescriptor vrs_image_uav;
 		std::unique_ptr<GfxGraphicsPipelineState> vrs_overlay_pso;
 
+		std::unique_ptr<GfxTexture> vrs_tile_mask;
+		std::unique_ptr<GfxComputePipelineState> content_adaptive_pso;
+
 		Bool is_supported = false;
 		Bool  additional_shading_rates_supported = false;
 		Uint32 shading_rate_image_tile_size;
 
 	private:
 		void CreateVRSImage();
+		void CreateTileMask();
 		void CreateOverlayPSO();
+		void AddContentAdaptivePass(RenderGraph& rg);
 		void DestroyContext();
 		void CreateContext();
 	};
@@ -100,15 +100,15 @@ namespace adria
 				dispatch_desc.upscaleOutput = GetFfxResource(output_texture, FFX_RESOURCE_STATE_UNORDERED_ACCESS);
 				dispatch_desc.jitterOffset.x = frame_data.camera_jitter_x;
 				dispatch_desc.jitterOffset.y = frame_data.camera_jitter_y;
-				dispatch_desc.motionVectorScale.x = (Float)render_width;
-				dispatch_desc.motionVectorScale.y = (Float)render_height;
+				dispatch_desc.motionVectorScale.x = (Float)GetDynamicRenderWidth();
+				dispatch_desc.motionVectorScale.y = (Float)GetDynamicRenderHeight();
 				dispatch_desc.reset = false;
 				dispatch_desc.enableSharpening = sharpening_enabled;
 				dispatch_desc.sharpness = sharpness;
 				dispatch_desc.frameTimeDelta = frame_data.delta_time;
 				dispatch_desc.preExposure = 1.0f;
-				dispatch_desc.renderSize.width = render_width;
-				dispatch_desc.renderSize.height = render_height;
+				dispatch_desc.renderSize.width = GetDynamicRenderWidth();
+				dispatch_desc.renderSize.height = GetDynamicRenderHeight();
 				dispatch_desc.cameraFar = frame_data.camera_far;
 				dispatch_desc.cameraNear = frame_data.camera_near;
 				dispatch_desc.cameraFovAngleVertical = frame_data.camera_fov;
@@ -11,6 +11,7 @@
 namespace adria
 {
 	static TAutoConsoleVariable<Bool> FilmEffects("r.FilmEffects", false, "Enable or Disable Film Effects");
+	static TAutoConsoleVariable<Bool> FilmEffectsFusion("r.FilmEffects.Fusion", true, "Apply film effects inside the tonemap dispatch instead of a separate full-screen pass");
 
 	FilmEffectsPass::FilmEffectsPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
 	{
@@ -52,35 +53,9 @@ namespace adria
 				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
 				Uint32 const i = dst_descriptor.GetIndex();
 
-				struct FilmEffectsConstants
-				{
-					Bool32  lens_distortion_enabled;
-					Float	lens_distortion_intensity;
-					Bool32  chromatic_aberration_enabled;
-					Float   chromatic_aberration_intensity;
-					Bool32  vignette_enabled;
-					Float   vignette_intensity;
-					Bool32  film_grain_enabled;
-					Float   film_grain_scale;
-					Float   film_grain_amount;
-					Uint32  film_grain_seed;
-					Uint32  input_idx;
-					Uint32  output_idx;
-				} constants =
-				{
-					.lens_distortion_enabled = lens_distortion_enabled,
-					.lens_distortion_intensity = lens_distortion_intensity,
-					.chromatic_aberration_enabled = chromatic_aberration_enabled,
-					.chromatic_aberration_intensity = chromatic_aberration_intensity,
-					.vignette_enabled = vignette_enabled,
-					.vignette_intensity = vignette_intensity,
-					.film_grain_enabled = film_grain_enabled,
-					.film_grain_scale = film_grain_scale,
-					.film_grain_amount = film_grain_amount,
-					.film_grain_seed = GetFilmGrainSeed(frame_data.delta_time, film_grain_seed_update_rate),
-					.input_idx = i + 0,
-					.output_idx = i + 1
-				};
+				FilmEffectsConstants constants = GetConstants(frame_data.delta_time);
+				constants.input_idx = i + 0;
+				constants.output_idx = i + 1;
 				cmd_list->SetPipelineState(film_effects_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootCBV(2, constants);
@@ -97,7 +72,32 @@ namespace adria
 
 	Bool FilmEffectsPass::IsEnabled(PostProcessor const*) const
 	{
-		return FilmEffects.Get();
+		return FilmEffects.Get() && !FilmEffectsFusion.Get();
+	}
+
+	Bool FilmEffectsPass::IsFused() const
+	{
+		return FilmEffects.Get() && FilmEffectsFusion.Get();
+	}
+
+	FilmEffectsConstants FilmEffectsPass::GetConstants(Float dt) const
+	{
+		FilmEffectsConstants constants =
+		{
+			.lens_distortion_enabled = lens_distortion_enabled,
+			.lens_distortion_intensity = lens_distortion_intensity,
+			.chromatic_aberration_enabled = chromatic_aberration_enabled,
+			.chromatic_aberration_intensity = chromatic_aberration_intensity,
+			.vignette_enabled = vignette_enabled,
+			.vignette_intensity = vignette_intensity,
+			.film_grain_enabled = film_grain_enabled,
+			.film_grain_scale = film_grain_scale,
+			.film_grain_amount = film_grain_amount,
+			.film_grain_seed = GetFilmGrainSeed(dt, film_grain_seed_update_rate),
+			.input_idx = 0,
+			.output_idx = 0
+		};
+		return constants;
 	}
 
 	void FilmEffectsPass::GUI()
@@ -109,6 +109,7 @@ namespace adria
 					ImGui::Checkbox("Enable Film Effects", FilmEffects.GetPtr());
 					if (FilmEffects.Get())
 					{
+						ImGui::Checkbox("Fuse With Tonemap", FilmEffectsFusion.GetPtr());
 						ImGui::Checkbox("Lens Distortion", &lens_distortion_enabled);
 						ImGui::Checkbox("Chromatic Aberration", &chromatic_aberration_enabled);
 						ImGui::Checkbox("Vignette", &vignette_enabled);
@@ -7,11 +7,30 @@ namespace adria
 	class GfxComputePipelineState;
 	class RenderGraph;
 
+	struct FilmEffectsConstants
+	{
+		Bool32  lens_distortion_enabled;
+		Float	lens_distortion_intensity;
+		Bool32  chromatic_aberration_enabled;
+		Float   chromatic_aberration_intensity;
+		Bool32  vignette_enabled;
+		Float   vignette_intensity;
+		Bool32  film_grain_enabled;
+		Float   film_grain_scale;
+		Float   film_grain_amount;
+		Uint32  film_grain_seed;
+		Uint32  input_idx;
+		Uint32  output_idx;
+	};
+
 	class FilmEffectsPass : public PostEffect
 	{
 	public:
 		FilmEffectsPass(GfxDevice* gfx, Uint32 w, Uint32 h);
 
+		Bool IsFused() const;
+		FilmEffectsConstants GetConstants(Float dt) const;
+
 		virtual void AddPass(RenderGraph&, PostProcessor*) override;
 		virtual void OnResize(Uint32, Uint32) override;
 		virtual Bool IsEnabled(PostProcessor const*) const override;
@@ -0,0 +1,148 @@
+#include "ForwardPlusPass.h"
+#include "Components.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxReflection.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> ForwardPlus("r.ForwardPlus", true, "Shade opaque and masked sheen materials forward with the clustered light lists instead of through the GBuffer");
+
+	ForwardPlusPass::ForwardPlusPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
+		: reg(reg), gfx(gfx), width(w), height(h)
+	{
+		CreatePSOs();
+	}
+
+	ForwardPlusPass::~ForwardPlusPass() = default;
+
+	Bool ForwardPlusPass::IsEnabled() const
+	{
+		return ForwardPlus.Get();
+	}
+
+	void ForwardPlusPass::AddPass(RenderGraph& rg)
+	{
+		if (!IsEnabled() || !rg.GetBlackboard().TryGet<LightClusterBlackboardData>()) return;
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct ForwardPlusDraw
+		{
+			Batch const* batch;
+			GfxPipelineState* pso;
+			Uint32 instance_count;
+		};
+		struct ForwardPlusPassData
+		{
+			RGBufferReadOnlyId light_grid;
+			RGBufferReadOnlyId light_list;
+			std::vector<ForwardPlusDraw> draws;
+		};
+
+		rg.AddPass<ForwardPlusPassData>("Forward Plus Pass",
+			[=](ForwardPlusPassData& data, RenderGraphBuilder& builder)
+			{
+				data.light_grid = builder.ReadBuffer(RG_NAME(LightGrid), ReadAccess_PixelShader);
+				data.light_list = builder.ReadBuffer(RG_NAME(LightList), ReadAccess_PixelShader);
+				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+
+				//the batches are still sorted by the GBuffer pass, consecutive instances are drawn instanced
+				auto batch_view = reg.view<Batch>();
+				for (auto batch_entity : batch_view)
+				{
+					Batch const& batch = batch_view.get<Batch>(batch_entity);
+					if (!batch.camera_visibility || batch.shading_extension != ShadingExtension::Sheen || batch.alpha_mode == MaterialAlphaMode::Blend) continue;
+
+					if (batch.alpha_mode == MaterialAlphaMode::Mask) forward_psos->AddDefine<GfxShaderStage::PS>("MASK", "1");
+					GfxPipelineState* pso = forward_psos->Get();
+
+					ForwardPlusDraw* last_draw = data.draws.empty() ? nullptr : &data.draws.back();
+					if (last_draw && last_draw->pso == pso && IsNextBatchInstance(*last_draw->batch, last_draw->instance_count, batch))
+					{
+						++last_draw->instance_count;
+						continue;
+					}
+					data.draws.push_back(ForwardPlusDraw{ &batch, pso, 1 });
+				}
+			},
+			[=](ForwardPlusPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				if (data.draws.empty()) return;
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					context.GetReadOnlyBuffer(data.light_grid),
+					context.GetReadOnlyBuffer(data.light_list)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				for (ForwardPlusDraw const& draw : data.draws)
+				{
+					struct ForwardPlusConstants
+					{
+						Uint32 instance_id;
+						Uint32 light_grid_idx;
+						Uint32 light_list_idx;
+					} constants =
+					{
+						.instance_id = draw.batch->instance_id,
+						.light_grid_idx = i,
+						.light_list_idx = i + 1
+					};
+					cmd_list->SetPipelineState(draw.pso);
+					cmd_list->SetRootConstants(1, constants);
+					DrawSubMeshLOD(cmd_list, *draw.batch->submesh, draw.batch->lod, draw.instance_count);
+				}
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+
+	void ForwardPlusPass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("Forward Plus", 0))
+				{
+					ImGui::Checkbox("Forward Shaded Sheen", ForwardPlus.GetPtr());
+					if (ImGui::IsItemHovered()) ImGui::SetTooltip("Sheen materials are shaded forward with the clustered light lists, otherwise they go through the GBuffer");
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void ForwardPlusPass::CreatePSOs()
+	{
+		GfxGraphicsPipelineStateDesc forward_pso_desc{};
+		GfxReflection::FillInputLayoutDesc(GetGfxShader(VS_GBuffer), forward_pso_desc.input_layout);
+		forward_pso_desc.root_signature = GfxRootSignatureID::Common;
+		forward_pso_desc.VS = VS_GBuffer;
+		forward_pso_desc.PS = PS_ForwardPlus;
+		forward_pso_desc.PS.AddDefine("SHADING_EXTENSION_SHEEN", "1");
+		forward_pso_desc.depth_state.depth_enable = true;
+		forward_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::All;
+		forward_pso_desc.depth_state.depth_func = GfxComparisonFunc::GreaterEqual;
+		forward_pso_desc.num_render_targets = 1;
+		forward_pso_desc.rtv_formats[0] = GfxFormat::R16G16B16A16_FLOAT;
+		forward_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
+
+		forward_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, forward_pso_desc);
+		forward_psos->DeclarePermutation();
+		forward_psos->AddDefine<GfxShaderStage::PS>("MASK", "1");
+		forward_psos->DeclarePermutation();
+		forward_psos->Precompile();
+		forward_psos->SetAsyncCompilation(true);
+		forward_psos->SetFallbackPermutation();
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	class GfxDevice;
+	class RenderGraph;
+
+	//shades opaque and masked sheen batches forward over the lit scene, looping only over the lights of their cluster.
+	//the clustered light lists have to be built before, see ClusteredDeferredLightingPass::AddLightCullingPasses
+	class ForwardPlusPass
+	{
+	public:
+		ForwardPlusPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
+		~ForwardPlusPass();
+
+		void AddPass(RenderGraph& rg);
+		void GUI();
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+		}
+		Bool IsEnabled() const;
+
+	private:
+		entt::registry& reg;
+		GfxDevice* gfx;
+		Uint32 width, height;
+		std::unique_ptr<GfxGraphicsPipelineStatePermutations> forward_psos;
+
+	private:
+		void CreatePSOs();
+	};
+}
@@ -4,17 +4,35 @@
 #include "Components.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h"
+#include "Meshlet.h"
+#include "OcclusionQueryPass.h"
 #include "Graphics/GfxReflection.h"
 #include "Graphics/GfxTracyProfiler.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
 #include "entt/entity/registry.hpp"
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> GBufferMeshShaders("r.GBuffer.MeshShaders", true, "Draw the CPU driven GBuffer with amplification and mesh shaders that cull meshlets when supported");
+	static TAutoConsoleVariable<Bool> GBufferMultiDrawIndirect("r.GBuffer.MultiDrawIndirect", true, "Submit the non mesh shader GBuffer draws with one ExecuteIndirect per pipeline state and geometry buffer");
+
+	using GBufferIndirectArguments = DrawIndexedRootConstantIndirectSignature::Arguments;
+
+	static constexpr Uint32 GetPermutationKey(Bool rain, ShadingExtension extension, MaterialAlphaMode alpha_mode)
+	{
+		return Uint32(rain) | (Uint32(extension) << 1) | (Uint32(alpha_mode) << 3);
+	}
+
+	static Bool IsMeshShaderCandidate(Batch const& batch)
+	{
+		return batch.submesh->meshlet_count > 0 && batch.submesh->topology == GfxPrimitiveTopology::TriangleList;
+	}
 
 	GBufferPass::GBufferPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h) :
 		reg{ reg }, gfx{ gfx }, width{ w }, height{ h }
@@ -24,11 +42,27 @@ namespace adria
 
 	GBufferPass::~GBufferPass() = default;
 
-	void GBufferPass::AddPass(RenderGraph& rg)
+	void GBufferPass::AddPass(RenderGraph& rg, OcclusionQueryPass* occlusion_queries)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
-		rg.AddPass<void>("GBuffer Pass",
-			[=](RenderGraphBuilder& builder)
+
+		struct GBufferDraw
+		{
+			Batch const* batch;
+			GfxPipelineState* pso;
+			Bool mesh_shader;
+			Uint32 indirect_offset;
+			Uint32 indirect_count;
+			Uint32 instance_count;
+		};
+		struct GBufferPassData
+		{
+			std::vector<GBufferDraw> draws;
+			GfxBuffer* indirect_buffer = nullptr;
+		};
+
+		rg.AddParallelPass<GBufferPassData>("GBuffer Pass",
+			[=](GBufferPassData& data, RenderGraphBuilder& builder)
 			{
 				RGTextureDesc gbuffer_desc{};
 				gbuffer_desc.width = width;
@@ -51,55 +85,150 @@ namespace adria
 				depth_desc.height = height;
 				depth_desc.format = GfxFormat::R32_TYPELESS;
 				depth_desc.clear_value = GfxClearValue(0.0f, 0);
-				builder.DeclareTexture(RG_NAME(DepthStencil), depth_desc);
+				builder.DeclareTemporalTexture(RG_NAME(DepthStencil), RG_NAME(DepthHistory), depth_desc);
 				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Clear_Preserve);
 				builder.SetViewport(width, height);
-			},
-			[=](RenderGraphContext& context, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-				
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+
 				auto GetPSO = [this](ShadingExtension extension, MaterialAlphaMode alpha_mode)
 				{
-					using enum GfxShaderStage;
-					if (raining)
+					return gbuffer_psos->Get(GetPermutationKey(raining, extension, alpha_mode), [&](auto& psos) { AddPermutationDefines(psos, raining, extension, alpha_mode); });
+				};
+				auto GetMeshPSO = [this](ShadingExtension extension, MaterialAlphaMode alpha_mode)
+				{
+					return gbuffer_mesh_psos->Get(GetPermutationKey(raining, extension, alpha_mode), [&](auto& psos) { AddPermutationDefines(psos, raining, extension, alpha_mode); });
+				};
+				Bool const use_mesh_shaders = gbuffer_mesh_psos && GBufferMeshShaders.Get();
+
+				//batch order barely changes between frames, insertion sort is close to linear on an almost sorted range
+				reg.sort<Batch>([](Batch const& lhs, Batch const& rhs) 
+					{ 
+						if(lhs.alpha_mode != rhs.alpha_mode) return lhs.alpha_mode < rhs.alpha_mode;
+						if(lhs.shading_extension != rhs.shading_extension) return lhs.shading_extension < rhs.shading_extension;
+						if(IsMeshShaderCandidate(lhs) != IsMeshShaderCandidate(rhs)) return IsMeshShaderCandidate(lhs) < IsMeshShaderCandidate(rhs);
+						return BatchDrawOrder(lhs, rhs);
+					}, entt::insertion_sort{});
+
+				//permutations are not thread safe so the pipeline states are resolved here and not while recording
+				auto batch_view = reg.view<Batch>();
+				Bool const use_multi_draw = GBufferMultiDrawIndirect.Get();
+				GfxDynamicAllocation indirect_allocation{};
+				if (use_multi_draw && !batch_view.empty())
+				{
+					indirect_allocation = gfx->GetDynamicAllocator()->Allocate(batch_view.size() * sizeof(GBufferIndirectArguments), sizeof(GBufferIndirectArguments));
+					data.indirect_buffer = indirect_allocation.buffer;
+				}
+
+				Uint32 indirect_count = 0;
+				Batch const* instanced_batch = nullptr;
+				GBufferIndirectArguments instanced_arguments{};
+				data.draws.reserve(batch_view.size());
+				for (auto batch_entity : batch_view)
+				{
+					Batch const& batch = batch_view.get<Batch>(batch_entity);
+					if (!batch.camera_visibility) continue;
+					if (!blend_batches_enabled && batch.alpha_mode == MaterialAlphaMode::Blend) continue;
+					if (!sheen_batches_enabled && batch.shading_extension == ShadingExtension::Sheen && batch.alpha_mode != MaterialAlphaMode::Blend) continue;
+					if (occlusion_queries)
+					{
+						//the read back result is from a previous frame, the query issued now decides a later one
+						Uint32 const batch_id = entt::to_integral(batch_entity);
+						Bool const visible = occlusion_queries->IsVisible(OcclusionQueryGroup::Batch, batch_id);
+						occlusion_queries->AddQuery(OcclusionQueryGroup::Batch, batch_id, batch.bounding_box);
+						if (!visible) continue;
+					}
+
+					Bool const mesh_shader = use_mesh_shaders && IsMeshShaderCandidate(batch);
+					GfxPipelineState* pso = mesh_shader ? static_cast<GfxPipelineState*>(GetMeshPSO(batch.shading_extension, batch.alpha_mode)) : GetPSO(batch.shading_extension, batch.alpha_mode);
+					if (mesh_shader)
 					{
-						gbuffer_psos->AddDefine<PS>("RAIN", "1");
+						data.draws.push_back(GBufferDraw{ &batch, pso, true, 0, 0, 1 });
+						instanced_batch = nullptr;
+						continue;
 					}
-					switch (extension)
+
+					//consecutive instances of a submesh are merged into one instanced draw
+					GBufferDraw* last_draw = data.draws.empty() ? nullptr : &data.draws.back();
+					if (instanced_batch && last_draw->pso == pso && IsNextBatchInstance(*instanced_batch, use_multi_draw ? instanced_arguments.draw.InstanceCount : last_draw->instance_count, batch))
 					{
-					case ShadingExtension::Anisotropy: gbuffer_psos->AddDefine<PS>("SHADING_EXTENSION_ANISOTROPY", "1"); break;
-					case ShadingExtension::ClearCoat: gbuffer_psos->AddDefine<PS>("SHADING_EXTENSION_CLEARCOAT", "1"); break;
+						if (use_multi_draw)
+						{
+							++instanced_arguments.draw.InstanceCount;
+							indirect_allocation.Update(&instanced_arguments, sizeof(instanced_arguments), (indirect_count - 1) * sizeof(GBufferIndirectArguments));
+						}
+						else ++last_draw->instance_count;
+						continue;
 					}
+					instanced_batch = &batch;
 
-					switch (alpha_mode)
+					if (!use_multi_draw)
 					{
-					case MaterialAlphaMode::Opaque: break;
-					case MaterialAlphaMode::Mask:   gbuffer_psos->AddDefine<PS>("MASK", "1"); break;
-					case MaterialAlphaMode::Blend:  gbuffer_psos->SetCullMode(GfxCullMode::None); break;
+						data.draws.push_back(GBufferDraw{ &batch, pso, false, 0, 0, 1 });
+						continue;
 					}
-					return gbuffer_psos->Get();
-				};
 
+					SubMeshGPU const& submesh = *batch.submesh;
+					SubMeshLOD const& lod = submesh.lods[batch.lod];
+					GBufferIndirectArguments arguments{};
+					arguments.root_constant = batch.instance_id;
+					arguments.draw.IndexCountPerInstance = lod.index_count;
+					arguments.draw.InstanceCount = 1;
+					arguments.draw.StartIndexLocation = (Uint32)(submesh.indices_offset / sizeof(Uint32)) + lod.first_index;
+					arguments.draw.BaseVertexLocation = 0;
+					arguments.draw.StartInstanceLocation = 0;
+					indirect_allocation.Update(&arguments, sizeof(arguments), indirect_count * sizeof(GBufferIndirectArguments));
+					instanced_arguments = arguments;
+
+					//draws sharing a pipeline state, geometry buffer and topology collapse into one ExecuteIndirect
+					GBufferDraw* bucket = data.draws.empty() ? nullptr : &data.draws.back();
+					if (bucket && bucket->indirect_count > 0 && bucket->pso == pso && bucket->batch->submesh->buffer_address == submesh.buffer_address && bucket->batch->submesh->topology == submesh.topology)
+					{
+						++bucket->indirect_count;
+					}
+					else
+					{
+						data.draws.push_back(GBufferDraw{ &batch, pso, false, (Uint32)(indirect_allocation.offset + indirect_count * sizeof(GBufferIndirectArguments)), 1, 1 });
+					}
+					++indirect_count;
+				}
+				builder.SetParallelWorkload((Uint32)data.draws.size(), 256);
+			},
+			[=](GBufferPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list, RGParallelRange const& range)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 
 				GfxShadingRateInfo const& vrs = gfx->GetVRSInfo();
 				cmd_list->BeginVRS(vrs);
 
-				reg.sort<Batch>([](Batch const& lhs, Batch const& rhs) 
-					{ 
-						if(lhs.alpha_mode != rhs.alpha_mode) return lhs.alpha_mode < rhs.alpha_mode;
-						return lhs.shading_extension < rhs.shading_extension;
-					});
-				auto batch_view = reg.view<Batch>();
-				for (auto batch_entity : batch_view)
+				for (Uint32 i = range.begin; i < range.end; ++i)
 				{
-					Batch& batch = batch_view.get<Batch>(batch_entity);
-					if (!batch.camera_visibility) continue;
+					GBufferDraw const& draw = data.draws[i];
+					Batch const& batch = *draw.batch;
+					cmd_list->SetPipelineState(draw.pso);
+
+					SubMeshLOD const& lod = batch.submesh->lods[batch.lod];
+					if (draw.mesh_shader)
+					{
+						struct GBufferMeshConstants
+						{
+							Uint32 instance_id;
+							Uint32 meshlet_count;
+							Uint32 first_meshlet;
+						} mesh_constants{ .instance_id = batch.instance_id, .meshlet_count = lod.meshlet_count, .first_meshlet = lod.first_meshlet };
+						cmd_list->SetRootConstants(1, mesh_constants);
+						cmd_list->DispatchMesh(DivideAndRoundUp(lod.meshlet_count, MESHLET_CULL_GROUP_SIZE));
+						continue;
+					}
 
-					GfxPipelineState* pso = GetPSO(batch.shading_extension, batch.alpha_mode);
-					cmd_list->SetPipelineState(pso);
+					if (draw.indirect_count > 0)
+					{
+						SubMeshGPU const& submesh = *batch.submesh;
+						GfxIndexBufferView ibv(submesh.buffer_address, (Uint32)(submesh.buffer_size / sizeof(Uint32)));
+						cmd_list->SetTopology(submesh.topology);
+						cmd_list->SetIndexBuffer(&ibv);
+						cmd_list->MultiDrawIndexedIndirect(*data.indirect_buffer, draw.indirect_offset, draw.indirect_count);
+						continue;
+					}
 
 					struct GBufferConstants
 					{
@@ -107,14 +236,11 @@ namespace adria
 					} constants { .instance_id = batch.instance_id };
 					cmd_list->SetRootConstants(1, constants);
 
-					GfxIndexBufferView ibv(batch.submesh->buffer_address + batch.submesh->indices_offset, batch.submesh->indices_count);
-					cmd_list->SetTopology(batch.submesh->topology);
-					cmd_list->SetIndexBuffer(&ibv);
-					cmd_list->DrawIndexed(batch.submesh->indices_count);
+					DrawSubMeshLOD(cmd_list, *batch.submesh, batch.lod, draw.instance_count);
 				}
 
 				cmd_list->EndVRS(vrs);
-			}, RGPassType::Graphics, RGPassFlags::None);
+			}, RGPassType::Graphics, RGPassFlags::SubmitAfter);
 	}
 
 	void GBufferPass::OnResize(Uint32 w, Uint32 h)
@@ -140,6 +266,73 @@ namespace adria
 		gbuffer_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
 
 		gbuffer_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gbuffer_pso_desc);
+		for (Bool rain : { false, true })
+		{
+			for (ShadingExtension extension : { ShadingExtension::None, ShadingExtension::Anisotropy, ShadingExtension::ClearCoat })
+			{
+				for (MaterialAlphaMode alpha_mode : { MaterialAlphaMode::Opaque, MaterialAlphaMode::Mask, MaterialAlphaMode::Blend })
+				{
+					AddPermutationDefines(*gbuffer_psos, rain, extension, alpha_mode);
+					gbuffer_psos->DeclarePermutation();
+				}
+			}
+		}
+		gbuffer_psos->Precompile();
+		gbuffer_psos->SetAsyncCompilation(true);
+		AddPermutationDefines(*gbuffer_psos, false, ShadingExtension::None, MaterialAlphaMode::Opaque);
+		gbuffer_psos->SetFallbackPermutation();
+
+		if (gfx->GetCapabilities().SupportsMeshShaders())
+		{
+			GfxMeshShaderPipelineStateDesc gbuffer_mesh_pso_desc{};
+			gbuffer_mesh_pso_desc.root_signature = GfxRootSignatureID::Common;
+			gbuffer_mesh_pso_desc.AS = AS_GBuffer;
+			gbuffer_mesh_pso_desc.MS = MS_GBuffer;
+			gbuffer_mesh_pso_desc.PS = PS_GBuffer;
+			gbuffer_mesh_pso_desc.depth_state = gbuffer_pso_desc.depth_state;
+			gbuffer_mesh_pso_desc.num_render_targets = gbuffer_pso_desc.num_render_targets;
+			for (Uint32 i = 0; i < gbuffer_pso_desc.num_render_targets; ++i) gbuffer_mesh_pso_desc.rtv_formats[i] = gbuffer_pso_desc.rtv_formats[i];
+			gbuffer_mesh_pso_desc.dsv_format = gbuffer_pso_desc.dsv_format;
+
+			gbuffer_mesh_psos = std::make_unique<GfxMeshShaderPipelineStatePermutations>(gfx, gbuffer_mesh_pso_desc);
+			for (Bool rain : { false, true })
+			{
+				for (ShadingExtension extension : { ShadingExtension::None, ShadingExtension::Anisotropy, ShadingExtension::ClearCoat })
+				{
+					for (MaterialAlphaMode alpha_mode : { MaterialAlphaMode::Opaque, MaterialAlphaMode::Mask, MaterialAlphaMode::Blend })
+					{
+						AddPermutationDefines(*gbuffer_mesh_psos, rain, extension, alpha_mode);
+						gbuffer_mesh_psos->DeclarePermutation();
+					}
+				}
+			}
+			gbuffer_mesh_psos->Precompile();
+			gbuffer_mesh_psos->SetAsyncCompilation(true);
+			AddPermutationDefines(*gbuffer_mesh_psos, false, ShadingExtension::None, MaterialAlphaMode::Opaque);
+			gbuffer_mesh_psos->SetFallbackPermutation();
+		}
+	}
+
+	template<typename PSOPermutations>
+	void GBufferPass::AddPermutationDefines(PSOPermutations& psos, Bool rain, ShadingExtension extension, MaterialAlphaMode alpha_mode)
+	{
+		using enum GfxShaderStage;
+		if (rain)
+		{
+			psos.template AddDefine<PS>("RAIN", "1");
+		}
+		switch (extension)
+		{
+		case ShadingExtension::Anisotropy: psos.template AddDefine<PS>("SHADING_EXTENSION_ANISOTROPY", "1"); break;
+		case ShadingExtension::ClearCoat: psos.template AddDefine<PS>("SHADING_EXTENSION_CLEARCOAT", "1"); break;
+		}
+
+		switch (alpha_mode)
+		{
+		case MaterialAlphaMode::Opaque: break;
+		case MaterialAlphaMode::Mask:   psos.template AddDefine<PS>("MASK", "1"); break;
+		case MaterialAlphaMode::Blend:  psos.SetCullMode(GfxCullMode::None); break;
+		}
 	}
 
 }
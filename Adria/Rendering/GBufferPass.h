@@ -7,6 +7,9 @@ namespace adria
 {
 	class GfxDevice;
 	class RenderGraph;
+	class OcclusionQueryPass;
+	enum class ShadingExtension : Uint8;
+	enum class MaterialAlphaMode : Uint8;
 
 	class GBufferPass
 	{
@@ -14,22 +17,36 @@ namespace adria
 		GBufferPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
 		~GBufferPass();
 
-		void AddPass(RenderGraph& rendergraph);
+		void AddPass(RenderGraph& rendergraph, OcclusionQueryPass* occlusion_queries = nullptr);
 		void OnResize(Uint32 w, Uint32 h);
 
 		void OnRainEvent(Bool enabled)
 		{
 			raining = enabled;
 		}
+		void SetBlendBatchesEnabled(Bool enabled)
+		{
+			blend_batches_enabled = enabled;
+		}
+		//opaque and masked sheen batches can be shaded forward instead, see ForwardPlusPass
+		void SetSheenBatchesEnabled(Bool enabled)
+		{
+			sheen_batches_enabled = enabled;
+		}
 
 	private:
 		entt::registry& reg;
 		GfxDevice* gfx;
 		Uint32 width, height;
 		Bool raining = false;
+		Bool blend_batches_enabled = true;
+		Bool sheen_batches_enabled = true;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> gbuffer_psos;
+		std::unique_ptr<GfxMeshShaderPipelineStatePermutations> gbuffer_mesh_psos;
 
 	private:
 		void CreatePSOs();
+		template<typename PSOPermutations>
+		void AddPermutationDefines(PSOPermutations& psos, Bool rain, ShadingExtension extension, MaterialAlphaMode alpha_mode);
 	};
 }
\ No newline at end of file
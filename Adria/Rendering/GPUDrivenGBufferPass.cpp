@@ -1,46 +1,90 @@
 #include "GPUDrivenGBufferPass.h"
+#include "HZBPass.h"
 #include "ShaderStructs.h"
 #include "Components.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
+#include "Graphics/GfxStateObject.h"
+#include "Graphics/GfxReadbackQueue.h"
+#include "Graphics/GfxShader.h"
+#include "Graphics/GfxShaderKey.h"
 #include "entt/entity/registry.hpp"
 #include "Logging/Logger.h"
 #include "Editor/GUICommand.h"
 #include "Core/ConsoleManager.h"
 
-#define A_CPU 1
-#include "Resources/Shaders/SPD/ffx_a.h"
-#include "Resources/Shaders/SPD/ffx_spd.h"
-
 using namespace DirectX;
 
 namespace adria
 {
 	static TAutoConsoleVariable<Bool> GpuDrivenRendering("r.GpuDrivenRendering", true, "Enable GPU Driven Rendering if supported");
+	static TAutoConsoleVariable<Bool> GpuDrivenWorkGraphs("r.GpuDrivenRendering.WorkGraphs", true, "Cull instances and meshlets with a work graph instead of the indirect dispatch chain if supported");
+	static TAutoConsoleVariable<Bool> GpuDrivenPredication("r.GpuDrivenRendering.Predication", true, "Skip the 2nd phase instance culling on the GPU when no instance was occluded in the 1st phase");
 
 	static constexpr Uint32 MAX_NUM_MESHLETS = 1 << 20u;
 	static constexpr Uint32 MAX_NUM_INSTANCES = 1 << 14u;
 
+	//visible meshlets are split into one stream per MaterialAlphaMode, selected by InstanceGPU::alpha_mode
+	static constexpr Uint32 DRAW_STREAM_COUNT = 3;
+	//phase 1 and phase 2 totals followed by per stream phase 1 and phase 2 counts
+	static constexpr Uint32 VISIBLE_MESHLETS_COUNTER_COUNT = 2 + 2 * DRAW_STREAM_COUNT;
+
 	struct MeshletCandidate
 	{
 		Uint32 instance_id;
 		Uint32 meshlet_index;
 	};
 
-	GPUDrivenGBufferPass::GPUDrivenGBufferPass(entt::registry& reg, GfxDevice* gfx, Uint32 width, Uint32 height) 
-		: reg(reg), gfx(gfx), width(width), height(height)
+	static constexpr Wchar const* CULL_WORK_GRAPH_NAME = L"CullMeshletsWorkGraph";
+	enum CullWorkGraphFlagBit : Uint32
+	{
+		CullWorkGraphFlag_None = 0,
+		CullWorkGraphFlag_SecondPhase = 1 << 0,
+		CullWorkGraphFlag_OcclusionCull = 1 << 1,
+		CullWorkGraphFlag_ConeCull = 1 << 2,
+		CullWorkGraphFlag_ClusterLOD = 1 << 3
+	};
+
+	//entry record of the instance culling node, SV_DispatchGrid is the number of 64 wide instance groups
+	struct CullWorkGraphRecord
+	{
+		Uint32 dispatch_grid;
+		Uint32 flags;
+	};
+
+	static void AddDrawStreamDefines(GfxMeshShaderPipelineStatePermutations& psos, Uint32 stream)
+	{
+		switch ((MaterialAlphaMode)stream)
+		{
+		case MaterialAlphaMode::Opaque: break;
+		case MaterialAlphaMode::Mask:   psos.AddDefine<GfxShaderStage::PS>("MASK", "1"); break;
+		case MaterialAlphaMode::Blend:  psos.SetCullMode(GfxCullMode::None); break;
+		}
+	}
+
+	GPUDrivenGBufferPass::GPUDrivenGBufferPass(entt::registry& reg, GfxDevice* gfx, HZBPass& hzb_pass, Uint32 width, Uint32 height) 
+		: reg(reg), gfx(gfx), hzb_pass(hzb_pass), width(width), height(height)
 	{
 		GpuDrivenRendering->Set(IsSupported());
 		if (!IsSupported()) return;
-		CreateDebugBuffer();
-		InitializeHZB();
 		CreatePSOs();
+		if (gfx->GetCapabilities().SupportsWorkGraphs())
+		{
+			CreateCullWorkGraph();
+			ShaderManager::GetLibraryRecompiledEvent().AddMember(&GPUDrivenGBufferPass::OnLibraryRecompiled, *this);
+		}
 	}
 
 	GPUDrivenGBufferPass::~GPUDrivenGBufferPass() = default;
 
+	//the blend stream is left out of the gbuffer when transparent batches are drawn order independently
+	Bool GPUDrivenGBufferPass::IsDrawStreamEnabled(Uint32 stream) const
+	{
+		return blend_stream_enabled || stream != (Uint32)MaterialAlphaMode::Blend;
+	}
+
 	Bool GPUDrivenGBufferPass::IsSupported() const
     {
         return gfx->GetCapabilities().SupportsMeshShaders();
@@ -51,6 +95,11 @@ namespace adria
 		return GpuDrivenRendering.Get();
 	}
 
+	Bool GPUDrivenGBufferPass::UseWorkGraphCulling() const
+	{
+		return GpuDrivenWorkGraphs.Get() && cull_work_graph_so != nullptr;
+	}
+
 	void GPUDrivenGBufferPass::AddPasses(RenderGraph& rg)
 	{
 		if (!IsSupported()) return;
@@ -58,6 +107,7 @@ namespace adria
 		AddClearCountersPass(rg);
 		Add1stPhasePasses(rg);
 		Add2ndPhasePasses(rg);
+		if (visibility_buffer) AddVisibilityBufferMaterialPass(rg);
 		AddDebugPass(rg);
 	}
 
@@ -71,6 +121,10 @@ namespace adria
 					if (GpuDrivenRendering.Get())
 					{
 						ImGui::Checkbox("Occlusion Cull", &occlusion_culling);
+						ImGui::Checkbox("Cone Cull", &cone_culling);
+						ImGui::Checkbox("Cluster LOD", &cluster_lod);
+						ImGui::Checkbox("Visibility Buffer", &visibility_buffer);
+						if (cull_work_graph_so) ImGui::Checkbox("Work Graph Culling", GpuDrivenWorkGraphs.GetPtr());
 						ImGui::Checkbox("Display Debug Stats", &display_debug_stats);
 						if (display_debug_stats)
 						{
@@ -79,8 +133,7 @@ namespace adria
 
 							ImGui::SeparatorText("GPU Driven Debug Stats");
 							{
-								Uint32 backbuffer_index = gfx->GetBackbufferIndex();
-								DebugStats current_debug_stats = debug_stats[backbuffer_index];
+								DebugStats current_debug_stats = debug_stats;
 
 								ImGui::BeginTable("Profiler", 2, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg);
 								ImGui::TableSetupColumn("Description");
@@ -166,6 +219,29 @@ namespace adria
 		mesh_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
 		draw_psos = std::make_unique<GfxMeshShaderPipelineStatePermutations>(gfx, mesh_pso_desc);
 
+		GfxMeshShaderPipelineStateDesc visibility_pso_desc = mesh_pso_desc;
+		visibility_pso_desc.PS = PS_DrawMeshletsVisibility;
+		visibility_pso_desc.num_render_targets = 1u;
+		visibility_pso_desc.rtv_formats[0] = GfxFormat::R32G32_UINT;
+		visibility_pso_desc.rtv_formats[1] = GfxFormat::UNKNOWN;
+		visibility_pso_desc.rtv_formats[2] = GfxFormat::UNKNOWN;
+		visibility_pso_desc.rtv_formats[3] = GfxFormat::UNKNOWN;
+		draw_visibility_psos = std::make_unique<GfxMeshShaderPipelineStatePermutations>(gfx, visibility_pso_desc);
+
+		GfxMeshShaderPipelineStateDesc shadow_pso_desc{};
+		shadow_pso_desc.root_signature = GfxRootSignatureID::Common;
+		shadow_pso_desc.MS = MS_DrawMeshlets;
+		shadow_pso_desc.rasterizer_state.cull_mode = GfxCullMode::Front;
+		shadow_pso_desc.rasterizer_state.depth_bias = 7500;
+		shadow_pso_desc.rasterizer_state.depth_bias_clamp = 0.0f;
+		shadow_pso_desc.rasterizer_state.slope_scaled_depth_bias = 1.0f;
+		shadow_pso_desc.depth_state.depth_enable = true;
+		shadow_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::All;
+		shadow_pso_desc.depth_state.depth_func = GfxComparisonFunc::LessEqual;
+		shadow_pso_desc.num_render_targets = 0u;
+		shadow_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
+		shadow_draw_psos = std::make_unique<GfxMeshShaderPipelineStatePermutations>(gfx, shadow_pso_desc);
+
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_CullInstances;
 		cull_instances_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
@@ -185,122 +261,96 @@ namespace adria
 		compute_pso_desc.CS = CS_ClearCounters;
 		clear_counters_pso = std::make_unique<GfxComputePipelineState>(gfx, compute_pso_desc);
 
-		compute_pso_desc.CS = CS_InitializeHZB;
-		initialize_hzb_pso = gfx->CreateComputePipelineState(compute_pso_desc);
-
-		compute_pso_desc.CS = CS_HZBMips;
-		hzb_mips_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_VisibilityBufferMaterial;
+		visibility_material_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 	}
 
-	void GPUDrivenGBufferPass::InitializeHZB()
+	void GPUDrivenGBufferPass::CreateCullWorkGraph()
 	{
-		CalculateHZBParameters();
-
-		GfxTextureDesc hzb_desc{};
-		hzb_desc.width = hzb_width;
-		hzb_desc.height = hzb_height;
-		hzb_desc.mip_levels = hzb_mip_count;
-		hzb_desc.format = GfxFormat::R32_FLOAT;
-		hzb_desc.initial_state = GfxResourceState::ComputeUAV;
-		hzb_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
-
-		HZB = gfx->CreateTexture(hzb_desc);
+		GfxShader const& cull_work_graph_blob = GetGfxShader(LIB_CullMeshletsWorkGraph);
+		GfxStateObjectBuilder cull_work_graph_builder(3);
+		{
+			D3D12_DXIL_LIBRARY_DESC	dxil_lib_desc{};
+			dxil_lib_desc.DXILLibrary.BytecodeLength = cull_work_graph_blob.GetSize();
+			dxil_lib_desc.DXILLibrary.pShaderBytecode = cull_work_graph_blob.GetData();
+			dxil_lib_desc.NumExports = 0;
+			dxil_lib_desc.pExports = nullptr;
+			cull_work_graph_builder.AddSubObject(dxil_lib_desc);
+
+			D3D12_GLOBAL_ROOT_SIGNATURE global_root_sig{};
+			global_root_sig.pGlobalRootSignature = gfx->GetCommonRootSignature();
+			cull_work_graph_builder.AddSubObject(global_root_sig);
+
+			D3D12_WORK_GRAPH_DESC work_graph_desc{};
+			work_graph_desc.ProgramName = CULL_WORK_GRAPH_NAME;
+			work_graph_desc.Flags = D3D12_WORK_GRAPH_FLAG_INCLUDE_ALL_AVAILABLE_NODES;
+			cull_work_graph_builder.AddSubObject(work_graph_desc);
+		}
+		cull_work_graph_so.reset(cull_work_graph_builder.CreateStateObject(gfx, GfxStateObjectType::Executable));
+
+		GfxBufferDesc backing_memory_desc{};
+		backing_memory_desc.size = std::max<Uint64>(cull_work_graph_so->GetWorkGraphBackingMemorySize(CULL_WORK_GRAPH_NAME), sizeof(Uint32));
+		backing_memory_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+		backing_memory_desc.resource_usage = GfxResourceUsage::Default;
+		cull_work_graph_backing_memory = gfx->CreateBuffer(backing_memory_desc);
+		cull_work_graph_initialized = false;
 	}
 
-	void GPUDrivenGBufferPass::AddClearCountersPass(RenderGraph& rg)
+	void GPUDrivenGBufferPass::OnLibraryRecompiled(GfxShaderKey const& key)
 	{
-		struct ClearCountersPassData
-		{
-			RGBufferReadWriteId candidate_meshlets_counter;
-			RGBufferReadWriteId visible_meshlets_counter;
-			RGBufferReadWriteId occluded_instances_counter;
-		};
-
-		rg.AddPass<ClearCountersPassData>("Clear Counters Pass",
-			[=](ClearCountersPassData& data, RenderGraphBuilder& builder)
-			{
-				RGBufferDesc counter_desc{};
-				counter_desc.size = 3 * sizeof(Uint32);
-				counter_desc.format = GfxFormat::R32_UINT;
-				counter_desc.stride = sizeof(Uint32);
-				builder.DeclareBuffer(RG_NAME(CandidateMeshletsCounter), counter_desc);
-				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
-
-				counter_desc.size = 2 * sizeof(Uint32);
-				builder.DeclareBuffer(RG_NAME(VisibleMeshletsCounter), counter_desc);
-				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
-
-				counter_desc.size = sizeof(Uint32);
-				builder.DeclareBuffer(RG_NAME(OccludedInstancesCounter), counter_desc);
-				data.occluded_instances_counter = builder.WriteBuffer(RG_NAME(OccludedInstancesCounter));
-			},
-			[=](ClearCountersPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-
-				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(3);
-				GfxDescriptor src_handles[] = { ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
-												ctx.GetReadWriteBuffer(data.visible_meshlets_counter),
-												ctx.GetReadWriteBuffer(data.occluded_instances_counter) };
-				gfx->CopyDescriptors(dst_handle, src_handles);
-				Uint32 i = dst_handle.GetIndex();
-
-				struct ClearCountersConstants
-				{
-					Uint32 candidate_meshlets_counter_idx;
-					Uint32 visible_meshlets_counter_idx;
-					Uint32 occluded_instances_counter_idx;
-				} constants =
-				{
-					.candidate_meshlets_counter_idx = i,
-					.visible_meshlets_counter_idx = i + 1,
-					.occluded_instances_counter_idx = i + 2
-				};
-				cmd_list->SetPipelineState(clear_counters_pso.get());
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(1, 1, 1);
-				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
-			}, RGPassType::Compute, RGPassFlags::None);
+		if (key.GetShaderID() == LIB_CullMeshletsWorkGraph) CreateCullWorkGraph();
 	}
 
-	void GPUDrivenGBufferPass::Add1stPhasePasses(RenderGraph& rg)
+	void GPUDrivenGBufferPass::AddCullWorkGraphPass(RenderGraph& rg, Bool second_phase)
 	{
-		rg.ImportTexture(RG_NAME(HZB), HZB.get());
-
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
-		struct CullInstancesPassData
+		struct CullWorkGraphPassData
 		{
 			RGTextureReadOnlyId hzb;
-			RGBufferReadWriteId candidate_meshlets;
-			RGBufferReadWriteId candidate_meshlets_counter;
 			RGBufferReadWriteId occluded_instances;
 			RGBufferReadWriteId occluded_instances_counter;
+			RGBufferReadWriteId candidate_meshlets;
+			RGBufferReadWriteId candidate_meshlets_counter;
+			RGBufferReadWriteId visible_meshlets;
+			RGBufferReadWriteId visible_meshlets_counter;
 		};
 
-		rg.AddPass<CullInstancesPassData>("1st Phase Cull Instances Pass",
-			[=](CullInstancesPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<CullWorkGraphPassData>(second_phase ? "2nd Phase Cull Work Graph Pass" : "1st Phase Cull Work Graph Pass",
+			[=](CullWorkGraphPassData& data, RenderGraphBuilder& builder)
 			{
-				RGBufferDesc candidate_meshlets_buffer_desc{};
-				candidate_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
-				candidate_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
-				candidate_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
-				candidate_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS;
-				builder.DeclareBuffer(RG_NAME(CandidateMeshlets), candidate_meshlets_buffer_desc);
-
-				RGBufferDesc occluded_instances_buffer_desc{};
-				occluded_instances_buffer_desc.resource_usage = GfxResourceUsage::Default;
-				occluded_instances_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
-				occluded_instances_buffer_desc.stride = sizeof(Uint32);
-				occluded_instances_buffer_desc.size = sizeof(Uint32) * MAX_NUM_INSTANCES;
-				builder.DeclareBuffer(RG_NAME(OccludedInstances), occluded_instances_buffer_desc);
+				if (!second_phase)
+				{
+					RGBufferDesc candidate_meshlets_buffer_desc{};
+					candidate_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
+					candidate_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+					candidate_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
+					candidate_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS;
+					builder.DeclareBuffer(RG_NAME(CandidateMeshlets), candidate_meshlets_buffer_desc);
+
+					RGBufferDesc occluded_instances_buffer_desc{};
+					occluded_instances_buffer_desc.resource_usage = GfxResourceUsage::Default;
+					occluded_instances_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+					occluded_instances_buffer_desc.stride = sizeof(Uint32);
+					occluded_instances_buffer_desc.size = sizeof(Uint32) * MAX_NUM_INSTANCES;
+					builder.DeclareBuffer(RG_NAME(OccludedInstances), occluded_instances_buffer_desc);
+
+					RGBufferDesc visible_meshlets_buffer_desc{};
+					visible_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
+					visible_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+					visible_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
+					visible_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS * DRAW_STREAM_COUNT;
+					builder.DeclareBuffer(RG_NAME(VisibleMeshlets), visible_meshlets_buffer_desc);
+				}
 
 				data.hzb = builder.ReadTexture(RG_NAME(HZB));
 				data.occluded_instances = builder.WriteBuffer(RG_NAME(OccludedInstances));
 				data.occluded_instances_counter = builder.WriteBuffer(RG_NAME(OccludedInstancesCounter));
 				data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
 				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+				data.visible_meshlets = builder.WriteBuffer(RG_NAME(VisibleMeshlets));
+				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
 			},
-			[=](CullInstancesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](CullWorkGraphPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
@@ -308,13 +358,15 @@ namespace adria
 												ctx.GetReadWriteBuffer(data.occluded_instances),
 												ctx.GetReadWriteBuffer(data.occluded_instances_counter),
 												ctx.GetReadWriteBuffer(data.candidate_meshlets),
-												ctx.GetReadWriteBuffer(data.candidate_meshlets_counter) };
+												ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
+												ctx.GetReadWriteBuffer(data.visible_meshlets),
+												ctx.GetReadWriteBuffer(data.visible_meshlets_counter) };
 				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
 				Uint32 const num_instances = (Uint32)reg.view<Batch>().size();
-				struct CullInstances1stPhaseConstants
+				struct CullWorkGraphConstants
 				{
 					Uint32 num_instances;
 					Uint32 hzb_idx;
@@ -322,6 +374,8 @@ namespace adria
 					Uint32 occluded_instances_counter_idx;
 					Uint32 candidate_meshlets_idx;
 					Uint32 candidate_meshlets_counter_idx;
+					Uint32 visible_meshlets_idx;
+					Uint32 visible_meshlets_counter_idx;
 				} constants =
 				{
 					.num_instances = num_instances,
@@ -330,134 +384,298 @@ namespace adria
 					.occluded_instances_counter_idx = i + 2,
 					.candidate_meshlets_idx = i + 3,
 					.candidate_meshlets_counter_idx = i + 4,
+					.visible_meshlets_idx = i + 5,
+					.visible_meshlets_counter_idx = i + 6
 				};
 
-				if (!occlusion_culling)
-				{
-					cull_instances_psos->AddDefine("OCCLUSION_CULL", "0");
-				}
-				GfxPipelineState* pso = cull_instances_psos->Get();
-				cmd_list->SetPipelineState(pso);
+				//the second phase only revisits occluded instances, the entry node reads their count from the counter and early outs
+				CullWorkGraphRecord record{};
+				record.dispatch_grid = DivideAndRoundUp(num_instances, 64);
+				record.flags = CullWorkGraphFlag_None;
+				if (second_phase) record.flags |= CullWorkGraphFlag_SecondPhase;
+				if (occlusion_culling) record.flags |= CullWorkGraphFlag_OcclusionCull;
+				if (cone_culling) record.flags |= CullWorkGraphFlag_ConeCull;
+				if (cluster_lod) record.flags |= CullWorkGraphFlag_ClusterLOD;
+				if (record.dispatch_grid == 0) return;
+
+				cmd_list->SetWorkGraph(cull_work_graph_so.get(), CULL_WORK_GRAPH_NAME, *cull_work_graph_backing_memory, !cull_work_graph_initialized);
+				cull_work_graph_initialized = true;
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(num_instances, 64), 1, 1);
-
+				cmd_list->DispatchGraph(&record, 1, sizeof(CullWorkGraphRecord));
 			}, RGPassType::Compute, RGPassFlags::None);
+	}
 
-		struct BuildMeshletCullArgsPassData
+	void GPUDrivenGBufferPass::AddClearCountersPass(RenderGraph& rg)
+	{
+		struct ClearCountersPassData
 		{
-			RGBufferReadOnlyId  candidate_meshlets_counter;
-			RGBufferReadWriteId meshlet_cull_args;
+			RGBufferReadWriteId candidate_meshlets_counter;
+			RGBufferReadWriteId visible_meshlets_counter;
+			RGBufferReadWriteId occluded_instances_counter;
 		};
 
-		rg.AddPass<BuildMeshletCullArgsPassData>("1st Phase Build Meshlet Cull Args Pass",
-			[=](BuildMeshletCullArgsPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<ClearCountersPassData>("Clear Counters Pass",
+			[=](ClearCountersPassData& data, RenderGraphBuilder& builder)
 			{
-				RGBufferDesc meshlet_cull_args_desc{};
-				meshlet_cull_args_desc.resource_usage = GfxResourceUsage::Default;
-				meshlet_cull_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
-				meshlet_cull_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
-				meshlet_cull_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
-				builder.DeclareBuffer(RG_NAME(MeshletCullArgs), meshlet_cull_args_desc);
+				RGBufferDesc counter_desc{};
+				counter_desc.size = 3 * sizeof(Uint32);
+				counter_desc.format = GfxFormat::R32_UINT;
+				counter_desc.stride = sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(CandidateMeshletsCounter), counter_desc);
+				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+
+				counter_desc.size = VISIBLE_MESHLETS_COUNTER_COUNT * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(VisibleMeshletsCounter), counter_desc);
+				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
 
-				data.meshlet_cull_args = builder.WriteBuffer(RG_NAME(MeshletCullArgs));
-				data.candidate_meshlets_counter = builder.ReadBuffer(RG_NAME(CandidateMeshletsCounter));
+				counter_desc.size = sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(OccludedInstancesCounter), counter_desc);
+				data.occluded_instances_counter = builder.WriteBuffer(RG_NAME(OccludedInstancesCounter));
 			},
-			[=](BuildMeshletCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](ClearCountersPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.candidate_meshlets_counter),
-												ctx.GetReadWriteBuffer(data.meshlet_cull_args)
-				};
-				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(3);
+				GfxDescriptor src_handles[] = { ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
+												ctx.GetReadWriteBuffer(data.visible_meshlets_counter),
+												ctx.GetReadWriteBuffer(data.occluded_instances_counter) };
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
-				struct BuildMeshletCullArgsConstants
+				struct ClearCountersConstants
 				{
 					Uint32 candidate_meshlets_counter_idx;
-					Uint32 meshlet_cull_args_idx;
+					Uint32 visible_meshlets_counter_idx;
+					Uint32 occluded_instances_counter_idx;
 				} constants =
 				{
-					.candidate_meshlets_counter_idx = i + 0,
-					.meshlet_cull_args_idx = i + 1
+					.candidate_meshlets_counter_idx = i,
+					.visible_meshlets_counter_idx = i + 1,
+					.occluded_instances_counter_idx = i + 2
 				};
-				cmd_list->SetPipelineState(build_meshlet_cull_args_psos->Get());
+				cmd_list->SetPipelineState(clear_counters_pso.get());
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(1, 1, 1);
-
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
 			}, RGPassType::Compute, RGPassFlags::None);
+	}
 
+	void GPUDrivenGBufferPass::Add1stPhasePasses(RenderGraph& rg)
+	{
+		hzb_pass.ImportHZB(rg);
 
-		struct CullMeshletsPassData
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		if (UseWorkGraphCulling())
 		{
-			RGTextureReadOnlyId hzb;
-			RGBufferIndirectArgsId indirect_args;
-			RGBufferReadWriteId candidate_meshlets;
-			RGBufferReadWriteId candidate_meshlets_counter;
-			RGBufferReadWriteId visible_meshlets;
-			RGBufferReadWriteId visible_meshlets_counter;
-		};
-
-		rg.AddPass<CullMeshletsPassData>("1st Phase Cull Meshlets Pass",
-			[=](CullMeshletsPassData& data, RenderGraphBuilder& builder)
+			AddCullWorkGraphPass(rg, false);
+		}
+		else
+		{
+			struct CullInstancesPassData
 			{
-				RGBufferDesc visible_meshlets_buffer_desc{};
-				visible_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
-				visible_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
-				visible_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
-				visible_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS;
-				builder.DeclareBuffer(RG_NAME(VisibleMeshlets), visible_meshlets_buffer_desc);
+				RGTextureReadOnlyId hzb;
+				RGBufferReadWriteId candidate_meshlets;
+				RGBufferReadWriteId candidate_meshlets_counter;
+				RGBufferReadWriteId occluded_instances;
+				RGBufferReadWriteId occluded_instances_counter;
+			};
+
+			rg.AddPass<CullInstancesPassData>("1st Phase Cull Instances Pass",
+				[=](CullInstancesPassData& data, RenderGraphBuilder& builder)
+				{
+					RGBufferDesc candidate_meshlets_buffer_desc{};
+					candidate_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
+					candidate_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+					candidate_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
+					candidate_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS;
+					builder.DeclareBuffer(RG_NAME(CandidateMeshlets), candidate_meshlets_buffer_desc);
+
+					RGBufferDesc occluded_instances_buffer_desc{};
+					occluded_instances_buffer_desc.resource_usage = GfxResourceUsage::Default;
+					occluded_instances_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+					occluded_instances_buffer_desc.stride = sizeof(Uint32);
+					occluded_instances_buffer_desc.size = sizeof(Uint32) * MAX_NUM_INSTANCES;
+					builder.DeclareBuffer(RG_NAME(OccludedInstances), occluded_instances_buffer_desc);
+
+					data.hzb = builder.ReadTexture(RG_NAME(HZB));
+					data.occluded_instances = builder.WriteBuffer(RG_NAME(OccludedInstances));
+					data.occluded_instances_counter = builder.WriteBuffer(RG_NAME(OccludedInstancesCounter));
+					data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
+					data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+				},
+				[=](CullInstancesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.hzb),
+													ctx.GetReadWriteBuffer(data.occluded_instances),
+													ctx.GetReadWriteBuffer(data.occluded_instances_counter),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets_counter) };
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					Uint32 const num_instances = (Uint32)reg.view<Batch>().size();
+					struct CullInstances1stPhaseConstants
+					{
+						Uint32 num_instances;
+						Uint32 hzb_idx;
+						Uint32 occluded_instances_idx;
+						Uint32 occluded_instances_counter_idx;
+						Uint32 candidate_meshlets_idx;
+						Uint32 candidate_meshlets_counter_idx;
+					} constants =
+					{
+						.num_instances = num_instances,
+						.hzb_idx = i,
+						.occluded_instances_idx = i + 1,
+						.occluded_instances_counter_idx = i + 2,
+						.candidate_meshlets_idx = i + 3,
+						.candidate_meshlets_counter_idx = i + 4,
+					};
+
+					if (!occlusion_culling)
+					{
+						cull_instances_psos->AddDefine("OCCLUSION_CULL", "0");
+					}
+					if (!cluster_lod)
+					{
+						cull_instances_psos->AddDefine("CLUSTER_LOD", "0");
+					}
+					GfxPipelineState* pso = cull_instances_psos->Get();
+					cmd_list->SetPipelineState(pso);
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(num_instances, 64), 1, 1);
 
-				data.hzb = builder.ReadTexture(RG_NAME(HZB));
-				data.indirect_args = builder.ReadIndirectArgsBuffer(RG_NAME(MeshletCullArgs));
-				data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
-				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
-				data.visible_meshlets = builder.WriteBuffer(RG_NAME(VisibleMeshlets));
-				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
-			},
-			[=](CullMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
+				}, RGPassType::Compute, RGPassFlags::None);
 
-				GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.hzb),
-												ctx.GetReadWriteBuffer(data.candidate_meshlets),
-												ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
-												ctx.GetReadWriteBuffer(data.visible_meshlets),
-												ctx.GetReadWriteBuffer(data.visible_meshlets_counter)};
-				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
-				gfx->CopyDescriptors(dst_handle, src_handles);
-				Uint32 i = dst_handle.GetIndex();
+			struct BuildMeshletCullArgsPassData
+			{
+				RGBufferReadOnlyId  candidate_meshlets_counter;
+				RGBufferReadWriteId meshlet_cull_args;
+			};
 
-				struct CullMeshlets1stPhaseConstants
+			rg.AddPass<BuildMeshletCullArgsPassData>("1st Phase Build Meshlet Cull Args Pass",
+				[=](BuildMeshletCullArgsPassData& data, RenderGraphBuilder& builder)
 				{
-					Uint32 hzb_idx;
-					Uint32 candidate_meshlets_idx;
-					Uint32 candidate_meshlets_counter_idx;
-					Uint32 visible_meshlets_idx;
-					Uint32 visible_meshlets_counter_idx;
-				} constants =
+					RGBufferDesc meshlet_cull_args_desc{};
+					meshlet_cull_args_desc.resource_usage = GfxResourceUsage::Default;
+					meshlet_cull_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+					meshlet_cull_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+					meshlet_cull_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
+					builder.DeclareBuffer(RG_NAME(MeshletCullArgs), meshlet_cull_args_desc);
+
+					data.meshlet_cull_args = builder.WriteBuffer(RG_NAME(MeshletCullArgs));
+					data.candidate_meshlets_counter = builder.ReadBuffer(RG_NAME(CandidateMeshletsCounter));
+				},
+				[=](BuildMeshletCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 				{
-					.hzb_idx = i,
-					.candidate_meshlets_idx = i + 1,
-					.candidate_meshlets_counter_idx = i + 2,
-					.visible_meshlets_idx = i + 3,
-					.visible_meshlets_counter_idx = i + 4,
-				};
+					GfxDevice* gfx = cmd_list->GetDevice();
 
-				if (!occlusion_culling)
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.candidate_meshlets_counter),
+													ctx.GetReadWriteBuffer(data.meshlet_cull_args)
+					};
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					struct BuildMeshletCullArgsConstants
+					{
+						Uint32 candidate_meshlets_counter_idx;
+						Uint32 meshlet_cull_args_idx;
+					} constants =
+					{
+						.candidate_meshlets_counter_idx = i + 0,
+						.meshlet_cull_args_idx = i + 1
+					};
+					cmd_list->SetPipelineState(build_meshlet_cull_args_psos->Get());
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(1, 1, 1);
+
+				}, RGPassType::Compute, RGPassFlags::None);
+
+
+			struct CullMeshletsPassData
+			{
+				RGTextureReadOnlyId hzb;
+				RGBufferIndirectArgsId indirect_args;
+				RGBufferReadWriteId candidate_meshlets;
+				RGBufferReadWriteId candidate_meshlets_counter;
+				RGBufferReadWriteId visible_meshlets;
+				RGBufferReadWriteId visible_meshlets_counter;
+			};
+
+			rg.AddPass<CullMeshletsPassData>("1st Phase Cull Meshlets Pass",
+				[=](CullMeshletsPassData& data, RenderGraphBuilder& builder)
 				{
-					cull_meshlets_psos->AddDefine("OCCLUSION_CULL", "0");
-				}
-				GfxPipelineState* pso = cull_meshlets_psos->Get();
-				cmd_list->SetPipelineState(pso);
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
+					RGBufferDesc visible_meshlets_buffer_desc{};
+					visible_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
+					visible_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+					visible_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
+					visible_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS * DRAW_STREAM_COUNT;
+					builder.DeclareBuffer(RG_NAME(VisibleMeshlets), visible_meshlets_buffer_desc);
+
+					data.hzb = builder.ReadTexture(RG_NAME(HZB));
+					data.indirect_args = builder.ReadIndirectArgsBuffer(RG_NAME(MeshletCullArgs));
+					data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
+					data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+					data.visible_meshlets = builder.WriteBuffer(RG_NAME(VisibleMeshlets));
+					data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
+				},
+				[=](CullMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.hzb),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
+													ctx.GetReadWriteBuffer(data.visible_meshlets),
+													ctx.GetReadWriteBuffer(data.visible_meshlets_counter)};
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					struct CullMeshlets1stPhaseConstants
+					{
+						Uint32 hzb_idx;
+						Uint32 candidate_meshlets_idx;
+						Uint32 candidate_meshlets_counter_idx;
+						Uint32 visible_meshlets_idx;
+						Uint32 visible_meshlets_counter_idx;
+					} constants =
+					{
+						.hzb_idx = i,
+						.candidate_meshlets_idx = i + 1,
+						.candidate_meshlets_counter_idx = i + 2,
+						.visible_meshlets_idx = i + 3,
+						.visible_meshlets_counter_idx = i + 4,
+					};
+
+					if (!occlusion_culling)
+					{
+						cull_meshlets_psos->AddDefine("OCCLUSION_CULL", "0");
+					}
+					if (!cluster_lod)
+					{
+						cull_meshlets_psos->AddDefine("CLUSTER_LOD", "0");
+					}
+					if (!cone_culling)
+					{
+						cull_meshlets_psos->AddDefine("CONE_CULL", "0");
+					}
+					GfxPipelineState* pso = cull_meshlets_psos->Get();
+					cmd_list->SetPipelineState(pso);
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
 
-				GfxBuffer const& indirect_args = ctx.GetIndirectArgsBuffer(data.indirect_args);
-				cmd_list->DispatchIndirect(indirect_args, 0);
-			}, RGPassType::Compute, RGPassFlags::None);
+					GfxBuffer const& indirect_args = ctx.GetIndirectArgsBuffer(data.indirect_args);
+					cmd_list->DispatchIndirect(indirect_args, 0);
+				}, RGPassType::Compute, RGPassFlags::None);
+		}
 
 		struct BuildMeshletDrawArgsPassData
 		{
@@ -472,7 +690,7 @@ namespace adria
 				meshlet_cull_draw_desc.resource_usage = GfxResourceUsage::Default;
 				meshlet_cull_draw_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
 				meshlet_cull_draw_desc.stride = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS);
-				meshlet_cull_draw_desc.size = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS);
+				meshlet_cull_draw_desc.size = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS) * DRAW_STREAM_COUNT;
 				builder.DeclareBuffer(RG_NAME(MeshletDrawArgs), meshlet_cull_draw_desc);
 
 				data.meshlet_draw_args = builder.WriteBuffer(RG_NAME(MeshletDrawArgs));
@@ -512,28 +730,41 @@ namespace adria
 		rg.AddPass<DrawMeshletsPassData>("1st Phase Draw Meshlets",
 			[=](DrawMeshletsPassData& data, RenderGraphBuilder& builder)
 			{
-				RGTextureDesc gbuffer_desc{};
-				gbuffer_desc.width = width;
-				gbuffer_desc.height = height;
-				gbuffer_desc.format = GfxFormat::R8G8B8A8_UNORM;
-				gbuffer_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
-
-				builder.DeclareTexture(RG_NAME(GBufferNormal), gbuffer_desc);
-				builder.DeclareTexture(RG_NAME(GBufferAlbedo), gbuffer_desc);
-				builder.DeclareTexture(RG_NAME(GBufferEmissive), gbuffer_desc);
-				builder.DeclareTexture(RG_NAME(GBufferCustom), gbuffer_desc);
-
-				builder.WriteRenderTarget(RG_NAME(GBufferNormal), RGLoadStoreAccessOp::Clear_Preserve);
-				builder.WriteRenderTarget(RG_NAME(GBufferAlbedo), RGLoadStoreAccessOp::Clear_Preserve);
-				builder.WriteRenderTarget(RG_NAME(GBufferEmissive), RGLoadStoreAccessOp::Clear_Preserve);
-				builder.WriteRenderTarget(RG_NAME(GBufferCustom), RGLoadStoreAccessOp::Clear_Preserve);
+				if (visibility_buffer)
+				{
+					RGTextureDesc visibility_desc{};
+					visibility_desc.width = width;
+					visibility_desc.height = height;
+					visibility_desc.format = GfxFormat::R32G32_UINT;
+					visibility_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+					builder.DeclareTexture(RG_NAME(VisibilityBuffer), visibility_desc);
+					builder.WriteRenderTarget(RG_NAME(VisibilityBuffer), RGLoadStoreAccessOp::Clear_Preserve);
+				}
+				else
+				{
+					RGTextureDesc gbuffer_desc{};
+					gbuffer_desc.width = width;
+					gbuffer_desc.height = height;
+					gbuffer_desc.format = GfxFormat::R8G8B8A8_UNORM;
+					gbuffer_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+
+					builder.DeclareTexture(RG_NAME(GBufferNormal), gbuffer_desc);
+					builder.DeclareTexture(RG_NAME(GBufferAlbedo), gbuffer_desc);
+					builder.DeclareTexture(RG_NAME(GBufferEmissive), gbuffer_desc);
+					builder.DeclareTexture(RG_NAME(GBufferCustom), gbuffer_desc);
+
+					builder.WriteRenderTarget(RG_NAME(GBufferNormal), RGLoadStoreAccessOp::Clear_Preserve);
+					builder.WriteRenderTarget(RG_NAME(GBufferAlbedo), RGLoadStoreAccessOp::Clear_Preserve);
+					builder.WriteRenderTarget(RG_NAME(GBufferEmissive), RGLoadStoreAccessOp::Clear_Preserve);
+					builder.WriteRenderTarget(RG_NAME(GBufferCustom), RGLoadStoreAccessOp::Clear_Preserve);
+				}
 
 				RGTextureDesc depth_desc{};
 				depth_desc.width = width;
 				depth_desc.height = height;
 				depth_desc.format = GfxFormat::D32_FLOAT;
 				depth_desc.clear_value = GfxClearValue(0.0f, 0);
-				builder.DeclareTexture(RG_NAME(DepthStencil), depth_desc);
+				builder.DeclareTemporalTexture(RG_NAME(DepthStencil), RG_NAME(DepthHistory), depth_desc);
 				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Clear_Preserve);
 				builder.SetViewport(width, height);
 
@@ -551,29 +782,51 @@ namespace adria
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
-				struct DrawMeshlets1stPhaseConstants
+				struct DrawMeshletsConstants
 				{
 					Uint32 visible_meshlets_idx;
+					Uint32 draw_stream;
 				} constants =
 				{
 					.visible_meshlets_idx = i,
+					.draw_stream = 0
 				};
-				GfxShadingRateInfo const& vrs = gfx->GetVRSInfo();
-				cmd_list->BeginVRS(vrs);
-				if (rain_active)
+				GfxBuffer const& draw_args = ctx.GetIndirectArgsBuffer(data.draw_args);
+				if (visibility_buffer)
 				{
-					draw_psos->AddDefine("RAIN", "1");
+					for (Uint32 stream = 0; stream < DRAW_STREAM_COUNT; ++stream)
+					{
+						if (!IsDrawStreamEnabled(stream)) continue;
+						constants.draw_stream = stream;
+						AddDrawStreamDefines(*draw_visibility_psos, stream);
+						cmd_list->SetPipelineState(draw_visibility_psos->Get());
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+						cmd_list->DispatchMeshIndirect(draw_args, stream * sizeof(D3D12_DISPATCH_MESH_ARGUMENTS));
+					}
+					return;
+				}
+
+				GfxShadingRateInfo const& vrs = gfx->GetVRSInfo();
+				cmd_list->BeginVRS(vrs);
+				for (Uint32 stream = 0; stream < DRAW_STREAM_COUNT; ++stream)
+				{
+					if (!IsDrawStreamEnabled(stream)) continue;
+					constants.draw_stream = stream;
+					if (rain_active)
+					{
+						draw_psos->AddDefine("RAIN", "1");
+					}
+					AddDrawStreamDefines(*draw_psos, stream);
+					cmd_list->SetPipelineState(draw_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->DispatchMeshIndirect(draw_args, stream * sizeof(D3D12_DISPATCH_MESH_ARGUMENTS));
 				}
-				GfxPipelineState* pso = draw_psos->Get();
-				cmd_list->SetPipelineState(pso);
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
-				GfxBuffer const& draw_args = ctx.GetIndirectArgsBuffer(data.draw_args);
-				cmd_list->DispatchMeshIndirect(draw_args, 0);
 				cmd_list->EndVRS(vrs);
 			}, RGPassType::Graphics, RGPassFlags::None);
 
-		AddHZBPasses(rg);
+		if (occlusion_culling) hzb_pass.AddPasses(rg, "1st phase");
 	}
 
 	void GPUDrivenGBufferPass::Add2ndPhasePasses(RenderGraph& rg)
@@ -581,74 +834,516 @@ namespace adria
 		if (!occlusion_culling) return;
 
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
-		struct BuildInstanceCullArgsPassData
+		if (UseWorkGraphCulling())
+		{
+			AddCullWorkGraphPass(rg, true);
+		}
+		else
 		{
-			RGBufferReadOnlyId  occluded_instances_counter;
-			RGBufferReadWriteId instance_cull_args;
+			Bool const predicated = GpuDrivenPredication.Get();
+			if (predicated) rg.AddCounterPredicatePass(RG_NAME(OccludedInstancesCounter), RG_NAME(OccludedInstancesPredicate));
+
+			struct BuildInstanceCullArgsPassData
+			{
+				RGBufferReadOnlyId  occluded_instances_counter;
+				RGBufferReadWriteId instance_cull_args;
+			};
+
+			rg.AddPass<BuildInstanceCullArgsPassData>("2nd Phase Build Instance Cull Args Pass",
+				[=](BuildInstanceCullArgsPassData& data, RenderGraphBuilder& builder)
+				{
+					RGBufferDesc instance_cull_args_desc{};
+					instance_cull_args_desc.resource_usage = GfxResourceUsage::Default;
+					instance_cull_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+					instance_cull_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+					instance_cull_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
+					builder.DeclareBuffer(RG_NAME(InstanceCullArgs), instance_cull_args_desc);
+
+					data.instance_cull_args = builder.WriteBuffer(RG_NAME(InstanceCullArgs));
+					data.occluded_instances_counter = builder.ReadBuffer(RG_NAME(OccludedInstancesCounter));
+					if (predicated) builder.SetPredication(RG_NAME(OccludedInstancesPredicate));
+				},
+				[=](BuildInstanceCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.occluded_instances_counter),
+													ctx.GetReadWriteBuffer(data.instance_cull_args)
+					};
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					struct BuildInstanceCullArgsConstants
+					{
+						Uint32  occluded_instances_counter_idx;
+						Uint32  instance_cull_args_idx;
+					} constants =
+					{
+						.occluded_instances_counter_idx = i + 0,
+						.instance_cull_args_idx = i + 1
+					};
+					cmd_list->SetPipelineState(build_instance_cull_args_pso.get());
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(1, 1, 1);
+
+				}, RGPassType::Compute, RGPassFlags::None);
+
+			struct CullInstancesPassData
+			{
+				RGTextureReadOnlyId hzb;
+				RGBufferIndirectArgsId cull_args;
+				RGBufferReadWriteId candidate_meshlets;
+				RGBufferReadWriteId candidate_meshlets_counter;
+				RGBufferReadWriteId occluded_instances;
+				RGBufferReadWriteId occluded_instances_counter;
+			};
+
+			rg.AddPass<CullInstancesPassData>("2nd Phase Cull Instances Pass",
+				[=](CullInstancesPassData& data, RenderGraphBuilder& builder)
+				{
+					data.hzb = builder.ReadTexture(RG_NAME(HZB));
+					data.cull_args = builder.ReadIndirectArgsBuffer(RG_NAME(InstanceCullArgs));
+					if (predicated) builder.SetPredication(RG_NAME(OccludedInstancesPredicate));
+					data.occluded_instances = builder.WriteBuffer(RG_NAME(OccludedInstances));
+					data.occluded_instances_counter = builder.WriteBuffer(RG_NAME(OccludedInstancesCounter));
+					data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
+					data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+				},
+				[=](CullInstancesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.hzb),
+													ctx.GetReadWriteBuffer(data.occluded_instances),
+													ctx.GetReadWriteBuffer(data.occluded_instances_counter),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets_counter) };
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					struct CullInstances2ndPhaseConstants
+					{
+						Uint32 num_instances;
+						Uint32 hzb_idx;
+						Uint32 occluded_instances_idx;
+						Uint32 occluded_instances_counter_idx;
+						Uint32 candidate_meshlets_idx;
+						Uint32 candidate_meshlets_counter_idx;
+					} constants =
+					{
+						.num_instances = 0,
+						.hzb_idx = i,
+						.occluded_instances_idx = i + 1,
+						.occluded_instances_counter_idx = i + 2,
+						.candidate_meshlets_idx = i + 3,
+						.candidate_meshlets_counter_idx = i + 4,
+					};
+
+					cull_instances_psos->AddDefine("SECOND_PHASE", "1");
+					if (!occlusion_culling)
+					{
+						cull_instances_psos->AddDefine("OCCLUSION_CULL", "0");
+					}
+					if (!cluster_lod)
+					{
+						cull_instances_psos->AddDefine("CLUSTER_LOD", "0");
+					}
+					cmd_list->SetPipelineState(cull_instances_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					GfxBuffer const& dispatch_args = ctx.GetIndirectArgsBuffer(data.cull_args);
+					cmd_list->DispatchIndirect(dispatch_args, 0);
+
+				}, RGPassType::Compute, RGPassFlags::None);
+
+			struct BuildMeshletCullArgsPassData
+			{
+				RGBufferReadOnlyId  candidate_meshlets_counter;
+				RGBufferReadWriteId meshlet_cull_args;
+			};
+
+			rg.AddPass<BuildMeshletCullArgsPassData>("2nd Phase Build Meshlet Cull Args Pass",
+				[=](BuildMeshletCullArgsPassData& data, RenderGraphBuilder& builder)
+				{
+					data.meshlet_cull_args = builder.WriteBuffer(RG_NAME(MeshletCullArgs));
+					data.candidate_meshlets_counter = builder.ReadBuffer(RG_NAME(CandidateMeshletsCounter));
+				},
+				[=](BuildMeshletCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.candidate_meshlets_counter),
+													ctx.GetReadWriteBuffer(data.meshlet_cull_args)
+					};
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					struct BuildMeshletCullArgsConstants
+					{
+						Uint32 candidate_meshlets_counter_idx;
+						Uint32 meshlet_cull_args_idx;
+					} constants =
+					{
+						.candidate_meshlets_counter_idx = i + 0,
+						.meshlet_cull_args_idx = i + 1
+					};
+					build_meshlet_cull_args_psos->AddDefine("SECOND_PHASE", "1");
+					cmd_list->SetPipelineState(build_meshlet_cull_args_psos->Get());
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(1, 1, 1);
+
+				}, RGPassType::Compute, RGPassFlags::None);
+
+
+			struct CullMeshletsPassData
+			{
+				RGTextureReadOnlyId hzb;
+				RGBufferIndirectArgsId indirect_args;
+				RGBufferReadWriteId candidate_meshlets;
+				RGBufferReadWriteId candidate_meshlets_counter;
+				RGBufferReadWriteId visible_meshlets;
+				RGBufferReadWriteId visible_meshlets_counter;
+			};
+
+			rg.AddPass<CullMeshletsPassData>("2nd Phase Cull Meshlets Pass",
+				[=](CullMeshletsPassData& data, RenderGraphBuilder& builder)
+				{
+					data.hzb = builder.ReadTexture(RG_NAME(HZB));
+					data.indirect_args = builder.ReadIndirectArgsBuffer(RG_NAME(MeshletCullArgs));
+					data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
+					data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+					data.visible_meshlets = builder.WriteBuffer(RG_NAME(VisibleMeshlets));
+					data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
+				},
+				[=](CullMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.hzb),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets),
+													ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
+													ctx.GetReadWriteBuffer(data.visible_meshlets),
+													ctx.GetReadWriteBuffer(data.visible_meshlets_counter) };
+					GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+					gfx->CopyDescriptors(dst_handle, src_handles);
+					Uint32 i = dst_handle.GetIndex();
+
+					struct CullMeshlets2ndPhaseConstants
+					{
+						Uint32 hzb_idx;
+						Uint32 candidate_meshlets_idx;
+						Uint32 candidate_meshlets_counter_idx;
+						Uint32 visible_meshlets_idx;
+						Uint32 visible_meshlets_counter_idx;
+					} constants =
+					{
+						.hzb_idx = i,
+						.candidate_meshlets_idx = i + 1,
+						.candidate_meshlets_counter_idx = i + 2,
+						.visible_meshlets_idx = i + 3,
+						.visible_meshlets_counter_idx = i + 4,
+					};
+
+					if (!occlusion_culling)
+					{
+						cull_meshlets_psos->AddDefine("OCCLUSION_CULL", "0");
+					}
+					if (!cluster_lod)
+					{
+						cull_meshlets_psos->AddDefine("CLUSTER_LOD", "0");
+					}
+					if (!cone_culling)
+					{
+						cull_meshlets_psos->AddDefine("CONE_CULL", "0");
+					}
+					cull_meshlets_psos->AddDefine("SECOND_PHASE", "1");
+					cmd_list->SetPipelineState(cull_meshlets_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+
+					GfxBuffer const& indirect_args = ctx.GetIndirectArgsBuffer(data.indirect_args);
+					cmd_list->DispatchIndirect(indirect_args, 0);
+				}, RGPassType::Compute, RGPassFlags::None);
+		}
+
+		struct BuildMeshletDrawArgsPassData
+		{
+			RGBufferReadOnlyId  visible_meshlets_counter;
+			RGBufferReadWriteId meshlet_draw_args;
 		};
 
-		rg.AddPass<BuildInstanceCullArgsPassData>("2nd Phase Build Instance Cull Args Pass",
-			[=](BuildInstanceCullArgsPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<BuildMeshletDrawArgsPassData>("2nd Phase Build Meshlet Draw Args Pass",
+			[=](BuildMeshletDrawArgsPassData& data, RenderGraphBuilder& builder)
 			{
-				RGBufferDesc instance_cull_args_desc{};
-				instance_cull_args_desc.resource_usage = GfxResourceUsage::Default;
-				instance_cull_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
-				instance_cull_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
-				instance_cull_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
-				builder.DeclareBuffer(RG_NAME(InstanceCullArgs), instance_cull_args_desc);
-
-				data.instance_cull_args = builder.WriteBuffer(RG_NAME(InstanceCullArgs));
-				data.occluded_instances_counter = builder.ReadBuffer(RG_NAME(OccludedInstancesCounter));
+				data.meshlet_draw_args = builder.WriteBuffer(RG_NAME(MeshletDrawArgs));
+				data.visible_meshlets_counter = builder.ReadBuffer(RG_NAME(VisibleMeshletsCounter));
 			},
-			[=](BuildInstanceCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](BuildMeshletDrawArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.occluded_instances_counter),
-												ctx.GetReadWriteBuffer(data.instance_cull_args)
+				GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.visible_meshlets_counter),
+												ctx.GetReadWriteBuffer(data.meshlet_draw_args)
 				};
 				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
-				struct BuildInstanceCullArgsConstants
+				struct BuildMeshletDrawArgsConstants
 				{
-					Uint32  occluded_instances_counter_idx;
-					Uint32  instance_cull_args_idx;
+					Uint32 visible_meshlets_counter_idx;
+					Uint32 meshlet_draw_args_idx;
 				} constants =
 				{
-					.occluded_instances_counter_idx = i + 0,
-					.instance_cull_args_idx = i + 1
+					.visible_meshlets_counter_idx = i + 0,
+					.meshlet_draw_args_idx = i + 1
 				};
-				cmd_list->SetPipelineState(build_instance_cull_args_pso.get());
+				build_meshlet_draw_args_psos->AddDefine("SECOND_PHASE", "1");
+				cmd_list->SetPipelineState(build_meshlet_draw_args_psos->Get());
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(1, 1, 1);
 
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		struct CullInstancesPassData
+		struct DrawMeshletsPassData
+		{
+			RGBufferReadOnlyId visible_meshlets;
+			RGBufferIndirectArgsId draw_args;
+		};
+		rg.AddPass<DrawMeshletsPassData>("2nd Phase Draw Meshlets",
+			[=](DrawMeshletsPassData& data, RenderGraphBuilder& builder)
+			{
+				if (visibility_buffer)
+				{
+					builder.WriteRenderTarget(RG_NAME(VisibilityBuffer), RGLoadStoreAccessOp::Preserve_Preserve);
+				}
+				else
+				{
+					builder.WriteRenderTarget(RG_NAME(GBufferNormal), RGLoadStoreAccessOp::Preserve_Preserve);
+					builder.WriteRenderTarget(RG_NAME(GBufferAlbedo), RGLoadStoreAccessOp::Preserve_Preserve);
+					builder.WriteRenderTarget(RG_NAME(GBufferEmissive), RGLoadStoreAccessOp::Preserve_Preserve);
+					builder.WriteRenderTarget(RG_NAME(GBufferCustom), RGLoadStoreAccessOp::Preserve_Preserve);
+				}
+				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+
+				data.visible_meshlets = builder.ReadBuffer(RG_NAME(VisibleMeshlets));
+				data.draw_args = builder.ReadIndirectArgsBuffer(RG_NAME(MeshletDrawArgs));
+			},
+			[=](DrawMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] =
+				{
+					ctx.GetReadOnlyBuffer(data.visible_meshlets)
+				};
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct DrawMeshletsConstants
+				{
+					Uint32 visible_meshlets_idx;
+					Uint32 draw_stream;
+				} constants =
+				{
+					.visible_meshlets_idx = i,
+					.draw_stream = 0
+				};
+				GfxBuffer const& draw_args = ctx.GetIndirectArgsBuffer(data.draw_args);
+
+				if (visibility_buffer)
+				{
+					for (Uint32 stream = 0; stream < DRAW_STREAM_COUNT; ++stream)
+					{
+						if (!IsDrawStreamEnabled(stream)) continue;
+						constants.draw_stream = stream;
+						AddDrawStreamDefines(*draw_visibility_psos, stream);
+						cmd_list->SetPipelineState(draw_visibility_psos->Get());
+						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+						cmd_list->SetRootConstants(1, constants);
+						cmd_list->DispatchMeshIndirect(draw_args, stream * sizeof(D3D12_DISPATCH_MESH_ARGUMENTS));
+					}
+					return;
+				}
+
+				GfxShadingRateInfo const& vrs = gfx->GetVRSInfo();
+				cmd_list->BeginVRS(vrs);
+				for (Uint32 stream = 0; stream < DRAW_STREAM_COUNT; ++stream)
+				{
+					if (!IsDrawStreamEnabled(stream)) continue;
+					constants.draw_stream = stream;
+					if (rain_active)
+					{
+						draw_psos->AddDefine("RAIN", "1");
+					}
+					AddDrawStreamDefines(*draw_psos, stream);
+					cmd_list->SetPipelineState(draw_psos->Get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->DispatchMeshIndirect(draw_args, stream * sizeof(D3D12_DISPATCH_MESH_ARGUMENTS));
+				}
+				cmd_list->EndVRS(vrs);
+			}, RGPassType::Graphics, RGPassFlags::None);
+
+		hzb_pass.AddPasses(rg, "2nd phase");
+	}
+
+	void GPUDrivenGBufferPass::AddVisibilityBufferMaterialPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct VisibilityBufferMaterialPassData
+		{
+			RGTextureReadOnlyId visibility_buffer;
+			RGTextureReadOnlyId depth;
+			RGTextureReadWriteId gbuffer_normal;
+			RGTextureReadWriteId gbuffer_albedo;
+			RGTextureReadWriteId gbuffer_emissive;
+			RGTextureReadWriteId gbuffer_custom;
+		};
+		rg.AddPass<VisibilityBufferMaterialPassData>("Visibility Buffer Material Pass",
+			[=](VisibilityBufferMaterialPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc gbuffer_desc{};
+				gbuffer_desc.width = width;
+				gbuffer_desc.height = height;
+				gbuffer_desc.format = GfxFormat::R8G8B8A8_UNORM;
+
+				builder.DeclareTexture(RG_NAME(GBufferNormal), gbuffer_desc);
+				builder.DeclareTexture(RG_NAME(GBufferAlbedo), gbuffer_desc);
+				builder.DeclareTexture(RG_NAME(GBufferEmissive), gbuffer_desc);
+				builder.DeclareTexture(RG_NAME(GBufferCustom), gbuffer_desc);
+
+				data.gbuffer_normal = builder.WriteTexture(RG_NAME(GBufferNormal));
+				data.gbuffer_albedo = builder.WriteTexture(RG_NAME(GBufferAlbedo));
+				data.gbuffer_emissive = builder.WriteTexture(RG_NAME(GBufferEmissive));
+				data.gbuffer_custom = builder.WriteTexture(RG_NAME(GBufferCustom));
+				data.visibility_buffer = builder.ReadTexture(RG_NAME(VisibilityBuffer), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+			},
+			[=](VisibilityBufferMaterialPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.visibility_buffer),
+												ctx.GetReadOnlyTexture(data.depth),
+												ctx.GetReadWriteTexture(data.gbuffer_normal),
+												ctx.GetReadWriteTexture(data.gbuffer_albedo),
+												ctx.GetReadWriteTexture(data.gbuffer_emissive),
+												ctx.GetReadWriteTexture(data.gbuffer_custom) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				//reconstructs the triangle attributes of every pixel once, so material cost no longer scales with overdraw
+				struct VisibilityBufferMaterialConstants
+				{
+					Uint32 visibility_buffer_idx;
+					Uint32 depth_idx;
+					Uint32 gbuffer_normal_idx;
+					Uint32 gbuffer_albedo_idx;
+					Uint32 gbuffer_emissive_idx;
+					Uint32 gbuffer_custom_idx;
+				} constants =
+				{
+					.visibility_buffer_idx = i,
+					.depth_idx = i + 1,
+					.gbuffer_normal_idx = i + 2,
+					.gbuffer_albedo_idx = i + 3,
+					.gbuffer_emissive_idx = i + 4,
+					.gbuffer_custom_idx = i + 5
+				};
+
+				if (rain_active)
+				{
+					visibility_material_psos->AddDefine("RAIN", "1");
+				}
+				cmd_list->SetPipelineState(visibility_material_psos->Get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 8), DivideAndRoundUp(height, 8), 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUDrivenGBufferPass::AddShadowPasses(RenderGraph& rg, RGResourceName shadow_map, Uint32 shadow_map_size, Uint64 view_cbuffer_address, Uint32 view_index, QuadTreeAllocator::Allocation const& atlas_tile)
+	{
+		if (!IsSupported()) return;
+
+		struct ShadowCullInstancesPassData
 		{
 			RGTextureReadOnlyId hzb;
-			RGBufferIndirectArgsId cull_args;
 			RGBufferReadWriteId candidate_meshlets;
 			RGBufferReadWriteId candidate_meshlets_counter;
+			RGBufferReadWriteId visible_meshlets_counter;
 			RGBufferReadWriteId occluded_instances;
 			RGBufferReadWriteId occluded_instances_counter;
 		};
 
-		rg.AddPass<CullInstancesPassData>("2nd Phase Cull Instances Pass",
-			[=](CullInstancesPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<ShadowCullInstancesPassData>("Shadow Cull Instances Pass",
+			[=](ShadowCullInstancesPassData& data, RenderGraphBuilder& builder)
 			{
+				RGBufferDesc counter_desc{};
+				counter_desc.size = 3 * sizeof(Uint32);
+				counter_desc.format = GfxFormat::R32_UINT;
+				counter_desc.stride = sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowCandidateMeshletsCounter, view_index), counter_desc);
+				counter_desc.size = VISIBLE_MESHLETS_COUNTER_COUNT * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowVisibleMeshletsCounter, view_index), counter_desc);
+				counter_desc.size = sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowOccludedInstancesCounter, view_index), counter_desc);
+
+				RGBufferDesc candidate_meshlets_buffer_desc{};
+				candidate_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
+				candidate_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				candidate_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
+				candidate_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS;
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowCandidateMeshlets, view_index), candidate_meshlets_buffer_desc);
+
+				RGBufferDesc occluded_instances_buffer_desc{};
+				occluded_instances_buffer_desc.resource_usage = GfxResourceUsage::Default;
+				occluded_instances_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				occluded_instances_buffer_desc.stride = sizeof(Uint32);
+				occluded_instances_buffer_desc.size = sizeof(Uint32) * MAX_NUM_INSTANCES;
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowOccludedInstances, view_index), occluded_instances_buffer_desc);
+
 				data.hzb = builder.ReadTexture(RG_NAME(HZB));
-				data.cull_args = builder.ReadIndirectArgsBuffer(RG_NAME(InstanceCullArgs));
-				data.occluded_instances = builder.WriteBuffer(RG_NAME(OccludedInstances));
-				data.occluded_instances_counter = builder.WriteBuffer(RG_NAME(OccludedInstancesCounter));
-				data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
-				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
+				data.occluded_instances = builder.WriteBuffer(RG_NAME_IDX(ShadowOccludedInstances, view_index));
+				data.occluded_instances_counter = builder.WriteBuffer(RG_NAME_IDX(ShadowOccludedInstancesCounter, view_index));
+				data.candidate_meshlets = builder.WriteBuffer(RG_NAME_IDX(ShadowCandidateMeshlets, view_index));
+				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME_IDX(ShadowCandidateMeshletsCounter, view_index));
+				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME_IDX(ShadowVisibleMeshletsCounter, view_index));
 			},
-			[=](CullInstancesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](ShadowCullInstancesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor counter_dst_handle = gfx->AllocateDescriptorsGPU(3);
+				GfxDescriptor counter_src_handles[] = { ctx.GetReadWriteBuffer(data.candidate_meshlets_counter),
+														ctx.GetReadWriteBuffer(data.visible_meshlets_counter),
+														ctx.GetReadWriteBuffer(data.occluded_instances_counter) };
+				gfx->CopyDescriptors(counter_dst_handle, counter_src_handles);
+				Uint32 j = counter_dst_handle.GetIndex();
+
+				struct ClearCountersConstants
+				{
+					Uint32 candidate_meshlets_counter_idx;
+					Uint32 visible_meshlets_counter_idx;
+					Uint32 occluded_instances_counter_idx;
+				} clear_constants =
+				{
+					.candidate_meshlets_counter_idx = j,
+					.visible_meshlets_counter_idx = j + 1,
+					.occluded_instances_counter_idx = j + 2
+				};
+				cmd_list->SetPipelineState(clear_counters_pso.get());
+				cmd_list->SetRootConstants(1, clear_constants);
+				cmd_list->Dispatch(1, 1, 1);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
 				GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.hzb),
 												ctx.GetReadWriteBuffer(data.occluded_instances),
 												ctx.GetReadWriteBuffer(data.occluded_instances_counter),
@@ -658,7 +1353,8 @@ namespace adria
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
-				struct CullInstances2ndPhaseConstants
+				Uint32 const num_instances = (Uint32)reg.view<Batch>().size();
+				struct CullInstances1stPhaseConstants
 				{
 					Uint32 num_instances;
 					Uint32 hzb_idx;
@@ -668,7 +1364,7 @@ namespace adria
 					Uint32 candidate_meshlets_counter_idx;
 				} constants =
 				{
-					.num_instances = 0,
+					.num_instances = num_instances,
 					.hzb_idx = i,
 					.occluded_instances_idx = i + 1,
 					.occluded_instances_counter_idx = i + 2,
@@ -676,32 +1372,37 @@ namespace adria
 					.candidate_meshlets_counter_idx = i + 4,
 				};
 
-				cull_instances_psos->AddDefine("SECOND_PHASE", "1");
-				if (!occlusion_culling)
+				cull_instances_psos->AddDefine("OCCLUSION_CULL", "0");
+				if (!cluster_lod)
 				{
-					cull_instances_psos->AddDefine("OCCLUSION_CULL", "0");
+					cull_instances_psos->AddDefine("CLUSTER_LOD", "0");
 				}
 				cmd_list->SetPipelineState(cull_instances_psos->Get());
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(0, view_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				GfxBuffer const& dispatch_args = ctx.GetIndirectArgsBuffer(data.cull_args);
-				cmd_list->DispatchIndirect(dispatch_args, 0);
-
+				cmd_list->Dispatch(DivideAndRoundUp(num_instances, 64), 1, 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		struct BuildMeshletCullArgsPassData
+		struct ShadowBuildMeshletCullArgsPassData
 		{
 			RGBufferReadOnlyId  candidate_meshlets_counter;
 			RGBufferReadWriteId meshlet_cull_args;
 		};
 
-		rg.AddPass<BuildMeshletCullArgsPassData>("2nd Phase Build Meshlet Cull Args Pass",
-			[=](BuildMeshletCullArgsPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<ShadowBuildMeshletCullArgsPassData>("Shadow Build Meshlet Cull Args Pass",
+			[=](ShadowBuildMeshletCullArgsPassData& data, RenderGraphBuilder& builder)
 			{
-				data.meshlet_cull_args = builder.WriteBuffer(RG_NAME(MeshletCullArgs));
-				data.candidate_meshlets_counter = builder.ReadBuffer(RG_NAME(CandidateMeshletsCounter));
+				RGBufferDesc meshlet_cull_args_desc{};
+				meshlet_cull_args_desc.resource_usage = GfxResourceUsage::Default;
+				meshlet_cull_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				meshlet_cull_args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+				meshlet_cull_args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowMeshletCullArgs, view_index), meshlet_cull_args_desc);
+
+				data.meshlet_cull_args = builder.WriteBuffer(RG_NAME_IDX(ShadowMeshletCullArgs, view_index));
+				data.candidate_meshlets_counter = builder.ReadBuffer(RG_NAME_IDX(ShadowCandidateMeshletsCounter, view_index));
 			},
-			[=](BuildMeshletCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](ShadowBuildMeshletCullArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
@@ -721,15 +1422,12 @@ namespace adria
 					.candidate_meshlets_counter_idx = i + 0,
 					.meshlet_cull_args_idx = i + 1
 				};
-				build_meshlet_cull_args_psos->AddDefine("SECOND_PHASE", "1");
 				cmd_list->SetPipelineState(build_meshlet_cull_args_psos->Get());
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(1, 1, 1);
-
 			}, RGPassType::Compute, RGPassFlags::None);
 
-
-		struct CullMeshletsPassData
+		struct ShadowCullMeshletsPassData
 		{
 			RGTextureReadOnlyId hzb;
 			RGBufferIndirectArgsId indirect_args;
@@ -739,17 +1437,24 @@ namespace adria
 			RGBufferReadWriteId visible_meshlets_counter;
 		};
 
-		rg.AddPass<CullMeshletsPassData>("2nd Phase Cull Meshlets Pass",
-			[=](CullMeshletsPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<ShadowCullMeshletsPassData>("Shadow Cull Meshlets Pass",
+			[=](ShadowCullMeshletsPassData& data, RenderGraphBuilder& builder)
 			{
+				RGBufferDesc visible_meshlets_buffer_desc{};
+				visible_meshlets_buffer_desc.resource_usage = GfxResourceUsage::Default;
+				visible_meshlets_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				visible_meshlets_buffer_desc.stride = sizeof(MeshletCandidate);
+				visible_meshlets_buffer_desc.size = sizeof(MeshletCandidate) * MAX_NUM_MESHLETS * DRAW_STREAM_COUNT;
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowVisibleMeshlets, view_index), visible_meshlets_buffer_desc);
+
 				data.hzb = builder.ReadTexture(RG_NAME(HZB));
-				data.indirect_args = builder.ReadIndirectArgsBuffer(RG_NAME(MeshletCullArgs));
-				data.candidate_meshlets = builder.WriteBuffer(RG_NAME(CandidateMeshlets));
-				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME(CandidateMeshletsCounter));
-				data.visible_meshlets = builder.WriteBuffer(RG_NAME(VisibleMeshlets));
-				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME(VisibleMeshletsCounter));
+				data.indirect_args = builder.ReadIndirectArgsBuffer(RG_NAME_IDX(ShadowMeshletCullArgs, view_index));
+				data.candidate_meshlets = builder.WriteBuffer(RG_NAME_IDX(ShadowCandidateMeshlets, view_index));
+				data.candidate_meshlets_counter = builder.WriteBuffer(RG_NAME_IDX(ShadowCandidateMeshletsCounter, view_index));
+				data.visible_meshlets = builder.WriteBuffer(RG_NAME_IDX(ShadowVisibleMeshlets, view_index));
+				data.visible_meshlets_counter = builder.WriteBuffer(RG_NAME_IDX(ShadowVisibleMeshletsCounter, view_index));
 			},
-			[=](CullMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](ShadowCullMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
@@ -762,7 +1467,7 @@ namespace adria
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
-				struct CullMeshlets2ndPhaseConstants
+				struct CullMeshlets1stPhaseConstants
 				{
 					Uint32 hzb_idx;
 					Uint32 candidate_meshlets_idx;
@@ -778,32 +1483,41 @@ namespace adria
 					.visible_meshlets_counter_idx = i + 4,
 				};
 
-				if (!occlusion_culling)
+				//cone culling tests against the camera position, which is meaningless for directional shadow views
+				cull_meshlets_psos->AddDefine("OCCLUSION_CULL", "0");
+				if (!cluster_lod)
 				{
-					cull_meshlets_psos->AddDefine("OCCLUSION_CULL", "0");
+					cull_meshlets_psos->AddDefine("CLUSTER_LOD", "0");
 				}
-				cull_meshlets_psos->AddDefine("SECOND_PHASE", "1");
+				cull_meshlets_psos->AddDefine("CONE_CULL", "0");
 				cmd_list->SetPipelineState(cull_meshlets_psos->Get());
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(0, view_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
 
 				GfxBuffer const& indirect_args = ctx.GetIndirectArgsBuffer(data.indirect_args);
 				cmd_list->DispatchIndirect(indirect_args, 0);
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		struct BuildMeshletDrawArgsPassData
+		struct ShadowBuildMeshletDrawArgsPassData
 		{
 			RGBufferReadOnlyId  visible_meshlets_counter;
 			RGBufferReadWriteId meshlet_draw_args;
 		};
 
-		rg.AddPass<BuildMeshletDrawArgsPassData>("2nd Phase Build Meshlet Draw Args Pass",
-			[=](BuildMeshletDrawArgsPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<ShadowBuildMeshletDrawArgsPassData>("Shadow Build Meshlet Draw Args Pass",
+			[=](ShadowBuildMeshletDrawArgsPassData& data, RenderGraphBuilder& builder)
 			{
-				data.meshlet_draw_args = builder.WriteBuffer(RG_NAME(MeshletDrawArgs));
-				data.visible_meshlets_counter = builder.ReadBuffer(RG_NAME(VisibleMeshletsCounter));
+				RGBufferDesc meshlet_draw_args_desc{};
+				meshlet_draw_args_desc.resource_usage = GfxResourceUsage::Default;
+				meshlet_draw_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				meshlet_draw_args_desc.stride = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS);
+				meshlet_draw_args_desc.size = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS) * DRAW_STREAM_COUNT;
+				builder.DeclareBuffer(RG_NAME_IDX(ShadowMeshletDrawArgs, view_index), meshlet_draw_args_desc);
+
+				data.meshlet_draw_args = builder.WriteBuffer(RG_NAME_IDX(ShadowMeshletDrawArgs, view_index));
+				data.visible_meshlets_counter = builder.ReadBuffer(RG_NAME_IDX(ShadowVisibleMeshletsCounter, view_index));
 			},
-			[=](BuildMeshletDrawArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](ShadowBuildMeshletDrawArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
@@ -823,35 +1537,28 @@ namespace adria
 					.visible_meshlets_counter_idx = i + 0,
 					.meshlet_draw_args_idx = i + 1
 				};
-				build_meshlet_draw_args_psos->AddDefine("SECOND_PHASE", "1");
 				cmd_list->SetPipelineState(build_meshlet_draw_args_psos->Get());
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(1, 1, 1);
-
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		struct DrawMeshletsPassData
+		struct ShadowDrawMeshletsPassData
 		{
 			RGBufferReadOnlyId visible_meshlets;
 			RGBufferIndirectArgsId draw_args;
 		};
-		rg.AddPass<DrawMeshletsPassData>("2nd Phase Draw Meshlets",
-			[=](DrawMeshletsPassData& data, RenderGraphBuilder& builder)
+		rg.AddPass<ShadowDrawMeshletsPassData>("Shadow Draw Meshlets Pass",
+			[=](ShadowDrawMeshletsPassData& data, RenderGraphBuilder& builder)
 			{
-				builder.WriteRenderTarget(RG_NAME(GBufferNormal), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.WriteRenderTarget(RG_NAME(GBufferAlbedo), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.WriteRenderTarget(RG_NAME(GBufferEmissive), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.WriteRenderTarget(RG_NAME(GBufferCustom), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
-				builder.SetViewport(width, height);
+				builder.WriteDepthStencil(shadow_map, atlas_tile.IsValid() ? RGLoadStoreAccessOp::Preserve_Preserve : RGLoadStoreAccessOp::Clear_Preserve);
+				builder.SetViewport(shadow_map_size, shadow_map_size);
 
-				data.visible_meshlets = builder.ReadBuffer(RG_NAME(VisibleMeshlets));
-				data.draw_args = builder.ReadIndirectArgsBuffer(RG_NAME(MeshletDrawArgs));
+				data.visible_meshlets = builder.ReadBuffer(RG_NAME_IDX(ShadowVisibleMeshlets, view_index));
+				data.draw_args = builder.ReadIndirectArgsBuffer(RG_NAME_IDX(ShadowMeshletDrawArgs, view_index));
 			},
-			[=](DrawMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](ShadowDrawMeshletsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
-
 				GfxDescriptor src_handles[] =
 				{
 					ctx.GetReadOnlyBuffer(data.visible_meshlets)
@@ -860,186 +1567,45 @@ namespace adria
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				Uint32 i = dst_handle.GetIndex();
 
-				struct DrawMeshlets1stPhaseConstants
+				struct DrawMeshletsConstants
 				{
 					Uint32 visible_meshlets_idx;
+					Uint32 draw_stream;
 				} constants =
 				{
 					.visible_meshlets_idx = i,
+					.draw_stream = 0
 				};
-
-				GfxShadingRateInfo const& vrs = gfx->GetVRSInfo();
-				cmd_list->BeginVRS(vrs);
-				if (rain_active)
-				{
-					draw_psos->AddDefine("RAIN", "1");
-				}
-				GfxPipelineState* pso = draw_psos->Get();
-				cmd_list->SetPipelineState(pso);
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
 				GfxBuffer const& draw_args = ctx.GetIndirectArgsBuffer(data.draw_args);
-				cmd_list->DispatchMeshIndirect(draw_args, 0);
-				cmd_list->EndVRS(vrs);
-			}, RGPassType::Graphics, RGPassFlags::None);
-
-		AddHZBPasses(rg, true);
-	}
-
-	void GPUDrivenGBufferPass::AddHZBPasses(RenderGraph& rg, Bool second_phase)
-	{
-		if (!occlusion_culling) return;
-
-		struct InitializeHZBPassData
-		{
-			RGTextureReadOnlyId depth;
-			RGTextureReadWriteId hzb;
-		};
-		std::string hzb_init_name = "HZB Init ";
-		hzb_init_name += (second_phase ? "2nd phase" : "1st phase");
-		rg.AddPass<InitializeHZBPassData>(hzb_init_name.c_str(),
-			[=](InitializeHZBPassData& data, RenderGraphBuilder& builder)
-			{
-				data.hzb = builder.WriteTexture(RG_NAME(HZB));
-				data.depth = builder.ReadTexture(RG_NAME(DepthStencil));
-			},
-			[=](InitializeHZBPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-
-				GfxDescriptor src_handles[] = 
-				{
-					ctx.GetReadOnlyTexture(data.depth),
-					ctx.GetReadWriteTexture(data.hzb)
-				};
-				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
-				gfx->CopyDescriptors(dst_handle, src_handles);
-				Uint32 i = dst_handle.GetIndex();
-
-				struct InitializeHZBConstants
+				if (atlas_tile.IsValid()) cmd_list->SetScissorRect(atlas_tile.x, atlas_tile.y, atlas_tile.size, atlas_tile.size);
+				for (Uint32 stream = 0; stream < DRAW_STREAM_COUNT; ++stream)
 				{
-					Uint32 depth_idx;
-					Uint32 hzb_idx;
-					Float inv_hzb_width;
-					Float inv_hzb_height;
-				} constants =
-				{
-					.depth_idx = i,
-					.hzb_idx = i + 1,
-					.inv_hzb_width = 1.0f / hzb_width,
-					.inv_hzb_height = 1.0f / hzb_height
-				};
-				cmd_list->SetPipelineState(initialize_hzb_pso.get());
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(hzb_width, 16), DivideAndRoundUp(hzb_height, 16), 1);
-			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
-
-		struct HZBMipsPassData
-		{
-			RGBufferReadWriteId  spd_counter;
-			RGTextureReadWriteId hzb_mips[12];
-		};
-
-		std::string hzb_mips_name = "HZB Mips ";
-		hzb_mips_name += (second_phase ? "2nd phase" : "1st phase");
-		rg.AddPass<HZBMipsPassData>(hzb_mips_name.c_str(),
-			[=](HZBMipsPassData& data, RenderGraphBuilder& builder)
-			{
-				if (!second_phase)
-				{
-					RGBufferDesc counter_desc{};
-					counter_desc.size = sizeof(Uint32);
-					counter_desc.format = GfxFormat::R32_UINT;
-					counter_desc.stride = sizeof(Uint32);
-					builder.DeclareBuffer(RG_NAME(SPDCounter), counter_desc);
-				}
-
-				ADRIA_ASSERT(hzb_mip_count <= 12);
-				for (Uint32 i = 0; i < hzb_mip_count; ++i)
-				{
-					data.hzb_mips[i] = builder.WriteTexture(RG_NAME(HZB), i, 1);
+					constants.draw_stream = stream;
+					if (stream != (Uint32)MaterialAlphaMode::Opaque)
+					{
+						shadow_draw_psos->ModifyDesc([](GfxMeshShaderPipelineStateDesc& desc) { desc.PS = PS_DrawMeshletsShadowMask; });
+						shadow_draw_psos->AddDefine("TRANSPARENT", "1");
+					}
+					cmd_list->SetPipelineState(shadow_draw_psos->Get());
+					cmd_list->SetRootCBV(0, view_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->DispatchMeshIndirect(draw_args, stream * sizeof(D3D12_DISPATCH_MESH_ARGUMENTS));
 				}
-				data.spd_counter = builder.WriteBuffer(RG_NAME(SPDCounter));
-			},
-			[=](HZBMipsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-
-				varAU2(dispatchThreadGroupCountXY);
-				varAU2(workGroupOffset);
-				varAU2(numWorkGroupsAndMips);
-				varAU4(rectInfo) = initAU4(0, 0, hzb_width, hzb_height);
-				Uint32 mips = hzb_mip_count;
-
-				SpdSetup(
-					dispatchThreadGroupCountXY,
-					workGroupOffset,
-					numWorkGroupsAndMips,
-					rectInfo,
-					mips - 1);
-
-				std::vector<GfxDescriptor> src_handles(hzb_mip_count + 1);
-				src_handles[0] = ctx.GetReadWriteBuffer(data.spd_counter);
-				for (Uint32 i = 0; i < hzb_mip_count; ++i) src_handles[i + 1] = ctx.GetReadWriteTexture(data.hzb_mips[i]);
-
-				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU((Uint32)src_handles.size());
-				gfx->CopyDescriptors(dst_handle, src_handles);
-				Uint32 i = dst_handle.GetIndex();
-
-				GfxDescriptor counter_uav_cpu = src_handles[0];
-				GfxDescriptor counter_uav_gpu = dst_handle;
-				GfxBuffer& spd_counter = ctx.GetBuffer(*data.spd_counter);
-				Uint32 clear[] = { 0u };
-				cmd_list->ClearUAV(spd_counter, counter_uav_gpu, counter_uav_cpu, clear);
-				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
-
-				struct HZBMipsConstants
-				{
-					Uint32 num_mips;
-					Uint32 num_work_groups;
-					Uint32 work_group_offset_x;
-					Uint32 work_group_offset_y;
-				} constants
-				{
-					.num_mips = numWorkGroupsAndMips[1],
-					.num_work_groups = numWorkGroupsAndMips[0],
-					.work_group_offset_x = workGroupOffset[0],
-					.work_group_offset_y = workGroupOffset[1]
-				};
-
-				DECLSPEC_ALIGN(16)
-				struct SPDIndices
-				{
-					XMUINT4	dstIdx[12];
-					Uint32	spdGlobalAtomicIdx;
-				} indices{ .spdGlobalAtomicIdx = i };
-				for (Uint32 j = 0; j < hzb_mip_count; ++j) indices.dstIdx[j].x = i + 1 + j;
-
-				cmd_list->SetPipelineState(hzb_mips_pso.get());
-				cmd_list->SetRootConstants(1, constants);
-				cmd_list->SetRootCBV(2, indices);
-				cmd_list->Dispatch(dispatchThreadGroupCountXY[0], dispatchThreadGroupCountXY[1], 1);
-			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+			}, RGPassType::Graphics, RGPassFlags::None);
 	}
 
 	void GPUDrivenGBufferPass::AddDebugPass(RenderGraph& rg)
 	{
-		if (!display_debug_stats) return;
-
 		struct GPUDrivenDebugPassData
 		{
 			RGBufferCopySrcId  candidate_meshlets_counter;
 			RGBufferCopySrcId  visible_meshlets_counter;
 			RGBufferCopySrcId  occluded_instances_counter;
-			RGBufferCopyDstId  debug_buffer;
 		};
 
-		rg.ImportBuffer(RG_NAME(GPUDrivenDebugBuffer), debug_buffer.get());
-
-		rg.AddPass<GPUDrivenDebugPassData>("GPU Driven Debug Pass",
+		rg.AddPassIf<GPUDrivenDebugPassData>(display_debug_stats, "GPU Driven Debug Pass",
 			[=](GPUDrivenDebugPassData& data, RenderGraphBuilder& builder)
 			{
-				data.debug_buffer = builder.WriteCopyDstBuffer(RG_NAME(GPUDrivenDebugBuffer));
 				data.candidate_meshlets_counter = builder.ReadCopySrcBuffer(RG_NAME(CandidateMeshletsCounter));
 				data.visible_meshlets_counter = builder.ReadCopySrcBuffer(RG_NAME(VisibleMeshletsCounter));
 				data.occluded_instances_counter = builder.ReadCopySrcBuffer(RG_NAME(OccludedInstancesCounter));
@@ -1049,48 +1615,31 @@ namespace adria
 				GfxBuffer const& src_buffer1 = context.GetCopySrcBuffer(data.occluded_instances_counter);
 				GfxBuffer const& src_buffer2 = context.GetCopySrcBuffer(data.visible_meshlets_counter);
 				GfxBuffer const& src_buffer3 = context.GetCopySrcBuffer(data.candidate_meshlets_counter);
-				GfxBuffer& debug_buffer = context.GetCopyDstBuffer(data.debug_buffer);
-
-				Uint32 backbuffer_index = gfx->GetBackbufferIndex();
-				Uint32 buffer_offset = 6 * sizeof(Uint32) * backbuffer_index;
-				cmd_list->CopyBuffer(debug_buffer, buffer_offset, src_buffer1, 0, sizeof(Uint32));
-				cmd_list->CopyBuffer(debug_buffer, buffer_offset + sizeof(Uint32), src_buffer2, 0, 2 * sizeof(Uint32));
-				cmd_list->CopyBuffer(debug_buffer, buffer_offset + 3 * sizeof(Uint32), src_buffer3, 0, 3 * sizeof(Uint32));
-
-				ADRIA_ASSERT(debug_buffer.IsMapped());
-				Uint32* buffer_data = debug_buffer.GetMappedData<Uint32>();
-				buffer_data += 6 * backbuffer_index;
-				Uint32 num_instances = (Uint32)reg.view<Batch>().size();
-				debug_stats[backbuffer_index].occluded_instances = buffer_data[0];
-				debug_stats[backbuffer_index].num_instances = num_instances;
-				debug_stats[backbuffer_index].visible_instances = num_instances - buffer_data[0];
-				debug_stats[backbuffer_index].processed_meshlets = buffer_data[3];
-				debug_stats[backbuffer_index].phase1_candidate_meshlets = buffer_data[4];
-				debug_stats[backbuffer_index].phase2_candidate_meshlets = buffer_data[5];
-				debug_stats[backbuffer_index].phase1_visible_meshlets = buffer_data[1];
-				debug_stats[backbuffer_index].phase2_visible_meshlets = buffer_data[2];
 
+				Uint32 const num_instances = (Uint32)reg.view<Batch>().size();
+				GfxReadbackQueue* readback_queue = gfx->GetReadbackQueue();
+				readback_queue->Enqueue(cmd_list, src_buffer1, 0, sizeof(Uint32), [this, num_instances](void const* readback_data, Uint64)
+					{
+						Uint32 const occluded_instances = *static_cast<Uint32 const*>(readback_data);
+						debug_stats.num_instances = num_instances;
+						debug_stats.occluded_instances = occluded_instances;
+						debug_stats.visible_instances = num_instances - occluded_instances;
+					});
+				readback_queue->Enqueue(cmd_list, src_buffer2, 0, 2 * sizeof(Uint32), [this](void const* readback_data, Uint64)
+					{
+						Uint32 const* counters = static_cast<Uint32 const*>(readback_data);
+						debug_stats.phase1_visible_meshlets = counters[0];
+						debug_stats.phase2_visible_meshlets = counters[1];
+					});
+				readback_queue->Enqueue(cmd_list, src_buffer3, 0, 3 * sizeof(Uint32), [this](void const* readback_data, Uint64)
+					{
+						Uint32 const* counters = static_cast<Uint32 const*>(readback_data);
+						debug_stats.processed_meshlets = counters[0];
+						debug_stats.phase1_candidate_meshlets = counters[1];
+						debug_stats.phase2_candidate_meshlets = counters[2];
+					});
 			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
 
 	}
 
-	void GPUDrivenGBufferPass::CalculateHZBParameters()
-	{
-		Uint32 mips_x = (Uint32)std::max(ceilf(log2f((Float)width)), 1.0f);
-		Uint32 mips_y = (Uint32)std::max(ceilf(log2f((Float)height)), 1.0f);
-
-		hzb_mip_count = std::max(mips_x, mips_y);
-		ADRIA_ASSERT(hzb_mip_count <= MAX_HZB_MIP_COUNT);
-		hzb_width = 1 << (mips_x - 1);
-		hzb_height = 1 << (mips_y - 1);
-	}
-
-	void GPUDrivenGBufferPass::CreateDebugBuffer()
-	{
-		GfxBufferDesc debug_buffer_desc{};
-		debug_buffer_desc.size = 6 * sizeof(Uint32) * GFX_BACKBUFFER_COUNT;
-		debug_buffer_desc.resource_usage = GfxResourceUsage::Readback;
-		debug_buffer = gfx->CreateBuffer(debug_buffer_desc);
-	}
-
 }
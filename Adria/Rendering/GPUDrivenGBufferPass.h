@@ -1,7 +1,9 @@
 #pragma once
 #include "RenderGraph/RenderGraphResourceId.h"
+#include "RenderGraph/RenderGraphResourceName.h"
 #include "Graphics/GfxMacros.h"
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
+#include "Utilities/QuadTreeAllocator.h"
 
 
 namespace adria
@@ -11,10 +13,12 @@ namespace adria
 	class GfxDevice;
 	class GfxTexture;
 	class GfxBuffer;
+	class GfxStateObject;
+	class GfxShaderKey;
+	class HZBPass;
 
 	class GPUDrivenGBufferPass
 	{
-		static constexpr Uint32 MAX_HZB_MIP_COUNT = 13;
 		struct DebugStats
 		{
 			Uint32 num_instances;
@@ -29,66 +33,77 @@ namespace adria
 
 
 	public:
-		GPUDrivenGBufferPass(entt::registry& reg, GfxDevice* gfx, Uint32 width, Uint32 height);
+		GPUDrivenGBufferPass(entt::registry& reg, GfxDevice* gfx, HZBPass& hzb_pass, Uint32 width, Uint32 height);
 		~GPUDrivenGBufferPass();
 
 		void AddPasses(RenderGraph& rg);
+		//a valid atlas tile restricts drawing to that region of the shadow map, which is then expected to be cleared by the caller
+		void AddShadowPasses(RenderGraph& rg, RGResourceName shadow_map, Uint32 shadow_map_size, Uint64 view_cbuffer_address, Uint32 view_index, QuadTreeAllocator::Allocation const& atlas_tile = {});
 		void GUI();
 
 		Bool IsSupported() const;
 		Bool IsEnabled() const;
+		Bool UseWorkGraphCulling() const;
+		Bool IsOcclusionCullingEnabled() const { return occlusion_culling; }
 
 		void OnResize(Uint32 w, Uint32 h)
 		{
 			width = w, height = h;
-			InitializeHZB();
 		}
 
 		void OnRainEvent(Bool enabled)
 		{
 			rain_active = enabled;
 		}
+		void SetBlendStreamEnabled(Bool enabled)
+		{
+			blend_stream_enabled = enabled;
+		}
 
 	private:
 		GfxDevice* gfx;
 		entt::registry& reg;
+		HZBPass& hzb_pass;
 		Uint32 width, height;
 
-		std::unique_ptr<GfxTexture> HZB;
-		Uint32 hzb_mip_count = 0;
-		Uint32 hzb_width = 0;
-		Uint32 hzb_height = 0;
-
 		Bool occlusion_culling = true;
+		Bool cone_culling = true;
+		Bool cluster_lod = true;
+		Bool visibility_buffer = false;
 
-		std::unique_ptr<GfxBuffer> debug_buffer;
 		Bool display_debug_stats = false;
-		DebugStats debug_stats[GFX_BACKBUFFER_COUNT] = {};
+		DebugStats debug_stats = {};
 
 		Bool rain_active = false;
+		Bool blend_stream_enabled = true;
 		std::unique_ptr<GfxMeshShaderPipelineStatePermutations> draw_psos;
+		std::unique_ptr<GfxMeshShaderPipelineStatePermutations> shadow_draw_psos;
+		std::unique_ptr<GfxMeshShaderPipelineStatePermutations> draw_visibility_psos;
+		std::unique_ptr<GfxComputePipelineStatePermutations>	visibility_material_psos;
 		std::unique_ptr<GfxComputePipelineStatePermutations>	cull_meshlets_psos;
 		std::unique_ptr<GfxComputePipelineStatePermutations>	cull_instances_psos;
 		std::unique_ptr<GfxComputePipelineStatePermutations>    build_meshlet_cull_args_psos;
 		std::unique_ptr<GfxComputePipelineStatePermutations>    build_meshlet_draw_args_psos;
 		std::unique_ptr<GfxComputePipelineState> clear_counters_pso;
 		std::unique_ptr<GfxComputePipelineState> build_instance_cull_args_pso;
-		std::unique_ptr<GfxComputePipelineState> initialize_hzb_pso;
-		std::unique_ptr<GfxComputePipelineState> hzb_mips_pso;
+
+		std::unique_ptr<GfxStateObject> cull_work_graph_so;
+		std::unique_ptr<GfxBuffer> cull_work_graph_backing_memory;
+		Bool cull_work_graph_initialized = false;
 
 	private:
 		void CreatePSOs();
-		void InitializeHZB();
+		void CreateCullWorkGraph();
+		Bool IsDrawStreamEnabled(Uint32 stream) const;
+		void OnLibraryRecompiled(GfxShaderKey const&);
 
 		void AddClearCountersPass(RenderGraph& rg);
 		void Add1stPhasePasses(RenderGraph& rg);
 		void Add2ndPhasePasses(RenderGraph& rg);
+		void AddVisibilityBufferMaterialPass(RenderGraph& rg);
+		void AddCullWorkGraphPass(RenderGraph& rg, Bool second_phase);
 
-		void AddHZBPasses(RenderGraph& rg, Bool second_phase = false);
 		void AddDebugPass(RenderGraph& rg);
-
-		void CalculateHZBParameters();
-		void CreateDebugBuffer();
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,583 @@
+#include "GPUParticlesPass.h"
+#include "Components.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> GPUParticles("r.Particles", true, "Enable GPU simulated particles of ParticleEmitter entities");
+	static TAutoConsoleVariable<Bool> ParticleCollisions("r.Particles.Collisions", true, "Collide particles against the depth buffer");
+	static TAutoConsoleVariable<Bool> ParticleSort("r.Particles.Sort", true, "Sort particles back to front before drawing them with alpha blending");
+
+	enum ParticleFlags : Uint32
+	{
+		ParticleFlag_Collisions		 = 1 << 0,
+		ParticleFlag_CameraRelative  = 1 << 1,
+		ParticleFlag_VelocityAligned = 1 << 2,
+	};
+
+	struct GPUParticle
+	{
+		Vector3 position;
+		Float   age;
+		Vector3 velocity;
+		Float   lifetime;
+		Float   start_size;
+		Float   end_size;
+		Uint32  start_color;
+		Uint32  end_color;
+		Uint32  texture_idx;
+		Float   gravity_scale;
+		Float   restitution;
+		Uint32  flags;
+	};
+
+	//counter buffer layout: dead count followed by the alive count of both alive lists
+	static constexpr Uint32 PARTICLE_COUNTER_COUNT = 3;
+	//draw args buffer layout: sort dispatch followed by the particle draw
+	static constexpr Uint32 SORT_DISPATCH_ARGS_OFFSET = 0;
+	static constexpr Uint32 DRAW_ARGS_OFFSET = sizeof(D3D12_DISPATCH_ARGUMENTS);
+
+	GPUParticlesPass::GPUParticlesPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
+		: reg(reg), gfx(gfx), width(w), height(h)
+	{
+		CreateBuffers();
+		CreatePSOs();
+	}
+	GPUParticlesPass::~GPUParticlesPass() = default;
+
+	void GPUParticlesPass::Update(Float dt)
+	{
+		frame_emitters.clear();
+		if (!IsEnabled()) return;
+
+		auto emitter_view = reg.view<ParticleEmitter>();
+		for (entt::entity entity : emitter_view)
+		{
+			ParticleEmitter& emitter = emitter_view.get<ParticleEmitter>(entity);
+			if (!emitter.active)
+			{
+				emitter.emit_accumulator = 0.0f;
+				continue;
+			}
+
+			emitter.emit_accumulator += emitter.particles_per_second * dt;
+			Uint32 const emit_count = std::min((Uint32)emitter.emit_accumulator, MAX_PARTICLES);
+			if (emit_count == 0) continue;
+			emitter.emit_accumulator -= (Float)emit_count;
+			emitter.emit_accumulator = std::min(emitter.emit_accumulator, 1.0f);
+
+			Uint32 flags = 0;
+			if (emitter.collisions && ParticleCollisions.Get()) flags |= ParticleFlag_Collisions;
+			if (emitter.camera_relative) flags |= ParticleFlag_CameraRelative;
+			if (emitter.velocity_aligned) flags |= ParticleFlag_VelocityAligned;
+
+			frame_emitters.push_back(EmitterConstants
+				{
+					.position = emitter.position,
+					.emit_count = emit_count,
+					.position_variance = emitter.position_variance,
+					.lifetime = emitter.lifetime,
+					.velocity = emitter.velocity,
+					.lifetime_variance = emitter.lifetime_variance,
+					.velocity_variance = emitter.velocity_variance,
+					.start_size = emitter.start_size,
+					.start_color = emitter.start_color,
+					.end_color = emitter.end_color,
+					.end_size = emitter.end_size,
+					.gravity_scale = emitter.gravity_scale,
+					.restitution = emitter.restitution,
+					.texture_idx = GetTextureIndex(emitter.texture),
+					.flags = flags,
+					.seed = emitter_seed++
+				});
+		}
+	}
+
+	void GPUParticlesPass::AddPasses(RenderGraph& rg)
+	{
+		if (!IsEnabled()) return;
+		if (!initialized && frame_emitters.empty()) return;
+
+		RG_PASS_GROUP(rg, "GPU Particles");
+		rg.ImportBuffer(RG_NAME(ParticleBuffer), particle_buffer.get());
+		rg.ImportBuffer(RG_NAME(ParticleDeadList), dead_list_buffer.get());
+		rg.ImportBuffer(RG_NAME(ParticleAliveListCurrent), alive_list_buffers[current_alive_list].get());
+		rg.ImportBuffer(RG_NAME(ParticleAliveListNext), alive_list_buffers[1 - current_alive_list].get());
+		rg.ImportBuffer(RG_NAME(ParticleSortKeys), sort_keys_buffer.get());
+		rg.ImportBuffer(RG_NAME(ParticleCounters), counter_buffer.get());
+		rg.ImportBuffer(RG_NAME(ParticleSimulateArgs), simulate_args_buffer.get());
+		rg.ImportBuffer(RG_NAME(ParticleDrawArgs), draw_args_buffer.get());
+
+		if (!initialized) AddInitPass(rg);
+		AddEmitPass(rg);
+		AddSimulatePass(rg);
+		if (ParticleSort.Get()) AddSortPass(rg);
+		AddDrawPass(rg);
+		current_alive_list = 1 - current_alive_list;
+	}
+
+	void GPUParticlesPass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("GPU Particles", 0))
+				{
+					ImGui::Checkbox("Enable", GPUParticles.GetPtr());
+					if (GPUParticles.Get())
+					{
+						ImGui::Checkbox("Depth Collisions", ParticleCollisions.GetPtr());
+						ImGui::Checkbox("Sort", ParticleSort.GetPtr());
+						ImGui::Text("Emitting: %zu emitters", frame_emitters.size());
+					}
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	Bool GPUParticlesPass::IsEnabled() const
+	{
+		return GPUParticles.Get();
+	}
+
+	void GPUParticlesPass::CreateBuffers()
+	{
+		particle_buffer = gfx->CreateBuffer(StructuredBufferDesc<GPUParticle>(MAX_PARTICLES));
+		particle_buffer->SetName("Particles");
+		dead_list_buffer = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(MAX_PARTICLES));
+		dead_list_buffer->SetName("Particle Dead List");
+		for (Uint32 i = 0; i < 2; ++i)
+		{
+			alive_list_buffers[i] = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(MAX_PARTICLES));
+			alive_list_buffers[i]->SetName("Particle Alive List");
+		}
+		sort_keys_buffer = gfx->CreateBuffer(StructuredBufferDesc<Float>(MAX_PARTICLES));
+		sort_keys_buffer->SetName("Particle Sort Keys");
+
+		GfxBufferDesc counter_desc{};
+		counter_desc.resource_usage = GfxResourceUsage::Default;
+		counter_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+		counter_desc.format = GfxFormat::R32_UINT;
+		counter_desc.stride = sizeof(Uint32);
+		counter_desc.size = PARTICLE_COUNTER_COUNT * sizeof(Uint32);
+		counter_buffer = gfx->CreateBuffer(counter_desc);
+		counter_buffer->SetName("Particle Counters");
+
+		GfxBufferDesc args_desc{};
+		args_desc.resource_usage = GfxResourceUsage::Default;
+		args_desc.bind_flags = GfxBindFlag::UnorderedAccess;
+		args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+		args_desc.stride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+		args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS);
+		simulate_args_buffer = gfx->CreateBuffer(args_desc);
+		simulate_args_buffer->SetName("Particle Simulate Args");
+
+		args_desc.stride = sizeof(Uint32);
+		args_desc.size = sizeof(D3D12_DISPATCH_ARGUMENTS) + sizeof(D3D12_DRAW_ARGUMENTS);
+		draw_args_buffer = gfx->CreateBuffer(args_desc);
+		draw_args_buffer->SetName("Particle Draw Args");
+	}
+
+	void GPUParticlesPass::CreatePSOs()
+	{
+		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
+		gfx_pso_desc.root_signature = GfxRootSignatureID::Common;
+		gfx_pso_desc.VS = VS_Particle;
+		gfx_pso_desc.PS = PS_Particle;
+		gfx_pso_desc.num_render_targets = 1;
+		gfx_pso_desc.rtv_formats[0] = GfxFormat::R16G16B16A16_FLOAT;
+		gfx_pso_desc.depth_state.depth_enable = true;
+		gfx_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::Zero;
+		gfx_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
+		gfx_pso_desc.blend_state.render_target[0].blend_enable = true;
+		gfx_pso_desc.blend_state.render_target[0].src_blend = GfxBlend::SrcAlpha;
+		gfx_pso_desc.blend_state.render_target[0].dest_blend = GfxBlend::InvSrcAlpha;
+		gfx_pso_desc.blend_state.render_target[0].blend_op = GfxBlendOp::Add;
+		gfx_pso_desc.blend_state.render_target[0].src_blend_alpha = GfxBlend::One;
+		gfx_pso_desc.blend_state.render_target[0].dest_blend_alpha = GfxBlend::InvSrcAlpha;
+		gfx_pso_desc.blend_state.render_target[0].blend_op_alpha = GfxBlendOp::Add;
+		gfx_pso_desc.rasterizer_state.cull_mode = GfxCullMode::None;
+		particle_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
+
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_ParticleInitDeadList;
+		init_dead_list_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ParticleEmit;
+		emit_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ParticleSimulate;
+		simulate_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ParticleBuildArgs;
+		build_args_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ParticleSortInitial;
+		sort_initial_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ParticleSortStep;
+		sort_step_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		compute_pso_desc.CS = CS_ParticleSortInner;
+		sort_inner_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void GPUParticlesPass::AddInitPass(RenderGraph& rg)
+	{
+		struct InitParticlesPassData
+		{
+			RGBufferReadWriteId dead_list;
+			RGBufferReadWriteId counters;
+		};
+
+		rg.AddPass<InitParticlesPassData>("Particles Init Dead List Pass",
+			[=](InitParticlesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.dead_list = builder.WriteBuffer(RG_NAME(ParticleDeadList));
+				data.counters = builder.WriteBuffer(RG_NAME(ParticleCounters));
+			},
+			[=](InitParticlesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadWriteBuffer(data.dead_list), ctx.GetReadWriteBuffer(data.counters) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct InitDeadListConstants
+				{
+					Uint32 dead_list_idx;
+					Uint32 counters_idx;
+					Uint32 max_particles;
+				} constants =
+				{
+					.dead_list_idx = i,
+					.counters_idx = i + 1,
+					.max_particles = MAX_PARTICLES
+				};
+				cmd_list->SetPipelineState(init_dead_list_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(MAX_PARTICLES, 256), 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+		initialized = true;
+	}
+
+	void GPUParticlesPass::AddEmitPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct EmitParticlesPassData
+		{
+			RGBufferReadWriteId particles;
+			RGBufferReadWriteId dead_list;
+			RGBufferReadWriteId alive_list;
+			RGBufferReadWriteId counters;
+			RGBufferReadWriteId simulate_args;
+		};
+
+		rg.AddPass<EmitParticlesPassData>("Particles Emit Pass",
+			[=](EmitParticlesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.particles = builder.WriteBuffer(RG_NAME(ParticleBuffer));
+				data.dead_list = builder.WriteBuffer(RG_NAME(ParticleDeadList));
+				data.alive_list = builder.WriteBuffer(RG_NAME(ParticleAliveListCurrent));
+				data.counters = builder.WriteBuffer(RG_NAME(ParticleCounters));
+				data.simulate_args = builder.WriteBuffer(RG_NAME(ParticleSimulateArgs));
+			},
+			[=](EmitParticlesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadWriteBuffer(data.particles),
+												ctx.GetReadWriteBuffer(data.dead_list),
+												ctx.GetReadWriteBuffer(data.alive_list),
+												ctx.GetReadWriteBuffer(data.counters),
+												ctx.GetReadWriteBuffer(data.simulate_args) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				if (!frame_emitters.empty())
+				{
+					struct EmitConstants
+					{
+						Uint32 particles_idx;
+						Uint32 dead_list_idx;
+						Uint32 alive_list_idx;
+						Uint32 counters_idx;
+						Uint32 alive_counter_offset;
+					} constants =
+					{
+						.particles_idx = i,
+						.dead_list_idx = i + 1,
+						.alive_list_idx = i + 2,
+						.counters_idx = i + 3,
+						.alive_counter_offset = 1 + current_alive_list
+					};
+					cmd_list->SetPipelineState(emit_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					//emitters only touch the shared counters atomically so their dispatches can overlap
+					for (EmitterConstants const& emitter : frame_emitters)
+					{
+						cmd_list->SetRootCBV(2, emitter);
+						cmd_list->Dispatch(DivideAndRoundUp(emitter.emit_count, 256), 1, 1);
+					}
+					cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+				}
+
+				struct BuildArgsConstants
+				{
+					Uint32 counters_idx;
+					Uint32 args_idx;
+					Uint32 current_alive_list;
+					Uint32 draw_args;
+				} constants =
+				{
+					.counters_idx = i + 3,
+					.args_idx = i + 4,
+					.current_alive_list = current_alive_list,
+					.draw_args = false
+				};
+				cmd_list->SetPipelineState(build_args_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUParticlesPass::AddSimulatePass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct SimulateParticlesPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGBufferIndirectArgsId simulate_args;
+			RGBufferReadWriteId particles;
+			RGBufferReadWriteId dead_list;
+			RGBufferReadWriteId alive_list;
+			RGBufferReadWriteId next_alive_list;
+			RGBufferReadWriteId sort_keys;
+			RGBufferReadWriteId counters;
+		};
+
+		rg.AddPass<SimulateParticlesPassData>("Particles Simulate Pass",
+			[=](SimulateParticlesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.simulate_args = builder.ReadIndirectArgsBuffer(RG_NAME(ParticleSimulateArgs));
+				data.particles = builder.WriteBuffer(RG_NAME(ParticleBuffer));
+				data.dead_list = builder.WriteBuffer(RG_NAME(ParticleDeadList));
+				data.alive_list = builder.WriteBuffer(RG_NAME(ParticleAliveListCurrent));
+				data.next_alive_list = builder.WriteBuffer(RG_NAME(ParticleAliveListNext));
+				data.sort_keys = builder.WriteBuffer(RG_NAME(ParticleSortKeys));
+				data.counters = builder.WriteBuffer(RG_NAME(ParticleCounters));
+			},
+			[=](SimulateParticlesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadOnlyTexture(data.depth),
+												ctx.GetReadOnlyTexture(data.normal),
+												ctx.GetReadWriteBuffer(data.particles),
+												ctx.GetReadWriteBuffer(data.dead_list),
+												ctx.GetReadWriteBuffer(data.alive_list),
+												ctx.GetReadWriteBuffer(data.next_alive_list),
+												ctx.GetReadWriteBuffer(data.sort_keys),
+												ctx.GetReadWriteBuffer(data.counters) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct SimulateConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 particles_idx;
+					Uint32 dead_list_idx;
+					Uint32 alive_list_idx;
+					Uint32 next_alive_list_idx;
+					Uint32 sort_keys_idx;
+					Uint32 counters_idx;
+				} constants =
+				{
+					.depth_idx = i,
+					.normal_idx = i + 1,
+					.particles_idx = i + 2,
+					.dead_list_idx = i + 3,
+					.alive_list_idx = i + 4,
+					.next_alive_list_idx = i + 5,
+					.sort_keys_idx = i + 6,
+					.counters_idx = i + 7
+				};
+				cmd_list->SetPipelineState(simulate_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->DispatchIndirect(ctx.GetIndirectArgsBuffer(data.simulate_args), 0);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct BuildDrawArgsPassData
+		{
+			RGBufferReadWriteId counters;
+			RGBufferReadWriteId draw_args;
+		};
+
+		rg.AddPass<BuildDrawArgsPassData>("Particles Build Draw Args Pass",
+			[=](BuildDrawArgsPassData& data, RenderGraphBuilder& builder)
+			{
+				data.counters = builder.WriteBuffer(RG_NAME(ParticleCounters));
+				data.draw_args = builder.WriteBuffer(RG_NAME(ParticleDrawArgs));
+			},
+			[=](BuildDrawArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadWriteBuffer(data.counters), ctx.GetReadWriteBuffer(data.draw_args) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct BuildArgsConstants
+				{
+					Uint32 counters_idx;
+					Uint32 args_idx;
+					Uint32 current_alive_list;
+					Uint32 draw_args;
+				} constants =
+				{
+					.counters_idx = i,
+					.args_idx = i + 1,
+					.current_alive_list = current_alive_list,
+					.draw_args = true
+				};
+				cmd_list->SetPipelineState(build_args_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUParticlesPass::AddSortPass(RenderGraph& rg)
+	{
+		struct SortParticlesPassData
+		{
+			RGBufferIndirectArgsId sort_args;
+			RGBufferReadWriteId alive_list;
+			RGBufferReadWriteId sort_keys;
+			RGBufferReadWriteId counters;
+		};
+
+		rg.AddPass<SortParticlesPassData>("Particles Sort Pass",
+			[=](SortParticlesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.sort_args = builder.ReadIndirectArgsBuffer(RG_NAME(ParticleDrawArgs));
+				data.alive_list = builder.WriteBuffer(RG_NAME(ParticleAliveListNext));
+				data.sort_keys = builder.WriteBuffer(RG_NAME(ParticleSortKeys));
+				data.counters = builder.WriteBuffer(RG_NAME(ParticleCounters));
+			},
+			[=](SortParticlesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadWriteBuffer(data.alive_list),
+												ctx.GetReadWriteBuffer(data.sort_keys),
+												ctx.GetReadWriteBuffer(data.counters) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct SortConstants
+				{
+					Uint32 alive_list_idx;
+					Uint32 sort_keys_idx;
+					Uint32 counters_idx;
+					Uint32 alive_counter_offset;
+					Uint32 k;
+					Uint32 j;
+				} constants =
+				{
+					.alive_list_idx = i,
+					.sort_keys_idx = i + 1,
+					.counters_idx = i + 2,
+					.alive_counter_offset = 2 - current_alive_list,
+					.k = SORT_BLOCK_SIZE,
+					.j = SORT_BLOCK_SIZE / 2
+				};
+
+				//bitonic sort over the alive count rounded up to a power of two, the args dispatch one group per block.
+				//blocks are sorted in shared memory first, merges with a stride below the block size also stay in shared memory
+				//and passes with k past the padded count return early in the shader
+				GfxBuffer const& sort_args = ctx.GetIndirectArgsBuffer(data.sort_args);
+				cmd_list->SetPipelineState(sort_initial_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->DispatchIndirect(sort_args, SORT_DISPATCH_ARGS_OFFSET);
+				for (Uint32 k = 2 * SORT_BLOCK_SIZE; k <= MAX_PARTICLES; k *= 2)
+				{
+					constants.k = k;
+					cmd_list->SetPipelineState(sort_step_pso.get());
+					for (Uint32 j = k / 2; j >= SORT_BLOCK_SIZE; j /= 2)
+					{
+						constants.j = j;
+						cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+						cmd_list->SetRootConstants(1, constants);
+						cmd_list->DispatchIndirect(sort_args, SORT_DISPATCH_ARGS_OFFSET);
+					}
+					constants.j = SORT_BLOCK_SIZE / 2;
+					cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+					cmd_list->SetPipelineState(sort_inner_pso.get());
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->DispatchIndirect(sort_args, SORT_DISPATCH_ARGS_OFFSET);
+				}
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUParticlesPass::AddDrawPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct DrawParticlesPassData
+		{
+			RGBufferIndirectArgsId draw_args;
+			RGBufferReadOnlyId particles;
+			RGBufferReadOnlyId alive_list;
+		};
+
+		rg.AddPass<DrawParticlesPassData>("Particles Draw Pass",
+			[=](DrawParticlesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.draw_args = builder.ReadIndirectArgsBuffer(RG_NAME(ParticleDrawArgs));
+				data.particles = builder.ReadBuffer(RG_NAME(ParticleBuffer), ReadAccess_NonPixelShader);
+				data.alive_list = builder.ReadBuffer(RG_NAME(ParticleAliveListNext), ReadAccess_NonPixelShader);
+				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.ReadDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=](DrawParticlesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { ctx.GetReadOnlyBuffer(data.particles), ctx.GetReadOnlyBuffer(data.alive_list) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct DrawConstants
+				{
+					Uint32 particles_idx;
+					Uint32 alive_list_idx;
+				} constants =
+				{
+					.particles_idx = i,
+					.alive_list_idx = i + 1
+				};
+				cmd_list->SetPipelineState(particle_pso.get());
+				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->DrawIndirect(ctx.GetIndirectArgsBuffer(data.draw_args), DRAW_ARGS_OFFSET);
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+}
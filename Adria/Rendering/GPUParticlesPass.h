@@ -0,0 +1,94 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Graphics/GfxDescriptor.h"
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxGraphicsPipelineState;
+	class GfxComputePipelineState;
+	class RenderGraph;
+
+	//particles of all ParticleEmitter components share one pool: emission pops indices from a dead list,
+	//simulation compacts survivors into the next alive list which is then depth sorted and drawn indirectly
+	class GPUParticlesPass
+	{
+		static constexpr Uint32 MAX_PARTICLES = 1 << 19;
+		static constexpr Uint32 SORT_BLOCK_SIZE = 1024;
+		static_assert((MAX_PARTICLES & (MAX_PARTICLES - 1)) == 0 && MAX_PARTICLES >= SORT_BLOCK_SIZE);
+
+		struct EmitterConstants
+		{
+			Vector3 position;
+			Uint32  emit_count;
+			Vector3 position_variance;
+			Float   lifetime;
+			Vector3 velocity;
+			Float   lifetime_variance;
+			Vector3 velocity_variance;
+			Float   start_size;
+			Vector4 start_color;
+			Vector4 end_color;
+			Float   end_size;
+			Float   gravity_scale;
+			Float   restitution;
+			Uint32  texture_idx;
+			Uint32  flags;
+			Uint32  seed;
+		};
+
+	public:
+		GPUParticlesPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
+		~GPUParticlesPass();
+
+		void Update(Float dt);
+		void AddPasses(RenderGraph& rg);
+		void GUI();
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+		}
+
+		Bool IsEnabled() const;
+
+	private:
+		entt::registry& reg;
+		GfxDevice* gfx;
+		Uint32 width, height;
+
+		std::unique_ptr<GfxBuffer> particle_buffer;
+		std::unique_ptr<GfxBuffer> dead_list_buffer;
+		std::unique_ptr<GfxBuffer> alive_list_buffers[2];
+		std::unique_ptr<GfxBuffer> sort_keys_buffer;
+		std::unique_ptr<GfxBuffer> counter_buffer;
+		std::unique_ptr<GfxBuffer> simulate_args_buffer;
+		std::unique_ptr<GfxBuffer> draw_args_buffer;
+		Uint32 current_alive_list = 0;
+		Bool initialized = false;
+
+		std::vector<EmitterConstants> frame_emitters;
+		Uint32 emitter_seed = 0;
+
+		std::unique_ptr<GfxGraphicsPipelineState> particle_pso;
+		std::unique_ptr<GfxComputePipelineState> init_dead_list_pso;
+		std::unique_ptr<GfxComputePipelineState> emit_pso;
+		std::unique_ptr<GfxComputePipelineState> simulate_pso;
+		std::unique_ptr<GfxComputePipelineState> build_args_pso;
+		std::unique_ptr<GfxComputePipelineState> sort_initial_pso;
+		std::unique_ptr<GfxComputePipelineState> sort_step_pso;
+		std::unique_ptr<GfxComputePipelineState> sort_inner_pso;
+
+	private:
+		void CreateBuffers();
+		void CreatePSOs();
+
+		void AddInitPass(RenderGraph& rg);
+		void AddEmitPass(RenderGraph& rg);
+		void AddSimulatePass(RenderGraph& rg);
+		void AddSortPass(RenderGraph& rg);
+		void AddDrawPass(RenderGraph& rg);
+	};
+}
@@ -0,0 +1,444 @@
+#include "GPUPrimitives.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/Random.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> GPUPrimitivesBenchmark("r.GPUPrimitives.Benchmark", false, "Run the prefix scan, stream compaction and radix sort primitives on random data every frame, timings show up in the render graph profiler");
+	static TAutoConsoleVariable<Int>  GPUPrimitivesBenchmarkSize("r.GPUPrimitives.BenchmarkSize", 1 << 20, "Number of elements the GPU primitives benchmark works on");
+
+	static constexpr Uint32 RADIX = 256;
+	static constexpr Uint32 RADIX_BITS = 8;
+
+	namespace
+	{
+		enum RadixSortPermutation : Uint32
+		{
+			RadixSortPermutation_Keys64  = 1 << 0,
+			RadixSortPermutation_Payload = 1 << 1
+		};
+
+		constexpr Uint32 GetRadixSortPermutationKey(GPURadixSortKeyType key_type, Bool payload)
+		{
+			return (key_type == GPURadixSortKeyType::Uint64 ? RadixSortPermutation_Keys64 : 0u) | (payload ? RadixSortPermutation_Payload : 0u);
+		}
+
+		//the wave size comes from the shader manager which injects it into the kernels, intel gets smaller groups for its narrower waves
+		GPUPrimitivesTuning GetVendorTuning(GfxDevice* gfx)
+		{
+			Uint32 const wave_size = ShaderManager::GetWaveSize();
+			switch (gfx->GetVendor())
+			{
+			case GfxVendor::Nvidia:
+			case GfxVendor::AMD:	return { .wave_size = wave_size, .group_size = 512, .items_per_thread = 15 };
+			default:				return { .wave_size = wave_size, .group_size = 256, .items_per_thread = 8 };
+			}
+		}
+	}
+
+	GPUPrimitives::GPUPrimitives(GfxDevice* gfx) : gfx(gfx)
+	{
+		tuning = GetVendorTuning(gfx);
+		CreatePSOs();
+	}
+
+	GPUPrimitives::~GPUPrimitives() = default;
+
+	void GPUPrimitives::AddPrefixScanPass(RenderGraph& rg, RGResourceName input, RGResourceName output, Uint32 count)
+	{
+		if (count == 0) return;
+
+		struct PrefixScanPassData
+		{
+			RGBufferReadOnlyId input;
+			RGBufferReadWriteId output;
+			RGBufferReadWriteId scan_state;
+		};
+
+		Uint32 const partition_count = DivideAndRoundUp(count, tuning.GetPartitionSize());
+		RGResourceName const scan_state_name = RG_NAME_IDX(PrefixScanState, input.hashed_name);
+		rg.AddPass<PrefixScanPassData>("Prefix Scan Pass",
+			[=](PrefixScanPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc buffer_desc{};
+				buffer_desc.resource_usage = GfxResourceUsage::Default;
+				buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				buffer_desc.stride = sizeof(Uint32);
+				if (!builder.IsBufferDeclared(output))
+				{
+					buffer_desc.size = count * sizeof(Uint32);
+					builder.DeclareBuffer(output, buffer_desc);
+				}
+				//first element hands out partition indices in launch order, the rest hold the packed status and value of every partition
+				buffer_desc.size = (partition_count + 1) * sizeof(Uint32);
+				builder.DeclareBuffer(scan_state_name, buffer_desc);
+
+				data.input = builder.ReadBuffer(input);
+				data.output = builder.WriteBuffer(output);
+				data.scan_state = builder.WriteBuffer(scan_state_name);
+			},
+			[=](PrefixScanPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.input),
+												context.GetReadWriteBuffer(data.output),
+												context.GetReadWriteBuffer(data.scan_state) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 const i = dst_handle.GetIndex();
+
+				Uint32 clear[] = { 0, 0, 0, 0 };
+				cmd_list->ClearUAV(context.GetBuffer(*data.scan_state), gfx->GetDescriptorGPU(i + 2), context.GetReadWriteBuffer(data.scan_state), clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				struct PrefixScanConstants
+				{
+					Uint32 input_idx;
+					Uint32 output_idx;
+					Uint32 scan_state_idx;
+					Uint32 count;
+					Uint32 partition_count;
+				} constants =
+				{
+					.input_idx = i, .output_idx = i + 1, .scan_state_idx = i + 2,
+					.count = count, .partition_count = partition_count
+				};
+				cmd_list->SetPipelineState(prefix_scan_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(partition_count, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUPrimitives::AddStreamCompactionPass(RenderGraph& rg, RGResourceName input, RGResourceName output, RGResourceName output_counter, Uint32 count)
+	{
+		if (count == 0) return;
+
+		struct StreamCompactionPassData
+		{
+			RGBufferReadOnlyId input;
+			RGBufferReadWriteId output;
+			RGBufferReadWriteId output_counter;
+		};
+
+		rg.AddPass<StreamCompactionPassData>("Stream Compaction Pass",
+			[=](StreamCompactionPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc buffer_desc{};
+				buffer_desc.resource_usage = GfxResourceUsage::Default;
+				buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				buffer_desc.stride = sizeof(Uint32);
+				if (!builder.IsBufferDeclared(output))
+				{
+					buffer_desc.size = count * sizeof(Uint32);
+					builder.DeclareBuffer(output, buffer_desc);
+				}
+				if (!builder.IsBufferDeclared(output_counter))
+				{
+					buffer_desc.size = sizeof(Uint32);
+					builder.DeclareBuffer(output_counter, buffer_desc);
+				}
+
+				data.input = builder.ReadBuffer(input);
+				data.output = builder.WriteBuffer(output);
+				data.output_counter = builder.WriteBuffer(output_counter);
+			},
+			[=](StreamCompactionPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.input),
+												context.GetReadWriteBuffer(data.output),
+												context.GetReadWriteBuffer(data.output_counter) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 const i = dst_handle.GetIndex();
+
+				Uint32 clear[] = { 0, 0, 0, 0 };
+				cmd_list->ClearUAV(context.GetBuffer(*data.output_counter), gfx->GetDescriptorGPU(i + 2), context.GetReadWriteBuffer(data.output_counter), clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				struct StreamCompactionConstants
+				{
+					Uint32 input_idx;
+					Uint32 output_idx;
+					Uint32 output_counter_idx;
+					Uint32 count;
+				} constants =
+				{
+					.input_idx = i, .output_idx = i + 1, .output_counter_idx = i + 2, .count = count
+				};
+				cmd_list->SetPipelineState(stream_compaction_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(count, tuning.group_size), 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUPrimitives::AddRadixSortPass(RenderGraph& rg, RGResourceName keys, RGResourceName payload, Uint32 count, GPURadixSortKeyType key_type)
+	{
+		if (count <= 1) return;
+
+		struct RadixSortPassData
+		{
+			RGBufferReadWriteId keys;
+			RGBufferReadWriteId keys_alt;
+			RGBufferReadWriteId payload;
+			RGBufferReadWriteId payload_alt;
+			RGBufferReadWriteId histogram;
+			RGBufferReadWriteId sort_state;
+		};
+
+		Bool const has_payload = payload.IsValidName();
+		Uint32 const key_size = key_type == GPURadixSortKeyType::Uint64 ? sizeof(Uint64) : sizeof(Uint32);
+		Uint32 const pass_count = key_size * 8 / RADIX_BITS;
+		Uint32 const partition_count = DivideAndRoundUp(count, tuning.GetPartitionSize());
+		Uint32 const permutation_key = GetRadixSortPermutationKey(key_type, has_payload);
+
+		RGResourceName const keys_alt_name = RG_NAME_IDX(RadixSortKeysAlt, keys.hashed_name);
+		RGResourceName const payload_alt_name = RG_NAME_IDX(RadixSortPayloadAlt, keys.hashed_name);
+		RGResourceName const histogram_name = RG_NAME_IDX(RadixSortHistogram, keys.hashed_name);
+		RGResourceName const sort_state_name = RG_NAME_IDX(RadixSortState, keys.hashed_name);
+
+		rg.AddPass<RadixSortPassData>("Radix Sort Pass",
+			[=](RadixSortPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc buffer_desc{};
+				buffer_desc.resource_usage = GfxResourceUsage::Default;
+				buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				buffer_desc.stride = key_size;
+				buffer_desc.size = Uint64(count) * key_size;
+				builder.DeclareBuffer(keys_alt_name, buffer_desc);
+
+				buffer_desc.stride = sizeof(Uint32);
+				if (has_payload)
+				{
+					buffer_desc.size = count * sizeof(Uint32);
+					builder.DeclareBuffer(payload_alt_name, buffer_desc);
+				}
+				buffer_desc.size = pass_count * RADIX * sizeof(Uint32);
+				builder.DeclareBuffer(histogram_name, buffer_desc);
+				//per digit pass a partition index counter followed by the packed status and count of every partition and digit
+				buffer_desc.size = pass_count * (partition_count * RADIX + 1) * sizeof(Uint32);
+				builder.DeclareBuffer(sort_state_name, buffer_desc);
+
+				data.keys = builder.WriteBuffer(keys);
+				data.keys_alt = builder.WriteBuffer(keys_alt_name);
+				if (has_payload)
+				{
+					data.payload = builder.WriteBuffer(payload);
+					data.payload_alt = builder.WriteBuffer(payload_alt_name);
+				}
+				data.histogram = builder.WriteBuffer(histogram_name);
+				data.sort_state = builder.WriteBuffer(sort_state_name);
+			},
+			[=](RadixSortPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadWriteBuffer(data.keys),
+												context.GetReadWriteBuffer(data.keys_alt),
+												has_payload ? context.GetReadWriteBuffer(data.payload) : context.GetReadWriteBuffer(data.keys),
+												has_payload ? context.GetReadWriteBuffer(data.payload_alt) : context.GetReadWriteBuffer(data.keys_alt),
+												context.GetReadWriteBuffer(data.histogram),
+												context.GetReadWriteBuffer(data.sort_state) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 const i = dst_handle.GetIndex();
+
+				Uint32 clear[] = { 0, 0, 0, 0 };
+				cmd_list->ClearUAV(context.GetBuffer(*data.histogram), gfx->GetDescriptorGPU(i + 4), context.GetReadWriteBuffer(data.histogram), clear);
+				cmd_list->ClearUAV(context.GetBuffer(*data.sort_state), gfx->GetDescriptorGPU(i + 5), context.GetReadWriteBuffer(data.sort_state), clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				struct RadixSortConstants
+				{
+					Uint32 keys_idx;
+					Uint32 keys_alt_idx;
+					Uint32 payload_idx;
+					Uint32 payload_alt_idx;
+					Uint32 histogram_idx;
+					Uint32 sort_state_idx;
+					Uint32 count;
+					Uint32 partition_count;
+				} constants =
+				{
+					.keys_idx = i, .keys_alt_idx = i + 1, .payload_idx = i + 2, .payload_alt_idx = i + 3,
+					.histogram_idx = i + 4, .sort_state_idx = i + 5, .count = count, .partition_count = partition_count
+				};
+				auto ApplyPermutation = [key_type, has_payload](GfxComputePipelineStatePermutations& psos)
+				{
+					if (key_type == GPURadixSortKeyType::Uint64) psos.AddDefine("KEYS_64BIT", "1");
+					if (has_payload) psos.AddDefine("PAYLOAD", "1");
+				};
+
+				//all digit histograms are built in one sweep over the keys and scanned once, so every digit pass reads the keys only once more
+				cmd_list->SetPipelineState(radix_sort_histogram_psos->Get(permutation_key, ApplyPermutation));
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(partition_count, 1, 1);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				cmd_list->SetPipelineState(radix_sort_scan_psos->Get(permutation_key, ApplyPermutation));
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(pass_count, 1, 1);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				//digit passes ping pong between the keys and the alternate buffer, the pass count is even so the result ends up in keys
+				cmd_list->SetPipelineState(radix_sort_onesweep_psos->Get(permutation_key, ApplyPermutation));
+				cmd_list->SetRootCBV(2, constants);
+				for (Uint32 pass_index = 0; pass_index < pass_count; ++pass_index)
+				{
+					cmd_list->SetRootConstant(1, pass_index, 0);
+					cmd_list->Dispatch(partition_count, 1, 1);
+					cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+				}
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void GPUPrimitives::AddBenchmarkPasses(RenderGraph& rg)
+	{
+		if (!GPUPrimitivesBenchmark.Get()) return;
+
+		Uint32 const size = (Uint32)std::clamp(GPUPrimitivesBenchmarkSize.Get(), 1024, 1 << 24);
+		if (size != benchmark_size) CreateBenchmarkBuffers(size);
+
+		rg.ImportBuffer(RG_NAME(BenchmarkSourceKeys), benchmark_keys.get());
+		rg.ImportBuffer(RG_NAME(BenchmarkSourceKeys64), benchmark_keys_64.get());
+		rg.ImportBuffer(RG_NAME(BenchmarkFlags), benchmark_flags.get());
+
+		struct BenchmarkCopyPassData
+		{
+			RGBufferCopySrcId source_keys;
+			RGBufferCopySrcId source_keys_64;
+			RGBufferCopyDstId keys;
+			RGBufferCopyDstId keys_64;
+			RGBufferCopyDstId payload;
+		};
+		//sorting is in place, so every frame starts from a fresh copy of the random keys
+		rg.AddPass<BenchmarkCopyPassData>("GPU Primitives Benchmark Copy Pass",
+			[=](BenchmarkCopyPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc buffer_desc{};
+				buffer_desc.resource_usage = GfxResourceUsage::Default;
+				buffer_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				buffer_desc.stride = sizeof(Uint32);
+				buffer_desc.size = size * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(BenchmarkKeys), buffer_desc);
+				builder.DeclareBuffer(RG_NAME(BenchmarkPayload), buffer_desc);
+				buffer_desc.stride = sizeof(Uint64);
+				buffer_desc.size = size * sizeof(Uint64);
+				builder.DeclareBuffer(RG_NAME(BenchmarkKeys64), buffer_desc);
+
+				data.source_keys = builder.ReadCopySrcBuffer(RG_NAME(BenchmarkSourceKeys));
+				data.source_keys_64 = builder.ReadCopySrcBuffer(RG_NAME(BenchmarkSourceKeys64));
+				data.keys = builder.WriteCopyDstBuffer(RG_NAME(BenchmarkKeys));
+				data.keys_64 = builder.WriteCopyDstBuffer(RG_NAME(BenchmarkKeys64));
+				data.payload = builder.WriteCopyDstBuffer(RG_NAME(BenchmarkPayload));
+			},
+			[=](BenchmarkCopyPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.keys), context.GetCopySrcBuffer(data.source_keys));
+				cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.payload), context.GetCopySrcBuffer(data.source_keys));
+				cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.keys_64), context.GetCopySrcBuffer(data.source_keys_64));
+			}, RGPassType::Copy, RGPassFlags::None);
+
+		AddPrefixScanPass(rg, RG_NAME(BenchmarkFlags), RG_NAME(BenchmarkScan), size);
+		AddStreamCompactionPass(rg, RG_NAME(BenchmarkFlags), RG_NAME(BenchmarkCompacted), RG_NAME(BenchmarkCompactedCounter), size);
+		AddRadixSortPass(rg, RG_NAME(BenchmarkKeys), RG_NAME(BenchmarkPayload), size, GPURadixSortKeyType::Uint32);
+		AddRadixSortPass(rg, RG_NAME(BenchmarkKeys64), RGResourceName{}, size, GPURadixSortKeyType::Uint64);
+
+		struct BenchmarkSinkPassData
+		{
+			RGBufferReadOnlyId scan;
+			RGBufferReadOnlyId compacted;
+			RGBufferReadOnlyId keys;
+			RGBufferReadOnlyId keys_64;
+		};
+		//nothing consumes the benchmark outputs, this keeps the primitive passes from being culled
+		rg.AddPass<BenchmarkSinkPassData>("GPU Primitives Benchmark Sink Pass",
+			[=](BenchmarkSinkPassData& data, RenderGraphBuilder& builder)
+			{
+				data.scan = builder.ReadBuffer(RG_NAME(BenchmarkScan));
+				data.compacted = builder.ReadBuffer(RG_NAME(BenchmarkCompacted));
+				data.keys = builder.ReadBuffer(RG_NAME(BenchmarkKeys));
+				data.keys_64 = builder.ReadBuffer(RG_NAME(BenchmarkKeys64));
+			},
+			[=](BenchmarkSinkPassData const&, RenderGraphContext&, GfxCommandList*) {}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+	}
+
+	void GPUPrimitives::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("GPU Primitives", 0))
+				{
+					if (tuning.wave_size > 0) ImGui::Text("Wave Size: %u, Group Size: %u, Items Per Thread: %u", tuning.wave_size, tuning.group_size, tuning.items_per_thread);
+					else ImGui::Text("Wave Size: Variable, Group Size: %u, Items Per Thread: %u", tuning.group_size, tuning.items_per_thread);
+					ImGui::Checkbox("Benchmark", GPUPrimitivesBenchmark.GetPtr());
+					if (GPUPrimitivesBenchmark.Get())
+					{
+						ImGui::SliderInt("Benchmark Size", GPUPrimitivesBenchmarkSize.GetPtr(), 1024, 1 << 24, "%d", ImGuiSliderFlags_Logarithmic);
+					}
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void GPUPrimitives::CreatePSOs()
+	{
+		std::string const group_size = std::to_string(tuning.group_size);
+		std::string const items_per_thread = std::to_string(tuning.items_per_thread);
+		auto AddTuningDefines = [&](GfxShaderKey& shader)
+		{
+			shader.AddDefine("GROUP_SIZE", group_size.c_str());
+			shader.AddDefine("ITEMS_PER_THREAD", items_per_thread.c_str());
+		};
+
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_PrefixScan;
+		AddTuningDefines(compute_pso_desc.CS);
+		prefix_scan_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = GfxShaderKey(CS_StreamCompaction);
+		AddTuningDefines(compute_pso_desc.CS);
+		stream_compaction_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = GfxShaderKey(CS_RadixSortHistogram);
+		AddTuningDefines(compute_pso_desc.CS);
+		radix_sort_histogram_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+
+		compute_pso_desc.CS = GfxShaderKey(CS_RadixSortScanHistogram);
+		AddTuningDefines(compute_pso_desc.CS);
+		radix_sort_scan_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+
+		compute_pso_desc.CS = GfxShaderKey(CS_RadixSortOnesweep);
+		AddTuningDefines(compute_pso_desc.CS);
+		radix_sort_onesweep_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+	}
+
+	void GPUPrimitives::CreateBenchmarkBuffers(Uint32 size)
+	{
+		IntRandomGenerator<Uint32> random_key(0u, UINT32_MAX);
+		std::vector<Uint32> keys(size);
+		std::vector<Uint64> keys_64(size);
+		std::vector<Uint32> flags(size);
+		for (Uint32 i = 0; i < size; ++i)
+		{
+			keys[i] = random_key();
+			keys_64[i] = (Uint64(random_key()) << 32) | keys[i];
+			flags[i] = keys[i] & 1;
+		}
+
+		gfx->WaitForGPU();
+		benchmark_keys = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(size), keys.data());
+		benchmark_keys_64 = gfx->CreateBuffer(StructuredBufferDesc<Uint64>(size), keys_64.data());
+		benchmark_flags = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(size), flags.data());
+		benchmark_size = size;
+	}
+}
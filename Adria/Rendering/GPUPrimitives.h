@@ -0,0 +1,67 @@
+#pragma once
+#include "RenderGraph/RenderGraphResourceName.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxComputePipelineState;
+	class RenderGraph;
+
+	enum class GPURadixSortKeyType : Uint8
+	{
+		Uint32,
+		Uint64
+	};
+
+	//partition layout the primitive shaders are compiled for, picked per vendor at startup. wave_size is 0 when the kernels run the generic wave path
+	struct GPUPrimitivesTuning
+	{
+		Uint32 wave_size = 32;
+		Uint32 group_size = 256;
+		Uint32 items_per_thread = 8;
+
+		Uint32 GetPartitionSize() const { return group_size * items_per_thread; }
+	};
+
+	//render graph helpers for the parallel building blocks shared by passes working on gpu generated lists.
+	//temporaries are named after the input buffer, so every input can go through each primitive once per frame
+	class GPUPrimitives
+	{
+	public:
+		explicit GPUPrimitives(GfxDevice* gfx);
+		~GPUPrimitives();
+
+		//single pass exclusive prefix sum of count Uint32 values, partitions publish their aggregates and look back at their predecessors
+		void AddPrefixScanPass(RenderGraph& rg, RGResourceName input, RGResourceName output, Uint32 count);
+		//writes the indices of the non zero Uint32 values of input to output and their number to output_counter,
+		//each wave reserves its range with a single atomic so indices are ordered within a wave but not across waves
+		void AddStreamCompactionPass(RenderGraph& rg, RGResourceName input, RGResourceName output, RGResourceName output_counter, Uint32 count);
+		//onesweep least significant digit radix sort with 8 bit digits, keys and the optional Uint32 payload are sorted in place
+		void AddRadixSortPass(RenderGraph& rg, RGResourceName keys, RGResourceName payload, Uint32 count, GPURadixSortKeyType key_type = GPURadixSortKeyType::Uint32);
+
+		void AddBenchmarkPasses(RenderGraph& rg);
+		void GUI();
+
+		GPUPrimitivesTuning const& GetTuning() const { return tuning; }
+
+	private:
+		GfxDevice* gfx;
+		GPUPrimitivesTuning tuning;
+		std::unique_ptr<GfxComputePipelineState> prefix_scan_pso;
+		std::unique_ptr<GfxComputePipelineState> stream_compaction_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> radix_sort_histogram_psos;
+		std::unique_ptr<GfxComputePipelineStatePermutations> radix_sort_scan_psos;
+		std::unique_ptr<GfxComputePipelineStatePermutations> radix_sort_onesweep_psos;
+
+		Uint32 benchmark_size = 0;
+		std::unique_ptr<GfxBuffer> benchmark_keys;
+		std::unique_ptr<GfxBuffer> benchmark_keys_64;
+		std::unique_ptr<GfxBuffer> benchmark_flags;
+
+	private:
+		void CreatePSOs();
+		void CreateBenchmarkBuffers(Uint32 size);
+	};
+}
@@ -0,0 +1,260 @@
+#include "GTAOPass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxPipelineState.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Int>   GTAOSliceCount("r.GTAO.SliceCount", 1, "Horizon slices traced per pixel per frame, 1 or 2");
+	static TAutoConsoleVariable<Int>   GTAOStepCount("r.GTAO.StepCount", 4, "Horizon search steps per slice side");
+	static TAutoConsoleVariable<Bool>  GTAOTemporal("r.GTAO.Temporal", true, "Accumulate GTAO over frames using the reprojected history");
+	static TAutoConsoleVariable<Float> GTAOHistoryWeight("r.GTAO.TemporalHistoryWeight", 0.9f, "Weight of the reprojected GTAO history");
+
+	GTAOPass::GTAOPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	{
+		CreatePSOs();
+	}
+	GTAOPass::~GTAOPass() = default;
+
+	void GTAOPass::AddPass(RenderGraph& rendergraph)
+	{
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+		Bool const temporal = GTAOTemporal.Get();
+		Uint32 const frame_index = gfx->GetFrameIndex();
+
+		struct GTAOPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGTextureReadWriteId output;
+		};
+
+		rendergraph.AddPass<GTAOPassData>("GTAO Pass",
+			[=](GTAOPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc gtao_desc{};
+				gtao_desc.format = GfxFormat::R8_UNORM;
+				gtao_desc.width = width;
+				gtao_desc.height = height;
+
+				builder.DeclareTexture(RG_NAME(GTAO_Output), gtao_desc);
+				data.output = builder.WriteTexture(RG_NAME(GTAO_Output));
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+			},
+			[=](GTAOPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadWriteTexture(data.output)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				//without the temporal resolve the slice rotation is kept fixed so the result does not flicker
+				struct GTAOConstants
+				{
+					Float  radius;
+					Float  radius_to_screen;
+					Float  falloff;
+					Float  power;
+					Uint32 slice_count;
+					Uint32 step_count;
+					Uint32 noise_index;
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 output_idx;
+				} constants =
+				{
+					.radius = params.radius, .radius_to_screen = params.radius * 0.5f * Float(height) / (tanf(frame_data.camera_fov * 0.5f) * 2.0f),
+					.falloff = params.falloff, .power = params.power,
+					.slice_count = (Uint32)std::clamp(GTAOSliceCount.Get(), 1, 2),
+					.step_count = (Uint32)std::clamp(GTAOStepCount.Get(), 1, 16),
+					.noise_index = temporal ? frame_index : 0,
+					.depth_idx = i, .normal_idx = i + 1, .output_idx = i + 2
+				};
+
+				cmd_list->SetPipelineState(gtao_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::ComputeAsync);
+
+		RGResourceName denoise_input = RG_NAME(GTAO_Output);
+		if (temporal)
+		{
+			Bool const has_velocity = rendergraph.IsTextureDeclared(RG_NAME(VelocityBuffer));
+
+			struct GTAOTemporalPassData
+			{
+				RGTextureReadOnlyId ao;
+				RGTextureReadOnlyId history;
+				RGTextureReadOnlyId depth;
+				RGTextureReadOnlyId velocity;
+				RGTextureReadWriteId output;
+				Bool history_valid;
+			};
+
+			rendergraph.AddPass<GTAOTemporalPassData>("GTAO Temporal Pass",
+				[=](GTAOTemporalPassData& data, RenderGraphBuilder& builder)
+				{
+					RGTextureDesc accumulated_desc{};
+					accumulated_desc.format = GfxFormat::R16_FLOAT;
+					accumulated_desc.width = width;
+					accumulated_desc.height = height;
+
+					data.history_valid = builder.DeclareTemporalTexture(RG_NAME(GTAO_Accumulated), RG_NAME(GTAO_History), accumulated_desc);
+					data.output = builder.WriteTexture(RG_NAME(GTAO_Accumulated));
+					data.ao = builder.ReadTexture(RG_NAME(GTAO_Output), ReadAccess_NonPixelShader);
+					data.history = builder.ReadTexture(RG_NAME(GTAO_History), ReadAccess_NonPixelShader);
+					data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+					if (has_velocity) data.velocity = builder.ReadTexture(RG_NAME(VelocityBuffer), ReadAccess_NonPixelShader);
+				},
+				[=](GTAOTemporalPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_descriptors[] =
+					{
+						ctx.GetReadOnlyTexture(data.ao),
+						ctx.GetReadOnlyTexture(data.history),
+						ctx.GetReadOnlyTexture(data.depth),
+						has_velocity ? ctx.GetReadOnlyTexture(data.velocity) : ctx.GetReadOnlyTexture(data.depth),
+						ctx.GetReadWriteTexture(data.output)
+					};
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+					Uint32 const i = dst_descriptor.GetIndex();
+
+					struct GTAOTemporalConstants
+					{
+						Uint32 ao_idx;
+						Uint32 history_idx;
+						Uint32 depth_idx;
+						Int32  velocity_idx;
+						Uint32 output_idx;
+						Float  history_weight;
+					} constants =
+					{
+						.ao_idx = i, .history_idx = i + 1, .depth_idx = i + 2,
+						.velocity_idx = has_velocity ? Int32(i + 3) : -1,
+						.output_idx = i + 4,
+						.history_weight = data.history_valid ? GTAOHistoryWeight.Get() : 0.0f
+					};
+
+					cmd_list->SetPipelineState(gtao_temporal_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+				}, RGPassType::ComputeAsync);
+
+			denoise_input = RG_NAME(GTAO_Accumulated);
+		}
+
+		struct GTAODenoisePassData
+		{
+			RGTextureReadOnlyId ao;
+			RGTextureReadOnlyId depth;
+			RGTextureReadWriteId output;
+		};
+
+		rendergraph.AddPass<GTAODenoisePassData>("GTAO Denoise Pass",
+			[=](GTAODenoisePassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc ao_desc{};
+				ao_desc.format = GfxFormat::R8_UNORM;
+				ao_desc.width = width;
+				ao_desc.height = height;
+
+				builder.DeclareTexture(RG_NAME(AmbientOcclusion), ao_desc);
+				data.output = builder.WriteTexture(RG_NAME(AmbientOcclusion));
+				data.ao = builder.ReadTexture(denoise_input, ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+			},
+			[=](GTAODenoisePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.ao),
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadWriteTexture(data.output)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct GTAODenoiseConstants
+				{
+					Uint32 ao_idx;
+					Uint32 depth_idx;
+					Uint32 output_idx;
+				} constants =
+				{
+					.ao_idx = i, .depth_idx = i + 1, .output_idx = i + 2
+				};
+
+				cmd_list->SetPipelineState(gtao_denoise_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::ComputeAsync);
+	}
+
+	void GTAOPass::OnResize(Uint32 w, Uint32 h)
+	{
+		width = w, height = h;
+	}
+
+	void GTAOPass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("GTAO", ImGuiTreeNodeFlags_None))
+				{
+					ImGui::SliderFloat("Radius", &params.radius, 0.25f, 8.0f);
+					ImGui::SliderFloat("Falloff", &params.falloff, 0.0f, 1.0f);
+					ImGui::SliderFloat("Power", &params.power, 0.5f, 4.0f);
+					ImGui::SliderInt("Slice Count", GTAOSliceCount.GetPtr(), 1, 2);
+					ImGui::SliderInt("Step Count", GTAOStepCount.GetPtr(), 1, 16);
+					ImGui::Checkbox("Temporal Accumulation", GTAOTemporal.GetPtr());
+					if (GTAOTemporal.Get())
+					{
+						ImGui::SliderFloat("History Weight", GTAOHistoryWeight.GetPtr(), 0.0f, 0.98f);
+					}
+
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_PostProcessing, GUICommandSubGroup_AO);
+	}
+
+	Bool GTAOPass::IsTemporal() const
+	{
+		return GTAOTemporal.Get();
+	}
+
+	void GTAOPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_Gtao;
+		gtao_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_GtaoTemporal;
+		gtao_temporal_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_GtaoDenoise;
+		gtao_denoise_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+}
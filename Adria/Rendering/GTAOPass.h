@@ -0,0 +1,41 @@
+#pragma once
+#include "RenderGraph/RenderGraphResourceId.h"
+
+namespace adria
+{
+	class RenderGraph;
+	class GfxDevice;
+	class GfxComputePipelineState;
+
+	//ground truth style horizon ao: one or two slices per pixel rotated every frame, accumulated
+	//into a reprojected history and filtered once with a depth aware bilateral pass
+	class GTAOPass
+	{
+		struct GTAOParams
+		{
+			Float radius = 1.5f;
+			Float falloff = 0.6f;
+			Float power = 1.5f;
+		};
+
+	public:
+		GTAOPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~GTAOPass();
+
+		void AddPass(RenderGraph& rendergraph);
+		void OnResize(Uint32 w, Uint32 h);
+		void GUI();
+		Bool IsTemporal() const;
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+		GTAOParams params{};
+		std::unique_ptr<GfxComputePipelineState> gtao_pso;
+		std::unique_ptr<GfxComputePipelineState> gtao_temporal_pso;
+		std::unique_ptr<GfxComputePipelineState> gtao_denoise_pso;
+
+	private:
+		void CreatePSOs();
+	};
+}
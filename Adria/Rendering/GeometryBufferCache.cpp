@@ -2,9 +2,12 @@
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxUploadManager.h"
 
 namespace adria
 {
+	static constexpr GfxResourceState GEOMETRY_RESIDENT_STATE = GfxResourceState::AllSRV | GfxResourceState::IndexBuffer;
+
 	void GeometryBufferCache::Initialize(GfxDevice* _gfx)
 	{
 		gfx = _gfx;
@@ -12,32 +15,56 @@ namespace adria
 
 	void GeometryBufferCache::Destroy()
 	{
-		buffer_map.clear();
+		allocation_map.clear();
+		pages.clear();
 		gfx = nullptr;
 	}
 
 	ArcGeometryBufferHandle GeometryBufferCache::CreateAndInitializeGeometryBuffer(GfxBuffer* staging_buffer, Uint64 total_buffer_size, Uint64 src_offset)
 	{
-		GfxBufferDesc desc{};
-		desc.size = total_buffer_size;
-		desc.bind_flags = GfxBindFlag::ShaderResource;
-		desc.misc_flags = GfxBufferMiscFlag::BufferRaw;
-		desc.resource_usage = GfxResourceUsage::Default;
+		GeometryAllocation geometry_allocation = AllocateGeometry(total_buffer_size);
+		GeometryPage& page = *pages[geometry_allocation.page];
+		if (staging_buffer)
+		{
+			GfxCommandList* cmd_list = gfx->GetCommandList();
+			if (page.state != GfxResourceState::CopyDst) cmd_list->BufferBarrier(*page.buffer, page.state, GfxResourceState::CopyDst);
+			cmd_list->FlushBarriers();
+			cmd_list->CopyBuffer(*page.buffer, geometry_allocation.allocation.offset, *staging_buffer, src_offset, total_buffer_size);
+			cmd_list->BufferBarrier(*page.buffer, GfxResourceState::CopyDst, GEOMETRY_RESIDENT_STATE);
+			cmd_list->FlushBarriers();
+			page.state = GEOMETRY_RESIDENT_STATE;
+		}
 
 		++current_handle;
-		buffer_map[current_handle] = gfx->CreateBuffer(desc);
-		if(staging_buffer) gfx->GetCommandList()->CopyBuffer(*buffer_map[current_handle], 0, *staging_buffer, src_offset, total_buffer_size);
-		buffer_srv_map[current_handle] = gfx->CreateBufferSRV(buffer_map[current_handle].get());
+		allocation_map[current_handle] = geometry_allocation;
+		return current_handle;
+	}
+
+	ArcGeometryBufferHandle GeometryBufferCache::CreateAndUploadGeometryBuffer(void const* data, Uint64 total_buffer_size)
+	{
+		GeometryAllocation geometry_allocation = AllocateGeometry(total_buffer_size);
+		GeometryPage& page = *pages[geometry_allocation.page];
+		gfx->GetUploadManager()->UploadBuffer(*page.buffer, data, total_buffer_size, geometry_allocation.allocation.offset, GEOMETRY_RESIDENT_STATE);
+		page.state = GEOMETRY_RESIDENT_STATE;
+
+		++current_handle;
+		allocation_map[current_handle] = geometry_allocation;
 		return current_handle;
 	}
 
 	void GeometryBufferCache::DestroyGeometryBuffer(GeometryBufferHandle& handle)
 	{
-		if (buffer_map.empty()) return;
-		if (auto it = buffer_map.find(handle); it != buffer_map.end())
+		if (allocation_map.empty()) return;
+		if (auto it = allocation_map.find(handle); it != allocation_map.end())
 		{
-			it->second = nullptr;
-			buffer_map.erase(it->first);
+			std::unique_ptr<GeometryPage>& page = pages[it->second.page];
+			page->allocator.Free(it->second.allocation);
+			if (page->allocator.Empty() && page->allocator.MaxSize() > GEOMETRY_PAGE_SIZE)
+			{
+				gfx->FreeDescriptorCPU(page->buffer_srv, GfxDescriptorHeapType::CBV_SRV_UAV);
+				page = nullptr;
+			}
+			allocation_map.erase(it);
 		}
 	}
 
@@ -45,24 +72,78 @@ namespace adria
 	{
 		if (!handle.IsValid()) return nullptr;
 
-		if (auto it = buffer_map.find(handle); it != buffer_map.end())
+		if (auto it = allocation_map.find(handle); it != allocation_map.end())
 		{
-			return it->second.get();
+			return pages[it->second.page]->buffer.get();
 		}
 		else return nullptr;
 	}
 
+	Uint64 GeometryBufferCache::GetGeometryBufferOffset(GeometryBufferHandle& handle) const
+	{
+		if (!handle.IsValid()) return 0;
+
+		if (auto it = allocation_map.find(handle); it != allocation_map.end())
+		{
+			return it->second.allocation.offset;
+		}
+		else return 0;
+	}
+
 	GfxDescriptor GeometryBufferCache::GetGeometryBufferSRV(GeometryBufferHandle& handle) const
 	{
 		if (!handle.IsValid()) return GfxDescriptor{};
 
-		if (auto it = buffer_srv_map.find(handle); it != buffer_srv_map.end())
+		if (auto it = allocation_map.find(handle); it != allocation_map.end())
 		{
-			return it->second;
+			return pages[it->second.page]->buffer_srv;
 		}
 		else return GfxDescriptor{};
 	}
 
+	Uint32 GeometryBufferCache::CreatePage(Uint64 page_size)
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::Geometry);
+		GfxBufferDesc desc{};
+		desc.size = page_size;
+		desc.bind_flags = GfxBindFlag::ShaderResource;
+		desc.misc_flags = GfxBufferMiscFlag::BufferRaw;
+		desc.resource_usage = GfxResourceUsage::Default;
+
+		std::unique_ptr<GeometryPage> page = std::make_unique<GeometryPage>(GeometryPage{ .allocator = TLSFAllocator(page_size, GEOMETRY_ALIGNMENT) });
+		page->buffer = gfx->CreateBuffer(desc);
+		page->buffer_srv = gfx->CreateBufferSRV(page->buffer.get());
+
+		for (Uint32 i = 0; i < pages.size(); ++i)
+		{
+			if (!pages[i])
+			{
+				pages[i] = std::move(page);
+				return i;
+			}
+		}
+		pages.push_back(std::move(page));
+		return (Uint32)pages.size() - 1;
+	}
+
+	GeometryBufferCache::GeometryAllocation GeometryBufferCache::AllocateGeometry(Uint64 total_buffer_size)
+	{
+		GeometryAllocation geometry_allocation{};
+		for (Uint32 i = 0; i < pages.size() && !geometry_allocation.allocation.IsValid(); ++i)
+		{
+			if (!pages[i]) continue;
+			geometry_allocation.page = i;
+			geometry_allocation.allocation = pages[i]->allocator.Allocate(total_buffer_size);
+		}
+		if (!geometry_allocation.allocation.IsValid())
+		{
+			geometry_allocation.page = CreatePage(std::max(GEOMETRY_PAGE_SIZE, Align(total_buffer_size, GEOMETRY_ALIGNMENT)));
+			geometry_allocation.allocation = pages[geometry_allocation.page]->allocator.Allocate(total_buffer_size);
+		}
+		ADRIA_ASSERT(geometry_allocation.allocation.IsValid());
+		return geometry_allocation;
+	}
+
 	GeometryBufferHandle::~GeometryBufferHandle()
 	{
 		if (IsValid()) g_GeometryBufferCache.DestroyGeometryBuffer(*this);
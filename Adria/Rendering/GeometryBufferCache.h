@@ -1,7 +1,9 @@
 #pragma once
 #include <memory>
 #include "Graphics/GfxDescriptor.h"
+#include "Graphics/GfxResourceCommon.h"
 #include "Utilities/Singleton.h"
+#include "Utilities/TLSFAllocator.h"
 
 namespace adria
 {
@@ -44,9 +46,12 @@ namespace adria
 	};
 
 
+	//all geometry is sub-allocated from a few large raw buffers so meshes share their SRVs
 	class GeometryBufferCache : public Singleton<GeometryBufferCache>
 	{
 		friend class Singleton<GeometryBufferCache>;
+		static constexpr Uint64 GEOMETRY_PAGE_SIZE = 256 * 1024 * 1024;
+		static constexpr Uint64 GEOMETRY_ALIGNMENT = 16;
 
 	public:
 
@@ -54,15 +59,35 @@ namespace adria
 		void Destroy();
 
 		ADRIA_NODISCARD ArcGeometryBufferHandle CreateAndInitializeGeometryBuffer(GfxBuffer* staging_buffer, Uint64 total_buffer_size, Uint64 src_offset);
+		//the copy goes through the upload manager and is recorded at the start of the next frame, so it can be called outside of a frame
+		ADRIA_NODISCARD ArcGeometryBufferHandle CreateAndUploadGeometryBuffer(void const* data, Uint64 total_buffer_size);
 		ADRIA_NODISCARD GfxBuffer* GetGeometryBuffer(GeometryBufferHandle& handle) const;
+		ADRIA_NODISCARD Uint64 GetGeometryBufferOffset(GeometryBufferHandle& handle) const;
 		ADRIA_NODISCARD GfxDescriptor GetGeometryBufferSRV(GeometryBufferHandle& handle) const;
 		void DestroyGeometryBuffer(GeometryBufferHandle& handle);
 
 	private:
+		struct GeometryPage
+		{
+			std::unique_ptr<GfxBuffer> buffer;
+			GfxDescriptor buffer_srv;
+			TLSFAllocator allocator;
+			GfxResourceState state = GfxResourceState::Common;
+		};
+		struct GeometryAllocation
+		{
+			Uint32 page;
+			TLSFAllocator::Allocation allocation;
+		};
+
 		GfxDevice* gfx;
 		Uint64 current_handle = INVALID_GEOMETRY_BUFFER_HANDLE;
-		std::unordered_map<Uint64, std::unique_ptr<GfxBuffer>> buffer_map;
-		std::unordered_map<Uint64, GfxDescriptor> buffer_srv_map;
+		std::vector<std::unique_ptr<GeometryPage>> pages;
+		std::unordered_map<Uint64, GeometryAllocation> allocation_map;
+
+	private:
+		Uint32 CreatePage(Uint64 page_size);
+		GeometryAllocation AllocateGeometry(Uint64 total_buffer_size);
 	};
 	#define g_GeometryBufferCache GeometryBufferCache::Get()
 }
\ No newline at end of file
@@ -8,12 +8,14 @@
 #include "Graphics/GfxPipelineState.h" 
 #include "RenderGraph/RenderGraph.h"
 #include "Logging/Logger.h"
+#include "Core/ConsoleManager.h"
 
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> GodRaysHalfResolution("r.GodRays.HalfResolution", false, "Compute god rays at half resolution, the additive composite upsamples them bilinearly");
 
 	GodRaysPass::GodRaysPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), copy_to_texture_pass(gfx, w, h)
 	{
@@ -63,6 +65,8 @@ namespace adria
 	void GodRaysPass::AddGodRaysPass(RenderGraph& rg, Light const& light)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const god_rays_width = GodRaysHalfResolution.Get() ? (width + 1) / 2 : width;
+		Uint32 const god_rays_height = GodRaysHalfResolution.Get() ? (height + 1) / 2 : height;
 
 		struct GodRaysPassData
 		{
@@ -75,8 +79,8 @@ namespace adria
 			{
 				RGTextureDesc god_rays_desc{};
 				god_rays_desc.format = GfxFormat::R16G16B16A16_FLOAT;
-				god_rays_desc.width = width;
-				god_rays_desc.height = height;
+				god_rays_desc.width = god_rays_width;
+				god_rays_desc.height = god_rays_height;
 
 				builder.DeclareTexture(RG_NAME(GodRaysOutput), god_rays_desc);
 				data.output = builder.WriteTexture(RG_NAME(GodRaysOutput));
@@ -127,7 +131,7 @@ namespace adria
 				cmd_list->SetPipelineState(god_rays_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+				cmd_list->Dispatch(DivideAndRoundUp(god_rays_width, 16), DivideAndRoundUp(god_rays_height, 16), 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
@@ -3,22 +3,30 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h" 
 #include "Graphics/GfxDevice.h"
-#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Utilities/Random.h"
 #include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> HBAOHalfResolution("r.HBAO.HalfResolution", false, "Trace HBAO at half resolution from the shared half resolution inputs and upsample it bilaterally");
 	
 	HBAOPass::HBAOPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), hbao_random_texture(nullptr),
-		blur_pass(gfx)
+		blur_pass(gfx), half_resolution_pass(gfx, w, h)
 	{
 		CreatePSO();
 	}
+	HBAOPass::~HBAOPass() = default;
 
 	void HBAOPass::AddPass(RenderGraph& rendergraph)
 	{
+		Bool const half_resolution = HBAOHalfResolution.Get();
+		if (half_resolution) half_resolution_pass.AddDownsamplePass(rendergraph, RGPassType::ComputeAsync);
+		Uint32 const hbao_width = half_resolution ? half_resolution_pass.GetHalfWidth() : width;
+		Uint32 const hbao_height = half_resolution ? half_resolution_pass.GetHalfHeight() : height;
+
 		struct HBAOPassData
 		{
 			RGTextureReadOnlyId gbuffer_normal_srv;
@@ -32,15 +40,15 @@ namespace adria
 			{
 				RGTextureDesc hbao_desc{};
 				hbao_desc.format = GfxFormat::R8_UNORM;
-				hbao_desc.width = width;
-				hbao_desc.height = height;
+				hbao_desc.width = hbao_width;
+				hbao_desc.height = hbao_height;
 
 				builder.DeclareTexture(RG_NAME(HBAO_Output), hbao_desc);
 				data.output_uav = builder.WriteTexture(RG_NAME(HBAO_Output));
-				data.gbuffer_normal_srv = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
-				data.depth_stencil_srv = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.gbuffer_normal_srv = builder.ReadTexture(half_resolution ? RG_NAME(HalfResNormal) : RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.depth_stencil_srv = builder.ReadTexture(half_resolution ? RG_NAME(HalfResDepth) : RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
 			},
-			[&](HBAOPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](HBAOPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
@@ -68,19 +76,33 @@ namespace adria
 					Uint32   output_idx;
 				} constants =
 				{
-					.r2 = params.hbao_radius * params.hbao_radius, .radius_to_screen = params.hbao_radius * 0.5f * Float(height) / (tanf(frame_data.camera_fov * 0.5f) * 2.0f),
+					.r2 = params.hbao_radius * params.hbao_radius, .radius_to_screen = params.hbao_radius * 0.5f * Float(hbao_height) / (tanf(frame_data.camera_fov * 0.5f) * 2.0f),
 					.power = params.hbao_power,
-					.noise_scale = std::max(width * 1.0f / NOISE_DIM,height * 1.0f / NOISE_DIM),
+					.noise_scale = std::max(hbao_width * 1.0f / NOISE_DIM, hbao_height * 1.0f / NOISE_DIM),
 					.depth_idx = i, .normal_idx = i + 1, .noise_idx = i + 2, .output_idx = i + 3
 				};
 
-				cmd_list->SetPipelineState(hbao_pso.get());
+				if (half_resolution) hbao_psos->AddDefine("HALF_RESOLUTION_INPUTS", "1");
+				cmd_list->SetPipelineState(hbao_psos->Get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
-			}, RGPassType::Compute);
+				cmd_list->Dispatch(DivideAndRoundUp(hbao_width, 16), DivideAndRoundUp(hbao_height, 16), 1);
+			}, RGPassType::ComputeAsync);
 
-		blur_pass.AddPass(rendergraph, RG_NAME(HBAO_Output), RG_NAME(AmbientOcclusion), " HBAO");
+		BlurBilateralInputs const bilateral
+		{
+			.depth = half_resolution ? RG_NAME(HalfResDepth) : RG_NAME(DepthStencil),
+			.normal = half_resolution ? RG_NAME(HalfResNormal) : RG_NAME(GBufferNormal)
+		};
+		if (half_resolution)
+		{
+			blur_pass.AddBilateralPass(rendergraph, RG_NAME(HBAO_Output), RG_NAME(HBAO_Blurred), bilateral, " HBAO", RGPassType::ComputeAsync);
+			half_resolution_pass.AddUpsamplePass(rendergraph, RG_NAME(HBAO_Blurred), RG_NAME(AmbientOcclusion), "HBAO", RGPassType::ComputeAsync);
+		}
+		else
+		{
+			blur_pass.AddBilateralPass(rendergraph, RG_NAME(HBAO_Output), RG_NAME(AmbientOcclusion), bilateral, " HBAO", RGPassType::ComputeAsync);
+		}
 	}
 
 	void HBAOPass::GUI()
@@ -91,6 +113,7 @@ namespace adria
 				{
 					ImGui::SliderFloat("Power", &params.hbao_power, 1.0f, 16.0f);
 					ImGui::SliderFloat("Radius", &params.hbao_radius, 0.25f, 8.0f);
+					ImGui::Checkbox("Half Resolution", HBAOHalfResolution.GetPtr());
 
 					ImGui::TreePop();
 					ImGui::Separator();
@@ -101,6 +124,7 @@ namespace adria
 	void HBAOPass::OnResize(Uint32 w, Uint32 h)
 	{
 		width = w, height = h;
+		half_resolution_pass.OnResize(w, h);
 	}
 
 	void HBAOPass::OnSceneInitialized()
@@ -141,7 +165,7 @@ namespace adria
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_Hbao;
-		hbao_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		hbao_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 	}
 
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include "BlurPass.h"
+#include "HalfResolutionPass.h"
 #include "Graphics/GfxDescriptor.h"
 #include "RenderGraph/RenderGraphResourceId.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 
 namespace adria
@@ -9,7 +11,6 @@ namespace adria
 	class RenderGraph;
 	class GfxDevice;
 	class GfxTexture;
-	class GfxComputePipelineState;
 
 	class HBAOPass
 	{
@@ -24,6 +25,7 @@ namespace adria
 
 	public:
 		HBAOPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~HBAOPass();
 		void AddPass(RenderGraph& rendergraph);
 		void OnResize(Uint32 w, Uint32 h);
 		void OnSceneInitialized();
@@ -36,7 +38,8 @@ namespace adria
 		std::unique_ptr<GfxTexture> hbao_random_texture;
 		GfxDescriptor hbao_random_texture_srv;
 		BlurPass blur_pass;
-		std::unique_ptr<GfxComputePipelineState> hbao_pso;
+		HalfResolutionPass half_resolution_pass;
+		std::unique_ptr<GfxComputePipelineStatePermutations> hbao_psos;
 
 	private:
 		void CreatePSO();
@@ -0,0 +1,220 @@
+#include "HZBPass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxPipelineState.h"
+
+#define A_CPU 1
+#include "Resources/Shaders/SPD/ffx_a.h"
+#include "Resources/Shaders/SPD/ffx_spd.h"
+
+using namespace DirectX;
+
+namespace adria
+{
+
+	HZBPass::HZBPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	{
+		CreatePSOs();
+		InitializeHZB();
+	}
+	HZBPass::~HZBPass() = default;
+
+	void HZBPass::ImportHZB(RenderGraph& rg)
+	{
+		if (!rg.IsTextureDeclared(RG_NAME(HZB))) rg.ImportTexture(RG_NAME(HZB), HZB.get());
+	}
+
+	void HZBPass::AddPasses(RenderGraph& rg, Char const* name_suffix)
+	{
+		ImportHZB(rg);
+
+		struct InitializeHZBPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadWriteId hzb;
+		};
+		std::string hzb_init_name = "HZB Init ";
+		hzb_init_name += name_suffix;
+		rg.AddPass<InitializeHZBPassData>(hzb_init_name.c_str(),
+			[=](InitializeHZBPassData& data, RenderGraphBuilder& builder)
+			{
+				data.hzb = builder.WriteTexture(RG_NAME(HZB));
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil));
+			},
+			[=](InitializeHZBPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = 
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadWriteTexture(data.hzb)
+				};
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct InitializeHZBConstants
+				{
+					Uint32 depth_idx;
+					Uint32 hzb_idx;
+					Float inv_hzb_width;
+					Float inv_hzb_height;
+				} constants =
+				{
+					.depth_idx = i,
+					.hzb_idx = i + 1,
+					.inv_hzb_width = 1.0f / hzb_width,
+					.inv_hzb_height = 1.0f / hzb_height
+				};
+				cmd_list->SetPipelineState(initialize_hzb_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(hzb_width, 16), DivideAndRoundUp(hzb_height, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+
+		struct HZBMipsPassData
+		{
+			RGBufferReadWriteId  spd_counter;
+			RGTextureReadWriteId hzb_mips[12];
+		};
+
+		Bool const declare_counter = !rg.IsBufferDeclared(RG_NAME(SPDCounter));
+		std::string hzb_mips_name = "HZB Mips ";
+		hzb_mips_name += name_suffix;
+		rg.AddPass<HZBMipsPassData>(hzb_mips_name.c_str(),
+			[=](HZBMipsPassData& data, RenderGraphBuilder& builder)
+			{
+				if (declare_counter)
+				{
+					RGBufferDesc counter_desc{};
+					counter_desc.size = sizeof(Uint32);
+					counter_desc.format = GfxFormat::R32_UINT;
+					counter_desc.stride = sizeof(Uint32);
+					builder.DeclareBuffer(RG_NAME(SPDCounter), counter_desc);
+				}
+
+				ADRIA_ASSERT(hzb_mip_count <= 12);
+				for (Uint32 i = 0; i < hzb_mip_count; ++i)
+				{
+					data.hzb_mips[i] = builder.WriteTexture(RG_NAME(HZB), i, 1);
+				}
+				data.spd_counter = builder.WriteBuffer(RG_NAME(SPDCounter));
+			},
+			[=](HZBMipsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				varAU2(dispatchThreadGroupCountXY);
+				varAU2(workGroupOffset);
+				varAU2(numWorkGroupsAndMips);
+				varAU4(rectInfo) = initAU4(0, 0, hzb_width, hzb_height);
+				Uint32 mips = hzb_mip_count;
+
+				SpdSetup(
+					dispatchThreadGroupCountXY,
+					workGroupOffset,
+					numWorkGroupsAndMips,
+					rectInfo,
+					mips - 1);
+
+				std::vector<GfxDescriptor> src_handles(hzb_mip_count + 1);
+				src_handles[0] = ctx.GetReadWriteBuffer(data.spd_counter);
+				for (Uint32 i = 0; i < hzb_mip_count; ++i) src_handles[i + 1] = ctx.GetReadWriteTexture(data.hzb_mips[i]);
+
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU((Uint32)src_handles.size());
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				GfxDescriptor counter_uav_cpu = src_handles[0];
+				GfxDescriptor counter_uav_gpu = dst_handle;
+				GfxBuffer& spd_counter = ctx.GetBuffer(*data.spd_counter);
+				Uint32 clear[] = { 0u };
+				cmd_list->ClearUAV(spd_counter, counter_uav_gpu, counter_uav_cpu, clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				struct HZBMipsConstants
+				{
+					Uint32 num_mips;
+					Uint32 num_work_groups;
+					Uint32 work_group_offset_x;
+					Uint32 work_group_offset_y;
+				} constants
+				{
+					.num_mips = numWorkGroupsAndMips[1],
+					.num_work_groups = numWorkGroupsAndMips[0],
+					.work_group_offset_x = workGroupOffset[0],
+					.work_group_offset_y = workGroupOffset[1]
+				};
+
+				DECLSPEC_ALIGN(16)
+				struct SPDIndices
+				{
+					XMUINT4	dstIdx[12];
+					Uint32	spdGlobalAtomicIdx;
+				} indices{ .spdGlobalAtomicIdx = i };
+				for (Uint32 j = 0; j < hzb_mip_count; ++j) indices.dstIdx[j].x = i + 1 + j;
+
+				cmd_list->SetPipelineState(hzb_mips_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetRootCBV(2, indices);
+				cmd_list->Dispatch(dispatchThreadGroupCountXY[0], dispatchThreadGroupCountXY[1], 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+
+		RGBlackboard& blackboard = rg.GetBlackboard();
+		if (!blackboard.TryGet<HZBBlackboardData>())
+		{
+			FrameBlackboardData const& frame_data = blackboard.Get<FrameBlackboardData>();
+			HZBBlackboardData hzb_data{};
+			hzb_data.hzb_view_projection = frame_data.camera_viewproj;
+			hzb_data.hzb_width = hzb_width;
+			hzb_data.hzb_height = hzb_height;
+			hzb_data.hzb_mip_count = hzb_mip_count;
+			blackboard.Add<HZBBlackboardData>(std::move(hzb_data));
+		}
+	}
+
+	void HZBPass::OnResize(Uint32 w, Uint32 h)
+	{
+		width = w, height = h;
+		InitializeHZB();
+	}
+
+	void HZBPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_InitializeHZB;
+		initialize_hzb_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_HZBMips;
+		hzb_mips_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void HZBPass::InitializeHZB()
+	{
+		CalculateHZBParameters();
+
+		GfxTextureDesc hzb_desc{};
+		hzb_desc.width = hzb_width;
+		hzb_desc.height = hzb_height;
+		hzb_desc.mip_levels = hzb_mip_count;
+		hzb_desc.format = GfxFormat::R32_FLOAT;
+		hzb_desc.initial_state = GfxResourceState::ComputeUAV;
+		hzb_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+
+		HZB = gfx->CreateTexture(hzb_desc);
+	}
+
+	void HZBPass::CalculateHZBParameters()
+	{
+		Uint32 mips_x = (Uint32)std::max(ceilf(log2f((Float)width)), 1.0f);
+		Uint32 mips_y = (Uint32)std::max(ceilf(log2f((Float)height)), 1.0f);
+
+		hzb_mip_count = std::max(mips_x, mips_y);
+		ADRIA_ASSERT(hzb_mip_count <= MAX_HZB_MIP_COUNT);
+		hzb_width = 1 << (mips_x - 1);
+		hzb_height = 1 << (mips_y - 1);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+namespace adria
+{
+	class RenderGraph;
+	class GfxDevice;
+	class GfxTexture;
+	class GfxComputePipelineState;
+
+	//depth pyramid of the scene depth, imported as HZB. The texture persists between frames so until it is
+	//rebuilt it holds the previous frame's depth, HZBBlackboardData is published once it was built for the current one
+	class HZBPass
+	{
+		static constexpr Uint32 MAX_HZB_MIP_COUNT = 13;
+
+	public:
+		HZBPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~HZBPass();
+
+		void ImportHZB(RenderGraph& rg);
+		void AddPasses(RenderGraph& rg, Char const* name_suffix = "");
+		void OnResize(Uint32 w, Uint32 h);
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+
+		std::unique_ptr<GfxTexture> HZB;
+		Uint32 hzb_mip_count = 0;
+		Uint32 hzb_width = 0;
+		Uint32 hzb_height = 0;
+
+		std::unique_ptr<GfxComputePipelineState> initialize_hzb_pso;
+		std::unique_ptr<GfxComputePipelineState> hzb_mips_pso;
+
+	private:
+		void CreatePSOs();
+		void InitializeHZB();
+		void CalculateHZBParameters();
+	};
+}
@@ -0,0 +1,158 @@
+#include "HalfResolutionPass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxPipelineState.h"
+#include "RenderGraph/RenderGraph.h"
+
+namespace adria
+{
+
+	HalfResolutionPass::HalfResolutionPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	{
+		CreatePSOs();
+	}
+
+	HalfResolutionPass::~HalfResolutionPass() = default;
+
+	void HalfResolutionPass::AddDownsamplePass(RenderGraph& rendergraph, RGPassType pass_type)
+	{
+		//half resolution inputs are shared by every effect that opts into half resolution, so build them only once per frame
+		if (rendergraph.IsTextureDeclared(RG_NAME(HalfResDepth))) return;
+
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const half_width = GetHalfWidth();
+		Uint32 const half_height = GetHalfHeight();
+
+		struct HalfResDownsamplePassData
+		{
+			RGTextureReadOnlyId  depth;
+			RGTextureReadOnlyId  normal;
+			RGTextureReadWriteId half_res_depth;
+			RGTextureReadWriteId half_res_normal;
+		};
+
+		rendergraph.AddPass<HalfResDownsamplePassData>("Half Resolution Downsample Pass",
+			[=](HalfResDownsamplePassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc half_res_desc{};
+				half_res_desc.width = half_width;
+				half_res_desc.height = half_height;
+				half_res_desc.format = GfxFormat::R32G32_FLOAT;
+				builder.DeclareTexture(RG_NAME(HalfResDepth), half_res_desc);
+
+				half_res_desc.format = GfxFormat::R8G8B8A8_UNORM;
+				builder.DeclareTexture(RG_NAME(HalfResNormal), half_res_desc);
+
+				data.half_res_depth = builder.WriteTexture(RG_NAME(HalfResDepth));
+				data.half_res_normal = builder.WriteTexture(RG_NAME(HalfResNormal));
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+			},
+			[=](HalfResDownsamplePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadWriteTexture(data.half_res_depth),
+					ctx.GetReadWriteTexture(data.half_res_normal)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct HalfResDownsampleConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 half_res_depth_idx;
+					Uint32 half_res_normal_idx;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .half_res_depth_idx = i + 2, .half_res_normal_idx = i + 3
+				};
+
+				cmd_list->SetPipelineState(downsample_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(half_width, 16), DivideAndRoundUp(half_height, 16), 1);
+			}, pass_type, RGPassFlags::None);
+	}
+
+	void HalfResolutionPass::AddUpsamplePass(RenderGraph& rendergraph, RGResourceName half_res_texture, RGResourceName full_res_texture, Char const* pass_name, RGPassType pass_type)
+	{
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct BilateralUpsamplePassData
+		{
+			RGTextureReadOnlyId  input;
+			RGTextureReadOnlyId  depth;
+			RGTextureReadOnlyId  half_res_depth;
+			RGTextureReadWriteId output;
+		};
+
+		std::string name = "Bilateral Upsample Pass " + std::string(pass_name);
+		rendergraph.AddPass<BilateralUpsamplePassData>(name.c_str(),
+			[=](BilateralUpsamplePassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc upsample_desc = builder.GetTextureDesc(half_res_texture);
+				upsample_desc.width = width;
+				upsample_desc.height = height;
+				builder.DeclareTexture(full_res_texture, upsample_desc);
+
+				data.output = builder.WriteTexture(full_res_texture);
+				data.input = builder.ReadTexture(half_res_texture, ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.half_res_depth = builder.ReadTexture(RG_NAME(HalfResDepth), ReadAccess_NonPixelShader);
+			},
+			[=](BilateralUpsamplePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.input),
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.half_res_depth),
+					ctx.GetReadWriteTexture(data.output)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct BilateralUpsampleConstants
+				{
+					Uint32 input_idx;
+					Uint32 depth_idx;
+					Uint32 half_res_depth_idx;
+					Uint32 output_idx;
+				} constants =
+				{
+					.input_idx = i, .depth_idx = i + 1, .half_res_depth_idx = i + 2, .output_idx = i + 3
+				};
+
+				cmd_list->SetPipelineState(upsample_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, pass_type, RGPassFlags::None);
+	}
+
+	void HalfResolutionPass::OnResize(Uint32 w, Uint32 h)
+	{
+		width = w, height = h;
+	}
+
+	void HalfResolutionPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_HalfResDownsample;
+		downsample_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_BilateralUpsample;
+		upsample_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+}
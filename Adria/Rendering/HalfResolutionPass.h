@@ -0,0 +1,34 @@
+#pragma once
+#include "RenderGraph/RenderGraphResourceName.h"
+#include "RenderGraph/RenderGraphPass.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxComputePipelineState;
+	class RenderGraph;
+
+	class HalfResolutionPass
+	{
+	public:
+		HalfResolutionPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~HalfResolutionPass();
+
+		void AddDownsamplePass(RenderGraph& rendergraph, RGPassType pass_type = RGPassType::Compute);
+		void AddUpsamplePass(RenderGraph& rendergraph, RGResourceName half_res_texture, RGResourceName full_res_texture, Char const* pass_name = "", RGPassType pass_type = RGPassType::Compute);
+
+		void OnResize(Uint32 w, Uint32 h);
+
+		Uint32 GetHalfWidth() const { return (width + 1) / 2; }
+		Uint32 GetHalfHeight() const { return (height + 1) / 2; }
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+		std::unique_ptr<GfxComputePipelineState> downsample_pso;
+		std::unique_ptr<GfxComputePipelineState> upsample_pso;
+
+	private:
+		void CreatePSOs();
+	};
+}
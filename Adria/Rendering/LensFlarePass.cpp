@@ -4,6 +4,7 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h" 
 #include "PostProcessor.h" 
+#include "OcclusionQueryPass.h"
 #include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
 #include "TextureManager.h"
@@ -48,6 +49,19 @@ namespace adria
 			auto const& light_data = lights.get<Light>(light);
 			if (!light_data.active || !light_data.lens_flare) continue;
 
+			OcclusionQueryPass* occlusion_queries = postprocessor->GetOcclusionQueryPass();
+			if (occlusion_queries && light_data.type == LightType::Directional)
+			{
+				FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+				Float const sun_distance = 0.9f * frame_data.camera_far;
+				Vector3 const sun_position = Vector3(frame_data.camera_position) - Vector3(light_data.direction) * sun_distance;
+
+				Uint32 const light_id = entt::to_integral(light);
+				Bool const sun_visible = occlusion_queries->IsVisible(OcclusionQueryGroup::Sun, light_id);
+				occlusion_queries->AddQuery(OcclusionQueryGroup::Sun, light_id, BoundingSphere(sun_position, 0.01f * sun_distance));
+				if (!sun_visible) continue;
+			}
+
 			switch (LensFlare.Get())
 			{
 			case LensFlareType_Procedural:
@@ -0,0 +1,335 @@
+#include "LightTree.h"
+#include "Components.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxUploadManager.h"
+#include "Math/Constants.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/HashUtil.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> LightTreeEnabled("r.LightTree", true, "Build a light tree for importance sampling of the scene lights in the path tracer and ReSTIR DI, uniform light selection is used otherwise");
+
+	void LightTree::LightBounds::Grow(LightBounds const& bounds)
+	{
+		if (bounds.power <= 0.0f) return;
+		if (power <= 0.0f)
+		{
+			*this = bounds;
+			return;
+		}
+		bounds_min = Vector3::Min(bounds_min, bounds.bounds_min);
+		bounds_max = Vector3::Max(bounds_max, bounds.bounds_max);
+		power += bounds.power;
+		cone = UnionCones(cone, bounds.cone);
+	}
+
+	LightTree::LightTree(GfxDevice* gfx) : gfx(gfx) {}
+
+	LightTree::~LightTree()
+	{
+		gfx->FreePersistentDescriptorGPU(nodes_buffer.buffer_srv_gpu);
+		gfx->FreePersistentDescriptorGPU(infinite_lights_buffer.buffer_srv_gpu);
+	}
+
+	void LightTree::Update(entt::registry& reg)
+	{
+		if (!LightTreeEnabled.Get())
+		{
+			Clear();
+			return;
+		}
+
+		std::vector<TreeLight> lights;
+		std::vector<Uint32> scene_infinite_lights;
+		HashState topology{}, data{};
+		for (auto&& [entity, light] : reg.view<Light>().each())
+		{
+			if (!light.active) continue;
+			if (light.type == LightType::Directional)
+			{
+				scene_infinite_lights.push_back(light.light_index);
+				topology.Combine(light.light_index);
+				continue;
+			}
+
+			LightBounds const bounds = GetLightBounds(light);
+			if (bounds.power <= 0.0f) continue;
+			topology.Combine(light.light_index);
+			topology.Combine((Int32)light.type);
+			data.Combine(bounds.bounds_min.x); data.Combine(bounds.bounds_min.y); data.Combine(bounds.bounds_min.z);
+			data.Combine(bounds.cone.axis.x); data.Combine(bounds.cone.axis.y); data.Combine(bounds.cone.axis.z);
+			data.Combine(bounds.cone.cos_theta_e);
+			data.Combine(bounds.power);
+			lights.push_back(TreeLight{ bounds, bounds.bounds_min, light.light_index });
+		}
+
+		Bool const rebuild = topology != topology_hash || lights.size() != tree_lights.size() || scene_infinite_lights.size() != infinite_lights.size();
+		if (rebuild)
+		{
+			tree_lights = std::move(lights);
+			infinite_lights = std::move(scene_infinite_lights);
+			Build();
+			Upload(nodes, nodes_buffer);
+			Upload(infinite_lights, infinite_lights_buffer);
+		}
+		else if (data != data_hash)
+		{
+			//same lights in the same order, only their bounds changed so the topology is kept
+			std::sort(lights.begin(), lights.end(), [](TreeLight const& a, TreeLight const& b) { return a.light_index < b.light_index; });
+			for (TreeLight& tree_light : tree_lights)
+			{
+				auto it = std::lower_bound(lights.begin(), lights.end(), tree_light.light_index, [](TreeLight const& light, Uint32 index) { return light.light_index < index; });
+				ADRIA_ASSERT(it != lights.end() && it->light_index == tree_light.light_index);
+				tree_light = *it;
+			}
+			Refit();
+			Upload(nodes, nodes_buffer);
+		}
+		topology_hash = topology;
+		data_hash = data;
+	}
+
+	void LightTree::Clear()
+	{
+		tree_lights.clear();
+		nodes.clear();
+		node_bounds.clear();
+		node_lights.clear();
+		infinite_lights.clear();
+		topology_hash = 0;
+		data_hash = 0;
+	}
+
+	void LightTree::Build()
+	{
+		nodes.clear();
+		node_bounds.clear();
+		node_lights.clear();
+		if (tree_lights.empty()) return;
+
+		Uint64 const max_node_count = 2 * tree_lights.size() - 1;
+		nodes.reserve(max_node_count);
+		node_bounds.reserve(max_node_count);
+		node_lights.reserve(max_node_count);
+		BuildNode(0, (Uint32)tree_lights.size());
+	}
+
+	//children are always stored after their parent, walking the nodes backwards updates both children before the parent
+	void LightTree::Refit()
+	{
+		for (Uint32 i = (Uint32)nodes.size(); i-- > 0;)
+		{
+			LightBounds bounds;
+			if (node_lights[i] != INVALID_NODE)
+			{
+				bounds = tree_lights[node_lights[i]].bounds;
+			}
+			else
+			{
+				bounds = node_bounds[i + 1];
+				bounds.Grow(node_bounds[nodes[i].child_or_light_index]);
+			}
+			WriteNode(i, bounds);
+		}
+	}
+
+	Uint32 LightTree::BuildNode(Uint32 first, Uint32 count)
+	{
+		Uint32 const node_index = (Uint32)nodes.size();
+		nodes.emplace_back();
+		node_bounds.emplace_back();
+		node_lights.push_back(INVALID_NODE);
+		if (count == 1)
+		{
+			node_lights[node_index] = first;
+			nodes[node_index].is_leaf = true;
+			nodes[node_index].child_or_light_index = tree_lights[first].light_index;
+			WriteNode(node_index, tree_lights[first].bounds);
+			return node_index;
+		}
+
+		LightBounds bounds;
+		Vector3 centroid_min(FLT_MAX), centroid_max(-FLT_MAX);
+		for (Uint32 i = first; i < first + count; ++i)
+		{
+			bounds.Grow(tree_lights[i].bounds);
+			centroid_min = Vector3::Min(centroid_min, tree_lights[i].centroid);
+			centroid_max = Vector3::Max(centroid_max, tree_lights[i].centroid);
+		}
+		Vector3 const extent = bounds.bounds_max - bounds.bounds_min;
+		Vector3 const centroid_extent = centroid_max - centroid_min;
+
+		//binned surface area orientation heuristic, every axis is tried since the orientation term differs per axis
+		Float best_cost = FLT_MAX;
+		Uint32 best_axis = 0, best_bin = 0;
+		for (Uint32 axis = 0; axis < 3; ++axis)
+		{
+			Float const axis_extent = (&centroid_extent.x)[axis];
+			if (axis_extent <= 0.0f) continue;
+			Float const axis_min = (&centroid_min.x)[axis];
+			Float const bin_scale = SAOH_BIN_COUNT / axis_extent;
+
+			LightBounds bin_bounds[SAOH_BIN_COUNT];
+			for (Uint32 i = first; i < first + count; ++i)
+			{
+				Uint32 const bin = std::min((Uint32)(((&tree_lights[i].centroid.x)[axis] - axis_min) * bin_scale), SAOH_BIN_COUNT - 1);
+				bin_bounds[bin].Grow(tree_lights[i].bounds);
+			}
+
+			Float left_costs[SAOH_BIN_COUNT - 1];
+			LightBounds left_bounds;
+			for (Uint32 bin = 0; bin < SAOH_BIN_COUNT - 1; ++bin)
+			{
+				left_bounds.Grow(bin_bounds[bin]);
+				left_costs[bin] = EvaluateCost(left_bounds, extent, axis);
+			}
+			LightBounds right_bounds;
+			for (Uint32 bin = SAOH_BIN_COUNT - 1; bin > 0; --bin)
+			{
+				right_bounds.Grow(bin_bounds[bin]);
+				if (left_costs[bin - 1] == FLT_MAX || right_bounds.power <= 0.0f) continue;
+				Float const cost = left_costs[bin - 1] + EvaluateCost(right_bounds, extent, axis);
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_bin = bin;
+				}
+			}
+		}
+
+		auto const begin = tree_lights.begin() + first;
+		auto const end = begin + count;
+		Uint32 split = first + count / 2;
+		if (best_bin > 0)
+		{
+			Float const axis_min = (&centroid_min.x)[best_axis];
+			Float const bin_scale = SAOH_BIN_COUNT / (&centroid_extent.x)[best_axis];
+			auto const middle = std::partition(begin, end, [&](TreeLight const& light)
+				{
+					return std::min((Uint32)(((&light.centroid.x)[best_axis] - axis_min) * bin_scale), SAOH_BIN_COUNT - 1) < best_bin;
+				});
+			split = first + (Uint32)(middle - begin);
+		}
+
+		BuildNode(first, split - first);
+		Uint32 const second_child = BuildNode(split, first + count - split);
+		nodes[node_index].child_or_light_index = second_child;
+		WriteNode(node_index, bounds);
+		return node_index;
+	}
+
+	void LightTree::WriteNode(Uint32 node_index, LightBounds const& bounds)
+	{
+		node_bounds[node_index] = bounds;
+		LightTreeNodeGPU& node = nodes[node_index];
+		node.bounds_min = bounds.bounds_min;
+		node.bounds_max = bounds.bounds_max;
+		node.power = bounds.power;
+		node.cone_axis = bounds.cone.axis;
+		node.cos_theta_o = bounds.cone.cos_theta_o;
+		node.cos_theta_e = bounds.cone.cos_theta_e;
+	}
+
+	template<typename T>
+	void LightTree::Upload(std::vector<T> const& data, TreeBuffer& tree_buffer)
+	{
+		if (data.empty()) return;
+		if (!tree_buffer.buffer || tree_buffer.buffer->GetCount() < data.size())
+		{
+			tree_buffer.buffer = gfx->CreateBuffer(StructuredBufferDesc<T>(data.size(), false, false));
+			tree_buffer.buffer_srv = gfx->CreateBufferSRV(tree_buffer.buffer.get());
+			gfx->FreePersistentDescriptorGPU(tree_buffer.buffer_srv_gpu);
+			tree_buffer.buffer_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+			gfx->CopyDescriptors(1, tree_buffer.buffer_srv_gpu, tree_buffer.buffer_srv);
+		}
+		gfx->GetUploadManager()->UploadBuffer(*tree_buffer.buffer, data.data(), data.size() * sizeof(T));
+	}
+
+	//point lights emit in every direction, spot lights around their direction up to the outer cone
+	LightTree::LightBounds LightTree::GetLightBounds(Light const& light)
+	{
+		LightBounds bounds{};
+		bounds.bounds_min = bounds.bounds_max = Vector3(light.position);
+		Float const intensity = Vector3(light.color).Dot(Vector3(0.2126f, 0.7152f, 0.0722f)) * light.intensity;
+		bounds.cone.empty = false;
+		if (light.type == LightType::Spot)
+		{
+			Vector3 axis(light.direction);
+			axis.Normalize();
+			bounds.cone.axis = axis;
+			bounds.cone.cos_theta_o = 1.0f;
+			bounds.cone.cos_theta_e = light.outer_cosine;
+			Float const cos_inner = std::max(light.inner_cosine, light.outer_cosine);
+			bounds.power = pi_times_2<Float> * intensity * ((1.0f - cos_inner) + (cos_inner - light.outer_cosine) / 2.0f);
+		}
+		else
+		{
+			bounds.cone.cos_theta_o = -1.0f;
+			bounds.cone.cos_theta_e = 0.0f;
+			bounds.power = pi_times_4<Float> * intensity;
+		}
+		return bounds;
+	}
+
+	LightTree::LightCone LightTree::UnionCones(LightCone const& a, LightCone const& b)
+	{
+		if (a.empty) return b;
+		if (b.empty) return a;
+
+		LightCone cone{};
+		cone.empty = false;
+		cone.cos_theta_e = std::min(a.cos_theta_e, b.cos_theta_e);
+
+		Float const theta_a = std::acos(std::clamp(a.cos_theta_o, -1.0f, 1.0f));
+		Float const theta_b = std::acos(std::clamp(b.cos_theta_o, -1.0f, 1.0f));
+		Float const theta_d = std::acos(std::clamp(a.axis.Dot(b.axis), -1.0f, 1.0f));
+		if (std::min(theta_d + theta_b, pi<Float>) <= theta_a)
+		{
+			cone.axis = a.axis;
+			cone.cos_theta_o = a.cos_theta_o;
+			return cone;
+		}
+		if (std::min(theta_d + theta_a, pi<Float>) <= theta_b)
+		{
+			cone.axis = b.axis;
+			cone.cos_theta_o = b.cos_theta_o;
+			return cone;
+		}
+
+		Float const theta_o = (theta_a + theta_d + theta_b) / 2.0f;
+		Vector3 rotation_axis = a.axis.Cross(b.axis);
+		if (theta_o >= pi<Float> || rotation_axis.LengthSquared() < 1e-12f)
+		{
+			cone.axis = a.axis;
+			cone.cos_theta_o = -1.0f;
+			return cone;
+		}
+		rotation_axis.Normalize();
+		cone.axis = Vector3::TransformNormal(a.axis, Matrix::CreateFromAxisAngle(rotation_axis, theta_o - theta_a));
+		cone.axis.Normalize();
+		cone.cos_theta_o = std::cos(theta_o);
+		return cone;
+	}
+
+	//power times the orientation measure times the surface area, stretched boxes are penalized when split along their short axes
+	Float LightTree::EvaluateCost(LightBounds const& bounds, Vector3 const& node_extent, Uint32 axis)
+	{
+		if (bounds.power <= 0.0f) return FLT_MAX;
+		Float const theta_o = std::acos(std::clamp(bounds.cone.cos_theta_o, -1.0f, 1.0f));
+		Float const theta_e = std::acos(std::clamp(bounds.cone.cos_theta_e, -1.0f, 1.0f));
+		Float const theta_w = std::min(theta_o + theta_e, pi<Float>);
+		Float const sin_theta_o = std::sqrt(std::max(0.0f, 1.0f - bounds.cone.cos_theta_o * bounds.cone.cos_theta_o));
+		Float const m_omega = pi_times_2<Float> * (1.0f - bounds.cone.cos_theta_o) +
+			pi_div_2<Float> * (2.0f * theta_w * sin_theta_o - std::cos(theta_o - 2.0f * theta_w) - 2.0f * theta_o * sin_theta_o + bounds.cone.cos_theta_o);
+
+		Float const axis_extent = (&node_extent.x)[axis];
+		Float const kr = axis_extent > 0.0f ? std::max({ node_extent.x, node_extent.y, node_extent.z }) / axis_extent : 1.0f;
+		Vector3 const d = bounds.bounds_max - bounds.bounds_min;
+		//a small area keeps coincident lights comparable instead of all costing nothing
+		Float const area = 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x) + 1e-4f;
+		return bounds.power * m_omega * kr * area;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "ShaderStructs.h"
+#include "Graphics/GfxDescriptor.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	struct Light;
+
+	//bounding volume hierarchy over the local lights of the scene for importance sampling of one light out of many (Conty Estevez and Kulla, "Importance Sampling of Many Lights with Adaptive Tree Splitting").
+	//nodes store the world space bounds, the total power and the orientation cone of their lights, directional lights are kept in a separate list and sampled uniformly.
+	//the tree is rebuilt when the set of lights changes, refitted when lights move and not uploaded at all while the lights are static
+	class LightTree
+	{
+		static constexpr Uint32 SAOH_BIN_COUNT = 12;
+		static constexpr Uint32 INVALID_NODE = UINT32_MAX;
+
+		struct LightCone
+		{
+			Vector3 axis = Vector3(0.0f, 0.0f, 1.0f);
+			Float cos_theta_o = 1.0f;
+			Float cos_theta_e = 1.0f;
+			Bool empty = true;
+		};
+		struct LightBounds
+		{
+			Vector3 bounds_min = Vector3(FLT_MAX);
+			Vector3 bounds_max = Vector3(-FLT_MAX);
+			Float power = 0.0f;
+			LightCone cone;
+
+			void Grow(LightBounds const& bounds);
+		};
+		struct TreeLight
+		{
+			LightBounds bounds;
+			Vector3 centroid;
+			Uint32 light_index;
+		};
+		struct TreeBuffer
+		{
+			std::unique_ptr<GfxBuffer> buffer;
+			GfxDescriptor buffer_srv;
+			GfxDescriptor buffer_srv_gpu;
+		};
+
+	public:
+		explicit LightTree(GfxDevice* gfx);
+		ADRIA_NONCOPYABLE_NONMOVABLE(LightTree)
+		~LightTree();
+
+		//light_index of the lights has to be assigned already, the tree refers to the lights in the scene light buffer
+		void Update(entt::registry& reg);
+		void Clear();
+
+		Int32 GetNodesIndex() const { return nodes.empty() ? -1 : (Int32)nodes_buffer.buffer_srv_gpu.GetIndex(); }
+		Int32 GetInfiniteLightsIndex() const { return infinite_lights.empty() ? -1 : (Int32)infinite_lights_buffer.buffer_srv_gpu.GetIndex(); }
+		Uint32 GetInfiniteLightCount() const { return (Uint32)infinite_lights.size(); }
+		Uint32 GetNodeCount() const { return (Uint32)nodes.size(); }
+
+	private:
+		GfxDevice* gfx;
+		std::vector<TreeLight> tree_lights;
+		std::vector<LightTreeNodeGPU> nodes;
+		std::vector<Uint32> infinite_lights;
+		//bounds of every node and the tree light of every leaf, used for refitting
+		std::vector<LightBounds> node_bounds;
+		std::vector<Uint32> node_lights;
+		Uint64 topology_hash = 0;
+		Uint64 data_hash = 0;
+
+		TreeBuffer nodes_buffer;
+		TreeBuffer infinite_lights_buffer;
+
+	private:
+		void Build();
+		void Refit();
+		Uint32 BuildNode(Uint32 first, Uint32 count);
+		void WriteNode(Uint32 node_index, LightBounds const& bounds);
+
+		template<typename T>
+		void Upload(std::vector<T> const& data, TreeBuffer& tree_buffer);
+
+		static LightBounds GetLightBounds(Light const& light);
+		static LightCone UnionCones(LightCone const& a, LightCone const& b);
+		static Float EvaluateCost(LightBounds const& bounds, Vector3 const& node_extent, Uint32 axis);
+	};
+}
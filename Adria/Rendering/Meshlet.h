@@ -4,24 +4,31 @@ namespace adria
 {
 	static constexpr Uint64 MESHLET_MAX_TRIANGLES = 124;
 	static constexpr Uint64 MESHLET_MAX_VERTICES = 64;
+	static constexpr Uint32 MESHLET_CULL_GROUP_SIZE = 32;
+	static_assert(MESHLET_MAX_VERTICES <= 256, "Meshlet triangles use 8-bit local vertex indices");
 
-	struct MeshletTriangle
-	{
-		Uint32 V0 : 10;
-		Uint32 V1 : 10;
-		Uint32 V2 : 10;
-		Uint32	  : 2;
-	};
-
+	//meshlet triangles are stored as 3 8-bit local vertex indices per triangle, each meshlet padded to 4 bytes
 	struct Meshlet
 	{
-		Float center[3];
-		Float radius;
+		Uint16 center[3];		 //unorm16 within the submesh bounding box
+		Uint16 radius;			 //fp16, rounded up to stay conservative
 
-		Uint32 vertex_count;
-		Uint32 triangle_count;
+		Uint32 cone_axis_cutoff; //snorm8 axis.xyz, snorm8 cutoff
 
 		Uint32 vertex_offset;
-		Uint32 triangle_offset;
+		Uint32 triangle_offset;  //in bytes
+
+		Uint16 vertex_count;
+		Uint16 triangle_count;
+	};
+
+	//cluster lod hierarchy: a meshlet is part of the cut when its own error is below the threshold and its parent's is not,
+	//errors and bounds are monotonic up the hierarchy so the test can run for every meshlet independently
+	struct MeshletLOD
+	{
+		Float self_bounds[4];	//center, radius of the group the meshlet was simplified from
+		Float parent_bounds[4];	//center, radius of the group the meshlet was simplified into
+		Float self_error;
+		Float parent_error;		//FLT_MAX for root meshlets
 	};
 }
\ No newline at end of file
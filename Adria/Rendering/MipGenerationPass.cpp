@@ -0,0 +1,108 @@
+#include "MipGenerationPass.h"
+#include "ShaderManager.h"
+#include "TextureManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxPipelineState.h"
+#include "RenderGraph/RenderGraph.h"
+
+namespace adria
+{
+
+	MipGenerationPass::MipGenerationPass(GfxDevice* gfx) : gfx(gfx)
+	{
+		CreatePSOs();
+	}
+
+	MipGenerationPass::~MipGenerationPass() = default;
+
+	void MipGenerationPass::AddPass(RenderGraph& rg)
+	{
+		std::vector<TextureManager::MipGenerationRequest> requests = g_TextureManager.ConsumeMipGenerationRequests();
+		if (requests.empty()) return;
+
+		rg.AddPass<void>("Texture Mip Generation Pass",
+			[=](RenderGraphBuilder& builder)
+			{
+			},
+			[=, this, requests = std::move(requests)](RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				Uint32 max_mip_levels = 0;
+				for (TextureManager::MipGenerationRequest const& request : requests)
+				{
+					if (request.state != GfxResourceState::AllSRV) cmd_list->TextureBarrier(*request.texture, request.state, GfxResourceState::AllSRV);
+					max_mip_levels = std::max(max_mip_levels, request.texture->GetDesc().mip_levels);
+				}
+
+				//every texture in the batch advances one mip per step so the dispatches of a step can overlap
+				cmd_list->SetPipelineState(generate_mips_pso.get());
+				for (Uint32 mip = 1; mip < max_mip_levels; ++mip)
+				{
+					for (TextureManager::MipGenerationRequest const& request : requests)
+					{
+						if (mip < request.texture->GetDesc().mip_levels) cmd_list->TextureBarrier(*request.texture, GfxResourceState::AllSRV, GfxResourceState::ComputeUAV, mip);
+					}
+					cmd_list->FlushBarriers();
+
+					for (TextureManager::MipGenerationRequest const& request : requests)
+					{
+						GfxTexture const& texture = *request.texture;
+						GfxTextureDesc const& desc = texture.GetDesc();
+						if (mip >= desc.mip_levels) continue;
+
+						GfxTextureDescriptorDesc src_desc{};
+						src_desc.first_mip = mip - 1;
+						src_desc.mip_count = 1;
+						GfxTextureDescriptorDesc dst_desc{};
+						dst_desc.first_mip = mip;
+						dst_desc.mip_count = 1;
+
+						GfxDescriptor src_handles[] = { gfx->CreateTextureSRV(&texture, &src_desc), gfx->CreateTextureUAV(&texture, &dst_desc) };
+						GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+						gfx->CopyDescriptors(dst_handle, src_handles);
+						for (GfxDescriptor const& src_handle : src_handles) gfx->FreeDescriptorCPU(src_handle, GfxDescriptorHeapType::CBV_SRV_UAV);
+						Uint32 const i = dst_handle.GetIndex();
+
+						Uint32 const dst_width = std::max(desc.width >> mip, 1u);
+						Uint32 const dst_height = std::max(desc.height >> mip, 1u);
+						struct GenerateMipsConstants
+						{
+							Uint32 dst_width;
+							Uint32 dst_height;
+							Float  inv_dst_width;
+							Float  inv_dst_height;
+							Uint32 src_idx;
+							Uint32 dst_idx;
+							Uint32 is_srgb;
+						} constants
+						{
+							.dst_width = dst_width,
+							.dst_height = dst_height,
+							.inv_dst_width = 1.0f / dst_width,
+							.inv_dst_height = 1.0f / dst_height,
+							.src_idx = i,
+							.dst_idx = i + 1,
+							.is_srgb = texture.IsSRGB()
+						};
+						cmd_list->SetRootConstants(1, constants);
+						cmd_list->Dispatch(DivideAndRoundUp(dst_width, 8u), DivideAndRoundUp(dst_height, 8u), 1);
+					}
+
+					for (TextureManager::MipGenerationRequest const& request : requests)
+					{
+						if (mip < request.texture->GetDesc().mip_levels) cmd_list->TextureBarrier(*request.texture, GfxResourceState::ComputeUAV, GfxResourceState::AllSRV, mip);
+					}
+				}
+				cmd_list->FlushBarriers();
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+	}
+
+	void MipGenerationPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_GenerateMips;
+		generate_mips_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxComputePipelineState;
+	class RenderGraph;
+
+	class MipGenerationPass
+	{
+	public:
+		explicit MipGenerationPass(GfxDevice* gfx);
+		~MipGenerationPass();
+
+		void AddPass(RenderGraph& rendergraph);
+
+	private:
+		GfxDevice* gfx;
+		std::unique_ptr<GfxComputePipelineState> generate_mips_pso;
+
+	private:
+		void CreatePSOs();
+	};
+}
@@ -8,14 +8,16 @@
 #include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "entt/entity/registry.hpp"
 
 namespace adria
 {
-	MotionVectorsPass::MotionVectorsPass(GfxDevice* gfx, Uint32 w, Uint32 h)
-		: gfx(gfx), width(w), height(h)
+	MotionVectorsPass::MotionVectorsPass(GfxDevice* gfx, entt::registry& reg, Uint32 w, Uint32 h)
+		: gfx(gfx), reg(reg), width(w), height(h)
 	{
 		CreatePSO();
 	}
+	MotionVectorsPass::~MotionVectorsPass() = default;
 
 	Bool MotionVectorsPass::IsEnabled(PostProcessor const* postprocessor) const
 	{
@@ -69,6 +71,8 @@ namespace adria
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute, RGPassFlags::None);
+
+		AddDynamicObjectsPass(rg);
 	}
 
 	void MotionVectorsPass::OnResize(Uint32 w, Uint32 h)
@@ -81,6 +85,54 @@ namespace adria
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_MotionVectors;
 		motion_vectors_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
+		gfx_pso_desc.root_signature = GfxRootSignatureID::Common;
+		gfx_pso_desc.VS = VS_MotionVectorsDynamic;
+		gfx_pso_desc.PS = PS_MotionVectorsDynamic;
+		gfx_pso_desc.depth_state.depth_enable = true;
+		gfx_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::Zero;
+		gfx_pso_desc.depth_state.depth_func = GfxComparisonFunc::GreaterEqual;
+		gfx_pso_desc.num_render_targets = 1;
+		gfx_pso_desc.rtv_formats[0] = GfxFormat::R16G16_FLOAT;
+		gfx_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
+		dynamic_motion_vectors_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
+	}
+
+	void MotionVectorsPass::AddDynamicObjectsPass(RenderGraph& rg)
+	{
+		std::vector<Batch const*> dynamic_batches;
+		for (auto batch_entity : reg.view<Batch>())
+		{
+			Batch const& batch = reg.get<Batch>(batch_entity);
+			if (batch.dynamic && batch.camera_visibility) dynamic_batches.push_back(&batch);
+		}
+		if (dynamic_batches.empty()) return;
+
+		//static pixels keep the camera reprojection, moved instances are rasterized on top with their previous transform
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		rg.AddPass<void>("Dynamic Objects Velocity Pass",
+			[=](RenderGraphBuilder& builder)
+			{
+				builder.WriteRenderTarget(RG_NAME(VelocityBuffer), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.ReadDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=, dynamic_batches = std::move(dynamic_batches)](RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				cmd_list->SetPipelineState(dynamic_motion_vectors_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				for (Batch const* batch : dynamic_batches)
+				{
+					struct DynamicMotionVectorsConstants
+					{
+						Uint32 instance_id;
+					} constants{ .instance_id = batch->instance_id };
+					cmd_list->SetRootConstants(1, constants);
+
+					DrawSubMeshLOD(cmd_list, *batch->submesh, batch->lod);
+				}
+			}, RGPassType::Graphics, RGPassFlags::None);
 	}
 
 }
@@ -1,16 +1,19 @@
 #pragma once
 #include "PostEffect.h"
+#include "entt/entity/fwd.hpp"
 
 namespace adria
 {
 	class GfxDevice;
 	class GfxComputePipelineState;
+	class GfxGraphicsPipelineState;
 	class RenderGraph;
 
 	class MotionVectorsPass : public PostEffect
 	{
 	public:
-		MotionVectorsPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		MotionVectorsPass(GfxDevice* gfx, entt::registry& reg, Uint32 w, Uint32 h);
+		~MotionVectorsPass();
 
 		virtual Bool IsEnabled(PostProcessor const*) const override;
 		virtual void AddPass(RenderGraph& rg, PostProcessor*) override;
@@ -18,10 +21,13 @@ namespace adria
 
 	private:
 		GfxDevice* gfx;
+		entt::registry& reg;
 		Uint32 width, height;
 		std::unique_ptr<GfxComputePipelineState> motion_vectors_pso;
+		std::unique_ptr<GfxGraphicsPipelineState> dynamic_motion_vectors_pso;
 
 	private:
 		void CreatePSO();
+		void AddDynamicObjectsPass(RenderGraph& rg);
 	};
 }
\ No newline at end of file
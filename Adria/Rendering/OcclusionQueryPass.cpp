@@ -0,0 +1,206 @@
+#include "OcclusionQueryPass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
+#include "Graphics/GfxReadbackQueue.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> OcclusionQueries("r.OcclusionQueries", true, "Test lights, decals, the sun and CPU driven batches against the HZB and skip the occluded ones");
+
+	static Uint64 GetQueryKey(OcclusionQueryGroup group, Uint32 id)
+	{
+		return ((Uint64)group << 32) | id;
+	}
+
+	OcclusionQueryPass::OcclusionQueryPass(GfxDevice* gfx) : gfx(gfx)
+	{
+		CreatePSO();
+	}
+	OcclusionQueryPass::~OcclusionQueryPass() = default;
+
+	Uint32 OcclusionQueryPass::AddQuery(OcclusionQueryGroup group, Uint32 id, BoundingBox const& box)
+	{
+		return AddQuery(group, id, OcclusionQueryBounds{ .center = box.Center, .is_sphere = false, .extents = box.Extents, .radius = 0.0f });
+	}
+
+	Uint32 OcclusionQueryPass::AddQuery(OcclusionQueryGroup group, Uint32 id, BoundingSphere const& sphere)
+	{
+		return AddQuery(group, id, OcclusionQueryBounds{ .center = sphere.Center, .is_sphere = true, .extents = Vector3(sphere.Radius), .radius = sphere.Radius });
+	}
+
+	Bool OcclusionQueryPass::IsVisible(OcclusionQueryGroup group, Uint32 id) const
+	{
+		if (!IsEnabled()) return true;
+		auto it = results.find(GetQueryKey(group, id));
+		if (it == results.end() || frame_index - it->second.frame > MAX_RESULT_AGE) return true;
+		return it->second.visible;
+	}
+
+	void OcclusionQueryPass::AddPass(RenderGraph& rg)
+	{
+		++frame_index;
+		std::erase_if(results, [this](auto const& result) { return frame_index - result.second.frame > MAX_RESULT_AGE; });
+
+		HZBBlackboardData const* hzb_data = rg.GetBlackboard().TryGet<HZBBlackboardData>();
+		if (!IsEnabled() || !hzb_data || query_bounds.empty())
+		{
+			query_bounds.clear();
+			query_keys.clear();
+			return;
+		}
+
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		HZBBlackboardData const hzb = *hzb_data;
+		std::vector<OcclusionQueryBounds> bounds = std::move(query_bounds);
+		std::vector<Uint64> keys = std::move(query_keys);
+		query_bounds.clear();
+		query_keys.clear();
+		Uint32 const query_count = (Uint32)bounds.size();
+
+		struct OcclusionQueryUploadPassData
+		{
+			RGBufferCopyDstId bounds;
+		};
+		rg.AddPass<OcclusionQueryUploadPassData>("Occlusion Query Upload Pass",
+			[=](OcclusionQueryUploadPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc bounds_desc{};
+				bounds_desc.resource_usage = GfxResourceUsage::Default;
+				bounds_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				bounds_desc.stride = sizeof(OcclusionQueryBounds);
+				bounds_desc.size = sizeof(OcclusionQueryBounds) * query_count;
+				builder.DeclareBuffer(RG_NAME(OcclusionQueryBounds), bounds_desc);
+				data.bounds = builder.WriteCopyDstBuffer(RG_NAME(OcclusionQueryBounds));
+			},
+			[=](OcclusionQueryUploadPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				Uint64 const bounds_size = sizeof(OcclusionQueryBounds) * bounds.size();
+				GfxDynamicAllocation staging = cmd_list->GetDevice()->GetDynamicAllocator()->Allocate(bounds_size, 16);
+				staging.Update(bounds.data(), bounds_size);
+				cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.bounds), 0, *staging.buffer, staging.offset, bounds_size);
+			}, RGPassType::Copy, RGPassFlags::None);
+
+		struct OcclusionQueryPassData
+		{
+			RGTextureReadOnlyId hzb;
+			RGBufferReadOnlyId  bounds;
+			RGBufferReadWriteId results;
+		};
+		rg.AddPass<OcclusionQueryPassData>("Occlusion Query Pass",
+			[=](OcclusionQueryPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc results_desc{};
+				results_desc.resource_usage = GfxResourceUsage::Default;
+				results_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				results_desc.stride = sizeof(Uint32);
+				results_desc.size = sizeof(Uint32) * query_count;
+				builder.DeclareBuffer(RG_NAME(OcclusionQueryResults), results_desc);
+
+				data.hzb = builder.ReadTexture(RG_NAME(HZB), ReadAccess_NonPixelShader);
+				data.bounds = builder.ReadBuffer(RG_NAME(OcclusionQueryBounds), ReadAccess_NonPixelShader);
+				data.results = builder.WriteBuffer(RG_NAME(OcclusionQueryResults));
+			},
+			[=](OcclusionQueryPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.hzb),
+												context.GetReadOnlyBuffer(data.bounds),
+												context.GetReadWriteBuffer(data.results) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct OcclusionQueryConstants
+				{
+					Matrix hzb_view_projection;
+					Uint32 hzb_idx;
+					Uint32 bounds_idx;
+					Uint32 results_idx;
+					Uint32 query_count;
+					Float  hzb_width;
+					Float  hzb_height;
+					Uint32 hzb_mip_count;
+				} constants =
+				{
+					.hzb_view_projection = hzb.hzb_view_projection,
+					.hzb_idx = i, .bounds_idx = i + 1, .results_idx = i + 2, .query_count = query_count,
+					.hzb_width = (Float)hzb.hzb_width, .hzb_height = (Float)hzb.hzb_height, .hzb_mip_count = hzb.hzb_mip_count
+				};
+
+				cmd_list->SetPipelineState(occlusion_query_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(query_count, 64u), 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct OcclusionQueryReadbackPassData
+		{
+			RGBufferCopySrcId results;
+		};
+		rg.AddPass<OcclusionQueryReadbackPassData>("Occlusion Query Readback Pass",
+			[=](OcclusionQueryReadbackPassData& data, RenderGraphBuilder& builder)
+			{
+				data.results = builder.ReadCopySrcBuffer(RG_NAME(OcclusionQueryResults));
+			},
+			[=, query_frame = frame_index](OcclusionQueryReadbackPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxBuffer const& results_buffer = context.GetCopySrcBuffer(data.results);
+				gfx->GetReadbackQueue()->Enqueue(cmd_list, results_buffer, 0, sizeof(Uint32) * query_count, [this, keys, query_frame](void const* readback_data, Uint64)
+					{
+						Uint32 const* visibility = static_cast<Uint32 const*>(readback_data);
+						Uint32 occluded_count = 0;
+						for (Uint64 i = 0; i < keys.size(); ++i)
+						{
+							results[keys[i]] = OcclusionQueryResult{ .frame = query_frame, .visible = visibility[i] != 0 };
+							if (!visibility[i]) ++occluded_count;
+						}
+						last_query_count = (Uint32)keys.size();
+						last_occluded_count = occluded_count;
+					});
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
+	}
+
+	void OcclusionQueryPass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("Occlusion Queries", 0))
+				{
+					ImGui::Checkbox("Enable", OcclusionQueries.GetPtr());
+					if (OcclusionQueries.Get())
+					{
+						ImGui::Text("Occluded: %u/%u", last_occluded_count, last_query_count);
+					}
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	Bool OcclusionQueryPass::IsEnabled() const
+	{
+		return OcclusionQueries.Get();
+	}
+
+	void OcclusionQueryPass::CreatePSO()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_OcclusionQuery;
+		occlusion_query_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	Uint32 OcclusionQueryPass::AddQuery(OcclusionQueryGroup group, Uint32 id, OcclusionQueryBounds const& bounds)
+	{
+		if (!IsEnabled() || query_bounds.size() >= MAX_QUERIES) return INVALID_QUERY;
+		query_bounds.push_back(bounds);
+		query_keys.push_back(GetQueryKey(group, id));
+		return (Uint32)query_bounds.size() - 1;
+	}
+}
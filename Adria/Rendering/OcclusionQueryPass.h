@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+namespace adria
+{
+	class RenderGraph;
+	class GfxDevice;
+	class GfxComputePipelineState;
+
+	enum class OcclusionQueryGroup : Uint8
+	{
+		Batch,
+		Light,
+		Decal,
+		Sun
+	};
+
+	//tests world space boxes and spheres against the HZB published in HZBBlackboardData.
+	//queries added since the last AddPass are resolved there: the results are written to OcclusionQueryResults for
+	//GPU passes later in the frame and read back for CPU ones. Read back results are a few frames old,
+	//anything without a recent result is reported visible
+	class OcclusionQueryPass
+	{
+		static constexpr Uint32 MAX_QUERIES = 1 << 16;
+		static constexpr Uint64 MAX_RESULT_AGE = 8;
+
+		struct OcclusionQueryBounds
+		{
+			Vector3 center;
+			Uint32  is_sphere;
+			Vector3 extents;
+			Float   radius;
+		};
+
+		struct OcclusionQueryResult
+		{
+			Uint64 frame;
+			Bool visible;
+		};
+
+	public:
+		static constexpr Uint32 INVALID_QUERY = UINT32_MAX;
+
+		explicit OcclusionQueryPass(GfxDevice* gfx);
+		~OcclusionQueryPass();
+
+		Uint32 AddQuery(OcclusionQueryGroup group, Uint32 id, BoundingBox const& box);
+		Uint32 AddQuery(OcclusionQueryGroup group, Uint32 id, BoundingSphere const& sphere);
+		Bool IsVisible(OcclusionQueryGroup group, Uint32 id) const;
+
+		void AddPass(RenderGraph& rg);
+		void GUI();
+		Bool IsEnabled() const;
+
+	private:
+		GfxDevice* gfx;
+		std::unique_ptr<GfxComputePipelineState> occlusion_query_pso;
+
+		std::vector<OcclusionQueryBounds> query_bounds;
+		std::vector<Uint64> query_keys;
+		std::unordered_map<Uint64, OcclusionQueryResult> results;
+		Uint64 frame_index = 0;
+		Uint32 last_query_count = 0;
+		Uint32 last_occluded_count = 0;
+
+	private:
+		void CreatePSO();
+		Uint32 AddQuery(OcclusionQueryGroup group, Uint32 id, OcclusionQueryBounds const& bounds);
+	};
+}
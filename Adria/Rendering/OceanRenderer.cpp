@@ -7,18 +7,28 @@
 #include "Core/Paths.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Graphics/GfxTexture.h"
+#include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "Graphics/GfxReflection.h"
 #include "Graphics/GfxCommon.h"
 #include "Editor/GUICommand.h"
 #include "Utilities/Random.h"
 #include "Math/Constants.h"
+#include "Core/ConsoleManager.h"
 #include "entt/entity/registry.hpp"
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> OceanClipmap("r.Ocean.Clipmap", true, "Draw the ocean as a camera-centred clipmap instead of the scene's fixed grid of chunks");
+
+	struct OceanClipmapTile
+	{
+		Vector2 origin;
+		Float   size;
+		Uint32  level;
+	};
 
 	OceanRenderer::OceanRenderer(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
 		: reg{ reg }, gfx{ gfx }, width{ w }, height{ h }
@@ -46,8 +56,8 @@ namespace adria
 		rendergraph.ImportTexture(RG_NAME(InitialSpectrum), initial_spectrum.get());
 		rendergraph.ImportTexture(RG_NAME(PongPhase), ping_pong_phase_textures[pong_phase].get());
 		rendergraph.ImportTexture(RG_NAME(PingPhase), ping_pong_phase_textures[!pong_phase].get());
-		rendergraph.ImportTexture(RG_NAME(PongSpectrum), ping_pong_spectrum_textures[pong_spectrum].get());
-		rendergraph.ImportTexture(RG_NAME(PingSpectrum), ping_pong_spectrum_textures[!pong_spectrum].get());
+		rendergraph.ImportTexture(RG_NAME(PongSpectrum), ping_pong_spectrum_textures[0].get());
+		rendergraph.ImportTexture(RG_NAME(PingSpectrum), ping_pong_spectrum_textures[1].get());
 
 		if (recreate_initial_spectrum)
 		{
@@ -81,7 +91,7 @@ namespace adria
 					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 					cmd_list->SetRootConstants(1, constants);
 					cmd_list->Dispatch(FFT_RESOLUTION / 16, FFT_RESOLUTION / 16, 1);
-				}, RGPassType::Compute, RGPassFlags::None);
+				}, RGPassType::ComputeAsync, RGPassFlags::None);
 		}
 
 		struct PhasePassData
@@ -119,7 +129,7 @@ namespace adria
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(FFT_RESOLUTION / 16, FFT_RESOLUTION / 16, 1);
-			}, RGPassType::Compute, RGPassFlags::None);
+			}, RGPassType::ComputeAsync, RGPassFlags::None);
 		pong_phase = !pong_phase;
 
 		struct SpectrumPassData
@@ -163,95 +173,70 @@ namespace adria
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(FFT_RESOLUTION / 16, FFT_RESOLUTION / 16, 1);
 
-			}, RGPassType::Compute, RGPassFlags::None);
+			}, RGPassType::ComputeAsync, RGPassFlags::None);
 
+		struct FFTPassData
+		{
+			RGTextureReadOnlyId  spectrum_srv;
+			RGTextureReadWriteId spectrum_uav;
+		};
 		struct FFTConstants
 		{
 			Uint32 input_idx;
 			Uint32 output_idx;
-			Uint32 seq_count;
-			Uint32 subseq_count;
+			Uint32 fft_resolution;
+			Uint32 fft_log_resolution;
 		};
 
-		for (Uint32 p = 1; p < FFT_RESOLUTION; p <<= 1)
-		{
-			struct FFTHorizontalPassData
+		rendergraph.AddPass<FFTPassData>("FFT Horizontal Pass",
+			[=](FFTPassData& data, RenderGraphBuilder& builder)
 			{
-				RGTextureReadOnlyId spectrum_srv;
-				RGTextureReadWriteId spectrum_uav;
-			};
-
-			rendergraph.AddPass<FFTHorizontalPassData>("FFT Horizontal Pass",
-				[=, pong_spectrum = this->pong_spectrum](FFTHorizontalPassData& data, RenderGraphBuilder& builder)
-				{
-					RGResourceName pong_spectrum_texture = !pong_spectrum ? RG_NAME(PongSpectrum) : RG_NAME(PingSpectrum);
-					RGResourceName ping_spectrum_texture = !pong_spectrum ? RG_NAME(PingSpectrum) : RG_NAME(PongSpectrum);
-					data.spectrum_srv = builder.ReadTexture(pong_spectrum_texture, ReadAccess_NonPixelShader);
-					data.spectrum_uav = builder.WriteTexture(ping_spectrum_texture);
-				},
-				[=](FFTHorizontalPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-				{
-					GfxDevice* gfx = cmd_list->GetDevice();
-					
-
-					cmd_list->SetPipelineState(fft_horizontal_pso.get());
-
-					Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
-					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyTexture(data.spectrum_srv));
-					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.spectrum_uav));
-
-					FFTConstants fft_constants{};
-					fft_constants.seq_count = FFT_RESOLUTION;
-					fft_constants.subseq_count = p;
-					fft_constants.input_idx = i;
-					fft_constants.output_idx = i + 1;
-
-					cmd_list->SetRootConstants(1, fft_constants);
-					cmd_list->Dispatch(FFT_RESOLUTION, 1, 1);
-
-				}, RGPassType::Compute, RGPassFlags::None);
-			pong_spectrum = !pong_spectrum;
-		}
-
-		for (Uint32 p = 1; p < FFT_RESOLUTION; p <<= 1)
-		{
-			struct FFTVerticalPassData
+				data.spectrum_srv = builder.ReadTexture(RG_NAME(PongSpectrum), ReadAccess_NonPixelShader);
+				data.spectrum_uav = builder.WriteTexture(RG_NAME(PingSpectrum));
+			},
+			[=](FFTPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
-				RGTextureReadOnlyId spectrum_srv;
-				RGTextureReadWriteId spectrum_uav;
-			};
-
-			rendergraph.AddPass<FFTVerticalPassData>("FFT Vertical Pass",
-				[=, pong_spectrum = this->pong_spectrum](FFTVerticalPassData& data, RenderGraphBuilder& builder)
-				{
-					RGResourceName pong_spectrum_texture = !pong_spectrum ? RG_NAME(PongSpectrum) : RG_NAME(PingSpectrum);
-					RGResourceName ping_spectrum_texture = !pong_spectrum ? RG_NAME(PingSpectrum) : RG_NAME(PongSpectrum);
-					data.spectrum_srv = builder.ReadTexture(pong_spectrum_texture, ReadAccess_NonPixelShader);
-					data.spectrum_uav = builder.WriteTexture(ping_spectrum_texture);
-				},
-				[=](FFTVerticalPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-				{
-					GfxDevice* gfx = cmd_list->GetDevice();
-					
-
-					cmd_list->SetPipelineState(fft_vertical_pso.get());
+				GfxDevice* gfx = cmd_list->GetDevice();
 
-					Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
-					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyTexture(data.spectrum_srv));
-					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.spectrum_uav));
+				Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyTexture(data.spectrum_srv));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.spectrum_uav));
+
+				FFTConstants fft_constants{};
+				fft_constants.input_idx = i;
+				fft_constants.output_idx = i + 1;
+				fft_constants.fft_resolution = FFT_RESOLUTION;
+				fft_constants.fft_log_resolution = FFT_LOG_RESOLUTION;
+
+				cmd_list->SetPipelineState(fft_horizontal_pso.get());
+				cmd_list->SetRootConstants(1, fft_constants);
+				cmd_list->Dispatch(FFT_RESOLUTION, 1, 1);
+			}, RGPassType::ComputeAsync, RGPassFlags::None);
+
+		rendergraph.AddPass<FFTPassData>("FFT Vertical Pass",
+			[=](FFTPassData& data, RenderGraphBuilder& builder)
+			{
+				data.spectrum_srv = builder.ReadTexture(RG_NAME(PingSpectrum), ReadAccess_NonPixelShader);
+				data.spectrum_uav = builder.WriteTexture(RG_NAME(PongSpectrum));
+			},
+			[=](FFTPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
 
-					FFTConstants fft_constants{};
-					fft_constants.seq_count = FFT_RESOLUTION;
-					fft_constants.subseq_count = p;
-					fft_constants.input_idx = i;
-					fft_constants.output_idx = i + 1;
+				Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyTexture(data.spectrum_srv));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadWriteTexture(data.spectrum_uav));
 
-					cmd_list->SetRootConstants(1, fft_constants);
-					cmd_list->Dispatch(FFT_RESOLUTION, 1, 1);
+				FFTConstants fft_constants{};
+				fft_constants.input_idx = i;
+				fft_constants.output_idx = i + 1;
+				fft_constants.fft_resolution = FFT_RESOLUTION;
+				fft_constants.fft_log_resolution = FFT_LOG_RESOLUTION;
 
-				}, RGPassType::Compute, RGPassFlags::None);
-			pong_spectrum = !pong_spectrum;
-		}
+				cmd_list->SetPipelineState(fft_vertical_pso.get());
+				cmd_list->SetRootConstants(1, fft_constants);
+				cmd_list->Dispatch(FFT_RESOLUTION, 1, 1);
+			}, RGPassType::ComputeAsync, RGPassFlags::None);
 
 		struct OceanNormalsPassData
 		{
@@ -267,8 +252,7 @@ namespace adria
 				ocean_desc.format = GfxFormat::R32G32B32A32_FLOAT;
 				builder.DeclareTexture(RG_NAME(OceanNormals), ocean_desc);
 
-				RGResourceName pong_spectrum_texture = !pong_spectrum ? RG_NAME(PongSpectrum) : RG_NAME(PingSpectrum);
-				data.spectrum_srv = builder.ReadTexture(pong_spectrum_texture, ReadAccess_NonPixelShader);
+				data.spectrum_srv = builder.ReadTexture(RG_NAME(PongSpectrum), ReadAccess_NonPixelShader);
 				data.normals_uav = builder.WriteTexture(RG_NAME(OceanNormals));
 			},
 			[=](OceanNormalsPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
@@ -295,7 +279,7 @@ namespace adria
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(FFT_RESOLUTION / 16, FFT_RESOLUTION / 16, 1);
-			}, RGPassType::Compute, RGPassFlags::None);
+			}, RGPassType::ComputeAsync, RGPassFlags::None);
 
 		struct OceanDrawPassData
 		{
@@ -303,11 +287,16 @@ namespace adria
 			RGTextureReadOnlyId displacement;
 		};
 
+		if (OceanClipmap.Get())
+		{
+			AddClipmapPasses(rendergraph);
+			return;
+		}
+
 		rendergraph.AddPass<OceanDrawPassData>("Ocean Draw Pass",
 			[=](OceanDrawPassData& data, RenderGraphBuilder& builder)
 			{
-				RGResourceName ping_spectrum_texture = !pong_spectrum ? RG_NAME(PingSpectrum) : RG_NAME(PongSpectrum);
-				data.displacement = builder.ReadTexture(ping_spectrum_texture, ReadAccess_NonPixelShader);
+				data.displacement = builder.ReadTexture(RG_NAME(PongSpectrum), ReadAccess_NonPixelShader);
 				data.normals = builder.ReadTexture(RG_NAME(OceanNormals), ReadAccess_PixelShader);
 				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
 				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
@@ -367,13 +356,154 @@ namespace adria
 			RGPassType::Graphics, RGPassFlags::None);
 	}
 
+	void OceanRenderer::AddClipmapPasses(RenderGraph& rendergraph)
+	{
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+
+		auto ocean_view = reg.view<Ocean, Material, Transform>();
+		entt::entity ocean_entity = ocean_view.front();
+		if (ocean_entity == entt::null) return;
+		Float const ocean_height = ocean_view.get<Transform>(ocean_entity).current_transform.Translation().y;
+		Vector3 const ocean_color(ocean_view.get<Material>(ocean_entity).albedo_color);
+
+		struct OceanClipmapCullPassData
+		{
+			RGBufferReadWriteId tiles;
+			RGBufferReadWriteId draw_args;
+		};
+
+		rendergraph.AddPass<OceanClipmapCullPassData>("Ocean Clipmap Cull Pass",
+			[=](OceanClipmapCullPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc tiles_desc{};
+				tiles_desc.resource_usage = GfxResourceUsage::Default;
+				tiles_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				tiles_desc.stride = sizeof(OceanClipmapTile);
+				tiles_desc.size = CLIPMAP_MAX_TILES * sizeof(OceanClipmapTile);
+				builder.DeclareBuffer(RG_NAME(OceanClipmapTiles), tiles_desc);
+
+				RGBufferDesc draw_args_desc{};
+				draw_args_desc.resource_usage = GfxResourceUsage::Default;
+				draw_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				draw_args_desc.stride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+				draw_args_desc.size = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+				builder.DeclareBuffer(RG_NAME(OceanClipmapDrawArgs), draw_args_desc);
+
+				data.tiles = builder.WriteBuffer(RG_NAME(OceanClipmapTiles));
+				data.draw_args = builder.WriteBuffer(RG_NAME(OceanClipmapDrawArgs));
+			},
+			[=](OceanClipmapCullPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadWriteBuffer(data.tiles), context.GetReadWriteBuffer(data.draw_args) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct OceanClipmapCullConstants
+				{
+					Uint32 tiles_idx;
+					Uint32 draw_args_idx;
+					Uint32 level_count;
+					Uint32 tile_index_count;
+					Float  base_tile_size;
+					Float  ocean_height;
+					Float  max_displacement;
+				} constants =
+				{
+					.tiles_idx = i, .draw_args_idx = i + 1, .level_count = CLIPMAP_LEVELS,
+					.tile_index_count = clipmap_tile_ib->GetCount(), .base_tile_size = clipmap_base_tile_size,
+					.ocean_height = ocean_height, .max_displacement = ocean_choppiness * 10.0f
+				};
+
+				cmd_list->SetPipelineState(clipmap_cull_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct OceanClipmapDrawPassData
+		{
+			RGTextureReadOnlyId    normals;
+			RGTextureReadOnlyId    displacement;
+			RGBufferReadOnlyId     tiles;
+			RGBufferIndirectArgsId draw_args;
+		};
+
+		rendergraph.AddPass<OceanClipmapDrawPassData>("Ocean Clipmap Draw Pass",
+			[=](OceanClipmapDrawPassData& data, RenderGraphBuilder& builder)
+			{
+				data.displacement = builder.ReadTexture(RG_NAME(PongSpectrum), ReadAccess_NonPixelShader);
+				data.normals = builder.ReadTexture(RG_NAME(OceanNormals), ReadAccess_PixelShader);
+				data.tiles = builder.ReadBuffer(RG_NAME(OceanClipmapTiles), ReadAccess_NonPixelShader);
+				data.draw_args = builder.ReadIndirectArgsBuffer(RG_NAME(OceanClipmapDrawArgs));
+				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=](OceanClipmapDrawPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.displacement), context.GetReadOnlyTexture(data.normals),
+												g_TextureManager.GetSRV(foam_handle), context.GetReadOnlyBuffer(data.tiles) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct OceanClipmapIndices
+				{
+					Uint32 displacement_idx;
+					Uint32 normal_idx;
+					Uint32 foam_idx;
+					Uint32 tiles_idx;
+				} indices =
+				{
+					.displacement_idx = i, .normal_idx = i + 1,
+					.foam_idx = i + 2, .tiles_idx = i + 3
+				};
+
+				struct OceanClipmapConstants
+				{
+					Vector3 ocean_color;
+					Float   ocean_height;
+					Float   tile_resolution;
+					Float   morph_range;
+				} constants =
+				{
+					.ocean_color = ocean_color,
+					.ocean_height = ocean_height,
+					.tile_resolution = (Float)CLIPMAP_TILE_RESOLUTION,
+					.morph_range = clipmap_morph_range
+				};
+
+				if (ocean_wireframe) ocean_clipmap_psos->SetFillMode(GfxFillMode::Wireframe);
+				cmd_list->SetPipelineState(ocean_clipmap_psos->Get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, indices);
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
+				GfxIndexBufferView ibv(clipmap_tile_ib.get());
+				cmd_list->SetIndexBuffer(&ibv);
+				GfxBuffer const& draw_args = context.GetIndirectArgsBuffer(data.draw_args);
+				cmd_list->DrawIndexedIndirect(draw_args, 0);
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+
 	void OceanRenderer::GUI()
 	{
 		QueueGUI([&]()
 			{
 				if (ImGui::TreeNodeEx("Ocean Settings", 0))
 				{
-					ImGui::Checkbox("Tessellation", &ocean_tesselation);
+					ImGui::Checkbox("Clipmap", OceanClipmap.GetPtr());
+					if (OceanClipmap.Get())
+					{
+						ImGui::SliderFloat("Clipmap Base Tile Size", &clipmap_base_tile_size, 1.0f, 128.0f);
+						ImGui::SliderFloat("Clipmap Morph Range", &clipmap_morph_range, 0.0f, 0.5f);
+					}
+					else ImGui::Checkbox("Tessellation", &ocean_tesselation);
 					ImGui::Checkbox("Wireframe", &ocean_wireframe);
 
 					ImGui::SliderFloat("Choppiness", &ocean_choppiness, 0.0f, 10.0f);
@@ -420,8 +550,36 @@ namespace adria
 		ping_pong_phase_textures[!pong_phase] = gfx->CreateTexture(ocean_texture_desc);
 
 		ocean_texture_desc.format = GfxFormat::R32G32B32A32_FLOAT;
-		ping_pong_spectrum_textures[pong_spectrum] = gfx->CreateTexture(ocean_texture_desc);
-		ping_pong_spectrum_textures[!pong_spectrum] = gfx->CreateTexture(ocean_texture_desc);
+		ping_pong_spectrum_textures[0] = gfx->CreateTexture(ocean_texture_desc);
+		ping_pong_spectrum_textures[1] = gfx->CreateTexture(ocean_texture_desc);
+
+		CreateClipmapTile();
+	}
+
+	void OceanRenderer::CreateClipmapTile()
+	{
+		//vertex positions are generated in the vertex shader from SV_VertexID, only the tile topology is stored
+		static constexpr Uint32 vertex_count_per_side = CLIPMAP_TILE_RESOLUTION + 1;
+		std::vector<Uint16> indices;
+		indices.reserve(CLIPMAP_TILE_RESOLUTION * CLIPMAP_TILE_RESOLUTION * 6);
+		for (Uint16 z = 0; z < CLIPMAP_TILE_RESOLUTION; ++z)
+		{
+			for (Uint16 x = 0; x < CLIPMAP_TILE_RESOLUTION; ++x)
+			{
+				Uint16 const i0 = z * vertex_count_per_side + x;
+				Uint16 const i1 = i0 + 1;
+				Uint16 const i2 = i0 + vertex_count_per_side;
+				Uint16 const i3 = i2 + 1;
+				indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+
+		GfxBufferDesc ib_desc{};
+		ib_desc.bind_flags = GfxBindFlag::None;
+		ib_desc.format = GfxFormat::R16_UINT;
+		ib_desc.stride = sizeof(Uint16);
+		ib_desc.size = indices.size() * sizeof(Uint16);
+		clipmap_tile_ib = gfx->CreateBuffer(ib_desc, indices.data());
 	}
 
 	void OceanRenderer::CreatePSOs()
@@ -445,6 +603,13 @@ namespace adria
 		gfx_pso_desc.topology_type = GfxPrimitiveTopologyType::Patch;
 		ocean_lod_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gfx_pso_desc);
 
+		gfx_pso_desc.input_layout = {};
+		gfx_pso_desc.VS = VS_OceanClipmap;
+		gfx_pso_desc.DS = ShaderID_Invalid;
+		gfx_pso_desc.HS = ShaderID_Invalid;
+		gfx_pso_desc.topology_type = GfxPrimitiveTopologyType::Triangle;
+		ocean_clipmap_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gfx_pso_desc);
+
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_FFT_Horizontal;
 		fft_horizontal_pso = gfx->CreateComputePipelineState(compute_pso_desc);
@@ -463,6 +628,9 @@ namespace adria
 
 		compute_pso_desc.CS = CS_OceanNormals;
 		ocean_normals_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_OceanClipmapCull;
+		clipmap_cull_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 	}
 
 }
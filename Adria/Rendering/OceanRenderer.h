@@ -10,12 +10,19 @@ namespace adria
 	class TextureManager;
 	class GfxDevice;
 	class GfxTexture;
+	class GfxBuffer;
 	class GfxGraphicsPipelineState;
 	class GfxComputePipelineState;
 
 	class OceanRenderer
 	{
 		static constexpr Uint32 FFT_RESOLUTION = 512;
+		static constexpr Uint32 FFT_LOG_RESOLUTION = 9;
+		static_assert((1u << FFT_LOG_RESOLUTION) == FFT_RESOLUTION);
+		static constexpr Uint32 CLIPMAP_LEVELS = 6;
+		static constexpr Uint32 CLIPMAP_TILE_RESOLUTION = 32;
+		static constexpr Uint32 CLIPMAP_TILES_PER_LEVEL = 16;
+		static constexpr Uint32 CLIPMAP_MAX_TILES = CLIPMAP_LEVELS * CLIPMAP_TILES_PER_LEVEL;
 
 	public:
 		OceanRenderer(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
@@ -36,10 +43,12 @@ namespace adria
 		std::unique_ptr<GfxTexture> ping_pong_phase_textures[2];
 		Bool pong_phase = false;
 		std::unique_ptr<GfxTexture> ping_pong_spectrum_textures[2];
-		Bool pong_spectrum = false;
+		std::unique_ptr<GfxBuffer> clipmap_tile_ib;
 
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> ocean_psos;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> ocean_lod_psos;
+		std::unique_ptr<GfxGraphicsPipelineStatePermutations> ocean_clipmap_psos;
+		std::unique_ptr<GfxComputePipelineState> clipmap_cull_pso;
 		std::unique_ptr<GfxComputePipelineState> fft_horizontal_pso;
 		std::unique_ptr<GfxComputePipelineState> fft_vertical_pso;
 		std::unique_ptr<GfxComputePipelineState> initial_spectrum_pso;
@@ -55,8 +64,12 @@ namespace adria
 		Bool ocean_color_changed = false;
 		Bool recreate_initial_spectrum = true;
 		Float wind_direction[2] = { 10.0f, 10.0f };
+		Float clipmap_base_tile_size = 16.0f;
+		Float clipmap_morph_range = 0.2f;
 
 	private:
 		void CreatePSOs();
+		void CreateClipmapTile();
+		void AddClipmapPasses(RenderGraph& rendergraph);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "OpacityMicromapBaker.h"
+#include "Utilities/Image.h"
+
+namespace adria
+{
+	namespace
+	{
+		enum MicroTriangleState : Uint8
+		{
+			MicroTriangleState_Transparent = 0,
+			MicroTriangleState_Opaque = 1,
+			MicroTriangleState_UnknownTransparent = 2,
+			MicroTriangleState_UnknownOpaque = 3
+		};
+
+		//footprints larger than this are not scanned, the micro triangle is left unknown instead
+		constexpr Uint32 MAX_FOOTPRINT_TEXELS = 4096;
+
+		Uint32 ExtractEvenBits(Uint32 x)
+		{
+			x &= 0x55555555;
+			x = (x | (x >> 1)) & 0x33333333;
+			x = (x | (x >> 2)) & 0x0f0f0f0f;
+			x = (x | (x >> 4)) & 0x00ff00ff;
+			x = (x | (x >> 8)) & 0x0000ffff;
+			return x;
+		}
+		Uint32 PrefixXor(Uint32 x)
+		{
+			x ^= (x >> 1);
+			x ^= (x >> 2);
+			x ^= (x >> 4);
+			x ^= (x >> 8);
+			return x;
+		}
+
+		//barycentrics of the corners of a micro triangle from its index along the bird curve
+		void GetMicroTriangleBarycentrics(Uint32 index, Uint32 subdivision_level, Vector2 (&barycentrics)[3])
+		{
+			if (subdivision_level == 0)
+			{
+				barycentrics[0] = Vector2(0.0f, 0.0f);
+				barycentrics[1] = Vector2(1.0f, 0.0f);
+				barycentrics[2] = Vector2(0.0f, 1.0f);
+				return;
+			}
+
+			Uint32 const b0 = ExtractEvenBits(index);
+			Uint32 const b1 = ExtractEvenBits(index >> 1);
+			Uint32 const fx = PrefixXor(b0);
+			Uint32 const fy = PrefixXor(b0 & ~b1);
+			Uint32 const t = fy ^ fx;
+			Uint32 const mask = (1u << subdivision_level) - 1;
+			Uint32 iu = ((fx & ~t) | (b0 & ~t) | (~b0 & ~fx & t)) & mask;
+			Uint32 iv = (fy ^ b0) & mask;
+			Uint32 const iw = ((~fx & ~t) | (b0 & ~t) | (~b0 & fx & t)) & mask;
+
+			Bool const upright = ((iu & 1) ^ (iv & 1) ^ (iw & 1)) != 0;
+			if (!upright)
+			{
+				iu += 1;
+				iv += 1;
+			}
+			Float const scale = 1.0f / (1u << subdivision_level);
+			Float const d = upright ? scale : -scale;
+			Float const u = iu * scale, v = iv * scale;
+			barycentrics[0] = Vector2(u, v);
+			barycentrics[1] = Vector2(u + d, v);
+			barycentrics[2] = Vector2(u, v + d);
+		}
+
+		class AlphaFootprint
+		{
+		public:
+			AlphaFootprint(Image const& image, Float alpha_cutoff) : data(image.Data()), width(image.Width()), height(image.Height()),
+				cutoff((Uint32)std::ceil(std::clamp(alpha_cutoff, 0.0f, 1.0f) * 255.0f)) {}
+
+			//every texel a bilinear lookup inside the uv triangle can touch, with repeat addressing
+			MicroTriangleState Classify(Vector2 const& uv0, Vector2 const& uv1, Vector2 const& uv2) const
+			{
+				Float const min_u = std::min({ uv0.x, uv1.x, uv2.x }) * width - 0.5f;
+				Float const max_u = std::max({ uv0.x, uv1.x, uv2.x }) * width - 0.5f;
+				Float const min_v = std::min({ uv0.y, uv1.y, uv2.y }) * height - 0.5f;
+				Float const max_v = std::max({ uv0.y, uv1.y, uv2.y }) * height - 0.5f;
+				if (!std::isfinite(min_u) || !std::isfinite(max_u) || !std::isfinite(min_v) || !std::isfinite(max_v)) return MicroTriangleState_UnknownOpaque;
+
+				Int64 const x0 = (Int64)std::floor(min_u), x1 = (Int64)std::floor(max_u) + 1;
+				Int64 const y0 = (Int64)std::floor(min_v), y1 = (Int64)std::floor(max_v) + 1;
+				if ((x1 - x0 + 1) * (y1 - y0 + 1) > MAX_FOOTPRINT_TEXELS) return MicroTriangleState_UnknownOpaque;
+
+				Uint32 opaque = 0, transparent = 0;
+				for (Int64 y = y0; y <= y1; ++y)
+				{
+					Uint64 const row = (Uint64)(((y % height) + height) % height) * width;
+					for (Int64 x = x0; x <= x1; ++x)
+					{
+						Uint64 const texel = row + (Uint64)(((x % width) + width) % width);
+						data[texel * 4 + 3] >= cutoff ? ++opaque : ++transparent;
+					}
+				}
+				if (transparent == 0) return MicroTriangleState_Opaque;
+				if (opaque == 0) return MicroTriangleState_Transparent;
+				return opaque >= transparent ? MicroTriangleState_UnknownOpaque : MicroTriangleState_UnknownTransparent;
+			}
+
+		private:
+			Uint8 const* data;
+			Int64 width;
+			Int64 height;
+			Uint32 cutoff;
+		};
+	}
+
+	std::unique_ptr<OpacityMicromapData> BakeOpacityMicromaps(std::span<Uint32 const> indices, std::span<Vector2 const> uvs, Image const& alpha_image, Float alpha_cutoff, Uint32 subdivision_level)
+	{
+		if (alpha_image.Format() != GfxFormat::R8G8B8A8_UNORM || alpha_image.Width() == 0 || alpha_image.Height() == 0) return nullptr;
+
+		Uint32 const micro_triangle_count = 1u << (2 * subdivision_level);
+		Uint64 const micromap_size = std::max<Uint64>(micro_triangle_count / 4, 1);
+		Uint64 const triangle_count = indices.size() / 3;
+		AlphaFootprint const footprint(alpha_image, alpha_cutoff);
+
+		std::unique_ptr<OpacityMicromapData> micromap_data = std::make_unique<OpacityMicromapData>();
+		micromap_data->subdivision_level = subdivision_level;
+		micromap_data->triangle_indices.resize(triangle_count, OpacityMicromapData::FullyUnknownOpaque);
+
+		Uint64 resolved_triangles = 0;
+		std::vector<Uint8> micromap(micromap_size);
+		for (Uint64 triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			Uint32 const i0 = indices[triangle * 3 + 0], i1 = indices[triangle * 3 + 1], i2 = indices[triangle * 3 + 2];
+			if (i0 >= uvs.size() || i1 >= uvs.size() || i2 >= uvs.size()) continue;
+			Vector2 const uv0 = uvs[i0], uv1 = uvs[i1], uv2 = uvs[i2];
+
+			//most foliage triangles are uniformly covered, those are resolved without micromap storage
+			MicroTriangleState const triangle_state = footprint.Classify(uv0, uv1, uv2);
+			if (triangle_state == MicroTriangleState_Opaque || triangle_state == MicroTriangleState_Transparent)
+			{
+				micromap_data->triangle_indices[triangle] = triangle_state == MicroTriangleState_Opaque ? OpacityMicromapData::FullyOpaque : OpacityMicromapData::FullyTransparent;
+				++resolved_triangles;
+				continue;
+			}
+
+			std::fill(micromap.begin(), micromap.end(), 0);
+			Uint32 known_micro_triangles = 0;
+			for (Uint32 i = 0; i < micro_triangle_count; ++i)
+			{
+				Vector2 barycentrics[3];
+				GetMicroTriangleBarycentrics(i, subdivision_level, barycentrics);
+				Vector2 micro_uvs[3];
+				for (Uint32 j = 0; j < 3; ++j)
+				{
+					micro_uvs[j] = uv0 * (1.0f - barycentrics[j].x - barycentrics[j].y) + uv1 * barycentrics[j].x + uv2 * barycentrics[j].y;
+				}
+				MicroTriangleState const state = footprint.Classify(micro_uvs[0], micro_uvs[1], micro_uvs[2]);
+				if (state == MicroTriangleState_Opaque || state == MicroTriangleState_Transparent) ++known_micro_triangles;
+				micromap[i / 4] |= (Uint8)(state << ((i % 4) * 2));
+			}
+			if (known_micro_triangles == 0) continue;
+
+			micromap_data->triangle_indices[triangle] = (Int32)micromap_data->micromap_count++;
+			micromap_data->micromaps.insert(micromap_data->micromaps.end(), micromap.begin(), micromap.end());
+			++resolved_triangles;
+		}
+		if (resolved_triangles == 0) return nullptr;
+		return micromap_data;
+	}
+}
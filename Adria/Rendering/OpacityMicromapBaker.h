@@ -0,0 +1,26 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	class Image;
+
+	//4 state opacity micromaps of one submesh, every micromap has 4^subdivision_level micro triangles of 2 bits each in bird curve order.
+	//triangles without a micromap of their own reference one of the special indices
+	struct OpacityMicromapData
+	{
+		static constexpr Int32 FullyTransparent = -1;
+		static constexpr Int32 FullyOpaque = -2;
+		static constexpr Int32 FullyUnknownTransparent = -3;
+		static constexpr Int32 FullyUnknownOpaque = -4;
+
+		Uint32 subdivision_level = 0;
+		Uint32 micromap_count = 0;
+		std::vector<Uint8> micromaps;
+		std::vector<Int32> triangle_indices;
+	};
+
+	//alpha is read from the fourth channel of an uncompressed rgba8 image, micro triangles whose texels straddle the cutoff stay unknown and keep running the any hit shader.
+	//returns null when the micromaps would not resolve a single triangle
+	std::unique_ptr<OpacityMicromapData> BakeOpacityMicromaps(std::span<Uint32 const> indices, std::span<Vector2 const> uvs, Image const& alpha_image, Float alpha_cutoff, Uint32 subdivision_level);
+}
@@ -4,11 +4,25 @@
 #include "Graphics/GfxShader.h"
 #include "Graphics/GfxShaderKey.h"
 #include "Graphics/GfxStateObject.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxQueryHeap.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/ImageWrite.h"
+#include "Logging/Logger.h"
+#include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
 
 namespace adria
 {
+	static TAutoConsoleVariable<Int>   PathTracingTargetSamples("r.PathTracing.TargetSamples", 1024, "Samples per pixel after which accumulation stops, 0 accumulates indefinitely");
+	static TAutoConsoleVariable<Int>   PathTracingTileSize("r.PathTracing.TileSize", 256, "Size of the tiles the path tracer dispatches, in pixels");
+	static TAutoConsoleVariable<Float> PathTracingFrameBudget("r.PathTracing.FrameBudget", 12.0f, "GPU time in milliseconds the path tracer may spend per frame");
+	static TAutoConsoleVariable<Bool>  PathTracingAdaptiveSampling("r.PathTracing.AdaptiveSampling", true, "Skip pixels whose estimated variance is below the threshold");
+	static TAutoConsoleVariable<Float> PathTracingVarianceThreshold("r.PathTracing.VarianceThreshold", 0.0005f, "Relative variance of the mean below which a pixel is considered converged");
+	static TAutoConsoleVariable<Int>   PathTracingAdaptiveMinSamples("r.PathTracing.AdaptiveMinSamples", 32, "Samples every pixel takes before adaptive sampling may skip it");
+	static TAutoConsoleVariable<Bool>  PathTracingExportOnConverge("r.PathTracing.ExportOnConverge", false, "Write the accumulated image to an HDR file once the target sample count is reached");
 
 	PathTracingPass::PathTracingPass(GfxDevice* gfx, Uint32 width, Uint32 height)
 		: gfx(gfx), width(width), height(height)
@@ -17,8 +31,16 @@ namespace adria
 		if (IsSupported())
 		{
 			CreateStateObject();
+			CreatePSO();
 			OnResize(width, height);
 			ShaderManager::GetLibraryRecompiledEvent().AddMember(&PathTracingPass::OnLibraryRecompiled, *this);
+
+			GfxQueryHeapDesc query_heap_desc{};
+			query_heap_desc.count = 2 * GFX_BACKBUFFER_COUNT;
+			query_heap_desc.type = GfxQueryType::Timestamp;
+			timestamp_query_heap = gfx->CreateQueryHeap(query_heap_desc);
+			timestamp_readback_buffer = gfx->CreateBuffer(ReadBackBufferDesc(2 * GFX_BACKBUFFER_COUNT * sizeof(Uint64)));
+			export_fence.Create(gfx, "Path Tracing Export Fence");
 		}
 	}
 	PathTracingPass::~PathTracingPass() = default;
@@ -28,15 +50,110 @@ namespace adria
 		if (!IsSupported()) return;
 
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
-		struct PathTracingPassData
+		rg.ImportTexture(RG_NAME(AccumulationTexture), accumulation_texture.get());
+		rg.ImportTexture(RG_NAME(PT_Moments), moments_texture.get());
+
+		UpdateTileBudget();
+		Bool const converged = IsConverged();
+		if (!converged)
+		{
+			struct PathTracingPassData
+			{
+				RGTextureReadWriteId accumulation;
+				RGTextureReadWriteId moments;
+			};
+
+			Uint32 const tile_size = (Uint32)std::max(PathTracingTileSize.Get(), 8);
+			Uint32 const tiles_x = DivideAndRoundUp(width, tile_size);
+			Uint32 const tile_count = GetTileCount();
+			Uint32 const first_tile = tile_cursor;
+			Uint32 const tile_dispatch_count = tiles_per_frame;
+			Int32 const sample_index = accumulated_frames;
+			Bool const clear_accumulation = reset_accumulation;
+			Uint32 const backbuffer_index = gfx->GetBackbufferIndex();
+
+			rg.AddPass<PathTracingPassData>("Path Tracing Pass",
+				[=](PathTracingPassData& data, RGBuilder& builder)
+				{
+					data.accumulation = builder.WriteTexture(RG_NAME(AccumulationTexture));
+					data.moments = builder.WriteTexture(RG_NAME(PT_Moments));
+				},
+				[=](PathTracingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+					GfxDescriptor src_descriptors[] =
+					{
+						ctx.GetReadWriteTexture(data.accumulation),
+						ctx.GetReadWriteTexture(data.moments)
+					};
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+					Uint32 const i = dst_descriptor.GetIndex();
+
+					if (clear_accumulation)
+					{
+						Float const clear_value[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+						cmd_list->ClearUAV(ctx.GetTexture(*data.accumulation), gfx->GetDescriptorGPU(i), src_descriptors[0], clear_value);
+						cmd_list->ClearUAV(ctx.GetTexture(*data.moments), gfx->GetDescriptorGPU(i + 1), src_descriptors[1], clear_value);
+						cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+					}
+
+					cmd_list->EndQuery(*timestamp_query_heap, backbuffer_index * 2 + 0);
+
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					auto& table = cmd_list->SetStateObject(path_tracing_so.get());
+					table.SetRayGenShader("PT_RayGen");
+					for (Uint32 t = 0; t < tile_dispatch_count; ++t)
+					{
+						Uint32 const tile = (first_tile + t) % tile_count;
+						Uint32 const tile_x = (tile % tiles_x) * tile_size;
+						Uint32 const tile_y = (tile / tiles_x) * tile_size;
+						struct PathTracingConstants
+						{
+							Int32   bounce_count;
+							Int32   sample_index;
+							Uint32  accum_idx;
+							Uint32  moments_idx;
+							Uint32  tile_offset_x;
+							Uint32  tile_offset_y;
+							Bool32  adaptive_sampling;
+							Float   variance_threshold;
+							Int32   adaptive_min_samples;
+						} constants =
+						{
+							.bounce_count = max_bounces, .sample_index = sample_index + Int32((first_tile + t) / tile_count),
+							.accum_idx = i + 0, .moments_idx = i + 1,
+							.tile_offset_x = tile_x, .tile_offset_y = tile_y,
+							.adaptive_sampling = PathTracingAdaptiveSampling.Get(),
+							.variance_threshold = PathTracingVarianceThreshold.Get(),
+							.adaptive_min_samples = PathTracingAdaptiveMinSamples.Get()
+						};
+						cmd_list->SetRootCBV(2, constants);
+						cmd_list->DispatchRays(std::min(tile_size, width - tile_x), std::min(tile_size, height - tile_y));
+					}
+
+					cmd_list->EndQuery(*timestamp_query_heap, backbuffer_index * 2 + 1);
+					cmd_list->ResolveQueryData(*timestamp_query_heap, backbuffer_index * 2, 2, *timestamp_readback_buffer, backbuffer_index * 2 * sizeof(Uint64));
+				}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+
+			timestamp_valid[backbuffer_index] = true;
+			reset_accumulation = false;
+			tile_cursor += tile_dispatch_count;
+			accumulated_frames += tile_cursor / tile_count;
+			tile_cursor %= tile_count;
+		}
+		else if (PathTracingExportOnConverge.Get() && export_filename.empty() && !export_pending)
 		{
+			RequestExport(paths::ScreenshotsDir + "PathTracing_" + std::to_string(accumulated_frames) + "spp.hdr");
+		}
+
+		struct PathTracingResolvePassData
+		{
+			RGTextureReadOnlyId  accumulation;
 			RGTextureReadWriteId output;
-			RGTextureReadWriteId accumulation;
 		};
-
-		rg.ImportTexture(RG_NAME(AccumulationTexture), accumulation_texture.get());
-		rg.AddPass<PathTracingPassData>("Path Tracing Pass",
-			[=](PathTracingPassData& data, RGBuilder& builder)
+		rg.AddPass<PathTracingResolvePassData>("Path Tracing Resolve Pass",
+			[=](PathTracingResolvePassData& data, RGBuilder& builder)
 			{
 				RGTextureDesc render_target_desc{};
 				render_target_desc.format = GfxFormat::R16G16B16A16_FLOAT;
@@ -46,52 +163,67 @@ namespace adria
 				builder.DeclareTexture(RG_NAME(PT_Output), render_target_desc);
 
 				data.output = builder.WriteTexture(RG_NAME(PT_Output));
-				data.accumulation = builder.WriteTexture(RG_NAME(AccumulationTexture));
+				data.accumulation = builder.ReadTexture(RG_NAME(AccumulationTexture), ReadAccess_NonPixelShader);
 			},
-			[=](PathTracingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=](PathTracingResolvePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 				GfxDescriptor src_descriptors[] =
 				{
-					ctx.GetReadWriteTexture(data.accumulation),
+					ctx.GetReadOnlyTexture(data.accumulation),
 					ctx.GetReadWriteTexture(data.output)
 				};
 				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
 				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
 				Uint32 const i = dst_descriptor.GetIndex();
 
-				struct PathTracingConstants
+				struct PathTracingResolveConstants
 				{
-					Int32   bounce_count;
-					Int32   accumulated_frames;
-					Uint32  accum_idx;
-					Uint32  output_idx;
+					Uint32 accum_idx;
+					Uint32 output_idx;
 				} constants =
 				{
-					.bounce_count = max_bounces, .accumulated_frames = accumulated_frames,
 					.accum_idx = i + 0, .output_idx = i + 1
 				};
 
+				cmd_list->SetPipelineState(resolve_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				auto& table = cmd_list->SetStateObject(path_tracing_so.get());
-				table.SetRayGenShader("PT_RayGen");
-				cmd_list->DispatchRays(width, height);
-
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		++accumulated_frames;
+		if (export_pending) AddExportPass(rg);
+
 		QueueGUI([&]()
 			{
 				if (ImGui::TreeNodeEx("Path tracing", ImGuiTreeNodeFlags_None))
 				{
-					ImGui::SliderInt("Max bounces", &max_bounces, 1, 8);
+					Int32 const target_samples = PathTracingTargetSamples.Get();
+					if (target_samples > 0) ImGui::Text("Samples: %d / %d", accumulated_frames, target_samples);
+					else ImGui::Text("Samples: %d", accumulated_frames);
+					ImGui::Text("Tiles per frame: %u / %u", tiles_per_frame, GetTileCount());
+
+					Bool changed = false;
+					changed |= ImGui::SliderInt("Max bounces", &max_bounces, 1, 8);
+					ImGui::SliderInt("Target samples", PathTracingTargetSamples.GetPtr(), 0, 16384);
+					ImGui::SliderFloat("Frame budget (ms)", PathTracingFrameBudget.GetPtr(), 1.0f, 100.0f);
+					changed |= ImGui::Checkbox("Adaptive sampling", PathTracingAdaptiveSampling.GetPtr());
+					if (PathTracingAdaptiveSampling.Get())
+					{
+						changed |= ImGui::SliderFloat("Variance threshold", PathTracingVarianceThreshold.GetPtr(), 0.00001f, 0.01f, "%.5f", ImGuiSliderFlags_Logarithmic);
+						changed |= ImGui::SliderInt("Min samples", PathTracingAdaptiveMinSamples.GetPtr(), 1, 256);
+					}
+					ImGui::Checkbox("Export on converge", PathTracingExportOnConverge.GetPtr());
+					if (ImGui::Button("Export HDR"))
+					{
+						RequestExport(paths::ScreenshotsDir + "PathTracing_" + std::to_string(accumulated_frames) + "spp.hdr");
+					}
+					if (changed) Reset();
 					ImGui::TreePop();
 					ImGui::Separator();
 				}
 			}
 		);
-
 	}
 
 	void PathTracingPass::OnResize(Uint32 w, Uint32 h)
@@ -107,6 +239,13 @@ namespace adria
 		accum_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
 		accum_desc.initial_state = GfxResourceState::ComputeUAV;
 		accumulation_texture = gfx->CreateTexture(accum_desc);
+
+		GfxTextureDesc moments_desc = accum_desc;
+		moments_desc.format = GfxFormat::R32G32_FLOAT;
+		moments_texture = gfx->CreateTexture(moments_desc);
+
+		if (!export_pending) export_buffer.reset();
+		Reset();
 	}
 
 	Bool PathTracingPass::IsSupported() const
@@ -117,6 +256,109 @@ namespace adria
 	void PathTracingPass::Reset()
 	{
 		accumulated_frames = 0;
+		tile_cursor = 0;
+		reset_accumulation = true;
+		export_filename.clear();
+	}
+
+	void PathTracingPass::RequestExport(std::string_view filename)
+	{
+		if (!IsSupported() || export_pending) return;
+		export_filename = filename;
+		export_pending = true;
+	}
+
+	Bool PathTracingPass::IsConverged() const
+	{
+		Int32 const target_samples = PathTracingTargetSamples.Get();
+		return target_samples > 0 && accumulated_frames >= target_samples;
+	}
+
+	void PathTracingPass::UpdateTileBudget()
+	{
+		Uint32 const tile_count = GetTileCount();
+		Uint32 const backbuffer_index = gfx->GetBackbufferIndex();
+		if (timestamp_valid[backbuffer_index])
+		{
+			Uint64 gpu_frequency = 0;
+			gfx->GetTimestampFrequency(gpu_frequency);
+			Uint64 const* timestamps = timestamp_readback_buffer->GetMappedData<Uint64>() + backbuffer_index * 2;
+			Float const elapsed_ms = Float(timestamps[1] - timestamps[0]) / gpu_frequency * 1000.0f;
+			if (elapsed_ms > 0.0f)
+			{
+				//scale the tile count towards the budget, but never more than double it per frame to avoid TDRs on expensive tiles
+				Float const budget_ms = std::max(PathTracingFrameBudget.Get(), 0.1f);
+				Float const tile_ms = elapsed_ms / tiles_per_frame;
+				Uint32 const budget_tiles = (Uint32)std::max(budget_ms / tile_ms, 1.0f);
+				tiles_per_frame = std::min(budget_tiles, tiles_per_frame * 2);
+			}
+		}
+		tiles_per_frame = std::clamp(tiles_per_frame, 1u, tile_count);
+	}
+
+	void PathTracingPass::AddExportPass(RenderGraph& rg)
+	{
+		if (!export_buffer)
+		{
+			GfxBufferDesc export_desc{};
+			export_desc.size = gfx->GetLinearBufferSize(accumulation_texture.get());
+			export_desc.resource_usage = GfxResourceUsage::Readback;
+			export_buffer = gfx->CreateBuffer(export_desc);
+		}
+		rg.ImportBuffer(RG_NAME(PT_ExportBuffer), export_buffer.get());
+
+		struct PathTracingExportPassData
+		{
+			RGBufferCopyDstId  dst;
+			RGTextureCopySrcId src;
+		};
+		rg.AddPass<PathTracingExportPassData>("Path Tracing Export Pass",
+			[=](PathTracingExportPassData& data, RenderGraphBuilder& builder)
+			{
+				data.dst = builder.WriteCopyDstBuffer(RG_NAME(PT_ExportBuffer));
+				data.src = builder.ReadCopySrcTexture(RG_NAME(AccumulationTexture));
+			},
+			[=](PathTracingExportPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxTexture const& src_texture = ctx.GetCopySrcTexture(data.src);
+				GfxBuffer& dst_buffer = ctx.GetCopyDstBuffer(data.dst);
+				cmd_list->CopyTextureToBuffer(dst_buffer, 0, src_texture, 0, 0);
+				cmd_list->Signal(export_fence, export_fence_value);
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
+
+		ADRIA_LOG(INFO, "Exporting path traced image with %d samples per pixel: %s", accumulated_frames, export_filename.c_str());
+		g_ThreadPool.Submit([this](std::string filename, Uint32 export_width, Uint32 export_height)
+			{
+				export_fence.Wait(export_fence_value);
+
+				//accumulation stores the radiance sum in rgb and the per-pixel sample count in alpha
+				Uint64 const row_pitch = export_buffer->GetSize() / export_height;
+				Uint8 const* src = export_buffer->GetMappedData<Uint8>();
+				std::vector<Float> pixels(export_width * export_height * 4);
+				for (Uint32 y = 0; y < export_height; ++y)
+				{
+					Float const* src_row = reinterpret_cast<Float const*>(src + y * row_pitch);
+					for (Uint32 x = 0; x < export_width; ++x)
+					{
+						Float const sample_count = std::max(src_row[x * 4 + 3], 1.0f);
+						Float* dst = &pixels[(y * export_width + x) * 4];
+						dst[0] = src_row[x * 4 + 0] / sample_count;
+						dst[1] = src_row[x * 4 + 1] / sample_count;
+						dst[2] = src_row[x * 4 + 2] / sample_count;
+						dst[3] = 1.0f;
+					}
+				}
+				WriteImageToFile(FileType::HDR, filename, export_width, export_height, pixels.data(), export_width * 4 * sizeof(Float));
+				ADRIA_LOG(INFO, "Path traced image saved to %s", filename.c_str());
+				export_fence_value++;
+				export_pending = false;
+			}, export_filename, width, height);
+	}
+
+	Uint32 PathTracingPass::GetTileCount() const
+	{
+		Uint32 const tile_size = (Uint32)std::max(PathTracingTileSize.Get(), 8);
+		return DivideAndRoundUp(width, tile_size) * DivideAndRoundUp(height, tile_size);
 	}
 
 	void PathTracingPass::CreateStateObject()
@@ -141,9 +383,7 @@ namespace adria
 			global_root_sig.pGlobalRootSignature = gfx->GetCommonRootSignature();
 			pt_state_object_builder.AddSubObject(global_root_sig);
 
-			D3D12_RAYTRACING_PIPELINE_CONFIG pipeline_config{};
-			pipeline_config.MaxTraceRecursionDepth = 3;
-			pt_state_object_builder.AddSubObject(pipeline_config);
+			pt_state_object_builder.AddRayTracingPipelineConfig(gfx, 3);
 
 			//D3D12_HIT_GROUP_DESC closesthit_group{};
 			//closesthit_group.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
@@ -154,6 +394,13 @@ namespace adria
 		path_tracing_so.reset(pt_state_object_builder.CreateStateObject(gfx));
 	}
 
+	void PathTracingPass::CreatePSO()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_PathTracingResolve;
+		resolve_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
 	void PathTracingPass::OnLibraryRecompiled(GfxShaderKey const& key)
 	{
 		if (key.GetShaderID() == LIB_PathTracing) CreateStateObject();
@@ -1,15 +1,19 @@
 #pragma once
-
+#include <atomic>
 #include "Graphics/GfxRayTracingShaderTable.h"
+#include "Graphics/GfxFence.h"
 #include "RenderGraph/RenderGraphResourceName.h"
 
 namespace adria
 {
 	class RenderGraph;
 	class GfxTexture;
+	class GfxBuffer;
 	class GfxDevice;
 	class GfxShaderKey;
 	class GfxStateObject;
+	class GfxQueryHeap;
+	class GfxComputePipelineState;
 
 	class PathTracingPass
 	{
@@ -21,17 +25,41 @@ namespace adria
 		Bool IsSupported() const;
 		void Reset();
 
+		void RequestExport(std::string_view filename);
+		Bool IsConverged() const;
+
 	private:
 		GfxDevice* gfx;
 		std::unique_ptr<GfxStateObject> path_tracing_so;
+		std::unique_ptr<GfxComputePipelineState> resolve_pso;
 		Uint32 width, height;
 		Bool is_supported;
 		std::unique_ptr<GfxTexture> accumulation_texture = nullptr;
-		Int32 accumulated_frames = 1;
+		std::unique_ptr<GfxTexture> moments_texture = nullptr;
+		Int32 accumulated_frames = 0;
 		Int32 max_bounces = 3;
 
+		Uint32 tile_cursor = 0;
+		Uint32 tiles_per_frame = 1;
+		Bool   reset_accumulation = true;
+
+		std::unique_ptr<GfxQueryHeap> timestamp_query_heap;
+		std::unique_ptr<GfxBuffer> timestamp_readback_buffer;
+		Bool timestamp_valid[GFX_BACKBUFFER_COUNT] = {};
+
+		std::string export_filename;
+		std::atomic<Bool> export_pending = false;
+		GfxFence export_fence;
+		Uint64 export_fence_value = 1;
+		std::unique_ptr<GfxBuffer> export_buffer;
+
 	private:
 		void CreateStateObject();
+		void CreatePSO();
 		void OnLibraryRecompiled(GfxShaderKey const&);
+
+		void UpdateTileBudget();
+		void AddExportPass(RenderGraph& rg);
+		Uint32 GetTileCount() const;
 	};
-}
\ No newline at end of file
+}
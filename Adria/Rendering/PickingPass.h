@@ -10,7 +10,6 @@ namespace adria
 	};
 
 	class GfxDevice;
-	class GfxBuffer;
 	class GfxComputePipelineState;
 	class RenderGraph;
 
@@ -24,16 +23,15 @@ namespace adria
 
 		void AddPass(RenderGraph& rg);
 
-		PickingData GetPickingData() const;
+		PickingData const& GetPickingData() const { return picking_data; }
 
 	private:
 		GfxDevice* gfx;
 		Uint32 width, height;
-		std::vector<std::unique_ptr<GfxBuffer>> read_picking_buffers;
+		PickingData picking_data{};
 		std::unique_ptr<GfxComputePipelineState> picking_pso;
 
 	private:
 		void CreatePSO();
-		void CreatePickingBuffers();
 	};
 }
\ No newline at end of file
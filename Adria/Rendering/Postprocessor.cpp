@@ -32,7 +32,7 @@ using namespace DirectX;
 
 namespace adria
 {
-	static TAutoConsoleVariable<int>  AmbientOcclusion("r.AmbientOcclusion", 1, "0 - No AO, 1 - SSAO, 2 - HBAO, 3 - CACAO, 4 - RTAO");
+	static TAutoConsoleVariable<int>  AmbientOcclusion("r.AmbientOcclusion", 1, "0 - No AO, 1 - SSAO, 2 - HBAO, 3 - CACAO, 4 - RTAO, 5 - GTAO");
 	
 	enum AmbientOcclusionType : Uint8
 	{
@@ -40,12 +40,14 @@ namespace adria
 		AmbientOcclusionType_SSAO,
 		AmbientOcclusionType_HBAO,
 		AmbientOcclusionType_CACAO,
-		AmbientOcclusionType_RTAO
+		AmbientOcclusionType_RTAO,
+		AmbientOcclusionType_GTAO
 	};
 
 	PostProcessor::PostProcessor(GfxDevice* gfx, entt::registry& reg, Uint32 width, Uint32 height)
 		: gfx(gfx), reg(reg), display_width(width), display_height(height), render_width(width), render_height(height),
-		ssao_pass(gfx, width, height), hbao_pass(gfx, width, height), rtao_pass(gfx, width, height), cacao_pass(gfx, width, height)
+		ssao_pass(gfx, width, height), hbao_pass(gfx, width, height), rtao_pass(gfx, width, height), cacao_pass(gfx, width, height),
+		gtao_pass(gfx, width, height)
 	{
 		ray_tracing_supported = gfx->GetCapabilities().SupportsRayTracing();
 		InitializePostEffects();
@@ -57,7 +59,7 @@ namespace adria
 	void PostProcessor::ImportHistoryResources(RenderGraph& rg)
 	{
 		rg.ImportTexture(RG_NAME(HistoryBuffer), history_buffer.get());
-		rg.ImportTexture(RG_NAME(DepthHistory), depth_history.get());
+		GetPostEffect<FFXVRSPass>()->ImportResources(rg);
 	}
 
 	void PostProcessor::OnRainEvent(Bool enabled)
@@ -65,6 +67,12 @@ namespace adria
 		GetPostEffect<VolumetricCloudsPass>()->OnRainEvent(enabled);
 	}
 
+	void PostProcessor::AddMotionVectorsPass(RenderGraph& rg)
+	{
+		//ray traced effects reproject their history in the denoiser, so velocity is needed before lighting
+		if (NeedsVelocityBuffer() || ray_tracing_ready) post_effects[PostEffectType_MotionVectors]->AddPass(rg, this);
+	}
+
 	void PostProcessor::AddAmbientOcclusionPass(RenderGraph& rg)
 	{
 		switch (AmbientOcclusion.Get())
@@ -72,7 +80,11 @@ namespace adria
 		case AmbientOcclusionType_SSAO:  ssao_pass.AddPass(rg); break;
 		case AmbientOcclusionType_HBAO:  hbao_pass.AddPass(rg); break;
 		case AmbientOcclusionType_CACAO: cacao_pass.AddPass(rg); break;
-		case AmbientOcclusionType_RTAO:  rtao_pass.AddPass(rg); break;
+		case AmbientOcclusionType_GTAO:  gtao_pass.AddPass(rg); break;
+		case AmbientOcclusionType_RTAO:
+			if (ray_tracing_ready) rtao_pass.AddPass(rg);
+			else ssao_pass.AddPass(rg);
+			break;
 		}
 	}
 
@@ -81,11 +93,11 @@ namespace adria
 		final_resource = RG_NAME(HDR_RenderTarget);
 		for (Uint32 i = 0; i < PostEffectType_Count; ++i)
 		{
+			if (i == PostEffectType_MotionVectors) continue;
 			if (post_effects[i]->IsEnabled(this)) post_effects[i]->AddPass(rg, this);
 		}
 
 		rg.ExportTexture(GetPostEffect<ToneMapPass>()->GetInput(), history_buffer.get());
-		rg.ExportTexture(RG_NAME(DepthStencil), depth_history.get());
 	}
 
 	void PostProcessor::AddTonemapPass(RenderGraph& rg, RGResourceName input)
@@ -105,7 +117,7 @@ namespace adria
 	{
 		QueueGUI([&]()
 			{
-				if (ImGui::Combo("Ambient Occlusion Type", AmbientOcclusion.GetPtr(), "None\0SSAO\0HBAO\0CACAO\0RTAO\0", 5))
+				if (ImGui::Combo("Ambient Occlusion Type", AmbientOcclusion.GetPtr(), "None\0SSAO\0HBAO\0CACAO\0RTAO\0GTAO\0", 6))
 				{
 					if (!ray_tracing_supported && AmbientOcclusion.Get() == 4) AmbientOcclusion->Set(AmbientOcclusionType_SSAO); 
 				}
@@ -116,6 +128,7 @@ namespace adria
 		case AmbientOcclusionType_HBAO:  hbao_pass.GUI();  break;
 		case AmbientOcclusionType_CACAO: cacao_pass.GUI(); break;
 		case AmbientOcclusionType_RTAO:  rtao_pass.GUI();  break;
+		case AmbientOcclusionType_GTAO:  gtao_pass.GUI();  break;
 		}
 
 		for (auto& post_effect : post_effects)
@@ -141,6 +154,11 @@ namespace adria
 		}
 	}
 
+	void PostProcessor::UpdateDynamicResolution()
+	{
+		GetPostEffect<UpscalerPassGroup>()->UpdateDynamicResolution();
+	}
+
 	void PostProcessor::OnRenderResolutionChanged(Uint32 w, Uint32 h)
 	{
 		render_width = w, render_height = h;
@@ -149,19 +167,12 @@ namespace adria
 		hbao_pass.OnResize(w, h);
 		cacao_pass.OnResize(w, h);
 		rtao_pass.OnResize(w, h);
+		gtao_pass.OnResize(w, h);
 
 		for (Uint32 i = 0; i < PostEffectType_Upscaler; ++i)
 		{
 			post_effects[i]->OnResize(w, h);
 		}
-
-		if (depth_history)
-		{
-			GfxTextureDesc depth_history_desc = depth_history->GetDesc();
-			depth_history_desc.width = w;
-			depth_history_desc.height = h;
-			depth_history = gfx->CreateTexture(depth_history_desc);
-		}
 	}
 
 	void PostProcessor::OnSceneInitialized()
@@ -194,9 +205,36 @@ namespace adria
 		return is_path_tracing_path;
 	}
 
+	FilmEffectsPass* PostProcessor::GetFusedFilmEffects() const
+	{
+		FilmEffectsPass* film_effects = GetPostEffect<FilmEffectsPass>();
+		return !is_path_tracing_path && film_effects->IsFused() ? film_effects : nullptr;
+	}
+
+	ExponentialHeightFogPass* PostProcessor::GetHeightFogPass() const
+	{
+		return GetPostEffect<ExponentialHeightFogPass>();
+	}
+
+	Int32 PostProcessor::GetCloudShadowMapIndex() const
+	{
+		return GetPostEffect<VolumetricCloudsPass>()->GetCloudShadowMapIndex();
+	}
+
+	Vector4 PostProcessor::GetCloudShadowParams() const
+	{
+		return GetPostEffect<VolumetricCloudsPass>()->GetCloudShadowParams();
+	}
+
 	Bool PostProcessor::NeedsVelocityBuffer() const
 	{
-		return HasTAA() || HasUpscaler() || post_effects[PostEffectType_Clouds]->IsEnabled(this) || post_effects[PostEffectType_MotionBlur]->IsEnabled(this);
+		Bool const gtao_temporal = AmbientOcclusion.Get() == AmbientOcclusionType_GTAO && gtao_pass.IsTemporal();
+		return HasTAA() || HasUpscaler() || gtao_temporal || post_effects[PostEffectType_Clouds]->IsEnabled(this) || post_effects[PostEffectType_MotionBlur]->IsEnabled(this);
+	}
+
+	Bool PostProcessor::NeedsHZB() const
+	{
+		return !is_path_tracing_path && post_effects[PostEffectType_Reflection]->IsEnabled(this) && GetPostEffect<ReflectionPassGroup>()->NeedsHZB();
 	}
 
 	Bool PostProcessor::NeedsHistoryBuffer() const
@@ -211,7 +249,7 @@ namespace adria
 
 	void PostProcessor::InitializePostEffects()
 	{
-		post_effects[PostEffectType_MotionVectors]	= std::make_unique<MotionVectorsPass>(gfx, render_width, render_height);
+		post_effects[PostEffectType_MotionVectors]	= std::make_unique<MotionVectorsPass>(gfx, reg, render_width, render_height);
 		post_effects[PostEffectType_VRS]			= std::make_unique<FFXVRSPass>(gfx, render_width, render_height);
 		post_effects[PostEffectType_LensFlare]		= std::make_unique<LensFlarePass>(gfx, render_width, render_height);
 		post_effects[PostEffectType_Sun]			= std::make_unique<SunPass>(gfx, render_width, render_height);
@@ -229,8 +267,6 @@ namespace adria
 		post_effects[PostEffectType_CAS]			= std::make_unique<FFXCASPass>(gfx, render_width, render_height);
 		post_effects[PostEffectType_ToneMap]		= std::make_unique<ToneMapPass>(gfx, render_width, render_height);
 		post_effects[PostEffectType_FXAA]			= std::make_unique<FXAAPass>(gfx, render_width, render_height);
-
-		GetPostEffect<UpscalerPassGroup>()->AddRenderResolutionChangedCallback(RenderResolutionChangedDelegate::CreateMember(&PostProcessor::OnRenderResolutionChanged, *this));
 	}
 
 	void PostProcessor::CreateHistoryResources()
@@ -242,14 +278,6 @@ namespace adria
 		render_target_desc.bind_flags = GfxBindFlag::ShaderResource;
 		render_target_desc.initial_state = GfxResourceState::CopyDst;
 		history_buffer = gfx->CreateTexture(render_target_desc);
-
-		GfxTextureDesc depth_target_desc{};
-		depth_target_desc.format = GfxFormat::D32_FLOAT;
-		depth_target_desc.width = render_width;
-		depth_target_desc.height = render_height;
-		depth_target_desc.bind_flags = GfxBindFlag::ShaderResource;
-		depth_target_desc.initial_state = GfxResourceState::CopyDst;
-		depth_history = gfx->CreateTexture(depth_target_desc);
 	}
 
 	template<typename PostEffectT> requires std::is_base_of_v<PostEffect, PostEffectT>
@@ -259,6 +287,10 @@ namespace adria
 		{
 			return static_cast<PostEffectT*>(post_effects[PostEffectType_MotionVectors].get());
 		}
+		else if constexpr (std::is_same_v<PostEffectT, FFXVRSPass>)
+		{
+			return static_cast<PostEffectT*>(post_effects[PostEffectType_VRS].get());
+		}
 		else if constexpr (std::is_same_v<PostEffectT, LensFlarePass>)
 		{
 			return static_cast<PostEffectT*>(post_effects[PostEffectType_LensFlare].get());
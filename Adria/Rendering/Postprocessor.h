@@ -1,6 +1,7 @@
 #pragma once
 #include "SSAOPass.h"
 #include "HBAOPass.h"
+#include "GTAOPass.h"
 #include "RayTracedAmbientOcclusionPass.h"
 #include "FFXCACAOPass.h"
 #include "Utilities/Delegate.h"
@@ -14,12 +15,16 @@ namespace adria
 	class GfxTexture;
 	class GfxBuffer;
 	class PostEffect;
+	class FilmEffectsPass;
+	class ExponentialHeightFogPass;
 	struct Light;
 	class RainEvent;
+	class OcclusionQueryPass;
 
 	enum AmbientOcclusionType : Uint8;
 	enum class UpscalerType : Uint8;
 	enum AntiAliasing : Uint8;
+	enum class GfxColorSpace : Uint8;
 
 	using RenderResolutionChangedDelegate = Delegate<void(Uint32, Uint32)>;
 	class PostProcessor
@@ -53,6 +58,7 @@ namespace adria
 
 		void ImportHistoryResources(RenderGraph& rg);
 
+		void AddMotionVectorsPass(RenderGraph& rg);
 		void AddAmbientOcclusionPass(RenderGraph& rg);
 		void AddPasses(RenderGraph& rg);
 		void AddTonemapPass(RenderGraph& rg, RGResourceName input);
@@ -62,15 +68,23 @@ namespace adria
 		void OnRainEvent(Bool enabled);
 		void OnResize(Uint32 w, Uint32 h);
 		void OnRenderResolutionChanged(Uint32 w, Uint32 h);
+		void UpdateDynamicResolution();
 		void OnSceneInitialized();
 
 		Bool NeedsJitter() const { return HasTAA() || HasUpscaler(); }
 		Bool NeedsVelocityBuffer() const;
+		Bool NeedsHZB() const;
 		Bool NeedsHistoryBuffer() const;
 		Bool HasUpscaler() const;
 		Bool HasTAA() const;
 		Bool HasFXAA() const;
 		Bool IsPathTracing() const;
+		FilmEffectsPass* GetFusedFilmEffects() const;
+		ExponentialHeightFogPass* GetHeightFogPass() const;
+		Int32 GetCloudShadowMapIndex() const;
+		Vector4 GetCloudShadowParams() const;
+		Bool IsRayTracingReady() const { return ray_tracing_ready; }
+		void SetRayTracingReady(Bool ready) { ray_tracing_ready = ready; }
 
 		void SetFinalResource(RGResourceName name)
 		{
@@ -78,6 +92,10 @@ namespace adria
 		}
 		RGResourceName GetFinalResource() const;
 		entt::registry& GetRegistry() const { return reg; }
+		void SetOcclusionQueryPass(OcclusionQueryPass* queries) { occlusion_queries = queries; }
+		OcclusionQueryPass* GetOcclusionQueryPass() const { return occlusion_queries; }
+		void SetOutputColorSpace(GfxColorSpace color_space) { output_color_space = color_space; }
+		GfxColorSpace GetOutputColorSpace() const { return output_color_space; }
 
 	private:
 		GfxDevice* gfx;
@@ -87,18 +105,21 @@ namespace adria
 		Uint32 render_width;
 		Uint32 render_height;
 		Bool ray_tracing_supported = false;
+		Bool ray_tracing_ready = false;
 		Bool is_path_tracing_path = false;
 
 		RGResourceName final_resource;
+		OcclusionQueryPass* occlusion_queries = nullptr;
+		GfxColorSpace output_color_space{};
 
 		SSAOPass	 ssao_pass;
 		HBAOPass     hbao_pass;
 		FFXCACAOPass cacao_pass;
 		RayTracedAmbientOcclusionPass rtao_pass;
+		GTAOPass     gtao_pass;
 
 		std::array<std::unique_ptr<PostEffect>, PostEffectType_Count> post_effects;
 		std::unique_ptr<GfxTexture> history_buffer;
-		std::unique_ptr<GfxTexture> depth_history;
 
 	private:
 		void InitializePostEffects();
@@ -0,0 +1,269 @@
+#include <fstream>
+#include <filesystem>
+#include "ProceduralTextureCache.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxReadbackQueue.h"
+#include "Graphics/GfxMemoryTracker.h"
+#include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
+#include "Logging/Logger.h"
+#include "Utilities/ThreadPool.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> ProceduralCache("r.ProceduralCache", true, "Bake procedurally generated textures to disk and reload them while their generation parameters are unchanged");
+
+	namespace
+	{
+		constexpr Uint32 MakeFourCC(Uint32 a, Uint32 b, Uint32 c, Uint32 d) { return a | (b << 8u) | (c << 16u) | (d << 24u); }
+
+		constexpr Uint32 PROCEDURAL_TEXTURE_MAGIC = MakeFourCC('P', 'R', 'O', 'C');
+		constexpr Uint32 PROCEDURAL_TEXTURE_VERSION = 1;
+
+#pragma pack(push,1)
+		struct DDSPixelFormat
+		{
+			Uint32 dwSize;
+			Uint32 dwFlags;
+			Uint32 dwFourCC;
+			Uint32 dwRGBBitCount;
+			Uint32 dwRBitMask;
+			Uint32 dwGBitMask;
+			Uint32 dwBBitMask;
+			Uint32 dwABitMask;
+		};
+
+		struct DDSFileHeader
+		{
+			Uint32 dwSize;
+			Uint32 dwFlags;
+			Uint32 dwHeight;
+			Uint32 dwWidth;
+			Uint32 dwLinearSize;
+			Uint32 dwDepth;
+			Uint32 dwMipMapCount;
+			Uint32 dwReserved1[11];
+			DDSPixelFormat ddpf;
+			Uint32 dwCaps;
+			Uint32 dwCaps2;
+			Uint32 dwCaps3;
+			Uint32 dwCaps4;
+			Uint32 dwReserved2;
+		};
+
+		struct DDSHeaderDX10
+		{
+			Uint32 dxgiFormat;
+			Uint32 resourceDimension;
+			Uint32 miscFlag;
+			Uint32 arraySize;
+			Uint32 miscFlags2;
+		};
+#pragma pack(pop)
+
+		//dwReserved1 is free for tool use, the cache keeps its validation data there
+		enum ProceduralTextureReserved
+		{
+			ProceduralTextureReserved_Magic,
+			ProceduralTextureReserved_Version,
+			ProceduralTextureReserved_HashLow,
+			ProceduralTextureReserved_HashHigh
+		};
+
+		struct ProceduralDataHeader
+		{
+			Uint32 magic;
+			Uint32 version;
+			Uint64 hash;
+			Uint64 size;
+		};
+
+		std::string GetProceduralTexturePath(std::string const& name)
+		{
+			return paths::ProceduralCacheDir + name + ".dds";
+		}
+		std::string GetProceduralDataPath(std::string const& name)
+		{
+			return paths::ProceduralCacheDir + name + ".bin";
+		}
+
+		//writes next to the destination first so a reader never sees a partially written file
+		template<typename F>
+		void WriteCacheFile(std::string const& cache_path, Uint64 hash, F&& write)
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(paths::ProceduralCacheDir, ec);
+			std::string const temp_path = cache_path + "." + std::to_string(hash) + ".tmp";
+			{
+				std::ofstream os(temp_path, std::ios::binary);
+				if (!os) return;
+				write(os);
+				if (!os) return;
+			}
+			std::filesystem::rename(temp_path, cache_path, ec);
+			if (ec) ADRIA_LOG(WARNING, "Failed to write procedural cache file %s", cache_path.c_str());
+			else ADRIA_LOG(INFO, "Baked procedural cache file %s", cache_path.c_str());
+		}
+
+		Uint32 GetDepth(GfxTextureDesc const& desc)
+		{
+			return desc.type == GfxTextureType_3D ? std::max(desc.depth, 1u) : 1u;
+		}
+		Uint32 GetArraySize(GfxTextureDesc const& desc)
+		{
+			return desc.type == GfxTextureType_3D ? 1u : std::max(desc.array_size, 1u);
+		}
+
+		void WriteProceduralTexture(std::string const& name, Uint64 hash, GfxTextureDesc const& desc, std::vector<Uint8> const& data)
+		{
+			DDSFileHeader header{};
+			header.dwSize = sizeof(DDSFileHeader);
+			header.dwFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | (desc.type == GfxTextureType_3D ? 0x800000 : 0x0);
+			header.dwHeight = desc.height;
+			header.dwWidth = desc.width;
+			header.dwDepth = GetDepth(desc);
+			header.dwMipMapCount = desc.mip_levels;
+			header.dwCaps = 0x1000 | 0x400000 | 0x8;
+			header.dwCaps2 = desc.type == GfxTextureType_3D ? 0x200000 : 0x0;
+			header.dwReserved1[ProceduralTextureReserved_Magic] = PROCEDURAL_TEXTURE_MAGIC;
+			header.dwReserved1[ProceduralTextureReserved_Version] = PROCEDURAL_TEXTURE_VERSION;
+			header.dwReserved1[ProceduralTextureReserved_HashLow] = (Uint32)hash;
+			header.dwReserved1[ProceduralTextureReserved_HashHigh] = (Uint32)(hash >> 32);
+			header.ddpf.dwSize = sizeof(DDSPixelFormat);
+			header.ddpf.dwFlags = 0x4;
+			header.ddpf.dwFourCC = MakeFourCC('D', 'X', '1', '0');
+
+			DDSHeaderDX10 header_dx10{};
+			header_dx10.dxgiFormat = (Uint32)ConvertGfxFormat(desc.format);
+			header_dx10.resourceDimension = desc.type == GfxTextureType_3D ? 4 : 3;
+			header_dx10.arraySize = GetArraySize(desc);
+
+			WriteCacheFile(GetProceduralTexturePath(name), hash, [&](std::ofstream& os)
+				{
+					Uint32 const magic = MakeFourCC('D', 'D', 'S', ' ');
+					os.write(reinterpret_cast<Char const*>(&magic), sizeof(magic));
+					os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+					os.write(reinterpret_cast<Char const*>(&header_dx10), sizeof(header_dx10));
+					os.write(reinterpret_cast<Char const*>(data.data()), data.size());
+				});
+		}
+	}
+
+	std::unique_ptr<GfxTexture> LoadProceduralTexture(GfxDevice* gfx, std::string const& name, Uint64 hash, GfxTextureDesc const& desc)
+	{
+		if (!ProceduralCache.Get()) return nullptr;
+
+		std::ifstream is(GetProceduralTexturePath(name), std::ios::binary);
+		if (!is) return nullptr;
+
+		Uint32 magic = 0;
+		DDSFileHeader header{};
+		DDSHeaderDX10 header_dx10{};
+		is.read(reinterpret_cast<Char*>(&magic), sizeof(magic));
+		is.read(reinterpret_cast<Char*>(&header), sizeof(header));
+		is.read(reinterpret_cast<Char*>(&header_dx10), sizeof(header_dx10));
+		if (!is || magic != MakeFourCC('D', 'D', 'S', ' ')) return nullptr;
+
+		Uint32 const* reserved = header.dwReserved1;
+		Bool const valid = reserved[ProceduralTextureReserved_Magic] == PROCEDURAL_TEXTURE_MAGIC &&
+						   reserved[ProceduralTextureReserved_Version] == PROCEDURAL_TEXTURE_VERSION &&
+						   reserved[ProceduralTextureReserved_HashLow] == (Uint32)hash &&
+						   reserved[ProceduralTextureReserved_HashHigh] == (Uint32)(hash >> 32) &&
+						   header.dwWidth == desc.width && header.dwHeight == desc.height && header.dwDepth == GetDepth(desc) &&
+						   header.dwMipMapCount == desc.mip_levels && header_dx10.arraySize == GetArraySize(desc) &&
+						   header_dx10.dxgiFormat == (Uint32)ConvertGfxFormat(desc.format);
+		if (!valid) return nullptr;
+
+		Uint32 const depth = GetDepth(desc);
+		Uint32 const array_size = GetArraySize(desc);
+		std::vector<Uint8> data(GetTextureByteSize(desc.format, desc.width, desc.height, depth, desc.mip_levels) * array_size);
+		is.read(reinterpret_cast<Char*>(data.data()), data.size());
+		if (!is) return nullptr;
+
+		std::vector<GfxTextureSubData> sub_data;
+		Uint64 offset = 0;
+		for (Uint32 slice = 0; slice < array_size; ++slice)
+		{
+			for (Uint32 mip = 0; mip < desc.mip_levels; ++mip)
+			{
+				GfxTextureSubData& subresource = sub_data.emplace_back();
+				subresource.data = data.data() + offset;
+				subresource.row_pitch = GetRowPitch(desc.format, desc.width, mip);
+				subresource.slice_pitch = GetSlicePitch(desc.format, desc.width, desc.height, mip);
+				offset += GetTextureMipByteSize(desc.format, desc.width, desc.height, depth, mip);
+			}
+		}
+
+		GfxTextureData init_data{};
+		init_data.sub_data = sub_data.data();
+		init_data.sub_count = (Uint32)sub_data.size();
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::Textures);
+		return gfx->CreateTexture(desc, init_data);
+	}
+
+	void SaveProceduralTexture(GfxDevice* gfx, GfxCommandList* cmd_list, GfxTexture const& texture, std::string const& name, Uint64 hash)
+	{
+		if (!ProceduralCache.Get()) return;
+
+		GfxTextureDesc const desc = texture.GetDesc();
+		D3D12_RESOURCE_DESC const resource_desc = texture.GetNative()->GetDesc();
+		Uint32 const subresource_count = desc.mip_levels * GetArraySize(desc);
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresource_count);
+		std::vector<Uint32> row_counts(subresource_count);
+		std::vector<Uint64> row_sizes(subresource_count);
+		gfx->GetDevice()->GetCopyableFootprints(&resource_desc, 0, subresource_count, 0, footprints.data(), row_counts.data(), row_sizes.data(), nullptr);
+
+		gfx->GetReadbackQueue()->EnqueueSubresources(cmd_list, texture, [=](void const* readback_data, Uint64)
+			{
+				//strip the footprint row padding so the file holds tightly packed subresources
+				Uint8 const* src = static_cast<Uint8 const*>(readback_data);
+				std::vector<Uint8> data;
+				for (Uint32 i = 0; i < subresource_count; ++i)
+				{
+					D3D12_SUBRESOURCE_FOOTPRINT const& footprint = footprints[i].Footprint;
+					for (Uint32 z = 0; z < footprint.Depth; ++z)
+					{
+						for (Uint32 row = 0; row < row_counts[i]; ++row)
+						{
+							Uint8 const* row_data = src + footprints[i].Offset + (Uint64(z) * row_counts[i] + row) * footprint.RowPitch;
+							data.insert(data.end(), row_data, row_data + row_sizes[i]);
+						}
+					}
+				}
+				g_ThreadPool.Submit([name, hash, desc, data = std::move(data)]() { WriteProceduralTexture(name, hash, desc, data); });
+			});
+	}
+
+	Bool LoadProceduralData(std::string const& name, Uint64 hash, std::vector<Uint8>& data)
+	{
+		if (!ProceduralCache.Get()) return false;
+
+		std::ifstream is(GetProceduralDataPath(name), std::ios::binary);
+		if (!is) return false;
+
+		ProceduralDataHeader header{};
+		is.read(reinterpret_cast<Char*>(&header), sizeof(header));
+		if (!is || header.magic != PROCEDURAL_TEXTURE_MAGIC || header.version != PROCEDURAL_TEXTURE_VERSION || header.hash != hash) return false;
+
+		data.resize(header.size);
+		is.read(reinterpret_cast<Char*>(data.data()), data.size());
+		return (Bool)is;
+	}
+
+	void SaveProceduralData(std::string const& name, Uint64 hash, std::vector<Uint8>&& data)
+	{
+		if (!ProceduralCache.Get()) return;
+
+		g_ThreadPool.Submit([name, hash, data = std::move(data)]()
+			{
+				ProceduralDataHeader const header{ .magic = PROCEDURAL_TEXTURE_MAGIC, .version = PROCEDURAL_TEXTURE_VERSION, .hash = hash, .size = data.size() };
+				WriteCacheFile(GetProceduralDataPath(name), hash, [&](std::ofstream& os)
+					{
+						os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+						os.write(reinterpret_cast<Char const*>(data.data()), data.size());
+					});
+			});
+	}
+}
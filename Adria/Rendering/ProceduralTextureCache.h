@@ -0,0 +1,22 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxTexture;
+	class GfxCommandList;
+	struct GfxTextureDesc;
+
+	//contents of procedurally generated textures are baked to dds files keyed by a hash of their generation parameters,
+	//so the passes that produce them only run again after the parameters change
+	std::unique_ptr<GfxTexture> LoadProceduralTexture(GfxDevice* gfx, std::string const& name, Uint64 hash, GfxTextureDesc const& desc);
+	//cmd_list has to be a graphics command list and texture has to be in copy source state
+	void SaveProceduralTexture(GfxDevice* gfx, GfxCommandList* cmd_list, GfxTexture const& texture, std::string const& name, Uint64 hash);
+
+	//raw bytes that belong to a baked texture set, written on the thread pool
+	Bool LoadProceduralData(std::string const& name, Uint64 hash, std::vector<Uint8>& data);
+	void SaveProceduralData(std::string const& name, Uint64 hash, std::vector<Uint8>&& data);
+}
@@ -9,24 +9,21 @@
 #include "Graphics/GfxReflection.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/HashUtil.h"
 #include "entt/entity/registry.hpp"
 
 using namespace DirectX;
 namespace adria
 {
-	static std::pair<Matrix, Matrix> RainBlockerMatrices(Vector4 const& camera_position, Uint32 map_size)
+	static TAutoConsoleVariable<Bool> RainBlockerCaching("r.Rain.BlockerCaching", true, "Keep the rain blocker map until the camera moves to another grid cell or the covered geometry changes");
+
+	static std::pair<Matrix, Matrix> RainBlockerMatrices(Vector2 const& center, Float extent, Float height)
 	{
-		Vector3 const max_extents(50.0f, 50.0f, 50.0f);
-		Vector3 const min_extents = -max_extents;
-
-		Float l = min_extents.x;
-		Float b = min_extents.y;
-		Float n = 1.0f;
-		Float r = max_extents.x;
-		Float t = max_extents.y;
-		Float f = (1000 - camera_position.y) * 1.5f;
-		Matrix V = XMMatrixLookAtLH(Vector4(0, 1000, 0, 1), camera_position, Vector3::Forward);
-		Matrix P = XMMatrixOrthographicOffCenterLH(l, r, b, t, n, f);
+		Vector3 const eye(center.x, height, center.y);
+		Vector3 const target(center.x, 0.0f, center.y);
+		Matrix V = XMMatrixLookAtLH(eye, target, Vector3::Forward);
+		Matrix P = XMMatrixOrthographicOffCenterLH(-extent, extent, -extent, extent, 1.0f, 2.0f * height);
 		return { V,P };
 	}
 
@@ -49,7 +46,20 @@ namespace adria
 	{
 		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
 
-		auto [V, P] = RainBlockerMatrices(Vector4(frame_data.camera_position), BLOCKER_DIM);
+		//snapping to whole cells keeps the map and its texels fixed in world space while the camera stays in a cell
+		Float const cell_size = 2.0f * BLOCKER_EXTENT / BLOCKER_CELLS;
+		Vector2 const center(std::floor(frame_data.camera_position[0] / cell_size + 0.5f) * cell_size, std::floor(frame_data.camera_position[2] / cell_size + 0.5f) * cell_size);
+		BoundingBox const blocker_bounds(Vector3(center.x, 0.0f, center.y), Vector3(BLOCKER_EXTENT, BLOCKER_HEIGHT, BLOCKER_EXTENT));
+
+		std::vector<Batch const*> blockers;
+		Uint64 hash = 0;
+		Bool const has_dynamic_blockers = GatherBlockers(blocker_bounds, blockers, hash);
+		if (RainBlockerCaching.Get() && blocker_map_valid && !has_dynamic_blockers && blocker_hash == hash && blocker_center == center) return;
+		blocker_map_valid = true;
+		blocker_hash = hash;
+		blocker_center = center;
+
+		auto [V, P] = RainBlockerMatrices(center, BLOCKER_EXTENT, BLOCKER_HEIGHT);
 		view_projection = V * P;
 
 		rendergraph.ImportTexture(RG_NAME(RainBlocker), blocker_map.get());
@@ -59,10 +69,8 @@ namespace adria
 				builder.WriteDepthStencil(RG_NAME(RainBlocker), RGLoadStoreAccessOp::Clear_Preserve);
 				builder.SetViewport(BLOCKER_DIM, BLOCKER_DIM);
 			},
-			[=](RenderGraphContext& context, GfxCommandList* cmd_list)
+			[=, blockers = std::move(blockers)](RenderGraphContext& context, GfxCommandList* cmd_list)
 			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				struct RainBlockerConstants
 				{
@@ -72,13 +80,11 @@ namespace adria
 					.rain_view_projection = view_projection
 				};
 				cmd_list->SetRootCBV(2, rain_constants);
+				cmd_list->SetPipelineState(rain_blocker_pso.get());
 
-				auto batch_view = reg.view<Batch>();
-				for (auto batch_entity : batch_view)
+				for (Batch const* blocker : blockers)
 				{
-					Batch& batch = batch_view.get<Batch>(batch_entity);
-					cmd_list->SetPipelineState(rain_blocker_pso.get());
-
+					Batch const& batch = *blocker;
 					struct GBufferConstants
 					{
 						Uint32 instance_id;
@@ -106,6 +112,30 @@ namespace adria
 		return (Int32)blocker_map_srv_gpu.GetIndex();
 	}
 
+	//returns true when a moving or skinned batch is covered by the map, its contents can't be kept then
+	Bool RainBlockerMapPass::GatherBlockers(BoundingBox const& blocker_bounds, std::vector<Batch const*>& blockers, Uint64& hash) const
+	{
+		Bool has_dynamic_blockers = false;
+		for (auto batch_entity : reg.view<Batch>())
+		{
+			Batch const& batch = reg.get<Batch>(batch_entity);
+			if (!blocker_bounds.Intersects(batch.bounding_box)) continue;
+			if (batch.dynamic) has_dynamic_blockers = true;
+			blockers.push_back(&batch);
+		}
+		std::sort(blockers.begin(), blockers.end(), [](Batch const* lhs, Batch const* rhs) { return lhs->instance_id < rhs->instance_id; });
+
+		HashState hash_state;
+		hash_state.Combine(blockers.size());
+		for (Batch const* blocker : blockers)
+		{
+			hash_state.Combine(blocker->instance_id);
+			hash_state.Combine(crc64(reinterpret_cast<Char const*>(&blocker->bounding_box), sizeof(blocker->bounding_box)));
+		}
+		hash = hash_state;
+		return has_dynamic_blockers;
+	}
+
 	void RainBlockerMapPass::CreatePSOs()
 	{
 		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
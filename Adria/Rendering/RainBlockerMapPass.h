@@ -9,10 +9,16 @@ namespace adria
 	class GfxDevice;
 	class GfxGraphicsPipelineState;
 	class RenderGraph;
+	struct Batch;
 	
+	//top down occlusion map for rain, centered on a world space grid cell around the camera and only redrawn when
+	//the camera moves to another cell or the batches covered by the map change
 	class RainBlockerMapPass
 	{
 		static constexpr Uint32 BLOCKER_DIM = 256;
+		static constexpr Float BLOCKER_EXTENT = 50.0f;
+		static constexpr Float BLOCKER_HEIGHT = 1000.0f;
+		static constexpr Uint32 BLOCKER_CELLS = 8;
 	public:
 		RainBlockerMapPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
 
@@ -27,11 +33,15 @@ namespace adria
 		GfxDevice* gfx;
 		Uint32 width, height;
 		Matrix view_projection;
+		Vector2 blocker_center;
+		Uint64 blocker_hash = 0;
+		Bool blocker_map_valid = false;
 		std::unique_ptr<GfxTexture> blocker_map;
 		GfxDescriptor blocker_map_srv;
 		std::unique_ptr<GfxGraphicsPipelineState> rain_blocker_pso;
 
 	private:
 		void CreatePSOs();
+		Bool GatherBlockers(BoundingBox const& blocker_bounds, std::vector<Batch const*>& blockers, Uint64& hash) const;
 	};
 }
\ No newline at end of file
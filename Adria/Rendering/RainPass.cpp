@@ -1,4 +1,5 @@
 #include "RainPass.h"
+#include "Components.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h" 
 #include "TextureManager.h"
@@ -9,10 +10,12 @@
 #include "Core/Paths.h"
 #include "Core/ConsoleManager.h"
 #include "Utilities/Random.h"
+#include "entt/entity/registry.hpp"
 
 namespace adria
 {
 	static TAutoConsoleVariable<Bool> Rain("r.Rain", false, "Enable Rain");
+	static TAutoConsoleVariable<Bool> RainParticles("r.Rain.GPUParticles", false, "Simulate and draw rain drops as GPU particles instead of the rain volume around the camera");
 	
 	struct RainData
 	{
@@ -21,7 +24,7 @@ namespace adria
 		Float   state;
 	};
 	
-	RainPass::RainPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), rain_blocker_map_pass(reg, gfx, w, h)
+	RainPass::RainPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h) : reg(reg), gfx(gfx), width(w), height(h), rain_blocker_map_pass(reg, gfx, w, h)
 	{
 		CreatePSOs();
 		Rain->AddOnChanged(ConsoleVariableDelegate::CreateLambda([this](IConsoleVariable* cvar) { OnRainEnabled(cvar->GetBool()); }));
@@ -33,6 +36,7 @@ namespace adria
 		{
 			rain_total_time += dt;
 		}
+		UpdateRainEmitter();
 	}
 
 	void RainPass::AddBlockerPass(RenderGraph& rg)
@@ -42,6 +46,8 @@ namespace adria
 
 	void RainPass::AddPass(RenderGraph& rg)
 	{
+		if (RainParticles.Get()) return;
+
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 		rg.ImportBuffer(RG_NAME(RainDataBuffer), rain_data_buffer.get());
 
@@ -118,7 +124,7 @@ namespace adria
 				} constants =
 				{
 					.rain_data_idx = i,
-					.rain_streak_idx = (Uint32)rain_streak_handle,
+					.rain_streak_idx = GetTextureIndex(rain_streak_handle),
 					.rain_streak_scale = streak_scale
 				};
 
@@ -141,6 +147,7 @@ namespace adria
 					if (Rain.Get())
 					{
 						ImGui::Checkbox("Pause simulation", &pause_simulation);
+						ImGui::Checkbox("GPU Particles", RainParticles.GetPtr());
 						if (ImGui::Checkbox("Cheap", &cheap))
 						{
 							OnRainEnabled(true);
@@ -182,6 +189,37 @@ namespace adria
 		rain_data_buffer = std::make_unique<GfxBuffer>(gfx, rain_data_buffer_desc, rain_data_buffer_init.data());
 	}
 
+	void RainPass::UpdateRainEmitter()
+	{
+		Bool const emit = Rain.Get() && RainParticles.Get();
+		if (!reg.valid(rain_emitter))
+		{
+			if (!emit) return;
+			rain_emitter = reg.create();
+			reg.emplace<ParticleEmitter>(rain_emitter);
+		}
+
+		//drops spawn on a disc above the camera and die when they hit the depth buffer
+		ParticleEmitter& emitter = reg.get<ParticleEmitter>(rain_emitter);
+		Float const fall_speed = RAIN_FALL_SPEED * simulation_speed;
+		emitter.active = emit && !pause_simulation;
+		emitter.camera_relative = true;
+		emitter.velocity_aligned = true;
+		emitter.collisions = true;
+		emitter.restitution = 0.0f;
+		emitter.gravity_scale = 0.0f;
+		emitter.position = Vector3(0.0f, RAIN_EMITTER_HEIGHT, 0.0f);
+		emitter.position_variance = Vector3(range_radius, 0.0f, range_radius);
+		emitter.velocity = Vector3(0.0f, -fall_speed, 0.0f);
+		emitter.velocity_variance = Vector3(0.0f, simulation_speed, 0.0f);
+		emitter.lifetime = 2.0f * RAIN_EMITTER_HEIGHT / fall_speed;
+		emitter.lifetime_variance = 0.0f;
+		emitter.particles_per_second = rain_density * MAX_RAIN_DATA_BUFFER_SIZE / emitter.lifetime;
+		emitter.start_size = emitter.end_size = 0.05f * streak_scale;
+		emitter.start_color = emitter.end_color = Vector4(1.0f, 1.0f, 1.0f, 0.5f);
+		emitter.texture = rain_streak_handle;
+	}
+
 	void RainPass::CreatePSOs()
 	{
 		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
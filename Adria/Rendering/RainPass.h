@@ -4,6 +4,7 @@
 #include "RainBlockerMapPass.h"
 #include "Graphics/GfxDescriptor.h"
 #include "Utilities/Delegate.h"
+#include "entt/entity/entity.hpp"
 
 namespace adria
 {
@@ -18,6 +19,8 @@ namespace adria
 	class RainPass
 	{
 		static constexpr Uint32 MAX_RAIN_DATA_BUFFER_SIZE = 1 << 20;
+		static constexpr Float RAIN_EMITTER_HEIGHT = 20.0f;
+		static constexpr Float RAIN_FALL_SPEED = 10.0f;
 
 	public:
 		RainPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
@@ -46,8 +49,10 @@ namespace adria
 		Int32 GetRainBlockerMapIndex()    const { return rain_blocker_map_pass.GetRainBlockerMapIdx(); }
 		Matrix GetRainViewProjection()    const { return rain_blocker_map_pass.GetViewProjection(); }
 	private:
+		entt::registry& reg;
 		GfxDevice* gfx;
 		std::unique_ptr<GfxBuffer> rain_data_buffer;
+		entt::entity rain_emitter = entt::null;
 		Uint32 width;
 		Uint32 height;
 
@@ -69,5 +74,6 @@ namespace adria
 
 	private:
 		void CreatePSOs();
+		void UpdateRainEmitter();
 	};
 }
\ No newline at end of file
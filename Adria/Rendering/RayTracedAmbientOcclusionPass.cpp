@@ -7,18 +7,22 @@
 #include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> RTAOHalfResolution("r.RTAO.HalfResolution", true, "Trace RTAO rays at half resolution and let the denoiser upsample them");
+	static TAutoConsoleVariable<Bool> RTAOInline("r.RTAO.Inline", true, "Use inline ray tracing (RayQuery) for RTAO when DXR 1.1 is supported");
 	
 	RayTracedAmbientOcclusionPass::RayTracedAmbientOcclusionPass(GfxDevice* gfx, Uint32 width, Uint32 height)
-		: gfx(gfx), width(width), height(height), blur_pass(gfx)
+		: gfx(gfx), width(width), height(height), denoiser(gfx, width, height, GfxFormat::R16_FLOAT)
 	{
 		is_supported = gfx->GetCapabilities().SupportsRayTracing();
+		is_inline_supported = gfx->GetCapabilities().CheckRayTracingSupport(RayTracingSupport::Tier1_1);
 		if (IsSupported())
 		{
-			CreatePSO();
 			CreateStateObject();
+			if (is_inline_supported) CreatePSO();
 			ShaderManager::GetLibraryRecompiledEvent().AddMember(&RayTracedAmbientOcclusionPass::OnLibraryRecompiled, *this);
 		}
 	}
@@ -30,6 +34,11 @@ namespace adria
 		if (!IsSupported()) return;
 
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const resolution_scale = RTAOHalfResolution.Get() ? 2 : 1;
+		Uint32 const trace_width = DivideAndRoundUp(width, resolution_scale);
+		Uint32 const trace_height = DivideAndRoundUp(height, resolution_scale);
+		Bool const use_inline = is_inline_supported && RTAOInline.Get();
+
 		struct RayTracedAmbientOcclusionPassData
 		{
 			RGTextureReadOnlyId depth;
@@ -41,8 +50,8 @@ namespace adria
 			[=](RayTracedAmbientOcclusionPassData& data, RGBuilder& builder)
 			{
 				RGTextureDesc desc{};
-				desc.width = width;
-				desc.height = height;
+				desc.width = trace_width;
+				desc.height = trace_height;
 				desc.format = GfxFormat::R8_UNORM;
 				builder.DeclareTexture(RG_NAME(RTAO_Output), desc);
 
@@ -70,12 +79,23 @@ namespace adria
 					Uint32  output_idx;
 					Float   ao_radius;
 					Float   ao_power;
+					Uint32  resolution_scale;
 				} constants =
 				{
 					.depth_idx = i + 0, .gbuf_normals_idx = i + 1, .output_idx = i + 2,
-					.ao_radius = params.radius, .ao_power = pow(2.f, params.power_log)
+					.ao_radius = params.radius, .ao_power = pow(2.f, params.power_log),
+					.resolution_scale = resolution_scale
 				};
 
+				if (use_inline)
+				{
+					cmd_list->SetPipelineState(ray_traced_ambient_occlusion_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(trace_width, 8), DivideAndRoundUp(trace_height, 8), 1);
+					return;
+				}
+
 				auto& table = cmd_list->SetStateObject(ray_traced_ambient_occlusion_so.get());
 				table.SetRayGenShader("RTAO_RayGen");
 				table.AddMissShader("RTAO_Miss", 0);
@@ -83,88 +103,11 @@ namespace adria
 
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->DispatchRays(width, height);
+				cmd_list->DispatchRays(trace_width, trace_height);
 
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		struct RTAOFilterPassData
-		{
-			RGTextureReadOnlyId depth;
-			RGTextureReadOnlyId input;
-			RGTextureReadWriteId output;
-		};
-
-		rg.AddPass<RTAOFilterPassData>("RTAO Filter Pass",
-			[=](RTAOFilterPassData& data, RGBuilder& builder)
-			{
-				RGTextureDesc desc{};
-				desc.width = width;
-				desc.height = height;
-				desc.format = GfxFormat::R8_UNORM;
-				builder.DeclareTexture(RG_NAME(AmbientOcclusion), desc);
-
-				data.output = builder.WriteTexture(RG_NAME(AmbientOcclusion));
-				data.input = builder.ReadTexture(RG_NAME(RTAO_Output), ReadAccess_NonPixelShader);
-				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
-			},
-			[=](RTAOFilterPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
-			{
-				GfxDevice* gfx = cmd_list->GetDevice();
-
-				GfxDescriptor src_descriptors[] =
-				{
-					ctx.GetReadOnlyTexture(data.depth),
-					ctx.GetReadOnlyTexture(data.input),
-					ctx.GetReadWriteTexture(data.output)
-				};
-				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
-				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
-				Uint32 const i = dst_descriptor.GetIndex();
-
-				struct RTAOFilterIndices
-				{
-					Uint32  depth_idx;
-					Uint32  input_idx;
-					Uint32  output_idx;
-				} indices =
-				{
-					.depth_idx = i + 0, .input_idx = i + 1, .output_idx = i + 2
-				};
-
-				Float distance_kernel[6];
-				for (Uint64 i = 0; i < 6; ++i)
-				{
-					distance_kernel[i] = (Float)exp(-Float(i * i) / (2.f * params.filter_distance_sigma * params.filter_distance_sigma));
-				}
-
-				struct RTAOFilterConstants
-				{
-					Float filter_width;
-					Float filter_height;
-					Float filter_distance_sigma;
-					Float filter_depth_sigma;
-					Float filter_dist_kernel0;
-					Float filter_dist_kernel1;
-					Float filter_dist_kernel2;
-					Float filter_dist_kernel3;
-					Float filter_dist_kernel4;
-					Float filter_dist_kernel5;
-				} constants =
-				{
-					.filter_width = (Float)width, .filter_height = (Float)height, .filter_distance_sigma = params.filter_distance_sigma, .filter_depth_sigma = params.filter_depth_sigma,
-					.filter_dist_kernel0 = distance_kernel[0], .filter_dist_kernel1 = distance_kernel[1],
-					.filter_dist_kernel2 = distance_kernel[2], .filter_dist_kernel3 = distance_kernel[3],
-					.filter_dist_kernel4 = distance_kernel[4], .filter_dist_kernel5 = distance_kernel[5],
-				};
-
-				cmd_list->SetPipelineState(rtao_filter_pso.get());
-
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, indices);
-				cmd_list->SetRootCBV(2, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 32), DivideAndRoundUp(height, 32), 1);
-
-			}, RGPassType::Compute, RGPassFlags::None);
+		denoiser.AddPass(rg, RG_NAME(RTAO_Output), RG_NAME(AmbientOcclusion), trace_width, trace_height, "RTAO");
 	}
 
 	void RayTracedAmbientOcclusionPass::GUI()
@@ -175,9 +118,8 @@ namespace adria
 				{
 					ImGui::SliderFloat("Radius", &params.radius, 1.0f, 32.0f);
 					ImGui::SliderFloat("Power (log2)", &params.power_log, -10.0f, 10.0f);
-					ImGui::SliderFloat("Power (log2)", &params.power_log, -10.0f, 10.0f);
-					ImGui::SliderFloat("Filter Distance Sigma", &params.filter_distance_sigma, 0.0f, 25.0f);
-					ImGui::SliderFloat("Filter Depth Sigma", &params.filter_depth_sigma, 0.0f, 1.0f);
+					ImGui::Checkbox("Half Resolution", RTAOHalfResolution.GetPtr());
+					if (is_inline_supported) ImGui::Checkbox("Inline Ray Tracing", RTAOInline.GetPtr());
 					ImGui::TreePop();
 					ImGui::Separator();
 				}
@@ -188,6 +130,7 @@ namespace adria
 	{
 		if (!IsSupported()) return;
 		width = w, height = h;
+		denoiser.OnResize(w, h);
 	}
 
 	Bool RayTracedAmbientOcclusionPass::IsSupported() const
@@ -195,13 +138,6 @@ namespace adria
 		return is_supported;
 	}
 
-	void RayTracedAmbientOcclusionPass::CreatePSO()
-	{
-		GfxComputePipelineStateDesc compute_pso_desc{};
-		compute_pso_desc.CS = CS_RTAOFilter;
-		rtao_filter_pso = gfx->CreateComputePipelineState(compute_pso_desc);
-	}
-
 	void RayTracedAmbientOcclusionPass::CreateStateObject()
 	{
 		GfxShader const& rtao_blob = GetGfxShader(LIB_AmbientOcclusion);
@@ -223,9 +159,7 @@ namespace adria
 			global_root_sig.pGlobalRootSignature = gfx->GetCommonRootSignature();
 			rtao_state_object_builder.AddSubObject(global_root_sig);
 
-			D3D12_RAYTRACING_PIPELINE_CONFIG pipeline_config{};
-			pipeline_config.MaxTraceRecursionDepth = 1;
-			rtao_state_object_builder.AddSubObject(pipeline_config);
+			rtao_state_object_builder.AddRayTracingPipelineConfig(gfx, 1);
 
 			D3D12_HIT_GROUP_DESC anyhit_group{};
 			anyhit_group.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
@@ -236,6 +170,13 @@ namespace adria
 		ray_traced_ambient_occlusion_so.reset(rtao_state_object_builder.CreateStateObject(gfx));
 	}
 
+	void RayTracedAmbientOcclusionPass::CreatePSO()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_RayTracedAmbientOcclusion;
+		ray_traced_ambient_occlusion_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
 	void RayTracedAmbientOcclusionPass::OnLibraryRecompiled(GfxShaderKey const& key)
 	{
 		if (key.GetShaderID() == LIB_AmbientOcclusion) CreateStateObject();
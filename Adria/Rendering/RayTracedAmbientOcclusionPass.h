@@ -1,5 +1,5 @@
 #pragma once
-#include "BlurPass.h"
+#include "RayTracingDenoiserPass.h"
 #include "Graphics/GfxRayTracingShaderTable.h"
 #include "RenderGraph/RenderGraphResourceName.h"
 
@@ -7,8 +7,8 @@ namespace adria
 {
 	class GfxDevice;
 	class GfxStateObject;
-	class GfxShaderKey;
 	class GfxComputePipelineState;
+	class GfxShaderKey;
 	class RenderGraph;
 
 	class RayTracedAmbientOcclusionPass
@@ -17,8 +17,6 @@ namespace adria
 		{
 			Float radius = 2.0f;
 			Float power_log = -1.0f;
-			Float filter_distance_sigma = 10.0f;
-			Float filter_depth_sigma = 0.25f;
 		};
 
 	public:
@@ -33,16 +31,17 @@ namespace adria
 	private:
 		GfxDevice* gfx;
 		std::unique_ptr<GfxStateObject> ray_traced_ambient_occlusion_so;
-		std::unique_ptr<GfxComputePipelineState> rtao_filter_pso;
+		std::unique_ptr<GfxComputePipelineState> ray_traced_ambient_occlusion_pso;
 		Uint32 width, height;
-		BlurPass blur_pass;
+		RayTracingDenoiserPass denoiser;
 
 		Bool is_supported;
+		Bool is_inline_supported;
 		RTAOParams params{};
 
 	private:
-		void CreatePSO();
 		void CreateStateObject();
+		void CreatePSO();
 		void OnLibraryRecompiled(GfxShaderKey const&);
 	};
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Graphics/GfxShader.h"
 #include "Graphics/GfxShaderKey.h"
 #include "Graphics/GfxStateObject.h"
+#include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
 #include "Core/ConsoleManager.h"
@@ -12,14 +13,18 @@
 namespace adria
 {
 	static TAutoConsoleVariable<Bool> RTR("r.RTR", true, "0 - Disabled, 1 - Enabled");
+	static TAutoConsoleVariable<Bool> RTRHalfResolution("r.RTR.HalfResolution", true, "Trace reflection rays at half resolution and let the denoiser upsample them");
+	static TAutoConsoleVariable<Float> RTRHybridRoughnessCutoff("r.RTR.Hybrid.RoughnessCutoff", 0.5f, "In hybrid mode pixels rougher than this use DDGI or the sky probe instead of a reflection ray");
+	static TAutoConsoleVariable<Float> RTRHybridConfidence("r.RTR.Hybrid.Confidence", 0.9f, "In hybrid mode SSR hits with at least this confidence are not traced again");
 	
 	RayTracedReflectionsPass::RayTracedReflectionsPass(GfxDevice* gfx, Uint32 width, Uint32 height)
-		: gfx(gfx), width(width), height(height), blur_pass(gfx), copy_to_texture_pass(gfx, width, height)
+		: gfx(gfx), width(width), height(height), denoiser(gfx, width, height, GfxFormat::R16G16B16A16_FLOAT), copy_to_texture_pass(gfx, width, height)
 	{
 		is_supported = gfx->GetCapabilities().CheckRayTracingSupport(RayTracingSupport::Tier1_1);
 		if (IsSupported())
 		{
 			CreateStateObject();
+			CreatePSOs();
 			ShaderManager::GetLibraryRecompiledEvent().AddMember(&RayTracedReflectionsPass::OnLibraryRecompiled, *this);
 		}
 	}
@@ -30,22 +35,38 @@ namespace adria
 		if (!IsSupported()) return;
 
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const resolution_scale = RTRHalfResolution.Get() ? 2 : 1;
+		Uint32 const trace_width = DivideAndRoundUp(width, resolution_scale);
+		Uint32 const trace_height = DivideAndRoundUp(height, resolution_scale);
+		Bool const hybrid = rg.IsTextureDeclared(RG_NAME(SSR_Reflection));
+		if (hybrid) AddClassifyPasses(rg, trace_width, trace_height, resolution_scale);
+
 		struct RayTracedReflectionsPassData
 		{
 			RGTextureReadOnlyId depth;
 			RGTextureReadOnlyId normal;
 			RGTextureReadOnlyId diffuse;
+			RGBufferReadOnlyId ray_list;
+			RGBufferIndirectArgsId ray_args;
 			RGTextureReadWriteId output;
 		};
 
 		rg.AddPass<RayTracedReflectionsPassData>("Ray Traced Reflections Pass",
 			[=](RayTracedReflectionsPassData& data, RGBuilder& builder)
 			{
-				RGTextureDesc desc{};
-				desc.width = width;
-				desc.height = height;
-				desc.format = GfxFormat::R8G8B8A8_UNORM;
-				builder.DeclareTexture(RG_NAME(RTR_OutputNoisy), desc);
+				if (!hybrid)
+				{
+					RGTextureDesc desc{};
+					desc.width = trace_width;
+					desc.height = trace_height;
+					desc.format = GfxFormat::R16G16B16A16_FLOAT;
+					builder.DeclareTexture(RG_NAME(RTR_OutputNoisy), desc);
+				}
+				else
+				{
+					data.ray_list = builder.ReadBuffer(RG_NAME(RTR_RayList));
+					data.ray_args = builder.ReadIndirectArgsBuffer(RG_NAME(RTR_RayArgs));
+				}
 
 				data.output = builder.WriteTexture(RG_NAME(RTR_OutputNoisy));
 				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal));
@@ -60,7 +81,8 @@ namespace adria
 					ctx.GetReadOnlyTexture(data.depth),
 					ctx.GetReadOnlyTexture(data.normal),
 					ctx.GetReadOnlyTexture(data.diffuse),
-					ctx.GetReadWriteTexture(data.output)
+					ctx.GetReadWriteTexture(data.output),
+					hybrid ? ctx.GetReadOnlyBuffer(data.ray_list) : ctx.GetReadOnlyTexture(data.depth)
 				};
 				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
 				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
@@ -73,10 +95,14 @@ namespace adria
 					Uint32  normal_idx;
 					Uint32  albedo_idx;
 					Uint32  output_idx;
+					Uint32  resolution_scale;
+					Int32   ray_list_idx;
 				} constants =
 				{
 					.roughness_scale = reflection_roughness_scale,
-					.depth_idx = i + 0, .normal_idx = i + 1, .albedo_idx = i + 2, .output_idx = i + 3
+					.depth_idx = i + 0, .normal_idx = i + 1, .albedo_idx = i + 2, .output_idx = i + 3,
+					.resolution_scale = resolution_scale,
+					.ray_list_idx = hybrid ? Int32(i + 4) : -1
 				};
 				auto& table = cmd_list->SetStateObject(ray_traced_reflections_so.get());
 				table.SetRayGenShader("RTR_RayGen");
@@ -85,17 +111,162 @@ namespace adria
 
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->DispatchRays(width, height);
+				if (hybrid) cmd_list->DispatchRaysIndirect(ctx.GetIndirectArgsBuffer(data.ray_args), 0);
+				else cmd_list->DispatchRays(trace_width, trace_height);
 			}, RGPassType::Compute, RGPassFlags::None);
 		
-		blur_pass.AddPass(rg, RG_NAME(RTR_OutputNoisy), RG_NAME(RTR_Output), "RTR Denoise");
+		denoiser.AddPass(rg, RG_NAME(RTR_OutputNoisy), RG_NAME(RTR_Output), trace_width, trace_height, "RTR");
 		copy_to_texture_pass.AddPass(rg, postprocessor->GetFinalResource(), RG_NAME(RTR_Output), BlendMode::AdditiveBlend);
 	}
 
+	void RayTracedReflectionsPass::AddClassifyPasses(RenderGraph& rg, Uint32 trace_width, Uint32 trace_height, Uint32 resolution_scale)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct RTRClassifyPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGTextureReadOnlyId diffuse;
+			RGTextureReadOnlyId ssr;
+			RGTextureReadWriteId output;
+			RGBufferReadWriteId ray_list;
+			RGBufferReadWriteId ray_counter;
+		};
+
+		rg.AddPass<RTRClassifyPassData>("RTR Classify Pass",
+			[=](RTRClassifyPassData& data, RGBuilder& builder)
+			{
+				RGTextureDesc desc{};
+				desc.width = trace_width;
+				desc.height = trace_height;
+				desc.format = GfxFormat::R16G16B16A16_FLOAT;
+				builder.DeclareTexture(RG_NAME(RTR_OutputNoisy), desc);
+
+				RGBufferDesc ray_list_desc{};
+				ray_list_desc.resource_usage = GfxResourceUsage::Default;
+				ray_list_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				ray_list_desc.stride = sizeof(Uint32);
+				ray_list_desc.size = trace_width * trace_height * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(RTR_RayList), ray_list_desc);
+
+				RGBufferDesc ray_counter_desc{};
+				ray_counter_desc.resource_usage = GfxResourceUsage::Default;
+				ray_counter_desc.misc_flags = GfxBufferMiscFlag::BufferRaw;
+				ray_counter_desc.stride = sizeof(Uint32);
+				ray_counter_desc.size = sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(RTR_RayCounter), ray_counter_desc);
+
+				data.output = builder.WriteTexture(RG_NAME(RTR_OutputNoisy));
+				data.ray_list = builder.WriteBuffer(RG_NAME(RTR_RayList));
+				data.ray_counter = builder.WriteBuffer(RG_NAME(RTR_RayCounter));
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.diffuse = builder.ReadTexture(RG_NAME(GBufferAlbedo), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.ssr = builder.ReadTexture(RG_NAME(SSR_Reflection), ReadAccess_NonPixelShader);
+			},
+			[=](RTRClassifyPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyTexture(data.diffuse),
+					ctx.GetReadOnlyTexture(data.ssr),
+					ctx.GetReadWriteTexture(data.output),
+					ctx.GetReadWriteBuffer(data.ray_list),
+					ctx.GetReadWriteBuffer(data.ray_counter)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				Uint32 clear[] = { 0, 0, 0, 0 };
+				cmd_list->ClearUAV(ctx.GetBuffer(*data.ray_counter), gfx->GetDescriptorGPU(i + 6), ctx.GetReadWriteBuffer(data.ray_counter), clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				//pixels that are not traced get their final noisy value here: zero where ssr hit, ddgi or the sky probe above the cutoff
+				struct RTRClassifyConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 albedo_idx;
+					Uint32 ssr_idx;
+					Uint32 output_idx;
+					Uint32 ray_list_idx;
+					Uint32 ray_counter_idx;
+					Uint32 resolution_scale;
+					Float  roughness_cutoff;
+					Float  ssr_confidence;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .albedo_idx = i + 2, .ssr_idx = i + 3,
+					.output_idx = i + 4, .ray_list_idx = i + 5, .ray_counter_idx = i + 6,
+					.resolution_scale = resolution_scale,
+					.roughness_cutoff = RTRHybridRoughnessCutoff.Get(),
+					.ssr_confidence = RTRHybridConfidence.Get()
+				};
+
+				cmd_list->SetPipelineState(classify_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(trace_width, 16), DivideAndRoundUp(trace_height, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct RTRRayArgsPassData
+		{
+			RGBufferReadOnlyId ray_counter;
+			RGBufferReadWriteId ray_args;
+		};
+
+		rg.AddPass<RTRRayArgsPassData>("RTR Ray Args Pass",
+			[=](RTRRayArgsPassData& data, RGBuilder& builder)
+			{
+				RGBufferDesc ray_args_desc{};
+				ray_args_desc.resource_usage = GfxResourceUsage::Default;
+				ray_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				ray_args_desc.stride = sizeof(D3D12_DISPATCH_RAYS_DESC);
+				ray_args_desc.size = sizeof(D3D12_DISPATCH_RAYS_DESC);
+				builder.DeclareBuffer(RG_NAME(RTR_RayArgs), ray_args_desc);
+
+				data.ray_counter = builder.ReadBuffer(RG_NAME(RTR_RayCounter), ReadAccess_NonPixelShader);
+				data.ray_args = builder.WriteBuffer(RG_NAME(RTR_RayArgs));
+			},
+			[=](RTRRayArgsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyBuffer(data.ray_counter),
+					ctx.GetReadWriteBuffer(data.ray_args)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct RTRRayArgsConstants
+				{
+					Uint32 ray_counter_idx;
+					Uint32 ray_args_idx;
+					Uint32 dimensions_offset;
+				} constants =
+				{
+					.ray_counter_idx = i, .ray_args_idx = i + 1,
+					.dimensions_offset = offsetof(D3D12_DISPATCH_RAYS_DESC, Width)
+				};
+
+				cmd_list->SetPipelineState(ray_args_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
 	void RayTracedReflectionsPass::OnResize(Uint32 w, Uint32 h)
 	{
 		if (!IsSupported()) return;
 		width = w, height = h;
+		denoiser.OnResize(w, h);
 		copy_to_texture_pass.OnResize(w, h);
 	}
 
@@ -114,6 +285,9 @@ namespace adria
 					if (RTR.Get())
 					{
 						ImGui::SliderFloat("Roughness scale", &reflection_roughness_scale, 0.0f, 0.25f);
+						ImGui::Checkbox("Half Resolution", RTRHalfResolution.GetPtr());
+						ImGui::SliderFloat("Hybrid Roughness Cutoff", RTRHybridRoughnessCutoff.GetPtr(), 0.0f, 1.0f);
+						ImGui::SliderFloat("Hybrid SSR Confidence", RTRHybridConfidence.GetPtr(), 0.0f, 1.0f);
 					}
 					ImGui::TreePop();
 					ImGui::Separator();
@@ -148,9 +322,7 @@ namespace adria
 			rtr_state_object_builder.AddSubObject(global_root_sig);
 
 			// Add a state subobject for the ray tracing pipeline config
-			D3D12_RAYTRACING_PIPELINE_CONFIG pipeline_config{};
-			pipeline_config.MaxTraceRecursionDepth = 2;
-			rtr_state_object_builder.AddSubObject(pipeline_config);
+			rtr_state_object_builder.AddRayTracingPipelineConfig(gfx, 2);
 
 			D3D12_HIT_GROUP_DESC closesthit_group{};
 			closesthit_group.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
@@ -165,6 +337,16 @@ namespace adria
 		ray_traced_reflections_so.reset(rtr_state_object_builder.CreateStateObject(gfx));
 	}
 
+	void RayTracedReflectionsPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_RTRClassify;
+		classify_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_RTRRayArgs;
+		ray_args_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
 	void RayTracedReflectionsPass::OnLibraryRecompiled(GfxShaderKey const& key)
 	{
 		if (key.GetShaderID() == LIB_Reflections) CreateStateObject();
@@ -1,6 +1,6 @@
 #pragma once
 #include "PostEffect.h"
-#include "BlurPass.h"
+#include "RayTracingDenoiserPass.h"
 #include "HelperPasses.h"
 #include "Graphics/GfxRayTracingShaderTable.h"
 
@@ -10,6 +10,7 @@ namespace adria
 	class GfxDevice;
 	class GfxStateObject;
 	class GfxShaderKey;
+	class GfxComputePipelineState;
 
 	class RayTracedReflectionsPass : public PostEffect
 	{
@@ -26,8 +27,10 @@ namespace adria
 	private:
 		GfxDevice* gfx;
 		std::unique_ptr<GfxStateObject> ray_traced_reflections_so;
+		std::unique_ptr<GfxComputePipelineState> classify_pso;
+		std::unique_ptr<GfxComputePipelineState> ray_args_pso;
 		Uint32 width, height;
-		BlurPass blur_pass;
+		RayTracingDenoiserPass denoiser;
 
 		Bool is_supported;
 		Float reflection_roughness_scale = 0.0f;
@@ -35,6 +38,9 @@ namespace adria
 
 	private:
 		void CreateStateObject();
+		void CreatePSOs();
+		//hybrid mode: compacts the pixels SSR did not resolve into RTR_RayList and writes the indirect dispatch for them
+		void AddClassifyPasses(RenderGraph& rg, Uint32 trace_width, Uint32 trace_height, Uint32 resolution_scale);
 		void OnLibraryRecompiled(GfxShaderKey const&);
 	};
 }
\ No newline at end of file
@@ -4,52 +4,92 @@
 #include "Graphics/GfxShader.h"
 #include "Graphics/GfxShaderKey.h"
 #include "Graphics/GfxStateObject.h"
+#include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
+#include "Core/ConsoleManager.h"
+
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> RayTracedShadowsHalfResolution("r.RayTracedShadows.HalfResolution", true, "Trace shadow rays at half resolution and let the denoiser upsample them");
+	static TAutoConsoleVariable<Bool> RayTracedShadowsInline("r.RayTracedShadows.Inline", true, "Use inline ray tracing (RayQuery) for shadow rays when DXR 1.1 is supported");
+
 	RayTracedShadowsPass::RayTracedShadowsPass(GfxDevice* gfx, Uint32 width, Uint32 height)
 		: gfx(gfx), width(width), height(height)
 	{
 		is_supported = gfx->GetCapabilities().SupportsRayTracing();
+		is_inline_supported = gfx->GetCapabilities().CheckRayTracingSupport(RayTracingSupport::Tier1_1);
 		if (IsSupported())
 		{
 			CreateStateObject();
+			if (is_inline_supported) CreatePSO();
 			ShaderManager::GetLibraryRecompiledEvent().AddMember(&RayTracedShadowsPass::OnLibraryRecompiled, *this);
 		}
 	}
 	RayTracedShadowsPass::~RayTracedShadowsPass() = default;
 
-	void RayTracedShadowsPass::AddPass(RenderGraph& rg, Uint32 light_index)
+	void RayTracedShadowsPass::AddPass(RenderGraph& rg, Uint32 light_index, Uint64 light_id)
 	{
 		if (!IsSupported()) return;
 
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const resolution_scale = RayTracedShadowsHalfResolution.Get() ? 2 : 1;
+		Uint32 const trace_width = DivideAndRoundUp(width, resolution_scale);
+		Uint32 const trace_height = DivideAndRoundUp(height, resolution_scale);
+		Bool const use_inline = is_inline_supported && RayTracedShadowsInline.Get();
+
 		struct RayTracedShadowsPassData
 		{
 			RGTextureReadOnlyId depth;
+			RGTextureReadWriteId output;
 		};
 
 		rg.AddPass<RayTracedShadowsPassData>("Ray Traced Shadows Pass",
 			[=](RayTracedShadowsPassData& data, RGBuilder& builder)
 			{
+				RGTextureDesc desc{};
+				desc.width = trace_width;
+				desc.height = trace_height;
+				desc.format = GfxFormat::R8_UNORM;
+				builder.DeclareTexture(RG_NAME_IDX(RTShadowNoisy, light_id), desc);
+
 				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.output = builder.WriteTexture(RG_NAME_IDX(RTShadowNoisy, light_id));
 			},
 			[=](RayTracedShadowsPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				Uint32 i = gfx->AllocateDescriptorsGPU(1).GetIndex();
-				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i), ctx.GetReadOnlyTexture(data.depth));
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadWriteTexture(data.output)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
 
 				struct RayTracedShadowsConstants
 				{
 					Uint32  depth_idx;
 					Uint32  light_idx;
+					Uint32  output_idx;
+					Uint32  resolution_scale;
 				} constants =
 				{
 					.depth_idx = i,
-					.light_idx = light_index
+					.light_idx = light_index,
+					.output_idx = i + 1,
+					.resolution_scale = resolution_scale
 				};
+				if (use_inline)
+				{
+					cmd_list->SetPipelineState(ray_traced_shadows_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(trace_width, 8), DivideAndRoundUp(trace_height, 8), 1);
+					return;
+				}
+
 				auto& table = cmd_list->SetStateObject(ray_traced_shadows_so.get());
 				table.SetRayGenShader("RTS_RayGen_Hard");
 				table.AddMissShader("RTS_Miss", 0);
@@ -57,14 +97,19 @@ namespace adria
 
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->DispatchRays(width, height);
+				cmd_list->DispatchRays(trace_width, trace_height);
+
+			}, RGPassType::Compute, RGPassFlags::None);
 
-			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+		std::unique_ptr<RayTracingDenoiserPass>& denoiser = denoisers[light_id];
+		if (!denoiser) denoiser = std::make_unique<RayTracingDenoiserPass>(gfx, width, height, GfxFormat::R16_FLOAT);
+		denoiser->AddPass(rg, RG_NAME_IDX(RTShadowNoisy, light_id), RG_NAME_IDX(LightMask, light_id), trace_width, trace_height, "RT Shadows");
 	}
 
 	void RayTracedShadowsPass::OnResize(Uint32 w, Uint32 h)
 	{
 		width = w, height = h;
+		for (auto& [light_id, denoiser] : denoisers) denoiser->OnResize(w, h);
 	}
 
 	Bool RayTracedShadowsPass::IsSupported() const
@@ -100,9 +145,7 @@ namespace adria
 			global_root_sig.pGlobalRootSignature = gfx->GetCommonRootSignature();
 			rt_shadows_state_object_builder.AddSubObject(global_root_sig);
 
-			D3D12_RAYTRACING_PIPELINE_CONFIG pipeline_config{};
-			pipeline_config.MaxTraceRecursionDepth = 1;
-			rt_shadows_state_object_builder.AddSubObject(pipeline_config);
+			rt_shadows_state_object_builder.AddRayTracingPipelineConfig(gfx, 1);
 
 			D3D12_HIT_GROUP_DESC anyhit_group{};
 			anyhit_group.Type = D3D12_HIT_GROUP_TYPE_TRIANGLES;
@@ -113,6 +156,13 @@ namespace adria
 		ray_traced_shadows_so.reset(rt_shadows_state_object_builder.CreateStateObject(gfx));
 	}
 
+	void RayTracedShadowsPass::CreatePSO()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_RayTracedShadows;
+		ray_traced_shadows_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
 	void RayTracedShadowsPass::OnLibraryRecompiled(GfxShaderKey const& key)
 	{
 		if (key.GetShaderID() == LIB_Shadows) CreateStateObject();
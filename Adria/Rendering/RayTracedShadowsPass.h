@@ -1,4 +1,5 @@
 #pragma once
+#include "RayTracingDenoiserPass.h"
 #include "Graphics/GfxRayTracingShaderTable.h"
 #include "RenderGraph/RenderGraphResourceName.h"
 
@@ -7,6 +8,7 @@ namespace adria
 	class RenderGraph;
 	class GfxDevice;
 	class GfxStateObject;
+	class GfxComputePipelineState;
 	class GfxShaderKey;
 
 	class RayTracedShadowsPass
@@ -14,7 +16,7 @@ namespace adria
 	public:
 		RayTracedShadowsPass(GfxDevice* gfx, Uint32 width, Uint32 height);
 		~RayTracedShadowsPass();
-		void AddPass(RenderGraph& rendergraph, Uint32 light_index);
+		void AddPass(RenderGraph& rendergraph, Uint32 light_index, Uint64 light_id);
 		void OnResize(Uint32 w, Uint32 h);
 
 		Bool IsSupported() const;
@@ -22,11 +24,15 @@ namespace adria
 	private:
 		GfxDevice* gfx;
 		std::unique_ptr<GfxStateObject> ray_traced_shadows_so;
+		std::unique_ptr<GfxComputePipelineState> ray_traced_shadows_pso;
 		Uint32 width, height;
 		Bool is_supported;
+		Bool is_inline_supported;
+		std::unordered_map<Uint64, std::unique_ptr<RayTracingDenoiserPass>> denoisers;
 
 	private:
 		void CreateStateObject();
+		void CreatePSO();
 		void OnLibraryRecompiled(GfxShaderKey const&);
 	};
 }
\ No newline at end of file
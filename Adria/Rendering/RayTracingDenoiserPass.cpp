@@ -0,0 +1,241 @@
+#include "RayTracingDenoiserPass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxPipelineState.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Int>   DenoiserAtrousIterations("r.RayTracing.Denoiser.AtrousIterations", 3, "Number of variance-guided a-trous filter iterations");
+	static TAutoConsoleVariable<Int>   DenoiserMaxHistoryLength("r.RayTracing.Denoiser.MaxHistoryLength", 32, "Maximal number of accumulated frames");
+	static TAutoConsoleVariable<Float> DenoiserPhiColor("r.RayTracing.Denoiser.PhiColor", 10.0f, "Luminance edge-stopping weight, scaled by the standard deviation");
+	static TAutoConsoleVariable<Float> DenoiserPhiNormal("r.RayTracing.Denoiser.PhiNormal", 128.0f, "Normal edge-stopping exponent");
+	static TAutoConsoleVariable<Float> DenoiserPhiDepth("r.RayTracing.Denoiser.PhiDepth", 1.0f, "Depth edge-stopping weight");
+
+	RayTracingDenoiserPass::RayTracingDenoiserPass(GfxDevice* gfx, Uint32 width, Uint32 height, GfxFormat format)
+		: gfx(gfx), width(width), height(height), format(format)
+	{
+		static Uint32 denoiser_count = 0;
+		denoiser_id = denoiser_count++;
+		CreatePSOs();
+		CreateHistoryTextures();
+	}
+
+	RayTracingDenoiserPass::~RayTracingDenoiserPass() = default;
+
+	void RayTracingDenoiserPass::AddPass(RenderGraph& rg, RGResourceName noisy_input, RGResourceName denoised_output, Uint32 input_width, Uint32 input_height, Char const* pass_name)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		RGResourceName const color_history_name = RG_NAME_IDX(RTDenoiserColorHistory, denoiser_id);
+		RGResourceName const moments_history_name = RG_NAME_IDX(RTDenoiserMomentsHistory, denoiser_id);
+		RGResourceName const temporal_color_name = RG_NAME_IDX(RTDenoiserTemporalColor, denoiser_id);
+		RGResourceName const temporal_moments_name = RG_NAME_IDX(RTDenoiserTemporalMoments, denoiser_id);
+		rg.ImportTexture(color_history_name, color_history.get());
+		rg.ImportTexture(moments_history_name, moments_history.get());
+
+		struct RTDenoiserTemporalPassData
+		{
+			RGTextureReadOnlyId  input;
+			RGTextureReadOnlyId  velocity;
+			RGTextureReadOnlyId  depth;
+			RGTextureReadOnlyId  depth_history;
+			RGTextureReadOnlyId  normal;
+			RGTextureReadOnlyId  color_history;
+			RGTextureReadOnlyId  moments_history;
+			RGTextureReadWriteId output_color;
+			RGTextureReadWriteId output_moments;
+		};
+
+		Bool const use_history = history_valid;
+		std::string temporal_name = "RT Denoiser Temporal Pass " + std::string(pass_name);
+		rg.AddPass<RTDenoiserTemporalPassData>(temporal_name.c_str(),
+			[=](RTDenoiserTemporalPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc desc{};
+				desc.width = width;
+				desc.height = height;
+				desc.format = format;
+				builder.DeclareTexture(temporal_color_name, desc);
+				desc.format = GfxFormat::R16G16B16A16_FLOAT;
+				builder.DeclareTexture(temporal_moments_name, desc);
+
+				data.output_color = builder.WriteTexture(temporal_color_name);
+				data.output_moments = builder.WriteTexture(temporal_moments_name);
+				data.input = builder.ReadTexture(noisy_input, ReadAccess_NonPixelShader);
+				data.velocity = builder.ReadTexture(RG_NAME(VelocityBuffer), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.depth_history = builder.ReadTexture(RG_NAME(DepthHistory), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.color_history = builder.ReadTexture(color_history_name, ReadAccess_NonPixelShader);
+				data.moments_history = builder.ReadTexture(moments_history_name, ReadAccess_NonPixelShader);
+			},
+			[=](RTDenoiserTemporalPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.input),
+					ctx.GetReadOnlyTexture(data.velocity),
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.depth_history),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyTexture(data.color_history),
+					ctx.GetReadOnlyTexture(data.moments_history),
+					ctx.GetReadWriteTexture(data.output_color),
+					ctx.GetReadWriteTexture(data.output_moments)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct RTDenoiserTemporalConstants
+				{
+					Uint32 input_idx;
+					Uint32 velocity_idx;
+					Uint32 depth_idx;
+					Uint32 depth_history_idx;
+					Uint32 normal_idx;
+					Uint32 color_history_idx;
+					Uint32 moments_history_idx;
+					Uint32 output_color_idx;
+					Uint32 output_moments_idx;
+					Uint32 input_width;
+					Uint32 input_height;
+					Float  max_history_length;
+					Bool32 history_valid;
+				} constants =
+				{
+					.input_idx = i, .velocity_idx = i + 1, .depth_idx = i + 2, .depth_history_idx = i + 3, .normal_idx = i + 4,
+					.color_history_idx = i + 5, .moments_history_idx = i + 6, .output_color_idx = i + 7, .output_moments_idx = i + 8,
+					.input_width = input_width, .input_height = input_height,
+					.max_history_length = (Float)std::max(DenoiserMaxHistoryLength.Get(), 1),
+					.history_valid = use_history
+				};
+
+				cmd_list->SetPipelineState(temporal_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct RTDenoiserAtrousPassData
+		{
+			RGTextureReadOnlyId  input;
+			RGTextureReadOnlyId  moments;
+			RGTextureReadOnlyId  depth;
+			RGTextureReadOnlyId  normal;
+			RGTextureReadWriteId output;
+		};
+
+		Uint32 const iteration_count = (Uint32)std::max(DenoiserAtrousIterations.Get(), 1);
+		RGResourceName atrous_input = temporal_color_name;
+		for (Uint32 iteration = 0; iteration < iteration_count; ++iteration)
+		{
+			Bool const last_iteration = iteration == iteration_count - 1;
+			RGResourceName const atrous_output = last_iteration ? denoised_output : RG_NAME_IDX(RTDenoiserAtrous, denoiser_id * 16 + iteration);
+
+			std::string atrous_name = "RT Denoiser A-Trous Pass " + std::to_string(iteration) + " " + std::string(pass_name);
+			rg.AddPass<RTDenoiserAtrousPassData>(atrous_name.c_str(),
+				[=](RTDenoiserAtrousPassData& data, RenderGraphBuilder& builder)
+				{
+					if (!builder.IsTextureDeclared(atrous_output))
+					{
+						RGTextureDesc desc{};
+						desc.width = width;
+						desc.height = height;
+						desc.format = format;
+						builder.DeclareTexture(atrous_output, desc);
+					}
+					data.output = builder.WriteTexture(atrous_output);
+					data.input = builder.ReadTexture(atrous_input, ReadAccess_NonPixelShader);
+					data.moments = builder.ReadTexture(temporal_moments_name, ReadAccess_NonPixelShader);
+					data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+					data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				},
+				[=](RTDenoiserAtrousPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+
+					GfxDescriptor src_descriptors[] =
+					{
+						ctx.GetReadOnlyTexture(data.input),
+						ctx.GetReadOnlyTexture(data.moments),
+						ctx.GetReadOnlyTexture(data.depth),
+						ctx.GetReadOnlyTexture(data.normal),
+						ctx.GetReadWriteTexture(data.output)
+					};
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+					Uint32 const i = dst_descriptor.GetIndex();
+
+					struct RTDenoiserAtrousConstants
+					{
+						Uint32 input_idx;
+						Uint32 moments_idx;
+						Uint32 depth_idx;
+						Uint32 normal_idx;
+						Uint32 output_idx;
+						Uint32 step_size;
+						Float  phi_color;
+						Float  phi_normal;
+						Float  phi_depth;
+					} constants =
+					{
+						.input_idx = i, .moments_idx = i + 1, .depth_idx = i + 2, .normal_idx = i + 3, .output_idx = i + 4,
+						.step_size = 1u << iteration,
+						.phi_color = DenoiserPhiColor.Get(), .phi_normal = DenoiserPhiNormal.Get(), .phi_depth = DenoiserPhiDepth.Get()
+					};
+
+					cmd_list->SetPipelineState(atrous_pso.get());
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					cmd_list->SetRootCBV(2, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+				}, RGPassType::Compute, last_iteration ? RGPassFlags::ForceNoCull : RGPassFlags::None);
+
+			//the first filtered iteration is fed back as history, like in SVGF
+			if (iteration == 0 && !last_iteration) rg.ExportTexture(atrous_output, color_history.get());
+			atrous_input = atrous_output;
+		}
+		if (iteration_count == 1) rg.ExportTexture(temporal_color_name, color_history.get());
+		rg.ExportTexture(temporal_moments_name, moments_history.get());
+		history_valid = true;
+	}
+
+	void RayTracingDenoiserPass::OnResize(Uint32 w, Uint32 h)
+	{
+		width = w, height = h;
+		CreateHistoryTextures();
+	}
+
+	void RayTracingDenoiserPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_RTDenoiserTemporal;
+		temporal_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_RTDenoiserAtrous;
+		atrous_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void RayTracingDenoiserPass::CreateHistoryTextures()
+	{
+		GfxTextureDesc history_desc{};
+		history_desc.width = width;
+		history_desc.height = height;
+		history_desc.format = format;
+		history_desc.bind_flags = GfxBindFlag::ShaderResource;
+		history_desc.initial_state = GfxResourceState::CopyDst;
+		color_history = gfx->CreateTexture(history_desc);
+		color_history->SetName("RT Denoiser Color History");
+
+		history_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+		moments_history = gfx->CreateTexture(history_desc);
+		moments_history->SetName("RT Denoiser Moments History");
+		history_valid = false;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Graphics/GfxFormat.h"
+#include "RenderGraph/RenderGraphResourceName.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxTexture;
+	class GfxComputePipelineState;
+	class RenderGraph;
+
+	class RayTracingDenoiserPass
+	{
+	public:
+		RayTracingDenoiserPass(GfxDevice* gfx, Uint32 width, Uint32 height, GfxFormat format);
+		~RayTracingDenoiserPass();
+
+		void AddPass(RenderGraph& rg, RGResourceName noisy_input, RGResourceName denoised_output, Uint32 input_width, Uint32 input_height, Char const* pass_name = "");
+		void OnResize(Uint32 w, Uint32 h);
+		void ResetHistory() { history_valid = false; }
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+		GfxFormat format;
+		Uint32 denoiser_id;
+		std::unique_ptr<GfxTexture> color_history;
+		std::unique_ptr<GfxTexture> moments_history;
+		Bool history_valid = false;
+		std::unique_ptr<GfxComputePipelineState> temporal_pso;
+		std::unique_ptr<GfxComputePipelineState> atrous_pso;
+
+	private:
+		void CreatePSOs();
+		void CreateHistoryTextures();
+	};
+}
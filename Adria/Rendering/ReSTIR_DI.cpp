@@ -3,28 +3,28 @@
 #include "ShaderManager.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Graphics/GfxTexture.h"
+#include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxCommon.h"
 #include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
 
 namespace adria
 {
-	struct ReSTIR_DI_ReservoirSample
-	{
-		Vector3 sample_position;
-		Vector3 sample_normal;
-		Vector3 sample_radiance;
-	};
+	static TAutoConsoleVariable<Int>   ReSTIRDICandidateCount("r.ReSTIR.DI.CandidateCount", 32, "Number of lights sampled from the light buffer per pixel before resampling");
+	static TAutoConsoleVariable<Int>   ReSTIRDIMaxHistory("r.ReSTIR.DI.MaxHistory", 20, "Maximum sample count (M) a temporally reused reservoir may carry");
+	static TAutoConsoleVariable<Int>   ReSTIRDISpatialSamples("r.ReSTIR.DI.SpatialSamples", 5, "Number of neighbouring reservoirs combined in the spatial resampling pass");
+	static TAutoConsoleVariable<Float> ReSTIRDISpatialRadius("r.ReSTIR.DI.SpatialRadius", 30.0f, "Radius in pixels used to pick spatial neighbours");
 
 	struct ReSTIR_DI_Reservoir
 	{
-		ReSTIR_DI_ReservoirSample sample;
-		Float target_function;
-		Float num_samples;
-		Float weight_sum;
+		Uint32 light_index;
+		Float  weight_sum;
+		Float  num_samples;
+		Float  weight;
 	};
 
-
 	ReSTIR_DI::ReSTIR_DI(GfxDevice* gfx, Uint32 width, Uint32 height) : gfx(gfx), width(width), height(height)
 	{
 		if (!gfx->GetCapabilities().CheckRayTracingSupport(RayTracingSupport::Tier1_1))
@@ -32,45 +32,62 @@ namespace adria
 			return;
 		}
 		
-		GfxComputePipelineStateDesc compute_pso_desc{};
-		compute_pso_desc.CS = CS_ReSTIRGI_InitialSampling;
-		initial_sampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
-
-		compute_pso_desc.CS = CS_ReSTIRGI_TemporalResampling;
-		temporal_resampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
-
-		compute_pso_desc.CS = CS_ReSTIRGI_SpatialResampling;
-		spatial_resampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
-
+		CreatePSOs();
 		CreateBuffers();
 		supported = true;
 	}
 
+	ReSTIR_DI::~ReSTIR_DI() = default;
+
 	void ReSTIR_DI::AddPasses(RenderGraph& rg)
+	{
+		if (!supported) return;
+
+		rg.ImportBuffer(RG_NAME(ReSTIR_DI_StagingReservoir), staging_reservoir_buffer.get());
+		rg.ImportBuffer(RG_NAME(ReSTIR_DI_Reservoir), reservoir_buffers[1 - history_index].get());
+		rg.ImportBuffer(RG_NAME(ReSTIR_DI_ReservoirHistory), reservoir_buffers[history_index].get());
+
+		Bool const temporal = resampling_mode == ResamplingMode::Temporal || resampling_mode == ResamplingMode::TemporalAndSpatial;
+		Bool const spatial  = resampling_mode == ResamplingMode::Spatial  || resampling_mode == ResamplingMode::TemporalAndSpatial;
+
+		AddInitialSamplingPass(rg);
+		RGResourceName reservoirs = RG_NAME(ReSTIR_DI_StagingReservoir);
+		if (temporal)
+		{
+			AddTemporalResamplingPass(rg);
+			reservoirs = RG_NAME(ReSTIR_DI_Reservoir);
+		}
+		if (spatial)
+		{
+			AddSpatialResamplingPass(rg, reservoirs);
+			reservoirs = reservoirs == RG_NAME(ReSTIR_DI_StagingReservoir) ? RG_NAME(ReSTIR_DI_Reservoir) : RG_NAME(ReSTIR_DI_StagingReservoir);
+		}
+		AddShadingPass(rg, reservoirs);
+
+		//the temporal output becomes next frame's history, spatial reuse is not fed back to avoid correlation artifacts
+		if (temporal) history_index = 1 - history_index;
+		history_valid = temporal;
+	}
+
+	void ReSTIR_DI::GUI()
 	{
 		if (!supported) return;
 		QueueGUI([&]()
 			{
 				if (ImGui::TreeNode("ReSTIR DI"))
 				{
-					ImGui::Checkbox("Enable", &enable);
-					static Int current_resampling_mode = static_cast<Int>(resampling_mode);
+					Int current_resampling_mode = static_cast<Int>(resampling_mode);
 					if (ImGui::Combo("Resampling mode", &current_resampling_mode, "None\0Temporal\0Spatial\0TemporalAndSpatial\0", 4))
 					{
 						resampling_mode = static_cast<ResamplingMode>(current_resampling_mode);
 					}
+					ImGui::SliderInt("Candidate lights", ReSTIRDICandidateCount.GetPtr(), 1, 64);
+					ImGui::SliderInt("Max history", ReSTIRDIMaxHistory.GetPtr(), 1, 64);
+					ImGui::SliderInt("Spatial samples", ReSTIRDISpatialSamples.GetPtr(), 1, 16);
+					ImGui::SliderFloat("Spatial radius", ReSTIRDISpatialRadius.GetPtr(), 1.0f, 64.0f);
 					ImGui::TreePop();
 				}
-			});
-		if (!enable) return;
-
-		AddInitialSamplingPass(rg);
-
-		if (resampling_mode != ResamplingMode::None)
-		{
-			if (resampling_mode == ResamplingMode::Temporal || resampling_mode == ResamplingMode::TemporalAndSpatial) AddTemporalResamplingPass(rg);
-			if (resampling_mode == ResamplingMode::Spatial  || resampling_mode == ResamplingMode::TemporalAndSpatial) AddSpatialResamplingPass(rg);
-		}
+			}, GUICommandGroup_Renderer);
 	}
 
 	void ReSTIR_DI::AddInitialSamplingPass(RenderGraph& rg)
@@ -81,114 +98,275 @@ namespace adria
 		{
 			RGTextureReadOnlyId depth;
 			RGTextureReadOnlyId normal;
-			RGTextureReadOnlyId prev_depth;
-			RGTextureReadOnlyId irradiance_history;
-			RGTextureReadWriteId irradiance;
-			RGTextureReadWriteId ray_direction;
+			RGTextureReadOnlyId albedo;
+			RGBufferReadWriteId reservoirs;
 		};
 
-		rg.AddPass<InitialSamplingPassData>("RESTIR DI Initial Sampling Pass",
+		rg.AddPass<InitialSamplingPassData>("ReSTIR DI Initial Sampling Pass",
 			[=](InitialSamplingPassData& data, RenderGraphBuilder& builder)
 			{
-				data.depth = builder.ReadTexture(RG_NAME(DepthStencil));
-				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal));
-				data.prev_depth = builder.ReadTexture(RG_NAME(DepthHistory));
-				data.irradiance_history = builder.ReadTexture(RG_NAME(ReSTIR_IrradianceHistory));
-
-				RGTextureDesc irradiance_desc{};
-				irradiance_desc.width = width;
-				irradiance_desc.height = height;
-				irradiance_desc.format = GfxFormat::R16G16B16A16_FLOAT;
-				builder.DeclareTexture(RG_NAME(ReSTIR_Irradiance), irradiance_desc);
-				data.irradiance = builder.WriteTexture(RG_NAME(ReSTIR_Irradiance));
-
-				RGTextureDesc ray_direction_desc{};
-				ray_direction_desc.width = width;
-				ray_direction_desc.height = height;
-				ray_direction_desc.format = GfxFormat::R32_UINT;
-				builder.DeclareTexture(RG_NAME(ReSTIR_RayDirection), irradiance_desc);
-				data.ray_direction = builder.WriteTexture(RG_NAME(ReSTIR_RayDirection));
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.albedo = builder.ReadTexture(RG_NAME(GBufferAlbedo), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.WriteBuffer(RG_NAME(ReSTIR_DI_StagingReservoir));
 			},
-			[=](InitialSamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+			[=](InitialSamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 				GfxDescriptor src_descriptors[] =
 				{
 					ctx.GetReadOnlyTexture(data.depth),
 					ctx.GetReadOnlyTexture(data.normal),
-					ctx.GetReadOnlyTexture(data.irradiance_history),
-					ctx.GetReadWriteTexture(data.irradiance),
-					ctx.GetReadWriteTexture(data.ray_direction)
+					ctx.GetReadOnlyTexture(data.albedo),
+					ctx.GetReadWriteBuffer(data.reservoirs)
 				};
-				Uint32 i = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors)).GetIndex();
-				gfx->CopyDescriptors(gfx->GetDescriptorGPU(i), src_descriptors);
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
 
-				struct InitialSamplingPassParameters
+				struct InitialSamplingConstants
 				{
 					Uint32 depth_idx;
 					Uint32 normal_idx;
-					Uint32 irradiance_history_idx;
-					Uint32 output_irradiance_idx;
-					Uint32 output_ray_direction_idx;
-				} parameters = 
+					Uint32 albedo_idx;
+					Uint32 reservoirs_idx;
+					Uint32 candidate_count;
+				} constants =
 				{
-					.depth_idx = i,
-					.normal_idx = i + 1,
-					.irradiance_history_idx = i + 2,
-					.output_irradiance_idx = i + 3,
-					.output_ray_direction_idx = i + 4
+					.depth_idx = i, .normal_idx = i + 1, .albedo_idx = i + 2, .reservoirs_idx = i + 3,
+					.candidate_count = (Uint32)std::max(ReSTIRDICandidateCount.Get(), 1)
 				};
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, parameters);
 				cmd_list->SetPipelineState(initial_sampling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute);
 	}
 
 	void ReSTIR_DI::AddTemporalResamplingPass(RenderGraph& rg)
 	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
 		struct TemporalResamplingPassData
 		{
-
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGTextureReadOnlyId velocity;
+			RGTextureReadOnlyId prev_depth;
+			RGBufferReadOnlyId  reservoirs;
+			RGBufferReadOnlyId  history_reservoirs;
+			RGBufferReadWriteId output_reservoirs;
 		};
 
+		Bool const use_history = history_valid;
 		rg.AddPass<TemporalResamplingPassData>("ReSTIR DI Temporal Resampling Pass", 
 			[=](TemporalResamplingPassData& data, RGBuilder& builder)
 			{
-				
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.velocity = builder.ReadTexture(RG_NAME(VelocityBuffer), ReadAccess_NonPixelShader);
+				data.prev_depth = builder.ReadTexture(RG_NAME(DepthHistory), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.ReadBuffer(RG_NAME(ReSTIR_DI_StagingReservoir), ReadAccess_NonPixelShader);
+				data.history_reservoirs = builder.ReadBuffer(RG_NAME(ReSTIR_DI_ReservoirHistory), ReadAccess_NonPixelShader);
+				data.output_reservoirs = builder.WriteBuffer(RG_NAME(ReSTIR_DI_Reservoir));
 			},
-			[=](TemporalResamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+			[=](TemporalResamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
-				
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyTexture(data.velocity),
+					ctx.GetReadOnlyTexture(data.prev_depth),
+					ctx.GetReadOnlyBuffer(data.reservoirs),
+					ctx.GetReadOnlyBuffer(data.history_reservoirs),
+					ctx.GetReadWriteBuffer(data.output_reservoirs)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct TemporalResamplingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 velocity_idx;
+					Uint32 prev_depth_idx;
+					Uint32 reservoirs_idx;
+					Uint32 history_reservoirs_idx;
+					Uint32 output_reservoirs_idx;
+					Uint32 max_history;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .velocity_idx = i + 2, .prev_depth_idx = i + 3,
+					.reservoirs_idx = i + 4, .history_reservoirs_idx = i + 5, .output_reservoirs_idx = i + 6,
+					.max_history = use_history ? (Uint32)std::max(ReSTIRDIMaxHistory.Get(), 1) : 0u
+				};
+				cmd_list->SetPipelineState(temporal_resampling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute);
 	}
 
-	void ReSTIR_DI::AddSpatialResamplingPass(RenderGraph& rg)
+	void ReSTIR_DI::AddSpatialResamplingPass(RenderGraph& rg, RGResourceName input)
 	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
 		struct SpatialResamplingPassData
 		{
-
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGBufferReadOnlyId  reservoirs;
+			RGBufferReadWriteId output_reservoirs;
 		};
 
+		RGResourceName const output = input == RG_NAME(ReSTIR_DI_StagingReservoir) ? RG_NAME(ReSTIR_DI_Reservoir) : RG_NAME(ReSTIR_DI_StagingReservoir);
 		rg.AddPass<SpatialResamplingPassData>("ReSTIR DI Spatial Resampling Pass",
 			[=](SpatialResamplingPassData& data, RGBuilder& builder)
 			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.ReadBuffer(input, ReadAccess_NonPixelShader);
+				data.output_reservoirs = builder.WriteBuffer(output);
+			},
+			[=](SpatialResamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyBuffer(data.reservoirs),
+					ctx.GetReadWriteBuffer(data.output_reservoirs)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct SpatialResamplingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 reservoirs_idx;
+					Uint32 output_reservoirs_idx;
+					Uint32 sample_count;
+					Float  sample_radius;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .reservoirs_idx = i + 2, .output_reservoirs_idx = i + 3,
+					.sample_count = (Uint32)std::max(ReSTIRDISpatialSamples.Get(), 1),
+					.sample_radius = ReSTIRDISpatialRadius.Get()
+				};
+				cmd_list->SetPipelineState(spatial_resampling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute);
+	}
+
+	void ReSTIR_DI::AddShadingPass(RenderGraph& rg, RGResourceName reservoirs)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct ShadingPassData
+		{
+			RGTextureReadOnlyId  gbuffer_normal;
+			RGTextureReadOnlyId  gbuffer_albedo;
+			RGTextureReadOnlyId  gbuffer_emissive;
+			RGTextureReadOnlyId  gbuffer_custom;
+			RGTextureReadOnlyId  depth;
+			RGTextureReadOnlyId  ambient_occlusion;
+			RGBufferReadOnlyId   reservoirs;
+			RGTextureReadWriteId output;
+		};
 
+		rg.AddPass<ShadingPassData>("ReSTIR DI Shading Pass",
+			[=](ShadingPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc hdr_desc{};
+				hdr_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+				hdr_desc.width = width;
+				hdr_desc.height = height;
+				hdr_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+				builder.DeclareTexture(RG_NAME(HDR_RenderTarget), hdr_desc);
+
+				data.output			  = builder.WriteTexture(RG_NAME(HDR_RenderTarget));
+				data.gbuffer_normal   = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.gbuffer_albedo   = builder.ReadTexture(RG_NAME(GBufferAlbedo), ReadAccess_NonPixelShader);
+				data.gbuffer_emissive = builder.ReadTexture(RG_NAME(GBufferEmissive), ReadAccess_NonPixelShader);
+				data.gbuffer_custom   = builder.ReadTexture(RG_NAME(GBufferCustom), ReadAccess_NonPixelShader);
+				data.depth			  = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.reservoirs		  = builder.ReadBuffer(reservoirs, ReadAccess_NonPixelShader);
+
+				if (builder.IsTextureDeclared(RG_NAME(AmbientOcclusion))) data.ambient_occlusion = builder.ReadTexture(RG_NAME(AmbientOcclusion), ReadAccess_NonPixelShader);
+				else data.ambient_occlusion.Invalidate();
+				if (builder.IsTextureDeclared(RG_NAME(ReSTIR_GI_Irradiance))) std::ignore = builder.ReadTexture(RG_NAME(ReSTIR_GI_Irradiance), ReadAccess_NonPixelShader);
 			},
-			[=](SpatialResamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list) mutable
+			[=](ShadingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.gbuffer_normal),
+					ctx.GetReadOnlyTexture(data.gbuffer_albedo),
+					ctx.GetReadOnlyTexture(data.gbuffer_emissive),
+					ctx.GetReadOnlyTexture(data.gbuffer_custom),
+					ctx.GetReadOnlyTexture(data.depth),
+					data.ambient_occlusion.IsValid() ? ctx.GetReadOnlyTexture(data.ambient_occlusion) : gfxcommon::GetCommonView(GfxCommonViewType::WhiteTexture2D_SRV),
+					ctx.GetReadOnlyBuffer(data.reservoirs),
+					ctx.GetReadWriteTexture(data.output)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
 
+				struct ShadingConstants
+				{
+					Uint32 normal_metallic_idx;
+					Uint32 diffuse_idx;
+					Uint32 emissive_idx;
+					Uint32 custom_idx;
+					Uint32 depth_idx;
+					Uint32 ao_idx;
+					Uint32 reservoirs_idx;
+					Uint32 output_idx;
+				} constants =
+				{
+					.normal_metallic_idx = i, .diffuse_idx = i + 1, .emissive_idx = i + 2, .custom_idx = i + 3,
+					.depth_idx = i + 4, .ao_idx = i + 5, .reservoirs_idx = i + 6, .output_idx = i + 7
+				};
+				cmd_list->SetPipelineState(shading_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute);
 	}
 
+	void ReSTIR_DI::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_ReSTIRDI_InitialSampling;
+		initial_sampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ReSTIRDI_TemporalResampling;
+		temporal_resampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ReSTIRDI_SpatialResampling;
+		spatial_resampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ReSTIRDI_Shading;
+		shading_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
 	void ReSTIR_DI::CreateBuffers()
 	{
-		if (staging_reservoir_buffer == nullptr || final_reservoir_buffer == nullptr)
-		{
-			GfxBufferDesc reservoir_buffer_desc = StructuredBufferDesc<ReSTIR_DI_ReservoirSample>(width * height, true, false);
-			staging_reservoir_buffer = gfx->CreateBuffer(reservoir_buffer_desc);
-			final_reservoir_buffer = gfx->CreateBuffer(reservoir_buffer_desc);
-		}
+		GfxBufferDesc reservoir_buffer_desc = StructuredBufferDesc<ReSTIR_DI_Reservoir>(width * height, true, false);
+		staging_reservoir_buffer = gfx->CreateBuffer(reservoir_buffer_desc);
+		reservoir_buffers[0] = gfx->CreateBuffer(reservoir_buffer_desc);
+		reservoir_buffers[1] = gfx->CreateBuffer(reservoir_buffer_desc);
+		history_valid = false;
 	}
 
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "Graphics/GfxDescriptor.h"
+#include "RenderGraph/RenderGraphResourceName.h"
 #include "entt/entity/fwd.hpp"
 
 
@@ -23,13 +24,16 @@ namespace adria
 
 	public:
 		ReSTIR_DI(GfxDevice* gfx, Uint32 width, Uint32 height);
+		~ReSTIR_DI();
 
 		void AddPasses(RenderGraph& rg);
+		void GUI();
 		void OnResize(Uint32 w, Uint32 h)
 		{
 			width = w, height = h;
-			CreateBuffers();
+			if (supported) CreateBuffers();
 		}
+		void ResetHistory() { history_valid = false; }
 		Bool IsSupported() const { return supported; }
 
 	private:
@@ -37,21 +41,25 @@ namespace adria
 		Uint32 width, height;
 
 		Bool supported = false;
-		Bool enable = false;
 		ResamplingMode resampling_mode = ResamplingMode::TemporalAndSpatial;
 
 		std::unique_ptr<GfxBuffer>  staging_reservoir_buffer;
-		std::unique_ptr<GfxBuffer>	final_reservoir_buffer;
+		std::unique_ptr<GfxBuffer>	reservoir_buffers[2];
+		Uint32 history_index = 0;
+		Bool history_valid = false;
 
 		std::unique_ptr<GfxComputePipelineState> initial_sampling_pso;
 		std::unique_ptr<GfxComputePipelineState> temporal_resampling_pso;
 		std::unique_ptr<GfxComputePipelineState> spatial_resampling_pso;
+		std::unique_ptr<GfxComputePipelineState> shading_pso;
 
 	private:
 		void AddInitialSamplingPass(RenderGraph& rg);
 		void AddTemporalResamplingPass(RenderGraph& rg);
-		void AddSpatialResamplingPass(RenderGraph& rg);
+		void AddSpatialResamplingPass(RenderGraph& rg, RGResourceName input);
+		void AddShadingPass(RenderGraph& rg, RGResourceName reservoirs);
 
+		void CreatePSOs();
 		void CreateBuffers();
 	};
-}
\ No newline at end of file
+}
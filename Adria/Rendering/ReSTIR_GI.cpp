@@ -0,0 +1,374 @@
+#include "ReSTIR_GI.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool>  ReSTIRGI("r.ReSTIR.GI", false, "Enable ReSTIR GI for indirect diffuse lighting, DDGI is used as the fallback on ray miss or termination");
+	static TAutoConsoleVariable<Float> ReSTIRGIMaxRayDistance("r.ReSTIR.GI.MaxRayDistance", 50.0f, "Maximum length of the secondary ray traced per pixel");
+	static TAutoConsoleVariable<Int>   ReSTIRGIMaxHistory("r.ReSTIR.GI.MaxHistory", 30, "Maximum sample count (M) a temporally reused reservoir may carry");
+	static TAutoConsoleVariable<Int>   ReSTIRGISpatialSamples("r.ReSTIR.GI.SpatialSamples", 4, "Number of neighbouring reservoirs combined in the spatial resampling pass");
+	static TAutoConsoleVariable<Float> ReSTIRGISpatialRadius("r.ReSTIR.GI.SpatialRadius", 24.0f, "Radius in pixels used to pick spatial neighbours");
+
+	struct ReSTIR_GI_ReservoirSample
+	{
+		Vector3 sample_position;
+		Vector3 sample_normal;
+		Vector3 sample_radiance;
+	};
+
+	struct ReSTIR_GI_Reservoir
+	{
+		ReSTIR_GI_ReservoirSample sample;
+		Float weight_sum;
+		Float num_samples;
+		Float weight;
+	};
+
+	ReSTIR_GI::ReSTIR_GI(GfxDevice* gfx, Uint32 width, Uint32 height) : gfx(gfx), width(width), height(height)
+	{
+		if (!gfx->GetCapabilities().CheckRayTracingSupport(RayTracingSupport::Tier1_1))
+		{
+			return;
+		}
+
+		CreatePSOs();
+		CreateResources();
+		supported = true;
+	}
+
+	ReSTIR_GI::~ReSTIR_GI()
+	{
+		if (irradiance_srv_gpu.IsValid()) gfx->FreePersistentDescriptorGPU(irradiance_srv_gpu);
+	}
+
+	Bool ReSTIR_GI::IsEnabled() const
+	{
+		return supported && ReSTIRGI.Get();
+	}
+
+	void ReSTIR_GI::AddPasses(RenderGraph& rg)
+	{
+		if (!IsEnabled()) return;
+
+		rg.ImportBuffer(RG_NAME(ReSTIR_GI_StagingReservoir), staging_reservoir_buffer.get());
+		rg.ImportBuffer(RG_NAME(ReSTIR_GI_Reservoir), reservoir_buffers[1 - history_index].get());
+		rg.ImportBuffer(RG_NAME(ReSTIR_GI_ReservoirHistory), reservoir_buffers[history_index].get());
+		rg.ImportTexture(RG_NAME(ReSTIR_GI_Irradiance), irradiance_texture.get());
+
+		Bool const temporal = resampling_mode == ResamplingMode::Temporal || resampling_mode == ResamplingMode::TemporalAndSpatial;
+		Bool const spatial  = resampling_mode == ResamplingMode::Spatial  || resampling_mode == ResamplingMode::TemporalAndSpatial;
+
+		AddInitialSamplingPass(rg);
+		RGResourceName reservoirs = RG_NAME(ReSTIR_GI_StagingReservoir);
+		if (temporal)
+		{
+			AddTemporalResamplingPass(rg);
+			reservoirs = RG_NAME(ReSTIR_GI_Reservoir);
+		}
+		if (spatial)
+		{
+			AddSpatialResamplingPass(rg, reservoirs);
+			reservoirs = reservoirs == RG_NAME(ReSTIR_GI_StagingReservoir) ? RG_NAME(ReSTIR_GI_Reservoir) : RG_NAME(ReSTIR_GI_StagingReservoir);
+		}
+		AddResolvePass(rg, reservoirs);
+
+		if (temporal) history_index = 1 - history_index;
+		history_valid = temporal;
+	}
+
+	void ReSTIR_GI::GUI()
+	{
+		if (!supported) return;
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNode("ReSTIR GI"))
+				{
+					ImGui::Checkbox("Enable", ReSTIRGI.GetPtr());
+					if (ReSTIRGI.Get())
+					{
+						Int current_resampling_mode = static_cast<Int>(resampling_mode);
+						if (ImGui::Combo("Resampling mode", &current_resampling_mode, "None\0Temporal\0Spatial\0TemporalAndSpatial\0", 4))
+						{
+							resampling_mode = static_cast<ResamplingMode>(current_resampling_mode);
+						}
+						ImGui::SliderFloat("Max ray distance", ReSTIRGIMaxRayDistance.GetPtr(), 1.0f, 200.0f);
+						ImGui::SliderInt("Max history", ReSTIRGIMaxHistory.GetPtr(), 1, 64);
+						ImGui::SliderInt("Spatial samples", ReSTIRGISpatialSamples.GetPtr(), 1, 16);
+						ImGui::SliderFloat("Spatial radius", ReSTIRGISpatialRadius.GetPtr(), 1.0f, 64.0f);
+					}
+					ImGui::TreePop();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void ReSTIR_GI::AddInitialSamplingPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct InitialSamplingPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGBufferReadWriteId reservoirs;
+		};
+
+		rg.AddPass<InitialSamplingPassData>("ReSTIR GI Initial Sampling Pass",
+			[=](InitialSamplingPassData& data, RenderGraphBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.WriteBuffer(RG_NAME(ReSTIR_GI_StagingReservoir));
+			},
+			[=](InitialSamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadWriteBuffer(data.reservoirs)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				//secondary hits are shaded with direct light and DDGI irradiance, misses sample the sky
+				struct InitialSamplingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 reservoirs_idx;
+					Float  max_ray_distance;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .reservoirs_idx = i + 2,
+					.max_ray_distance = ReSTIRGIMaxRayDistance.Get()
+				};
+				cmd_list->SetPipelineState(initial_sampling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute);
+	}
+
+	void ReSTIR_GI::AddTemporalResamplingPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct TemporalResamplingPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGTextureReadOnlyId velocity;
+			RGTextureReadOnlyId prev_depth;
+			RGBufferReadOnlyId  reservoirs;
+			RGBufferReadOnlyId  history_reservoirs;
+			RGBufferReadWriteId output_reservoirs;
+		};
+
+		Bool const use_history = history_valid;
+		rg.AddPass<TemporalResamplingPassData>("ReSTIR GI Temporal Resampling Pass",
+			[=](TemporalResamplingPassData& data, RGBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.velocity = builder.ReadTexture(RG_NAME(VelocityBuffer), ReadAccess_NonPixelShader);
+				data.prev_depth = builder.ReadTexture(RG_NAME(DepthHistory), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.ReadBuffer(RG_NAME(ReSTIR_GI_StagingReservoir), ReadAccess_NonPixelShader);
+				data.history_reservoirs = builder.ReadBuffer(RG_NAME(ReSTIR_GI_ReservoirHistory), ReadAccess_NonPixelShader);
+				data.output_reservoirs = builder.WriteBuffer(RG_NAME(ReSTIR_GI_Reservoir));
+			},
+			[=](TemporalResamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyTexture(data.velocity),
+					ctx.GetReadOnlyTexture(data.prev_depth),
+					ctx.GetReadOnlyBuffer(data.reservoirs),
+					ctx.GetReadOnlyBuffer(data.history_reservoirs),
+					ctx.GetReadWriteBuffer(data.output_reservoirs)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct TemporalResamplingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 velocity_idx;
+					Uint32 prev_depth_idx;
+					Uint32 reservoirs_idx;
+					Uint32 history_reservoirs_idx;
+					Uint32 output_reservoirs_idx;
+					Uint32 max_history;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .velocity_idx = i + 2, .prev_depth_idx = i + 3,
+					.reservoirs_idx = i + 4, .history_reservoirs_idx = i + 5, .output_reservoirs_idx = i + 6,
+					.max_history = use_history ? (Uint32)std::max(ReSTIRGIMaxHistory.Get(), 1) : 0u
+				};
+				cmd_list->SetPipelineState(temporal_resampling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute);
+	}
+
+	void ReSTIR_GI::AddSpatialResamplingPass(RenderGraph& rg, RGResourceName input)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct SpatialResamplingPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId normal;
+			RGBufferReadOnlyId  reservoirs;
+			RGBufferReadWriteId output_reservoirs;
+		};
+
+		RGResourceName const output = input == RG_NAME(ReSTIR_GI_StagingReservoir) ? RG_NAME(ReSTIR_GI_Reservoir) : RG_NAME(ReSTIR_GI_StagingReservoir);
+		rg.AddPass<SpatialResamplingPassData>("ReSTIR GI Spatial Resampling Pass",
+			[=](SpatialResamplingPassData& data, RGBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.ReadBuffer(input, ReadAccess_NonPixelShader);
+				data.output_reservoirs = builder.WriteBuffer(output);
+			},
+			[=](SpatialResamplingPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyBuffer(data.reservoirs),
+					ctx.GetReadWriteBuffer(data.output_reservoirs)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				//spatial neighbours are reconnected to the current pixel with a visibility ray to keep the estimator unbiased
+				struct SpatialResamplingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 reservoirs_idx;
+					Uint32 output_reservoirs_idx;
+					Uint32 sample_count;
+					Float  sample_radius;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .reservoirs_idx = i + 2, .output_reservoirs_idx = i + 3,
+					.sample_count = (Uint32)std::max(ReSTIRGISpatialSamples.Get(), 1),
+					.sample_radius = ReSTIRGISpatialRadius.Get()
+				};
+				cmd_list->SetPipelineState(spatial_resampling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute);
+	}
+
+	void ReSTIR_GI::AddResolvePass(RenderGraph& rg, RGResourceName reservoirs)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct ResolvePassData
+		{
+			RGTextureReadOnlyId  depth;
+			RGTextureReadOnlyId  normal;
+			RGBufferReadOnlyId   reservoirs;
+			RGTextureReadWriteId irradiance;
+		};
+
+		rg.AddPass<ResolvePassData>("ReSTIR GI Resolve Pass",
+			[=](ResolvePassData& data, RGBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.reservoirs = builder.ReadBuffer(reservoirs, ReadAccess_NonPixelShader);
+				data.irradiance = builder.WriteTexture(RG_NAME(ReSTIR_GI_Irradiance));
+			},
+			[=](ResolvePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadOnlyTexture(data.normal),
+					ctx.GetReadOnlyBuffer(data.reservoirs),
+					ctx.GetReadWriteTexture(data.irradiance)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct ResolveConstants
+				{
+					Uint32 depth_idx;
+					Uint32 normal_idx;
+					Uint32 reservoirs_idx;
+					Uint32 irradiance_idx;
+				} constants =
+				{
+					.depth_idx = i, .normal_idx = i + 1, .reservoirs_idx = i + 2, .irradiance_idx = i + 3
+				};
+				cmd_list->SetPipelineState(resolve_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute);
+	}
+
+	void ReSTIR_GI::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_ReSTIRGI_InitialSampling;
+		initial_sampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ReSTIRGI_TemporalResampling;
+		temporal_resampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ReSTIRGI_SpatialResampling;
+		spatial_resampling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_ReSTIRGI_Resolve;
+		resolve_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void ReSTIR_GI::CreateResources()
+	{
+		GfxBufferDesc reservoir_buffer_desc = StructuredBufferDesc<ReSTIR_GI_Reservoir>(width * height, true, false);
+		staging_reservoir_buffer = gfx->CreateBuffer(reservoir_buffer_desc);
+		reservoir_buffers[0] = gfx->CreateBuffer(reservoir_buffer_desc);
+		reservoir_buffers[1] = gfx->CreateBuffer(reservoir_buffer_desc);
+		history_valid = false;
+
+		GfxTextureDesc irradiance_desc{};
+		irradiance_desc.width = width;
+		irradiance_desc.height = height;
+		irradiance_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+		irradiance_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		irradiance_desc.initial_state = GfxResourceState::ComputeUAV;
+		irradiance_texture = gfx->CreateTexture(irradiance_desc);
+
+		if (!irradiance_srv_gpu.IsValid()) irradiance_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+		irradiance_srv = gfx->CreateTextureSRV(irradiance_texture.get());
+		gfx->CopyDescriptors(1, irradiance_srv_gpu, irradiance_srv);
+	}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "Graphics/GfxDescriptor.h"
+#include "RenderGraph/RenderGraphResourceName.h"
+
+
+namespace adria
+{
+	class GfxBuffer;
+	class GfxTexture;
+	class GfxDevice;
+	class GfxComputePipelineState;
+	class RenderGraph;
+
+	class ReSTIR_GI
+	{
+		enum class ResamplingMode : Uint8
+		{
+			None = 0,
+			Temporal = 1,
+			Spatial = 2,
+			TemporalAndSpatial = 3
+		};
+
+	public:
+		ReSTIR_GI(GfxDevice* gfx, Uint32 width, Uint32 height);
+		~ReSTIR_GI();
+
+		void AddPasses(RenderGraph& rg);
+		void GUI();
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+			if (supported) CreateResources();
+		}
+		void ResetHistory() { history_valid = false; }
+		Bool IsSupported() const { return supported; }
+		Bool IsEnabled() const;
+		Int32 GetIrradianceIndex() const { return (Int32)irradiance_srv_gpu.GetIndex(); }
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+
+		Bool supported = false;
+		ResamplingMode resampling_mode = ResamplingMode::TemporalAndSpatial;
+
+		std::unique_ptr<GfxBuffer>  staging_reservoir_buffer;
+		std::unique_ptr<GfxBuffer>	reservoir_buffers[2];
+		Uint32 history_index = 0;
+		Bool history_valid = false;
+
+		std::unique_ptr<GfxTexture> irradiance_texture;
+		GfxDescriptor irradiance_srv;
+		GfxDescriptor irradiance_srv_gpu;
+
+		std::unique_ptr<GfxComputePipelineState> initial_sampling_pso;
+		std::unique_ptr<GfxComputePipelineState> temporal_resampling_pso;
+		std::unique_ptr<GfxComputePipelineState> spatial_resampling_pso;
+		std::unique_ptr<GfxComputePipelineState> resolve_pso;
+
+	private:
+		void AddInitialSamplingPass(RenderGraph& rg);
+		void AddTemporalResamplingPass(RenderGraph& rg);
+		void AddSpatialResamplingPass(RenderGraph& rg, RGResourceName input);
+		void AddResolvePass(RenderGraph& rg, RGResourceName reservoirs);
+
+		void CreatePSOs();
+		void CreateResources();
+	};
+}
@@ -1,6 +1,7 @@
 #include "ReflectionPassGroup.h"
 #include "RayTracedReflectionsPass.h"
 #include "SSRPass.h"
+#include "Postprocessor.h"
 #include "Core/ConsoleManager.h"
 #include "Editor/GUICommand.h"
 
@@ -12,10 +13,11 @@ namespace adria
 		ReflectionType_None,
 		ReflectionType_SSR,
 		ReflectionType_RTR,
+		ReflectionType_Hybrid,
 		ReflectionType_Count
 	};
 
-	static TAutoConsoleVariable<int> Reflection("r.Reflections", ReflectionType_SSR, "0 - No Reflections, 1 - SSR, 2 - RTR");
+	static TAutoConsoleVariable<int> Reflection("r.Reflections", ReflectionType_SSR, "0 - No Reflections, 1 - SSR, 2 - RTR, 3 - SSR with RTR for rays SSR could not resolve");
 
 	ReflectionPassGroup::ReflectionPassGroup(GfxDevice* gfx, Uint32 width, Uint32 height) : reflection_type(ReflectionType_SSR)
 	{
@@ -30,20 +32,61 @@ namespace adria
 		post_effects[ReflectionType_None] = std::make_unique<EmptyPostEffect>();
 		post_effects[ReflectionType_SSR]  = std::make_unique<SSRPass>(gfx, width, height);
 		post_effects[ReflectionType_RTR]  = std::make_unique<RayTracedReflectionsPass>(gfx, width, height);
+		post_effects[ReflectionType_Hybrid] = std::make_unique<EmptyPostEffect>();
 		is_rtr_supported = post_effects[ReflectionType_RTR]->IsSupported();
 	}
 
+	void ReflectionPassGroup::AddPass(RenderGraph& rg, PostProcessor* postprocessor)
+	{
+		Bool const ray_tracing_ready = postprocessor->IsRayTracingReady();
+		if ((reflection_type == ReflectionType_RTR || reflection_type == ReflectionType_Hybrid) && !ray_tracing_ready)
+		{
+			if (post_effects[ReflectionType_SSR]->IsEnabled(postprocessor)) post_effects[ReflectionType_SSR]->AddPass(rg, postprocessor);
+			return;
+		}
+		if (reflection_type == ReflectionType_Hybrid)
+		{
+			//ssr is traced first, rtr reads SSR_Reflection and only traces pixels without a confident screen space hit
+			SSRPass* ssr_pass = static_cast<SSRPass*>(post_effects[ReflectionType_SSR].get());
+			if (ssr_pass->IsEnabled(postprocessor)) ssr_pass->AddPass(rg, postprocessor);
+			if (post_effects[ReflectionType_RTR]->IsEnabled(postprocessor)) post_effects[ReflectionType_RTR]->AddPass(rg, postprocessor);
+			return;
+		}
+		PostEffectGroup::AddPass(rg, postprocessor);
+	}
+
+	Bool ReflectionPassGroup::IsEnabled(PostProcessor const* postprocessor) const
+	{
+		if (reflection_type == ReflectionType_Hybrid) return true;
+		return PostEffectGroup::IsEnabled(postprocessor);
+	}
+
+	Bool ReflectionPassGroup::NeedsHZB() const
+	{
+		return UsesSSR() && static_cast<SSRPass const*>(post_effects[ReflectionType_SSR].get())->NeedsHZB();
+	}
+
+	Bool ReflectionPassGroup::UsesSSR() const
+	{
+		return reflection_type == ReflectionType_SSR || reflection_type == ReflectionType_Hybrid || (reflection_type == ReflectionType_RTR && !is_rtr_supported);
+	}
+
 	void ReflectionPassGroup::GroupGUI()
 	{
 		QueueGUI([&]()
 			{
 				static Int current_reflection_type = (Int)reflection_type;
-				if (ImGui::Combo("Reflections", &current_reflection_type, "None\0SSR\0RTR\0", 3))
+				if (ImGui::Combo("Reflections", &current_reflection_type, "None\0SSR\0RTR\0Hybrid\0", 4))
 				{
-					if (!is_rtr_supported && current_reflection_type == 2) current_reflection_type = 1;
+					if (!is_rtr_supported && current_reflection_type >= 2) current_reflection_type = 1;
 					Reflection->Set(current_reflection_type);
 				}
 			}, GUICommandGroup_PostProcessing, GUICommandSubGroup_Reflection);
+		if (reflection_type == ReflectionType_Hybrid)
+		{
+			post_effects[ReflectionType_SSR]->GUI();
+			post_effects[ReflectionType_RTR]->GUI();
+		}
 	}
 
 }
@@ -11,11 +11,16 @@ namespace adria
 	public:
 		ReflectionPassGroup(GfxDevice* gfx, Uint32 width, Uint32 height);
 
+		virtual void AddPass(RenderGraph& rg, PostProcessor* postprocessor) override;
+		virtual Bool IsEnabled(PostProcessor const* postprocessor) const override;
+		Bool NeedsHZB() const;
+
 	private:
 		ReflectionType reflection_type;
 		Bool is_rtr_supported;
 
 	private:
+		Bool UsesSSR() const;
 		virtual void GroupGUI() override;
 	};
 }
\ No newline at end of file
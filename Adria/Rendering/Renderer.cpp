@@ -6,23 +6,29 @@
 #include "SkyModel.h"
 #include "TextureManager.h"
 #include "DebugRenderer.h"
+#include "ExponentialHeightFogPass.h"
 
 #include "Editor/GUICommand.h"
 #include "Editor/Editor.h"
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxTexture.h"
+#include "Graphics/GfxReadbackQueue.h"
+#include "Graphics/GfxUploadManager.h"
 #include "Graphics/GfxCommon.h"
 #include "Graphics/GfxPipelineState.h"
 #include "Graphics/GfxProfiler.h"
 #include "Graphics/GfxTracyProfiler.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Utilities/ThreadPool.h"
+#include "Utilities/JobSystem.h"
 #include "Utilities/Random.h"
 #include "Utilities/ImageWrite.h"
 #include "Math/Constants.h"
 #include "Logging/Logger.h"
 #include "Core/Paths.h"
 #include "Core/ConsoleManager.h"
+#include "Core/CpuProfiler.h"
+#include "Core/MemoryTracker.h"
 #include "entt/entity/registry.hpp"
 
 
@@ -30,38 +36,49 @@ using namespace DirectX;
 
 namespace adria
 {
-	static TAutoConsoleVariable<int>  LightingPath("r.LightingPath", 0, "0 - Deferred, 1 - Tiled Deferred, 2 - Clustered Deferred, 3 - Path Tracing");
-	static TAutoConsoleVariable<int>  VolumetricPath("r.VolumetricPath", 1, "0 - None, 1 - 2D Raymarching, 2 - Fog Volume");
-
-	Renderer::Renderer(entt::registry& reg, GfxDevice* gfx, Uint32 width, Uint32 height) : reg(reg), gfx(gfx), resource_pool(gfx),
-		accel_structure(gfx), camera(nullptr), display_width(width), display_height(height), render_width(width), render_height(height),
+	static TAutoConsoleVariable<int>  LightingPath("r.LightingPath", 0, "0 - Deferred, 1 - Tiled Deferred, 2 - Clustered Deferred, 3 - Path Tracing, 4 - ReSTIR DI");
+	static TAutoConsoleVariable<int>  VolumetricPath("r.VolumetricPath", 2, "0 - None, 1 - 2D Raymarching, 2 - Froxel Fog Volume");
+	static TAutoConsoleVariable<Int>  ScreenshotFormat("r.Screenshot.Format", 0, "0 - PNG, 1 - QOI, 2 - EXR");
+	static TAutoConsoleVariable<Int>  ScreenshotSequence("r.Screenshot.Sequence", 0, "Capture a screenshot of each of the next N frames");
+	static TAutoConsoleVariable<Float> LODErrorThreshold("r.LOD.ErrorThreshold", 1.0f, "Screen space simplification error in pixels a mesh LOD may have, 0 always renders LOD 0");
+
+	Renderer::Renderer(entt::registry& reg, GfxDevice* gfx, Uint32 width, Uint32 height) : reg(reg), gfx(gfx), resource_pool(gfx), transform_system(reg), animation_system(reg),
+		accel_structure(gfx), light_tree(gfx), camera(nullptr), display_width(width), display_height(height), render_width(width), render_height(height),
 		backbuffer_count(gfx->GetBackbufferCount()), backbuffer_index(gfx->GetBackbufferIndex()), final_texture(nullptr),
-		frame_cbuffer(gfx, backbuffer_count), gpu_driven_renderer(reg, gfx, width, height),
+		frame_cbuffer(gfx, backbuffer_count), hzb_pass(gfx, width, height), occlusion_query_pass(gfx), gpu_driven_renderer(reg, gfx, hzb_pass, width, height),
 		gbuffer_pass(reg, gfx, width, height),
 		sky_pass(reg, gfx, width, height), deferred_lighting_pass(gfx, width, height), 
 		volumetric_lighting_pass(gfx, width, height), volumetric_fog_pass(gfx, reg, width, height),
 		tiled_deferred_lighting_pass(reg, gfx, width, height) , copy_to_texture_pass(gfx, width, height), add_textures_pass(gfx, width, height),
 		postprocessor(gfx, reg, width, height), picking_pass(gfx, width, height),
 		clustered_deferred_lighting_pass(reg, gfx, width, height),
-		decals_pass(reg, gfx, width, height), rain_pass(reg, gfx, width, height), ocean_renderer(reg, gfx, width, height),
+		decals_pass(reg, gfx, width, height), rain_pass(reg, gfx, width, height), particles_pass(reg, gfx, width, height), transparent_pass(reg, gfx, width, height), forward_plus_pass(reg, gfx, width, height), skinning_pass(reg, gfx), gpu_primitives(gfx), ocean_renderer(reg, gfx, width, height), terrain_renderer(reg, gfx, width, height),
 		shadow_renderer(reg, gfx, width, height), renderer_output_pass(gfx, width, height),
-		path_tracer(gfx, width, height), ddgi(gfx, reg, width, height), gpu_debug_printer(gfx)
+		path_tracer(gfx, width, height), ddgi(gfx, reg, width, height), restir_di(gfx, width, height), restir_gi(gfx, width, height), gpu_debug_printer(gfx), mip_generation_pass(gfx),
+		video_capture_pass(gfx, width, height)
 	{
 		ray_tracing_supported = gfx->GetCapabilities().SupportsRayTracing();
+		//with cpu visible video memory (gpu upload heap or cache coherent UMA) the buffers are written in place instead of copied
+		scene_buffers_cpu_writable = gfx->GetCapabilities().SupportsGPUUploadHeap() || gfx->GetCapabilities().IsCacheCoherentUMA();
 
 		g_DebugRenderer.Initialize(gfx, width, height);
 		g_GfxProfiler.Initialize(gfx);
 		GfxTracyProfiler::Initialize(gfx);
 		CreateSizeDependentResources();
 
+		postprocessor.SetOcclusionQueryPass(&occlusion_query_pass);
 		postprocessor.AddRenderResolutionChangedCallback(RenderResolutionChangedDelegate::CreateMember(&Renderer::OnRenderResolutionChanged, *this));
 		shadow_renderer.GetShadowTextureRenderedEvent().AddMember(&DeferredLightingPass::OnShadowTextureRendered, deferred_lighting_pass);
 		shadow_renderer.GetShadowTextureRenderedEvent().AddMember(&VolumetricLightingPass::OnShadowTextureRendered, volumetric_lighting_pass);
+		shadow_renderer.GetShadowTextureRenderedEvent().AddMember(&DDGIPass::OnShadowTextureRendered, ddgi);
 
 		rain_pass.GetRainEvent().AddMember(&PostProcessor::OnRainEvent, postprocessor);
 		rain_pass.GetRainEvent().AddMember(&GPUDrivenGBufferPass::OnRainEvent, gpu_driven_renderer);
 		rain_pass.GetRainEvent().AddMember(&GBufferPass::OnRainEvent, gbuffer_pass);
-		screenshot_fence.Create(gfx, "Screenshot Fence");
+
+		reg.on_construct<Mesh>().connect<&Renderer::OnMeshChanged>(this);
+		reg.on_update<Mesh>().connect<&Renderer::OnMeshChanged>(this);
+		reg.on_destroy<Mesh>().connect<&Renderer::OnMeshChanged>(this);
 
 		{
 			LightingPath->AddOnChanged(ConsoleVariableDelegate::CreateLambda([this](IConsoleVariable* cvar) { lighting_path = static_cast<LightingPathType>(cvar->GetInt()); }));
@@ -74,6 +91,9 @@ namespace adria
 		GfxTracyProfiler::Destroy();
 		g_GfxProfiler.Destroy();
 		gfx->WaitForGPU();
+		reg.on_construct<Mesh>().disconnect(this);
+		reg.on_update<Mesh>().disconnect(this);
+		reg.on_destroy<Mesh>().disconnect(this);
 		reg.clear();
 		gfxcommon::Destroy();
 	}
@@ -93,19 +113,38 @@ namespace adria
 		ADRIA_ASSERT(_camera);
 		camera = _camera;
 		backbuffer_index = gfx->GetBackbufferIndex();
+		if (final_texture->GetDesc().format != gfx->GetBackbufferFormat()) CreateSizeDependentResources();
+		//the editor shows the scene through the UI, which is composited in SDR and encoded for the display afterwards
+		postprocessor.SetOutputColorSpace(g_Editor.IsActive() ? GfxColorSpace::SDR : gfx->GetColorSpace());
 		g_GfxProfiler.NewFrame();
 		GfxTracyProfiler::NewFrame();
 	}
 	void Renderer::Update(Float dt)
 	{
+		postprocessor.UpdateDynamicResolution();
+		ApplyRenderResolutionChange();
 		shadow_renderer.SetupShadows(camera);
+		{
+			MemoryTagScope memory_scope(MemoryTag::ECS);
+			transform_system.Update();
+		}
 		UpdateSceneBuffers();
+		{
+			MemoryTagScope memory_scope(MemoryTag::ECS);
+			animation_system.Update(dt);
+		}
+		skinning_pass.Update(animation_system.GetPosedEntities());
+		ForwardSkinnedInstances();
+		shadow_renderer.SetBatchBVH(&batch_bvh, batch_entities);
 		UpdateFrameConstants(dt);
 		CameraFrustumCulling();
 	}
 	void Renderer::Render()
 	{
-		RenderGraph render_graph(resource_pool);
+		g_TextureManager.Update();
+		UploadFrameConstants();
+		MemoryTagScope memory_scope(MemoryTag::RenderGraph);
+		RenderGraph render_graph(resource_pool, &render_graph_cache);
 		RGBlackboard& rg_blackboard = render_graph.GetBlackboard();
 		FrameBlackboardData frame_data{};
 		{
@@ -132,17 +171,37 @@ namespace adria
 		render_graph.ImportTexture(RG_NAME(FinalTexture), final_texture.get());
 		postprocessor.ImportHistoryResources(render_graph);
 
+		mip_generation_pass.AddPass(render_graph);
 		gpu_debug_printer.AddClearPass(render_graph);
-		if (lighting_path == LightingPathType::PathTracing) Render_PathTracing(render_graph);
+		g_DebugRenderer.AddClearGPUPrimitivesPass(render_graph);
+		skinning_pass.AddPass(render_graph);
+		gpu_primitives.AddBenchmarkPasses(render_graph);
+		accel_structure.AddTLASUpdatePass(render_graph);
+		postprocessor.SetRayTracingReady(IsRayTracingReady());
+		if (lighting_path == LightingPathType::PathTracing && IsRayTracingReady()) Render_PathTracing(render_graph);
 		else Render_Deferred(render_graph);
+		if (ScreenshotSequence.Get() > 0 && !take_screenshot)
+		{
+			OnTakeScreenshot(("adria_sequence_" + std::to_string(screenshot_sequence_frame++)).c_str());
+			ScreenshotSequence->Set(ScreenshotSequence.Get() - 1);
+		}
+		else if (ScreenshotSequence.Get() <= 0) screenshot_sequence_frame = 0;
 		if (take_screenshot) TakeScreenshot(render_graph);
+		video_capture_pass.AddPasses(render_graph);
 		gpu_debug_printer.AddPrintPass(render_graph);
 
 		if (!g_Editor.IsActive()) CopyToBackbuffer(render_graph);
 		else g_Editor.AddRenderPass(render_graph);
 
-		render_graph.Build();
-		render_graph.Execute();
+		{
+			AdriaCpuProfileScope("Render Graph Build");
+			render_graph.Build();
+		}
+		{
+			AdriaCpuProfileScope("Render Graph Execute");
+			render_graph.Execute();
+		}
+		accel_structure.Update();
 
 		GUI();
 	}
@@ -152,19 +211,34 @@ namespace adria
 		if (display_width != w || display_height != h)
 		{
 			display_width = w; display_height = h;
+			resource_pool.EvictIdleTextures();
 			CreateSizeDependentResources();
 			postprocessor.OnResize(w, h);
 			g_DebugRenderer.OnResize(w, h);
 			path_tracer.OnResize(w, h);
 			renderer_output_pass.OnResize(w, h);
+			video_capture_pass.OnResize(w, h);
 		}
 	}
+	//the upscaler can report several changes per frame (display resize, dynamic resolution), only the last one is applied
 	void Renderer::OnRenderResolutionChanged(Uint32 w, Uint32 h)
 	{
+		pending_render_resolution = Vector2u(w, h);
+	}
+
+	void Renderer::ApplyRenderResolutionChange()
+	{
+		if (!pending_render_resolution) return;
+		Uint32 const w = pending_render_resolution->x, h = pending_render_resolution->y;
+		pending_render_resolution.reset();
+
+		postprocessor.OnRenderResolutionChanged(w, h);
 		if (render_width != w || render_height != h)
 		{
 			render_width = w, render_height = h;
+			resource_pool.EvictIdleTextures();
 
+			hzb_pass.OnResize(w, h);
 			gbuffer_pass.OnResize(w, h);
 			gpu_driven_renderer.OnResize(w, h);
 			sky_pass.OnResize(w, h);
@@ -178,20 +252,26 @@ namespace adria
 			picking_pass.OnResize(w, h);
 			decals_pass.OnResize(w, h);
 			ocean_renderer.OnResize(w, h);
+			terrain_renderer.OnResize(w, h);
 			shadow_renderer.OnResize(w, h);
 			ddgi.OnResize(w, h);
+			restir_di.OnResize(w, h);
+			restir_gi.OnResize(w, h);
 			rain_pass.OnResize(w, h);
+			particles_pass.OnResize(w, h);
+			transparent_pass.OnResize(w, h);
+			forward_plus_pass.OnResize(w, h);
 		}
 	}
 
-	void Renderer::OnSceneInitialized()
+	void Renderer::OnSceneInitialized(Uint64 scene_hash)
 	{
 		sky_pass.OnSceneInitialized();
 		decals_pass.OnSceneInitialized();
 		rain_pass.OnSceneInitialized();
 		postprocessor.OnSceneInitialized();
 		ocean_renderer.OnSceneInitialized();
-		ddgi.OnSceneInitialized();
+		ddgi.OnSceneInitialized(scene_hash);
 		volumetric_fog_pass.OnSceneInitialized();
 		CreateAS();
 
@@ -204,6 +284,11 @@ namespace adria
 	}
 	void Renderer::OnTakeScreenshot(Char const* filename)
 	{
+		if (final_texture->GetDesc().format != GfxFormat::R8G8B8A8_UNORM)
+		{
+			ADRIA_LOG(WARNING, "Screenshots are only supported with SDR output!");
+			return;
+		}
 		screenshot_name = filename;
 		if (screenshot_name.empty())
 		{
@@ -214,9 +299,32 @@ namespace adria
 		take_screenshot = true;
 	}
 
+	//the caller has to make sure the GPU is idle so every pending screenshot readback has completed
+	void Renderer::FlushScreenshots()
+	{
+		gfx->GetReadbackQueue()->Flush();
+		for (std::future<void>& write : screenshot_writes) write.wait();
+		screenshot_writes.clear();
+	}
+
+	Bool Renderer::NeedsContinuousRendering() const
+	{
+		//the path tracer keeps accumulating until it reaches its target sample count
+		if (lighting_path == LightingPathType::PathTracing && IsRayTracingReady() && !path_tracer.IsConverged()) return true;
+		if (ray_tracing_supported && accel_structure.GetInstanceCount() > 0 && !accel_structure.IsReady()) return true;
+		if (video_capture_pass.IsCapturing() || rain_pass.IsEnabled() || take_screenshot) return true;
+		if (!reg.view<ParticleEmitter>().empty() || !reg.view<Ocean>().empty()) return true;
+		for (auto&& [entity, skeleton] : reg.view<Skeleton>().each())
+		{
+			if (skeleton.playing && !skeleton.clips.empty()) return true;
+		}
+		return false;
+	}
+
 	void Renderer::OnLightChanged()
 	{
 		path_tracer.Reset();
+		shadow_renderer.OnLightChanged();
 	}
 
 	void Renderer::CreateSizeDependentResources()
@@ -224,10 +332,11 @@ namespace adria
 		GfxTextureDesc ldr_desc{};
 		ldr_desc.width = display_width;
 		ldr_desc.height = display_height;
-		ldr_desc.format = GfxFormat::R8G8B8A8_UNORM;
+		ldr_desc.format = gfx->GetBackbufferFormat();
 		ldr_desc.bind_flags = GfxBindFlag::UnorderedAccess | GfxBindFlag::ShaderResource | GfxBindFlag::RenderTarget;
 		ldr_desc.initial_state = GfxResourceState::ComputeUAV;
 		final_texture = gfx->CreateTexture(ldr_desc);
+		++final_texture_generation;
 	}
 	void Renderer::CreateAS()
 	{
@@ -244,18 +353,79 @@ namespace adria
 		accel_structure.Build();
 	}
 
+	void Renderer::UpdateAS()
+	{
+		if (!ray_tracing_supported) return;
+
+		auto ray_tracing_view = reg.view<Mesh, RayTracing>();
+		Uint32 instance_count = 0;
+		for (auto entity : ray_tracing_view) instance_count += (Uint32)ray_tracing_view.get<Mesh>(entity).instances.size();
+		Bool const rebuild = instance_count != accel_structure.GetInstanceCount();
+		if (rebuild) CreateAS();
+
+		Uint32 instance_index = 0;
+		for (auto entity : ray_tracing_view)
+		{
+			Mesh const& mesh = ray_tracing_view.get<Mesh>(entity);
+			if (auto it = scene_mesh_range_indices.find(entity); it != scene_mesh_range_indices.end()) scene_mesh_ranges[it->second].first_rt_instance = instance_index;
+			if (rebuild)
+			{
+				instance_index += (Uint32)mesh.instances.size();
+				continue;
+			}
+			for (SubMeshInstance const& instance : mesh.instances)
+			{
+				accel_structure.SetInstanceTransform(instance_index++, mesh.submeshes[instance.submesh_index], instance.world_transform);
+			}
+		}
+	}
+
 	void Renderer::UpdateSceneBuffers()
 	{
-		volumetric_lights = 0;
-		for (auto e : reg.view<Batch>()) reg.destroy(e);
-		reg.clear<Batch>();
+		AdriaCpuProfileScope("UpdateSceneBuffers");
+		auto CopyBuffer = [&]<typename T>(std::vector<T> const& data, SceneBuffer& scene_buffer)
+		{
+			if (data.empty()) return;
+			if (scene_buffers_cpu_writable)
+			{
+				WriteSceneBuffer(scene_buffer, StructuredBufferDesc<T>(data.size(), false, true), data.data(), data.size() * sizeof(T), 0);
+				return;
+			}
+			std::unique_ptr<GfxBuffer>& buffer = scene_buffer.buffers[0];
+			if (!buffer || buffer->GetCount() < data.size())
+			{
+				buffer = gfx->CreateBuffer(StructuredBufferDesc<T>(data.size(), false, false));
+				scene_buffer.buffer_srvs[0] = gfx->CreateBufferSRV(buffer.get());
+				gfx->FreePersistentDescriptorGPU(scene_buffer.buffer_srvs_gpu[0]);
+				scene_buffer.buffer_srvs_gpu[0] = gfx->AllocatePersistentDescriptorGPU();
+				gfx->CopyDescriptors(1, scene_buffer.buffer_srvs_gpu[0], scene_buffer.buffer_srvs[0]);
+			}
+			gfx->GetUploadManager()->UploadBuffer(*buffer, data.data(), data.size() * sizeof(T));
+		};
 
+		volumetric_lights = 0;
+		light_query_offset = OcclusionQueryPass::INVALID_QUERY;
+		Bool light_queries = occlusion_query_pass.IsEnabled() && !(lighting_path == LightingPathType::PathTracing && IsRayTracingReady());
 		std::vector<LightGPU> hlsl_lights{};
 		Uint32 light_index = 0;
-		Matrix light_transform = lighting_path == LightingPathType::PathTracing ? Matrix::Identity : camera->View();
+		Matrix light_transform = lighting_path == LightingPathType::PathTracing && IsRayTracingReady() ? Matrix::Identity : camera->View();
 		for (auto light_entity : reg.view<Light>())
 		{
 			Light& light = reg.get<Light>(light_entity);
+			Uint32 const light_id = entt::to_integral(light_entity);
+			Bool const light_visible = light.type == LightType::Directional || occlusion_query_pass.IsVisible(OcclusionQueryGroup::Light, light_id);
+			if (light_queries)
+			{
+				//directional lights get a sphere around the camera which always passes, keeping the queries indexable by light index
+				BoundingSphere const light_bounds = light.type == LightType::Directional ? BoundingSphere(camera->Position(), camera->Near() * 2.0f) : BoundingSphere(Vector3(light.position), light.range);
+				Uint32 const query = occlusion_query_pass.AddQuery(OcclusionQueryGroup::Light, light_id, light_bounds);
+				if (light_index == 0) light_query_offset = query;
+				if (query == OcclusionQueryPass::INVALID_QUERY)
+				{
+					light_query_offset = OcclusionQueryPass::INVALID_QUERY;
+					light_queries = false;
+				}
+			}
 			light.light_index = light_index;
 			++light_index;
 
@@ -267,61 +437,274 @@ namespace adria
 			hlsl_light.type = static_cast<Int32>(light.type);
 			hlsl_light.inner_cosine = light.inner_cosine;
 			hlsl_light.outer_cosine = light.outer_cosine;
-			hlsl_light.volumetric = light.volumetric;
+			hlsl_light.volumetric = light.volumetric && light_visible;
 			hlsl_light.volumetric_strength = light.volumetric_strength;
 			hlsl_light.active = light.active;
 			hlsl_light.shadow_matrix_index = light.casts_shadows ? light.shadow_matrix_index : -1;
 			hlsl_light.shadow_texture_index = light.casts_shadows ? light.shadow_texture_index : -1;
-			hlsl_light.shadow_mask_index = light.ray_traced_shadows ? light.shadow_mask_index : -1;
+			hlsl_light.shadow_mask_index = light.ray_traced_shadows && IsRayTracingReady() ? light.shadow_mask_index : -1;
+			hlsl_light.shadow_page_table_index = light.casts_shadows ? light.shadow_page_table_index : -1;
 			hlsl_light.use_cascades = light.use_cascades;
-			if (light.volumetric) ++volumetric_lights;
+			if (hlsl_light.volumetric) ++volumetric_lights;
+		}
+		CopyBuffer(hlsl_lights, scene_buffers[SceneBuffer_Light]);
+		light_tree.Update(reg);
+
+		ApplyWorldTransforms();
+		if (scene_meshes_dirty)
+		{
+			std::vector<MaterialGPU> scene_materials;
+			scene_instances.clear();
+			RebuildSceneMeshes(scene_instances, scene_materials);
+			CopyBuffer(scene_instances, scene_buffers[SceneBuffer_Instance]);
+			CopyBuffer(scene_materials, scene_buffers[SceneBuffer_Material]);
+			CopyBuffer(scene_meshes, scene_buffers[SceneBuffer_Mesh]);
+			UpdateAS();
+			scene_meshes_dirty = false;
+		}
+		else
+		{
+			//instances that moved last frame are at rest unless they moved again, so their previous transform catches up
+			std::vector<Uint32> dirty_instances = std::move(moved_instances);
+			moved_instances.clear();
+			for (Uint32 instance_id : dirty_instances)
+			{
+				Batch& batch = reg.get<Batch>(batch_entities[instance_id]);
+				batch.prev_world_transform = batch.world_transform;
+				batch.dynamic = false;
+				scene_instances[instance_id].prev_world_matrix = scene_instances[instance_id].world_matrix;
+			}
+			ForwardInstanceTransforms();
+			dirty_instances.insert(dirty_instances.end(), moved_instances.begin(), moved_instances.end());
+			UploadSceneInstances(dirty_instances);
+			batch_bvh.Update();
+		}
+	}
+
+	void Renderer::ApplyWorldTransforms()
+	{
+		for (entt::entity entity : transform_system.GetChangedEntities())
+		{
+			Mesh* mesh = reg.try_get<Mesh>(entity);
+			if (!mesh) continue;
+			Matrix const& world_transform = reg.get<WorldTransform>(entity).transform;
+			for (SubMeshInstance& instance : mesh->instances) instance.world_transform = instance.local_transform * world_transform;
+		}
+	}
+
+	void Renderer::ForwardInstanceTransforms()
+	{
+		for (entt::entity entity : transform_system.GetChangedEntities())
+		{
+			auto it = scene_mesh_range_indices.find(entity);
+			if (it == scene_mesh_range_indices.end()) continue;
+
+			SceneMeshRange const& range = scene_mesh_ranges[it->second];
+			Mesh const& mesh = reg.get<Mesh>(entity);
+			Bool const first_move = dynamic_meshes.insert(entity).second;
+			for (Uint32 i = 0; i < mesh.instances.size(); ++i)
+			{
+				SubMeshInstance const& instance = mesh.instances[i];
+				SubMeshGPU const& submesh = mesh.submeshes[instance.submesh_index];
+				Uint32 const instance_id = range.first_instance + i;
+
+				if (first_move) reg.emplace_or_replace<DynamicBatch>(batch_entities[instance_id]);
+				Batch& batch = reg.get<Batch>(batch_entities[instance_id]);
+				batch.prev_world_transform = batch.world_transform;
+				batch.world_transform = instance.world_transform;
+				batch.dynamic = true;
+				submesh.bounding_box.Transform(batch.bounding_box, batch.world_transform);
+				batch_bounds.Set(instance_id, batch.bounding_box);
+				batch_bvh.SetItemBounds(instance_id, batch.bounding_box);
+
+				InstanceGPU& instance_gpu = scene_instances[instance_id];
+				instance_gpu.world_matrix = instance.world_transform;
+				instance_gpu.inverse_world_matrix = XMMatrixInverse(nullptr, instance.world_transform);
+				instance_gpu.prev_world_matrix = batch.prev_world_transform;
+				moved_instances.push_back(instance_id);
+
+				if (range.first_rt_instance != UINT32_MAX && range.first_rt_instance + i < accel_structure.GetInstanceCount())
+				{
+					accel_structure.SetInstanceTransform(range.first_rt_instance + i, submesh, instance.world_transform);
+				}
+			}
+		}
+	}
+
+	void Renderer::ForwardSkinnedInstances()
+	{
+		//deformed instances keep their transform but move their vertices, they are treated as moving for motion vectors and cached shadows
+		std::vector<Uint32> deformed_instances;
+		for (SkinningPass::SkinnedInstance const& instance : skinning_pass.GetInstances())
+		{
+			if (!instance.deformed && !instance.settling) continue;
+
+			Uint32 const instance_id = instance.instance_id;
+			reg.emplace_or_replace<DynamicBatch>(batch_entities[instance_id]);
+			Batch& batch = reg.get<Batch>(batch_entities[instance_id]);
+			batch.dynamic = true;
+			instance.bounds.Transform(batch.bounding_box, batch.world_transform);
+			batch_bounds.Set(instance_id, batch.bounding_box);
+			batch_bvh.SetItemBounds(instance_id, batch.bounding_box);
+
+			InstanceGPU& instance_gpu = scene_instances[instance_id];
+			instance_gpu.bb_origin = instance.bounds.Center;
+			instance_gpu.bb_extents = instance.bounds.Extents;
+			moved_instances.push_back(instance_id);
+			deformed_instances.push_back(instance_id);
+
+			SceneMeshRange const& range = scene_mesh_ranges[scene_mesh_range_indices[instance.mesh_entity]];
+			if (range.first_rt_instance != UINT32_MAX && range.first_rt_instance + instance.mesh_instance_index < accel_structure.GetInstanceCount())
+			{
+				accel_structure.RefitInstance(range.first_rt_instance + instance.mesh_instance_index, instance.vertex_buffer.get(), instance.positions_offset);
+			}
+		}
+		if (deformed_instances.empty()) return;
+		UploadSceneInstances(deformed_instances);
+		batch_bvh.Update();
+	}
+
+	void Renderer::UploadSceneInstances(std::vector<Uint32>& instance_ids)
+	{
+		SceneBuffer& instance_buffer = scene_buffers[SceneBuffer_Instance];
+		if (instance_ids.empty()) return;
+		if (scene_buffers_cpu_writable ? instance_buffer.cpu_data.empty() : !instance_buffer.buffers[0]) return;
+
+		std::sort(instance_ids.begin(), instance_ids.end());
+		instance_ids.erase(std::unique(instance_ids.begin(), instance_ids.end()), instance_ids.end());
+		for (Uint64 i = 0; i < instance_ids.size();)
+		{
+			Uint64 range_end = i + 1;
+			while (range_end < instance_ids.size() && instance_ids[range_end] == instance_ids[range_end - 1] + 1) ++range_end;
+
+			Uint32 const first_instance = instance_ids[i];
+			Uint64 const size = (range_end - i) * sizeof(InstanceGPU), offset = first_instance * sizeof(InstanceGPU);
+			if (scene_buffers_cpu_writable) WriteSceneBuffer(instance_buffer, instance_buffer.desc, &scene_instances[first_instance], size, offset);
+			else gfx->GetUploadManager()->UploadBuffer(*instance_buffer.buffers[0], &scene_instances[first_instance], size, offset);
+			i = range_end;
 		}
+	}
+
+	void Renderer::WriteSceneBuffer(SceneBuffer& scene_buffer, GfxBufferDesc const& desc, void const* data, Uint64 size, Uint64 offset)
+	{
+		if (scene_buffer.cpu_data.size() < offset + size)
+		{
+			scene_buffer.cpu_data.resize(offset + size);
+			scene_buffer.desc = desc;
+			scene_buffer.desc.resource_usage = GfxResourceUsage::GpuUpload;
+		}
+		memcpy(scene_buffer.cpu_data.data() + offset, data, size);
+		for (auto& dirty_ranges : scene_buffer.dirty_ranges) dirty_ranges.emplace_back(offset, size);
+	}
+
+	//runs after BeginFrame waited for the slot, frames still in flight only read the copies of the other slots
+	void Renderer::FlushSceneBuffers()
+	{
+		if (!scene_buffers_cpu_writable) return;
+		for (SceneBuffer& scene_buffer : scene_buffers)
+		{
+			std::vector<std::pair<Uint64, Uint64>>& dirty_ranges = scene_buffer.dirty_ranges[backbuffer_index];
+			if (dirty_ranges.empty()) continue;
+
+			std::unique_ptr<GfxBuffer>& buffer = scene_buffer.buffers[backbuffer_index];
+			if (!buffer || buffer->GetSize() < scene_buffer.cpu_data.size())
+			{
+				buffer = gfx->CreateBuffer(scene_buffer.desc);
+				scene_buffer.buffer_srvs[backbuffer_index] = gfx->CreateBufferSRV(buffer.get());
+				gfx->FreePersistentDescriptorGPU(scene_buffer.buffer_srvs_gpu[backbuffer_index]);
+				scene_buffer.buffer_srvs_gpu[backbuffer_index] = gfx->AllocatePersistentDescriptorGPU();
+				gfx->CopyDescriptors(1, scene_buffer.buffer_srvs_gpu[backbuffer_index], scene_buffer.buffer_srvs[backbuffer_index]);
+				dirty_ranges.assign(1, { 0, scene_buffer.cpu_data.size() });
+			}
+			for (auto const& [offset, size] : dirty_ranges) buffer->Update(scene_buffer.cpu_data.data() + offset, size, offset);
+			dirty_ranges.clear();
+		}
+	}
 
-		std::vector<MeshGPU> meshes;
-		std::vector<InstanceGPU> instances;
-		std::vector<MaterialGPU> materials;
+	void Renderer::RebuildSceneMeshes(std::vector<InstanceGPU>& scene_instances, std::vector<MaterialGPU>& scene_materials)
+	{
+		//batch entities persist across rebuilds and are updated in place, only the difference in instance count is created or destroyed
+		std::vector<entt::entity> prev_batch_entities = std::move(batch_entities);
+		std::erase_if(prev_batch_entities, [this](entt::entity batch_entity) { return !reg.valid(batch_entity); });
+		batch_entities.clear();
+		batch_bounds.Clear();
+		std::vector<BoundingBox> batch_boxes;
+		for (GfxDescriptor const& geometry_buffer_srv_gpu : geometry_buffer_srvs_gpu) gfx->FreePersistentDescriptorGPU(geometry_buffer_srv_gpu);
+		geometry_buffer_srvs_gpu.clear();
+		scene_mesh_ranges.clear();
+		scene_mesh_range_indices.clear();
+		scene_meshes.clear();
+		skinning_pass.Clear();
 		Uint32 instanceID = 0;
+		moved_instances.clear();
+		Uint64 mesh_instance_count = 0;
+		for (auto mesh_entity : reg.view<Mesh>()) mesh_instance_count += reg.get<Mesh>(mesh_entity).instances.size();
 
+		std::unordered_map<GfxBuffer*, GfxDescriptor> geometry_buffer_srv_map;
 		for (auto mesh_entity : reg.view<Mesh>())
 		{
 			Mesh& mesh = reg.get<Mesh>(mesh_entity);
 
 			GfxBuffer* mesh_buffer = g_GeometryBufferCache.GetGeometryBuffer(mesh.geometry_buffer_handle);
-			GfxDescriptor mesh_buffer_srv = g_GeometryBufferCache.GetGeometryBufferSRV(mesh.geometry_buffer_handle);
-			GfxDescriptor mesh_buffer_online_srv = gfx->AllocateDescriptorsGPU();
-			gfx->CopyDescriptors(1, mesh_buffer_online_srv, mesh_buffer_srv);
+			auto [srv_it, inserted] = geometry_buffer_srv_map.try_emplace(mesh_buffer);
+			if (inserted)
+			{
+				srv_it->second = gfx->AllocatePersistentDescriptorGPU();
+				gfx->CopyDescriptors(1, srv_it->second, g_GeometryBufferCache.GetGeometryBufferSRV(mesh.geometry_buffer_handle));
+				geometry_buffer_srvs_gpu.push_back(srv_it->second);
+			}
+			GfxDescriptor const mesh_buffer_srv_gpu = srv_it->second;
+			scene_mesh_range_indices[mesh_entity] = (Uint32)scene_mesh_ranges.size();
+			scene_mesh_ranges.push_back(SceneMeshRange{ mesh_entity, (Uint32)scene_meshes.size(), (Uint32)mesh.submeshes.size(), instanceID, UINT32_MAX });
 
-			for (auto const& instance : mesh.instances)
+			for (Uint32 mesh_instance_index = 0; mesh_instance_index < mesh.instances.size(); ++mesh_instance_index)
 			{
+				SubMeshInstance const& instance = mesh.instances[mesh_instance_index];
 				SubMeshGPU& submesh = mesh.submeshes[instance.submesh_index];
 				Material& material = mesh.materials[submesh.material_index];
 
 				submesh.buffer_address = mesh_buffer->GetGpuAddress();
+				submesh.buffer_size = mesh_buffer->GetSize();
 
-				entt::entity batch_entity = reg.create();
-				Batch& batch = reg.emplace<Batch>(batch_entity);
+				entt::entity batch_entity = instanceID < prev_batch_entities.size() ? prev_batch_entities[instanceID] : reg.create();
+				Batch& batch = reg.emplace_or_replace<Batch>(batch_entity);
+				if (dynamic_meshes.contains(mesh_entity)) reg.emplace_or_replace<DynamicBatch>(batch_entity);
+				else reg.remove<DynamicBatch>(batch_entity);
 				batch.instance_id = instanceID;
 				batch.alpha_mode = material.alpha_mode;
 				batch.shading_extension = material.shading_extension;
 				batch.submesh = &submesh;
+				batch.material = &material;
 				batch.world_transform = instance.world_transform;
+				//instance ids are only stable while the instance count is unchanged, otherwise there is no motion to carry over
+				Bool const has_prev_transform = instanceID < prev_instance_transforms.size() && prev_instance_transforms.size() == mesh_instance_count;
+				batch.prev_world_transform = has_prev_transform ? prev_instance_transforms[instanceID] : instance.world_transform;
+				batch.dynamic = batch.prev_world_transform != batch.world_transform;
+				if (batch.dynamic) moved_instances.push_back(instanceID);
 				submesh.bounding_box.Transform(batch.bounding_box, batch.world_transform);
+				batch_entities.push_back(batch_entity);
+				batch_bounds.Add(batch.bounding_box);
+				batch_boxes.push_back(batch.bounding_box);
 
-				InstanceGPU& instance_gpu = instances.emplace_back();
+				InstanceGPU& instance_gpu = scene_instances.emplace_back();
 				instance_gpu.instance_id = instanceID;
-				instance_gpu.material_idx = static_cast<Uint32>(materials.size() + submesh.material_index);
-				instance_gpu.mesh_index = static_cast<Uint32>(meshes.size() + instance.submesh_index);
+				instance_gpu.material_idx = static_cast<Uint32>(scene_materials.size() + submesh.material_index);
+				instance_gpu.mesh_index = static_cast<Uint32>(scene_meshes.size() + instance.submesh_index);
+				instance_gpu.alpha_mode = static_cast<Uint32>(material.alpha_mode);
 				instance_gpu.world_matrix = instance.world_transform;
 				instance_gpu.inverse_world_matrix = XMMatrixInverse(nullptr, instance.world_transform);
+				instance_gpu.prev_world_matrix = batch.prev_world_transform;
 				instance_gpu.bb_origin = submesh.bounding_box.Center;
 				instance_gpu.bb_extents = submesh.bounding_box.Extents;
+				instance_gpu.skinned_vertices_idx = -1;
+				skinning_pass.AddInstance(instance_gpu, mesh_entity, mesh_instance_index, mesh_buffer_srv_gpu.GetIndex());
 
 				++instanceID;
 			}
 			for (auto const& submesh : mesh.submeshes)
 			{
-				MeshGPU& mesh_gpu = meshes.emplace_back();
-				mesh_gpu.buffer_idx = mesh_buffer_online_srv.GetIndex();
+				MeshGPU& mesh_gpu = scene_meshes.emplace_back();
+				mesh_gpu.buffer_idx = mesh_buffer_srv_gpu.GetIndex();
 				mesh_gpu.indices_offset = submesh.indices_offset;
 				mesh_gpu.positions_offset = submesh.positions_offset;
 				mesh_gpu.normals_offset = submesh.normals_offset;
@@ -332,56 +715,59 @@ namespace adria
 				mesh_gpu.meshlet_vertices_offset = submesh.meshlet_vertices_offset;
 				mesh_gpu.meshlet_triangles_offset = submesh.meshlet_triangles_offset;
 				mesh_gpu.meshlet_count = submesh.meshlet_count;
+				mesh_gpu.vertex_layout = (Uint32)submesh.vertex_layout;
+				mesh_gpu.lod_count = submesh.lod_count;
+				mesh_gpu.cluster_lods_offset = submesh.cluster_lods_offset;
+				mesh_gpu.cluster_count = submesh.cluster_count;
+				for (Uint32 lod = 0; lod < submesh.lod_count; ++lod)
+				{
+					SubMeshLOD const& submesh_lod = submesh.lods[lod];
+					mesh_gpu.lods[lod] = MeshLODGPU{ submesh_lod.first_index, submesh_lod.index_count, submesh_lod.first_meshlet, submesh_lod.meshlet_count, submesh_lod.error };
+				}
 			}
 
 			for (auto const& material : mesh.materials)
 			{
-				MaterialGPU& material_gpu = materials.emplace_back();
+				MaterialGPU& material_gpu = scene_materials.emplace_back();
 				material_gpu.shading_extension = (Uint32)material.shading_extension;
 				material_gpu.albedo_color = Vector3(material.albedo_color);
-				material_gpu.albedo_idx = (Uint32)material.albedo_texture;
-				material_gpu.roughness_metallic_idx = (Uint32)material.metallic_roughness_texture;
+				material_gpu.albedo_idx = GetTextureIndex(material.albedo_texture);
+				material_gpu.roughness_metallic_idx = GetTextureIndex(material.metallic_roughness_texture);
 				material_gpu.metallic_factor = material.metallic_factor;
 				material_gpu.roughness_factor = material.roughness_factor;
 
-				material_gpu.normal_idx = (Uint32)material.normal_texture;
-				material_gpu.emissive_idx = (Uint32)material.emissive_texture;
+				material_gpu.normal_idx = GetTextureIndex(material.normal_texture);
+				material_gpu.emissive_idx = GetTextureIndex(material.emissive_texture);
 				material_gpu.emissive_factor = material.emissive_factor;
 				material_gpu.alpha_cutoff = material.alpha_cutoff;
 
-				material_gpu.anisotropy_idx = (Uint32)material.anisotropy_texture;
+				material_gpu.anisotropy_idx = GetTextureIndex(material.anisotropy_texture);
 				material_gpu.anisotropy_strength = material.anisotropy_strength;
 				material_gpu.anisotropy_rotation = material.anisotropy_rotation;
 
-				material_gpu.clear_coat_idx = (Uint32)material.clear_coat_texture;
-				material_gpu.clear_coat_roughness_idx = (Uint32)material.clear_coat_roughness_texture;
-				material_gpu.clear_coat_normal_idx = (Uint32)material.clear_coat_normal_texture;
+				material_gpu.clear_coat_idx = GetTextureIndex(material.clear_coat_texture);
+				material_gpu.clear_coat_roughness_idx = GetTextureIndex(material.clear_coat_roughness_texture);
+				material_gpu.clear_coat_normal_idx = GetTextureIndex(material.clear_coat_normal_texture);
 				material_gpu.clear_coat = material.clear_coat;
 				material_gpu.clear_coat_roughness = material.clear_coat_roughness;
 
 				material_gpu.sheen_color = Vector3(material.sheen_color);
-				material_gpu.sheen_color_idx = (Uint32)material.sheen_color_texture;
+				material_gpu.sheen_color_idx = GetTextureIndex(material.sheen_color_texture);
 				material_gpu.sheen_roughness = material.sheen_roughness;
-				material_gpu.sheen_roughness_idx = (Uint32)material.sheen_roughness_texture;
+				material_gpu.sheen_roughness_idx = GetTextureIndex(material.sheen_roughness_texture);
 			}
 		}
 
-		auto CopyBuffer = [&]<typename T>(std::vector<T> const& data, SceneBuffer& scene_buffer)
-		{
-			if (data.empty()) return;
-			if (!scene_buffer.buffer || scene_buffer.buffer->GetCount() < data.size())
-			{
-				scene_buffer.buffer = gfx->CreateBuffer(StructuredBufferDesc<T>(data.size(), false, true));
-				scene_buffer.buffer_srv = gfx->CreateBufferSRV(scene_buffer.buffer.get());
-			}
-			scene_buffer.buffer->Update(data.data(), data.size() * sizeof(T));
-			scene_buffer.buffer_srv_gpu = gfx->AllocateDescriptorsGPU();
-			gfx->CopyDescriptors(1, scene_buffer.buffer_srv_gpu, scene_buffer.buffer_srv);
-		};
-		CopyBuffer(hlsl_lights, scene_buffers[SceneBuffer_Light]);
-		CopyBuffer(meshes, scene_buffers[SceneBuffer_Mesh]);
-		CopyBuffer(instances, scene_buffers[SceneBuffer_Instance]);
-		CopyBuffer(materials, scene_buffers[SceneBuffer_Material]);
+		for (Uint64 i = batch_entities.size(); i < prev_batch_entities.size(); ++i) reg.destroy(prev_batch_entities[i]);
+		std::erase_if(dynamic_meshes, [this](entt::entity mesh_entity) { return !reg.valid(mesh_entity); });
+		batch_bvh.Build(batch_boxes);
+		prev_instance_transforms.resize(scene_instances.size());
+		for (Uint64 i = 0; i < scene_instances.size(); ++i) prev_instance_transforms[i] = scene_instances[i].world_matrix;
+	}
+
+	void Renderer::OnMeshChanged(entt::registry&, entt::entity)
+	{
+		scene_meshes_dirty = true;
 	}
 
 	void Renderer::UpdateFrameConstants(Float dt)
@@ -389,6 +775,7 @@ namespace adria
 		static Float total_time = 0.0f;
 		total_time += dt;
 		rain_pass.Update(dt);
+		particles_pass.Update(dt);
 
 		camera_jitter = Vector2(0.0f, 0.0f);
 		if (postprocessor.NeedsJitter()) camera_jitter = camera->Jitter(gfx->GetFrameIndex());
@@ -417,21 +804,31 @@ namespace adria
 		frame_cbuf_data.mouse_normalized_coords_x = (viewport_data.mouse_position_x - viewport_data.scene_viewport_pos_x) / viewport_data.scene_viewport_size_x;
 		frame_cbuf_data.mouse_normalized_coords_y = (viewport_data.mouse_position_y - viewport_data.scene_viewport_pos_y) / viewport_data.scene_viewport_size_y;
 		frame_cbuf_data.env_map_idx = sky_pass.GetSkyIndex();
-		frame_cbuf_data.meshes_idx = (Int32)scene_buffers[SceneBuffer_Mesh].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.materials_idx = (Int32)scene_buffers[SceneBuffer_Material].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.instances_idx = (Int32)scene_buffers[SceneBuffer_Instance].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.lights_idx = (Int32)scene_buffers[SceneBuffer_Light].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.light_count = (Int32)scene_buffers[SceneBuffer_Light].buffer->GetCount();
+		frame_cbuf_data.sky_sh_idx = sky_pass.GetSkyIrradianceSHIndex();
+		//the tree is built in world space for every lighting path, its leaves index the light buffer above
+		frame_cbuf_data.light_tree_nodes_idx = light_tree.GetNodesIndex();
+		frame_cbuf_data.light_tree_infinite_lights_idx = light_tree.GetInfiniteLightsIndex();
+		frame_cbuf_data.light_tree_infinite_light_count = light_tree.GetInfiniteLightCount();
 		shadow_renderer.FillFrameCBuffer(frame_cbuf_data);
-		frame_cbuf_data.ddgi_volumes_idx = ddgi.IsEnabled() ? ddgi.GetDDGIVolumeIndex() : -1;
+		if (ddgi.IsEnabled() && IsRayTracingReady()) ddgi.UpdateVolumes(camera->Position());
+		terrain_renderer.Update(camera->Position());
+		frame_cbuf_data.ddgi_volumes_idx = ddgi.IsEnabled() && IsRayTracingReady() ? ddgi.GetDDGIVolumeIndex() : -1;
+		frame_cbuf_data.ddgi_volume_count = ddgi.IsEnabled() && IsRayTracingReady() ? ddgi.GetDDGIVolumeCount() : 0;
+		frame_cbuf_data.restir_gi_irradiance_idx = restir_gi.IsEnabled() && IsRayTracingReady() ? restir_gi.GetIrradianceIndex() : -1;
 		frame_cbuf_data.printf_buffer_idx = gpu_debug_printer.GetPrintfBufferIndex();
+		frame_cbuf_data.debug_primitive_args_idx = g_DebugRenderer.GetGPUPrimitiveArgsIndex();
+		frame_cbuf_data.debug_primitive_vertices_idx = g_DebugRenderer.GetGPUPrimitiveVerticesIndex();
 		frame_cbuf_data.rain_splash_diffuse_idx = rain_pass.GetRainSplashDiffuseIndex();
 		frame_cbuf_data.rain_splash_bump_idx = rain_pass.GetRainSplashBumpIndex();
 		frame_cbuf_data.rain_blocker_map_idx = rain_pass.GetRainBlockerMapIndex();
 		frame_cbuf_data.rain_view_projection = rain_pass.GetRainViewProjection();
 		frame_cbuf_data.rain_total_time = rain_pass.GetRainTotalTime();
+		frame_cbuf_data.cloud_shadow_map_idx = postprocessor.GetCloudShadowMapIndex();
+		frame_cbuf_data.cloud_shadow_params = postprocessor.GetCloudShadowParams();
+		frame_cbuf_data.lod_camera_position = camera->Position();
+		frame_cbuf_data.lod_error_scale = GetLODErrorScale();
 
-		if (ray_tracing_supported && reg.view<RayTracing>().size())
+		if (IsRayTracingReady())
 		{
 			frame_cbuf_data.accel_struct_idx = accel_structure.GetTLASIndex();
 		}
@@ -451,68 +848,205 @@ namespace adria
 
 		frame_cbuf_data.ambient_color = Vector4(ambient_color[0], ambient_color[1], ambient_color[2], 1.0f);
 		frame_cbuf_data.wind_params = Vector4(wind_dir[0], wind_dir[1], wind_dir[2], wind_speed);
+	}
+
+	//the frame constants and cpu writable scene buffers of this slot are only written once BeginFrame waited for the slot
+	void Renderer::UploadFrameConstants()
+	{
+		FlushSceneBuffers();
+		Uint32 const slot = GetSceneBufferSlot();
+		frame_cbuf_data.meshes_idx = (Int32)scene_buffers[SceneBuffer_Mesh].buffer_srvs_gpu[slot].GetIndex();
+		frame_cbuf_data.materials_idx = (Int32)scene_buffers[SceneBuffer_Material].buffer_srvs_gpu[slot].GetIndex();
+		frame_cbuf_data.instances_idx = (Int32)scene_buffers[SceneBuffer_Instance].buffer_srvs_gpu[slot].GetIndex();
+		frame_cbuf_data.lights_idx = (Int32)scene_buffers[SceneBuffer_Light].buffer_srvs_gpu[slot].GetIndex();
+		frame_cbuf_data.light_count = (Int32)scene_buffers[SceneBuffer_Light].buffers[slot]->GetCount();
 		frame_cbuffer.Update(frame_cbuf_data, backbuffer_index);
 
 		frame_cbuf_data.prev_view_projection = camera->ViewProj();
 		frame_cbuf_data.prev_view = camera->View();
 		frame_cbuf_data.prev_projection = camera->Proj();
 	}
+	Float Renderer::GetLODErrorScale() const
+	{
+		//multiplied by world scale / distance this maps object space lod errors to a fraction of the pixel threshold
+		Float const threshold = LODErrorThreshold.Get();
+		if (threshold <= 0.0f) return FLT_MAX;
+		return display_height / (2.0f * std::tan(camera->Fov() * 0.5f) * threshold);
+	}
+
 	void Renderer::CameraFrustumCulling()
 	{
+		AdriaCpuProfileScope("Culling");
 		BoundingFrustum camera_frustum = camera->Frustum();
 		auto batch_view = reg.view<Batch>();
 		auto light_view = reg.view<Light>();
-		for (auto e : batch_view)
+		Vector3 const camera_position = camera->Position();
+		Float const screen_scale = display_height / (2.0f * std::tan(camera->Fov() * 0.5f));
+		Float const camera_near = camera->Near();
+		Float const lod_error_scale = GetLODErrorScale();
+
+		static constexpr Uint32 CULL_CHUNK_SIZE = 4096;
+		Uint64 const batch_count = batch_entities.size();
+		camera_visibility_mask.assign(DivideAndRoundUp<Uint64>(batch_count, 64), 0ull);
+		std::vector<Float> screen_sizes(batch_count);
+		g_JobSystem.ParallelFor((Uint32)DivideAndRoundUp<Uint64>(batch_count, CULL_CHUNK_SIZE), 1, [&](Uint32 chunk)
+			{
+				Uint64 const begin = (Uint64)chunk * CULL_CHUNK_SIZE;
+				Uint64 const end = std::min<Uint64>(begin + CULL_CHUNK_SIZE, batch_count);
+				FrustumCull(camera_frustum, batch_bounds, begin, end, camera_visibility_mask.data());
+				for (Uint64 i = begin; i < end; ++i)
+				{
+					Bool const visible = IsVisible(camera_visibility_mask.data(), i);
+					Batch& batch = batch_view.get<Batch>(batch_entities[i]);
+					batch.camera_visibility = visible;
+
+					//lods are selected for invisible batches too since shadow views draw them with the camera lod
+					Vector3 const center(batch_bounds.center_x[i], batch_bounds.center_y[i], batch_bounds.center_z[i]);
+					Float const radius = Vector3(batch_bounds.extents_x[i], batch_bounds.extents_y[i], batch_bounds.extents_z[i]).Length();
+					Float const distance = std::max(Vector3::Distance(camera_position, center) - radius, camera_near);
+					Matrix const& world = batch.world_transform;
+					Float const world_scale = std::max({ Vector3(world._11, world._12, world._13).Length(), Vector3(world._21, world._22, world._23).Length(), Vector3(world._31, world._32, world._33).Length() });
+					batch.lod = SelectSubMeshLOD(*batch.submesh, lod_error_scale * world_scale / distance);
+					if (!visible) continue;
+
+					screen_sizes[i] = 2.0f * radius * screen_scale / distance;
+				}
+			});
+
+		for (Uint64 i = 0; i < batch_count; ++i)
 		{
-			Batch& batch = batch_view.get<Batch>(e);
-			auto& aabb = batch.bounding_box;
-			batch.camera_visibility = camera_frustum.Intersects(aabb);
+			if (!IsVisible(camera_visibility_mask.data(), i)) continue;
+			Batch const& batch = batch_view.get<Batch>(batch_entities[i]);
+
+			Float const screen_size = screen_sizes[i];
+			Material const& material = *batch.material;
+			for (TextureHandle texture : { material.albedo_texture, material.metallic_roughness_texture, material.normal_texture, material.emissive_texture,
+										   material.anisotropy_texture, material.clear_coat_texture, material.clear_coat_roughness_texture, material.clear_coat_normal_texture,
+										   material.sheen_color_texture, material.sheen_roughness_texture })
+			{
+				g_TextureManager.RequestTexture(texture, screen_size);
+			}
 		}
 	}
 
 	void Renderer::Render_Deferred(RenderGraph& render_graph)
 	{
-		if (update_picking_data)
+		Bool const oit = renderer_output == RendererOutput::Final && transparent_pass.IsEnabled();
+		//the gpu driven draw streams cannot single out sheen materials, they stay in the GBuffer there
+		Bool const forward_plus = renderer_output == RendererOutput::Final && forward_plus_pass.IsEnabled() && !gpu_driven_renderer.IsEnabled();
 		{
-			picking_data = picking_pass.GetPickingData();
-			update_picking_data = false;
+			RG_PASS_GROUP(render_graph, "Geometry");
+			if (rain_pass.IsEnabled()) rain_pass.AddBlockerPass(render_graph);
+			gbuffer_pass.SetBlendBatchesEnabled(!oit);
+			gbuffer_pass.SetSheenBatchesEnabled(!forward_plus);
+			clustered_deferred_lighting_pass.SetAssignAllClusters(oit || forward_plus);
+			gpu_driven_renderer.SetBlendStreamEnabled(!oit);
+			if (gpu_driven_renderer.IsEnabled()) gpu_driven_renderer.AddPasses(render_graph);
+			else gbuffer_pass.AddPass(render_graph, &occlusion_query_pass);
+			terrain_renderer.AddPasses(render_graph, gpu_driven_renderer.IsEnabled() && gpu_driven_renderer.IsOcclusionCullingEnabled());
 		}
-		if (rain_pass.IsEnabled()) rain_pass.AddBlockerPass(render_graph);
-		if (gpu_driven_renderer.IsEnabled()) gpu_driven_renderer.AddPasses(render_graph);
-		else gbuffer_pass.AddPass(render_graph);
 
-		if(ddgi.IsEnabled()) ddgi.AddPasses(render_graph);
+		if (occlusion_query_pass.IsEnabled())
+		{
+			RG_PASS_GROUP(render_graph, "Occlusion Queries");
+			if (!gpu_driven_renderer.IsEnabled() || !gpu_driven_renderer.IsOcclusionCullingEnabled()) hzb_pass.AddPasses(render_graph);
+			occlusion_query_pass.AddPass(render_graph);
+			if (light_query_offset != OcclusionQueryPass::INVALID_QUERY && render_graph.IsBufferDeclared(RG_NAME(OcclusionQueryResults)))
+			{
+				render_graph.GetBlackboard().Add<OcclusionQueryBlackboardData>(OcclusionQueryBlackboardData{ .light_query_offset = light_query_offset });
+			}
+		}
 
-		decals_pass.AddPass(render_graph);
-		postprocessor.AddAmbientOcclusionPass(render_graph);
-		shadow_renderer.AddShadowMapPasses(render_graph);
-		shadow_renderer.AddRayTracingShadowPasses(render_graph);
+		if (postprocessor.NeedsHZB() && !render_graph.GetBlackboard().TryGet<HZBBlackboardData>())
+		{
+			RG_PASS_GROUP(render_graph, "HZB");
+			hzb_pass.AddPasses(render_graph);
+		}
+
+		{
+			RG_PASS_GROUP(render_graph, "Geometry");
+			decals_pass.AddPass(render_graph, &occlusion_query_pass);
+			postprocessor.AddMotionVectorsPass(render_graph);
+		}
+		{
+			RG_PASS_GROUP(render_graph, "Ambient Occlusion");
+			postprocessor.AddAmbientOcclusionPass(render_graph);
+		}
+		{
+			RG_PASS_GROUP(render_graph, "Shadows");
+			shadow_renderer.AddShadowMapPasses(render_graph, frame_cbuf_data, gpu_driven_renderer.IsEnabled() ? &gpu_driven_renderer : nullptr);
+			if (IsRayTracingReady()) shadow_renderer.AddRayTracingShadowPasses(render_graph);
+		}
+		//after the shadow maps, inline probe tracing shades its hits with them
+		if (ddgi.IsEnabled() && IsRayTracingReady())
+		{
+			RG_PASS_GROUP(render_graph, "Global Illumination");
+			ddgi.AddPasses(render_graph);
+		}
+		if (restir_gi.IsEnabled() && IsRayTracingReady())
+		{
+			RG_PASS_GROUP(render_graph, "Global Illumination");
+			restir_gi.AddPasses(render_graph);
+		}
 
 		if (renderer_output == RendererOutput::Final)
 		{
-			switch (lighting_path)
 			{
-			case LightingPathType::Deferred:			deferred_lighting_pass.AddPass(render_graph); break;
-			case LightingPathType::TiledDeferred:		tiled_deferred_lighting_pass.AddPass(render_graph); break;
-			case LightingPathType::ClusteredDeferred:	clustered_deferred_lighting_pass.AddPass(render_graph, true); break;
+				RG_PASS_GROUP(render_graph, "Lighting");
+				switch (lighting_path)
+				{
+				case LightingPathType::Deferred:
+				case LightingPathType::PathTracing:			deferred_lighting_pass.AddPass(render_graph); break;
+				case LightingPathType::TiledDeferred:		tiled_deferred_lighting_pass.AddPass(render_graph); break;
+				case LightingPathType::ClusteredDeferred:	clustered_deferred_lighting_pass.AddPass(render_graph); break;
+				case LightingPathType::ReSTIR_DI:
+					if (restir_di.IsSupported() && IsRayTracingReady()) restir_di.AddPasses(render_graph);
+					else deferred_lighting_pass.AddPass(render_graph);
+					break;
+				}
+				if (oit || forward_plus) clustered_deferred_lighting_pass.AddLightCullingPasses(render_graph);
+				if (forward_plus) forward_plus_pass.AddPass(render_graph);
 			}
 
-			if (volumetric_lights > 0)
+			ExponentialHeightFogPass* height_fog_pass = postprocessor.GetHeightFogPass();
+			Bool const froxel_height_fog = volumetric_path == VolumetricPathType::FogVolume && height_fog_pass->IsFogEnabled() && volumetric_fog_pass.IsHeightFogInjectionEnabled();
+			height_fog_pass->SetInjectedIntoFroxels(froxel_height_fog);
+			volumetric_fog_pass.SetHeightFogParameters(froxel_height_fog ? &height_fog_pass->GetParameters() : nullptr);
 			{
+				RG_PASS_GROUP(render_graph, "Volumetrics");
 				switch (volumetric_path)
 				{
-				case VolumetricPathType::Raymarching:	volumetric_lighting_pass.AddPass(render_graph); break;
-				case VolumetricPathType::FogVolume:		volumetric_fog_pass.AddPasses(render_graph); break;
+				case VolumetricPathType::Raymarching:
+					if (volumetric_lights > 0) volumetric_lighting_pass.AddPass(render_graph);
+					break;
+				case VolumetricPathType::FogVolume:
+					if (volumetric_lights > 0 || froxel_height_fog) volumetric_fog_pass.AddPasses(render_graph);
+					break;
 				}
 			}
 
-			if (ddgi.IsEnabled() && ddgi.Visualize()) ddgi.AddVisualizePass(render_graph);
-			ocean_renderer.AddPasses(render_graph);
-			sky_pass.AddComputeSkyPass(render_graph, sun_direction);
-			sky_pass.AddDrawSkyPass(render_graph);
-			picking_pass.AddPass(render_graph);
+			if (ddgi.IsEnabled() && IsRayTracingReady() && ddgi.Visualize()) ddgi.AddVisualizePass(render_graph);
+			{
+				RG_PASS_GROUP(render_graph, "Environment");
+				ocean_renderer.AddPasses(render_graph);
+				sky_pass.AddComputeSkyPass(render_graph, sun_direction);
+				sky_pass.AddDrawSkyPass(render_graph);
+			}
+			{
+				RG_PASS_GROUP(render_graph, "Transparency");
+				transparent_pass.AddPass(render_graph);
+			}
+			if (update_picking_data)
+			{
+				picking_pass.AddPass(render_graph);
+				update_picking_data = false;
+			}
 			if (rain_pass.IsEnabled()) rain_pass.AddPass(render_graph);
-			postprocessor.AddPasses(render_graph);
+			particles_pass.AddPasses(render_graph);
+			{
+				RG_PASS_GROUP(render_graph, "Postprocess");
+				postprocessor.AddPasses(render_graph);
+			}
 			g_DebugRenderer.Render(render_graph);
 		}
 		else
@@ -529,10 +1063,13 @@ namespace adria
 	void Renderer::GUI()
 	{
 		if (gpu_driven_renderer.IsSupported()) gpu_driven_renderer.GUI();
+		occlusion_query_pass.GUI();
 		if (ddgi.IsSupported()) ddgi.GUI();
+		if (restir_gi.IsSupported()) restir_gi.GUI();
 		if (renderer_output == RendererOutput::Final)
 		{
 			if (lighting_path == LightingPathType::TiledDeferred) tiled_deferred_lighting_pass.GUI();
+			if (lighting_path == LightingPathType::ReSTIR_DI) restir_di.GUI();
 			shadow_renderer.GUI();
 			switch (volumetric_path)
 			{
@@ -540,8 +1077,14 @@ namespace adria
 			case VolumetricPathType::FogVolume:		volumetric_fog_pass.GUI();		break;
 			}
 			ocean_renderer.GUI();
+			terrain_renderer.GUI();
 			sky_pass.GUI();
 			rain_pass.GUI();
+			particles_pass.GUI();
+			transparent_pass.GUI();
+			if (!gpu_driven_renderer.IsEnabled()) forward_plus_pass.GUI();
+			video_capture_pass.GUI();
+			gpu_primitives.GUI();
 
 			QueueGUI([&]()
 				{
@@ -602,6 +1145,18 @@ namespace adria
 						}
 						ImGui::SliderFloat3("Wind Direction", wind_dir, -1.0f, 1.0f);
 						ImGui::SliderFloat("Wind Speed", &wind_speed, 0.0f, 32.0f);
+
+						GfxLowLatency const& low_latency = gfx->GetLowLatency();
+						GfxLowLatencyMode const current_low_latency_mode = low_latency.GetMode();
+						if (ImGui::BeginCombo("Low Latency", GfxLowLatencyModeToString(current_low_latency_mode)))
+						{
+							for (GfxLowLatencyMode mode : { GfxLowLatencyMode::Off, GfxLowLatencyMode::Reflex, GfxLowLatencyMode::AntiLag2 })
+							{
+								if (!low_latency.IsSupported(mode)) continue;
+								if (ImGui::Selectable(GfxLowLatencyModeToString(mode), mode == current_low_latency_mode)) gfx->SetLowLatencyMode(mode);
+							}
+							ImGui::EndCombo();
+						}
 						ImGui::TreePop();
 					}
 				}, GUICommandGroup_Renderer);
@@ -635,45 +1190,50 @@ namespace adria
 	{
 		ADRIA_ASSERT(take_screenshot);
 
-		std::string absolute_screenshot_path = paths::ScreenshotsDir + screenshot_name + ".png";
-		ADRIA_LOG(INFO, "Taking screenshot: %s.png...", screenshot_name.c_str());
-		if (!screenshot_buffer)
-		{	
-			GfxBufferDesc screenshot_desc{};
-			screenshot_desc.size = gfx->GetLinearBufferSize(final_texture.get()); 
-			screenshot_desc.resource_usage = GfxResourceUsage::Readback;
-			screenshot_buffer = gfx->CreateBuffer(screenshot_desc);
-		}
-		rg.ImportBuffer(RG_NAME(ScreenshotBuffer), screenshot_buffer.get());
-
+		static constexpr FileType screenshot_types[] = { FileType::PNG, FileType::QOI, FileType::EXR };
+		FileType const file_type = screenshot_types[std::clamp(ScreenshotFormat.Get(), 0, (Int)ARRAYSIZE(screenshot_types) - 1)];
+		std::string absolute_screenshot_path = paths::ScreenshotsDir + screenshot_name + GetFileTypeExtension(file_type);
+		ADRIA_LOG(INFO, "Taking screenshot: %s%s...", screenshot_name.c_str(), GetFileTypeExtension(file_type));
 		struct ScreenshotPassData
 		{
-			RGBufferCopyDstId  dst;
 			RGTextureCopySrcId src;
 		};
 		rg.AddPass<ScreenshotPassData>("Screenshot Pass",
 			[=](ScreenshotPassData& data, RenderGraphBuilder& builder)
 			{
-				data.dst = builder.WriteCopyDstBuffer(RG_NAME(ScreenshotBuffer));
 				data.src = builder.ReadCopySrcTexture(RG_NAME(FinalTexture));
 			},
-			[=](ScreenshotPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			[=, width = display_width, height = display_height](ScreenshotPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxTexture const& src_texture = ctx.GetCopySrcTexture(data.src);
-				GfxBuffer& dst_buffer = ctx.GetCopyDstBuffer(data.dst);
-				cmd_list->CopyTextureToBuffer(dst_buffer, 0, src_texture, 0, 0);
-				cmd_list->Signal(screenshot_fence, screenshot_fence_value);
+				gfx->GetReadbackQueue()->Enqueue(cmd_list, src_texture, [=](void const* readback_data, Uint64 size)
+					{
+						std::vector<Uint8> pixels(static_cast<Uint8 const*>(readback_data), static_cast<Uint8 const*>(readback_data) + size);
+						std::erase_if(screenshot_writes, [](std::future<void> const& write) { return write.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+						//sequences can outpace the encoders, bound the number of frames waiting in memory
+						if (screenshot_writes.size() >= MAX_PENDING_SCREENSHOT_WRITES)
+						{
+							screenshot_writes.front().wait();
+							screenshot_writes.erase(screenshot_writes.begin());
+						}
+						screenshot_writes.push_back(g_ThreadPool.Submit([=, pixels = std::move(pixels)]()
+							{
+								if (file_type == FileType::EXR)
+								{
+									std::vector<Float> linear_pixels(pixels.size());
+									for (Uint64 i = 0; i < pixels.size(); ++i)
+									{
+										Float const c = pixels[i] / 255.0f;
+										linear_pixels[i] = (i % 4 == 3) ? c : (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f));
+									}
+									WriteImageToFile(file_type, absolute_screenshot_path.c_str(), width, height, linear_pixels.data(), width * 4 * sizeof(Float));
+								}
+								else WriteImageToFile(file_type, absolute_screenshot_path.c_str(), width, height, pixels.data(), width * 4);
+								ADRIA_LOG(INFO, "Screenshot %s saved to screenshots folder!", absolute_screenshot_path.c_str());
+							}));
+					});
 			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
 
-		g_ThreadPool.Submit([this](std::string_view name) 
-			{
-			screenshot_fence.Wait(screenshot_fence_value);
-			WriteImageToFile(FileType::PNG, name.data(), display_width, display_height, screenshot_buffer->GetMappedData(), display_width * 4);
-			screenshot_buffer.reset();
-			ADRIA_LOG(INFO, "Screenshot %s.png saved to screenshots folder!", screenshot_name.c_str());
-			screenshot_fence_value++;
-			}, absolute_screenshot_path);
-
 		take_screenshot = false;
 	}
 
@@ -1,4 +1,6 @@
 #pragma once
+#include <future>
+#include <unordered_set>
 #include "ViewportData.h"
 #include "ShaderStructs.h"
 #include "PostProcessor.h"
@@ -11,19 +13,37 @@
 #include "TiledDeferredLightingPass.h"
 #include "ClusteredDeferredLightingPass.h"
 #include "DDGIPass.h"
+#include "ReSTIR_DI.h"
+#include "ReSTIR_GI.h"
 #include "GPUDebugPrinter.h"
+#include "MipGenerationPass.h"
 #include "HelperPasses.h"
 #include "PickingPass.h"
 #include "DecalsPass.h"
 #include "RainPass.h"
+#include "GPUParticlesPass.h"
+#include "TransparentPass.h"
+#include "ForwardPlusPass.h"
+#include "HZBPass.h"
+#include "OcclusionQueryPass.h"
 #include "OceanRenderer.h"
+#include "TerrainRenderer.h"
 #include "AccelerationStructure.h"
+#include "LightTree.h"
 #include "ShadowRenderer.h"
 #include "PathTracingPass.h"
 #include "RendererOutputPass.h"
+#include "VideoCapturePass.h"
+#include "TransformSystem.h"
+#include "AnimationSystem.h"
+#include "SkinningPass.h"
+#include "GPUPrimitives.h"
 #include "Graphics/GfxShaderCompiler.h"
 #include "Graphics/GfxConstantBuffer.h"
 #include "RenderGraph/RenderGraphResourcePool.h"
+#include "RenderGraph/RenderGraphCache.h"
+#include "Math/FrustumCulling.h"
+#include "Math/BoundingVolumeHierarchy.h"
 
 namespace adria
 {
@@ -38,11 +58,14 @@ namespace adria
 		Deferred,
 		TiledDeferred,
 		ClusteredDeferred,
-		PathTracing
+		PathTracing,
+		ReSTIR_DI
 	};
 
 	class Renderer
 	{
+		static constexpr Uint64 MAX_PENDING_SCREENSHOT_WRITES = 16;
+
 		enum class VolumetricPathType : Uint8
 		{
 			None,
@@ -61,16 +84,20 @@ namespace adria
 
 		void OnResize(Uint32 w, Uint32 h);
 		void OnRenderResolutionChanged(Uint32 w, Uint32 h);
-		void OnSceneInitialized();
+		void OnSceneInitialized(Uint64 scene_hash);
 		void OnRightMouseClicked(Int32 x, Int32 y);
 		void OnTakeScreenshot(Char const*);
+		void FlushScreenshots();
 		void OnLightChanged();
 
-		PickingData const& GetPickingData() const { return picking_data; }
+		PickingData const& GetPickingData() const { return picking_pass.GetPickingData(); }
 		Vector2u GetDisplayResolution() const { return Vector2u(display_width, display_height); }
+		GfxTexture* GetFinalTexture() const { return final_texture.get(); }
+		Uint64 GetFinalTextureGeneration() const { return final_texture_generation; }
 
 		RendererOutput GetRendererOutput() const { return renderer_output; }
 		LightingPathType GetLightingPath() const { return lighting_path; }
+		Bool NeedsContinuousRendering() const;
 		void SetRendererOutput(RendererOutput type)
 		{
 			renderer_output = type;
@@ -82,6 +109,9 @@ namespace adria
 		entt::registry& reg;
 		GfxDevice* gfx;
 		RGResourcePool resource_pool;
+		RGCache render_graph_cache;
+		TransformSystem transform_system;
+		AnimationSystem animation_system;
 
 		Camera const* camera;
 		Vector2 camera_jitter;
@@ -92,8 +122,10 @@ namespace adria
 		Uint32 display_height;
 		Uint32 render_width;
 		Uint32 render_height;
+		std::optional<Vector2u> pending_render_resolution;
 
 		std::unique_ptr<GfxTexture> final_texture;
+		Uint64 final_texture_generation = 0;
 
 		FrameCBuffer frame_cbuf_data{};
 		GfxConstantBuffer<FrameCBuffer> frame_cbuffer;
@@ -107,15 +139,45 @@ namespace adria
 			SceneBuffer_Instance, 
 			SceneBuffer_Count 
 		};
+		//default heap buffers only use the first slot, their copies are ordered on the frame's command list.
+		//cpu writable buffers get one copy per frame slot, writes go to a cpu copy and reach a slot once the frame fence retired it
 		struct SceneBuffer
 		{
-			std::unique_ptr<GfxBuffer>  buffer;
-			GfxDescriptor				buffer_srv;
-			GfxDescriptor				buffer_srv_gpu;
+			std::unique_ptr<GfxBuffer>  buffers[GFX_BACKBUFFER_COUNT];
+			GfxDescriptor				buffer_srvs[GFX_BACKBUFFER_COUNT];
+			GfxDescriptor				buffer_srvs_gpu[GFX_BACKBUFFER_COUNT];
+			GfxBufferDesc				desc;
+			std::vector<Uint8>			cpu_data;
+			std::vector<std::pair<Uint64, Uint64>> dirty_ranges[GFX_BACKBUFFER_COUNT];
 		};
 		std::array<SceneBuffer, SceneBuffer_Count> scene_buffers;
+		Bool scene_buffers_cpu_writable = false;
+		struct SceneMeshRange
+		{
+			entt::entity mesh_entity;
+			Uint32 first_mesh;
+			Uint32 mesh_count;
+			Uint32 first_instance;
+			Uint32 first_rt_instance;
+		};
+		std::vector<SceneMeshRange> scene_mesh_ranges;
+		std::unordered_map<entt::entity, Uint32> scene_mesh_range_indices;
+		std::vector<GfxDescriptor> geometry_buffer_srvs_gpu;
+		std::vector<MeshGPU> scene_meshes;
+		std::vector<InstanceGPU> scene_instances;
+		std::vector<Matrix> prev_instance_transforms;
+		Bool scene_meshes_dirty = true;
+		std::vector<Uint32> moved_instances;
+
+		std::vector<entt::entity> batch_entities;
+		std::unordered_set<entt::entity> dynamic_meshes;
+		AABBArray batch_bounds;
+		BoundingVolumeHierarchy batch_bvh;
+		std::vector<Uint64> camera_visibility_mask;
 
 		//passes
+		HZBPass hzb_pass;
+		OcclusionQueryPass occlusion_query_pass;
 		GBufferPass  gbuffer_pass;
 		GPUDrivenGBufferPass gpu_driven_renderer;
 		SkyPass		 sky_pass;
@@ -129,22 +191,32 @@ namespace adria
 		PickingPass picking_pass;
 		DecalsPass decals_pass;
 		RainPass rain_pass;
+		GPUParticlesPass particles_pass;
+		TransparentPass transparent_pass;
+		ForwardPlusPass forward_plus_pass;
+		SkinningPass skinning_pass;
+		GPUPrimitives gpu_primitives;
 		OceanRenderer  ocean_renderer;
+		TerrainRenderer terrain_renderer;
 		ShadowRenderer shadow_renderer;
 		PostProcessor postprocessor;
 		DDGIPass		  ddgi;
+		ReSTIR_DI		  restir_di;
+		ReSTIR_GI		  restir_gi;
 		PathTracingPass path_tracer;
 		RendererOutputPass renderer_output_pass;
 		GPUDebugPrinter gpu_debug_printer;
+		MipGenerationPass mip_generation_pass;
+		VideoCapturePass video_capture_pass;
 
 		//ray tracing
 		Bool ray_tracing_supported = false;
 		AccelerationStructure accel_structure;
 		GfxDescriptor tlas_srv;
+		LightTree light_tree;
 
 		//picking
 		Bool update_picking_data = false;
-		PickingData picking_data;
 
 		LightingPathType	 lighting_path = LightingPathType::Deferred;
 		RendererOutput		 renderer_output = RendererOutput::Final;
@@ -158,24 +230,38 @@ namespace adria
 		//screenshot
 		Bool						take_screenshot = false;
 		std::string					screenshot_name = "";
-		GfxFence					screenshot_fence;
-		Uint64						screenshot_fence_value = 1;
-		std::unique_ptr<GfxBuffer>  screenshot_buffer;
+		std::vector<std::future<void>> screenshot_writes;
+		Uint32						screenshot_sequence_frame = 0;
 
 		//volumetric
 		Uint32			         volumetric_lights = 0;
-		VolumetricPathType		 volumetric_path = VolumetricPathType::Raymarching;
+		Uint32			         light_query_offset = OcclusionQueryPass::INVALID_QUERY;
+		VolumetricPathType		 volumetric_path = VolumetricPathType::FogVolume;
 		//misc
 		ViewportData			 viewport_data;
 
 	private:
 		void CreateSizeDependentResources();
+		void ApplyRenderResolutionChange();
 		void CreateAS();
+		void UpdateAS();
+		Bool IsRayTracingReady() const { return ray_tracing_supported && accel_structure.IsReady(); }
 
 		void GUI();
 		void UpdateSceneBuffers();
+		void RebuildSceneMeshes(std::vector<InstanceGPU>& scene_instances, std::vector<MaterialGPU>& scene_materials);
+		void ApplyWorldTransforms();
+		void ForwardInstanceTransforms();
+		void ForwardSkinnedInstances();
+		void UploadSceneInstances(std::vector<Uint32>& instance_ids);
+		void WriteSceneBuffer(SceneBuffer& scene_buffer, GfxBufferDesc const& desc, void const* data, Uint64 size, Uint64 offset);
+		void FlushSceneBuffers();
+		void UploadFrameConstants();
+		Uint32 GetSceneBufferSlot() const { return scene_buffers_cpu_writable ? backbuffer_index : 0; }
+		void OnMeshChanged(entt::registry&, entt::entity);
 		void UpdateFrameConstants(Float dt);
 		void CameraFrustumCulling();
+		Float GetLODErrorScale() const;
 
 		void Render_Deferred(RenderGraph& rg);
 		void Render_PathTracing(RenderGraph& rg);
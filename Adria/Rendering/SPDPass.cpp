@@ -0,0 +1,141 @@
+#include "SPDPass.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
+#include "RenderGraph/RenderGraph.h"
+
+#define A_CPU 1
+#include "Resources/Shaders/SPD/ffx_a.h"
+#include "Resources/Shaders/SPD/ffx_spd.h"
+
+using namespace DirectX;
+
+namespace adria
+{
+
+	SPDPass::SPDPass(GfxDevice* gfx) : gfx(gfx)
+	{
+		CreatePSOs();
+	}
+
+	SPDPass::~SPDPass() = default;
+
+	void SPDPass::AddPass(RenderGraph& rendergraph, RGResourceName src_texture, std::vector<RGResourceName> const& dst_mips,
+		GfxFormat format, SPDReductionOp op, Char const* pass_name)
+	{
+		static Uint64 counter = 0;
+		counter++;
+
+		Uint32 const mip_count = (Uint32)dst_mips.size();
+		ADRIA_ASSERT(mip_count > 0 && mip_count <= SPD_MAX_MIPS);
+		RGResourceName spd_counter = RG_NAME_IDX(SPDPassCounter, counter);
+
+		struct SPDPassData
+		{
+			RGTextureReadOnlyId  src;
+			RGBufferReadWriteId  spd_counter;
+			RGTextureReadWriteId dst_mips[SPD_MAX_MIPS];
+		};
+
+		std::string spd_name = "SPD Pass " + std::string(pass_name);
+		rendergraph.AddPass<SPDPassData>(spd_name.c_str(),
+			[=](SPDPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc const& src_desc = builder.GetTextureDesc(src_texture);
+				for (Uint32 i = 0; i < mip_count; ++i)
+				{
+					RGTextureDesc mip_desc{};
+					mip_desc.width = std::max(1u, src_desc.width >> (i + 1));
+					mip_desc.height = std::max(1u, src_desc.height >> (i + 1));
+					mip_desc.format = format;
+					builder.DeclareTexture(dst_mips[i], mip_desc);
+					data.dst_mips[i] = builder.WriteTexture(dst_mips[i]);
+				}
+
+				RGBufferDesc counter_desc{};
+				counter_desc.size = sizeof(Uint32);
+				counter_desc.format = GfxFormat::R32_UINT;
+				counter_desc.stride = sizeof(Uint32);
+				builder.DeclareBuffer(spd_counter, counter_desc);
+				data.spd_counter = builder.WriteBuffer(spd_counter);
+				data.src = builder.ReadTexture(src_texture, ReadAccess_NonPixelShader);
+			},
+			[=](SPDPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxTextureDesc const& src_desc = ctx.GetTexture(*data.src).GetDesc();
+
+				varAU2(dispatchThreadGroupCountXY);
+				varAU2(workGroupOffset);
+				varAU2(numWorkGroupsAndMips);
+				varAU4(rectInfo) = initAU4(0, 0, src_desc.width, src_desc.height);
+				SpdSetup(
+					dispatchThreadGroupCountXY,
+					workGroupOffset,
+					numWorkGroupsAndMips,
+					rectInfo,
+					mip_count);
+
+				std::vector<GfxDescriptor> src_handles(mip_count + 2);
+				src_handles[0] = ctx.GetReadWriteBuffer(data.spd_counter);
+				src_handles[1] = ctx.GetReadOnlyTexture(data.src);
+				for (Uint32 i = 0; i < mip_count; ++i) src_handles[i + 2] = ctx.GetReadWriteTexture(data.dst_mips[i]);
+
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU((Uint32)src_handles.size());
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				GfxBuffer& spd_counter_buffer = ctx.GetBuffer(*data.spd_counter);
+				Uint32 clear[] = { 0u };
+				cmd_list->ClearUAV(spd_counter_buffer, dst_handle, src_handles[0], clear);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+
+				struct SPDConstants
+				{
+					Uint32 num_mips;
+					Uint32 num_work_groups;
+					Uint32 work_group_offset_x;
+					Uint32 work_group_offset_y;
+					Float  inv_src_width;
+					Float  inv_src_height;
+					Uint32 src_idx;
+				} constants
+				{
+					.num_mips = numWorkGroupsAndMips[1],
+					.num_work_groups = numWorkGroupsAndMips[0],
+					.work_group_offset_x = workGroupOffset[0],
+					.work_group_offset_y = workGroupOffset[1],
+					.inv_src_width = 1.0f / src_desc.width,
+					.inv_src_height = 1.0f / src_desc.height,
+					.src_idx = i + 1
+				};
+
+				DECLSPEC_ALIGN(16)
+				struct SPDIndices
+				{
+					XMUINT4	dstIdx[SPD_MAX_MIPS];
+					Uint32	spdGlobalAtomicIdx;
+				} indices{ .spdGlobalAtomicIdx = i };
+				for (Uint32 j = 0; j < mip_count; ++j) indices.dstIdx[j].x = i + 2 + j;
+
+				switch (op)
+				{
+				case SPDReductionOp::Min:			spd_psos->AddDefine("SPD_REDUCTION_MIN", "1"); break;
+				case SPDReductionOp::Max:			spd_psos->AddDefine("SPD_REDUCTION_MAX", "1"); break;
+				case SPDReductionOp::Average:		spd_psos->AddDefine("SPD_REDUCTION_AVERAGE", "1"); break;
+				case SPDReductionOp::KarisAverage:	spd_psos->AddDefine("SPD_REDUCTION_KARIS_AVERAGE", "1"); break;
+				}
+				cmd_list->SetPipelineState(spd_psos->Get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetRootCBV(2, indices);
+				cmd_list->Dispatch(dispatchThreadGroupCountXY[0], dispatchThreadGroupCountXY[1], 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void SPDPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_SPD;
+		spd_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+	}
+}
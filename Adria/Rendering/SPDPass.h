@@ -0,0 +1,36 @@
+#pragma once
+#include "RenderGraph/RenderGraphResourceName.h"
+#include "Graphics/GfxFormat.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class RenderGraph;
+
+	enum class SPDReductionOp : Uint8
+	{
+		Min,
+		Max,
+		Average,
+		KarisAverage
+	};
+
+	class SPDPass
+	{
+		static constexpr Uint32 SPD_MAX_MIPS = 12;
+	public:
+		explicit SPDPass(GfxDevice* gfx);
+		~SPDPass();
+
+		void AddPass(RenderGraph& rendergraph, RGResourceName src_texture, std::vector<RGResourceName> const& dst_mips,
+			GfxFormat format, SPDReductionOp op, Char const* pass_name = "");
+
+	private:
+		GfxDevice* gfx;
+		std::unique_ptr<GfxComputePipelineStatePermutations> spd_psos;
+
+	private:
+		void CreatePSOs();
+	};
+}
@@ -3,7 +3,7 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h" 
 #include "Graphics/GfxDevice.h"
-#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "Math/Packing.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Utilities/Random.h"
@@ -26,7 +26,7 @@ namespace adria
 	static TAutoConsoleVariable<Float> SSAORadius("r.SSAO.Radius", 1.0f, "Controls the radius of SSAO");
 	static TAutoConsoleVariable<Int>   SSAOResolution("r.SSAO.Resolution", SSAOResolution_Full, "Sets the resolution mode for SSAO: 0 - Full resolution, 1 - Half resolution, 2 - Quarter resolution");
 
-	SSAOPass::SSAOPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), ssao_random_texture(nullptr), blur_pass(gfx)
+	SSAOPass::SSAOPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), ssao_random_texture(nullptr), blur_pass(gfx), half_resolution_pass(gfx, w, h)
 	{
 		CreatePSO();
 		RealRandomGenerator rand_float(0.0f, 1.0f);
@@ -39,8 +39,14 @@ namespace adria
 		}
 		SSAOResolution->AddOnChanged(ConsoleVariableDelegate::CreateLambda([&](IConsoleVariable* cvar) { OnResize(width, height); }));
 	}
+	SSAOPass::~SSAOPass() = default;
+
 	void SSAOPass::AddPass(RenderGraph& rendergraph)
 	{
+		//at half resolution ssao reads the shared depth-aware half resolution inputs and is upsampled bilaterally afterwards
+		Bool const half_resolution = SSAOResolution.Get() == SSAOResolution_Half;
+		if (half_resolution) half_resolution_pass.AddDownsamplePass(rendergraph, RGPassType::ComputeAsync);
+
 		struct SSAOPassData
 		{
 			RGTextureReadOnlyId gbuffer_normal;
@@ -59,8 +65,8 @@ namespace adria
 
 				builder.DeclareTexture(RG_NAME(SSAO_Output), ssao_desc);
 				data.output = builder.WriteTexture(RG_NAME(SSAO_Output));
-				data.gbuffer_normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
-				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.gbuffer_normal = builder.ReadTexture(half_resolution ? RG_NAME(HalfResNormal) : RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(half_resolution ? RG_NAME(HalfResDepth) : RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
 			},
 			[&](SSAOPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
@@ -98,15 +104,30 @@ namespace adria
 					.depth_idx = i, .normal_idx = i + 1, .noise_idx = i + 2, .output_idx = i + 3
 				};
 
-				cmd_list->SetPipelineState(ssao_pso.get());
+				if (SSAOResolution.Get() == SSAOResolution_Half) ssao_psos->AddDefine("HALF_RESOLUTION_INPUTS", "1");
+				cmd_list->SetPipelineState(ssao_psos->Get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->SetRootCBV(2, ssao_kernel);
 				cmd_list->Dispatch(DivideAndRoundUp(ssao_width, 16), DivideAndRoundUp(ssao_height, 16), 1);
 
-			}, RGPassType::Compute);
+			}, RGPassType::ComputeAsync);
 
-		blur_pass.AddPass(rendergraph, RG_NAME(SSAO_Output), RG_NAME(AmbientOcclusion), " SSAO");
+		if (half_resolution)
+		{
+			BlurBilateralInputs const bilateral{ .depth = RG_NAME(HalfResDepth), .normal = RG_NAME(HalfResNormal) };
+			blur_pass.AddBilateralPass(rendergraph, RG_NAME(SSAO_Output), RG_NAME(SSAO_Blurred), bilateral, " SSAO", RGPassType::ComputeAsync);
+			half_resolution_pass.AddUpsamplePass(rendergraph, RG_NAME(SSAO_Blurred), RG_NAME(AmbientOcclusion), "SSAO", RGPassType::ComputeAsync);
+		}
+		else if (SSAOResolution.Get() == SSAOResolution_Full)
+		{
+			BlurBilateralInputs const bilateral{ .depth = RG_NAME(DepthStencil), .normal = RG_NAME(GBufferNormal) };
+			blur_pass.AddBilateralPass(rendergraph, RG_NAME(SSAO_Output), RG_NAME(AmbientOcclusion), bilateral, " SSAO", RGPassType::ComputeAsync);
+		}
+		else
+		{
+			blur_pass.AddPass(rendergraph, RG_NAME(SSAO_Output), RG_NAME(AmbientOcclusion), " SSAO", RGPassType::ComputeAsync);
+		}
 	}
 
 	void SSAOPass::GUI()
@@ -118,10 +139,7 @@ namespace adria
 					ImGui::SliderFloat("Power", SSAOPower.GetPtr(), 1.0f, 16.0f);
 					ImGui::SliderFloat("Radius", SSAORadius.GetPtr(), 0.5f, 4.0f);
 
-					if (ImGui::Combo("SSAO Resolution", SSAOResolution.GetPtr(), "Full\0Half\0Quarter\0", 3))
-					{
-						OnResize(width, height);
-					}
+					ImGui::Combo("SSAO Resolution", SSAOResolution.GetPtr(), "Full\0Half\0Quarter\0", 3);
 					ImGui::TreePop();
 					ImGui::Separator();
 				}
@@ -131,6 +149,7 @@ namespace adria
 	void SSAOPass::OnResize(Uint32 w, Uint32 h)
 	{
 		width = w, height = h;
+		half_resolution_pass.OnResize(w, h);
 	}
 
 	void SSAOPass::OnSceneInitialized()
@@ -170,7 +189,7 @@ namespace adria
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_Ssao;
-		ssao_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		ssao_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 	}
 
 }
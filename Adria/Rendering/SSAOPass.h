@@ -1,14 +1,15 @@
 #pragma once
 #include "BlurPass.h"
+#include "HalfResolutionPass.h"
 #include "Graphics/GfxDescriptor.h"
 #include "RenderGraph/RenderGraphResourceId.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 
 namespace adria
 {
 	class GfxDevice;
 	class GfxTexture;
-	class GfxComputePipelineState;
 	class RenderGraph;
 
 	class SSAOPass
@@ -18,6 +19,7 @@ namespace adria
 		static constexpr Uint32 KERNEL_SIZE = 16;
 	public:
 		SSAOPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~SSAOPass();
 
 		void AddPass(RenderGraph& rendergraph);
 		void GUI();
@@ -28,10 +30,11 @@ namespace adria
 		GfxDevice* gfx;
 		Uint32 width, height;
 		Vector4 ssao_kernel[KERNEL_SIZE] = {};
-		std::unique_ptr<GfxComputePipelineState> ssao_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> ssao_psos;
 		std::unique_ptr<GfxTexture> ssao_random_texture;
 		GfxDescriptor ssao_random_texture_srv;
 		BlurPass blur_pass;
+		HalfResolutionPass half_resolution_pass;
 
 	private:
 		void CreatePSO();
@@ -5,19 +5,26 @@
 #include "ShaderManager.h" 
 #include "Postprocessor.h" 
 #include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
 #include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
 #include "Core/ConsoleManager.h"
 
 namespace adria
 {
-	static TAutoConsoleVariable<Bool> SSR("r.SSR", true, "0 - Disabled, 1 - Enabled");
+	static TAutoConsoleVariable<Bool>  SSR("r.SSR", true, "0 - Disabled, 1 - Enabled");
+	static TAutoConsoleVariable<Bool>  SSRHiZ("r.SSR.HiZ", true, "Trace SSR rays through the HZB instead of marching the depth buffer linearly");
+	static TAutoConsoleVariable<Int>   SSRMaxRays("r.SSR.MaxRays", 4, "Rays per pixel at the roughness cutoff, smooth surfaces trace a single ray");
+	static TAutoConsoleVariable<Bool>  SSRTemporal("r.SSR.Temporal", true, "Accumulate SSR over frames using the reprojected history");
+	static TAutoConsoleVariable<Float> SSRHistoryWeight("r.SSR.TemporalHistoryWeight", 0.9f, "Weight of the reprojected SSR history");
 
-	SSRPass::SSRPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	SSRPass::SSRPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h), copy_to_texture_pass(gfx, w, h)
 	{
-		CreatePSO();
+		CreatePSOs();
 	}
+	SSRPass::~SSRPass() = default;
 
 	Bool SSRPass::IsEnabled(PostProcessor const*) const
 	{
@@ -25,8 +32,19 @@ namespace adria
 	}
 
 	void SSRPass::AddPass(RenderGraph& rg, PostProcessor* postprocessor)
+	{
+		AddTracePasses(rg, postprocessor);
+		copy_to_texture_pass.AddPass(rg, postprocessor->GetFinalResource(), RG_NAME(SSR_Reflection), BlendMode::AdditiveBlend);
+	}
+
+	void SSRPass::AddTracePasses(RenderGraph& rg, PostProcessor* postprocessor)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		HZBBlackboardData const* hzb_data = SSRHiZ.Get() ? rg.GetBlackboard().TryGet<HZBBlackboardData>() : nullptr;
+		HZBBlackboardData const hzb = hzb_data ? *hzb_data : HZBBlackboardData{};
+		Bool const use_hzb = hzb_data != nullptr;
+		Bool const temporal = SSRTemporal.Get();
+
 		RGResourceName last_resource = postprocessor->GetFinalResource();
 		struct SSRPassData
 		{
@@ -34,6 +52,7 @@ namespace adria
 			RGTextureReadOnlyId roughness;
 			RGTextureReadOnlyId input;
 			RGTextureReadOnlyId depth;
+			RGTextureReadOnlyId hzb;
 			RGTextureReadWriteId output;
 		};
 
@@ -45,12 +64,14 @@ namespace adria
 				ssr_output_desc.height = height;
 				ssr_output_desc.format = GfxFormat::R16G16B16A16_FLOAT;
 
-				builder.DeclareTexture(RG_NAME(SSR_Output), ssr_output_desc);
-				data.output = builder.WriteTexture(RG_NAME(SSR_Output));
+				RGResourceName const output_name = temporal ? RG_NAME(SSR_Trace) : RG_NAME(SSR_Reflection);
+				builder.DeclareTexture(output_name, ssr_output_desc);
+				data.output = builder.WriteTexture(output_name);
 				data.input = builder.ReadTexture(last_resource, ReadAccess_NonPixelShader);
 				data.normals = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_NonPixelShader);
 				data.roughness = builder.ReadTexture(RG_NAME(GBufferAlbedo), ReadAccess_NonPixelShader);
 				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				if (use_hzb) data.hzb = builder.ReadTexture(RG_NAME(HZB), ReadAccess_NonPixelShader);
 			},
 			[=](SSRPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
@@ -62,7 +83,8 @@ namespace adria
 					ctx.GetReadOnlyTexture(data.normals),
 					ctx.GetReadOnlyTexture(data.roughness),
 					ctx.GetReadOnlyTexture(data.input),
-					ctx.GetReadWriteTexture(data.output)
+					ctx.GetReadWriteTexture(data.output),
+					use_hzb ? ctx.GetReadOnlyTexture(data.hzb) : ctx.GetReadOnlyTexture(data.depth)
 				};
 				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
 				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
@@ -78,24 +100,113 @@ namespace adria
 					Uint32 diffuse_idx;
 					Uint32 scene_idx;
 					Uint32 output_idx;
+
+					Uint32 hzb_idx;
+					Uint32 hzb_mip_count;
+					Float  hzb_width;
+					Float  hzb_height;
+					Uint32 hiz_max_iterations;
+					Uint32 max_rays;
+					Float  roughness_cutoff;
 				} constants =
 				{
 					.ssr_ray_step = params.ssr_ray_step, .ssr_ray_hit_threshold = params.ssr_ray_hit_threshold,
-					.depth_idx = i, .normal_idx = i + 1, .diffuse_idx = i + 2, .scene_idx = i + 3, .output_idx = i + 4
+					.depth_idx = i, .normal_idx = i + 1, .diffuse_idx = i + 2, .scene_idx = i + 3, .output_idx = i + 4,
+					.hzb_idx = i + 5, .hzb_mip_count = hzb.hzb_mip_count, .hzb_width = (Float)hzb.hzb_width, .hzb_height = (Float)hzb.hzb_height,
+					.hiz_max_iterations = (Uint32)params.hiz_max_iterations,
+					.max_rays = (Uint32)std::clamp(SSRMaxRays.Get(), 1, 8),
+					.roughness_cutoff = params.ssr_roughness_cutoff
 				};
 
-				cmd_list->SetPipelineState(ssr_pso.get());
+				if (use_hzb) ssr_psos->AddDefine("SSR_HIZ", "1");
+				cmd_list->SetPipelineState(ssr_psos->Get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
 				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute);
 
-		postprocessor->SetFinalResource(RG_NAME(SSR_Output));
+		if (temporal) AddResolvePass(rg);
+	}
+
+	Bool SSRPass::NeedsHZB() const
+	{
+		return SSR.Get() && SSRHiZ.Get();
+	}
+
+	void SSRPass::AddResolvePass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Bool const has_velocity = rg.IsTextureDeclared(RG_NAME(VelocityBuffer));
+
+		struct SSRResolvePassData
+		{
+			RGTextureReadOnlyId trace;
+			RGTextureReadOnlyId history;
+			RGTextureReadOnlyId velocity;
+			RGTextureReadOnlyId depth;
+			RGTextureReadWriteId output;
+			Bool history_valid;
+		};
+
+		rg.AddPass<SSRResolvePassData>("SSR Resolve Pass",
+			[=](SSRResolvePassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc ssr_output_desc{};
+				ssr_output_desc.width = width;
+				ssr_output_desc.height = height;
+				ssr_output_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+
+				data.history_valid = builder.DeclareTemporalTexture(RG_NAME(SSR_Reflection), RG_NAME(SSR_History), ssr_output_desc);
+				data.output = builder.WriteTexture(RG_NAME(SSR_Reflection));
+				data.trace = builder.ReadTexture(RG_NAME(SSR_Trace), ReadAccess_NonPixelShader);
+				data.history = builder.ReadTexture(RG_NAME(SSR_History), ReadAccess_NonPixelShader);
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				if (has_velocity) data.velocity = builder.ReadTexture(RG_NAME(VelocityBuffer), ReadAccess_NonPixelShader);
+			},
+			[=](SSRResolvePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.trace),
+					ctx.GetReadOnlyTexture(data.history),
+					ctx.GetReadOnlyTexture(data.depth),
+					has_velocity ? ctx.GetReadOnlyTexture(data.velocity) : ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadWriteTexture(data.output)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				//without a velocity buffer the history is reprojected from depth with the previous view projection
+				struct SSRResolveConstants
+				{
+					Uint32 trace_idx;
+					Uint32 history_idx;
+					Uint32 depth_idx;
+					Int32  velocity_idx;
+					Uint32 output_idx;
+					Float  history_weight;
+				} constants =
+				{
+					.trace_idx = i, .history_idx = i + 1, .depth_idx = i + 2,
+					.velocity_idx = has_velocity ? Int32(i + 3) : -1,
+					.output_idx = i + 4,
+					.history_weight = data.history_valid ? SSRHistoryWeight.Get() : 0.0f
+				};
+
+				cmd_list->SetPipelineState(ssr_resolve_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute);
 	}
 
 	void SSRPass::OnResize(Uint32 w, Uint32 h)
 	{
 		width = w, height = h;
+		copy_to_texture_pass.OnResize(w, h);
 	}
 
 	void SSRPass::GUI()
@@ -106,8 +217,23 @@ namespace adria
 				ImGui::Checkbox("Enable SSR", SSR.GetPtr());
 				if (SSR.Get())
 				{
-					ImGui::SliderFloat("Ray Step", &params.ssr_ray_step, 1.0f, 3.0f);
+					ImGui::Checkbox("Hi-Z Tracing", SSRHiZ.GetPtr());
+					if (SSRHiZ.Get())
+					{
+						ImGui::SliderInt("Max Iterations", &params.hiz_max_iterations, 16, 256);
+					}
+					else
+					{
+						ImGui::SliderFloat("Ray Step", &params.ssr_ray_step, 1.0f, 3.0f);
+					}
 					ImGui::SliderFloat("Ray Hit Threshold", &params.ssr_ray_hit_threshold, 0.25f, 5.0f);
+					ImGui::SliderFloat("Roughness Cutoff", &params.ssr_roughness_cutoff, 0.0f, 1.0f);
+					ImGui::SliderInt("Max Rays", SSRMaxRays.GetPtr(), 1, 8);
+					ImGui::Checkbox("Temporal Resolve", SSRTemporal.GetPtr());
+					if (SSRTemporal.Get())
+					{
+						ImGui::SliderFloat("History Weight", SSRHistoryWeight.GetPtr(), 0.0f, 0.98f);
+					}
 				}
 				ImGui::TreePop();
 				ImGui::Separator();
@@ -115,12 +241,14 @@ namespace adria
 			}, GUICommandGroup_PostProcessing, GUICommandSubGroup_Reflection);
 	}
 
-	void SSRPass::CreatePSO()
+	void SSRPass::CreatePSOs()
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_Ssr;
-		ssr_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		ssr_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+
+		compute_pso_desc.CS = CS_SsrResolve;
+		ssr_resolve_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 	}
 
 }
-
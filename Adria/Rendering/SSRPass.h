@@ -1,5 +1,7 @@
 #pragma once
 #include "PostEffect.h"
+#include "HelperPasses.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 namespace adria
 {
@@ -7,15 +9,20 @@ namespace adria
 	class GfxComputePipelineState;
 	class RenderGraph;
 
+	//traces SSR_Reflection (premultiplied reflection, hit confidence in alpha) either by marching the depth buffer linearly
+	//or by walking the min-depth HZB when it was built for the current frame, resolves it temporally and adds it to the final resource
 	class SSRPass : public PostEffect
 	{
 		struct SSRParameters
 		{
 			Float ssr_ray_step = 1.60f;
 			Float ssr_ray_hit_threshold = 2.00f;
+			Float ssr_roughness_cutoff = 0.6f;
+			Int   hiz_max_iterations = 64;
 		};
 	public:
 		SSRPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~SSRPass();
 
 		virtual Bool IsEnabled(PostProcessor const*) const override;
 		virtual void AddPass(RenderGraph&, PostProcessor*) override;
@@ -23,14 +30,21 @@ namespace adria
 		virtual void OnSceneInitialized() {}
 		virtual void GUI() override;
 
+		//declares SSR_Reflection without compositing it, hybrid reflections trace rtr only where it has no confident hit
+		void AddTracePasses(RenderGraph&, PostProcessor*);
+		Bool NeedsHZB() const;
+
 	private:
 		GfxDevice* gfx;
 		Uint32 width, height;
 		SSRParameters params{};
-		std::unique_ptr<GfxComputePipelineState> ssr_pso;
-		
+		std::unique_ptr<GfxComputePipelineStatePermutations> ssr_psos;
+		std::unique_ptr<GfxComputePipelineState> ssr_resolve_pso;
+		CopyToTexturePass copy_to_texture_pass;
+
 	private:
-		void CreatePSO();
+		void CreatePSOs();
+		void AddResolvePass(RenderGraph&);
 	};
 
-}
\ No newline at end of file
+}
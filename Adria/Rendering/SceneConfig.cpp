@@ -4,6 +4,7 @@
 #include "Math/Constants.h"
 #include "Utilities/JsonUtil.h"
 #include "Utilities/FilesUtil.h"
+#include "Utilities/HashUtil.h"
 
 using json = nlohmann::json;
 using namespace DirectX;
@@ -12,7 +13,7 @@ namespace adria
 {
 	Bool ParseSceneConfig(std::string const& scene_file, SceneConfig& config, Bool append_dir)
 	{
-		json models, lights, camera, skybox;
+		json models, lights, camera, skybox, streaming;
 		std::string ini_file;
 		try
 		{
@@ -22,6 +23,7 @@ namespace adria
 			lights = scene_params.FindJsonArray("lights");
 			camera = scene_params.FindJson("camera");
 			skybox = scene_params.FindJson("skybox");
+			streaming = scene_params.FindJson("streaming");
 			ini_file = scene_params.FindOr<std::string>("ini", "default_cvars.ini");
 		}
 		catch (json::parse_error const& e)
@@ -30,6 +32,12 @@ namespace adria
 			return false;
 		}
 
+		JsonParams streaming_params(streaming);
+		config.streaming.cell_size = std::max(streaming_params.FindOr<Float>("cell_size", 100.0f), 1.0f);
+		config.streaming.load_radius = streaming_params.FindOr<Float>("load_radius", 200.0f);
+		config.streaming.unload_radius = std::max(streaming_params.FindOr<Float>("unload_radius", 300.0f), config.streaming.load_radius);
+		std::unordered_map<Uint64, Uint32> cell_indices;
+
 		for (auto&& model_json : models)
 		{
 			JsonParams model_params(model_json);
@@ -61,7 +69,25 @@ namespace adria
 			model_params.Find<Bool>("force_alpha_mask", force_mask);
 			Bool load_model_lights = false;
 			model_params.Find<Bool>("load_model_lights", load_model_lights);
-			config.scene_models.emplace_back(path, tex_path, transform, triangle_ccw, force_mask, load_model_lights);
+			Bool compact_vertices = false;
+			model_params.Find<Bool>("compact_vertices", compact_vertices);
+			Bool cluster_lod = false;
+			model_params.Find<Bool>("cluster_lod", cluster_lod);
+			Bool streamed = false;
+			model_params.Find<Bool>("streamed", streamed);
+			if (!streamed)
+			{
+				config.scene_models.emplace_back(path, tex_path, transform, triangle_ccw, force_mask, load_model_lights, compact_vertices, cluster_lod);
+				continue;
+			}
+
+			Int32 const cell_x = (Int32)std::floor(position[0] / config.streaming.cell_size);
+			Int32 const cell_z = (Int32)std::floor(position[2] / config.streaming.cell_size);
+			Uint64 const cell_key = ((Uint64)(Uint32)cell_x << 32) | (Uint32)cell_z;
+			auto [it, inserted] = cell_indices.try_emplace(cell_key, (Uint32)config.streaming.cells.size());
+			if (inserted) config.streaming.cells.push_back(SceneCell{ .x = cell_x, .z = cell_z });
+			//lights of a streamed model would outlive its cell, so they are not loaded
+			config.streaming.cells[it->second].models.emplace_back(path, tex_path, transform, triangle_ccw, force_mask, false, compact_vertices, cluster_lod);
 		}
 
 		for (auto&& light_json : lights)
@@ -203,5 +229,33 @@ namespace adria
 		return true;
 	}
 
+	Uint64 HashSceneConfig(SceneConfig const& scene_config)
+	{
+		HashState hash{};
+		auto CombineVector = [&hash](Vector4 const& v) { hash.Combine(v.x); hash.Combine(v.y); hash.Combine(v.z); hash.Combine(v.w); };
+		auto CombineModel = [&hash](ModelParameters const& model)
+			{
+				hash.Combine(model.model_path);
+				for (Uint32 i = 0; i < 16; ++i) hash.Combine(model.model_matrix.m[i / 4][i % 4]);
+			};
+		for (ModelParameters const& model : scene_config.scene_models) CombineModel(model);
+		for (SceneCell const& cell : scene_config.streaming.cells)
+		{
+			for (ModelParameters const& model : cell.models) CombineModel(model);
+		}
+		for (LightParameters const& light : scene_config.scene_lights)
+		{
+			Light const& light_data = light.light_data;
+			hash.Combine((Int32)light_data.type);
+			CombineVector(light_data.position);
+			CombineVector(light_data.direction);
+			CombineVector(light_data.color);
+			hash.Combine(light_data.intensity);
+			hash.Combine(light_data.range);
+		}
+		hash.Combine(scene_config.ini_file);
+		return hash;
+	}
+
 }
 
@@ -4,9 +4,25 @@
 
 namespace adria
 {
+	struct SceneCell
+	{
+		Int32 x = 0;
+		Int32 z = 0;
+		std::vector<ModelParameters> models;
+	};
+	//streamed models are grouped into square cells on the xz plane by their translation and are loaded around the camera instead of with the scene
+	struct SceneStreamingParameters
+	{
+		Float cell_size = 100.0f;
+		Float load_radius = 200.0f;
+		Float unload_radius = 300.0f;
+		std::vector<SceneCell> cells;
+	};
+
 	struct SceneConfig
 	{
 		std::vector<ModelParameters> scene_models;
+		SceneStreamingParameters streaming;
 		std::vector<LightParameters> scene_lights;
 		SkyboxParameters skybox_params;
 		CameraParameters camera_params;
@@ -14,4 +30,6 @@ namespace adria
 	};
 
 	Bool ParseSceneConfig(std::string const& scene_file, SceneConfig& scene_config, Bool append_dir = true);
+	//identifies the scene content for data persisted per scene
+	Uint64 HashSceneConfig(SceneConfig const& scene_config);
 }
\ No newline at end of file
@@ -1,20 +1,28 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #define TINYOBJLOADER_USE_MAPBOX_EARCUT
 #define CGLTF_IMPLEMENTATION
+#include <DirectXPackedVector.h>
 #include "tiny_obj_loader.h"
 #include "cgltf.h"
 #include "meshoptimizer.h"
 #include "SceneLoader.h"
+#include "CookedModel.h"
 #include "Components.h"
 #include "Meshlet.h"
+#include "OpacityMicromapBaker.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxLinearDynamicAllocator.h"
 #include "Logging/Logger.h"
+#include "Core/ConsoleManager.h"
+#include "Core/MemoryTracker.h"
 #include "Math/BoundingVolumeUtil.h"
+#include "Math/Packing.h"
 #include "Core/Paths.h"
 #include "Utilities/StringUtil.h"
 #include "Utilities/FilesUtil.h"
 #include "Utilities/Heightmap.h"
+#include "Utilities/Image.h"
+#include "Utilities/ThreadPool.h"
 
 
 using namespace DirectX;
@@ -22,6 +30,161 @@ using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> OpacityMicromaps("r.RayTracing.OpacityMicromaps", true, "Bake opacity micromaps for alpha tested geometry when the device supports them, applies to models loaded afterwards");
+	static TAutoConsoleVariable<Int> OpacityMicromapLevel("r.RayTracing.OpacityMicromapLevel", 3, "Subdivision level of baked opacity micromaps, every triangle has 4^level micro triangles [0, 8]");
+
+	namespace
+	{
+		constexpr Float LOD_TRIANGLE_RATIO = 0.5f;
+		constexpr Float LOD_MIN_REDUCTION = 0.85f;
+		constexpr Float LOD_MAX_ERROR = 0.05f;
+		constexpr Uint64 CLUSTER_GROUP_SIZE = 4;
+
+		//greedily groups clusters with the ones they share the most vertices with
+		std::vector<std::vector<Uint32>> GroupClusters(std::vector<Uint32> const& clusters, std::vector<std::vector<Uint32>> const& cluster_indices, Uint64 vertex_count)
+		{
+			std::vector<std::vector<Uint32>> vertex_clusters(vertex_count);
+			for (Uint32 i = 0; i < clusters.size(); ++i)
+			{
+				for (Uint32 vertex : cluster_indices[clusters[i]])
+				{
+					std::vector<Uint32>& users = vertex_clusters[vertex];
+					if (users.empty() || users.back() != i) users.push_back(i);
+				}
+			}
+
+			std::vector<std::unordered_map<Uint32, Uint32>> adjacency(clusters.size());
+			for (std::vector<Uint32> const& users : vertex_clusters)
+			{
+				for (Uint64 a = 0; a < users.size(); ++a)
+				{
+					for (Uint64 b = a + 1; b < users.size(); ++b)
+					{
+						++adjacency[users[a]][users[b]];
+						++adjacency[users[b]][users[a]];
+					}
+				}
+			}
+
+			std::vector<std::vector<Uint32>> groups;
+			std::vector<Bool> grouped(clusters.size(), false);
+			for (Uint32 seed = 0; seed < clusters.size(); ++seed)
+			{
+				if (grouped[seed]) continue;
+				grouped[seed] = true;
+				std::vector<Uint32> group_members{ seed };
+				while (group_members.size() < CLUSTER_GROUP_SIZE)
+				{
+					Uint32 best = Uint32(-1), best_shared = 0;
+					for (Uint32 member : group_members)
+					{
+						for (auto const& [neighbor, shared] : adjacency[member])
+						{
+							if (!grouped[neighbor] && shared > best_shared) best = neighbor, best_shared = shared;
+						}
+					}
+					if (best == Uint32(-1)) break;
+					grouped[best] = true;
+					group_members.push_back(best);
+				}
+
+				std::vector<Uint32>& group = groups.emplace_back();
+				for (Uint32 member : group_members) group.push_back(clusters[member]);
+			}
+			return groups;
+		}
+
+		Vector4 MergeSpheres(std::vector<Vector4> const& spheres)
+		{
+			Vector3 center(0.0f, 0.0f, 0.0f);
+			for (Vector4 const& sphere : spheres) center += Vector3(sphere.x, sphere.y, sphere.z);
+			center /= (Float)spheres.size();
+			Float radius = 0.0f;
+			for (Vector4 const& sphere : spheres) radius = std::max(radius, Vector3::Distance(center, Vector3(sphere.x, sphere.y, sphere.z)) + sphere.w);
+			return Vector4(center.x, center.y, center.z, radius);
+		}
+
+		//node relative transforms of EXT_mesh_gpu_instancing, a single identity transform if the node is not instanced
+		std::vector<Matrix> GetNodeInstanceTransforms(cgltf_node const& gltf_node)
+		{
+			if (!gltf_node.has_mesh_gpu_instancing) return { Matrix::Identity };
+
+			cgltf_mesh_gpu_instancing const& instancing = gltf_node.mesh_gpu_instancing;
+			Uint64 const instance_count = instancing.attributes[0].data->count;
+			std::vector<Vector3> translations(instance_count, Vector3(0.0f, 0.0f, 0.0f));
+			std::vector<Quaternion> rotations(instance_count, Quaternion::Identity);
+			std::vector<Vector3> scales(instance_count, Vector3(1.0f, 1.0f, 1.0f));
+			for (Uint64 i = 0; i < instancing.attributes_count; ++i)
+			{
+				cgltf_attribute const& gltf_attribute = instancing.attributes[i];
+				for (Uint64 j = 0; j < instance_count; ++j)
+				{
+					if (strcmp(gltf_attribute.name, "TRANSLATION") == 0) cgltf_accessor_read_float(gltf_attribute.data, j, &translations[j].x, 3);
+					else if (strcmp(gltf_attribute.name, "ROTATION") == 0) cgltf_accessor_read_float(gltf_attribute.data, j, &rotations[j].x, 4);
+					else if (strcmp(gltf_attribute.name, "SCALE") == 0) cgltf_accessor_read_float(gltf_attribute.data, j, &scales[j].x, 3);
+				}
+			}
+
+			std::vector<Matrix> instance_transforms(instance_count);
+			for (Uint64 j = 0; j < instance_count; ++j)
+			{
+				instance_transforms[j] = Matrix::CreateScale(scales[j]) * Matrix::CreateFromQuaternion(rotations[j]) * Matrix::CreateTranslation(translations[j]);
+			}
+			return instance_transforms;
+		}
+
+		//EXT_meshopt_compression, decoded views override their buffer data and are freed by cgltf_free.
+		//accessors of KHR_mesh_quantization need no special handling since cgltf_accessor_read_float dequantizes them
+		Bool DecodeMeshoptBufferViews(cgltf_data* gltf_data)
+		{
+			for (Uint64 i = 0; i < gltf_data->buffer_views_count; ++i)
+			{
+				cgltf_buffer_view& buffer_view = gltf_data->buffer_views[i];
+				if (!buffer_view.has_meshopt_compression) continue;
+
+				cgltf_meshopt_compression const& compression = buffer_view.meshopt_compression;
+				Uint8 const* source = static_cast<Uint8 const*>(compression.buffer->data);
+				if (!source) return false;
+				source += compression.offset;
+
+				buffer_view.data = malloc(compression.count * compression.stride);
+				if (!buffer_view.data) return false;
+
+				Int32 decode_result = -1;
+				switch (compression.mode)
+				{
+				case cgltf_meshopt_compression_mode_attributes:
+					decode_result = meshopt_decodeVertexBuffer(buffer_view.data, compression.count, compression.stride, source, compression.size);
+					break;
+				case cgltf_meshopt_compression_mode_triangles:
+					decode_result = meshopt_decodeIndexBuffer(buffer_view.data, compression.count, compression.stride, source, compression.size);
+					break;
+				case cgltf_meshopt_compression_mode_indices:
+					decode_result = meshopt_decodeIndexSequence(buffer_view.data, compression.count, compression.stride, source, compression.size);
+					break;
+				default:
+					return false;
+				}
+				if (decode_result != 0) return false;
+
+				switch (compression.filter)
+				{
+				case cgltf_meshopt_compression_filter_octahedral:
+					meshopt_decodeFilterOct(buffer_view.data, compression.count, compression.stride);
+					break;
+				case cgltf_meshopt_compression_filter_quaternion:
+					meshopt_decodeFilterQuat(buffer_view.data, compression.count, compression.stride);
+					break;
+				case cgltf_meshopt_compression_filter_exponential:
+					meshopt_decodeFilterExp(buffer_view.data, compression.count, compression.stride);
+					break;
+				default:
+					break;
+				}
+			}
+			return true;
+		}
+	}
 
 	std::vector<entt::entity> SceneLoader::LoadGrid(GridParameters const& params)
 	{
@@ -443,6 +606,34 @@ namespace adria
 		return ocean_chunks;
 	}
 
+	entt::entity SceneLoader::LoadTerrain(TerrainParameters&& params)
+	{
+		ADRIA_ASSERT(params.heightmap && params.heightmap->Width() > 1 && params.heightmap->Depth() > 1);
+		ADRIA_ASSERT(params.layers.size() <= Terrain::MAX_LAYERS);
+
+		Terrain terrain{};
+		terrain.heightmap = std::move(params.heightmap);
+		terrain.origin = params.origin;
+		terrain.texel_size = params.texel_size;
+		terrain.height_scale = params.height_scale;
+		terrain.layer_count = (Uint32)std::min<Uint64>(params.layers.size(), Terrain::MAX_LAYERS);
+		for (Uint32 i = 0; i < terrain.layer_count; ++i)
+		{
+			TerrainLayerParameters const& layer_params = params.layers[i];
+			TerrainLayer& layer = terrain.layers[i];
+			if (!layer_params.albedo_texture_path.empty()) layer.albedo_texture = g_TextureManager.LoadTexture(layer_params.albedo_texture_path);
+			layer.albedo_color = layer_params.albedo_color;
+			layer.tiling = layer_params.tiling;
+			layer.height_range = layer_params.height_range;
+			layer.slope_range = layer_params.slope_range;
+		}
+
+		entt::entity terrain_entity = reg.create();
+		reg.emplace<Terrain>(terrain_entity, std::move(terrain));
+		reg.emplace<Tag>(terrain_entity, "Terrain");
+		return terrain_entity;
+	}
+
 	entt::entity SceneLoader::LoadDecal(DecalParameters const& params)
 	{
 		Decal decal{};
@@ -484,7 +675,105 @@ namespace adria
 		return decal_entity;
 	}
 
+	PreparedModel::PreparedModel() = default;
+	PreparedModel::~PreparedModel() = default;
+
 	entt::entity SceneLoader::LoadModel_GLTF(ModelParameters const& params)
+	{
+		if (!FileExists(params.model_path))
+		{
+			ADRIA_LOG(WARNING, "GLTF - Failed to load '%s'", params.model_path.c_str());
+			return entt::null;
+		}
+
+		CookedModel cooked_model{};
+		if (!LoadOrCookModel_GLTF(params, cooked_model)) return entt::null;
+		return CreateModel(params, cooked_model);
+	}
+
+	std::unique_ptr<PreparedModel> SceneLoader::PrepareModel_GLTF(ModelParameters const& params)
+	{
+		if (!FileExists(params.model_path))
+		{
+			ADRIA_LOG(WARNING, "GLTF - Failed to load '%s'", params.model_path.c_str());
+			return nullptr;
+		}
+
+		std::unique_ptr<PreparedModel> prepared_model = std::make_unique<PreparedModel>();
+		prepared_model->params = params;
+		prepared_model->cooked_model = std::make_unique<CookedModel>();
+		CookedModel& cooked_model = *prepared_model->cooked_model;
+		if (!LoadOrCookModel_GLTF(params, cooked_model)) return nullptr;
+
+		//copying here faults the mapped geometry in on this thread instead of in the upload on the main one
+		Uint8 const* geometry_data = cooked_model.GetGeometryData();
+		prepared_model->geometry.assign(geometry_data, geometry_data + cooked_model.GetGeometrySize());
+		return prepared_model;
+	}
+
+	entt::entity SceneLoader::CreatePreparedModel(PreparedModel const& prepared_model)
+	{
+		return CreateModel(prepared_model.params, *prepared_model.cooked_model, prepared_model.geometry);
+	}
+
+	Bool SceneLoader::LoadOrCookModel_GLTF(ModelParameters const& params, CookedModel& cooked_model)
+	{
+		MemoryTagScope memory_scope(MemoryTag::SceneLoader);
+		std::string const cooked_path = GetCookedModelPath(params.model_path);
+		Int64 const source_write_time = GetFileLastWriteTime(params.model_path);
+		CookedModelOptions cook_options = CookedModelOption_None;
+		if (params.triangle_ccw) cook_options |= CookedModelOption_TriangleCCW;
+		if (params.compact_vertices) cook_options |= CookedModelOption_CompactVertices;
+		if (params.cluster_lod) cook_options |= CookedModelOption_ClusterLOD;
+		if (!cooked_model.Load(cooked_path, source_write_time, cook_options))
+		{
+			if (!CookModel_GLTF(params, cooked_model)) return false;
+			cooked_model.Save(cooked_path, source_write_time, cook_options);
+		}
+		BakeOpacityMicromaps(params, cooked_model);
+		return true;
+	}
+
+	void SceneLoader::BakeOpacityMicromaps(ModelParameters const& params, CookedModel& cooked_model)
+	{
+		if (!OpacityMicromaps.Get() || !gfx->GetCapabilities().SupportsOpacityMicromaps()) return;
+
+		Uint32 const subdivision_level = (Uint32)std::clamp(OpacityMicromapLevel.Get(), 0, 8);
+		Uint8 const* geometry_data = cooked_model.GetGeometryData();
+		std::unordered_map<std::string, std::unique_ptr<Image>> alpha_images;
+		std::vector<Vector2> uvs;
+		cooked_model.opacity_micromaps.assign(cooked_model.submeshes.size(), nullptr);
+		for (Uint64 i = 0; i < cooked_model.submeshes.size(); ++i)
+		{
+			SubMeshGPU const& submesh = cooked_model.submeshes[i];
+			if (submesh.skinned || submesh.morph_target_count > 0 || submesh.topology != GfxPrimitiveTopology::TriangleList) continue;
+			Material const& material = cooked_model.materials[submesh.material_index];
+			std::string const& albedo_texture = cooked_model.material_textures[submesh.material_index][MaterialTextureSlot_Albedo];
+			if (material.alpha_mode != MaterialAlphaMode::Mask || albedo_texture.empty()) continue;
+
+			std::unique_ptr<Image>& alpha_image = alpha_images[albedo_texture];
+			if (!alpha_image) alpha_image = std::make_unique<Image>(params.textures_path + albedo_texture);
+
+			uvs.resize(submesh.vertices_count);
+			if (submesh.vertex_layout == VertexLayout::Compact)
+			{
+				Uint32 const* packed_uvs = reinterpret_cast<Uint32 const*>(geometry_data + submesh.uvs_offset);
+				for (Uint32 v = 0; v < submesh.vertices_count; ++v)
+				{
+					uvs[v].x = PackedVector::XMConvertHalfToFloat((PackedVector::HALF)(packed_uvs[v] & 0xffff));
+					uvs[v].y = PackedVector::XMConvertHalfToFloat((PackedVector::HALF)(packed_uvs[v] >> 16));
+				}
+			}
+			else
+			{
+				memcpy(uvs.data(), geometry_data + submesh.uvs_offset, uvs.size() * sizeof(Vector2));
+			}
+			std::span<Uint32 const> const indices(reinterpret_cast<Uint32 const*>(geometry_data + submesh.indices_offset), submesh.indices_count);
+			cooked_model.opacity_micromaps[i] = adria::BakeOpacityMicromaps(indices, uvs, *alpha_image, material.alpha_cutoff, subdivision_level);
+		}
+	}
+
+	Bool SceneLoader::CookModel_GLTF(ModelParameters const& params, CookedModel& cooked_model)
 	{
 		cgltf_options options{};
 		cgltf_data* gltf_data = nullptr;
@@ -492,24 +781,29 @@ namespace adria
 		if (result != cgltf_result_success)
 		{
 			ADRIA_LOG(WARNING, "GLTF - Failed to load '%s'", params.model_path.c_str());
-			return entt::null;
+			return false;
 		}
 		result = cgltf_load_buffers(&options, gltf_data, params.model_path.c_str());
 		if (result != cgltf_result_success)
 		{
 			ADRIA_LOG(WARNING, "GLTF - Failed to load buffers '%s'", params.model_path.c_str());
-			return entt::null;
+			cgltf_free(gltf_data);
+			return false;
+		}
+		if (!DecodeMeshoptBufferViews(gltf_data))
+		{
+			ADRIA_LOG(WARNING, "GLTF - Failed to decode meshopt compressed buffers '%s'", params.model_path.c_str());
+			cgltf_free(gltf_data);
+			return false;
 		}
 
-		std::string model_name = GetFilename(params.model_path);
-		entt::entity mesh_entity = reg.create();
-		Mesh mesh{};
-
-		mesh.materials.reserve(gltf_data->materials_count);
+		cooked_model.materials.reserve(gltf_data->materials_count);
+		cooked_model.material_textures.resize(gltf_data->materials_count);
 		for (Uint32 i = 0; i < gltf_data->materials_count; ++i)
 		{
 			cgltf_material const& gltf_material = gltf_data->materials[i];
-			Material& material = mesh.materials.emplace_back();
+			Material& material = cooked_model.materials.emplace_back();
+			auto& material_textures = cooked_model.material_textures[i];
 			material.alpha_cutoff = (Float)gltf_material.alpha_cutoff;
 			material.double_sided = gltf_material.double_sided;
 			material.emissive_factor = (Float)gltf_material.emissive_factor[0];
@@ -546,14 +840,10 @@ namespace adria
 				}
 				return texture->image->uri;
 			};
-			auto GetTexture = [&](cgltf_texture* texture, bool srgb, TextureHandle default_handle)
+			auto SetTexture = [&](MaterialTextureSlot slot, cgltf_texture* texture, TextureHandle default_handle)
 			{
-				if (texture)
-				{
-					std::string texbase = params.textures_path + GetImageURI(texture);
-					return g_TextureManager.LoadTexture(texbase, srgb);
-				}
-				return default_handle;
+				GetMaterialTexture(material, slot) = default_handle;
+				if (texture) material_textures[slot] = GetImageURI(texture);
 			};
 			if (gltf_material.has_pbr_metallic_roughness)
 			{
@@ -563,13 +853,13 @@ namespace adria
 				material.albedo_color[2] = (Float)pbr_metallic_roughness.base_color_factor[2];
 				material.metallic_factor = (Float)pbr_metallic_roughness.metallic_factor;
 				material.roughness_factor = (Float)pbr_metallic_roughness.roughness_factor;
-				material.albedo_texture = GetTexture(pbr_metallic_roughness.base_color_texture.texture, true, DEFAULT_WHITE_TEXTURE_HANDLE);
-				material.metallic_roughness_texture = GetTexture(pbr_metallic_roughness.metallic_roughness_texture.texture, false, DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_Albedo, pbr_metallic_roughness.base_color_texture.texture, DEFAULT_WHITE_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_MetallicRoughness, pbr_metallic_roughness.metallic_roughness_texture.texture, DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE);
 			}
 			else if (gltf_material.has_pbr_specular_glossiness)
 			{
 				cgltf_pbr_specular_glossiness pbr_specular_glossiness = gltf_material.pbr_specular_glossiness;
-				material.albedo_texture = GetTexture(pbr_specular_glossiness.diffuse_texture.texture, true, DEFAULT_WHITE_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_Albedo, pbr_specular_glossiness.diffuse_texture.texture, DEFAULT_WHITE_TEXTURE_HANDLE);
 				material.roughness_factor = 1.0f - gltf_material.pbr_specular_glossiness.glossiness_factor;
 				material.albedo_color[0] = gltf_material.pbr_specular_glossiness.diffuse_factor[0];
 				material.albedo_color[1] = gltf_material.pbr_specular_glossiness.diffuse_factor[1];
@@ -581,49 +871,32 @@ namespace adria
 			if (gltf_material.has_anisotropy)
 			{
 				material.shading_extension = ShadingExtension::Anisotropy;
-				material.anisotropy_texture = GetTexture(gltf_material.anisotropy.anisotropy_texture.texture, true, INVALID_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_Anisotropy, gltf_material.anisotropy.anisotropy_texture.texture, INVALID_TEXTURE_HANDLE);
 				material.anisotropy_strength = gltf_material.anisotropy.anisotropy_strength;
 				material.anisotropy_rotation = gltf_material.anisotropy.anisotropy_rotation;
 			}
 			if (gltf_material.has_clearcoat)
 			{
 				material.shading_extension = ShadingExtension::ClearCoat;
-				material.clear_coat_texture = GetTexture(gltf_material.clearcoat.clearcoat_texture.texture, false, DEFAULT_WHITE_TEXTURE_HANDLE);
-				material.clear_coat_roughness_texture = GetTexture(gltf_material.clearcoat.clearcoat_roughness_texture.texture, false, DEFAULT_WHITE_TEXTURE_HANDLE);
-				material.clear_coat_normal_texture = GetTexture(gltf_material.clearcoat.clearcoat_normal_texture.texture, false, DEFAULT_NORMAL_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_ClearCoat, gltf_material.clearcoat.clearcoat_texture.texture, DEFAULT_WHITE_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_ClearCoatRoughness, gltf_material.clearcoat.clearcoat_roughness_texture.texture, DEFAULT_WHITE_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_ClearCoatNormal, gltf_material.clearcoat.clearcoat_normal_texture.texture, DEFAULT_NORMAL_TEXTURE_HANDLE);
 				material.clear_coat = gltf_material.clearcoat.clearcoat_factor;
 				material.clear_coat_roughness = gltf_material.clearcoat.clearcoat_roughness_factor;
 			}
 			if (gltf_material.has_sheen)
 			{
 				material.shading_extension = ShadingExtension::Sheen;
-				material.sheen_color_texture = GetTexture(gltf_material.sheen.sheen_color_texture.texture, true, DEFAULT_WHITE_TEXTURE_HANDLE);
-				material.sheen_roughness_texture = GetTexture(gltf_material.sheen.sheen_color_texture.texture, false, DEFAULT_WHITE_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_SheenColor, gltf_material.sheen.sheen_color_texture.texture, DEFAULT_WHITE_TEXTURE_HANDLE);
+				SetTexture(MaterialTextureSlot_SheenRoughness, gltf_material.sheen.sheen_color_texture.texture, DEFAULT_WHITE_TEXTURE_HANDLE);
 				material.sheen_color[0] = gltf_material.sheen.sheen_color_factor[0];
 				material.sheen_color[1] = gltf_material.sheen.sheen_color_factor[1];
 				material.sheen_color[2] = gltf_material.sheen.sheen_color_factor[2];
 				material.sheen_roughness = gltf_material.sheen.sheen_roughness_factor;
 			}
 
-			if (cgltf_texture* texture = gltf_material.normal_texture.texture)
-			{
-				std::string texnormal = params.textures_path + GetImageURI(texture);
-				material.normal_texture = g_TextureManager.LoadTexture(texnormal, false);
-			}
-			else
-			{
-				material.normal_texture = DEFAULT_NORMAL_TEXTURE_HANDLE;
-			}
-
-			if (cgltf_texture* texture = gltf_material.emissive_texture.texture)
-			{
-				std::string texemissive = params.textures_path + GetImageURI(texture);
-				material.emissive_texture = g_TextureManager.LoadTexture(texemissive, true);
-			}
-			else
-			{
-				material.emissive_texture = DEFAULT_BLACK_TEXTURE_HANDLE;
-			}
+			SetTexture(MaterialTextureSlot_Normal, gltf_material.normal_texture.texture, DEFAULT_NORMAL_TEXTURE_HANDLE);
+			SetTexture(MaterialTextureSlot_Emissive, gltf_material.emissive_texture.texture, DEFAULT_BLACK_TEXTURE_HANDLE);
 		}
 
 		std::unordered_map<cgltf_mesh const*, std::vector<Int32>> mesh_primitives_map; //mesh -> vector of primitive indices
@@ -641,21 +914,50 @@ namespace adria
 			std::vector<Vector2> uvs_stream;
 			std::vector<Uint32>   indices;
 
+			std::vector<std::array<Uint16, 4>> joints_stream;
+			std::vector<Vector4> weights_stream;
+			std::vector<MorphTargetVertex> morph_targets;
+			Uint32 morph_target_count = 0;
+
+			//deformed vertices are written as floats by the skinning pass, they are never quantized
+			Bool IsSkinned() const { return !joints_stream.empty(); }
+			Bool IsDeformable() const { return IsSkinned() || morph_target_count > 0; }
+
+			std::vector<Uint64> compact_positions_stream;
+			std::vector<Uint32> compact_normals_stream;
+			std::vector<Uint32> compact_tangents_stream;
+			std::vector<Uint32> compact_uvs_stream;
+
 			std::vector<Meshlet>		 meshlets;
 			std::vector<Uint32>			 meshlet_vertices;
-			std::vector<MeshletTriangle> meshlet_triangles;
+			std::vector<Uint8>			 meshlet_triangles;
+
+			std::vector<SubMeshLOD> lods;
+			std::vector<MeshletLOD> cluster_lods;
 		};
-		std::vector<MeshData> mesh_datas{};
+		std::vector<cgltf_primitive const*> gltf_primitives{};
 		for (Uint32 i = 0; i < gltf_data->meshes_count; ++i)
 		{
 			cgltf_mesh const& gltf_mesh = gltf_data->meshes[i];
 			std::vector<Int32>& primitives = mesh_primitives_map[&gltf_mesh];
 			for (Uint32 j = 0; j < gltf_mesh.primitives_count; ++j)
 			{
-				auto const& gltf_primitive = gltf_mesh.primitives[j];
+				gltf_primitives.push_back(&gltf_mesh.primitives[j]);
+				primitives.push_back(primitive_count++);
+			}
+		}
+
+		std::vector<MeshData> mesh_datas(gltf_primitives.size());
+		std::vector<std::future<void>> mesh_tasks;
+		mesh_tasks.reserve(gltf_primitives.size());
+		for (Uint64 primitive_index = 0; primitive_index < gltf_primitives.size(); ++primitive_index)
+		{
+			mesh_tasks.push_back(g_ThreadPool.Submit([&, primitive_index]()
+			{
+				cgltf_primitive const& gltf_primitive = *gltf_primitives[primitive_index];
+				MeshData& mesh_data = mesh_datas[primitive_index];
 				ADRIA_ASSERT(gltf_primitive.indices->count >= 0);
 
-				MeshData& mesh_data = mesh_datas.emplace_back();
 				mesh_data.material_index = (Int32)(gltf_primitive.material - gltf_data->materials);
 				mesh_data.indices.reserve(gltf_primitive.indices->count);
 				
@@ -710,131 +1012,359 @@ namespace adria
 					ReadAttributeData(mesh_data.normals_stream, "NORMAL");
 					ReadAttributeData(mesh_data.tangents_stream, "TANGENT");
 					ReadAttributeData(mesh_data.uvs_stream, "TEXCOORD_0");
+					ReadAttributeData(mesh_data.weights_stream, "WEIGHTS_0");
+					if (!attr_name.compare("JOINTS_0"))
+					{
+						mesh_data.joints_stream.resize(gltf_attribute.data->count);
+						for (Uint64 i = 0; i < gltf_attribute.data->count; ++i)
+						{
+							Uint32 joints[4] = {};
+							cgltf_accessor_read_uint(gltf_attribute.data, i, joints, 4);
+							for (Uint32 j = 0; j < 4; ++j) mesh_data.joints_stream[i][j] = (Uint16)joints[j];
+						}
+					}
 				}
-				primitives.push_back(primitive_count++);
-			}
-		}
 
-		Uint64 total_buffer_size = 0;
-		for (auto& mesh_data : mesh_datas)
-		{
-			std::vector<Uint32> const& indices = mesh_data.indices;
-			Uint64 vertex_count = mesh_data.positions_stream.size();
+				std::vector<Uint32> const& indices = mesh_data.indices;
+				Uint64 vertex_count = mesh_data.positions_stream.size();
 
-			Bool has_tangents = !mesh_data.tangents_stream.empty();
-			if (mesh_data.normals_stream.size() != vertex_count) mesh_data.normals_stream.resize(vertex_count);
-			if (mesh_data.uvs_stream.size() != vertex_count) mesh_data.uvs_stream.resize(vertex_count);
-			if (mesh_data.tangents_stream.size() != vertex_count) mesh_data.tangents_stream.resize(vertex_count);
+				Bool has_tangents = !mesh_data.tangents_stream.empty();
+				if (mesh_data.normals_stream.size() != vertex_count) mesh_data.normals_stream.resize(vertex_count);
+				if (mesh_data.uvs_stream.size() != vertex_count) mesh_data.uvs_stream.resize(vertex_count);
+				if (mesh_data.tangents_stream.size() != vertex_count) mesh_data.tangents_stream.resize(vertex_count);
 
-			if (!has_tangents)
-			{
-				ComputeTangentFrame(mesh_data.indices.data(), mesh_data.indices.size(), mesh_data.positions_stream.data(),
-					mesh_data.normals_stream.data(), mesh_data.uvs_stream.data(), vertex_count, mesh_data.tangents_stream.data());
-			}
+				if (!has_tangents)
+				{
+					ComputeTangentFrame(mesh_data.indices.data(), mesh_data.indices.size(), mesh_data.positions_stream.data(),
+						mesh_data.normals_stream.data(), mesh_data.uvs_stream.data(), vertex_count, mesh_data.tangents_stream.data());
+				}
 
-			meshopt_optimizeVertexCache(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
-			meshopt_optimizeOverdraw(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3), 1.05f);
-			std::vector<Uint32> remap(vertex_count);
-			meshopt_optimizeVertexFetchRemap(&remap[0], mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
-			meshopt_remapIndexBuffer(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.positions_stream.data(), mesh_data.positions_stream.data(), vertex_count, sizeof(Vector3), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.normals_stream.data(), mesh_data.normals_stream.data(), mesh_data.normals_stream.size(), sizeof(Vector3), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.tangents_stream.data(), mesh_data.tangents_stream.data(), mesh_data.tangents_stream.size(), sizeof(Vector4), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.uvs_stream.data(), mesh_data.uvs_stream.data(), mesh_data.uvs_stream.size(), sizeof(Vector2), &remap[0]);
+				if (mesh_data.joints_stream.size() != vertex_count || mesh_data.weights_stream.size() != vertex_count)
+				{
+					mesh_data.joints_stream.clear();
+					mesh_data.weights_stream.clear();
+				}
+				for (Vector4& weights : mesh_data.weights_stream)
+				{
+					Float const weight_sum = weights.x + weights.y + weights.z + weights.w;
+					weights = weight_sum > 0.0f ? weights / weight_sum : Vector4(1.0f, 0.0f, 0.0f, 0.0f);
+				}
 
-			Uint64 const max_meshlets = meshopt_buildMeshletsBound(mesh_data.indices.size(), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
-			mesh_data.meshlets.resize(max_meshlets);
-			mesh_data.meshlet_vertices.resize(max_meshlets * MESHLET_MAX_VERTICES);
+				mesh_data.morph_target_count = (Uint32)gltf_primitive.targets_count;
+				mesh_data.morph_targets.resize(mesh_data.morph_target_count * vertex_count);
+				for (Uint32 target = 0; target < mesh_data.morph_target_count; ++target)
+				{
+					cgltf_morph_target const& gltf_target = gltf_primitive.targets[target];
+					MorphTargetVertex* target_vertices = mesh_data.morph_targets.data() + target * vertex_count;
+					for (Uint32 k = 0; k < gltf_target.attributes_count; ++k)
+					{
+						cgltf_attribute const& gltf_attribute = gltf_target.attributes[k];
+						if (gltf_attribute.data->count != vertex_count) continue;
+						Bool const position = !strcmp(gltf_attribute.name, "POSITION");
+						if (!position && strcmp(gltf_attribute.name, "NORMAL")) continue;
+						for (Uint64 i = 0; i < vertex_count; ++i)
+						{
+							Vector3& delta = position ? target_vertices[i].position : target_vertices[i].normal;
+							cgltf_accessor_read_float(gltf_attribute.data, i, &delta.x, 3);
+						}
+					}
+				}
 
-			std::vector<Uchar> meshlet_triangles(max_meshlets * MESHLET_MAX_TRIANGLES * 3);
-			std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+				meshopt_optimizeVertexCache(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
+				meshopt_optimizeOverdraw(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3), 1.05f);
+				std::vector<Uint32> remap(vertex_count);
+				meshopt_optimizeVertexFetchRemap(&remap[0], mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
+				meshopt_remapIndexBuffer(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &remap[0]);
+				meshopt_remapVertexBuffer(mesh_data.positions_stream.data(), mesh_data.positions_stream.data(), vertex_count, sizeof(Vector3), &remap[0]);
+				meshopt_remapVertexBuffer(mesh_data.normals_stream.data(), mesh_data.normals_stream.data(), mesh_data.normals_stream.size(), sizeof(Vector3), &remap[0]);
+				meshopt_remapVertexBuffer(mesh_data.tangents_stream.data(), mesh_data.tangents_stream.data(), mesh_data.tangents_stream.size(), sizeof(Vector4), &remap[0]);
+				meshopt_remapVertexBuffer(mesh_data.uvs_stream.data(), mesh_data.uvs_stream.data(), mesh_data.uvs_stream.size(), sizeof(Vector2), &remap[0]);
+				meshopt_remapVertexBuffer(mesh_data.joints_stream.data(), mesh_data.joints_stream.data(), mesh_data.joints_stream.size(), sizeof(std::array<Uint16, 4>), &remap[0]);
+				meshopt_remapVertexBuffer(mesh_data.weights_stream.data(), mesh_data.weights_stream.data(), mesh_data.weights_stream.size(), sizeof(Vector4), &remap[0]);
+				for (Uint32 target = 0; target < mesh_data.morph_target_count; ++target)
+				{
+					MorphTargetVertex* target_vertices = mesh_data.morph_targets.data() + target * vertex_count;
+					meshopt_remapVertexBuffer(target_vertices, target_vertices, vertex_count, sizeof(MorphTargetVertex), &remap[0]);
+				}
 
-			Uint64 meshlet_count = meshopt_buildMeshlets(meshlets.data(), mesh_data.meshlet_vertices.data(), meshlet_triangles.data(),
-				mesh_data.indices.data(), mesh_data.indices.size(), &mesh_data.positions_stream[0].x, mesh_data.positions_stream.size(), sizeof(Vector3),
-				MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, 0);
+				mesh_data.bounding_box = AABBFromPositions(mesh_data.positions_stream);
 
-			meshopt_Meshlet const& last = meshlets[meshlet_count - 1];
-			meshlet_triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-			meshlets.resize(meshlet_count);
+				//meshlet centers are quantized within the submesh bounding box, the radius absorbs the quantization error
+				Vector3 const bounds_extents = Vector3::Max(Vector3(mesh_data.bounding_box.Extents), Vector3(1e-4f, 1e-4f, 1e-4f));
+				Vector3 const bounds_min = Vector3(mesh_data.bounding_box.Center) - bounds_extents;
+				Vector3 const bounds_size = bounds_extents * 2.0f;
+				Float const center_error = (bounds_size * 0.5f).Length() / 65535.0f;
 
-			mesh_data.meshlets.resize(meshlet_count);
-			mesh_data.meshlet_vertices.resize(last.vertex_offset + last.vertex_count);
-			mesh_data.meshlet_triangles.resize(meshlet_triangles.size() / 3);
+				//meshlets of all lods share the submesh meshlet streams, offsets are relative to the start of the submesh streams
+				auto BuildMeshlets = [&](std::vector<Uint32> const& indices)
+				{
+					Uint64 const max_meshlets = meshopt_buildMeshletsBound(indices.size(), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+					std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+					std::vector<Uint32> meshlet_vertices(max_meshlets * MESHLET_MAX_VERTICES);
+					std::vector<Uint8> meshlet_triangles(max_meshlets * MESHLET_MAX_TRIANGLES * 3);
+
+					Uint64 meshlet_count = meshopt_buildMeshlets(meshlets.data(), meshlet_vertices.data(), meshlet_triangles.data(),
+						indices.data(), indices.size(), &mesh_data.positions_stream[0].x, mesh_data.positions_stream.size(), sizeof(Vector3),
+						MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, 0);
+
+					meshopt_Meshlet const& last = meshlets[meshlet_count - 1];
+					meshlet_triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
+					meshlet_vertices.resize(last.vertex_offset + last.vertex_count);
+
+					Uint32 const vertex_base = (Uint32)mesh_data.meshlet_vertices.size();
+					Uint32 const triangle_base = (Uint32)mesh_data.meshlet_triangles.size();
+					mesh_data.meshlets.reserve(mesh_data.meshlets.size() + meshlet_count);
+					for (Uint64 i = 0; i < meshlet_count; ++i)
+					{
+						meshopt_Meshlet const& m = meshlets[i];
+						meshopt_Bounds meshopt_bounds = meshopt_computeMeshletBounds(&meshlet_vertices[m.vertex_offset], &meshlet_triangles[m.triangle_offset],
+							m.triangle_count, reinterpret_cast<Float const*>(mesh_data.positions_stream.data()), vertex_count, sizeof(Vector3));
+
+						Meshlet& meshlet = mesh_data.meshlets.emplace_back();
+						Vector3 const center = (Vector3(meshopt_bounds.center) - bounds_min) / bounds_size;
+						meshlet.center[0] = PackUnorm16(center.x);
+						meshlet.center[1] = PackUnorm16(center.y);
+						meshlet.center[2] = PackUnorm16(center.z);
+						meshlet.radius = PackHalfRoundUp(meshopt_bounds.radius + center_error);
+
+						meshlet.vertex_count = (Uint16)m.vertex_count;
+						meshlet.triangle_count = (Uint16)m.triangle_count;
+						meshlet.vertex_offset = vertex_base + m.vertex_offset;
+						meshlet.triangle_offset = triangle_base + m.triangle_offset;
+						meshlet.cone_axis_cutoff = (Uint8)meshopt_bounds.cone_axis_s8[0] | ((Uint8)meshopt_bounds.cone_axis_s8[1] << 8) |
+												   ((Uint8)meshopt_bounds.cone_axis_s8[2] << 16) | ((Uint32)(Uint8)meshopt_bounds.cone_cutoff_s8 << 24);
+					}
+					mesh_data.meshlet_vertices.insert(mesh_data.meshlet_vertices.end(), meshlet_vertices.begin(), meshlet_vertices.end());
+					mesh_data.meshlet_triangles.insert(mesh_data.meshlet_triangles.end(), meshlet_triangles.begin(), meshlet_triangles.end());
+					return (Uint32)meshlet_count;
+				};
 
-			Uint32 triangle_offset = 0;
-			for (Uint64 i = 0; i < meshlet_count; ++i)
-			{
-				meshopt_Meshlet const& m = meshlets[i];
-				meshopt_Bounds meshopt_bounds = meshopt_computeMeshletBounds(&mesh_data.meshlet_vertices[m.vertex_offset], &meshlet_triangles[m.triangle_offset],
-					m.triangle_count, reinterpret_cast<Float const*>(mesh_data.positions_stream.data()), vertex_count, sizeof(Vector3));
+				SubMeshLOD& base_lod = mesh_data.lods.emplace_back();
+				base_lod.index_count = (Uint32)mesh_data.indices.size();
+				base_lod.meshlet_count = BuildMeshlets(mesh_data.indices);
 
-				Uchar* src_triangles = meshlet_triangles.data() + m.triangle_offset;
-				for (Uint32 triangle_idx = 0; triangle_idx < m.triangle_count; ++triangle_idx)
+				if (params.cluster_lod && mesh_data.topology == GfxPrimitiveTopology::TriangleList)
 				{
-					MeshletTriangle& tri = mesh_data.meshlet_triangles[triangle_idx + triangle_offset];
-					tri.V0 = *src_triangles++;
-					tri.V1 = *src_triangles++;
-					tri.V2 = *src_triangles++;
-				}
+					//the hierarchy starts from the lod 0 meshlets and appends every simplified level after them
+					auto GetMeshletIndices = [&](Uint32 meshlet_index)
+					{
+						Meshlet const& meshlet = mesh_data.meshlets[meshlet_index];
+						std::vector<Uint32> indices(meshlet.triangle_count * 3);
+						for (Uint32 k = 0; k < indices.size(); ++k)
+						{
+							indices[k] = mesh_data.meshlet_vertices[meshlet.vertex_offset + mesh_data.meshlet_triangles[meshlet.triangle_offset + k]];
+						}
+						return indices;
+					};
+					auto AddClusterLOD = [&](std::vector<Uint32> const& indices, Vector4 const* group_bounds, Float error)
+					{
+						meshopt_Bounds const bounds = meshopt_computeClusterBounds(indices.data(), indices.size(), &mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3));
+						Vector4 const self_bounds = group_bounds ? *group_bounds : Vector4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius);
+						MeshletLOD& cluster_lod = mesh_data.cluster_lods.emplace_back();
+						std::memcpy(cluster_lod.self_bounds, &self_bounds, sizeof(cluster_lod.self_bounds));
+						std::memcpy(cluster_lod.parent_bounds, &self_bounds, sizeof(cluster_lod.parent_bounds));
+						cluster_lod.self_error = error;
+						cluster_lod.parent_error = FLT_MAX;
+					};
 
-				Meshlet& meshlet = mesh_data.meshlets[i];
-				std::memcpy(meshlet.center, meshopt_bounds.center, sizeof(Float) * 3);
+					Float const error_scale = meshopt_simplifyScale(&mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3));
+					std::vector<std::vector<Uint32>> cluster_indices;
+					std::vector<Uint32> pending_clusters;
+					for (Uint32 i = 0; i < base_lod.meshlet_count; ++i)
+					{
+						cluster_indices.push_back(GetMeshletIndices(i));
+						AddClusterLOD(cluster_indices.back(), nullptr, 0.0f);
+						pending_clusters.push_back(i);
+					}
 
-				meshlet.radius = meshopt_bounds.radius;
-				meshlet.vertex_count = m.vertex_count;
-				meshlet.triangle_count = m.triangle_count;
-				meshlet.vertex_offset = m.vertex_offset;
-				meshlet.triangle_offset = triangle_offset;
-				triangle_offset += m.triangle_count;
+					while (pending_clusters.size() > 1)
+					{
+						std::vector<Uint32> next_clusters;
+						for (std::vector<Uint32> const& group : GroupClusters(pending_clusters, cluster_indices, vertex_count))
+						{
+							if (group.size() == 1) continue;
+
+							std::vector<Uint32> merged_indices;
+							for (Uint32 cluster : group) merged_indices.insert(merged_indices.end(), cluster_indices[cluster].begin(), cluster_indices[cluster].end());
+
+							//locking the group border keeps the seams with neighbouring groups watertight
+							std::vector<Uint32> simplified_indices(merged_indices.size());
+							Float result_error = 0.0f;
+							Uint64 const index_count = meshopt_simplify(simplified_indices.data(), merged_indices.data(), merged_indices.size(), &mesh_data.positions_stream[0].x,
+								vertex_count, sizeof(Vector3), merged_indices.size() / 6 * 3, FLT_MAX, meshopt_SimplifyLockBorder, &result_error);
+							if (index_count == 0 || index_count > merged_indices.size() * LOD_MIN_REDUCTION) continue;
+							simplified_indices.resize(index_count);
+
+							std::vector<Vector4> child_bounds;
+							Float error = 0.0f;
+							for (Uint32 cluster : group)
+							{
+								MeshletLOD const& child = mesh_data.cluster_lods[cluster];
+								child_bounds.emplace_back(child.self_bounds[0], child.self_bounds[1], child.self_bounds[2], child.self_bounds[3]);
+								error = std::max(error, child.self_error);
+							}
+							error += result_error * error_scale;
+							Vector4 const group_bounds = MergeSpheres(child_bounds);
+							for (Uint32 cluster : group)
+							{
+								MeshletLOD& child = mesh_data.cluster_lods[cluster];
+								std::memcpy(child.parent_bounds, &group_bounds, sizeof(child.parent_bounds));
+								child.parent_error = error;
+							}
 
-			}
-			mesh_data.meshlet_triangles.resize(triangle_offset);
+							Uint32 const first_meshlet = (Uint32)mesh_data.meshlets.size();
+							Uint32 const meshlet_count = BuildMeshlets(simplified_indices);
+							for (Uint32 i = first_meshlet; i < first_meshlet + meshlet_count; ++i)
+							{
+								cluster_indices.push_back(GetMeshletIndices(i));
+								AddClusterLOD(cluster_indices.back(), &group_bounds, error);
+								next_clusters.push_back(i);
+							}
+						}
+						if (next_clusters.empty()) break;
+						pending_clusters = std::move(next_clusters);
+					}
+				}
+
+				if (mesh_data.topology == GfxPrimitiveTopology::TriangleList)
+				{
+					//each lod is simplified from the previous one, so the errors accumulate
+					Float const error_scale = meshopt_simplifyScale(&mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3));
+					Float lod_error = 0.0f;
+					std::vector<Uint32> lod_indices = mesh_data.indices;
+					while (mesh_data.lods.size() < SUBMESH_MAX_LODS)
+					{
+						Uint64 const target_index_count = (Uint64)(lod_indices.size() * LOD_TRIANGLE_RATIO) / 3 * 3;
+						if (target_index_count < 3) break;
+
+						std::vector<Uint32> simplified_indices(lod_indices.size());
+						Float result_error = 0.0f;
+						Uint64 const index_count = meshopt_simplify(simplified_indices.data(), lod_indices.data(), lod_indices.size(), &mesh_data.positions_stream[0].x,
+							vertex_count, sizeof(Vector3), target_index_count, LOD_MAX_ERROR, 0, &result_error);
+						if (index_count == 0 || index_count > lod_indices.size() * LOD_MIN_REDUCTION) break;
+
+						simplified_indices.resize(index_count);
+						meshopt_optimizeVertexCache(simplified_indices.data(), simplified_indices.data(), index_count, vertex_count);
+						lod_error += result_error * error_scale;
+
+						SubMeshLOD& lod = mesh_data.lods.emplace_back();
+						lod.first_index = (Uint32)mesh_data.indices.size();
+						lod.index_count = (Uint32)index_count;
+						lod.first_meshlet = (Uint32)mesh_data.meshlets.size();
+						lod.meshlet_count = BuildMeshlets(simplified_indices);
+						lod.error = lod_error;
+
+						mesh_data.indices.insert(mesh_data.indices.end(), simplified_indices.begin(), simplified_indices.end());
+						lod_indices = std::move(simplified_indices);
+					}
+				}
 
+				if (params.compact_vertices && !mesh_data.IsDeformable())
+				{
+					//flat submeshes still need an invertible dequantization for the ray tracing instance transform
+					Vector3 extents(mesh_data.bounding_box.Extents);
+					extents = Vector3::Max(extents, Vector3(1e-4f, 1e-4f, 1e-4f));
+					mesh_data.bounding_box.Extents = extents;
+					Vector3 const center(mesh_data.bounding_box.Center);
+
+					mesh_data.compact_positions_stream.reserve(mesh_data.positions_stream.size());
+					for (Vector3 const& position : mesh_data.positions_stream)
+					{
+						Vector3 const q = (position - center) / extents;
+						mesh_data.compact_positions_stream.push_back((Uint64)(Uint16)PackSnorm16(q.x) | ((Uint64)(Uint16)PackSnorm16(q.y) << 16) |
+																	 ((Uint64)(Uint16)PackSnorm16(q.z) << 32));
+					}
+					mesh_data.compact_normals_stream.reserve(mesh_data.normals_stream.size());
+					for (Vector3 const& normal : mesh_data.normals_stream) mesh_data.compact_normals_stream.push_back(PackOctahedralNormal(normal));
+					mesh_data.compact_tangents_stream.reserve(mesh_data.tangents_stream.size());
+					for (Vector4 const& tangent : mesh_data.tangents_stream) mesh_data.compact_tangents_stream.push_back(PackOctahedralTangent(tangent));
+					mesh_data.compact_uvs_stream.reserve(mesh_data.uvs_stream.size());
+					for (Vector2 const& uv : mesh_data.uvs_stream) mesh_data.compact_uvs_stream.push_back(PackTwoFloatsToUint32(uv.x, uv.y));
+				}
+			}));
+		}
+		for (std::future<void>& mesh_task : mesh_tasks) mesh_task.get();
+
+		Uint64 total_buffer_size = 0;
+		for (MeshData const& mesh_data : mesh_datas)
+		{
 			total_buffer_size += Align(mesh_data.indices.size() * sizeof(Uint32), 16);
-			total_buffer_size += Align(mesh_data.positions_stream.size() * sizeof(Vector3), 16);
-			total_buffer_size += Align(mesh_data.uvs_stream.size() * sizeof(Vector2), 16);
-			total_buffer_size += Align(mesh_data.normals_stream.size() * sizeof(Vector3), 16);
-			total_buffer_size += Align(mesh_data.tangents_stream.size() * sizeof(Vector4), 16);
+			if (params.compact_vertices && !mesh_data.IsDeformable())
+			{
+				total_buffer_size += Align(mesh_data.compact_positions_stream.size() * sizeof(Uint64), 16);
+				total_buffer_size += Align(mesh_data.compact_uvs_stream.size() * sizeof(Uint32), 16);
+				total_buffer_size += Align(mesh_data.compact_normals_stream.size() * sizeof(Uint32), 16);
+				total_buffer_size += Align(mesh_data.compact_tangents_stream.size() * sizeof(Uint32), 16);
+			}
+			else
+			{
+				total_buffer_size += Align(mesh_data.positions_stream.size() * sizeof(Vector3), 16);
+				total_buffer_size += Align(mesh_data.uvs_stream.size() * sizeof(Vector2), 16);
+				total_buffer_size += Align(mesh_data.normals_stream.size() * sizeof(Vector3), 16);
+				total_buffer_size += Align(mesh_data.tangents_stream.size() * sizeof(Vector4), 16);
+			}
 			total_buffer_size += Align(mesh_data.meshlets.size() * sizeof(Meshlet), 16);
 			total_buffer_size += Align(mesh_data.meshlet_vertices.size() * sizeof(Uint32), 16);
-			total_buffer_size += Align(mesh_data.meshlet_triangles.size() * sizeof(MeshletTriangle), 16);
-
-			mesh_data.bounding_box = AABBFromPositions(mesh_data.positions_stream);
+			total_buffer_size += Align(mesh_data.meshlet_triangles.size() * sizeof(Uint8), 16);
+			total_buffer_size += Align(mesh_data.cluster_lods.size() * sizeof(MeshletLOD), 16);
+			total_buffer_size += Align(mesh_data.joints_stream.size() * sizeof(std::array<Uint16, 4>), 16);
+			total_buffer_size += Align(mesh_data.weights_stream.size() * sizeof(Vector4), 16);
+			total_buffer_size += Align(mesh_data.morph_targets.size() * sizeof(MorphTargetVertex), 16);
 		}
 
-		GfxDynamicAllocation staging_buffer = gfx->GetDynamicAllocator()->Allocate(total_buffer_size, 16);
-
+		cooked_model.geometry.resize(total_buffer_size);
 		Uint32 current_offset = 0;
-		auto CopyData = [&staging_buffer, &current_offset]<typename T>(std::vector<T> const& _data)
+		auto CopyData = [&cooked_model, &current_offset]<typename T>(std::vector<T> const& _data)
 		{
 			Uint64 current_copy_size = _data.size() * sizeof(T);
-			staging_buffer.Update(_data.data(), current_copy_size, current_offset);
+			if (current_copy_size > 0) memcpy(cooked_model.geometry.data() + current_offset, _data.data(), current_copy_size);
 			current_offset += (Uint32)Align(current_copy_size, 16);
 		};
 
-		mesh.submeshes.reserve(mesh_datas.size());
+		cooked_model.submeshes.reserve(mesh_datas.size());
 		for (Uint64 i = 0; i < mesh_datas.size(); ++i)
 		{
 			auto const& mesh_data = mesh_datas[i];
 
-			SubMeshGPU& submesh = mesh.submeshes.emplace_back();
+			SubMeshGPU& submesh = cooked_model.submeshes.emplace_back();
+			submesh.buffer_address = 0;
+			submesh.buffer_size = 0;
 
 			submesh.indices_offset = current_offset;
-			submesh.indices_count = (Uint32)mesh_data.indices.size();
+			submesh.indices_count = mesh_data.lods[0].index_count;
 			CopyData(mesh_data.indices);
 
 			submesh.vertices_count = (Uint32)mesh_data.positions_stream.size();
-			submesh.positions_offset = current_offset;
-			CopyData(mesh_data.positions_stream);
+			Bool const compact_vertices = params.compact_vertices && !mesh_data.IsDeformable();
+			submesh.vertex_layout = compact_vertices ? VertexLayout::Compact : VertexLayout::Full;
+			if (compact_vertices)
+			{
+				submesh.positions_offset = current_offset;
+				CopyData(mesh_data.compact_positions_stream);
+
+				submesh.uvs_offset = current_offset;
+				CopyData(mesh_data.compact_uvs_stream);
+
+				submesh.normals_offset = current_offset;
+				CopyData(mesh_data.compact_normals_stream);
+
+				submesh.tangents_offset = current_offset;
+				CopyData(mesh_data.compact_tangents_stream);
+			}
+			else
+			{
+				submesh.positions_offset = current_offset;
+				CopyData(mesh_data.positions_stream);
 
-			submesh.uvs_offset = current_offset;
-			CopyData(mesh_data.uvs_stream);
+				submesh.uvs_offset = current_offset;
+				CopyData(mesh_data.uvs_stream);
 
-			submesh.normals_offset = current_offset;
-			CopyData(mesh_data.normals_stream);
+				submesh.normals_offset = current_offset;
+				CopyData(mesh_data.normals_stream);
 
-			submesh.tangents_offset = current_offset;
-			CopyData(mesh_data.tangents_stream);
+				submesh.tangents_offset = current_offset;
+				CopyData(mesh_data.tangents_stream);
+			}
 
 			submesh.meshlet_offset = current_offset;
 			CopyData(mesh_data.meshlets);
@@ -845,13 +1375,34 @@ namespace adria
 			submesh.meshlet_triangles_offset = current_offset;
 			CopyData(mesh_data.meshlet_triangles);
 
-			submesh.meshlet_count = (Uint32)mesh_data.meshlets.size();
+			submesh.cluster_lods_offset = current_offset;
+			CopyData(mesh_data.cluster_lods);
+
+			submesh.skinned = mesh_data.IsSkinned();
+			submesh.joints_offset = current_offset;
+			CopyData(mesh_data.joints_stream);
+
+			submesh.weights_offset = current_offset;
+			CopyData(mesh_data.weights_stream);
+
+			submesh.morph_targets_offset = current_offset;
+			submesh.morph_target_count = mesh_data.morph_target_count;
+			CopyData(mesh_data.morph_targets);
+
+			submesh.meshlet_count = mesh_data.lods[0].meshlet_count;
+			submesh.cluster_count = (Uint32)mesh_data.cluster_lods.size();
+			submesh.lod_count = (Uint32)mesh_data.lods.size();
+			std::copy(mesh_data.lods.begin(), mesh_data.lods.end(), submesh.lods);
 
 			submesh.bounding_box = mesh_data.bounding_box;
 			submesh.topology = mesh_data.topology;
 			submesh.material_index = mesh_data.material_index;
 		}
-		mesh.geometry_buffer_handle = g_GeometryBufferCache.CreateAndInitializeGeometryBuffer(staging_buffer.buffer, total_buffer_size, staging_buffer.offset);
+
+		Bool const has_skeleton = gltf_data->skins_count > 0 || gltf_data->animations_count > 0 ||
+			std::any_of(mesh_datas.begin(), mesh_datas.end(), [](MeshData const& mesh_data) { return mesh_data.morph_target_count > 0; });
+		std::vector<Uint32> node_order(gltf_data->nodes_count, UINT32_MAX);
+		if (has_skeleton) CookSkeleton(gltf_data, node_order, cooked_model);
 
 		for (Uint64 i = 0; i < gltf_data->nodes_count; ++i)
 		{
@@ -862,51 +1413,292 @@ namespace adria
 
 			if (gltf_node.mesh)
 			{
+				std::vector<Matrix> const instance_transforms = GetNodeInstanceTransforms(gltf_node);
 				for (Int32 primitive : mesh_primitives_map[gltf_node.mesh])
 				{
-					SubMeshInstance& instance = mesh.instances.emplace_back();
-					instance.submesh_index = primitive;
-					instance.world_transform = local_to_world * params.model_matrix;
-					instance.parent = mesh_entity;
+					//skinned vertices are placed by the joints alone, the transform of the mesh node does not apply to them
+					Bool const skinned = gltf_node.skin && mesh_datas[primitive].IsSkinned();
+					Uint32 const skin_index = skinned ? (Uint32)(gltf_node.skin - gltf_data->skins) : UINT32_MAX;
+					if (skinned)
+					{
+						cooked_model.instances.push_back(CookedModelInstance{ Matrix::Identity, (Uint32)primitive, node_order[i], skin_index });
+						continue;
+					}
+					for (Matrix const& instance_transform : instance_transforms)
+					{
+						cooked_model.instances.push_back(CookedModelInstance{ instance_transform * local_to_world, (Uint32)primitive, node_order[i], skin_index });
+					}
 				}
 			}
 
-			if (params.load_model_lights && gltf_node.light)
+			if (gltf_node.light)
 			{
 				cgltf_light const& gltf_light = *gltf_node.light;
-			
+				CookedModelLight& light = cooked_model.lights.emplace_back();
+				light.local_to_world = local_to_world;
+				light.color[0] = gltf_light.color[0];
+				light.color[1] = gltf_light.color[1];
+				light.color[2] = gltf_light.color[2];
+				light.intensity = gltf_light.intensity;
+				light.inner_cone_angle = gltf_light.spot_inner_cone_angle;
+				light.outer_cone_angle = gltf_light.spot_outer_cone_angle;
+				light.range = gltf_light.range;
+				switch (gltf_light.type)
+				{
+				case cgltf_light_type_directional: light.type = LightType::Directional; break;
+				case cgltf_light_type_spot:		   light.type = LightType::Spot; break;
+				default:						   light.type = LightType::Point; break;
+				}
+			}
+		}
+
+		//instances of a primitive get consecutive instance ids, which lets the renderer draw them instanced
+		std::stable_sort(cooked_model.instances.begin(), cooked_model.instances.end(),
+			[](CookedModelInstance const& lhs, CookedModelInstance const& rhs) { return lhs.submesh_index < rhs.submesh_index; });
+
+		cgltf_free(gltf_data);
+		return true;
+	}
+
+	void SceneLoader::CookSkeleton(cgltf_data const* gltf_data, std::vector<Uint32>& node_order, CookedModel& cooked_model)
+	{
+		//nodes are ordered breadth first, so a single pass over them resolves the hierarchy
+		std::vector<cgltf_node const*> ordered_nodes;
+		ordered_nodes.reserve(gltf_data->nodes_count);
+		for (Uint64 i = 0; i < gltf_data->nodes_count; ++i)
+		{
+			if (!gltf_data->nodes[i].parent) ordered_nodes.push_back(&gltf_data->nodes[i]);
+		}
+		for (Uint64 i = 0; i < ordered_nodes.size(); ++i)
+		{
+			cgltf_node const* gltf_node = ordered_nodes[i];
+			node_order[gltf_node - gltf_data->nodes] = (Uint32)i;
+			for (Uint64 j = 0; j < gltf_node->children_count; ++j) ordered_nodes.push_back(gltf_node->children[j]);
+		}
+
+		cooked_model.nodes.reserve(ordered_nodes.size());
+		for (cgltf_node const* gltf_node : ordered_nodes)
+		{
+			Matrix local_transform;
+			cgltf_node_transform_local(gltf_node, &local_transform.m[0][0]);
+
+			SkeletonNode& node = cooked_model.nodes.emplace_back();
+			local_transform.Decompose(node.scale, node.rotation, node.translation);
+			node.parent = gltf_node->parent ? (Int32)node_order[gltf_node->parent - gltf_data->nodes] : -1;
+
+			Uint64 weight_count = gltf_node->weights_count;
+			Float const* weights = gltf_node->weights;
+			if (weight_count == 0 && gltf_node->mesh)
+			{
+				weight_count = gltf_node->mesh->weights_count;
+				weights = gltf_node->mesh->weights;
+			}
+			node.first_morph_weight = (Uint32)cooked_model.morph_weights.size();
+			node.morph_weight_count = (Uint32)weight_count;
+			if (weight_count > 0) cooked_model.morph_weights.insert(cooked_model.morph_weights.end(), weights, weights + weight_count);
+		}
+
+		for (Uint64 i = 0; i < gltf_data->skins_count; ++i)
+		{
+			cgltf_skin const& gltf_skin = gltf_data->skins[i];
+			SkeletonSkin& skin = cooked_model.skins.emplace_back();
+			skin.first_joint = (Uint32)cooked_model.skin_joints.size();
+			skin.joint_count = (Uint32)gltf_skin.joints_count;
+			for (Uint64 j = 0; j < gltf_skin.joints_count; ++j)
+			{
+				cooked_model.skin_joints.push_back(node_order[gltf_skin.joints[j] - gltf_data->nodes]);
+				Matrix& inverse_bind_matrix = cooked_model.inverse_bind_matrices.emplace_back();
+				if (gltf_skin.inverse_bind_matrices) cgltf_accessor_read_float(gltf_skin.inverse_bind_matrices, j, &inverse_bind_matrix.m[0][0], 16);
+			}
+		}
+
+		for (Uint64 i = 0; i < gltf_data->animations_count; ++i)
+		{
+			cgltf_animation const& gltf_animation = gltf_data->animations[i];
+			AnimationClip& clip = cooked_model.clips.emplace_back();
+			clip.first_channel = (Uint32)cooked_model.channels.size();
+			clip.duration = 0.0f;
+			for (Uint64 j = 0; j < gltf_animation.channels_count; ++j)
+			{
+				cgltf_animation_channel const& gltf_channel = gltf_animation.channels[j];
+				cgltf_animation_sampler const& gltf_sampler = *gltf_channel.sampler;
+				Uint64 const key_count = gltf_sampler.input->count;
+				if (!gltf_channel.target_node || key_count == 0) continue;
+
+				//cubic spline keys store in tangent, value and out tangent, only the values are kept and interpolated linearly
+				Bool const cubic_spline = gltf_sampler.interpolation == cgltf_interpolation_type_cubic_spline;
+				Uint64 const values_per_key = cubic_spline ? 3 : 1;
+
+				AnimationChannel channel{};
+				channel.node = node_order[gltf_channel.target_node - gltf_data->nodes];
+				channel.interpolation = gltf_sampler.interpolation == cgltf_interpolation_type_step ? AnimationInterpolation::Step : AnimationInterpolation::Linear;
+				switch (gltf_channel.target_path)
+				{
+				case cgltf_animation_path_type_translation: channel.path = AnimationPath::Translation;	channel.value_stride = 3; break;
+				case cgltf_animation_path_type_rotation:	channel.path = AnimationPath::Rotation;		channel.value_stride = 4; break;
+				case cgltf_animation_path_type_scale:		channel.path = AnimationPath::Scale;		channel.value_stride = 3; break;
+				case cgltf_animation_path_type_weights:
+					channel.path = AnimationPath::MorphWeights;
+					channel.value_stride = (Uint32)(gltf_sampler.output->count / (key_count * values_per_key));
+					break;
+				default: continue;
+				}
+				if (channel.value_stride == 0) continue;
+
+				channel.first_key = (Uint32)cooked_model.key_times.size();
+				channel.key_count = (Uint32)key_count;
+				channel.first_value = (Uint32)cooked_model.key_values.size();
+				for (Uint64 k = 0; k < key_count; ++k)
+				{
+					Float time = 0.0f;
+					cgltf_accessor_read_float(gltf_sampler.input, k, &time, 1);
+					cooked_model.key_times.push_back(time);
+					clip.duration = std::max(clip.duration, time);
+
+					Uint64 const value_index = k * values_per_key + (cubic_spline ? 1 : 0);
+					if (channel.path == AnimationPath::MorphWeights)
+					{
+						for (Uint32 w = 0; w < channel.value_stride; ++w)
+						{
+							Float weight = 0.0f;
+							cgltf_accessor_read_float(gltf_sampler.output, value_index * channel.value_stride + w, &weight, 1);
+							cooked_model.key_values.push_back(weight);
+						}
+					}
+					else
+					{
+						Float value[4] = {};
+						cgltf_accessor_read_float(gltf_sampler.output, value_index, value, channel.value_stride);
+						cooked_model.key_values.insert(cooked_model.key_values.end(), value, value + channel.value_stride);
+					}
+				}
+				cooked_model.channels.push_back(channel);
+			}
+			clip.channel_count = (Uint32)cooked_model.channels.size() - clip.first_channel;
+		}
+	}
+
+	entt::entity SceneLoader::CreateModel(ModelParameters const& params, CookedModel const& cooked_model, std::span<Uint8 const> geometry)
+	{
+		MemoryTagScope memory_scope(MemoryTag::SceneLoader);
+		std::string model_name = GetFilename(params.model_path);
+		entt::entity mesh_entity = reg.create();
+		Mesh mesh{};
+
+		mesh.materials = cooked_model.materials;
+
+		//materials share most of their textures, so the unique set of the model is loaded as one batch
+		std::vector<TextureLoadDesc> texture_descs;
+		std::unordered_map<std::string, Uint32> texture_indices;
+		std::vector<std::pair<TextureHandle*, Uint32>> material_texture_indices;
+		for (Uint64 i = 0; i < mesh.materials.size(); ++i)
+		{
+			for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+			{
+				std::string const& texture = cooked_model.material_textures[i][slot];
+				if (texture.empty()) continue;
+				MaterialTextureSlot const texture_slot = (MaterialTextureSlot)slot;
+				auto [it, inserted] = texture_indices.try_emplace(texture, (Uint32)texture_descs.size());
+				if (inserted)
+				{
+					texture_descs.push_back(TextureLoadDesc{ .path = params.textures_path + texture, .srgb = IsMaterialTextureSlotSRGB(texture_slot), .cook_mode = GetMaterialTextureCookMode(texture_slot) });
+				}
+				material_texture_indices.emplace_back(&GetMaterialTexture(mesh.materials[i], texture_slot), it->second);
+			}
+		}
+		std::vector<TextureHandle> texture_handles(texture_descs.size(), INVALID_TEXTURE_HANDLE);
+		g_TextureManager.LoadTextures(texture_descs, texture_handles);
+		for (auto const& [material_texture, texture_index] : material_texture_indices) *material_texture = texture_handles[texture_index];
+		mesh.submeshes = cooked_model.submeshes;
+		mesh.opacity_micromaps = cooked_model.opacity_micromaps;
+
+		Uint64 const total_buffer_size = cooked_model.GetGeometrySize();
+		if (!geometry.empty())
+		{
+			ADRIA_ASSERT(geometry.size() == total_buffer_size);
+			mesh.geometry_buffer_handle = g_GeometryBufferCache.CreateAndUploadGeometryBuffer(geometry.data(), total_buffer_size);
+		}
+		else
+		{
+			GfxDynamicAllocation staging_buffer{};
+			Bool geometry_read = false;
+			if (cooked_model.CanReadGeometry())
+			{
+				staging_buffer = gfx->GetDynamicAllocator()->Allocate(Align(total_buffer_size, COOKED_MODEL_GEOMETRY_ALIGNMENT), COOKED_MODEL_GEOMETRY_ALIGNMENT);
+				geometry_read = cooked_model.ReadGeometry(staging_buffer.cpu_address);
+			}
+			else
+			{
+				staging_buffer = gfx->GetDynamicAllocator()->Allocate(total_buffer_size, 16);
+			}
+			if (!geometry_read) staging_buffer.Update(cooked_model.GetGeometryData(), total_buffer_size);
+			mesh.geometry_buffer_handle = g_GeometryBufferCache.CreateAndInitializeGeometryBuffer(staging_buffer.buffer, total_buffer_size, staging_buffer.offset);
+		}
+
+		Uint32 const geometry_offset = (Uint32)g_GeometryBufferCache.GetGeometryBufferOffset(mesh.geometry_buffer_handle);
+		for (SubMeshGPU& submesh : mesh.submeshes)
+		{
+			submesh.indices_offset += geometry_offset;
+			submesh.positions_offset += geometry_offset;
+			submesh.uvs_offset += geometry_offset;
+			submesh.normals_offset += geometry_offset;
+			submesh.tangents_offset += geometry_offset;
+			submesh.meshlet_offset += geometry_offset;
+			submesh.meshlet_vertices_offset += geometry_offset;
+			submesh.meshlet_triangles_offset += geometry_offset;
+			submesh.cluster_lods_offset += geometry_offset;
+			submesh.joints_offset += geometry_offset;
+			submesh.weights_offset += geometry_offset;
+			submesh.morph_targets_offset += geometry_offset;
+		}
+
+		mesh.instances.reserve(cooked_model.instances.size());
+		for (CookedModelInstance const& cooked_instance : cooked_model.instances)
+		{
+			SubMeshInstance& instance = mesh.instances.emplace_back();
+			instance.submesh_index = cooked_instance.submesh_index;
+			instance.local_transform = cooked_instance.local_to_world;
+			instance.world_transform = cooked_instance.local_to_world * params.model_matrix;
+			instance.parent = mesh_entity;
+			instance.node_index = cooked_instance.node_index;
+			instance.skin_index = cooked_instance.skin_index;
+		}
+
+		if (params.load_model_lights)
+		{
+			for (CookedModelLight const& cooked_light : cooked_model.lights)
+			{
 				Vector3 translation, scale;
 				Quaternion rotation;
+				Matrix local_to_world = cooked_light.local_to_world;
 				local_to_world.Decompose(scale, rotation,translation);
 
 				LightParameters light_params{};
 				light_params.mesh_size = 150;
 				light_params.mesh_type = LightMesh::NoMesh;
-				light_params.light_data.color.x = gltf_light.color[0];
-				light_params.light_data.color.y = gltf_light.color[1];
-				light_params.light_data.color.z = gltf_light.color[2];
-				light_params.light_data.intensity = gltf_light.intensity;
-				light_params.light_data.inner_cosine = cos(gltf_light.spot_inner_cone_angle);
-				light_params.light_data.outer_cosine = cos(gltf_light.spot_outer_cone_angle);
-				light_params.light_data.range = gltf_light.range > 0 ? gltf_light.range : FLT_MAX;
+				light_params.light_data.color.x = cooked_light.color[0];
+				light_params.light_data.color.y = cooked_light.color[1];
+				light_params.light_data.color.z = cooked_light.color[2];
+				light_params.light_data.intensity = cooked_light.intensity;
+				light_params.light_data.inner_cosine = cos(cooked_light.inner_cone_angle);
+				light_params.light_data.outer_cosine = cos(cooked_light.outer_cone_angle);
+				light_params.light_data.range = cooked_light.range > 0 ? cooked_light.range : FLT_MAX;
 				light_params.light_data.position = Vector4(translation.x, translation.y, translation.z, 1.0f);
 				Vector3 forward(0.0f, 0.0f, -1.0f);
 				Vector3 direction = Vector3::Transform(forward, Matrix::CreateFromQuaternion(rotation));
 				light_params.light_data.direction = Vector4(direction.x, direction.y, direction.z, 0.0f);
+				light_params.light_data.type = cooked_light.type;
 
-				switch (gltf_light.type)
+				switch (cooked_light.type)
 				{
-				case cgltf_light_type_directional: 
-					light_params.light_data.type = LightType::Directional;
+				case LightType::Directional:
 					light_params.light_data.casts_shadows = true;
 					light_params.light_data.use_cascades = true;
 					break;
-				case cgltf_light_type_point:	   
-					light_params.light_data.type = LightType::Point;
+				case LightType::Point:
 					light_params.light_data.intensity /= 10;
 					break;
-				case cgltf_light_type_spot:		   
-					light_params.light_data.type = LightType::Spot;
+				case LightType::Spot:
 					light_params.light_data.intensity /= 100;
 					break;
 				}
@@ -921,12 +1713,27 @@ namespace adria
 		}
 
 		reg.emplace<Mesh>(mesh_entity, mesh);
+		if (!cooked_model.nodes.empty())
+		{
+			Skeleton& skeleton = reg.emplace<Skeleton>(mesh_entity);
+			skeleton.nodes = cooked_model.nodes;
+			skeleton.skins = cooked_model.skins;
+			skeleton.skin_joints = cooked_model.skin_joints;
+			skeleton.inverse_bind_matrices = cooked_model.inverse_bind_matrices;
+			skeleton.morph_weights = cooked_model.morph_weights;
+			skeleton.clips = cooked_model.clips;
+			skeleton.channels = cooked_model.channels;
+			skeleton.key_times = cooked_model.key_times;
+			skeleton.key_values = cooked_model.key_values;
+		}
+		reg.emplace<ModelSource>(mesh_entity, params.model_path, params.textures_path, params.triangle_ccw, params.force_mask_alpha_usage, params.compact_vertices, params.cluster_lod);
+		reg.emplace<LocalTransform>(mesh_entity, params.model_matrix);
+		reg.emplace<WorldTransform>(mesh_entity, params.model_matrix);
 		reg.emplace<Tag>(mesh_entity, model_name + " mesh");
 
 		if (gfx->GetCapabilities().SupportsRayTracing()) reg.emplace<RayTracing>(mesh_entity);
 
 		ADRIA_LOG(INFO, "GLTF Model %s successfully loaded!", params.model_path.c_str());
-		cgltf_free(gltf_data);
 		return mesh_entity;
 	}
 }
\ No newline at end of file
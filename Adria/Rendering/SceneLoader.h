@@ -8,6 +8,8 @@
 #include "Utilities/Heightmap.h"
 #include "entt/entity/registry.hpp"
 
+struct cgltf_data;
+
 namespace adria
 {
 	enum class LightMesh
@@ -25,6 +27,8 @@ namespace adria
 		Bool triangle_ccw = true;
 		Bool force_mask_alpha_usage = false;
 		Bool load_model_lights = false;
+		Bool compact_vertices = false;
+		Bool cluster_lod = false;
     };
     struct SkyboxParameters
     {
@@ -49,6 +53,22 @@ namespace adria
 	{
 		GridParameters ocean_grid;
 	};
+	struct TerrainLayerParameters
+	{
+		std::string albedo_texture_path;
+		Vector3 albedo_color = Vector3(1.0f);
+		Float tiling = 0.25f;
+		Vector2 height_range = Vector2(0.0f, 1.0f);
+		Vector2 slope_range = Vector2(0.0f, 1.0f);
+	};
+	struct TerrainParameters
+	{
+		std::unique_ptr<Heightmap> heightmap;
+		Vector3 origin = Vector3::Zero;
+		Float texel_size = 1.0f;
+		Float height_scale = 1.0f;
+		std::vector<TerrainLayerParameters> layers;
+	};
 
     struct LightParameters
     {
@@ -70,6 +90,18 @@ namespace adria
 	};
 
     class GfxDevice;
+	class CookedModel;
+
+	//cpu side of a model load, it's prepared on a background thread and turned into entities on the main one
+	struct PreparedModel
+	{
+		PreparedModel();
+		~PreparedModel();
+
+		ModelParameters params;
+		std::unique_ptr<CookedModel> cooked_model;
+		std::vector<Uint8> geometry;
+	};
  
 	class SceneLoader
 	{
@@ -83,11 +115,22 @@ namespace adria
 		ADRIA_MAYBE_UNUSED entt::entity LoadSkybox(SkyboxParameters const&);
         ADRIA_MAYBE_UNUSED entt::entity LoadLight(LightParameters const&);
 		ADRIA_MAYBE_UNUSED std::vector<entt::entity> LoadOcean(OceanParameters const&);
+		ADRIA_MAYBE_UNUSED entt::entity LoadTerrain(TerrainParameters&&);
 		ADRIA_MAYBE_UNUSED entt::entity LoadDecal(DecalParameters const&);
 		ADRIA_MAYBE_UNUSED entt::entity LoadModel_GLTF(ModelParameters const&);
+		//touches neither the registry nor the device so it can run on any thread
+		ADRIA_NODISCARD std::unique_ptr<PreparedModel> PrepareModel_GLTF(ModelParameters const&);
+		ADRIA_MAYBE_UNUSED entt::entity CreatePreparedModel(PreparedModel const&);
 	private:
         entt::registry& reg;
         GfxDevice* gfx;
+
+	private:
+		Bool LoadOrCookModel_GLTF(ModelParameters const&, CookedModel&);
+		Bool CookModel_GLTF(ModelParameters const&, CookedModel&);
+		void BakeOpacityMicromaps(ModelParameters const&, CookedModel&);
+		entt::entity CreateModel(ModelParameters const&, CookedModel const&, std::span<Uint8 const> geometry = {});
+		void CookSkeleton(cgltf_data const*, std::vector<Uint32>& node_order, CookedModel&);
 	};
 }
 
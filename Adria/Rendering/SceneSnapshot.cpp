@@ -0,0 +1,271 @@
+#include <unordered_set>
+#include "cereal/types/array.hpp"
+#include "cereal/types/utility.hpp"
+#include "SceneSnapshot.h"
+#include "SceneLoader.h"
+#include "Components.h"
+#include "TextureManager.h"
+#include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
+#include "Logging/Logger.h"
+#include "Utilities/FilesUtil.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Uint32 SNAPSHOT_MAGIC = 0x53534441; //ADSS
+		//bump whenever a serialized record or a raw component changes
+		constexpr Uint32 SNAPSHOT_VERSION = 1;
+		constexpr Char const* SNAPSHOT_EXTENSION = ".snapshot";
+
+		SnapshotTexture CaptureTexture(TextureHandle handle)
+		{
+			SnapshotTexture texture{};
+			TextureLoadDesc desc{};
+			if (handle != INVALID_TEXTURE_HANDLE && g_TextureManager.GetLoadDesc(handle, desc))
+			{
+				texture.path = desc.path;
+				texture.srgb = desc.srgb;
+				texture.cook_mode = desc.cook_mode;
+			}
+			return texture;
+		}
+
+		//handles of the built-in textures stay valid across scenes, every other texture is loaded again by its path
+		TextureHandle RestoreTexture(SnapshotTexture const& texture, TextureHandle saved_handle)
+		{
+			if (!texture.path.empty()) return g_TextureManager.LoadTexture(texture.path, texture.srgb, texture.cook_mode);
+			if (saved_handle != INVALID_TEXTURE_HANDLE && GetTextureIndex(saved_handle) < TEXTURE_MANAGER_START_HANDLE) return saved_handle;
+			return INVALID_TEXTURE_HANDLE;
+		}
+	}
+
+	template<typename Archive, typename T>
+	void SerializeRaw(Archive& archive, T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		archive(cereal::binary_data(&value, sizeof(T)));
+	}
+
+	template<typename Archive>
+	void serialize(Archive& archive, SnapshotTexture& texture)
+	{
+		archive(texture.path, texture.srgb, texture.cook_mode);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SnapshotMaterial& material)
+	{
+		SerializeRaw(archive, material.material);
+		archive(material.textures);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, ModelSource& source)
+	{
+		archive(source.model_path, source.textures_path, source.triangle_ccw, source.force_mask_alpha_usage, source.compact_vertices, source.cluster_lod);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SnapshotModel& model)
+	{
+		archive(model.source, model.tag);
+		SerializeRaw(archive, model.local_transform);
+		archive(model.materials);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SnapshotLight& light)
+	{
+		SerializeRaw(archive, light.light);
+		archive(light.tag);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SnapshotDecal& decal)
+	{
+		SerializeRaw(archive, decal.decal);
+		archive(decal.albedo_texture, decal.normal_texture, decal.tag);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, ModelParameters& params)
+	{
+		archive(params.model_path, params.textures_path);
+		SerializeRaw(archive, params.model_matrix);
+		archive(params.triangle_ccw, params.force_mask_alpha_usage, params.load_model_lights, params.compact_vertices, params.cluster_lod);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SceneCell& cell)
+	{
+		archive(cell.x, cell.z, cell.models);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SceneStreamingParameters& streaming)
+	{
+		archive(streaming.cell_size, streaming.load_radius, streaming.unload_radius, streaming.cells);
+	}
+	template<typename Archive>
+	void serialize(Archive& archive, SceneSnapshot& snapshot)
+	{
+		archive(snapshot.scene_hash);
+		SerializeRaw(archive, snapshot.camera_params);
+		archive(snapshot.skybox_texture, snapshot.models, snapshot.lights, snapshot.decals, snapshot.streaming, snapshot.cvars);
+	}
+
+	void CaptureSceneSnapshot(entt::registry& reg, Camera const& camera, Uint64 scene_hash, SceneStreamingParameters const& streaming,
+		std::span<entt::entity const> streamed_entities, SceneSnapshot& snapshot)
+	{
+		snapshot = SceneSnapshot{};
+		snapshot.scene_hash = scene_hash;
+		snapshot.camera_params = CameraParameters{ camera.Near(), camera.Far(), camera.Fov(), camera.Position(), camera.Position() + camera.Forward() };
+		snapshot.streaming = streaming;
+
+		for (auto&& [entity, skybox] : reg.view<Skybox>().each())
+		{
+			if (skybox.active) snapshot.skybox_texture = CaptureTexture(skybox.cubemap_texture);
+		}
+
+		std::unordered_set<entt::entity> const streamed(streamed_entities.begin(), streamed_entities.end());
+		for (auto&& [entity, source, mesh] : reg.view<ModelSource, Mesh>().each())
+		{
+			if (streamed.contains(entity)) continue;
+			SnapshotModel& model = snapshot.models.emplace_back();
+			model.source = source;
+			if (Tag const* tag = reg.try_get<Tag>(entity)) model.tag = tag->name;
+			if (LocalTransform const* local_transform = reg.try_get<LocalTransform>(entity)) model.local_transform = local_transform->transform;
+			for (Material& material : mesh.materials)
+			{
+				SnapshotMaterial& snapshot_material = model.materials.emplace_back();
+				snapshot_material.material = material;
+				for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+				{
+					snapshot_material.textures[slot] = CaptureTexture(GetMaterialTexture(material, (MaterialTextureSlot)slot));
+				}
+			}
+		}
+
+		for (auto&& [entity, light] : reg.view<Light>().each())
+		{
+			SnapshotLight& snapshot_light = snapshot.lights.emplace_back();
+			snapshot_light.light = light;
+			//shadow resources are assigned again once the light is created
+			snapshot_light.light.shadow_texture_index = -1;
+			snapshot_light.light.shadow_matrix_index = -1;
+			snapshot_light.light.shadow_mask_index = -1;
+			snapshot_light.light.shadow_page_table_index = -1;
+			snapshot_light.light.light_index = 0;
+			if (Tag const* tag = reg.try_get<Tag>(entity)) snapshot_light.tag = tag->name;
+		}
+
+		for (auto&& [entity, decal] : reg.view<Decal>().each())
+		{
+			SnapshotDecal& snapshot_decal = snapshot.decals.emplace_back();
+			snapshot_decal.decal = decal;
+			snapshot_decal.albedo_texture = CaptureTexture(decal.albedo_decal_texture);
+			snapshot_decal.normal_texture = CaptureTexture(decal.normal_decal_texture);
+			if (Tag const* tag = reg.try_get<Tag>(entity)) snapshot_decal.tag = tag->name;
+		}
+
+		g_ConsoleManager.ForAllObjects(ConsoleObjectDelegate::CreateLambda([&snapshot](IConsoleObject* const object)
+			{
+				if (IConsoleVariable* cvar = object->AsVariable()) snapshot.cvars.emplace_back(object->GetName(), cvar->GetString());
+			}));
+		std::sort(snapshot.cvars.begin(), snapshot.cvars.end());
+	}
+
+	void RestoreSceneSnapshot(SceneSnapshot const& snapshot, entt::registry& reg, SceneLoader& scene_loader)
+	{
+		SkyboxParameters skybox_params{};
+		skybox_params.cubemap = snapshot.skybox_texture.path.empty() ? paths::TexturesDir + "Skybox/sunsetcube1024.dds" : snapshot.skybox_texture.path;
+		scene_loader.LoadSkybox(skybox_params);
+
+		for (SnapshotModel const& model : snapshot.models)
+		{
+			ModelSource const& source = model.source;
+			//lights of the model are part of the snapshot lights
+			ModelParameters const params{ source.model_path, source.textures_path, model.local_transform, source.triangle_ccw, source.force_mask_alpha_usage, false, source.compact_vertices, source.cluster_lod };
+			entt::entity const entity = scene_loader.LoadModel_GLTF(params);
+			if (entity == entt::null) continue;
+
+			Mesh& mesh = reg.get<Mesh>(entity);
+			if (mesh.materials.size() == model.materials.size())
+			{
+				for (Uint64 i = 0; i < mesh.materials.size(); ++i)
+				{
+					Material material = model.materials[i].material;
+					for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+					{
+						TextureHandle& texture = GetMaterialTexture(material, (MaterialTextureSlot)slot);
+						texture = RestoreTexture(model.materials[i].textures[slot], texture);
+					}
+					mesh.materials[i] = material;
+				}
+			}
+			else
+			{
+				ADRIA_LOG(WARNING, "Model %s changed since the snapshot was taken, its materials are not restored", source.model_path.c_str());
+			}
+			if (!model.tag.empty()) reg.get<Tag>(entity).name = model.tag;
+		}
+
+		for (SnapshotLight const& light : snapshot.lights)
+		{
+			entt::entity const entity = scene_loader.LoadLight(LightParameters{ .light_data = light.light });
+			if (!light.tag.empty()) reg.get<Tag>(entity).name = light.tag;
+		}
+
+		for (SnapshotDecal const& snapshot_decal : snapshot.decals)
+		{
+			Decal decal = snapshot_decal.decal;
+			decal.albedo_decal_texture = RestoreTexture(snapshot_decal.albedo_texture, decal.albedo_decal_texture);
+			decal.normal_decal_texture = RestoreTexture(snapshot_decal.normal_texture, decal.normal_decal_texture);
+
+			entt::entity const entity = reg.create();
+			reg.emplace<Decal>(entity, decal);
+			reg.emplace<Tag>(entity, snapshot_decal.tag.empty() ? "decal" : snapshot_decal.tag);
+		}
+	}
+
+	Bool SaveSceneSnapshot(std::string const& snapshot_file, SceneSnapshot const& snapshot)
+	{
+		std::ofstream os(snapshot_file, std::ios::binary);
+		if (!os)
+		{
+			ADRIA_LOG(WARNING, "Failed to write scene snapshot %s!", snapshot_file.c_str());
+			return false;
+		}
+		cereal::BinaryOutputArchive archive(os);
+		archive(SNAPSHOT_MAGIC, SNAPSHOT_VERSION, snapshot);
+		ADRIA_LOG(INFO, "Scene snapshot written to %s", snapshot_file.c_str());
+		return true;
+	}
+
+	Bool LoadSceneSnapshot(std::string const& snapshot_file, SceneSnapshot& snapshot)
+	{
+		std::ifstream is(snapshot_file, std::ios::binary);
+		if (!is)
+		{
+			ADRIA_LOG(WARNING, "Scene snapshot %s not found!", snapshot_file.c_str());
+			return false;
+		}
+		try
+		{
+			cereal::BinaryInputArchive archive(is);
+			Uint32 magic = 0, version = 0;
+			archive(magic, version);
+			if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION)
+			{
+				ADRIA_LOG(WARNING, "Scene snapshot %s is invalid or outdated!", snapshot_file.c_str());
+				return false;
+			}
+			archive(snapshot);
+		}
+		catch (cereal::Exception const& e)
+		{
+			ADRIA_LOG(WARNING, "Failed to read scene snapshot %s: %s", snapshot_file.c_str(), e.what());
+			return false;
+		}
+		return true;
+	}
+
+	Bool IsSceneSnapshotFile(std::string const& file)
+	{
+		return GetExtension(file) == SNAPSHOT_EXTENSION;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "SceneConfig.h"
+#include "CookedModel.h"
+
+namespace adria
+{
+	class SceneLoader;
+
+	struct SnapshotTexture
+	{
+		std::string path;
+		Bool srgb = false;
+		TextureCookMode cook_mode = TextureCookMode::None;
+	};
+	struct SnapshotMaterial
+	{
+		Material material;
+		std::array<SnapshotTexture, MaterialTextureSlot_Count> textures;
+	};
+	struct SnapshotModel
+	{
+		ModelSource source;
+		std::string tag;
+		Matrix local_transform;
+		std::vector<SnapshotMaterial> materials;
+	};
+	struct SnapshotLight
+	{
+		Light light;
+		std::string tag;
+	};
+	struct SnapshotDecal
+	{
+		Decal decal;
+		SnapshotTexture albedo_texture;
+		SnapshotTexture normal_texture;
+		std::string tag;
+	};
+
+	//binary copy of the loaded scene that restores with one sequential read instead of parsing the scene json and the gltf files.
+	//meshes are recreated from their cooked models, everything else is stored as it is in the registry with texture handles replaced by their paths
+	struct SceneSnapshot
+	{
+		Uint64 scene_hash = 0;
+		CameraParameters camera_params{};
+		SnapshotTexture skybox_texture;
+		std::vector<SnapshotModel> models;
+		std::vector<SnapshotLight> lights;
+		std::vector<SnapshotDecal> decals;
+		SceneStreamingParameters streaming;
+		std::vector<std::pair<std::string, std::string>> cvars;
+	};
+
+	//streamed entities are skipped, the streaming cells are stored instead
+	void CaptureSceneSnapshot(entt::registry& reg, Camera const& camera, Uint64 scene_hash, SceneStreamingParameters const& streaming,
+		std::span<entt::entity const> streamed_entities, SceneSnapshot& snapshot);
+	//creates the snapshot entities, the registry is expected to be empty and cvars have to be applied by the caller
+	void RestoreSceneSnapshot(SceneSnapshot const& snapshot, entt::registry& reg, SceneLoader& scene_loader);
+
+	Bool SaveSceneSnapshot(std::string const& snapshot_file, SceneSnapshot const& snapshot);
+	Bool LoadSceneSnapshot(std::string const& snapshot_file, SceneSnapshot& snapshot);
+	Bool IsSceneSnapshotFile(std::string const& file);
+}
@@ -0,0 +1,230 @@
+#include "SceneStreamer.h"
+#include "SceneLoader.h"
+#include "CookedModel.h"
+#include "Components.h"
+#include "TextureManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Logging/Logger.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> SceneStreaming("r.Streaming.Scene", true, "Load the cells of streamed models around the camera");
+	static TAutoConsoleVariable<Int> MaxCellsPerFrame("r.Streaming.MaxCellsPerFrame", 1, "Maximum number of prepared cells whose entities are created in one frame");
+
+	SceneStreamer::SceneStreamer(entt::registry& reg, GfxDevice* gfx, SceneLoader* scene_loader) : reg(reg), gfx(gfx), scene_loader(scene_loader)
+	{
+		stream_thread = std::thread(&SceneStreamer::StreamThread, this);
+	}
+
+	SceneStreamer::~SceneStreamer()
+	{
+		{
+			std::lock_guard lock(stream_mutex);
+			exit = true;
+			requests.clear();
+		}
+		stream_cv.notify_all();
+		if (stream_thread.joinable()) stream_thread.join();
+	}
+
+	void SceneStreamer::Initialize(SceneStreamingParameters const& params)
+	{
+		Clear();
+		cell_size = params.cell_size;
+		load_radius = params.load_radius;
+		unload_radius = params.unload_radius;
+		cells.reserve(params.cells.size());
+		for (SceneCell const& cell : params.cells) cells.push_back(Cell{ .desc = cell });
+		if (!cells.empty()) ADRIA_LOG(INFO, "Scene streaming: %llu cells of %.1f units", cells.size(), cell_size);
+	}
+
+	//the registry is cleared together with the scene, only the bookkeeping and the work of the background thread is dropped here
+	void SceneStreamer::Clear()
+	{
+		{
+			std::lock_guard lock(stream_mutex);
+			requests.clear();
+			prepared_cells.clear();
+		}
+		cells.clear();
+		retired_geometry.clear();
+	}
+
+	void SceneStreamer::Update(Vector3 const& camera_position)
+	{
+		Uint64 const frame_index = gfx->GetFrameIndex();
+		std::erase_if(retired_geometry, [frame_index](RetiredGeometry const& retired) { return retired.frame + GFX_BACKBUFFER_COUNT < frame_index; });
+		if (cells.empty()) return;
+
+		std::vector<PreparedCell> ready_cells;
+		{
+			std::lock_guard lock(stream_mutex);
+			Uint64 const ready_count = std::min<Uint64>(prepared_cells.size(), std::max(MaxCellsPerFrame.Get(), 1));
+			std::move(prepared_cells.begin(), prepared_cells.begin() + ready_count, std::back_inserter(ready_cells));
+			prepared_cells.erase(prepared_cells.begin(), prepared_cells.begin() + ready_count);
+		}
+		for (PreparedCell& prepared_cell : ready_cells)
+		{
+			if (prepared_cell.cell_index >= cells.size()) continue;
+			Cell& cell = cells[prepared_cell.cell_index];
+			//cells which went out of range while they were being prepared have a newer request id or none at all
+			if (cell.state != CellState::Loading || cell.request_id != prepared_cell.request_id) continue;
+			CreateCell(cell, prepared_cell);
+		}
+
+		Bool const streaming = SceneStreaming.Get();
+		std::vector<std::pair<Float, Uint32>> cells_to_load;
+		for (Uint32 i = 0; i < cells.size(); ++i)
+		{
+			Cell& cell = cells[i];
+			Float const distance = streaming ? GetCellDistance(cell, camera_position) : FLT_MAX;
+			switch (cell.state)
+			{
+			case CellState::Unloaded:
+				if (distance <= load_radius) cells_to_load.emplace_back(distance, i);
+				break;
+			case CellState::Loading:
+				if (distance > unload_radius)
+				{
+					cell.state = CellState::Unloaded;
+					cell.request_id = 0;
+				}
+				break;
+			case CellState::Loaded:
+				if (distance > unload_radius) UnloadCell(cell);
+				break;
+			}
+		}
+		if (cells_to_load.empty()) return;
+
+		std::sort(cells_to_load.begin(), cells_to_load.end());
+		{
+			std::lock_guard lock(stream_mutex);
+			for (auto const& [distance, cell_index] : cells_to_load)
+			{
+				Cell& cell = cells[cell_index];
+				cell.state = CellState::Loading;
+				cell.request_id = next_request_id++;
+				requests.push_back(CellRequest{ cell_index, cell.request_id, cell.desc.models });
+			}
+		}
+		stream_cv.notify_one();
+	}
+
+	Uint32 SceneStreamer::GetLoadedCellCount() const
+	{
+		return (Uint32)std::count_if(cells.begin(), cells.end(), [](Cell const& cell) { return cell.state == CellState::Loaded; });
+	}
+
+	Bool SceneStreamer::IsStreaming() const
+	{
+		if (!retired_geometry.empty()) return true;
+		return std::any_of(cells.begin(), cells.end(), [](Cell const& cell) { return cell.state == CellState::Loading; });
+	}
+
+	SceneStreamingParameters SceneStreamer::GetParameters() const
+	{
+		SceneStreamingParameters params{ .cell_size = cell_size, .load_radius = load_radius, .unload_radius = unload_radius };
+		params.cells.reserve(cells.size());
+		for (Cell const& cell : cells) params.cells.push_back(cell.desc);
+		return params;
+	}
+
+	std::vector<entt::entity> SceneStreamer::GetStreamedEntities() const
+	{
+		std::vector<entt::entity> entities;
+		for (Cell const& cell : cells) entities.insert(entities.end(), cell.entities.begin(), cell.entities.end());
+		return entities;
+	}
+
+	void SceneStreamer::StreamThread()
+	{
+		while (true)
+		{
+			CellRequest request;
+			{
+				std::unique_lock lock(stream_mutex);
+				stream_cv.wait(lock, [this]() { return exit || !requests.empty(); });
+				if (exit) return;
+				request = std::move(requests.front());
+				requests.pop_front();
+			}
+
+			PreparedCell prepared_cell{ request.cell_index, request.request_id };
+			for (ModelParameters const& model : request.models)
+			{
+				if (std::unique_ptr<PreparedModel> prepared_model = scene_loader->PrepareModel_GLTF(model))
+				{
+					prepared_cell.models.push_back(std::move(prepared_model));
+				}
+			}
+
+			std::lock_guard lock(stream_mutex);
+			prepared_cells.push_back(std::move(prepared_cell));
+		}
+	}
+
+	Float SceneStreamer::GetCellDistance(Cell const& cell, Vector3 const& camera_position) const
+	{
+		Float const min_x = cell.desc.x * cell_size, min_z = cell.desc.z * cell_size;
+		Float const dx = std::max({ min_x - camera_position.x, 0.0f, camera_position.x - (min_x + cell_size) });
+		Float const dz = std::max({ min_z - camera_position.z, 0.0f, camera_position.z - (min_z + cell_size) });
+		return std::sqrt(dx * dx + dz * dz);
+	}
+
+	void SceneStreamer::CreateCell(Cell& cell, PreparedCell& prepared_cell)
+	{
+		for (std::unique_ptr<PreparedModel> const& prepared_model : prepared_cell.models)
+		{
+			entt::entity const entity = scene_loader->CreatePreparedModel(*prepared_model);
+			if (entity != entt::null) cell.entities.push_back(entity);
+		}
+		cell.state = CellState::Loaded;
+	}
+
+	void SceneStreamer::UnloadCell(Cell& cell)
+	{
+		std::vector<TextureHandle> cell_textures;
+		Uint64 const frame_index = gfx->GetFrameIndex();
+		for (entt::entity entity : cell.entities)
+		{
+			if (!reg.valid(entity)) continue;
+			if (Mesh* mesh = reg.try_get<Mesh>(entity))
+			{
+				for (Material& material : mesh->materials)
+				{
+					for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+					{
+						TextureHandle const texture = GetMaterialTexture(material, (MaterialTextureSlot)slot);
+						if (texture != INVALID_TEXTURE_HANDLE) cell_textures.push_back(texture);
+					}
+				}
+				//frames in flight can still read the geometry, its range is recycled once they are done
+				retired_geometry.push_back(RetiredGeometry{ mesh->geometry_buffer_handle, frame_index });
+			}
+			reg.destroy(entity);
+		}
+		cell.entities.clear();
+		cell.state = CellState::Unloaded;
+		cell.request_id = 0;
+		if (cell_textures.empty()) return;
+
+		//textures are shared by path, so only the ones no remaining mesh references are unloaded
+		std::sort(cell_textures.begin(), cell_textures.end());
+		cell_textures.erase(std::unique(cell_textures.begin(), cell_textures.end()), cell_textures.end());
+		for (auto&& [entity, mesh] : reg.view<Mesh>().each())
+		{
+			for (Material& material : mesh.materials)
+			{
+				for (Uint32 slot = 0; slot < MaterialTextureSlot_Count; ++slot)
+				{
+					TextureHandle const texture = GetMaterialTexture(material, (MaterialTextureSlot)slot);
+					auto it = std::lower_bound(cell_textures.begin(), cell_textures.end(), texture);
+					if (it != cell_textures.end() && *it == texture) cell_textures.erase(it);
+				}
+			}
+		}
+		for (TextureHandle texture : cell_textures) g_TextureManager.UnloadTexture(texture);
+	}
+}
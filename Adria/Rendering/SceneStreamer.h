@@ -0,0 +1,90 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include "SceneConfig.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	class GfxDevice;
+	class SceneLoader;
+	struct PreparedModel;
+
+	//loads the cells of the scene around the camera and unloads the distant ones. models are cooked and read on a background thread,
+	//the main thread only creates the entities and queues the geometry upload and texture loads, at most a few cells per frame
+	class SceneStreamer
+	{
+		enum class CellState : Uint8
+		{
+			Unloaded,
+			Loading,
+			Loaded
+		};
+
+		struct Cell
+		{
+			SceneCell desc;
+			CellState state = CellState::Unloaded;
+			Uint64 request_id = 0;
+			std::vector<entt::entity> entities;
+		};
+		struct CellRequest
+		{
+			Uint32 cell_index;
+			Uint64 request_id;
+			std::vector<ModelParameters> models;
+		};
+		struct PreparedCell
+		{
+			Uint32 cell_index;
+			Uint64 request_id;
+			std::vector<std::unique_ptr<PreparedModel>> models;
+		};
+		struct RetiredGeometry
+		{
+			ArcGeometryBufferHandle handle;
+			Uint64 frame;
+		};
+
+	public:
+		SceneStreamer(entt::registry& reg, GfxDevice* gfx, SceneLoader* scene_loader);
+		ADRIA_NONCOPYABLE_NONMOVABLE(SceneStreamer)
+		~SceneStreamer();
+
+		void Initialize(SceneStreamingParameters const& params);
+		void Clear();
+		void Update(Vector3 const& camera_position);
+
+		Uint32 GetLoadedCellCount() const;
+		//cells are being loaded or retired geometry is waiting for the gpu
+		Bool IsStreaming() const;
+		SceneStreamingParameters GetParameters() const;
+		std::vector<entt::entity> GetStreamedEntities() const;
+
+	private:
+		entt::registry& reg;
+		GfxDevice* gfx;
+		SceneLoader* scene_loader;
+		Float cell_size = 100.0f;
+		Float load_radius = 200.0f;
+		Float unload_radius = 300.0f;
+		std::vector<Cell> cells;
+		std::vector<RetiredGeometry> retired_geometry;
+		Uint64 next_request_id = 1;
+
+		std::thread stream_thread;
+		std::mutex stream_mutex;
+		std::condition_variable stream_cv;
+		std::deque<CellRequest> requests;
+		std::vector<PreparedCell> prepared_cells;
+		Bool exit = false;
+
+	private:
+		void StreamThread();
+		Float GetCellDistance(Cell const& cell, Vector3 const& camera_position) const;
+		void CreateCell(Cell& cell, PreparedCell& prepared_cell);
+		void UnloadCell(Cell& cell);
+	};
+}
@@ -1,13 +1,18 @@
+#include <bit>
 #include <set>
+#include <mutex>
 #include "ShaderManager.h"
 #include "Core/Paths.h"
 #include "Core/ConsoleManager.h"
 #include "Graphics/GfxShaderCompiler.h"
+#include "Graphics/GfxReflection.h"
+#include "Graphics/GfxShaderCache.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxPipelineState.h"
 #include "Logging/Logger.h"
 #include "Utilities/Timer.h"
 #include "Utilities/FileWatcher.h"
+#include "Utilities/ThreadPool.h"
 
 namespace fs = std::filesystem;
 
@@ -15,6 +20,12 @@ namespace adria
 {
 	static TAutoConsoleVariable<Bool> OptimizeShaders("r.Shaders.Optimize", true, "Whether to optimize shaders");
 	static TAutoConsoleVariable<Bool> ShaderDebugInfo("r.Shaders.DebugInfo", false, "Whether to keep debug data from shader bytecode");
+	static TAutoConsoleVariable<Bool> WarmUpShaders("r.Shaders.WarmUp", true, "Whether to compile all shaders in parallel at startup");
+	static TAutoConsoleVariable<Bool> HotReloadShaders("r.Shaders.HotReload", true, "Whether to recompile shaders automatically when their source files change");
+	static TAutoConsoleVariable<Int>  ShaderWaveSize("r.Shaders.WaveSize", 0, "Wave size the wave specialized compute kernels are compiled for, 0 picks it per vendor, clamped to the device lane count range");
+	static TAutoConsoleVariable<Bool> Shader16BitTypes("r.Shaders.16BitTypes", true, "Whether bandwidth bound post processing shaders use native 16 bit math when the device supports it");
+	static TAutoConsoleVariable<Bool> ShaderExecutionReordering("r.Shaders.ExecutionReordering", true, "Whether the path tracer reorders its hits by material before shading when the device supports SM 6.9 shader execution reordering");
+	static TAutoConsoleVariable<Bool> ShaderWaveSizeAttribute("r.Shaders.WaveSizeAttribute", true, "Whether wave specialized kernels force their wave size with the SM 6.6 WaveSize attribute");
 
 	namespace
 	{
@@ -23,6 +34,20 @@ namespace adria
 		LibraryRecompiledEvent library_recompiled_event;
 		std::unordered_map<GfxShaderKey, GfxShader, GfxShaderKeyHash> shader_map;
 		std::unordered_map<fs::path, std::set<GfxShaderKey>> file_shader_map;
+		std::mutex shader_map_mutex;
+		std::recursive_mutex shader_event_mutex;
+
+		struct HotReloadTask
+		{
+			GfxShaderKey shader;
+			std::unique_ptr<GfxShaderCompileOutput> output;
+			std::future<Bool> compile_task;
+		};
+		std::vector<HotReloadTask> hot_reload_tasks;
+		Uint32 wave_size = 0;
+		Bool wave_size_attribute = false;
+		Bool native_16bit_types = false;
+		Bool shader_execution_reordering = false;
 
 		inline GfxShaderCompilerFlags GetShaderCompilerFlags()
 		{
@@ -46,34 +71,49 @@ namespace adria
 			case VS_Sun:
 			case VS_Decals:
 			case VS_GBuffer:
+			case VS_MotionVectorsDynamic:
 			case VS_FullscreenTriangle:
 			case VS_LensFlare:
 			case VS_Shadow:
 			case VS_Ocean:
 			case VS_OceanLOD:
+			case VS_OceanClipmap:
 			case VS_CloudsCombine:
 			case VS_Debug:
+			case VS_DebugGPUPrimitives:
 			case VS_DDGIVisualize:
 			case VS_Rain:
 			case VS_RainBlocker:
+			case VS_Particle:
+			case VS_Terrain:
 				return GfxShaderStage::VS;
 			case PS_Sky:
 			case PS_Texture:
 			case PS_Solid:
 			case PS_Decals:
 			case PS_GBuffer:
+			case PS_MotionVectorsDynamic:
 			case PS_Copy:
 			case PS_Add:
+			case PS_UIComposite:
+			case PS_TransparentOIT:
+			case PS_OITComposite:
+			case PS_ForwardPlus:
 			case PS_LensFlare:
 			case PS_Shadow:
 			case PS_Ocean:
 			case PS_CloudsCombine:
 			case PS_DrawMeshlets:
+			case PS_DrawMeshletsVisibility:
+			case PS_DrawMeshletsShadowMask:
 			case PS_Debug:
 			case PS_DDGIVisualize:
 			case PS_Rain:
+			case PS_Particle:
+			case PS_Terrain:
 			case PS_VolumetricFog_CombineFog:
 			case PS_VRSOverlay:
+			case PS_VirtualShadowMap:
 				return GfxShaderStage::PS;
 			case GS_LensFlare:
 				return GfxShaderStage::GS;
@@ -81,19 +121,27 @@ namespace adria
 			case CS_Blur_Vertical:
 			case CS_BloomDownsample:
 			case CS_BloomUpsample:
+			case CS_BloomUpsampleFused:
 			case CS_InitialSpectrum:
 			case CS_Phase:
 			case CS_Spectrum:
 			case CS_FFT_Horizontal:
 			case CS_FFT_Vertical:
 			case CS_OceanNormals:
+			case CS_OceanClipmapCull:
 			case CS_Picking:
 			case CS_GenerateMips:
 			case CS_BuildHistogram:
 			case CS_HistogramReduction:
 			case CS_Ssao:
 			case CS_Hbao:
+			case CS_Gtao:
+			case CS_GtaoTemporal:
+			case CS_GtaoDenoise:
+			case CS_HalfResDownsample:
+			case CS_BilateralUpsample:
 			case CS_Ssr:
+			case CS_SsrResolve:
 			case CS_ExponentialHeightFog:
 			case CS_Tonemap:
 			case CS_MotionVectors:
@@ -103,18 +151,41 @@ namespace adria
 			case CS_Fxaa:
 			case CS_Ambient:
 			case CS_Clouds:
+			case CS_CloudsReconstruct:
+			case CS_CloudShadow:
 			case CS_CloudShape:
 			case CS_CloudDetail:
 			case CS_CloudType:
 			case CS_Taa:
+			case CS_DecalsTileCulling:
+			case CS_DecalsApply:
+			case CS_Skinning:
+			case CS_PrefixScan:
+			case CS_StreamCompaction:
+			case CS_RadixSortHistogram:
+			case CS_RadixSortScanHistogram:
+			case CS_RadixSortOnesweep:
+			case CS_VRSContentAdaptive:
+			case CS_ClearDebugGPUPrimitives:
 			case CS_DeferredLighting:
+			case CS_DeferredLightingClearTileArgs:
+			case CS_DeferredLightingClassifyTiles:
 			case CS_VolumetricLighting:
 			case CS_TiledDeferredLighting:
+			case CS_TiledLightBounds:
+			case CS_TiledCoarseCulling:
 			case CS_ClusteredDeferredLighting:
 			case CS_ClusterBuilding:
-			case CS_ClusterCulling:
+			case CS_ClusterMarkActive:
+			case CS_ClusterCompact:
+			case CS_ClusterLightCount:
+			case CS_ClusterPrefixSum:
+			case CS_ClusterLightAssign:
+			case CS_RTRClassify:
+			case CS_RTRRayArgs:
 			case CS_HosekWilkieSky:
 			case CS_MinimalAtmosphereSky:
+			case CS_SkyIrradianceSH:
 			case CS_LensFlare2:
 			case CS_ClearCounters:
 			case CS_CullInstances:
@@ -122,38 +193,78 @@ namespace adria
 			case CS_CullMeshlets:
 			case CS_BuildMeshletDrawArgs:
 			case CS_BuildInstanceCullArgs:
+			case CS_VisibilityBufferMaterial:
 			case CS_InitializeHZB:
 			case CS_HZBMips:
-			case CS_RTAOFilter:
+			case CS_OcclusionQuery:
+			case CS_SPD:
+			case CS_RayTracedShadows:
+			case CS_RayTracedAmbientOcclusion:
+			case CS_PathTracingResolve:
+			case CS_RTDenoiserTemporal:
+			case CS_RTDenoiserAtrous:
 			case CS_DDGIUpdateIrradiance:
 			case CS_DDGIUpdateDistance:
+			case CS_DDGIRelocateProbes:
+			case CS_DDGIClassifyProbes:
+			case CS_DDGIResetProbes:
+			case CS_DDGIRayTraceInline:
 			case CS_RainSimulation:
+			case CS_ParticleInitDeadList:
+			case CS_ParticleEmit:
+			case CS_ParticleSimulate:
+			case CS_ParticleBuildArgs:
+			case CS_ParticleSortInitial:
+			case CS_ParticleSortStep:
+			case CS_ParticleSortInner:
+			case CS_TerrainClipmapCull:
+			case CS_TerrainVirtualTextureUpdate:
+			case CS_VideoCaptureConvert:
+			case CS_ReSTIRDI_InitialSampling:
+			case CS_ReSTIRDI_TemporalResampling:
+			case CS_ReSTIRDI_SpatialResampling:
+			case CS_ReSTIRDI_Shading:
 			case CS_ReSTIRGI_InitialSampling:
 			case CS_ReSTIRGI_TemporalResampling:
 			case CS_ReSTIRGI_SpatialResampling:
+			case CS_ReSTIRGI_Resolve:
+			case CS_VolumetricFog_DensityInjection:
 			case CS_VolumetricFog_LightInjection:
 			case CS_VolumetricFog_ScatteringIntegration:
+			case CS_VirtualShadowMapReset:
+			case CS_VirtualShadowMapMarkPages:
+			case CS_VirtualShadowMapFreePages:
+			case CS_VirtualShadowMapAllocatePages:
+			case CS_VirtualShadowMapClearPages:
+			case CS_GenerateMips:
 			case CS_RendererOutput:
 			case CS_DepthOfField_ComputeCoC:
 			case CS_DepthOfField_ComputeSeparatedCoC:
-			case CS_DepthOfField_DownsampleCoC:
 			case CS_DepthOfField_ComputePrefilteredTexture:
 			case CS_DepthOfField_BokehFirstPass:
 			case CS_DepthOfField_BokehSecondPass:
 			case CS_DepthOfField_ComputePostfilteredTexture:
 			case CS_DepthOfField_Combine:
+			case CS_DepthOfField_ClearTileArgs:
+			case CS_DepthOfField_ClassifyTiles:
 				return GfxShaderStage::CS;
 			case HS_OceanLOD:
 				return GfxShaderStage::HS;
 			case DS_OceanLOD:
 				return GfxShaderStage::DS;
 			case MS_DrawMeshlets:
+			case MS_Shadow:
+			case MS_GBuffer:
 				return GfxShaderStage::MS;
+			case AS_Shadow:
+			case AS_GBuffer:
+				return GfxShaderStage::AS;
 			case LIB_Shadows:
 			case LIB_AmbientOcclusion:
 			case LIB_Reflections:
 			case LIB_PathTracing:
 			case LIB_DDGIRayTracing:
+			case LIB_CullMeshletsWorkGraph:
 				return GfxShaderStage::LIB;
 			case ShaderId_Count:
 			default:
@@ -168,6 +279,7 @@ namespace adria
 			case PS_Sky:
 			case CS_HosekWilkieSky:
 			case CS_MinimalAtmosphereSky:
+			case CS_SkyIrradianceSH:
 				return "Weather/Sky.hlsl";
 			case VS_Rain:
 			case PS_Rain:
@@ -176,6 +288,27 @@ namespace adria
 				return "Weather/RainBlocker.hlsl";
 			case CS_RainSimulation:
 				return "Weather/RainSimulation.hlsl";
+			case VS_Particle:
+			case PS_Particle:
+				return "Particles/Particles.hlsl";
+			case CS_ParticleInitDeadList:
+			case CS_ParticleEmit:
+			case CS_ParticleSimulate:
+			case CS_ParticleBuildArgs:
+				return "Particles/ParticleSimulation.hlsl";
+			case CS_ParticleSortInitial:
+			case CS_ParticleSortStep:
+			case CS_ParticleSortInner:
+				return "Particles/ParticleSort.hlsl";
+			case VS_Terrain:
+			case PS_Terrain:
+				return "Terrain/Terrain.hlsl";
+			case CS_TerrainClipmapCull:
+				return "Terrain/TerrainClipmapCull.hlsl";
+			case CS_TerrainVirtualTextureUpdate:
+				return "Terrain/TerrainVirtualTexture.hlsl";
+			case CS_VideoCaptureConvert:
+				return "Other/VideoCaptureConvert.hlsl";
 			case VS_Simple:
 			case VS_Sun:
 			case PS_Texture:
@@ -184,16 +317,41 @@ namespace adria
 			case VS_Debug:
 			case PS_Debug:
 				return "Other/Debug.hlsl";
+			case VS_DebugGPUPrimitives:
+			case CS_ClearDebugGPUPrimitives:
+				return "Other/DebugPrimitives.hlsl";
 			case VS_Decals:
 			case PS_Decals:
 				return "Other/Decals.hlsl";
+			case CS_DecalsTileCulling:
+			case CS_DecalsApply:
+				return "Other/DecalsTiled.hlsl";
+			case CS_Skinning:
+				return "Other/Skinning.hlsl";
+			case CS_PrefixScan:
+				return "Other/PrefixScan.hlsl";
+			case CS_StreamCompaction:
+				return "Other/StreamCompaction.hlsl";
+			case CS_RadixSortHistogram:
+			case CS_RadixSortScanHistogram:
+			case CS_RadixSortOnesweep:
+				return "Other/RadixSort.hlsl";
 			case VS_GBuffer:
 			case PS_GBuffer:
+			case AS_GBuffer:
+			case MS_GBuffer:
 				return "Lighting/GBuffer.hlsl";
 			case VS_FullscreenTriangle:
 				return "Other/FullscreenTriangle.hlsl";
 			case PS_Copy:
 				return "Other/CopyTexture.hlsl";
+			case PS_UIComposite:
+				return "Other/UIComposite.hlsl";
+			case PS_TransparentOIT:
+			case PS_OITComposite:
+				return "Other/OIT.hlsl";
+			case PS_ForwardPlus:
+				return "Lighting/ForwardPlus.hlsl";
 			case PS_Add:
 				return "Other/AddTextures.hlsl";
 			case VS_LensFlare:
@@ -203,6 +361,8 @@ namespace adria
 			case CS_LensFlare2:
 				return "Postprocess/LensFlare2.hlsl";
 			case CS_Clouds:
+			case CS_CloudsReconstruct:
+			case CS_CloudShadow:
 			case VS_CloudsCombine:
 			case PS_CloudsCombine:
 				return "Weather/VolumetricClouds.hlsl";
@@ -212,12 +372,24 @@ namespace adria
 				return "Weather/CloudNoise.hlsl";
 			case VS_Shadow:
 			case PS_Shadow:
+			case AS_Shadow:
+			case MS_Shadow:
 				return "Lighting/Shadow.hlsl";
+			case CS_VirtualShadowMapReset:
+			case CS_VirtualShadowMapMarkPages:
+			case CS_VirtualShadowMapFreePages:
+			case CS_VirtualShadowMapAllocatePages:
+			case CS_VirtualShadowMapClearPages:
+			case PS_VirtualShadowMap:
+				return "Lighting/VirtualShadowMap.hlsl";
+			case CS_GenerateMips:
+				return "Other/GenerateMips.hlsl";
 			case CS_Blur_Horizontal:
 			case CS_Blur_Vertical:
 				return "Postprocess/Blur.hlsl";
 			case CS_BloomDownsample:
 			case CS_BloomUpsample:
+			case CS_BloomUpsampleFused:
 				return "Postprocess/Bloom.hlsl";
 			case CS_InitialSpectrum:
 				return "Ocean/InitialSpectrum.hlsl";
@@ -231,8 +403,11 @@ namespace adria
 			case CS_OceanNormals:
 				return "Ocean/OceanNormals.hlsl";
 			case VS_Ocean:
+			case VS_OceanClipmap:
 		    case PS_Ocean:
 				return "Ocean/Ocean.hlsl";
+			case CS_OceanClipmapCull:
+				return "Ocean/OceanClipmapCull.hlsl";
 			case VS_OceanLOD:
 			case HS_OceanLOD:
 			case DS_OceanLOD:
@@ -249,13 +424,23 @@ namespace adria
 				return "Postprocess/SSAO.hlsl";
 			case CS_Hbao:
 				return "Postprocess/HBAO.hlsl";
+			case CS_Gtao:
+			case CS_GtaoTemporal:
+			case CS_GtaoDenoise:
+				return "Postprocess/GTAO.hlsl";
+			case CS_HalfResDownsample:
+			case CS_BilateralUpsample:
+				return "Postprocess/HalfResolution.hlsl";
 			case CS_Ssr:
+			case CS_SsrResolve:
 				return "Postprocess/SSR.hlsl";
 			case CS_ExponentialHeightFog:
 				return "Postprocess/ExponentialHeightFog.hlsl";
 			case CS_Tonemap:
 				return "Postprocess/Tonemap.hlsl";
 			case CS_MotionVectors:
+			case VS_MotionVectorsDynamic:
+			case PS_MotionVectorsDynamic:
 				return "Postprocess/MotionVectors.hlsl";
 			case CS_MotionBlur:
 				return "Postprocess/MotionBlur.hlsl";
@@ -271,16 +456,28 @@ namespace adria
 				return "Lighting/Ambient.hlsl";
 			case CS_DeferredLighting:
 				return "Lighting/DeferredLighting.hlsl";
+			case CS_DeferredLightingClearTileArgs:
+			case CS_DeferredLightingClassifyTiles:
+				return "Lighting/DeferredLightingClassification.hlsl";
 			case CS_VolumetricLighting:
 				return "Lighting/VolumetricLighting.hlsl";
 			case CS_TiledDeferredLighting:
+			case CS_TiledLightBounds:
+			case CS_TiledCoarseCulling:
 				return "Lighting/TiledDeferredLighting.hlsl";
 			case CS_ClusteredDeferredLighting:
 				return "Lighting/ClusteredDeferredLighting.hlsl";
 			case CS_ClusterBuilding:
 				return "Lighting/ClusterBuilding.hlsl";
-			case CS_ClusterCulling:
+			case CS_ClusterMarkActive:
+			case CS_ClusterCompact:
+			case CS_ClusterLightCount:
+			case CS_ClusterPrefixSum:
+			case CS_ClusterLightAssign:
 				return "Lighting/ClusterCulling.hlsl";
+			case CS_RTRClassify:
+			case CS_RTRRayArgs:
+				return "RayTracing/RTRClassify.hlsl";
 			case CS_ClearCounters:
 				return "Meshlets/ClearCounters.hlsl";
 			case CS_BuildMeshletCullArgs:
@@ -292,44 +489,70 @@ namespace adria
 			case CS_BuildMeshletDrawArgs:
 			case MS_DrawMeshlets:
 			case PS_DrawMeshlets:
+			case PS_DrawMeshletsVisibility:
+			case PS_DrawMeshletsShadowMask:
 				return "Meshlets/DrawMeshlets.hlsl";
+			case CS_VisibilityBufferMaterial:
+				return "Meshlets/VisibilityBufferMaterial.hlsl";
 			case CS_InitializeHZB:
 			case CS_HZBMips:
 				return "Meshlets/HZB.hlsl";
+			case CS_OcclusionQuery:
+				return "Other/OcclusionQuery.hlsl";
+			case CS_SPD:
+				return "SPD/SPD.hlsl";
+			case CS_VolumetricFog_DensityInjection:
 			case CS_VolumetricFog_LightInjection:
 			case CS_VolumetricFog_ScatteringIntegration:
 			case PS_VolumetricFog_CombineFog:
 				return "Lighting/VolumetricFog.hlsl";
-			case CS_RTAOFilter:
-				return "RayTracing/RTAOFilter.hlsl";
+			case CS_RTDenoiserTemporal:
+			case CS_RTDenoiserAtrous:
+				return "RayTracing/RTDenoiser.hlsl";
 			case CS_DDGIUpdateIrradiance:
 				return "DDGI/DDGIUpdateIrradiance.hlsl";
 			case CS_DDGIUpdateDistance:
 				return "DDGI/DDGIUpdateDistance.hlsl";
+			case CS_DDGIRelocateProbes:
+			case CS_DDGIClassifyProbes:
+			case CS_DDGIResetProbes:
+				return "DDGI/DDGIProbeUpdate.hlsl";
 			case VS_DDGIVisualize:
 			case PS_DDGIVisualize:
 				return "DDGI/DDGIVisualize.hlsl";
 			case LIB_DDGIRayTracing:
+			case CS_DDGIRayTraceInline:
 				return "DDGI/DDGIRayTrace.hlsl";
 			case LIB_Shadows:
+			case CS_RayTracedShadows:
 				return "RayTracing/RayTracedShadows.hlsl";
 			case LIB_AmbientOcclusion:
+			case CS_RayTracedAmbientOcclusion:
 				return "RayTracing/RayTracedAmbientOcclusion.hlsl";
 			case LIB_Reflections:
 				return "RayTracing/RayTracedReflections.hlsl";
 			case LIB_PathTracing:
+			case CS_PathTracingResolve:
 				return "RayTracing/PathTracer.hlsl";
+			case LIB_CullMeshletsWorkGraph:
+				return "Meshlets/CullMeshletsWorkGraph.hlsl";
+			case CS_ReSTIRDI_InitialSampling:
+			case CS_ReSTIRDI_TemporalResampling:
+			case CS_ReSTIRDI_SpatialResampling:
+			case CS_ReSTIRDI_Shading:
+				return "ReSTIR/ReSTIR_DI.hlsl";
 			case CS_ReSTIRGI_InitialSampling:
 				return "ReSTIR/InitialSampling.hlsl";
 			case CS_ReSTIRGI_TemporalResampling:
 				return "ReSTIR/TemporalResampling.hlsl";
 			case CS_ReSTIRGI_SpatialResampling:
 				return "ReSTIR/SpatialResampling.hlsl";
+			case CS_ReSTIRGI_Resolve:
+				return "ReSTIR/Resolve.hlsl";
 			case CS_RendererOutput:
 				return "Other/RendererOutput.hlsl";
 			case CS_DepthOfField_ComputeCoC:
 			case CS_DepthOfField_ComputeSeparatedCoC:
-			case CS_DepthOfField_DownsampleCoC:
 				return "Postprocess/DepthOfField/CircleOfConfusion.hlsl";
 			case CS_DepthOfField_ComputePrefilteredTexture:
 			case CS_DepthOfField_ComputePostfilteredTexture:
@@ -338,8 +561,13 @@ namespace adria
 			case CS_DepthOfField_BokehFirstPass:
 			case CS_DepthOfField_BokehSecondPass:
 				return "Postprocess/DepthOfField/Bokeh.hlsl";
+			case CS_DepthOfField_ClearTileArgs:
+			case CS_DepthOfField_ClassifyTiles:
+				return "Postprocess/DepthOfField/TileClassification.hlsl";
 			case PS_VRSOverlay:
 				return "Other/VRSOverlay.hlsl";
+			case CS_VRSContentAdaptive:
+				return "Other/VRSContentAdaptive.hlsl";
 			case ShaderId_Count:
 			default:
 				return "";
@@ -365,10 +593,20 @@ namespace adria
 				return "DrawMeshletsMS";
 			case PS_DrawMeshlets:
 				return "DrawMeshletsPS";
+			case PS_DrawMeshletsVisibility:
+				return "DrawMeshletsVisibilityPS";
+			case PS_DrawMeshletsShadowMask:
+				return "DrawMeshletsShadowMaskPS";
+			case CS_VisibilityBufferMaterial:
+				return "VisibilityBufferMaterialCS";
 			case CS_InitializeHZB:
 				return "InitializeHZB_CS";
 			case CS_HZBMips:
 				return "HZBMipsCS";
+			case CS_OcclusionQuery:
+				return "OcclusionQueryCS";
+			case CS_SPD:
+				return "SPD_CS";
 			case CS_BuildHistogram:
 				return "BuildHistogramCS";
 			case CS_HistogramReduction:
@@ -377,14 +615,30 @@ namespace adria
 				return "SSAO_CS";
 			case CS_Hbao:
 				return "HBAO_CS";
+			case CS_Gtao:
+				return "GTAO_CS";
+			case CS_GtaoTemporal:
+				return "GTAO_TemporalCS";
+			case CS_GtaoDenoise:
+				return "GTAO_DenoiseCS";
+			case CS_HalfResDownsample:
+				return "HalfResDownsampleCS";
+			case CS_BilateralUpsample:
+				return "BilateralUpsampleCS";
 			case CS_Ssr:
 				return "SSR_CS";
+			case CS_SsrResolve:
+				return "SSR_ResolveCS";
 			case CS_ExponentialHeightFog:
 				return "ExponentialHeightFogCS";
 			case CS_Tonemap:
 				return "TonemapCS";
 			case CS_MotionVectors:
 				return "MotionVectorsCS";
+			case VS_MotionVectorsDynamic:
+				return "MotionVectorsDynamicVS";
+			case PS_MotionVectorsDynamic:
+				return "MotionVectorsDynamicPS";
 			case CS_MotionBlur:
 				return "MotionBlurCS";
 			case CS_GodRays:
@@ -399,6 +653,10 @@ namespace adria
 				return "GBufferVS";
 			case PS_GBuffer:
 				return "GBufferPS";
+			case AS_GBuffer:
+				return "GBufferAS";
+			case MS_GBuffer:
+				return "GBufferMS";
 			case VS_LensFlare:
 				return "LensFlareVS";
 			case GS_LensFlare:
@@ -409,8 +667,16 @@ namespace adria
 				return "DebugVS";
 			case PS_Debug:
 				return "DebugPS";
+			case VS_DebugGPUPrimitives:
+				return "DebugPrimitivesVS";
+			case CS_ClearDebugGPUPrimitives:
+				return "ClearDebugPrimitivesCS";
 			case CS_Clouds:
 				return "CloudsCS";
+			case CS_CloudsReconstruct:
+				return "CloudsReconstructCS";
+			case CS_CloudShadow:
+				return "CloudShadowCS";
 			case CS_CloudShape:
 				return "CloudShapeCS";
 			case CS_CloudDetail:
@@ -421,6 +687,8 @@ namespace adria
 				return "BloomDownsampleCS";
 			case CS_BloomUpsample:
 				return "BloomUpsampleCS";
+			case CS_BloomUpsampleFused:
+				return "BloomUpsampleFusedCS";
 			case CS_Blur_Horizontal:
 				return "Blur_HorizontalCS";
 			case CS_Blur_Vertical:
@@ -433,14 +701,18 @@ namespace adria
 				return "OceanPS";
 			case VS_OceanLOD:
 				return "OceanVS_LOD";
+			case VS_OceanClipmap:
+				return "OceanClipmapVS";
+			case CS_OceanClipmapCull:
+				return "OceanClipmapCullCS";
 			case DS_OceanLOD:
 				return "OceanDS_LOD";
 			case HS_OceanLOD:
 				return "OceanHS_LOD";
 			case CS_FFT_Horizontal:
-				return "FFT_HorizontalCS";
+				return "FFT_StockhamHorizontalCS";
 			case CS_FFT_Vertical:
-				return "FFT_VerticalCS";
+				return "FFT_StockhamVerticalCS";
 			case CS_InitialSpectrum:
 				return "InitialSpectrumCS";
 			case CS_Spectrum:
@@ -455,6 +727,14 @@ namespace adria
 				return "AddTexturesPS";
 			case PS_Copy:
 				return "CopyTexturePS";
+			case PS_UIComposite:
+				return "UICompositePS";
+			case PS_TransparentOIT:
+				return "TransparentOITPS";
+			case PS_OITComposite:
+				return "OITCompositePS";
+			case PS_ForwardPlus:
+				return "ForwardPlusPS";
 			case VS_Sky:
 				return "SkyVS";
 			case PS_Sky:
@@ -463,6 +743,8 @@ namespace adria
 				return "HosekWilkieSkyCS";
 			case CS_MinimalAtmosphereSky:
 				return "MinimalAtmosphereSkyCS";
+			case CS_SkyIrradianceSH:
+				return "SkyIrradianceSHCS";
 			case VS_Rain:
 				return "RainVS";
 			case PS_Rain:
@@ -471,6 +753,34 @@ namespace adria
 				return "RainBlockerVS";
 			case CS_RainSimulation:
 				return "RainSimulationCS";
+			case VS_Particle:
+				return "ParticleVS";
+			case PS_Particle:
+				return "ParticlePS";
+			case CS_ParticleInitDeadList:
+				return "ParticleInitDeadListCS";
+			case CS_ParticleEmit:
+				return "ParticleEmitCS";
+			case CS_ParticleSimulate:
+				return "ParticleSimulateCS";
+			case CS_ParticleBuildArgs:
+				return "ParticleBuildArgsCS";
+			case CS_ParticleSortInitial:
+				return "ParticleSortInitialCS";
+			case CS_ParticleSortStep:
+				return "ParticleSortStepCS";
+			case CS_ParticleSortInner:
+				return "ParticleSortInnerCS";
+			case VS_Terrain:
+				return "TerrainVS";
+			case PS_Terrain:
+				return "TerrainPS";
+			case CS_TerrainClipmapCull:
+				return "TerrainClipmapCullCS";
+			case CS_TerrainVirtualTextureUpdate:
+				return "TerrainVirtualTextureUpdateCS";
+			case CS_VideoCaptureConvert:
+				return "VideoCaptureConvertCS";
 			case VS_Simple:
 				return "SimpleVS";
 			case VS_Sun:
@@ -483,22 +793,60 @@ namespace adria
 				return "DecalsVS";
 			case PS_Decals:
 				return "DecalsPS";
+			case CS_DecalsTileCulling:
+				return "DecalsTileCullingCS";
+			case CS_DecalsApply:
+				return "DecalsApplyCS";
+			case CS_Skinning:
+				return "SkinningCS";
+			case CS_PrefixScan:
+				return "PrefixScanCS";
+			case CS_StreamCompaction:
+				return "StreamCompactionCS";
+			case CS_RadixSortHistogram:
+				return "GlobalHistogramCS";
+			case CS_RadixSortScanHistogram:
+				return "ScanHistogramCS";
+			case CS_RadixSortOnesweep:
+				return "OnesweepCS";
 			case CS_GenerateMips:
 				return "GenerateMipsCS";
 			case CS_Taa:
 				return "TAA_CS";
 			case CS_DeferredLighting:
 				return "DeferredLightingCS";
+			case CS_DeferredLightingClearTileArgs:
+				return "ClearTileArgsCS";
+			case CS_DeferredLightingClassifyTiles:
+				return "ClassifyTilesCS";
 			case CS_VolumetricLighting:
 				return "VolumetricLightingCS";
 			case CS_TiledDeferredLighting:
 				return "TiledDeferredLightingCS";
+			case CS_TiledLightBounds:
+				return "TiledLightBoundsCS";
+			case CS_TiledCoarseCulling:
+				return "TiledCoarseCullingCS";
 			case CS_ClusteredDeferredLighting:
 				return "ClusteredDeferredLightingCS";
 			case CS_ClusterBuilding:
 				return "ClusterBuildingCS";
-			case CS_ClusterCulling:
-				return "ClusterCullingCS";
+			case CS_ClusterMarkActive:
+				return "ClusterMarkActiveCS";
+			case CS_ClusterCompact:
+				return "ClusterCompactCS";
+			case CS_ClusterLightCount:
+				return "ClusterLightCountCS";
+			case CS_ClusterPrefixSum:
+				return "ClusterPrefixSumCS";
+			case CS_ClusterLightAssign:
+				return "ClusterLightAssignCS";
+			case CS_RTRClassify:
+				return "RTRClassifyCS";
+			case CS_RTRRayArgs:
+				return "RTRRayArgsCS";
+			case CS_VolumetricFog_DensityInjection:
+				return "DensityInjectionCS";
 			case CS_VolumetricFog_LightInjection:
 				return "LightInjectionCS";
 			case CS_VolumetricFog_ScatteringIntegration:
@@ -509,18 +857,52 @@ namespace adria
 				return "ShadowVS";
 			case PS_Shadow:
 				return "ShadowPS";
+			case AS_Shadow:
+				return "ShadowAS";
+			case MS_Shadow:
+				return "ShadowMS";
+			case CS_VirtualShadowMapReset:
+				return "ResetPagesCS";
+			case CS_VirtualShadowMapMarkPages:
+				return "MarkPagesCS";
+			case CS_VirtualShadowMapFreePages:
+				return "FreePagesCS";
+			case CS_VirtualShadowMapAllocatePages:
+				return "AllocatePagesCS";
+			case CS_VirtualShadowMapClearPages:
+				return "ClearPagesCS";
+			case PS_VirtualShadowMap:
+				return "VirtualShadowMapPS";
+			case CS_GenerateMips:
+				return "GenerateMipsCS";
 			case VS_CloudsCombine:
 				return "CloudsCombineVS";
 			case PS_CloudsCombine:
 				return "CloudsCombinePS";
 			case CS_LensFlare2:
 				return "LensFlareCS";
-			case CS_RTAOFilter:
-				return "RTAOFilterCS";
+			case CS_RayTracedShadows:
+				return "RTS_InlineCS";
+			case CS_PathTracingResolve:
+				return "PT_ResolveCS";
+			case CS_RayTracedAmbientOcclusion:
+				return "RTAO_InlineCS";
+			case CS_RTDenoiserTemporal:
+				return "RTDenoiser_TemporalCS";
+			case CS_RTDenoiserAtrous:
+				return "RTDenoiser_AtrousCS";
 			case CS_DDGIUpdateIrradiance:
 				return "DDGI_UpdateIrradianceCS";
 			case CS_DDGIUpdateDistance:
 				return "DDGI_UpdateDistanceCS";
+			case CS_DDGIRelocateProbes:
+				return "DDGI_RelocateProbesCS";
+			case CS_DDGIClassifyProbes:
+				return "DDGI_ClassifyProbesCS";
+			case CS_DDGIResetProbes:
+				return "DDGI_ResetProbesCS";
+			case CS_DDGIRayTraceInline:
+				return "DDGI_RayTraceInlineCS";
 			case VS_DDGIVisualize:
 				return "DDGIVisualizeVS";
 			case PS_DDGIVisualize:
@@ -531,14 +913,22 @@ namespace adria
 				return "TemporalResamplingCS";
 			case CS_ReSTIRGI_SpatialResampling:
 				return "SpatialResampling";
+			case CS_ReSTIRGI_Resolve:
+				return "ResolveCS";
+			case CS_ReSTIRDI_InitialSampling:
+				return "ReSTIRDI_InitialSamplingCS";
+			case CS_ReSTIRDI_TemporalResampling:
+				return "ReSTIRDI_TemporalResamplingCS";
+			case CS_ReSTIRDI_SpatialResampling:
+				return "ReSTIRDI_SpatialResamplingCS";
+			case CS_ReSTIRDI_Shading:
+				return "ReSTIRDI_ShadingCS";
 			case CS_RendererOutput:
 				return "RendererOutputCS";
 			case CS_DepthOfField_ComputeCoC:
 				return "ComputeCircleOfConfusionCS";
 			case CS_DepthOfField_ComputeSeparatedCoC:
 				return "ComputeSeparatedCircleOfConfusionCS";
-			case CS_DepthOfField_DownsampleCoC:
-				return "DownsampleCircleOfConfusionCS";
 			case CS_DepthOfField_ComputePrefilteredTexture:
 				return "ComputePrefilteredTextureCS";
 			case CS_DepthOfField_BokehFirstPass:
@@ -549,20 +939,103 @@ namespace adria
 				return "ComputePostfilteredTextureCS";
 			case CS_DepthOfField_Combine:
 				return "CombineCS";
+			case CS_DepthOfField_ClearTileArgs:
+				return "ClearTileArgsCS";
+			case CS_DepthOfField_ClassifyTiles:
+				return "ClassifyTilesCS";
 			case PS_VRSOverlay:
 				return "VRSOverlayPS";
+			case CS_VRSContentAdaptive:
+				return "VRSContentAdaptiveCS";
 			}
 			return "main";
 		}
 		constexpr GfxShaderModel GetShaderModel(ShaderID shader)
 		{
+			switch (shader)
+			{
+			case LIB_CullMeshletsWorkGraph:
+				return SM_6_8;
+			}
 			return SM_6_7;
 		}
 
-		void CompileShader(GfxShaderKey const& shader)
+		constexpr Bool IsWaveSizeSpecialized(ShaderID shader)
 		{
-			if (!shader.IsValid()) return;
+			switch (shader)
+			{
+			case CS_CullInstances:
+			case CS_CullMeshlets:
+			case CS_BuildInstanceCullArgs:
+			case CS_BuildMeshletCullArgs:
+			case CS_OceanClipmapCull:
+			case CS_TerrainClipmapCull:
+			case CS_DecalsTileCulling:
+			case CS_TiledLightBounds:
+			case CS_TiledCoarseCulling:
+			case CS_ClusterCompact:
+			case CS_ClusterLightCount:
+			case CS_ClusterPrefixSum:
+			case CS_ClusterLightAssign:
+			case CS_BuildHistogram:
+			case CS_HistogramReduction:
+			case CS_FFT_Horizontal:
+			case CS_FFT_Vertical:
+			case CS_PrefixScan:
+			case CS_StreamCompaction:
+			case CS_RadixSortHistogram:
+			case CS_RadixSortScanHistogram:
+			case CS_RadixSortOnesweep:
+				return true;
+			}
+			return false;
+		}
+
+		//passes bound by texture bandwidth and alu on 4k targets, values are colors or weights that fit half precision
+		constexpr Bool HasReorderingPath(ShaderID shader)
+		{
+			switch (shader)
+			{
+			case LIB_PathTracing:
+				return true;
+			}
+			return false;
+		}
+		constexpr Bool HasHalfPrecisionPath(ShaderID shader)
+		{
+			switch (shader)
+			{
+			case CS_Tonemap:
+			case CS_FilmEffects:
+			case CS_Fxaa:
+			case CS_BloomDownsample:
+			case CS_BloomUpsample:
+			case CS_BloomUpsampleFused:
+			case CS_Blur_Horizontal:
+			case CS_Blur_Vertical:
+			case CS_Taa:
+				return true;
+			}
+			return false;
+		}
+
+		//rdna and gcn are fastest in wave64 for these kernels, nvidia only runs wave32 and intel defaults to simd16
+		Uint32 ChooseWaveSize(GfxDevice* gfx)
+		{
+			GfxCapabilities const& capabilities = gfx->GetCapabilities();
+			Uint32 preferred_wave_size = capabilities.GetWaveLaneCountMin();
+			switch (gfx->GetVendor())
+			{
+			case GfxVendor::AMD:	preferred_wave_size = 64; break;
+			case GfxVendor::Nvidia: preferred_wave_size = 32; break;
+			case GfxVendor::Intel:	preferred_wave_size = 16; break;
+			}
+			if (ShaderWaveSize.Get() > 0) preferred_wave_size = (Uint32)ShaderWaveSize.Get();
+			return std::clamp(std::bit_floor(preferred_wave_size), capabilities.GetWaveLaneCountMin(), capabilities.GetWaveLaneCountMax());
+		}
 
+		GfxShaderDesc GetShaderDesc(GfxShaderKey const& shader)
+		{
 			GfxShaderDesc shader_desc{};
 			shader_desc.entry_point = GetEntryPoint(shader);
 			shader_desc.stage = GetShaderStage(shader);
@@ -570,31 +1043,75 @@ namespace adria
 			shader_desc.file = paths::ShaderDir + GetShaderSource(shader);
 			shader_desc.flags = GetShaderCompilerFlags();
 			shader_desc.defines = shader.GetDefines();
+			if (wave_size > 0 && IsWaveSizeSpecialized(shader))
+			{
+				shader_desc.defines.emplace_back("WAVE_SIZE", std::to_string(wave_size));
+				if (wave_size_attribute) shader_desc.defines.emplace_back("WAVE_SIZE_ATTRIBUTE", "1");
+			}
+			if (native_16bit_types && HasHalfPrecisionPath(shader))
+			{
+				shader_desc.flags |= GfxShaderCompilerFlag_Enable16BitTypes;
+				shader_desc.defines.emplace_back("USE_16BIT_TYPES", "1");
+			}
+			if (shader_execution_reordering && HasReorderingPath(shader))
+			{
+				shader_desc.model = SM_6_9;
+				shader_desc.defines.emplace_back("SHADER_EXECUTION_REORDERING", "1");
+			}
+			return shader_desc;
+		}
+		void RegisterShader(GfxShaderKey const& shader, GfxShaderCompileOutput& output)
+		{
+			GfxShaderDesc const shader_desc = GetShaderDesc(shader);
+			if (shader_desc.stage != GfxShaderStage::LIB)
+			{
+				GfxReflection::FillConstantBuffers(output.shader);
+			}
+			{
+				std::lock_guard lock(shader_map_mutex);
+				shader_map[shader] = std::move(output.shader);
+
+				file_shader_map[fs::path(shader_desc.file)].insert(shader);
+				for (auto const& include : output.includes)
+				{
+					file_shader_map[fs::path(include)].insert(shader);
+				}
+			}
+			std::lock_guard lock(shader_event_mutex);
+			shader_desc.stage == GfxShaderStage::LIB ? library_recompiled_event.Broadcast(shader) : shader_recompiled_event.Broadcast(shader);
+		}
+		void CompileShader(GfxShaderKey const& shader)
+		{
+			if (!shader.IsValid()) return;
 
 			GfxShaderCompileOutput output;
-			Bool compile_result = GfxShaderCompiler::CompileShader(shader_desc, output);
+			Bool compile_result = GfxShaderCompiler::CompileShader(GetShaderDesc(shader), output);
 			ADRIA_ASSERT(compile_result);
 			if (!compile_result) return;
-
-			shader_map[shader] = std::move(output.shader);
-
-			file_shader_map[fs::path(shader_desc.file)].insert(shader);
-			for (auto const& include : output.includes)
-			{
-				file_shader_map[fs::path(include)].insert(shader);
-			}
-			shader_desc.stage == GfxShaderStage::LIB ? library_recompiled_event.Broadcast(shader) : shader_recompiled_event.Broadcast(shader);
+			RegisterShader(shader, output);
 		}
 		void OnShaderFileChanged(std::string const& filename)
 		{
-			for (GfxShaderKey const& shader_key : file_shader_map[fs::path(filename)])
+			std::set<GfxShaderKey> shader_keys;
+			{
+				std::lock_guard lock(shader_map_mutex);
+				shader_keys = file_shader_map[fs::path(filename)];
+			}
+			GfxShaderCache::OnSourceFilesChanged();
+			for (GfxShaderKey const& shader_key : shader_keys)
 			{
-				CompileShader(shader_key);
+				HotReloadTask& hot_reload_task = hot_reload_tasks.emplace_back();
+				hot_reload_task.shader = shader_key;
+				hot_reload_task.output = std::make_unique<GfxShaderCompileOutput>();
+				hot_reload_task.compile_task = g_ThreadPool.Submit([shader_desc = GetShaderDesc(shader_key), output = hot_reload_task.output.get()]()
+					{
+						return GfxShaderCompiler::CompileShader(shader_desc, *output);
+					});
 			}
 		}
 	}
 
-	void ShaderManager::Initialize(Bool shader_debug)
+	void ShaderManager::Initialize(GfxDevice* gfx, Bool shader_debug)
 	{
 		file_watcher = std::make_unique<FileWatcher>();
 		file_watcher->AddPathToWatch(paths::ShaderDir);
@@ -605,9 +1122,69 @@ namespace adria
 			OptimizeShaders->Set(false);
 			ShaderDebugInfo->Set(true);
 		}
+
+		//without the attribute the driver may pick any lane count in the supported range, so kernels only specialize when it is unambiguous
+		GfxCapabilities const& capabilities = gfx->GetCapabilities();
+		wave_size_attribute = ShaderWaveSizeAttribute.Get() && capabilities.SupportsShaderModel(SM_6_6);
+		wave_size = ChooseWaveSize(gfx);
+		native_16bit_types = Shader16BitTypes.Get() && capabilities.SupportsNative16BitShaderOps();
+		shader_execution_reordering = ShaderExecutionReordering.Get() && capabilities.SupportsShaderExecutionReordering();
+		if (!wave_size_attribute && capabilities.GetWaveLaneCountMin() != capabilities.GetWaveLaneCountMax()) wave_size = 0;
+		ADRIA_LOG(INFO, "Wave specialized shaders compiled for wave size %u%s", wave_size, wave_size_attribute ? " with WaveSize attribute" : "");
+	}
+	void ShaderManager::WarmUp()
+	{
+		if (!WarmUpShaders.Get()) return;
+
+		Timer timer;
+		std::vector<std::future<void>> compile_tasks;
+		compile_tasks.reserve(ShaderId_Count);
+		for (Uint32 i = ShaderID_Invalid + 1; i < ShaderId_Count; ++i)
+		{
+			compile_tasks.push_back(g_ThreadPool.Submit([i]()
+				{
+					GfxShaderKey shader_key((ShaderID)i);
+					{
+						std::lock_guard lock(shader_map_mutex);
+						if (shader_map.contains(shader_key)) return;
+					}
+					CompileShader(shader_key);
+				}));
+		}
+
+		Uint64 const progress_step = std::max<Uint64>(compile_tasks.size() / 10, 1);
+		for (Uint64 i = 0; i < compile_tasks.size(); ++i)
+		{
+			compile_tasks[i].get();
+			if ((i + 1) % progress_step == 0 || i + 1 == compile_tasks.size())
+			{
+				ADRIA_LOG(INFO, "Shader warm-up: %llu/%llu shaders ready", i + 1, (Uint64)compile_tasks.size());
+			}
+		}
+		ADRIA_LOG(INFO, "Shader warm-up finished in %f s", timer.ElapsedInSeconds());
+	}
+	void ShaderManager::Update()
+	{
+		if (HotReloadShaders.Get()) file_watcher->CheckWatchedFiles();
+		std::erase_if(hot_reload_tasks, [](HotReloadTask& hot_reload_task)
+			{
+				if (hot_reload_task.compile_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+				if (hot_reload_task.compile_task.get())
+				{
+					RegisterShader(hot_reload_task.shader, *hot_reload_task.output);
+				}
+				else
+				{
+					ADRIA_LOG(WARNING, "Hot reload of shader %s failed, keeping the previous version", GetShaderSource(hot_reload_task.shader).c_str());
+				}
+				return true;
+			});
+		GfxPipelineState::UpdatePendingPipelineStates();
 	}
 	void ShaderManager::Destroy()
 	{
+		for (HotReloadTask& hot_reload_task : hot_reload_tasks) hot_reload_task.compile_task.wait();
+		hot_reload_tasks.clear();
 		file_watcher = nullptr;
 		shader_map.clear();
 	}
@@ -618,11 +1195,20 @@ namespace adria
 
 	GfxShader const& ShaderManager::GetGfxShader(GfxShaderKey const& shader_key)
 	{
-		if (shader_map.contains(shader_key)) return shader_map[shader_key];
+		{
+			std::lock_guard lock(shader_map_mutex);
+			if (auto it = shader_map.find(shader_key); it != shader_map.end()) return it->second;
+		}
 		CompileShader(shader_key);
+		std::lock_guard lock(shader_map_mutex);
 		return shader_map[shader_key];
 	}
 
+	Uint32 ShaderManager::GetWaveSize()
+	{
+		return wave_size;
+	}
+
 	ShaderRecompiledEvent& ShaderManager::GetShaderRecompiledEvent()
 	{
 		return shader_recompiled_event;
@@ -631,5 +1217,9 @@ namespace adria
 	{
 		return library_recompiled_event;
 	}
+	std::recursive_mutex& ShaderManager::GetEventMutex()
+	{
+		return shader_event_mutex;
+	}
 }
 
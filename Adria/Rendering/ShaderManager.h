@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include "Utilities/Delegate.h"
 
 namespace adria
@@ -13,52 +14,96 @@ namespace adria
 		VS_Sky,
 		PS_Sky,
 		CS_MinimalAtmosphereSky,
+		CS_SkyIrradianceSH,
 		CS_HosekWilkieSky,
 		VS_FullscreenTriangle,
 		VS_GBuffer,
+		VS_MotionVectorsDynamic,
 		PS_GBuffer,
+		PS_MotionVectorsDynamic,
+		AS_GBuffer,
+		MS_GBuffer,
 		VS_Shadow,
 		PS_Shadow,
+		AS_Shadow,
+		MS_Shadow,
 		VS_LensFlare,
 		GS_LensFlare,
 		PS_LensFlare,
 		CS_LensFlare2,
 		PS_Copy,
 		PS_Add,
+		PS_UIComposite,
+		PS_TransparentOIT,
+		PS_OITComposite,
+		PS_ForwardPlus,
 		VS_Sun,
 		VS_Simple,
 		PS_Texture,
 		PS_Solid,
 		VS_Debug,
+		VS_DebugGPUPrimitives,
 		PS_Debug,
+		CS_ClearDebugGPUPrimitives,
 		CS_Blur_Horizontal,
 		CS_Blur_Vertical,
 		CS_BloomDownsample,
 		CS_BloomUpsample,
+		CS_BloomUpsampleFused,
 		CS_GenerateMips,
 		CS_FFT_Horizontal,
 		CS_FFT_Vertical,
 		CS_InitialSpectrum,
 		CS_OceanNormals,
+		CS_OceanClipmapCull,
 		CS_Phase,
 		CS_Spectrum,
 		VS_Ocean,
 		PS_Ocean,
 		VS_Decals,
 		PS_Decals,
+		CS_DecalsTileCulling,
+		CS_DecalsApply,
+		CS_Skinning,
+		CS_PrefixScan,
+		CS_StreamCompaction,
+		CS_RadixSortHistogram,
+		CS_RadixSortScanHistogram,
+		CS_RadixSortOnesweep,
 		VS_OceanLOD,
+		VS_OceanClipmap,
 		DS_OceanLOD,
 		HS_OceanLOD,
 		VS_Rain,
 		PS_Rain,
 		CS_RainSimulation,
 		VS_RainBlocker,
+		VS_Particle,
+		PS_Particle,
+		CS_ParticleInitDeadList,
+		CS_ParticleEmit,
+		CS_ParticleSimulate,
+		CS_ParticleBuildArgs,
+		CS_ParticleSortInitial,
+		CS_ParticleSortStep,
+		CS_ParticleSortInner,
+		VS_Terrain,
+		PS_Terrain,
+		CS_TerrainClipmapCull,
+		CS_TerrainVirtualTextureUpdate,
+		CS_VideoCaptureConvert,
 		CS_Picking,
 		CS_BuildHistogram,
 		CS_HistogramReduction,
 		CS_Ssao,
 		CS_Hbao,
+		CS_Gtao,
+		CS_GtaoTemporal,
+		CS_GtaoDenoise,
+		CS_HalfResDownsample,
+		CS_BilateralUpsample,
 		CS_Ssr,
+		CS_SsrResolve,
 		CS_ExponentialHeightFog,
 		CS_Tonemap,
 		CS_MotionVectors,
@@ -68,6 +113,8 @@ namespace adria
 		CS_FilmEffects,
 		CS_Ambient,
 		CS_Clouds,
+		CS_CloudsReconstruct,
+		CS_CloudShadow,
 		CS_CloudDetail,
 		CS_CloudShape,
 		CS_CloudType,
@@ -75,11 +122,21 @@ namespace adria
 		PS_CloudsCombine,
 		CS_Taa,
 		CS_DeferredLighting,
+		CS_DeferredLightingClearTileArgs,
+		CS_DeferredLightingClassifyTiles,
 		CS_VolumetricLighting,
 		CS_TiledDeferredLighting,
+		CS_TiledLightBounds,
+		CS_TiledCoarseCulling,
 		CS_ClusteredDeferredLighting,
 		CS_ClusterBuilding,
-		CS_ClusterCulling,
+		CS_ClusterMarkActive,
+		CS_ClusterCompact,
+		CS_ClusterLightCount,
+		CS_ClusterPrefixSum,
+		CS_ClusterLightAssign,
+		CS_RTRClassify,
+		CS_RTRRayArgs,
 		CS_ClearCounters,
 		CS_CullInstances,
 		CS_BuildMeshletCullArgs,
@@ -87,35 +144,64 @@ namespace adria
 		CS_BuildMeshletDrawArgs,
 		MS_DrawMeshlets,
 		PS_DrawMeshlets,
+		PS_DrawMeshletsVisibility,
+		PS_DrawMeshletsShadowMask,
+		CS_VisibilityBufferMaterial,
 		CS_BuildInstanceCullArgs,
 		CS_InitializeHZB,
 		CS_HZBMips,
-		CS_RTAOFilter,
+		CS_OcclusionQuery,
+		CS_SPD,
+		CS_RayTracedShadows,
+		CS_PathTracingResolve,
+		CS_RayTracedAmbientOcclusion,
+		CS_RTDenoiserTemporal,
+		CS_RTDenoiserAtrous,
 		CS_RendererOutput,
 		CS_DDGIUpdateIrradiance,
 		CS_DDGIUpdateDistance,
+		CS_DDGIRelocateProbes,
+		CS_DDGIClassifyProbes,
+		CS_DDGIResetProbes,
+		CS_DDGIRayTraceInline,
 		VS_DDGIVisualize,
 		PS_DDGIVisualize,
 		CS_DepthOfField_ComputeCoC,
 		CS_DepthOfField_ComputeSeparatedCoC,
-		CS_DepthOfField_DownsampleCoC,
 		CS_DepthOfField_ComputePrefilteredTexture,
 		CS_DepthOfField_BokehFirstPass,
 		CS_DepthOfField_BokehSecondPass,
 		CS_DepthOfField_ComputePostfilteredTexture,
 		CS_DepthOfField_Combine,
+		CS_DepthOfField_ClearTileArgs,
+		CS_DepthOfField_ClassifyTiles,
+		CS_VolumetricFog_DensityInjection,
 		CS_VolumetricFog_LightInjection,
 		CS_VolumetricFog_ScatteringIntegration,
 		PS_VolumetricFog_CombineFog,
 		PS_VRSOverlay,
+		CS_VRSContentAdaptive,
+		CS_ReSTIRDI_InitialSampling,
+		CS_ReSTIRDI_TemporalResampling,
+		CS_ReSTIRDI_SpatialResampling,
+		CS_ReSTIRDI_Shading,
 		CS_ReSTIRGI_InitialSampling,
 		CS_ReSTIRGI_TemporalResampling,
 		CS_ReSTIRGI_SpatialResampling,
+		CS_ReSTIRGI_Resolve,
+		CS_VirtualShadowMapReset,
+		CS_VirtualShadowMapMarkPages,
+		CS_VirtualShadowMapFreePages,
+		CS_VirtualShadowMapAllocatePages,
+		CS_VirtualShadowMapClearPages,
+		PS_VirtualShadowMap,
+		CS_GenerateMips,
 		LIB_DDGIRayTracing,
 		LIB_Shadows,
 		LIB_AmbientOcclusion,
 		LIB_Reflections,
 		LIB_PathTracing,
+		LIB_CullMeshletsWorkGraph,
 		ShaderId_Count
 	};
 
@@ -124,13 +210,18 @@ namespace adria
 	class ShaderManager
 	{
 	public:
-		static void Initialize(Bool shader_debug);
+		static void Initialize(GfxDevice* gfx, Bool shader_debug);
+		static void WarmUp();
+		static void Update();
 		static void Destroy();
 		static void CheckIfShadersHaveChanged();
 
 		static ShaderRecompiledEvent& GetShaderRecompiledEvent();
 		static LibraryRecompiledEvent& GetLibraryRecompiledEvent();
+		static std::recursive_mutex& GetEventMutex();
 		static GfxShader const& GetGfxShader(GfxShaderKey const& shader_key);
+		//wave size the specialized compute kernels are compiled for, 0 if the lane count can't be guaranteed
+		static Uint32 GetWaveSize();
 	};
 	#define GetGfxShader(key) ShaderManager::GetGfxShader(key)
 }
\ No newline at end of file
@@ -56,12 +56,27 @@ namespace adria
 		Int32  materials_idx;
 		Int32  instances_idx;
 		Int32  ddgi_volumes_idx;
+		Int32  ddgi_volume_count;
+		Int32  restir_gi_irradiance_idx;
+		Int32  sky_sh_idx;
 		Int32  printf_buffer_idx;
+		Int32  debug_primitive_args_idx;
+		Int32  debug_primitive_vertices_idx;
 
 		Int32  rain_splash_diffuse_idx;
 		Int32  rain_splash_bump_idx;
 		Int32  rain_blocker_map_idx;
 		Float  rain_total_time;
+
+		Vector3 lod_camera_position;
+		Float   lod_error_scale;
+
+		Int32   light_tree_nodes_idx;
+		Int32   light_tree_infinite_lights_idx;
+		Uint32  light_tree_infinite_light_count;
+		Int32   cloud_shadow_map_idx;
+
+		Vector4 cloud_shadow_params;
 	};
 
 	struct LightGPU
@@ -82,7 +97,41 @@ namespace adria
 		Int32 shadow_texture_index;
 		Int32 shadow_matrix_index;
 		Int32 shadow_mask_index;
-		Int32 padd;
+		Int32 shadow_page_table_index;
+	};
+
+	//interior nodes are followed by their first child, child_or_light_index is the second child. leaves store the index of their light
+	struct LightTreeNodeGPU
+	{
+		Vector3 bounds_min;
+		Float   power;
+		Vector3 bounds_max;
+		Uint32  child_or_light_index;
+		Vector3 cone_axis;
+		Float   cos_theta_o;
+		Float   cos_theta_e;
+		Bool32  is_leaf;
+		PAD;
+		PAD;
+	};
+
+	struct DecalGPU
+	{
+		Matrix model_matrix;
+		Matrix transposed_inverse_model;
+		Uint32 decal_type;
+		Uint32 decal_albedo_idx;
+		Uint32 decal_normal_idx;
+		Bool32 modify_normals;
+	};
+
+	struct MeshLODGPU
+	{
+		Uint32 first_index;
+		Uint32 index_count;
+		Uint32 first_meshlet;
+		Uint32 meshlet_count;
+		Float  error;
 	};
 
 	struct MeshGPU
@@ -97,6 +146,11 @@ namespace adria
 		Uint32 meshlet_vertices_offset;
 		Uint32 meshlet_triangles_offset;
 		Uint32 meshlet_count;
+		Uint32 vertex_layout;
+		Uint32 lod_count;
+		MeshLODGPU lods[4];
+		Uint32 cluster_lods_offset;
+		Uint32 cluster_count;
 	};
 
 	struct MaterialGPU
@@ -133,12 +187,22 @@ namespace adria
 	{
 		Matrix world_matrix;
 		Matrix inverse_world_matrix;
+		Matrix prev_world_matrix;
 		Vector3 bb_origin;
 		PAD;
 		Vector3 bb_extents;
 		Uint32 instance_id;
 		Uint32 material_idx;
 		Uint32 mesh_index;
-		PAD[2];
+		Uint32 alpha_mode;
+		//deformed vertices written by the skinning pass, -1 if the instance reads the rest pose geometry
+		Int32  skinned_vertices_idx;
+		Uint32 skinned_positions_offset;
+		Uint32 skinned_prev_positions_offset;
+		Uint32 skinned_normals_offset;
+		Uint32 skinned_tangents_offset;
+		PAD;
+		PAD;
+		PAD;
 	};
 }
\ No newline at end of file
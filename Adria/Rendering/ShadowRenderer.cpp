@@ -4,10 +4,15 @@
 #include "ShaderManager.h"
 #include "BlackboardData.h"
 #include "ShaderStructs.h"
+#include "GPUDrivenGBufferPass.h"
+#include "Meshlet.h"
+#include "Math/BoundingVolumeHierarchy.h"
 #include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxShader.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
 #include "Graphics/GfxReflection.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
@@ -20,6 +25,12 @@ namespace adria
 {
 	static TAutoConsoleVariable<Float> CascadesSplitLambda("r.Shadows.CascadesSplitLambda", 0.5f, "Lambda used when calculating cascades split");
 	static TAutoConsoleVariable<Float> ShadowFarFactor("r.Shadows.FarFactor", 1.2f, "Far factor used to calculate projection matrices of directional light");
+	static TAutoConsoleVariable<Bool>  GpuDrivenShadows("r.Shadows.GpuDriven", true, "Render shadow maps with the GPU driven culling pipeline when it is enabled");
+	static TAutoConsoleVariable<Bool>  ShadowMeshShaders("r.Shadows.MeshShaders", true, "Draw shadow casters with amplification and mesh shaders that cull meshlets per light view when supported");
+	static TAutoConsoleVariable<Bool>  VirtualShadowMaps("r.Shadows.Virtual", false, "Use a virtual shadow map with cached pages instead of cascades for directional lights");
+	static TAutoConsoleVariable<Float> VirtualShadowMapRadius("r.Shadows.Virtual.Radius", 128.0f, "Half extent in world units covered by the directional light virtual shadow map");
+	static TAutoConsoleVariable<Bool>  CacheShadowMaps("r.Shadows.Cache", true, "Keep spot and point light shadow atlas tiles across frames and re-render them only when their casters change");
+	static TAutoConsoleVariable<Float> ShadowAtlasResolutionScale("r.Shadows.Atlas.ResolutionScale", 1.0f, "Scale applied to the screen size of spot and point lights when picking their shadow atlas tile resolution");
 	static TAutoConsoleVariable<Float> ShadowLightDistanceFactor("r.Shadows.LightDistanceFactor", 1.0f, "Factor used to calculate projection matrices of directional light");
 
 	namespace
@@ -151,6 +162,28 @@ namespace adria
 
 			return { V,P };
 		}
+		std::pair<Matrix, Matrix> LightViewProjection_Virtual(Light const& light, Vector3 const& center, Float radius, std::vector<BoundingObject>& bounding_objects)
+		{
+			Float const far_factor = ShadowFarFactor.Get();
+
+			Vector3 light_dir = XMVector3Normalize(light.direction);
+			Matrix V = XMMatrixLookAtLH(center, center + light_dir * radius, Vector3::Up);
+
+			Float l = -radius;
+			Float b = -radius;
+			Float n = -radius - far_factor * radius;
+			Float r = radius;
+			Float t = radius;
+			Float f = radius * far_factor;
+			Matrix P = XMMatrixOrthographicOffCenterLH(l, r, b, t, n, f);
+
+			BoundingBox box;
+			BoundingBox::CreateFromPoints(box, Vector4(l, b, n, 1.0f), Vector4(r, t, f, 1.0f));
+			box.Transform(box, V.Invert());
+			bounding_objects.emplace_back(box);
+
+			return { V,P };
+		}
 		std::pair<Matrix, Matrix> LightViewProjection_Cascades(Light const& light, Camera const& camera, Matrix const& projection_matrix, Uint32 shadow_cascade_size, std::vector<BoundingObject>& bounding_objects)
 		{
 			Float const far_factor = ShadowFarFactor.Get();
@@ -210,10 +243,26 @@ namespace adria
 
 			return { V,P };
 		}
+
+		QuadTreeAllocator::Allocation ShadowAtlasTileInterior(QuadTreeAllocator::Allocation const& tile, Uint32 border)
+		{
+			return QuadTreeAllocator::Allocation{ .x = tile.x + border, .y = tile.y + border, .size = tile.size - 2 * border };
+		}
+		//maps the clip space of a light view into its atlas tile, so the same matrix is used for rendering with a scissor and for sampling
+		Matrix ShadowAtlasTileTransform(QuadTreeAllocator::Allocation const& tile_interior, Uint32 atlas_size)
+		{
+			Float const scale = (Float)tile_interior.size / atlas_size;
+			Float const center_x = (tile_interior.x + tile_interior.size * 0.5f) / atlas_size * 2.0f - 1.0f;
+			Float const center_y = 1.0f - (tile_interior.y + tile_interior.size * 0.5f) / atlas_size * 2.0f;
+			return Matrix(scale, 0.0f, 0.0f, 0.0f,
+						  0.0f, scale, 0.0f, 0.0f,
+						  0.0f, 0.0f, 1.0f, 0.0f,
+						  center_x, center_y, 0.0f, 1.0f);
+		}
 	}
 
 	ShadowRenderer::ShadowRenderer(entt::registry& reg, GfxDevice* gfx, Uint32 width, Uint32 height) : reg(reg), gfx(gfx), width(width), height(height),
-		ray_traced_shadows_pass(gfx, width, height) 
+		ray_traced_shadows_pass(gfx, width, height), virtual_shadow_map_pass(gfx, width, height), shadow_atlas_allocator(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MIN_TILE_SIZE)
 	{
 		CreatePSOs();
 	}
@@ -225,6 +274,12 @@ namespace adria
 		frame_cbuffer.cascade_splits = Vector4(split_distances[0], split_distances[1], split_distances[2], split_distances[3]);
 	}
 
+	void ShadowRenderer::OnLightChanged()
+	{
+		for (auto& [light_id, entry] : shadow_atlas_entries) entry.static_casters_hashes.fill(0);
+		virtual_shadow_map_pass.Invalidate();
+	}
+
 	void ShadowRenderer::GUI()
 	{
 		QueueGUI([&]()
@@ -233,6 +288,14 @@ namespace adria
 				{
 					ImGui::SliderFloat("Cascades Split Lambda", CascadesSplitLambda.GetPtr(), 0.0f, 1.0f);
 					ImGui::SliderFloat("Far Plane Factor", ShadowFarFactor.GetPtr(), 0.1f, 4.0f);
+					ImGui::Checkbox("Virtual Shadow Maps", VirtualShadowMaps.GetPtr());
+					if (VirtualShadowMaps.Get())
+					{
+						ImGui::SliderFloat("Virtual Shadow Map Radius", VirtualShadowMapRadius.GetPtr(), 16.0f, 1024.0f);
+					}
+					ImGui::SliderFloat("Atlas Resolution Scale", ShadowAtlasResolutionScale.GetPtr(), 0.125f, 4.0f);
+					ImGui::Checkbox("Cache Atlas Tiles", CacheShadowMaps.GetPtr());
+					ImGui::Text("Atlas Usage: %.1f%%", 100.0f * shadow_atlas_allocator.GetUsedArea() / (Float(SHADOW_ATLAS_SIZE) * SHADOW_ATLAS_SIZE));
 
 					ImGui::TreePop();
 					ImGui::Separator();
@@ -304,28 +367,6 @@ namespace adria
 				}
 			}
 			break;
-			case LightType::Point:
-			{
-				if (light_shadow_maps[light_id].size() != 6)
-				{
-					light_shadow_maps[light_id].clear();
-					light_shadow_map_srvs[light_id].clear();
-					light_shadow_map_dsvs[light_id].clear();
-					for (Uint32 i = 0; i < 6; ++i) AddShadowMap(light_id, SHADOW_CUBE_SIZE);
-				}
-			}
-			break;
-			case LightType::Spot:
-			{
-				if (light_shadow_maps[light_id].size() != 1)
-				{
-					light_shadow_maps[light_id].clear();
-					light_shadow_map_srvs[light_id].clear();
-					light_shadow_map_dsvs[light_id].clear();
-					AddShadowMap(light_id, SHADOW_MAP_SIZE);
-				}
-			}
-			break;
 			}
 
 			for (Uint64 j = 0; j < light_shadow_maps[light_id].size(); ++j)
@@ -346,8 +387,8 @@ namespace adria
 			auto& light = light_view.get<Light>(e);
 			if (light.casts_shadows)
 			{
-				if (light.type == LightType::Directional && light.use_cascades) current_light_matrices_count += SHADOW_CASCADE_COUNT;
-				else if (light.type == LightType::Point) current_light_matrices_count += 6;
+				if (light.type == LightType::Directional && light.use_cascades && !VirtualShadowMaps.Get()) current_light_matrices_count += SHADOW_CASCADE_COUNT;
+				else if (light.type == LightType::Point) current_light_matrices_count += POINT_LIGHT_FACE_COUNT;
 				else current_light_matrices_count++;
 			}
 		}
@@ -369,21 +410,68 @@ namespace adria
 			}
 		}
 
+		AllocateShadowAtlasTiles(*camera);
+
 		bounding_objects.clear();
+		shadow_views.clear();
 		std::vector<Matrix> light_matrices;
 		light_matrices.reserve(light_matrices_count);
+		auto AddShadowAtlasViews = [&](Light& light, Uint64 light_id)
+		{
+			light_shadow_maps.erase(light_id);
+			light_shadow_map_srvs.erase(light_id);
+			light_shadow_map_dsvs.erase(light_id);
+
+			auto it = shadow_atlas_entries.find(light_id);
+			ShadowAtlasEntry const* entry = it != shadow_atlas_entries.end() && it->second.tile_count > 0 ? &it->second : nullptr;
+			Uint32 const view_count = light.type == LightType::Point ? POINT_LIGHT_FACE_COUNT : 1;
+			for (Uint32 i = 0; i < view_count; ++i)
+			{
+				auto [V, P] = light.type == LightType::Point ? LightViewProjection_Point(light, i, bounding_objects) : LightViewProjection_Spot(light, bounding_objects);
+				if (entry) P = P * ShadowAtlasTileTransform(ShadowAtlasTileInterior(entry->tiles[i], SHADOW_ATLAS_TILE_BORDER), SHADOW_ATLAS_SIZE);
+				light_matrices.push_back(XMMatrixTranspose(V * P));
+				shadow_views.push_back({ V, P });
+			}
+			if (!entry) return;
+
+			//point lights index one descriptor per face
+			GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(view_count);
+			for (Uint32 i = 0; i < view_count; ++i) gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(dst_descriptor.GetIndex() + i), shadow_atlas_srv);
+			light.shadow_texture_index = (Int32)dst_descriptor.GetIndex();
+		};
+
 		for (auto e : light_view)
 		{
 			auto& light = light_view.get<Light>(e);
 			light.shadow_mask_index = -1;
 			light.shadow_texture_index = -1;
+			light.shadow_page_table_index = -1;
 			if (light.casts_shadows)
 			{
 				if (light.ray_traced_shadows) continue;
 				light.shadow_matrix_index = (Uint32)light_matrices.size();
 				if (light.type == LightType::Directional)
 				{
-					if (light.use_cascades)
+					if (VirtualShadowMaps.Get())
+					{
+						Uint64 const light_id = entt::to_integral(e);
+						light_shadow_maps.erase(light_id);
+						light_shadow_map_srvs.erase(light_id);
+						light_shadow_map_dsvs.erase(light_id);
+
+						Float const radius = VirtualShadowMapRadius.Get();
+						Vector3 const center = virtual_shadow_map_pass.GetViewCenter(Vector3(light.direction), camera->Position(), radius);
+						auto const& [V, P] = LightViewProjection_Virtual(light, center, radius, bounding_objects);
+						light_matrices.push_back(XMMatrixTranspose(V * P));
+						shadow_views.push_back({ V, P });
+
+						GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(2);
+						gfx->CopyDescriptors(1, dst_descriptor, virtual_shadow_map_pass.GetPhysicalPagesSRV());
+						gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(dst_descriptor.GetIndex() + 1), virtual_shadow_map_pass.GetPageTableSRV());
+						light.shadow_texture_index = (Int32)dst_descriptor.GetIndex();
+						light.shadow_page_table_index = (Int32)dst_descriptor.GetIndex() + 1;
+					}
+					else if (light.use_cascades)
 					{
 						std::array<Matrix, SHADOW_CASCADE_COUNT> proj_matrices = RecalculateProjectionMatrices(*camera, CascadesSplitLambda.Get(), split_distances);
 						AddShadowMaps(light, entt::to_integral(e));
@@ -391,6 +479,7 @@ namespace adria
 						{
 							auto const& [V, P] = LightViewProjection_Cascades(light, *camera, proj_matrices[i], SHADOW_CASCADE_MAP_SIZE, bounding_objects);
 							light_matrices.push_back(XMMatrixTranspose(V * P));
+							shadow_views.push_back({ V, P });
 						}
 					}
 					else
@@ -398,23 +487,13 @@ namespace adria
 						AddShadowMaps(light, entt::to_integral(e));
 						auto const& [V, P] = LightViewProjection_Directional(light, *camera, SHADOW_MAP_SIZE, bounding_objects);
 						light_matrices.push_back(XMMatrixTranspose(V * P));
+						shadow_views.push_back({ V, P });
 					}
 
 				}
-				else if (light.type == LightType::Point)
-				{
-					AddShadowMaps(light, entt::to_integral(e));
-					for (Uint32 i = 0; i < 6; ++i)
-					{
-						auto const& [V, P] = LightViewProjection_Point(light, i, bounding_objects);
-						light_matrices.push_back(XMMatrixTranspose(V * P));
-					}
-				}
-				else if (light.type == LightType::Spot)
+				else
 				{
-					AddShadowMaps(light, entt::to_integral(e));
-					auto const& [V, P] = LightViewProjection_Spot(light, bounding_objects);
-					light_matrices.push_back(XMMatrixTranspose(V * P));
+					AddShadowAtlasViews(light, entt::to_integral(e));
 				}
 			}
 			else if (light.ray_traced_shadows)
@@ -433,101 +512,302 @@ namespace adria
 		}
 	}
 
-	void ShadowRenderer::AddShadowMapPasses(RenderGraph& rg)
+	void ShadowRenderer::AllocateShadowAtlasTiles(Camera const& camera)
+	{
+		struct ShadowAtlasRequest
+		{
+			Uint64 light_id;
+			Uint32 tile_count;
+			Uint32 tile_size;
+		};
+		std::vector<ShadowAtlasRequest> requests;
+
+		auto light_view = reg.view<Light>();
+		for (auto e : light_view)
+		{
+			Light const& light = light_view.get<Light>(e);
+			if (!light.casts_shadows || light.ray_traced_shadows || light.type == LightType::Directional) continue;
+			Uint32 const tile_count = light.type == LightType::Point ? POINT_LIGHT_FACE_COUNT : 1;
+			requests.push_back(ShadowAtlasRequest{ entt::to_integral(e), tile_count, GetShadowAtlasTileSize(light, camera) });
+		}
+
+		auto FreeEntry = [&](ShadowAtlasEntry& entry)
+		{
+			for (Uint32 i = 0; i < entry.tile_count; ++i) shadow_atlas_allocator.Free(entry.tiles[i]);
+			entry = ShadowAtlasEntry{};
+		};
+
+		//tiles are kept while the wanted size stays within one level below the allocated one, so lights don't oscillate between two sizes
+		std::unordered_map<Uint64, ShadowAtlasEntry> entries;
+		for (ShadowAtlasRequest const& request : requests)
+		{
+			auto it = shadow_atlas_entries.find(request.light_id);
+			if (it == shadow_atlas_entries.end()) continue;
+			ShadowAtlasEntry& entry = it->second;
+			Bool const keep = entry.tile_count == request.tile_count && (entry.tile_size == request.tile_size || entry.tile_size == request.tile_size * 2);
+			if (!keep) FreeEntry(entry);
+			entries[request.light_id] = entry;
+			shadow_atlas_entries.erase(it);
+		}
+		for (auto& [light_id, entry] : shadow_atlas_entries) FreeEntry(entry);
+		shadow_atlas_entries = std::move(entries);
+
+		//larger lights are placed first and shrink until they fit, lights that find no space in a full atlas stay unshadowed
+		std::sort(requests.begin(), requests.end(), [](ShadowAtlasRequest const& lhs, ShadowAtlasRequest const& rhs) { return lhs.tile_size > rhs.tile_size; });
+		for (ShadowAtlasRequest const& request : requests)
+		{
+			ShadowAtlasEntry& entry = shadow_atlas_entries[request.light_id];
+			if (entry.tile_count > 0) continue;
+
+			for (Uint32 tile_size = request.tile_size; tile_size >= SHADOW_ATLAS_MIN_TILE_SIZE && entry.tile_count == 0; tile_size /= 2)
+			{
+				Uint32 allocated = 0;
+				for (; allocated < request.tile_count; ++allocated)
+				{
+					entry.tiles[allocated] = shadow_atlas_allocator.Allocate(tile_size);
+					if (!entry.tiles[allocated].IsValid()) break;
+				}
+				if (allocated == request.tile_count)
+				{
+					entry.tile_count = request.tile_count;
+					entry.tile_size = tile_size;
+					entry.static_casters_hashes.fill(0);
+				}
+				else
+				{
+					for (Uint32 i = 0; i < allocated; ++i) shadow_atlas_allocator.Free(entry.tiles[i]);
+				}
+			}
+		}
+
+		if (!shadow_atlas && !requests.empty())
+		{
+			GfxTextureDesc atlas_desc{};
+			atlas_desc.width = SHADOW_ATLAS_SIZE;
+			atlas_desc.height = SHADOW_ATLAS_SIZE;
+			atlas_desc.format = GfxFormat::R32_TYPELESS;
+			atlas_desc.clear_value = GfxClearValue(1.0f, 0);
+			atlas_desc.bind_flags = GfxBindFlag::DepthStencil | GfxBindFlag::ShaderResource;
+			atlas_desc.initial_state = GfxResourceState::DSV;
+			shadow_atlas = gfx->CreateTexture(atlas_desc);
+			shadow_atlas_srv = gfx->CreateTextureSRV(shadow_atlas.get());
+		}
+	}
+
+	Uint32 ShadowRenderer::GetShadowAtlasTileSize(Light const& light, Camera const& camera) const
+	{
+		//resolution follows the projected diameter of the light bounds, lights enclosing the camera get the largest tiles
+		Float screen_size = (Float)SHADOW_ATLAS_MAX_TILE_SIZE;
+		Float const distance = Vector3::Distance(Vector3(light.position), camera.Position());
+		if (distance > light.range)
+		{
+			screen_size = light.range / (distance * std::tan(camera.Fov() * 0.5f)) * height;
+		}
+		//a cube face spans 90 degrees so it needs about half the resolution of the whole light
+		if (light.type == LightType::Point) screen_size *= 0.5f;
+
+		Uint32 const tile_size = (Uint32)std::max(screen_size * ShadowAtlasResolutionScale.Get(), 1.0f);
+		return std::clamp(std::bit_ceil(tile_size), SHADOW_ATLAS_MIN_TILE_SIZE, SHADOW_ATLAS_MAX_TILE_SIZE);
+	}
+
+	void ShadowRenderer::AddShadowMapPasses(RenderGraph& rg, FrameCBuffer const& frame_cbuffer, GPUDrivenGBufferPass* gpu_driven_pass)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Bool const gpu_driven_shadows = gpu_driven_pass && GpuDrivenShadows.Get();
+
+		auto AddShadowMapPass = [&](Light const& light, Char const* name, RGResourceName shadow_map_name, Uint32 shadow_map_size, Uint32 matrix_offset, QuadTreeAllocator::Allocation const& atlas_tile = {})
+		{
+			Int32 light_index = light.light_index;
+			Int32 light_matrix_index = light.shadow_matrix_index;
+			Uint32 shadow_view_index = light_matrix_index + matrix_offset;
+
+			if (gpu_driven_shadows)
+			{
+				ShadowView const& shadow_view = shadow_views[shadow_view_index];
+				FrameCBuffer view_cbuffer = frame_cbuffer;
+				view_cbuffer.view = shadow_view.view;
+				view_cbuffer.projection = shadow_view.projection;
+				view_cbuffer.view_projection = shadow_view.view * shadow_view.projection;
+				view_cbuffer.inverse_view = view_cbuffer.view.Invert();
+				view_cbuffer.inverse_projection = view_cbuffer.projection.Invert();
+				view_cbuffer.inverse_view_projection = view_cbuffer.view_projection.Invert();
+				view_cbuffer.prev_view = view_cbuffer.view;
+				view_cbuffer.prev_projection = view_cbuffer.projection;
+				view_cbuffer.prev_view_projection = view_cbuffer.view_projection;
+				view_cbuffer.camera_position = view_cbuffer.inverse_view.Translation();
+				view_cbuffer.camera_forward = Vector3(view_cbuffer.inverse_view._31, view_cbuffer.inverse_view._32, view_cbuffer.inverse_view._33);
+				view_cbuffer.camera_jitter_x = 0.0f;
+				view_cbuffer.camera_jitter_y = 0.0f;
+				view_cbuffer.render_resolution_x = (Float)shadow_map_size;
+				view_cbuffer.render_resolution_y = (Float)shadow_map_size;
+
+				GfxDynamicAllocation view_cbuffer_allocation = gfx->GetDynamicAllocator()->AllocateCBuffer<FrameCBuffer>();
+				view_cbuffer_allocation.Update(view_cbuffer);
+				gpu_driven_pass->AddShadowPasses(rg, shadow_map_name, shadow_map_size, view_cbuffer_allocation.gpu_address, shadow_view_index, atlas_tile);
+				return;
+			}
+
+			rg.AddPass<void>(name,
+				[=](RenderGraphBuilder& builder)
+				{
+					builder.WriteDepthStencil(shadow_map_name, atlas_tile.IsValid() ? RGLoadStoreAccessOp::Preserve_Preserve : RGLoadStoreAccessOp::Clear_Preserve);
+					builder.SetViewport(shadow_map_size, shadow_map_size);
+				},
+				[=](RenderGraphContext& context, GfxCommandList* cmd_list)
+				{
+					if (atlas_tile.IsValid()) cmd_list->SetScissorRect(atlas_tile.x, atlas_tile.y, atlas_tile.size, atlas_tile.size);
+					cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+					ShadowMapPass_Common(cmd_list, shadow_psos.get(), shadow_mesh_psos.get(), light_index, light_matrix_index, matrix_offset);
+				}, RGPassType::Graphics, atlas_tile.IsValid() ? RGPassFlags::None : RGPassFlags::ScheduleLate);
+		};
+
+		struct ShadowAtlasView
+		{
+			Light const* light;
+			Uint32 face;
+			QuadTreeAllocator::Allocation tile;
+		};
+		std::vector<ShadowAtlasView> atlas_views;
+		Bool atlas_used = false;
+
 		auto light_view = reg.view<Light>();
 		for (auto e : light_view)
 		{
 			auto& light = light_view.get<Light>(e);
 			if (!light.casts_shadows) continue;
-			Int32 light_index = light.light_index;
-			Int32 light_matrix_index = light.shadow_matrix_index;
 			Uint64 light_id = entt::to_integral(e);
 
 			if (light.type == LightType::Directional)
 			{
-				if (light.use_cascades)
+				if (VirtualShadowMaps.Get())
+				{
+					AddVirtualShadowMapPasses(rg, light);
+				}
+				else if (light.use_cascades)
 				{
 					for (Uint32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
 					{
-						rg.ImportTexture(RG_NAME_IDX(ShadowMap, light_matrix_index + i), light_shadow_maps[light_id][i].get());
 						std::string name = "Cascade Shadow Pass" + std::to_string(i);
-						rg.AddPass<void>(name.c_str(),
-							[=](RenderGraphBuilder& builder)
-							{
-								builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light_matrix_index + i), RGLoadStoreAccessOp::Clear_Preserve);
-								builder.SetViewport(SHADOW_CASCADE_MAP_SIZE, SHADOW_CASCADE_MAP_SIZE);
-							},
-							[=](RenderGraphContext& context, GfxCommandList* cmd_list)
-							{
-								cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-								ShadowMapPass_Common(cmd_list, light.type, light_index, light_matrix_index, i);
-							}, RGPassType::Graphics);
-
-						shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light_matrix_index + i));
+						RGResourceName shadow_map_name = RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i);
+						rg.ImportTexture(shadow_map_name, light_shadow_maps[light_id][i].get());
+						AddShadowMapPass(light, name.c_str(), shadow_map_name, SHADOW_CASCADE_MAP_SIZE, i);
+						shadow_rendered_event.Broadcast(shadow_map_name);
 					}
 				}
 				else
 				{
-					rg.ImportTexture(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index), light_shadow_maps[light_id][0].get());
-					std::string name = "Directional Shadow Pass";
-					rg.AddPass<void>(name.c_str(),
-						[=](RenderGraphBuilder& builder)
-						{
-							builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index), RGLoadStoreAccessOp::Clear_Preserve);
-							builder.SetViewport(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
-						},
-						[=](RenderGraphContext& context, GfxCommandList* cmd_list)
-						{
-							cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-							ShadowMapPass_Common(cmd_list, light.type, light_index, light_matrix_index, 0);
-						}, RGPassType::Graphics);
-
-					shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index));
+					RGResourceName shadow_map_name = RG_NAME_IDX(ShadowMap, light.shadow_matrix_index);
+					rg.ImportTexture(shadow_map_name, light_shadow_maps[light_id][0].get());
+					AddShadowMapPass(light, "Directional Shadow Pass", shadow_map_name, SHADOW_MAP_SIZE, 0);
+					shadow_rendered_event.Broadcast(shadow_map_name);
 				}
 			}
-			else if (light.type == LightType::Point)
+			else if (!light.ray_traced_shadows)
 			{
-				for (Uint32 i = 0; i < 6; ++i)
-				{
-					rg.ImportTexture(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i), light_shadow_maps[light_id][i].get());
-					std::string name = "Point Shadow Pass" + std::to_string(i);
-					rg.AddPass<void>(name.c_str(),
-						[=](RenderGraphBuilder& builder)
-						{
-							builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i), RGLoadStoreAccessOp::Clear_Preserve);
-							builder.SetViewport(SHADOW_CUBE_SIZE, SHADOW_CUBE_SIZE);
-						},
-						[=](RenderGraphContext& context, GfxCommandList* cmd_list)
-						{
-							cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-							ShadowMapPass_Common(cmd_list, light.type, light_index, light_matrix_index, i);
-						}, RGPassType::Graphics);
+				auto it = shadow_atlas_entries.find(light_id);
+				if (it == shadow_atlas_entries.end() || it->second.tile_count == 0) continue;
 
-					shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i));
+				atlas_used = true;
+				ShadowAtlasEntry& entry = it->second;
+				for (Uint32 i = 0; i < entry.tile_count; ++i)
+				{
+					Bool has_dynamic_casters = false;
+					Uint64 const static_casters_hash = GetStaticCastersHash(light.shadow_matrix_index + i, has_dynamic_casters);
+					Bool const cache_valid = CacheShadowMaps.Get() && !has_dynamic_casters && entry.static_casters_hashes[i] == static_casters_hash;
+					entry.static_casters_hashes[i] = has_dynamic_casters ? 0 : static_casters_hash;
+					if (!cache_valid) atlas_views.push_back(ShadowAtlasView{ &light, i, entry.tiles[i] });
 				}
 			}
-			else if (light.type == LightType::Spot)
+		}
+		if (!atlas_used) return;
+
+		rg.ImportTexture(RG_NAME(ShadowAtlas), shadow_atlas.get());
+		if (!atlas_views.empty())
+		{
+			//only the tiles that are re-rendered are cleared, cached tiles keep their depth from previous frames
+			struct ShadowAtlasClearPassData
 			{
-				rg.ImportTexture(RG_NAME_IDX(ShadowMap, light_matrix_index), light_shadow_maps[light_id][0].get());
-				std::string name = "Spot Shadow Pass";
-				rg.AddPass<void>(name.c_str(),
-					[=](RenderGraphBuilder& builder)
-					{
-						builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light_matrix_index), RGLoadStoreAccessOp::Clear_Preserve);
-						builder.SetViewport(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
-					},
-					[=](RenderGraphContext& context, GfxCommandList* cmd_list)
+				RGDepthStencilId shadow_atlas;
+			};
+			rg.AddPass<ShadowAtlasClearPassData>("Shadow Atlas Clear Pass",
+				[=](ShadowAtlasClearPassData& data, RenderGraphBuilder& builder)
+				{
+					data.shadow_atlas = builder.WriteDepthStencil(RG_NAME(ShadowAtlas), RGLoadStoreAccessOp::Preserve_Preserve);
+					builder.SetViewport(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
+				},
+				[=](ShadowAtlasClearPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+				{
+					GfxDescriptor dsv = context.GetDepthStencil(data.shadow_atlas);
+					for (ShadowAtlasView const& atlas_view : atlas_views)
 					{
-						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-						ShadowMapPass_Common(cmd_list, light.type, light_index, light_matrix_index, 0);
-					}, RGPassType::Graphics);
+						cmd_list->ClearDepth(dsv, atlas_view.tile.x, atlas_view.tile.y, atlas_view.tile.size, atlas_view.tile.size);
+					}
+				}, RGPassType::Graphics, RGPassFlags::LegacyRenderPass);
 
-				shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light_matrix_index));
+			for (ShadowAtlasView const& atlas_view : atlas_views)
+			{
+				Char const* name = atlas_view.light->type == LightType::Point ? "Point Shadow Pass" : "Spot Shadow Pass";
+				AddShadowMapPass(*atlas_view.light, name, RG_NAME(ShadowAtlas), SHADOW_ATLAS_SIZE, atlas_view.face, ShadowAtlasTileInterior(atlas_view.tile, SHADOW_ATLAS_TILE_BORDER));
 			}
 		}
+		shadow_rendered_event.Broadcast(RG_NAME(ShadowAtlas));
 	}
+	void ShadowRenderer::AddVirtualShadowMapPasses(RenderGraph& rg, Light const& light)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const light_index = light.light_index;
+		Uint32 const light_matrix_index = light.shadow_matrix_index;
+
+		Bool has_dynamic_casters = false;
+		Uint64 const static_casters_hash = GetStaticCastersHash(light_matrix_index, has_dynamic_casters);
+		virtual_shadow_map_pass.AddPageAllocationPasses(rg, light_matrix_index, static_casters_hash, has_dynamic_casters);
+
+		struct VirtualShadowMapPassData
+		{
+			RGTextureReadOnlyId  page_table;
+			RGTextureReadWriteId physical_pages;
+		};
+		rg.AddPass<VirtualShadowMapPassData>("Virtual Shadow Map Pass",
+			[=](VirtualShadowMapPassData& data, RenderGraphBuilder& builder)
+			{
+				data.page_table = builder.ReadTexture(RG_NAME(VirtualShadowMapPageTable), ReadAccess_PixelShader);
+				data.physical_pages = builder.WriteTexture(RG_NAME(VirtualShadowMapPhysicalPages));
+				builder.SetViewport(VirtualShadowMapPass::VIRTUAL_SIZE, VirtualShadowMapPass::VIRTUAL_SIZE);
+			},
+			[=](VirtualShadowMapPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.page_table),
+					ctx.GetReadWriteTexture(data.physical_pages)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct VirtualShadowMapConstants
+				{
+					Uint32 page_table_idx;
+					Uint32 physical_pages_idx;
+					Uint32 page_size;
+					Uint32 page_table_size;
+				} constants =
+				{
+					.page_table_idx = i, .physical_pages_idx = i + 1,
+					.page_size = VirtualShadowMapPass::PAGE_SIZE, .page_table_size = VirtualShadowMapPass::PAGE_TABLE_SIZE
+				};
+
+				//depth is resolved with atomics into the physical pages, only texels of dirty pages are written
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(3, constants);
+				ShadowMapPass_Common(cmd_list, virtual_shadow_map_psos.get(), nullptr, light_index, light_matrix_index, 0);
+			}, RGPassType::Graphics, RGPassFlags::ForceNoCull);
+
+		shadow_rendered_event.Broadcast(RG_NAME(VirtualShadowMapPageTable));
+		shadow_rendered_event.Broadcast(RG_NAME(VirtualShadowMapPhysicalPages));
+	}
+
 	void ShadowRenderer::AddRayTracingShadowPasses(RenderGraph& rg)
 	{
 		auto light_view = reg.view<Light>();
@@ -539,7 +819,7 @@ namespace adria
 			Uint64 light_id = entt::to_integral(e);
 
 			rg.ImportTexture(RG_NAME_IDX(LightMask, light_id), light_mask_textures[light_id].get());
-			ray_traced_shadows_pass.AddPass(rg, light_index);
+			ray_traced_shadows_pass.AddPass(rg, light_index, light_id);
 			shadow_rendered_event.Broadcast(RG_NAME_IDX(LightMask, light_id));
 		}
 	}
@@ -563,9 +843,47 @@ namespace adria
 		gfx_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
 
 		shadow_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gfx_pso_desc);
+		shadow_psos->DeclarePermutation();
+		shadow_psos->AddDefine("TRANSPARENT", "1");
+		shadow_psos->DeclarePermutation();
+		shadow_psos->Precompile();
+		shadow_psos->SetAsyncCompilation(true);
+		shadow_psos->SetFallbackPermutation();
+
+		if (gfx->GetCapabilities().SupportsMeshShaders())
+		{
+			GfxMeshShaderPipelineStateDesc mesh_pso_desc{};
+			mesh_pso_desc.root_signature = GfxRootSignatureID::Common;
+			mesh_pso_desc.AS = AS_Shadow;
+			mesh_pso_desc.MS = MS_Shadow;
+			mesh_pso_desc.PS = PS_Shadow;
+			mesh_pso_desc.rasterizer_state = gfx_pso_desc.rasterizer_state;
+			mesh_pso_desc.depth_state = gfx_pso_desc.depth_state;
+			mesh_pso_desc.dsv_format = gfx_pso_desc.dsv_format;
+
+			shadow_mesh_psos = std::make_unique<GfxMeshShaderPipelineStatePermutations>(gfx, mesh_pso_desc);
+			shadow_mesh_psos->DeclarePermutation();
+			shadow_mesh_psos->AddDefine("TRANSPARENT", "1");
+			shadow_mesh_psos->DeclarePermutation();
+			shadow_mesh_psos->Precompile();
+			shadow_mesh_psos->SetAsyncCompilation(true);
+			shadow_mesh_psos->SetFallbackPermutation();
+		}
+
+		gfx_pso_desc.PS = PS_VirtualShadowMap;
+		gfx_pso_desc.depth_state.depth_enable = false;
+		gfx_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::Zero;
+		gfx_pso_desc.dsv_format = GfxFormat::UNKNOWN;
+		virtual_shadow_map_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gfx_pso_desc);
+		virtual_shadow_map_psos->DeclarePermutation();
+		virtual_shadow_map_psos->AddDefine("TRANSPARENT", "1");
+		virtual_shadow_map_psos->DeclarePermutation();
+		virtual_shadow_map_psos->Precompile();
+		virtual_shadow_map_psos->SetAsyncCompilation(true);
+		virtual_shadow_map_psos->SetFallbackPermutation();
 	}
 
-	void ShadowRenderer::ShadowMapPass_Common(GfxCommandList* cmd_list, LightType light_type, Uint64 light_index, Uint64 matrix_index, Uint64 matrix_offset)
+	void ShadowRenderer::ShadowMapPass_Common(GfxCommandList* cmd_list, GfxGraphicsPipelineStatePermutations* psos, GfxMeshShaderPipelineStatePermutations* mesh_psos, Uint64 light_index, Uint64 matrix_index, Uint64 matrix_offset)
 	{
 		struct ShadowConstants
 		{
@@ -576,59 +894,149 @@ namespace adria
 			.light_index = (Uint32)light_index,
 			.matrix_offset = (Uint32)matrix_offset
 		};
-		auto view = reg.view<Batch>();
 		std::vector<Batch*> masked_batches, opaque_batches;
-		for (auto batch_entity : reg.view<Batch>())
-		{
-			Batch& batch = reg.get<Batch>(batch_entity);
-			if (batch.alpha_mode == MaterialAlphaMode::Opaque) opaque_batches.push_back(&batch);
-			else masked_batches.push_back(&batch);
-		}
+		ForEachShadowViewBatch(matrix_index + matrix_offset, [&](entt::entity batch_entity, Batch& batch)
+			{
+				if (batch.alpha_mode == MaterialAlphaMode::Opaque) opaque_batches.push_back(&batch);
+				else masked_batches.push_back(&batch);
+			});
 
+		GfxShaderConstantBuffer const* root_constants = GetGfxShader(VS_Shadow).GetConstantBuffer(1);
+		GfxShaderConstantBufferVariable const* root_instance_id = root_constants ? root_constants->FindVariable("instance_id") : nullptr;
+
+		Bool const use_mesh_shaders = mesh_psos && ShadowMeshShaders.Get();
+
+		std::vector<Batch*> visible_batches;
 		auto DrawBatch = [&](GfxCommandList* cmd_list, Bool masked_batch)
 		{
-			std::vector<Batch*>& batches = masked_batch ? masked_batches : opaque_batches;
-			if (masked_batch)
+			std::vector<Batch*> const& batches = masked_batch ? masked_batches : opaque_batches;
+			visible_batches.assign(batches.begin(), batches.end());
+			std::sort(visible_batches.begin(), visible_batches.end(), [](Batch const* lhs, Batch const* rhs) { return BatchDrawOrder(*lhs, *rhs); });
+
+			if (use_mesh_shaders)
 			{
-				shadow_psos->AddDefine("TRANSPARENT", "1");
+				auto IsMeshletBatch = [](Batch const* batch) { return batch->submesh->meshlet_count > 0 && batch->submesh->topology == GfxPrimitiveTopology::TriangleList; };
+				if (std::any_of(visible_batches.begin(), visible_batches.end(), IsMeshletBatch))
+				{
+					cmd_list->SetPipelineState(mesh_psos->Get(masked_batch, [masked_batch](auto& permutations) { if (masked_batch) permutations.AddDefine("TRANSPARENT", "1"); }));
+					for (Batch* batch : visible_batches)
+					{
+						if (!IsMeshletBatch(batch)) continue;
+						struct ShadowMeshConstants
+						{
+							Uint32 light_index;
+							Uint32 matrix_offset;
+							Uint32 instance_id;
+							Uint32 meshlet_count;
+							Uint32 first_meshlet;
+						} mesh_constants =
+						{
+							.light_index = (Uint32)light_index,
+							.matrix_offset = (Uint32)matrix_offset,
+							.instance_id = batch->instance_id,
+							.meshlet_count = batch->submesh->lods[batch->lod].meshlet_count,
+							.first_meshlet = batch->submesh->lods[batch->lod].first_meshlet
+						};
+						cmd_list->SetRootConstants(1, mesh_constants);
+						cmd_list->DispatchMesh(DivideAndRoundUp(mesh_constants.meshlet_count, MESHLET_CULL_GROUP_SIZE));
+					}
+					std::erase_if(visible_batches, IsMeshletBatch);
+				}
 			}
-			GfxPipelineState* pso = shadow_psos->Get();
+			if (visible_batches.empty()) return;
+
+			GfxPipelineState* pso = psos->Get(masked_batch, [masked_batch](auto& permutations) { if (masked_batch) permutations.AddDefine("TRANSPARENT", "1"); });
 			cmd_list->SetRootConstants(1, constants);
 			cmd_list->SetPipelineState(pso);
-			for (Batch* batch : batches)
+
+			struct ModelConstants
+			{
+				Uint32 instance_id;
+			};
+			static constexpr Uint64 ModelConstantsStride = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+			GfxDynamicAllocation model_constants_allocation{};
+			if (!root_instance_id)
+			{
+				model_constants_allocation = cmd_list->GetDevice()->GetDynamicAllocator()->Allocate(visible_batches.size() * ModelConstantsStride, ModelConstantsStride);
+			}
+
+			for (Uint64 i = 0; i < visible_batches.size();)
 			{
-				Bool skip_batch = false;
-				switch (light_type)
+				//consecutive instances of a submesh are drawn with one instanced draw
+				Batch* batch = visible_batches[i];
+				Uint32 instance_count = 1;
+				while (i + instance_count < visible_batches.size() && IsNextBatchInstance(*batch, instance_count, *visible_batches[i + instance_count])) ++instance_count;
+
+				ModelConstants model_constants{ .instance_id = batch->instance_id };
+				if (root_instance_id)
 				{
-				case LightType::Directional:
-					ADRIA_ASSERT(bounding_objects[matrix_index].type == BoundingObject::Box);
-					skip_batch = !bounding_objects[matrix_index].GetBox().Intersects(batch->bounding_box);
-					break;
-				case LightType::Spot:
-				case LightType::Point:
-					ADRIA_ASSERT(bounding_objects[matrix_index].type == BoundingObject::Frustum);
-					skip_batch = !bounding_objects[matrix_index].GetFrustum().Intersects(batch->bounding_box);
-					break;
-				default:
-					ADRIA_ASSERT(false);
+					cmd_list->SetRootConstants(1, &model_constants, sizeof(model_constants), root_instance_id->offset / sizeof(Uint32));
 				}
-				if (skip_batch) continue;
-
-				struct ModelConstants
+				else
 				{
-					Uint32 instance_id;
-				} model_constants{ .instance_id = batch->instance_id };
-				cmd_list->SetRootCBV(2, model_constants);
-				GfxIndexBufferView ibv(batch->submesh->buffer_address + batch->submesh->indices_offset, batch->submesh->indices_count);
-				cmd_list->SetTopology(batch->submesh->topology);
-				cmd_list->SetIndexBuffer(&ibv);
-				cmd_list->DrawIndexed(batch->submesh->indices_count);
+					model_constants_allocation.Update(&model_constants, sizeof(model_constants), i * ModelConstantsStride);
+					cmd_list->SetRootCBV(2, model_constants_allocation.gpu_address + i * ModelConstantsStride);
+				}
+				DrawSubMeshLOD(cmd_list, *batch->submesh, batch->lod, instance_count);
+				i += instance_count;
 			}
 		};
 
 		DrawBatch(cmd_list, false);
 		DrawBatch(cmd_list, true);
 	}
+	template<typename F>
+	void ShadowRenderer::ForEachShadowViewBatch(Uint64 view_index, F&& f) const
+	{
+		if (batch_bvh && !batch_bvh->Empty() && batch_bvh->GetItemCount() == batch_entities.size())
+		{
+			auto Visit = [&](Uint32 item) { f(batch_entities[item], reg.get<Batch>(batch_entities[item])); };
+			BoundingObject const& bounding_object = bounding_objects[view_index];
+			if (bounding_object.type == BoundingObject::Frustum) batch_bvh->Query(bounding_object.GetFrustum(), Visit);
+			else batch_bvh->Query(bounding_object.GetBox(), Visit);
+			return;
+		}
+
+		for (auto batch_entity : reg.view<Batch>())
+		{
+			Batch& batch = reg.get<Batch>(batch_entity);
+			if (IntersectsShadowView(view_index, batch.bounding_box)) f(batch_entity, batch);
+		}
+	}
+
+	Bool ShadowRenderer::IntersectsShadowView(Uint64 view_index, BoundingBox const& box) const
+	{
+		BoundingObject const& bounding_object = bounding_objects[view_index];
+		if (bounding_object.type == BoundingObject::Frustum) return bounding_object.GetFrustum().Intersects(box);
+		return bounding_object.GetBox().Intersects(box);
+	}
+
+	Uint64 ShadowRenderer::GetStaticCastersHash(Uint64 view_index, Bool& has_dynamic_casters) const
+	{
+		ShadowView const& shadow_view = shadow_views[view_index];
+		Matrix const view_projection = shadow_view.view * shadow_view.projection;
+
+		HashState hash;
+		hash.Combine(crc64(reinterpret_cast<Char const*>(&view_projection), sizeof(view_projection)));
+		has_dynamic_casters = false;
+		std::vector<Batch const*> static_casters;
+		ForEachShadowViewBatch(view_index, [&](entt::entity batch_entity, Batch const& batch)
+			{
+				if (batch.dynamic || reg.all_of<DynamicBatch>(batch_entity)) has_dynamic_casters = true;
+				else static_casters.push_back(&batch);
+			});
+		//the traversal order changes when the hierarchy is rebuilt, the hash must not
+		std::sort(static_casters.begin(), static_casters.end(), [](Batch const* lhs, Batch const* rhs) { return lhs->instance_id < rhs->instance_id; });
+		for (Batch const* static_caster : static_casters)
+		{
+			Batch const& batch = *static_caster;
+			hash.Combine(batch.instance_id);
+			hash.Combine((Uint64)batch.alpha_mode);
+			hash.Combine(crc64(reinterpret_cast<Char const*>(&batch.bounding_box), sizeof(batch.bounding_box)));
+		}
+		return hash;
+	}
+
 	std::array<Matrix, ShadowRenderer::SHADOW_CASCADE_COUNT> ShadowRenderer::RecalculateProjectionMatrices(Camera const& camera, Float split_lambda, std::array<Float, SHADOW_CASCADE_COUNT>& split_distances)
 	{
 		Float camera_near = camera.Near();
@@ -1,11 +1,15 @@
 #pragma once
 #include <array>
 #include <variant>
+#include <span>
 #include "RayTracedShadowsPass.h"
+#include "VirtualShadowMapPass.h"
 #include "Graphics/GfxMacros.h"
 #include "Graphics/GfxDescriptor.h"
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
 #include "Utilities/Delegate.h"
+#include "Utilities/QuadTreeAllocator.h"
+#include "entt/entity/fwd.hpp"
 
 namespace adria
 {
@@ -16,6 +20,9 @@ namespace adria
 	class RenderGraph;
 	class Camera;
 	struct FrameCBuffer;
+	class GPUDrivenGBufferPass;
+	class BoundingVolumeHierarchy;
+	struct Light;
 	enum class LightType : Int32;
 
 	struct BoundingObject
@@ -26,8 +33,8 @@ namespace adria
 			Frustum
 		} type = Box;
 
-		BoundingObject(BoundingBox const& box) : data(box) {}
-		BoundingObject(BoundingFrustum const& frustum) : data(frustum) {}
+		BoundingObject(BoundingBox const& box) : type(Box), data(box) {}
+		BoundingObject(BoundingFrustum const& frustum) : type(Frustum), data(frustum) {}
 
 		BoundingBox const& GetBox() const
 		{
@@ -47,8 +54,28 @@ namespace adria
 	{
 		static constexpr Uint32 SHADOW_MAP_SIZE = 1024;
 		static constexpr Uint32 SHADOW_CASCADE_MAP_SIZE = 2048;
-		static constexpr Uint32 SHADOW_CUBE_SIZE = 512;
 		static constexpr Uint32 SHADOW_CASCADE_COUNT = 4;
+		static constexpr Uint32 SHADOW_ATLAS_SIZE = 4096;
+		static constexpr Uint32 SHADOW_ATLAS_MIN_TILE_SIZE = 64;
+		static constexpr Uint32 SHADOW_ATLAS_MAX_TILE_SIZE = 1024;
+		//left cleared around every tile so filtering never reads a neighbouring tile
+		static constexpr Uint32 SHADOW_ATLAS_TILE_BORDER = 2;
+		static constexpr Uint32 POINT_LIGHT_FACE_COUNT = 6;
+
+		struct ShadowView
+		{
+			Matrix view;
+			Matrix projection;
+		};
+
+		//spot and point light shadows live in the atlas, a tile keeps its depth until its static casters change
+		struct ShadowAtlasEntry
+		{
+			std::array<QuadTreeAllocator::Allocation, POINT_LIGHT_FACE_COUNT> tiles{};
+			std::array<Uint64, POINT_LIGHT_FACE_COUNT> static_casters_hashes{};
+			Uint32 tile_count = 0;
+			Uint32 tile_size = 0;
+		};
 
 	public:
 		ShadowRenderer(entt::registry& reg, GfxDevice* gfx, Uint32 width, Uint32 height);
@@ -60,15 +87,23 @@ namespace adria
 			{
 				width = w, height = h;
 				ray_traced_shadows_pass.OnResize(w, h);
+				virtual_shadow_map_pass.OnResize(w, h);
 				light_mask_textures.clear();
 			}
 		}
 		void SetupShadows(Camera const* camera);
+		//items of the hierarchy index into batch_entities
+		void SetBatchBVH(BoundingVolumeHierarchy const* bvh, std::span<entt::entity const> entities)
+		{
+			batch_bvh = bvh;
+			batch_entities = entities;
+		}
 
-		void AddShadowMapPasses(RenderGraph& rg);
+		void AddShadowMapPasses(RenderGraph& rg, FrameCBuffer const& frame_cbuffer, GPUDrivenGBufferPass* gpu_driven_pass = nullptr);
 		void AddRayTracingShadowPasses(RenderGraph& rg);
 
 		void FillFrameCBuffer(FrameCBuffer& frame_cbuffer);
+		void OnLightChanged();
 		void GUI();
 		ShadowTextureRenderedEvent& GetShadowTextureRenderedEvent() { return shadow_rendered_event; }
 
@@ -78,7 +113,10 @@ namespace adria
 		Uint32 width;
 		Uint32 height;
 		RayTracedShadowsPass ray_traced_shadows_pass;
+		VirtualShadowMapPass virtual_shadow_map_pass;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> shadow_psos;
+		std::unique_ptr<GfxMeshShaderPipelineStatePermutations> shadow_mesh_psos;
+		std::unique_ptr<GfxGraphicsPipelineStatePermutations> virtual_shadow_map_psos;
 
 		std::unique_ptr<GfxBuffer>  light_matrices_buffer;
 		GfxDescriptor				light_matrices_buffer_srvs[GFX_BACKBUFFER_COUNT];
@@ -90,14 +128,29 @@ namespace adria
 		std::unordered_map<Uint64, GfxDescriptor> light_mask_texture_uavs;
 		Int32						   light_matrices_gpu_index = -1;
 
+		std::unique_ptr<GfxTexture>					shadow_atlas;
+		GfxDescriptor								shadow_atlas_srv;
+		QuadTreeAllocator							shadow_atlas_allocator;
+		std::unordered_map<Uint64, ShadowAtlasEntry> shadow_atlas_entries;
+
 		std::vector<BoundingObject>						bounding_objects;
+		BoundingVolumeHierarchy const*					batch_bvh = nullptr;
+		std::span<entt::entity const>					batch_entities;
+		std::vector<ShadowView>							shadow_views;
 		std::array<Float, SHADOW_CASCADE_COUNT>		    split_distances{};
 
 		ShadowTextureRenderedEvent shadow_rendered_event;
 
 	private:
 		void CreatePSOs();
-		void ShadowMapPass_Common(GfxCommandList* cmd_list, LightType light_type, Uint64 light_index, Uint64 matrix_index, Uint64 matrix_offset);
+		void AllocateShadowAtlasTiles(Camera const& camera);
+		Uint32 GetShadowAtlasTileSize(Light const& light, Camera const& camera) const;
+		void AddVirtualShadowMapPasses(RenderGraph& rg, Light const& light);
+		void ShadowMapPass_Common(GfxCommandList* cmd_list, GfxGraphicsPipelineStatePermutations* psos, GfxMeshShaderPipelineStatePermutations* mesh_psos, Uint64 light_index, Uint64 matrix_index, Uint64 matrix_offset);
+		Bool IntersectsShadowView(Uint64 view_index, BoundingBox const& box) const;
+		template<typename F>
+		void ForEachShadowViewBatch(Uint64 view_index, F&& f) const;
+		Uint64 GetStaticCastersHash(Uint64 view_index, Bool& has_dynamic_casters) const;
 		static std::array<Matrix, SHADOW_CASCADE_COUNT> RecalculateProjectionMatrices(Camera const& camera, Float split_lambda, std::array<Float, SHADOW_CASCADE_COUNT>& split_distances);
 	};
 }
\ No newline at end of file
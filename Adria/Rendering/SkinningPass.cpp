@@ -0,0 +1,274 @@
+#include "SkinningPass.h"
+#include "Components.h"
+#include "ShaderStructs.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/AllocatorUtil.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> Skinning("r.Skinning", true, "Skin and morph deformable instances in compute, when disabled deformable instances keep their last pose");
+
+	SkinningPass::SkinningPass(entt::registry& reg, GfxDevice* gfx) : reg(reg), gfx(gfx)
+	{
+		CreatePSO();
+	}
+
+	SkinningPass::~SkinningPass()
+	{
+		Clear();
+	}
+
+	void SkinningPass::Clear()
+	{
+		for (SkinnedInstance const& instance : instances) gfx->FreePersistentDescriptorGPU(instance.vertex_buffer_srv_gpu);
+		instances.clear();
+		dispatches.clear();
+	}
+
+	void SkinningPass::AddInstance(InstanceGPU& instance_gpu, entt::entity mesh_entity, Uint32 mesh_instance_index, Uint32 geometry_buffer_idx)
+	{
+		Mesh const& mesh = reg.get<Mesh>(mesh_entity);
+		SubMeshInstance const& mesh_instance = mesh.instances[mesh_instance_index];
+		SubMeshGPU const& submesh = mesh.submeshes[mesh_instance.submesh_index];
+		Bool const skinned = submesh.skinned && mesh_instance.skin_index != UINT32_MAX;
+		Bool const morphed = submesh.morph_target_count > 0 && mesh_instance.node_index != UINT32_MAX;
+		if ((!skinned && !morphed) || !reg.all_of<Skeleton>(mesh_entity)) return;
+		ADRIA_ASSERT(submesh.vertex_layout == VertexLayout::Full);
+
+		SkinnedInstance& instance = instances.emplace_back();
+		instance.mesh_entity = mesh_entity;
+		instance.mesh_instance_index = mesh_instance_index;
+		instance.instance_id = instance_gpu.instance_id;
+		instance.submesh = &submesh;
+		instance.geometry_buffer_idx = geometry_buffer_idx;
+		instance.skin_index = skinned ? mesh_instance.skin_index : UINT32_MAX;
+		instance.node_index = mesh_instance.node_index;
+		instance.bounds = submesh.bounding_box;
+
+		Uint64 const vertex_count = submesh.vertices_count;
+		instance.positions_offset = 0;
+		instance.prev_positions_offset = (Uint32)Align(vertex_count * sizeof(Vector3), 16);
+		instance.normals_offset = instance.prev_positions_offset + (Uint32)Align(vertex_count * sizeof(Vector3), 16);
+		instance.tangents_offset = instance.normals_offset + (Uint32)Align(vertex_count * sizeof(Vector3), 16);
+
+		GfxBufferDesc vertex_buffer_desc{};
+		vertex_buffer_desc.size = instance.tangents_offset + Align(vertex_count * sizeof(Vector4), 16);
+		vertex_buffer_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		vertex_buffer_desc.misc_flags = GfxBufferMiscFlag::BufferRaw;
+		instance.vertex_buffer = gfx->CreateBuffer(vertex_buffer_desc);
+		instance.vertex_buffer->SetName("Skinned Vertex Buffer");
+		instance.vertex_buffer_uav = gfx->CreateBufferUAV(instance.vertex_buffer.get());
+		instance.vertex_buffer_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+		gfx->CopyDescriptors(1, instance.vertex_buffer_srv_gpu, gfx->CreateBufferSRV(instance.vertex_buffer.get()));
+
+		instance_gpu.skinned_vertices_idx = (Int32)instance.vertex_buffer_srv_gpu.GetIndex();
+		instance_gpu.skinned_positions_offset = instance.positions_offset;
+		instance_gpu.skinned_prev_positions_offset = instance.prev_positions_offset;
+		instance_gpu.skinned_normals_offset = instance.normals_offset;
+		instance_gpu.skinned_tangents_offset = instance.tangents_offset;
+	}
+
+	void SkinningPass::Update(std::span<entt::entity const> posed_entities)
+	{
+		dispatches.clear();
+		joint_matrices.clear();
+		morph_weights.clear();
+
+		for (Uint32 i = 0; i < instances.size(); ++i)
+		{
+			SkinnedInstance& instance = instances[i];
+			Skeleton const& skeleton = reg.get<Skeleton>(instance.mesh_entity);
+			if (skeleton.node_transforms.empty()) continue;
+
+			//an instance that stops deforming is dispatched once more so its previous positions match the current ones
+			Bool const posed = Skinning.Get() && std::find(posed_entities.begin(), posed_entities.end(), instance.mesh_entity) != posed_entities.end();
+			Bool const was_deformed = instance.deformed;
+			instance.deformed = posed || !instance.history_valid;
+			instance.settling = !instance.deformed && was_deformed;
+			if (!instance.deformed && !instance.settling) continue;
+
+			SkinningDispatch& dispatch = dispatches.emplace_back();
+			dispatch.instance = i;
+			dispatch.first_joint_matrix = (Uint32)joint_matrices.size();
+			dispatch.first_morph_weight = (Uint32)morph_weights.size();
+
+			SubMeshGPU const& submesh = *instance.submesh;
+			if (instance.skin_index != UINT32_MAX)
+			{
+				//the pose bounds are the rest bounds moved by every joint, loose but cheap and never smaller than the skinned mesh
+				SkeletonSkin const& skin = skeleton.skins[instance.skin_index];
+				Bool first_joint = true;
+				for (Uint32 joint = skin.first_joint; joint < skin.first_joint + skin.joint_count; ++joint)
+				{
+					Matrix const& joint_matrix = joint_matrices.emplace_back(skeleton.inverse_bind_matrices[joint] * skeleton.node_transforms[skeleton.skin_joints[joint]]);
+					DirectX::BoundingBox joint_bounds;
+					submesh.bounding_box.Transform(joint_bounds, joint_matrix);
+					if (first_joint) instance.bounds = joint_bounds;
+					else DirectX::BoundingBox::CreateMerged(instance.bounds, instance.bounds, joint_bounds);
+					first_joint = false;
+				}
+			}
+			if (submesh.morph_target_count > 0)
+			{
+				SkeletonNode const& node = skeleton.nodes[instance.node_index];
+				for (Uint32 target = 0; target < submesh.morph_target_count; ++target)
+				{
+					morph_weights.push_back(target < node.morph_weight_count ? skeleton.pose_morph_weights[node.first_morph_weight + target] : 0.0f);
+				}
+			}
+		}
+	}
+
+	void SkinningPass::AddPass(RenderGraph& rg)
+	{
+		if (dispatches.empty()) return;
+
+		struct SkinningUploadPassData
+		{
+			RGBufferCopyDstId joint_matrices;
+			RGBufferCopyDstId morph_weights;
+		};
+
+		rg.AddPass<SkinningUploadPassData>("Skinning Upload Pass",
+			[=](SkinningUploadPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc joint_matrices_desc{};
+				joint_matrices_desc.resource_usage = GfxResourceUsage::Default;
+				joint_matrices_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				joint_matrices_desc.stride = sizeof(Matrix);
+				joint_matrices_desc.size = sizeof(Matrix) * std::max<Uint64>(joint_matrices.size(), 1);
+				builder.DeclareBuffer(RG_NAME(SkinningJointMatrices), joint_matrices_desc);
+
+				RGBufferDesc morph_weights_desc{};
+				morph_weights_desc.resource_usage = GfxResourceUsage::Default;
+				morph_weights_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				morph_weights_desc.stride = sizeof(Float);
+				morph_weights_desc.size = sizeof(Float) * std::max<Uint64>(morph_weights.size(), 1);
+				builder.DeclareBuffer(RG_NAME(SkinningMorphWeights), morph_weights_desc);
+
+				data.joint_matrices = builder.WriteCopyDstBuffer(RG_NAME(SkinningJointMatrices));
+				data.morph_weights = builder.WriteCopyDstBuffer(RG_NAME(SkinningMorphWeights));
+			},
+			[=, this](SkinningUploadPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxLinearDynamicAllocator* dynamic_allocator = cmd_list->GetDevice()->GetDynamicAllocator();
+				if (!joint_matrices.empty())
+				{
+					Uint64 const joint_matrices_size = joint_matrices.size() * sizeof(Matrix);
+					GfxDynamicAllocation staging = dynamic_allocator->Allocate(joint_matrices_size, 16);
+					staging.Update(joint_matrices.data(), joint_matrices_size);
+					cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.joint_matrices), 0, *staging.buffer, staging.offset, joint_matrices_size);
+				}
+				if (!morph_weights.empty())
+				{
+					Uint64 const morph_weights_size = morph_weights.size() * sizeof(Float);
+					GfxDynamicAllocation staging = dynamic_allocator->Allocate(morph_weights_size, 16);
+					staging.Update(morph_weights.data(), morph_weights_size);
+					cmd_list->CopyBuffer(context.GetCopyDstBuffer(data.morph_weights), 0, *staging.buffer, staging.offset, morph_weights_size);
+				}
+			}, RGPassType::Copy, RGPassFlags::None);
+
+		struct SkinningPassData
+		{
+			RGBufferReadOnlyId joint_matrices;
+			RGBufferReadOnlyId morph_weights;
+		};
+
+		//the deformed vertex buffers live outside the graph and are read bindless, so the pass is never culled
+		rg.AddPass<SkinningPassData>("Skinning Pass",
+			[=](SkinningPassData& data, RenderGraphBuilder& builder)
+			{
+				data.joint_matrices = builder.ReadBuffer(RG_NAME(SkinningJointMatrices), ReadAccess_NonPixelShader);
+				data.morph_weights = builder.ReadBuffer(RG_NAME(SkinningMorphWeights), ReadAccess_NonPixelShader);
+			},
+			[=, this](SkinningPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				cmd_list->SetPipelineState(skinning_pso.get());
+				cmd_list->GlobalBarrier(GfxResourceState::AllSRV, GfxResourceState::ComputeUAV);
+				cmd_list->FlushBarriers();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					context.GetReadOnlyBuffer(data.joint_matrices),
+					context.GetReadOnlyBuffer(data.morph_weights)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				for (SkinningDispatch const& dispatch : dispatches)
+				{
+					SkinnedInstance& instance = instances[dispatch.instance];
+					SubMeshGPU const& submesh = *instance.submesh;
+
+					GfxDescriptor vertex_buffer_uav = gfx->AllocateDescriptorsGPU();
+					gfx->CopyDescriptors(1, vertex_buffer_uav, instance.vertex_buffer_uav);
+
+					struct SkinningConstants
+					{
+						Uint32 geometry_buffer_idx;
+						Uint32 vertex_count;
+						Uint32 positions_offset;
+						Uint32 normals_offset;
+						Uint32 tangents_offset;
+						Uint32 joints_offset;
+						Uint32 weights_offset;
+						Uint32 morph_targets_offset;
+
+						Uint32 morph_target_count;
+						Uint32 joint_matrices_idx;
+						Int32  first_joint_matrix;
+						Uint32 morph_weights_idx;
+						Uint32 first_morph_weight;
+						Uint32 skinned_vertices_idx;
+						Uint32 skinned_positions_offset;
+						Uint32 skinned_prev_positions_offset;
+
+						Uint32 skinned_normals_offset;
+						Uint32 skinned_tangents_offset;
+						Uint32 reset_history;
+					} constants =
+					{
+						.geometry_buffer_idx = instance.geometry_buffer_idx,
+						.vertex_count = submesh.vertices_count,
+						.positions_offset = submesh.positions_offset,
+						.normals_offset = submesh.normals_offset,
+						.tangents_offset = submesh.tangents_offset,
+						.joints_offset = submesh.joints_offset,
+						.weights_offset = submesh.weights_offset,
+						.morph_targets_offset = submesh.morph_targets_offset,
+						.morph_target_count = submesh.morph_target_count,
+						.joint_matrices_idx = i,
+						.first_joint_matrix = instance.skin_index != UINT32_MAX ? (Int32)dispatch.first_joint_matrix : -1,
+						.morph_weights_idx = i + 1,
+						.first_morph_weight = dispatch.first_morph_weight,
+						.skinned_vertices_idx = vertex_buffer_uav.GetIndex(),
+						.skinned_positions_offset = instance.positions_offset,
+						.skinned_prev_positions_offset = instance.prev_positions_offset,
+						.skinned_normals_offset = instance.normals_offset,
+						.skinned_tangents_offset = instance.tangents_offset,
+						.reset_history = !instance.history_valid
+					};
+					cmd_list->SetRootCBV(2, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(submesh.vertices_count, SKINNING_GROUP_SIZE), 1, 1);
+					instance.history_valid = true;
+				}
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::AllSRV);
+				cmd_list->FlushBarriers();
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+	}
+
+	void SkinningPass::CreatePSO()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_Skinning;
+		skinning_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+}
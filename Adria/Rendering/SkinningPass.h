@@ -0,0 +1,81 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <span>
+#include <DirectXCollision.h>
+#include "Graphics/GfxDescriptor.h"
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxComputePipelineState;
+	class RenderGraph;
+	struct InstanceGPU;
+	struct SubMeshGPU;
+
+	//skins and morphs deformable instances once per frame in compute, every pass that reads the instance geometry
+	//(gbuffer, shadows, motion vectors and the BLAS refit) then reuses the deformed vertices instead of skinning again
+	class SkinningPass
+	{
+		static constexpr Uint32 SKINNING_GROUP_SIZE = 64;
+
+	public:
+		//per instance raw buffer with the current and previous frame positions, normals and tangents of the deformed vertices
+		struct SkinnedInstance
+		{
+			entt::entity mesh_entity;
+			Uint32 mesh_instance_index;
+			Uint32 instance_id;
+			SubMeshGPU const* submesh;
+			Uint32 geometry_buffer_idx;
+			Uint32 skin_index;
+			Uint32 node_index;
+
+			std::unique_ptr<GfxBuffer> vertex_buffer;
+			GfxDescriptor vertex_buffer_uav;
+			GfxDescriptor vertex_buffer_srv_gpu;
+			Uint32 positions_offset;
+			Uint32 prev_positions_offset;
+			Uint32 normals_offset;
+			Uint32 tangents_offset;
+
+			DirectX::BoundingBox bounds; //object space bounds of the current pose
+			Bool deformed = false; //written this frame
+			Bool settling = false; //deformed last frame, needs one more dispatch for the previous positions to catch up
+			Bool history_valid = false;
+		};
+
+	public:
+		SkinningPass(entt::registry& reg, GfxDevice* gfx);
+		~SkinningPass();
+
+		void Clear();
+		void AddInstance(InstanceGPU& instance_gpu, entt::entity mesh_entity, Uint32 mesh_instance_index, Uint32 geometry_buffer_idx);
+		void Update(std::span<entt::entity const> posed_entities);
+		void AddPass(RenderGraph& rg);
+
+		std::span<SkinnedInstance const> GetInstances() const { return instances; }
+		Bool HasWork() const { return !dispatches.empty(); }
+
+	private:
+		struct SkinningDispatch
+		{
+			Uint32 instance;
+			Uint32 first_joint_matrix;
+			Uint32 first_morph_weight;
+		};
+
+		entt::registry& reg;
+		GfxDevice* gfx;
+		std::unique_ptr<GfxComputePipelineState> skinning_pso;
+		std::vector<SkinnedInstance> instances;
+		std::vector<SkinningDispatch> dispatches;
+		std::vector<Matrix> joint_matrices;
+		std::vector<Float> morph_weights;
+
+	private:
+		void CreatePSO();
+	};
+}
@@ -5,9 +5,11 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h"
 #include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxReflection.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "Utilities/HashUtil.h"
 #include "entt/entity/registry.hpp"
 
 using namespace DirectX;
@@ -15,6 +17,7 @@ using namespace DirectX;
 namespace adria
 {
 	static constexpr Uint32 SKYCUBE_SIZE = 128;
+	static constexpr Uint32 SKY_SH_COEFFICIENT_COUNT = 9;
 
 	SkyPass::SkyPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
 		: reg(reg), gfx(gfx), width(w), height(h), sky_type(SkyType::HosekWilkie)
@@ -22,8 +25,18 @@ namespace adria
 		CreatePSOs();
 	}
 
+	SkyPass::~SkyPass()
+	{
+		if (sky_sh_srv_gpu.IsValid()) gfx->FreePersistentDescriptorGPU(sky_sh_srv_gpu);
+	}
+
 	void SkyPass::AddComputeSkyPass(RenderGraph& rg, Vector3 const& dir)
 	{
+		rg.ImportBuffer(RG_NAME(SkyIrradianceSH), sky_sh_buffer.get());
+
+		//the sky cubemap and its irradiance only change with the sky inputs, so they are cached across frames
+		HashState hash;
+		hash.Combine((Uint32)sky_type);
 		if (sky_type == SkyType::Skybox)
 		{
 			auto skybox_view = reg.view<Skybox>();
@@ -34,25 +47,43 @@ namespace adria
 				{
 					GfxTexture* skybox_texture = g_TextureManager.GetTexture(skybox.cubemap_texture);
 					rg.ImportTexture(RG_NAME(Sky), skybox_texture);
+					hash.Combine((Uint64)skybox.cubemap_texture);
 					break;
 				}
 			}
+			if (sky_hash != hash)
+			{
+				sky_hash = hash;
+				AddSkyIrradianceSHPass(rg);
+			}
 			return;
 		}
 
+		rg.ImportTexture(RG_NAME(Sky), sky_texture.get());
+		hash.Combine(dir.x);
+		hash.Combine(dir.y);
+		hash.Combine(dir.z);
+		if (sky_type == SkyType::HosekWilkie)
+		{
+			hash.Combine(turbidity);
+			hash.Combine(ground_albedo);
+		}
+		if (sky_hash == hash) return;
+		sky_hash = hash;
+
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 		struct ComputeSkyPassData
 		{
 			RGTextureReadWriteId sky_uav;
 		};
 
-		rg.ImportTexture(RG_NAME(Sky), sky_texture.get());
+		SkyParameters const parameters = CalculateSkyParameters(turbidity, ground_albedo, dir);
 		rg.AddPass<ComputeSkyPassData>("Compute Sky Pass",
 			[=](ComputeSkyPassData& data, RenderGraphBuilder& builder)
 			{
 				data.sky_uav = builder.WriteTexture(RG_NAME(Sky));
 			},
-			[&](ComputeSkyPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			[=](ComputeSkyPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
@@ -71,7 +102,6 @@ namespace adria
 				case SkyType::HosekWilkie:
 				{
 					cmd_list->SetPipelineState(hosek_wilkie_pso.get());
-					SkyParameters parameters = CalculateSkyParameters(turbidity, ground_albedo, dir);
 					struct HosekWilkieConstants
 					{
 						DECLSPEC_ALIGN(16) Vector3 A;
@@ -107,6 +137,46 @@ namespace adria
 				cmd_list->Dispatch(SKYCUBE_SIZE / 16, SKYCUBE_SIZE / 16, 6);
 
 			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+
+		AddSkyIrradianceSHPass(rg);
+	}
+
+	void SkyPass::AddSkyIrradianceSHPass(RenderGraph& rg)
+	{
+		struct SkyIrradianceSHPassData
+		{
+			RGTextureReadOnlyId sky;
+			RGBufferReadWriteId sky_sh;
+		};
+
+		rg.AddPass<SkyIrradianceSHPassData>("Sky Irradiance SH Pass",
+			[=](SkyIrradianceSHPassData& data, RenderGraphBuilder& builder)
+			{
+				data.sky = builder.ReadTexture(RG_NAME(Sky), ReadAccess_NonPixelShader);
+				data.sky_sh = builder.WriteBuffer(RG_NAME(SkyIrradianceSH));
+			},
+			[=](SkyIrradianceSHPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.sky), context.GetReadWriteBuffer(data.sky_sh) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct SkyIrradianceSHConstants
+				{
+					Uint32 sky_idx;
+					Uint32 sky_sh_idx;
+				} constants =
+				{
+					.sky_idx = i, .sky_sh_idx = i + 1
+				};
+
+				cmd_list->SetPipelineState(sky_sh_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
 	}
 
 	void SkyPass::AddDrawSkyPass(RenderGraph& rg)
@@ -182,7 +252,7 @@ namespace adria
 				if (!skybox.active) continue;
 
 				ADRIA_ASSERT(skybox.cubemap_texture != INVALID_TEXTURE_HANDLE);
-				return (Int32)skybox.cubemap_texture;
+				return (Int32)GetTextureIndex(skybox.cubemap_texture);
 			}
 		}
 
@@ -200,6 +270,9 @@ namespace adria
 		compute_pso_desc.CS = CS_HosekWilkieSky;
 		hosek_wilkie_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 
+		compute_pso_desc.CS = CS_SkyIrradianceSH;
+		sky_sh_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
 		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
 		GfxReflection::FillInputLayoutDesc(GetGfxShader(VS_Sky), gfx_pso_desc.input_layout);
 		gfx_pso_desc.root_signature = GfxRootSignatureID::Common;
@@ -233,6 +306,12 @@ namespace adria
 		sky_srv_desc.slice_count = 6;
 		sky_texture_srv = gfx->CreateTextureSRV(sky_texture.get(), &sky_srv_desc);
 
+		sky_sh_buffer = gfx->CreateBuffer(StructuredBufferDesc<Vector4>(SKY_SH_COEFFICIENT_COUNT));
+		sky_sh_srv = gfx->CreateBufferSRV(sky_sh_buffer.get());
+		if (!sky_sh_srv_gpu.IsValid()) sky_sh_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+		gfx->CopyDescriptors(1, sky_sh_srv_gpu, sky_sh_srv);
+		sky_hash = 0;
+
 		SimpleVertex const cube_vertices[8] =
 		{
 			Vector3{ -0.5f, -0.5f,  0.5f },
@@ -26,6 +26,7 @@ namespace adria
 	{
 	public:
 		SkyPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
+		~SkyPass();
 
 		void AddComputeSkyPass(RenderGraph& rg, Vector3 const& dir);
 		void AddDrawSkyPass(RenderGraph& rg);
@@ -35,6 +36,7 @@ namespace adria
 		void GUI();
 
 		Int32 GetSkyIndex() const;
+		Int32 GetSkyIrradianceSHIndex() const { return (Int32)sky_sh_srv_gpu.GetIndex(); }
 		void SetSkyType(SkyType type)
 		{
 			sky_type = type;
@@ -49,9 +51,14 @@ namespace adria
 
 		std::unique_ptr<GfxTexture> sky_texture = nullptr;
 		GfxDescriptor sky_texture_srv;
+		std::unique_ptr<GfxBuffer> sky_sh_buffer = nullptr;
+		GfxDescriptor sky_sh_srv;
+		GfxDescriptor sky_sh_srv_gpu;
+		Uint64 sky_hash = 0;
 
 		std::unique_ptr<GfxComputePipelineState> minimal_atmosphere_pso;
 		std::unique_ptr<GfxComputePipelineState> hosek_wilkie_pso;
+		std::unique_ptr<GfxComputePipelineState> sky_sh_pso;
 		std::unique_ptr<GfxGraphicsPipelineState> sky_pso;
 		
 		SkyType sky_type = SkyType::HosekWilkie;
@@ -61,5 +68,6 @@ namespace adria
 	private:
 		void CreatePSOs();
 		void CreateCubeBuffers();
+		void AddSkyIrradianceSHPass(RenderGraph& rg);
 	};
 }
\ No newline at end of file
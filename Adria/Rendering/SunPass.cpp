@@ -69,7 +69,7 @@ namespace adria
 				{
 					.model_matrix = transform.current_transform,
 					.diffuse_color = Vector3(material.albedo_color),
-					.diffuse_idx = (Uint32)material.albedo_texture
+					.diffuse_idx = GetTextureIndex(material.albedo_texture)
 				};
 				cmd_list->SetRootCBV(2, constants);
 				Draw(mesh, cmd_list);
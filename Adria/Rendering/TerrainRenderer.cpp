@@ -0,0 +1,586 @@
+#include <algorithm>
+#include "TerrainRenderer.h"
+#include "Components.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxUploadManager.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/Heightmap.h"
+#include "Utilities/HashUtil.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> TerrainEnabled("r.Terrain", true, "Draw the Terrain entity as a streamed clipmap");
+
+	struct TerrainClipmapTile
+	{
+		Vector2 origin;
+		Float   size;
+		Uint32  level;
+	};
+
+	TerrainRenderer::TerrainRenderer(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
+		: reg{ reg }, gfx{ gfx }, width{ w }, height{ h }
+	{
+		CreatePSOs();
+		CreateClipmapTile();
+	}
+
+	TerrainRenderer::~TerrainRenderer()
+	{
+		UnloadTerrain();
+	}
+
+	void TerrainRenderer::Update(Vector3 const& camera_position)
+	{
+		if (!IsEnabled()) return;
+		++frame_index;
+
+		auto terrain_view = reg.view<Terrain>();
+		entt::entity const entity = terrain_view.front();
+		Terrain const* terrain = entity != entt::null ? &terrain_view.get<Terrain>(entity) : nullptr;
+		if (entity != terrain_entity || (terrain && terrain->heightmap != heightmap))
+		{
+			UnloadTerrain();
+			if (terrain && terrain->heightmap) LoadTerrain(entity, *terrain);
+		}
+		if (terrain_entity == entt::null) return;
+
+		StreamHeightTiles(*terrain, camera_position);
+		UpdateVirtualTexture(*terrain, camera_position);
+
+		terrain_constants.origin = terrain->origin;
+		terrain_constants.texel_size = terrain->texel_size;
+		terrain_constants.height_scale = terrain->height_scale;
+		terrain_constants.min_height = terrain->origin.y + min_height * terrain->height_scale;
+		terrain_constants.max_height = terrain->origin.y + max_height * terrain->height_scale;
+		terrain_constants.height_tile_size = HEIGHT_TILE_SIZE;
+		terrain_constants.heightmap_width = (Uint32)heightmap->Width();
+		terrain_constants.heightmap_depth = (Uint32)heightmap->Depth();
+		terrain_constants.tile_count_x = tile_count_x;
+		terrain_constants.tile_table_idx = tile_table_srv_gpu.GetIndex();
+		terrain_constants.overview_idx = overview_srv_gpu.GetIndex();
+		terrain_constants.overview_stride = overview_stride;
+		terrain_constants.virtual_texture_texel_size = virtual_texture_texel_size;
+		terrain_constants.layer_count = terrain->layer_count;
+		for (Uint32 i = 0; i < terrain->layer_count; ++i)
+		{
+			TerrainLayer const& layer = terrain->layers[i];
+			terrain_constants.layers[i] = TerrainLayerConstants
+			{
+				.albedo_color = layer.albedo_color,
+				.albedo_idx = GetTextureIndex(layer.albedo_texture),
+				.height_range = layer.height_range,
+				.slope_range = layer.slope_range,
+				.tiling = layer.tiling,
+				.blend_width = layer.blend_width
+			};
+		}
+	}
+
+	void TerrainRenderer::AddPasses(RenderGraph& rg, Bool hzb_culling)
+	{
+		if (!IsEnabled() || terrain_entity == entt::null || !reg.valid(terrain_entity)) return;
+
+		rg.ImportTexture(RG_NAME(TerrainVirtualTexture), virtual_texture.get());
+		if (!virtual_texture_updates.empty()) AddVirtualTexturePass(rg);
+		AddCullPass(rg, hzb_culling);
+		AddDrawPass(rg);
+	}
+
+	void TerrainRenderer::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("Terrain Settings", 0))
+				{
+					ImGui::Checkbox("Enable", TerrainEnabled.GetPtr());
+					if (TerrainEnabled.Get())
+					{
+						ImGui::SliderFloat("Clipmap Base Tile Size", &clipmap_base_tile_size, 1.0f, 64.0f);
+						ImGui::SliderFloat("Clipmap Morph Range", &clipmap_morph_range, 0.0f, 0.5f);
+						ImGui::SliderFloat("Virtual Texture Texel Size", &virtual_texture_texel_size, 0.03125f, 1.0f);
+						ImGui::Checkbox("Wireframe", &wireframe);
+						ImGui::Text("Resident Height Tiles: %zu/%u", resident_tiles.size(), tile_count_x * tile_count_z);
+					}
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	Bool TerrainRenderer::IsEnabled() const
+	{
+		return TerrainEnabled.Get();
+	}
+
+	void TerrainRenderer::CreatePSOs()
+	{
+		GfxGraphicsPipelineStateDesc gfx_pso_desc{};
+		gfx_pso_desc.root_signature = GfxRootSignatureID::Common;
+		gfx_pso_desc.VS = VS_Terrain;
+		gfx_pso_desc.PS = PS_Terrain;
+		gfx_pso_desc.depth_state.depth_enable = true;
+		gfx_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::All;
+		gfx_pso_desc.depth_state.depth_func = GfxComparisonFunc::GreaterEqual;
+		gfx_pso_desc.num_render_targets = 4u;
+		gfx_pso_desc.rtv_formats[0] = GfxFormat::R8G8B8A8_UNORM;
+		gfx_pso_desc.rtv_formats[1] = GfxFormat::R8G8B8A8_UNORM;
+		gfx_pso_desc.rtv_formats[2] = GfxFormat::R8G8B8A8_UNORM;
+		gfx_pso_desc.rtv_formats[3] = GfxFormat::R8G8B8A8_UNORM;
+		gfx_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
+		terrain_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(gfx, gfx_pso_desc);
+
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_TerrainClipmapCull;
+		clipmap_cull_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_TerrainVirtualTextureUpdate;
+		virtual_texture_update_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void TerrainRenderer::CreateClipmapTile()
+	{
+		//vertex positions are generated in the vertex shader from SV_VertexID, only the tile topology is stored
+		static constexpr Uint32 vertex_count_per_side = CLIPMAP_TILE_RESOLUTION + 1;
+		std::vector<Uint16> indices;
+		indices.reserve(CLIPMAP_TILE_RESOLUTION * CLIPMAP_TILE_RESOLUTION * 6);
+		for (Uint16 z = 0; z < CLIPMAP_TILE_RESOLUTION; ++z)
+		{
+			for (Uint16 x = 0; x < CLIPMAP_TILE_RESOLUTION; ++x)
+			{
+				Uint16 const i0 = z * vertex_count_per_side + x;
+				Uint16 const i1 = i0 + 1;
+				Uint16 const i2 = i0 + vertex_count_per_side;
+				Uint16 const i3 = i2 + 1;
+				indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+
+		GfxBufferDesc ib_desc{};
+		ib_desc.bind_flags = GfxBindFlag::None;
+		ib_desc.format = GfxFormat::R16_UINT;
+		ib_desc.stride = sizeof(Uint16);
+		ib_desc.size = indices.size() * sizeof(Uint16);
+		clipmap_tile_ib = gfx->CreateBuffer(ib_desc, indices.data());
+	}
+
+	void TerrainRenderer::LoadTerrain(entt::entity entity, Terrain const& terrain)
+	{
+		Uint64 const heightmap_width = terrain.heightmap->Width();
+		Uint64 const heightmap_depth = terrain.heightmap->Depth();
+		if (heightmap_width < 2 || heightmap_depth < 2) return;
+
+		terrain_entity = entity;
+		heightmap = terrain.heightmap;
+
+		min_height = FLT_MAX;
+		max_height = -FLT_MAX;
+		for (Uint64 z = 0; z < heightmap_depth; ++z)
+		{
+			for (Uint64 x = 0; x < heightmap_width; ++x)
+			{
+				Float const h = heightmap->HeightAt(x, z);
+				min_height = std::min(min_height, h);
+				max_height = std::max(max_height, h);
+			}
+		}
+
+		//neighbouring tiles share their edge texels so every tile can be filtered on its own
+		tile_count_x = (Uint32)DivideAndRoundUp(heightmap_width - 1, (Uint64)HEIGHT_TILE_SIZE);
+		tile_count_z = (Uint32)DivideAndRoundUp(heightmap_depth - 1, (Uint64)HEIGHT_TILE_SIZE);
+		tile_table.assign(tile_count_x * tile_count_z, INVALID_TILE);
+		tile_table_buffer = gfx->CreateBuffer(StructuredBufferDesc<Uint32>(tile_table.size(), false, false));
+		tile_table_buffer->SetName("Terrain Height Tile Table");
+		tile_table_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+		gfx->CopyDescriptors(1, tile_table_srv_gpu, gfx->CreateBufferSRV(tile_table_buffer.get()));
+		tile_table_dirty = true;
+
+		overview_stride = (Uint32)std::max<Uint64>(1, DivideAndRoundUp(std::max(heightmap_width, heightmap_depth), (Uint64)OVERVIEW_MAX_RESOLUTION));
+		Uint32 const overview_width = (Uint32)DivideAndRoundUp(heightmap_width, (Uint64)overview_stride);
+		Uint32 const overview_depth = (Uint32)DivideAndRoundUp(heightmap_depth, (Uint64)overview_stride);
+		std::vector<Float> overview_heights(overview_width * overview_depth);
+		for (Uint32 z = 0; z < overview_depth; ++z)
+		{
+			for (Uint32 x = 0; x < overview_width; ++x)
+			{
+				overview_heights[z * overview_width + x] = heightmap->HeightAt((Uint64)x * overview_stride, (Uint64)z * overview_stride);
+			}
+		}
+
+		GfxTextureDesc overview_desc{};
+		overview_desc.width = overview_width;
+		overview_desc.height = overview_depth;
+		overview_desc.format = GfxFormat::R32_FLOAT;
+		overview_desc.bind_flags = GfxBindFlag::ShaderResource;
+		overview_desc.initial_state = GfxResourceState::AllSRV;
+
+		GfxTextureSubData overview_sub_data{};
+		overview_sub_data.data = overview_heights.data();
+		overview_sub_data.row_pitch = sizeof(Float) * overview_width;
+		overview_sub_data.slice_pitch = 0;
+		GfxTextureData overview_data{};
+		overview_data.sub_data = &overview_sub_data;
+		overview_data.sub_count = 1;
+		overview_texture = gfx->CreateTexture(overview_desc, overview_data);
+		overview_texture->SetName("Terrain Height Overview");
+		overview_srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+		gfx->CopyDescriptors(1, overview_srv_gpu, gfx->CreateTextureSRV(overview_texture.get()));
+
+		GfxTextureDesc virtual_texture_desc{};
+		virtual_texture_desc.width = VIRTUAL_TEXTURE_RESOLUTION;
+		virtual_texture_desc.height = VIRTUAL_TEXTURE_RESOLUTION;
+		virtual_texture_desc.array_size = VIRTUAL_TEXTURE_LEVELS;
+		virtual_texture_desc.format = GfxFormat::R8G8B8A8_UNORM;
+		virtual_texture_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		virtual_texture_desc.initial_state = GfxResourceState::ComputeUAV;
+		virtual_texture = gfx->CreateTexture(virtual_texture_desc);
+		virtual_texture->SetName("Terrain Virtual Texture");
+		virtual_texture_valid = false;
+	}
+
+	void TerrainRenderer::UnloadTerrain()
+	{
+		for (auto& [tile_index, tile] : resident_tiles) gfx->FreePersistentDescriptorGPU(tile.srv_gpu);
+		resident_tiles.clear();
+		tile_table.clear();
+		if (tile_table_buffer)
+		{
+			gfx->FreePersistentDescriptorGPU(tile_table_srv_gpu);
+			gfx->FreePersistentDescriptorGPU(overview_srv_gpu);
+		}
+		tile_table_buffer.reset();
+		overview_texture.reset();
+		virtual_texture.reset();
+		virtual_texture_updates.clear();
+		heightmap.reset();
+		tile_count_x = tile_count_z = 0;
+		terrain_entity = entt::null;
+	}
+
+	void TerrainRenderer::StreamHeightTiles(Terrain const& terrain, Vector3 const& camera_position)
+	{
+		Float const tile_world_size = HEIGHT_TILE_SIZE * terrain.texel_size;
+		Int32 const camera_tile_x = (Int32)std::floor((camera_position.x - terrain.origin.x) / tile_world_size);
+		Int32 const camera_tile_z = (Int32)std::floor((camera_position.z - terrain.origin.z) / tile_world_size);
+
+		std::vector<std::pair<Int32, Uint32>> missing_tiles;
+		for (Int32 dz = -HEIGHT_STREAMING_RADIUS; dz <= HEIGHT_STREAMING_RADIUS; ++dz)
+		{
+			for (Int32 dx = -HEIGHT_STREAMING_RADIUS; dx <= HEIGHT_STREAMING_RADIUS; ++dx)
+			{
+				Int32 const tile_x = camera_tile_x + dx;
+				Int32 const tile_z = camera_tile_z + dz;
+				if (tile_x < 0 || tile_z < 0 || tile_x >= (Int32)tile_count_x || tile_z >= (Int32)tile_count_z) continue;
+
+				Uint32 const tile_index = tile_z * tile_count_x + tile_x;
+				if (auto it = resident_tiles.find(tile_index); it != resident_tiles.end()) it->second.last_used_frame = frame_index;
+				else missing_tiles.emplace_back(dx * dx + dz * dz, tile_index);
+			}
+		}
+		std::sort(missing_tiles.begin(), missing_tiles.end());
+
+		Uint32 const upload_count = std::min((Uint32)missing_tiles.size(), MAX_HEIGHT_TILE_UPLOADS);
+		std::vector<Float> tile_heights((HEIGHT_TILE_SIZE + 1) * (HEIGHT_TILE_SIZE + 1));
+		for (Uint32 i = 0; i < upload_count; ++i)
+		{
+			if (resident_tiles.size() >= MAX_RESIDENT_HEIGHT_TILES)
+			{
+				auto lru = std::min_element(resident_tiles.begin(), resident_tiles.end(),
+					[](auto const& lhs, auto const& rhs) { return lhs.second.last_used_frame < rhs.second.last_used_frame; });
+				if (lru->second.last_used_frame == frame_index) break;
+				gfx->FreePersistentDescriptorGPU(lru->second.srv_gpu);
+				tile_table[lru->first] = INVALID_TILE;
+				resident_tiles.erase(lru);
+			}
+
+			Uint32 const tile_index = missing_tiles[i].second;
+			Uint64 const first_x = (Uint64)(tile_index % tile_count_x) * HEIGHT_TILE_SIZE;
+			Uint64 const first_z = (Uint64)(tile_index / tile_count_x) * HEIGHT_TILE_SIZE;
+			for (Uint32 z = 0; z <= HEIGHT_TILE_SIZE; ++z)
+			{
+				Uint64 const heightmap_z = std::min<Uint64>(first_z + z, heightmap->Depth() - 1);
+				for (Uint32 x = 0; x <= HEIGHT_TILE_SIZE; ++x)
+				{
+					Uint64 const heightmap_x = std::min<Uint64>(first_x + x, heightmap->Width() - 1);
+					tile_heights[z * (HEIGHT_TILE_SIZE + 1) + x] = heightmap->HeightAt(heightmap_x, heightmap_z);
+				}
+			}
+
+			GfxTextureDesc tile_desc{};
+			tile_desc.width = HEIGHT_TILE_SIZE + 1;
+			tile_desc.height = HEIGHT_TILE_SIZE + 1;
+			tile_desc.format = GfxFormat::R32_FLOAT;
+			tile_desc.bind_flags = GfxBindFlag::ShaderResource;
+			tile_desc.initial_state = GfxResourceState::AllSRV;
+
+			GfxTextureSubData tile_sub_data{};
+			tile_sub_data.data = tile_heights.data();
+			tile_sub_data.row_pitch = sizeof(Float) * (HEIGHT_TILE_SIZE + 1);
+			tile_sub_data.slice_pitch = 0;
+			GfxTextureData tile_data{};
+			tile_data.sub_data = &tile_sub_data;
+			tile_data.sub_count = 1;
+
+			HeightTile& tile = resident_tiles[tile_index];
+			tile.texture = gfx->CreateTexture(tile_desc, tile_data);
+			tile.srv_gpu = gfx->AllocatePersistentDescriptorGPU();
+			tile.last_used_frame = frame_index;
+			gfx->CopyDescriptors(1, tile.srv_gpu, gfx->CreateTextureSRV(tile.texture.get()));
+			tile_table[tile_index] = tile.srv_gpu.GetIndex();
+			tile_table_dirty = true;
+		}
+
+		if (tile_table_dirty)
+		{
+			gfx->GetUploadManager()->UploadBuffer(*tile_table_buffer, tile_table.data(), tile_table.size() * sizeof(Uint32));
+			tile_table_dirty = false;
+		}
+	}
+
+	void TerrainRenderer::UpdateVirtualTexture(Terrain const& terrain, Vector3 const& camera_position)
+	{
+		HashState hash{};
+		hash.Combine(virtual_texture_texel_size);
+		hash.Combine(terrain.height_scale);
+		hash.Combine(terrain.layer_count);
+		for (Uint32 i = 0; i < terrain.layer_count; ++i)
+		{
+			TerrainLayer const& layer = terrain.layers[i];
+			hash.Combine((Uint32)layer.albedo_texture);
+			hash.Combine(layer.albedo_color.x);
+			hash.Combine(layer.albedo_color.y);
+			hash.Combine(layer.albedo_color.z);
+			hash.Combine(layer.tiling);
+			hash.Combine(layer.height_range.x);
+			hash.Combine(layer.height_range.y);
+			hash.Combine(layer.slope_range.x);
+			hash.Combine(layer.slope_range.y);
+			hash.Combine(layer.blend_width);
+		}
+		if (hash != layers_hash)
+		{
+			layers_hash = hash;
+			virtual_texture_valid = false;
+		}
+
+		//each level is addressed toroidally, moving the camera only bakes the strips that scrolled into the level
+		static constexpr Int32 resolution = (Int32)VIRTUAL_TEXTURE_RESOLUTION;
+		virtual_texture_updates.clear();
+		for (Uint32 level = 0; level < VIRTUAL_TEXTURE_LEVELS; ++level)
+		{
+			Float const level_texel_size = virtual_texture_texel_size * (1u << level);
+			Int32 const origin_x = (Int32)std::floor(camera_position.x / (level_texel_size * VIRTUAL_TEXTURE_UPDATE_GRANULARITY)) * VIRTUAL_TEXTURE_UPDATE_GRANULARITY - resolution / 2;
+			Int32 const origin_z = (Int32)std::floor(camera_position.z / (level_texel_size * VIRTUAL_TEXTURE_UPDATE_GRANULARITY)) * VIRTUAL_TEXTURE_UPDATE_GRANULARITY - resolution / 2;
+			Int32& previous_origin_x = virtual_texture_origins[level][0];
+			Int32& previous_origin_z = virtual_texture_origins[level][1];
+			Int32 const dx = origin_x - previous_origin_x;
+			Int32 const dz = origin_z - previous_origin_z;
+
+			if (!virtual_texture_valid || std::abs(dx) >= resolution || std::abs(dz) >= resolution)
+			{
+				virtual_texture_updates.push_back(VirtualTextureUpdate{ origin_x, origin_z, VIRTUAL_TEXTURE_RESOLUTION, VIRTUAL_TEXTURE_RESOLUTION, level });
+			}
+			else
+			{
+				if (dx != 0)
+				{
+					Int32 const first_x = dx > 0 ? previous_origin_x + resolution : origin_x;
+					virtual_texture_updates.push_back(VirtualTextureUpdate{ first_x, origin_z, (Uint32)std::abs(dx), VIRTUAL_TEXTURE_RESOLUTION, level });
+				}
+				if (dz != 0)
+				{
+					Int32 const first_z = dz > 0 ? previous_origin_z + resolution : origin_z;
+					virtual_texture_updates.push_back(VirtualTextureUpdate{ origin_x, first_z, VIRTUAL_TEXTURE_RESOLUTION, (Uint32)std::abs(dz), level });
+				}
+			}
+			previous_origin_x = origin_x;
+			previous_origin_z = origin_z;
+		}
+		virtual_texture_valid = true;
+	}
+
+	void TerrainRenderer::AddVirtualTexturePass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct TerrainVirtualTexturePassData
+		{
+			RGTextureReadWriteId virtual_texture;
+		};
+
+		rg.AddPass<TerrainVirtualTexturePassData>("Terrain Virtual Texture Update Pass",
+			[=](TerrainVirtualTexturePassData& data, RenderGraphBuilder& builder)
+			{
+				data.virtual_texture = builder.WriteTexture(RG_NAME(TerrainVirtualTexture));
+			},
+			[=](TerrainVirtualTexturePassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU();
+				gfx->CopyDescriptors(1, dst_handle, context.GetReadWriteTexture(data.virtual_texture));
+
+				cmd_list->SetPipelineState(virtual_texture_update_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(2, terrain_constants);
+				for (VirtualTextureUpdate const& update : virtual_texture_updates)
+				{
+					struct TerrainVirtualTextureConstants
+					{
+						Uint32 virtual_texture_idx;
+						Uint32 level;
+						Int32  texel_x;
+						Int32  texel_z;
+						Uint32 width;
+						Uint32 depth;
+						Uint32 resolution;
+					} constants =
+					{
+						.virtual_texture_idx = dst_handle.GetIndex(),
+						.level = update.level,
+						.texel_x = update.texel_x,
+						.texel_z = update.texel_z,
+						.width = update.width,
+						.depth = update.depth,
+						.resolution = VIRTUAL_TEXTURE_RESOLUTION
+					};
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(update.width, 8), DivideAndRoundUp(update.depth, 8), 1);
+				}
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void TerrainRenderer::AddCullPass(RenderGraph& rg, Bool hzb_culling)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct TerrainClipmapCullPassData
+		{
+			RGTextureReadOnlyId hzb;
+			RGBufferReadWriteId tiles;
+			RGBufferReadWriteId draw_args;
+		};
+
+		rg.AddPass<TerrainClipmapCullPassData>("Terrain Clipmap Cull Pass",
+			[=](TerrainClipmapCullPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc tiles_desc{};
+				tiles_desc.resource_usage = GfxResourceUsage::Default;
+				tiles_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				tiles_desc.stride = sizeof(TerrainClipmapTile);
+				tiles_desc.size = CLIPMAP_MAX_TILES * sizeof(TerrainClipmapTile);
+				builder.DeclareBuffer(RG_NAME(TerrainClipmapTiles), tiles_desc);
+
+				RGBufferDesc draw_args_desc{};
+				draw_args_desc.resource_usage = GfxResourceUsage::Default;
+				draw_args_desc.misc_flags = GfxBufferMiscFlag::IndirectArgs;
+				draw_args_desc.stride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+				draw_args_desc.size = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+				builder.DeclareBuffer(RG_NAME(TerrainClipmapDrawArgs), draw_args_desc);
+
+				if (hzb_culling) data.hzb = builder.ReadTexture(RG_NAME(HZB), ReadAccess_NonPixelShader);
+				data.tiles = builder.WriteBuffer(RG_NAME(TerrainClipmapTiles));
+				data.draw_args = builder.WriteBuffer(RG_NAME(TerrainClipmapDrawArgs));
+			},
+			[=](TerrainClipmapCullPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadWriteBuffer(data.tiles), context.GetReadWriteBuffer(data.draw_args) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles) + hzb_culling);
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+				if (hzb_culling) gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 2), context.GetReadOnlyTexture(data.hzb));
+
+				struct TerrainClipmapCullConstants
+				{
+					Uint32 tiles_idx;
+					Uint32 draw_args_idx;
+					Int32  hzb_idx;
+					Uint32 level_count;
+					Uint32 tile_index_count;
+					Float  base_tile_size;
+				} constants =
+				{
+					.tiles_idx = i, .draw_args_idx = i + 1, .hzb_idx = hzb_culling ? (Int32)(i + 2) : -1,
+					.level_count = CLIPMAP_LEVELS, .tile_index_count = clipmap_tile_ib->GetCount(),
+					.base_tile_size = clipmap_base_tile_size
+				};
+
+				cmd_list->SetPipelineState(clipmap_cull_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetRootCBV(2, terrain_constants);
+				cmd_list->Dispatch(1, 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void TerrainRenderer::AddDrawPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct TerrainDrawPassData
+		{
+			RGTextureReadOnlyId    virtual_texture;
+			RGBufferReadOnlyId     tiles;
+			RGBufferIndirectArgsId draw_args;
+		};
+
+		rg.AddPass<TerrainDrawPassData>("Terrain Draw Pass",
+			[=](TerrainDrawPassData& data, RenderGraphBuilder& builder)
+			{
+				data.virtual_texture = builder.ReadTexture(RG_NAME(TerrainVirtualTexture), ReadAccess_PixelShader);
+				data.tiles = builder.ReadBuffer(RG_NAME(TerrainClipmapTiles), ReadAccess_NonPixelShader);
+				data.draw_args = builder.ReadIndirectArgsBuffer(RG_NAME(TerrainClipmapDrawArgs));
+				builder.WriteRenderTarget(RG_NAME(GBufferNormal), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteRenderTarget(RG_NAME(GBufferAlbedo), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteRenderTarget(RG_NAME(GBufferEmissive), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteRenderTarget(RG_NAME(GBufferCustom), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.WriteDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=](TerrainDrawPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.tiles), context.GetReadOnlyTexture(data.virtual_texture) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct TerrainClipmapConstants
+				{
+					Uint32 tiles_idx;
+					Uint32 virtual_texture_idx;
+					Uint32 virtual_texture_levels;
+					Uint32 virtual_texture_resolution;
+					Float  tile_resolution;
+					Float  morph_range;
+				} constants =
+				{
+					.tiles_idx = i, .virtual_texture_idx = i + 1,
+					.virtual_texture_levels = VIRTUAL_TEXTURE_LEVELS, .virtual_texture_resolution = VIRTUAL_TEXTURE_RESOLUTION,
+					.tile_resolution = (Float)CLIPMAP_TILE_RESOLUTION, .morph_range = clipmap_morph_range
+				};
+
+				if (wireframe) terrain_psos->SetFillMode(GfxFillMode::Wireframe);
+				cmd_list->SetPipelineState(terrain_psos->Get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetRootCBV(2, terrain_constants);
+				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
+				GfxIndexBufferView ibv(clipmap_tile_ib.get());
+				cmd_list->SetIndexBuffer(&ibv);
+				cmd_list->DrawIndexedIndirect(context.GetIndirectArgsBuffer(data.draw_args), 0);
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include "Graphics/GfxDescriptor.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
+#include "RenderGraph/RenderGraphResourceId.h"
+#include "entt/entity/entity.hpp"
+
+namespace adria
+{
+	class RenderGraph;
+	class GfxDevice;
+	class GfxTexture;
+	class GfxBuffer;
+	class GfxComputePipelineState;
+	class Heightmap;
+	struct Terrain;
+
+	//draws the Terrain entity as a camera-centred geometry clipmap into the gbuffer.
+	//heights are streamed in tiles around the camera on top of an always resident low resolution overview,
+	//the layer blend is baked into a toroidally updated runtime virtual texture with one slice per clipmap level
+	class TerrainRenderer
+	{
+		static constexpr Uint32 CLIPMAP_LEVELS = 8;
+		static constexpr Uint32 CLIPMAP_TILE_RESOLUTION = 32;
+		static constexpr Uint32 CLIPMAP_TILES_PER_LEVEL = 16;
+		static constexpr Uint32 CLIPMAP_MAX_TILES = CLIPMAP_LEVELS * CLIPMAP_TILES_PER_LEVEL;
+
+		static constexpr Uint32 HEIGHT_TILE_SIZE = 256;
+		static constexpr Int32  HEIGHT_STREAMING_RADIUS = 2;
+		static constexpr Uint32 MAX_RESIDENT_HEIGHT_TILES = 64;
+		static constexpr Uint32 MAX_HEIGHT_TILE_UPLOADS = 2;
+		static constexpr Uint32 OVERVIEW_MAX_RESOLUTION = 1024;
+		static constexpr Uint32 INVALID_TILE = UINT32_MAX;
+
+		static constexpr Uint32 VIRTUAL_TEXTURE_LEVELS = 4;
+		static constexpr Uint32 VIRTUAL_TEXTURE_RESOLUTION = 1024;
+		static constexpr Int32  VIRTUAL_TEXTURE_UPDATE_GRANULARITY = 32;
+
+		struct HeightTile
+		{
+			std::unique_ptr<GfxTexture> texture;
+			GfxDescriptor srv_gpu;
+			Uint64 last_used_frame = 0;
+		};
+
+		struct TerrainLayerConstants
+		{
+			Vector3 albedo_color;
+			Uint32  albedo_idx;
+			Vector2 height_range;
+			Vector2 slope_range;
+			Float   tiling;
+			Float   blend_width;
+			Vector2 _pad;
+		};
+
+		struct TerrainConstants
+		{
+			Vector3 origin;
+			Float   texel_size;
+			Float   height_scale;
+			Float   min_height;
+			Float   max_height;
+			Uint32  height_tile_size;
+			Uint32  heightmap_width;
+			Uint32  heightmap_depth;
+			Uint32  tile_count_x;
+			Uint32  tile_table_idx;
+			Uint32  overview_idx;
+			Uint32  overview_stride;
+			Float   virtual_texture_texel_size;
+			Uint32  layer_count;
+			TerrainLayerConstants layers[4];
+		};
+
+		struct VirtualTextureUpdate
+		{
+			Int32  texel_x;
+			Int32  texel_z;
+			Uint32 width;
+			Uint32 depth;
+			Uint32 level;
+		};
+
+	public:
+		TerrainRenderer(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
+		~TerrainRenderer();
+
+		void Update(Vector3 const& camera_position);
+		void AddPasses(RenderGraph& rg, Bool hzb_culling);
+		void GUI();
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+		}
+
+		Bool IsEnabled() const;
+
+	private:
+		entt::registry& reg;
+		GfxDevice* gfx;
+		Uint32 width, height;
+
+		entt::entity terrain_entity = entt::null;
+		std::shared_ptr<Heightmap> heightmap;
+		Uint32 tile_count_x = 0;
+		Uint32 tile_count_z = 0;
+		Float min_height = 0.0f;
+		Float max_height = 0.0f;
+
+		std::unordered_map<Uint32, HeightTile> resident_tiles;
+		std::vector<Uint32> tile_table;
+		Bool tile_table_dirty = false;
+		std::unique_ptr<GfxBuffer> tile_table_buffer;
+		GfxDescriptor tile_table_srv_gpu;
+		std::unique_ptr<GfxTexture> overview_texture;
+		GfxDescriptor overview_srv_gpu;
+		Uint32 overview_stride = 1;
+		Uint64 frame_index = 0;
+
+		TerrainConstants terrain_constants{};
+
+		std::unique_ptr<GfxTexture> virtual_texture;
+		Int32 virtual_texture_origins[VIRTUAL_TEXTURE_LEVELS][2] = {};
+		Bool virtual_texture_valid = false;
+		std::vector<VirtualTextureUpdate> virtual_texture_updates;
+		Uint64 layers_hash = 0;
+
+		std::unique_ptr<GfxBuffer> clipmap_tile_ib;
+		std::unique_ptr<GfxGraphicsPipelineStatePermutations> terrain_psos;
+		std::unique_ptr<GfxComputePipelineState> clipmap_cull_pso;
+		std::unique_ptr<GfxComputePipelineState> virtual_texture_update_pso;
+
+		//settings
+		Float clipmap_base_tile_size = 8.0f;
+		Float clipmap_morph_range = 0.2f;
+		Float virtual_texture_texel_size = 0.125f;
+		Bool wireframe = false;
+
+	private:
+		void CreatePSOs();
+		void CreateClipmapTile();
+
+		void LoadTerrain(entt::entity entity, Terrain const& terrain);
+		void UnloadTerrain();
+		void StreamHeightTiles(Terrain const& terrain, Vector3 const& camera_position);
+		void UpdateVirtualTexture(Terrain const& terrain, Vector3 const& camera_position);
+
+		void AddVirtualTexturePass(RenderGraph& rg);
+		void AddCullPass(RenderGraph& rg, Bool hzb_culling);
+		void AddDrawPass(RenderGraph& rg);
+	};
+}
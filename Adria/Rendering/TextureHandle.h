@@ -2,11 +2,31 @@
 
 namespace adria
 {
+	//low bits are the texture's slot in the bindless range of the shader visible heap, high bits the slot's generation
 	using TextureHandle = Uint32;
+	inline constexpr Uint32 TEXTURE_HANDLE_INDEX_BITS = 20;
+	inline constexpr Uint32 TEXTURE_HANDLE_INDEX_MASK = (1u << TEXTURE_HANDLE_INDEX_BITS) - 1;
+	inline constexpr Uint32 TEXTURE_HANDLE_GENERATION_MASK = (1u << (32 - TEXTURE_HANDLE_INDEX_BITS)) - 1;
+
 	inline constexpr TextureHandle INVALID_TEXTURE_HANDLE = TextureHandle(-1);
 	inline constexpr TextureHandle DEFAULT_BLACK_TEXTURE_HANDLE = TextureHandle(0);
 	inline constexpr TextureHandle DEFAULT_WHITE_TEXTURE_HANDLE = TextureHandle(1);
 	inline constexpr TextureHandle DEFAULT_NORMAL_TEXTURE_HANDLE = TextureHandle(2);
 	inline constexpr TextureHandle DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE = TextureHandle(3);
 	inline constexpr TextureHandle TEXTURE_MANAGER_START_HANDLE = TextureHandle(4);
-}
\ No newline at end of file
+	inline constexpr Uint32 TEXTURE_MANAGER_BINDLESS_RANGE = 1024;
+
+	inline constexpr TextureHandle MakeTextureHandle(Uint32 index, Uint32 generation)
+	{
+		return TextureHandle(((generation & TEXTURE_HANDLE_GENERATION_MASK) << TEXTURE_HANDLE_INDEX_BITS) | (index & TEXTURE_HANDLE_INDEX_MASK));
+	}
+	//index shaders use to address the texture, invalid handles stay invalid
+	inline constexpr Uint32 GetTextureIndex(TextureHandle handle)
+	{
+		return handle == INVALID_TEXTURE_HANDLE ? Uint32(-1) : (handle & TEXTURE_HANDLE_INDEX_MASK);
+	}
+	inline constexpr Uint32 GetTextureGeneration(TextureHandle handle)
+	{
+		return handle >> TEXTURE_HANDLE_INDEX_BITS;
+	}
+}
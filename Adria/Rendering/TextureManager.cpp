@@ -1,17 +1,84 @@
 #include "d3dx12.h"
+#include <filesystem>
 
 #include "TextureManager.h"
 #include "Graphics/GfxTexture.h"
+#include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxDevice.h"
+#include "Graphics/GfxResidencyManager.h"
 #include "Graphics/GfxCommon.h"
 #include "Graphics/GfxCommandList.h"
 #include "Graphics/GfxShaderCompiler.h"
 #include "Logging/Logger.h"
+#include "Core/ConsoleManager.h"
+#include "Core/MemoryTracker.h"
 #include "Utilities/Image.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/TextureCooker.h"
 
 
 namespace adria
 {
+	static TAutoConsoleVariable<Bool> AsyncTextureLoading("r.AsyncTextureLoading", true, "0 - Textures are decoded and uploaded on the calling thread, 1 - Textures are decoded on the thread pool and uploaded on the copy queue");
+	static TAutoConsoleVariable<Bool> TextureStreaming("r.TextureStreaming", true, "Stream texture mips in and out based on their on-screen size and the GPU memory budget");
+	static TAutoConsoleVariable<Bool> TextureCooking("r.TextureCooking", true, "Cook material textures into block compressed DDS files with full mip chains, cached next to the source");
+	static constexpr Uint64 MAX_UPLOAD_SIZE_PER_FRAME = 64 * 1024 * 1024;
+	static constexpr Uint32 MAX_STREAMING_REQUESTS = 16;
+	static constexpr Uint32 STREAMING_TAIL_SIZE = 64;
+	static constexpr Uint32 STREAMING_EVICT_FRAMES = 120;
+	static constexpr Uint32 STREAMING_BIAS_FRAMES = 30;
+	static constexpr Uint32 MAX_STREAMING_MIP_BIAS = 4;
+
+	namespace
+	{
+		Bool CanGenerateMips(Image const& img)
+		{
+			if (img.MipLevels() > 1 || img.IsCubemap() || img.Depth() > 1 || std::max(img.Width(), img.Height()) <= 1) return false;
+			return img.Format() == GfxFormat::R8G8B8A8_UNORM || img.Format() == GfxFormat::R32G32B32A32_FLOAT;
+		}
+
+		Bool InitTextureDesc(Image const& img, Bool srgb, Uint32 first_mip, Bool generate_mips, GfxTextureDesc& desc, std::vector<GfxTextureSubData>& tex_data)
+		{
+			first_mip = std::min(first_mip, img.MipLevels() - 1);
+			desc.type = img.Depth() > 1 ? GfxTextureType_3D : GfxTextureType_2D;
+			desc.width = std::max(img.Width() >> first_mip, 1u);
+			desc.height = std::max(img.Height() >> first_mip, 1u);
+			desc.array_size = img.IsCubemap() ? 6 : 1;
+			desc.depth = img.Depth();
+			desc.bind_flags = GfxBindFlag::ShaderResource;
+			desc.format = img.Format();
+			desc.initial_state = GfxResourceState::AllSRV;
+			desc.heap_type = GfxResourceUsage::Default;
+			desc.mip_levels = img.MipLevels() - first_mip;
+			desc.misc_flags = img.IsCubemap() ? GfxTextureMiscFlag::TextureCube : GfxTextureMiscFlag::None;
+			if (srgb)
+			{
+				desc.misc_flags |= GfxTextureMiscFlag::SRGB;
+			}
+
+			Uint32 const loaded_mips = desc.mip_levels;
+			Bool const needs_mips = generate_mips && CanGenerateMips(img);
+			if (needs_mips)
+			{
+				desc.mip_levels = (Uint32)std::log2(std::max(desc.width, desc.height)) + 1;
+				desc.bind_flags |= GfxBindFlag::UnorderedAccess;
+			}
+
+			Image const* curr_img = &img;
+			while (curr_img)
+			{
+				for (Uint32 i = 0; i < loaded_mips; ++i)
+				{
+					GfxTextureSubData& data = tex_data.emplace_back();
+					data.data = curr_img->MipData(first_mip + i);
+					data.row_pitch = GetRowPitch(curr_img->Format(), desc.width, i);
+					data.slice_pitch = GetSlicePitch(img.Format(), desc.width, desc.height, i);
+				}
+				curr_img = curr_img->NextImage();
+			}
+			return needs_mips;
+		}
+	}
 
     TextureManager::TextureManager() {}
     TextureManager::~TextureManager() = default;
@@ -19,18 +86,33 @@ namespace adria
 	void TextureManager::Initialize(GfxDevice* _gfx)
 	{
         gfx = _gfx;
+		slot_generations.assign(TEXTURE_MANAGER_BINDLESS_RANGE, 0);
 	}
 
 	void TextureManager::Clear()
 	{
+		std::lock_guard lock(load_mutex);
 		for (auto& [handle, descriptor] : texture_srv_map)
 		{
 			gfx->FreeDescriptorCPU(descriptor, GfxDescriptorHeapType::CBV_SRV_UAV);
 		}
-		handle = TEXTURE_MANAGER_START_HANDLE;
+		//handles from the previous scene go stale and the bindless range is filled from the start again
+		for (Uint32 index = TEXTURE_MANAGER_START_HANDLE; index < next_slot; ++index) ++slot_generations[index];
+		free_slots.clear();
+		next_slot = TEXTURE_MANAGER_START_HANDLE;
+		pending_textures.clear();
+		uploading_textures.clear();
+		streaming_textures.clear();
+		mip_requests.clear();
+		mip_bias = 0;
+		for (auto const& [texture_handle, texture] : texture_map)
+		{
+			if (texture) gfx->GetResidencyManager()->Unregister(texture->GetPageable());
+		}
 		texture_srv_map.clear();
 		texture_map.clear();
 		loaded_textures.clear();
+		texture_load_descs.clear();
 		is_scene_initialized = false;
 	}
 
@@ -40,62 +122,71 @@ namespace adria
 		gfx = nullptr;
 	}
 
-    TextureHandle TextureManager::LoadTexture(std::string_view path, Bool srgb)
-    {
-        std::string texture_name(path);
-        if (auto it = loaded_textures.find(texture_name); it == loaded_textures.end())
-        {
-            ++handle;
-            loaded_textures.insert({ texture_name, handle });
-            Image img(path);
+	TextureHandle TextureManager::LoadTexture(std::string_view path, Bool srgb, TextureCookMode cook_mode)
+	{
+		TextureLoadDesc const desc{ .path = std::string(path), .srgb = srgb, .cook_mode = cook_mode };
+		TextureHandle texture_handle = INVALID_TEXTURE_HANDLE;
+		LoadTextures(std::span(&desc, 1), std::span(&texture_handle, 1));
+		return texture_handle;
+	}
 
-			GfxTextureDesc desc{};
-			desc.type = img.Depth() > 1 ? GfxTextureType_3D : GfxTextureType_2D;
-			desc.misc_flags = GfxTextureMiscFlag::None;
-			desc.width = img.Width();
-			desc.height = img.Height();
-			desc.array_size = img.IsCubemap() ? 6 : 1;
-			desc.depth = img.Depth();
-			desc.bind_flags = GfxBindFlag::ShaderResource;
-			desc.format = img.Format();
-			desc.initial_state = GfxResourceState::AllSRV; 
-			desc.heap_type = GfxResourceUsage::Default;
-			desc.mip_levels = img.MipLevels();
-            desc.misc_flags = img.IsCubemap() ? GfxTextureMiscFlag::TextureCube : GfxTextureMiscFlag::None;
-			if (srgb)
+	void TextureManager::LoadTextures(std::span<TextureLoadDesc const> descs, std::span<TextureHandle> handles)
+	{
+		MemoryTagScope memory_scope(MemoryTag::TextureManager);
+		ADRIA_ASSERT(handles.size() >= descs.size());
+		struct NewTexture
+		{
+			TextureHandle handle;
+			std::string name;
+			Bool srgb;
+			TextureCookMode cook_mode;
+			std::future<std::unique_ptr<Image>> image;
+		};
+		std::vector<NewTexture> new_textures;
+
+		std::lock_guard lock(load_mutex);
+		for (Uint64 i = 0; i < descs.size(); ++i)
+		{
+			std::string texture_name = std::filesystem::path(descs[i].path).lexically_normal().generic_string();
+			if (auto it = loaded_textures.find(texture_name); it != loaded_textures.end())
 			{
-				desc.misc_flags |= GfxTextureMiscFlag::SRGB;
+				handles[i] = it->second;
+				continue;
 			}
 
-            std::vector<GfxTextureSubData> tex_data;
-			const Image* curr_img = &img;
-			while (curr_img)
+			TextureCookMode const cook_mode = TextureCooking.Get() ? descs[i].cook_mode : TextureCookMode::None;
+			Bool const srgb = descs[i].srgb;
+			TextureHandle const new_handle = AllocateHandle();
+			handles[i] = new_handle;
+			loaded_textures.insert({ texture_name, new_handle });
+			texture_load_descs[new_handle] = TextureLoadDesc{ .path = texture_name, .srgb = descs[i].srgb, .cook_mode = descs[i].cook_mode };
+			NewTexture& new_texture = new_textures.emplace_back(NewTexture{ new_handle, texture_name, srgb, cook_mode });
+			new_texture.image = g_ThreadPool.Submit([texture_name, cook_mode, srgb]() { return LoadCookedImage(texture_name, cook_mode, srgb); });
+		}
+
+		for (NewTexture& new_texture : new_textures)
+		{
+			if (AsyncTextureLoading.Get())
 			{
-				for (Uint32 i = 0; i < desc.mip_levels; ++i)
+				pending_textures.push_back(PendingTexture{ new_texture.handle, new_texture.srgb, INVALID_MIP, mipmaps, std::move(new_texture.image) });
+				streaming_textures[new_texture.handle] = StreamingTexture{ .path = new_texture.name, .srgb = new_texture.srgb, .generate_mips = mipmaps, .cook_mode = new_texture.cook_mode };
+				if (is_scene_initialized)
 				{
-                    GfxTextureSubData& data = tex_data.emplace_back();
-					data.data = curr_img->MipData(i);
-					data.row_pitch = GetRowPitch(curr_img->Format(), desc.width, i);
-					data.slice_pitch = GetSlicePitch(img.Format(), desc.width, desc.height, i);
+					gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(GetTextureIndex(new_texture.handle)), gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV));
 				}
-                curr_img = curr_img->NextImage();
 			}
-
-			GfxTextureData init_data{};
-			init_data.sub_data = tex_data.data();
-			init_data.sub_count = (Uint32)tex_data.size();
-            std::unique_ptr<GfxTexture> tex = gfx->CreateTexture(desc, init_data);
-
-            texture_map[handle] = std::move(tex);
-			CreateViewForTexture(handle);
-			return handle;
-        }
-	    else return it->second;
-    }
+			else
+			{
+				std::unique_ptr<Image> img = new_texture.image.get();
+				CreateTexture(new_texture.handle, *img, new_texture.srgb, 0, mipmaps);
+			}
+		}
+	}
 
 	TextureHandle TextureManager::LoadCubemap(std::array<std::string, 6> const& cubemap_textures)
 	{
-		++handle;
+		std::lock_guard lock(load_mutex);
+		TextureHandle const handle = AllocateHandle();
 		GfxTextureDesc desc{};
 		desc.type = GfxTextureType_2D;
 		desc.mip_levels = 1;
@@ -119,6 +210,7 @@ namespace adria
 
 		GfxTextureData init_data{};
 		init_data.sub_data = subresources.data();
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::Textures);
 		std::unique_ptr<GfxTexture> cubemap = gfx->CreateTexture(desc, init_data);
 
 		texture_map.insert({ handle, std::move(cubemap) });
@@ -126,18 +218,82 @@ namespace adria
 		return handle;
 	}
 
+	void TextureManager::UnloadTexture(TextureHandle handle)
+	{
+		std::lock_guard lock(load_mutex);
+		if (!IsHandleValid(handle) || GetTextureIndex(handle) < TEXTURE_MANAGER_START_HANDLE) return;
+
+		std::erase_if(pending_textures, [handle](PendingTexture const& pending) { return pending.handle == handle; });
+		std::erase_if(uploading_textures, [handle](UploadingTexture const& uploading) { return uploading.handle == handle; });
+		std::erase_if(mip_requests, [handle](MipGenerationRequest const& request) { return request.handle == handle; });
+		std::erase_if(loaded_textures, [handle](auto const& loaded_texture) { return loaded_texture.second == handle; });
+		texture_load_descs.erase(handle);
+		streaming_textures.erase(handle);
+		if (auto it = texture_map.find(handle); it != texture_map.end())
+		{
+			if (it->second) gfx->GetResidencyManager()->Unregister(it->second->GetPageable());
+			texture_map.erase(it);
+		}
+		if (auto it = texture_srv_map.find(handle); it != texture_srv_map.end())
+		{
+			gfx->FreeDescriptorCPU(it->second, GfxDescriptorHeapType::CBV_SRV_UAV);
+			texture_srv_map.erase(it);
+		}
+
+		Uint32 const index = GetTextureIndex(handle);
+		if (is_scene_initialized)
+		{
+			gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(index), gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV));
+		}
+		slot_generations[index] = (slot_generations[index] + 1) & TEXTURE_HANDLE_GENERATION_MASK;
+		free_slots.push_back(FreeSlot{ index, current_frame });
+	}
+
 	GfxDescriptor TextureManager::GetSRV(TextureHandle tex_handle)
 	{
-		return texture_srv_map[tex_handle];
+		std::lock_guard lock(load_mutex);
+		if (!IsHandleValid(tex_handle)) return gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV);
+		if (auto it = texture_srv_map.find(tex_handle); it != texture_srv_map.end()) return it->second;
+		return gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV);
 	}
 
-	GfxTexture* TextureManager::GetTexture(TextureHandle handle) const
+	GfxTexture* TextureManager::GetTexture(TextureHandle handle)
 	{
 		if (handle == INVALID_TEXTURE_HANDLE) return nullptr;
-		else if (auto it = texture_map.find(handle); it != texture_map.end()) return it->second.get();
+
+		std::lock_guard lock(load_mutex);
+		if (!IsHandleValid(handle)) return nullptr;
+		if (!texture_map.contains(handle)) FinishPendingTexture(handle);
+		if (auto it = texture_map.find(handle); it != texture_map.end()) return it->second.get();
 		else return nullptr;
 	}
 
+	Bool TextureManager::GetLoadDesc(TextureHandle handle, TextureLoadDesc& desc)
+	{
+		std::lock_guard lock(load_mutex);
+		if (!IsHandleValid(handle)) return false;
+		if (auto it = texture_load_descs.find(handle); it != texture_load_descs.end())
+		{
+			desc = it->second;
+			return true;
+		}
+		return false;
+	}
+
+	std::vector<TextureManager::MipGenerationRequest> TextureManager::ConsumeMipGenerationRequests()
+	{
+		std::lock_guard lock(load_mutex);
+		std::vector<MipGenerationRequest> requests = std::move(mip_requests);
+		mip_requests.clear();
+		std::erase_if(requests, [this](MipGenerationRequest const& request)
+			{
+				auto it = texture_map.find(request.handle);
+				return it == texture_map.end() || it->second.get() != request.texture;
+			});
+		for (MipGenerationRequest const& request : requests) CreateViewForTexture(request.handle);
+		return requests;
+	}
+
 	void TextureManager::EnableMipMaps(Bool mips)
     {
         mipmaps = mips;
@@ -145,30 +301,303 @@ namespace adria
 
 	void TextureManager::OnSceneInitialized()
 	{
-		gfx->InitShaderVisibleAllocator(1024);
+		gfx->InitShaderVisibleAllocator(TEXTURE_MANAGER_BINDLESS_RANGE);
 		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((Uint32)DEFAULT_BLACK_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV));
 		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((Uint32)DEFAULT_WHITE_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::WhiteTexture2D_SRV));
 		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((Uint32)DEFAULT_NORMAL_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::DefaultNormal2D_SRV));
 		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((Uint32)DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::MetallicRoughness2D_SRV));
-		for (Uint64 i = TEXTURE_MANAGER_START_HANDLE; i <= handle; ++i)
+		std::lock_guard lock(load_mutex);
+		for (Uint32 index = TEXTURE_MANAGER_START_HANDLE; index < next_slot; ++index)
         {
-            GfxTexture* texture = texture_map[TextureHandle(i)].get();
-            if (texture)
+            if (auto it = texture_map.find(MakeTextureHandle(index, slot_generations[index])); it != texture_map.end() && it->second)
             {
-                CreateViewForTexture(TextureHandle(i), true);
+                CreateViewForTexture(it->first, true);
             }
+			else
+			{
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(index), gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV));
+			}
         }
         is_scene_initialized = true;
 	}
 
+	void TextureManager::Update()
+	{
+		MemoryTagScope memory_scope(MemoryTag::TextureManager);
+		std::lock_guard lock(load_mutex);
+		GfxFence& upload_fence = gfx->GetUploadFence();
+		std::erase_if(uploading_textures, [this, &upload_fence](UploadingTexture& uploading_texture)
+			{
+				if (!upload_fence.IsCompleted(uploading_texture.upload_fence_value)) return false;
+				if (uploading_texture.texture)
+				{
+					SetTexture(uploading_texture.handle, std::move(uploading_texture.texture));
+					if (uploading_texture.generate_mips) QueueMipGeneration(uploading_texture.handle, GfxResourceState::Common);
+					CreateViewForTexture(uploading_texture.handle);
+				}
+				if (auto it = streaming_textures.find(uploading_texture.handle); it != streaming_textures.end())
+				{
+					it->second.resident_mip = uploading_texture.first_mip;
+					it->second.streaming = false;
+				}
+				return true;
+			});
+
+		Uint64 upload_size = 0;
+		Uint64 const first_upload = uploading_textures.size();
+		for (auto it = pending_textures.begin(); it != pending_textures.end() && upload_size < MAX_UPLOAD_SIZE_PER_FRAME;)
+		{
+			if (it->image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++it;
+				continue;
+			}
+			std::unique_ptr<Image> img = it->image.get();
+			Uint32 const first_mip = it->first_mip != INVALID_MIP ? it->first_mip : OnTextureDecoded(it->handle, *img);
+			UploadingTexture& uploading_texture = uploading_textures.emplace_back(UploadTexture(it->handle, *img, it->srgb, first_mip, it->generate_mips));
+			upload_size += uploading_texture.staging_buffer->GetSize();
+			it = pending_textures.erase(it);
+		}
+		if (first_upload != uploading_textures.size())
+		{
+			Uint64 const upload_fence_value = gfx->IncrementUploadFenceValue();
+			gfx->GetCommandList(GfxCommandListType::Copy)->Signal(upload_fence, upload_fence_value);
+			for (Uint64 i = first_upload; i < uploading_textures.size(); ++i) uploading_textures[i].upload_fence_value = upload_fence_value;
+		}
+
+		++current_frame;
+		if (TextureStreaming.Get()) UpdateStreaming();
+	}
+
+	void TextureManager::RequestTexture(TextureHandle handle, Float screen_size)
+	{
+		if (handle == INVALID_TEXTURE_HANDLE) return;
+
+		std::lock_guard lock(load_mutex);
+		if (auto it = streaming_textures.find(handle); it != streaming_textures.end())
+		{
+			StreamingTexture& streaming_texture = it->second;
+			streaming_texture.requested_size = std::max(streaming_texture.requested_size, screen_size);
+			streaming_texture.last_request_frame = current_frame;
+			if (auto texture_it = texture_map.find(handle); texture_it != texture_map.end() && texture_it->second && streaming_texture.resident_mip != INVALID_MIP)
+			{
+				Uint32 const resident_size = std::max(std::max(streaming_texture.width, streaming_texture.height) >> streaming_texture.resident_mip, 1u);
+				gfx->GetResidencyManager()->MarkUsed(texture_it->second->GetPageable(), screen_size / resident_size);
+			}
+		}
+	}
+
+	void TextureManager::UpdateStreaming()
+	{
+		if (current_frame - last_bias_change_frame > STREAMING_BIAS_FRAMES)
+		{
+			GPUMemoryUsage const memory_usage = gfx->GetMemoryUsage();
+			if (memory_usage.usage > memory_usage.budget / 20 * 19 && mip_bias < MAX_STREAMING_MIP_BIAS)
+			{
+				++mip_bias;
+				last_bias_change_frame = current_frame;
+			}
+			else if (memory_usage.usage < memory_usage.budget / 10 * 8 && mip_bias > 0)
+			{
+				--mip_bias;
+				last_bias_change_frame = current_frame;
+			}
+		}
+
+		Uint32 streaming_requests = 0;
+		for (auto const& [handle, streaming_texture] : streaming_textures)
+		{
+			if (streaming_texture.streaming) ++streaming_requests;
+		}
+
+		for (auto& [handle, streaming_texture] : streaming_textures)
+		{
+			if (streaming_texture.streaming || streaming_texture.mip_levels <= 1)
+			{
+				streaming_texture.requested_size = 0.0f;
+				continue;
+			}
+
+			Uint32 const desired_mip = GetDesiredMip(streaming_texture);
+			streaming_texture.requested_size = 0.0f;
+			Bool const stream_in = desired_mip < streaming_texture.resident_mip;
+			Bool const stream_out = desired_mip > streaming_texture.resident_mip + 1;
+			if ((!stream_in && !stream_out) || streaming_requests >= MAX_STREAMING_REQUESTS) continue;
+
+			std::string path = streaming_texture.path;
+			TextureCookMode const cook_mode = streaming_texture.cook_mode;
+			Bool const srgb = streaming_texture.srgb;
+			pending_textures.push_back(PendingTexture{ handle, srgb, desired_mip, streaming_texture.generate_mips, g_ThreadPool.Submit([path, cook_mode, srgb]() { return LoadCookedImage(path, cook_mode, srgb); }) });
+			streaming_texture.streaming = true;
+			++streaming_requests;
+		}
+	}
+
+	Uint32 TextureManager::GetDesiredMip(StreamingTexture const& streaming_texture) const
+	{
+		Uint32 const max_size = std::max(streaming_texture.width, streaming_texture.height);
+		Uint32 tail_mip = 0;
+		while (tail_mip + 1 < streaming_texture.mip_levels && (max_size >> tail_mip) > STREAMING_TAIL_SIZE) ++tail_mip;
+
+		Uint32 desired_mip = 0;
+		if (streaming_texture.requested_size > 0.0f)
+		{
+			Float const texels_per_pixel = max_size / streaming_texture.requested_size;
+			desired_mip = texels_per_pixel > 1.0f ? (Uint32)std::floor(std::log2(texels_per_pixel)) : 0;
+		}
+		else if (streaming_texture.last_request_frame != 0)
+		{
+			if (current_frame - streaming_texture.last_request_frame < STREAMING_EVICT_FRAMES) return streaming_texture.resident_mip;
+			desired_mip = tail_mip;
+		}
+		return std::min(desired_mip + mip_bias, tail_mip);
+	}
+
+	Uint32 TextureManager::OnTextureDecoded(TextureHandle handle, Image const& img)
+	{
+		auto it = streaming_textures.find(handle);
+		if (it == streaming_textures.end()) return 0;
+
+		StreamingTexture& streaming_texture = it->second;
+		streaming_texture.width = img.Width();
+		streaming_texture.height = img.Height();
+		streaming_texture.mip_levels = img.IsCubemap() || img.Depth() > 1 ? 1 : img.MipLevels();
+		if (!TextureStreaming.Get() || streaming_texture.mip_levels <= 1) return 0;
+		return GetDesiredMip(streaming_texture);
+	}
+
+	TextureHandle TextureManager::AllocateHandle()
+	{
+		//freed slots are reused only once the frames that could still sample them have retired
+		if (!free_slots.empty() && free_slots.front().free_frame + GFX_BACKBUFFER_COUNT < current_frame)
+		{
+			Uint32 const index = free_slots.front().index;
+			free_slots.erase(free_slots.begin());
+			return MakeTextureHandle(index, slot_generations[index]);
+		}
+		ADRIA_ASSERT_MSG(next_slot < TEXTURE_MANAGER_BINDLESS_RANGE, "Bindless texture range exhausted!");
+		Uint32 const index = next_slot++;
+		return MakeTextureHandle(index, slot_generations[index]);
+	}
+
+	Bool TextureManager::IsHandleValid(TextureHandle handle) const
+	{
+		Uint32 const index = GetTextureIndex(handle);
+		if (index < TEXTURE_MANAGER_START_HANDLE) return handle == index;
+		return index < next_slot && GetTextureGeneration(handle) == slot_generations[index];
+	}
+
 	void TextureManager::CreateViewForTexture(TextureHandle handle, Bool flag)
 	{
         if (!is_scene_initialized && !flag) return;
 
 		GfxTexture* texture = texture_map[handle].get();
 		ADRIA_ASSERT(texture);
-        texture_srv_map[handle] = gfx->CreateTextureSRV(texture);
-        gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((Uint32)handle), texture_srv_map[handle]);
+		if (auto it = texture_srv_map.find(handle); it != texture_srv_map.end())
+		{
+			gfx->FreeDescriptorCPU(it->second, GfxDescriptorHeapType::CBV_SRV_UAV);
+		}
+		//until its mip chain is generated only the top mip is visible to shaders
+		Bool const mips_pending = std::any_of(mip_requests.begin(), mip_requests.end(), [handle](MipGenerationRequest const& request) { return request.handle == handle; });
+		GfxTextureDescriptorDesc srv_desc{};
+		if (mips_pending) srv_desc.mip_count = 1;
+        texture_srv_map[handle] = gfx->CreateTextureSRV(texture, &srv_desc);
+        gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(GetTextureIndex(handle)), texture_srv_map[handle]);
+	}
+
+	void TextureManager::SetTexture(TextureHandle handle, std::unique_ptr<GfxTexture>&& texture)
+	{
+		std::unique_ptr<GfxTexture>& current_texture = texture_map[handle];
+		if (current_texture) gfx->GetResidencyManager()->Unregister(current_texture->GetPageable());
+		current_texture = std::move(texture);
+	}
+
+	void TextureManager::QueueMipGeneration(TextureHandle handle, GfxResourceState state)
+	{
+		MipGenerationRequest& request = mip_requests.emplace_back();
+		request.handle = handle;
+		request.texture = texture_map[handle].get();
+		request.state = state;
+	}
+
+	void TextureManager::CreateTexture(TextureHandle handle, Image const& img, Bool srgb, Uint32 first_mip, Bool generate_mips)
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::Textures);
+		GfxTextureDesc desc{};
+		std::vector<GfxTextureSubData> tex_data;
+		Bool const needs_mips = InitTextureDesc(img, srgb, first_mip, generate_mips, desc, tex_data);
+
+		GfxTextureData init_data{};
+		init_data.sub_data = tex_data.data();
+		init_data.sub_count = (Uint32)tex_data.size();
+		SetTexture(handle, gfx->CreateTexture(desc, init_data));
+		if (needs_mips) QueueMipGeneration(handle, desc.initial_state);
+		CreateViewForTexture(handle);
+	}
+
+	TextureManager::UploadingTexture TextureManager::UploadTexture(TextureHandle handle, Image const& img, Bool srgb, Uint32 first_mip, Bool generate_mips)
+	{
+		GfxMemoryCategoryScope memory_scope(GfxMemoryCategory::Textures);
+		GfxTextureDesc desc{};
+		std::vector<GfxTextureSubData> tex_data;
+		Bool const needs_mips = InitTextureDesc(img, srgb, first_mip, generate_mips, desc, tex_data);
+		desc.initial_state = GfxResourceState::Common;
+
+		UploadingTexture uploading_texture{};
+		uploading_texture.handle = handle;
+		uploading_texture.first_mip = first_mip;
+		uploading_texture.generate_mips = needs_mips;
+		uploading_texture.texture = gfx->CreateTexture(desc);
+
+		ID3D12Resource* resource = uploading_texture.texture->GetNative();
+		D3D12_RESOURCE_DESC resource_desc = resource->GetDesc();
+		Uint32 const subresource_count = (Uint32)tex_data.size();
+		Uint64 required_size = 0;
+		gfx->GetDevice()->GetCopyableFootprints(&resource_desc, 0, subresource_count, 0, nullptr, nullptr, nullptr, &required_size);
+
+		GfxBufferDesc staging_desc{};
+		staging_desc.size = required_size;
+		staging_desc.resource_usage = GfxResourceUsage::Upload;
+		uploading_texture.staging_buffer = gfx->CreateBuffer(staging_desc);
+
+		std::vector<D3D12_SUBRESOURCE_DATA> subresource_data(subresource_count);
+		for (Uint32 i = 0; i < subresource_count; ++i)
+		{
+			subresource_data[i].pData = tex_data[i].data;
+			subresource_data[i].RowPitch = tex_data[i].row_pitch;
+			subresource_data[i].SlicePitch = tex_data[i].slice_pitch;
+		}
+		GfxCommandList* copy_cmd_list = gfx->GetCommandList(GfxCommandListType::Copy);
+		UpdateSubresources(copy_cmd_list->GetNative(), resource, uploading_texture.staging_buffer->GetNative(), 0, 0, subresource_count, subresource_data.data());
+		return uploading_texture;
+	}
+
+	void TextureManager::FinishPendingTexture(TextureHandle handle)
+	{
+		if (auto it = std::find_if(pending_textures.begin(), pending_textures.end(), [handle](PendingTexture const& pending) { return pending.handle == handle; }); it != pending_textures.end())
+		{
+			std::unique_ptr<Image> img = it->image.get();
+			Uint32 const first_mip = it->first_mip != INVALID_MIP ? it->first_mip : OnTextureDecoded(handle, *img);
+			CreateTexture(handle, *img, it->srgb, first_mip, it->generate_mips);
+			if (auto streaming_it = streaming_textures.find(handle); streaming_it != streaming_textures.end())
+			{
+				streaming_it->second.resident_mip = first_mip;
+				streaming_it->second.streaming = false;
+			}
+			pending_textures.erase(it);
+		}
+		else if (auto it = std::find_if(uploading_textures.begin(), uploading_textures.end(), [handle](UploadingTexture const& uploading) { return uploading.handle == handle; }); it != uploading_textures.end() && it->texture)
+		{
+			gfx->GetCommandList()->Wait(gfx->GetUploadFence(), it->upload_fence_value);
+			SetTexture(handle, std::move(it->texture));
+			if (it->generate_mips) QueueMipGeneration(handle, GfxResourceState::Common);
+			CreateViewForTexture(handle);
+			if (auto streaming_it = streaming_textures.find(handle); streaming_it != streaming_textures.end())
+			{
+				streaming_it->second.resident_mip = it->first_mip;
+				streaming_it->second.streaming = false;
+			}
+		}
 	}
 
 }
\ No newline at end of file
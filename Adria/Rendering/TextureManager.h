@@ -1,13 +1,26 @@
 #pragma once
+#include <future>
+#include <mutex>
 #include "TextureHandle.h"
 #include "Graphics/GfxDescriptor.h"
+#include "Graphics/GfxResourceCommon.h"
 #include "Utilities/Singleton.h"
 #include "Utilities/Ref.h"
+#include "Utilities/TextureCooker.h"
 
 namespace adria
 {
 	class GfxDevice;
 	class GfxTexture;
+	class GfxBuffer;
+	class Image;
+
+	struct TextureLoadDesc
+	{
+		std::string path;
+		Bool srgb = false;
+		TextureCookMode cook_mode = TextureCookMode::None;
+	};
 
 	class TextureManager : public Singleton<TextureManager>
 	{
@@ -20,20 +33,86 @@ namespace adria
 		void Clear();
 		void Destroy();
 
-		ADRIA_NODISCARD TextureHandle LoadTexture(std::string_view path, Bool srgb = false);
+		ADRIA_NODISCARD TextureHandle LoadTexture(std::string_view path, Bool srgb = false, TextureCookMode cook_mode = TextureCookMode::None);
+		//deduplicates the batch and decodes every new texture in parallel, handles has to be as large as descs
+		void LoadTextures(std::span<TextureLoadDesc const> descs, std::span<TextureHandle> handles);
 		ADRIA_NODISCARD TextureHandle LoadCubemap(std::array<std::string, 6> const& cubemap_textures);
+		//the handle's slot is recycled with a new generation once the gpu can no longer reference it
+		void UnloadTexture(TextureHandle handle);
 		ADRIA_NODISCARD GfxDescriptor GetSRV(TextureHandle handle);
-		ADRIA_NODISCARD GfxTexture* GetTexture(TextureHandle handle) const;
+		ADRIA_NODISCARD GfxTexture* GetTexture(TextureHandle handle);
+		//how a texture loaded from a file was requested, false for textures created from memory or cubemap faces
+		Bool GetLoadDesc(TextureHandle handle, TextureLoadDesc& desc);
 		void EnableMipMaps(Bool);
 		void OnSceneInitialized();
+		void Update();
+		void RequestTexture(TextureHandle handle, Float screen_size);
+
+		struct MipGenerationRequest
+		{
+			TextureHandle handle;
+			GfxTexture* texture;
+			GfxResourceState state;
+		};
+		std::vector<MipGenerationRequest> ConsumeMipGenerationRequests();
 
 	private:
+		static constexpr Uint32 INVALID_MIP = Uint32(-1);
+
+		struct PendingTexture
+		{
+			TextureHandle handle;
+			Bool srgb;
+			Uint32 first_mip;
+			Bool generate_mips;
+			std::future<std::unique_ptr<Image>> image;
+		};
+		struct UploadingTexture
+		{
+			TextureHandle handle;
+			Uint32 first_mip;
+			Bool generate_mips;
+			std::unique_ptr<GfxTexture> texture;
+			std::unique_ptr<GfxBuffer> staging_buffer;
+			Uint64 upload_fence_value;
+		};
+		struct FreeSlot
+		{
+			Uint32 index;
+			Uint64 free_frame;
+		};
+		struct StreamingTexture
+		{
+			std::string path;
+			Bool srgb;
+			Bool generate_mips = true;
+			TextureCookMode cook_mode = TextureCookMode::None;
+			Uint32 width = 0;
+			Uint32 height = 0;
+			Uint32 mip_levels = 0;
+			Uint32 resident_mip = INVALID_MIP;
+			Float requested_size = 0.0f;
+			Uint64 last_request_frame = 0;
+			Bool streaming = true;
+		};
+
 		GfxDevice* gfx = nullptr;
+		std::mutex load_mutex;
+		std::vector<PendingTexture> pending_textures;
+		std::vector<UploadingTexture> uploading_textures;
+		std::unordered_map<TextureHandle, StreamingTexture> streaming_textures;
+		std::vector<MipGenerationRequest> mip_requests;
+		Uint64 current_frame = 0;
+		Uint64 last_bias_change_frame = 0;
+		Uint32 mip_bias = 0;
 		
 		std::unordered_map<TextureName, TextureHandle> loaded_textures;
+		std::unordered_map<TextureHandle, TextureLoadDesc> texture_load_descs;
 		std::unordered_map<TextureHandle, std::unique_ptr<GfxTexture>> texture_map;
 		std::unordered_map<TextureHandle, GfxDescriptor> texture_srv_map;
-		TextureHandle handle = TEXTURE_MANAGER_START_HANDLE;
+		std::vector<Uint32> slot_generations;
+		std::vector<FreeSlot> free_slots;
+		Uint32 next_slot = TEXTURE_MANAGER_START_HANDLE;
 		Bool mipmaps = true;
 		Bool is_scene_initialized = false;
 
@@ -41,7 +120,17 @@ namespace adria
 		TextureManager();
 		~TextureManager();
 
+		TextureHandle AllocateHandle();
+		Bool IsHandleValid(TextureHandle handle) const;
 		void CreateViewForTexture(TextureHandle handle, Bool flag = false);
+		void SetTexture(TextureHandle handle, std::unique_ptr<GfxTexture>&& texture);
+		void CreateTexture(TextureHandle handle, Image const& img, Bool srgb, Uint32 first_mip = 0, Bool generate_mips = false);
+		UploadingTexture UploadTexture(TextureHandle handle, Image const& img, Bool srgb, Uint32 first_mip, Bool generate_mips);
+		void QueueMipGeneration(TextureHandle handle, GfxResourceState state);
+		void FinishPendingTexture(TextureHandle handle);
+		void UpdateStreaming();
+		Uint32 GetDesiredMip(StreamingTexture const& streaming_texture) const;
+		Uint32 OnTextureDecoded(TextureHandle handle, Image const& img);
 	};
 	#define g_TextureManager TextureManager::Get()
 
@@ -2,12 +2,14 @@
 #include "ShaderStructs.h"
 #include "Components.h"
 #include "BlackboardData.h"
+#include "FFXVRSPass.h"
 #include "ShaderManager.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommon.h"
-#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Math/Packing.h"
+#include "Core/ConsoleManager.h"
 #include "Logging/Logger.h"
 #include "Editor/GUICommand.h"
 #include "entt/entity/registry.hpp"
@@ -16,7 +18,16 @@ using namespace DirectX;
 
 namespace adria
 {
-	
+	static TAutoConsoleVariable<Bool> CoarseCulling("r.TiledLighting.CoarseCulling", true, "Bin lights into 64x64 coarse tiles before the per-tile culling in the tiled deferred lighting pass");
+
+	struct TiledLightBounds
+	{
+		Vector4 screen_bounds;
+		Vector2 depth_bounds;
+		Uint32  valid;
+		Uint32  padding;
+	};
+
 	TiledDeferredLightingPass::TiledDeferredLightingPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h) : reg(reg), gfx(gfx), width(w), height(h),
 		add_textures_pass(gfx, width, height), copy_to_texture_pass(gfx, width, height)
 	{
@@ -27,6 +38,10 @@ namespace adria
 	{
 		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
 
+		Uint32 const light_count = (Uint32)reg.view<Light>().size();
+		Bool const coarse_culling = CoarseCulling.Get() && light_count > 0;
+		if (coarse_culling) AddCoarseCullingPasses(rendergraph, light_count);
+
 		struct TiledDeferredLightingPassData
 		{
 			RGTextureReadOnlyId  gbuffer_normal;
@@ -37,6 +52,9 @@ namespace adria
 			RGTextureReadOnlyId  ambient_occlusion;
 			RGTextureReadWriteId output;
 			RGTextureReadWriteId debug_output;
+			RGBufferReadOnlyId   coarse_tile_light_list;
+			RGBufferReadOnlyId   coarse_tile_light_count;
+			RGTextureReadOnlyId  vrs_tile_mask;
 		};
 
 		rendergraph.AddPass<TiledDeferredLightingPassData>("Tiled Deferred Lighting Pass",
@@ -61,8 +79,19 @@ namespace adria
 				if (builder.IsTextureDeclared(RG_NAME(AmbientOcclusion)))
 					data.ambient_occlusion = builder.ReadTexture(RG_NAME(AmbientOcclusion), ReadAccess_NonPixelShader);
 				else data.ambient_occlusion.Invalidate();
+				if (builder.IsTextureDeclared(RG_NAME(ReSTIR_GI_Irradiance))) std::ignore = builder.ReadTexture(RG_NAME(ReSTIR_GI_Irradiance), ReadAccess_NonPixelShader);
 
 				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+
+				if (builder.IsTextureDeclared(RG_NAME(VRSTileMask)))
+					data.vrs_tile_mask = builder.ReadTexture(RG_NAME(VRSTileMask), ReadAccess_NonPixelShader);
+				else data.vrs_tile_mask.Invalidate();
+
+				if (coarse_culling)
+				{
+					data.coarse_tile_light_list = builder.ReadBuffer(RG_NAME(CoarseTileLightList), ReadAccess_NonPixelShader);
+					data.coarse_tile_light_count = builder.ReadBuffer(RG_NAME(CoarseTileLightCount), ReadAccess_NonPixelShader);
+				}
 			},
 			[=](TiledDeferredLightingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
 			{
@@ -105,10 +134,48 @@ namespace adria
 				cmd_list->ClearUAV(tiled_target, gfx->GetDescriptorGPU(i + 5), context.GetReadWriteTexture(data.output), black);
 				cmd_list->ClearUAV(tiled_debug_target, gfx->GetDescriptorGPU(i + 6), context.GetReadWriteTexture(data.debug_output), black);
 
-				cmd_list->SetPipelineState(tiled_deferred_lighting_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
-				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+				if (coarse_culling)
+				{
+					GfxDescriptor coarse_src_handles[] = { context.GetReadOnlyBuffer(data.coarse_tile_light_list),
+														   context.GetReadOnlyBuffer(data.coarse_tile_light_count) };
+					GfxDescriptor coarse_dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(coarse_src_handles));
+					gfx->CopyDescriptors(coarse_dst_handle, coarse_src_handles);
+					Uint32 j = coarse_dst_handle.GetIndex();
+
+					struct TiledLightingCoarseConstants
+					{
+						Uint32 coarse_tile_light_list_idx;
+						Uint32 coarse_tile_light_count_idx;
+						Uint32 coarse_tile_count_x;
+						Uint32 coarse_tile_capacity;
+					} coarse_constants =
+					{
+						.coarse_tile_light_list_idx = j, .coarse_tile_light_count_idx = j + 1,
+						.coarse_tile_count_x = DivideAndRoundUp(width, COARSE_TILE_SIZE), .coarse_tile_capacity = light_count
+					};
+					cmd_list->SetRootCBV(2, coarse_constants);
+					tiled_deferred_lighting_psos->AddDefine("COARSE_CULLING", "1");
+				}
+				if (data.vrs_tile_mask.IsValid())
+				{
+					GfxDescriptor vrs_dst_handle = gfx->AllocateDescriptorsGPU();
+					gfx->CopyDescriptors(1, vrs_dst_handle, context.GetReadOnlyTexture(data.vrs_tile_mask));
+
+					struct SoftwareVRSConstants
+					{
+						Uint32 vrs_tile_mask_idx;
+						Uint32 vrs_tile_size;
+					} vrs_constants =
+					{
+						.vrs_tile_mask_idx = vrs_dst_handle.GetIndex(), .vrs_tile_size = FFXVRSPass::SOFTWARE_VRS_TILE_SIZE
+					};
+					cmd_list->SetRootCBV(3, vrs_constants);
+					tiled_deferred_lighting_psos->AddDefine("SOFTWARE_VRS", "1");
+				}
+				cmd_list->SetPipelineState(tiled_deferred_lighting_psos->Get());
+				cmd_list->Dispatch(DivideAndRoundUp(width, TILE_SIZE), DivideAndRoundUp(height, TILE_SIZE), 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 
 		if (visualize_tiled)
@@ -123,6 +190,7 @@ namespace adria
 			{
 				if (ImGui::TreeNodeEx("Tiled Deferred", ImGuiTreeNodeFlags_None))
 				{
+					ImGui::Checkbox("Coarse Culling", CoarseCulling.GetPtr());
 					ImGui::Checkbox("Visualize Tiles", &visualize_tiled);
 					if (visualize_tiled) ImGui::SliderInt("Visualize Scale", &visualize_max_lights, 1, 32);
 
@@ -137,7 +205,124 @@ namespace adria
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_TiledDeferredLighting;
-		tiled_deferred_lighting_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		tiled_deferred_lighting_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
+
+		compute_pso_desc.CS = CS_TiledLightBounds;
+		light_bounds_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_TiledCoarseCulling;
+		coarse_culling_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void TiledDeferredLightingPass::AddCoarseCullingPasses(RenderGraph& rendergraph, Uint32 light_count)
+	{
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+		OcclusionQueryBlackboardData const* occlusion_data = rendergraph.GetBlackboard().TryGet<OcclusionQueryBlackboardData>();
+		Uint32 const light_query_offset = occlusion_data ? occlusion_data->light_query_offset : 0;
+
+		struct TiledLightBoundsPassData
+		{
+			RGBufferReadWriteId light_bounds;
+			RGBufferReadOnlyId  light_visibility;
+		};
+		rendergraph.AddPass<TiledLightBoundsPassData>("Tiled Light Bounds Pass",
+			[=](TiledLightBoundsPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc light_bounds_desc{};
+				light_bounds_desc.resource_usage = GfxResourceUsage::Default;
+				light_bounds_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				light_bounds_desc.stride = sizeof(TiledLightBounds);
+				light_bounds_desc.size = light_count * sizeof(TiledLightBounds);
+				builder.DeclareBuffer(RG_NAME(TiledLightBounds), light_bounds_desc);
+				data.light_bounds = builder.WriteBuffer(RG_NAME(TiledLightBounds));
+				if (occlusion_data) data.light_visibility = builder.ReadBuffer(RG_NAME(OcclusionQueryResults), ReadAccess_NonPixelShader);
+				else data.light_visibility.Invalidate();
+			},
+			[=](TiledLightBoundsPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(2);
+				gfx->CopyDescriptors(1, dst_handle, context.GetReadWriteBuffer(data.light_bounds));
+				if (data.light_visibility.IsValid()) gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(dst_handle.GetIndex() + 1), context.GetReadOnlyBuffer(data.light_visibility));
+
+				//occluded lights get invalid bounds and are never binned
+				struct TiledLightBoundsConstants
+				{
+					Uint32 light_bounds_idx;
+					Uint32 light_count;
+					Int32  light_visibility_idx;
+					Uint32 light_query_offset;
+				} constants =
+				{
+					.light_bounds_idx = dst_handle.GetIndex(), .light_count = light_count,
+					.light_visibility_idx = data.light_visibility.IsValid() ? Int32(dst_handle.GetIndex() + 1) : -1, .light_query_offset = light_query_offset
+				};
+
+				cmd_list->SetPipelineState(light_bounds_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(light_count, 64u), 1, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+
+		struct TiledCoarseCullingPassData
+		{
+			RGTextureReadOnlyId depth;
+			RGBufferReadOnlyId  light_bounds;
+			RGBufferReadWriteId coarse_tile_light_list;
+			RGBufferReadWriteId coarse_tile_light_count;
+		};
+		Uint32 const coarse_tile_count_x = DivideAndRoundUp(width, COARSE_TILE_SIZE);
+		Uint32 const coarse_tile_count_y = DivideAndRoundUp(height, COARSE_TILE_SIZE);
+		rendergraph.AddPass<TiledCoarseCullingPassData>("Tiled Coarse Culling Pass",
+			[=](TiledCoarseCullingPassData& data, RenderGraphBuilder& builder)
+			{
+				RGBufferDesc coarse_tile_desc{};
+				coarse_tile_desc.resource_usage = GfxResourceUsage::Default;
+				coarse_tile_desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+				coarse_tile_desc.stride = sizeof(Uint32);
+				coarse_tile_desc.size = coarse_tile_count_x * coarse_tile_count_y * light_count * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(CoarseTileLightList), coarse_tile_desc);
+
+				coarse_tile_desc.size = coarse_tile_count_x * coarse_tile_count_y * sizeof(Uint32);
+				builder.DeclareBuffer(RG_NAME(CoarseTileLightCount), coarse_tile_desc);
+
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.light_bounds = builder.ReadBuffer(RG_NAME(TiledLightBounds), ReadAccess_NonPixelShader);
+				data.coarse_tile_light_list = builder.WriteBuffer(RG_NAME(CoarseTileLightList));
+				data.coarse_tile_light_count = builder.WriteBuffer(RG_NAME(CoarseTileLightCount));
+			},
+			[=](TiledCoarseCullingPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.depth),
+												context.GetReadOnlyBuffer(data.light_bounds),
+												context.GetReadWriteBuffer(data.coarse_tile_light_list),
+												context.GetReadWriteBuffer(data.coarse_tile_light_count) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct TiledCoarseCullingConstants
+				{
+					Uint32 depth_idx;
+					Uint32 light_bounds_idx;
+					Uint32 coarse_tile_light_list_idx;
+					Uint32 coarse_tile_light_count_idx;
+					Uint32 light_count;
+					Uint32 coarse_tile_count_x;
+				} constants =
+				{
+					.depth_idx = i, .light_bounds_idx = i + 1,
+					.coarse_tile_light_list_idx = i + 2, .coarse_tile_light_count_idx = i + 3,
+					.light_count = light_count, .coarse_tile_count_x = coarse_tile_count_x
+				};
+
+				cmd_list->SetPipelineState(coarse_culling_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(coarse_tile_count_x, coarse_tile_count_y, 1);
+			}, RGPassType::Compute, RGPassFlags::None);
 	}
 
 }
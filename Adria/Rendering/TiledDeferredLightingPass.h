@@ -1,6 +1,7 @@
 #pragma once
 #include "HelperPasses.h"
 #include "RenderGraph/RenderGraphResourceId.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 #include "entt/entity/fwd.hpp"
 
 namespace adria
@@ -11,6 +12,9 @@ namespace adria
 
 	class TiledDeferredLightingPass
 	{
+		static constexpr Uint32 TILE_SIZE = 16;
+		static constexpr Uint32 COARSE_TILE_SIZE = 64;
+
 	public:
 		TiledDeferredLightingPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
 
@@ -26,7 +30,9 @@ namespace adria
 		entt::registry& reg;
 		GfxDevice* gfx;
 		Uint32 width, height;
-		std::unique_ptr<GfxComputePipelineState> tiled_deferred_lighting_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> tiled_deferred_lighting_psos;
+		std::unique_ptr<GfxComputePipelineState> light_bounds_pso;
+		std::unique_ptr<GfxComputePipelineState> coarse_culling_pso;
 		CopyToTexturePass copy_to_texture_pass;
 		AddTexturesPass add_textures_pass;
 		Bool visualize_tiled = false;
@@ -34,6 +40,7 @@ namespace adria
 
 	private:
 		void CreatePSOs();
+		void AddCoarseCullingPasses(RenderGraph& rendergraph, Uint32 light_count);
 	};
 
 }
\ No newline at end of file
@@ -3,10 +3,11 @@
 #include "ShaderManager.h" 
 #include "TextureManager.h"
 #include "PostProcessor.h"
+#include "FilmEffectsPass.h"
 #include "Core/Paths.h"
 #include "Core/ConsoleManager.h"
 #include "Graphics/GfxDevice.h"
-#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxPipelineStatePermutations.h"
 #include "Graphics/GfxCommon.h"
 #include "Math/Packing.h"
 #include "Editor/GUICommand.h"
@@ -33,6 +34,8 @@ namespace adria
 		CreatePSO();
 	}
 
+	ToneMapPass::~ToneMapPass() = default;
+
 	void ToneMapPass::AddPass(RenderGraph& rg, PostProcessor* postprocessor)
 	{
 		RGResourceName source = postprocessor->GetFinalResource();
@@ -40,6 +43,32 @@ namespace adria
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 		BloomBlackboardData const* bloom_data = rg.GetBlackboard().TryGet<BloomBlackboardData>();
 
+		//film effects are per-pixel (distortion and aberration only offset the input fetch), so they can run in the tonemap dispatch
+		FilmEffectsPass* film_effects = postprocessor->GetFusedFilmEffects();
+		Bool const fuse_film_effects = film_effects != nullptr;
+		FilmEffectsConstants film_effects_constants{};
+		if (fuse_film_effects) film_effects_constants = film_effects->GetConstants(frame_data.delta_time);
+
+		//on HDR outputs the curve maps to the display's luminance range and the shader applies the swapchain encoding
+		GfxColorSpace const output_color_space = postprocessor->GetOutputColorSpace();
+		Bool const hdr_output = output_color_space != GfxColorSpace::SDR;
+		GfxDisplayInfo const& display_info = gfx->GetDisplayInfo();
+		struct TonemapCBuffer
+		{
+			FilmEffectsConstants film_effects;
+			Float paper_white_nits;
+			Float display_min_luminance;
+			Float display_max_luminance;
+			Float display_max_full_frame_luminance;
+		} tonemap_cbuffer =
+		{
+			.film_effects = film_effects_constants,
+			.paper_white_nits = gfx->GetHDRPaperWhite(),
+			.display_min_luminance = display_info.min_luminance,
+			.display_max_luminance = display_info.max_luminance,
+			.display_max_full_frame_luminance = display_info.max_full_frame_luminance
+		};
+
 		struct ToneMapPassData
 		{
 			RGTextureReadOnlyId  hdr_input;
@@ -56,7 +85,7 @@ namespace adria
 					RGTextureDesc destination_desc{};
 					destination_desc.width = width;
 					destination_desc.height = height;
-					destination_desc.format = GfxFormat::R8G8B8A8_UNORM;
+					destination_desc.format = hdr_output ? gfx->GetBackbufferFormat() : GfxFormat::R8G8B8A8_UNORM;
 					builder.DeclareTexture(destination, destination_desc);
 				}
 				data.hdr_input = builder.ReadTexture(source, ReadAccess_NonPixelShader);
@@ -106,13 +135,23 @@ namespace adria
 				{
 					ADRIA_ASSERT(bloom_data != nullptr);
 					constants.bloom_idx = i + ARRAYSIZE(src_descriptors);
-					constants.lens_dirt_idx = (Uint32)lens_dirt_handle;
+					constants.lens_dirt_idx = GetTextureIndex(lens_dirt_handle);
 					constants.bloom_params_packed = PackTwoFloatsToUint32(bloom_data->bloom_intensity, bloom_data->bloom_blend_factor);
 				}
 
-				cmd_list->SetPipelineState(tonemap_pso.get());
+				if (fuse_film_effects)
+				{
+					if (film_effects_constants.lens_distortion_enabled) tonemap_psos->AddDefine("LENS_DISTORTION", "1");
+					if (film_effects_constants.chromatic_aberration_enabled) tonemap_psos->AddDefine("CHROMATIC_ABERRATION", "1");
+					if (film_effects_constants.vignette_enabled) tonemap_psos->AddDefine("VIGNETTE", "1");
+					if (film_effects_constants.film_grain_enabled) tonemap_psos->AddDefine("FILM_GRAIN", "1");
+				}
+				if (output_color_space == GfxColorSpace::HDR10) tonemap_psos->AddDefine("HDR10_OUTPUT", "1");
+				else if (output_color_space == GfxColorSpace::scRGB) tonemap_psos->AddDefine("SCRGB_OUTPUT", "1");
+				cmd_list->SetPipelineState(tonemap_psos->Get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootConstants(1, constants);
+				if (fuse_film_effects || hdr_output) cmd_list->SetRootCBV(2, tonemap_cbuffer);
 				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
 			}, RGPassType::Compute, RGPassFlags::None);
 
@@ -135,7 +174,7 @@ namespace adria
 	{
 		GfxComputePipelineStateDesc compute_pso_desc{};
 		compute_pso_desc.CS = CS_Tonemap;
-		tonemap_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+		tonemap_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, compute_pso_desc);
 	}
 
 	void ToneMapPass::GUI()
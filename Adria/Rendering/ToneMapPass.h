@@ -1,17 +1,18 @@
 #pragma once
 #include "TextureHandle.h"
 #include "PostEffect.h"
+#include "Graphics/GfxPipelineStatePermutationsFwd.h"
 
 namespace adria
 {
 	class GfxDevice;
-	class GfxComputePipelineState;
 	class RenderGraph;
 
 	class ToneMapPass : public PostEffect
 	{
 	public:
 		ToneMapPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~ToneMapPass();
 
 		virtual void AddPass(RenderGraph&, PostProcessor*) override;
 		virtual void OnResize(Uint32, Uint32) override;
@@ -26,7 +27,7 @@ namespace adria
 		Uint32 width, height;
 		TextureHandle lens_dirt_handle = INVALID_TEXTURE_HANDLE;
 		TextureHandle tony_mc_mapface_lut_handle = INVALID_TEXTURE_HANDLE;
-		std::unique_ptr<GfxComputePipelineState> tonemap_pso;
+		std::unique_ptr<GfxComputePipelineStatePermutations> tonemap_psos;
 		RGResourceName input;
 
 	private:
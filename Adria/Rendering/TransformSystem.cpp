@@ -0,0 +1,163 @@
+#include "TransformSystem.h"
+#include "Components.h"
+#include "Utilities/JobSystem.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	TransformSystem::TransformSystem(entt::registry& reg) : reg(reg)
+	{
+		reg.on_construct<LocalTransform>().connect<&TransformSystem::OnHierarchyChanged>(this);
+		reg.on_destroy<LocalTransform>().connect<&TransformSystem::OnHierarchyChanged>(this);
+		reg.on_update<LocalTransform>().connect<&TransformSystem::OnLocalTransformChanged>(this);
+		reg.on_construct<Relationship>().connect<&TransformSystem::OnHierarchyChanged>(this);
+		reg.on_update<Relationship>().connect<&TransformSystem::OnHierarchyChanged>(this);
+		reg.on_destroy<Relationship>().connect<&TransformSystem::OnHierarchyChanged>(this);
+	}
+
+	TransformSystem::~TransformSystem()
+	{
+		reg.on_construct<LocalTransform>().disconnect(this);
+		reg.on_destroy<LocalTransform>().disconnect(this);
+		reg.on_update<LocalTransform>().disconnect(this);
+		reg.on_construct<Relationship>().disconnect(this);
+		reg.on_update<Relationship>().disconnect(this);
+		reg.on_destroy<Relationship>().disconnect(this);
+	}
+
+	void TransformSystem::SetParent(entt::entity child, entt::entity parent)
+	{
+		ADRIA_ASSERT(child != parent);
+		reg.emplace_or_replace<Relationship>(child, parent);
+	}
+
+	void TransformSystem::Update()
+	{
+		changed_entities.clear();
+		if (hierarchy_dirty)
+		{
+			RebuildHierarchy();
+		}
+		else
+		{
+			for (entt::entity entity : pending_entities)
+			{
+				auto it = entity_indices.find(entity);
+				if (it == entity_indices.end()) continue;
+				local_transforms[it->second] = reg.get<LocalTransform>(entity).transform;
+				dirty[it->second] = 1;
+			}
+		}
+		pending_entities.clear();
+
+		for (Uint64 level = 0; level + 1 < level_offsets.size(); ++level)
+		{
+			Uint32 const level_begin = level_offsets[level];
+			Uint32 const level_end = level_offsets[level + 1];
+			if (level_end - level_begin <= UPDATE_CHUNK_SIZE)
+			{
+				UpdateRange(level_begin, level_end);
+				continue;
+			}
+			g_JobSystem.ParallelFor(DivideAndRoundUp(level_end - level_begin, UPDATE_CHUNK_SIZE), 1, [&](Uint32 chunk)
+				{
+					Uint32 const chunk_begin = level_begin + chunk * UPDATE_CHUNK_SIZE;
+					UpdateRange(chunk_begin, std::min(chunk_begin + UPDATE_CHUNK_SIZE, level_end));
+				});
+		}
+
+		for (Uint32 i = 0; i < entities.size(); ++i)
+		{
+			if (!dirty[i]) continue;
+			reg.emplace_or_replace<WorldTransform>(entities[i], world_transforms[i]);
+			changed_entities.push_back(entities[i]);
+			dirty[i] = 0;
+		}
+	}
+
+	void TransformSystem::RebuildHierarchy()
+	{
+		auto transform_view = reg.view<LocalTransform>();
+
+		std::unordered_map<entt::entity, Uint32> depths;
+		depths.reserve(transform_view.size());
+		std::vector<entt::entity> chain;
+		Uint32 max_depth = 0;
+		for (entt::entity entity : transform_view)
+		{
+			//walk up until an ancestor with a known depth or the root, then assign depths on the way back down
+			chain.clear();
+			Uint32 depth = 0;
+			for (entt::entity current = entity; current != entt::null && chain.size() <= transform_view.size(); current = GetParent(current))
+			{
+				if (auto it = depths.find(current); it != depths.end())
+				{
+					depth = it->second + 1;
+					break;
+				}
+				chain.push_back(current);
+			}
+			for (auto it = chain.rbegin(); it != chain.rend(); ++it, ++depth)
+			{
+				depths[*it] = depth;
+				max_depth = std::max(max_depth, depth);
+			}
+		}
+
+		Uint32 const count = (Uint32)depths.size();
+		level_offsets.assign(count > 0 ? max_depth + 2 : 0, 0);
+		for (auto const& [entity, depth] : depths) ++level_offsets[depth + 1];
+		for (Uint64 i = 1; i < level_offsets.size(); ++i) level_offsets[i] += level_offsets[i - 1];
+
+		entities.resize(count);
+		parents.resize(count);
+		local_transforms.resize(count);
+		world_transforms.resize(count);
+		dirty.assign(count, 1);
+		entity_indices.clear();
+		entity_indices.reserve(count);
+
+		std::vector<Uint32> level_cursors(level_offsets.begin(), level_offsets.empty() ? level_offsets.end() : level_offsets.end() - 1);
+		for (entt::entity entity : transform_view)
+		{
+			Uint32 const index = level_cursors[depths[entity]]++;
+			entities[index] = entity;
+			entity_indices[entity] = index;
+		}
+		for (Uint32 i = 0; i < count; ++i)
+		{
+			entt::entity const parent = GetParent(entities[i]);
+			parents[i] = parent != entt::null ? entity_indices[parent] : INVALID_INDEX;
+			local_transforms[i] = transform_view.get<LocalTransform>(entities[i]).transform;
+		}
+		hierarchy_dirty = false;
+	}
+
+	void TransformSystem::UpdateRange(Uint32 begin, Uint32 end)
+	{
+		for (Uint32 i = begin; i < end; ++i)
+		{
+			Uint32 const parent = parents[i];
+			if (parent != INVALID_INDEX && dirty[parent]) dirty[i] = 1;
+			if (!dirty[i]) continue;
+			world_transforms[i] = parent != INVALID_INDEX ? local_transforms[i] * world_transforms[parent] : local_transforms[i];
+		}
+	}
+
+	entt::entity TransformSystem::GetParent(entt::entity entity) const
+	{
+		Relationship const* relationship = reg.try_get<Relationship>(entity);
+		if (!relationship || !reg.valid(relationship->parent) || !reg.all_of<LocalTransform>(relationship->parent)) return entt::null;
+		return relationship->parent;
+	}
+
+	void TransformSystem::OnHierarchyChanged(entt::registry&, entt::entity)
+	{
+		hierarchy_dirty = true;
+	}
+
+	void TransformSystem::OnLocalTransformChanged(entt::registry&, entt::entity entity)
+	{
+		pending_entities.push_back(entity);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	//LocalTransform is relative to the Relationship parent, WorldTransform is derived from it.
+	//the hierarchy is flattened into arrays ordered by depth so every level is updated in parallel chunks after its parents
+	class TransformSystem
+	{
+		static constexpr Uint32 INVALID_INDEX = UINT32_MAX;
+		static constexpr Uint32 UPDATE_CHUNK_SIZE = 256;
+
+	public:
+		explicit TransformSystem(entt::registry& reg);
+		~TransformSystem();
+
+		void SetParent(entt::entity child, entt::entity parent);
+		void Update();
+
+		std::span<entt::entity const> GetChangedEntities() const { return changed_entities; }
+
+	private:
+		entt::registry& reg;
+
+		std::vector<entt::entity> entities;
+		std::vector<Uint32> parents;
+		std::vector<Matrix> local_transforms;
+		std::vector<Matrix> world_transforms;
+		std::vector<Uint8> dirty;
+		std::vector<Uint32> level_offsets;
+		std::unordered_map<entt::entity, Uint32> entity_indices;
+
+		std::vector<entt::entity> pending_entities;
+		std::vector<entt::entity> changed_entities;
+		Bool hierarchy_dirty = true;
+
+	private:
+		void RebuildHierarchy();
+		void UpdateRange(Uint32 begin, Uint32 end);
+		entt::entity GetParent(entt::entity entity) const;
+
+		void OnHierarchyChanged(entt::registry&, entt::entity);
+		void OnLocalTransformChanged(entt::registry&, entt::entity);
+	};
+}
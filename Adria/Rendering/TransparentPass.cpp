@@ -0,0 +1,270 @@
+#include "TransparentPass.h"
+#include "Components.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxReflection.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> OIT("r.OIT", true, "Draw alpha blended batches unsorted with weighted blended order independent transparency instead of the GBuffer");
+
+	using TransparentIndirectArguments = DrawIndexedRootConstantIndirectSignature::Arguments;
+
+	TransparentPass::TransparentPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h)
+		: reg(reg), gfx(gfx), width(w), height(h)
+	{
+		CreatePSOs();
+	}
+
+	TransparentPass::~TransparentPass() = default;
+
+	Bool TransparentPass::IsEnabled() const
+	{
+		return OIT.Get();
+	}
+
+	void TransparentPass::AddPass(RenderGraph& rg)
+	{
+		if (!IsEnabled()) return;
+		AddAccumulatePass(rg);
+		AddCompositePass(rg);
+	}
+
+	void TransparentPass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("Transparency", 0))
+				{
+					ImGui::Checkbox("Order Independent Transparency", OIT.GetPtr());
+					if (ImGui::IsItemHovered()) ImGui::SetTooltip("Blend batches are drawn in any order into accumulation and revealage targets, otherwise they go through the GBuffer");
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void TransparentPass::CreatePSOs()
+	{
+		GfxGraphicsPipelineStateDesc accumulate_pso_desc{};
+		GfxReflection::FillInputLayoutDesc(GetGfxShader(VS_GBuffer), accumulate_pso_desc.input_layout);
+		accumulate_pso_desc.root_signature = GfxRootSignatureID::Common;
+		accumulate_pso_desc.VS = VS_GBuffer;
+		accumulate_pso_desc.PS = PS_TransparentOIT;
+		accumulate_pso_desc.rasterizer_state.cull_mode = GfxCullMode::None;
+		accumulate_pso_desc.depth_state.depth_enable = true;
+		accumulate_pso_desc.depth_state.depth_write_mask = GfxDepthWriteMask::Zero;
+		accumulate_pso_desc.depth_state.depth_func = GfxComparisonFunc::GreaterEqual;
+		accumulate_pso_desc.num_render_targets = 2;
+		accumulate_pso_desc.rtv_formats[0] = GfxFormat::R16G16B16A16_FLOAT;
+		accumulate_pso_desc.rtv_formats[1] = GfxFormat::R8_UNORM;
+		accumulate_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
+		accumulate_pso_desc.blend_state.independent_blend_enable = true;
+		//accumulation sums weighted premultiplied color and alpha, revealage is the product of (1 - alpha)
+		accumulate_pso_desc.blend_state.render_target[0].blend_enable = true;
+		accumulate_pso_desc.blend_state.render_target[0].src_blend = GfxBlend::One;
+		accumulate_pso_desc.blend_state.render_target[0].dest_blend = GfxBlend::One;
+		accumulate_pso_desc.blend_state.render_target[0].blend_op = GfxBlendOp::Add;
+		accumulate_pso_desc.blend_state.render_target[0].src_blend_alpha = GfxBlend::One;
+		accumulate_pso_desc.blend_state.render_target[0].dest_blend_alpha = GfxBlend::One;
+		accumulate_pso_desc.blend_state.render_target[0].blend_op_alpha = GfxBlendOp::Add;
+		accumulate_pso_desc.blend_state.render_target[1].blend_enable = true;
+		accumulate_pso_desc.blend_state.render_target[1].src_blend = GfxBlend::Zero;
+		accumulate_pso_desc.blend_state.render_target[1].dest_blend = GfxBlend::InvSrcColor;
+		accumulate_pso_desc.blend_state.render_target[1].blend_op = GfxBlendOp::Add;
+		accumulate_pso_desc.blend_state.render_target[1].src_blend_alpha = GfxBlend::Zero;
+		accumulate_pso_desc.blend_state.render_target[1].dest_blend_alpha = GfxBlend::InvSrcAlpha;
+		accumulate_pso_desc.blend_state.render_target[1].blend_op_alpha = GfxBlendOp::Add;
+		accumulate_pso = gfx->CreateGraphicsPipelineState(accumulate_pso_desc);
+
+		GfxGraphicsPipelineStateDesc composite_pso_desc{};
+		composite_pso_desc.root_signature = GfxRootSignatureID::Common;
+		composite_pso_desc.VS = VS_FullscreenTriangle;
+		composite_pso_desc.PS = PS_OITComposite;
+		composite_pso_desc.depth_state.depth_enable = false;
+		composite_pso_desc.num_render_targets = 1;
+		composite_pso_desc.rtv_formats[0] = GfxFormat::R16G16B16A16_FLOAT;
+		composite_pso_desc.blend_state.render_target[0].blend_enable = true;
+		composite_pso_desc.blend_state.render_target[0].src_blend = GfxBlend::SrcAlpha;
+		composite_pso_desc.blend_state.render_target[0].dest_blend = GfxBlend::InvSrcAlpha;
+		composite_pso_desc.blend_state.render_target[0].blend_op = GfxBlendOp::Add;
+		composite_pso = gfx->CreateGraphicsPipelineState(composite_pso_desc);
+	}
+
+	void TransparentPass::AddAccumulatePass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Bool const light_clusters = rg.GetBlackboard().TryGet<LightClusterBlackboardData>() != nullptr;
+
+		struct TransparentDraw
+		{
+			SubMeshGPU const* submesh;
+			Uint32 indirect_offset;
+			Uint32 indirect_count;
+		};
+		struct OITAccumulatePassData
+		{
+			RGBufferReadOnlyId light_grid;
+			RGBufferReadOnlyId light_list;
+			std::vector<TransparentDraw> draws;
+			GfxBuffer* indirect_buffer = nullptr;
+		};
+
+		rg.AddPass<OITAccumulatePassData>("OIT Accumulation Pass",
+			[=](OITAccumulatePassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc accumulation_desc{};
+				accumulation_desc.width = width;
+				accumulation_desc.height = height;
+				accumulation_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+				accumulation_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+				builder.DeclareTexture(RG_NAME(OIT_Accumulation), accumulation_desc);
+
+				RGTextureDesc revealage_desc{};
+				revealage_desc.width = width;
+				revealage_desc.height = height;
+				revealage_desc.format = GfxFormat::R8_UNORM;
+				revealage_desc.clear_value = GfxClearValue(1.0f, 1.0f, 1.0f, 1.0f);
+				builder.DeclareTexture(RG_NAME(OIT_Revealage), revealage_desc);
+
+				builder.WriteRenderTarget(RG_NAME(OIT_Accumulation), RGLoadStoreAccessOp::Clear_Preserve);
+				builder.WriteRenderTarget(RG_NAME(OIT_Revealage), RGLoadStoreAccessOp::Clear_Preserve);
+				builder.ReadDepthStencil(RG_NAME(DepthStencil), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+				//with the clustered light lists built transparents are shaded forward plus, otherwise with every light
+				if (light_clusters)
+				{
+					data.light_grid = builder.ReadBuffer(RG_NAME(LightGrid), ReadAccess_PixelShader);
+					data.light_list = builder.ReadBuffer(RG_NAME(LightList), ReadAccess_PixelShader);
+				}
+				else
+				{
+					data.light_grid.Invalidate();
+					data.light_list.Invalidate();
+				}
+
+				//blending is commutative so batches are submitted in storage order, draws sharing a geometry buffer collapse into one ExecuteIndirect
+				auto batch_view = reg.view<Batch>();
+				if (batch_view.empty()) return;
+				GfxDynamicAllocation indirect_allocation = gfx->GetDynamicAllocator()->Allocate(batch_view.size() * sizeof(TransparentIndirectArguments), sizeof(TransparentIndirectArguments));
+				data.indirect_buffer = indirect_allocation.buffer;
+
+				Uint32 indirect_count = 0;
+				for (auto batch_entity : batch_view)
+				{
+					Batch const& batch = batch_view.get<Batch>(batch_entity);
+					if (batch.alpha_mode != MaterialAlphaMode::Blend || !batch.camera_visibility) continue;
+
+					SubMeshGPU const& submesh = *batch.submesh;
+					SubMeshLOD const& lod = submesh.lods[batch.lod];
+					TransparentIndirectArguments arguments{};
+					arguments.root_constant = batch.instance_id;
+					arguments.draw.IndexCountPerInstance = lod.index_count;
+					arguments.draw.InstanceCount = 1;
+					arguments.draw.StartIndexLocation = (Uint32)(submesh.indices_offset / sizeof(Uint32)) + lod.first_index;
+					arguments.draw.BaseVertexLocation = 0;
+					arguments.draw.StartInstanceLocation = 0;
+					indirect_allocation.Update(&arguments, sizeof(arguments), indirect_count * sizeof(TransparentIndirectArguments));
+
+					TransparentDraw* bucket = data.draws.empty() ? nullptr : &data.draws.back();
+					if (bucket && bucket->submesh->buffer_address == submesh.buffer_address && bucket->submesh->topology == submesh.topology)
+					{
+						++bucket->indirect_count;
+					}
+					else
+					{
+						data.draws.push_back(TransparentDraw{ &submesh, (Uint32)(indirect_allocation.offset + indirect_count * sizeof(TransparentIndirectArguments)), 1 });
+					}
+					++indirect_count;
+				}
+			},
+			[=](OITAccumulatePassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				if (data.draws.empty()) return;
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				struct OITLightConstants
+				{
+					Int32 light_grid_idx;
+					Int32 light_list_idx;
+				} light_constants = { .light_grid_idx = -1, .light_list_idx = -1 };
+				if (data.light_grid.IsValid())
+				{
+					GfxDescriptor src_descriptors[] =
+					{
+						context.GetReadOnlyBuffer(data.light_grid),
+						context.GetReadOnlyBuffer(data.light_list)
+					};
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+					light_constants.light_grid_idx = (Int32)dst_descriptor.GetIndex();
+					light_constants.light_list_idx = (Int32)dst_descriptor.GetIndex() + 1;
+				}
+
+				cmd_list->SetPipelineState(accumulate_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				//the instance id is the first root constant, written by each indirect draw
+				cmd_list->SetRootConstants(1, &light_constants, sizeof(light_constants), 1);
+				for (TransparentDraw const& draw : data.draws)
+				{
+					GfxIndexBufferView ibv(draw.submesh->buffer_address, (Uint32)(draw.submesh->buffer_size / sizeof(Uint32)));
+					cmd_list->SetTopology(draw.submesh->topology);
+					cmd_list->SetIndexBuffer(&ibv);
+					cmd_list->MultiDrawIndexedIndirect(*data.indirect_buffer, draw.indirect_offset, draw.indirect_count);
+				}
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+
+	void TransparentPass::AddCompositePass(RenderGraph& rg)
+	{
+		struct OITCompositePassData
+		{
+			RGTextureReadOnlyId accumulation;
+			RGTextureReadOnlyId revealage;
+		};
+
+		rg.AddPass<OITCompositePassData>("OIT Composite Pass",
+			[=](OITCompositePassData& data, RenderGraphBuilder& builder)
+			{
+				data.accumulation = builder.ReadTexture(RG_NAME(OIT_Accumulation), ReadAccess_PixelShader);
+				data.revealage = builder.ReadTexture(RG_NAME(OIT_Revealage), ReadAccess_PixelShader);
+				builder.WriteRenderTarget(RG_NAME(HDR_RenderTarget), RGLoadStoreAccessOp::Preserve_Preserve);
+				builder.SetViewport(width, height);
+			},
+			[=](OITCompositePassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					context.GetReadOnlyTexture(data.accumulation),
+					context.GetReadOnlyTexture(data.revealage)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct OITCompositeConstants
+				{
+					Uint32 accumulation_idx;
+					Uint32 revealage_idx;
+				} constants =
+				{
+					.accumulation_idx = i,
+					.revealage_idx = i + 1
+				};
+
+				cmd_list->SetPipelineState(composite_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetTopology(GfxPrimitiveTopology::TriangleList);
+				cmd_list->Draw(3);
+			}, RGPassType::Graphics, RGPassFlags::None);
+	}
+}
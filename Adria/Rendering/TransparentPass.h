@@ -0,0 +1,39 @@
+#pragma once
+#include <memory>
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxGraphicsPipelineState;
+	class RenderGraph;
+
+	//weighted blended order independent transparency: blend batches accumulate weighted premultiplied color and revealage in any order,
+	//a fullscreen pass then resolves them over the lit scene
+	class TransparentPass
+	{
+	public:
+		TransparentPass(entt::registry& reg, GfxDevice* gfx, Uint32 w, Uint32 h);
+		~TransparentPass();
+
+		void AddPass(RenderGraph& rg);
+		void GUI();
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+		}
+		Bool IsEnabled() const;
+
+	private:
+		entt::registry& reg;
+		GfxDevice* gfx;
+		Uint32 width, height;
+		std::unique_ptr<GfxGraphicsPipelineState> accumulate_pso;
+		std::unique_ptr<GfxGraphicsPipelineState> composite_pso;
+
+	private:
+		void CreatePSOs();
+		void AddAccumulatePass(RenderGraph& rg);
+		void AddCompositePass(RenderGraph& rg);
+	};
+}
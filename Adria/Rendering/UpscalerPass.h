@@ -10,14 +10,28 @@ namespace adria
 	public:
 		RenderResolutionChanged& GetRenderResolutionChangedEvent() { return render_resolution_changed_event; }
 
+		void SetDynamicResolutionScale(Float scale)
+		{
+			if (scale == dynamic_resolution_scale) return;
+			dynamic_resolution_scale = scale;
+			if (max_render_width != 0) render_resolution_changed_event.Broadcast(GetDynamicRenderWidth(), GetDynamicRenderHeight());
+		}
+
 	private:
 		RenderResolutionChanged render_resolution_changed_event;
+		Uint32 max_render_width = 0;
+		Uint32 max_render_height = 0;
+		Float dynamic_resolution_scale = 1.0f;
 
 	protected:
+		//upscaler contexts are created for the full render resolution, dynamic resolution only shrinks the input below it
 		void BroadcastRenderResolutionChanged(Uint32 w, Uint32 h)
 		{
-			render_resolution_changed_event.Broadcast(w, h);
+			max_render_width = w, max_render_height = h;
+			render_resolution_changed_event.Broadcast(GetDynamicRenderWidth(), GetDynamicRenderHeight());
 		}
+		Uint32 GetDynamicRenderWidth() const { return std::max((Uint32)(max_render_width * dynamic_resolution_scale), 1u); }
+		Uint32 GetDynamicRenderHeight() const { return std::max((Uint32)(max_render_height * dynamic_resolution_scale), 1u); }
 	};
 
 	class EmptyUpscalerPass : public UpscalerPass
@@ -4,12 +4,22 @@
 #include "XeSSPass.h"
 #include "DLSS3Pass.h"
 #include "Core/ConsoleManager.h"
+#include "Graphics/GfxProfiler.h"
 #include "Editor/GUICommand.h"
 #include "Logging/Logger.h"
 
 namespace adria
 {
 	static TAutoConsoleVariable<int>  Upscaler("r.Upscaler", 0, "0 - No Upscaler, 1 - FSR2, 2 - FSR3, 3 - XeSS, 4 - DLSS3");
+	static TAutoConsoleVariable<Bool>  DynamicResolution("r.DynamicResolution", false, "Scale the upscaler render resolution to hit the target GPU frame time");
+	static TAutoConsoleVariable<Float> DynamicResolutionTargetFrameTime("r.DynamicResolution.TargetFrameTime", 16.6f, "Target GPU frame time in milliseconds");
+	static TAutoConsoleVariable<Float> DynamicResolutionMinScale("r.DynamicResolution.MinScale", 0.5f, "Minimum render resolution scale");
+	static TAutoConsoleVariable<Float> DynamicResolutionMaxScale("r.DynamicResolution.MaxScale", 1.0f, "Maximum render resolution scale");
+
+	static constexpr Float DYNAMIC_RESOLUTION_STEP = 0.05f;
+	static constexpr Float DYNAMIC_RESOLUTION_SMOOTHING = 0.1f;
+	static constexpr Float DYNAMIC_RESOLUTION_HYSTERESIS = 0.05f;
+	static constexpr Uint32 DYNAMIC_RESOLUTION_COOLDOWN_FRAMES = 30;
 	
 	enum class UpscalerType : Uint8
 	{
@@ -52,6 +62,41 @@ namespace adria
 		}
 	}
 
+	void UpscalerPassGroup::UpdateDynamicResolution()
+	{
+		if (upscaler_type == UpscalerType::None) return;
+
+		UpscalerPass* upscaler = post_effects[(Uint32)upscaler_type].get();
+		Float const frame_gpu_time = g_GfxProfiler.GetFrameGPUTime();
+		if (!DynamicResolution.Get() || frame_gpu_time <= 0.0f)
+		{
+			dynamic_resolution_scale = 1.0f;
+			smoothed_gpu_time = 0.0f;
+			upscaler->SetDynamicResolutionScale(dynamic_resolution_scale);
+			return;
+		}
+		upscaler->SetDynamicResolutionScale(dynamic_resolution_scale);
+
+		smoothed_gpu_time = smoothed_gpu_time > 0.0f ? std::lerp(smoothed_gpu_time, frame_gpu_time, DYNAMIC_RESOLUTION_SMOOTHING) : frame_gpu_time;
+		if (++frames_since_scale_change < DYNAMIC_RESOLUTION_COOLDOWN_FRAMES) return;
+
+		//gpu cost is roughly proportional to pixel count, so the axis scale follows the square root of the time ratio
+		Float const target_frame_time = DynamicResolutionTargetFrameTime.Get();
+		Float const frame_time_ratio = target_frame_time / smoothed_gpu_time;
+		if (std::abs(1.0f - frame_time_ratio) < DYNAMIC_RESOLUTION_HYSTERESIS) return;
+
+		Float const min_scale = std::clamp(DynamicResolutionMinScale.Get(), 0.1f, 1.0f);
+		Float const max_scale = std::clamp(DynamicResolutionMaxScale.Get(), min_scale, 1.0f);
+		Float desired_scale = dynamic_resolution_scale * std::sqrt(frame_time_ratio);
+		desired_scale = std::round(desired_scale / DYNAMIC_RESOLUTION_STEP) * DYNAMIC_RESOLUTION_STEP;
+		desired_scale = std::clamp(desired_scale, min_scale, max_scale);
+		if (desired_scale == dynamic_resolution_scale) return;
+
+		dynamic_resolution_scale = desired_scale;
+		frames_since_scale_change = 0;
+		upscaler->SetDynamicResolutionScale(dynamic_resolution_scale);
+	}
+
 	void UpscalerPassGroup::GroupGUI()
 	{
 		QueueGUI([&]()
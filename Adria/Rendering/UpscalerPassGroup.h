@@ -15,6 +15,7 @@ namespace adria
 	public:
 		UpscalerPassGroup(GfxDevice* gfx, Uint32 width, Uint32 height);
 		virtual void OnResize(Uint32 w, Uint32 h) override;
+		void UpdateDynamicResolution();
 
 		void AddRenderResolutionChangedCallback(RenderResolutionChangedDelegate delegate)
 		{
@@ -26,6 +27,9 @@ namespace adria
 		UpscalerType upscaler_type;
 		UpscalerDisabledEvent upscaler_disabled_event;
 		Uint32 display_width, display_height;
+		Float dynamic_resolution_scale = 1.0f;
+		Float smoothed_gpu_time = 0.0f;
+		Uint32 frames_since_scale_change = 0;
 
 	private:
 		virtual void GroupGUI() override;
@@ -0,0 +1,215 @@
+#include "VideoCapturePass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxReadbackQueue.h"
+#include "Graphics/GfxVideoEncoder.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Utilities/AllocatorUtil.h"
+#include "Editor/GUICommand.h"
+#include "Logging/Logger.h"
+#include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<Bool> VideoCapture("r.VideoCapture", false, "Record the final image into an H.264 stream using the hardware video encoder");
+	static TAutoConsoleVariable<Int>  VideoCaptureQP("r.VideoCapture.QP", 23, "Constant quantization parameter of intra frames, lower values give better quality and bigger files");
+	static TAutoConsoleVariable<Int>  VideoCaptureFrameRate("r.VideoCapture.FrameRate", 60, "Frame rate written into the rate control of the captured stream");
+
+	VideoCapturePass::VideoCapturePass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h)
+	{
+		CreatePSO();
+	}
+
+	VideoCapturePass::~VideoCapturePass()
+	{
+		if (encoder) FinishCapture();
+	}
+
+	void VideoCapturePass::AddPasses(RenderGraph& rg)
+	{
+		if (stopping)
+		{
+			FinishCapture();
+			stopping = false;
+		}
+
+		Bool const size_changed = encoder && (encoder->GetDesc().width != (Uint32)Align(width, 2) || encoder->GetDesc().height != (Uint32)Align(height, 2));
+		if (encoder && (!VideoCapture.Get() || size_changed))
+		{
+			AddFlushPass(rg);
+			stopping = true;
+			return;
+		}
+		if (!VideoCapture.Get()) return;
+
+		if (!encoder)
+		{
+			StartCapture();
+			if (!encoder) return;
+		}
+		AddConvertPass(rg);
+		AddEncodePass(rg);
+	}
+
+	void VideoCapturePass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNodeEx("Video Capture", 0))
+				{
+					ImGui::Checkbox("Record", VideoCapture.GetPtr());
+					ImGui::SliderInt("QP", VideoCaptureQP.GetPtr(), 10, 51);
+					if (encoder) ImGui::Text("Recording adria_capture_%u.h264 at %ux%u", capture_index - 1, encoder->GetDesc().width, encoder->GetDesc().height);
+					ImGui::TreePop();
+					ImGui::Separator();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void VideoCapturePass::CreatePSO()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_VideoCaptureConvert;
+		convert_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void VideoCapturePass::StartCapture()
+	{
+		GfxVideoEncoderDesc encoder_desc{};
+		encoder_desc.width = width;
+		encoder_desc.height = height;
+		encoder_desc.frame_rate = (Uint32)std::max(VideoCaptureFrameRate.Get(), 1);
+		encoder_desc.gop_length = encoder_desc.frame_rate;
+		encoder_desc.qp = (Uint32)std::clamp(VideoCaptureQP.Get(), 0, 49);
+		encoder = std::make_unique<GfxVideoEncoder>(gfx, encoder_desc, [this](Uint8 const* data, Uint64 size)
+			{
+				output.write(reinterpret_cast<Char const*>(data), size);
+			});
+		if (!encoder->IsValid())
+		{
+			encoder.reset();
+			VideoCapture->Set(false);
+			return;
+		}
+
+		std::string const capture_path = paths::ScreenshotsDir + "adria_capture_" + std::to_string(capture_index++) + ".h264";
+		output.open(capture_path, std::ios::binary);
+		ADRIA_LOG(INFO, "Video capture started: %s", capture_path.c_str());
+	}
+
+	//readback callbacks write into the stream, so the encoder and file stay alive until every queued readback has run
+	void VideoCapturePass::FinishCapture()
+	{
+		gfx->WaitForGPU();
+		gfx->GetReadbackQueue()->Flush();
+		encoder.reset();
+		output.close();
+		ADRIA_LOG(INFO, "Video capture finished");
+	}
+
+	void VideoCapturePass::AddConvertPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		Uint32 const encode_width = encoder->GetDesc().width;
+		Uint32 const encode_height = encoder->GetDesc().height;
+
+		struct VideoCaptureConvertPassData
+		{
+			RGTextureReadOnlyId  input;
+			RGTextureReadWriteId luma;
+			RGTextureReadWriteId chroma;
+		};
+
+		rg.AddPass<VideoCaptureConvertPassData>("Video Capture Convert Pass",
+			[=](VideoCaptureConvertPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc luma_desc{};
+				luma_desc.format = GfxFormat::R8_UNORM;
+				luma_desc.width = encode_width;
+				luma_desc.height = encode_height;
+				builder.DeclareTexture(RG_NAME(VideoCaptureLuma), luma_desc);
+
+				RGTextureDesc chroma_desc{};
+				chroma_desc.format = GfxFormat::R8G8_UNORM;
+				chroma_desc.width = encode_width / 2;
+				chroma_desc.height = encode_height / 2;
+				builder.DeclareTexture(RG_NAME(VideoCaptureChroma), chroma_desc);
+
+				data.luma = builder.WriteTexture(RG_NAME(VideoCaptureLuma));
+				data.chroma = builder.WriteTexture(RG_NAME(VideoCaptureChroma));
+				data.input = builder.ReadTexture(RG_NAME(FinalTexture), ReadAccess_NonPixelShader);
+			},
+			[=](VideoCaptureConvertPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.input),
+					ctx.GetReadWriteTexture(data.luma),
+					ctx.GetReadWriteTexture(data.chroma)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				//every thread converts a 2x2 block, writing four luma texels and one averaged chroma texel
+				struct VideoCaptureConvertConstants
+				{
+					Uint32 input_idx;
+					Uint32 luma_idx;
+					Uint32 chroma_idx;
+					Uint32 width;
+					Uint32 height;
+				} constants =
+				{
+					.input_idx = i + 0,
+					.luma_idx = i + 1,
+					.chroma_idx = i + 2,
+					.width = encode_width,
+					.height = encode_height
+				};
+
+				cmd_list->SetPipelineState(convert_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(encode_width / 2, 8), DivideAndRoundUp(encode_height / 2, 8), 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
+	void VideoCapturePass::AddEncodePass(RenderGraph& rg)
+	{
+		struct VideoCaptureEncodePassData
+		{
+			RGTextureCopySrcId luma;
+			RGTextureCopySrcId chroma;
+		};
+
+		rg.AddPass<VideoCaptureEncodePassData>("Video Capture Encode Pass",
+			[=](VideoCaptureEncodePassData& data, RenderGraphBuilder& builder)
+			{
+				data.luma = builder.ReadCopySrcTexture(RG_NAME(VideoCaptureLuma));
+				data.chroma = builder.ReadCopySrcTexture(RG_NAME(VideoCaptureChroma));
+			},
+			[=](VideoCaptureEncodePassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				encoder->EncodeFrame(cmd_list, ctx.GetCopySrcTexture(data.luma), ctx.GetCopySrcTexture(data.chroma));
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
+	}
+
+	void VideoCapturePass::AddFlushPass(RenderGraph& rg)
+	{
+		rg.AddPass<void>("Video Capture Flush Pass",
+			[=](RenderGraphBuilder& builder)
+			{
+			},
+			[=](RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				encoder->ReadbackAll(cmd_list);
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <fstream>
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxComputePipelineState;
+	class GfxVideoEncoder;
+	class RenderGraph;
+
+	//records the final texture into a raw h264 elementary stream in the screenshots folder using the hardware video encoder
+	class VideoCapturePass
+	{
+	public:
+		VideoCapturePass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~VideoCapturePass();
+
+		void AddPasses(RenderGraph& rg);
+		void GUI();
+		Bool IsCapturing() const { return encoder != nullptr; }
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+		}
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+		std::unique_ptr<GfxComputePipelineState> convert_pso;
+		std::unique_ptr<GfxVideoEncoder> encoder;
+		std::ofstream output;
+		Bool stopping = false;
+		Uint32 capture_index = 0;
+
+	private:
+		void CreatePSO();
+		void StartCapture();
+		void FinishCapture();
+
+		void AddConvertPass(RenderGraph& rg);
+		void AddEncodePass(RenderGraph& rg);
+		void AddFlushPass(RenderGraph& rg);
+	};
+}
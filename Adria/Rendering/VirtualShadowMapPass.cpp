@@ -0,0 +1,290 @@
+#include "VirtualShadowMapPass.h"
+#include "BlackboardData.h"
+#include "ShaderManager.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxTexture.h"
+#include "Graphics/GfxPipelineState.h"
+#include "RenderGraph/RenderGraph.h"
+
+using namespace DirectX;
+
+namespace adria
+{
+
+	VirtualShadowMapPass::VirtualShadowMapPass(GfxDevice* gfx, Uint32 w, Uint32 h) : gfx(gfx), width(w), height(h),
+		free_pages(gfx, StructuredBufferDesc<Uint32>(PHYSICAL_PAGE_COUNT)),
+		free_page_count(gfx, StructuredBufferDesc<Uint32>(1))
+	{
+		CreatePSOs();
+		CreateResources();
+	}
+	VirtualShadowMapPass::~VirtualShadowMapPass() = default;
+
+	void VirtualShadowMapPass::AddPageAllocationPasses(RenderGraph& rg, Uint32 light_matrix_index, Uint64 static_casters_hash, Bool has_dynamic_casters)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		//pages cannot tell which dynamic casters touched them, so those keep the whole map dirty
+		Bool const reset_pages = invalidate || has_dynamic_casters || static_casters_hash != cached_static_casters_hash;
+		cached_static_casters_hash = static_casters_hash;
+		invalidate = false;
+
+		rg.ImportTexture(RG_NAME(VirtualShadowMapPageTable), page_table.get());
+		rg.ImportTexture(RG_NAME(VirtualShadowMapPageRequests), page_requests.get());
+		rg.ImportTexture(RG_NAME(VirtualShadowMapPhysicalPages), physical_pages.get());
+		rg.ImportBuffer(RG_NAME(VirtualShadowMapFreePages), &free_pages);
+		rg.ImportBuffer(RG_NAME(VirtualShadowMapFreePageCount), &free_page_count);
+
+		if (reset_pages)
+		{
+			struct ResetPagesPassData
+			{
+				RGTextureReadWriteId page_table;
+				RGTextureReadWriteId page_requests;
+				RGBufferReadWriteId  free_pages;
+				RGBufferReadWriteId  free_page_count;
+			};
+			rg.AddPass<ResetPagesPassData>("Virtual Shadow Map Reset Pages Pass",
+				[=](ResetPagesPassData& data, RenderGraphBuilder& builder)
+				{
+					data.page_table = builder.WriteTexture(RG_NAME(VirtualShadowMapPageTable));
+					data.page_requests = builder.WriteTexture(RG_NAME(VirtualShadowMapPageRequests));
+					data.free_pages = builder.WriteBuffer(RG_NAME(VirtualShadowMapFreePages));
+					data.free_page_count = builder.WriteBuffer(RG_NAME(VirtualShadowMapFreePageCount));
+				},
+				[=](ResetPagesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+				{
+					GfxDevice* gfx = cmd_list->GetDevice();
+					GfxDescriptor src_descriptors[] =
+					{
+						ctx.GetReadWriteTexture(data.page_table),
+						ctx.GetReadWriteTexture(data.page_requests),
+						ctx.GetReadWriteBuffer(data.free_pages),
+						ctx.GetReadWriteBuffer(data.free_page_count)
+					};
+					GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+					gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+					Uint32 const i = dst_descriptor.GetIndex();
+
+					struct ResetPagesConstants
+					{
+						Uint32 page_table_idx;
+						Uint32 page_requests_idx;
+						Uint32 free_pages_idx;
+						Uint32 free_page_count_idx;
+						Uint32 physical_page_count;
+					} constants =
+					{
+						.page_table_idx = i, .page_requests_idx = i + 1, .free_pages_idx = i + 2, .free_page_count_idx = i + 3,
+						.physical_page_count = PHYSICAL_PAGE_COUNT
+					};
+
+					cmd_list->SetPipelineState(reset_pages_pso.get());
+					cmd_list->SetRootConstants(1, constants);
+					cmd_list->Dispatch(DivideAndRoundUp(PAGE_TABLE_SIZE, 16), DivideAndRoundUp(PAGE_TABLE_SIZE, 16), 1);
+				}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+		}
+
+		struct MarkPagesPassData
+		{
+			RGTextureReadOnlyId  depth;
+			RGTextureReadWriteId page_requests;
+		};
+		rg.AddPass<MarkPagesPassData>("Virtual Shadow Map Mark Pages Pass",
+			[=](MarkPagesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_NonPixelShader);
+				data.page_requests = builder.WriteTexture(RG_NAME(VirtualShadowMapPageRequests));
+			},
+			[=](MarkPagesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.depth),
+					ctx.GetReadWriteTexture(data.page_requests)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct MarkPagesConstants
+				{
+					Uint32 depth_idx;
+					Uint32 page_requests_idx;
+					Uint32 light_matrix_idx;
+					Uint32 page_table_size;
+				} constants =
+				{
+					.depth_idx = i, .page_requests_idx = i + 1, .light_matrix_idx = light_matrix_index,
+					.page_table_size = PAGE_TABLE_SIZE
+				};
+
+				cmd_list->SetPipelineState(mark_pages_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(width, 16), DivideAndRoundUp(height, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+
+		struct UpdatePagesPassData
+		{
+			RGTextureReadWriteId page_table;
+			RGTextureReadOnlyId  page_requests;
+			RGBufferReadWriteId  free_pages;
+			RGBufferReadWriteId  free_page_count;
+		};
+		rg.AddPass<UpdatePagesPassData>("Virtual Shadow Map Update Pages Pass",
+			[=](UpdatePagesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.page_table = builder.WriteTexture(RG_NAME(VirtualShadowMapPageTable));
+				data.page_requests = builder.ReadTexture(RG_NAME(VirtualShadowMapPageRequests), ReadAccess_NonPixelShader);
+				data.free_pages = builder.WriteBuffer(RG_NAME(VirtualShadowMapFreePages));
+				data.free_page_count = builder.WriteBuffer(RG_NAME(VirtualShadowMapFreePageCount));
+			},
+			[=](UpdatePagesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadWriteTexture(data.page_table),
+					ctx.GetReadOnlyTexture(data.page_requests),
+					ctx.GetReadWriteBuffer(data.free_pages),
+					ctx.GetReadWriteBuffer(data.free_page_count)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct UpdatePagesConstants
+				{
+					Uint32 page_table_idx;
+					Uint32 page_requests_idx;
+					Uint32 free_pages_idx;
+					Uint32 free_page_count_idx;
+					Uint32 page_retention_frames;
+				} constants =
+				{
+					.page_table_idx = i, .page_requests_idx = i + 1, .free_pages_idx = i + 2, .free_page_count_idx = i + 3,
+					.page_retention_frames = PAGE_RETENTION_FRAMES
+				};
+
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+
+				//stale pages go back to the free list before new requests pop from it
+				cmd_list->SetPipelineState(free_pages_pso.get());
+				cmd_list->Dispatch(DivideAndRoundUp(PAGE_TABLE_SIZE, 16), DivideAndRoundUp(PAGE_TABLE_SIZE, 16), 1);
+				cmd_list->GlobalBarrier(GfxResourceState::ComputeUAV, GfxResourceState::ComputeUAV);
+				cmd_list->SetPipelineState(allocate_pages_pso.get());
+				cmd_list->Dispatch(DivideAndRoundUp(PAGE_TABLE_SIZE, 16), DivideAndRoundUp(PAGE_TABLE_SIZE, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+
+		struct ClearPagesPassData
+		{
+			RGTextureReadOnlyId  page_table;
+			RGTextureReadWriteId physical_pages;
+		};
+		rg.AddPass<ClearPagesPassData>("Virtual Shadow Map Clear Pages Pass",
+			[=](ClearPagesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.page_table = builder.ReadTexture(RG_NAME(VirtualShadowMapPageTable), ReadAccess_NonPixelShader);
+				data.physical_pages = builder.WriteTexture(RG_NAME(VirtualShadowMapPhysicalPages));
+			},
+			[=](ClearPagesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+				GfxDescriptor src_descriptors[] =
+				{
+					ctx.GetReadOnlyTexture(data.page_table),
+					ctx.GetReadWriteTexture(data.physical_pages)
+				};
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_descriptors));
+				gfx->CopyDescriptors(dst_descriptor, src_descriptors);
+				Uint32 const i = dst_descriptor.GetIndex();
+
+				struct ClearPagesConstants
+				{
+					Uint32 page_table_idx;
+					Uint32 physical_pages_idx;
+					Uint32 page_size;
+				} constants =
+				{
+					.page_table_idx = i, .physical_pages_idx = i + 1, .page_size = PAGE_SIZE
+				};
+
+				//one group per virtual page, groups of pages that are not dirty exit immediately
+				cmd_list->SetPipelineState(clear_pages_pso.get());
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(PAGE_TABLE_SIZE, PAGE_TABLE_SIZE, 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+	}
+
+	Vector3 VirtualShadowMapPass::GetViewCenter(Vector3 const& light_direction, Vector3 const& camera_position, Float radius)
+	{
+		Vector3 light_dir = XMVector3Normalize(light_direction);
+		Matrix const light_rotation = XMMatrixLookAtLH(Vector3::Zero, light_dir, Vector3::Up);
+		Vector3 const camera_light_space = Vector3::Transform(camera_position, light_rotation);
+		Vector3 const center_light_space = Vector3::Transform(view_center, light_rotation);
+
+		//keep the virtual map fixed while the camera stays near its center so cached pages survive camera movement
+		Float const recenter_distance = 0.25f * radius;
+		Vector3 const offset = camera_light_space - center_light_space;
+		Bool const recenter = light_dir != view_light_direction || radius != view_radius ||
+			std::abs(offset.x) > recenter_distance || std::abs(offset.y) > recenter_distance || std::abs(offset.z) > recenter_distance;
+		if (recenter)
+		{
+			Float const page_world_size = 2.0f * radius / PAGE_TABLE_SIZE;
+			Vector3 snapped_center = XMVectorRound(camera_light_space / page_world_size);
+			snapped_center *= page_world_size;
+			view_center = Vector3::Transform(snapped_center, light_rotation.Invert());
+			view_light_direction = light_dir;
+			view_radius = radius;
+		}
+		return view_center;
+	}
+
+	void VirtualShadowMapPass::CreatePSOs()
+	{
+		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_VirtualShadowMapReset;
+		reset_pages_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_VirtualShadowMapMarkPages;
+		mark_pages_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_VirtualShadowMapFreePages;
+		free_pages_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_VirtualShadowMapAllocatePages;
+		allocate_pages_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
+		compute_pso_desc.CS = CS_VirtualShadowMapClearPages;
+		clear_pages_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+	}
+
+	void VirtualShadowMapPass::CreateResources()
+	{
+		GfxTextureDesc page_table_desc{};
+		page_table_desc.width = PAGE_TABLE_SIZE;
+		page_table_desc.height = PAGE_TABLE_SIZE;
+		page_table_desc.format = GfxFormat::R32_UINT;
+		page_table_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		page_table_desc.initial_state = GfxResourceState::ComputeUAV;
+		page_table = gfx->CreateTexture(page_table_desc);
+		page_table->SetName("Virtual Shadow Map Page Table");
+		page_table_srv = gfx->CreateTextureSRV(page_table.get());
+
+		page_requests = gfx->CreateTexture(page_table_desc);
+		page_requests->SetName("Virtual Shadow Map Page Requests");
+
+		GfxTextureDesc physical_pages_desc{};
+		physical_pages_desc.width = PHYSICAL_SIZE;
+		physical_pages_desc.height = PHYSICAL_SIZE;
+		physical_pages_desc.format = GfxFormat::R32_UINT;
+		physical_pages_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		physical_pages_desc.initial_state = GfxResourceState::ComputeUAV;
+		physical_pages = gfx->CreateTexture(physical_pages_desc);
+		physical_pages->SetName("Virtual Shadow Map Physical Pages");
+		physical_pages_srv = gfx->CreateTextureSRV(physical_pages.get());
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxDescriptor.h"
+#include "RenderGraph/RenderGraphResourceName.h"
+
+namespace adria
+{
+	class RenderGraph;
+	class GfxDevice;
+	class GfxTexture;
+	class GfxComputePipelineState;
+
+	class VirtualShadowMapPass
+	{
+	public:
+		static constexpr Uint32 VIRTUAL_SIZE = 16384;
+		static constexpr Uint32 PAGE_SIZE = 128;
+		static constexpr Uint32 PAGE_TABLE_SIZE = VIRTUAL_SIZE / PAGE_SIZE;
+		static constexpr Uint32 PHYSICAL_SIZE = 4096;
+		static constexpr Uint32 PHYSICAL_PAGE_COUNT = (PHYSICAL_SIZE / PAGE_SIZE) * (PHYSICAL_SIZE / PAGE_SIZE);
+		static constexpr Uint32 PAGE_RETENTION_FRAMES = 30;
+
+	public:
+		VirtualShadowMapPass(GfxDevice* gfx, Uint32 w, Uint32 h);
+		~VirtualShadowMapPass();
+
+		void AddPageAllocationPasses(RenderGraph& rg, Uint32 light_matrix_index, Uint64 static_casters_hash, Bool has_dynamic_casters);
+		Vector3 GetViewCenter(Vector3 const& light_direction, Vector3 const& camera_position, Float radius);
+		void Invalidate() { invalidate = true; }
+		void OnResize(Uint32 w, Uint32 h)
+		{
+			width = w, height = h;
+		}
+
+		GfxDescriptor GetPageTableSRV() const { return page_table_srv; }
+		GfxDescriptor GetPhysicalPagesSRV() const { return physical_pages_srv; }
+
+	private:
+		GfxDevice* gfx;
+		Uint32 width, height;
+
+		std::unique_ptr<GfxTexture> page_table;
+		std::unique_ptr<GfxTexture> page_requests;
+		std::unique_ptr<GfxTexture> physical_pages;
+		GfxBuffer free_pages;
+		GfxBuffer free_page_count;
+		GfxDescriptor page_table_srv;
+		GfxDescriptor physical_pages_srv;
+
+		std::unique_ptr<GfxComputePipelineState> reset_pages_pso;
+		std::unique_ptr<GfxComputePipelineState> mark_pages_pso;
+		std::unique_ptr<GfxComputePipelineState> free_pages_pso;
+		std::unique_ptr<GfxComputePipelineState> allocate_pages_pso;
+		std::unique_ptr<GfxComputePipelineState> clear_pages_pso;
+
+		Bool invalidate = true;
+		Uint64 cached_static_casters_hash = 0;
+		Vector3 view_center = Vector3::Zero;
+		Vector3 view_light_direction = Vector3::Zero;
+		Float view_radius = 0.0f;
+
+	private:
+		void CreatePSOs();
+		void CreateResources();
+	};
+}
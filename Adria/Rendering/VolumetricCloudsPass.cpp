@@ -5,6 +5,7 @@
 #include "ShaderManager.h" 
 #include "PostProcessor.h" 
 #include "TextureManager.h"
+#include "ProceduralTextureCache.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxDevice.h"
@@ -12,6 +13,7 @@
 #include "Logging/Logger.h"
 #include "Editor/GUICommand.h"
 #include "Core/ConsoleManager.h"
+#include "Utilities/HashUtil.h"
 
 
 using namespace DirectX;
@@ -19,12 +21,30 @@ using namespace DirectX;
 namespace adria
 {
 	static TAutoConsoleVariable<Bool> Clouds("r.Clouds", true, "Enable or Disable Clouds");
+	static TAutoConsoleVariable<Bool> CloudsTemporalAmortization("r.Clouds.TemporalAmortization", false, "Raymarch one pixel per 4x4 block each frame and reproject the rest");
+	static TAutoConsoleVariable<Bool> CloudShadowMap("r.Clouds.ShadowMap", true, "Keep a top down cloud transmittance map for sun shadowing in the lighting, volumetric and ocean passes");
+	static TAutoConsoleVariable<Int> CloudShadowMapSlices("r.Clouds.ShadowMap.Slices", 8, "Number of frames over which the cloud shadow map is updated, one slice of rows per frame");
+
+	static constexpr Uint32 CLOUDS_AMORTIZATION_BLOCK_SIZE = 4;
+	static constexpr Uint32 CLOUDS_BAYER_ORDER[CLOUDS_AMORTIZATION_BLOCK_SIZE * CLOUDS_AMORTIZATION_BLOCK_SIZE] =
+	{
+		0, 10, 2, 8, 5, 15, 7, 13, 1, 11, 3, 9, 4, 14, 6, 12
+	};
 
 		
 	VolumetricCloudsPass::VolumetricCloudsPass(GfxDevice* gfx, Uint32 w, Uint32 h)
 		: gfx(gfx), width{ w }, height{ h }
 	{
 		CreatePSOs();
+
+		GfxTextureDesc cloud_shadow_desc{};
+		cloud_shadow_desc.width = CLOUD_SHADOW_DIM;
+		cloud_shadow_desc.height = CLOUD_SHADOW_DIM;
+		cloud_shadow_desc.format = GfxFormat::R16_FLOAT;
+		cloud_shadow_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
+		cloud_shadow_desc.initial_state = GfxResourceState::AllSRV;
+		cloud_shadow_map = gfx->CreateTexture(cloud_shadow_desc);
+		cloud_shadow_map_srv = gfx->CreateTextureSRV(cloud_shadow_map.get());
 	}
 
 	VolumetricCloudsPass::~VolumetricCloudsPass() = default;
@@ -39,15 +59,15 @@ namespace adria
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
 		rg.ImportTexture(RG_NAME(PreviousCloudsOutput), prev_clouds.get());
 
-		static Bool first_frame = true;
-		if (first_frame || should_generate_textures)
+		if (should_generate_textures)
 		{
-			first_frame = false;
-			if (should_generate_textures)
-			{
-				CreateCloudTextures();
-				should_generate_textures = false;
-			}
+			CreateCloudTextures();
+			should_generate_textures = false;
+		}
+
+		if (!cloud_textures_baked)
+		{
+			cloud_textures_baked = true;
 			rg.ImportTexture(RG_NAME(CloudShape), cloud_shape_noise.get());
 			rg.ImportTexture(RG_NAME(CloudDetail), cloud_detail_noise.get());
 			rg.ImportTexture(RG_NAME(CloudType), cloud_type.get());
@@ -91,7 +111,7 @@ namespace adria
 						cmd_list->SetRootConstants(1, constants);
 						Uint32 const dispatch = DivideAndRoundUp(resolution, 8);
 						cmd_list->Dispatch(dispatch, dispatch, dispatch);
-					}, RGPassType::Compute, RGPassFlags::None);
+					}, RGPassType::ComputeAsync, RGPassFlags::None);
 			}
 
 			for (Uint32 i = 0; i < cloud_detail_noise->GetDesc().mip_levels; ++i)
@@ -126,7 +146,7 @@ namespace adria
 						cmd_list->SetRootConstants(1, constants);
 						Uint32 const dispatch = DivideAndRoundUp(resolution, 8);
 						cmd_list->Dispatch(dispatch, dispatch, dispatch);
-					}, RGPassType::Compute, RGPassFlags::None);
+					}, RGPassType::ComputeAsync, RGPassFlags::None);
 			}
 
 			struct CloudTypePassData
@@ -158,7 +178,9 @@ namespace adria
 					cmd_list->SetRootConstants(1, constants);
 					Uint32 const dispatch = DivideAndRoundUp(resolution, 8);
 					cmd_list->Dispatch(dispatch, dispatch, dispatch);
-				}, RGPassType::Compute, RGPassFlags::None);
+				}, RGPassType::ComputeAsync, RGPassFlags::None);
+
+			AddBakeCloudTexturesPass(rg);
 		}
 		else
 		{
@@ -167,6 +189,17 @@ namespace adria
 			rg.ImportTexture(RG_NAME(CloudType), cloud_type.get());
 		}
 
+		if (CloudShadowMap.Get()) AddCloudShadowPass(rg);
+		else cloud_shadow_valid = false;
+
+		Bool const temporal_amortization = CloudsTemporalAmortization.Get();
+		Uint32 const update_index = CLOUDS_BAYER_ORDER[gfx->GetFrameIndex() % ARRAYSIZE(CLOUDS_BAYER_ORDER)];
+		Uint32 const clouds_width = width >> resolution;
+		Uint32 const clouds_height = height >> resolution;
+		Uint32 const raymarch_width = temporal_amortization ? DivideAndRoundUp(clouds_width, CLOUDS_AMORTIZATION_BLOCK_SIZE) : clouds_width;
+		Uint32 const raymarch_height = temporal_amortization ? DivideAndRoundUp(clouds_height, CLOUDS_AMORTIZATION_BLOCK_SIZE) : clouds_height;
+		RGResourceName const raymarch_output = temporal_amortization ? RG_NAME(CloudsRaymarchOutput) : RG_NAME(CloudsOutput);
+
 		struct VolumetricCloudsPassData
 		{
 			RGTextureReadOnlyId type;
@@ -180,12 +213,12 @@ namespace adria
 			{
 				RGTextureDesc clouds_output_desc{};
 				clouds_output_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
-				clouds_output_desc.width = width >> resolution;
-				clouds_output_desc.height = height >> resolution;
+				clouds_output_desc.width = raymarch_width;
+				clouds_output_desc.height = raymarch_height;
 				clouds_output_desc.format = GfxFormat::R16G16B16A16_FLOAT;
 
-				builder.DeclareTexture(RG_NAME(CloudsOutput), clouds_output_desc);
-				data.output = builder.WriteTexture(RG_NAME(CloudsOutput));
+				builder.DeclareTexture(raymarch_output, clouds_output_desc);
+				data.output = builder.WriteTexture(raymarch_output);
 				data.type = builder.ReadTexture(RG_NAME(CloudType), ReadAccess_NonPixelShader);
 				data.shape = builder.ReadTexture(RG_NAME(CloudShape), ReadAccess_NonPixelShader);
 				data.detail = builder.ReadTexture(RG_NAME(CloudDetail), ReadAccess_NonPixelShader);
@@ -240,6 +273,8 @@ namespace adria
 					Float 	    henyey_greenstein_g_forward;
 					Float 	    henyey_greenstein_g_backward;
 					Uint32      resolution_factor;
+
+					Uint32      update_index;
 				} constants =
 				{
 					.type_idx = i + 0,
@@ -273,10 +308,16 @@ namespace adria
 					.sun_light_factor = params.sun_light_factor,
 					.henyey_greenstein_g_forward = params.henyey_greenstein_g_forward,
 					.henyey_greenstein_g_backward = params.henyey_greenstein_g_backward,
-					.resolution_factor = (Uint32)resolution
+					.resolution_factor = (Uint32)resolution,
+
+					.update_index = update_index
 				};
 
-				if (temporal_reprojection)
+				if (temporal_amortization)
+				{
+					clouds_psos->AddDefine("TEMPORAL_AMORTIZATION", "1");
+				}
+				else if (temporal_reprojection)
 				{
 					clouds_psos->AddDefine("REPROJECTION", "1");
 				}
@@ -285,11 +326,13 @@ namespace adria
 				cmd_list->SetPipelineState(clouds_pso);
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 				cmd_list->SetRootCBV(2, constants);
-				cmd_list->Dispatch(DivideAndRoundUp((width >> resolution), 16), DivideAndRoundUp((height >> resolution), 16), 1);
+				cmd_list->Dispatch(DivideAndRoundUp(raymarch_width, 16), DivideAndRoundUp(raymarch_height, 16), 1);
 
 			}, RGPassType::Compute, RGPassFlags::None);
 
-		if (temporal_reprojection)
+		if (temporal_amortization) AddReconstructPass(rg, update_index);
+
+		if (temporal_reprojection || temporal_amortization)
 		{
 			struct CopyCloudsPassData
 			{
@@ -313,6 +356,173 @@ namespace adria
 		AddCombinePass(rg, postprocessor->GetFinalResource());
 	}
 
+	//the lighting of the next frame reads the map, a slice of its rows is remarched each frame
+	void VolumetricCloudsPass::AddCloudShadowPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		//the map stays fixed in world space while the camera is inside a cell, moving to another cell rebuilds it at once
+		Float const cell_size = 2.0f * CLOUD_SHADOW_EXTENT / CLOUD_SHADOW_CELLS;
+		Vector2 const center(std::floor(frame_data.camera_position[0] / cell_size + 0.5f) * cell_size, std::floor(frame_data.camera_position[2] / cell_size + 0.5f) * cell_size);
+		Uint32 const slice_count = std::clamp<Uint32>((Uint32)CloudShadowMapSlices.Get(), 1, CLOUD_SHADOW_DIM / 16);
+		Uint32 const rows_per_slice = DivideAndRoundUp(CLOUD_SHADOW_DIM, slice_count);
+
+		Uint32 first_row = 0, row_count = CLOUD_SHADOW_DIM;
+		if (cloud_shadow_valid && center == cloud_shadow_center && slice_count > 1)
+		{
+			cloud_shadow_slice = (cloud_shadow_slice + 1) % slice_count;
+			first_row = cloud_shadow_slice * rows_per_slice;
+			row_count = std::min(rows_per_slice, CLOUD_SHADOW_DIM - first_row);
+		}
+		cloud_shadow_valid = true;
+		cloud_shadow_center = center;
+
+		rg.ImportTexture(RG_NAME(CloudShadowMap), cloud_shadow_map.get());
+
+		struct CloudShadowPassData
+		{
+			RGTextureReadOnlyId type;
+			RGTextureReadOnlyId shape;
+			RGTextureReadOnlyId detail;
+			RGTextureReadWriteId output;
+		};
+		rg.AddPass<CloudShadowPassData>("Cloud Shadow Pass",
+			[=](CloudShadowPassData& data, RenderGraphBuilder& builder)
+			{
+				data.output = builder.WriteTexture(RG_NAME(CloudShadowMap));
+				data.type = builder.ReadTexture(RG_NAME(CloudType), ReadAccess_NonPixelShader);
+				data.shape = builder.ReadTexture(RG_NAME(CloudShape), ReadAccess_NonPixelShader);
+				data.detail = builder.ReadTexture(RG_NAME(CloudDetail), ReadAccess_NonPixelShader);
+			},
+			[=](CloudShadowPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.type),
+												context.GetReadOnlyTexture(data.shape),
+												context.GetReadOnlyTexture(data.detail),
+												context.GetReadWriteTexture(data.output) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				Float noise_scale = 0.00001f + params.shape_noise_scale * 0.0004f;
+				struct CloudShadowConstants
+				{
+					Uint32      type_idx;
+					Uint32      shape_idx;
+					Uint32      detail_idx;
+					Uint32      output_idx;
+
+					Vector2     shadow_center;
+					Float       shadow_extent;
+					Uint32      first_row;
+
+					Float		cloud_type;
+					Float 	    cloud_min_height;
+					Float 	    cloud_max_height;
+					Float 	    shape_noise_scale;
+
+					Float 	    detail_noise_scale;
+					Float 	    detail_noise_modifier;
+					Float       global_density;
+					Float 	    cloud_coverage;
+
+					Vector3     planet_center;
+					Float 	    planet_radius;
+
+					Float 	    precipitation;
+					Uint32      shadow_dim;
+				} constants =
+				{
+					.type_idx = i + 0,
+					.shape_idx = i + 1,
+					.detail_idx = i + 2,
+					.output_idx = i + 3,
+
+					.shadow_center = center,
+					.shadow_extent = CLOUD_SHADOW_EXTENT,
+					.first_row = first_row,
+
+					.cloud_type = params.cloud_type,
+					.cloud_min_height = params.cloud_min_height,
+					.cloud_max_height = params.cloud_max_height,
+					.shape_noise_scale = noise_scale,
+
+					.detail_noise_scale = params.detail_noise_scale * noise_scale,
+					.detail_noise_modifier = params.detail_noise_modifier,
+					.global_density = params.global_density,
+					.cloud_coverage = params.cloud_coverage,
+
+					.planet_center = Vector3(0.0f, -params.planet_radius, 0.0f),
+					.planet_radius = params.planet_radius,
+
+					.precipitation = params.precipitation * 0.01f,
+					.shadow_dim = CLOUD_SHADOW_DIM
+				};
+
+				cmd_list->SetPipelineState(cloud_shadow_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(CLOUD_SHADOW_DIM, 16), DivideAndRoundUp(row_count, 16), 1);
+			}, RGPassType::Compute, RGPassFlags::ForceNoCull);
+	}
+
+	void VolumetricCloudsPass::AddReconstructPass(RenderGraph& rg, Uint32 update_index)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct CloudsReconstructPassData
+		{
+			RGTextureReadOnlyId  raymarch_output;
+			RGTextureReadOnlyId  prev_output;
+			RGTextureReadWriteId output;
+		};
+		rg.AddPass<CloudsReconstructPassData>("Clouds Reconstruct Pass",
+			[=](CloudsReconstructPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc clouds_output_desc{};
+				clouds_output_desc.clear_value = GfxClearValue(0.0f, 0.0f, 0.0f, 0.0f);
+				clouds_output_desc.width = width >> resolution;
+				clouds_output_desc.height = height >> resolution;
+				clouds_output_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+
+				builder.DeclareTexture(RG_NAME(CloudsOutput), clouds_output_desc);
+				data.output = builder.WriteTexture(RG_NAME(CloudsOutput));
+				data.raymarch_output = builder.ReadTexture(RG_NAME(CloudsRaymarchOutput), ReadAccess_NonPixelShader);
+				data.prev_output = builder.ReadTexture(RG_NAME(PreviousCloudsOutput), ReadAccess_NonPixelShader);
+			},
+			[=](CloudsReconstructPassData const& data, RenderGraphContext& context, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.raymarch_output),
+												context.GetReadOnlyTexture(data.prev_output),
+												context.GetReadWriteTexture(data.output) };
+				GfxDescriptor dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(src_handles));
+				gfx->CopyDescriptors(dst_handle, src_handles);
+				Uint32 i = dst_handle.GetIndex();
+
+				struct CloudsReconstructConstants
+				{
+					Uint32 raymarch_output_idx;
+					Uint32 prev_output_idx;
+					Uint32 output_idx;
+					Uint32 update_index;
+					Uint32 resolution_factor;
+				} constants =
+				{
+					.raymarch_output_idx = i, .prev_output_idx = i + 1, .output_idx = i + 2,
+					.update_index = update_index, .resolution_factor = (Uint32)resolution
+				};
+
+				cmd_list->SetPipelineState(clouds_reconstruct_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootConstants(1, constants);
+				cmd_list->Dispatch(DivideAndRoundUp((width >> resolution), 16), DivideAndRoundUp((height >> resolution), 16), 1);
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
 	void VolumetricCloudsPass::AddCombinePass(RenderGraph& rendergraph, RGResourceName render_target)
 	{
 		struct CloudsCombinePassData
@@ -341,6 +551,19 @@ namespace adria
 			}, RGPassType::Graphics, RGPassFlags::None);
 	}
 
+	Int32 VolumetricCloudsPass::GetCloudShadowMapIndex() const
+	{
+		if (!Clouds.Get() || !CloudShadowMap.Get() || !cloud_shadow_valid) return -1;
+		GfxDescriptor cloud_shadow_map_srv_gpu = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, cloud_shadow_map_srv_gpu, cloud_shadow_map_srv);
+		return (Int32)cloud_shadow_map_srv_gpu.GetIndex();
+	}
+
+	Vector4 VolumetricCloudsPass::GetCloudShadowParams() const
+	{
+		return Vector4(cloud_shadow_center.x, cloud_shadow_center.y, 1.0f / (2.0f * CLOUD_SHADOW_EXTENT), 0.5f * (params.cloud_min_height + params.cloud_max_height));
+	}
+
 	void VolumetricCloudsPass::OnResize(Uint32 w, Uint32 h)
 	{
 		width = w, height = h;
@@ -367,6 +590,7 @@ namespace adria
 
 		prev_clouds = gfx->CreateTexture(clouds_output_desc);
 		CreateCloudTextures(gfx);
+		cloud_shadow_valid = false;
 	}
 
 	void VolumetricCloudsPass::GUI()
@@ -379,6 +603,9 @@ namespace adria
 					if (Clouds.Get())
 					{
 						ImGui::Checkbox("Temporal reprojection", &temporal_reprojection);
+						ImGui::Checkbox("Temporal amortization (4x4)", CloudsTemporalAmortization.GetPtr());
+						ImGui::Checkbox("Cloud Shadow Map", CloudShadowMap.GetPtr());
+						if (CloudShadowMap.Get()) ImGui::SliderInt("Cloud Shadow Map Slices", CloudShadowMapSlices.GetPtr(), 1, 32);
 						should_generate_textures |= ImGui::SliderInt("Shape Noise Frequency", &params.shape_noise_frequency, 1, 10);
 						should_generate_textures |= ImGui::SliderInt("Shape Noise Resolution", &params.shape_noise_resolution, 32, 256);
 						should_generate_textures |= ImGui::SliderInt("Detail Noise Frequency", &params.detail_noise_frequency, 1, 10);
@@ -440,6 +667,12 @@ namespace adria
 		clouds_pso_desc.CS = CS_Clouds;
 		clouds_psos = std::make_unique<GfxComputePipelineStatePermutations>(gfx, clouds_pso_desc);
 
+		clouds_pso_desc.CS = CS_CloudsReconstruct;
+		clouds_reconstruct_pso = gfx->CreateComputePipelineState(clouds_pso_desc);
+
+		clouds_pso_desc.CS = CS_CloudShadow;
+		cloud_shadow_pso = gfx->CreateComputePipelineState(clouds_pso_desc);
+
 		clouds_pso_desc.CS = CS_CloudType;
 		clouds_type_pso = gfx->CreateComputePipelineState(clouds_pso_desc);
 
@@ -479,7 +712,16 @@ namespace adria
 		cloud_shape_noise_desc.format = GfxFormat::R8G8B8A8_UNORM;
 		cloud_shape_noise_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
 
-		cloud_shape_noise = gfx->CreateTexture(cloud_shape_noise_desc);
+		HashState hash{};
+		hash.Combine(params.shape_noise_frequency);
+		hash.Combine(params.shape_noise_resolution);
+		hash.Combine(params.detail_noise_frequency);
+		hash.Combine(params.detail_noise_resolution);
+		cloud_noise_hash = hash;
+
+		cloud_shape_noise = LoadProceduralTexture(gfx, "CloudShape", cloud_noise_hash, cloud_shape_noise_desc);
+		cloud_textures_baked = cloud_shape_noise != nullptr;
+		if (!cloud_shape_noise) cloud_shape_noise = gfx->CreateTexture(cloud_shape_noise_desc);
 
 		GfxTextureDesc cloud_detail_noise_desc{};
 		cloud_detail_noise_desc.type = GfxTextureType_3D;
@@ -490,7 +732,9 @@ namespace adria
 		cloud_detail_noise_desc.format = GfxFormat::R8G8B8A8_UNORM;
 		cloud_detail_noise_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
 
-		cloud_detail_noise = gfx->CreateTexture(cloud_detail_noise_desc);
+		cloud_detail_noise = LoadProceduralTexture(gfx, "CloudDetail", cloud_noise_hash, cloud_detail_noise_desc);
+		cloud_textures_baked &= cloud_detail_noise != nullptr;
+		if (!cloud_detail_noise) cloud_detail_noise = gfx->CreateTexture(cloud_detail_noise_desc);
 
 		GfxTextureDesc cloud_type_desc{};
 		cloud_type_desc.type = GfxTextureType_2D;
@@ -500,7 +744,32 @@ namespace adria
 		cloud_type_desc.format = GfxFormat::R8_UNORM;
 		cloud_type_desc.bind_flags = GfxBindFlag::ShaderResource | GfxBindFlag::UnorderedAccess;
 
-		cloud_type = gfx->CreateTexture(cloud_type_desc);
+		cloud_type = LoadProceduralTexture(gfx, "CloudType", cloud_noise_hash, cloud_type_desc);
+		cloud_textures_baked &= cloud_type != nullptr;
+		if (!cloud_type) cloud_type = gfx->CreateTexture(cloud_type_desc);
+	}
+
+	void VolumetricCloudsPass::AddBakeCloudTexturesPass(RenderGraph& rg)
+	{
+		struct BakeCloudTexturesPassData
+		{
+			RGTextureCopySrcId shape;
+			RGTextureCopySrcId detail;
+			RGTextureCopySrcId type;
+		};
+		rg.AddPass<BakeCloudTexturesPassData>("Bake Cloud Textures Pass",
+			[=](BakeCloudTexturesPassData& data, RenderGraphBuilder& builder)
+			{
+				data.shape = builder.ReadCopySrcTexture(RG_NAME(CloudShape));
+				data.detail = builder.ReadCopySrcTexture(RG_NAME(CloudDetail));
+				data.type = builder.ReadCopySrcTexture(RG_NAME(CloudType));
+			},
+			[=, hash = cloud_noise_hash](BakeCloudTexturesPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				SaveProceduralTexture(gfx, cmd_list, ctx.GetCopySrcTexture(data.shape), "CloudShape", hash);
+				SaveProceduralTexture(gfx, cmd_list, ctx.GetCopySrcTexture(data.detail), "CloudDetail", hash);
+				SaveProceduralTexture(gfx, cmd_list, ctx.GetCopySrcTexture(data.type), "CloudType", hash);
+			}, RGPassType::Copy, RGPassFlags::ForceNoCull);
 	}
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "PostEffect.h"
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
+#include "Graphics/GfxDescriptor.h"
 
 namespace adria
 {
@@ -40,6 +41,11 @@ namespace adria
 			Float henyey_greenstein_g_backward = 0.179f;
 		};
 
+		//top down transmittance of the cloud layer around the camera, the lighting passes sample it instead of marching the clouds
+		static constexpr Uint32 CLOUD_SHADOW_DIM = 512;
+		static constexpr Float CLOUD_SHADOW_EXTENT = 8000.0f;
+		static constexpr Uint32 CLOUD_SHADOW_CELLS = 8;
+
 		enum CloudResolution
 		{
 			CloudResolution_Full  = 0,
@@ -59,6 +65,10 @@ namespace adria
 
 		void OnRainEvent(Bool enabled);
 
+		Int32 GetCloudShadowMapIndex() const;
+		//xy is the world space center of the map, z one over its size and w the height of the cloud layer
+		Vector4 GetCloudShadowParams() const;
+
 	private:
 		GfxDevice* gfx;
 		Uint32 width, height;
@@ -67,20 +77,32 @@ namespace adria
 		std::unique_ptr<GfxTexture> cloud_detail_noise;
 		std::unique_ptr<GfxTexture> cloud_shape_noise;
 		std::unique_ptr<GfxTexture> cloud_type;
+		std::unique_ptr<GfxTexture> cloud_shadow_map;
+		GfxDescriptor cloud_shadow_map_srv;
+		Vector2 cloud_shadow_center;
+		Uint32 cloud_shadow_slice = 0;
+		Bool cloud_shadow_valid = false;
 
 		CloudParameters params{};
 		CloudResolution resolution = CloudResolution_Full;
 		Bool should_generate_textures = false;
+		Bool cloud_textures_baked = false;
+		Uint64 cloud_noise_hash = 0;
 		Bool temporal_reprojection = true;
 		std::unique_ptr<GfxComputePipelineStatePermutations> clouds_psos;
 		std::unique_ptr<GfxComputePipelineState> clouds_type_pso;
 		std::unique_ptr<GfxComputePipelineState> clouds_shape_pso;
 		std::unique_ptr<GfxComputePipelineState> clouds_detail_pso;
+		std::unique_ptr<GfxComputePipelineState> clouds_reconstruct_pso;
+		std::unique_ptr<GfxComputePipelineState> cloud_shadow_pso;
 		std::unique_ptr<GfxGraphicsPipelineState> clouds_combine_pso;
 
 	private:
 		void CreatePSOs();
 		void CreateCloudTextures(GfxDevice* gfx = nullptr);
+		void AddBakeCloudTexturesPass(RenderGraph& rg);
+		void AddCloudShadowPass(RenderGraph& rendergraph);
+		void AddReconstructPass(RenderGraph& rendergraph, Uint32 update_index);
 		void AddCombinePass(RenderGraph& rendergraph, RGResourceName render_target);
 
 	};
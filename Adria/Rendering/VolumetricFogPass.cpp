@@ -2,12 +2,16 @@
 #include "BlackboardData.h"
 #include "ShaderManager.h" 
 #include "Components.h"
+#include "ExponentialHeightFogPass.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxPipelineState.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
 #include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
+#include "Math/Packing.h"
+#include "Math/Halton.h"
 
 namespace adria
 {
@@ -15,6 +19,13 @@ namespace adria
 	static constexpr Uint32 VOXEL_TEXEL_SIZE_Y = 8;
 	static constexpr Uint32 VOXEL_GRID_SIZE_Z  = 128;
 
+	static TAutoConsoleVariable<Bool>  HeightFogInjection("r.VolumetricFog.HeightFog", true, "Inject exponential height fog into the froxel volume instead of applying it as a post effect");
+	static TAutoConsoleVariable<Bool>  TemporalReprojection("r.VolumetricFog.TemporalReprojection", true, "Reproject and blend the previous frame's froxel lighting");
+	static TAutoConsoleVariable<Float> TemporalHistoryWeight("r.VolumetricFog.TemporalHistoryWeight", 0.9f, "Weight of the reprojected froxel history");
+	static TAutoConsoleVariable<Bool>  JitterSlices("r.VolumetricFog.JitterSlices", true, "Jitter the froxel depth slices every frame");
+
+	static constexpr HaltonSequence<16, 2> slice_jitter_sequence;
+
 	VolumetricFogPass::VolumetricFogPass(GfxDevice* gfx, entt::registry& reg, Uint32 w, Uint32 h) : gfx(gfx), reg(reg), width(w), height(h)
 	{
 		CreatePSOs();
@@ -56,6 +67,11 @@ namespace adria
 		CreateFogVolumeBuffer();
 	}
 
+	Bool VolumetricFogPass::IsHeightFogInjectionEnabled() const
+	{
+		return HeightFogInjection.Get();
+	}
+
 	void VolumetricFogPass::GUI()
 	{
 		QueueGUI([&]()
@@ -72,6 +88,11 @@ namespace adria
 					update_fog_volume_buffer |= ImGui::ColorEdit3("Fog Color", (Float*)&fog_color);
 					fog_volume.color = Color(fog_color);
 
+					ImGui::Checkbox("Inject Height Fog", HeightFogInjection.GetPtr());
+					ImGui::Checkbox("Jitter Slices", JitterSlices.GetPtr());
+					ImGui::Checkbox("Temporal Reprojection", TemporalReprojection.GetPtr());
+					if (TemporalReprojection.Get()) ImGui::SliderFloat("History Weight", TemporalHistoryWeight.GetPtr(), 0.0f, 0.98f);
+
 					if (update_fog_volume_buffer)
 					{
 						CreateFogVolumeBuffer();
@@ -88,11 +109,84 @@ namespace adria
 		gfx->CopyDescriptors(1, fog_volume_buffer_srv_gpu, fog_volume_buffer_srv);
 		fog_volume_buffer_idx = fog_volume_buffer_srv_gpu.GetIndex();
 
+		AddDensityInjectionPass(rg);
 		AddLightInjectionPass(rg);
 		AddScatteringIntegrationPass(rg);
 		AddCombineFogPass(rg);
 	}
 
+	void VolumetricFogPass::AddDensityInjectionPass(RenderGraph& rg)
+	{
+		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+
+		struct DensityInjectionPassData
+		{
+			RGTextureReadWriteId density_target;
+		};
+
+		rg.AddPass<DensityInjectionPassData>("Volumetric Fog Density Injection Pass",
+			[=](DensityInjectionPassData& data, RenderGraphBuilder& builder)
+			{
+				RGTextureDesc density_target_desc{};
+				density_target_desc.type = GfxTextureType_3D;
+				density_target_desc.width = DivideAndRoundUp(width, VOXEL_TEXEL_SIZE_X);
+				density_target_desc.height = DivideAndRoundUp(height, VOXEL_TEXEL_SIZE_Y);
+				density_target_desc.depth = VOXEL_GRID_SIZE_Z;
+				density_target_desc.format = GfxFormat::R16G16B16A16_FLOAT;
+				builder.DeclareTexture(RG_NAME(FogDensityTarget), density_target_desc);
+
+				data.density_target = builder.WriteTexture(RG_NAME(FogDensityTarget));
+			},
+			[=](DensityInjectionPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
+			{
+				GfxDevice* gfx = cmd_list->GetDevice();
+
+				GfxDescriptor dst_descriptor = gfx->AllocateDescriptorsGPU();
+				gfx->CopyDescriptors(1, dst_descriptor, ctx.GetReadWriteTexture(data.density_target));
+
+				ExponentialHeightFogParameters height_fog = height_fog_params ? *height_fog_params : ExponentialHeightFogParameters{};
+				struct DensityInjectionConstants
+				{
+					Vector3u voxel_grid_dimensions;
+					Uint32   fog_volumes_count;
+
+					Uint32   fog_volume_buffer_idx;
+					Uint32   density_target_idx;
+					Float    slice_jitter;
+					Bool32   height_fog_enabled;
+
+					Float    height_fog_falloff;
+					Float    height_fog_density;
+					Float    height_fog_height;
+					Float    height_fog_start;
+
+					Float    height_fog_cutoff_distance;
+					Uint32   height_fog_color;
+				} constants =
+				{
+					.voxel_grid_dimensions = Vector3u(light_injection_target_history->GetWidth(), light_injection_target_history->GetHeight(), light_injection_target_history->GetDepth()),
+					.fog_volumes_count = fog_volume_buffer->GetCount(),
+					.fog_volume_buffer_idx = fog_volume_buffer_idx,
+					.density_target_idx = dst_descriptor.GetIndex(),
+					.slice_jitter = JitterSlices.Get() ? slice_jitter_sequence[gfx->GetFrameIndex()] - 0.5f : 0.0f,
+					.height_fog_enabled = height_fog_params != nullptr,
+					.height_fog_falloff = height_fog.fog_falloff / 1000.0f,
+					.height_fog_density = height_fog.fog_density / 1000.0f,
+					.height_fog_height = height_fog.fog_height,
+					.height_fog_start = height_fog.fog_start,
+					.height_fog_cutoff_distance = height_fog.fog_cutoff_distance,
+					.height_fog_color = PackToUint(height_fog.fog_color)
+				};
+
+				cmd_list->SetPipelineState(density_injection_pso.get());
+				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+				cmd_list->SetRootCBV(2, constants);
+				cmd_list->Dispatch(DivideAndRoundUp(light_injection_target_history->GetWidth(), 8),
+								   DivideAndRoundUp(light_injection_target_history->GetHeight(), 8),
+								   DivideAndRoundUp(light_injection_target_history->GetDepth(), 8));
+			}, RGPassType::Compute, RGPassFlags::None);
+	}
+
 	void VolumetricFogPass::AddLightInjectionPass(RenderGraph& rg)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
@@ -103,7 +197,7 @@ namespace adria
 		{
 			RGTextureReadWriteId light_injection_target;
 			RGTextureReadOnlyId  light_injection_target_history;
-			RGBufferReadOnlyId   fog_volume_buffer;
+			RGTextureReadOnlyId  density_target;
 		};
 
 		rg.AddPass<LightInjectionPassData>("Volumetric Fog Light Injection Pass",
@@ -122,36 +216,42 @@ namespace adria
 
 				data.light_injection_target = builder.WriteTexture(RG_NAME(FogLightInjectionTarget));
 				data.light_injection_target_history = builder.ReadTexture(RG_NAME(FogLightInjectionTargetHistory));
+				data.density_target = builder.ReadTexture(RG_NAME(FogDensityTarget));
 			},
 			[=](LightInjectionPassData const& data, RenderGraphContext& ctx, GfxCommandList* cmd_list)
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 				
-				Uint32 i = gfx->AllocateDescriptorsGPU(2).GetIndex();
+				Uint32 i = gfx->AllocateDescriptorsGPU(3).GetIndex();
 				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 0), ctx.GetReadWriteTexture(data.light_injection_target));
 				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 1), ctx.GetReadOnlyTexture(data.light_injection_target_history));
+				gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(i + 2), ctx.GetReadOnlyTexture(data.density_target));
 				
 				struct LightInjectionConstants
 				{
 					Vector3u voxel_grid_dimensions;
-					Uint32 fog_volumes_count;
-					Uint32 fog_volume_buffer_idx;
+					Uint32 density_target_idx;
+
 					Uint32 light_injection_target_idx;
 					Uint32 light_injection_target_history_idx;
 					Uint32 blue_noise_idx;
+					Float  slice_jitter;
+
+					Float  history_weight;
 				} constants =
 				{
 					.voxel_grid_dimensions = Vector3u(light_injection_target_history->GetWidth(), light_injection_target_history->GetHeight(), light_injection_target_history->GetDepth()),
-					.fog_volumes_count = fog_volume_buffer->GetCount(),
-					.fog_volume_buffer_idx = fog_volume_buffer_idx,
+					.density_target_idx = i + 2,
 					.light_injection_target_idx = i,
 					.light_injection_target_history_idx = i + 1,
-					.blue_noise_idx = (Uint32)blue_noise_handles[gfx->GetFrameIndex() % BLUE_NOISE_TEXTURE_COUNT]
+					.blue_noise_idx = GetTextureIndex(blue_noise_handles[gfx->GetFrameIndex() % BLUE_NOISE_TEXTURE_COUNT]),
+					.slice_jitter = JitterSlices.Get() ? slice_jitter_sequence[gfx->GetFrameIndex()] - 0.5f : 0.0f,
+					.history_weight = TemporalReprojection.Get() ? TemporalHistoryWeight.Get() : 0.0f
 				};
 				
 				cmd_list->SetPipelineState(light_injection_pso.get());
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				cmd_list->SetRootConstants(1, constants);
+				cmd_list->SetRootCBV(2, constants);
 				cmd_list->Dispatch(DivideAndRoundUp(light_injection_target_history->GetWidth(), 8), 
 								   DivideAndRoundUp(light_injection_target_history->GetHeight(), 8),
 								   DivideAndRoundUp(light_injection_target_history->GetDepth(), 8));
@@ -270,6 +370,9 @@ namespace adria
 		combine_fog_pso = gfx->CreateGraphicsPipelineState(gfx_pso_desc);
 
 		GfxComputePipelineStateDesc compute_pso_desc{};
+		compute_pso_desc.CS = CS_VolumetricFog_DensityInjection;
+		density_injection_pso = gfx->CreateComputePipelineState(compute_pso_desc);
+
 		compute_pso_desc.CS = CS_VolumetricFog_LightInjection;
 		light_injection_pso = gfx->CreateComputePipelineState(compute_pso_desc);
 
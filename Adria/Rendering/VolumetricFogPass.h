@@ -12,6 +12,7 @@ namespace adria
 	class GfxBuffer;
 	class GfxComputePipelineState;
 	class GfxGraphicsPipelineState;
+	struct ExponentialHeightFogParameters;
 
 	class VolumetricFogPass
 	{
@@ -43,6 +44,12 @@ namespace adria
 		void OnSceneInitialized();
 		void GUI();
 
+		Bool IsHeightFogInjectionEnabled() const;
+		void SetHeightFogParameters(ExponentialHeightFogParameters const* _height_fog_params)
+		{
+			height_fog_params = _height_fog_params;
+		}
+
 	private:
 		GfxDevice* gfx;
 		entt::registry& reg;
@@ -55,8 +62,10 @@ namespace adria
 		std::unique_ptr<GfxBuffer> fog_volume_buffer;
 		GfxDescriptor fog_volume_buffer_srv;
 		Uint32 fog_volume_buffer_idx;
+		ExponentialHeightFogParameters const* height_fog_params = nullptr;
 
 		std::array<TextureHandle, BLUE_NOISE_TEXTURE_COUNT> blue_noise_handles;
+		std::unique_ptr<GfxComputePipelineState>  density_injection_pso;
 		std::unique_ptr<GfxComputePipelineState>  light_injection_pso;
 		std::unique_ptr<GfxComputePipelineState>  scattering_integration_pso;
 		std::unique_ptr<GfxGraphicsPipelineState> combine_fog_pso;
@@ -66,6 +75,7 @@ namespace adria
 		void CreateLightInjectionHistoryTexture();
 		void CreateFogVolumeBuffer();
 
+		void AddDensityInjectionPass(RenderGraph& rendergraph);
 		void AddLightInjectionPass(RenderGraph& rendergraph);
 		void AddScatteringIntegrationPass(RenderGraph& rendergraph);
 		void AddCombineFogPass(RenderGraph& rendergraph);
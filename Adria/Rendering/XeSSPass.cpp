@@ -110,11 +110,11 @@ namespace adria
 				execute_params.jitterOffsetY = frame_data.camera_jitter_y;
 				execute_params.exposureScale = 1.0f;
 				execute_params.resetHistory = false;
-				execute_params.inputWidth = render_width;
-				execute_params.inputHeight = render_height;
+				execute_params.inputWidth = GetDynamicRenderWidth();
+				execute_params.inputHeight = GetDynamicRenderHeight();
 
 				xessSetJitterScale(context, 1.0f, 1.0f);
-				xessSetVelocityScale(context, (Float)render_width, (Float)render_height);
+				xessSetVelocityScale(context, (Float)GetDynamicRenderWidth(), (Float)GetDynamicRenderHeight());
 
 				xess_result_t result = xessD3D12Execute(context, cmd_list->GetNative(), &execute_params);
 				ADRIA_ASSERT(result == XESS_RESULT_SUCCESS);
@@ -0,0 +1,133 @@
+#include <filesystem>
+#include "FileWatcher.h"
+#include "StringUtil.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	FileWatcher::FileWatcher()
+	{
+		completion_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+		if (!completion_port)
+		{
+			ADRIA_LOG(WARNING, "Failed to create file watcher completion port, file changes won't be detected!");
+			return;
+		}
+		watch_thread = std::thread(&FileWatcher::WatchThread, this);
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		file_modified_event.RemoveAll();
+		if (!completion_port) return;
+
+		PostQueuedCompletionStatus(completion_port, 0, 0, nullptr);
+		if (watch_thread.joinable()) watch_thread.join();
+		for (auto& directory : directories)
+		{
+			DWORD bytes = 0;
+			CancelIoEx(directory->handle, &directory->overlapped);
+			GetOverlappedResult(directory->handle, &directory->overlapped, &bytes, TRUE);
+			CloseHandle(directory->handle);
+		}
+		directories.clear();
+		CloseHandle(completion_port);
+	}
+
+	void FileWatcher::AddPathToWatch(std::string const& path, Bool recursive)
+	{
+		if (!completion_port) return;
+
+		std::unique_ptr<WatchedDirectory> directory = std::make_unique<WatchedDirectory>();
+		directory->path = path;
+		directory->recursive = recursive;
+		directory->handle = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (directory->handle == INVALID_HANDLE_VALUE)
+		{
+			ADRIA_LOG(WARNING, "Failed to open directory %s for watching!", path.c_str());
+			return;
+		}
+		if (!CreateIoCompletionPort(directory->handle, completion_port, reinterpret_cast<ULONG_PTR>(directory.get()), 0) || !IssueRead(*directory))
+		{
+			ADRIA_LOG(WARNING, "Failed to start watching directory %s!", path.c_str());
+			CloseHandle(directory->handle);
+			return;
+		}
+		directories.push_back(std::move(directory));
+	}
+
+	void FileWatcher::CheckWatchedFiles()
+	{
+		std::vector<std::string> changed_files;
+		{
+			std::lock_guard lock(changes_mutex);
+			if (pending_changes.empty()) return;
+
+			auto const now = std::chrono::steady_clock::now();
+			for (auto it = pending_changes.begin(); it != pending_changes.end();)
+			{
+				if (now - it->second >= DEBOUNCE_INTERVAL)
+				{
+					changed_files.push_back(it->first);
+					it = pending_changes.erase(it);
+				}
+				else ++it;
+			}
+		}
+		for (std::string const& file : changed_files) file_modified_event.Broadcast(file);
+	}
+
+	void FileWatcher::WatchThread()
+	{
+		while (true)
+		{
+			DWORD bytes = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+			BOOL const result = GetQueuedCompletionStatus(completion_port, &bytes, &key, &overlapped, INFINITE);
+			if (key == 0) break;
+
+			WatchedDirectory& directory = *reinterpret_cast<WatchedDirectory*>(key);
+			if (!result)
+			{
+				if (GetLastError() == ERROR_OPERATION_ABORTED) continue;
+			}
+			else if (bytes == 0)
+			{
+				ADRIA_LOG(WARNING, "File watcher notification buffer overflowed for %s, some changes may be missed", directory.path.c_str());
+			}
+			else
+			{
+				ProcessNotifications(directory, bytes);
+			}
+			IssueRead(directory);
+		}
+	}
+
+	Bool FileWatcher::IssueRead(WatchedDirectory& directory)
+	{
+		directory.overlapped = {};
+		DWORD const filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+		return ReadDirectoryChangesW(directory.handle, directory.buffer, NOTIFY_BUFFER_SIZE, directory.recursive, filter, nullptr, &directory.overlapped, nullptr);
+	}
+
+	void FileWatcher::ProcessNotifications(WatchedDirectory& directory, Uint32 size)
+	{
+		auto const now = std::chrono::steady_clock::now();
+		std::lock_guard lock(changes_mutex);
+		Uint32 offset = 0;
+		while (offset < size)
+		{
+			FILE_NOTIFY_INFORMATION const* info = reinterpret_cast<FILE_NOTIFY_INFORMATION const*>(directory.buffer + offset);
+			if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+			{
+				std::wstring const filename(info->FileName, info->FileNameLength / sizeof(WCHAR));
+				std::string const file = (std::filesystem::path(directory.path) / ToString(filename)).string();
+				pending_changes[file] = now;
+			}
+			if (info->NextEntryOffset == 0) break;
+			offset += info->NextEntryOffset;
+		}
+	}
+}
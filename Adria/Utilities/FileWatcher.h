@@ -1,5 +1,8 @@
 #pragma once
-#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include "Utilities/Delegate.h"
 
 namespace adria
@@ -15,47 +18,40 @@ namespace adria
 
 	class FileWatcher
 	{
-	public:
-		FileWatcher() = default;
-		~FileWatcher()
-		{
-			file_modified_event.RemoveAll();
-		}
+		static constexpr Uint32 NOTIFY_BUFFER_SIZE = 64 * 1024;
+		static constexpr std::chrono::milliseconds DEBOUNCE_INTERVAL{ 100 };
 
-		void AddPathToWatch(std::string const& path, Bool recursive = true)
-		{
-			if (recursive)
-			{
-				for (auto& path : std::filesystem::recursive_directory_iterator(path))
-				{
-					if (path.is_regular_file()) files_map[path.path().string()] = std::filesystem::last_write_time(path);
-				}
-			}
-			else
-			{
-				for (auto& path : std::filesystem::directory_iterator(path))
-				{
-					if (path.is_regular_file()) files_map[path.path().string()] = std::filesystem::last_write_time(path);
-				}
-			}
-		}
-		void CheckWatchedFiles()
+		struct WatchedDirectory
 		{
-			for (auto const& [file, ft] : files_map)
-			{
-				auto current_file_last_write_time = std::filesystem::last_write_time(file);
-				if (files_map[file] != current_file_last_write_time)
-				{
-					files_map[file] = current_file_last_write_time;
-					file_modified_event.Broadcast(file);
-				}
-			}
-		}
+			HANDLE handle = INVALID_HANDLE_VALUE;
+			OVERLAPPED overlapped{};
+			std::string path;
+			Bool recursive = true;
+			alignas(DWORD) Uint8 buffer[NOTIFY_BUFFER_SIZE];
+		};
+
+	public:
+		FileWatcher();
+		ADRIA_NONCOPYABLE_NONMOVABLE(FileWatcher)
+		~FileWatcher();
+
+		void AddPathToWatch(std::string const& path, Bool recursive = true);
+		void CheckWatchedFiles();
 
 		FileModifiedEvent& GetFileModifiedEvent() { return file_modified_event; }
 
 	private:
-		std::unordered_map<std::string, std::filesystem::file_time_type> files_map;
+		std::vector<std::unique_ptr<WatchedDirectory>> directories;
+		HANDLE completion_port = nullptr;
+		std::thread watch_thread;
+
+		std::mutex changes_mutex;
+		std::unordered_map<std::string, std::chrono::steady_clock::time_point> pending_changes;
 		FileModifiedEvent file_modified_event;
+
+	private:
+		void WatchThread();
+		Bool IssueRead(WatchedDirectory& directory);
+		void ProcessNotifications(WatchedDirectory& directory, Uint32 size);
 	};
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "Heightmap.h"
+#include "Image.h"
 #include "Cpp/FastNoiseLite.h"
 
 namespace adria
@@ -72,15 +73,28 @@ namespace adria
 	}
 	Heightmap::Heightmap(std::string_view heightmap_path)
 	{
-		//todo
+		//heights are normalized to [0, 1] from the red channel
+		Image image(heightmap_path);
+		if (image.Format() != GfxFormat::R8G8B8A8_UNORM && image.Format() != GfxFormat::R32G32B32A32_FLOAT) return;
+
+		heightmap.resize(image.Height());
+		for (Uint32 z = 0; z < image.Height(); z++)
+		{
+			heightmap[z].resize(image.Width());
+			for (Uint32 x = 0; x < image.Width(); x++)
+			{
+				Uint64 const texel = (Uint64)z * image.Width() + x;
+				heightmap[z][x] = image.Format() == GfxFormat::R32G32B32A32_FLOAT ? image.Data<Float>()[texel * 4] : image.Data<Uint8>()[texel * 4] / 255.0f;
+			}
+		}
 	}
-	Float Heightmap::HeightAt(Uint64 x, Uint64 z)
+	Float Heightmap::HeightAt(Uint64 x, Uint64 z) const
 	{
 		return heightmap[z][x];
 	}
 	Uint64 Heightmap::Width() const
 	{
-		return heightmap[0].size();
+		return heightmap.empty() ? 0 : heightmap[0].size();
 	}
 	Uint64 Heightmap::Depth() const
 	{
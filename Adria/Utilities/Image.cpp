@@ -1,8 +1,11 @@
+#include <intrin.h>
+#include <tmmintrin.h>
 #include "Image.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include "Logging/Logger.h"
 #include "Utilities/FilesUtil.h"
+#include "Utilities/MappedFile.h"
 #include "Utilities/StringUtil.h"
 
 namespace adria
@@ -50,6 +53,41 @@ namespace adria
 		{
 			return GetImageFormat(ToString(std::wstring(path)));
 		}
+
+		Bool SupportsSSSE3()
+		{
+			static Bool const supported = []()
+				{
+					Int32 cpu_info[4] = {};
+					__cpuid(cpu_info, 1);
+					return (cpu_info[2] & (1 << 9)) != 0;
+				}();
+			return supported;
+		}
+
+		//stb expands rgb to rgba one channel at a time, here 4 pixels are expanded with a single shuffle
+		void ExpandRGBToRGBA(Uint8 const* src, Uint8* dst, Uint64 pixel_count)
+		{
+			Uint64 i = 0;
+			if (SupportsSSSE3())
+			{
+				__m128i const shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+				__m128i const alpha = _mm_set1_epi32(0xff000000);
+				//each load reads 16 bytes for 12 used ones, the last pixels are left to the scalar loop to stay inside the source
+				for (; i + 6 <= pixel_count; i += 4)
+				{
+					__m128i const rgb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 3));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+				}
+			}
+			for (; i < pixel_count; ++i)
+			{
+				dst[i * 4 + 0] = src[i * 3 + 0];
+				dst[i * 4 + 1] = src[i * 3 + 1];
+				dst[i * 4 + 2] = src[i * 3 + 2];
+				dst[i * 4 + 3] = 0xff;
+			}
+		}
 	}
 
 	Image::Image(std::string_view file_path)
@@ -77,33 +115,29 @@ namespace adria
 		ADRIA_ASSERT(result);
 	}
 
-	Uint64 Image::SetData(Uint32 _width, Uint32 _height, Uint32 _depth, Uint32 _mip_levels, void const* _data)
+	Image::~Image() = default;
+
+	Uint64 Image::SetExternalData(std::shared_ptr<void const> const& owner, Uint32 _width, Uint32 _height, Uint32 _depth, Uint32 _mip_levels, Uint8 const* _data)
 	{
 		width = std::max(_width, 1u);
 		height = std::max(_height, 1u);
 		depth = std::max(_depth, 1u);
 		mip_levels = std::max(_mip_levels, 1u);
-		Uint64 texture_byte_size = GetTextureByteSize(format, width, height, depth, mip_levels);
-		pixels.resize(texture_byte_size);
-		memcpy(pixels.data(), _data, pixels.size());
-		return texture_byte_size;
+		pixel_owner = owner;
+		external_pixels = _data;
+		return GetTextureByteSize(format, width, height, depth, mip_levels);
 	}
 
 	Bool Image::LoadDDS(std::string_view texture_path)
 	{
 		//https://github.com/simco50/D3D12_Research/blob/master/D3D12/Content/Image.cpp - LoadDDS
 
-		FILE* file = nullptr;
-		fopen_s(&file, texture_path.data(), "rb");
-		if (!file)
-			return false;
-
-		fseek(file, 0, SEEK_END);
-		std::vector<Char> data((Uint64)ftell(file));
-		fseek(file, 0, SEEK_SET);
-		fread(data.data(), data.size(), 1, file);
+		//mip data is read from the mapping when it's copied into upload memory, so it's never copied to the heap
+		std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+		if (!file->Open(texture_path)) return false;
 
-		Char* bytes = data.data();
+		Uint8 const* bytes = file->Data();
+		Uint8 const* const bytes_end = bytes + file->Size();
 #pragma pack(push,1)
 		struct PixelFormatHeader
 		{
@@ -163,7 +197,7 @@ namespace adria
 		auto MakeFourCC = [](Uint32 a, Uint32 b, Uint32 c, Uint32 d) { return a | (b << 8u) | (c << 16u) | (d << 24u); };
 
 		constexpr const Char magic[] = "DDS ";
-		if (memcmp(magic, bytes, 4) != 0) return false;
+		if (file->Size() < 4 + sizeof(FileHeader) || memcmp(magic, bytes, 4) != 0) return false;
 		bytes += 4;
 
 		const FileHeader* dds_header = (FileHeader*)bytes;
@@ -181,6 +215,7 @@ namespace adria
 
 			if (has_dxgi)
 			{
+				if (bytes + sizeof(DX10FileHeader) > bytes_end) return false;
 				pDx10Header = (DX10FileHeader*)bytes;
 				bytes += sizeof(DX10FileHeader);
 
@@ -248,7 +283,8 @@ namespace adria
 			Image* current_image = this;
 			for (Uint32 image_idx = 0; image_idx < image_chain_count; ++image_idx)
 			{
-				Uint64 offset = current_image->SetData(dds_header->dwWidth, dds_header->dwHeight, dds_header->dwDepth, dds_header->dwMipMapCount, bytes);
+				Uint64 offset = current_image->SetExternalData(file, dds_header->dwWidth, dds_header->dwHeight, dds_header->dwDepth, dds_header->dwMipMapCount, bytes);
+				if (offset > (Uint64)(bytes_end - bytes)) return false;
 				bytes += offset;
 				if (image_idx < image_chain_count - 1)
 				{
@@ -263,37 +299,43 @@ namespace adria
 
 	Bool Image::LoadSTB(std::string_view texture_path)
 	{
-		Int32 components = 0;
-		is_hdr = stbi_is_hdr(texture_path.data());
+		//decoding from the mapping avoids stdio reads and opening the file again for the hdr check
+		MappedFile file;
+		if (!file.Open(texture_path) || file.Size() > (Uint64)INT32_MAX) return false;
+		stbi_uc const* file_data = file.Data();
+		Int32 const file_size = (Int32)file.Size();
+
+		Int32 _width = 0, _height = 0, components = 0;
+		if (!stbi_info_from_memory(file_data, file_size, &_width, &_height, &components)) return false;
+		is_hdr = stbi_is_hdr_from_memory(file_data, file_size);
 		if (is_hdr)
 		{
-			Int32 _width, _height;
-			Float* _pixels = stbi_loadf(texture_path.data(), &_width, &_height, &components, 4);
+			Float* _pixels = stbi_loadf_from_memory(file_data, file_size, &_width, &_height, &components, 4);
 			if (_pixels == nullptr) return false;
-			width = (Uint32)_width;
-			height = (Uint32)_height;
-			depth = 1;
-			mip_levels = 1;
 			format = GfxFormat::R32G32B32A32_FLOAT;
-			pixels.resize(width * height * 4 * sizeof(Float));
-			memcpy(pixels.data(), _pixels, pixels.size());
-			stbi_image_free(_pixels);
+			SetExternalData(std::shared_ptr<void const>(_pixels, stbi_image_free), _width, _height, 1, 1, reinterpret_cast<Uint8 const*>(_pixels));
 			return true;
 		}
-		else
+
+		format = GfxFormat::R8G8B8A8_UNORM;
+		if (components == 3)
 		{
-			Int _width, _height;
-			stbi_uc* _pixels = stbi_load(texture_path.data(), &_width, &_height, &components, 4);
+			stbi_uc* _pixels = stbi_load_from_memory(file_data, file_size, &_width, &_height, &components, 3);
 			if (_pixels == nullptr) return false;
 			width = (Uint32)_width;
 			height = (Uint32)_height;
 			depth = 1;
 			mip_levels = 1;
-			format = GfxFormat::R8G8B8A8_UNORM;
-			pixels.resize(width * height * 4);
-			memcpy(pixels.data(), _pixels, pixels.size());
+			pixels.resize((Uint64)width * height * 4);
+			ExpandRGBToRGBA(_pixels, pixels.data(), (Uint64)width * height);
 			stbi_image_free(_pixels);
 			return true;
 		}
+
+		//the decoded rgba buffer is kept as is instead of being copied into the pixel vector
+		stbi_uc* _pixels = stbi_load_from_memory(file_data, file_size, &_width, &_height, &components, 4);
+		if (_pixels == nullptr) return false;
+		SetExternalData(std::shared_ptr<void const>(_pixels, stbi_image_free), _width, _height, 1, 1, _pixels);
+		return true;
 	}
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace adria
 	public:
 		explicit Image(GfxFormat format) : format(format) {}
 		explicit Image(std::string_view file_path);
+		~Image();
 
 		Uint32 Width() const
 		{
@@ -44,6 +45,9 @@ namespace adria
 		Uint32 depth = 0;
 		Uint32 mip_levels = 0;
 		std::vector<Uint8> pixels;
+		//dds images point straight into the mapped file shared by all images of the chain, stb images into the decoder's buffer
+		std::shared_ptr<void const> pixel_owner;
+		Uint8 const* external_pixels = nullptr;
 		Bool is_hdr = false;
 		Bool is_cubemap = false;
 		Bool is_srgb = false;
@@ -51,7 +55,8 @@ namespace adria
 		std::unique_ptr<Image> next_image = nullptr;
 
 	private:
-		Uint64 SetData(Uint32 width, Uint32 height, Uint32 depth, Uint32 mip_levels, void const* data);
+		Uint64 SetExternalData(std::shared_ptr<void const> const& owner, Uint32 width, Uint32 height, Uint32 depth, Uint32 mip_levels, Uint8 const* data);
+		Uint8 const* GetPixels() const { return external_pixels ? external_pixels : pixels.data(); }
 
 		Bool LoadDDS(std::string_view texture_path);
 		Bool LoadSTB(std::string_view texture_path);
@@ -60,7 +65,7 @@ namespace adria
 	template<typename T>
 	T const* Image::Data() const
 	{
-		return reinterpret_cast<T const*>(pixels.data());
+		return reinterpret_cast<T const*>(GetPixels());
 	}
 
 	template<typename T>
@@ -71,6 +76,6 @@ namespace adria
 		{
 			offset += GetTextureMipByteSize(format, width, height, depth, mip);
 		}
-		return reinterpret_cast<T const*>(pixels.data() + offset);
+		return reinterpret_cast<T const*>(GetPixels() + offset);
 	}
 }
\ No newline at end of file
@@ -1,9 +1,343 @@
+#include <DirectXPackedVector.h>
+#include "JobSystem.h"
+
+namespace adria
+{
+	unsigned char* ParallelZlibCompress(unsigned char* data, int data_len, int* out_len, int quality);
+}
+#define STBIW_ZLIB_COMPRESS adria::ParallelZlibCompress
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 #include "ImageWrite.h"
 
 namespace adria
 {
+	namespace
+	{
+		//fixed huffman deflate with a hash chain matcher, every chunk is compressed independently
+		//and ends with an empty stored block so the chunks can be concatenated into one stream
+		class DeflateChunkWriter
+		{
+			static constexpr Uint32 HASH_BITS = 15;
+			static constexpr Int32 WINDOW_SIZE = 32767;
+			static constexpr Uint32 MIN_MATCH = 3;
+			static constexpr Uint32 MAX_MATCH = 258;
+
+		public:
+			void Compress(Uint8 const* data, Uint32 size, Bool last, Uint32 max_chain)
+			{
+				static constexpr Uint16 length_base[] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258,259 };
+				static constexpr Uint8  length_bits[] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+				static constexpr Uint16 dist_base[] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,32768 };
+				static constexpr Uint8  dist_bits[] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+				std::vector<Int32> head(1u << HASH_BITS, -1);
+				std::vector<Int32> prev(size);
+				auto Insert = [&](Uint32 i)
+					{
+						if (i + MIN_MATCH > size) return;
+						Uint32 const h = Hash(data + i);
+						prev[i] = head[h];
+						head[h] = (Int32)i;
+					};
+
+				AddBits(last ? 1 : 0, 1);
+				AddBits(1, 2);
+				for (Uint32 i = 0; i < size;)
+				{
+					Uint32 best_length = 0, best_distance = 0;
+					if (i + MIN_MATCH <= size)
+					{
+						Uint32 const max_length = std::min(MAX_MATCH, size - i);
+						Uint32 chain = max_chain;
+						for (Int32 j = head[Hash(data + i)]; j >= 0 && (Int32)i - j <= WINDOW_SIZE && chain-- > 0; j = prev[j])
+						{
+							Uint32 length = 0;
+							while (length < max_length && data[j + length] == data[i + length]) ++length;
+							if (length > best_length)
+							{
+								best_length = length;
+								best_distance = i - j;
+								if (length == max_length) break;
+							}
+						}
+					}
+
+					if (best_length >= MIN_MATCH)
+					{
+						Uint32 code = 0;
+						while (best_length > length_base[code + 1] - 1u) ++code;
+						AddHuffman(code + 257);
+						if (length_bits[code]) AddBits(best_length - length_base[code], length_bits[code]);
+
+						code = 0;
+						while (best_distance > dist_base[code + 1] - 1u) ++code;
+						AddBits(ReverseBits(code, 5), 5);
+						if (dist_bits[code]) AddBits(best_distance - dist_base[code], dist_bits[code]);
+
+						for (Uint32 k = 0; k < best_length; ++k) Insert(i + k);
+						i += best_length;
+					}
+					else
+					{
+						AddHuffman(data[i]);
+						Insert(i);
+						++i;
+					}
+				}
+				AddHuffman(256);
+
+				if (!last)
+				{
+					AddBits(0, 3);
+					FlushBits();
+					bytes.insert(bytes.end(), { 0x00, 0x00, 0xFF, 0xFF });
+				}
+				else FlushBits();
+			}
+
+			std::vector<Uint8> const& GetBytes() const { return bytes; }
+
+		private:
+			std::vector<Uint8> bytes;
+			Uint32 bit_buffer = 0;
+			Uint32 bit_count = 0;
+
+		private:
+			static Uint32 Hash(Uint8 const* p)
+			{
+				Uint32 const v = Uint32(p[0]) | (Uint32(p[1]) << 8) | (Uint32(p[2]) << 16);
+				return (v * 2654435761u) >> (32 - HASH_BITS);
+			}
+			static Uint32 ReverseBits(Uint32 code, Uint32 length)
+			{
+				Uint32 result = 0;
+				for (Uint32 i = 0; i < length; ++i, code >>= 1) result = (result << 1) | (code & 1);
+				return result;
+			}
+
+			void AddBits(Uint32 value, Uint32 count)
+			{
+				bit_buffer |= value << bit_count;
+				bit_count += count;
+				while (bit_count >= 8)
+				{
+					bytes.push_back(Uint8(bit_buffer));
+					bit_buffer >>= 8;
+					bit_count -= 8;
+				}
+			}
+			void AddHuffman(Uint32 symbol)
+			{
+				if (symbol <= 143)		AddBits(ReverseBits(0x30 + symbol, 8), 8);
+				else if (symbol <= 255) AddBits(ReverseBits(0x190 + symbol - 144, 9), 9);
+				else if (symbol <= 279) AddBits(ReverseBits(symbol - 256, 7), 7);
+				else					AddBits(ReverseBits(0xC0 + symbol - 280, 8), 8);
+			}
+			void FlushBits()
+			{
+				if (bit_count > 0) AddBits(0, 8 - bit_count);
+			}
+		};
+
+		void WriteQOI(std::string_view filename, Uint32 width, Uint32 height, Uint8 const* data, Uint32 stride)
+		{
+			struct Pixel
+			{
+				Uint8 r, g, b, a;
+				Bool operator==(Pixel const&) const = default;
+			};
+
+			std::vector<Uint8> output;
+			output.reserve(14 + Uint64(width) * height * 5 + 8);
+			auto WriteUint32 = [&output](Uint32 v) { output.insert(output.end(), { Uint8(v >> 24), Uint8(v >> 16), Uint8(v >> 8), Uint8(v) }); };
+			output.insert(output.end(), { 'q', 'o', 'i', 'f' });
+			WriteUint32(width);
+			WriteUint32(height);
+			output.push_back(4);
+			output.push_back(0);
+
+			Pixel index[64] = {};
+			Pixel prev{ 0, 0, 0, 255 };
+			Uint32 run = 0;
+			Uint64 const pixel_count = Uint64(width) * height;
+			for (Uint64 p = 0; p < pixel_count; ++p)
+			{
+				Uint8 const* src = data + (p / width) * stride + (p % width) * 4;
+				Pixel const px{ src[0], src[1], src[2], src[3] };
+				if (px == prev)
+				{
+					++run;
+					if (run == 62 || p + 1 == pixel_count)
+					{
+						output.push_back(Uint8(0xC0 | (run - 1)));
+						run = 0;
+					}
+					continue;
+				}
+				if (run > 0)
+				{
+					output.push_back(Uint8(0xC0 | (run - 1)));
+					run = 0;
+				}
+
+				Uint32 const hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+				if (index[hash] == px)
+				{
+					output.push_back(Uint8(hash));
+				}
+				else
+				{
+					index[hash] = px;
+					if (px.a == prev.a)
+					{
+						Int8 const dr = Int8(px.r - prev.r);
+						Int8 const dg = Int8(px.g - prev.g);
+						Int8 const db = Int8(px.b - prev.b);
+						Int8 const dr_dg = Int8(dr - dg);
+						Int8 const db_dg = Int8(db - dg);
+						if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+						{
+							output.push_back(Uint8(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+						}
+						else if (dr_dg >= -8 && dr_dg <= 7 && dg >= -32 && dg <= 31 && db_dg >= -8 && db_dg <= 7)
+						{
+							output.push_back(Uint8(0x80 | (dg + 32)));
+							output.push_back(Uint8(((dr_dg + 8) << 4) | (db_dg + 8)));
+						}
+						else output.insert(output.end(), { 0xFE, px.r, px.g, px.b });
+					}
+					else output.insert(output.end(), { 0xFF, px.r, px.g, px.b, px.a });
+				}
+				prev = px;
+			}
+			output.insert(output.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+			std::ofstream file(std::string(filename), std::ios::binary);
+			file.write(reinterpret_cast<Char const*>(output.data()), output.size());
+		}
+
+		//uncompressed scanline exr with half channels, stored in the alphabetical A, B, G, R order the format requires
+		void WriteEXR(std::string_view filename, Uint32 width, Uint32 height, Float const* data, Uint32 stride)
+		{
+			std::vector<Uint8> output;
+			auto Write = [&output](void const* src, Uint64 size) { output.insert(output.end(), static_cast<Uint8 const*>(src), static_cast<Uint8 const*>(src) + size); };
+			auto WriteString = [&](Char const* s) { Write(s, strlen(s) + 1); };
+			auto WriteInt32 = [&](Int32 v) { Write(&v, sizeof(v)); };
+			auto WriteFloat = [&](Float v) { Write(&v, sizeof(v)); };
+			auto WriteAttribute = [&](Char const* name, Char const* type, Int32 size) { WriteString(name); WriteString(type); WriteInt32(size); };
+
+			output.insert(output.end(), { 0x76, 0x2F, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00 });
+			WriteAttribute("channels", "chlist", 4 * 18 + 1);
+			for (Char const* channel : { "A", "B", "G", "R" })
+			{
+				WriteString(channel);
+				WriteInt32(1);
+				output.insert(output.end(), { 0, 0, 0, 0 });
+				WriteInt32(1);
+				WriteInt32(1);
+			}
+			output.push_back(0);
+			WriteAttribute("compression", "compression", 1);
+			output.push_back(0);
+			for (Char const* window : { "dataWindow", "displayWindow" })
+			{
+				WriteAttribute(window, "box2i", 16);
+				WriteInt32(0);
+				WriteInt32(0);
+				WriteInt32((Int32)width - 1);
+				WriteInt32((Int32)height - 1);
+			}
+			WriteAttribute("lineOrder", "lineOrder", 1);
+			output.push_back(0);
+			WriteAttribute("pixelAspectRatio", "float", 4);
+			WriteFloat(1.0f);
+			WriteAttribute("screenWindowCenter", "v2f", 8);
+			WriteFloat(0.0f);
+			WriteFloat(0.0f);
+			WriteAttribute("screenWindowWidth", "float", 4);
+			WriteFloat(1.0f);
+			output.push_back(0);
+
+			Uint64 const line_size = Uint64(width) * 4 * sizeof(Uint16);
+			Uint64 const table_offset = output.size();
+			Uint64 const data_offset = table_offset + Uint64(height) * sizeof(Uint64);
+			output.resize(data_offset + Uint64(height) * (8 + line_size));
+
+			Uint8 const* src_data = reinterpret_cast<Uint8 const*>(data);
+			g_JobSystem.ParallelFor(height, 64, [&](Uint32 y)
+				{
+					Uint64 const line_offset = data_offset + y * (8 + line_size);
+					memcpy(output.data() + table_offset + y * sizeof(Uint64), &line_offset, sizeof(Uint64));
+
+					Uint8* line = output.data() + line_offset;
+					Int32 const line_y = (Int32)y, line_bytes = (Int32)line_size;
+					memcpy(line, &line_y, 4);
+					memcpy(line + 4, &line_bytes, 4);
+					Uint16* halfs = reinterpret_cast<Uint16*>(line + 8);
+
+					Float const* row = reinterpret_cast<Float const*>(src_data + Uint64(y) * stride);
+					static constexpr Uint32 channel_order[] = { 3, 2, 1, 0 };
+					for (Uint32 c = 0; c < 4; ++c)
+					{
+						for (Uint32 x = 0; x < width; ++x) halfs[c * width + x] = DirectX::PackedVector::XMConvertFloatToHalf(row[x * 4 + channel_order[c]]);
+					}
+				});
+
+			std::ofstream file(std::string(filename), std::ios::binary);
+			file.write(reinterpret_cast<Char const*>(output.data()), output.size());
+		}
+	}
+
+	//replaces the single threaded stb compressor used by the png writer, the filtered image is split into chunks deflated in parallel
+	unsigned char* ParallelZlibCompress(unsigned char* data, int data_len, int* out_len, int quality)
+	{
+		static constexpr Uint32 CHUNK_SIZE = 1 << 18;
+		Uint32 const size = (Uint32)data_len;
+		Uint32 const chunk_count = std::max(DivideAndRoundUp(size, CHUNK_SIZE), 1u);
+		Uint32 const max_chain = (Uint32)std::max(quality, 1) * 4;
+
+		std::vector<DeflateChunkWriter> chunks(chunk_count);
+		g_JobSystem.ParallelFor(chunk_count, 1, [&](Uint32 i)
+			{
+				Uint32 const begin = i * CHUNK_SIZE;
+				Uint32 const end = std::min(begin + CHUNK_SIZE, size);
+				chunks[i].Compress(data + begin, end - begin, i + 1 == chunk_count, max_chain);
+			});
+
+		Uint32 s1 = 1, s2 = 0;
+		for (Uint32 i = 0; i < size;)
+		{
+			Uint32 const block_end = std::min(i + 5552, size);
+			for (; i < block_end; ++i)
+			{
+				s1 += data[i];
+				s2 += s1;
+			}
+			s1 %= 65521;
+			s2 %= 65521;
+		}
+		Uint32 const adler = (s2 << 16) | s1;
+
+		Uint64 total_size = 2 + 4;
+		for (DeflateChunkWriter const& chunk : chunks) total_size += chunk.GetBytes().size();
+
+		Uint8* output = static_cast<Uint8*>(STBIW_MALLOC(total_size));
+		Uint8* dst = output;
+		*dst++ = 0x78;
+		*dst++ = 0x5E;
+		for (DeflateChunkWriter const& chunk : chunks)
+		{
+			memcpy(dst, chunk.GetBytes().data(), chunk.GetBytes().size());
+			dst += chunk.GetBytes().size();
+		}
+		*dst++ = Uint8(adler >> 24);
+		*dst++ = Uint8(adler >> 16);
+		*dst++ = Uint8(adler >> 8);
+		*dst++ = Uint8(adler);
+		*out_len = (int)total_size;
+		return output;
+	}
 
 	void WriteImageToFile(FileType type, std::string_view filename, Uint32 width, Uint32 height, void const* data, Uint32 stride)
 	{
@@ -14,8 +348,25 @@ namespace adria
 		case FileType::HDR: stbi_write_hdr(filename.data(), (int)width, (int)height, 4, (Float*)data); break;
 		case FileType::TGA: stbi_write_tga(filename.data(), (int)width, (int)height, 4, data); break;
 		case FileType::BMP: stbi_write_bmp(filename.data(), (int)width, (int)height, 4, data); break;
+		case FileType::QOI: WriteQOI(filename, width, height, (Uint8 const*)data, stride); break;
+		case FileType::EXR: WriteEXR(filename, width, height, (Float const*)data, stride); break;
 		default: ADRIA_UNREACHABLE();
 		}
 	}
-}
 
+	Char const* GetFileTypeExtension(FileType type)
+	{
+		switch (type)
+		{
+		case FileType::PNG: return ".png";
+		case FileType::JPG: return ".jpg";
+		case FileType::HDR: return ".hdr";
+		case FileType::TGA: return ".tga";
+		case FileType::BMP: return ".bmp";
+		case FileType::QOI: return ".qoi";
+		case FileType::EXR: return ".exr";
+		default: ADRIA_UNREACHABLE();
+		}
+		return "";
+	}
+}
@@ -9,7 +9,11 @@ namespace adria
 		JPG,
 		HDR,
 		TGA,
-		BMP
+		BMP,
+		QOI,
+		EXR
 	};
+	//HDR and EXR expect RGBA32F data, the other types RGBA8
 	void WriteImageToFile(FileType type, std::string_view filename, Uint32 width, Uint32 height, void const* data, Uint32 stride);
-}
\ No newline at end of file
+	Char const* GetFileTypeExtension(FileType type);
+}
@@ -0,0 +1,207 @@
+#include "JobSystem.h"
+
+namespace adria
+{
+	thread_local Uint32 JobSystem::thread_worker_index = JobSystem::INVALID_WORKER_INDEX;
+
+	namespace
+	{
+		Uint32 NextRandom()
+		{
+			thread_local Uint32 state = 0x9e3779b9u ^ (Uint32)std::hash<std::thread::id>{}(std::this_thread::get_id());
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	}
+
+	void JobSystem::JobDeque::Push(Job* job)
+	{
+		Int64 const b = bottom.load(std::memory_order_relaxed);
+		ADRIA_ASSERT(b - top.load(std::memory_order_acquire) < MAX_JOBS_PER_WORKER);
+		jobs[b & (MAX_JOBS_PER_WORKER - 1)].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	JobSystem::Job* JobSystem::JobDeque::Pop()
+	{
+		Int64 const b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		Int64 t = top.load(std::memory_order_relaxed);
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = jobs[b & (MAX_JOBS_PER_WORKER - 1)].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	JobSystem::Job* JobSystem::JobDeque::Steal()
+	{
+		Int64 t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		Int64 const b = bottom.load(std::memory_order_acquire);
+		if (t >= b) return nullptr;
+
+		Job* job = jobs[t & (MAX_JOBS_PER_WORKER - 1)].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+		return job;
+	}
+
+	void JobSystem::Initialize(Uint32 worker_count)
+	{
+		Uint32 const max_threads = std::max(std::thread::hardware_concurrency(), 2u);
+		Uint32 const thread_count = worker_count == 0 ? max_threads - 1 : std::min(max_threads - 1, worker_count);
+
+		done = false;
+		external_worker = std::make_unique<Worker>();
+		workers.reserve(thread_count + 1);
+		for (Uint32 i = 0; i <= thread_count; ++i) workers.push_back(std::make_unique<Worker>());
+
+		thread_worker_index = 0;
+		threads.reserve(thread_count);
+		for (Uint32 i = 1; i <= thread_count; ++i)
+		{
+			threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+		}
+	}
+
+	void JobSystem::Destroy()
+	{
+		if (workers.empty()) return;
+
+		done = true;
+		wake_counter.fetch_add(1, std::memory_order_release);
+		wake_counter.notify_all();
+		for (std::thread& thread : threads)
+		{
+			if (thread.joinable()) thread.join();
+		}
+		threads.clear();
+		workers.clear();
+		external_worker.reset();
+		external_jobs.clear();
+		thread_worker_index = INVALID_WORKER_INDEX;
+	}
+
+	void JobSystem::Wait(JobCounter const& counter)
+	{
+		while (!counter.IsDone())
+		{
+			Job* job = GetJob();
+			if (!job || !ExecuteJob(job)) std::this_thread::yield();
+		}
+	}
+
+	Bool JobSystem::TryExecuteJob()
+	{
+		if (workers.empty()) return false;
+		Job* job = GetJob();
+		return job && ExecuteJob(job);
+	}
+
+	JobSystem::Job* JobSystem::AllocateJob()
+	{
+		Job* job = nullptr;
+		if (thread_worker_index != INVALID_WORKER_INDEX)
+		{
+			Worker& worker = *workers[thread_worker_index];
+			job = &worker.job_pool[worker.job_pool_index++ & (MAX_JOBS_PER_WORKER - 1)];
+		}
+		else
+		{
+			std::lock_guard lock(external_mutex);
+			job = &external_worker->job_pool[external_worker->job_pool_index++ & (MAX_JOBS_PER_WORKER - 1)];
+		}
+		ADRIA_ASSERT_MSG(!job->in_use.load(std::memory_order_acquire), "Too many jobs in flight!");
+		job->in_use.store(true, std::memory_order_relaxed);
+		return job;
+	}
+
+	void JobSystem::Submit(Job* job)
+	{
+		if (thread_worker_index != INVALID_WORKER_INDEX)
+		{
+			workers[thread_worker_index]->deque.Push(job);
+		}
+		else
+		{
+			std::lock_guard lock(external_mutex);
+			external_jobs.push_back(job);
+			external_job_count.fetch_add(1, std::memory_order_release);
+		}
+		wake_counter.fetch_add(1, std::memory_order_release);
+		wake_counter.notify_one();
+	}
+
+	JobSystem::Job* JobSystem::GetJob()
+	{
+		if (thread_worker_index != INVALID_WORKER_INDEX)
+		{
+			if (Job* job = workers[thread_worker_index]->deque.Pop()) return job;
+		}
+
+		Uint32 const worker_count = (Uint32)workers.size();
+		Uint32 const first_victim = NextRandom() % worker_count;
+		for (Uint32 i = 0; i < worker_count; ++i)
+		{
+			Uint32 const victim = (first_victim + i) % worker_count;
+			if (victim == thread_worker_index) continue;
+			if (Job* job = workers[victim]->deque.Steal()) return job;
+		}
+
+		if (external_job_count.load(std::memory_order_acquire) > 0)
+		{
+			std::lock_guard lock(external_mutex);
+			if (!external_jobs.empty())
+			{
+				Job* job = external_jobs.front();
+				external_jobs.pop_front();
+				external_job_count.fetch_sub(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	Bool JobSystem::ExecuteJob(Job* job)
+	{
+		if (job->dependency && !job->dependency->IsDone())
+		{
+			Submit(job);
+			return false;
+		}
+
+		job->invoke(job->storage);
+		job->destroy(job->storage);
+		JobCounter* counter = job->counter;
+		job->in_use.store(false, std::memory_order_release);
+		counter->count.fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	}
+
+	void JobSystem::WorkerLoop(Uint32 worker_index)
+	{
+		thread_worker_index = worker_index;
+		while (!done.load(std::memory_order_acquire))
+		{
+			Uint32 const wake_value = wake_counter.load(std::memory_order_acquire);
+			if (Job* job = GetJob())
+			{
+				ExecuteJob(job);
+				continue;
+			}
+			wake_counter.wait(wake_value, std::memory_order_acquire);
+		}
+	}
+}
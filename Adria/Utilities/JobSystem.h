@@ -0,0 +1,128 @@
+#pragma once
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include "Singleton.h"
+
+namespace adria
+{
+	class JobCounter
+	{
+		friend class JobSystem;
+	public:
+		JobCounter() = default;
+		ADRIA_NONCOPYABLE_NONMOVABLE(JobCounter)
+
+		Bool IsDone() const { return count.load(std::memory_order_acquire) == 0; }
+
+	private:
+		std::atomic<Uint32> count = 0;
+	};
+
+	class JobSystem : public Singleton<JobSystem>
+	{
+		friend class Singleton<JobSystem>;
+
+		static constexpr Uint64 JOB_STORAGE_SIZE = 64;
+		static constexpr Uint32 MAX_JOBS_PER_WORKER = 2048;
+		static constexpr Uint32 INVALID_WORKER_INDEX = UINT32_MAX;
+		static_assert((MAX_JOBS_PER_WORKER & (MAX_JOBS_PER_WORKER - 1)) == 0);
+
+		struct Job
+		{
+			alignas(std::max_align_t) Uint8 storage[JOB_STORAGE_SIZE];
+			void (*invoke)(void*) = nullptr;
+			void (*destroy)(void*) = nullptr;
+			JobCounter* counter = nullptr;
+			JobCounter const* dependency = nullptr;
+			std::atomic<Bool> in_use = false;
+		};
+
+		class JobDeque
+		{
+		public:
+			void Push(Job* job);
+			Job* Pop();
+			Job* Steal();
+
+		private:
+			alignas(64) std::atomic<Int64> top = 0;
+			alignas(64) std::atomic<Int64> bottom = 0;
+			std::atomic<Job*> jobs[MAX_JOBS_PER_WORKER] = {};
+		};
+
+		struct Worker
+		{
+			JobDeque deque;
+			Job job_pool[MAX_JOBS_PER_WORKER];
+			Uint32 job_pool_index = 0;
+		};
+
+	public:
+		ADRIA_NONCOPYABLE_NONMOVABLE(JobSystem)
+
+		void Initialize(Uint32 worker_count = 0);
+		void Destroy();
+
+		template<typename F>
+		void Execute(F&& f, JobCounter& counter, JobCounter const* dependency = nullptr)
+		{
+			using Functor = std::decay_t<F>;
+			static_assert(sizeof(Functor) <= JOB_STORAGE_SIZE, "Job functor doesn't fit into the inline job storage!");
+			static_assert(alignof(Functor) <= alignof(std::max_align_t));
+
+			Job* job = AllocateJob();
+			new (job->storage) Functor(std::forward<F>(f));
+			job->invoke = [](void* storage) { (*static_cast<Functor*>(storage))(); };
+			job->destroy = [](void* storage) { static_cast<Functor*>(storage)->~Functor(); };
+			job->counter = &counter;
+			job->dependency = dependency;
+			counter.count.fetch_add(1, std::memory_order_relaxed);
+			Submit(job);
+		}
+
+		template<typename F>
+		void ParallelFor(Uint32 count, Uint32 batch_size, F&& f)
+		{
+			if (count == 0) return;
+			batch_size = std::max(batch_size, 1u);
+			JobCounter counter;
+			for (Uint32 begin = 0; begin < count; begin += batch_size)
+			{
+				Uint32 const end = std::min(begin + batch_size, count);
+				Execute([&f, begin, end]() { for (Uint32 i = begin; i < end; ++i) f(i); }, counter);
+			}
+			Wait(counter);
+		}
+
+		void Wait(JobCounter const& counter);
+		//runs at most one pending job on the calling thread, returns false if there was nothing to run
+		Bool TryExecuteJob();
+		Uint32 GetWorkerCount() const { return (Uint32)workers.size(); }
+
+	private:
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread> threads;
+		std::atomic<Bool> done = false;
+		std::atomic<Uint32> wake_counter = 0;
+
+		std::mutex external_mutex;
+		std::unique_ptr<Worker> external_worker;
+		std::deque<Job*> external_jobs;
+		std::atomic<Uint32> external_job_count = 0;
+
+		static thread_local Uint32 thread_worker_index;
+
+	private:
+		JobSystem() = default;
+		~JobSystem() = default;
+
+		Job* AllocateJob();
+		void Submit(Job* job);
+		Job* GetJob();
+		Bool ExecuteJob(Job* job);
+		void WorkerLoop(Uint32 worker_index);
+	};
+	#define g_JobSystem JobSystem::Get()
+}
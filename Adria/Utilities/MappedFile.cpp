@@ -0,0 +1,43 @@
+#include "MappedFile.h"
+
+namespace adria
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	Bool MappedFile::Open(std::string_view file_path)
+	{
+		Close();
+		file = CreateFileA(std::string(file_path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER file_size{};
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		view = mapping ? static_cast<Uint8 const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (!view)
+		{
+			Close();
+			return false;
+		}
+		size = (Uint64)file_size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (view) UnmapViewOfFile(view);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		view = nullptr;
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+		size = 0;
+	}
+}
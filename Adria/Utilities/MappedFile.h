@@ -0,0 +1,27 @@
+#pragma once
+#include <string_view>
+
+namespace adria
+{
+	//read only view of a whole file, pages are brought in by the os on first access instead of being copied into a heap buffer
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		ADRIA_NONCOPYABLE_NONMOVABLE(MappedFile)
+		~MappedFile();
+
+		Bool Open(std::string_view file_path);
+		void Close();
+
+		Bool IsOpen() const { return view != nullptr; }
+		Uint8 const* Data() const { return view; }
+		Uint64 Size() const { return size; }
+
+	private:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		Uint8 const* view = nullptr;
+		Uint64 size = 0;
+	};
+}
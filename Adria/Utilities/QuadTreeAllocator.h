@@ -0,0 +1,147 @@
+#pragma once
+#include <bit>
+#include <vector>
+#include <algorithm>
+
+namespace adria
+{
+	//buddy allocator over a square of power of two size: every node is free, allocated or split into four quadrants
+	class QuadTreeAllocator
+	{
+		static constexpr Uint32 INVALID_NODE = Uint32(-1);
+
+		enum class NodeState : Uint8
+		{
+			Free,
+			Allocated,
+			Split
+		};
+
+	public:
+		struct Allocation
+		{
+			Uint32 x = 0;
+			Uint32 y = 0;
+			Uint32 size = 0;
+
+			Bool IsValid() const { return size != 0; }
+			Bool operator==(Allocation const&) const = default;
+		};
+
+	public:
+		QuadTreeAllocator(Uint32 size, Uint32 min_size) : size(size), min_size(min_size)
+		{
+			ADRIA_ASSERT(std::has_single_bit(size) && std::has_single_bit(min_size) && min_size <= size);
+			level_count = (Uint32)std::countr_zero(size / min_size) + 1;
+			level_offsets.resize(level_count);
+			Uint32 node_count = 0;
+			for (Uint32 level = 0; level < level_count; ++level)
+			{
+				level_offsets[level] = node_count;
+				node_count += 1u << (2 * level);
+			}
+			nodes.assign(node_count, NodeState::Free);
+		}
+		ADRIA_DEFAULT_COPYABLE_MOVABLE(QuadTreeAllocator)
+		~QuadTreeAllocator() = default;
+
+		Allocation Allocate(Uint32 alloc_size)
+		{
+			alloc_size = std::clamp(std::bit_ceil(alloc_size), min_size, size);
+			Uint32 const target_level = GetLevel(alloc_size);
+
+			Uint32 level = target_level;
+			Uint32 node = FindFree(level);
+			while (node == INVALID_NODE && level > 0) node = FindFree(--level);
+			if (node == INVALID_NODE) return Allocation{};
+
+			//split the smallest free node that fits down to the requested size, always continuing in the first quadrant
+			Uint32 x = 0, y = 0;
+			GetCoords(level, node, x, y);
+			while (level < target_level)
+			{
+				nodes[level_offsets[level] + node] = NodeState::Split;
+				++level;
+				x *= 2, y *= 2;
+				for (Uint32 i = 0; i < 4; ++i) nodes[level_offsets[level] + GetIndex(level, x + (i & 1), y + (i >> 1))] = NodeState::Free;
+				node = GetIndex(level, x, y);
+			}
+			nodes[level_offsets[level] + node] = NodeState::Allocated;
+			used_area += Uint64(alloc_size) * alloc_size;
+			return Allocation{ .x = x * alloc_size, .y = y * alloc_size, .size = alloc_size };
+		}
+
+		void Free(Allocation const& allocation)
+		{
+			if (!allocation.IsValid()) return;
+
+			Uint32 level = GetLevel(allocation.size);
+			Uint32 x = allocation.x / allocation.size;
+			Uint32 y = allocation.y / allocation.size;
+			ADRIA_ASSERT(nodes[level_offsets[level] + GetIndex(level, x, y)] == NodeState::Allocated);
+			nodes[level_offsets[level] + GetIndex(level, x, y)] = NodeState::Free;
+			used_area -= Uint64(allocation.size) * allocation.size;
+
+			while (level > 0)
+			{
+				Uint32 const parent_x = x / 2, parent_y = y / 2;
+				for (Uint32 i = 0; i < 4; ++i)
+				{
+					if (nodes[level_offsets[level] + GetIndex(level, parent_x * 2 + (i & 1), parent_y * 2 + (i >> 1))] != NodeState::Free) return;
+				}
+				--level;
+				x = parent_x, y = parent_y;
+				nodes[level_offsets[level] + GetIndex(level, x, y)] = NodeState::Free;
+			}
+		}
+
+		void Clear()
+		{
+			nodes.assign(nodes.size(), NodeState::Free);
+			used_area = 0;
+		}
+
+		Uint32 GetSize() const { return size; }
+		Uint32 GetMinSize() const { return min_size; }
+		Uint64 GetUsedArea() const { return used_area; }
+
+	private:
+		Uint32 size;
+		Uint32 min_size;
+		Uint32 level_count = 0;
+		std::vector<Uint32> level_offsets;
+		std::vector<NodeState> nodes;
+		Uint64 used_area = 0;
+
+	private:
+		Uint32 GetLevel(Uint32 node_size) const
+		{
+			return (Uint32)std::countr_zero(size / node_size);
+		}
+		static Uint32 GetIndex(Uint32 level, Uint32 x, Uint32 y)
+		{
+			return y * (1u << level) + x;
+		}
+		static void GetCoords(Uint32 level, Uint32 index, Uint32& x, Uint32& y)
+		{
+			x = index % (1u << level);
+			y = index / (1u << level);
+		}
+
+		//nodes below a free or allocated node keep stale states, only children of split nodes are reachable
+		Uint32 FindFree(Uint32 level) const
+		{
+			Uint32 const count = 1u << (2 * level);
+			for (Uint32 index = 0; index < count; ++index)
+			{
+				if (nodes[level_offsets[level] + index] != NodeState::Free) continue;
+				if (level == 0) return index;
+
+				Uint32 x = 0, y = 0;
+				GetCoords(level, index, x, y);
+				if (nodes[level_offsets[level - 1] + GetIndex(level - 1, x / 2, y / 2)] == NodeState::Split) return index;
+			}
+			return INVALID_NODE;
+		}
+	};
+}
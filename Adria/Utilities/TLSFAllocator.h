@@ -0,0 +1,203 @@
+#pragma once
+#include <bit>
+#include "AllocatorUtil.h"
+
+namespace adria
+{
+	//two level segregated fit: O(1) allocation and free over an offset range, used to sub-allocate large GPU buffers
+	class TLSFAllocator
+	{
+		static constexpr Uint32 SL_BITS = 4;
+		static constexpr Uint32 SL_COUNT = 1u << SL_BITS;
+		static constexpr Uint32 FL_COUNT = 64 - SL_BITS + 1;
+		static constexpr Uint32 INVALID_NODE = Uint32(-1);
+
+		struct Node
+		{
+			Uint64 offset = 0;
+			Uint64 size = 0;
+			Uint32 prev_physical = INVALID_NODE;
+			Uint32 next_physical = INVALID_NODE;
+			Uint32 prev_free = INVALID_NODE;
+			Uint32 next_free = INVALID_NODE;
+			Bool   free = false;
+		};
+
+	public:
+		struct Allocation
+		{
+			Uint64 offset = INVALID_ALLOC_OFFSET;
+			Uint32 node = INVALID_NODE;
+
+			Bool IsValid() const { return offset != INVALID_ALLOC_OFFSET; }
+		};
+
+	public:
+		TLSFAllocator(Uint64 max_size, Uint64 granularity = 16) : max_size(max_size), granularity(granularity)
+		{
+			free_heads.fill(INVALID_NODE);
+			Uint32 const node = CreateNode();
+			nodes[node].offset = 0;
+			nodes[node].size = max_size / granularity;
+			InsertFree(node);
+		}
+		ADRIA_DEFAULT_COPYABLE_MOVABLE(TLSFAllocator)
+		~TLSFAllocator() = default;
+
+		Allocation Allocate(Uint64 size)
+		{
+			Uint64 const units = std::max<Uint64>(DivideAndRoundUp(size, granularity), 1);
+			Uint32 const node = FindFree(units);
+			if (node == INVALID_NODE) return Allocation{};
+
+			RemoveFree(node);
+			if (nodes[node].size > units)
+			{
+				Uint32 const remainder = CreateNode();
+				nodes[remainder].offset = nodes[node].offset + units;
+				nodes[remainder].size = nodes[node].size - units;
+				nodes[remainder].prev_physical = node;
+				nodes[remainder].next_physical = nodes[node].next_physical;
+				if (nodes[node].next_physical != INVALID_NODE) nodes[nodes[node].next_physical].prev_physical = remainder;
+				nodes[node].next_physical = remainder;
+				nodes[node].size = units;
+				InsertFree(remainder);
+			}
+			used_units += nodes[node].size;
+			return Allocation{ nodes[node].offset * granularity, node };
+		}
+
+		void Free(Allocation const& allocation)
+		{
+			if (!allocation.IsValid()) return;
+
+			Uint32 node = allocation.node;
+			ADRIA_ASSERT(!nodes[node].free);
+			used_units -= nodes[node].size;
+
+			if (Uint32 next = nodes[node].next_physical; next != INVALID_NODE && nodes[next].free)
+			{
+				RemoveFree(next);
+				nodes[node].size += nodes[next].size;
+				nodes[node].next_physical = nodes[next].next_physical;
+				if (nodes[next].next_physical != INVALID_NODE) nodes[nodes[next].next_physical].prev_physical = node;
+				ReleaseNode(next);
+			}
+			if (Uint32 prev = nodes[node].prev_physical; prev != INVALID_NODE && nodes[prev].free)
+			{
+				RemoveFree(prev);
+				nodes[prev].size += nodes[node].size;
+				nodes[prev].next_physical = nodes[node].next_physical;
+				if (nodes[node].next_physical != INVALID_NODE) nodes[nodes[node].next_physical].prev_physical = prev;
+				ReleaseNode(node);
+				node = prev;
+			}
+			InsertFree(node);
+		}
+
+		Uint64 MaxSize()  const { return max_size; }
+		Uint64 UsedSize() const { return used_units * granularity; }
+		Bool Empty()	  const { return used_units == 0; }
+
+	private:
+		Uint64 max_size;
+		Uint64 granularity;
+		Uint64 used_units = 0;
+		std::vector<Node> nodes;
+		std::vector<Uint32> unused_nodes;
+		Uint64 fl_bitmap = 0;
+		std::array<Uint32, FL_COUNT> sl_bitmaps{};
+		std::array<Uint32, FL_COUNT * SL_COUNT> free_heads;
+
+	private:
+		static void Mapping(Uint64 size, Uint32& fl, Uint32& sl)
+		{
+			if (size < SL_COUNT)
+			{
+				fl = 0;
+				sl = (Uint32)size;
+			}
+			else
+			{
+				Uint32 const msb = 63 - (Uint32)std::countl_zero(size);
+				fl = msb - SL_BITS + 1;
+				sl = (Uint32)(size >> (msb - SL_BITS)) - SL_COUNT;
+			}
+		}
+
+		Uint32 FindFree(Uint64 size) const
+		{
+			//round up to the next bucket so any block found there is large enough
+			if (size >= SL_COUNT)
+			{
+				Uint32 const msb = 63 - (Uint32)std::countl_zero(size);
+				size += (1ull << (msb - SL_BITS)) - 1;
+			}
+			Uint32 fl, sl;
+			Mapping(size, fl, sl);
+			if (fl >= FL_COUNT) return INVALID_NODE;
+
+			Uint32 sl_map = sl_bitmaps[fl] & (~0u << sl);
+			if (sl_map == 0)
+			{
+				Uint64 const fl_map = fl + 1 < 64 ? fl_bitmap & (~0ull << (fl + 1)) : 0;
+				if (fl_map == 0) return INVALID_NODE;
+				fl = (Uint32)std::countr_zero(fl_map);
+				sl_map = sl_bitmaps[fl];
+			}
+			sl = (Uint32)std::countr_zero(sl_map);
+			return free_heads[fl * SL_COUNT + sl];
+		}
+
+		void InsertFree(Uint32 node)
+		{
+			Uint32 fl, sl;
+			Mapping(nodes[node].size, fl, sl);
+			Uint32& head = free_heads[fl * SL_COUNT + sl];
+			nodes[node].free = true;
+			nodes[node].prev_free = INVALID_NODE;
+			nodes[node].next_free = head;
+			if (head != INVALID_NODE) nodes[head].prev_free = node;
+			head = node;
+			fl_bitmap |= 1ull << fl;
+			sl_bitmaps[fl] |= 1u << sl;
+		}
+
+		void RemoveFree(Uint32 node)
+		{
+			Uint32 fl, sl;
+			Mapping(nodes[node].size, fl, sl);
+			Uint32& head = free_heads[fl * SL_COUNT + sl];
+			if (nodes[node].prev_free != INVALID_NODE) nodes[nodes[node].prev_free].next_free = nodes[node].next_free;
+			if (nodes[node].next_free != INVALID_NODE) nodes[nodes[node].next_free].prev_free = nodes[node].prev_free;
+			if (head == node) head = nodes[node].next_free;
+			if (head == INVALID_NODE)
+			{
+				sl_bitmaps[fl] &= ~(1u << sl);
+				if (sl_bitmaps[fl] == 0) fl_bitmap &= ~(1ull << fl);
+			}
+			nodes[node].free = false;
+			nodes[node].prev_free = INVALID_NODE;
+			nodes[node].next_free = INVALID_NODE;
+		}
+
+		Uint32 CreateNode()
+		{
+			if (!unused_nodes.empty())
+			{
+				Uint32 const node = unused_nodes.back();
+				unused_nodes.pop_back();
+				nodes[node] = Node{};
+				return node;
+			}
+			nodes.emplace_back();
+			return (Uint32)nodes.size() - 1;
+		}
+
+		void ReleaseNode(Uint32 node)
+		{
+			nodes[node] = Node{};
+			unused_nodes.push_back(node);
+		}
+	};
+}
@@ -0,0 +1,415 @@
+#include <fstream>
+#include <filesystem>
+#include <stb_image.h>
+#include "TextureCooker.h"
+#include "Image.h"
+#include "FilesUtil.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr Uint32 COOKED_TEXTURE_MAGIC = 0x58455443;
+		constexpr Uint32 COOKED_TEXTURE_VERSION = 1;
+
+#pragma pack(push,1)
+		struct DDSPixelFormat
+		{
+			Uint32 dwSize;
+			Uint32 dwFlags;
+			Uint32 dwFourCC;
+			Uint32 dwRGBBitCount;
+			Uint32 dwRBitMask;
+			Uint32 dwGBitMask;
+			Uint32 dwBBitMask;
+			Uint32 dwABitMask;
+		};
+
+		struct DDSFileHeader
+		{
+			Uint32 dwSize;
+			Uint32 dwFlags;
+			Uint32 dwHeight;
+			Uint32 dwWidth;
+			Uint32 dwLinearSize;
+			Uint32 dwDepth;
+			Uint32 dwMipMapCount;
+			Uint32 dwReserved1[11];
+			DDSPixelFormat ddpf;
+			Uint32 dwCaps;
+			Uint32 dwCaps2;
+			Uint32 dwCaps3;
+			Uint32 dwCaps4;
+			Uint32 dwReserved2;
+		};
+#pragma pack(pop)
+
+		//dwReserved1 is free for tool use, the cooker keeps its validation data there
+		enum CookedTextureReserved
+		{
+			CookedTextureReserved_Magic,
+			CookedTextureReserved_Version,
+			CookedTextureReserved_Mode,
+			CookedTextureReserved_SRGB,
+			CookedTextureReserved_WriteTimeLow,
+			CookedTextureReserved_WriteTimeHigh
+		};
+
+		struct MipLevel
+		{
+			Uint32 width;
+			Uint32 height;
+			std::vector<Uint8> pixels;
+		};
+
+		constexpr Uint32 MakeFourCC(Uint32 a, Uint32 b, Uint32 c, Uint32 d) { return a | (b << 8u) | (c << 16u) | (d << 24u); }
+
+		Float SRGBToLinear(Float c)
+		{
+			return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		Float LinearToSRGB(Float c)
+		{
+			return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		}
+		Uint8 ToUnorm8(Float c)
+		{
+			return (Uint8)std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f);
+		}
+
+		std::vector<MipLevel> GenerateMipChain(Uint8 const* pixels, Uint32 width, Uint32 height, TextureCookMode mode, Bool srgb)
+		{
+			std::array<Float, 256> to_linear{};
+			for (Uint32 i = 0; i < 256; ++i) to_linear[i] = srgb ? SRGBToLinear(i / 255.0f) : i / 255.0f;
+
+			std::vector<MipLevel> mips;
+			MipLevel& top_mip = mips.emplace_back();
+			top_mip.width = width;
+			top_mip.height = height;
+			top_mip.pixels.assign(pixels, pixels + width * height * 4);
+
+			while (mips.back().width > 1 || mips.back().height > 1)
+			{
+				MipLevel const& src = mips.back();
+				MipLevel dst{};
+				dst.width = std::max(src.width / 2, 1u);
+				dst.height = std::max(src.height / 2, 1u);
+				dst.pixels.resize(dst.width * dst.height * 4);
+				for (Uint32 y = 0; y < dst.height; ++y)
+				{
+					for (Uint32 x = 0; x < dst.width; ++x)
+					{
+						Uint32 const x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+						Uint32 const y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+						Uint8 const* taps[4] =
+						{
+							&src.pixels[(y0 * src.width + x0) * 4], &src.pixels[(y0 * src.width + x1) * 4],
+							&src.pixels[(y1 * src.width + x0) * 4], &src.pixels[(y1 * src.width + x1) * 4]
+						};
+
+						Float sum[4] = {};
+						for (Uint8 const* tap : taps)
+						{
+							for (Uint32 c = 0; c < 3; ++c) sum[c] += mode == TextureCookMode::NormalMap ? tap[c] / 127.5f - 1.0f : to_linear[tap[c]];
+							sum[3] += tap[3] / 255.0f;
+						}
+
+						Uint8* out = &dst.pixels[(y * dst.width + x) * 4];
+						if (mode == TextureCookMode::NormalMap)
+						{
+							Float const length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+							for (Uint32 c = 0; c < 3; ++c) out[c] = ToUnorm8(length > 0.0f ? sum[c] / length * 0.5f + 0.5f : (c == 2 ? 1.0f : 0.5f));
+						}
+						else
+						{
+							for (Uint32 c = 0; c < 3; ++c) out[c] = ToUnorm8(srgb ? LinearToSRGB(sum[c] * 0.25f) : sum[c] * 0.25f);
+						}
+						out[3] = ToUnorm8(sum[3] * 0.25f);
+					}
+				}
+				mips.push_back(std::move(dst));
+			}
+			return mips;
+		}
+
+		void GetBlock(MipLevel const& mip, Uint32 block_x, Uint32 block_y, Uint8 block[64])
+		{
+			for (Uint32 y = 0; y < 4; ++y)
+			{
+				for (Uint32 x = 0; x < 4; ++x)
+				{
+					Uint32 const src_x = std::min(block_x * 4 + x, mip.width - 1);
+					Uint32 const src_y = std::min(block_y * 4 + y, mip.height - 1);
+					memcpy(&block[(y * 4 + x) * 4], &mip.pixels[(src_y * mip.width + src_x) * 4], 4);
+				}
+			}
+		}
+
+		Uint16 ToRGB565(Uint8 const* color)
+		{
+			return (Uint16)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+		}
+		void FromRGB565(Uint16 color, Int32* out)
+		{
+			Int32 const r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+			out[0] = (r << 3) | (r >> 2);
+			out[1] = (g << 2) | (g >> 4);
+			out[2] = (b << 3) | (b >> 2);
+		}
+
+		//range fit: inset bounding box endpoints, always in four color mode so the block is also valid inside BC3
+		void EncodeBC1Block(Uint8 const* block, Uint8* output)
+		{
+			Uint8 min_color[3] = { 255, 255, 255 };
+			Uint8 max_color[3] = { 0, 0, 0 };
+			for (Uint32 i = 0; i < 16; ++i)
+			{
+				for (Uint32 c = 0; c < 3; ++c)
+				{
+					min_color[c] = std::min(min_color[c], block[i * 4 + c]);
+					max_color[c] = std::max(max_color[c], block[i * 4 + c]);
+				}
+			}
+			for (Uint32 c = 0; c < 3; ++c)
+			{
+				Uint8 const inset = (max_color[c] - min_color[c]) >> 4;
+				min_color[c] += inset;
+				max_color[c] -= inset;
+			}
+
+			Uint16 color0 = ToRGB565(max_color);
+			Uint16 color1 = ToRGB565(min_color);
+			if (color0 < color1) std::swap(color0, color1);
+
+			Uint32 indices = 0;
+			if (color0 != color1)
+			{
+				Int32 palette[4][3];
+				FromRGB565(color0, palette[0]);
+				FromRGB565(color1, palette[1]);
+				for (Uint32 c = 0; c < 3; ++c)
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+
+				for (Uint32 i = 0; i < 16; ++i)
+				{
+					Uint32 best_index = 0;
+					Int32 best_distance = std::numeric_limits<Int32>::max();
+					for (Uint32 p = 0; p < 4; ++p)
+					{
+						Int32 const dr = block[i * 4 + 0] - palette[p][0];
+						Int32 const dg = block[i * 4 + 1] - palette[p][1];
+						Int32 const db = block[i * 4 + 2] - palette[p][2];
+						Int32 const distance = dr * dr + dg * dg + db * db;
+						if (distance < best_distance)
+						{
+							best_distance = distance;
+							best_index = p;
+						}
+					}
+					indices |= best_index << (2 * i);
+				}
+			}
+			memcpy(output + 0, &color0, sizeof(Uint16));
+			memcpy(output + 2, &color1, sizeof(Uint16));
+			memcpy(output + 4, &indices, sizeof(Uint32));
+		}
+
+		void EncodeBC4Block(Uint8 const* block, Uint32 channel, Uint8* output)
+		{
+			Uint8 min_value = 255, max_value = 0;
+			for (Uint32 i = 0; i < 16; ++i)
+			{
+				min_value = std::min(min_value, block[i * 4 + channel]);
+				max_value = std::max(max_value, block[i * 4 + channel]);
+			}
+
+			output[0] = max_value;
+			output[1] = min_value;
+			Uint64 indices = 0;
+			if (max_value != min_value)
+			{
+				Int32 palette[8];
+				palette[0] = max_value;
+				palette[1] = min_value;
+				for (Int32 i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * max_value + i * min_value) / 7;
+
+				for (Uint32 i = 0; i < 16; ++i)
+				{
+					Uint64 best_index = 0;
+					Int32 best_distance = std::numeric_limits<Int32>::max();
+					for (Uint32 p = 0; p < 8; ++p)
+					{
+						Int32 const distance = std::abs(block[i * 4 + channel] - palette[p]);
+						if (distance < best_distance)
+						{
+							best_distance = distance;
+							best_index = p;
+						}
+					}
+					indices |= best_index << (3 * i);
+				}
+			}
+			memcpy(output + 2, &indices, 6);
+		}
+
+		std::vector<Uint8> EncodeMips(std::vector<MipLevel> const& mips, GfxFormat format)
+		{
+			std::vector<Uint8> data;
+			if (format == GfxFormat::R8G8B8A8_UNORM)
+			{
+				for (MipLevel const& mip : mips) data.insert(data.end(), mip.pixels.begin(), mip.pixels.end());
+				return data;
+			}
+
+			Uint32 const block_bytes = format == GfxFormat::BC1_UNORM ? 8 : 16;
+			for (MipLevel const& mip : mips)
+			{
+				Uint32 const blocks_x = DivideAndRoundUp(mip.width, 4u);
+				Uint32 const blocks_y = DivideAndRoundUp(mip.height, 4u);
+				Uint64 offset = data.size();
+				data.resize(offset + (Uint64)blocks_x * blocks_y * block_bytes);
+				for (Uint32 block_y = 0; block_y < blocks_y; ++block_y)
+				{
+					for (Uint32 block_x = 0; block_x < blocks_x; ++block_x)
+					{
+						Uint8 block[64];
+						GetBlock(mip, block_x, block_y, block);
+						if (format == GfxFormat::BC3_UNORM)
+						{
+							EncodeBC4Block(block, 3, &data[offset]);
+							EncodeBC1Block(block, &data[offset + 8]);
+						}
+						else
+						{
+							EncodeBC1Block(block, &data[offset]);
+						}
+						offset += block_bytes;
+					}
+				}
+			}
+			return data;
+		}
+
+		Bool IsCookedTextureValid(std::string const& cooked_path, TextureCookMode mode, Bool srgb, Int64 source_write_time)
+		{
+			std::ifstream is(cooked_path, std::ios::binary);
+			if (!is) return false;
+
+			Uint32 magic = 0;
+			DDSFileHeader header{};
+			is.read(reinterpret_cast<Char*>(&magic), sizeof(magic));
+			is.read(reinterpret_cast<Char*>(&header), sizeof(header));
+			if (!is || magic != MakeFourCC('D', 'D', 'S', ' ')) return false;
+
+			Uint32 const* reserved = header.dwReserved1;
+			return reserved[CookedTextureReserved_Magic] == COOKED_TEXTURE_MAGIC &&
+				   reserved[CookedTextureReserved_Version] == COOKED_TEXTURE_VERSION &&
+				   reserved[CookedTextureReserved_Mode] == (Uint32)mode &&
+				   reserved[CookedTextureReserved_SRGB] == (Uint32)srgb &&
+				   reserved[CookedTextureReserved_WriteTimeLow] == (Uint32)source_write_time &&
+				   reserved[CookedTextureReserved_WriteTimeHigh] == (Uint32)(source_write_time >> 32);
+		}
+
+		Bool SaveCookedTexture(std::string const& cooked_path, GfxFormat format, std::vector<MipLevel> const& mips, std::vector<Uint8> const& data,
+							   TextureCookMode mode, Bool srgb, Int64 source_write_time)
+		{
+			DDSFileHeader header{};
+			header.dwSize = sizeof(DDSFileHeader);
+			header.dwFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;
+			header.dwHeight = mips[0].height;
+			header.dwWidth = mips[0].width;
+			header.dwDepth = 1;
+			header.dwMipMapCount = (Uint32)mips.size();
+			header.dwCaps = 0x1000 | 0x400000 | 0x8;
+			header.dwReserved1[CookedTextureReserved_Magic] = COOKED_TEXTURE_MAGIC;
+			header.dwReserved1[CookedTextureReserved_Version] = COOKED_TEXTURE_VERSION;
+			header.dwReserved1[CookedTextureReserved_Mode] = (Uint32)mode;
+			header.dwReserved1[CookedTextureReserved_SRGB] = (Uint32)srgb;
+			header.dwReserved1[CookedTextureReserved_WriteTimeLow] = (Uint32)source_write_time;
+			header.dwReserved1[CookedTextureReserved_WriteTimeHigh] = (Uint32)(source_write_time >> 32);
+			header.ddpf.dwSize = sizeof(DDSPixelFormat);
+			if (format == GfxFormat::R8G8B8A8_UNORM)
+			{
+				header.ddpf.dwFlags = 0x40 | 0x1;
+				header.ddpf.dwRGBBitCount = 32;
+				header.ddpf.dwRBitMask = 0x000000ff;
+				header.ddpf.dwGBitMask = 0x0000ff00;
+				header.ddpf.dwBBitMask = 0x00ff0000;
+				header.ddpf.dwABitMask = 0xff000000;
+			}
+			else
+			{
+				header.ddpf.dwFlags = 0x4;
+				header.ddpf.dwFourCC = format == GfxFormat::BC1_UNORM ? MakeFourCC('D', 'X', 'T', '1') : MakeFourCC('D', 'X', 'T', '5');
+			}
+
+			std::string const temp_path = cooked_path + ".tmp";
+			{
+				std::ofstream os(temp_path, std::ios::binary);
+				if (!os) return false;
+				Uint32 const magic = MakeFourCC('D', 'D', 'S', ' ');
+				os.write(reinterpret_cast<Char const*>(&magic), sizeof(magic));
+				os.write(reinterpret_cast<Char const*>(&header), sizeof(header));
+				os.write(reinterpret_cast<Char const*>(data.data()), data.size());
+				if (!os) return false;
+			}
+			std::error_code ec;
+			std::filesystem::rename(temp_path, cooked_path, ec);
+			return !ec;
+		}
+
+		Bool CookTexture(std::string const& texture_path, std::string const& cooked_path, TextureCookMode mode, Bool srgb, Int64 source_write_time)
+		{
+			Int32 width = 0, height = 0, components = 0;
+			stbi_uc* pixels = stbi_load(texture_path.c_str(), &width, &height, &components, 4);
+			if (!pixels) return false;
+
+			Bool has_alpha = false;
+			for (Int64 i = 0; i < (Int64)width * height && !has_alpha; ++i) has_alpha = pixels[i * 4 + 3] != 255;
+			std::vector<MipLevel> mips = GenerateMipChain(pixels, (Uint32)width, (Uint32)height, mode, srgb);
+			stbi_image_free(pixels);
+
+			//block compressed textures need the top mip to be a multiple of the block size
+			GfxFormat format = has_alpha ? GfxFormat::BC3_UNORM : GfxFormat::BC1_UNORM;
+			if (mode == TextureCookMode::NormalMap || width % 4 != 0 || height % 4 != 0) format = GfxFormat::R8G8B8A8_UNORM;
+
+			std::vector<Uint8> data = EncodeMips(mips, format);
+			if (!SaveCookedTexture(cooked_path, format, mips, data, mode, srgb, source_write_time))
+			{
+				ADRIA_LOG(WARNING, "Failed to write cooked texture %s", cooked_path.c_str());
+				return false;
+			}
+			ADRIA_LOG(INFO, "Cooked texture %s (%s, %llu mips)", texture_path.c_str(), GfxFormatToString(format), (Uint64)mips.size());
+			return true;
+		}
+
+		Bool IsCookable(std::string const& texture_path)
+		{
+			std::string extension = GetExtension(texture_path);
+			std::transform(std::begin(extension), std::end(extension), std::begin(extension), [](Char c) {return std::tolower(c); });
+			return extension != ".dds" && !stbi_is_hdr(texture_path.c_str());
+		}
+	}
+
+	std::string GetCookedTexturePath(std::string_view texture_path)
+	{
+		return std::string(texture_path) + ".cooked.dds";
+	}
+
+	std::unique_ptr<Image> LoadCookedImage(std::string const& texture_path, TextureCookMode mode, Bool srgb)
+	{
+		if (mode == TextureCookMode::None || !FileExists(texture_path) || !IsCookable(texture_path)) return std::make_unique<Image>(texture_path);
+
+		std::string const cooked_path = GetCookedTexturePath(texture_path);
+		Int64 const source_write_time = GetFileLastWriteTime(texture_path);
+		if (IsCookedTextureValid(cooked_path, mode, srgb, source_write_time) || CookTexture(texture_path, cooked_path, mode, srgb, source_write_time))
+		{
+			return std::make_unique<Image>(cooked_path);
+		}
+		return std::make_unique<Image>(texture_path);
+	}
+}
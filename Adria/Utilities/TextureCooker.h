@@ -0,0 +1,18 @@
+#pragma once
+#include <string_view>
+#include <memory>
+
+namespace adria
+{
+	class Image;
+
+	enum class TextureCookMode : Uint8
+	{
+		None,
+		BlockCompressed,
+		NormalMap
+	};
+
+	std::string GetCookedTexturePath(std::string_view texture_path);
+	std::unique_ptr<Image> LoadCookedImage(std::string const& texture_path, TextureCookMode mode, Bool srgb);
+}
@@ -32,6 +32,16 @@ int APIENTRY wWinMain(
 		cli_parser.AddArg(false, "-gpuvalidation");
 		cli_parser.AddArg(false, "-pix");
 		cli_parser.AddArg(false, "-aftermath");
+		cli_parser.AddArg(false, "-precompile");
+		cli_parser.AddArg(false, "-cpubenchmark");
+		cli_parser.AddArg(true, "-cpubenchmarkfilter");
+		cli_parser.AddArg(true, "-benchmark");
+		cli_parser.AddArg(false, "-headless");
+		cli_parser.AddArg(true, "-frames");
+		cli_parser.AddArg(true, "-capture");
+		cli_parser.AddArg(true, "-framesinflight");
+		cli_parser.AddArg(true, "-remote");
+		cli_parser.AddArg(true, "-remoteaddress");
     }
     CLIParseResult cli_result = cli_parser.Parse(lpCmdLine);
     
@@ -40,18 +50,48 @@ int APIENTRY wWinMain(
     g_Log.Register(new FileLogger(log_file.c_str(), log_level));
     g_Log.Register(new OutputDebugStringLogger(log_level));
 
+    if (cli_result["-headless"])
+    {
+        EngineInit engine_init{};
+        engine_init.scene_file = cli_result["-scene"].AsStringOr("sponza.json");
+        engine_init.benchmark_file = cli_result["-benchmark"].AsStringOr("");
+        engine_init.headless_frames = cli_result["-frames"].AsIntOr(1);
+        engine_init.headless_capture = cli_result["-capture"].AsStringOr("");
+        engine_init.remote_port = (Uint16)cli_result["-remote"].AsIntOr(0);
+        engine_init.remote_address = cli_result["-remoteaddress"].AsStringOr("127.0.0.1");
+        engine_init.gfx_options.headless = true;
+        engine_init.gfx_options.headless_width = cli_result["-w"].AsIntOr(1920);
+        engine_init.gfx_options.headless_height = cli_result["-h"].AsIntOr(1080);
+        engine_init.gfx_options.headless_frames_in_flight = cli_result["-framesinflight"].AsIntOr(3);
+        engine_init.gfx_options.debug_device = cli_result["-debugdevice"];
+        engine_init.gfx_options.shader_debug = cli_result["-shaderdebug"];
+        engine_init.gfx_options.dred = cli_result["-dred"];
+        engine_init.gfx_options.gpu_validation = cli_result["-gpuvalidation"];
+        engine_init.gfx_options.aftermath = cli_result["-aftermath"];
+
+        Engine engine(engine_init);
+        while (!engine.IsFinished())
+        {
+            engine.Run();
+        }
+        return engine.GetExitCode();
+    }
+
 	std::string title_str = cli_result["-title"].AsStringOr("Adria").c_str();
     WindowInit window_init{};
     window_init.width = cli_result["-w"].AsIntOr(1280);
     window_init.height = cli_result["-h"].AsIntOr(1024);
     window_init.title = title_str.c_str();
     window_init.maximize = cli_result["-max"];
+    window_init.hidden = cli_result["-precompile"] || cli_result["-cpubenchmark"];
     Window window(window_init);
     g_Input.Initialize(&window);
 
     EngineInit engine_init{};
     engine_init.scene_file = cli_result["-scene"].AsStringOr("sponza.json");
 	engine_init.window = &window;
+	engine_init.remote_port = (Uint16)cli_result["-remote"].AsIntOr(0);
+	engine_init.remote_address = cli_result["-remoteaddress"].AsStringOr("127.0.0.1");
 	engine_init.gfx_options.vsync = cli_result["-vsync"];
 	engine_init.gfx_options.debug_device = cli_result["-debugdevice"];
 	engine_init.gfx_options.shader_debug = cli_result["-shaderdebug"];
@@ -60,6 +100,30 @@ int APIENTRY wWinMain(
 	engine_init.gfx_options.pix = cli_result["-pix"];
 	engine_init.gfx_options.aftermath = cli_result["-aftermath"];
 
+    if (cli_result["-precompile"])
+    {
+        Engine::Precompile(engine_init);
+        return 0;
+    }
+
+    if (cli_result["-cpubenchmark"])
+    {
+        Engine::RunCpuBenchmarks(engine_init, cli_result["-cpubenchmarkfilter"].AsStringOr(""));
+        return 0;
+    }
+
+    if (cli_result["-benchmark"])
+    {
+        engine_init.benchmark_file = cli_result["-benchmark"].AsString();
+        Engine engine(engine_init);
+        window.GetWindowEvent().AddLambda([&engine](WindowEventData const& msg_data) { engine.OnWindowEvent(msg_data); });
+        while (window.Loop())
+        {
+            engine.Run();
+        }
+        return 0;
+    }
+
     EditorInit editor_init{ .engine_init = engine_init };
     g_Editor.Init(std::move(editor_init));
 